@@ -36,8 +36,12 @@
 #include "ao_bookmarklist.h"
 #include "ao_markword.h"
 #include "ao_tasks.h"
+#include "ao_taskscan.h"
 #include "ao_xmltagging.h"
 #include "ao_wrapwords.h"
+#include "ao_lines.h"
+#include "largefile.h"
+#include "startprof.h"
 
 
 GeanyPlugin		*geany_plugin;
@@ -83,6 +87,7 @@ typedef struct
 
 	gchar *tasks_token_list;
 	gboolean tasks_scan_all_documents;
+	gboolean tasks_scan_project;
 
 	DocListSortMode doclist_sort_mode;
 
@@ -102,29 +107,42 @@ static void ao_update_editor_menu_cb(GObject *obj, const gchar *word, gint pos,
 									 GeanyDocument *doc, gpointer data);
 static void ao_document_activate_cb(GObject *obj, GeanyDocument *doc, gpointer data);
 static void ao_document_open_cb(GObject *obj, GeanyDocument *doc, gpointer data);
+static void ao_document_new_cb(GObject *obj, GeanyDocument *doc, gpointer data);
 static void ao_document_save_cb(GObject *obj, GeanyDocument *doc, gpointer data);
 static void ao_document_before_save_cb(GObject *obj, GeanyDocument *doc, gpointer data);
 static void ao_document_close_cb(GObject *obj, GeanyDocument *doc, gpointer data);
 static void ao_document_reload_cb(GObject *obj, GeanyDocument *doc, gpointer data);
+static void ao_document_filetype_set_cb(GObject *obj, GeanyDocument *doc,
+	GeanyFiletype *filetype_old, gpointer data);
 static void ao_startup_complete_cb(GObject *obj, gpointer data);
+static void ao_project_open_cb(GObject *obj, GKeyFile *config, gpointer data);
+static void ao_project_close_cb(GObject *obj, gpointer data);
 
 gboolean ao_editor_notify_cb(GObject *object, GeanyEditor *editor,
 	SCNotification *nt, gpointer data);
 
+GP_STARTUP_PROFILE_DOCUMENT_OPEN_HANDLER(ao_document_open_profiled_cb, ao_document_open_cb)
+GP_STARTUP_PROFILE_STARTUP_COMPLETE_HANDLER(ao_startup_complete_profiled_cb, ao_startup_complete_cb)
+
 
 PluginCallback plugin_callbacks[] =
 {
 	{ "update-editor-menu", (GCallback) &ao_update_editor_menu_cb, FALSE, NULL },
 	{ "editor-notify", (GCallback) &ao_editor_notify_cb, TRUE, NULL },
 
-	{ "document-open", (GCallback) &ao_document_open_cb, TRUE, NULL },
+	{ "document-open", (GCallback) &ao_document_open_profiled_cb, TRUE, NULL },
+	{ "document-new", (GCallback) &ao_document_new_cb, TRUE, NULL },
 	{ "document-save", (GCallback) &ao_document_save_cb, TRUE, NULL },
 	{ "document-close", (GCallback) &ao_document_close_cb, TRUE, NULL },
 	{ "document-activate", (GCallback) &ao_document_activate_cb, TRUE, NULL },
 	{ "document-before-save", (GCallback) &ao_document_before_save_cb, TRUE, NULL },
 	{ "document-reload", (GCallback) &ao_document_reload_cb, TRUE, NULL },
+	{ "document-filetype-set", (GCallback) &ao_document_filetype_set_cb, TRUE, NULL },
+
+	{ "project-open", (GCallback) &ao_project_open_cb, TRUE, NULL },
+	{ "project-close", (GCallback) &ao_project_close_cb, TRUE, NULL },
 
-	{ "geany-startup-complete", (GCallback) &ao_startup_complete_cb, TRUE, NULL },
+	{ "geany-startup-complete", (GCallback) &ao_startup_complete_profiled_cb, TRUE, NULL },
 
 	{ NULL, NULL, FALSE, NULL }
 };
@@ -136,6 +154,18 @@ static void ao_startup_complete_cb(GObject *obj, gpointer data)
 }
 
 
+static void ao_project_open_cb(GObject *obj, GKeyFile *config, gpointer data)
+{
+	ao_tasks_project_changed(ao_info->tasks, FALSE);
+}
+
+
+static void ao_project_close_cb(GObject *obj, gpointer data)
+{
+	ao_tasks_project_changed(ao_info->tasks, TRUE);
+}
+
+
 static void kb_bmlist_activate(guint key_id)
 {
 	ao_bookmark_list_activate(ao_info->bookmarklist);
@@ -164,7 +194,10 @@ static void kb_ao_xmltagging(guint key_id)
 gboolean ao_editor_notify_cb(GObject *object, GeanyEditor *editor,
 							 SCNotification *nt, gpointer data)
 {
+	/* decodes text modifications once for the tasks and the bookmark list */
+	ao_lines_editor_notify(editor, nt);
 	ao_bookmark_list_update_marker(ao_info->bookmarklist, editor, nt);
+	ao_doc_list_update_modified(ao_info->doclist, editor, nt);
 	ao_mark_word_check(ao_info->markword, editor, nt);
 
 	return FALSE;
@@ -186,6 +219,7 @@ static void ao_document_activate_cb(GObject *obj, GeanyDocument *doc, gpointer d
 
 	ao_bookmark_list_update(ao_info->bookmarklist, doc);
 	ao_tasks_update_single(ao_info->tasks, doc);
+	ao_doc_list_set_active(ao_info->doclist, doc);
 }
 
 
@@ -194,6 +228,15 @@ static void ao_document_open_cb(GObject *obj, GeanyDocument *doc, gpointer data)
 	g_return_if_fail(doc != NULL && doc->is_valid);
 
 	ao_tasks_update(ao_info->tasks, doc);
+	ao_doc_list_invalidate(ao_info->doclist);
+}
+
+
+static void ao_document_new_cb(GObject *obj, GeanyDocument *doc, gpointer data)
+{
+	g_return_if_fail(doc != NULL && doc->is_valid);
+
+	ao_doc_list_invalidate(ao_info->doclist);
 }
 
 
@@ -202,6 +245,8 @@ static void ao_document_close_cb(GObject *obj, GeanyDocument *doc, gpointer data
 	g_return_if_fail(doc != NULL && doc->is_valid);
 
 	ao_tasks_remove(ao_info->tasks, doc);
+	ao_doc_list_invalidate(ao_info->doclist);
+	ao_lines_document_close(doc);
 }
 
 
@@ -210,6 +255,8 @@ static void ao_document_save_cb(GObject *obj, GeanyDocument *doc, gpointer data)
 	g_return_if_fail(doc != NULL && doc->is_valid);
 
 	ao_tasks_update(ao_info->tasks, doc);
+	/* the name may have changed */
+	ao_doc_list_invalidate(ao_info->doclist);
 }
 
 
@@ -229,6 +276,16 @@ static void ao_document_reload_cb(GObject *obj, GeanyDocument *doc, gpointer dat
 }
 
 
+static void ao_document_filetype_set_cb(GObject *obj, GeanyDocument *doc,
+	GeanyFiletype *filetype_old, gpointer data)
+{
+	g_return_if_fail(doc != NULL && doc->is_valid);
+
+	/* the icon of the document changed */
+	ao_doc_list_invalidate(ao_info->doclist);
+}
+
+
 GtkWidget *ao_image_menu_item_new(const gchar *stock_id, const gchar *label)
 {
 	GtkWidget *item = gtk_image_menu_item_new_with_label(label);
@@ -240,7 +297,7 @@ GtkWidget *ao_image_menu_item_new(const gchar *stock_id, const gchar *label)
 }
 
 
-void plugin_init(GeanyData *data)
+static void init_plugin(GeanyData *data)
 {
 	GKeyFile *config = g_key_file_new();
 	GeanyKeyGroup *key_group;
@@ -261,6 +318,8 @@ void plugin_init(GeanyData *data)
 		"addons", "enable_tasks", TRUE);
 	ao_info->tasks_scan_all_documents = utils_get_setting_boolean(config,
 		"addons", "tasks_scan_all_documents", FALSE);
+	ao_info->tasks_scan_project = utils_get_setting_boolean(config,
+		"addons", "tasks_scan_project", FALSE);
 	ao_info->tasks_token_list = utils_get_setting_string(config,
 		"addons", "tasks_token_list", "TODO;FIXME");
 	ao_info->enable_systray = utils_get_setting_boolean(config,
@@ -278,6 +337,9 @@ void plugin_init(GeanyData *data)
 	ao_info->enable_enclose_words_auto = utils_get_setting_boolean(config, "addons",
 		"enable_enclose_words_auto", FALSE);
 
+	/* the tasks project scan uses a thread pool */
+	if (! g_thread_supported())
+		g_thread_init(NULL);
 	plugin_module_make_resident(geany_plugin);
 
 	ao_info->doclist = ao_doc_list_new(ao_info->enable_doclist, ao_info->doclist_sort_mode);
@@ -286,7 +348,8 @@ void plugin_init(GeanyData *data)
 	ao_info->bookmarklist = ao_bookmark_list_new(ao_info->enable_bookmarklist);
 	ao_info->markword = ao_mark_word_new(ao_info->enable_markword);
 	ao_info->tasks = ao_tasks_new(ao_info->enable_tasks,
-						ao_info->tasks_token_list, ao_info->tasks_scan_all_documents);
+						ao_info->tasks_token_list, ao_info->tasks_scan_all_documents,
+						ao_info->tasks_scan_project);
 
 	ao_blanklines_set_enable(ao_info->strip_trailing_blank_lines);
 
@@ -304,15 +367,21 @@ void plugin_init(GeanyData *data)
 	ao_enclose_words_init(ao_info->config_file, key_group);
 	ao_enclose_words_set_enabled (ao_info->enable_enclose_words, ao_info->enable_enclose_words_auto);
 
+	gp_large_file_register(geany_plugin, _("Tasks"), GP_LARGE_FILE_DISABLED);
+	gp_large_file_register(geany_plugin, _("Mark word"), GP_LARGE_FILE_VIEWPORT_ONLY);
+
 	g_key_file_free(config);
 }
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init_plugin)
+
 
 static void ao_configure_tasks_toggled_cb(GtkToggleButton *togglebutton, gpointer data)
 {
 	gboolean sens = gtk_toggle_button_get_active(togglebutton);
 
 	gtk_widget_set_sensitive(g_object_get_data(G_OBJECT(data), "check_tasks_scan_mode"), sens);
+	gtk_widget_set_sensitive(g_object_get_data(G_OBJECT(data), "check_tasks_scan_project"), sens);
 	gtk_widget_set_sensitive(g_object_get_data(G_OBJECT(data), "entry_tasks_tokens"), sens);
 }
 
@@ -355,6 +424,8 @@ static void ao_configure_response_cb(GtkDialog *dialog, gint response, gpointer
 			g_object_get_data(G_OBJECT(dialog), "check_tasks"))));
 		ao_info->tasks_scan_all_documents = (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(
 			g_object_get_data(G_OBJECT(dialog), "check_tasks_scan_mode"))));
+		ao_info->tasks_scan_project = (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(
+			g_object_get_data(G_OBJECT(dialog), "check_tasks_scan_project"))));
 		g_free(ao_info->tasks_token_list);
 		ao_info->tasks_token_list = g_strdup(gtk_entry_get_text(GTK_ENTRY(
 			g_object_get_data(G_OBJECT(dialog), "entry_tasks_tokens"))));
@@ -384,6 +455,8 @@ static void ao_configure_response_cb(GtkDialog *dialog, gint response, gpointer
 		g_key_file_set_string(config, "addons", "tasks_token_list", ao_info->tasks_token_list);
 		g_key_file_set_boolean(config, "addons", "tasks_scan_all_documents",
 			ao_info->tasks_scan_all_documents);
+		g_key_file_set_boolean(config, "addons", "tasks_scan_project",
+			ao_info->tasks_scan_project);
 		g_key_file_set_boolean(config, "addons", "enable_systray", ao_info->enable_systray);
 		g_key_file_set_boolean(config, "addons", "enable_bookmarklist",
 			ao_info->enable_bookmarklist);
@@ -407,6 +480,7 @@ static void ao_configure_response_cb(GtkDialog *dialog, gint response, gpointer
 		g_object_set(ao_info->tasks,
 			"enable-tasks", ao_info->enable_tasks,
 			"scan-all-documents", ao_info->tasks_scan_all_documents,
+			"scan-project", ao_info->tasks_scan_project,
 			"tokens", ao_info->tasks_token_list,
 			NULL);
 		ao_blanklines_set_enable(ao_info->strip_trailing_blank_lines);
@@ -435,7 +509,7 @@ GtkWidget *plugin_configure(GtkDialog *dialog)
 	GtkWidget *check_doclist, *vbox_doclist, *frame_doclist;
 	GtkWidget *radio_doclist_name, *radio_doclist_tab_order, *radio_doclist_tab_order_reversed;
 	GtkWidget *check_bookmarklist, *check_markword, *frame_tasks, *vbox_tasks;
-	GtkWidget *check_tasks_scan_mode, *entry_tasks_tokens, *label_tasks_tokens, *tokens_hbox;
+	GtkWidget *check_tasks_scan_mode, *check_tasks_scan_project, *entry_tasks_tokens, *label_tasks_tokens, *tokens_hbox;
 	GtkWidget *check_blanklines, *check_xmltagging;
 	GtkWidget *check_enclose_words, *check_enclose_words_auto, *enclose_words_config_button, *enclose_words_hbox;
 
@@ -503,6 +577,13 @@ GtkWidget *plugin_configure(GtkDialog *dialog)
 	ui_widget_set_tooltip_text(check_tasks_scan_mode,
 		_("Whether to show the tasks of all open documents in the list or only those of the current document."));
 
+	check_tasks_scan_project = gtk_check_button_new_with_label(
+		_("Show tasks of all project files"));
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(check_tasks_scan_project),
+		ao_info->tasks_scan_project);
+	ui_widget_set_tooltip_text(check_tasks_scan_project,
+		_("Whether to also search the files below the project's base path which are not open. Only used when the tasks of all documents are shown."));
+
 	entry_tasks_tokens = gtk_entry_new();
 	if (!EMPTY(ao_info->tasks_token_list))
 		gtk_entry_set_text(GTK_ENTRY(entry_tasks_tokens), ao_info->tasks_token_list);
@@ -519,6 +600,7 @@ GtkWidget *plugin_configure(GtkDialog *dialog)
 
 	vbox_tasks = gtk_vbox_new(FALSE, 0);
 	gtk_box_pack_start(GTK_BOX(vbox_tasks), check_tasks_scan_mode, FALSE, FALSE, 3);
+	gtk_box_pack_start(GTK_BOX(vbox_tasks), check_tasks_scan_project, FALSE, FALSE, 3);
 	gtk_box_pack_start(GTK_BOX(vbox_tasks), tokens_hbox, TRUE, TRUE, 3);
 
 	frame_tasks = gtk_frame_new(NULL);
@@ -584,6 +666,7 @@ GtkWidget *plugin_configure(GtkDialog *dialog)
 	g_object_set_data(G_OBJECT(dialog), "check_tasks", check_tasks);
 	g_object_set_data(G_OBJECT(dialog), "entry_tasks_tokens", entry_tasks_tokens);
 	g_object_set_data(G_OBJECT(dialog), "check_tasks_scan_mode", check_tasks_scan_mode);
+	g_object_set_data(G_OBJECT(dialog), "check_tasks_scan_project", check_tasks_scan_project);
 	g_object_set_data(G_OBJECT(dialog), "check_systray", check_systray);
 	g_object_set_data(G_OBJECT(dialog), "check_bookmarklist", check_bookmarklist);
 	g_object_set_data(G_OBJECT(dialog), "check_markword", check_markword);
@@ -609,15 +692,19 @@ GtkWidget *plugin_configure(GtkDialog *dialog)
 
 void plugin_cleanup(void)
 {
+	gp_large_file_unregister(geany_plugin);
 	g_object_unref(ao_info->doclist);
 	g_object_unref(ao_info->openuri);
 	g_object_unref(ao_info->systray);
 	g_object_unref(ao_info->bookmarklist);
 	g_object_unref(ao_info->markword);
 	g_object_unref(ao_info->tasks);
+	ao_task_scan_cleanup();
 	g_free(ao_info->tasks_token_list);
+	ao_lines_cleanup();
 
 	ao_blanklines_set_enable(FALSE);
+	ao_enclose_words_set_enabled(FALSE, FALSE);
 
 	g_free(ao_info->config_file);
 	g_free(ao_info);
@@ -26,43 +26,62 @@
 
 static gboolean enabled = FALSE;
 
+/* size of the first block of the end of the buffer looked at, doubled as needed */
+#define TAIL_BLOCK_SIZE 4096
+
+
+/* Returns the position of the last character that is not a space, a tab or
+ * a line break, or -1 if there is none. The buffer is read directly, from
+ * the end, in blocks growing until such a character is found. */
+static gint find_last_non_blank(ScintillaObject *sci, gint maxpos)
+{
+	gint block_end = maxpos;
+	gint block_size = TAIL_BLOCK_SIZE;
+
+	while (block_end > 0)
+	{
+		gint block_start = MAX(0, block_end - block_size);
+		const gchar *text = (const gchar *) scintilla_send_message(sci,
+			SCI_GETRANGEPOINTER, block_start, block_end - block_start);
+		gint pos;
+
+		for (pos = block_end - 1; pos >= block_start; pos--)
+		{
+			gchar ch = text[pos - block_start];
+
+			if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n')
+				return pos;
+		}
+		block_end = block_start;
+		block_size *= 2;
+	}
+	return -1;
+}
+
+
 static void editor_strip_trailing_newlines(GeanyEditor *editor)
 {
-	const gint maxline = sci_get_line_count(editor->sci) - 1;
-	const gint maxpos = sci_get_line_end_position(editor->sci, maxline);
+	const gint maxpos = sci_get_length(editor->sci);
 
-	gint line, start, end, pos = 0;
-	gchar ch;
+	gint line, pos;
 
 	/*
 	 * Store index of the last non-empty line in `line' and position of the first
 	 * of its trailing spaces in `pos'. If all lines are empty, `line' will
 	 * contain -1, and `pos' will be undefined. If `line' does not contain
 	 * trailing spaces, `pos' will be its end position.
+	 *
+	 * We can't be sure that `geany_data->file_prefs->strip_trailing_spaces'
+	 * setting is set, so trailing spaces are looked for too.
 	 */
-	for (line = maxline; line >= 0; line--)
+	pos = find_last_non_blank(editor->sci, maxpos);
+	if (pos >= 0)
 	{
-		start = sci_get_position_from_line(editor->sci, line);
-		end = sci_get_line_end_position(editor->sci, line);
-
-		/*
-		 * We can't be sure that `geany_data->file_prefs->strip_trailing_spaces'
-		 * setting is set, so we should check for trailing spaces manually.
-		 * Performance overhead of the for loop below is very small anyway,
-		 * so it does not worth checking the setting manually and writing
-		 * additional code.
-		 */
-
-		for (pos = end-1; pos >= start; pos--)
-		{
-			ch = sci_get_char_at(editor->sci, pos);
-			if (ch != ' ' && ch != '\t')
-				break;
-		}
-		++pos;
-		if (pos > start)
-			break;
+		line = sci_get_line_from_position(editor->sci, pos);
+		pos++;
 	}
+	else
+		line = -1;
 
 	if (line == -1 || geany_data->file_prefs->final_new_line)
 	{
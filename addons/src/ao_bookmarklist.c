@@ -31,6 +31,7 @@
 
 #include "addons.h"
 #include "ao_bookmarklist.h"
+#include "ao_lines.h"
 
 #include <gdk/gdkkeysyms.h>
 
@@ -60,10 +61,17 @@ struct _AoBookmarkListPrivate
 	GtkListStore *store;
 	GtkWidget *tree;
 
-	gint		 search_line;
-	GtkTreeIter	*search_iter;
+	/* the document whose bookmarks are listed, and its bookmarks sorted by line */
+	ScintillaObject	*sci;
+	GArray			*lines;
 };
 
+typedef struct
+{
+	gint line;
+	GtkTreeIter iter;
+} AoBookmark;
+
 enum
 {
 	PROP_0,
@@ -136,38 +144,41 @@ static void ao_bookmark_list_finalize(GObject *object)
 	g_return_if_fail(IS_AO_BOOKMARK_LIST(object));
 
 	ao_bookmark_list_hide(AO_BOOKMARK_LIST(object));
+	ao_lines_disconnect(ao_bookmark_list_lines_changed_cb, object);
+	g_array_free(AO_BOOKMARK_LIST_GET_PRIVATE(object)->lines, TRUE);
 
 	G_OBJECT_CLASS(ao_bookmark_list_parent_class)->finalize(object);
 }
 
 
-static gboolean tree_model_foreach(GtkTreeModel *model, GtkTreePath *path,
-								   GtkTreeIter *iter, gpointer data)
+/* Returns the index in priv->lines of the bookmark at line_nr, or of the first one after it */
+static guint find_line(AoBookmarkListPrivate *priv, gint line_nr)
 {
-	gint x;
-	AoBookmarkListPrivate *priv = AO_BOOKMARK_LIST_GET_PRIVATE(data);
+	guint lo = 0;
+	guint hi = priv->lines->len;
 
-	gtk_tree_model_get(model, iter, BMLIST_COL_LINE, &x, -1);
-	if (x == priv->search_line)
+	while (lo < hi)
 	{
-		priv->search_iter = gtk_tree_iter_copy(iter);
-		return TRUE;
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index(priv->lines, AoBookmark, mid).line < line_nr)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	return FALSE;
+	return lo;
 }
 
 
 static void delete_line(AoBookmarkList *bm, gint line_nr)
 {
 	AoBookmarkListPrivate *priv = AO_BOOKMARK_LIST_GET_PRIVATE(bm);
+	guint i = find_line(priv, line_nr);
 
-	priv->search_line = line_nr + 1;
-	priv->search_iter = NULL;
-	gtk_tree_model_foreach(GTK_TREE_MODEL(priv->store), tree_model_foreach, bm);
-	if (priv->search_iter != NULL)
+	if (i < priv->lines->len && g_array_index(priv->lines, AoBookmark, i).line == line_nr)
 	{
-		gtk_list_store_remove(priv->store, priv->search_iter);
-		gtk_tree_iter_free(priv->search_iter);
+		gtk_list_store_remove(priv->store, &g_array_index(priv->lines, AoBookmark, i).iter);
+		g_array_remove_index(priv->lines, i);
 	}
 }
 
@@ -175,23 +186,95 @@ static void delete_line(AoBookmarkList *bm, gint line_nr)
 static void add_line(AoBookmarkList *bm, ScintillaObject *sci, gint line_nr)
 {
 	gchar *line, *tooltip;
+	AoBookmark bookmark;
 	AoBookmarkListPrivate *priv = AO_BOOKMARK_LIST_GET_PRIVATE(bm);
+	guint i = find_line(priv, line_nr);
+
+	if (i < priv->lines->len && g_array_index(priv->lines, AoBookmark, i).line == line_nr)
+		return; /* already listed */
 
 	line = g_strstrip(sci_get_line(sci, line_nr));
 	if (EMPTY(line))
 		line = g_strdup(_("(Empty Line)"));
 	tooltip = g_markup_escape_text(line, -1);
 
-	gtk_list_store_insert_with_values(priv->store, NULL, -1,
+	/* the rows are in the same order as the bookmarks */
+	bookmark.line = line_nr;
+	gtk_list_store_insert_with_values(priv->store, &bookmark.iter, (gint) i,
 		BMLIST_COL_LINE, line_nr + 1,
 		BMLIST_COL_NAME, line,
 		BMLIST_COL_TOOLTIP, tooltip,
 		-1);
+	g_array_insert_val(priv->lines, i, bookmark);
 	g_free(line);
 	g_free(tooltip);
 }
 
 
+/* Moves the bookmarks from the index first on by lines_added lines */
+static void shift_lines(AoBookmarkList *bm, guint first, gint lines_added)
+{
+	AoBookmarkListPrivate *priv = AO_BOOKMARK_LIST_GET_PRIVATE(bm);
+	guint i;
+
+	for (i = first; i < priv->lines->len; i++)
+	{
+		AoBookmark *bookmark = &g_array_index(priv->lines, AoBookmark, i);
+
+		bookmark->line += lines_added;
+		gtk_list_store_set(priv->store, &bookmark->iter, BMLIST_COL_LINE, bookmark->line + 1, -1);
+	}
+}
+
+
+/* Follows what Scintilla does to the markers when lines are added or removed */
+static void ao_bookmark_list_lines_changed_cb(GeanyDocument *doc, const AoLinesChange *change,
+											  gpointer data)
+{
+	AoBookmarkList *bm = data;
+	AoBookmarkListPrivate *priv = AO_BOOKMARK_LIST_GET_PRIVATE(bm);
+	ScintillaObject *sci = doc->editor->sci;
+	gint line_nr = change->line;
+	guint first;
+
+	if (! priv->enable_bookmarklist || sci != priv->sci || change->lines_added == 0)
+		return;
+
+	if (change->inserted)
+	{
+		/* text inserted at the start of a line pushes its markers down */
+		if (change->at_line_start)
+			first = find_line(priv, line_nr);
+		else
+			first = find_line(priv, line_nr + 1);
+		shift_lines(bm, first, change->lines_added);
+	}
+	else
+	{
+		/* markers of removed lines are merged into the line of the deletion */
+		guint last;
+
+		first = find_line(priv, line_nr + 1);
+		last = find_line(priv, line_nr + 1 - change->lines_added);
+		if (last > first)
+		{
+			guint i;
+
+			for (i = first; i < last; i++)
+				gtk_list_store_remove(priv->store, &g_array_index(priv->lines, AoBookmark, i).iter);
+			g_array_remove_range(priv->lines, first, last - first);
+			if (sci_is_marker_set_at_line(sci, line_nr, 1) &&
+				(first == 0 || g_array_index(priv->lines, AoBookmark, first - 1).line != line_nr))
+			{
+				add_line(bm, sci, line_nr);
+				first++;
+			}
+		}
+		shift_lines(bm, first, change->lines_added);
+	}
+}
+
+
 static gboolean ao_selection_changed_cb(gpointer widget)
 {
 	GtkTreeSelection *selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(widget));
@@ -276,6 +359,8 @@ static void ao_bookmark_list_hide(AoBookmarkList *bm)
 		gtk_widget_destroy(priv->popup_menu);
 		priv->popup_menu = NULL;
 	}
+	g_array_set_size(priv->lines, 0);
+	priv->sci = NULL;
 }
 
 
@@ -320,7 +405,6 @@ static void ao_bookmark_list_show(AoBookmarkList *bm)
 	GtkTreeView *tree;
 	GtkListStore *store;
 	GtkWidget *scrollwin;
-	GtkTreeSortable *sortable;
 	GeanyDocument *doc;
 	AoBookmarkListPrivate *priv = AO_BOOKMARK_LIST_GET_PRIVATE(bm);
 
@@ -346,9 +430,7 @@ static void ao_bookmark_list_show(AoBookmarkList *bm)
 
 	gtk_tree_view_set_search_column(tree, BMLIST_COL_NAME);
 
-	/* sorting */
-	sortable = GTK_TREE_SORTABLE(GTK_TREE_MODEL(store));
-	gtk_tree_sortable_set_sort_column_id(sortable, BMLIST_COL_LINE, GTK_SORT_ASCENDING);
+	/* no sorting, rows are inserted in line order */
 
 	ui_widget_modify_font_from_string(GTK_WIDGET(tree), geany->interface_prefs->tagbar_font);
 
@@ -409,12 +491,23 @@ void ao_bookmark_list_update(AoBookmarkList *bm, GeanyDocument *doc)
 
 	if (priv->enable_bookmarklist)
 	{
+		GtkTreeModel *model = GTK_TREE_MODEL(priv->store);
+
+		/* detach the model so the view doesn't follow each row */
+		g_object_ref(model);
+		gtk_tree_view_set_model(GTK_TREE_VIEW(priv->tree), NULL);
+
 		gtk_list_store_clear(priv->store);
+		g_array_set_size(priv->lines, 0);
+		priv->sci = sci;
 		while ((line_nr = scintilla_send_message(sci, SCI_MARKERNEXT, line_nr, mask)) != -1)
 		{
 			add_line(bm, sci, line_nr);
 			line_nr++;
 		}
+
+		gtk_tree_view_set_model(GTK_TREE_VIEW(priv->tree), model);
+		g_object_unref(model);
 	}
 }
 
@@ -423,8 +516,10 @@ void ao_bookmark_list_update_marker(AoBookmarkList *bm, GeanyEditor *editor, SCN
 {
 	AoBookmarkListPrivate *priv = AO_BOOKMARK_LIST_GET_PRIVATE(bm);
 
-	if (priv->enable_bookmarklist &&
-		nt->nmhdr.code == SCN_MODIFIED && nt->modificationType == SC_MOD_CHANGEMARKER)
+	if (! priv->enable_bookmarklist || nt->nmhdr.code != SCN_MODIFIED || editor->sci != priv->sci)
+		return;
+
+	if (nt->modificationType == SC_MOD_CHANGEMARKER)
 	{
 		if (sci_is_marker_set_at_line(editor->sci, nt->line, 1))
 		{
@@ -443,6 +538,9 @@ static void ao_bookmark_list_init(AoBookmarkList *self)
 	AoBookmarkListPrivate *priv = AO_BOOKMARK_LIST_GET_PRIVATE(self);
 
 	priv->page = NULL;
+	priv->sci = NULL;
+	priv->lines = g_array_new(FALSE, FALSE, sizeof(AoBookmark));
+	ao_lines_connect(ao_bookmark_list_lines_changed_cb, self);
 }
 
 
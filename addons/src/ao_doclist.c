@@ -28,6 +28,8 @@
 	#include "config.h"
 #endif
 #include <geanyplugin.h>
+#include <gdk/gdkkeysyms.h>
+#include <string.h>
 
 #include "addons.h"
 #include "ao_doclist.h"
@@ -53,6 +55,17 @@ struct _AoDocListPrivate
 	gboolean enable_doclist;
 	DocListSortMode sort_mode;
 	GtkToolItem *toolbar_doclist_button;
+
+	/* the document menu is kept between popups, and rebuilt only when needed */
+	GtkWidget *menu;
+	GtkWidget *filter_item;
+	GHashTable *items;			/* GeanyDocument* -> its menu item */
+	GeanyDocument *active_doc;
+	gboolean menu_dirty;
+	guint rebuild_source;
+	gulong reorder_handler;
+
+	GString *filter;
 };
 
 enum
@@ -112,6 +125,14 @@ static void ao_doc_list_finalize(GObject *object)
 
 	if (priv->toolbar_doclist_button != NULL)
 		gtk_widget_destroy(GTK_WIDGET(priv->toolbar_doclist_button));
+	if (priv->rebuild_source != 0)
+		g_source_remove(priv->rebuild_source);
+	if (priv->reorder_handler != 0)
+		g_signal_handler_disconnect(geany->main_widgets->notebook, priv->reorder_handler);
+	if (priv->menu != NULL)
+		gtk_widget_destroy(priv->menu);
+	g_hash_table_destroy(priv->items);
+	g_string_free(priv->filter, TRUE);
 
 	G_OBJECT_CLASS(ao_doc_list_parent_class)->finalize(object);
 }
@@ -170,52 +191,272 @@ static void ao_doclist_menu_item_activate_cb(GtkMenuItem *menuitem, gpointer dat
 }
 
 
-static void ao_toolbar_item_doclist_clicked_cb(GtkWidget *button, gpointer data)
+static GCompareFunc ao_doclist_get_compare_func(AoDocListPrivate *priv)
 {
-	static GtkWidget *menu = NULL;
-	GtkWidget *menu_item;
-	GeanyDocument *current_doc = document_get_current();
-	GCompareFunc compare_func;
-	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(data);
-
-	if (menu != NULL)
-		gtk_widget_destroy(menu);
-
-	menu = gtk_menu_new();
-
 	switch (priv->sort_mode)
 	{
 		case DOCLIST_SORT_BY_NAME:
-			compare_func = document_compare_by_display_name;
-			break;
+			return document_compare_by_display_name;
 		case DOCLIST_SORT_BY_TAB_ORDER_REVERSE:
-			compare_func = document_compare_by_tab_order_reverse;
-			break;
+			return document_compare_by_tab_order_reverse;
 		case DOCLIST_SORT_BY_TAB_ORDER:
 		default:
-			compare_func = document_compare_by_tab_order;
-			break;
+			return document_compare_by_tab_order;
+	}
+}
+
+
+static void ao_doclist_set_item_active(GtkWidget *item, gboolean active)
+{
+	GtkWidget *label = gtk_bin_get_child(GTK_BIN(item));
+	const gchar *base_name = g_object_get_data(G_OBJECT(item), "ao-doclist-name");
+
+	if (active)
+	{
+		gchar *markup = g_markup_printf_escaped("<b>%s</b>", base_name);
+		gtk_label_set_markup(GTK_LABEL(label), markup);
+		g_free(markup);
 	}
+	else
+		gtk_label_set_text(GTK_LABEL(label), base_name);
+}
+
+
+/* Shows only the documents whose name contains the typed filter */
+static void ao_doclist_apply_filter(AoDocListPrivate *priv)
+{
+	GHashTableIter iter;
+	gpointer item;
+	gchar *filter = g_utf8_casefold(priv->filter->str, -1);
+	GtkWidget *first = NULL;
+	GList *children, *node;
+
+	g_hash_table_iter_init(&iter, priv->items);
+	while (g_hash_table_iter_next(&iter, NULL, &item))
+	{
+		const gchar *key = g_object_get_data(G_OBJECT(item), "ao-doclist-key");
+
+		if (strstr(key, filter) != NULL)
+			gtk_widget_show(item);
+		else
+			gtk_widget_hide(item);
+	}
+
+	if (priv->filter->len > 0)
+	{
+		gchar *text = g_strdup_printf(_("Filter: %s"), priv->filter->str);
+		gtk_label_set_text(GTK_LABEL(gtk_bin_get_child(GTK_BIN(priv->filter_item))), text);
+		gtk_widget_show(priv->filter_item);
+		g_free(text);
+	}
+	else
+		gtk_widget_hide(priv->filter_item);
+
+	/* select the first shown document */
+	children = gtk_container_get_children(GTK_CONTAINER(priv->menu));
+	for (node = children; node != NULL && first == NULL; node = node->next)
+	{
+		if (GTK_WIDGET_VISIBLE(node->data) &&
+			g_object_get_data(G_OBJECT(node->data), "ao-doclist-key") != NULL)
+			first = node->data;
+	}
+	g_list_free(children);
+	if (first != NULL && priv->filter->len > 0)
+		gtk_menu_shell_select_item(GTK_MENU_SHELL(priv->menu), first);
+
+	g_free(filter);
+}
+
+
+static gboolean ao_doclist_menu_key_press_cb(GtkWidget *widget, GdkEventKey *event, gpointer data)
+{
+	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(data);
+	gunichar ch = gdk_keyval_to_unicode(event->keyval);
+
+	if (event->keyval == GDK_BackSpace)
+	{
+		if (priv->filter->len > 0)
+		{
+			const gchar *last = g_utf8_prev_char(priv->filter->str + priv->filter->len);
+			g_string_truncate(priv->filter, last - priv->filter->str);
+			ao_doclist_apply_filter(priv);
+		}
+		return TRUE;
+	}
+	else if (ch != 0 && g_unichar_isprint(ch) &&
+		! (event->state & (GDK_CONTROL_MASK | GDK_MOD1_MASK)))
+	{
+		g_string_append_unichar(priv->filter, ch);
+		ao_doclist_apply_filter(priv);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+
+static void ao_doclist_menu_deactivate_cb(GtkWidget *widget, gpointer data)
+{
+	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(data);
+
+	if (priv->filter->len > 0)
+	{
+		g_string_truncate(priv->filter, 0);
+		ao_doclist_apply_filter(priv);
+	}
+}
+
+
+static void ao_doclist_rebuild_menu(AoDocList *self)
+{
+	GtkWidget *menu_item;
+	GeanyDocument *current_doc = document_get_current();
+	GCompareFunc compare_func;
+	GPtrArray *sorted_documents;
+	GList *children, *node;
+	guint i;
+	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(self);
+
+	if (priv->menu != NULL)
+		gtk_widget_destroy(priv->menu);
+	g_hash_table_remove_all(priv->items);
+
+	priv->menu = gtk_menu_new();
+	g_signal_connect(priv->menu, "key-press-event", G_CALLBACK(ao_doclist_menu_key_press_cb), self);
+	g_signal_connect(priv->menu, "deactivate", G_CALLBACK(ao_doclist_menu_deactivate_cb), self);
+
+	priv->filter_item = gtk_menu_item_new_with_label("");
+	gtk_widget_set_sensitive(priv->filter_item, FALSE);
+	gtk_container_add(GTK_CONTAINER(priv->menu), priv->filter_item);
 
-	ui_menu_add_document_items_sorted(GTK_MENU(menu), current_doc,
+	compare_func = ao_doclist_get_compare_func(priv);
+	ui_menu_add_document_items_sorted(GTK_MENU(priv->menu), current_doc,
 		G_CALLBACK(ao_doclist_menu_item_activate_cb), compare_func);
 
+	/* Find which item is which document, sorting them the same way. The items are
+	 * only updated in place if each one activates the expected document. */
+	sorted_documents = g_ptr_array_new();
+	foreach_document(i)
+		g_ptr_array_add(sorted_documents, documents[i]);
+	g_ptr_array_sort(sorted_documents, compare_func);
+
+	children = gtk_container_get_children(GTK_CONTAINER(priv->menu));
+	for (node = children->next, i = 0; node != NULL && i < sorted_documents->len;
+		 node = node->next, i++)
+	{
+		GeanyDocument *doc = g_ptr_array_index(sorted_documents, i);
+		gchar *base_name;
+		gchar *key;
+
+		if (g_signal_handler_find(node->data, G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
+				0, 0, NULL, (gpointer) ao_doclist_menu_item_activate_cb, doc) == 0)
+		{
+			g_hash_table_remove_all(priv->items);
+			break;
+		}
+		base_name = g_path_get_basename(DOC_FILENAME(doc));
+		key = g_utf8_casefold(base_name, -1);
+		g_object_set_data_full(G_OBJECT(node->data), "ao-doclist-name", base_name, g_free);
+		g_object_set_data_full(G_OBJECT(node->data), "ao-doclist-key", key, g_free);
+		g_hash_table_insert(priv->items, doc, node->data);
+	}
+	g_list_free(children);
+	g_ptr_array_free(sorted_documents, TRUE);
+
 	menu_item = gtk_separator_menu_item_new();
 	gtk_widget_show(menu_item);
-	gtk_container_add(GTK_CONTAINER(menu), menu_item);
+	gtk_container_add(GTK_CONTAINER(priv->menu), menu_item);
 
 	menu_item = ui_image_menu_item_new(GTK_STOCK_CLOSE, _("Close Ot_her Documents"));
 	gtk_widget_show(menu_item);
-	gtk_container_add(GTK_CONTAINER(menu), menu_item);
+	gtk_container_add(GTK_CONTAINER(priv->menu), menu_item);
 	g_signal_connect(menu_item, "activate", G_CALLBACK(ao_doclist_menu_item_activate_cb),
 		GINT_TO_POINTER(ACTION_CLOSE_OTHER));
 	menu_item = ui_image_menu_item_new(GTK_STOCK_CLOSE, _("C_lose All"));
 	gtk_widget_show(menu_item);
-	gtk_container_add(GTK_CONTAINER(menu), menu_item);
+	gtk_container_add(GTK_CONTAINER(priv->menu), menu_item);
 	g_signal_connect(menu_item, "activate", G_CALLBACK(ao_doclist_menu_item_activate_cb),
 		GINT_TO_POINTER(ACTION_CLOSE_ALL));
 
-	gtk_menu_popup(GTK_MENU(menu), NULL, NULL,
+	priv->active_doc = current_doc;
+	priv->menu_dirty = FALSE;
+}
+
+
+static gboolean ao_doclist_rebuild_idle(gpointer data)
+{
+	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(data);
+
+	priv->rebuild_source = 0;
+	if (priv->menu_dirty && priv->enable_doclist)
+		ao_doclist_rebuild_menu(AO_DOC_LIST(data));
+	return FALSE;
+}
+
+
+/* Rebuilds the menu once idle, so that several changes in a row cause one rebuild */
+void ao_doc_list_invalidate(AoDocList *self)
+{
+	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(self);
+
+	priv->menu_dirty = TRUE;
+	if (priv->enable_doclist && priv->rebuild_source == 0)
+		priv->rebuild_source = g_idle_add(ao_doclist_rebuild_idle, self);
+}
+
+
+/* Updates the highlighting of the active document without rebuilding the menu */
+void ao_doc_list_set_active(AoDocList *self, GeanyDocument *doc)
+{
+	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(self);
+	GtkWidget *old_item, *new_item;
+
+	if (priv->menu_dirty || doc == priv->active_doc)
+		return;
+
+	old_item = priv->active_doc ? g_hash_table_lookup(priv->items, priv->active_doc) : NULL;
+	new_item = doc ? g_hash_table_lookup(priv->items, doc) : NULL;
+	if ((priv->active_doc != NULL && old_item == NULL) || (doc != NULL && new_item == NULL))
+	{
+		ao_doc_list_invalidate(self);
+		return;
+	}
+
+	if (old_item != NULL)
+		ao_doclist_set_item_active(old_item, FALSE);
+	if (new_item != NULL)
+		ao_doclist_set_item_active(new_item, TRUE);
+	priv->active_doc = doc;
+}
+
+
+/* The colour of the items shows whether the documents are modified */
+void ao_doc_list_update_modified(AoDocList *self, GeanyEditor *editor, SCNotification *nt)
+{
+	if (nt->nmhdr.code == SCN_SAVEPOINTLEFT || nt->nmhdr.code == SCN_SAVEPOINTREACHED)
+		ao_doc_list_invalidate(self);
+}
+
+
+static void ao_doclist_page_reordered_cb(GtkNotebook *notebook, GtkWidget *child,
+										 guint page_num, gpointer data)
+{
+	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(data);
+
+	if (priv->sort_mode != DOCLIST_SORT_BY_NAME)
+		ao_doc_list_invalidate(AO_DOC_LIST(data));
+}
+
+
+static void ao_toolbar_item_doclist_clicked_cb(GtkWidget *button, gpointer data)
+{
+	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(data);
+
+	if (priv->menu == NULL || priv->menu_dirty)
+		ao_doclist_rebuild_menu(AO_DOC_LIST(data));
+	else
+		ao_doc_list_set_active(AO_DOC_LIST(data), document_get_current());
+
+	gtk_menu_popup(GTK_MENU(priv->menu), NULL, NULL,
 		ao_popup_position_menu, button, 0, gtk_get_current_event_time());
 }
 
@@ -262,9 +503,11 @@ static void ao_doclist_set_property(GObject *object, guint prop_id,
 		case PROP_ENABLE_DOCLIST:
 			priv->enable_doclist = g_value_get_boolean(value);
 			ao_toolbar_update(AO_DOC_LIST(object));
+			ao_doc_list_invalidate(AO_DOC_LIST(object));
 			break;
 		case PROP_SORT_MODE:
 			priv->sort_mode = g_value_get_int(value);
+			ao_doc_list_invalidate(AO_DOC_LIST(object));
 			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -278,6 +521,15 @@ static void ao_doc_list_init(AoDocList *self)
 	AoDocListPrivate *priv = AO_DOC_LIST_GET_PRIVATE(self);
 
 	priv->toolbar_doclist_button = NULL;
+	priv->menu = NULL;
+	priv->filter_item = NULL;
+	priv->items = g_hash_table_new(g_direct_hash, g_direct_equal);
+	priv->active_doc = NULL;
+	priv->menu_dirty = TRUE;
+	priv->rebuild_source = 0;
+	priv->filter = g_string_new(NULL);
+	priv->reorder_handler = g_signal_connect(geany->main_widgets->notebook, "page-reordered",
+		G_CALLBACK(ao_doclist_page_reordered_cb), self);
 }
 
 
@@ -51,6 +51,10 @@ typedef enum
 
 GType		ao_doc_list_get_type		(void);
 AoDocList*	ao_doc_list_new				(gboolean enable, DocListSortMode sort_mode);
+void		ao_doc_list_invalidate		(AoDocList *self);
+void		ao_doc_list_set_active		(AoDocList *self, GeanyDocument *doc);
+void		ao_doc_list_update_modified	(AoDocList *self, GeanyEditor *editor,
+										 SCNotification *nt);
 
 G_END_DECLS
 
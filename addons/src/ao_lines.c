@@ -0,0 +1,136 @@
+/*
+ *      ao_lines.c - this file is part of Addons, a Geany plugin
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Text modifications of the documents, decoded once from the editor notifications and
+ * passed on to the addons keeping per-line data (tasks, bookmark list, mark word) */
+
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+#include <geanyplugin.h>
+
+#include "addons.h"
+#include "ao_lines.h"
+
+
+typedef struct
+{
+	AoLinesChangedFunc func;
+	gpointer data;
+} Subscriber;
+
+
+static GArray *subscribers = NULL;
+/* GeanyDocument -> number of modifications since it was opened */
+static GHashTable *generations = NULL;
+static guint last_generation = 0;
+
+
+void ao_lines_connect(AoLinesChangedFunc func, gpointer data)
+{
+	Subscriber subscriber;
+
+	if (subscribers == NULL)
+		subscribers = g_array_new(FALSE, FALSE, sizeof(Subscriber));
+
+	subscriber.func = func;
+	subscriber.data = data;
+	g_array_append_val(subscribers, subscriber);
+}
+
+
+void ao_lines_disconnect(AoLinesChangedFunc func, gpointer data)
+{
+	guint i;
+
+	for (i = 0; subscribers != NULL && i < subscribers->len; i++)
+	{
+		Subscriber *subscriber = &g_array_index(subscribers, Subscriber, i);
+
+		if (subscriber->func == func && subscriber->data == data)
+		{
+			g_array_remove_index(subscribers, i);
+			break;
+		}
+	}
+}
+
+
+/* Returns a number which changes each time the text of doc is modified */
+guint ao_lines_get_generation(GeanyDocument *doc)
+{
+	if (generations == NULL)
+		return 0;
+	return GPOINTER_TO_UINT(g_hash_table_lookup(generations, doc));
+}
+
+
+void ao_lines_editor_notify(GeanyEditor *editor, SCNotification *nt)
+{
+	AoLinesChange change;
+	guint i;
+
+	if (nt->nmhdr.code != SCN_MODIFIED ||
+		! (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+		return;
+
+	if (generations == NULL)
+		generations = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_insert(generations, editor->document, GUINT_TO_POINTER(++last_generation));
+
+	if (subscribers == NULL || subscribers->len == 0)
+		return;
+
+	change.position = nt->position;
+	change.length = nt->length;
+	change.line = sci_get_line_from_position(editor->sci, nt->position);
+	change.lines_added = nt->linesAdded;
+	change.inserted = (nt->modificationType & SC_MOD_INSERTTEXT) != 0;
+	change.at_line_start = (sci_get_position_from_line(editor->sci, change.line) == nt->position);
+
+	for (i = 0; i < subscribers->len; i++)
+	{
+		Subscriber *subscriber = &g_array_index(subscribers, Subscriber, i);
+
+		subscriber->func(editor->document, &change, subscriber->data);
+	}
+}
+
+
+void ao_lines_document_close(GeanyDocument *doc)
+{
+	/* the document structure is reused by the next opened document */
+	if (generations != NULL)
+		g_hash_table_insert(generations, doc, GUINT_TO_POINTER(++last_generation));
+}
+
+
+void ao_lines_cleanup(void)
+{
+	if (subscribers != NULL)
+	{
+		g_array_free(subscribers, TRUE);
+		subscribers = NULL;
+	}
+	if (generations != NULL)
+	{
+		g_hash_table_destroy(generations);
+		generations = NULL;
+	}
+}
@@ -0,0 +1,48 @@
+/*
+ *      ao_lines.h - this file is part of Addons, a Geany plugin
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __AO_LINES_H__
+#define __AO_LINES_H__
+
+G_BEGIN_DECLS
+
+/* A text modification of a document, in lines */
+typedef struct
+{
+	gint position;			/* where the text was inserted or deleted */
+	gint length;			/* length of the inserted or deleted text */
+	gint line;				/* line of position */
+	gint lines_added;		/* negative when lines were deleted */
+	gboolean inserted;		/* whether text was inserted, otherwise deleted */
+	gboolean at_line_start;	/* whether position is the start of line */
+} AoLinesChange;
+
+typedef void (*AoLinesChangedFunc) (GeanyDocument *doc, const AoLinesChange *change, gpointer data);
+
+
+void	ao_lines_connect				(AoLinesChangedFunc func, gpointer data);
+void	ao_lines_disconnect				(AoLinesChangedFunc func, gpointer data);
+guint	ao_lines_get_generation			(GeanyDocument *doc);
+void	ao_lines_editor_notify			(GeanyEditor *editor, SCNotification *nt);
+void	ao_lines_document_close			(GeanyDocument *doc);
+void	ao_lines_cleanup				(void);
+
+G_END_DECLS
+
+#endif /* __AO_LINES_H__ */
@@ -28,6 +28,8 @@
 
 #include "addons.h"
 #include "ao_markword.h"
+#include "ao_lines.h"
+#include "largefile.h"
 
 
 typedef struct _AoMarkWordPrivate			AoMarkWordPrivate;
@@ -48,8 +50,24 @@ struct _AoMarkWordClass
 struct _AoMarkWordPrivate
 {
 	gboolean enable_markword;
+
+	/* what was marked last, to not search the whole document again for it */
+	GeanyDocument *marked_doc;
+	guint marked_generation;
+	gchar *marked_word;
+
+	/* marking of the rest of the document once idle */
+	guint mark_source;
+	gint mark_pos;			/* where to search next */
+	gint mark_end;			/* end of the current pass */
+	gint mark_stop;			/* where the visible range, marked first, starts */
+	gboolean mark_wrapped;	/* whether the pass from the start of the document is done */
+	gint mark_count;
 };
 
+/* number of bytes searched at once when idle */
+#define MARK_CHUNK_SIZE 262144
+
 enum
 {
 	PROP_0,
@@ -104,10 +122,118 @@ static void ao_mark_word_finalize(GObject *object)
 	g_return_if_fail(object != NULL);
 	g_return_if_fail(IS_AO_MARKWORD(object));
 
+	if (AO_MARKWORD_GET_PRIVATE(object)->mark_source != 0)
+		g_source_remove(AO_MARKWORD_GET_PRIVATE(object)->mark_source);
+	g_free(AO_MARKWORD_GET_PRIVATE(object)->marked_word);
+
 	G_OBJECT_CLASS(ao_mark_word_parent_class)->finalize(object);
 }
 
 
+/* Marks the occurrences of word between start and end, returns their number */
+static gint mark_range(GeanyEditor *editor, const gchar *word, gint start, gint end)
+{
+	struct Sci_TextToFind ttf;
+	gint count = 0;
+
+	ttf.chrg.cpMin = start;
+	ttf.chrg.cpMax = end;
+	ttf.lpstrText = (gchar *) word;
+	while (ttf.chrg.cpMin < end &&
+		sci_find_text(editor->sci, SCFIND_MATCHCASE | SCFIND_WHOLEWORD, &ttf) != -1)
+	{
+		if (ttf.chrgText.cpMax <= ttf.chrgText.cpMin)
+			break;
+		editor_indicator_set_on_range(editor, GEANY_INDICATOR_SEARCH,
+			ttf.chrgText.cpMin, ttf.chrgText.cpMax);
+		ttf.chrg.cpMin = ttf.chrgText.cpMax;
+		count++;
+	}
+	return count;
+}
+
+
+static void stop_marking(AoMarkWordPrivate *priv)
+{
+	if (priv->mark_source != 0)
+	{
+		g_source_remove(priv->mark_source);
+		priv->mark_source = 0;
+	}
+}
+
+
+static gboolean mark_idle_cb(gpointer data)
+{
+	AoMarkWordPrivate *priv = AO_MARKWORD_GET_PRIVATE(data);
+	GeanyDocument *doc = priv->marked_doc;
+	ScintillaObject *sci;
+	gint end;
+
+	/* stop if the document was closed or modified meanwhile */
+	if (! DOC_VALID(doc) || ao_lines_get_generation(doc) != priv->marked_generation)
+	{
+		priv->mark_source = 0;
+		return FALSE;
+	}
+	sci = doc->editor->sci;
+
+	/* words don't span lines, so chunks end at line ends */
+	end = MIN(priv->mark_pos + MARK_CHUNK_SIZE, priv->mark_end);
+	if (end < priv->mark_end)
+		end = MIN(sci_get_line_end_position(sci, sci_get_line_from_position(sci, end)),
+			priv->mark_end);
+
+	priv->mark_count += mark_range(doc->editor, priv->marked_word, priv->mark_pos, end);
+	priv->mark_pos = end;
+
+	if (priv->mark_pos >= priv->mark_end)
+	{
+		if (! priv->mark_wrapped)
+		{	/* go on from the start of the document up to the visible range */
+			priv->mark_wrapped = TRUE;
+			priv->mark_pos = 0;
+			priv->mark_end = priv->mark_stop;
+			return TRUE;
+		}
+		ui_set_statusbar(FALSE, _("Found %d matches for \"%s\"."),
+			priv->mark_count, priv->marked_word);
+		priv->mark_source = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+/* Marks all occurrences of word in the document, those on the screen right away and the
+ * other ones in chunks once idle, not to block on huge documents */
+static void start_marking(AoMarkWord *mw, GeanyEditor *editor)
+{
+	AoMarkWordPrivate *priv = AO_MARKWORD_GET_PRIVATE(mw);
+	ScintillaObject *sci = editor->sci;
+	gint first_line, last_line, start, end;
+
+	stop_marking(priv);
+	editor_indicator_clear(editor, GEANY_INDICATOR_SEARCH);
+
+	first_line = scintilla_send_message(sci, SCI_DOCLINEFROMVISIBLE,
+		scintilla_send_message(sci, SCI_GETFIRSTVISIBLELINE, 0, 0), 0);
+	last_line = first_line + scintilla_send_message(sci, SCI_LINESONSCREEN, 0, 0);
+	last_line = MIN(last_line, sci_get_line_count(sci) - 1);
+	start = sci_get_position_from_line(sci, first_line);
+	end = sci_get_line_end_position(sci, last_line);
+
+	priv->mark_count = mark_range(editor, priv->marked_word, start, end);
+	priv->mark_pos = end;
+	priv->mark_end = sci_get_length(sci);
+	priv->mark_stop = start;
+	priv->mark_wrapped = FALSE;
+	/* only the visible occurrences are marked in large documents */
+	if (! gp_large_file_check(editor->document))
+		priv->mark_source = g_idle_add_full(G_PRIORITY_LOW, mark_idle_cb, mw, NULL);
+}
+
+
 void ao_mark_word_check(AoMarkWord *bm, GeanyEditor *editor, SCNotification *nt)
 {
 	AoMarkWordPrivate *priv = AO_MARKWORD_GET_PRIVATE(bm);
@@ -117,8 +243,37 @@ void ao_mark_word_check(AoMarkWord *bm, GeanyEditor *editor, SCNotification *nt)
 		switch (nt->nmhdr.code)
 		{
 			case SCN_DOUBLECLICK:
-				keybindings_send_command(GEANY_KEY_GROUP_SEARCH, GEANY_KEYS_SEARCH_MARKALL);
+			{
+				ScintillaObject *sci = editor->sci;
+				gchar *word = sci_get_selection_contents(sci);
+				guint generation = ao_lines_get_generation(editor->document);
+
+				/* marking all occurrences searches the whole document, don't do it again
+				 * for the same word if the document didn't change and it is still marked */
+				if (editor->document == priv->marked_doc &&
+					generation == priv->marked_generation &&
+					g_strcmp0(word, priv->marked_word) == 0 &&
+					scintilla_send_message(sci, SCI_INDICATORVALUEAT, GEANY_INDICATOR_SEARCH,
+						sci_get_selection_start(sci)) != 0)
+				{
+					g_free(word);
+					break;
+				}
+
+				priv->marked_doc = editor->document;
+				priv->marked_generation = generation;
+				g_free(priv->marked_word);
+				priv->marked_word = word;
+
+				if (EMPTY(word))
+				{
+					stop_marking(priv);
+					editor_indicator_clear(editor, GEANY_INDICATOR_SEARCH);
+				}
+				else
+					start_marking(bm, editor);
 				break;
+			}
 		}
 	}
 }
@@ -126,6 +281,12 @@ void ao_mark_word_check(AoMarkWord *bm, GeanyEditor *editor, SCNotification *nt)
 
 static void ao_mark_word_init(AoMarkWord *self)
 {
+	AoMarkWordPrivate *priv = AO_MARKWORD_GET_PRIVATE(self);
+
+	priv->marked_doc = NULL;
+	priv->marked_generation = 0;
+	priv->marked_word = NULL;
+	priv->mark_source = 0;
 }
 
 
@@ -34,6 +34,12 @@
 
 typedef struct _AoOpenUriPrivate			AoOpenUriPrivate;
 
+/* The characters of a URI, besides the word characters */
+#define AO_URI_CHARS	GEANY_WORDCHARS"@.://-?&%#="
+/* Text around the click is only looked at up to this length on each side, so that
+ * clicking into a huge line (minified code, data) doesn't copy it */
+#define AO_URI_MAX_LENGTH	2048
+
 #define AO_OPEN_URI_GET_PRIVATE(obj)		(G_TYPE_INSTANCE_GET_PRIVATE((obj),\
 			AO_OPEN_URI_TYPE, AoOpenUriPrivate))
 
@@ -51,6 +57,7 @@ struct _AoOpenUriPrivate
 {
 	gboolean	 enable_openuri;
 	gchar 		*uri;
+	GRegex		*uri_regex;
 
 	GtkWidget	*menu_item_open;
 	GtkWidget	*menu_item_copy;
@@ -117,6 +124,7 @@ static void ao_open_uri_finalize(GObject *object)
 	AoOpenUriPrivate *priv = AO_OPEN_URI_GET_PRIVATE(object);
 
 	g_free(priv->uri);
+	g_regex_unref(priv->uri_regex);
 	gtk_widget_destroy(priv->menu_item_open);
 	gtk_widget_destroy(priv->menu_item_copy);
 	gtk_widget_destroy(priv->menu_item_sep);
@@ -160,6 +168,10 @@ static void ao_open_uri_init(AoOpenUri *self)
 	AoOpenUriPrivate *priv = AO_OPEN_URI_GET_PRIVATE(self);
 
 	priv->uri = NULL;
+	/* either a scheme (based on g_uri_parse_scheme()) followed by "//", or two dots and
+	 * no spaces (www.domain.tld) unless we get too many matches */
+	priv->uri_regex = g_regex_new("^(?:[[:alpha:]][[:alnum:]+.-]*://|[^ ]*\\.[^ ]*\\.[^ ]*$)",
+		G_REGEX_OPTIMIZE, 0, NULL);
 
 	priv->menu_item_open = ao_image_menu_item_new(
 		ao_find_icon_name("text-html", GTK_STOCK_NEW), _("Open URI"));
@@ -187,45 +199,45 @@ AoOpenUri *ao_open_uri_new(gboolean enable)
 }
 
 
-static gboolean ao_uri_is_link(const gchar  *uri)
+static gboolean ao_is_uri_char(gchar c)
 {
-	gchar *dot;
-
-	g_return_val_if_fail (uri != NULL, FALSE);
-
-	if ((dot = strchr(uri, '.')) && *dot != '\0')
-	{	/* we require two dots and don't allow any spaces (www.domain.tld)
-		 * unless we get too many matches */
-		return (strchr(dot + 1, '.') && ! strchr(uri, ' '));
-	}
-	return FALSE;
+	/* non-ASCII bytes belong to words, like in Geany */
+	return (c < 0 || strchr(AO_URI_CHARS, c) != NULL);
 }
 
 
-/* based on g_uri_parse_scheme() but only checks for a scheme, doesn't return it */
-static gboolean ao_uri_has_scheme(const gchar  *uri)
+/* Like editor_get_word_at_pos() with the URI characters, but only reads the text up to
+ * AO_URI_MAX_LENGTH around pos instead of the whole line.
+ * Returns: the word, or NULL if there is none or it is longer than that */
+static gchar *ao_get_uri_at_pos(ScintillaObject *sci, gint pos)
 {
-	const gchar *p;
-	gchar c;
-
-	g_return_val_if_fail (uri != NULL, FALSE);
-
-	p = uri;
-
-	if (! g_ascii_isalpha(*p))
-		return FALSE;
-
-	while (1)
-	{
-		c = *p++;
-
-		if (c == ':' && strncmp(p, "//", 2) == 0)
-			return TRUE;
+	gint line = sci_get_line_from_position(sci, pos);
+	gint line_start = sci_get_position_from_line(sci, line);
+	gint line_end = sci_get_line_end_position(sci, line);
+	gint start = MAX(line_start, pos - AO_URI_MAX_LENGTH);
+	gint end = MIN(line_end, pos + AO_URI_MAX_LENGTH);
+	gint word_start, word_end;
+	gchar *text, *word;
+
+	if (pos < line_start || pos > line_end)
+		return NULL;
+
+	text = sci_get_contents_range(sci, start, end);
+	word_start = word_end = pos - start;
+	while (word_start > 0 && ao_is_uri_char(text[word_start - 1]))
+		word_start--;
+	while (word_end < end - start && ao_is_uri_char(text[word_end]))
+		word_end++;
+
+	/* the word goes on past the window */
+	if ((word_start == 0 && start > line_start) || (word_end == end - start && end < line_end) ||
+		word_start == word_end)
+		word = NULL;
+	else
+		word = g_strndup(text + word_start, (gsize) (word_end - word_start));
 
-		if (! (g_ascii_isalnum(c) || c == '+' || c == '-' || c == '.'))
-			return FALSE;
-	}
-	return FALSE;
+	g_free(text);
+	return word;
 }
 
 
@@ -246,14 +258,21 @@ void ao_open_uri_update_menu(AoOpenUri *openuri, GeanyDocument *doc, gint pos)
 	if (sci_has_selection(doc->editor->sci))
 	{
 		gint len = sci_get_selected_text_length(doc->editor->sci);
-		text = g_malloc0((guint)len + 1);
-		sci_get_selected_text(doc->editor->sci, text);
+
+		/* no URI is that long, don't copy a huge selection */
+		if (len > 2 * AO_URI_MAX_LENGTH)
+			text = NULL;
+		else
+		{
+			text = g_malloc0((guint)len + 1);
+			sci_get_selected_text(doc->editor->sci, text);
+		}
 	}
 	else
-		text = editor_get_word_at_pos(doc->editor, pos, GEANY_WORDCHARS"@.://-?&%#=");
+		text = ao_get_uri_at_pos(doc->editor->sci, pos);
 
 	/* TODO be more restrictive when handling selections as there are too many hits by now */
-	if (text != NULL && (ao_uri_has_scheme(text) || ao_uri_is_link(text)))
+	if (! EMPTY(text) && g_regex_match(priv->uri_regex, text, 0, NULL))
 	{
 		gsize len = strlen(text);
 		/* remove trailing dots and colons */
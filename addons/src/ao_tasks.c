@@ -32,6 +32,9 @@
 
 #include "addons.h"
 #include "ao_tasks.h"
+#include "ao_taskscan.h"
+#include "ao_lines.h"
+#include "largefile.h"
 
 #include <gdk/gdkkeysyms.h>
 
@@ -71,14 +74,32 @@ struct _AoTasksPrivate
 	gint selected_task_line;
 	GeanyDocument *selected_task_doc;
 	gboolean ignore_selection_changed;
+
+	/* document -> GArray of TaskRow sorted by line, for all documents shown in the list */
+	GHashTable *doc_tasks;
+
+	AoTokenMatcher *matcher;
+
+	gboolean scan_project;
+	AoTaskScan *project_scan;
+	/* UTF-8 filename -> GArray of GtkTreeIter, for all project files which are not open */
+	GHashTable *project_tasks;
 };
 
+/* A task of a document and its row in the store, used to update single lines in place */
+typedef struct
+{
+	gint line;
+	GtkTreeIter iter;
+} TaskRow;
+
 enum
 {
 	PROP_0,
 	PROP_ENABLE_TASKS,
 	PROP_TOKENS,
-	PROP_SCAN_ALL_DOCUMENTS
+	PROP_SCAN_ALL_DOCUMENTS,
+	PROP_SCAN_PROJECT
 };
 
 enum
@@ -95,6 +116,8 @@ enum
 static void ao_tasks_finalize  			(GObject *object);
 static void ao_tasks_show				(AoTasks *t);
 static void ao_tasks_hide				(AoTasks *t);
+static void ao_tasks_lines_changed_cb	(GeanyDocument *doc, const AoLinesChange *change,
+										 gpointer data);
 
 G_DEFINE_TYPE(AoTasks, ao_tasks, G_TYPE_OBJECT)
 
@@ -124,6 +147,11 @@ static void ao_tasks_set_property(GObject *object, guint prop_id,
 			priv->scan_all_documents = g_value_get_boolean(value);
 			break;
 		}
+		case PROP_SCAN_PROJECT:
+		{
+			priv->scan_project = g_value_get_boolean(value);
+			break;
+		}
 		case PROP_TOKENS:
 		{
 			const gchar *t = g_value_get_string(value);
@@ -131,6 +159,8 @@ static void ao_tasks_set_property(GObject *object, guint prop_id,
 				t = "TODO;FIXME"; /* fallback */
 			g_strfreev(priv->tokens);
 			priv->tokens = g_strsplit(t, ";", -1);
+			ao_token_matcher_free(priv->matcher);
+			priv->matcher = ao_token_matcher_new(priv->tokens);
 			ao_tasks_update(AO_TASKS(object), NULL);
 			break;
 		}
@@ -159,6 +189,15 @@ static void ao_tasks_class_init(AoTasksClass *klass)
 									TRUE,
 									G_PARAM_WRITABLE));
 
+	g_object_class_install_property(g_object_class,
+									PROP_SCAN_PROJECT,
+									g_param_spec_boolean(
+									"scan-project",
+									"scan-project",
+									"Whether to show tasks for all files of the current project",
+									FALSE,
+									G_PARAM_WRITABLE));
+
 	g_object_class_install_property(g_object_class,
 									PROP_ENABLE_TASKS,
 									g_param_spec_boolean(
@@ -187,12 +226,18 @@ static void ao_tasks_finalize(GObject *object)
 	g_return_if_fail(IS_AO_TASKS(object));
 
 	priv = AO_TASKS_GET_PRIVATE(object);
+	ao_lines_disconnect(ao_tasks_lines_changed_cb, object);
 	g_strfreev(priv->tokens);
+	ao_token_matcher_free(priv->matcher);
+	if (priv->project_scan != NULL)
+		ao_task_scan_cancel(priv->project_scan);
 
 	ao_tasks_hide(AO_TASKS(object));
 
 	if (priv->selected_tasks != NULL)
 		g_hash_table_destroy(priv->selected_tasks);
+	g_hash_table_destroy(priv->doc_tasks);
+	g_hash_table_destroy(priv->project_tasks);
 
 	G_OBJECT_CLASS(ao_tasks_parent_class)->finalize(object);
 }
@@ -297,6 +342,9 @@ static void ao_tasks_hide(AoTasks *t)
 		g_object_unref(priv->popup_menu);
 		priv->popup_menu = NULL;
 	}
+	/* the rows belong to the store of the destroyed tree */
+	g_hash_table_remove_all(priv->doc_tasks);
+	g_hash_table_remove_all(priv->project_tasks);
 }
 
 
@@ -497,101 +545,388 @@ void ao_tasks_activate(AoTasks *t)
 }
 
 
-void ao_tasks_remove(AoTasks *t, GeanyDocument *cur_doc)
+static void task_rows_free(GArray *rows)
+{
+	g_array_free(rows, TRUE);
+}
+
+
+/* Removes all tasks from the list */
+static void clear_tasks(AoTasks *t)
 {
 	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
-	GtkTreeModel *model = GTK_TREE_MODEL(priv->store);
-	GtkTreeIter iter;
-	gchar *filename;
 
-	if (! priv->active)
+	gtk_list_store_clear(priv->store);
+	g_hash_table_remove_all(priv->doc_tasks);
+	g_hash_table_remove_all(priv->project_tasks);
+}
+
+
+static void project_rows_free(GArray *rows)
+{
+	g_array_free(rows, TRUE);
+}
+
+
+/* Removes the tasks of a project file which is not open from the list */
+static void remove_project_tasks(AoTasks *t, const gchar *filename)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+	GArray *rows;
+	guint i;
+
+	if (filename == NULL || (rows = g_hash_table_lookup(priv->project_tasks, filename)) == NULL)
 		return;
 
-	if (gtk_tree_model_get_iter_first(model, &iter))
-	{
-		gboolean has_next;
+	for (i = 0; i < rows->len; i++)
+		gtk_list_store_remove(priv->store, &g_array_index(rows, GtkTreeIter, i));
 
-		do
-		{
-			gtk_tree_model_get(model, &iter, TLIST_COL_FILENAME, &filename, -1);
+	g_hash_table_remove(priv->project_tasks, filename);
+}
 
-			if (utils_str_equal(filename, cur_doc->file_name))
-			{	/* gtk_list_store_remove() manages the iter and set it to the next row */
-				has_next = gtk_list_store_remove(priv->store, &iter);
-			}
-			else
-			{	/* if we didn't delete the row, we need to manage the iter manually */
-				has_next = gtk_tree_model_iter_next(model, &iter);
-			}
-			g_free(filename);
-		}
-		while (has_next);
-	}
+
+static void remove_doc_tasks(AoTasks *t, GeanyDocument *cur_doc)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+	GArray *rows;
+	guint i;
+
+	rows = g_hash_table_lookup(priv->doc_tasks, cur_doc);
+	if (rows == NULL)
+		return;
+
+	for (i = 0; i < rows->len; i++)
+		gtk_list_store_remove(priv->store, &g_array_index(rows, TaskRow, i).iter);
+
+	g_hash_table_remove(priv->doc_tasks, cur_doc);
 }
 
 
-static void create_task(AoTasks *t, GeanyDocument *doc, gint line, const gchar *token,
-						const gchar *line_buf, const gchar *task_start, const gchar *display_name)
+/* Adds a task of token found in line_buf (the stripped line) to the list. context is the
+ * following line shown in the tooltip. Returns FALSE if the token is not part of line_buf. */
+static gboolean insert_task(AoTasks *t, const gchar *filename, const gchar *display_name,
+							gint line, const gchar *token, const gchar *line_buf,
+							const gchar *context, GtkTreeIter *iter)
 {
 	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
-	gchar *context, *tooltip;
+	const gchar *task_start;
+	gchar *tooltip;
 
-	/* retrieve the following line and use it for the tooltip */
-	context = g_strstrip(sci_get_line(doc->editor->sci, line + 1));
-	setptr(context, g_strconcat(
-		_("Context:"), "\n", line_buf, "\n", context, NULL));
-	tooltip = g_markup_escape_text(context, -1);
+	task_start = strstr(line_buf, token);
+	if (task_start == NULL)
+	{	/* the token matched only in leading or trailing white space */
+		return FALSE;
+	}
+
+	/* skip the token and additional whitespace */
+	task_start += strlen(token);
+	while (*task_start == ' ' || *task_start == ':')
+		task_start++;
+	/* reset task_start in case there is no text following */
+	if (EMPTY(task_start))
+		task_start = line_buf;
+
+	tooltip = g_strconcat(_("Context:"), "\n", line_buf, "\n", context, NULL);
+	setptr(tooltip, g_markup_escape_text(tooltip, -1));
 
 	/* add the task into the list */
-	gtk_list_store_insert_with_values(priv->store, NULL, -1,
-		TLIST_COL_FILENAME, DOC_FILENAME(doc),
+	gtk_list_store_insert_with_values(priv->store, iter, -1,
+		TLIST_COL_FILENAME, filename,
 		TLIST_COL_DISPLAY_FILENAME, display_name,
 		TLIST_COL_LINE, line + 1,
 		TLIST_COL_TOKEN, token,
 		TLIST_COL_NAME, task_start,
 		TLIST_COL_TOOLTIP, tooltip,
 		-1);
-	g_free(context);
 	g_free(tooltip);
+
+	return TRUE;
+}
+
+
+typedef struct
+{
+	AoTasks *t;
+	GeanyDocument *doc;
+	const gchar *display_name;
+	GArray *rows;
+	guint index;
+} DocScanData;
+
+
+/* Adds the task found in the line from line_start to line_end to the list and to the
+ * rows of the document */
+static void add_doc_task(gint line, gint token, const gchar *line_start,
+						 const gchar *line_end, gpointer data)
+{
+	DocScanData *dsd = data;
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(dsd->t);
+	gchar *line_buf, *context;
+	TaskRow row;
+
+	line_buf = g_strstrip(g_strndup(line_start, line_end - line_start));
+	/* retrieve the following line and use it for the tooltip */
+	context = g_strstrip(sci_get_line(dsd->doc->editor->sci, line + 1));
+
+	row.line = line;
+	if (insert_task(dsd->t, DOC_FILENAME(dsd->doc), dsd->display_name, line,
+			priv->tokens[token], line_buf, context, &row.iter))
+	{
+		g_array_insert_val(dsd->rows, dsd->index, row);
+		dsd->index++;
+	}
+	g_free(line_buf);
+	g_free(context);
+}
+
+
+/* Scans the lines from first to last (inclusive) for tasks in a single pass over the
+ * document buffer and inserts the found tasks into rows starting at index. */
+static void update_tasks_for_lines(AoTasks *t, GeanyDocument *doc, gint first, gint last,
+								   const gchar *display_name, GArray *rows, guint index)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+	ScintillaObject *sci = doc->editor->sci;
+	DocScanData dsd;
+	const gchar *text;
+	gint start, end;
+
+	if (ao_token_matcher_is_empty(priv->matcher) || first > last)
+		return;
+
+	dsd.t = t;
+	dsd.doc = doc;
+	dsd.display_name = display_name;
+	dsd.rows = rows;
+	dsd.index = index;
+
+	/* the pointer stays valid as long as the document isn't modified */
+	text = (const gchar *) scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+	start = sci_get_position_from_line(sci, first);
+	end = (last + 1 < sci_get_line_count(sci)) ?
+		sci_get_position_from_line(sci, last + 1) : sci_get_length(sci);
+
+	ao_token_matcher_scan(priv->matcher, text + start, end - start, first, add_doc_task, &dsd);
 }
 
 
 static void update_tasks_for_doc(AoTasks *t, GeanyDocument *doc)
 {
-	gint lines, line;
-	gchar *line_buf, *display_name, *task_start;
-	gchar **token;
+	gchar *display_name;
+	GArray *rows;
 	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
 
-	if (doc->is_valid)
+	/* large documents are left out, scanning them would block */
+	if (doc->is_valid && ! gp_large_file_check(doc))
 	{
+		rows = g_array_new(FALSE, FALSE, sizeof(TaskRow));
+		g_hash_table_insert(priv->doc_tasks, doc, rows);
+
 		display_name = document_get_basename_for_display(doc, -1);
-		lines = sci_get_line_count(doc->editor->sci);
-		for (line = 0; line < lines; line++)
+		update_tasks_for_lines(t, doc, 0, sci_get_line_count(doc->editor->sci) - 1,
+			display_name, rows, 0);
+		g_free(display_name);
+	}
+}
+
+
+/* Updates the tasks of a document shown in the list after a text modification, only the
+ * modified lines are scanned again and the rows of the other tasks are moved in place */
+static void ao_tasks_lines_changed_cb(GeanyDocument *doc, const AoLinesChange *change,
+									  gpointer data)
+{
+	AoTasks *t = data;
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+	GArray *rows;
+	gchar *display_name;
+	gint line, first, last;
+	guint i;
+
+	if (! priv->active)
+		return;
+
+	rows = g_hash_table_lookup(priv->doc_tasks, doc);
+	if (rows == NULL)
+		return;
+
+	line = change->line;
+
+	/* move the tasks after the modified line and drop those on deleted lines */
+	if (change->lines_added != 0)
+	{
+		i = 0;
+		while (i < rows->len)
 		{
-			line_buf = g_strstrip(sci_get_line(doc->editor->sci, line));
-			token = priv->tokens;
-			while (*token != NULL)
+			TaskRow *row = &g_array_index(rows, TaskRow, i);
+
+			if (row->line > line && row->line <= line - change->lines_added)
+			{
+				gtk_list_store_remove(priv->store, &row->iter);
+				g_array_remove_index(rows, i);
+				continue;
+			}
+			if (row->line > line)
 			{
-				if (!EMPTY(*token) && (task_start = strstr(line_buf, *token)) != NULL)
-				{
-					/* skip the token and additional whitespace */
-					task_start += strlen(*token);
-					while (*task_start == ' ' || *task_start == ':')
-						task_start++;
-					/* reset task_start in case there is no text following */
-					if (EMPTY(task_start))
-						task_start = line_buf;
-					/* create the task */
-					create_task(t, doc, line, *token, line_buf, task_start, display_name);
-					/* if we found a token, continue on next line */
-					break;
-				}
-				token++;
+				row->line += change->lines_added;
+				gtk_list_store_set(priv->store, &row->iter, TLIST_COL_LINE, row->line + 1, -1);
 			}
-			g_free(line_buf);
+			i++;
 		}
-		g_free(display_name);
+	}
+
+	/* scan the modified lines again, including the previous line as the tooltips contain
+	 * the following line */
+	first = MAX(line - 1, 0);
+	last = line + MAX(change->lines_added, 0);
+
+	i = 0;
+	while (i < rows->len && g_array_index(rows, TaskRow, i).line < first)
+		i++;
+	while (i < rows->len && g_array_index(rows, TaskRow, i).line <= last)
+	{
+		gtk_list_store_remove(priv->store, &g_array_index(rows, TaskRow, i).iter);
+		g_array_remove_index(rows, i);
+	}
+
+	display_name = document_get_basename_for_display(doc, -1);
+	update_tasks_for_lines(t, doc, first, MIN(last, sci_get_line_count(doc->editor->sci) - 1),
+		display_name, rows, i);
+	g_free(display_name);
+}
+
+
+/* Adds the tasks of a project file which is not open to the list. closing_doc is a
+ * document of the file which is about to be closed or NULL. */
+static void add_project_tasks(AoTasks *t, const gchar *filename, GPtrArray *tasks,
+							  GeanyDocument *closing_doc)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+	GeanyDocument *doc;
+	GArray *rows;
+	gchar *display_name;
+	guint i;
+
+	/* open documents are scanned from their buffer */
+	remove_project_tasks(t, filename);
+	doc = document_find_by_filename(filename);
+	if (tasks == NULL || tasks->len == 0 || (doc != NULL && doc != closing_doc))
+		return;
+
+	rows = g_array_sized_new(FALSE, FALSE, sizeof(GtkTreeIter), tasks->len);
+	display_name = g_path_get_basename(filename);
+	for (i = 0; i < tasks->len; i++)
+	{
+		AoFileTask *task = g_ptr_array_index(tasks, i);
+		GtkTreeIter iter;
+
+		if (insert_task(t, filename, display_name, task->line, task->token, task->text,
+				task->context, &iter))
+			g_array_append_val(rows, iter);
+	}
+	g_free(display_name);
+
+	g_hash_table_insert(priv->project_tasks, g_strdup(filename), rows);
+}
+
+
+static void project_scan_cb(const gchar *filename, GPtrArray *tasks, gpointer data)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(data);
+
+	if (filename == NULL)
+	{	/* the scan is complete and will be freed */
+		priv->project_scan = NULL;
+		return;
+	}
+	add_project_tasks(AO_TASKS(data), filename, tasks, NULL);
+}
+
+
+static void stop_project_scan(AoTasks *t)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+
+	if (priv->project_scan != NULL)
+	{
+		ao_task_scan_cancel(priv->project_scan);
+		priv->project_scan = NULL;
+	}
+}
+
+
+static gboolean scans_project(AoTasks *t)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+
+	return priv->scan_project && priv->scan_all_documents && geany->app->project != NULL &&
+		! EMPTY(geany->app->project->base_path);
+}
+
+
+/* Scans all files of the current project which are not open, in the background */
+static void update_project_tasks(AoTasks *t)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+
+	stop_project_scan(t);
+
+	if (! scans_project(t))
+		return;
+
+	priv->project_scan = ao_task_scan_start(geany->app->project->base_path, priv->tokens,
+		project_scan_cb, t);
+}
+
+
+/* Called when the project is opened or closed. When closing, the project is still set
+ * but its files shouldn't be scanned anymore. */
+void ao_tasks_project_changed(AoTasks *t, gboolean closed)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+	GHashTableIter iter;
+	gpointer value;
+
+	if (! priv->active)
+		return;
+
+	if (closed)
+	{
+		stop_project_scan(t);
+		g_hash_table_iter_init(&iter, priv->project_tasks);
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			GArray *rows = value;
+			guint i;
+
+			for (i = 0; i < rows->len; i++)
+				gtk_list_store_remove(priv->store, &g_array_index(rows, GtkTreeIter, i));
+			g_hash_table_iter_remove(&iter);
+		}
+	}
+	else
+		update_project_tasks(t);
+}
+
+
+void ao_tasks_remove(AoTasks *t, GeanyDocument *cur_doc)
+{
+	AoTasksPrivate *priv = AO_TASKS_GET_PRIVATE(t);
+
+	if (! priv->active)
+		return;
+
+	remove_doc_tasks(t, cur_doc);
+
+	/* show the tasks of a closed project file again, from the file on disk */
+	if (scans_project(t) && cur_doc->real_path != NULL &&
+		g_str_has_prefix(cur_doc->file_name, geany->app->project->base_path))
+	{
+		gchar *locale_filename = utils_get_locale_from_utf8(cur_doc->file_name);
+		GPtrArray *tasks = ao_task_scan_file(locale_filename, priv->tokens);
+
+		add_project_tasks(t, cur_doc->file_name, tasks, cur_doc);
+		ao_file_tasks_free(tasks);
+		g_free(locale_filename);
 	}
 }
 
@@ -606,7 +941,7 @@ void ao_tasks_update_single(AoTasks *t, GeanyDocument *cur_doc)
 	if (! priv->scan_all_documents)
 	{
 		/* update */
-		gtk_list_store_clear(priv->store);
+		clear_tasks(t);
 		ao_tasks_update(t, cur_doc);
 	}
 }
@@ -667,7 +1002,7 @@ void ao_tasks_update(AoTasks *t, GeanyDocument *cur_doc)
 	if (! priv->scan_all_documents && cur_doc == NULL)
 	{
 		/* clear all */
-		gtk_list_store_clear(priv->store);
+		clear_tasks(t);
 		/* get the current document */
 		cur_doc = document_get_current();
 	}
@@ -675,19 +1010,21 @@ void ao_tasks_update(AoTasks *t, GeanyDocument *cur_doc)
 	if (cur_doc != NULL)
 	{
 		/* TODO handle renaming of files, probably we need a new signal for this */
-		ao_tasks_remove(t, cur_doc);
+		remove_doc_tasks(t, cur_doc);
+		remove_project_tasks(t, cur_doc->file_name);
 		update_tasks_for_doc(t, cur_doc);
 	}
 	else
 	{
 		guint i;
 		/* clear all */
-		gtk_list_store_clear(priv->store);
+		clear_tasks(t);
 		/* iterate over all docs */
 		foreach_document(i)
 		{
 			update_tasks_for_doc(t, documents[i]);
 		}
+		update_project_tasks(t);
 	}
 	/* restore selection */
 	priv->ignore_selection_changed = TRUE;
@@ -711,22 +1048,33 @@ static void ao_tasks_init(AoTasks *self)
 	priv->page = NULL;
 	priv->popup_menu = NULL;
 	priv->tokens = NULL;
+	priv->matcher = NULL;
 	priv->active = FALSE;
 	priv->ignore_selection_changed = FALSE;
 
 	priv->selected_task_line = 0;
 	priv->selected_task_doc = 0;
+	priv->doc_tasks = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, (GDestroyNotify) task_rows_free);
+	priv->project_tasks = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, (GDestroyNotify) project_rows_free);
+	priv->scan_project = FALSE;
+	priv->project_scan = NULL;
 	if (priv->scan_all_documents)
 		priv->selected_tasks = NULL;
 	else
 		priv->selected_tasks = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	ao_lines_connect(ao_tasks_lines_changed_cb, self);
 }
 
 
-AoTasks *ao_tasks_new(gboolean enable, const gchar *tokens, gboolean scan_all_documents)
+AoTasks *ao_tasks_new(gboolean enable, const gchar *tokens, gboolean scan_all_documents,
+					  gboolean scan_project)
 {
 	return g_object_new(AO_TASKS_TYPE,
 		"scan-all-documents", scan_all_documents,
+		"scan-project", scan_project,
 		"tokens", tokens,
 		"enable-tasks", enable, NULL);
 }
@@ -38,12 +38,14 @@ typedef struct _AoTasksClass	AoTasksClass;
 GType			ao_tasks_get_type		(void);
 AoTasks*		ao_tasks_new			(gboolean enable,
 										 const gchar *tokens,
-										 gboolean scan_all_documents);
+										 gboolean scan_all_documents,
+										 gboolean scan_project);
 void			ao_tasks_update			(AoTasks *t, GeanyDocument *cur_doc);
 void			ao_tasks_update_single	(AoTasks *t, GeanyDocument *cur_doc);
 void			ao_tasks_remove			(AoTasks *t, GeanyDocument *cur_doc);
 void			ao_tasks_activate		(AoTasks *t);
 void			ao_tasks_set_active		(AoTasks *t);
+void			ao_tasks_project_changed	(AoTasks *t, gboolean closed);
 
 G_END_DECLS
 
@@ -0,0 +1,579 @@
+/*
+ *      ao_taskscan.c - this file is part of Addons, a Geany plugin
+ *
+ *      Copyright 2009-2011 Enrico Tröger <enrico(dot)troeger(at)uvena(dot)de>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $Id$
+ */
+
+/* Task token matching and scanning of files which are not open in Geany */
+
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+#include <geanyplugin.h>
+
+#include "addons.h"
+#include "ao_taskscan.h"
+
+
+/* number of threads scanning files */
+#define SCAN_MAX_THREADS 4
+/* files bigger than this are not scanned */
+#define SCAN_MAX_FILE_SIZE (16 * 1024 * 1024)
+/* files with a NUL byte within this many bytes at the start are considered binary */
+#define SCAN_BINARY_CHECK_SIZE 8000
+/* interval in milliseconds in which results are passed to the main thread */
+#define SCAN_UPDATE_INTERVAL 200
+
+
+/* Aho-Corasick automaton matching all task tokens in a single pass. The transitions
+ * include the failure links so that each byte takes exactly one lookup. */
+struct _AoTokenMatcher
+{
+	gint *next;			/* n_states * 256 transitions */
+	gint *match;		/* lowest index of the tokens ending in a state or -1 */
+	guint n_states;
+};
+
+/* The tasks of a scanned file, remembered as long as the file doesn't change */
+typedef struct
+{
+	time_t mtime;
+	off_t size;
+	GPtrArray *tasks;
+} CacheEntry;
+
+typedef struct
+{
+	gchar *filename;	/* UTF-8 */
+	GPtrArray *tasks;
+} ScanResult;
+
+struct _AoTaskScan
+{
+	gchar **tokens;
+	AoTokenMatcher *matcher;
+
+	GThreadPool *pool;
+	GMutex *lock;				/* held while pushing jobs and setting cancelled */
+	volatile gint pending;		/* number of queued and running jobs */
+	volatile gint cancelled;
+
+	GAsyncQueue *results;		/* of ScanResult */
+	guint source_id;
+
+	AoTaskScanFunc func;
+	gpointer data;
+};
+
+/* locale filename -> CacheEntry, shared by all scans */
+static GHashTable *file_cache = NULL;
+/* the tokens the cached tasks were found with */
+static gchar *file_cache_tokens = NULL;
+static GStaticMutex file_cache_mutex = G_STATIC_MUTEX_INIT;
+
+
+void ao_token_matcher_free(AoTokenMatcher *matcher)
+{
+	if (matcher == NULL)
+		return;
+
+	g_free(matcher->next);
+	g_free(matcher->match);
+	g_free(matcher);
+}
+
+
+AoTokenMatcher *ao_token_matcher_new(gchar **tokens)
+{
+	AoTokenMatcher *matcher = g_new0(AoTokenMatcher, 1);
+	guint max_states = 1;
+	guint i, c;
+	gint *fail;
+	GQueue *queue;
+
+	for (i = 0; tokens[i] != NULL; i++)
+		max_states += strlen(tokens[i]);
+
+	matcher->next = g_new(gint, max_states * 256);
+	matcher->match = g_new(gint, max_states);
+	for (i = 0; i < max_states * 256; i++)
+		matcher->next[i] = -1;
+	matcher->match[0] = -1;
+	matcher->n_states = 1;
+
+	/* build the trie */
+	for (i = 0; tokens[i] != NULL; i++)
+	{
+		const guchar *p;
+		gint state = 0;
+
+		if (EMPTY(tokens[i]))
+			continue;
+
+		for (p = (const guchar *) tokens[i]; *p != '\0'; p++)
+		{
+			gint *next = &matcher->next[state * 256 + *p];
+
+			if (*next == -1)
+			{
+				*next = matcher->n_states++;
+				matcher->match[*next] = -1;
+			}
+			state = *next;
+		}
+		/* earlier tokens take precedence */
+		if (matcher->match[state] == -1)
+			matcher->match[state] = i;
+	}
+
+	/* add the failure transitions in breadth-first order */
+	fail = g_new0(gint, matcher->n_states);
+	queue = g_queue_new();
+	for (c = 0; c < 256; c++)
+	{
+		gint next = matcher->next[c];
+
+		if (next == -1)
+			matcher->next[c] = 0;
+		else
+		{
+			fail[next] = 0;
+			g_queue_push_tail(queue, GINT_TO_POINTER(next));
+		}
+	}
+	while (! g_queue_is_empty(queue))
+	{
+		gint state = GPOINTER_TO_INT(g_queue_pop_head(queue));
+
+		for (c = 0; c < 256; c++)
+		{
+			gint next = matcher->next[state * 256 + c];
+			gint fallback = matcher->next[fail[state] * 256 + c];
+
+			if (next == -1)
+				matcher->next[state * 256 + c] = fallback;
+			else
+			{
+				gint m = matcher->match[fallback];
+
+				fail[next] = fallback;
+				if (m != -1 && (matcher->match[next] == -1 || m < matcher->match[next]))
+					matcher->match[next] = m;
+				g_queue_push_tail(queue, GINT_TO_POINTER(next));
+			}
+		}
+	}
+	g_queue_free(queue);
+	g_free(fail);
+
+	return matcher;
+}
+
+
+gboolean ao_token_matcher_is_empty(const AoTokenMatcher *matcher)
+{
+	return matcher == NULL || matcher->n_states <= 1;
+}
+
+
+void ao_token_matcher_scan(const AoTokenMatcher *matcher, const gchar *text, gsize len,
+						   gint first_line, AoTokenMatchFunc func, gpointer data)
+{
+	const gchar *p = text;
+	const gchar *end = text + len;
+	const gchar *line_start = text;
+	gint line = first_line;
+	gint state = 0;
+	gint best = -1;
+
+	if (ao_token_matcher_is_empty(matcher))
+		return;
+
+	while (p < end)
+	{
+		guchar c = *p;
+
+		if (c == '\n' || c == '\r')
+		{
+			if (best != -1)
+				func(line, best, line_start, p, data);
+			if (c == '\r' && p + 1 < end && p[1] == '\n')
+				p++;
+			p++;
+			line++;
+			line_start = p;
+			state = 0;
+			best = -1;
+			continue;
+		}
+
+		state = matcher->next[state * 256 + c];
+		if (matcher->match[state] != -1 && (best == -1 || matcher->match[state] < best))
+			best = matcher->match[state];
+		p++;
+	}
+	/* last line without a line ending */
+	if (best != -1)
+		func(line, best, line_start, end, data);
+}
+
+
+static void file_task_free(AoFileTask *task)
+{
+	g_free(task->token);
+	g_free(task->text);
+	g_free(task->context);
+	g_free(task);
+}
+
+
+void ao_file_tasks_free(GPtrArray *tasks)
+{
+	if (tasks == NULL)
+		return;
+
+	g_ptr_array_foreach(tasks, (GFunc) file_task_free, NULL);
+	g_ptr_array_free(tasks, TRUE);
+}
+
+
+static GPtrArray *file_tasks_copy(GPtrArray *tasks)
+{
+	GPtrArray *copy = g_ptr_array_sized_new(tasks->len);
+	guint i;
+
+	for (i = 0; i < tasks->len; i++)
+	{
+		AoFileTask *task = g_ptr_array_index(tasks, i);
+		AoFileTask *new_task = g_new(AoFileTask, 1);
+
+		new_task->line = task->line;
+		new_task->token = g_strdup(task->token);
+		new_task->text = g_strdup(task->text);
+		new_task->context = g_strdup(task->context);
+		g_ptr_array_add(copy, new_task);
+	}
+	return copy;
+}
+
+
+static void cache_entry_free(CacheEntry *entry)
+{
+	ao_file_tasks_free(entry->tasks);
+	g_free(entry);
+}
+
+
+/* Must be called with file_cache_mutex locked */
+static void file_cache_check_tokens(gchar **tokens)
+{
+	gchar *key = g_strjoinv(";", tokens);
+
+	if (file_cache == NULL)
+		file_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify) cache_entry_free);
+
+	if (! utils_str_equal(key, file_cache_tokens))
+	{	/* the cached tasks were found with other tokens */
+		g_hash_table_remove_all(file_cache);
+		g_free(file_cache_tokens);
+		file_cache_tokens = key;
+	}
+	else
+		g_free(key);
+}
+
+
+typedef struct
+{
+	gchar **tokens;
+	const gchar *end;
+	GPtrArray *tasks;
+} FileScanData;
+
+
+static void file_scan_match(gint line, gint token, const gchar *line_start,
+							const gchar *line_end, gpointer data)
+{
+	FileScanData *fsd = data;
+	AoFileTask *task;
+	const gchar *next_start = line_end;
+	const gchar *next_end;
+
+	/* find the following line for the context */
+	if (next_start < fsd->end && *next_start == '\r' && next_start + 1 < fsd->end &&
+		next_start[1] == '\n')
+		next_start++;
+	if (next_start < fsd->end)
+		next_start++;
+	next_end = next_start;
+	while (next_end < fsd->end && *next_end != '\n' && *next_end != '\r')
+		next_end++;
+
+	task = g_new(AoFileTask, 1);
+	task->line = line;
+	task->token = g_strdup(fsd->tokens[token]);
+	task->text = g_strstrip(g_strndup(line_start, line_end - line_start));
+	task->context = g_strstrip(g_strndup(next_start, next_end - next_start));
+	g_ptr_array_add(fsd->tasks, task);
+}
+
+
+static GPtrArray *scan_file(const gchar *locale_filename, gchar **tokens,
+							const AoTokenMatcher *matcher)
+{
+	struct stat st;
+	CacheEntry *entry;
+	GMappedFile *map;
+	FileScanData fsd;
+	const gchar *contents;
+	gsize len;
+	GPtrArray *result = NULL;
+
+	if (g_stat(locale_filename, &st) != 0 || ! S_ISREG(st.st_mode) ||
+		st.st_size > SCAN_MAX_FILE_SIZE)
+		return NULL;
+
+	g_static_mutex_lock(&file_cache_mutex);
+	file_cache_check_tokens(tokens);
+	entry = g_hash_table_lookup(file_cache, locale_filename);
+	if (entry != NULL && entry->mtime == st.st_mtime && entry->size == st.st_size)
+		result = file_tasks_copy(entry->tasks);
+	g_static_mutex_unlock(&file_cache_mutex);
+
+	if (result != NULL)
+		return result;
+
+	fsd.tokens = tokens;
+	fsd.tasks = g_ptr_array_new();
+
+	map = g_mapped_file_new(locale_filename, FALSE, NULL);
+	if (map != NULL)
+	{
+		contents = g_mapped_file_get_contents(map);
+		len = g_mapped_file_get_length(map);
+		fsd.end = contents + len;
+
+		/* skip binary files */
+		if (contents != NULL && memchr(contents, '\0', MIN(len, SCAN_BINARY_CHECK_SIZE)) == NULL)
+			ao_token_matcher_scan(matcher, contents, len, 0, file_scan_match, &fsd);
+
+		g_mapped_file_free(map);
+	}
+
+	entry = g_new(CacheEntry, 1);
+	entry->mtime = st.st_mtime;
+	entry->size = st.st_size;
+	entry->tasks = file_tasks_copy(fsd.tasks);
+
+	g_static_mutex_lock(&file_cache_mutex);
+	file_cache_check_tokens(tokens);
+	g_hash_table_insert(file_cache, g_strdup(locale_filename), entry);
+	g_static_mutex_unlock(&file_cache_mutex);
+
+	return fsd.tasks;
+}
+
+
+GPtrArray *ao_task_scan_file(const gchar *locale_filename, gchar **tokens)
+{
+	AoTokenMatcher *matcher = ao_token_matcher_new(tokens);
+	GPtrArray *tasks = scan_file(locale_filename, tokens, matcher);
+
+	ao_token_matcher_free(matcher);
+	return tasks;
+}
+
+
+/* Queues a job for locale_path, which is freed instead if the scan was cancelled:
+ * ao_task_scan_cancel() may be freeing the pool then */
+static void scan_push(AoTaskScan *scan, gchar *locale_path)
+{
+	g_mutex_lock(scan->lock);
+	if (g_atomic_int_get(&scan->cancelled))
+		g_free(locale_path);
+	else
+	{
+		g_atomic_int_inc(&scan->pending);
+		g_thread_pool_push(scan->pool, locale_path, NULL);
+	}
+	g_mutex_unlock(scan->lock);
+}
+
+
+/* Frees the tasks cached for the scanned files, the plugin being resident */
+void ao_task_scan_cleanup(void)
+{
+	g_static_mutex_lock(&file_cache_mutex);
+	if (file_cache != NULL)
+	{
+		g_hash_table_destroy(file_cache);
+		file_cache = NULL;
+	}
+	g_free(file_cache_tokens);
+	file_cache_tokens = NULL;
+	g_static_mutex_unlock(&file_cache_mutex);
+}
+
+
+/* Thread pool function, scans a file or queues the entries of a directory */
+static void scan_job(gpointer data, gpointer user_data)
+{
+	gchar *locale_path = data;
+	AoTaskScan *scan = user_data;
+
+	if (! g_atomic_int_get(&scan->cancelled))
+	{
+		if (g_file_test(locale_path, G_FILE_TEST_IS_DIR))
+		{
+			GDir *dir = g_dir_open(locale_path, 0, NULL);
+
+			if (dir != NULL)
+			{
+				const gchar *name;
+
+				while ((name = g_dir_read_name(dir)) != NULL)
+				{
+					gchar *child;
+
+					if (g_atomic_int_get(&scan->cancelled))
+						break;
+					/* skip hidden files and directories like .git */
+					if (name[0] == '.')
+						continue;
+					child = g_build_filename(locale_path, name, NULL);
+					/* skip links to directories, which may lead back to an ancestor */
+					if (g_file_test(child, G_FILE_TEST_IS_SYMLINK) &&
+						g_file_test(child, G_FILE_TEST_IS_DIR))
+					{
+						g_free(child);
+						continue;
+					}
+					scan_push(scan, child);
+				}
+				g_dir_close(dir);
+			}
+		}
+		else if (! g_file_test(locale_path, G_FILE_TEST_IS_SYMLINK))
+		{
+			GPtrArray *tasks = scan_file(locale_path, scan->tokens, scan->matcher);
+
+			if (tasks != NULL && tasks->len > 0)
+			{
+				ScanResult *result = g_new(ScanResult, 1);
+
+				result->filename = utils_get_utf8_from_locale(locale_path);
+				result->tasks = tasks;
+				g_async_queue_push(scan->results, result);
+			}
+			else
+				ao_file_tasks_free(tasks);
+		}
+	}
+	g_free(locale_path);
+	g_atomic_int_add(&scan->pending, -1);
+}
+
+
+static void scan_result_free(ScanResult *result)
+{
+	g_free(result->filename);
+	ao_file_tasks_free(result->tasks);
+	g_free(result);
+}
+
+
+static void scan_free(AoTaskScan *scan)
+{
+	ScanResult *result;
+
+	/* drop the queued jobs and wait for the running ones */
+	g_thread_pool_free(scan->pool, TRUE, TRUE);
+
+	while ((result = g_async_queue_try_pop(scan->results)) != NULL)
+		scan_result_free(result);
+	g_async_queue_unref(scan->results);
+	g_mutex_free(scan->lock);
+
+	ao_token_matcher_free(scan->matcher);
+	g_strfreev(scan->tokens);
+	g_free(scan);
+}
+
+
+/* Passes the results collected so far to the main thread */
+static gboolean scan_update(gpointer data)
+{
+	AoTaskScan *scan = data;
+	gboolean finished = g_atomic_int_get(&scan->pending) == 0;
+	ScanResult *result;
+
+	while ((result = g_async_queue_try_pop(scan->results)) != NULL)
+	{
+		scan->func(result->filename, result->tasks, scan->data);
+		scan_result_free(result);
+	}
+
+	if (! finished)
+		return TRUE;
+
+	scan->func(NULL, NULL, scan->data);
+	scan_free(scan);
+	return FALSE;
+}
+
+
+/* Scans all files below base_path in separate threads */
+AoTaskScan *ao_task_scan_start(const gchar *base_path, gchar **tokens,
+							   AoTaskScanFunc func, gpointer data)
+{
+	AoTaskScan *scan = g_new0(AoTaskScan, 1);
+
+	scan->tokens = g_strdupv(tokens);
+	scan->matcher = ao_token_matcher_new(tokens);
+	scan->results = g_async_queue_new();
+	scan->func = func;
+	scan->data = data;
+	scan->lock = g_mutex_new();
+	scan->pool = g_thread_pool_new(scan_job, scan, SCAN_MAX_THREADS, FALSE, NULL);
+
+	scan_push(scan, utils_get_locale_from_utf8(base_path));
+	scan->source_id = plugin_timeout_add(geany_plugin, SCAN_UPDATE_INTERVAL, scan_update, scan);
+
+	return scan;
+}
+
+
+/* Stops the scan, func is not called anymore */
+void ao_task_scan_cancel(AoTaskScan *scan)
+{
+	g_return_if_fail(scan != NULL);
+
+	g_mutex_lock(scan->lock);
+	g_atomic_int_set(&scan->cancelled, TRUE);
+	g_mutex_unlock(scan->lock);
+	g_source_remove(scan->source_id);
+	scan_free(scan);
+}
@@ -0,0 +1,67 @@
+/*
+ *      ao_taskscan.h - this file is part of Addons, a Geany plugin
+ *
+ *      Copyright 2009-2011 Enrico Tröger <enrico(dot)troeger(at)uvena(dot)de>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $Id$
+ */
+
+
+#ifndef __AO_TASKSCAN_H__
+#define __AO_TASKSCAN_H__
+
+G_BEGIN_DECLS
+
+typedef struct _AoTokenMatcher	AoTokenMatcher;
+typedef struct _AoTaskScan		AoTaskScan;
+
+/* A task found in a file which is not open */
+typedef struct
+{
+	gint line;
+	gchar *token;
+	gchar *text;		/* the stripped line */
+	gchar *context;		/* the stripped following line */
+} AoFileTask;
+
+/* Called for each line containing a task token. token is the index of the first configured
+ * token found in the line, line_end points to the line ending. */
+typedef void (*AoTokenMatchFunc)(gint line, gint token, const gchar *line_start,
+								 const gchar *line_end, gpointer data);
+
+/* Called in the main thread with the tasks of each scanned file (an array of AoFileTask
+ * owned by the scan) and finally once with a NULL filename when the scan is complete. */
+typedef void (*AoTaskScanFunc)(const gchar *utf8_filename, GPtrArray *tasks, gpointer data);
+
+
+AoTokenMatcher*	ao_token_matcher_new		(gchar **tokens);
+void			ao_token_matcher_free		(AoTokenMatcher *matcher);
+gboolean		ao_token_matcher_is_empty	(const AoTokenMatcher *matcher);
+void			ao_token_matcher_scan		(const AoTokenMatcher *matcher,
+											 const gchar *text, gsize len, gint first_line,
+											 AoTokenMatchFunc func, gpointer data);
+
+AoTaskScan*		ao_task_scan_start			(const gchar *base_path, gchar **tokens,
+											 AoTaskScanFunc func, gpointer data);
+void			ao_task_scan_cancel			(AoTaskScan *scan);
+GPtrArray*		ao_task_scan_file			(const gchar *locale_filename, gchar **tokens);
+void			ao_file_tasks_free			(GPtrArray *tasks);
+void			ao_task_scan_cleanup		(void);
+
+G_END_DECLS
+
+#endif /* __AO_TASKSCAN_H__ */
@@ -40,6 +40,12 @@ gboolean auto_enabled = FALSE;
 gboolean enclose_enabled = FALSE;
 gchar *config_file;
 GtkListStore *chars_list;
+static gulong key_press_handler = 0;
+
+/* The characters enclosing the selection when typed, by pairs of opening and closing ones */
+static const gchar auto_enclose_pairs [] = "()[]{}''\"\"``";
+/* The closing character for each opening one, indexed by key value, 0 for other keys */
+static gchar auto_enclose_closing [128];
 
 /*
  * Called when a keybinding associated with the plugin is pressed.  Encloses the selected text in
@@ -81,48 +87,25 @@ gboolean on_key_press (GtkWidget *widget, GdkEventKey *event, gpointer user_data
 {
 	gint selection_end;
 	gchar insert_chars [4] = {0, 0, 0, 0};
+	GeanyDocument *doc;
 	ScintillaObject *sci_obj;
 
-	if (!auto_enabled)
+	/* most keys aren't enclosing characters, leave them before asking the editor anything */
+	if (event->keyval >= G_N_ELEMENTS (auto_enclose_closing) ||
+		auto_enclose_closing [event->keyval] == 0)
 		return FALSE;
 
-	if (document_get_current () == NULL)
+	doc = document_get_current ();
+	if (doc == NULL)
 		return FALSE;
 
-	sci_obj = document_get_current ()->editor->sci;
+	sci_obj = doc->editor->sci;
 
 	if (sci_get_selected_text_length (sci_obj) < 2)
 		return FALSE;
 
-	switch (event->keyval)
-	{
-		case '(':
-			insert_chars [0] = '(';
-			insert_chars [2] = ')';
-			break;
-		case '[':
-			insert_chars [0] = '[';
-			insert_chars [2] = ']';
-			break;
-		case '{':
-			insert_chars [0] = '{';
-			insert_chars [2] = '}';
-			break;
-		case '\'':
-			insert_chars [0] = '\'';
-			insert_chars [2] = '\'';
-			break;
-		case '\"':
-			insert_chars [0] = '\"';
-			insert_chars [2] = '\"';
-			break;
-        case '`':
-            insert_chars [0] = '`';
-            insert_chars [2] = '`';
-			break;
-		default:
-			return FALSE;
-	}
+	insert_chars [0] = (gchar) event->keyval;
+	insert_chars [2] = auto_enclose_closing [event->keyval];
 
 	selection_end = sci_get_selection_end (sci_obj);
 
@@ -145,6 +128,9 @@ void ao_enclose_words_init (gchar *config_file_name, GeanyKeyGroup *key_group)
 	gchar key_name[] = "Enclose_x";
 	gint i;
 
+	for (i = 0; auto_enclose_pairs [i] != 0; i += 2)
+		auto_enclose_closing [(guchar) auto_enclose_pairs [i]] = auto_enclose_pairs [i + 1];
+
 	config_file = g_strdup (config_file_name);
 	g_key_file_load_from_file (config, config_file, G_KEY_FILE_NONE, NULL);
 
@@ -159,15 +145,26 @@ void ao_enclose_words_init (gchar *config_file_name, GeanyKeyGroup *key_group)
 	}
 
 	g_key_file_free(config);
-
-	plugin_signal_connect(geany_plugin, G_OBJECT(geany->main_widgets->window), "key-press-event",
-			FALSE, G_CALLBACK(on_key_press), NULL);
 }
 
+/*
+ * Automatic enclosing watches every key press, so it is only connected while enabled.
+ * Called with FALSE when the plugin is unloaded.
+ */
+
 void ao_enclose_words_set_enabled (gboolean enabled_w, gboolean enabled_a)
 {
 	auto_enabled = enabled_a;
 	enclose_enabled = enabled_w;
+
+	if (auto_enabled && key_press_handler == 0)
+		key_press_handler = g_signal_connect (geany->main_widgets->window, "key-press-event",
+			G_CALLBACK (on_key_press), NULL);
+	else if (!auto_enabled && key_press_handler != 0)
+	{
+		g_signal_handler_disconnect (geany->main_widgets->window, key_press_handler);
+		key_press_handler = 0;
+	}
 }
 
 /*
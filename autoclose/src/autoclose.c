@@ -34,10 +34,15 @@
 
 #include "Scintilla.h"
 #include "SciLexer.h"
+#include "notifyprof.h"
+#include "largefile.h"
 
 #define AC_STOP_ACTION TRUE
 #define AC_CONTINUE_ACTION FALSE
 #define SSM(s, m, w, l) scintilla_send_message(s, m, w, l)
+/* characters around the caret read in one request on each handled key */
+#define AC_CONTEXT_BEFORE 16
+#define AC_CONTEXT_AFTER 2
 
 GeanyPlugin	*geany_plugin;
 GeanyData	*geany_data;
@@ -86,6 +91,14 @@ typedef struct {
 
 static AutocloseInfo *ac_info = NULL;
 
+typedef struct {
+	ScintillaObject *sci;
+	gint start;
+	gint end;
+	/* character and style pairs for start..end - 1, as SCI_GETSTYLEDTEXT fills them */
+	gchar cells[2 * (AC_CONTEXT_BEFORE + AC_CONTEXT_AFTER) + 2];
+} AutocloseContext;
+
 typedef struct {
 	gulong notify_handler[2];
 	/* used to place the caret after autoclosed items on tab (similar to eclipse) */
@@ -115,6 +128,36 @@ get_char_range(ScintillaObject *sci, gint start, gint length)
 	return (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, start, length);
 }
 
+static void
+context_read(AutocloseContext *ctx, ScintillaObject *sci, gint pos)
+{
+	struct Sci_TextRange tr;
+
+	ctx->sci = sci;
+	ctx->start = MAX(pos - AC_CONTEXT_BEFORE, 0);
+	ctx->end = pos + AC_CONTEXT_AFTER;
+	tr.chrg.cpMin = ctx->start;
+	tr.chrg.cpMax = ctx->end;
+	tr.lpstrText = ctx->cells;
+	SSM(sci, SCI_GETSTYLEDTEXT, 0, (sptr_t) &tr);
+}
+
+static gchar
+context_char_at(AutocloseContext *ctx, gint pos)
+{
+	if (pos >= ctx->start && pos < ctx->end)
+		return ctx->cells[2 * (pos - ctx->start)];
+	return char_at(ctx->sci, pos);
+}
+
+static gint
+context_style_at(AutocloseContext *ctx, gint pos)
+{
+	if (pos >= ctx->start && pos < ctx->end)
+		return (guchar) ctx->cells[2 * (pos - ctx->start) + 1];
+	return sci_get_style_at(ctx->sci, pos);
+}
+
 static gboolean
 blank_line(ScintillaObject *sci, gint line)
 {
@@ -178,6 +221,12 @@ get_ancor_pos(ScintillaObject *sci, gint selection)
 	return (gint) SSM(sci, SCI_GETSELECTIONNANCHOR, selection, 0);
 }
 
+static gint
+compare_positions(gconstpointer a, gconstpointer b, G_GNUC_UNUSED gpointer user_data)
+{
+	return *(const gint *) a - *(const gint *) b;
+}
+
 static gboolean
 char_is_quote(gchar ch)
 {
@@ -385,9 +434,11 @@ handle_backspace(
 	gint end_pos;
 	gint line_start, line_end, line;
 	gint i;
+	AutocloseContext ctx;
 	if (!ac_info->delete_pairing_brace)
 		return AC_CONTINUE_ACTION;
-	ch = char_at(sci, pos - 1);
+	context_read(&ctx, sci, pos);
+	ch = context_char_at(&ctx, pos - 1);
 
 	if (!check_chars(sci, ch, ch_left, ch_right))
 		return AC_CONTINUE_ACTION;
@@ -441,10 +492,10 @@ final:
 	}
 
 	/* handle \'|' situation */
-	if (char_is_quote(ch) && char_at(sci, pos - 2) == '\\')
+	if (char_is_quote(ch) && context_char_at(&ctx, pos - 2) == '\\')
 		return AC_CONTINUE_ACTION;
 
-	if (ch_left[0] == ch && ch_right[0] == char_at(sci, pos))
+	if (ch_left[0] == ch && ch_right[0] == context_char_at(&ctx, pos))
 	{
 		SSM(sci, SCI_DELETERANGE, pos, 1);
 		data->jump_on_tab = 0;
@@ -517,49 +568,37 @@ enclose_selection(
 		/* specially handle rectangular selection */
 		if (selections > 1)
 		{
-			gint *sels_left = g_malloc(selections * sizeof(gint));
-			gint *sels_right = g_malloc(selections * sizeof(gint));
-			gint caret = get_caret_pos(sci, 0);
-			gint anchor = get_ancor_pos(sci, 0);
-			gboolean caret_is_left = caret < anchor;
-			gint pos_first = get_caret_pos(sci, 0);
-			gint pos_second = get_caret_pos(sci, 1);
-			gboolean selection_is_up_down = pos_first < pos_second;
-			gint line;
-			/* looks like a forward loop but actually lines processed in reverse order */
+			/* start and end pairs, sorted by start */
+			gint *sels = g_new(gint, selections * 2);
+			gint left_len = strlen(chars_left);
+			gint right_len = strlen(chars_right);
 			for (i = 0; i < selections; i++)
 			{
-				if(selection_is_up_down)
-					line = selections - i - 1;
-				else
-					line = i;
-				if (caret_is_left)
-				{
-					sels_left[i]  = get_caret_pos(sci, line);
-					sels_right[i] = get_ancor_pos(sci, line) + 1;
-				}
-				else
-				{
-					sels_right[i] = get_caret_pos(sci, line) + 1;
-					sels_left[i]  = get_ancor_pos(sci, line);
-				}
+				gint caret = get_caret_pos(sci, i);
+				gint anchor = get_ancor_pos(sci, i);
+				sels[2 * i]     = MIN(caret, anchor);
+				sels[2 * i + 1] = MAX(caret, anchor);
 			}
-			for (i = 0; i < selections; i++)
+			g_qsort_with_data(sels, selections, 2 * sizeof(gint), compare_positions, NULL);
+			/* insert from the last selection back, so that no position moves,
+			 * and repaint once when all are done */
+			SSM(sci, SCI_SETREDRAW, FALSE, 0);
+			for (i = selections - 1; i >= 0; i--)
 			{
-				insert_text(sci, sels_left[i],  chars_left);
-				insert_text(sci, sels_right[i], chars_right);
-				sels_left[i]  += (selections - i - 1) * 2 + 1;
-				sels_right[i] += (selections - i - 1) * 2 + 1;
+				insert_text(sci, sels[2 * i + 1], chars_right);
+				insert_text(sci, sels[2 * i], chars_left);
 			}
 			if (ac_info->keep_selection)
 			{
-				i = 0;
-				SSM(sci, SCI_SETSELECTION, sels_left[i], sels_right[i] - 1);
-				for (i = 1; i < selections; i++)
-					SSM(sci, SCI_ADDSELECTION, sels_left[i], sels_right[i] - 1);
+				for (i = 0; i < selections; i++)
+				{
+					gint shift = i * (left_len + right_len) + left_len;
+					SSM(sci, i == 0 ? SCI_SETSELECTION : SCI_ADDSELECTION,
+						sels[2 * i] + shift, sels[2 * i + 1] + shift);
+				}
 			}
-			g_free(sels_left);
-			g_free(sels_right);
+			SSM(sci, SCI_SETREDRAW, TRUE, 0);
+			g_free(sels);
 		}
 		else /* normal selection */
 		{
@@ -580,22 +619,32 @@ enclose_selection(
 	return AC_STOP_ACTION;
 }
 
+/* Returns the line starting the statement that a brace typed at pos opens:
+ * the brace's line if there is text before it, or else the line before
+ * (a brace alone on its line), -1 if that one is blank. Looking no further
+ * keeps the cost the same whatever the text before the caret. */
+static gint
+get_brace_statement_line(ScintillaObject *sci, gint pos)
+{
+	gint line = sci_get_line_from_position(sci, pos);
+
+	if (get_indent(sci, line) < pos)
+		return line;
+	if (line == 0)
+		return -1;
+	line--;
+	if (get_indent(sci, line) == sci_get_line_end_position(sci, line))
+		return -1;
+	return line;
+}
+
 static gboolean
 check_struct(
 	ScintillaObject *sci,
-	gint             pos,
+	gint             line,
 	const gchar     *str)
 {
-	gchar ch;
-	gint line, len;
-	ch = char_at(sci, pos - 1);
-	while(g_ascii_isspace(ch))
-	{
-		pos--;
-		ch = char_at(sci, pos - 1);
-	}
-	line = sci_get_line_from_position(sci, pos);
-	len = strlen(str);
+	gint len = strlen(str);
 	const gchar *sci_buf = get_char_range(sci, get_indent(sci, line), len);
 	g_return_val_if_fail(sci_buf, FALSE);
 	if (strncmp(sci_buf, str, len) == 0)
@@ -610,13 +659,19 @@ struct_semicolon(
 	gchar           *chars_right,
 	gint             filetype)
 {
-	if (filetype_c_or_cpp(filetype) && 
-	   (check_struct(sci, pos, "struct") || check_struct(sci, pos, "typedef struct")))
+	gint line;
+
+	if (!filetype_c_or_cpp(filetype))
+		return;
+	line = get_brace_statement_line(sci, pos);
+	if (line < 0)
+		return;
+	if (check_struct(sci, line, "struct") || check_struct(sci, line, "typedef struct"))
 	{
 		chars_right[1] = ';';
 		return;
 	}
-	if (filetype_cpp(filetype) && check_struct(sci, pos, "class"))
+	if (filetype_cpp(filetype) && check_struct(sci, line, "class"))
 	{
 		chars_right[1] = ';';
 		return;
@@ -650,6 +705,7 @@ auto_close_chars(
 	gint             pos, line, lex_offset;
 	gboolean         has_sel;
 	gint             filetype = 0;
+	AutocloseContext ctx;
 
 	g_return_val_if_fail(data, AC_CONTINUE_ACTION);
 	doc = data->doc;
@@ -690,23 +746,24 @@ auto_close_chars(
 		return AC_CONTINUE_ACTION;
 
 	has_sel = sci_has_selection(sci);
+	context_read(&ctx, sci, pos);
 
 	/* do not suppress/complete in case: '\|' */
-	if (char_is_quote(ch) && char_at(sci, pos - 1) == '\\' && !has_sel)
+	if (char_is_quote(ch) && context_char_at(&ctx, pos - 1) == '\\' && !has_sel)
 		return AC_CONTINUE_ACTION;
 
 	lexer = sci_get_lexer(sci);
 
 	/* in C-like languages - complete functions with ; */
 	lex_offset = -1;
-	ch_buf = char_at(sci, pos + lex_offset);
+	ch_buf = context_char_at(&ctx, pos + lex_offset);
 	while (g_ascii_isspace(ch_buf))
 	{
 		--lex_offset;
-		ch_buf = char_at(sci, pos + lex_offset);
+		ch_buf = context_char_at(&ctx, pos + lex_offset);
 	}
 
-	style = sci_get_style_at(sci, pos + lex_offset);
+	style = context_style_at(&ctx, pos + lex_offset);
 
 	/* add ; after functions */
 	if (lexer_cpp_like(lexer, style) &&
@@ -718,10 +775,10 @@ auto_close_chars(
 		 !check_define(sci, line))
 		chars_right[1] = ';';
 
-	style = sci_get_style_at(sci, pos);
+	style = context_style_at(&ctx, pos);
 
 	/* suppress double completion symbols */
-	ch_next = char_at(sci, pos);
+	ch_next = context_char_at(&ctx, pos);
 	if (ch == ch_next && !has_sel && ac_info->suppress_doubling &&
 	  !(chars_left[0] != chars_right[0] && ch == chars_left[0]))
 	{
@@ -770,6 +827,9 @@ on_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
 {
 	AutocloseUserData *data = user_data;
 	g_return_val_if_fail(data && DOC_VALID(data->doc), AC_CONTINUE_ACTION);
+	/* deciding whether to close scans back from the caret */
+	if (gp_large_file_check(data->doc))
+		return AC_CONTINUE_ACTION;
 	return auto_close_chars(data, event);
 }
 
@@ -800,6 +860,16 @@ on_sci_notify(ScintillaObject *sci, gint scn, SCNotification *nt, gpointer user_
 	data->last_line = new_line;
 }
 
+static void
+on_sci_notify_profiled(ScintillaObject *sci, gint scn, SCNotification *nt, gpointer user_data)
+{
+	GpNotifyTimer timer;
+
+	gp_notify_profile_start(&timer, geany_plugin, nt);
+	on_sci_notify(sci, scn, nt, user_data);
+	gp_notify_profile_stop(&timer);
+}
+
 
 static void
 on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data)
@@ -813,7 +883,7 @@ on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data)
 	g_return_if_fail(data);
 	data->doc = doc;
 	data->notify_handler[0] = g_signal_connect(G_OBJECT(sci), "sci-notify",
-					G_CALLBACK(on_sci_notify), data);
+					G_CALLBACK(on_sci_notify_profiled), data);
 	data->notify_handler[1] = g_signal_connect(G_OBJECT(sci), "key-press-event",
 					G_CALLBACK(on_key_press), data);
 	/* This will free the data when the sci is destroyed */
@@ -955,6 +1025,8 @@ plugin_init(G_GNUC_UNUSED GeanyData *data)
 #undef GET_CONF_BOOL
 
 	g_key_file_free(config);
+
+	gp_large_file_register(geany_plugin, _("Auto-closing"), GP_LARGE_FILE_DISABLED);
 }
 
 #define GET_CHECKBOX_ACTIVE(name) gboolean sens = gtk_toggle_button_get_active(\
@@ -1128,6 +1200,7 @@ plugin_configure(GtkDialog *dialog)
 void
 plugin_cleanup(void)
 {
+	gp_large_file_unregister(geany_plugin);
 	autoclose_handlers_cleanup();
 	g_free(ac_info->config_file);
 	g_free(ac_info);
@@ -0,0 +1,104 @@
+/*
+ * bench-commander.c - benchmarks of Commander's fuzzy matching
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/* get_score() is static, the plugin is compiled in this file */
+#include "commander/src/commander-plugin.c"
+
+#include "bench.h"
+#include "bench-stubs.h"
+
+
+#define N_ROWS 2000
+
+typedef struct
+{
+	const gchar *needle;
+	GPtrArray *haystacks;
+	gint total;
+} ScoreData;
+
+
+/* scores every row, like filtering the list on a keystroke */
+static void score_rows(gpointer data)
+{
+	ScoreData *sd = data;
+	guint i;
+
+	sd->total = 0;
+	for (i = 0; i < sd->haystacks->len; i++)
+		sd->total += get_score(sd->needle, g_ptr_array_index(sd->haystacks, i));
+}
+
+
+/* rows like the ones Commander lists: menu items and document paths */
+static GPtrArray *create_haystacks(gsize *bytes)
+{
+	GPtrArray *haystacks = g_ptr_array_new();
+	guint i;
+
+	*bytes = 0;
+	for (i = 0; i < N_ROWS; i++)
+	{
+		gchar *row;
+
+		if (i % 4 == 0)
+			row = g_strdup_printf("%s/%s %s", bench_word(), bench_word(), bench_word());
+		else
+			row = g_strdup_printf("/home/user/src/%s/%s/%s_%s.c", bench_word(),
+				bench_word(), bench_word(), bench_word());
+		*bytes += strlen(row);
+		g_ptr_array_add(haystacks, row);
+	}
+	return haystacks;
+}
+
+
+int main(int argc, char **argv)
+{
+	static const struct
+	{
+		const gchar *name;
+		const gchar *needle;
+	}
+	needles[] =
+	{
+		{ "get_score/short", "doc" },
+		{ "get_score/path", "src/plugin/editor" },
+		{ "get_score/long", "home user src document window buffer_value" },
+		{ "get_score/no-match", "zqx" }
+	};
+	ScoreData sd;
+	gsize bytes;
+	guint i;
+
+	bench_init(&argc, &argv, "commander");
+	bench_stubs_init();
+
+	sd.haystacks = create_haystacks(&bytes);
+	for (i = 0; i < G_N_ELEMENTS(needles); i++)
+	{
+		sd.needle = needles[i].needle;
+		bench_run(needles[i].name, score_rows, &sd, bytes);
+	}
+
+	g_ptr_array_foreach(sd.haystacks, (GFunc) g_free, NULL);
+	g_ptr_array_free(sd.haystacks, TRUE);
+	bench_stubs_finalize();
+	return bench_finish();
+}
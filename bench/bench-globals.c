@@ -0,0 +1,33 @@
+/*
+ * bench-globals.c - the plugin globals, for benchmarks not linking a plugin's main file
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/* In an archive member of its own, so that the linker only picks it when the
+ * benchmark doesn't already define these, e.g. by including the plugin's
+ * main source file to reach its static functions. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <geanyplugin.h>
+
+
+GeanyPlugin *geany_plugin = NULL;
+GeanyData *geany_data = NULL;
+GeanyFunctions *geany_functions = NULL;
@@ -0,0 +1,166 @@
+/*
+ * bench-gproject.c - benchmarks of GProject's file scanning
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/* compiled here rather than linked, the sources live in the plugin's directory */
+#include "gproject/src/gproject-utils.c"
+#include "gproject/src/gproject-ignore.c"
+#include "gproject/src/gproject-scanner.c"
+
+#include <unistd.h>
+
+#include "bench.h"
+#include "bench-stubs.h"
+
+
+#define TREE_DEPTH 3
+#define TREE_DIRS 6		/* subdirectories of each directory */
+#define TREE_FILES 20		/* files in each directory */
+
+typedef struct
+{
+	gchar *base_path;
+	gchar *index_file;	/* NULL to scan without an index */
+	GMainLoop *loop;
+	guint n_files;
+} ScanData;
+
+
+static void on_scanned(GPrjScanner *scanner, GPtrArray *files, GPtrArray *dirs,
+	gpointer user_data)
+{
+	ScanData *sd = user_data;
+
+	sd->n_files = files->len;
+	g_main_loop_quit(sd->loop);
+}
+
+
+/* what gprj_project_rescan() does when a project is opened, up to the list of files */
+static void scan(gpointer data)
+{
+	static gchar *file_patterns[] = { "*.c", "*.h", "Makefile*", NULL };
+	static gchar *ignored_dirs_patterns[] = { ".*", "CVS", NULL };
+	ScanData *sd = data;
+
+	if (sd->index_file == NULL)
+		gprj_scanner_start(sd->base_path, file_patterns, ignored_dirs_patterns, FALSE,
+			NULL, on_scanned, sd);
+	else
+		gprj_scanner_start(sd->base_path, file_patterns, ignored_dirs_patterns, FALSE,
+			sd->index_file, on_scanned, sd);
+	g_main_loop_run(sd->loop);
+}
+
+
+static void create_tree(const gchar *path, gint depth)
+{
+	static const gchar *const extensions[] = { ".c", ".h", ".txt", ".o", "" };
+	guint i;
+
+	g_mkdir_with_parents(path, 0755);
+	for (i = 0; i < TREE_FILES; i++)
+	{
+		gchar *name = g_strdup_printf("%s_%u%s", bench_word(), i,
+			extensions[bench_random(G_N_ELEMENTS(extensions))]);
+		gchar *filename = g_build_filename(path, name, NULL);
+
+		g_file_set_contents(filename, "", 0, NULL);
+		g_free(filename);
+		g_free(name);
+	}
+
+	if (depth == TREE_DEPTH)
+	{
+		/* ignored, and not read */
+		gchar *git = g_build_filename(path, ".git", "objects", NULL);
+
+		create_tree(git, TREE_DEPTH - 1);
+		g_free(git);
+	}
+
+	if (depth == 0)
+		return;
+
+	for (i = 0; i < TREE_DIRS; i++)
+	{
+		gchar *name = g_strdup_printf("%s_%u", bench_word(), i);
+		gchar *subdir = g_build_filename(path, name, NULL);
+
+		create_tree(subdir, depth - 1);
+		g_free(subdir);
+		g_free(name);
+	}
+}
+
+
+static void remove_tree(const gchar *path)
+{
+	GDir *dir = g_dir_open(path, 0, NULL);
+	const gchar *name;
+
+	while (dir != NULL && (name = g_dir_read_name(dir)) != NULL)
+	{
+		gchar *filename = g_build_filename(path, name, NULL);
+
+		if (g_file_test(filename, G_FILE_TEST_IS_DIR) &&
+			! g_file_test(filename, G_FILE_TEST_IS_SYMLINK))
+			remove_tree(filename);
+		else
+			g_unlink(filename);
+		g_free(filename);
+	}
+	if (dir != NULL)
+		g_dir_close(dir);
+	g_rmdir(path);
+}
+
+
+int main(int argc, char **argv)
+{
+	ScanData sd;
+	gchar *name;
+
+	bench_init(&argc, &argv, "gproject");
+	bench_stubs_init();
+
+	name = g_strdup_printf("geany-plugins-bench-%lu", (gulong) getpid());
+	sd.base_path = g_build_filename(g_get_tmp_dir(), name, "project", NULL);
+	create_tree(sd.base_path, TREE_DEPTH);
+	sd.loop = g_main_loop_new(NULL, FALSE);
+
+	sd.index_file = NULL;
+	bench_run("scanner/no-index", scan, &sd, 0);
+
+	/* the first scan writes the index, the next ones only check the directories */
+	sd.index_file = g_build_filename(g_get_tmp_dir(), name, "index", NULL);
+	bench_run("scanner/unchanged-index", scan, &sd, 0);
+	g_unlink(sd.index_file);
+	g_free(sd.index_file);
+
+	g_main_loop_unref(sd.loop);
+	remove_tree(sd.base_path);
+	g_free(sd.base_path);
+	sd.base_path = g_build_filename(g_get_tmp_dir(), name, NULL);
+	remove_tree(sd.base_path);
+	g_free(sd.base_path);
+	g_free(name);
+
+	bench_stubs_finalize();
+	return bench_finish();
+}
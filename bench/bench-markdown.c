@@ -0,0 +1,132 @@
+/*
+ * bench-markdown.c - benchmarks of the peg-markdown conversion
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include "markdown_lib.h"
+
+#include "bench.h"
+
+
+static void convert(gpointer data)
+{
+	/* the preview converts the whole document on each update */
+	g_free(markdown_to_string(data, 0, HTML_FORMAT));
+}
+
+
+static void append_inline(GString *md)
+{
+	switch (bench_random(12))
+	{
+		case 0: g_string_append_printf(md, "*%s* ", bench_word()); break;
+		case 1: g_string_append_printf(md, "**%s %s** ", bench_word(), bench_word()); break;
+		case 2: g_string_append_printf(md, "`%s()` ", bench_word()); break;
+		case 3: g_string_append_printf(md, "[%s](http://example.com/%s) ", bench_word(),
+			bench_word()); break;
+		default: g_string_append_printf(md, "%s ", bench_word());
+	}
+}
+
+
+static void append_paragraph(GString *md, guint words)
+{
+	guint i;
+
+	for (i = 0; i < words; i++)
+	{
+		append_inline(md);
+		if (i % 12 == 11)
+			g_string_append_c(md, '\n');
+	}
+	g_string_append(md, "\n\n");
+}
+
+
+/* a document like a README: headers, paragraphs, lists, code and quotes */
+static gchar *create_markdown(gsize size)
+{
+	GString *md = g_string_new(NULL);
+	guint i;
+
+	while (md->len < size)
+	{
+		switch (bench_random(6))
+		{
+			case 0:
+				g_string_append_printf(md, "%.*s %s %s\n\n", (gint) (1 + bench_random(3)),
+					"###", bench_word(), bench_word());
+				break;
+			case 1:
+				for (i = 1 + bench_random(6); i > 0; i--)
+				{
+					g_string_append(md, bench_random(2) ? "* " : "1. ");
+					append_paragraph(md, 3 + bench_random(8));
+					g_string_truncate(md, md->len - 1);
+				}
+				g_string_append_c(md, '\n');
+				break;
+			case 2:
+				for (i = 1 + bench_random(8); i > 0; i--)
+					g_string_append_printf(md, "    %s = %s(%u);\n", bench_word(),
+						bench_word(), bench_random(100));
+				g_string_append_c(md, '\n');
+				break;
+			case 3:
+				g_string_append(md, "> ");
+				append_paragraph(md, 10 + bench_random(20));
+				break;
+			default:
+				append_paragraph(md, 20 + bench_random(60));
+		}
+	}
+	return g_string_free(md, FALSE);
+}
+
+
+int main(int argc, char **argv)
+{
+	static const struct
+	{
+		const gchar *name;
+		gsize size;
+	}
+	inputs[] =
+	{
+		{ "markdown_to_string/4k", 4 * 1024 },
+		{ "markdown_to_string/256k", 256 * 1024 }
+	};
+	guint i;
+
+	bench_init(&argc, &argv, "markdown");
+
+	for (i = 0; i < G_N_ELEMENTS(inputs); i++)
+	{
+		gchar *md = create_markdown(inputs[i].size);
+
+		bench_run(inputs[i].name, convert, md, strlen(md));
+		g_free(md);
+	}
+
+	return bench_finish();
+}
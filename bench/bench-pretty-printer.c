@@ -0,0 +1,114 @@
+/*
+ * bench-pretty-printer.c - benchmarks of the XML pretty-printing
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/* compiled here rather than linked, the sources live in the plugin's directory */
+#include "pretty-printer/src/PrettyPrinter.c"
+
+#include "bench.h"
+
+
+typedef struct
+{
+	gchar *xml;
+	gint length;
+	PrettyPrintingOptions *options;
+} PrettyData;
+
+
+static void pretty_print(gpointer data)
+{
+	PrettyData *pd = data;
+	/* processXMLPrettyPrinting() replaces the buffer, free()ing the input */
+	char *xml = malloc(pd->length + 1);
+	int length = pd->length;
+
+	memcpy(xml, pd->xml, pd->length + 1);
+	if (processXMLPrettyPrinting(&xml, &length, pd->options) != PRETTY_PRINTING_SUCCESS)
+		g_error("pretty-printing failed");
+	free(xml);
+}
+
+
+static void append_element(GString *xml, gint depth)
+{
+	const gchar *name = bench_random(2) ? "item" : "node";
+	guint i, n_children;
+
+	g_string_append_printf(xml, "<%s id=\"%u\" name=\"%s\">", name, bench_random(100000),
+		bench_word());
+
+	n_children = depth > 0 ? 1 + bench_random(5) : 0;
+	if (n_children == 0)
+	{
+		switch (bench_random(5))
+		{
+			case 0: g_string_append_printf(xml, "<!-- %s %s -->", bench_word(), bench_word()); break;
+			case 1: g_string_append_printf(xml, "<![CDATA[%s < %s]]>", bench_word(), bench_word()); break;
+			case 2: g_string_append(xml, "<empty></empty>"); break;
+			default: g_string_append_printf(xml, "  %s %s  ", bench_word(), bench_word());
+		}
+	}
+	for (i = 0; i < n_children; i++)
+		append_element(xml, depth - 1);
+
+	g_string_append_printf(xml, "</%s>", name);
+}
+
+
+/* a document on a single line, the usual input of the pretty-printer */
+static gchar *create_xml(gsize size)
+{
+	GString *xml = g_string_new("<?xml version=\"1.0\" encoding=\"UTF-8\"?><root>");
+
+	while (xml->len < size)
+		append_element(xml, 4);
+	g_string_append(xml, "</root>");
+	return g_string_free(xml, FALSE);
+}
+
+
+int main(int argc, char **argv)
+{
+	static const struct
+	{
+		const gchar *name;
+		gsize size;
+	}
+	inputs[] =
+	{
+		{ "processXMLPrettyPrinting/4k", 4 * 1024 },
+		{ "processXMLPrettyPrinting/1m", 1024 * 1024 }
+	};
+	PrettyData pd;
+	guint i;
+
+	bench_init(&argc, &argv, "pretty-printer");
+
+	pd.options = createDefaultPrettyPrintingOptions();
+	for (i = 0; i < G_N_ELEMENTS(inputs); i++)
+	{
+		pd.xml = create_xml(inputs[i].size);
+		pd.length = strlen(pd.xml);
+		bench_run(inputs[i].name, pretty_print, &pd, pd.length);
+		g_free(pd.xml);
+	}
+	free(pd.options);
+
+	return bench_finish();
+}
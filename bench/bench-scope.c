@@ -0,0 +1,339 @@
+/*
+ * bench-scope.c - benchmarks of Scope's GDB/MI message parsing
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/* The handlers parse_message() routes the messages to are the rest of Scope,
+ * which needs its user interface.  They are all replaced by one only counting
+ * the parsed nodes, so that the parsing alone is measured. */
+#define on_break_created bench_on_message
+#define on_break_deleted bench_on_message
+#define on_break_done bench_on_message
+#define on_break_features bench_on_message
+#define on_break_inserted bench_on_message
+#define on_break_list bench_on_message
+#define on_break_stopped bench_on_message
+#define on_debug_auto_run bench_on_message
+#define on_debug_error bench_on_message
+#define on_debug_list_source bench_on_message
+#define on_debug_load_error bench_on_message
+#define on_debug_loaded bench_on_message
+#define on_inspect_assign bench_on_message
+#define on_inspect_changelist bench_on_message
+#define on_inspect_children bench_on_message
+#define on_inspect_evaluate bench_on_message
+#define on_inspect_format bench_on_message
+#define on_inspect_ndeleted bench_on_message
+#define on_inspect_path_expr bench_on_message
+#define on_inspect_variable bench_on_message
+#define on_local_variables bench_on_message
+#define on_memory_read_bytes bench_on_message
+#define on_menu_evaluate_value bench_on_message
+#define on_register_changes bench_on_message
+#define on_register_names bench_on_message
+#define on_register_values bench_on_message
+#define on_stack_arguments bench_on_message
+#define on_stack_follow bench_on_message
+#define on_stack_frames bench_on_message
+#define on_thread_created bench_on_message
+#define on_thread_exited bench_on_message
+#define on_thread_follow bench_on_message
+#define on_thread_frame bench_on_message
+#define on_thread_group_added bench_on_message
+#define on_thread_group_exited bench_on_message
+#define on_thread_group_removed bench_on_message
+#define on_thread_group_started bench_on_message
+#define on_thread_info bench_on_message
+#define on_thread_running bench_on_message
+#define on_thread_selected bench_on_message
+#define on_thread_stopped bench_on_message
+#define on_tooltip_error bench_on_message
+#define on_tooltip_value bench_on_message
+#define on_watch_error bench_on_message
+#define on_watch_value bench_on_message
+
+#include "scope/src/parse.c"
+
+#include "bench.h"
+#include "bench-stubs.h"
+
+
+static guint bench_nodes = 0;
+static guint bench_errors = 0;
+
+void bench_on_message(GArray *nodes)
+{
+	bench_nodes += nodes->len;
+}
+
+
+/* What parse.c references besides the handlers: error reporting, and the
+ * parse modes store, which parse_message() doesn't reach.  The options have
+ * their default values. */
+
+gboolean pref_gdb_async_mode = FALSE;
+gint option_high_bit_mode = HB_7BIT;
+gboolean option_member_names = TRUE;
+gboolean option_long_mr_format = TRUE;
+
+void dc_error(const char *format, ...)
+{
+	bench_errors++;
+}
+
+void plugin_blink(void)
+{
+}
+
+GObject *get_object(const char *name)
+{
+	g_return_val_if_reached(NULL);
+}
+
+void views_context_dirty(DebugState state, gboolean frame_only)
+{
+}
+
+void program_load_views(void)
+{
+}
+
+gboolean store_find(ScpTreeStore *store, GtkTreeIter *iter, guint column, const char *key)
+{
+	return FALSE;
+}
+
+void store_save(ScpTreeStore *store, GKeyFile *config, const char *prefix,
+	gboolean (*save_func)(GKeyFile *config, const char *section, GtkTreeIter *iter))
+{
+}
+
+void utils_load(GKeyFile *config, const char *prefix,
+	gboolean (*load_func)(GKeyFile *config, const char *section))
+{
+}
+
+gchar *utils_key_file_get_string(GKeyFile *config, const char *section, const char *key)
+{
+	return NULL;
+}
+
+gchar *utils_get_utf8_basename(const char *file)
+{
+	return g_path_get_basename(file);
+}
+
+char *utils_get_locale_from_7bit(const char *text)
+{
+	return g_strdup(text);
+}
+
+gchar *utils_get_display_from_locale(const char *locale, gint hb_mode)
+{
+	return g_strdup(locale);
+}
+
+GType scp_tree_store_get_type(void)
+{
+	return G_TYPE_OBJECT;
+}
+
+void scp_tree_store_insert_with_values(ScpTreeStore *store, GtkTreeIter *iter,
+	GtkTreeIter *parent, gint position, ...)
+{
+}
+
+void scp_tree_store_get(ScpTreeStore *store, GtkTreeIter *iter, ...)
+{
+}
+
+void scp_tree_store_set(ScpTreeStore *store, GtkTreeIter *iter, ...)
+{
+}
+
+void scp_tree_store_set_sort_column_id(ScpTreeStore *store, gint sort_column_id,
+	GtkSortType order)
+{
+}
+
+void scp_tree_store_clear_children(ScpTreeStore *store, GtkTreeIter *parent,
+	gboolean emit_subsignals)
+{
+}
+
+
+typedef struct
+{
+	const char *token;	/* the mark and the rest, as debug.c passes it */
+	char *message;
+} Message;
+
+typedef struct
+{
+	GArray *messages;
+	GString *buffer;
+} ParseData;
+
+
+static void parse_messages(gpointer data)
+{
+	ParseData *pd = data;
+	guint i;
+
+	for (i = 0; i < pd->messages->len; i++)
+	{
+		const Message *m = &g_array_index(pd->messages, Message, i);
+
+		/* parsed in place, like in the receive buffer */
+		g_string_assign(pd->buffer, m->message);
+		parse_message(pd->buffer->str, m->token);
+	}
+}
+
+
+static void add_message(ParseData *pd, const char *token, char *message)
+{
+	Message m = { token, message };
+
+	g_array_append_val(pd->messages, m);
+}
+
+
+static char *create_frame(guint level)
+{
+	return g_strdup_printf("frame={level=\"%u\",addr=\"0x%016x\",func=\"%s_%s\","
+		"file=\"%s.c\",fullname=\"/home/user/src/%s/%s.c\",line=\"%u\"}", level,
+		bench_random(G_MAXINT), bench_word(), bench_word(), bench_word(), bench_word(),
+		bench_word(), 1 + bench_random(5000));
+}
+
+
+static char *create_list(const char *prefix, guint count, char *(*create)(guint n))
+{
+	GString *list = g_string_new(prefix);
+	guint i;
+
+	for (i = 0; i < count; i++)
+	{
+		char *item = create(i);
+
+		if (i > 0)
+			g_string_append_c(list, ',');
+		g_string_append(list, item);
+		g_free(item);
+	}
+	g_string_append_c(list, ']');
+	return g_string_free(list, FALSE);
+}
+
+
+static char *create_variable(guint n)
+{
+	return g_strdup_printf("{name=\"%s_%u\",value=\"{x = %u, name = 0x%x \\\"%s\\\"}\"}",
+		bench_word(), n, bench_random(1000), bench_random(G_MAXINT), bench_word());
+}
+
+
+static char *create_register(guint n)
+{
+	return g_strdup_printf("{number=\"%u\",value=\"0x%x\"}", n, bench_random(G_MAXINT));
+}
+
+
+static char *create_thread(guint n)
+{
+	char *frame = create_frame(0);
+	char *thread = g_strdup_printf("{id=\"%u\",target-id=\"Thread 0x7ffff7%04x (LWP %u)\","
+		"name=\"%s\",%s,state=\"stopped\",core=\"%u\"}", n + 1, bench_random(0x10000),
+		1000 + n, bench_word(), frame, bench_random(8));
+
+	g_free(frame);
+	return thread;
+}
+
+
+/* the messages of a step in the debugger, with the views refreshed */
+static void create_step(ParseData *pd)
+{
+	char *frame = create_frame(0);
+
+	add_message(pd, NULL, g_strdup("*running,thread-id=\"all\""));
+	add_message(pd, NULL, g_strdup_printf("*stopped,reason=\"end-stepping-range\",%s,"
+		"thread-id=\"1\",stopped-threads=\"all\",core=\"3\"", frame));
+	add_message(pd, NULL, create_list("^done,threads=[", 4, create_thread));
+	add_message(pd, "41", create_list("^done,stack=[", 12, create_frame));
+	add_message(pd, "41", create_list("^done,variables=[", 16, create_variable));
+	add_message(pd, "41", create_list("^done,register-values=[", 24, create_register));
+	add_message(pd, "61", g_strdup("^done,value=\"{x = 1, y = 2, name = 0x5555 \\\"abc\\\"}\""));
+	g_free(frame);
+}
+
+
+static void clear_messages(ParseData *pd)
+{
+	guint i;
+
+	for (i = 0; i < pd->messages->len; i++)
+		g_free(g_array_index(pd->messages, Message, i).message);
+	g_array_set_size(pd->messages, 0);
+}
+
+
+static gsize messages_size(ParseData *pd)
+{
+	gsize size = 0;
+	guint i;
+
+	for (i = 0; i < pd->messages->len; i++)
+		size += strlen(g_array_index(pd->messages, Message, i).message);
+	return size;
+}
+
+
+int main(int argc, char **argv)
+{
+	ParseData pd;
+
+	bench_init(&argc, &argv, "scope");
+	bench_stubs_init();
+	parse_arrays = g_ptr_array_new();
+	errors = g_string_sized_new(MAXLEN);
+
+	pd.messages = g_array_new(FALSE, FALSE, sizeof(Message));
+	pd.buffer = g_string_sized_new(0x10000);
+
+	create_step(&pd);
+	bench_run("parse_message/step", parse_messages, &pd, messages_size(&pd));
+	clear_messages(&pd);
+
+	add_message(&pd, "41", create_list("^done,stack=[", 256, create_frame));
+	bench_run("parse_message/stack-256", parse_messages, &pd, messages_size(&pd));
+	clear_messages(&pd);
+
+	add_message(&pd, "41", create_list("^done,variables=[", 512, create_variable));
+	bench_run("parse_message/variables-512", parse_messages, &pd, messages_size(&pd));
+	clear_messages(&pd);
+
+	if (bench_errors > 0)
+		g_warning("%u messages failed to parse", bench_errors);
+
+	g_array_free(pd.messages, TRUE);
+	g_string_free(pd.buffer, TRUE);
+	parse_finalize();
+	bench_stubs_finalize();
+	return bench_finish();
+}
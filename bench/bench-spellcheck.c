@@ -0,0 +1,135 @@
+/*
+ * bench-spellcheck.c - benchmarks of the spell checker's tokenizer
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/* split_text_words() and the other steps are static, the speller is compiled in
+ * this file; the dictionary is not involved */
+#include "spellcheck/src/speller.c"
+
+#include "bench.h"
+#include "bench-stubs.h"
+
+
+SpellCheck *sc_info = NULL;
+
+typedef struct
+{
+	GeanyDocument *doc;
+	gint lexer;
+	guchar *styles;
+	gint words;
+} TokenizeData;
+
+
+/* what check_job_word() does to each word before looking it up */
+static gboolean count_word(const gchar *word, gsize offset, gpointer data)
+{
+	TokenizeData *td = data;
+	gchar *word_to_check;
+	gint word_offset;
+
+	if (isdigit(*word))
+		return TRUE;
+
+	word_to_check = strip_word(word, &word_offset);
+	if (NZV(word_to_check))
+		td->words++;
+	g_free(word_to_check);
+	return TRUE;
+}
+
+
+/* the work of sc_speller_check_document(), up to the dictionary */
+static void tokenize(gpointer data)
+{
+	TokenizeData *td = data;
+	ScintillaObject *sci = td->doc->editor->sci;
+	gsize len = sci_get_length(sci);
+	GString *str = g_string_sized_new(256);
+	gchar *text;
+
+	td->lexer = scintilla_send_message(sci, SCI_GETLEXER, 0, 0);
+	td->words = 0;
+	gp_sci_get_styled_text(sci, 0, len, &text, &td->styles);
+	split_text_words(text, td->styles, len, td->lexer, str, count_word, td);
+
+	g_string_free(str, TRUE);
+	g_free(text);
+	g_free(td->styles);
+}
+
+
+/* C source: only the comments and the strings are checked */
+static GeanyDocument *create_source(gsize size)
+{
+	GString *code = g_string_new(NULL);
+	GArray *comments = g_array_new(FALSE, FALSE, sizeof(gint));
+	GeanyDocument *doc;
+	guint i;
+
+	while (code->len < size)
+	{
+		gchar *text = bench_text(160);
+		gint start = code->len;
+
+		g_string_append_printf(code, "/* %s */\n", text);
+		g_array_append_val(comments, start);
+		start = code->len - start;
+		g_array_append_val(comments, start);
+		g_string_append_printf(code, "static gint %s_%u(GtkTreeView *view)\n{\n"
+			"\treturn g_strcmp0(view, \"%s\");\n}\n\n", bench_word(), bench_random(1000),
+			bench_word());
+		g_free(text);
+	}
+
+	doc = bench_document_new("bench.c", code->str);
+	bench_document_set_lexer(doc, SCLEX_CPP);
+	bench_document_set_style(doc, 0, code->len, SCE_C_IDENTIFIER);
+	for (i = 0; i < comments->len; i += 2)
+		bench_document_set_style(doc, g_array_index(comments, gint, i),
+			g_array_index(comments, gint, i + 1), SCE_C_COMMENT);
+
+	g_array_free(comments, TRUE);
+	g_string_free(code, TRUE);
+	return doc;
+}
+
+
+int main(int argc, char **argv)
+{
+	TokenizeData td;
+	gchar *text;
+
+	bench_init(&argc, &argv, "spellcheck");
+	bench_stubs_init();
+	sc_info = g_new0(SpellCheck, 1);
+
+	text = bench_text(256 * 1024);
+	td.doc = bench_document_new("bench.txt", text);
+	bench_run("tokenize/text", tokenize, &td, strlen(text));
+	bench_document_free(td.doc);
+	g_free(text);
+
+	td.doc = create_source(256 * 1024);
+	bench_run("tokenize/c-source", tokenize, &td, sci_get_length(td.doc->editor->sci));
+	bench_document_free(td.doc);
+
+	g_free(sc_info);
+	bench_stubs_finalize();
+	return bench_finish();
+}
@@ -0,0 +1,384 @@
+/*
+ * bench-stubs.c - headless stand-ins for the parts of Geany the benchmarks use
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#ifndef G_OS_WIN32
+# include <limits.h>
+#endif
+
+#include "bench-stubs.h"
+#include "scintilla/SciLexer.h"
+
+/* the names of the functions are the ones of the table entries, not the
+ * wrappers geanyfunctions.h defines */
+#undef scintilla_send_message
+#undef sci_get_length
+#undef sci_get_line_count
+#undef sci_get_position_from_line
+#undef sci_get_line_from_position
+#undef sci_get_line_end_position
+#undef sci_get_char_at
+#undef sci_get_contents_range
+#undef document_get_current
+#undef tm_get_real_path
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+
+
+/* what a ScintillaObject holds for the benchmarks */
+typedef struct
+{
+	GString *text;
+	guchar *styles;		/* one per byte of text */
+	GArray *line_starts;	/* gint positions, the first one is 0 */
+	gint lexer;
+} BenchBuffer;
+
+static GHashTable *bench_buffers = NULL;	/* ScintillaObject -> BenchBuffer */
+static GeanyDocument *bench_current = NULL;
+
+
+static BenchBuffer *get_buffer(ScintillaObject *sci)
+{
+	BenchBuffer *buffer = g_hash_table_lookup(bench_buffers, sci);
+
+	g_return_val_if_fail(buffer != NULL, NULL);
+	return buffer;
+}
+
+
+static gint buffer_length(BenchBuffer *buffer)
+{
+	return (gint) buffer->text->len;
+}
+
+
+static gint buffer_line_count(BenchBuffer *buffer)
+{
+	return (gint) buffer->line_starts->len;
+}
+
+
+static gint buffer_line_start(BenchBuffer *buffer, gint line)
+{
+	if (line < 0)
+		return 0;
+	if (line >= buffer_line_count(buffer))
+		return buffer_length(buffer);
+	return g_array_index(buffer->line_starts, gint, line);
+}
+
+
+static gint buffer_line_from_position(BenchBuffer *buffer, gint pos)
+{
+	gint low = 0, high = buffer_line_count(buffer) - 1;
+
+	/* the last line starting at or before pos */
+	while (low < high)
+	{
+		gint mid = (low + high + 1) / 2;
+
+		if (g_array_index(buffer->line_starts, gint, mid) <= pos)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	return low;
+}
+
+
+static gint buffer_line_end(BenchBuffer *buffer, gint line)
+{
+	gint end;
+
+	if (line + 1 >= buffer_line_count(buffer))
+		return buffer_length(buffer);
+
+	end = buffer_line_start(buffer, line + 1);
+	if (end > 0 && buffer->text->str[end - 1] == '\n')
+		end--;
+	if (end > 0 && buffer->text->str[end - 1] == '\r')
+		end--;
+	return end;
+}
+
+
+static void buffer_clamp(BenchBuffer *buffer, glong *start, glong *end)
+{
+	if (*end < 0 || *end > buffer_length(buffer))
+		*end = buffer_length(buffer);
+	*start = CLAMP(*start, 0, *end);
+}
+
+
+static long int bench_scintilla_send_message(ScintillaObject *sci, unsigned int msg,
+	uptr_t wparam, sptr_t lparam)
+{
+	BenchBuffer *buffer = get_buffer(sci);
+
+	if (buffer == NULL)
+		return 0;
+
+	switch (msg)
+	{
+		case SCI_GETLENGTH:
+		case SCI_GETTEXTLENGTH:
+			return buffer_length(buffer);
+		case SCI_GETLINECOUNT:
+			return buffer_line_count(buffer);
+		case SCI_POSITIONFROMLINE:
+			return buffer_line_start(buffer, (gint) wparam);
+		case SCI_LINEFROMPOSITION:
+			return buffer_line_from_position(buffer, (gint) wparam);
+		case SCI_GETLINEENDPOSITION:
+			return buffer_line_end(buffer, (gint) wparam);
+		case SCI_GETCHARAT:
+			if ((gint) wparam < 0 || (gint) wparam >= buffer_length(buffer))
+				return 0;
+			return buffer->text->str[wparam];
+		case SCI_GETSTYLEAT:
+			if ((gint) wparam < 0 || (gint) wparam >= buffer_length(buffer))
+				return 0;
+			return buffer->styles[wparam];
+		case SCI_GETLEXER:
+			return buffer->lexer;
+		case SCI_GETCURRENTPOS:
+		case SCI_GETANCHOR:
+		case SCI_GETSELECTIONSTART:
+		case SCI_GETSELECTIONEND:
+			return 0;
+		case SCI_GETTEXTRANGE:
+		{
+			struct Sci_TextRange *tr = (struct Sci_TextRange *) lparam;
+			glong start = tr->chrg.cpMin, end = tr->chrg.cpMax;
+
+			buffer_clamp(buffer, &start, &end);
+			memcpy(tr->lpstrText, buffer->text->str + start, end - start);
+			tr->lpstrText[end - start] = '\0';
+			return end - start;
+		}
+		case SCI_GETSTYLEDTEXT:
+		{
+			struct Sci_TextRange *tr = (struct Sci_TextRange *) lparam;
+			glong start = tr->chrg.cpMin, end = tr->chrg.cpMax;
+			glong i;
+
+			buffer_clamp(buffer, &start, &end);
+			for (i = start; i < end; i++)
+			{
+				tr->lpstrText[2 * (i - start)] = buffer->text->str[i];
+				tr->lpstrText[2 * (i - start) + 1] = (gchar) buffer->styles[i];
+			}
+			tr->lpstrText[2 * (end - start)] = '\0';
+			tr->lpstrText[2 * (end - start) + 1] = '\0';
+			return 2 * (end - start);
+		}
+	}
+	return 0;
+}
+
+
+static gint bench_sci_get_length(ScintillaObject *sci)
+{
+	return bench_scintilla_send_message(sci, SCI_GETLENGTH, 0, 0);
+}
+
+
+static gint bench_sci_get_line_count(ScintillaObject *sci)
+{
+	return bench_scintilla_send_message(sci, SCI_GETLINECOUNT, 0, 0);
+}
+
+
+static gint bench_sci_get_position_from_line(ScintillaObject *sci, gint line)
+{
+	return bench_scintilla_send_message(sci, SCI_POSITIONFROMLINE, line, 0);
+}
+
+
+static gint bench_sci_get_line_from_position(ScintillaObject *sci, gint position)
+{
+	return bench_scintilla_send_message(sci, SCI_LINEFROMPOSITION, position, 0);
+}
+
+
+static gint bench_sci_get_line_end_position(ScintillaObject *sci, gint line)
+{
+	return bench_scintilla_send_message(sci, SCI_GETLINEENDPOSITION, line, 0);
+}
+
+
+static gchar bench_sci_get_char_at(ScintillaObject *sci, gint pos)
+{
+	return (gchar) bench_scintilla_send_message(sci, SCI_GETCHARAT, pos, 0);
+}
+
+
+static gchar *bench_sci_get_contents_range(ScintillaObject *sci, gint start, gint end)
+{
+	BenchBuffer *buffer = get_buffer(sci);
+	glong s = start, e = end;
+
+	if (buffer == NULL)
+		return NULL;
+	buffer_clamp(buffer, &s, &e);
+	return g_strndup(buffer->text->str + s, e - s);
+}
+
+
+static GeanyDocument *bench_document_get_current(void)
+{
+	return bench_current;
+}
+
+
+static gchar *bench_tm_get_real_path(const gchar *file_name)
+{
+#ifndef G_OS_WIN32
+	gchar path[PATH_MAX];
+
+	if (file_name != NULL && realpath(file_name, path) != NULL)
+		return g_strdup(path);
+#endif
+	return g_strdup(file_name);
+}
+
+
+void bench_stubs_init(void)
+{
+	bench_buffers = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	geany_data = g_new0(GeanyData, 1);
+	geany_functions = g_new0(GeanyFunctions, 1);
+
+	geany_functions->p_scintilla = g_new0(ScintillaFuncs, 1);
+	geany_functions->p_scintilla->scintilla_send_message = bench_scintilla_send_message;
+
+	geany_functions->p_sci = g_new0(SciFuncs, 1);
+	geany_functions->p_sci->sci_get_length = bench_sci_get_length;
+	geany_functions->p_sci->sci_get_line_count = bench_sci_get_line_count;
+	geany_functions->p_sci->sci_get_position_from_line = bench_sci_get_position_from_line;
+	geany_functions->p_sci->sci_get_line_from_position = bench_sci_get_line_from_position;
+	geany_functions->p_sci->sci_get_line_end_position = bench_sci_get_line_end_position;
+	geany_functions->p_sci->sci_get_char_at = bench_sci_get_char_at;
+	geany_functions->p_sci->sci_get_contents_range = bench_sci_get_contents_range;
+
+	geany_functions->p_document = g_new0(DocumentFuncs, 1);
+	geany_functions->p_document->document_get_current = bench_document_get_current;
+
+	geany_functions->p_tm = g_new0(TagManagerFuncs, 1);
+	geany_functions->p_tm->tm_get_real_path = bench_tm_get_real_path;
+}
+
+
+void bench_stubs_finalize(void)
+{
+	g_free(geany_functions->p_scintilla);
+	g_free(geany_functions->p_sci);
+	g_free(geany_functions->p_document);
+	g_free(geany_functions->p_tm);
+	g_free(geany_functions);
+	geany_functions = NULL;
+	g_free(geany_data);
+	geany_data = NULL;
+
+	g_hash_table_destroy(bench_buffers);
+	bench_buffers = NULL;
+	bench_current = NULL;
+}
+
+
+GeanyDocument *bench_document_new(const gchar *file_name, const gchar *text)
+{
+	GeanyDocument *doc = g_new0(GeanyDocument, 1);
+	BenchBuffer *buffer = g_new0(BenchBuffer, 1);
+	const gchar *p;
+	gint start = 0;
+
+	buffer->text = g_string_new(text);
+	buffer->styles = g_malloc0(buffer->text->len + 1);
+	buffer->lexer = SCLEX_NULL;
+	buffer->line_starts = g_array_new(FALSE, FALSE, sizeof(gint));
+	g_array_append_val(buffer->line_starts, start);
+	for (p = buffer->text->str; *p; p++)
+	{
+		/* \r\n, \r and \n line endings */
+		if (*p == '\n' || (*p == '\r' && p[1] != '\n'))
+		{
+			start = p - buffer->text->str + 1;
+			g_array_append_val(buffer->line_starts, start);
+		}
+	}
+
+	/* never realized, only used as the key of its buffer */
+	doc->editor = g_new0(GeanyEditor, 1);
+	doc->editor->document = doc;
+	doc->editor->sci = g_malloc0(sizeof(ScintillaObject));
+	doc->file_name = g_strdup(file_name);
+	doc->real_path = g_strdup(file_name);
+	doc->encoding = g_strdup("UTF-8");
+	doc->is_valid = TRUE;
+	g_hash_table_insert(bench_buffers, doc->editor->sci, buffer);
+
+	bench_current = doc;
+	return doc;
+}
+
+
+void bench_document_set_lexer(GeanyDocument *doc, gint lexer)
+{
+	get_buffer(doc->editor->sci)->lexer = lexer;
+}
+
+
+void bench_document_set_style(GeanyDocument *doc, gint start, gint length, gint style)
+{
+	BenchBuffer *buffer = get_buffer(doc->editor->sci);
+	glong s = start, e = start + length;
+
+	buffer_clamp(buffer, &s, &e);
+	memset(buffer->styles + s, style, e - s);
+}
+
+
+void bench_document_free(GeanyDocument *doc)
+{
+	BenchBuffer *buffer = get_buffer(doc->editor->sci);
+
+	g_hash_table_remove(bench_buffers, doc->editor->sci);
+	g_string_free(buffer->text, TRUE);
+	g_free(buffer->styles);
+	g_array_free(buffer->line_starts, TRUE);
+	g_free(buffer);
+
+	if (bench_current == doc)
+		bench_current = NULL;
+	g_free(doc->editor->sci);
+	g_free(doc->editor);
+	g_free(doc->file_name);
+	g_free(doc->real_path);
+	g_free(doc->encoding);
+	g_free(doc);
+}
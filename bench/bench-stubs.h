@@ -0,0 +1,44 @@
+/*
+ * bench-stubs.h - headless stand-ins for the parts of Geany the benchmarks use
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_BENCH_STUBS_H
+#define GP_BENCH_STUBS_H
+
+#include <geanyplugin.h>
+
+G_BEGIN_DECLS
+
+/* Points geany_data and geany_functions to tables whose functions work on
+ * the documents below, without a Geany instance or a display.  Only the
+ * functions the benchmarked code paths call are implemented, the other
+ * entries are left NULL and crash when called. */
+void bench_stubs_init(void);
+void bench_stubs_finalize(void);
+
+/* Creates a document whose ScintillaObject is only a text buffer understood by
+ * the stub scintilla_send_message(); it becomes the current document.  All the
+ * text has the style 0 and the lexer is SCLEX_NULL until set below. */
+GeanyDocument *bench_document_new(const gchar *file_name, const gchar *text);
+void bench_document_set_lexer(GeanyDocument *doc, gint lexer);
+void bench_document_set_style(GeanyDocument *doc, gint start, gint length, gint style);
+void bench_document_free(GeanyDocument *doc);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * bench.c - micro-benchmark harness for the geany-plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib-object.h>
+
+#include "bench.h"
+
+
+/* the inputs only depend on the seed, so that runs can be compared */
+#define BENCH_SEED 0x67656e79
+
+static const gchar *bench_suite = NULL;
+static gdouble bench_min_time = 0.5;
+static gchar *bench_filter = NULL;
+static GRand *bench_rand = NULL;
+
+static const gchar *const bench_words[] =
+{
+	"the", "of", "and", "to", "in", "is", "it", "that", "for", "on", "with", "as",
+	"editor", "document", "plugin", "project", "symbol", "buffer", "window", "file",
+	"debugger", "breakpoint", "thread", "frame", "variable", "expression", "value",
+	"spelling", "dictionary", "snippet", "completion", "markdown", "preview",
+	"don't", "isn't", "Geany's", "colour", "behaviour", "initialise", "teh", "recieve",
+	"naïve", "café", "Straße", "größer", "élève", "x86_64", "GtkTreeView", "g_strdup"
+};
+
+
+void bench_init(gint *argc, gchar ***argv, const gchar *suite)
+{
+	GOptionEntry entries[] =
+	{
+		{ "min-time", 't', 0, G_OPTION_ARG_DOUBLE, &bench_min_time,
+			"Minimum run time of each benchmark (default: 0.5)", "SECONDS" },
+		{ "filter", 'f', 0, G_OPTION_ARG_STRING, &bench_filter,
+			"Only run the benchmarks whose name contains TEXT", "TEXT" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+	GOptionContext *context;
+	GError *error = NULL;
+
+#if ! GLIB_CHECK_VERSION(2, 32, 0)
+	if (! g_thread_supported())
+		g_thread_init(NULL);
+#endif
+#if ! GLIB_CHECK_VERSION(2, 36, 0)
+	g_type_init();
+#endif
+
+	context = g_option_context_new("- run the benchmarks");
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (! g_option_context_parse(context, argc, argv, &error))
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		exit(2);
+	}
+	g_option_context_free(context);
+
+	bench_suite = suite;
+	bench_rand = g_rand_new_with_seed(BENCH_SEED);
+}
+
+
+gboolean bench_enabled(const gchar *name)
+{
+	return bench_filter == NULL || strstr(name, bench_filter) != NULL;
+}
+
+
+static void print_double(const gchar *key, gdouble value)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	/* not printf(), the output must not depend on the locale */
+	printf(", \"%s\": %s", key, g_ascii_formatd(buf, sizeof(buf), "%.6g", value));
+}
+
+
+void bench_run(const gchar *name, BenchFunc func, gpointer data, gsize bytes)
+{
+	GTimer *timer;
+	gulong iterations = 1;
+	gulong i;
+	gdouble elapsed;
+
+	if (! bench_enabled(name))
+		return;
+
+	/* warm up the caches, and the lazy initializations of the code measured */
+	func(data);
+
+	timer = g_timer_new();
+	for (;;)
+	{
+		g_timer_start(timer);
+		for (i = 0; i < iterations; i++)
+			func(data);
+		elapsed = g_timer_elapsed(timer, NULL);
+
+		if (elapsed >= bench_min_time || iterations >= G_MAXULONG / 16)
+			break;
+		/* aim a little past the minimum time from the rate measured so far */
+		if (elapsed < bench_min_time / 100)
+			iterations *= 10;
+		else
+			iterations = MAX((gulong) (iterations * 1.2 * bench_min_time / elapsed),
+				iterations + 1);
+	}
+	g_timer_destroy(timer);
+
+	printf("{\"suite\": \"%s\", \"benchmark\": \"%s\", \"iterations\": %lu",
+		bench_suite, name, iterations);
+	print_double("seconds", elapsed);
+	print_double("ns_per_op", elapsed * 1e9 / iterations);
+	if (bytes > 0)
+		print_double("mb_per_s", (gdouble) bytes * iterations / elapsed / (1024 * 1024));
+	printf("}\n");
+	fflush(stdout);
+}
+
+
+gint bench_finish(void)
+{
+	g_rand_free(bench_rand);
+	bench_rand = NULL;
+	g_free(bench_filter);
+	bench_filter = NULL;
+	return 0;
+}
+
+
+guint bench_random(guint n)
+{
+	return g_rand_int_range(bench_rand, 0, n);
+}
+
+
+const gchar *bench_word(void)
+{
+	return bench_words[bench_random(G_N_ELEMENTS(bench_words))];
+}
+
+
+gchar *bench_text(gsize size)
+{
+	GString *text = g_string_sized_new(size + 80);
+	gsize line_start = 0;
+
+	while (text->len < size)
+	{
+		gboolean sentence_start = text->len == line_start;
+		const gchar *word = bench_word();
+
+		if (sentence_start)
+		{
+			g_string_append_c(text, g_ascii_toupper(*word));
+			g_string_append(text, word + 1);
+		}
+		else
+			g_string_append(text, word);
+
+		switch (bench_random(16))
+		{
+			case 0: g_string_append(text, ". "); break;
+			case 1: g_string_append(text, ", "); break;
+			case 2: g_string_append_printf(text, " %u ", bench_random(1000)); break;
+			default: g_string_append_c(text, ' ');
+		}
+
+		if (text->len - line_start > 72)
+		{
+			g_string_truncate(text, text->len - 1);
+			g_string_append_c(text, '\n');
+			line_start = text->len;
+		}
+	}
+	return g_string_free(text, FALSE);
+}
@@ -0,0 +1,56 @@
+/*
+ * bench.h - micro-benchmark harness for the geany-plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_BENCH_H
+#define GP_BENCH_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* one call of the code being measured */
+typedef void (*BenchFunc)(gpointer data);
+
+
+/* Parses the options common to all benchmarks (--min-time, --filter) and
+ * initializes GLib. suite is the name reported in the results, usually the
+ * plugin's. */
+void bench_init(gint *argc, gchar ***argv, const gchar *suite);
+
+/* Returns FALSE if the benchmark name was filtered out on the command line,
+ * to skip the preparation of its input */
+gboolean bench_enabled(const gchar *name);
+
+/* Calls func repeatedly for at least the minimum time and prints the result
+ * as a line of JSON on stdout. bytes is the size of the input processed by
+ * each call, to report the throughput, or 0. */
+void bench_run(const gchar *name, BenchFunc func, gpointer data, gsize bytes);
+
+/* Returns the exit status of the benchmark program */
+gint bench_finish(void);
+
+
+/* Deterministic input generators, the same input is generated on each run */
+guint bench_random(guint n);		/* in [0, n) */
+const gchar *bench_word(void);
+gchar *bench_text(gsize size);		/* lines of prose */
+
+G_END_DECLS
+
+#endif
@@ -2,6 +2,8 @@ AC_DEFUN([GP_CHECK_ADDONS],
 [
     GP_ARG_DISABLE([Addons], [auto])
     GP_CHECK_PLUGIN_GTK2_ONLY([Addons])
+    GP_CHECK_PLUGIN_DEPS([Addons], [ADDONS],
+                         [gthread-2.0])
     GP_COMMIT_PLUGIN_STATUS([Addons])
     AC_CONFIG_FILES([
         addons/Makefile
@@ -0,0 +1,6 @@
+AC_DEFUN([GP_CHECK_BENCH],
+[
+    AC_CONFIG_FILES([
+        bench/Makefile
+    ])
+])
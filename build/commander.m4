@@ -4,7 +4,8 @@ AC_DEFUN([GP_CHECK_COMMANDER],
 
     GP_CHECK_PLUGIN_DEPS([Commander], [COMMANDER],
                          [$GP_GTK_PACKAGE >= 2.16
-                          glib-2.0 >= 2.4])
+                          glib-2.0 >= 2.4
+                          gthread-2.0])
 
     GP_COMMIT_PLUGIN_STATUS([Commander])
 
@@ -2,6 +2,8 @@ AC_DEFUN([GP_CHECK_GEANYVC],
 [
     GP_ARG_DISABLE([GeanyVC], [auto])
     GP_CHECK_PLUGIN_GTK2_ONLY([GeanyVC])
+    GP_CHECK_PLUGIN_DEPS([GeanyVC], [GEANYVC],
+                         [gthread-2.0])
     GP_COMMIT_PLUGIN_STATUS([GeanyVC])
     AC_ARG_ENABLE(gtkspell,
         AC_HELP_STRING([--enable-gtkspell=ARG],
@@ -24,6 +26,23 @@ AC_DEFUN([GP_CHECK_GEANYVC],
 
     GP_STATUS_FEATURE_ADD([GeanyVC GtkSpell support], [$enable_gtkspell])
 
+    AC_ARG_ENABLE(libgit2,
+        AC_HELP_STRING([--enable-libgit2=ARG],
+            [Enable the in-process Git backend of GeanyVC. [[default=auto]]]),,
+        enable_libgit2=auto)
+
+    if [[ x"$enable_libgit2" = "xauto" ]]; then
+        PKG_CHECK_MODULES(LIBGIT2, [libgit2 >= 0.23],
+            enable_libgit2=yes, enable_libgit2=no)
+    elif [[ x"$enable_libgit2" = "xyes" ]]; then
+        PKG_CHECK_MODULES(LIBGIT2, [libgit2 >= 0.23])
+    fi
+    if [[ x"$enable_libgit2" = "xyes" ]]; then
+        AC_DEFINE(HAVE_LIBGIT2, 1, [libgit2 support])
+    fi
+
+    GP_STATUS_FEATURE_ADD([GeanyVC libgit2 support], [$enable_libgit2])
+
     AC_CONFIG_FILES([
         geanyvc/Makefile
         geanyvc/src/Makefile
@@ -1,6 +1,8 @@
 AC_DEFUN([GP_CHECK_GPROJECT],
 [
     GP_ARG_DISABLE([GProject], [auto])
+    GP_CHECK_PLUGIN_DEPS([GProject], [GPROJECT],
+                         [gthread-2.0])
     GP_COMMIT_PLUGIN_STATUS([GProject])
     AC_CONFIG_FILES([
         gproject/Makefile
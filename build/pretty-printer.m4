@@ -4,7 +4,8 @@ AC_DEFUN([GP_CHECK_PRETTYPRINTER],
 
     GP_ARG_DISABLE([pretty-printer], [auto])
     GP_CHECK_PLUGIN_DEPS([pretty-printer], [LIBXML],
-                         [libxml-2.0 >= ${LIBXML_VERSION}])
+                         [libxml-2.0 >= ${LIBXML_VERSION}
+                          gthread-2.0])
     GP_COMMIT_PLUGIN_STATUS([Pretty Printer])
 
     AC_CONFIG_FILES([
@@ -8,7 +8,8 @@ AC_DEFUN([GP_CHECK_SPELLCHECK],
                       have_enchant_1_5=yes,
                       have_enchant_1_5=no)
     GP_CHECK_PLUGIN_DEPS([spellcheck], [ENCHANT],
-                         [enchant >= ${ENCHANT_VERSION}])
+                         [enchant >= ${ENCHANT_VERSION}
+                          gthread-2.0])
 
     AM_CONDITIONAL([HAVE_ENCHANT_1_5], [test "$have_enchant_1_5" = yes])
     GP_COMMIT_PLUGIN_STATUS([Spellcheck])
@@ -0,0 +1,7 @@
+AC_DEFUN([GP_CHECK_UTILSLIB],
+[
+    AC_CONFIG_FILES([
+        utils/Makefile
+        utils/src/Makefile
+    ])
+])
@@ -33,6 +33,8 @@
 #include "codenavigation.h"
 #include "switch_head_impl.h"
 #include "goto_file.h"
+#include "file_index.h"
+#include "utils.h"
 
 /************************* Global variables ***************************/
 
@@ -64,6 +66,16 @@ PLUGIN_KEY_GROUP(code_navigation, NB_KEY_IDS)
 static void
 on_configure_response(GtkDialog *dialog, gint response, gpointer user_data);
 
+static void
+on_project_changed(GObject* obj, GKeyFile* config, gpointer user_data);
+
+PluginCallback plugin_callbacks[] =
+{
+	{ "project-open", (GCallback) &on_project_changed, TRUE, NULL },
+	{ "project-save", (GCallback) &on_project_changed, TRUE, NULL },
+	{ NULL, NULL, FALSE, NULL }
+};
+
 /* ---------------------------------------------------------------------
  * Called by Geany to initialize the plugin.
  * Note: data is the same as geany_data.
@@ -76,6 +88,9 @@ void plugin_init(GeanyData *data)
 	/* Initialize the features */
 	switch_head_impl_init();
 	goto_file_init();
+
+	/* Index the files of an already open project */
+	on_project_changed(NULL, NULL, NULL);
 }
 
 /* ---------------------------------------------------------------------
@@ -115,6 +130,23 @@ void plugin_cleanup(void)
 	switch_head_impl_cleanup();
 }
 
+/* ---------------------------------------------------------------------
+ * Callback called when a project is opened or saved : index its files
+ * in the background, for the features to find them.
+ * ---------------------------------------------------------------------
+ */
+static void
+on_project_changed(GObject* obj, GKeyFile* config, gpointer user_data)
+{
+	gchar* base_path = get_project_base_path();
+
+	if(base_path != NULL)
+	{
+		file_index_set_root(base_path);
+		g_free(base_path);
+	}
+}
+
 /* ---------------------------------------------------------------------
  * Callback called when validating the configuration of the plug-in
  * ---------------------------------------------------------------------
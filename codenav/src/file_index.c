@@ -0,0 +1,139 @@
+/*
+ *      file_index.c - this file is part of "codenavigation", which is
+ *      part of the "geany-plugins" project.
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/* Index of the files under a directory, for the "Goto file" feature and the
+ * header/implementation switch. The index itself is the one shared by the
+ * plugins (utils/src/fileindex.c): other plugins indexing the same directory
+ * use the same one, and it starts from the files of the previous session.
+ */
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+#include <geanyplugin.h>
+
+#include "file_index.h"
+
+/******************* Global variables for the feature *****************/
+
+static GpFileIndex* shared_index = NULL;
+static gulong subscription = 0;
+
+static FileIndexChangedFunc changed_func = NULL;
+static gpointer changed_data = NULL;
+
+/********************** Functions for the feature *********************/
+
+static void
+on_index_changed(GpFileIndex* changed_index, gpointer user_data)
+{
+	if(changed_func != NULL)
+		changed_func(changed_data);
+}
+
+/* ---------------------------------------------------------------------
+ * Index the files under root (UTF-8), in the background.
+ * ---------------------------------------------------------------------
+ */
+void
+file_index_set_root(const gchar* new_root)
+{
+	GpFileIndex* new_index;
+
+	g_return_if_fail(new_root != NULL);
+
+	if(shared_index != NULL && utils_str_equal(gp_file_index_get_root(shared_index), new_root))
+		return;
+
+	log_debug("indexing %s", new_root);
+
+	/* referenced before the old one is released, in case it is the same */
+	new_index = gp_file_index_ref(geany_plugin, new_root);
+	file_index_cleanup();
+	shared_index = new_index;
+	subscription = gp_file_index_subscribe(shared_index, on_index_changed, NULL);
+}
+
+const gchar*
+file_index_get_root(void)
+{
+	return (shared_index != NULL) ? gp_file_index_get_root(shared_index) : NULL;
+}
+
+gboolean
+file_index_is_building(void)
+{
+	return shared_index != NULL && gp_file_index_is_building(shared_index);
+}
+
+guint
+file_index_get_size(void)
+{
+	return (shared_index != NULL) ? gp_file_index_get_size(shared_index) : 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Fill matches with the best max_matches files matching query.
+ * ---------------------------------------------------------------------
+ */
+guint
+file_index_query(const gchar* query, FileIndexMatch* matches, guint max_matches)
+{
+	if(shared_index == NULL)
+		return 0;
+
+	return gp_file_index_query(shared_index, query, matches, max_matches);
+}
+
+/* ---------------------------------------------------------------------
+ * The files whose basename without extension is stem.
+ * ---------------------------------------------------------------------
+ */
+GSList*
+file_index_find_by_stem(const gchar* stem)
+{
+	if(shared_index == NULL)
+		return NULL;
+
+	return gp_file_index_find_by_stem(shared_index, stem);
+}
+
+void
+file_index_set_changed_func(FileIndexChangedFunc func, gpointer user_data)
+{
+	changed_func = func;
+	changed_data = user_data;
+}
+
+/* ---------------------------------------------------------------------
+ * Cleanup
+ * ---------------------------------------------------------------------
+ */
+void
+file_index_cleanup(void)
+{
+	if(shared_index == NULL)
+		return;
+
+	gp_file_index_unsubscribe(shared_index, subscription);
+	gp_file_index_unref(shared_index);
+	shared_index = NULL;
+	subscription = 0;
+}
@@ -0,0 +1,69 @@
+/*
+ *      file_index.h - this file is part of "codenavigation", which is
+ *      part of the "geany-plugins" project.
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include "codenavigation.h"
+#include "fileindex.h"
+
+/* A file matching a query, path being relative to the root */
+typedef GpFileIndexMatch FileIndexMatch;
+
+/* Called when files were added to or removed from the index */
+typedef void (*FileIndexChangedFunc)(gpointer user_data);
+
+/* Index the files under root (UTF-8), in the background. Nothing is done if
+ * root is already the indexed directory. */
+void
+file_index_set_root(const gchar* root);
+
+/* The indexed directory (UTF-8), or NULL */
+const gchar*
+file_index_get_root(void);
+
+/* Whether the directories are still being walked */
+gboolean
+file_index_is_building(void);
+
+/* Number of files in the index */
+guint
+file_index_get_size(void);
+
+/* Fill matches with the best max_matches files matching query, best first.
+ * The paths are only valid until the index changes.
+ * Returns: the number of matches */
+guint
+file_index_query(const gchar* query, FileIndexMatch* matches, guint max_matches);
+
+/* The files whose basename up to its first dot is stem (UTF-8), as paths
+ * relative to the root. The paths are only valid until the index changes.
+ * Returns: a newly-allocated list of the paths */
+GSList*
+file_index_find_by_stem(const gchar* stem);
+
+void
+file_index_set_changed_func(FileIndexChangedFunc func, gpointer user_data);
+
+/* Cleanup */
+void
+file_index_cleanup(void);
+
+#endif /* FILE_INDEX_H */
@@ -26,11 +26,31 @@
 #include <geanyplugin.h>
 
 #include "goto_file.h"
+#include "file_index.h"
+#include "utils.h"
+
+#define MAX_MATCHES 100
 
 /******************* Global variables for the feature *****************/
 
 static GtkWidget* menu_item = NULL;
 
+/* Widgets of the dialog, while it is shown */
+static struct
+{
+	GtkWidget* entry;
+	GtkWidget* label;
+	GtkWidget* view;
+	GtkListStore* store;
+} dialog_widgets;
+
+/* Columns of the list of matches */
+enum
+{
+	COLUMN_PATH,
+	NB_COLUMNS
+};
+
 /********************** Functions for the feature *********************/
 
 /* ---------------------------------------------------------------------
@@ -82,6 +102,149 @@ goto_file_cleanup(void)
 	log_func();
 
 	gtk_widget_destroy(menu_item);
+	file_index_cleanup();
+}
+
+/* ---------------------------------------------------------------------
+ * Directory to search files into : the project base path, or the
+ * directory of the current document. Newly-allocated, UTF-8.
+ * ---------------------------------------------------------------------
+ */
+static gchar*
+get_search_root(void)
+{
+	GeanyDocument* doc;
+	gchar* path;
+
+	path = get_project_base_path();
+	if(path != NULL)
+		return path;
+
+	doc = document_get_current();
+	if(doc != NULL && doc->file_name != NULL && g_path_is_absolute(doc->file_name))
+		return g_path_get_dirname(doc->file_name);
+
+	return NULL;
+}
+
+/* ---------------------------------------------------------------------
+ * Fills the list with the files matching the text of the entry.
+ * ---------------------------------------------------------------------
+ */
+static void
+update_matches(void)
+{
+	FileIndexMatch matches[MAX_MATCHES];
+	GtkTreeIter iter;
+	guint n_matches;
+	guint i;
+	gchar* status;
+
+	n_matches = file_index_query(gtk_entry_get_text(GTK_ENTRY(dialog_widgets.entry)),
+								 matches, MAX_MATCHES);
+
+	/* fill the store while it is not attached to the view */
+	g_object_ref(dialog_widgets.store);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(dialog_widgets.view), NULL);
+	gtk_list_store_clear(dialog_widgets.store);
+	for(i = 0; i < n_matches; i++)
+		gtk_list_store_insert_with_values(dialog_widgets.store, &iter, i,
+										  COLUMN_PATH, matches[i].path, -1);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(dialog_widgets.view),
+							GTK_TREE_MODEL(dialog_widgets.store));
+	g_object_unref(dialog_widgets.store);
+
+	if(gtk_tree_model_get_iter_first(GTK_TREE_MODEL(dialog_widgets.store), &iter))
+		gtk_tree_selection_select_iter(
+			gtk_tree_view_get_selection(GTK_TREE_VIEW(dialog_widgets.view)), &iter);
+
+	if(file_index_is_building())
+		status = g_strdup_printf(_("Indexing... %u files"), file_index_get_size());
+	else
+		status = g_strdup_printf(_("%u files"), file_index_get_size());
+	gtk_label_set_text(GTK_LABEL(dialog_widgets.label), status);
+	g_free(status);
+}
+
+static void
+on_entry_changed(GtkEditable* editable, gpointer user_data)
+{
+	update_matches();
+}
+
+static void
+on_index_changed(gpointer user_data)
+{
+	update_matches();
+}
+
+/* ---------------------------------------------------------------------
+ * Up and down in the entry move the selection in the list.
+ * ---------------------------------------------------------------------
+ */
+static gboolean
+on_entry_key_press(GtkWidget* widget, GdkEventKey* event, gpointer user_data)
+{
+	GtkTreeSelection* selection;
+	GtkTreeModel* model;
+	GtkTreeIter iter;
+	GtkTreePath* path;
+
+	if(event->keyval != GDK_Up && event->keyval != GDK_Down)
+		return FALSE;
+
+	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(dialog_widgets.view));
+	if(! gtk_tree_selection_get_selected(selection, &model, &iter))
+		return TRUE;
+
+	path = gtk_tree_model_get_path(model, &iter);
+	if(event->keyval == GDK_Up)
+		gtk_tree_path_prev(path);
+	else
+		gtk_tree_path_next(path);
+	if(gtk_tree_model_get_iter(model, &iter, path))
+	{
+		gtk_tree_selection_select_iter(selection, &iter);
+		gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(dialog_widgets.view), path, NULL, FALSE, 0, 0);
+	}
+	gtk_tree_path_free(path);
+
+	return TRUE;
+}
+
+static void
+on_row_activated(GtkTreeView* view, GtkTreePath* path, GtkTreeViewColumn* column,
+				 gpointer dialog)
+{
+	gtk_dialog_response(GTK_DIALOG(dialog), GTK_RESPONSE_ACCEPT);
+}
+
+/* ---------------------------------------------------------------------
+ * Opens the file selected in the list.
+ * ---------------------------------------------------------------------
+ */
+static void
+open_selected_file(void)
+{
+	GtkTreeSelection* selection;
+	GtkTreeModel* model;
+	GtkTreeIter iter;
+	gchar* rel_path;
+	gchar* path;
+	gchar* locale_path;
+
+	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(dialog_widgets.view));
+	if(! gtk_tree_selection_get_selected(selection, &model, &iter))
+		return;
+
+	gtk_tree_model_get(model, &iter, COLUMN_PATH, &rel_path, -1);
+	path = g_build_filename(file_index_get_root(), rel_path, NULL);
+	locale_path = utils_get_locale_from_utf8(path);
+	document_open_file(locale_path, FALSE, NULL, NULL);
+
+	g_free(locale_path);
+	g_free(path);
+	g_free(rel_path);
 }
 
 /* ---------------------------------------------------------------------
@@ -91,23 +254,70 @@ goto_file_cleanup(void)
 static void
 menu_item_activate(guint key_id)
 {
-	GtkWidget *dialog;
+	GtkWidget* dialog;
+	GtkWidget* vbox;
+	GtkWidget* scrolled;
+	GtkCellRenderer* renderer;
+	gchar* search_root;
 
 	log_func();
 
-	/* TODO */
-	dialog = gtk_message_dialog_new(
+	search_root = get_search_root();
+	if(search_root == NULL)
+	{
+		ui_set_statusbar(FALSE, _("No project or saved document to find files from"));
+		return;
+	}
+	file_index_set_root(search_root);
+	g_free(search_root);
+
+	dialog = gtk_dialog_new_with_buttons(_("Goto file"),
 		GTK_WINDOW(geany->main_widgets->window),
-		GTK_DIALOG_DESTROY_WITH_PARENT,
-		GTK_MESSAGE_INFO,
-		GTK_BUTTONS_OK,
-		"Open by name : TODO");
+		GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+		GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+		GTK_STOCK_OPEN, GTK_RESPONSE_ACCEPT,
+		NULL);
+	gtk_dialog_set_default_response(GTK_DIALOG(dialog), GTK_RESPONSE_ACCEPT);
+	gtk_window_set_default_size(GTK_WINDOW(dialog), 500, 350);
+
+	vbox = ui_dialog_vbox_new(GTK_DIALOG(dialog));
+	gtk_box_set_spacing(GTK_BOX(vbox), 6);
+
+	dialog_widgets.entry = gtk_entry_new();
+	gtk_entry_set_activates_default(GTK_ENTRY(dialog_widgets.entry), TRUE);
+	gtk_box_pack_start(GTK_BOX(vbox), dialog_widgets.entry, FALSE, FALSE, 0);
+
+	dialog_widgets.store = gtk_list_store_new(NB_COLUMNS, G_TYPE_STRING);
+	dialog_widgets.view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(dialog_widgets.store));
+	g_object_unref(dialog_widgets.store);
+	gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(dialog_widgets.view), FALSE);
+	gtk_tree_view_set_enable_search(GTK_TREE_VIEW(dialog_widgets.view), FALSE);
+	renderer = gtk_cell_renderer_text_new();
+	gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(dialog_widgets.view), -1, NULL,
+		renderer, "text", COLUMN_PATH, NULL);
+
+	scrolled = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled),
+		GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(scrolled), GTK_SHADOW_IN);
+	gtk_container_add(GTK_CONTAINER(scrolled), dialog_widgets.view);
+	gtk_box_pack_start(GTK_BOX(vbox), scrolled, TRUE, TRUE, 0);
+
+	dialog_widgets.label = gtk_label_new(NULL);
+	gtk_misc_set_alignment(GTK_MISC(dialog_widgets.label), 0, 0.5);
+	gtk_box_pack_start(GTK_BOX(vbox), dialog_widgets.label, FALSE, FALSE, 0);
+
+	g_signal_connect(dialog_widgets.entry, "changed", G_CALLBACK(on_entry_changed), NULL);
+	g_signal_connect(dialog_widgets.entry, "key-press-event", G_CALLBACK(on_entry_key_press), NULL);
+	g_signal_connect(dialog_widgets.view, "row-activated", G_CALLBACK(on_row_activated), dialog);
+	file_index_set_changed_func(on_index_changed, NULL);
 
-	gtk_window_set_title(GTK_WINDOW(dialog), "Goto file...");
+	update_matches();
+	gtk_widget_show_all(dialog);
 
-	gtk_message_dialog_format_secondary_text(GTK_MESSAGE_DIALOG(dialog),
-		_("(From the %s plugin)"), geany_plugin->info->name);
+	if(gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT)
+		open_selected_file();
 
-	gtk_dialog_run(GTK_DIALOG(dialog));
+	file_index_set_changed_func(NULL, NULL);
 	gtk_widget_destroy(dialog);
 }
@@ -25,7 +25,10 @@
 #endif
 #include <geanyplugin.h>
 
+#include <string.h>
+
 #include "switch_head_impl.h"
+#include "file_index.h"
 #include "utils.h"
 
 /********************* Data types for the feature *********************/
@@ -199,6 +202,78 @@ fill_default_languages_list(void)
 #undef IMPL_PREPEND
 }
 
+/* ---------------------------------------------------------------------
+ * Looks for a counterpart of the file doc_path (UTF-8) in the project
+ * file index : one of the files named in filenames_to_test, preferably
+ * in the same directory, else in the closest one (e.g. include/ for
+ * src/).
+ * Returns: the newly-allocated path of the best one, or NULL.
+ * *searched is set when the index covers doc_path and is complete, so
+ * the file system doesn't need to be searched.
+ * ---------------------------------------------------------------------
+ */
+static gchar*
+find_in_file_index(const gchar* doc_path, GSList* filenames_to_test, gboolean* searched)
+{
+	const gchar* root = file_index_get_root();
+	const gchar* doc_rel_path;
+	const gchar* best = NULL;
+	gsize best_common = 0;
+	GSList* paths;
+	GSList* iter;
+	gchar* stem;
+	gchar* basename;
+
+	*searched = FALSE;
+
+	/* the file must be under the indexed directory */
+	if(root == NULL || ! g_str_has_prefix(doc_path, root))
+		return NULL;
+	doc_rel_path = doc_path + strlen(root);
+	if(*doc_rel_path != G_DIR_SEPARATOR)
+		return NULL;
+	doc_rel_path++;
+
+	*searched = ! file_index_is_building();
+
+	basename = g_path_get_basename(doc_path);
+	stem = copy_and_remove_extension(basename);
+	paths = file_index_find_by_stem(stem);
+	for(iter = paths; iter != NULL; iter = iter->next)
+	{
+		const gchar* path = iter->data;
+		const gchar* name = strrchr(path, G_DIR_SEPARATOR);
+		gsize common = 0;
+		gsize i;
+
+		name = (name != NULL) ? name + 1 : path;
+		if(g_slist_find_custom(filenames_to_test, name, (GCompareFunc)(&compare_strings)) == NULL)
+			continue;
+
+		/* length of the directories in common with the document */
+		for(i = 0; path[i] != '\0' && path[i] == doc_rel_path[i]; i++)
+		{
+			if(path[i] == G_DIR_SEPARATOR)
+				common = i + 1;
+		}
+		/* same directory */
+		if(path + common == name && doc_rel_path[common] != '\0' &&
+		   strchr(doc_rel_path + common, G_DIR_SEPARATOR) == NULL)
+			common = G_MAXSIZE;
+
+		if(best == NULL || common > best_common)
+		{
+			best = path;
+			best_common = common;
+		}
+	}
+	g_slist_free(paths);
+	g_free(stem);
+	g_free(basename);
+
+	return (best != NULL) ? g_build_filename(root, best, NULL) : NULL;
+}
+
 /* ---------------------------------------------------------------------
  *  Callback when the menu item is clicked.
  * ---------------------------------------------------------------------
@@ -227,6 +302,7 @@ menu_item_activate(guint key_id)
 
 	gchar* p_str = NULL;	/* Local variables, used as temporary buffers */
 	gchar* p_str2 = NULL;
+	gboolean searched = FALSE;
 
 	if(current_doc != NULL && current_doc->file_name != NULL && current_doc->file_name[0] != '\0')
 	{
@@ -325,9 +401,29 @@ menu_item_activate(guint key_id)
 			}
 		}
 
-		/* Second : if not found, look for a corresponding file in the same directory.
+		/* Second : if not found, look for a corresponding file in the project file index.
 		 * If found, open it.
 		 */
+		p_str = find_in_file_index(current_doc->file_name, filenames_to_test, &searched);
+		if(p_str != NULL)
+		{
+			log_debug("found in the file index : \"%s\"", p_str);
+
+			p_str2 = utils_get_locale_from_utf8(p_str);
+			g_free(p_str);
+			if(	document_open_file(p_str2, FALSE, NULL, NULL) != NULL ||
+				document_open_file(p_str2, TRUE, NULL, NULL) != NULL)
+			{
+				g_free(p_str2);
+				goto free_mem;
+			}
+			g_free(p_str2);
+			searched = FALSE;
+		}
+
+		/* Third : if not found, look for a corresponding file in the same directory.
+		 * If found, open it. Not needed when the whole index was searched.
+		 */
 		/* -> compute dirname */
 		dirname = g_path_get_dirname(current_doc->real_path);
 		if(dirname == NULL)
@@ -336,7 +432,7 @@ menu_item_activate(guint key_id)
 		log_debug("dirname == \"%s\"", dirname);
 
 		/* -> try all the extensions we should test */
-		for(iter_ext = p_extensions_to_test ; iter_ext != NULL ; iter_ext = iter_ext->next)
+		for(iter_ext = p_extensions_to_test ; iter_ext != NULL && ! searched ; iter_ext = iter_ext->next)
 		{
 			p_str = g_strdup_printf(	"%s" G_DIR_SEPARATOR_S "%s.%s",
 										dirname, basename_no_extension, (const gchar*)(iter_ext->data));
@@ -356,7 +452,7 @@ menu_item_activate(guint key_id)
 			g_free(p_str2);
 		}
 
-		/* Third : if not found, ask the user if he wants to create it or not. */
+		/* Fourth : if not found, ask the user if he wants to create it or not. */
 		{
 			GtkWidget* dialog;
 
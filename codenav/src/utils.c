@@ -73,6 +73,44 @@ copy_and_remove_extension(gchar* path)
 	return str;
 }
 
+/* Newly-allocated absolute base path (UTF-8) of the open project, or NULL
+ */
+gchar*
+get_project_base_path(void)
+{
+	GeanyProject* project = geany->app->project;
+	GFile* file;
+	gchar* path;
+	gchar* locale_path;
+
+	if(project == NULL || project->base_path == NULL || project->base_path[0] == '\0')
+		return NULL;
+
+	if(g_path_is_absolute(project->base_path))
+		path = g_strdup(project->base_path);
+	else
+	{
+		/* relative to the project file */
+		gchar* dir = g_path_get_dirname(project->file_name);
+
+		path = g_build_filename(dir, project->base_path, NULL);
+		g_free(dir);
+	}
+
+	/* remove the "." and ".." parts and the trailing separator, so the
+	 * path can be compared with the paths of the documents */
+	locale_path = utils_get_locale_from_utf8(path);
+	g_free(path);
+	file = g_file_new_for_path(locale_path);
+	g_free(locale_path);
+	locale_path = g_file_get_path(file);
+	g_object_unref(file);
+	path = utils_get_utf8_from_locale(locale_path);
+	g_free(locale_path);
+
+	return path;
+}
+
 /* Comparison of strings, for use with g_slist_find_custom */
 gint
 compare_strings(const gchar* a, const gchar* b)
@@ -40,4 +40,9 @@ copy_and_remove_extension(gchar* path);
 gint
 compare_strings(const gchar* a, const gchar* b);
 
+/* Newly-allocated absolute base path (UTF-8) of the open project, or NULL
+ */
+gchar*
+get_project_base_path(void);
+
 #endif /* UTILS_H */
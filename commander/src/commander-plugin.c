@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 #include <glib.h>
 #include <glib/gi18n-lib.h>
@@ -27,6 +28,9 @@
 
 #include <geanyplugin.h>
 
+#include "fileindex.h"
+#include "idlesched.h"
+
 
 GeanyPlugin      *geany_plugin;
 GeanyData        *geany_data;
@@ -79,20 +83,112 @@ enum {
   KB_COUNT
 };
 
+/* a row of the store or a project file, with what is needed to score it */
+typedef struct {
+  GtkTreeIter iter;   /* in plugin_data.store, unset for project files */
+  gchar      *path;   /* UTF-8 path of a project file, NULL for store rows */
+  gchar      *key;    /* casefolded path */
+  guint64     mask;   /* characters of key, see char_bit() */
+  gint        type;
+} StoreRow;
+
+/* a row matching the key */
+typedef struct {
+  StoreRow   *row;
+  guint       position; /* in the scored rows, to keep ties stable */
+  gint        score;
+} RowMatch;
+
 struct {
   GtkWidget    *panel;
   GtkWidget    *entry;
   GtkWidget    *view;
   GtkListStore *store;
-  GtkTreeModel *sort;
+  GtkListStore *results;
+  
+  GPtrArray    *rows;
+  /* rows matching last_key, whatever their rank */
+  GPtrArray    *candidates;
+  gchar        *last_key;
+  gint          last_type;
   
   GtkTreePath  *last_path;
 } plugin_data = {
   NULL, NULL, NULL,
   NULL, NULL,
+  NULL, NULL, NULL, 0,
   NULL
 };
 
+/* maximum number of rows shown in the panel */
+#define MAX_RESULTS 200
+
+/* large sets of rows are scored in chunks by worker threads, see refilter() */
+#define SCORE_CHUNK_ROWS    16384
+#define SCORE_THREADED_ROWS (2 * SCORE_CHUNK_ROWS)
+/* rows scored between checks for a newer key */
+#define SCORE_CHECK_ROWS    1024
+
+typedef struct ScoreQuery ScoreQuery;
+
+typedef struct {
+  ScoreQuery   *query;
+  guint         begin;
+  guint         end;
+  GPtrArray    *candidates; /* rows of the chunk matching the key */
+  GArray       *matches;    /* RowMatch, the best MAX_RESULTS of the chunk */
+} ScoreChunk;
+
+struct ScoreQuery {
+  gchar        *key;
+  gint          type;
+  GPtrArray    *source;     /* plugin_data.rows or plugin_data.candidates */
+  volatile gint cancelled;
+  ScoreChunk   *chunks;
+  guint         n_chunks;
+  guint         n_pending;  /* chunks not done yet */
+};
+
+/* the rows a worker thread reads must not be freed before it notices its
+ * query was cancelled, see score_wait() */
+struct {
+  ScoreQuery   *current;
+  GMutex       *lock;       /* protects n_busy, kept once created */
+  GCond        *idle;
+  gint          n_busy;     /* chunks being scored */
+} score_data = {
+  NULL, NULL, NULL, 0
+};
+
+/* what the menu items of a menu shell were read from */
+typedef struct {
+  gchar      *parent_path;  /* path of the menu item owning the shell, or NULL */
+  GPtrArray  *rows;         /* GtkTreeIter in plugin_data.store */
+  GSList     *submenus;     /* GtkMenuShell of the items */
+} MenuShellData;
+
+/* the store is filled the first time the panel is shown, then updated as
+ * the menus and documents change */
+struct {
+  gboolean      filled;
+  GtkWidget    *menubar;
+  GHashTable   *shells;     /* GtkMenuShell -> MenuShellData */
+  GSList       *dirty;      /* GtkMenuShell that changed since they were read */
+  GHashTable   *documents;  /* GeanyDocument -> GtkTreeIter */
+} store_data = {
+  FALSE, NULL, NULL, NULL, NULL
+};
+
+struct {
+  GpFileIndex  *index;
+  gulong        subscription;
+  GSList       *patterns;     /* GPatternSpec of the project's file patterns */
+  guint         generation;   /* of the index when the files were read */
+  GPtrArray    *files;        /* StoreRow */
+} project_data = {
+  NULL, 0, NULL, 0, NULL
+};
+
 typedef enum {
   COL_TYPE_MENU_ITEM  = 1 << 0,
   COL_TYPE_FILE       = 1 << 1,
@@ -116,48 +212,117 @@ enum {
 /* TODO: be more tolerant regarding unmatched character in the needle.
  * Right now, we implicitly accept unmatched characters at the end of the
  * needle but absolutely not at the start.  e.g. "xpy" won't match "python" at
- * all, though "pyx" will. */
-static inline gint
+ * all, though "pyx" will.
+ * 
+ * The score is computed bottom-up, which gives the same result as the naive
+ * recursion:
+ * 
+ *   score(n, h) = score(n, h + 1)                  if *h is a separator
+ *               = score(n + 1, next_sep(h))        if *n is a separator
+ *               = MAX(score(n + 1, h + 1) + 1,
+ *                     score(n, next_sep(h)))       if *n == *h
+ *               = score(n, next_sep(h))            otherwise
+ * 
+ * but in O(strlen(needle) * strlen(haystack)) instead of exponential time.
+ * The haystack is walked backwards keeping only the column for the next
+ * position and the one for the next separator, each one score per
+ * position in the needle. */
+static gint
 get_score (const gchar *needle,
            const gchar *haystack)
 {
+  gint    stack_cols[3 * 64];
+  gsize   n;
+  gsize   i;
+  gsize   j;
+  gint   *cols;
+  gint   *next;
+  gint   *cur;
+  gint   *sep;
+  gint    score;
+  
   if (needle == NULL || haystack == NULL ||
       *needle == '\0' || *haystack == '\0') {
     return 0;
   }
   
-  if (IS_SEPARATOR (*haystack)) {
-    return get_score (needle, haystack + 1);
+  n = strlen (needle);
+  /* next/cur: columns for haystack positions j + 1 and j.  sep: column for
+   * the first separator after j, all zeros if there is none */
+  if (3 * (n + 1) <= G_N_ELEMENTS (stack_cols)) {
+    cols = stack_cols;
+    memset (cols, 0, 3 * (n + 1) * sizeof *cols);
+  } else {
+    cols = g_new0 (gint, 3 * (n + 1));
   }
-
-  if (IS_SEPARATOR (*needle)) {
-    return get_score (needle + 1, next_separator (haystack));
+  next = cols;
+  cur  = cols + (n + 1);
+  sep  = cols + 2 * (n + 1);
+  
+  for (j = strlen (haystack); j-- > 0; ) {
+    if (IS_SEPARATOR (haystack[j])) {
+      /* the column is the same as the next one, and the separator column
+       * for the previous positions */
+      memcpy (sep, next, (n + 1) * sizeof *sep);
+      continue;
+    }
+    
+    cur[n] = 0;
+    for (i = n; i-- > 0; ) {
+      if (IS_SEPARATOR (needle[i])) {
+        cur[i] = sep[i + 1];
+      } else if (needle[i] == haystack[j]) {
+        cur[i] = MAX (next[i + 1] + 1, sep[i]);
+      } else {
+        cur[i] = sep[i];
+      }
+    }
+    
+    {
+      gint *tmp = next;
+      
+      next = cur;
+      cur = tmp;
+    }
+  }
+  
+  score = next[0];
+  if (cols != stack_cols) {
+    g_free (cols);
   }
+  
+  return score;
+}
 
-  if (*needle == *haystack) {
-    gint a = get_score (needle + 1, haystack + 1) + 1;
-    gint b = get_score (needle, next_separator (haystack));
-    
-    return MAX (a, b);
+/* maps a character to one of 64 bits, so that a row can be skipped when it
+ * lacks a character of the key.  letters and digits get their own bit */
+static inline guint64
+char_bit (gchar c)
+{
+  guchar  u = (guchar) c;
+  guint   n;
+  
+  if (u >= 'a' && u <= 'z') {
+    n = u - 'a';
+  } else if (u >= '0' && u <= '9') {
+    n = 26 + (u - '0');
   } else {
-    return get_score (needle, next_separator (haystack));
+    n = 36 + u % 28;
   }
+  
+  return G_GUINT64_CONSTANT (1) << n;
 }
 
-static gint
-key_score (const gchar *key_,
-           const gchar *text_)
+static guint64
+key_mask (const gchar *key)
 {
-  gchar  *text  = g_utf8_casefold (text_, -1);
-  gchar  *key   = g_utf8_casefold (key_, -1);
-  gint    score;
+  guint64 mask = 0;
   
-  score = get_score (key, text);
-  
-  g_free (text);
-  g_free (key);
+  for (; *key; key++) {
+    mask |= char_bit (*key);
+  }
   
-  return score;
+  return mask;
 }
 
 static const gchar *
@@ -263,21 +428,140 @@ tree_view_activate_focused_row (GtkTreeView *view)
   }
 }
 
+static void store_mark_dirty (GtkMenuShell *shell);
+
+static void
+on_menu_shell_changed (GtkMenuShell *shell,
+                       GtkWidget    *child,
+                       gpointer      dummy)
+{
+  store_mark_dirty (shell);
+}
+
+static void
+on_menu_shell_insert (GtkMenuShell *shell,
+                      GtkWidget    *child,
+                      gint          position,
+                      gpointer      dummy)
+{
+  store_mark_dirty (shell);
+}
+
+static void
+on_menu_item_notify (GObject    *item,
+                     GParamSpec *pspec,
+                     gpointer    shell)
+{
+  if (strcmp (pspec->name, "visible") == 0 ||
+      strcmp (pspec->name, "label") == 0 ||
+      strcmp (pspec->name, "use-underline") == 0 ||
+      strcmp (pspec->name, "submenu") == 0) {
+    store_mark_dirty (shell);
+  }
+}
+
+static void store_forget_menu_items (GtkListStore *store,
+                                     GtkMenuShell *menu,
+                                     gboolean      alive);
+
+static void
+on_menu_shell_destroy (GtkWidget *shell,
+                       gpointer   dummy)
+{
+  store_forget_menu_items (plugin_data.store, GTK_MENU_SHELL (shell), FALSE);
+}
+
+static void
+menu_shell_data_free (MenuShellData *data)
+{
+  guint i;
+  
+  for (i = 0; i < data->rows->len; i++) {
+    g_slice_free (GtkTreeIter, g_ptr_array_index (data->rows, i));
+  }
+  g_ptr_array_free (data->rows, TRUE);
+  g_slist_free (data->submenus);
+  g_free (data->parent_path);
+  g_slice_free (MenuShellData, data);
+}
+
+/* removes the rows of @menu and its submenus.  if @alive is FALSE, @menu is
+ * being destroyed and its signals are left alone */
+static void
+store_forget_menu_items (GtkListStore *store,
+                         GtkMenuShell *menu,
+                         gboolean      alive)
+{
+  MenuShellData  *data;
+  GSList         *node;
+  guint           i;
+  
+  data = store_data.shells ? g_hash_table_lookup (store_data.shells, menu) : NULL;
+  if (! data) {
+    return;
+  }
+  
+  for (i = 0; i < data->rows->len; i++) {
+    gtk_list_store_remove (store, g_ptr_array_index (data->rows, i));
+  }
+  /* a destroyed submenu already removed itself */
+  for (node = data->submenus; node; node = node->next) {
+    store_forget_menu_items (store, node->data, alive);
+  }
+  
+  if (alive) {
+    GList *children = gtk_container_get_children (GTK_CONTAINER (menu));
+    GList *child;
+    
+    g_signal_handlers_disconnect_by_func (menu, on_menu_shell_changed, NULL);
+    g_signal_handlers_disconnect_by_func (menu, on_menu_shell_insert, NULL);
+    g_signal_handlers_disconnect_by_func (menu, on_menu_shell_destroy, NULL);
+    for (child = children; child; child = child->next) {
+      g_signal_handlers_disconnect_by_func (child->data, on_menu_item_notify, menu);
+    }
+    g_list_free (children);
+  }
+  
+  store_data.dirty = g_slist_remove (store_data.dirty, menu);
+  g_hash_table_remove (store_data.shells, menu);
+}
+
 static void
 store_populate_menu_items (GtkListStore  *store,
                            GtkMenuShell  *menu,
                            const gchar   *parent_path)
 {
-  GList  *children;
-  GList  *node;
+  GList          *children;
+  GList          *node;
+  MenuShellData  *data = g_slice_new (MenuShellData);
+  
+  data->parent_path = g_strdup (parent_path);
+  data->rows = g_ptr_array_new ();
+  data->submenus = NULL;
+  g_hash_table_insert (store_data.shells, menu, data);
+  
+  /* watch the changes so only this shell is read again */
+  g_signal_connect (menu, "add", G_CALLBACK (on_menu_shell_changed), NULL);
+  g_signal_connect (menu, "remove", G_CALLBACK (on_menu_shell_changed), NULL);
+  /* GtkMenuShell::insert only appeared in GTK 3.2 */
+  if (g_signal_lookup ("insert", GTK_TYPE_MENU_SHELL)) {
+    g_signal_connect (menu, "insert", G_CALLBACK (on_menu_shell_insert), NULL);
+  }
+  g_signal_connect (menu, "destroy", G_CALLBACK (on_menu_shell_destroy), NULL);
   
   children = gtk_container_get_children (GTK_CONTAINER (menu));
   for (node = children; node; node = node->next) {
+    if (GTK_IS_MENU_ITEM (node->data)) {
+      /* hidden items too, they might be shown later */
+      g_signal_connect (node->data, "notify", G_CALLBACK (on_menu_item_notify), menu);
+    }
+    
     if (GTK_IS_SEPARATOR_MENU_ITEM (node->data) ||
         ! gtk_widget_get_visible (node->data)) {
       /* skip that */
     } else if (GTK_IS_MENU_ITEM (node->data)) {
       GtkWidget    *submenu;
+      GtkTreeIter   iter;
       gchar        *path;
       gchar        *item_label;
       gboolean      use_underline;
@@ -315,6 +599,7 @@ store_populate_menu_items (GtkListStore  *store,
       submenu = gtk_menu_item_get_submenu (node->data);
       if (submenu) {
         /* go deeper in the menus... */
+        data->submenus = g_slist_prepend (data->submenus, submenu);
         store_populate_menu_items (store, GTK_MENU_SHELL (submenu), path);
       } else {
         gchar *tmp;
@@ -331,12 +616,13 @@ store_populate_menu_items (GtkListStore  *store,
         SETPTR (label, g_strconcat (label, "\n<small><i>", tmp, "</i></small>", NULL));
         g_free (tmp);
         
-        gtk_list_store_insert_with_values (store, NULL, -1,
+        gtk_list_store_insert_with_values (store, &iter, -1,
                                            COL_LABEL, label,
                                            COL_PATH, path,
                                            COL_TYPE, COL_TYPE_MENU_ITEM,
                                            COL_WIDGET, node->data,
                                            -1);
+        g_ptr_array_add (data->rows, g_slice_dup (GtkTreeIter, &iter));
         
         g_free (label);
       }
@@ -371,67 +657,799 @@ find_menubar (GtkContainer *container)
   return menubar;
 }
 
+static void
+store_add_document (GtkListStore  *store,
+                    GeanyDocument *doc)
+{
+  GtkTreeIter  iter;
+  gchar       *basename = g_path_get_basename (DOC_FILENAME (doc));
+  gchar       *label = g_markup_printf_escaped ("<big>%s</big>\n"
+                                                "<small><i>%s</i></small>",
+                                                basename,
+                                                DOC_FILENAME (doc));
+  
+  gtk_list_store_insert_with_values (store, &iter, -1,
+                                     COL_LABEL, label,
+                                     COL_PATH, DOC_FILENAME (doc),
+                                     COL_TYPE, COL_TYPE_FILE,
+                                     COL_DOCUMENT, doc,
+                                     -1);
+  g_hash_table_insert (store_data.documents, doc, g_slice_dup (GtkTreeIter, &iter));
+  g_free (basename);
+  g_free (label);
+}
+
+static void
+store_remove_document (GtkListStore  *store,
+                       GeanyDocument *doc)
+{
+  GtkTreeIter *iter = g_hash_table_lookup (store_data.documents, doc);
+  
+  if (iter) {
+    gtk_list_store_remove (store, iter);
+    g_hash_table_remove (store_data.documents, doc);
+  }
+}
+
+static void
+iter_free (gpointer iter)
+{
+  g_slice_free (GtkTreeIter, iter);
+}
+
 static void
 fill_store (GtkListStore *store)
 {
-  GtkWidget  *menubar;
-  guint       i;
+  guint i;
+  
+  store_data.shells = g_hash_table_new_full (NULL, NULL, NULL,
+                                             (GDestroyNotify) menu_shell_data_free);
+  store_data.documents = g_hash_table_new_full (NULL, NULL, NULL, iter_free);
   
   /* menu items */
-  menubar = find_menubar (GTK_CONTAINER (geany_data->main_widgets->window));
-  store_populate_menu_items (store, GTK_MENU_SHELL (menubar), NULL);
+  store_data.menubar = find_menubar (GTK_CONTAINER (geany_data->main_widgets->window));
+  store_populate_menu_items (store, GTK_MENU_SHELL (store_data.menubar), NULL);
   
   /* open files */
   foreach_document (i) {
-    gchar *basename = g_path_get_basename (DOC_FILENAME (documents[i]));
+    store_add_document (store, documents[i]);
+  }
+  
+  store_data.filled = TRUE;
+}
+
+/* reads the menu shells that changed again */
+static gboolean
+store_refresh (GtkListStore *store)
+{
+  gboolean changed = store_data.dirty != NULL;
+  
+  while (store_data.dirty) {
+    GtkMenuShell   *shell = store_data.dirty->data;
+    MenuShellData  *data = g_hash_table_lookup (store_data.shells, shell);
+    gchar          *parent_path = g_strdup (data->parent_path);
+    
+    store_forget_menu_items (store, shell, TRUE);
+    store_populate_menu_items (store, shell, parent_path);
+    g_free (parent_path);
+  }
+  
+  return changed;
+}
+
+static void
+store_clear (GtkListStore *store)
+{
+  if (! store_data.filled) {
+    return;
+  }
+  
+  store_forget_menu_items (store, GTK_MENU_SHELL (store_data.menubar), TRUE);
+  g_hash_table_destroy (store_data.shells);
+  store_data.shells = NULL;
+  g_hash_table_destroy (store_data.documents);
+  store_data.documents = NULL;
+  g_slist_free (store_data.dirty);
+  store_data.dirty = NULL;
+  gtk_list_store_clear (store);
+  store_data.filled = FALSE;
+}
+
+/* forgets the query being scored, its results will be ignored */
+static void
+score_cancel (void)
+{
+  if (score_data.current) {
+    g_atomic_int_set (&score_data.current->cancelled, TRUE);
+    score_data.current = NULL;
+  }
+}
+
+/* waits for the worker threads to be done reading the rows of the cancelled
+ * queries, which they check often */
+static void
+score_wait (void)
+{
+  if (score_data.lock) {
+    g_mutex_lock (score_data.lock);
+    while (score_data.n_busy > 0) {
+      g_cond_wait (score_data.idle, score_data.lock);
+    }
+    g_mutex_unlock (score_data.lock);
+  }
+}
+
+static void
+rows_clear (void)
+{
+  score_cancel ();
+  score_wait ();
+  
+  if (plugin_data.rows) {
+    guint i;
+    
+    for (i = 0; i < plugin_data.rows->len; i++) {
+      StoreRow *row = g_ptr_array_index (plugin_data.rows, i);
+      
+      /* project files belong to project_data */
+      if (! row->path) {
+        g_free (row->key);
+        g_slice_free (StoreRow, row);
+      }
+    }
+    g_ptr_array_free (plugin_data.rows, TRUE);
+    plugin_data.rows = NULL;
+  }
+  if (plugin_data.candidates) {
+    g_ptr_array_free (plugin_data.candidates, TRUE);
+    plugin_data.candidates = NULL;
+  }
+  g_free (plugin_data.last_key);
+  plugin_data.last_key = NULL;
+}
+
+/* reads the rows of @model, which is expected not to change until the
+ * next call to rows_clear(), followed by the project files that are not
+ * open */
+static void
+rows_build (GtkTreeModel *model)
+{
+  GtkTreeIter iter;
+  guint       i;
+  
+  rows_clear ();
+  plugin_data.rows = g_ptr_array_new ();
+  
+  if (gtk_tree_model_get_iter_first (model, &iter)) {
+    do {
+      StoreRow *row = g_slice_new (StoreRow);
+      gchar    *path;
+      
+      gtk_tree_model_get (model, &iter, COL_PATH, &path, COL_TYPE, &row->type, -1);
+      row->iter   = iter;
+      row->path   = NULL;
+      row->key    = g_utf8_casefold (path, -1);
+      row->mask   = key_mask (row->key);
+      g_ptr_array_add (plugin_data.rows, row);
+      g_free (path);
+    } while (gtk_tree_model_iter_next (model, &iter));
+  }
+  
+  if (project_data.files) {
+    GHashTable *open_files = g_hash_table_new (g_str_hash, g_str_equal);
+    
+    foreach_document (i) {
+      g_hash_table_insert (open_files, DOC_FILENAME (documents[i]), documents[i]);
+    }
+    
+    for (i = 0; i < project_data.files->len; i++) {
+      StoreRow *row = g_ptr_array_index (project_data.files, i);
+      
+      if (! g_hash_table_lookup (open_files, row->path)) {
+        g_ptr_array_add (plugin_data.rows, row);
+      }
+    }
+    g_hash_table_destroy (open_files);
+  }
+}
+
+/* whether @key has anything to match.  a key made only of separators
+ * matches nothing, and adding characters to it can make it match */
+static gboolean
+key_is_selective (const gchar *key)
+{
+  for (; *key; key++) {
+    if (! IS_SEPARATOR (*key)) {
+      return TRUE;
+    }
+  }
+  
+  return FALSE;
+}
+
+/* better matches first */
+static gint
+match_compare (const RowMatch *a,
+               const RowMatch *b)
+{
+  if (a->score != b->score) {
+    return b->score - a->score;
+  }
+  
+  return (gint) a->position - (gint) b->position;
+}
+
+static gint
+match_compare_cb (gconstpointer a,
+                  gconstpointer b)
+{
+  return match_compare (a, b);
+}
+
+/* moves the @k best matches of @matches to its start, in no particular
+ * order (quickselect) */
+static void
+matches_select_best (GArray *matches,
+                     guint   k)
+{
+  RowMatch *v     = (RowMatch *) matches->data;
+  gint      left  = 0;
+  gint      right = (gint) matches->len - 1;
+  
+  while (left < right) {
+    RowMatch  pivot = v[left + (right - left) / 2];
+    gint      i     = left;
+    gint      j     = right;
+    
+    while (i <= j) {
+      while (match_compare (&v[i], &pivot) < 0) {
+        i++;
+      }
+      while (match_compare (&v[j], &pivot) > 0) {
+        j--;
+      }
+      if (i <= j) {
+        RowMatch tmp = v[i];
+        
+        v[i++] = v[j];
+        v[j--] = tmp;
+      }
+    }
+    /* now v[left..j] <= pivot <= v[i..right] */
+    if ((gint) k <= j) {
+      right = j;
+    } else if ((gint) k >= i) {
+      left = i;
+    } else {
+      break;
+    }
+  }
+}
+
+static void
+matches_add (GArray    *matches,
+             StoreRow  *row,
+             guint      position,
+             gint       score)
+{
+  RowMatch match;
+  
+  match.row       = row;
+  match.position  = position;
+  match.score     = score;
+  g_array_append_val (matches, match);
+}
+
+/* adds @row to the results */
+static void
+results_append (StoreRow *row)
+{
+  if (row->path) {
+    gchar *basename = g_path_get_basename (row->path);
     gchar *label = g_markup_printf_escaped ("<big>%s</big>\n"
                                             "<small><i>%s</i></small>",
-                                            basename,
-                                            DOC_FILENAME (documents[i]));
+                                            basename, row->path);
     
-    gtk_list_store_insert_with_values (store, NULL, -1,
+    gtk_list_store_insert_with_values (plugin_data.results, NULL, -1,
                                        COL_LABEL, label,
-                                       COL_PATH, DOC_FILENAME (documents[i]),
+                                       COL_PATH, row->path,
                                        COL_TYPE, COL_TYPE_FILE,
-                                       COL_DOCUMENT, documents[i],
                                        -1);
     g_free (basename);
     g_free (label);
+  } else {
+    GtkTreeModel *model = GTK_TREE_MODEL (plugin_data.store);
+    GtkTreeIter   iter;
+    gint          col;
+    
+    gtk_list_store_append (plugin_data.results, &iter);
+    for (col = 0; col < COL_COUNT; col++) {
+      GValue value = { 0 };
+      
+      gtk_tree_model_get_value (model, &row->iter, col, &value);
+      gtk_list_store_set_value (plugin_data.results, &iter, col, &value);
+      g_value_unset (&value);
+    }
   }
 }
 
-static gint
-sort_func (GtkTreeModel  *model,
-           GtkTreeIter   *a,
-           GtkTreeIter   *b,
-           gpointer       dummy)
-{
-  gint          scorea;
-  gint          scoreb;
-  gchar        *patha;
-  gchar        *pathb;
-  gint          typea;
-  gint          typeb;
+/* scores the rows of @source from @begin to @end against @key, adding the
+ * ones that can match to @candidates and the best MAX_RESULTS of them to
+ * @matches.  only reads the rows, so it can run in a worker thread, and
+ * stops early once @cancelled is set.
+ * 
+ * a row can only match if it contains the first character of the key, and
+ * its score is at most the number of characters of the key it contains.
+ * once enough rows are found, rows that can't beat them aren't scored, but
+ * are kept as candidates for the next key. */
+static void
+score_range (GPtrArray      *source,
+             guint           begin,
+             guint           end,
+             const gchar    *key,
+             gint            type,
+             volatile gint  *cancelled,
+             GPtrArray      *candidates,
+             GArray         *matches)
+{
+  gboolean      selective = key_is_selective (key);
+  const gchar  *p;
+  guint64      *key_bits;
+  guint         n_key_bits = 0;
+  guint        *counts;
+  gint          threshold = 1;
+  guint         n_above = 0;
+  guint         i;
+  guint         j;
+  
+  key_bits = g_new (guint64, strlen (key) + 1);
+  for (p = key; *p; p++) {
+    if (! IS_SEPARATOR (*p)) {
+      key_bits[n_key_bits++] = char_bit (*p);
+    }
+  }
+  /* number of scored rows per score */
+  counts = g_new0 (guint, n_key_bits + 1);
+  
+  for (i = begin; i < end; i++) {
+    StoreRow *row = g_ptr_array_index (source, i);
+    gint      score;
+    
+    if (cancelled && (i - begin) % SCORE_CHECK_ROWS == 0 &&
+        g_atomic_int_get (cancelled)) {
+      break;
+    }
+    if (! (row->type & type)) {
+      continue;
+    }
+    if (! selective) {
+      g_ptr_array_add (candidates, row);
+      if (matches->len < MAX_RESULTS) {
+        matches_add (matches, row, i, 0);
+      }
+      continue;
+    }
+    if (! (row->mask & key_bits[0])) {
+      continue;
+    }
+    
+    /* the rows come by index, so when it can at best tie with the rows
+     * already found it comes after all of them */
+    if (n_above >= MAX_RESULTS) {
+      gint bound = 0;
+      
+      for (j = 0; j < n_key_bits; j++) {
+        if (row->mask & key_bits[j]) {
+          bound++;
+        }
+      }
+      if (bound <= threshold) {
+        g_ptr_array_add (candidates, row);
+        continue;
+      }
+    }
+    
+    score = get_score (key, row->key);
+    if (score > 0) {
+      g_ptr_array_add (candidates, row);
+      matches_add (matches, row, i, score);
+      counts[score]++;
+      /* keep threshold the highest score reached by MAX_RESULTS rows */
+      if (score >= threshold) {
+        n_above++;
+        while (n_above - counts[threshold] >= MAX_RESULTS) {
+          n_above -= counts[threshold];
+          threshold++;
+        }
+      }
+    }
+  }
+  g_free (key_bits);
+  g_free (counts);
+  
+  /* the others can't be shown */
+  if (matches->len > MAX_RESULTS) {
+    matches_select_best (matches, MAX_RESULTS);
+    g_array_set_size (matches, MAX_RESULTS);
+  }
+}
+
+/* shows the best of @matches, and remembers @candidates for the next key.
+ * takes ownership of @key, @candidates and @matches */
+static void
+refilter_show (gchar     *key,
+               gint       type,
+               GPtrArray *candidates,
+               GArray    *matches)
+{
+  GtkTreeView  *view = GTK_TREE_VIEW (plugin_data.view);
+  GtkTreeIter   iter;
+  guint         n_results;
+  guint         i;
+  
+  if (plugin_data.candidates) {
+    /* a cancelled query might still be reading them */
+    score_wait ();
+    g_ptr_array_free (plugin_data.candidates, TRUE);
+  }
+  plugin_data.candidates = candidates;
+  g_free (plugin_data.last_key);
+  plugin_data.last_key = key;
+  plugin_data.last_type = type;
+  
+  /* only sort the rows that will be shown */
+  n_results = MIN (matches->len, MAX_RESULTS);
+  if (n_results < matches->len) {
+    matches_select_best (matches, n_results);
+  }
+  qsort (matches->data, n_results, sizeof (RowMatch), match_compare_cb);
+  
+  gtk_list_store_clear (plugin_data.results);
+  for (i = 0; i < n_results; i++) {
+    results_append (g_array_index (matches, RowMatch, i).row);
+  }
+  g_array_free (matches, TRUE);
+  
+  if (gtk_tree_model_get_iter_first (GTK_TREE_MODEL (plugin_data.results), &iter)) {
+    tree_view_set_cursor_from_iter (view, &iter);
+  }
+}
+
+/* runs in a worker thread */
+static void
+score_chunk_work (gpointer        data,
+                  volatile gint  *cancelled)
+{
+  ScoreChunk *chunk = data;
+  ScoreQuery *query = chunk->query;
+  
+  /* once cancelled, the rows can be freed as soon as no chunk is busy */
+  g_mutex_lock (score_data.lock);
+  if (g_atomic_int_get (&query->cancelled)) {
+    g_mutex_unlock (score_data.lock);
+    return;
+  }
+  score_data.n_busy++;
+  g_mutex_unlock (score_data.lock);
+  
+  score_range (query->source, chunk->begin, chunk->end, query->key,
+               query->type, &query->cancelled, chunk->candidates, chunk->matches);
+  
+  g_mutex_lock (score_data.lock);
+  if (--score_data.n_busy == 0) {
+    g_cond_broadcast (score_data.idle);
+  }
+  g_mutex_unlock (score_data.lock);
+}
+
+/* merges the chunks once they are all done, in the order of the rows */
+static void
+score_chunk_done (gpointer  data,
+                  gboolean  cancelled)
+{
+  ScoreChunk *chunk = data;
+  ScoreQuery *query = chunk->query;
+  guint       i;
+  
+  if (cancelled) {
+    g_atomic_int_set (&query->cancelled, TRUE);
+  }
+  if (--query->n_pending > 0) {
+    return;
+  }
+  
+  if (query == score_data.current) {
+    score_data.current = NULL;
+  }
+  if (! g_atomic_int_get (&query->cancelled)) {
+    GPtrArray *candidates;
+    GArray    *matches;
+    guint      n_candidates = 0;
+    
+    for (i = 0; i < query->n_chunks; i++) {
+      n_candidates += query->chunks[i].candidates->len;
+    }
+    candidates = g_ptr_array_sized_new (n_candidates);
+    matches = g_array_new (FALSE, FALSE, sizeof (RowMatch));
+    for (i = 0; i < query->n_chunks; i++) {
+      ScoreChunk *c = &query->chunks[i];
+      guint       j;
+      
+      for (j = 0; j < c->candidates->len; j++) {
+        g_ptr_array_add (candidates, g_ptr_array_index (c->candidates, j));
+      }
+      g_array_append_vals (matches, c->matches->data, c->matches->len);
+    }
+    refilter_show (query->key, query->type, candidates, matches);
+    query->key = NULL;
+  }
+  
+  for (i = 0; i < query->n_chunks; i++) {
+    g_ptr_array_free (query->chunks[i].candidates, TRUE);
+    g_array_free (query->chunks[i].matches, TRUE);
+  }
+  g_free (query->chunks);
+  g_free (query->key);
+  g_slice_free (ScoreQuery, query);
+}
+
+/* scores @source against @key in chunks on the worker threads, the results
+ * being shown once they are all done.  takes ownership of @key */
+static void
+score_start (gchar     *key,
+             gint       type,
+             GPtrArray *source)
+{
+  ScoreQuery *query = g_slice_new0 (ScoreQuery);
+  guint       i;
+  
+  if (! score_data.lock) {
+    if (! g_thread_supported ()) {
+      g_thread_init (NULL);
+    }
+    score_data.lock = g_mutex_new ();
+    score_data.idle = g_cond_new ();
+  }
+  
+  query->key = key;
+  query->type = type;
+  query->source = source;
+  query->n_chunks = (source->len + SCORE_CHUNK_ROWS - 1) / SCORE_CHUNK_ROWS;
+  query->n_pending = query->n_chunks;
+  query->chunks = g_new0 (ScoreChunk, query->n_chunks);
+  score_data.current = query;
+  
+  for (i = 0; i < query->n_chunks; i++) {
+    ScoreChunk *chunk = &query->chunks[i];
+    
+    chunk->query = query;
+    chunk->begin = i * SCORE_CHUNK_ROWS;
+    chunk->end = MIN (chunk->begin + SCORE_CHUNK_ROWS, source->len);
+    chunk->candidates = g_ptr_array_new ();
+    chunk->matches = g_array_new (FALSE, FALSE, sizeof (RowMatch));
+    gp_sched_run_in_thread (geany_plugin, NULL, score_chunk_work, score_chunk_done, chunk);
+  }
+}
+
+/* scores the rows against the current key and shows the best ones.  if the
+ * key extends the previous one, only the rows that matched it can match.
+ * 
+ * large sets of rows (e.g. the files of a big project) are scored in the
+ * background, the previous results staying shown until then.  a newer key
+ * cancels the query, and only the best rows of each chunk are merged. */
+static void
+refilter (void)
+{
+  GPtrArray    *source  = plugin_data.rows;
+  GPtrArray    *candidates;
+  GArray       *matches;
   gint          type;
-  const gchar  *key = get_key (&type);
+  gchar        *key;
   
-  gtk_tree_model_get (model, a, COL_PATH, &patha, COL_TYPE, &typea, -1);
-  gtk_tree_model_get (model, b, COL_PATH, &pathb, COL_TYPE, &typeb, -1);
+  if (! source) {
+    return;
+  }
   
-  scorea = key_score (key, patha);
-  scoreb = key_score (key, pathb);
+  score_cancel ();
+  key = g_utf8_casefold (get_key (&type), -1);
   
-  if (! (typea & type)) {
-    scorea -= 0xf000;
+  if (plugin_data.candidates && plugin_data.last_key &&
+      type == plugin_data.last_type &&
+      key_is_selective (plugin_data.last_key) &&
+      g_str_has_prefix (key, plugin_data.last_key)) {
+    source = plugin_data.candidates;
   }
-  if (! (typeb & type)) {
-    scoreb -= 0xf000;
+  
+  if (source->len >= SCORE_THREADED_ROWS) {
+    score_start (key, type, source);
+    return;
   }
   
-  g_free (patha);
-  g_free (pathb);
+  candidates = g_ptr_array_sized_new (source->len);
+  matches = g_array_new (FALSE, FALSE, sizeof (RowMatch));
+  score_range (source, 0, source->len, key, type, NULL, candidates, matches);
+  refilter_show (key, type, candidates, matches);
+}
+
+/* the rows changed, read them again now if they are shown */
+static void
+rows_invalidate (void)
+{
+  if (plugin_data.panel && gtk_widget_get_visible (plugin_data.panel)) {
+    rows_build (GTK_TREE_MODEL (plugin_data.store));
+    refilter ();
+  } else {
+    rows_clear ();
+  }
+}
+
+static void
+store_mark_dirty (GtkMenuShell *shell)
+{
+  if (store_data.shells && g_hash_table_lookup (store_data.shells, shell) &&
+      ! g_slist_find (store_data.dirty, shell)) {
+    store_data.dirty = g_slist_prepend (store_data.dirty, shell);
+  }
+}
+
+
+/* Project files */
+
+static StoreRow *
+project_file_new (gchar *path)
+{
+  StoreRow *row = g_slice_new0 (StoreRow);
+  
+  row->path = path;
+  row->key  = g_utf8_casefold (path, -1);
+  row->mask = key_mask (row->key);
+  row->type = COL_TYPE_FILE;
+  
+  return row;
+}
+
+static void
+project_files_free (GPtrArray *files)
+{
+  guint i;
+  
+  /* the rows were cleared before, cancelling the queries reading them */
+  score_wait ();
+  for (i = 0; i < files->len; i++) {
+    StoreRow *row = g_ptr_array_index (files, i);
+    
+    g_free (row->path);
+    g_free (row->key);
+    g_slice_free (StoreRow, row);
+  }
+  g_ptr_array_free (files, TRUE);
+}
+
+static gboolean
+project_file_match (const gchar *rel_path)
+{
+  const gchar *name = strrchr (rel_path, G_DIR_SEPARATOR);
+  GSList      *node;
   
-  return scoreb - scorea;
+  if (! project_data.patterns) {
+    return TRUE;
+  }
+  name = name ? name + 1 : rel_path;
+  for (node = project_data.patterns; node; node = node->next) {
+    if (g_pattern_match_string (node->data, name)) {
+      return TRUE;
+    }
+  }
+  
+  return FALSE;
+}
+
+static void
+project_add_file (const gchar *rel_path,
+                  gpointer     files)
+{
+  if (project_file_match (rel_path)) {
+    const gchar *root = gp_file_index_get_root (project_data.index);
+    
+    g_ptr_array_add (files, project_file_new (g_build_filename (root, rel_path, NULL)));
+  }
+}
+
+/* reads the project files again if the index changed since they were read.
+ * the rows are cleared since they point to the files, returns whether the
+ * files changed */
+static gboolean
+project_update_files (void)
+{
+  GPtrArray *old = project_data.files;
+  GPtrArray *files;
+  
+  if (! project_data.index ||
+      (old && project_data.generation == gp_file_index_get_generation (project_data.index))) {
+    return FALSE;
+  }
+  
+  files = g_ptr_array_new ();
+  gp_file_index_foreach (project_data.index, project_add_file, files);
+  project_data.files = files;
+  project_data.generation = gp_file_index_get_generation (project_data.index);
+  rows_clear ();
+  if (old) {
+    project_files_free (old);
+  }
+  
+  return TRUE;
+}
+
+/* the index is walked in the background, and monitored afterwards */
+static void
+on_project_index_changed (GpFileIndex  *index,
+                          gpointer      dummy)
+{
+  /* the files are read when the panel is shown otherwise */
+  if (plugin_data.panel && gtk_widget_get_visible (plugin_data.panel) &&
+      project_update_files ()) {
+    rows_invalidate ();
+  }
+}
+
+static void
+project_close (void)
+{
+  if (project_data.index) {
+    gp_file_index_unsubscribe (project_data.index, project_data.subscription);
+    gp_file_index_unref (project_data.index);
+    project_data.index = NULL;
+    project_data.subscription = 0;
+  }
+  g_slist_foreach (project_data.patterns, (GFunc) g_pattern_spec_free, NULL);
+  g_slist_free (project_data.patterns);
+  project_data.patterns = NULL;
+  if (project_data.files) {
+    GPtrArray *old = project_data.files;
+    
+    project_data.files = NULL;
+    rows_invalidate ();
+    project_files_free (old);
+  }
+}
+
+/* the project files come from the file index shared with the other plugins,
+ * which starts with the files of the previous session */
+static void
+project_open (void)
+{
+  GeanyProject *project = geany_data->app->project;
+  GpFileIndex  *index;
+  gchar        *base_path;
+  guint         i;
+  
+  if (! project || ! project->base_path) {
+    project_close ();
+    return;
+  }
+  
+  if (g_path_is_absolute (project->base_path)) {
+    base_path = g_strdup (project->base_path);
+  } else {
+    gchar *dir = g_path_get_dirname (project->file_name);
+    
+    base_path = g_build_filename (dir, project->base_path, NULL);
+    g_free (dir);
+  }
+  
+  /* referenced before the old one is released, in case it is the same */
+  index = gp_file_index_ref (geany_plugin, base_path);
+  project_close ();
+  project_data.index = index;
+  project_data.subscription = gp_file_index_subscribe (index, on_project_index_changed, NULL);
+  for (i = 0; project->file_patterns && project->file_patterns[i]; i++) {
+    project_data.patterns = g_slist_prepend (project_data.patterns,
+                                             g_pattern_spec_new (project->file_patterns[i]));
+  }
+  g_free (base_path);
+  
+  on_project_index_changed (index, NULL);
 }
 
 static gboolean
@@ -478,21 +1496,7 @@ on_entry_text_notify (GObject    *object,
                       GParamSpec *pspec,
                       gpointer    dummy)
 {
-  GtkTreeIter   iter;
-  GtkTreeView  *view  = GTK_TREE_VIEW (plugin_data.view);
-  GtkTreeModel *model = gtk_tree_view_get_model (view);
-  
-  /* we force re-sorting the whole model from how it was before, and the
-   * back to the new filter.  this is somewhat hackish but since we don't
-   * know the original sorting order, and GtkTreeSortable don't have a
-   * resort() API anyway. */
-  gtk_tree_model_sort_reset_default_sort_func (GTK_TREE_MODEL_SORT (model));
-  gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (model),
-                                           sort_func, NULL, NULL);
-  
-  if (gtk_tree_model_get_iter_first (model, &iter)) {
-    tree_view_set_cursor_from_iter (view, &iter);
-  }
+  refilter ();
 }
 
 static void
@@ -514,7 +1518,9 @@ on_panel_hide (GtkWidget *widget,
   }
   gtk_tree_view_get_cursor (view, &plugin_data.last_path, NULL);
   
-  gtk_list_store_clear (plugin_data.store);
+  /* the results of a query still being scored would be lost */
+  score_cancel ();
+  gtk_list_store_clear (plugin_data.results);
 }
 
 static void
@@ -524,7 +1530,16 @@ on_panel_show (GtkWidget *widget,
   GtkTreePath *path;
   GtkTreeView *view = GTK_TREE_VIEW (plugin_data.view);
   
-  fill_store (plugin_data.store);
+  project_update_files ();
+  if (! store_data.filled) {
+    fill_store (plugin_data.store);
+  } else if (store_refresh (plugin_data.store)) {
+    rows_clear ();
+  }
+  if (! plugin_data.rows) {
+    rows_build (GTK_TREE_MODEL (plugin_data.store));
+  }
+  refilter ();
   
   gtk_widget_grab_focus (plugin_data.entry);
   
@@ -566,6 +1581,18 @@ on_view_row_activated (GtkTreeView       *view,
         gint            page;
         
         gtk_tree_model_get (model, &iter, COL_DOCUMENT, &doc, -1);
+        if (! doc) {
+          /* a project file that isn't open */
+          gchar *path;
+          gchar *locale_path;
+          
+          gtk_tree_model_get (model, &iter, COL_PATH, &path, -1);
+          locale_path = utils_get_locale_from_utf8 (path);
+          document_open_file (locale_path, FALSE, NULL, NULL);
+          g_free (locale_path);
+          g_free (path);
+          break;
+        }
         page = document_get_notebook_page (doc);
         gtk_notebook_set_current_page (GTK_NOTEBOOK (geany_data->main_widgets->notebook),
                                        page);
@@ -635,10 +1662,13 @@ create_panel (void)
                                           GTK_TYPE_WIDGET,
                                           G_TYPE_POINTER);
   
-  plugin_data.sort = gtk_tree_model_sort_new_with_model (GTK_TREE_MODEL (plugin_data.store));
-  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (plugin_data.sort),
-                                        GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
-                                        GTK_SORT_ASCENDING);
+  /* the best rows of the store for the current key, in order */
+  plugin_data.results = gtk_list_store_new (COL_COUNT,
+                                            G_TYPE_STRING,
+                                            G_TYPE_STRING,
+                                            G_TYPE_INT,
+                                            GTK_TYPE_WIDGET,
+                                            G_TYPE_POINTER);
   
   scroll = g_object_new (GTK_TYPE_SCROLLED_WINDOW,
                          "hscrollbar-policy", GTK_POLICY_AUTOMATIC,
@@ -646,7 +1676,7 @@ create_panel (void)
                          NULL);
   gtk_box_pack_start (GTK_BOX (box), scroll, TRUE, TRUE, 0);
   
-  plugin_data.view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (plugin_data.sort));
+  plugin_data.view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (plugin_data.results));
   gtk_widget_set_can_focus (plugin_data.view, FALSE);
   gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (plugin_data.view), FALSE);
   cell = gtk_cell_renderer_text_new ();
@@ -662,6 +1692,66 @@ create_panel (void)
   gtk_widget_show_all (frame);
 }
 
+static void
+on_project_open (GObject  *obj,
+                 GKeyFile *config,
+                 gpointer  dummy)
+{
+  project_open ();
+}
+
+static void
+on_project_close (GObject  *obj,
+                  gpointer  dummy)
+{
+  project_close ();
+}
+
+static void
+on_document_open (GObject       *obj,
+                  GeanyDocument *doc,
+                  gpointer       dummy)
+{
+  if (store_data.filled && ! g_hash_table_lookup (store_data.documents, doc)) {
+    store_add_document (plugin_data.store, doc);
+    rows_invalidate ();
+  }
+}
+
+static void
+on_document_close (GObject       *obj,
+                   GeanyDocument *doc,
+                   gpointer       dummy)
+{
+  if (store_data.filled) {
+    store_remove_document (plugin_data.store, doc);
+    rows_invalidate ();
+  }
+}
+
+/* the file name changes when saving as */
+static void
+on_document_save (GObject       *obj,
+                  GeanyDocument *doc,
+                  gpointer       dummy)
+{
+  if (store_data.filled) {
+    store_remove_document (plugin_data.store, doc);
+    store_add_document (plugin_data.store, doc);
+    rows_invalidate ();
+  }
+}
+
+PluginCallback plugin_callbacks[] = {
+  { "project-open",   G_CALLBACK (on_project_open),   TRUE, NULL },
+  { "project-close",  G_CALLBACK (on_project_close),  TRUE, NULL },
+  { "document-new",   G_CALLBACK (on_document_open),  TRUE, NULL },
+  { "document-open",  G_CALLBACK (on_document_open),  TRUE, NULL },
+  { "document-close", G_CALLBACK (on_document_close), TRUE, NULL },
+  { "document-save",  G_CALLBACK (on_document_save),  TRUE, NULL },
+  { NULL, NULL, FALSE, NULL }
+};
+
 static void
 on_kb_show_panel (guint key_id)
 {
@@ -681,6 +1771,8 @@ plugin_init (GeanyData *data)
 {
   GeanyKeyGroup *group;
   
+  plugin_module_make_resident (geany_plugin);
+  
   group = plugin_set_key_group (geany_plugin, "commander", KB_COUNT, NULL);
   keybindings_set_item (group, KB_SHOW_PANEL, on_kb_show_panel,
                         0, 0, "show_panel", _("Show Command Panel"), NULL);
@@ -688,6 +1780,10 @@ plugin_init (GeanyData *data)
   /* delay for other plugins to have a chance to load before, so we will
    * include their items */
   plugin_idle_add (geany_plugin, on_plugin_idle_init, NULL);
+  
+  if (geany_data->app->project) {
+    project_open ();
+  }
 }
 
 void
@@ -696,6 +1792,12 @@ plugin_cleanup (void)
   if (plugin_data.panel) {
     gtk_widget_destroy (plugin_data.panel);
   }
+  rows_clear ();
+  if (plugin_data.store) {
+    store_clear (plugin_data.store);
+    g_object_unref (plugin_data.store);
+  }
+  project_close ();
   if (plugin_data.last_path) {
     gtk_tree_path_free (plugin_data.last_path);
   }
@@ -28,6 +28,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <memory.h>
 
 #include <gtk/gtk.h>
@@ -742,6 +743,33 @@ void bptree_set_enabled(breakpoint *bp)
 	update_file_node(&parent);
 }
 
+/*
+ * enable/disable breaks, updating each file node once
+ * arguments:
+ * 		breaks 	- list of breakpoints, better grouped by file
+ */
+void bptree_set_enabled_list(GList *breaks)
+{
+	GtkTreeIter parent;
+	const gchar *file = NULL;
+
+	for (; breaks; breaks = breaks->next)
+	{
+		breakpoint *bp = (breakpoint*)breaks->data;
+
+		if (file && strcmp(file, bp->file))
+			update_file_node(&parent);
+
+		gtk_tree_store_set(store, &(bp->iter), ENABLED, bp->enabled, -1);
+
+		gtk_tree_model_iter_parent(model, &parent, &(bp->iter));
+		file = bp->file;
+	}
+
+	if (file)
+		update_file_node(&parent);
+}
+
 /*
  * set breaks hits count
  * arguments:
@@ -793,64 +821,122 @@ void bptree_set_readonly(gboolean value)
 }
 
 /*
- * add new breakpoint to the tree view
- * arguments:
- * 		bp - breakpoint to add
+ * gets the file node iterator, adding the node if it doesn't exist
  */
-void bptree_add_breakpoint(breakpoint* bp)
+static void get_file_iter(const gchar *file, GtkTreeIter *file_iter)
 {
-	GtkTreeIter file_iter, iter, child, *sibling = NULL;
-	GtkTreeRowReference *file_reference = (GtkTreeRowReference*)g_hash_table_lookup(files, bp->file);
+	GtkTreeRowReference *file_reference = (GtkTreeRowReference*)g_hash_table_lookup(files, file);
 
 	if (!file_reference)
 	{
 		GtkTreePath *file_path;
 
-		gtk_tree_store_prepend (store, &file_iter, NULL);
-		gtk_tree_store_set (store, &file_iter,
-						FILEPATH, bp->file,
+		gtk_tree_store_prepend (store, file_iter, NULL);
+		gtk_tree_store_set (store, file_iter,
+						FILEPATH, file,
 						ENABLED, TRUE,
 						-1);
 
-		file_path = gtk_tree_model_get_path(model, &file_iter);
+		file_path = gtk_tree_model_get_path(model, file_iter);
 		file_reference = gtk_tree_row_reference_new(model, file_path);
 		gtk_tree_path_free(file_path);
 
-		g_hash_table_insert(files, (gpointer)g_strdup(bp->file),(gpointer)file_reference);
+		g_hash_table_insert(files, (gpointer)g_strdup(file),(gpointer)file_reference);
 	}
 	else
 	{
 		GtkTreePath *path = gtk_tree_row_reference_get_path(file_reference);
-		gtk_tree_model_get_iter(model, &file_iter, path);
+		gtk_tree_model_get_iter(model, file_iter, path);
 		gtk_tree_path_free(path);
 	}
-	
+}
+
+/*
+ * inserts a breakpoint row to the file node keeping rows sorted by line,
+ * looking for the place after "start" row if given
+ */
+static void insert_breakpoint(breakpoint* bp, GtkTreeIter *file_iter, GtkTreeIter *start)
+{
+	GtkTreeIter iter, child, *sibling = NULL;
+	gboolean valid;
+
 	/* lookup where to insert new row */
-	if(gtk_tree_model_iter_children(model, &child, &file_iter))
+	if (start)
 	{
-		do
+		child = *start;
+		valid = gtk_tree_model_iter_next(model, &child);
+	}
+	else
+		valid = gtk_tree_model_iter_children(model, &child, file_iter);
+
+	for (; valid; valid = gtk_tree_model_iter_next(model, &child))
+	{
+		int line;
+		gtk_tree_model_get (
+			model,
+			&child,
+			LINE, &line,
+			-1);
+		if (line > bp->line)
 		{
-			int line;
-			gtk_tree_model_get (
-				model,
-				&child,
-				LINE, &line,
-				-1);
-			if (line > bp->line)
-			{
-				sibling = &child;
-				break;
-			}
+			sibling = &child;
+			break;
 		}
-		while(gtk_tree_model_iter_next(model, &child));
 	}
 	
-	gtk_tree_store_insert_before(store, &iter, &file_iter, sibling);
+	gtk_tree_store_insert_before(store, &iter, file_iter, sibling);
 	bp->iter = iter;
 	
 	bptree_update_breakpoint(bp);
 }
 
+/*
+ * add new breakpoint to the tree view
+ * arguments:
+ * 		bp - breakpoint to add
+ */
+void bptree_add_breakpoint(breakpoint* bp)
+{
+	GtkTreeIter file_iter;
+
+	get_file_iter(bp->file, &file_iter);
+	insert_breakpoint(bp, &file_iter, NULL);
+}
+
+/*
+ * add new breakpoints to the tree view,
+ * the rows of a file are looked through once if its breakpoints
+ * are consecutive and sorted by line
+ * arguments:
+ * 		breaks - list of breakpoints to add
+ */
+void bptree_add_breakpoints(GList *breaks)
+{
+	GtkTreeIter file_iter;
+	breakpoint *previous = NULL;
+
+	for (; breaks; breaks = breaks->next)
+	{
+		breakpoint *bp = (breakpoint*)breaks->data;
+
+		if (previous && !strcmp(previous->file, bp->file) && previous->line < bp->line)
+			insert_breakpoint(bp, &file_iter, &previous->iter);
+		else
+		{
+			if (previous)
+				update_file_node(&file_iter);
+
+			get_file_iter(bp->file, &file_iter);
+			insert_breakpoint(bp, &file_iter, NULL);
+		}
+
+		previous = bp;
+	}
+
+	if (previous)
+		update_file_node(&file_iter);
+}
+
 /*
  * update existing breakpoint
  * arguments:
@@ -894,6 +980,48 @@ void bptree_remove_breakpoint(breakpoint* bp)
 	}
 }
 
+/*
+ * remove breakpoints, updating each file node once
+ * arguments:
+ * 		breaks - list of breakpoints to remove, better grouped by file
+ */
+void bptree_remove_breakpoints(GList *breaks)
+{
+	GtkTreeIter file;
+	const gchar *pending = NULL;
+
+	for (; breaks; breaks = breaks->next)
+	{
+		breakpoint *bp = (breakpoint*)breaks->data;
+		GtkTreeIter parent;
+
+		/* the file node of the previous breakpoints is done with */
+		if (pending && strcmp(pending, bp->file))
+		{
+			update_file_node(&file);
+			pending = NULL;
+		}
+
+		gtk_tree_model_iter_parent(model, &parent, &(bp->iter));
+		gtk_tree_store_remove(store, &(bp->iter));
+
+		if (!gtk_tree_model_iter_n_children(model, &parent))
+		{
+			g_hash_table_remove(files, (gpointer)bp->file);
+			gtk_tree_store_remove(store, &parent);
+			pending = NULL;
+		}
+		else
+		{
+			file = parent;
+			pending = bp->file;
+		}
+	}
+
+	if (pending)
+		update_file_node(&file);
+}
+
 /*
  * updates all file ENABLED checkboxes base on theit children states
  * arguments:
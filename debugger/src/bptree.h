@@ -30,11 +30,14 @@
 gboolean		bptree_init(move_to_line_cb callback);
 void			bptree_destroy(void);
 void 			bptree_add_breakpoint(breakpoint* bp);
+void			bptree_add_breakpoints(GList *breaks);
 void 			bptree_update_breakpoint(breakpoint* bp);
 void 			bptree_remove_breakpoint(breakpoint* bp);
+void			bptree_remove_breakpoints(GList *breaks);
 void 			bptree_set_condition(breakpoint* bp);
 void 			bptree_set_hitscount(breakpoint* bp);
 void 			bptree_set_enabled(breakpoint* bp);
+void			bptree_set_enabled_list(GList *breaks);
 gchar*			bptree_get_condition(breakpoint* bp);
 void 			bptree_set_readonly(gboolean readonly);
 void			bptree_update_file_nodes(void);
@@ -44,33 +44,14 @@ GHashTable* files = NULL;
  * Functions for breakpoint iteration support
  */
 
-typedef void 	(*breaks_iterate_function)(void* bp);
-
-/*
- * Iterates through GTree for the particular file
- */
-static gboolean tree_foreach_call_function(gpointer key, gpointer value, gpointer data)
-{
-	((breaks_iterate_function)data)(value);
-	return FALSE;
-}
-
-/*
- * Iterates through hash table of GTree-s
- */
-static void hash_table_foreach_call_function(gpointer key, gpointer value, gpointer user_data)
-{
-	g_tree_foreach((GTree*)value, tree_foreach_call_function, user_data);
-}
-
 /*
  * Iterates through GTree
- * adding each item to GList that is passed through data variable
+ * prepending each item to GList that is passed through data variable
  */
 static gboolean tree_foreach_add_to_list(gpointer key, gpointer value, gpointer data)
 {
 	GList **list = (GList**)data;
-	*list = g_list_append(*list, value);
+	*list = g_list_prepend(*list, value);
 	return FALSE;
 }
 
@@ -94,6 +75,11 @@ static void on_add(breakpoint *bp)
 	/* add marker */
 	markers_add_breakpoint(bp);
 }
+static void on_add_list(GList *list)
+{
+	bptree_add_breakpoints(list);
+	markers_add_breakpoints(list);
+}
 static void on_remove(breakpoint *bp)
 {
 	GTree *tree;
@@ -128,33 +114,45 @@ static void on_switch(breakpoint *bp)
 	/* set checkbox in breaks tree */
 	bptree_set_enabled(bp);
 }
+static void on_switch_list(GList *list)
+{
+	markers_remove_breakpoints(list);
+	markers_add_breakpoints(list);
+
+	bptree_set_enabled_list(list);
+}
 static void on_set_enabled_list(GList *breaks, gboolean enabled)
 {
-	GList *iter = breaks;
-	while (iter)
+	GList *iter, *switched = NULL;
+	for (iter = breaks; iter; iter = iter->next)
 	{
 		breakpoint *bp = (breakpoint*)iter->data;
 		
 		if (bp->enabled ^ enabled)
 		{
 			bp->enabled = enabled;
-			
-			/* remove old and set new marker */
-			markers_remove_breakpoint(bp);
-			markers_add_breakpoint(bp);
-			
-			/* set checkbox in breaks tree */
-			bptree_set_enabled(bp);
+			switched = g_list_prepend(switched, bp);
 		}
-		iter = iter->next;
 	}
+
+	switched = g_list_reverse(switched);
+	on_switch_list(switched);
+	g_list_free(switched);
 }
 static void on_remove_list(GList *list)
 {
 	GList *iter;
+
+	/* remove markers and tree rows while breakpoints are still alive */
+	markers_remove_breakpoints(list);
+	bptree_remove_breakpoints(list);
+
+	/* remove from internal storage */
 	for (iter = list; iter; iter = iter->next)
 	{
-		on_remove((breakpoint*)iter->data);
+		breakpoint *bp = (breakpoint*)iter->data;
+		GTree *tree = g_hash_table_lookup(files, bp->file);
+		g_tree_remove(tree, GINT_TO_POINTER(bp->line));
 	}
 }
 
@@ -249,7 +247,7 @@ static void breaks_switch_debug(breakpoint* bp)
 }
 static void breaks_set_disabled_list_debug(GList *list)
 {
-	GList *iter;
+	GList *iter, *switched = NULL;
 	for (iter = list; iter; iter = iter->next)
 	{
 		breakpoint *bp = (breakpoint*)iter->data;
@@ -258,7 +256,7 @@ static void breaks_set_disabled_list_debug(GList *list)
 			bp->enabled = FALSE;
 			if (debug_set_break(bp, BSA_UPDATE_ENABLE))
 			{
-				on_switch(bp);
+				switched = g_list_prepend(switched, bp);
 			}
 			else
 			{
@@ -268,11 +266,15 @@ static void breaks_set_disabled_list_debug(GList *list)
 	}
 	g_list_free(list);
 
+	switched = g_list_reverse(switched);
+	on_switch_list(switched);
+	g_list_free(switched);
+
 	config_set_debug_changed();
 }
 static void breaks_set_enabled_list_debug(GList *list)
 {
-	GList *iter;
+	GList *iter, *switched = NULL;
 	for (iter = list; iter; iter = iter->next)
 	{
 		breakpoint *bp = (breakpoint*)iter->data;
@@ -281,7 +283,7 @@ static void breaks_set_enabled_list_debug(GList *list)
 			bp->enabled = TRUE;
 			if (debug_set_break(bp, BSA_UPDATE_ENABLE))
 			{
-				on_switch(bp);
+				switched = g_list_prepend(switched, bp);
 			}
 			else
 			{
@@ -291,21 +293,48 @@ static void breaks_set_enabled_list_debug(GList *list)
 	}
 	g_list_free(list);
 
+	switched = g_list_reverse(switched);
+	on_switch_list(switched);
+	g_list_free(switched);
+
+	config_set_debug_changed();
+}
+static void breaks_add_list_debug(GList *list)
+{
+	GList *iter, *added = NULL;
+	for (iter = list; iter; iter = iter->next)
+	{
+		breakpoint *bp = (breakpoint*)iter->data;
+		if (debug_set_break(bp, BSA_NEW_BREAK))
+		{
+			added = g_list_prepend(added, bp);
+		}
+	}
+	g_list_free(list);
+
+	added = g_list_reverse(added);
+	on_add_list(added);
+	g_list_free(added);
+
 	config_set_debug_changed();
 }
 static void breaks_remove_list_debug(GList *list)
 {
-	GList *iter;
+	GList *iter, *removed = NULL;
 	for (iter = list; iter; iter = iter->next)
 	{
 		breakpoint *bp = (breakpoint*)iter->data;
 		if (debug_remove_break(bp))
 		{
-			on_remove((breakpoint*)iter->data);
+			removed = g_list_prepend(removed, bp);
 		}
 	}
 	g_list_free(list);
 
+	removed = g_list_reverse(removed);
+	on_remove_list(removed);
+	g_list_free(removed);
+
 	config_set_debug_changed();
 }
 
@@ -335,13 +364,8 @@ gboolean breaks_init(move_to_line_cb cb)
 void breaks_destroy(void)
 {
 	/* remove all markers */
-	GList *breaks, *iter;
-	breaks = iter = breaks_get_all();
-	while (iter)
-	{
-		markers_remove_breakpoint((breakpoint*)iter->data);
-		iter = iter->next;
-	}
+	GList *breaks = breaks_get_all();
+	markers_remove_breakpoints(breaks);
 	g_list_free(breaks);
 	
 	/* free storage */
@@ -351,6 +375,25 @@ void breaks_destroy(void)
 	bptree_destroy();
 }
 
+/*
+ * Inserts a breakpoint to the internal storage
+ */
+static void store_breakpoint(breakpoint *bp)
+{
+	GTree *tree;
+
+	/* check whether GTree for this file exists and create if doesn't */
+	if (!(tree = g_hash_table_lookup(files, bp->file)))
+	{
+		char *newfile = g_strdup(bp->file);
+		tree = g_tree_new_full(compare_func, NULL, NULL, (GDestroyNotify)g_free);
+		g_hash_table_insert(files, newfile, tree);
+	}
+	
+	/* insert to internal storage */
+	g_tree_insert(tree, GINT_TO_POINTER(bp->line), bp);
+}
+
 /*
  * Add new breakpoint.
  * arguments:
@@ -362,7 +405,6 @@ void breaks_destroy(void)
  */
 void breaks_add(const char* file, int line, char* condition, int enabled, int hitscount)
 {
-	GTree *tree;
 	breakpoint* bp;
 	enum dbs state = debug_get_state();
 
@@ -373,17 +415,7 @@ void breaks_add(const char* file, int line, char* condition, int enabled, int hi
 	
 	/* allocate memory */
 	bp = break_new_full(file, line, condition, enabled, hitscount);
-	
-	/* check whether GTree for this file exists and create if doesn't */
-	if (!(tree = g_hash_table_lookup(files, bp->file)))
-	{
-		char *newfile = g_strdup(bp->file);
-		tree = g_tree_new_full(compare_func, NULL, NULL, (GDestroyNotify)g_free);
-		g_hash_table_insert(files, newfile, tree);
-	}
-	
-	/* insert to internal storage */
-	g_tree_insert(tree, GINT_TO_POINTER(bp->line), bp);
+	store_breakpoint(bp);
 
 	/* handle creation instantly if debugger is idle or stopped
 	and request debug module interruption overwise */
@@ -398,6 +430,46 @@ void breaks_add(const char* file, int line, char* condition, int enabled, int hi
 		debug_request_interrupt((bs_callback)breaks_add_debug, (gpointer)bp);
 }
 
+/*
+ * Add a list of new breakpoints, updating markers and
+ * breaks tree once per file. The list and breakpoints,
+ * allocated with break_new_full, are taken by the function.
+ * arguments:
+ * 		breaks - list of breakpoints, better grouped by file and sorted by line
+ */
+void breaks_add_list(GList *breaks)
+{
+	GList *iter;
+	enum dbs state = debug_get_state();
+
+	/* do not process async break manipulation on modules
+	that do not support async interuppt */
+	if (DBS_RUNNING == state &&  !debug_supports_async_breaks())
+	{
+		g_list_foreach(breaks, (GFunc)g_free, NULL);
+		g_list_free(breaks);
+		return;
+	}
+
+	/* insert to internal storage */
+	for (iter = breaks; iter; iter = iter->next)
+		store_breakpoint((breakpoint*)iter->data);
+
+	/* handle creation instantly if debugger is idle or stopped
+	and request debug module interruption overwise */
+	if (DBS_IDLE == state)
+	{
+		on_add_list(breaks);
+		g_list_free(breaks);
+
+		config_set_debug_changed();
+	}
+	else if (DBS_STOPPED == state)
+		breaks_add_list_debug(breaks);
+	else if (DBS_STOP_REQUESTED != state)
+		debug_request_interrupt((bs_callback)breaks_add_list_debug, (gpointer)breaks);
+}
+
 /*
  * Remove breakpoint.
  * arguments:
@@ -465,7 +537,10 @@ void breaks_remove_list(GList *list)
  */
 void breaks_remove_all(void)
 {
-	g_hash_table_foreach(files, hash_table_foreach_call_function, (gpointer)on_remove);
+	GList *breaks = breaks_get_all();
+	on_remove_list(breaks);
+	g_list_free(breaks);
+
 	g_hash_table_remove_all(files);
 }
 
@@ -675,7 +750,7 @@ GList* breaks_get_for_document(const char* file)
 	{
 		g_tree_foreach(tree, tree_foreach_add_to_list, &breaks);
 	}
-	return breaks;
+	return g_list_reverse(breaks);
 }
 
 /*
@@ -702,5 +777,5 @@ GList* breaks_get_all(void)
 {
 	GList *breaks  = NULL;
 	g_hash_table_foreach(files, hash_table_foreach_add_to_list, &breaks);
-	return breaks;
+	return g_list_reverse(breaks);
 }
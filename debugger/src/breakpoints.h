@@ -38,6 +38,7 @@ typedef void	(*select_frame_cb)(int frame_number);
 gboolean		breaks_init(move_to_line_cb callback);
 void			breaks_destroy(void);
 void			breaks_add(const char* file, int line, char* condition, int enable, int hitscount);
+void			breaks_add_list(GList *breaks);
 void			breaks_remove(const char* file, int line);
 void			breaks_remove_list(GList *list);
 void			breaks_remove_all(void);
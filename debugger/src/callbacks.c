@@ -137,23 +137,39 @@ void on_document_save(GObject *obj, GeanyDocument *doc, gpointer user_data)
  */
 void on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data)
 {
-	/*set markers*/
-	markers_set_for_document(doc->editor->sci);
-
 	/*set dwell interval*/
 	scintilla_send_message(doc->editor->sci, SCI_SETMOUSEDWELLTIME, 500, 0);
 
 	/* set tab size for calltips */
 	scintilla_send_message(doc->editor->sci, SCI_CALLTIPUSESTYLE, 20, (long)NULL);
 
-	/* set breakpoint and frame markers */
-	set_markers_for_file(DOC_FILENAME(doc));
+	/* markers are set once the document is shown, so that opening
+	 a session doesn't set them for all the documents at once */
+	markers_set_dirty(doc);
+	if (doc == document_get_current())
+		on_document_activate(obj, doc, user_data);
 
 	/* if debug is active - tell the debug module that a file was opened */
 	if (DBS_IDLE != debug_get_state())
 		debug_on_file_open(doc);
 }
 
+/*
+ * 	Occures on document activation.
+ * 	Sets the markers of a document shown for the first time
+ */
+void on_document_activate(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	if (!markers_is_dirty(doc))
+		return;
+
+	/*set markers*/
+	markers_set_for_document(doc->editor->sci);
+
+	/* set breakpoint and frame markers */
+	set_markers_for_file(DOC_FILENAME(doc));
+}
+
 /*
  * 	Handles mouse leave event to check if a calltip is still present and hides it if yes 
  */
@@ -173,6 +189,28 @@ static gboolean on_mouse_leave(GtkWidget *widget, GdkEvent *event, gpointer user
 	return FALSE;
 }
 
+/*
+ * 	Position of the hovered word, the calltip is shown there if it is still current
+ */
+static ScintillaObject *calltip_sci = NULL;
+static gint calltip_position = -1;
+
+/*
+ * 	Shows the calltip of the hovered word when it is evaluated
+ */
+static void on_calltip_ready(const gchar *calltip, gpointer data)
+{
+	GeanyDocument *doc = document_get_current();
+
+	/* the document may have been switched or closed meanwhile */
+	if (!doc || doc->editor->sci != calltip_sci)
+		return;
+
+	if (!leave_signal)
+		leave_signal = g_signal_connect(G_OBJECT(calltip_sci), "leave-notify-event", G_CALLBACK(on_mouse_leave), NULL);
+	scintilla_send_message (calltip_sci, SCI_CALLTIPSHOW, calltip_position, (long)calltip);
+}
+
 /*
  * 	Occures on notify from editor.
  * 	Handles margin click to set/remove breakpoint 
@@ -224,12 +262,9 @@ gboolean on_editor_notify(
 			word = get_word_at_position(editor->sci, nt->position);
 			if (word->len)
 			{
-				gchar *calltip = debug_get_calltip_for_expression(word->str);
-				if (calltip)
-				{
-					leave_signal = g_signal_connect(G_OBJECT(editor->sci), "leave-notify-event", G_CALLBACK(on_mouse_leave), NULL);
-					scintilla_send_message (editor->sci, SCI_CALLTIPSHOW, nt->position, (long)calltip);
-				}
+				calltip_sci = editor->sci;
+				calltip_position = nt->position;
+				debug_request_calltip(word->str, on_calltip_ready, NULL);
 			}
 				
 			g_string_free(word, TRUE);
@@ -238,6 +273,8 @@ gboolean on_editor_notify(
 		}
 		case SCN_DWELLEND:
 		{
+			debug_cancel_calltip();
+
 			if (leave_signal > 0)
 			{
 				g_signal_handler_disconnect(G_OBJECT(editor->sci), leave_signal);
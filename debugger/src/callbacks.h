@@ -27,6 +27,7 @@
 #include "geanyplugin.h"
 
 void on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data);
+void on_document_activate(GObject *obj, GeanyDocument *doc, gpointer user_data);
 void on_document_save(GObject *obj, GeanyDocument *doc, gpointer user_data);
 void on_document_before_save(GObject *obj, GeanyDocument *doc, gpointer user_data);
 gboolean on_editor_notify(GObject *object, GeanyEditor *editor, SCNotification *nt, gpointer data);
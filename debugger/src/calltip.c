@@ -34,6 +34,8 @@
 #define REST_LINES "\t▸\t%s = (%s) %s"
 #define REST_LINES_NO_CHILDERN "\t\t%s = (%s) %s"
 
+extern dbg_module *active_module;
+
 /*
  * creates text for a tooltip taking list or variables   
  */
@@ -42,6 +44,7 @@ GString* get_calltip_line(variable *var, gboolean firstline)
 	GString *calltip = NULL;
 	if (var && var->evaluated)
 	{
+		gchar *value = active_module->format_value(var->value->str);
 		calltip = g_string_new("");
 		if (firstline)
 		{
@@ -49,7 +52,7 @@ GString* get_calltip_line(variable *var, gboolean firstline)
 				var->has_children ? FIRST_LINE : FIRST_LINE_NO_CHILDERN,
 				var->name->str,
 				var->type->str,
-				var->value->str);
+				value);
 		}
 		else
 		{
@@ -57,8 +60,9 @@ GString* get_calltip_line(variable *var, gboolean firstline)
 				var->has_children ? REST_LINES : REST_LINES_NO_CHILDERN,
 				var->name->str,
 				var->type->str,
-				var->value->str);
+				value);
 		}
+		g_free(value);
 
 		if (calltip->len > MAX_CALLTIP_LENGTH)
 		{
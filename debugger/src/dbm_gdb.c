@@ -38,6 +38,7 @@ extern GeanyData		*geany_data;
 
 #include "breakpoint.h"
 #include "debug_module.h"
+#include "gdb_mi.h"
 
 /* module features */
 #define MODULE_FEATURES MF_ASYNC_BREAKS
@@ -47,8 +48,8 @@ extern GeanyData		*geany_data;
 	G_SPAWN_SEARCH_PATH | \
 	G_SPAWN_DO_NOT_REAP_CHILD
 
-/* GDB prompt */
-#define GDB_PROMPT "(gdb) \n"
+/* GDB prompt (without the line terminator) */
+#define GDB_PROMPT "(gdb) "
 
 /* enumeration for GDB command execution status */
 typedef enum _result_class {
@@ -57,6 +58,20 @@ typedef enum _result_class {
 	RC_ERROR
 } result_class;
 
+/* callback to be called with the result of a pipelined command */
+typedef void (*pipe_callback) (result_class rc, const mi_record *record, gpointer data);
+
+/* structure to keep a pipelined command */
+typedef struct _pipe_item {
+	guint token;
+	gchar *command;
+	pipe_callback callback;
+	gpointer data;
+} pipe_item;
+
+/* maximum number of pipelined commands sent without reading their results */
+#define PIPE_MAX_SENT 32
+
 /* structure to keep async command data (command line, messages) */
 typedef struct _queue_item {
 	GString *message;
@@ -99,6 +114,35 @@ static GIOChannel *gdb_ch_out;
 /* GDB output event source id */
 static guint gdb_id_out;
 
+/* GDB output line buffer, reused for every line read */
+static GString *gdb_line = NULL;
+
+/* records parsed from the asyncronous and the command output */
+static mi_record *async_record = NULL;
+static mi_record *sync_record = NULL;
+
+/* result record buffer, the lines read after it overwrite gdb_line */
+static GString *result_line = NULL;
+
+/* interned record class names, compared by address */
+static const gchar *class_done;
+static const gchar *class_error;
+static const gchar *class_exit;
+static const gchar *class_running;
+static const gchar *class_stopped;
+static const gchar *class_thread_group_created;
+static const gchar *class_thread_group_started;
+static const gchar *class_thread_created;
+static const gchar *class_thread_exited;
+static const gchar *class_library_loaded;
+static const gchar *class_library_unloaded;
+
+/* pipelined commands waiting to be sent and waiting for the result,
+ and the last command token used */
+static GQueue *pipe_queued = NULL;
+static GQueue *pipe_sent = NULL;
+static guint pipe_token = 0;
+
 /* buffer for the error message */
 char err_message[1000];
 
@@ -111,11 +155,29 @@ static GList *autos = NULL;
 /* watches list */
 static GList *watches = NULL;
 
+/* variables kept for the calltips cached by the plugin */
+static GList *calltips = NULL;
+
+/* variables created since the last update, they are evaluated in full */
+static GList *created = NULL;
+
+/* GDB variables changed by the last update and the number of updates,
+the calltips are kept as long as their variables don't change */
+static GHashTable *changed_variables = NULL;
+static guint updates_count = 0;
+
+/* lists of the variables children, by the parent GDB variable name,
+a page of them is kept by "<name>.@<first child index>" */
+static GHashTable *children_cache = NULL;
+/* numbers of the variables children, by the parent GDB variable name */
+static GHashTable *children_counts = NULL;
+
 /* loaded files list */
 static GList *files = NULL;
 
 /* set to true if library was loaded/unloaded
-and it's nessesary to refresh files list */
+and it's nessesary to refresh files list, which is done
+once the list is asked for, for all the libraries loaded since */
 static gboolean file_refresh_needed = FALSE;
 
 /* current frame number */
@@ -126,6 +188,8 @@ static void stop(void);
 static variable* add_watch(gchar* expression);
 static void update_watches(void);
 static void update_autos(void);
+static void update_changes(void);
+static void free_variables(GList *vars);
 static void update_files(void);
 
 /*
@@ -186,11 +250,21 @@ static void on_gdb_exit(GPid pid, gint status, gpointer data)
 	g_list_foreach(watches, (GFunc)g_free, NULL);
 	g_list_free(watches);
 	watches = NULL;
+
+	/* delete calltips variables */
+	free_variables(calltips);
+	calltips = NULL;
+	g_hash_table_remove_all(changed_variables);
 	
 	/* delete files */
 	g_list_foreach(files, (GFunc)g_free, NULL);
 	g_list_free(files);
 	files = NULL;
+	file_refresh_needed = FALSE;
+
+	/* delete children */
+	g_hash_table_remove_all(children_cache);
+	g_hash_table_remove_all(children_counts);
 	
 	g_source_remove(gdb_src_id);
 	
@@ -198,24 +272,31 @@ static void on_gdb_exit(GPid pid, gint status, gpointer data)
 }
 
 /*
- * reads gdb_out until "(gdb)" prompt met
+ * reads the next line of GDB output into gdb_line, without the line terminator
  */
-static GList* read_until_prompt(void)
+static gboolean read_line(GIOChannel *ch)
 {
-	GList *lines = NULL;
-
-	gchar *line = NULL;
 	gsize terminator;
-	while (G_IO_STATUS_NORMAL == g_io_channel_read_line(gdb_ch_out, &line, NULL, &terminator, NULL))
-	{
-		if (!strcmp(GDB_PROMPT, line))
-			break;
 
-		line[terminator] = '\0';
-		lines = g_list_append (lines, line);
+	if (G_IO_STATUS_NORMAL != g_io_channel_read_line_string(ch, gdb_line, &terminator, NULL))
+		return FALSE;
+
+	g_string_truncate(gdb_line, terminator);
+
+	return TRUE;
+}
+
+/*
+ * reads gdb_out until "(gdb)" prompt met,
+ * showing the lines if "show" is set
+ */
+static void read_until_prompt(gboolean show)
+{
+	while (read_line(gdb_ch_out) && strcmp(gdb_line->str, GDB_PROMPT))
+	{
+		if (show && *gdb_line->str)
+			colorize_message(gdb_line->str);
 	}
-	
-	return lines;
 }
 
 /*
@@ -305,38 +386,26 @@ static GList* add_to_queue(GList* queue, const gchar *message, const gchar *comm
 static void exec_async_command(const gchar* command);
 static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpointer data)
 {
-	gchar *line;
-	gsize length;
-	
-	if (G_IO_STATUS_NORMAL != g_io_channel_read_line(src, &line, NULL, &length, NULL))
-		return TRUE;		
-
-	*(line + length) = '\0';
+	if (!read_line(src))
+		return TRUE;
 
-	if ('^' == line[0])
+	if (mi_parse_record(async_record, gdb_line->str) && '^' == async_record->type)
 	{
 		/* got some result */
 
-		GList *lines;
 		GList *commands = (GList*)data;
-		gchar *coma;
+		gboolean done = class_done == async_record->klass;
+		gchar *gdb_msg = NULL;
 
 		g_source_remove(gdb_id_out);
 
-		lines = read_until_prompt();
-		g_list_foreach(lines, (GFunc)g_free, NULL);
-		g_list_free (lines);
+		/* the line buffer is reused while reading until prompt */
+		if (!done)
+			gdb_msg = g_strdup(mi_find_string(async_record, NULL, "msg"));
 
-		coma = strchr(line, ',');
-		if (coma)
-		{
-			*coma = '\0';
-			coma++;
-		}
-		else
-			coma = line + strlen(line);
-		
-		if (!strcmp(line, "^done"))
+		read_until_prompt(FALSE);
+
+		if (done)
 		{
 			/* command completed succesfully - run next command if exists */
 			if (commands->next)
@@ -365,8 +434,8 @@ static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpoint
 				/* removing read callback */
 				g_source_remove(gdb_id_out);
 
-				/* update source files list */
-				update_files();
+				/* source files list is updated when asked for */
+				file_refresh_needed = TRUE;
 
 				/* -exec-run */
 				exec_async_command("-exec-run &");
@@ -379,13 +448,10 @@ static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpoint
 			{
 				if (item->format_error_message)
 				{
-					gchar* gdb_msg = g_strcompress(strstr(coma, "msg=\"") + strlen("msg=\""));
-
 					GString *msg = g_string_new("");
-					g_string_printf(msg, item->error_message->str, gdb_msg);
+					g_string_printf(msg, item->error_message->str, gdb_msg ? gdb_msg : "");
 					dbg_cbs->report_error(msg->str);
 
-					g_free(gdb_msg);
 					g_string_free(msg, FALSE);
 				}
 				else
@@ -399,9 +465,9 @@ static gboolean on_read_async_output(GIOChannel * src, GIOCondition cond, gpoint
 
 			stop();
 		}
-	}
 
-	g_free(line);
+		g_free(gdb_msg);
+	}
 
 	return TRUE;
 }
@@ -414,90 +480,78 @@ enum dbs debug_get_state(void);
 static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer data)
 {
 	gchar *line;
-	gsize length;
-	gboolean prompt;
+	const gchar *klass;
+	const gchar *value;
 	
-	if (G_IO_STATUS_NORMAL != g_io_channel_read_line(src, &line, NULL, &length, NULL))
-		return TRUE;		
+	if (!read_line(src))
+		return TRUE;
 
-	prompt = !strcmp(line, GDB_PROMPT);
-	
-	*(line + length) = '\0';
+	line = gdb_line->str;
+	if (!strcmp(line, GDB_PROMPT))
+		return TRUE;
 
-	if (!prompt)
-	{
-		if ('~' == line[0])
-		{
-			colorize_message(line);
-		}
-		else
-		{
-			gchar *compressed = g_strcompress(line);
-			colorize_message(compressed);
-			g_free(compressed);
-		}
-	}
-		
-	if (!target_pid && g_str_has_prefix(line, "=thread-group-created"))
+	/* only lines with escape sequences have to be unescaped to be shown */
+	if ('~' == line[0] || !strchr(line, '\\'))
 	{
-		*(strrchr(line, '\"')) = '\0';
-		target_pid = atoi(line + strlen("=thread-group-created,id=\""));
+		colorize_message(line);
 	}
-	else if (!target_pid && g_str_has_prefix(line, "=thread-group-started"))
+	else
 	{
-		*(strrchr(line, '\"')) = '\0';
-		target_pid = atoi(strrchr(line, '\"') + 1);
+		gchar *compressed = g_strcompress(line);
+		colorize_message(compressed);
+		g_free(compressed);
 	}
-	else if (g_str_has_prefix(line, "=thread-created"))
-	{
-		int thread_id;
 
-		*(strrchr(line, ',') - 1) = '\0';
-		thread_id = atoi(line + strlen("=thread-created,id=\""));
-		dbg_cbs->add_thread(thread_id);
-	}
-	else if (g_str_has_prefix(line, "=thread-exited"))
-	{
-		int thread_id;
+	/* parsing modifies the line, so it goes after showing */
+	if (!mi_parse_record(async_record, line))
+		return TRUE;
+	klass = async_record->klass;
 
-		*(strrchr(line, ',') - 1) = '\0';
-		thread_id = atoi(line + strlen("=thread-exited,id=\""));
-		dbg_cbs->remove_thread(thread_id);
-	}
-	else if (g_str_has_prefix(line, "=library-loaded") || g_str_has_prefix(line, "=library-unloaded"))
+	if ('=' == async_record->type)
 	{
-		file_refresh_needed = TRUE;
+		if (!target_pid && class_thread_group_created == klass)
+		{
+			if ( (value = mi_find_string(async_record, NULL, "id")) )
+				target_pid = atoi(value);
+		}
+		else if (!target_pid && class_thread_group_started == klass)
+		{
+			if ( (value = mi_find_string(async_record, NULL, "pid")) )
+				target_pid = atoi(value);
+		}
+		else if (class_thread_created == klass)
+		{
+			if ( (value = mi_find_string(async_record, NULL, "id")) )
+				dbg_cbs->add_thread(atoi(value));
+		}
+		else if (class_thread_exited == klass)
+		{
+			if ( (value = mi_find_string(async_record, NULL, "id")) )
+				dbg_cbs->remove_thread(atoi(value));
+		}
+		else if (class_library_loaded == klass || class_library_unloaded == klass)
+		{
+			file_refresh_needed = TRUE;
+		}
 	}
-	else if (*line == '*')
+	else if ('*' == async_record->type)
 	{
 		/* asyncronous record found */
-		char *record = NULL;
-		if ( (record = strchr(line, ',')) )
-		{
-			*record = '\0';
-			record++;
-		}
-		else
-			record = line + strlen(line);
-		
-		if (!strcmp(line, "*running"))
+		if (class_running == klass)
 			dbg_cbs->set_run();
-		else if (!strcmp(line, "*stopped"))
+		else if (class_stopped == klass)
 		{
-			char *reason;
+			const gchar *reason;
+			int thread_id = 0;
+			int exit_code = 0;
 
 			/* removing read callback (will pulling all output left manually) */
 			g_source_remove(gdb_id_out);
 
 			/* looking for a reason to stop */
-			reason = strstr(record, "reason=\"");
+			reason = mi_find_string(async_record, NULL, "reason");
 			if (reason)
 			{
-				char *next;
-
-				reason += strlen("reason=\"");
-				next = strstr(reason, "\"") + 1;
-				*(next - 1) = '\0';
 				if (!strcmp(reason, "breakpoint-hit"))
 					stop_reason = SR_BREAKPOINT_HIT;
 				else if (!strcmp(reason, "end-stepping-range"))
@@ -516,12 +570,15 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
 				/* somehow, sometimes there can be no stop reason */
 				stop_reason = SR_EXITED_NORMALLY;
 			}
+
+			/* the record is overwritten by the commands executed below */
+			if ( (value = mi_find_string(async_record, NULL, "thread-id")) )
+				thread_id = atoi(value);
+			if ( (value = mi_find_string(async_record, NULL, "exit-code")) )
+				exit_code = (int)(char)strtol(value, NULL, 8);
 			
 			if (SR_BREAKPOINT_HIT == stop_reason || SR_END_STEPPING_RANGE == stop_reason || SR_SIGNAL_RECIEVED == stop_reason)
 			{
-				gchar *thread_id = strstr(reason + strlen(reason) + 1,"thread-id=\"") + strlen("thread-id=\"");
-				*(strchr(thread_id, '\"')) = '\0'; 
-				
 				active_frame = 0;
 
 				if (SR_BREAKPOINT_HIT == stop_reason || SR_END_STEPPING_RANGE == stop_reason)
@@ -531,15 +588,11 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
 			
 					/* update watches */
 					update_watches();
-			
-					/* update files */
-					if (file_refresh_needed)
-					{
-						update_files();
-						file_refresh_needed = FALSE;
-					}
-
-					dbg_cbs->set_stopped(atoi(thread_id));
+
+					/* update values */
+					update_changes();
+
+					dbg_cbs->set_stopped(thread_id);
 				}
 				else
 				{
@@ -548,19 +601,14 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
 					else
 						requested_interrupt = FALSE;
 						
-					dbg_cbs->set_stopped(atoi(thread_id));
+					dbg_cbs->set_stopped(thread_id);
 				}
 			}
 			else if (stop_reason == SR_EXITED_NORMALLY || stop_reason == SR_EXITED_SIGNALLED || stop_reason == SR_EXITED_WITH_CODE)
 			{
 				if (stop_reason == SR_EXITED_WITH_CODE)
 				{
-					gchar *code;
-					gchar *message;
-
-					code = strstr(reason + strlen(reason) + 1,"exit-code=\"") + strlen("exit-code=\"");
-					*(strchr(code, '\"')) = '\0';
-					message = g_strdup_printf(_("Program exited with code \"%i\""), (int)(char)strtol(code, NULL, 8));
+					gchar *message = g_strdup_printf(_("Program exited with code \"%i\""), exit_code);
 					dbg_cbs->report_error(message);
 
 					g_free(message);
@@ -570,47 +618,32 @@ static gboolean on_read_from_gdb(GIOChannel * src, GIOCondition cond, gpointer d
 			}
 		}
 	}
-	else if (g_str_has_prefix (line, "^error"))
+	else if ('^' == async_record->type && class_error == klass)
 	{
-		GList *lines, *iter;
-		char *msg;
+		gchar *msg;
 
 		/* removing read callback (will pulling all output left manually) */
 		g_source_remove(gdb_id_out);
 
+		/* get message, the record is overwritten by the output read below */
+		msg = g_strdup(mi_find_string(async_record, NULL, "msg"));
+
 		/* set debugger stopped if is running */
 		if (DBS_STOPPED != debug_get_state())
 		{
-			gchar *thread_id = strstr(line + strlen(line) + 1,"thread-id=\"");
-			*(strchr(thread_id, '\"')) = '\0'; 
-
-			dbg_cbs->set_stopped(atoi(thread_id));
+			value = mi_find_string(async_record, NULL, "thread-id");
+			dbg_cbs->set_stopped(value ? atoi(value) : 0);
 		}
 
-		/* get message */
-		msg = strstr(line, "msg=\"") + strlen("msg=\"");
-		*strrchr(msg, '\"') = '\0';
-		msg = g_strcompress(msg);
-		
 		/* reading until prompt */
-		lines = read_until_prompt();
-		for (iter = lines; iter; iter = iter->next)
-		{
-			gchar *l = (gchar*)iter->data;
-			if (strcmp(l, GDB_PROMPT))
-				colorize_message(l);
-			g_free(l);
-		}
-		g_list_free (lines);
+		read_until_prompt(TRUE);
 
 		/* send error message */
-		dbg_cbs->report_error(msg);
+		dbg_cbs->report_error(msg ? msg : "");
 
 		g_free(msg);
 	}
 
-	g_free(line);
-
 	return TRUE;
 }
 
@@ -633,69 +666,49 @@ static void exec_async_command(const gchar* command)
 }
 
 /*
- * execute "command" syncronously
- * i.e. reading output right
- * after execution
- */ 
-static result_class exec_sync_command(const gchar* command, gboolean wait4prompt, gchar** command_record)
+ * reads GDB output until prompt, looking for the result record
+ * of the command tagged with "token" (0 for an untagged command),
+ * the result record is left parsed in sync_record
+ */
+static result_class read_result(guint token, gchar** command_record)
 {
-	GList *lines, *iter;
-	result_class rc;
-
-#ifdef DEBUG_OUTPUT
-	dbg_cbs->send_message(command, "red");
-#endif
+	result_class rc = RC_ERROR;
 
-	/* write command to gdb input channel */
-	gdb_input_write_line(command);
-	
-	if (!wait4prompt)
-		return RC_DONE;
-	
-	lines = read_until_prompt();
+	while (read_line(gdb_ch_out) && strcmp(gdb_line->str, GDB_PROMPT))
+	{
+		gchar *line = gdb_line->str;
 
 #ifdef DEBUG_OUTPUT
-	for (iter = lines; iter; iter = iter->next)
-	{
-		dbg_cbs->send_message((gchar*)iter->data, "red");
-	}
+		dbg_cbs->send_message(line, "red");
 #endif
 
-	rc = RC_ERROR;
+		if ('^' == *(line + strspn(line, "0123456789")) && token == strtoul(line, NULL, 10))
+		{
+			gchar* coma;
 
-	for (iter = lines; iter; iter = iter->next)
-	{
-		gchar *line = (gchar*)iter->data;
+			/* the record is parsed in its own buffer,
+			the lines read up to the prompt overwrite the line buffer */
+			g_string_assign(result_line, line);
+			line = result_line->str;
 
-		if ('^' == line[0])
-		{
-			gchar* coma = strchr(line, ',');
-			if (coma)
-			{
-				*coma = '\0';
-				coma++;
-			}
-			else
-				coma = line + strlen(line);
-			
+			coma = strchr(line, ',');
 			if (command_record)
-			{
-				*command_record = (gchar*)g_malloc(strlen(coma) + 1);
-				strcpy(*command_record, coma);
-			}
-			
-			if (!strcmp(line, "^done"))
+				*command_record = g_strdup(coma ? coma + 1 : "");
+
+			/* a malformed record still has its class parsed */
+			mi_parse_record(sync_record, line);
+
+			if (class_done == sync_record->klass)
 				rc = RC_DONE;
-			else if (!strcmp(line, "^error"))
+			else if (class_error == sync_record->klass)
 			{
 				/* save error message */
-				gchar* msg = g_strcompress(strstr(coma, "msg=\"") + strlen("msg=\""));
-				strcpy(err_message, msg);
-				g_free(msg);
+				const gchar *msg = mi_find_string(sync_record, NULL, "msg");
+				g_strlcpy(err_message, msg ? msg : "", sizeof(err_message));
 				
 				rc = RC_ERROR;
 			}
-			else if (!strcmp(line, "^exit"))
+			else if (class_exit == sync_record->klass)
 				rc = RC_EXIT;
 		}
 		else if ('&' != line[0])
@@ -704,12 +717,124 @@ static result_class exec_sync_command(const gchar* command, gboolean wait4prompt
 		}
 	}
 	
-	g_list_foreach(lines, (GFunc)g_free, NULL);
-	g_list_free(lines);
-	
 	return rc;
 }
 
+/*
+ * execute "command" syncronously
+ * i.e. reading output right
+ * after execution
+ */ 
+static result_class exec_sync_command(const gchar* command, gboolean wait4prompt, gchar** command_record)
+{
+#ifdef DEBUG_OUTPUT
+	dbg_cbs->send_message(command, "red");
+#endif
+
+	/* write command to gdb input channel */
+	gdb_input_write_line(command);
+	
+	if (!wait4prompt)
+		return RC_DONE;
+	
+	return read_result(0, command_record);
+}
+
+/*
+ * queue "command" to be pipelined with other commands,
+ * "callback" is called with the parsed result record when it arrives
+ * and may queue the commands depending on the result
+ */ 
+static void pipe_command(const gchar* command, pipe_callback callback, gpointer data)
+{
+	pipe_item *item = g_malloc(sizeof(pipe_item));
+
+	/* tokens are positive, untagged results have no token */
+	if (!++pipe_token)
+		pipe_token++;
+
+	item->token = pipe_token;
+	item->command = g_strdup_printf("%u%s", item->token, command);
+	item->callback = callback;
+	item->data = data;
+
+	g_queue_push_tail(pipe_queued, item);
+}
+
+/*
+ * pipelined command callback, stores the result class to "data"
+ */ 
+static void on_command_done(result_class rc, const mi_record *record, gpointer data)
+{
+	*(result_class*)data = rc;
+}
+
+/*
+ * sends the queued commands without waiting for each result in turn
+ * and reads the results, until all queued commands are completed
+ */ 
+static void pipe_flush(void)
+{
+	while (!g_queue_is_empty(pipe_queued) || !g_queue_is_empty(pipe_sent))
+	{
+		pipe_item *item;
+		result_class rc;
+
+		/* limit the commands in flight, so that GDB never blocks
+		writing the output while we are still writing the commands */
+		while (!g_queue_is_empty(pipe_queued) && g_queue_get_length(pipe_sent) < PIPE_MAX_SENT)
+		{
+			item = (pipe_item*)g_queue_pop_head(pipe_queued);
+#ifdef DEBUG_OUTPUT
+			dbg_cbs->send_message(item->command, "red");
+#endif
+			gdb_input_write_line(item->command);
+			g_queue_push_tail(pipe_sent, item);
+		}
+
+		/* GDB executes the commands in order */
+		item = (pipe_item*)g_queue_pop_head(pipe_sent);
+		rc = read_result(item->token, NULL);
+		if (item->callback)
+			item->callback(rc, sync_record, item->data);
+
+		g_free(item->command);
+		g_free(item);
+	}
+}
+
+/*
+ * creates the output buffers and the command queues, interns the record class names,
+ * they are kept while the plugin is loaded
+ */
+static void init_parser(void)
+{
+	if (gdb_line)
+		return;
+
+	gdb_line = g_string_sized_new(1024);
+	result_line = g_string_sized_new(1024);
+	pipe_queued = g_queue_new();
+	pipe_sent = g_queue_new();
+	children_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)free_variables);
+	children_counts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	changed_variables = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	async_record = mi_record_new();
+	sync_record = mi_record_new();
+
+	class_done = g_intern_static_string("done");
+	class_error = g_intern_static_string("error");
+	class_exit = g_intern_static_string("exit");
+	class_running = g_intern_static_string("running");
+	class_stopped = g_intern_static_string("stopped");
+	class_thread_group_created = g_intern_static_string("thread-group-created");
+	class_thread_group_started = g_intern_static_string("thread-group-started");
+	class_thread_created = g_intern_static_string("thread-created");
+	class_thread_exited = g_intern_static_string("thread-exited");
+	class_library_loaded = g_intern_static_string("library-loaded");
+	class_library_unloaded = g_intern_static_string("library-unloaded");
+}
+
 /*
  * starts gdb, collects commands and start the first one
  */
@@ -719,7 +844,7 @@ static gboolean run(const gchar* file, const gchar* commandline, GList* env, GLi
 	const gchar *exclude[] = { "LANG", NULL };
 	gchar **gdb_env = utils_copy_environment(exclude, "LANG", "C", NULL);
 	gchar *working_directory = g_path_get_dirname(file);
-	GList *lines, *iter;
+	GList *iter;
 	GList *commands = NULL;
 	GString *command;
 	int bp_index;
@@ -727,6 +852,8 @@ static gboolean run(const gchar* file, const gchar* commandline, GList* env, GLi
 
 	dbg_cbs = callbacks;
 
+	init_parser();
+
 	/* spawn GDB */
 	if (!g_spawn_async_with_pipes(working_directory, (gchar**)gdb_args, gdb_env,
 				     GDB_SPAWN_FLAGS, NULL,
@@ -751,17 +878,7 @@ static gboolean run(const gchar* file, const gchar* commandline, GList* env, GLi
 	gdb_ch_out = g_io_channel_unix_new(gdb_out);
 
 	/* reading starting gdb messages */
-	lines = read_until_prompt();
-	for (iter = lines; iter; iter = iter->next)
-	{
-		gchar *unescaped = g_strcompress((gchar*)iter->data);
-		if (strlen(unescaped))
-		{
-			colorize_message((gchar*)iter->data);
-		}
-	}
-	g_list_foreach(lines, (GFunc)g_free, NULL);
-	g_list_free(lines);
+	read_until_prompt(TRUE);
 
 	/* add initial watches to the list */
 	while (witer)
@@ -1007,6 +1124,7 @@ static gboolean set_break(breakpoint* bp, break_set_activity bsa)
 		char *pos;
 		int number;
 		gchar *record = NULL;
+		result_class condition_rc = RC_DONE;
 
 		/* 1. insert breakpoint */
 		sprintf (command, "-break-insert \"\\\"%s\\\":%i\"", bp->file, bp->line);
@@ -1029,23 +1147,23 @@ static gboolean set_break(breakpoint* bp, break_set_activity bsa)
 		if (bp->hitscount)
 		{
 			sprintf (command, "-break-after %i %i", number, bp->hitscount);
-			exec_sync_command(command, TRUE, NULL);
+			pipe_command(command, NULL, NULL);
 		}
 		/* 3. set condition if exists */
 		if (strlen(bp->condition))
 		{
 			sprintf (command, "-break-condition %i %s", number, bp->condition);
-			if (RC_DONE != exec_sync_command(command, TRUE, NULL))
-				return FALSE;
+			pipe_command(command, on_command_done, &condition_rc);
 		}
 		/* 4. disable if disabled */
 		if (!bp->enabled)
 		{
 			sprintf (command, "-break-disable %i", number);
-			exec_sync_command(command, TRUE, NULL);
+			pipe_command(command, NULL, NULL);
 		}
+		pipe_flush();
 		
-		return TRUE;
+		return RC_DONE == condition_rc;
 	}
 	else
 	{
@@ -1106,102 +1224,83 @@ static void set_active_frame(int frame_number)
 		active_frame = frame_number;
 		update_autos();
 		update_watches();
+		update_changes();
 	}
 	g_free(command);
 }
 
 /*
- * gets stack
+ * gets stack depth
+ */
+static int get_stack_depth(void)
+{
+	gchar* record = NULL;
+	const gchar *depth;
+	int value = 0;
+
+	if (RC_DONE != exec_sync_command("-stack-info-depth", TRUE, &record))
+		return 0;
+
+	mi_parse_results(sync_record, record);
+	if ( (depth = mi_find_string(sync_record, NULL, "depth")) )
+		value = atoi(depth);
+
+	free(record);
+
+	return value;
+}
+
+/*
+ * gets stack frames from "low" to "high" inclusive
  */
-static GList* get_stack(void)
+static GList* get_stack(int low, int high)
 {
 	gchar* record = NULL;
 	GList *stack = NULL;
-	gchar **frames, **next;
+	const mi_node *node;
 	result_class rc;
+	gchar *command;
 
-	rc = exec_sync_command("-stack-list-frames", TRUE, &record);
+	command = g_strdup_printf("-stack-list-frames %i %i", low, high);
+	rc = exec_sync_command(command, TRUE, &record);
+	g_free(command);
 	if (RC_DONE != rc)
 		return NULL;
 
-	frames = g_strsplit(record, "frame=", 0);
-	next = frames + 1;
-	while (*next)
+	mi_parse_results(sync_record, record);
+	node = mi_find(sync_record, NULL, "stack");
+	for (node = node ? mi_first(sync_record, node) : NULL; node; node = mi_next(sync_record, node))
 	{
 		frame *f = frame_new();
-		int line;
-		gchar *pos, *fullname, *file, *from;
-		
-		/* adresss */
-		pos = strstr(*next, "addr=\"") + strlen("addr=\"");
-		*strchr(pos, '\"') = '\0';
-		f->address = g_strdup(pos);
-		pos += strlen(pos) + 1;
+		const gchar *address, *function, *fullname, *file, *line;
 
-		/* function */
-		pos = strstr(pos, "func=\"") + strlen("func=\"");
-		*strchr(pos, '\"') = '\0';
-		f->function = g_strdup(pos);
-		pos += strlen(pos) + 1;
+		/* adresss and function */
+		address = mi_find_string(sync_record, node, "addr");
+		function = mi_find_string(sync_record, node, "func");
+		f->address = g_strdup(address ? address : "");
+		f->function = g_strdup(function ? function : "");
 
 		/* file: fullname | file | from */
-		fullname = strstr(pos, "fullname=\"");
-		file = strstr(pos, "file=\"");
-		from = strstr(pos, "from=\"");
-		
+		fullname = mi_find_string(sync_record, node, "fullname");
 		if (fullname)
-		{
-			fullname += strlen("fullname=\"");
-			pos = fullname;
-			*strchr(pos, '\"') = '\0';
-			f->file = g_strdup(pos);
-			pos += strlen(pos) + 1;
-		}
-		else if (file)
-		{
-			file += strlen("file=\"");
-			pos = file;
-			*strchr(pos, '\"') = '\0';
-			f->file = g_strdup(pos);
-			pos += strlen(pos) + 1;
-		}
-		else if (from)
-		{
-			from += strlen("from=\"");
-			pos = from;
-			*strchr(pos, '\"') = '\0';
-			f->file = g_strdup(pos);
-			pos += strlen(pos) + 1;
-		}
-		else
-		{
-			f->file = g_strdup("");
-		}
-		
+			file = fullname;
+		else if (!(file = mi_find_string(sync_record, node, "file")))
+			file = mi_find_string(sync_record, node, "from");
+		f->file = g_strdup(file ? file : "");
+
 		/* whether source is available */
 		f->have_source = fullname ? TRUE : FALSE;
 
 		/* line */
-		line = 0;
-		pos = strstr(pos, "line=\"");
-		if (pos)
-		{
-			pos += strlen("line=\"");
-			*strchr(pos, '\"') = '\0';
-			line = atoi(pos);
-			pos += strlen(pos) + 1;
-		}
-		f->line = line;
-
-		stack = g_list_append(stack, f);
+		line = mi_find_string(sync_record, node, "line");
+		f->line = line ? atoi(line) : 0;
 
-		next++;
+		stack = g_list_prepend(stack, f);
 	}
-	g_strfreev(frames);	
 	
 	free(record);
 	
-	return stack;
+	return g_list_reverse(stack);
 }
 
 /*
@@ -1274,12 +1373,20 @@ static gchar* unescape_octal_values(gchar *text)
 {
 	GString *value = g_string_new("");
 	
-	gboolean utf8 = g_str_has_suffix(getenv("LANG"), "UTF-8");
+	/* the values are formatted as they are shown, the locale is checked once */
+	static gint utf8 = -1;
 
 	gchar *tmp = g_strdup(text);
 	gchar *unescaped = g_strcompress(tmp);
 
 	gchar *pos = unescaped;
+
+	if (utf8 < 0)
+	{
+		const gchar *lang = getenv("LANG");
+		utf8 = lang && g_str_has_suffix(lang, "UTF-8");
+	}
+
 	while (*pos)
 	{
 		if (isvalidcharacter(pos, utf8))
@@ -1313,6 +1420,7 @@ static gchar* unescape_octal_values(gchar *text)
 		}
 	}
 
+	g_free(unescaped);
 	g_free(tmp);
 
 	return g_string_free (value, FALSE);
@@ -1344,102 +1452,182 @@ static gchar *unescape(gchar *text)
 }
 
 /*
- * updates variables from vars list 
+ * unescapes value string already unescaped once by the record parser
  */
-static void get_variables (GList *vars)
+static gchar *unescape_parsed(const gchar *text)
 {
-	while (vars)
-	{
-		gchar command[1000];
-		
-		variable *var = (variable*)vars->data;
-
-		gchar *varname = var->internal->str;
-		gchar *record = NULL;
-		gchar *pos;
-		gchar *expression;
-		int numchild;
-		gchar *value;
+	if (strstr(text, "\\x"))
+		return unescape_hex_values((gchar*)text);
+	else
+		return unescape_octal_values((gchar*)text);
+}
 
-		/* path expression */
-		sprintf(command, "-var-info-path-expression \"%s\"", varname);
-		exec_sync_command(command, TRUE, &record);
-		pos = strstr(record, "path_expr=\"") + strlen("path_expr=\"");
-		*(strrchr(pos, '\"')) = '\0';
-		expression = unescape(pos);
-		g_string_assign(var->expression, expression);
-		g_free(expression);
-		g_free(record);
-		
-		/* children number */
-		sprintf(command, "-var-info-num-children \"%s\"", varname);
-		exec_sync_command(command, TRUE, &record);
-		pos = strstr(record, "numchild=\"") + strlen("numchild=\"");
-		*(strchr(pos, '\"')) = '\0';
-		numchild = atoi(pos);
-		var->has_children = numchild > 0;
-		g_free(record);
+/*
+ * assigns a variable value from a "-data-evaluate-expression" or
+ * "-var-evaluate-expression" result
+ */
+static gboolean assign_variable_value(variable *var, result_class rc, const mi_record *record)
+{
+	const gchar *value = RC_DONE == rc ? mi_find_string(record, NULL, "value") : NULL;
 
-		/* value */
-		sprintf(command, "-data-evaluate-expression \"%s\"", var->expression->str);
-		exec_sync_command(command, TRUE, &record);
-		pos = strstr(record, "value=\"");
-		if (!pos)
-		{
-			g_free(record);
-			sprintf(command, "-var-evaluate-expression \"%s\"", varname);
-			exec_sync_command(command, TRUE, &record);
-			pos = strstr(record, "value=\"");
-		}
-		pos +=  + strlen("value=\"");
-		*(strrchr(pos, '\"')) = '\0';
-		value = unescape(pos);
+	/* formatted when shown */
+	if (value)
 		g_string_assign(var->value, value);
-		g_free(value);
-		g_free(record);
 
-		/* type */
-		sprintf(command, "-var-info-type \"%s\"", varname);
-		exec_sync_command(command, TRUE, &record);
-		pos = strstr(record, "type=\"") + strlen("type=\"");
-		*(strchr(pos, '\"')) = '\0';
-		g_string_assign(var->type, pos);
-		g_free(record);
+	return NULL != value;
+}
 
-		vars = vars->next;
-	}
+/*
+ * "-var-evaluate-expression" result, a fallback if the expression can't be evaluated
+ */
+static void on_variable_evaluated(result_class rc, const mi_record *record, gpointer data)
+{
+	assign_variable_value((variable*)data, rc, record);
 }
 
 /*
- * updates files list
+ * "-data-evaluate-expression" result
  */
-static void update_files(void)
+static void on_expression_evaluated(result_class rc, const mi_record *record, gpointer data)
 {
-	GHashTable *ht = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL);
-	gchar *record = NULL;
-	gchar *pos;
+	variable *var = (variable*)data;
 
-	if (files)
+	if (!assign_variable_value(var, rc, record))
 	{
-		/* free previous list */
-		g_list_foreach(files, (GFunc)g_free, NULL);
-		g_list_free(files);
-		files = NULL;
+		gchar command[1000];
+		sprintf(command, "-var-evaluate-expression \"%s\"", var->internal->str);
+		pipe_command(command, on_variable_evaluated, var);
 	}
+}
 
-	exec_sync_command("-file-list-exec-source-files", TRUE, &record);
-	pos = record;
-	while ( (pos = strstr(pos, "fullname=\"")) )
-	{
-		pos += strlen("fullname=\"");
-		*(strchr(pos, '\"')) = '\0';
-		if (!g_hash_table_lookup(ht, pos))
+/*
+ * queues evaluating a variable value using its path expression
+ */
+static void pipe_evaluate_variable(variable *var)
+{
+	gchar command[1000];
+	sprintf(command, "-data-evaluate-expression \"%s\"", var->expression->str);
+	pipe_command(command, on_expression_evaluated, var);
+}
+
+/*
+ * assigns a variable path expression from a "-var-info-path-expression" result
+ */
+static void assign_path_expression(variable *var, result_class rc, const mi_record *record)
+{
+	const gchar *path = RC_DONE == rc ? mi_find_string(record, NULL, "path_expr") : NULL;
+
+	if (path)
+	{
+		gchar *expression = unescape_parsed(path);
+		g_string_assign(var->expression, expression);
+		g_free(expression);
+	}
+}
+
+/*
+ * "-var-info-path-expression" result, the value is evaluated using the path expression
+ */
+static void on_variable_path_expression(result_class rc, const mi_record *record, gpointer data)
+{
+	assign_path_expression((variable*)data, rc, record);
+	pipe_evaluate_variable((variable*)data);
+}
+
+/*
+ * "-var-info-path-expression" result for a listed child, the listing has the values
+ * of the simple children, only the compound ones are evaluated
+ */
+static void on_child_path_expression(result_class rc, const mi_record *record, gpointer data)
+{
+	assign_path_expression((variable*)data, rc, record);
+	if (((variable*)data)->has_children)
+		pipe_evaluate_variable((variable*)data);
+}
+
+/*
+ * "-var-info-num-children" result
+ */
+static void on_variable_num_children(result_class rc, const mi_record *record, gpointer data)
+{
+	const gchar *numchild = RC_DONE == rc ? mi_find_string(record, NULL, "numchild") : NULL;
+
+	((variable*)data)->has_children = numchild && atoi(numchild) > 0;
+}
+
+/*
+ * "-var-info-type" result
+ */
+static void on_variable_type(result_class rc, const mi_record *record, gpointer data)
+{
+	const gchar *type = RC_DONE == rc ? mi_find_string(record, NULL, "type") : NULL;
+
+	if (type)
+		g_string_assign(((variable*)data)->type, type);
+}
+
+/*
+ * updates variables from vars list,
+ * the commands for all variables are pipelined
+ */
+static void get_variables (GList *vars)
+{
+	while (vars)
+	{
+		gchar command[1000];
+		
+		variable *var = (variable*)vars->data;
+		gchar *varname = var->internal->str;
+
+		/* path expression, then value */
+		sprintf(command, "-var-info-path-expression \"%s\"", varname);
+		pipe_command(command, on_variable_path_expression, var);
+
+		/* children number */
+		sprintf(command, "-var-info-num-children \"%s\"", varname);
+		pipe_command(command, on_variable_num_children, var);
+
+		/* type */
+		sprintf(command, "-var-info-type \"%s\"", varname);
+		pipe_command(command, on_variable_type, var);
+
+		vars = vars->next;
+	}
+
+	pipe_flush();
+}
+
+/*
+ * updates files list
+ */
+static void update_files(void)
+{
+	GHashTable *ht = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL);
+	gchar *record = NULL;
+
+	if (files)
+	{
+		/* free previous list */
+		g_list_foreach(files, (GFunc)g_free, NULL);
+		g_list_free(files);
+		files = NULL;
+	}
+
+	exec_sync_command("-file-list-exec-source-files", TRUE, &record);
+	if (record && mi_parse_results(sync_record, record))
+	{
+		const mi_node *node = mi_find(sync_record, NULL, "files");
+
+		for (node = node ? mi_first(sync_record, node) : NULL; node; node = mi_next(sync_record, node))
 		{
-			g_hash_table_insert(ht, (gpointer)pos, (gpointer)1);
-			files = g_list_append(files, g_strdup(pos));
+			const gchar *fullname = mi_find_string(sync_record, node, "fullname");
+			if (fullname && !g_hash_table_lookup(ht, fullname))
+			{
+				g_hash_table_insert(ht, (gpointer)fullname, (gpointer)1);
+				files = g_list_prepend(files, g_strdup(fullname));
+			}
 		}
-			
-		pos += strlen(pos) + 1;
+		files = g_list_reverse(files);
 	}
 
 	g_hash_table_destroy(ht);
@@ -1447,152 +1635,358 @@ static void update_files(void)
 }
 
 /*
- * updates watches list 
+ * "-var-create" result, assigns the internal name of the variable
  */
-static void update_watches(void)
+static void on_variable_created(result_class rc, const mi_record *record, gpointer data)
+{
+	variable *var = (variable*)data;
+	const gchar *name = RC_DONE == rc ? mi_find_string(record, NULL, "name") : NULL;
+
+	var->evaluated = NULL != name;
+	g_string_assign(var->internal, name ? name : "");
+}
+
+/*
+ * queues creating a GDB variable for "var",
+ * floating variables are evaluated in the selected frame on every update
+ */
+static void pipe_create_variable(variable *var)
 {
 	gchar command[1000];
-	GList *updating = NULL;
+	gchar *escaped = g_strescape(var->name->str, NULL);
+
+	sprintf(command, "-var-create - @ \"%s\"", escaped);
+	g_free(escaped);
+
+	pipe_command(command, on_variable_created, var);
+}
+
+/*
+ * frees a list of variables
+ */
+static void free_variables(GList *vars)
+{
+	g_list_foreach(vars, (GFunc)variable_free, NULL);
+	g_list_free(vars);
+}
+
+/*
+ * checks whether the cached children belong to the GDB variable "data"
+ */
+static gboolean is_child_of(gpointer key, gpointer value, gpointer data)
+{
+	const gchar *internal = (const gchar*)data;
+	size_t len = strlen(internal);
+
+	return !strncmp((const gchar*)key, internal, len) && ('\0' == ((const gchar*)key)[len] || '.' == ((const gchar*)key)[len]);
+}
+
+/*
+ * removes the cached children of the GDB variable "internal" and of its children
+ */
+static void drop_children(const gchar *internal)
+{
+	g_hash_table_foreach_remove(children_cache, is_child_of, (gpointer)internal);
+	g_hash_table_foreach_remove(children_counts, is_child_of, (gpointer)internal);
+}
+
+/*
+ * deletes a GDB variable with its children
+ */
+static void pipe_delete_variable(variable *var)
+{
+	if (var->internal->len)
+	{
+		gchar command[1000];
+		sprintf(command, "-var-delete %s", var->internal->str);
+		pipe_command(command, NULL, NULL);
+
+		drop_children(var->internal->str);
+	}
+}
+
+/*
+ * updates watches list,
+ * GDB variables are kept between the updates, only those failed to be created are created again
+ */
+static void update_watches(void)
+{
+	GList *creating = NULL;
 	GList *iter;
 
-	/* delete all GDB variables */
 	for (iter = watches; iter; iter = iter->next)
 	{
 		variable *var = (variable*)iter->data;
 		
-		if (var->internal->len)
+		if (!var->internal->len)
 		{
-			sprintf(command, "-var-delete %s", var->internal->str);
-			exec_sync_command(command, TRUE, NULL);
+			variable_reset(var);
+			pipe_create_variable(var);
+			creating = g_list_prepend(creating, var);
 		}
-		
-		/* reset all variables fields */
-		variable_reset(var);
 	}
-	
-	/* create GDB variables, adding successfully created
-	variables to the list then passed for updatind */
-	for (iter = watches; iter; iter = iter->next)
+	pipe_flush();
+
+	/* successfully created variables are evaluated in full */
+	for (iter = creating; iter; iter = iter->next)
 	{
 		variable *var = (variable*)iter->data;
-		gchar *record = NULL;
-		gchar *pos;
-		gchar *escaped;
+		if (var->evaluated)
+			created = g_list_prepend(created, var);
+	}
+	g_list_free(creating);
+}
 
-		/* try to create variable */
-		escaped = g_strescape(var->name->str, NULL);
-		sprintf(command, "-var-create - * \"%s\"", escaped);
-		g_free(escaped);
+/*
+ * "-stack-list-arguments" and "-stack-list-locals" result,
+ * adds the listed variables to "data" list
+ */
+static void on_autos_listed(result_class rc, const mi_record *record, gpointer data, variable_type vt)
+{
+	GList **list = (GList**)data;
+	const mi_node *node = NULL;
 
-		if (RC_DONE != exec_sync_command(command, TRUE, &record))
+	if (RC_DONE != rc)
+		return;
+
+	if (VT_ARGUMENT == vt)
+	{
+		/* stack-args=[frame={level="0",args=[name="a",...]}] */
+		if ( (node = mi_find(record, NULL, "stack-args")) && (node = mi_first(record, node)) )
+			node = mi_find(record, node, "args");
+	}
+	else
+		node = mi_find(record, NULL, "locals");
+
+	for (node = node ? mi_first(record, node) : NULL; node; node = mi_next(record, node))
+	{
+		const gchar *name;
+
+		/* "name" results or, with values, tuples with a "name" */
+		if (MI_STRING == node->type)
+			name = node->name && !strcmp(node->name, "name") ? node->value : NULL;
+		else
+			name = mi_find_string(record, node, "name");
+
+		if (name)
+			*list = g_list_prepend(*list, variable_new((gchar*)name, vt));
+	}
+}
+
+static void on_arguments_listed(result_class rc, const mi_record *record, gpointer data)
+{
+	on_autos_listed(rc, record, data, VT_ARGUMENT);
+}
+
+static void on_locals_listed(result_class rc, const mi_record *record, gpointer data)
+{
+	on_autos_listed(rc, record, data, VT_LOCAL);
+}
+
+/*
+ * checks whether the listed autos are the same as the current ones
+ */
+static gboolean autos_unchanged(GList *listed)
+{
+	if (g_list_length(listed) != g_list_length(autos))
+		return FALSE;
+
+	for (; listed; listed = listed->next)
+	{
+		variable *var = (variable*)listed->data;
+		GList *iter;
+
+		for (iter = autos; iter; iter = iter->next)
 		{
-			/* do not include to updating list, move to next watch */
-			var->evaluated = FALSE;
-			g_string_assign(var->internal, "");
-			g_free(record);
-			
-			continue;
+			variable *current = (variable*)iter->data;
+			if (var->vt == current->vt && !strcmp(var->name->str, current->name->str))
+				break;
 		}
-		
-		/* find and assign internal name */
-		pos = strstr(record, "name=\"") + strlen("name=\"");
-		*strchr(pos, '\"') = '\0'; 
-		g_string_assign(var->internal, pos);
-		g_free(record);			
-		
-		var->evaluated = TRUE;
-
-		/* add to updating list */
-		updating = g_list_append(updating, var);
+		if (!iter)
+			return FALSE;
 	}
-	
-	/* update watches */
-	get_variables(updating);
 
-	/* free updating list */
-	g_list_free(updating);
+	return TRUE;
 }
 
 /*
- * updates autos list 
+ * updates autos list,
+ * while the same variables are listed their GDB variables are kept,
+ * otherwise the autos are created again
  */
 static void update_autos(void)
 {
 	gchar command[1000];
-	GList *unevaluated = NULL, *iter;
-	const char *gdb_commands[2];
-	int i;
+	GList *listed = NULL, *unevaluated = NULL, *iter;
+
+	/* list current autos */
+	sprintf(command, "-stack-list-arguments 0 %i %i", active_frame, active_frame);
+	pipe_command(command, on_arguments_listed, &listed);
+	pipe_command("-stack-list-locals 0", on_locals_listed, &listed);
+	pipe_flush();
+
+	if (autos_unchanged(listed))
+	{
+		free_variables(listed);
+		return;
+	}
 
 	/* remove all previous GDB variables for autos */
 	for (iter = autos; iter; iter = iter->next)
+		pipe_delete_variable((variable*)iter->data);
+
+	free_variables(autos);
+	autos = NULL;
+
+	/* create the new ones */
+	for (iter = listed; iter; iter = iter->next)
+		pipe_create_variable((variable*)iter->data);
+	pipe_flush();
+
+	/* split the incorrect variables, the listed ones are in reverse order */
+	for (iter = listed; iter; iter = iter->next)
 	{
 		variable *var = (variable*)iter->data;
-		
-		sprintf(command, "-var-delete %s", var->internal->str);
-		exec_sync_command(command, TRUE, NULL);
+		if (var->evaluated)
+		{
+			autos = g_list_prepend(autos, var);
+			created = g_list_prepend(created, var);
+		}
+		else
+			unevaluated = g_list_prepend(unevaluated, var);
 	}
-
-	g_list_foreach(autos, (GFunc)variable_free, NULL);
-	g_list_free(autos);
-	autos = NULL;
-	
-	/* add current autos to the list */
+	g_list_free(listed);
 	
-	gdb_commands[0] = g_strdup_printf("-stack-list-arguments 0 %i %i", active_frame, active_frame);
-	gdb_commands[1] = "-stack-list-locals 0";
-	for (i = 0; i < sizeof (gdb_commands) / sizeof(*gdb_commands); i++)
+	/* add incorrect variables */
+	autos = g_list_concat(autos, unevaluated);
+}
+
+/*
+ * adds the GDB variables of "vars" list to the index
+ */
+static void index_variables(GHashTable *index, GList *vars)
+{
+	for (; vars; vars = vars->next)
 	{
-		gchar *record = NULL, *pos;
+		variable *var = (variable*)vars->data;
+		if (var->internal->len)
+			g_hash_table_insert(index, var->internal->str, var);
+	}
+}
 
-		result_class rc = exec_sync_command(gdb_commands[i], TRUE, &record);
-		if (RC_DONE != rc)
-			break;
+static void index_children(gpointer key, gpointer value, gpointer data)
+{
+	index_variables((GHashTable*)data, (GList*)value);
+}
 
-		pos = record;
-		while ((pos = strstr(pos, "name=\"")))
-		{
-			variable *var;
-			gchar *create_record = NULL, *escaped;
+/* data for the "-var-update" result */
+typedef struct _changes {
+	GHashTable *index;
+	GList *dropped;
+} changes;
 
-			pos += strlen("name=\"");
-			*(strchr(pos, '\"')) = '\0';
+/*
+ * "-var-update" result, applies the changes to the variables
+ */
+static void on_variables_updated(result_class rc, const mi_record *record, gpointer data)
+{
+	changes *ch = (changes*)data;
+	const mi_node *node;
 
-			var = variable_new(pos, i ? VT_LOCAL : VT_ARGUMENT);
+	if (RC_DONE != rc || !(node = mi_find(record, NULL, "changelist")))
+		return;
 
-			/* create new gdb variable */
-			escaped = g_strescape(pos, NULL);
-			sprintf(command, "-var-create - * \"%s\"", escaped);
-			g_free(escaped);
+	for (node = mi_first(record, node); node; node = mi_next(record, node))
+	{
+		const gchar *name = mi_find_string(record, node, "name");
+		const gchar *in_scope = mi_find_string(record, node, "in_scope");
+		const gchar *value = mi_find_string(record, node, "value");
+		const gchar *type = mi_find_string(record, node, "new_type");
+		const gchar *numchild = mi_find_string(record, node, "new_num_children");
+		variable *var;
 
-			/* form new variable */
-			if (RC_DONE == exec_sync_command(command, TRUE, &create_record))
-			{
-				gchar *intname = strstr(create_record, "name=\"") + strlen ("name=\"");
-				*strchr(intname, '\"') = '\0';
-				var->evaluated = TRUE;
-				g_string_assign(var->internal, intname);
-				autos = g_list_append(autos, var);
+		if (name)
+			g_hash_table_insert(changed_variables, g_strdup(name), GINT_TO_POINTER(TRUE));
 
-				g_free(create_record);
-			}
-			else
-			{
-				var->evaluated = FALSE;
-				g_string_assign(var->internal, "");
-				unevaluated = g_list_append(unevaluated, var);
-			}
-			
-			pos += strlen(pos) + 1;
-		}
-		g_free(record);
+		if (!name || !(var = (variable*)g_hash_table_lookup(ch->index, name)))
+			continue;
+
+		var->evaluated = !in_scope || !strcmp(in_scope, "true");
+		if (!var->evaluated)
+			continue;
+
+		if (type)
+			g_string_assign(var->type, type);
+		if (numchild)
+			var->has_children = atoi(numchild) > 0;
+
+		/* the listed children are no longer valid, they are dropped after the index is no longer used */
+		if (type || numchild)
+			ch->dropped = g_list_prepend(ch->dropped, g_strdup(name));
+
+		/* compound values are evaluated separately */
+		if (value && !var->has_children)
+			g_string_assign(var->value, value);
 	}
-	g_free((void*)gdb_commands[0]);
-	
-	/* get values for the autos (without incorrect variables) */
-	get_variables(autos);
-	
-	/* add incorrect variables */
-	autos = g_list_concat(autos, unevaluated);
+}
+
+/*
+ * queues evaluating the compound variables of "vars" list, that are not created since the last update
+ */
+static void pipe_evaluate_compound(GList *vars)
+{
+	for (; vars; vars = vars->next)
+	{
+		variable *var = (variable*)vars->data;
+		if (var->evaluated && var->has_children && !g_list_find(created, var))
+			pipe_evaluate_variable(var);
+	}
+}
+
+static void evaluate_children(gpointer key, gpointer value, gpointer data)
+{
+	pipe_evaluate_compound((GList*)value);
+}
+
+/*
+ * updates the variables values from the GDB variables changes,
+ * the variables created since the last update are evaluated in full
+ */
+static void update_changes(void)
+{
+	changes ch;
+	GList *iter;
+
+	ch.index = g_hash_table_new(g_str_hash, g_str_equal);
+	ch.dropped = NULL;
+
+	g_hash_table_remove_all(changed_variables);
+	updates_count++;
+
+	index_variables(ch.index, autos);
+	index_variables(ch.index, watches);
+	g_hash_table_foreach(children_cache, index_children, ch.index);
+
+	pipe_command("-var-update --all-values *", on_variables_updated, &ch);
+	pipe_flush();
+
+	g_hash_table_destroy(ch.index);
+	for (iter = ch.dropped; iter; iter = iter->next)
+		drop_children((gchar*)iter->data);
+	g_list_foreach(ch.dropped, (GFunc)g_free, NULL);
+	g_list_free(ch.dropped);
+
+	/* the values of the compound variables are shown in full,
+	a change inside isn't reported for them */
+	pipe_evaluate_compound(autos);
+	pipe_evaluate_compound(watches);
+	g_hash_table_foreach(children_cache, evaluate_children, NULL);
+
+	/* get_variables() flushes the pipe */
+	created = g_list_reverse(created);
+	get_variables(created);
+	g_list_free(created);
+	created = NULL;
 }
 
 /*
@@ -1616,72 +2010,157 @@ static GList* get_watches (void)
  */
 static GList* get_files (void)
 {
+	if (file_refresh_needed)
+	{
+		update_files();
+		file_refresh_needed = FALSE;
+	}
+
 	return g_list_copy(files);
 }
 
+/*
+ * get list of the children, those from "from" to "to" (excluded) if "from" isn't negative
+ */
+static GList* list_children (gchar* path, int from, int to)
+{
+	GList *children = NULL, *copy = NULL, *iter;
+	gpointer cached;
+	gchar *key = from < 0 ? g_strdup(path) : g_strdup_printf("%s.@%d", path, from);
+
+	if (g_hash_table_lookup_extended(children_cache, key, NULL, &cached))
+	{
+		children = (GList*)cached;
+		g_free(key);
+	}
+	else
+	{
+		gchar command[1000];
+		gchar *record = NULL;
+		const mi_node *node;
+
+		/* the values come with the children list,
+		GDB creates the variables of the listed children only */
+		if (from < 0)
+			sprintf(command, "-var-list-children --all-values \"%s\"", path);
+		else
+			sprintf(command, "-var-list-children --all-values \"%s\" %d %d", path, from, to);
+		if (RC_DONE != exec_sync_command(command, TRUE, &record))
+		{
+			g_free(record);
+			g_free(key);
+			return NULL;
+		}
+
+		mi_parse_results(sync_record, record);
+		node = mi_find(sync_record, NULL, "children");
+		for (node = node ? mi_first(sync_record, node) : NULL; node; node = mi_next(sync_record, node))
+		{
+			const gchar *internal = mi_find_string(sync_record, node, "name");
+			const gchar *name = mi_find_string(sync_record, node, "exp");
+			const gchar *numchild = mi_find_string(sync_record, node, "numchild");
+			const gchar *type = mi_find_string(sync_record, node, "type");
+			const gchar *value = mi_find_string(sync_record, node, "value");
+			variable *var;
+
+			if (!internal || !name)
+				continue;
+
+			var = variable_new2((gchar*)name, (gchar*)internal, VT_CHILD);
+			var->evaluated = TRUE;
+			var->has_children = numchild && atoi(numchild) > 0;
+			if (type)
+				g_string_assign(var->type, type);
+			if (value && !var->has_children)
+				g_string_assign(var->value, value);
+
+			children = g_list_prepend(children, var);
+		}
+		children = g_list_reverse(children);
+		g_free(record);
+
+		/* path expressions, and values of the compound children */
+		for (iter = children; iter; iter = iter->next)
+		{
+			variable *var = (variable*)iter->data;
+			sprintf(command, "-var-info-path-expression \"%s\"", var->internal->str);
+			pipe_command(command, on_child_path_expression, var);
+		}
+		pipe_flush();
+
+		/* kept until the parent changes its type or is deleted,
+		the values are updated from the GDB variables changes */
+		g_hash_table_insert(children_cache, key, children);
+	}
+
+	/* the caller frees the list */
+	for (iter = children; iter; iter = iter->next)
+	{
+		variable *var = (variable*)iter->data;
+		variable *child = variable_new2(var->name->str, var->internal->str, var->vt);
+
+		g_string_assign(child->expression, var->expression->str);
+		g_string_assign(child->type, var->type->str);
+		g_string_assign(child->value, var->value->str);
+		child->has_children = var->has_children;
+		child->evaluated = var->evaluated;
+
+		copy = g_list_prepend(copy, child);
+	}
+
+	return g_list_reverse(copy);
+}
+
 /*
  * get list of children 
  */
 static GList* get_children (gchar* path)
 {
-	GList *children = NULL;
-	
+	return list_children(path, -1, -1);
+}
+
+/*
+ * get the number of children
+ */
+static int get_children_count (gchar* path)
+{
+	gpointer cached;
+	int count = 0;
 	gchar command[1000];
-	result_class rc;
 	gchar *record = NULL;
-	gchar *pos = NULL;
-	int numchild;
 
-	/* children number */
+	if (g_hash_table_lookup_extended(children_counts, path, NULL, &cached))
+		return GPOINTER_TO_INT(cached);
+
 	sprintf(command, "-var-info-num-children \"%s\"", path);
-	rc = exec_sync_command(command, TRUE, &record);
-	if (RC_DONE != rc)
-		return NULL;
-	pos = strstr(record, "numchild=\"") + strlen("numchild=\"");
-	*(strchr(pos, '\"')) = '\0';
-	numchild = atoi(pos);
-	g_free(record);
-	if (!numchild)
-		return NULL;
-	
-	/* recursive get children and put into list */
-	sprintf(command, "-var-list-children \"%s\"", path);
-	rc = exec_sync_command(command, TRUE, &record);
-	if (RC_DONE == rc)
+	if (RC_DONE == exec_sync_command(command, TRUE, &record))
 	{
-		pos = record;
-		while ( (pos = strstr(pos, "child={")) )
-		{
-			gchar *name, *internal;
-			variable *var;
-			
-			/* name */
-			pos = strstr(pos, "name=\"") + strlen("name=\"");
-			*(strstr(pos, "\",exp=\"")) = '\0';
-			internal = pos;
-			pos += strlen(pos) + 1;
-
-			/* exp */
-			pos = strstr(pos, "exp=\"") + strlen("exp=\"");
-			*(strstr(pos, "\",numchild=\"")) = '\0';
-			
-			name = g_strcompress(pos);
-			
-			var = variable_new2(name, internal, VT_CHILD);
-			var->evaluated = TRUE;
-			
-			pos += strlen(pos) + 1;
+		const gchar *numchild;
 
-			children = g_list_append(children, var);
-		
-			g_free(name);
-		}
+		mi_parse_results(sync_record, record);
+		numchild = mi_find_string(sync_record, NULL, "numchild");
+		count = numchild ? atoi(numchild) : 0;
+		g_hash_table_insert(children_counts, g_strdup(path), GINT_TO_POINTER(count));
 	}
 	g_free(record);
-	
-	get_variables(children);
 
-	return children;
+	return count;
+}
+
+/*
+ * get list of the children from "from" to "to" (excluded)
+ */
+static GList* get_children_range (gchar* path, int from, int to)
+{
+	return list_children(path, from, to);
+}
+
+/*
+ * formats a value for display, it is kept as parsed from the GDB records
+ */
+static gchar* format_value (const gchar* value)
+{
+	return unescape_parsed(value);
 }
 
 /*
@@ -1689,33 +2168,19 @@ static GList* get_children (gchar* path)
  */
 static variable* add_watch(gchar* expression)
 {
-	gchar command[1000];
-	gchar *record = NULL, *escaped, *pos;
 	GList *vars = NULL;
 	variable *var = variable_new(expression, VT_WATCH);
 
 	watches = g_list_append(watches, var);
 
 	/* try to create a variable */
-	escaped = g_strescape(expression, NULL);
-	sprintf(command, "-var-create - * \"%s\"", escaped);
-	g_free(escaped);
-
-	if (RC_DONE != exec_sync_command(command, TRUE, &record))
-	{
-		g_free(record);
+	pipe_create_variable(var);
+	pipe_flush();
+	if (!var->evaluated)
 		return var;
-	}
-	
-	pos = strstr(record, "name=\"") + strlen("name=\"");
-	*strchr(pos, '\"') = '\0'; 
-	g_string_assign(var->internal, pos);
-	var->evaluated = TRUE;
 
 	vars = g_list_append(NULL, var);
 	get_variables(vars);
-
-	g_free(record);
 	g_list_free(vars);
 
 	return var;	
@@ -1732,16 +2197,88 @@ static void remove_watch(gchar* internal)
 		variable *var = (variable*)iter->data;
 		if (!strcmp(var->internal->str, internal))
 		{
-			gchar command[1000];
-			sprintf(command, "-var-delete %s", internal);
-			exec_sync_command(command, TRUE, NULL);
+			pipe_delete_variable(var);
+			pipe_flush();
 			variable_free(var);
 			watches = g_list_delete_link(watches, iter);
+			break;
 		}
 		iter = iter->next;
 	}
 }
 
+/*
+ * creates the GDB variable of a calltip, which is kept until removed,
+ * so that its changes are known
+ */
+static variable* add_calltip(gchar* expression)
+{
+	GList *vars = NULL;
+	variable *var = variable_new(expression, VT_WATCH);
+
+	calltips = g_list_prepend(calltips, var);
+
+	pipe_create_variable(var);
+	pipe_flush();
+	if (!var->evaluated)
+		return var;
+
+	vars = g_list_append(NULL, var);
+	get_variables(vars);
+	g_list_free(vars);
+
+	return var;
+}
+
+/*
+ * removes the GDB variable of a calltip
+ */
+static void remove_calltip(gchar* internal)
+{
+	GList *iter;
+	for (iter = calltips; iter; iter = iter->next)
+	{
+		variable *var = (variable*)iter->data;
+		if (!strcmp(var->internal->str, internal))
+		{
+			pipe_delete_variable(var);
+			pipe_flush();
+			variable_free(var);
+			calltips = g_list_delete_link(calltips, iter);
+			break;
+		}
+	}
+}
+
+/*
+ * gets the number of the GDB variables updates
+ */
+static guint get_updates_count(void)
+{
+	return updates_count;
+}
+
+/*
+ * checks whether the last update changed the GDB variable "internal" or one of its children
+ */
+static gboolean is_changed(gchar* internal)
+{
+	GHashTableIter iter;
+	gpointer name;
+
+	if (g_hash_table_lookup(changed_variables, internal))
+		return TRUE;
+
+	g_hash_table_iter_init(&iter, changed_variables);
+	while (g_hash_table_iter_next(&iter, &name, NULL))
+	{
+		if (is_child_of(name, NULL, internal))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 /*
  * evaluates given expression and returns the result
  */
@@ -46,8 +46,8 @@ extern GeanyData *geany_data;
 
 /* keyfile debug group name */
 #define DEBUGGER_GROUP "debugger"
-/* saving interval */
-#define SAVING_INTERVAL 2000000
+/* delay after the last change before saving, in milliseconds */
+#define SAVING_DELAY 1000
 
 /* check button for a configure dialog */
 static GtkWidget *save_to_project_btn = NULL;
@@ -66,13 +66,24 @@ static GKeyFile *keyfile_project = NULL;
  * to prevent change state to modified from GUI callbacks */
 static gboolean debug_config_loading = FALSE;
 
-/* saving thread staff */
-static GMutex *change_config_mutex;
-static GCond *cond;
+/* saving thread staff: keyfiles are serialized on the GUI thread when
+ * the saving timeout expires and the resulting data is written to disk
+ * on the saving thread, which is the only one taking the queue items */
+typedef struct _saving_job {
+	gchar *path;
+	gchar *data;
+} saving_job;
+
+static GAsyncQueue *saving_queue;
 static GThread *saving_thread;
+static guint saving_source = 0;
+
+/* last data queued for writing, to skip writing unchanged files */
+static gchar *plugin_config_data = NULL;
+static gchar *project_config_data = NULL;
 
 /* flags that indicate that part of a config has been changed and
- * is going to be saved on the savng thread */
+ * is going to be saved when the saving timeout expires */
 static gboolean debug_config_changed = FALSE;
 static gboolean panel_config_changed = FALSE;
 
@@ -100,6 +111,7 @@ static void debug_load_from_keyfile(GKeyFile *keyfile)
 {
 	gchar *value;
 	int i, count;
+	GList *breaks;
 
 	debug_config_loading = TRUE;
 	
@@ -143,6 +155,7 @@ static void debug_load_from_keyfile(GKeyFile *keyfile)
 	}
 
 	/* breakpoints */
+	breaks = NULL;
 	count = g_key_file_get_integer(keyfile, DEBUGGER_GROUP, "breaks_count", NULL);
 	for (i = 0; i < count; i++)
 	{
@@ -158,7 +171,7 @@ static void debug_load_from_keyfile(GKeyFile *keyfile)
 		int hits_count = g_key_file_get_integer(keyfile, DEBUGGER_GROUP, break_hits_id, NULL);
 		gboolean enabled = g_key_file_get_boolean(keyfile, DEBUGGER_GROUP, break_enabled_id, NULL);
 		
-		breaks_add(file, line, condition, enabled, hits_count);
+		breaks = g_list_prepend(breaks, break_new_full(file, line, condition, enabled, hits_count));
 
 		g_free(break_file_id);
 		g_free(break_line_id);
@@ -169,6 +182,7 @@ static void debug_load_from_keyfile(GKeyFile *keyfile)
 		g_free(file);
 		g_free(condition);
 	}
+	breaks_add_list(g_list_reverse(breaks));
 	bptree_update_file_nodes();
 
 	debug_config_loading = FALSE;
@@ -269,68 +283,110 @@ static void save_to_keyfile(GKeyFile *keyfile)
  */
 static gpointer saving_thread_func(gpointer data)
 {
-	GTimeVal interval;
-	GMutex *m = g_mutex_new();
-	do
+	saving_job *job;
+
+	while ((job = (saving_job*)g_async_queue_pop(saving_queue))->path)
 	{
-		g_mutex_lock(change_config_mutex);
-		
-		if (
-			panel_config_changed ||
-			(debug_config_changed && DEBUG_STORE_PLUGIN == dstore)
-		)
-		{
-			gchar *config_data;
+		g_file_set_contents(job->path, job->data, -1, NULL);
 
-			/* if all saving is going to be done to a plugin keyfile */
-			if (debug_config_changed)
-			{
-				save_to_keyfile(keyfile_plugin);
-				debug_config_changed = FALSE;
-			}
-			
-			config_data = g_key_file_to_data(keyfile_plugin, NULL, NULL);
-			g_file_set_contents(plugin_config_path, config_data, -1, NULL);
-			g_free(config_data);
+		g_free(job->path);
+		g_free(job->data);
+		g_free(job);
+	}
+	g_free(job);
 
-			panel_config_changed = FALSE;
+	return NULL;
+}
+
+/*
+ * queues a keyfile to be written on the saving thread if its contents
+ * differ from what has been written the last time
+ */
+static void queue_keyfile(const gchar *path, GKeyFile *keyfile, gchar **last_data)
+{
+	saving_job *job;
+	gchar *data = g_key_file_to_data(keyfile, NULL, NULL);
+
+	if (!g_strcmp0(data, *last_data))
+	{
+		g_free(data);
+		return;
+	}
+
+	g_free(*last_data);
+	*last_data = g_strdup(data);
+
+	job = g_new(saving_job, 1);
+	job->path = g_strdup(path);
+	job->data = data;
+	g_async_queue_push(saving_queue, job);
+}
+
+/*
+ * saves changed config parts, called on the GUI thread
+ */
+static gboolean saving_timeout(gpointer data)
+{
+	saving_source = 0;
+
+	if (debug_config_changed)
+	{
+		/* only the debugger group is rebuilt, the rest of the keyfile is kept */
+		if (DEBUG_STORE_PLUGIN == dstore)
+		{
+			save_to_keyfile(keyfile_plugin);
+			panel_config_changed = TRUE;
 		}
-		
-		if (debug_config_changed && DEBUG_STORE_PROJECT == dstore)
+		else
 		{
-			gchar *config_data;
-
-			/* if debug is saved into a project and has been changed */
 			save_to_keyfile(keyfile_project);
-
-			config_data = g_key_file_to_data(keyfile_project, NULL, NULL);
-			g_file_set_contents(geany_data->app->project->file_name, config_data, -1, NULL);
-			g_free(config_data);
-		
-			debug_config_changed = FALSE;
+			queue_keyfile(geany_data->app->project->file_name, keyfile_project, &project_config_data);
 		}
-		
-		g_mutex_unlock(change_config_mutex);
+		debug_config_changed = FALSE;
+	}
 
-		g_get_current_time(&interval);
-		g_time_val_add(&interval, SAVING_INTERVAL);
+	if (panel_config_changed)
+	{
+		queue_keyfile(plugin_config_path, keyfile_plugin, &plugin_config_data);
+		panel_config_changed = FALSE;
 	}
-	while (!g_cond_timed_wait(cond, m, &interval));
-	g_mutex_free(m);
-	
-	return NULL;
+
+	return FALSE;
+}
+
+/*
+ * (re)starts saving timeout, so that a series of changes is saved once
+ */
+static void schedule_saving(void)
+{
+	if (saving_source)
+	{
+		g_source_remove(saving_source);
+	}
+	saving_source = g_timeout_add(SAVING_DELAY, saving_timeout, NULL);
 }
 
 /*
- * set "debug changed" flag to save it on "saving_thread" thread
+ * saves pending changes without waiting for the timeout
+ */
+static void flush_saving(void)
+{
+	if (saving_source)
+	{
+		g_source_remove(saving_source);
+		saving_timeout(NULL);
+	}
+}
+
+/*
+ * set "debug changed" flag to save it after a delay
  */
 void config_set_debug_changed(void)
 {
 	if (!debug_config_loading)
 	{
-		g_mutex_lock(change_config_mutex);
 		debug_config_changed = TRUE;
-		g_mutex_unlock(change_config_mutex);
+		schedule_saving();
 	}
 }
 
@@ -341,8 +397,6 @@ void config_set_panel(int config_part, gpointer config_value, ...)
 {
 	va_list ap;
 	
-	g_mutex_lock(change_config_mutex);
-	
 	va_start(ap, config_value);
 	
 	while(config_part)
@@ -396,8 +450,10 @@ void config_set_panel(int config_part, gpointer config_value, ...)
 		}
 	}
 	
+	va_end(ap);
+
 	panel_config_changed = TRUE;
-	g_mutex_unlock(change_config_mutex);
+	schedule_saving();
 }
 
 /*
@@ -449,20 +505,15 @@ void config_init(void)
 	g_mkdir_with_parents(config_dir, S_IRUSR | S_IWUSR | S_IXUSR);
 	g_free(config_dir);
 
+	saving_queue = g_async_queue_new();
+	saving_thread = g_thread_create(saving_thread_func, NULL, TRUE, NULL);
+
 	keyfile_plugin = g_key_file_new();
 	if (!g_key_file_load_from_file(keyfile_plugin, plugin_config_path, G_KEY_FILE_NONE, NULL))
 	{
-		gchar *data;
-
 		config_set_panel_defaults(keyfile_plugin);
-		data = g_key_file_to_data(keyfile_plugin, NULL, NULL);
-		g_file_set_contents(plugin_config_path, data, -1, NULL);
-		g_free(data);
+		queue_keyfile(plugin_config_path, keyfile_plugin, &plugin_config_data);
 	}
-
-	change_config_mutex = g_mutex_new();
-	cond = g_cond_new();
-	saving_thread = g_thread_create(saving_thread_func, NULL, TRUE, NULL);
 }	
 
 /*
@@ -470,12 +521,15 @@ void config_init(void)
  */
 void config_destroy(void)
 {
-	g_cond_signal(cond);
-	/* ??? g_thread_join(saving_thread); */	
-	
-	g_mutex_free(change_config_mutex);
-	g_cond_free(cond);
+	flush_saving();
+
+	/* a job without a path stops the saving thread once all the files are written */
+	g_async_queue_push(saving_queue, g_new0(saving_job, 1));
+	g_thread_join(saving_thread);
+	g_async_queue_unref(saving_queue);
 
+	g_free(plugin_config_data);
+	g_free(project_config_data);
 	g_free(plugin_config_path);
 	
 	g_key_file_free(keyfile_plugin);
@@ -531,6 +585,9 @@ void config_set_debug_store(debug_store store)
 {
 	GKeyFile *keyfile;
 
+	/* changes belong to the store being left */
+	flush_saving();
+
 	dstore = store;
 
 	tpage_clear();
@@ -540,15 +597,16 @@ void config_set_debug_store(debug_store store)
 	keyfile = DEBUG_STORE_PROJECT == dstore ? keyfile_project : keyfile_plugin;
 	if (!g_key_file_has_group(keyfile, DEBUGGER_GROUP))
 	{
-		gchar *data, *file;
-
 		config_set_debug_defaults(keyfile);
-		data = g_key_file_to_data(keyfile, NULL, NULL);
-
-		file = DEBUG_STORE_PROJECT == dstore ? geany_data->app->project->file_name : plugin_config_path;
-		g_file_set_contents(file, data, -1, NULL);
 
-		g_free(data);
+		if (DEBUG_STORE_PROJECT == dstore)
+		{
+			queue_keyfile(geany_data->app->project->file_name, keyfile, &project_config_data);
+		}
+		else
+		{
+			queue_keyfile(plugin_config_path, keyfile, &plugin_config_data);
+		}
 	}
 	
 	debug_load_from_keyfile(keyfile);
@@ -565,6 +623,9 @@ void config_update_project_keyfile(void)
 	}
 	keyfile_project = g_key_file_new();
 	g_key_file_load_from_file(keyfile_project, geany_data->app->project->file_name, G_KEY_FILE_NONE, NULL);
+
+	g_free(project_config_data);
+	project_config_data = NULL;
 }
 
 /*
@@ -630,6 +691,8 @@ void config_on_project_save(GObject *obj, GKeyFile *config, gpointer user_data)
 			g_key_file_free(keyfile_project);
 		}
 		keyfile_project = create_copy_keyfile(config);
+		g_free(project_config_data);
+		project_config_data = NULL;
 	}
 }
 
@@ -643,9 +706,8 @@ static void on_configure_response(GtkDialog* dialog, gint response, gpointer use
 	{
 		g_key_file_set_boolean(keyfile_plugin, "saving_settings", "save_to_project", newvalue);
 
-		g_mutex_lock(change_config_mutex);
 		panel_config_changed = TRUE;
-		g_mutex_unlock(change_config_mutex);
+		schedule_saving();
 
 		if (geany_data->app->project)
 		{
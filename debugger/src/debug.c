@@ -70,6 +70,11 @@ extern GeanyData		*geany_data;
 #define CALLTIP_HEIGHT 20
 #define CALLTIP_WIDTH 200
 
+/*
+ *  number of stack frames to get at once
+ */
+#define STACK_WINDOW 100
+
 /* module description structure (name/module pointer) */
 typedef struct _module_description {
 	const gchar *title;
@@ -135,10 +140,18 @@ static GtkWidget **sensitive_widget[] = {&stree, &wtree, &atree, NULL};
  */
 static GList* stack = NULL;
 
+/* 
+ * number of frames in the stack list
+ * and total stack depth
+ */
+static int stack_loaded = 0;
+static int stack_depth = 0;
+
 /*
- * pages which are loaded in debugger and therefore, are set readonly
+ * pages which are loaded in debugger and therefore, are set readonly,
+ * a set of the file names, NULL while empty
  */
-static GList *read_only_pages = NULL;
+static GHashTable *read_only_pages = NULL;
 
 /* available modules */
 static module_description modules[] = 
@@ -147,8 +160,82 @@ static module_description modules[] =
 	{ NULL, NULL }
 };
 
-/* calltips cache  */
+/* cached calltip, kept while the GDB variable it was evaluated from doesn't change */
+typedef struct _calltip_entry {
+	gchar *text;
+	gchar *internal;
+} calltip_entry;
+
+/* calltips cache by expression, an expression that can't be evaluated has no text
+ and the compound values keep no GDB variable, a change deep inside isn't reported.
+ The entries belong to the thread, the frame and the number of variables updates
+ they were checked at */
 static GHashTable *calltips = NULL;
+static int calltips_thread = 0;
+static gchar *calltips_frame = NULL;
+static guint calltips_updates = 0;
+
+/* incremented each time the cached calltips become stale,
+ so that a calltip requested before is not shown */
+static guint calltips_generation = 0;
+
+/* calltip request waiting to be evaluated */
+typedef struct _calltip_request {
+	gchar *expression;
+	calltip_callback callback;
+	gpointer data;
+	guint generation;
+} calltip_request;
+
+static calltip_request *calltip_pending = NULL;
+static guint calltip_source = 0;
+
+/*
+ * frees a cached calltip with its GDB variable
+ */
+static void calltip_entry_free(calltip_entry *entry)
+{
+	if (entry->internal)
+	{
+		active_module->remove_calltip(entry->internal);
+		g_free(entry->internal);
+	}
+	g_free(entry->text);
+	g_free(entry);
+}
+
+/*
+ * checks whether a cached calltip is to be dropped, "data" tells whether
+ * the context of the cache stays the same
+ */
+static gboolean is_calltip_stale(gpointer key, gpointer value, gpointer data)
+{
+	calltip_entry *entry = (calltip_entry*)value;
+	return !GPOINTER_TO_INT(data) || !entry->internal || active_module->is_changed(entry->internal);
+}
+
+/*
+ * drops the cached calltips which values may have changed and the one being requested,
+ * only the ones which GDB variables were not changed by the last update are kept,
+ * if the thread and the frame are the same and nothing else ran meanwhile
+ */
+static void refresh_calltips(int thread_id)
+{
+	frame *f = (frame*)g_list_nth_data(stack, active_module->get_active_frame());
+	guint updates = active_module->get_updates_count();
+	gboolean same_context = thread_id == calltips_thread && f && calltips_frame &&
+		!strcmp(f->address, calltips_frame) && updates == calltips_updates + 1;
+
+	debug_cancel_calltip();
+	if (calltips)
+		g_hash_table_foreach_remove(calltips, is_calltip_stale, GINT_TO_POINTER(same_context));
+	calltips_generation++;
+
+	calltips_thread = thread_id;
+	g_free(calltips_frame);
+	calltips_frame = f ? g_strdup(f->address) : NULL;
+	calltips_updates = updates;
+}
 
 /* 
  * remove stack margin markers
@@ -572,22 +659,34 @@ static void on_watch_expanded_callback(GtkTreeView *tree, GtkTreeIter *iter, Gtk
 	{
 		GList *children;
 		gchar *internal;
+		int page, count;
 
 		/* if item has not been expanded before */
 		gtk_tree_model_get (
 			model,
 			iter,
 			W_INTERNAL, &internal,
+			W_PAGE, &page,
 			-1);
 		
-		/* get children list */
-		children = active_module->get_children(internal);
-		
-		/* remove stub and add children */
-		expand_stub(tree, iter, children);
-		
-		/* free children list */
-		free_variables_list(children);
+		/* get children list, a page row lists its page of the parent children,
+		a variable with too many children gets page rows */
+		count = page ? 0 : active_module->get_children_count(internal);
+		if (count > WATCH_CHILDREN_PAGE)
+			expand_stub_pages(tree, iter, count);
+		else
+		{
+			if (page)
+				children = active_module->get_children_range(internal, page - 1, page - 1 + WATCH_CHILDREN_PAGE);
+			else
+				children = active_module->get_children(internal);
+
+			/* remove stub and add children */
+			expand_stub(tree, iter, children);
+
+			/* free children list */
+			free_variables_list(children);
+		}
 
 		/* unset W_STUB flag */
 		gtk_tree_store_set (store, iter,
@@ -633,6 +732,7 @@ static void on_debugger_run (void)
 		g_list_foreach(stack, (GFunc)frame_free, NULL);
 		g_list_free(stack);
 		stack = NULL;
+		stack_loaded = 0;
 
 		stree_remove_frames();
 	}
@@ -648,6 +748,57 @@ static void on_debugger_run (void)
 /* 
  * called from debug module when debugger is being stopped 
  */
+/*
+ * sets an open document readonly or writable if it is a source file
+ * in one of the sets and not in the other, sets being NULL when empty
+ */
+static void set_read_only_document(GeanyDocument *doc, GHashTable *old_pages, GHashTable *new_pages)
+{
+	gboolean was_read_only, read_only;
+
+	if (!doc->real_path)
+		return;
+
+	was_read_only = old_pages && g_hash_table_lookup(old_pages, doc->real_path);
+	read_only = new_pages && g_hash_table_lookup(new_pages, doc->real_path);
+	if (was_read_only != read_only)
+		scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, read_only, 0);
+}
+
+/*
+ * makes the source files list the readonly pages: the file list
+ * may hold tens of thousands of files while it seldom changes, so
+ * only a changed list is taken, and only the open documents
+ * whose status changed are touched then
+ */
+static void update_read_only_pages(GList *files)
+{
+	GHashTable *pages;
+	GList *iter;
+	guint count = 0;
+	int i;
+
+	/* same files as before */
+	for (iter = files; iter; iter = iter->next, count++)
+	{
+		if (!read_only_pages || !g_hash_table_lookup(read_only_pages, iter->data))
+			break;
+	}
+	if (!iter && count == (read_only_pages ? g_hash_table_size(read_only_pages) : 0))
+		return;
+
+	pages = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (iter = files; iter; iter = iter->next)
+		g_hash_table_replace(pages, g_strdup((gchar*)iter->data), GINT_TO_POINTER(TRUE));
+
+	foreach_document(i)
+		set_read_only_document(document_index(i), read_only_pages, pages);
+
+	if (read_only_pages)
+		g_hash_table_destroy(read_only_pages);
+	read_only_pages = pages;
+}
+
 static void on_debugger_stopped (int thread_id)
 {
 	GList *iter, *files, *autos, *watches;
@@ -661,9 +812,6 @@ static void on_debugger_stopped (int thread_id)
 		btnpanel_set_debug_state(debug_state);
 	}
 
-	/* clear calltips cache */
-	g_hash_table_remove_all(calltips);
-
 	/* if a stop was requested for asyncronous exiting -
 	 * stop debug module and exit */
 	if (exit_pending)
@@ -687,62 +835,25 @@ static void on_debugger_stopped (int thread_id)
 	/* clear stack tree view */
 	stree_set_active_thread_id(thread_id);
 
-	/* get current stack trace and put in the tree view */
-	stack = active_module->get_stack();
+	/* get first frames of the current stack trace and put in the tree view,
+	the rest of frames are loaded when scrolled to */
+	stack_depth = active_module->get_stack_depth();
+	stack = active_module->get_stack(0, STACK_WINDOW - 1);
 	for (iter = stack; iter; iter = iter->next)
 	{
 		frame *f = (frame*)iter->data;
 		stree_add(f);
+		stack_loaded++;
 	}
+	stree_set_frames_left(stack_depth - stack_loaded);
 	stree_select_first_frame(TRUE);
 
+	/* drop the calltips which values may have changed */
+	refresh_calltips(thread_id);
+
 	/* files */
 	files = active_module->get_files();
-	/* remove from list and make writable those files,
-	that are not in the current list */
-	iter = read_only_pages;
-	while (iter)
-	{
-		if (!g_list_find_custom(files, iter->data, (GCompareFunc)g_strcmp0))
-		{
-			GList *next;
-
-			/* set document writable */
-			GeanyDocument *doc = document_find_by_real_path((const gchar*)iter->data);
-			if (doc)
-				scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 0, 0);
-
-			/* free file name */
-			g_free(iter->data);
-			/* save next item pointer */
-			next = iter->next;
-			/* remove current item */
-			read_only_pages = g_list_delete_link(read_only_pages, iter);
-
-			/* set next item and continue */
-			iter = next;
-			continue;
-		}
-
-		iter = iter->next;
-	}
-	/* add to the list and make readonly those files
-	from the current list that are new */
-	iter = files;
-	while (iter)
-	{
-		if (!g_list_find_custom(read_only_pages, iter->data, (GCompareFunc)g_strcmp0))
-		{
-			/* set document readonly */
-			GeanyDocument *doc = document_find_by_real_path((const gchar*)iter->data);
-			if (doc)
-				scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 1, 0);
-
-			/* add new file to the list */
-			read_only_pages = g_list_append(read_only_pages, g_strdup((gchar*)iter->data));
-		}
-		iter = iter->next;
-	}
+	update_read_only_pages(files);
 	g_list_free(files);
 
 	/* autos */
@@ -782,7 +893,6 @@ static void on_debugger_exited (int code)
 {
 	GtkTextIter start, end;
 	GtkTextBuffer *buffer;
-	GList *iter;
 
 	/* remove marker for current instruction if was set */
 	if (stack)
@@ -791,6 +901,7 @@ static void on_debugger_exited (int code)
 		g_list_foreach(stack, (GFunc)frame_free, NULL);
 		g_list_free(stack);
 		stack = NULL;
+		stack_loaded = 0;
 	}
 	
 	/* clear watch page */
@@ -818,21 +929,23 @@ static void on_debugger_exited (int code)
 		bptree_set_readonly(FALSE);
 	
 	/* set files that was readonly during debug writable */
-	for (iter = read_only_pages; iter; iter = iter->next)
+	update_read_only_pages(NULL);
+	if (read_only_pages)
 	{
-		GeanyDocument *doc = document_find_by_real_path((const gchar*)iter->data);
-		if (doc)
-			scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 0, 0);
-
-		/* free file name */
-		g_free(iter->data);
+		g_hash_table_destroy(read_only_pages);
+		read_only_pages = NULL;
 	}
-	g_list_free(read_only_pages);
-	read_only_pages = NULL;
 
-	/* clear and destroy calltips cache */
-	g_hash_table_destroy(calltips);
-	calltips = NULL;
+	/* clear and destroy calltips cache, the GDB variables are gone */
+	debug_cancel_calltip();
+	if (calltips)
+	{
+		g_hash_table_destroy(calltips);
+		calltips = NULL;
+	}
+	calltips_generation++;
+	g_free(calltips_frame);
+	calltips_frame = NULL;
 
 	/* enable widgets */
 	enable_sensitive_widgets(TRUE);
@@ -914,6 +1027,33 @@ dbg_callbacks callbacks = {
  * Interface functions
  */
 
+/* 
+ * called when the stack tree is scrolled to the frames that are not loaded yet 
+ */
+static void on_load_frames(void)
+{
+	GList *frames, *iter;
+
+	if (DBS_STOPPED != debug_state)
+		return;
+
+	frames = active_module->get_stack(stack_loaded, stack_loaded + STACK_WINDOW - 1);
+	for (iter = frames; iter; iter = iter->next)
+	{
+		frame *f = (frame*)iter->data;
+		stree_add(f);
+		if (f->have_source)
+		{
+			markers_add_frame(f->file, f->line);
+		}
+		stack_loaded++;
+	}
+	stack = g_list_concat(stack, frames);
+
+	/* do not request frames again if none were got */
+	stree_set_frames_left(frames ? stack_depth - stack_loaded : 0);
+}
+
 /* 
  * called when a frame in the stack tree has been selected 
  */
@@ -926,8 +1066,8 @@ static void on_select_frame(int frame_number)
 
 	active_module->set_active_frame(frame_number);
 	
-	/* clear calltips cache */
-	g_hash_table_remove_all(calltips);
+	/* drop the calltips which values may have changed */
+	refresh_calltips(calltips_thread);
 	
 	/* autos */
 	autos = active_module->get_autos();
@@ -985,7 +1125,7 @@ void debug_init(void)
 	gtk_container_add(GTK_CONTAINER(tab_autos), atree);
 	
 	/* create stack trace page */
-	stree = stree_init(editor_open_position, on_select_frame);
+	stree = stree_init(editor_open_position, on_select_frame, on_load_frames);
 	tab_call_stack = gtk_scrolled_window_new(
 		gtk_tree_view_get_hadjustment(GTK_TREE_VIEW(stree )),
 		gtk_tree_view_get_vadjustment(GTK_TREE_VIEW(stree ))
@@ -1063,6 +1203,7 @@ void debug_destroy(void)
 		g_list_foreach(stack, (GFunc)frame_free, NULL);
 		g_list_free(stack);
 		stack = NULL;
+		stack_loaded = 0;
 	}
 	
 	stree_destroy();
@@ -1313,55 +1454,148 @@ gchar* debug_evaluate_expression(gchar *expression)
 }
 
 /*
- * return list of strings for the calltip
- * first line is a header, others should be shifted right with tab
+ * evaluates the calltip for the expression,
+ * first line is a header, others should be shifted right with tab,
+ * "internal" is set to the GDB variable kept for the calltip, if any
  */
-gchar* debug_get_calltip_for_expression(gchar* expression)
+static gchar* evaluate_calltip(gchar* expression, gchar **internal)
 {
-	gchar *calltip = NULL;
-	if (!calltips || !(calltip = g_hash_table_lookup(calltips, expression)))
+	GString *calltip_str = NULL;
+	variable *var = active_module->add_calltip(expression);
+
+	*internal = NULL;
+	if (!var)
+		return NULL;
+
+	if (var->evaluated)
 	{
-		GString *calltip_str = NULL;
-		variable *var = active_module->add_watch(expression);
-		if (var)
+		calltip_str = get_calltip_line(var, TRUE);
+		if (var->has_children)
 		{
-			calltip_str = get_calltip_line(var, TRUE);
-			if (var->has_children)
+			int lines_left = MAX_CALLTIP_HEIGHT - 1;
+			/* one more child than shown tells if there are more */
+			GList* children = active_module->get_children_range(var->internal->str, 0, MAX_CALLTIP_HEIGHT);
+			GList* child = children;
+			while(child && lines_left)
 			{
-				int lines_left = MAX_CALLTIP_HEIGHT - 1;
-				GList* children = active_module->get_children(var->internal->str); 
-				GList* child = children;
-				while(child && lines_left)
-				{
-					variable *varchild = (variable*)child->data;
-					GString *child_string = get_calltip_line(varchild, FALSE);
-					g_string_append_printf(calltip_str, "\n%s", child_string->str);
-					g_string_free(child_string, TRUE);
+				variable *varchild = (variable*)child->data;
+				GString *child_string = get_calltip_line(varchild, FALSE);
+				g_string_append_printf(calltip_str, "\n%s", child_string->str);
+				g_string_free(child_string, TRUE);
 
-					child = child->next;
-					lines_left--;
-				}
-				if (!lines_left && child)
-				{
-					g_string_append(calltip_str, "\n\t\t........");
-				}
-				g_list_foreach(children, (GFunc)variable_free, NULL);
-				g_list_free(children);
+				child = child->next;
+				lines_left--;
 			}
-
-			active_module->remove_watch(var->internal->str);
-
-			calltip = g_string_free(calltip_str, FALSE);
-
-			if (!calltips)
+			if (!lines_left && child)
 			{
-				calltips = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, (GDestroyNotify)g_free);
+				g_string_append(calltip_str, "\n\t\t........");
 			}
-			g_hash_table_insert(calltips, g_strdup(expression), calltip);
+			g_list_foreach(children, (GFunc)variable_free, NULL);
+			g_list_free(children);
 		}
 	}
 
-	return calltip;
+	if (var->evaluated && !var->has_children)
+		*internal = g_strdup(var->internal->str);
+	else
+		active_module->remove_calltip(var->internal->str);
+
+	return calltip_str ? g_string_free(calltip_str, FALSE) : NULL;
+}
+
+/*
+ * frees a calltip request
+ */
+static void calltip_request_free(calltip_request *request)
+{
+	g_free(request->expression);
+	g_free(request);
+}
+
+/*
+ * evaluates the pending calltip once the events queued meanwhile are handled,
+ * a dwell end or a newer hover has cancelled it already
+ */
+static gboolean on_calltip_idle(gpointer data)
+{
+	calltip_request *request = calltip_pending;
+	calltip_entry *entry;
+
+	calltip_source = 0;
+	calltip_pending = NULL;
+
+	if (DBS_STOPPED != debug_state || request->generation != calltips_generation)
+	{
+		calltip_request_free(request);
+		return FALSE;
+	}
+
+	entry = g_malloc(sizeof(calltip_entry));
+	entry->text = evaluate_calltip(request->expression, &entry->internal);
+
+	/* the failed evaluations are cached too, hovering them again costs nothing */
+	if (!calltips)
+	{
+		calltips = g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify)g_free, (GDestroyNotify)calltip_entry_free);
+	}
+	g_hash_table_insert(calltips, g_strdup(request->expression), entry);
+
+	if (entry->text)
+		request->callback(entry->text, request->data);
+
+	calltip_request_free(request);
+
+	return FALSE;
+}
+
+/*
+ * requests the calltip for the expression, "callback" is called with it
+ * right away if it is cached, or later, unless the request is cancelled
+ * by another one or by debug_cancel_calltip(), or the debugger resumes meanwhile.
+ * "callback" is not called if the expression can't be evaluated
+ */
+void debug_request_calltip(const gchar* expression, calltip_callback callback, gpointer data)
+{
+	calltip_entry *entry;
+
+	debug_cancel_calltip();
+
+	if (DBS_STOPPED != debug_state)
+		return;
+
+	if (calltips && (entry = (calltip_entry*)g_hash_table_lookup(calltips, expression)))
+	{
+		if (entry->text)
+			callback(entry->text, data);
+		return;
+	}
+
+	calltip_pending = g_malloc(sizeof(calltip_request));
+	calltip_pending->expression = g_strdup(expression);
+	calltip_pending->callback = callback;
+	calltip_pending->data = data;
+	calltip_pending->generation = calltips_generation;
+
+	/* low priority, so that the mouse leaving or moving to another word
+	cancels the request before GDB is asked */
+	calltip_source = g_idle_add_full(G_PRIORITY_LOW, on_calltip_idle, NULL, NULL);
+}
+
+/*
+ * cancels the calltip request in progress, if any
+ */
+void debug_cancel_calltip(void)
+{
+	if (calltip_source)
+	{
+		g_source_remove(calltip_source);
+		calltip_source = 0;
+	}
+	if (calltip_pending)
+	{
+		calltip_request_free(calltip_pending);
+		calltip_pending = NULL;
+	}
 }
 
 /*
@@ -1390,7 +1624,7 @@ void debug_jump_to_current_instruction(void)
 void debug_on_file_open(GeanyDocument *doc)
 {
 	const gchar *file = DOC_FILENAME(doc);
-	if (g_list_find_custom(read_only_pages, (gpointer)file, (GCompareFunc)g_strcmp0))
+	if (read_only_pages && g_hash_table_lookup(read_only_pages, file))
 		scintilla_send_message(doc->editor->sci, SCI_SETREADONLY, 1, 0);
 }
 
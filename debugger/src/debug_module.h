@@ -116,7 +116,8 @@ typedef struct _dbg_module {
 	gboolean (*set_break) (breakpoint* bp, break_set_activity bsa);
 	gboolean (*remove_break) (breakpoint* bp);
 
-	GList* (*get_stack) (void);
+	int (*get_stack_depth) (void);
+	GList* (*get_stack) (int low, int high);
 
 	void (*set_active_frame)(int frame_number);
 	int (*get_active_frame)(void);
@@ -127,10 +128,23 @@ typedef struct _dbg_module {
 	GList* (*get_files) (void);
 
 	GList* (*get_children) (gchar* path);
+	/* the number of children, and a page of them, from "from" to "to" (excluded) */
+	int (*get_children_count) (gchar* path);
+	GList* (*get_children_range) (gchar* path, int from, int to);
 	variable* (*add_watch)(gchar* expression);
 	void (*remove_watch)(gchar* path);
 
+	/* variables kept for the cached calltips, the number of the variables
+	updates and whether the last one changed a variable or its children */
+	variable* (*add_calltip)(gchar* expression);
+	void (*remove_calltip)(gchar* internal);
+	guint (*get_updates_count)(void);
+	gboolean (*is_changed)(gchar* internal);
+
 	gchar* (*evaluate_expression)(gchar *expression);
+	/* variables values are kept as the debugger gives them,
+	they are formatted for display when shown */
+	gchar* (*format_value)(const gchar *value);
 	
 	gboolean (*request_interrupt) (void);
 	gchar* (*error_message) (void);
@@ -151,6 +165,7 @@ typedef struct _dbg_module {
 	execute_until, \
 	set_break, \
 	remove_break, \
+	get_stack_depth, \
 	get_stack, \
 	set_active_frame, \
 	get_active_frame, \
@@ -158,9 +173,16 @@ typedef struct _dbg_module {
 	get_watches, \
 	get_files, \
 	get_children, \
+	get_children_count, \
+	get_children_range, \
 	add_watch, \
 	remove_watch, \
+	add_calltip, \
+	remove_calltip, \
+	get_updates_count, \
+	is_changed, \
 	evaluate_expression, \
+	format_value, \
 	request_interrupt, \
 	error_message, \
 	MODULE_FEATURES }
@@ -0,0 +1,295 @@
+/*
+ *		gdb_mi.c
+ *
+ *      Copyright 2010 Alexander Petukhov <devel(at)apetukhov.ru>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/*
+ *		GDB/MI output records parser.
+ *		Records are parsed in place, in a single pass: names and strings are
+ *		terminated and unescaped inside the line, all values of a record
+ *		are kept in one array that is reused for the next record.
+ */
+
+#include <string.h>
+
+#include "gdb_mi.h"
+
+#define NODE(record, index) (&g_array_index((record)->nodes, mi_node, (index)))
+
+/*
+ * unescapes a C string in place, "text" points to the opening quote
+ * the unescaped string starts at the quote position,
+ * returns position after the closing quote or NULL on error
+ */
+static gchar *parse_cstring(gchar *text)
+{
+	gchar *out = text;
+	gchar *in = text + 1;
+
+	while (TRUE)
+	{
+		gchar c = *in++;
+
+		if ('"' == c)
+		{
+			*out = '\0';
+			return in;
+		}
+		else if ('\0' == c)
+			return NULL;
+		else if ('\\' == c)
+		{
+			c = *in++;
+			switch (c)
+			{
+				case '\0':
+					return NULL;
+				case 'n':
+					c = '\n';
+					break;
+				case 't':
+					c = '\t';
+					break;
+				case 'r':
+					c = '\r';
+					break;
+				case 'b':
+					c = '\b';
+					break;
+				case 'f':
+					c = '\f';
+					break;
+				case 'v':
+					c = '\v';
+					break;
+				default:
+					if (c >= '0' && c <= '7')
+					{
+						gint value = c - '0';
+						gint digits = 1;
+
+						while (digits++ < 3 && *in >= '0' && *in <= '7')
+							value = value * 8 + *in++ - '0';
+						c = (gchar)value;
+					}
+					break;
+			}
+		}
+
+		*out++ = c;
+	}
+}
+
+/*
+ * parses comma separated values until "end" character,
+ * the values are linked as children of the "parent" node (-1 for the top level)
+ * returns position after "end" or NULL on error
+ */
+static gchar *parse_values(mi_record *record, gchar *text, gchar end, gint parent)
+{
+	gint previous = -1;
+
+	if (end == *text)
+		return end ? text + 1 : text;
+
+	while (TRUE)
+	{
+		mi_node node = { NULL, MI_STRING, NULL, -1, -1 };
+		gint index;
+
+		/* lists may contain values without names */
+		if (g_ascii_isalpha(*text) || '_' == *text)
+		{
+			node.name = text;
+			while (g_ascii_isalnum(*text) || '_' == *text || '-' == *text || '.' == *text)
+				text++;
+			if ('=' != *text)
+				return NULL;
+			*text++ = '\0';
+		}
+
+		index = record->nodes->len;
+		g_array_append_val(record->nodes, node);
+		if (previous >= 0)
+			NODE(record, previous)->next = index;
+		else if (parent >= 0)
+			NODE(record, parent)->child = index;
+		else
+			record->results = index;
+		previous = index;
+
+		if ('"' == *text)
+		{
+			NODE(record, index)->value = text;
+			if (!(text = parse_cstring(text)))
+				return NULL;
+		}
+		else if ('{' == *text || '[' == *text)
+		{
+			gchar close = '{' == *text ? '}' : ']';
+
+			NODE(record, index)->type = '{' == *text ? MI_TUPLE : MI_LIST;
+			if (!(text = parse_values(record, text + 1, close, index)))
+				return NULL;
+		}
+		else
+			return NULL;
+
+		if (',' == *text)
+			text++;
+		else if (end == *text)
+			return end ? text + 1 : text;
+		else
+			return NULL;
+	}
+}
+
+/*
+ * resets the record before parsing
+ */
+static void reset_record(mi_record *record)
+{
+	record->type = '\0';
+	record->klass = NULL;
+	record->stream = NULL;
+	record->results = -1;
+	g_array_set_size(record->nodes, 0);
+}
+
+/*
+ * creates a record to parse lines with
+ */
+mi_record *mi_record_new(void)
+{
+	mi_record *record = g_malloc(sizeof(mi_record));
+
+	record->nodes = g_array_new(FALSE, FALSE, sizeof(mi_node));
+	reset_record(record);
+
+	return record;
+}
+
+/*
+ * frees a record
+ */
+void mi_record_free(mi_record *record)
+{
+	g_array_free(record->nodes, TRUE);
+	g_free(record);
+}
+
+/*
+ * parses a GDB/MI output line in place,
+ * the record class name is interned, so it can be compared by address
+ * returns FALSE if the line is not a valid record (e.g. the prompt)
+ */
+gboolean mi_parse_record(mi_record *record, gchar *line)
+{
+	gchar *klass;
+
+	reset_record(record);
+
+	/* skip the command token */
+	while (g_ascii_isdigit(*line))
+		line++;
+
+	record->type = *line;
+	switch (*line)
+	{
+		case '~':
+		case '@':
+		case '&':
+			/* stream record */
+			record->stream = line + 1;
+			return '"' == line[1] && parse_cstring(line + 1);
+		case '^':
+		case '*':
+		case '+':
+		case '=':
+			/* result or async record */
+			klass = ++line;
+			while (*line && ',' != *line)
+				line++;
+			if (',' == *line)
+			{
+				*line++ = '\0';
+				record->klass = g_intern_string(klass);
+				return NULL != parse_values(record, line, '\0', -1);
+			}
+			record->klass = g_intern_string(klass);
+			return TRUE;
+	}
+
+	record->type = '\0';
+	return FALSE;
+}
+
+/*
+ * parses a comma separated list of results in place,
+ * i.e. a result record text after the class name
+ */
+gboolean mi_parse_results(mi_record *record, gchar *text)
+{
+	reset_record(record);
+
+	return NULL != parse_values(record, text, '\0', -1);
+}
+
+/*
+ * returns the first member of a tuple or list "node",
+ * or the first result of a record if "node" is NULL
+ */
+const mi_node *mi_first(const mi_record *record, const mi_node *node)
+{
+	gint index = node ? node->child : record->results;
+
+	return index >= 0 ? NODE(record, index) : NULL;
+}
+
+/*
+ * returns the next member after "node"
+ */
+const mi_node *mi_next(const mi_record *record, const mi_node *node)
+{
+	return node->next >= 0 ? NODE(record, node->next) : NULL;
+}
+
+/*
+ * finds a member of "node" (a record result if NULL) by name
+ */
+const mi_node *mi_find(const mi_record *record, const mi_node *node, const gchar *name)
+{
+	for (node = mi_first(record, node); node; node = mi_next(record, node))
+	{
+		if (node->name && !strcmp(node->name, name))
+			return node;
+	}
+
+	return NULL;
+}
+
+/*
+ * finds a string member of "node" (a record result if NULL) by name
+ */
+const gchar *mi_find_string(const mi_record *record, const mi_node *node, const gchar *name)
+{
+	node = mi_find(record, node, name);
+
+	return node && MI_STRING == node->type ? node->value : NULL;
+}
@@ -0,0 +1,63 @@
+/*
+ *		gdb_mi.h
+ *
+ *      Copyright 2010 Alexander Petukhov <devel(at)apetukhov.ru>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef GDB_MI_H
+#define GDB_MI_H
+
+#include <glib.h>
+
+/* type of a value in a GDB/MI record */
+typedef enum _mi_type {
+	MI_STRING,
+	MI_TUPLE,
+	MI_LIST
+} mi_type;
+
+/* a value in a GDB/MI record, tuples and lists link their members by index */
+typedef struct _mi_node {
+	const gchar *name;
+	mi_type type;
+	const gchar *value;
+	gint child;
+	gint next;
+} mi_node;
+
+/* a parsed GDB/MI record, the strings point into the parsed line */
+typedef struct _mi_record {
+	gchar type;
+	const gchar *klass;
+	const gchar *stream;
+	gint results;
+	GArray *nodes;
+} mi_record;
+
+mi_record*		mi_record_new(void);
+void			mi_record_free(mi_record *record);
+
+gboolean		mi_parse_record(mi_record *record, gchar *line);
+gboolean		mi_parse_results(mi_record *record, gchar *text);
+
+const mi_node*	mi_first(const mi_record *record, const mi_node *node);
+const mi_node*	mi_next(const mi_record *record, const mi_node *node);
+const mi_node*	mi_find(const mi_record *record, const mi_node *node, const gchar *name);
+const gchar*	mi_find_string(const mi_record *record, const mi_node *node, const gchar *name);
+
+#endif /* guard */
@@ -65,6 +65,9 @@ extern GeanyData		*geany_data;
 
 #define LIGHT_YELLOW	RGB(200,200,0)
 
+/* set on the scintilla of a document which markers are not applied yet */
+#define MARKERS_DIRTY_KEY	"debugger-markers-dirty"
+
 /*
  * sets markers for a scintilla document
  */
@@ -90,6 +93,34 @@ void markers_set_for_document(ScintillaObject *sci)
 
 	/* frame marker current */
 	scintilla_send_message(sci, SCI_MARKERDEFINEPIXMAP, M_FRAME, (long)frame_xpm);
+
+	g_object_set_data(G_OBJECT(sci), MARKERS_DIRTY_KEY, NULL);
+}
+
+/*
+ * marks a document to have its markers applied when it is activated,
+ * until then the markers changes for it are skipped
+ */
+void markers_set_dirty(GeanyDocument *doc)
+{
+	g_object_set_data(G_OBJECT(doc->editor->sci), MARKERS_DIRTY_KEY, GINT_TO_POINTER(TRUE));
+}
+
+/*
+ * whether the markers of a document are still to be applied
+ */
+gboolean markers_is_dirty(GeanyDocument *doc)
+{
+	return NULL != g_object_get_data(G_OBJECT(doc->editor->sci), MARKERS_DIRTY_KEY);
+}
+
+/*
+ * finds an opened document to change the markers of
+ */
+static GeanyDocument* find_document(const gchar *file)
+{
+	GeanyDocument *doc = document_find_by_filename(file);
+	return doc && !markers_is_dirty(doc) ? doc : NULL;
 }
 
 /*
@@ -97,10 +128,53 @@ void markers_set_for_document(ScintillaObject *sci)
  */
 void markers_init(void)
 {
-	/* set markers in all currently opened documents */
+	/* markers are applied to the currently opened documents when they are activated */
 	int i;
 	foreach_document(i)
-		markers_set_for_document(document_index(i)->editor->sci);
+		markers_set_dirty(document_index(i));
+}
+
+/*
+ * sets breakpoint marker in a document
+ */
+static void add_breakpoint_marker(GeanyDocument *doc, breakpoint* bp)
+{
+	if (!bp->enabled)
+	{
+		sci_set_marker_at_line(doc->editor->sci, bp->line - 1, M_BP_DISABLED);
+	}
+	else if (strlen(bp->condition) || bp->hitscount)
+	{
+			sci_set_marker_at_line(doc->editor->sci, bp->line - 1, M_BP_CONDITIONAL);
+	}
+	else
+	{
+			sci_set_marker_at_line(doc->editor->sci, bp->line - 1, M_BP_ENABLED);
+	}
+}
+
+/*
+ * removes breakpoint marker from a document
+ */
+static void remove_breakpoint_marker(GeanyDocument *doc, breakpoint* bp)
+{
+	static int breakpoint_markers[] = {
+		M_BP_ENABLED,
+		M_BP_DISABLED,
+		M_BP_CONDITIONAL
+	};
+
+	int markers = scintilla_send_message(doc->editor->sci, SCI_MARKERGET, bp->line - 1, (long)NULL);
+	int markers_count = sizeof(breakpoint_markers) / sizeof(breakpoint_markers[0]);
+	int i = 0;
+	for (; i < markers_count; i++)
+	{
+		int marker = breakpoint_markers[i];
+		if (markers & (0x01 << marker))
+		{
+			sci_delete_marker_at_line(doc->editor->sci, bp->line - 1, marker);
+		}
+	}
 }
 
 /*
@@ -111,21 +185,10 @@ void markers_init(void)
  */
 void markers_add_breakpoint(breakpoint* bp)
 {
-	GeanyDocument *doc = document_find_by_filename(bp->file);
+	GeanyDocument *doc = find_document(bp->file);
 	if (doc)
 	{
-		if (!bp->enabled)
-		{
-			sci_set_marker_at_line(doc->editor->sci, bp->line - 1, M_BP_DISABLED);
-		}
-		else if (strlen(bp->condition) || bp->hitscount)
-		{
-				sci_set_marker_at_line(doc->editor->sci, bp->line - 1, M_BP_CONDITIONAL);
-		}
-		else
-		{
-				sci_set_marker_at_line(doc->editor->sci, bp->line - 1, M_BP_ENABLED);
-		}
+		add_breakpoint_marker(doc, bp);
 	}
 }
 
@@ -134,35 +197,61 @@ void markers_add_breakpoint(breakpoint* bp)
  */
 void markers_remove_breakpoint(breakpoint *bp)
 {
-	static int breakpoint_markers[] = {
-		M_BP_ENABLED,
-		M_BP_DISABLED,
-		M_BP_CONDITIONAL
-	};
-
-	GeanyDocument *doc = document_find_by_filename(bp->file);
+	GeanyDocument *doc = find_document(bp->file);
 	if (doc)
 	{
-		int markers = scintilla_send_message(doc->editor->sci, SCI_MARKERGET, bp->line - 1, (long)NULL);
-		int markers_count = sizeof(breakpoint_markers) / sizeof(breakpoint_markers[0]);
-		int i = 0;
-		for (; i < markers_count; i++)
+		remove_breakpoint_marker(doc, bp);
+	}
+}
+
+/*
+ * calls a marker function for each breakpoint of the list,
+ * looking up a document once for the consecutive breakpoints of a file
+ */
+static void foreach_breakpoint_document(GList *breaks, void (*func)(GeanyDocument *doc, breakpoint *bp))
+{
+	GeanyDocument *doc = NULL;
+	const gchar *file = NULL;
+
+	for (; breaks; breaks = breaks->next)
+	{
+		breakpoint *bp = (breakpoint*)breaks->data;
+		if (!file || strcmp(file, bp->file))
 		{
-			int marker = breakpoint_markers[i];
-			if (markers & (0x01 << marker))
-			{
-				sci_delete_marker_at_line(doc->editor->sci, bp->line - 1, marker);
-			}
+			file = bp->file;
+			doc = find_document(file);
 		}
+		if (doc)
+			func(doc, bp);
 	}
 }
 
+/*
+ * add markers for a list of breakpoints
+ * arguments:
+ * 		breaks - list of breakpoints, better grouped by file
+ */
+void markers_add_breakpoints(GList *breaks)
+{
+	foreach_breakpoint_document(breaks, add_breakpoint_marker);
+}
+
+/*
+ * removes markers for a list of breakpoints
+ * arguments:
+ * 		breaks - list of breakpoints, better grouped by file
+ */
+void markers_remove_breakpoints(GList *breaks)
+{
+	foreach_breakpoint_document(breaks, remove_breakpoint_marker);
+}
+
 /*
  * adds current instruction marker
  */
 void markers_add_current_instruction(char* file, int line)
 {
-	GeanyDocument *doc = document_find_by_filename(file);
+	GeanyDocument *doc = find_document(file);
 	if (doc)
 	{
 		sci_set_marker_at_line(doc->editor->sci, line - 1, M_CI_ARROW);
@@ -175,7 +264,7 @@ void markers_add_current_instruction(char* file, int line)
  */
 void markers_remove_current_instruction(char* file, int line)
 {
-	GeanyDocument *doc = document_find_by_filename(file);
+	GeanyDocument *doc = find_document(file);
 	if (doc)
 	{
 		sci_delete_marker_at_line(doc->editor->sci, line - 1, M_CI_ARROW);
@@ -189,7 +278,7 @@ void markers_remove_current_instruction(char* file, int line)
  */
 void markers_add_frame(char* file, int line)
 {
-	GeanyDocument *doc = document_find_by_filename(file);
+	GeanyDocument *doc = find_document(file);
 	if (doc)
 	{
 		sci_set_marker_at_line(doc->editor->sci, line - 1, M_FRAME);
@@ -201,7 +290,7 @@ void markers_add_frame(char* file, int line)
  */
 void markers_remove_frame(char* file, int line)
 {
-	GeanyDocument *doc = document_find_by_filename(file);
+	GeanyDocument *doc = find_document(file);
 	if (doc)
 	{
 		sci_delete_marker_at_line(doc->editor->sci, line - 1, M_FRAME);
@@ -28,8 +28,12 @@
 
 void markers_init(void);
 void markers_set_for_document(ScintillaObject *sci);
+void markers_set_dirty(GeanyDocument *doc);
+gboolean markers_is_dirty(GeanyDocument *doc);
 void markers_add_breakpoint(breakpoint* bp);
 void markers_remove_breakpoint(breakpoint* bp);
+void markers_add_breakpoints(GList *breaks);
+void markers_remove_breakpoints(GList *breaks);
 void markers_add_current_instruction(char* file, int line);
 void markers_remove_current_instruction(char* file, int line);
 void markers_add_frame(char* file, int line);
@@ -40,6 +40,7 @@
 #include "tabs.h"
 #include "envtree.h"
 #include "pixbuf.h"
+#include "startprof.h"
 
 /* These items are set by Geany before plugin_init() is called. */
 GeanyPlugin		*geany_plugin;
@@ -68,6 +69,7 @@ PluginCallback plugin_callbacks[] =
 	 * can prevent Geany from processing the notification. Use this with care. */
 	{ "editor-notify", (GCallback) &on_editor_notify, FALSE, NULL },
 	{ "document_open", (GCallback) &on_document_open, FALSE, NULL },
+	{ "document_activate", (GCallback) &on_document_activate, FALSE, NULL },
 	{ "document_save", (GCallback) &on_document_save, FALSE, NULL },
 	{ "document_before_save", (GCallback) &on_document_before_save, FALSE, NULL },
 	{ "project_open", (GCallback) &config_on_project_open, FALSE, NULL },
@@ -84,9 +86,9 @@ static void on_paned_mode_changed(GtkToggleButton *button, gpointer user_data)
 	tpage_pack_widgets(state);
 }
 
-/* Called by Geany to initialize the plugin.
+/* Called by Geany to initialize the plugin, through plugin_init() below.
  * Note: data is the same as geany_data. */
-void plugin_init(GeanyData *data)
+static void init_plugin(GeanyData *data)
 {
 	GtkWidget* vbox;
 	int i;
@@ -116,6 +118,10 @@ void plugin_init(GeanyData *data)
 	/* load config */
 	config_init();
 
+	/* set markers for the document shown, the others get them on activation */
+	if (document_get_current())
+		on_document_activate(NULL, document_get_current(), NULL);
+
 	/* init paned */
 	dpaned_init();
 	tpage_pack_widgets(config_get_tabbed());
@@ -148,6 +154,8 @@ void plugin_init(GeanyData *data)
 	}
 }
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init_plugin)
+
 /* Called by Geany to show the plugin's configure dialog. This function is always called after
  * plugin_init() was called.
  * You can omit this function if the plugin doesn't need to be configured.
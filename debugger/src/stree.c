@@ -63,6 +63,16 @@ static int active_frame_index = 0;
 /* callbacks */
 static select_frame_cb select_frame = NULL;
 static move_to_line_cb move_to_line = NULL;
+static load_frames_cb load_frames = NULL;
+
+/*
+ * frames of the active thread are loaded by windows,
+ * the row after the loaded frames stands for the rest of them
+ * and next window is requested when it gets visible
+ */
+static int frames_count = 0;
+static int frames_left = 0;
+static guint load_frames_source = 0;
 
 /* tree view, model and store handles */
 static GtkWidget *tree = NULL;
@@ -72,13 +82,82 @@ static GtkTreeStore *store = NULL;
 /* cell renderer for a frame arrow */
 static GtkCellRenderer *renderer_arrow = NULL;
 
+/* 
+ * checks whether a path points to the row of not loaded frames
+ */
+static gboolean is_frames_left_row(GtkTreePath *path)
+{
+	return frames_left && 2 == gtk_tree_path_get_depth(path) && gtk_tree_path_get_indices(path)[1] == frames_count;
+}
+
+/* 
+ * gets the active thread row path
+ */
+static GtkTreePath* get_active_thread_path(void)
+{
+	GtkTreeRowReference *reference = (GtkTreeRowReference*)g_hash_table_lookup(threads, (gpointer)active_thread_id);
+	return reference ? gtk_tree_row_reference_get_path(reference) : NULL;
+}
+
+/* 
+ * requests next frames window if the row of not loaded frames is visible
+ */
+static gboolean on_load_frames_idle(gpointer user_data)
+{
+	GtkTreePath *start, *end;
+
+	load_frames_source = 0;
+
+	if (frames_left && gtk_tree_view_get_visible_range(GTK_TREE_VIEW(tree), &start, &end))
+	{
+		GtkTreePath *path = get_active_thread_path();
+		if (path)
+		{
+			gtk_tree_path_append_index(path, frames_count);
+			if (gtk_tree_path_compare(path, end) <= 0)
+			{
+				load_frames();
+			}
+			gtk_tree_path_free(path);
+		}
+
+		gtk_tree_path_free(start);
+		gtk_tree_path_free(end);
+	}
+
+	return FALSE;
+}
+
+/* 
+ * tree view scrolled or resized
+ */
+static void on_adjustment_changed(GtkAdjustment *adjustment, gpointer user_data)
+{
+	if (frames_left && !load_frames_source)
+	{
+		load_frames_source = g_idle_add(on_load_frames_idle, NULL);
+	}
+}
+
+/* 
+ * tree view is put into a scrolled window
+ */
+static void on_set_scroll_adjustments(GtkTreeView *tree_view, GtkAdjustment *hadjustment, GtkAdjustment *vadjustment, gpointer user_data)
+{
+	if (vadjustment)
+	{
+		g_signal_connect(G_OBJECT(vadjustment), "value-changed", G_CALLBACK(on_adjustment_changed), NULL);
+		g_signal_connect(G_OBJECT(vadjustment), "changed", G_CALLBACK(on_adjustment_changed), NULL);
+	}
+}
+
 /* 
  * frame arrow clicked callback
  */
 static void on_frame_arrow_clicked(CellRendererFrameIcon *cell_renderer, gchar *path, gpointer user_data)
 {
     GtkTreePath *new_active_frame = gtk_tree_path_new_from_string (path);
-    if (gtk_tree_path_get_indices(new_active_frame)[1] != active_frame_index)
+    if (!is_frames_left_row(new_active_frame) && gtk_tree_path_get_indices(new_active_frame)[1] != active_frame_index)
 	{
 		GtkTreeIter iter;
 
@@ -155,7 +234,7 @@ static void on_render_arrow(GtkTreeViewColumn *tree_column, GtkCellRenderer *cel
 	GtkTreeIter *iter, gpointer data)
 {
 	GtkTreePath *tpath = gtk_tree_model_get_path(model, iter);
-	g_object_set(cell, "visible", 1 != gtk_tree_path_get_depth(tpath), NULL);
+	g_object_set(cell, "visible", 1 != gtk_tree_path_get_depth(tpath) && !is_frames_left_row(tpath), NULL);
 	gtk_tree_path_free(tpath);
 }
 
@@ -167,7 +246,7 @@ static void on_render_line(GtkTreeViewColumn *tree_column, GtkCellRenderer *cell
 {
 	GtkTreePath *tpath = gtk_tree_model_get_path(model, iter);
 
-	if (1 == gtk_tree_path_get_depth(tpath))
+	if (1 == gtk_tree_path_get_depth(tpath) || is_frames_left_row(tpath))
 	{
 		g_object_set(cell, "text", "", NULL);
 	}
@@ -320,13 +399,14 @@ static void on_selection_changed(GtkTreeSelection *treeselection, gpointer user_
 /*
  *	inits stack trace tree
  */
-GtkWidget* stree_init(move_to_line_cb ml, select_frame_cb sf)
+GtkWidget* stree_init(move_to_line_cb ml, select_frame_cb sf, load_frames_cb lf)
 {
 	GtkTreeViewColumn *column;
 	GtkCellRenderer *renderer;
 
 	move_to_line = ml;
 	select_frame = sf;
+	load_frames = lf;
 
 	/* create tree view */
 	store = gtk_tree_store_new (
@@ -357,6 +437,9 @@ GtkWidget* stree_init(move_to_line_cb ml, select_frame_cb sf)
 	
 	g_signal_connect(G_OBJECT(tree), "query-tooltip", G_CALLBACK (on_query_tooltip), NULL);
 
+	/* for loading frames while scrolling */
+	g_signal_connect(G_OBJECT(tree), "set-scroll-adjustments", G_CALLBACK(on_set_scroll_adjustments), NULL);
+
 	/* creating columns */
 	/* address */
 	column = gtk_tree_view_column_new();
@@ -417,14 +500,14 @@ GtkWidget* stree_init(move_to_line_cb ml, select_frame_cb sf)
  */
 void stree_add(frame *f)
 {
-	GtkTreeRowReference *reference = (GtkTreeRowReference*)g_hash_table_lookup(threads, (gpointer)active_thread_id);
 	GtkTreeIter frame_iter;
 	GtkTreeIter thread_iter;
-	GtkTreePath *path = gtk_tree_row_reference_get_path(reference);
+	GtkTreePath *path = get_active_thread_path();
 	gtk_tree_model_get_iter(model, &thread_iter, path);
 	gtk_tree_path_free(path);
 
-	gtk_tree_store_insert_before(store, &frame_iter, &thread_iter, 0);
+	/* frames are inserted before the row of not loaded ones */
+	gtk_tree_store_insert(store, &frame_iter, &thread_iter, frames_count++);
 
 	gtk_tree_store_set (store, &frame_iter,
                     S_ADRESS, f->address,
@@ -435,6 +518,48 @@ void stree_add(frame *f)
                     -1);
 }
 
+/*
+ *	set the number of frames that are not loaded yet
+ */
+void stree_set_frames_left(int count)
+{
+	GtkTreeIter thread_iter, iter;
+	GtkTreePath *path = get_active_thread_path();
+	gtk_tree_model_get_iter(model, &thread_iter, path);
+	gtk_tree_path_free(path);
+
+	if (count > 0)
+	{
+		gchar *label = g_strdup_printf(_("%i more frames..."), count);
+
+		if (!frames_left)
+		{
+			gtk_tree_store_insert(store, &iter, &thread_iter, frames_count);
+		}
+		else
+		{
+			gtk_tree_model_iter_nth_child(model, &iter, &thread_iter, frames_count);
+		}
+
+		gtk_tree_store_set (store, &iter,
+						S_FUNCTION, label,
+						S_HAVE_SOURCE, FALSE,
+						-1);
+		g_free(label);
+
+		frames_left = count;
+
+		/* the row can be visible already */
+		on_adjustment_changed(NULL, NULL);
+	}
+	else if (frames_left)
+	{
+		gtk_tree_model_iter_nth_child(model, &iter, &thread_iter, frames_count);
+		gtk_tree_store_remove(store, &iter);
+		frames_left = 0;
+	}
+}
+
 /*
  *	clear tree view completely
  */
@@ -442,6 +567,8 @@ void stree_clear(void)
 {
 	gtk_tree_store_clear(store);
 	g_hash_table_remove_all(threads);
+
+	frames_count = frames_left = 0;
 }
 
 /*
@@ -484,6 +611,12 @@ void stree_select_first_frame(gboolean make_active)
  */
 void stree_destroy(void)
 {
+	if (load_frames_source)
+	{
+		g_source_remove(load_frames_source);
+		load_frames_source = 0;
+	}
+
 	if (threads)
 	{
 		g_hash_table_destroy(threads);
@@ -559,6 +692,11 @@ void stree_remove_thread(int thread_id)
 	g_hash_table_remove(threads, (gpointer)(glong)thread_id);
 
 	gtk_tree_path_free(tpath);
+
+	if (thread_id == active_thread_id)
+	{
+		frames_count = frames_left = 0;
+	}
 }
 
 /*
@@ -566,10 +704,9 @@ void stree_remove_thread(int thread_id)
  */
 void stree_remove_frames(void)
 {
-	GtkTreeRowReference *reference = (GtkTreeRowReference*)g_hash_table_lookup(threads, (gpointer)active_thread_id);
 	GtkTreeIter child;
 	GtkTreeIter thread_iter;
-	GtkTreePath *tpath = gtk_tree_row_reference_get_path(reference);
+	GtkTreePath *tpath = get_active_thread_path();
 	gtk_tree_model_get_iter(model, &thread_iter, tpath);
 	gtk_tree_path_free(tpath);
 
@@ -578,6 +715,8 @@ void stree_remove_frames(void)
 		while(gtk_tree_store_remove(GTK_TREE_STORE(model), &child))
 			;
 	}
+
+	frames_count = frames_left = 0;
 }
 
 /*
@@ -28,10 +28,13 @@
 #include "breakpoints.h"
 #include "debug_module.h"
 
-GtkWidget*		stree_init(move_to_line_cb ml, select_frame_cb sf);
+typedef void	(*load_frames_cb)(void);
+
+GtkWidget*		stree_init(move_to_line_cb ml, select_frame_cb sf, load_frames_cb lf);
 void			stree_destroy(void);
 
 void 			stree_add(frame *f);
+void			stree_set_frames_left(int count);
 void 			stree_clear(void);
 
 void 			stree_add_thread(int thread_id);
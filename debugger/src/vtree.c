@@ -44,6 +44,8 @@
 /* columns minumum width in characters */
 #define MIN_COLUMN_CHARS 20
 
+extern dbg_module *active_module;
+
 /*
  * key pressed event
  */
@@ -121,12 +123,26 @@ static void render_value(GtkTreeViewColumn *tree_column,
 {
 	/* paint changed values in red */
 	gboolean changed = FALSE;
+	gchar *value = NULL;
 	gtk_tree_model_get (
 		tree_model,
 		iter,
 		W_CHANGED, &changed,
+		W_VALUE, &value,
 		-1);
 	g_object_set (cell, "foreground", changed ? "red" : "black", NULL);
+
+	/* the values are kept as the debugger gives them,
+	only the shown ones with escape sequences are formatted */
+	if (value && active_module && strchr(value, '\\'))
+	{
+		gchar *formatted = active_module->format_value(value);
+		g_object_set (cell, "text", formatted, NULL);
+		g_free(formatted);
+	}
+	else
+		g_object_set (cell, "text", value, NULL);
+	g_free(value);
 }
 
 /*
@@ -151,6 +167,7 @@ GtkWidget* vtree_create(watch_render_name on_render_name, watch_expression_chang
 		G_TYPE_STRING,
 		G_TYPE_INT,
 		G_TYPE_INT,
+		G_TYPE_INT,
 		G_TYPE_INT);
 	GtkWidget* tree = gtk_tree_view_new_with_model (GTK_TREE_MODEL(store));
 	g_object_unref(store);
@@ -193,7 +210,7 @@ GtkWidget* vtree_create(watch_render_name on_render_name, watch_expression_chang
 
 	/* Value */
 	renderer = gtk_cell_renderer_text_new ();
-	column = gtk_tree_view_column_new_with_attributes (_("Value"), renderer, "text", W_VALUE, NULL);
+	column = gtk_tree_view_column_new_with_attributes (_("Value"), renderer, NULL);
 	gtk_tree_view_column_set_cell_data_func(column, renderer, render_value, NULL, NULL);
 	gtk_tree_view_column_set_resizable (column, TRUE);
 
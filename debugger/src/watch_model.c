@@ -81,6 +81,42 @@ inline static void add_stub(GtkTreeStore *store, GtkTreeIter *parent)
 		-1);
 }
 
+/*
+ * sets the name of the page row "page" of "count" children
+ */
+static void set_page_name(GtkTreeStore *store, GtkTreeIter *page, int from, int count)
+{
+	gchar *name = g_strdup_printf("[%d..%d]", from, MIN(from + WATCH_CHILDREN_PAGE, count) - 1);
+	gtk_tree_store_set (store, page, W_NAME, name, -1);
+	g_free(name);
+}
+
+/*
+ * adds to "parent" the page rows of its "count" children, each with a stub item
+ */
+static void append_pages(GtkTreeStore *store, GtkTreeIter *parent, const gchar *internal, int count,
+	gboolean changed)
+{
+	int from;
+	for (from = 0; from < count; from += WATCH_CHILDREN_PAGE)
+	{
+		GtkTreeIter page;
+		gtk_tree_store_append (store, &page, parent);
+		gtk_tree_store_set (store, &page,
+			W_VALUE, "",
+			W_TYPE, "",
+			W_INTERNAL, internal,
+			W_EXPRESSION, "",
+			W_STUB, FALSE,
+			W_CHANGED, changed,
+			W_VT, VT_NONE,
+			W_PAGE, from + 1,
+			-1);
+		set_page_name(store, &page, from, count);
+		add_stub(store, &page);
+	}
+}
+
 /*
  * insert all "vars" members to "parent" iterator in the "tree" as new children
  * mark_changed specifies whether to mark new items as beed changed
@@ -252,6 +288,97 @@ void expand_stub(GtkTreeView *tree, GtkTreeIter *parent, GList *vars)
 	gtk_tree_store_remove(store, &stub);
 }
 
+/*
+ * remove stub item and add the page rows of the "count" children of parent iterator
+ */
+void expand_stub_pages(GtkTreeView *tree, GtkTreeIter *parent, int count)
+{
+	GtkTreeModel *model = gtk_tree_view_get_model(tree);
+	GtkTreeStore *store = GTK_TREE_STORE(model);
+	GtkTreeIter stub;
+	gboolean changed;
+	gchar *internal;
+
+	gtk_tree_model_iter_children(model, &stub, parent);
+	gtk_tree_model_get(model, parent,
+		W_CHANGED, &changed,
+		W_INTERNAL, &internal,
+		-1);
+
+	append_pages(store, parent, internal, count, changed);
+	gtk_tree_store_remove(store, &stub);
+
+	g_free(internal);
+}
+
+/*
+ * updates the children of the expanded "parent" row of the GDB variable "internal",
+ * by pages if it has many, only the expanded pages are listed
+ */
+static void update_children(GtkTreeView *tree, GtkTreeIter *parent, gchar *internal)
+{
+	GtkTreeModel *model = gtk_tree_view_get_model(tree);
+	GtkTreeStore *store = GTK_TREE_STORE(model);
+	int count = active_module->get_children_count(internal);
+	int pages = (count + WATCH_CHILDREN_PAGE - 1) / WATCH_CHILDREN_PAGE;
+	gboolean changed = FALSE;
+	GtkTreeIter child;
+	int page = 0;
+
+	gtk_tree_model_get(model, parent, W_CHANGED, &changed, -1);
+	if (gtk_tree_model_iter_children(model, &child, parent))
+		gtk_tree_model_get(model, &child, W_PAGE, &page, -1);
+
+	if (count <= WATCH_CHILDREN_PAGE)
+	{
+		GList *children;
+
+		/* the children aren't paged any longer */
+		if (page)
+			remove_children(model, parent);
+
+		children = active_module->get_children(internal);
+		update_variables(tree, parent, g_list_copy(children));
+		free_variables_list(children);
+	}
+	else if (!page || gtk_tree_model_iter_n_children(model, parent) != pages)
+	{
+		/* list the pages again */
+		remove_children(model, parent);
+		append_pages(store, parent, internal, count, changed);
+	}
+	else
+	{
+		do
+		{
+			GtkTreePath *path = gtk_tree_model_get_path(model, &child);
+			gboolean stub;
+
+			gtk_tree_model_get(model, &child,
+				W_PAGE, &page,
+				W_STUB, &stub,
+				-1);
+			set_page_name(store, &child, page - 1, count);
+			gtk_tree_store_set (store, &child, W_CHANGED, changed, -1);
+
+			if (gtk_tree_view_row_expanded(tree, path))
+			{
+				GList *children = active_module->get_children_range(internal, page - 1, page - 1 + WATCH_CHILDREN_PAGE);
+				update_variables(tree, &child, g_list_copy(children));
+				free_variables_list(children);
+			}
+			else if (!stub)
+			{
+				remove_children(model, &child);
+				add_stub(store, &child);
+			}
+
+			gtk_tree_path_free(path);
+		}
+		while (gtk_tree_model_iter_next(model, &child));
+	}
+}
+
 /*
  * change watch specified by "iter" as dscribed in "var"
  */
@@ -371,12 +498,8 @@ void update_variables(GtkTreeView *tree, GtkTreeIter *parent, GList *vars)
 					}
 					else
 					{
-						/* get children for "parent" item */
-						GList *children = active_module->get_children(v->internal->str);
 						/* update children */
-						update_variables(tree, &child, g_list_copy(children));
-						/* frees children list */
-						free_variables_list(children);
+						update_children(tree, &child, v->internal->str);
 					}
 					gtk_tree_path_free(path);
 				}
@@ -25,6 +25,10 @@
 #include <glib.h>
 #include <gtk/gtk.h>
 
+/* the children of a variable having more are shown by pages of this size,
+each page row (W_PAGE is its first child index + 1) listing its children when expanded */
+#define WATCH_CHILDREN_PAGE 100
+
 /* tree view columns */
 enum
 {
@@ -37,6 +41,7 @@ enum
    W_STUB,
    W_CHANGED,
    W_VT,
+   W_PAGE,
    W_N_COLUMNS
 };
 
@@ -55,5 +60,6 @@ void	change_watch(GtkTreeView *tree, GtkTreeIter *iter, gpointer var);
 void	free_variables_list(GList *vars);
 void	variable_set_name_only(GtkTreeStore *store, GtkTreeIter *iter, gchar *name);
 void	expand_stub(GtkTreeView *tree, GtkTreeIter *parent, GList *vars);
+void	expand_stub_pages(GtkTreeView *tree, GtkTreeIter *parent, int count);
 
 #endif /* guard */
@@ -34,6 +34,7 @@
 
 #include "Scintilla.h"
 #include "SciLexer.h"
+#include "notifyprof.h"
 
 /* #define DEBUG */
 
@@ -60,31 +61,86 @@ PLUGIN_SET_TRANSLATABLE_INFO(
 
 static GArray *lines_stack = NULL;
 
-static gint
-get_line_end(ScintillaObject *sci, gint line)
+/* Extent of the last define found, to not walk back to its first line on
+ * each change: line start begins with "#define", the line before it
+ * doesn't end with a backslash, and lines start to end all do, but broken
+ * (if not -1) which is being edited. */
+static struct
 {
-	gint end;
-	gchar ch;
-	end = sci_get_line_end_position(sci, line);
-	ch = sci_get_char_at(sci, end - 1);
-	while(ch == ' ' || ch == '\t')
-	{
-		end--;
-		ch = sci_get_char_at(sci, end - 1);
-	}
-	return end;
+	ScintillaObject *sci;
+	gint             start;
+	gint             end;
+	gint             broken;
+} define_cache = { NULL, 0, 0, -1 };
+
+static gboolean
+line_has_backslash(ScintillaObject *sci, gint line)
+{
+	return sci_get_char_at(sci, get_line_end(sci, line) - 1) == '\\';
 }
 
-static gint
-get_indent_pos(ScintillaObject *sci, gint line)
+static void
+define_cache_invalidate(void)
 {
-	return (gint)SSM(sci, SCI_GETLINEINDENTPOSITION, (uptr_t)line, 0);
+	define_cache.sci = NULL;
 }
 
-static const gchar *
-get_char_range(ScintillaObject *sci, gint start, gint length)
+static void
+define_cache_check_line(ScintillaObject *sci, gint line)
 {
-	return (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, start, length);
+	if(line > define_cache.end)
+		return;
+	if(line_has_backslash(sci, line))
+	{
+		if(define_cache.broken == line)
+			define_cache.broken = -1;
+	}
+	else if(define_cache.broken < 0 || define_cache.broken == line)
+		define_cache.broken = line;
+	else
+	{
+		/* a second line without backslash, the define ends before */
+		define_cache.end = MIN(define_cache.broken, line) - 1;
+		define_cache.broken = -1;
+	}
+}
+
+/* keeps the cached define in sync with a modification of the text */
+static void
+define_cache_update(ScintillaObject *sci, gint line, gint lines_added)
+{
+	gint i;
+
+	if(define_cache.sci != sci)
+		return;
+	if(line < define_cache.start - 1)
+	{
+		/* before the define, only moves it if the lines removed end before
+		 * the line preceding it */
+		if(line - MIN(lines_added, 0) < define_cache.start - 1)
+		{
+			define_cache.start += lines_added;
+			define_cache.end += lines_added;
+			if(define_cache.broken >= 0)
+				define_cache.broken += lines_added;
+		}
+		else
+			define_cache_invalidate();
+	}
+	else if(line <= define_cache.start || lines_added < 0)
+	{
+		if(line <= define_cache.end + 1)
+			define_cache_invalidate();
+	}
+	else if(line <= define_cache.end)
+	{
+		/* inside the define, the lines touched may have lost their backslash */
+		define_cache.end += lines_added;
+		if(define_cache.broken > line)
+			define_cache.broken += lines_added;
+		for(i = line; i <= line + lines_added; i++)
+			define_cache_check_line(sci, i);
+	}
 }
 
 static gboolean
@@ -94,6 +150,7 @@ inside_define(ScintillaObject *sci, gint line, gboolean newline)
 	gint    start_pos;
 	gint    end_pos;
 	gchar   end_char;
+	gint    last;
 
 	lexer = sci_get_lexer(sci);
 	if(lexer != SCLEX_CPP)
@@ -108,11 +165,16 @@ inside_define(ScintillaObject *sci, gint line, gboolean newline)
 	}
 	if(newline)
 		line--;
-	do {
+	line--;
+	if(define_cache.sci == sci && define_cache.start - 1 <= line && line <= define_cache.end &&
+	   (define_cache.broken < 0 || line < define_cache.broken))
+	{
+		dprintf("Cached define on line %d\n", define_cache.start + 1);
+		return TRUE;
+	}
+	last = line;
+	while(line >= 0 && line_has_backslash(sci, line))
 		line--;
-		end_pos = get_line_end(sci, line);
-		end_char = sci_get_char_at(sci, end_pos - 1);
-	} while(end_char == '\\' && line >= 0);
 	line++;
 	dprintf("Expecting define on line %d\n", line + 1);
 	start_pos = (gint)SSM(sci, SCI_GETLINEINDENTPOSITION, (uptr_t)line, 0);
@@ -129,6 +191,10 @@ inside_define(ScintillaObject *sci, gint line, gboolean newline)
 		dprintf("Start line is not \"#define\", exit\n");
 		return FALSE;
 	}
+	define_cache.sci = sci;
+	define_cache.start = line;
+	define_cache.end = last;
+	define_cache.broken = -1;
 	return TRUE;
 }
 
@@ -156,6 +222,7 @@ define_format_line(ScintillaObject *sci, gint current_line)
 	gint    first_line;
 	gint    first_end;
 	gint    max = geany_data->editor_prefs->long_line_column;
+	gchar  *padding;
 
 	if(!inside_define(sci, current_line, FALSE))
 		return;
@@ -165,9 +232,11 @@ define_format_line(ScintillaObject *sci, gint current_line)
 	for (first_end--; sci_get_char_at(sci, first_end - 1) == ' '; first_end--) {}
 	SSM(sci, SCI_DELETERANGE, first_end, sci_get_line_end_position(sci, first_line) - first_end);
 	length = first_end - get_indent_pos(sci, first_line) + sci_get_line_indentation(sci, first_line);
-	for(; length < max - 1; length++, first_end++)
-		sci_insert_text(sci, first_end, " ");
-	sci_insert_text(sci, first_end, "\\");
+	/* the padding and the backslash in a single insertion */
+	padding = g_strnfill(MAX(max - 1 - length, 0) + 1, ' ');
+	padding[strlen(padding) - 1] = '\\';
+	sci_insert_text(sci, first_end, padding);
+	g_free(padding);
 }
 
 static gboolean
@@ -214,6 +283,8 @@ editor_notify_cb(GObject *object, GeanyEditor *editor, SCNotification *nt, gpoin
 	{
 		if(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
 		{
+			define_cache_update(editor->sci,
+				sci_get_line_from_position(editor->sci, nt->position), nt->linesAdded);
 			if(nt->modificationType & (SC_PERFORMED_UNDO | SC_PERFORMED_REDO))
 				return FALSE;
 			gint line = sci_get_line_from_position(editor->sci, nt->position) + 1;
@@ -240,9 +311,19 @@ editor_notify_cb(GObject *object, GeanyEditor *editor, SCNotification *nt, gpoin
 	return FALSE;
 }
 
+static void
+on_document_close(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	if(define_cache.sci == doc->editor->sci)
+		define_cache_invalidate();
+}
+
+GP_NOTIFY_PROFILE_EDITOR_HANDLER(editor_notify_cb_profiled, editor_notify_cb)
+
 PluginCallback plugin_callbacks[] =
 {
-	{ "editor-notify", (GCallback) &editor_notify_cb, FALSE, NULL },
+	{ "editor-notify", (GCallback) &editor_notify_cb_profiled, FALSE, NULL },
+	{ "document-close", (GCallback) &on_document_close, FALSE, NULL },
 	{ NULL, NULL, FALSE, NULL }
 };
 
@@ -254,6 +335,7 @@ void plugin_init(GeanyData *data)
 void plugin_cleanup(void)
 {
 	g_array_free(lines_stack, TRUE);
+	define_cache_invalidate();
 }
 
 void
@@ -100,8 +100,9 @@ dh_base_init (DhBase *base)
         ige_conf_add_defaults (conf, path);
         g_free (path);
 
+        /* Populated by dh_base_get() or, for dh_base_new_deferred(), by
+         * the caller */
         priv->book_manager = dh_book_manager_new ();
-        dh_book_manager_populate (priv->book_manager);
 
 #ifdef GDK_WINDOWING_X11
         {
@@ -136,6 +137,8 @@ dh_base_get (void)
 {
         if (!base_instance) {
                 base_instance = g_object_new (DH_TYPE_BASE, NULL);
+                dh_book_manager_populate (
+                        GET_PRIVATE (base_instance)->book_manager);
         }
 
         return base_instance;
@@ -151,6 +154,21 @@ dh_base_new (void)
         return dh_base_get ();
 }
 
+/* Like dh_base_new(), but the books are not loaded: the caller populates
+ * the book manager when it sees fit, see dh_book_manager_populate_async().
+ */
+DhBase *
+dh_base_new_deferred (void)
+{
+        if (base_instance) {
+                g_error ("You can only have one DhBase instance.");
+        }
+
+        base_instance = g_object_new (DH_TYPE_BASE, NULL);
+
+        return base_instance;
+}
+
 GtkWidget *
 dh_base_new_window (DhBase *base)
 {
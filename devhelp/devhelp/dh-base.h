@@ -50,6 +50,7 @@ struct _DhBaseClass {
 GType          dh_base_get_type                        (void) G_GNUC_CONST;
 DhBase *       dh_base_get                             (void);
 DhBase *       dh_base_new                             (void);
+DhBase *       dh_base_new_deferred                    (void);
 GtkWidget *    dh_base_new_window                      (DhBase *base);
 GtkWidget *    dh_base_new_assistant                   (DhBase *base);
 GtkWidget *    dh_base_get_window                      (DhBase *base);
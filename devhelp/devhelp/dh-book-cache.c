@@ -0,0 +1,562 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The parsed books, saved in one file so that the next start does not have
+ * to parse the ones whose file did not change. The file is mapped and holds
+ * one record per book:
+ *
+ *   path, mtime and size of the book file
+ *   the tree, in preorder: type, flags, number of children, name,
+ *     filename, plus base and id for the book node
+ *   the keywords: type, then either the index of a tree node (book and
+ *     pages are shared with the tree) or flags, index of the page node,
+ *     name and filename
+ *
+ * Integers are stored in the byte order of the machine, strings as a length
+ * followed by the bytes and a NUL.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#include "dh-link.h"
+#include "dh-book-cache.h"
+
+#define CACHE_MAGIC   "DHBC"
+#define CACHE_VERSION 1
+
+struct _DhBookCache {
+        GMappedFile *file;
+
+        /* book path -> record, both in the mapped file */
+        GHashTable  *records;
+        gboolean     changed;
+};
+
+typedef struct {
+        const gchar *pos;
+        const gchar *end;
+} CacheReader;
+
+static gboolean
+cache_read_uint32 (CacheReader *reader,
+                   guint32     *value)
+{
+        if (reader->end - reader->pos < (gssize) sizeof (guint32)) {
+                return FALSE;
+        }
+
+        memcpy (value, reader->pos, sizeof (guint32));
+        reader->pos += sizeof (guint32);
+
+        return TRUE;
+}
+
+static gboolean
+cache_read_uint64 (CacheReader *reader,
+                   guint64     *value)
+{
+        if (reader->end - reader->pos < (gssize) sizeof (guint64)) {
+                return FALSE;
+        }
+
+        memcpy (value, reader->pos, sizeof (guint64));
+        reader->pos += sizeof (guint64);
+
+        return TRUE;
+}
+
+static gboolean
+cache_read_uint8 (CacheReader *reader,
+                  guint8      *value)
+{
+        if (reader->pos >= reader->end) {
+                return FALSE;
+        }
+
+        *value = (guint8) *reader->pos++;
+
+        return TRUE;
+}
+
+/* The returned string points into the mapped file. */
+static gboolean
+cache_read_string (CacheReader  *reader,
+                   const gchar **value)
+{
+        guint32 length;
+
+        if (!cache_read_uint32 (reader, &length) ||
+            (gsize) (reader->end - reader->pos) <= length ||
+            reader->pos[length] != '\0') {
+                return FALSE;
+        }
+
+        *value = reader->pos;
+        reader->pos += length + 1;
+
+        return TRUE;
+}
+
+static void
+cache_write_uint32 (GString *buffer,
+                    guint32  value)
+{
+        g_string_append_len (buffer, (const gchar *) &value, sizeof (value));
+}
+
+static void
+cache_write_uint64 (GString *buffer,
+                    guint64  value)
+{
+        g_string_append_len (buffer, (const gchar *) &value, sizeof (value));
+}
+
+static void
+cache_write_uint8 (GString *buffer,
+                   guint8   value)
+{
+        g_string_append_c (buffer, (gchar) value);
+}
+
+static void
+cache_write_string (GString     *buffer,
+                    const gchar *value)
+{
+        gsize length;
+
+        if (!value) {
+                value = "";
+        }
+
+        length = strlen (value);
+        cache_write_uint32 (buffer, length);
+        g_string_append_len (buffer, value, length + 1);
+}
+
+gchar *
+dh_book_cache_get_filename (void)
+{
+        return g_build_filename (g_get_user_cache_dir (),
+                                 "devhelp",
+                                 "books.cache",
+                                 NULL);
+}
+
+/* Returns NULL if there is no usable cache. */
+DhBookCache *
+dh_book_cache_load (const gchar *filename)
+{
+        DhBookCache *cache;
+        GMappedFile *file;
+        CacheReader  reader;
+        guint32      version;
+
+        g_return_val_if_fail (filename != NULL, NULL);
+
+        file = g_mapped_file_new (filename, FALSE, NULL);
+        if (!file) {
+                return NULL;
+        }
+
+        reader.pos = g_mapped_file_get_contents (file);
+        reader.end = reader.pos + g_mapped_file_get_length (file);
+
+        if (reader.end - reader.pos < (gssize) strlen (CACHE_MAGIC) ||
+            memcmp (reader.pos, CACHE_MAGIC, strlen (CACHE_MAGIC)) != 0) {
+                g_mapped_file_free (file);
+                return NULL;
+        }
+        reader.pos += strlen (CACHE_MAGIC);
+
+        if (!cache_read_uint32 (&reader, &version) ||
+            version != CACHE_VERSION) {
+                g_mapped_file_free (file);
+                return NULL;
+        }
+
+        cache = g_new0 (DhBookCache, 1);
+        cache->file = file;
+        cache->records = g_hash_table_new (g_str_hash, g_str_equal);
+
+        while (reader.pos < reader.end) {
+                CacheReader  record;
+                guint32      length;
+                const gchar *path;
+
+                if (!cache_read_uint32 (&reader, &length) ||
+                    (gsize) (reader.end - reader.pos) < length) {
+                        /* Truncated, keep the complete records. */
+                        break;
+                }
+
+                record.pos = reader.pos;
+                record.end = reader.pos + length;
+                reader.pos = record.end;
+
+                if (cache_read_string (&record, &path)) {
+                        g_hash_table_insert (cache->records,
+                                             (gpointer) path,
+                                             (gpointer) record.pos);
+                }
+        }
+
+        return cache;
+}
+
+void
+dh_book_cache_free (DhBookCache *cache)
+{
+        if (!cache) {
+                return;
+        }
+
+        g_hash_table_destroy (cache->records);
+        g_mapped_file_free (cache->file);
+        g_free (cache);
+}
+
+static GNode *
+cache_read_node (CacheReader *reader,
+                 GPtrArray   *nodes,
+                 DhLink      *book_link)
+{
+        GNode       *node;
+        DhLink      *link;
+        guint8       type, flags;
+        guint32      n_children, i;
+        const gchar *name, *filename;
+
+        if (!cache_read_uint8 (reader, &type) ||
+            !cache_read_uint8 (reader, &flags) ||
+            !cache_read_uint32 (reader, &n_children) ||
+            !cache_read_string (reader, &name) ||
+            !cache_read_string (reader, &filename)) {
+                return NULL;
+        }
+
+        if (book_link == NULL) {
+                const gchar *base, *id;
+
+                if (type != DH_LINK_TYPE_BOOK ||
+                    !cache_read_string (reader, &base) ||
+                    !cache_read_string (reader, &id)) {
+                        return NULL;
+                }
+
+                link = dh_link_new (DH_LINK_TYPE_BOOK,
+                                    base, id, name,
+                                    NULL, NULL, filename);
+                book_link = link;
+        } else {
+                if (type != DH_LINK_TYPE_PAGE) {
+                        return NULL;
+                }
+
+                link = dh_link_new (DH_LINK_TYPE_PAGE,
+                                    NULL, NULL, name,
+                                    book_link, NULL, filename);
+        }
+        dh_link_set_flags (link, flags);
+
+        node = g_node_new (link);
+        g_ptr_array_add (nodes, node);
+
+        for (i = 0; i < n_children; i++) {
+                GNode *child;
+
+                child = cache_read_node (reader, nodes, book_link);
+                if (!child) {
+                        return NULL;
+                }
+                g_node_append (node, child);
+        }
+
+        return node;
+}
+
+static gboolean
+cache_unref_node_link (GNode    *node,
+                       gpointer  data)
+{
+        dh_link_unref (node->data);
+
+        return FALSE;
+}
+
+static DhBook *
+cache_read_book (CacheReader *reader,
+                 const gchar *book_path)
+{
+        GPtrArray *nodes;
+        GNode     *tree;
+        GList     *keywords = NULL;
+        GList     *l;
+        guint32    n_keywords, i;
+
+        nodes = g_ptr_array_new ();
+
+        tree = cache_read_node (reader, nodes, NULL);
+        if (!tree || !cache_read_uint32 (reader, &n_keywords)) {
+                goto error;
+        }
+
+        for (i = 0; i < n_keywords; i++) {
+                DhLink      *link;
+                guint8       type, flags;
+                guint32      page;
+                const gchar *name, *filename;
+
+                if (!cache_read_uint8 (reader, &type)) {
+                        goto error;
+                }
+
+                if (type == DH_LINK_TYPE_BOOK || type == DH_LINK_TYPE_PAGE) {
+                        /* Shared with the tree, the way the parser does. */
+                        if (!cache_read_uint32 (reader, &page) ||
+                            page >= nodes->len) {
+                                goto error;
+                        }
+
+                        link = ((GNode *) g_ptr_array_index (nodes, page))->data;
+                        if (type == DH_LINK_TYPE_BOOK) {
+                                dh_link_ref (link);
+                        }
+                } else {
+                        if (type > DH_LINK_TYPE_TYPEDEF ||
+                            !cache_read_uint8 (reader, &flags) ||
+                            !cache_read_uint32 (reader, &page) ||
+                            page >= nodes->len ||
+                            !cache_read_string (reader, &name) ||
+                            !cache_read_string (reader, &filename)) {
+                                goto error;
+                        }
+
+                        link = dh_link_new (type, NULL, NULL, name,
+                                            tree->data,
+                                            ((GNode *) g_ptr_array_index (nodes, page))->data,
+                                            filename);
+                        dh_link_set_flags (link, flags);
+                }
+
+                keywords = g_list_prepend (keywords, link);
+        }
+
+        g_ptr_array_free (nodes, TRUE);
+
+        return dh_book_new_from_data (book_path,
+                                      tree,
+                                      g_list_reverse (keywords));
+
+error:
+        /* The pages are only referenced by the tree. */
+        for (l = keywords; l; l = g_list_next (l)) {
+                if (dh_link_get_link_type (l->data) != DH_LINK_TYPE_PAGE) {
+                        dh_link_unref (l->data);
+                }
+        }
+        g_list_free (keywords);
+        /* The nodes of a partly read tree are not all linked together,
+         * free each piece. Going backwards, a piece is only freed after
+         * the nodes it contains were looked at.
+         */
+        for (i = nodes->len; i > 0; i--) {
+                GNode *node = g_ptr_array_index (nodes, i - 1);
+
+                if (G_NODE_IS_ROOT (node)) {
+                        g_node_traverse (node, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+                                         cache_unref_node_link, NULL);
+                        g_node_destroy (node);
+                }
+        }
+        g_ptr_array_free (nodes, TRUE);
+
+        return NULL;
+}
+
+/* Returns the book stored for book_path if the file did not change since
+ * it was saved, NULL otherwise.
+ */
+DhBook *
+dh_book_cache_lookup (DhBookCache *cache,
+                      const gchar *book_path)
+{
+        CacheReader  reader;
+        struct stat  st;
+        guint64      mtime, size;
+        DhBook      *book;
+
+        g_return_val_if_fail (book_path != NULL, NULL);
+
+        if (!cache) {
+                return NULL;
+        }
+
+        reader.pos = g_hash_table_lookup (cache->records, book_path);
+        if (!reader.pos) {
+                cache->changed = TRUE;
+                return NULL;
+        }
+        reader.end = g_mapped_file_get_contents (cache->file) +
+                g_mapped_file_get_length (cache->file);
+
+        if (g_stat (book_path, &st) != 0 ||
+            !cache_read_uint64 (&reader, &mtime) ||
+            !cache_read_uint64 (&reader, &size) ||
+            mtime != (guint64) st.st_mtime ||
+            size != (guint64) st.st_size) {
+                cache->changed = TRUE;
+                return NULL;
+        }
+
+        book = cache_read_book (&reader, book_path);
+        if (!book) {
+                cache->changed = TRUE;
+                return NULL;
+        }
+
+        /* What is left once all the books were looked up is gone. */
+        g_hash_table_remove (cache->records, book_path);
+
+        return book;
+}
+
+/* Whether the cache should be saved again: a book was missing or had
+ * changed, or some stored books were not looked up any more.
+ */
+gboolean
+dh_book_cache_is_stale (DhBookCache *cache)
+{
+        if (!cache) {
+                return TRUE;
+        }
+
+        return cache->changed || g_hash_table_size (cache->records) > 0;
+}
+
+static void
+cache_write_node (GString    *buffer,
+                  GNode      *node,
+                  GHashTable *indexes)
+{
+        DhLink *link = node->data;
+        GNode  *child;
+
+        g_hash_table_insert (indexes, link,
+                             GUINT_TO_POINTER (g_hash_table_size (indexes)));
+
+        cache_write_uint8 (buffer, dh_link_get_link_type (link));
+        cache_write_uint8 (buffer, dh_link_get_flags (link));
+        cache_write_uint32 (buffer, g_node_n_children (node));
+        cache_write_string (buffer, dh_link_get_name (link));
+        cache_write_string (buffer, dh_link_get_filename (link));
+        if (G_NODE_IS_ROOT (node)) {
+                cache_write_string (buffer, dh_link_get_base (link));
+                cache_write_string (buffer, dh_link_get_book_id (link));
+        }
+
+        for (child = node->children; child; child = child->next) {
+                cache_write_node (buffer, child, indexes);
+        }
+}
+
+static gboolean
+cache_write_book (GString *buffer,
+                  DhBook  *book)
+{
+        GHashTable  *indexes;
+        GNode       *tree;
+        GList       *l;
+        struct stat  st;
+        gsize        start;
+        guint32      length;
+
+        tree = dh_book_get_tree (book);
+        if (!tree || g_stat (dh_book_get_path (book), &st) != 0) {
+                return FALSE;
+        }
+
+        start = buffer->len;
+        cache_write_uint32 (buffer, 0);
+        cache_write_string (buffer, dh_book_get_path (book));
+        cache_write_uint64 (buffer, st.st_mtime);
+        cache_write_uint64 (buffer, st.st_size);
+
+        /* link -> preorder index of its node */
+        indexes = g_hash_table_new (g_direct_hash, g_direct_equal);
+        cache_write_node (buffer, tree, indexes);
+
+        cache_write_uint32 (buffer, g_list_length (dh_book_get_keywords (book)));
+        for (l = dh_book_get_keywords (book); l; l = g_list_next (l)) {
+                DhLink     *link = l->data;
+                DhLinkType  type = dh_link_get_link_type (link);
+                gpointer    index;
+
+                cache_write_uint8 (buffer, type);
+                if (type == DH_LINK_TYPE_BOOK || type == DH_LINK_TYPE_PAGE) {
+                        index = g_hash_table_lookup (indexes, link);
+                        cache_write_uint32 (buffer, GPOINTER_TO_UINT (index));
+                } else {
+                        index = g_hash_table_lookup (indexes,
+                                                     dh_link_get_page (link));
+                        cache_write_uint8 (buffer, dh_link_get_flags (link));
+                        cache_write_uint32 (buffer, GPOINTER_TO_UINT (index));
+                        cache_write_string (buffer, dh_link_get_name (link));
+                        cache_write_string (buffer, dh_link_get_filename (link));
+                }
+        }
+
+        g_hash_table_destroy (indexes);
+
+        length = buffer->len - start - sizeof (guint32);
+        memcpy (buffer->str + start, &length, sizeof (guint32));
+
+        return TRUE;
+}
+
+gboolean
+dh_book_cache_save (const gchar  *filename,
+                    GList        *books,
+                    GError      **error)
+{
+        GString  *buffer;
+        GList    *l;
+        gchar    *dir;
+        gboolean  result;
+
+        g_return_val_if_fail (filename != NULL, FALSE);
+
+        dir = g_path_get_dirname (filename);
+        g_mkdir_with_parents (dir, 0755);
+        g_free (dir);
+
+        buffer = g_string_new (CACHE_MAGIC);
+        cache_write_uint32 (buffer, CACHE_VERSION);
+
+        for (l = books; l; l = g_list_next (l)) {
+                cache_write_book (buffer, DH_BOOK (l->data));
+        }
+
+        result = g_file_set_contents (filename, buffer->str, buffer->len, error);
+        g_string_free (buffer, TRUE);
+
+        return result;
+}
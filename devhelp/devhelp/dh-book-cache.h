@@ -0,0 +1,42 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __DH_BOOK_CACHE_H__
+#define __DH_BOOK_CACHE_H__
+
+#include <glib.h>
+
+#include "dh-book.h"
+
+G_BEGIN_DECLS
+
+typedef struct _DhBookCache DhBookCache;
+
+gchar       *dh_book_cache_get_filename (void);
+DhBookCache *dh_book_cache_load         (const gchar  *filename);
+void         dh_book_cache_free         (DhBookCache  *cache);
+DhBook      *dh_book_cache_lookup       (DhBookCache  *cache,
+                                         const gchar  *book_path);
+gboolean     dh_book_cache_is_stale     (DhBookCache  *cache);
+gboolean     dh_book_cache_save         (const gchar  *filename,
+                                         GList        *books,
+                                         GError      **error);
+
+G_END_DECLS
+
+#endif /* __DH_BOOK_CACHE_H__ */
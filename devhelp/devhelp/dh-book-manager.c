@@ -28,15 +28,33 @@
 #include "dh-util.h"
 #include "dh-book.h"
 #include "dh-book-manager.h"
+#include "dh-book-cache.h"
 #include "dh-marshal.h"
 
 typedef struct {
         /* The list of all DhBooks found in the system */
         GList *books;
+        /* Index of the keywords of all the books, for searching */
+        DhKeywordIndex *keyword_index;
+        /* Whether the books are being loaded in a thread */
+        gboolean loading;
 } DhBookManagerPriv;
 
+/* The books found while populating, built without touching the manager so
+ * that it can be done in a thread */
+typedef struct {
+        DhBookManager  *book_manager;
+        GList          *books;
+        /* Books not added because of a duplicate name, they are
+         * still saved in the cache so that they are not parsed again */
+        GList          *duplicates;
+        DhBookCache    *cache;
+        DhKeywordIndex *keyword_index;
+} DhBookLoad;
+
 enum {
         DISABLED_BOOK_LIST_UPDATED,
+        BOOKS_LOADED,
         LAST_SIGNAL
 };
 
@@ -50,13 +68,13 @@ G_DEFINE_TYPE (DhBookManager, dh_book_manager, G_TYPE_OBJECT);
 static void    dh_book_manager_init       (DhBookManager      *book_manager);
 static void    dh_book_manager_class_init (DhBookManagerClass *klass);
 
-static void    book_manager_add_from_filepath     (DhBookManager *book_manager,
+static void    book_manager_add_from_filepath     (DhBookLoad    *load,
                                                    const gchar   *book_path);
-static void    book_manager_add_from_dir          (DhBookManager *book_manager,
+static void    book_manager_add_from_dir          (DhBookLoad    *load,
                                                    const gchar   *dir_path);
 
 #ifdef GDK_WINDOWING_QUARTZ
-static void    book_manager_add_from_xcode_docset (DhBookManager *book_manager,
+static void    book_manager_add_from_xcode_docset (DhBookLoad    *load,
                                                    const gchar   *dir_path);
 #endif
 
@@ -68,6 +86,8 @@ book_manager_finalize (GObject *object)
 
         priv = GET_PRIVATE (object);
 
+        dh_keyword_index_free (priv->keyword_index);
+
         /* Destroy all books */
         for (l = priv->books; l; l = g_list_next (l)) {
                 g_object_unref (l->data);
@@ -94,6 +114,16 @@ dh_book_manager_class_init (DhBookManagerClass *klass)
                               G_TYPE_NONE,
                               0);
 
+        signals[BOOKS_LOADED] =
+                g_signal_new ("books-loaded",
+                              G_TYPE_FROM_CLASS (klass),
+                              G_SIGNAL_RUN_LAST,
+                              G_STRUCT_OFFSET (DhBookManagerClass, books_loaded),
+                              NULL, NULL,
+                              _dh_marshal_VOID__VOID,
+                              G_TYPE_NONE,
+                              0);
+
 	g_type_class_add_private (klass, sizeof (DhBookManagerPriv));
 }
 
@@ -103,6 +133,8 @@ dh_book_manager_init (DhBookManager *book_manager)
         DhBookManagerPriv *priv = GET_PRIVATE (book_manager);
 
         priv->books = NULL;
+        priv->keyword_index = NULL;
+        priv->loading = FALSE;
 }
 
 static void
@@ -137,43 +169,172 @@ book_manager_check_status_from_conf (DhBookManager *book_manager)
 }
 
 static void
-book_manager_add_books_in_data_dir (DhBookManager *book_manager,
-                                    const gchar   *data_dir)
+book_manager_add_books_in_data_dir (DhBookLoad  *load,
+                                    const gchar *data_dir)
 {
         gchar *dir;
 
         dir = g_build_filename (data_dir, "gtk-doc", "html", NULL);
-        book_manager_add_from_dir (book_manager, dir);
+        book_manager_add_from_dir (load, dir);
         g_free (dir);
 
         dir = g_build_filename (data_dir, "devhelp", "books", NULL);
-        book_manager_add_from_dir (book_manager, dir);
+        book_manager_add_from_dir (load, dir);
         g_free (dir);
 }
 
-void
-dh_book_manager_populate (DhBookManager *book_manager)
+/* Finds the books, reading the ones that did not change from the cache, and
+ * indexes their keywords. Runs in the loading thread when populating
+ * asynchronously.
+ */
+static void
+book_manager_load (DhBookLoad *load)
 {
         const gchar * const * system_dirs;
+        gchar                *cache_file;
+        gboolean              stale;
+
+        cache_file = dh_book_cache_get_filename ();
+        load->cache = dh_book_cache_load (cache_file);
 
-        book_manager_add_books_in_data_dir (book_manager,
-                                            g_get_user_data_dir ());
+        book_manager_add_books_in_data_dir (load, g_get_user_data_dir ());
 
         system_dirs = g_get_system_data_dirs ();
         while (*system_dirs) {
-                book_manager_add_books_in_data_dir (book_manager,
-                                                    *system_dirs);
+                book_manager_add_books_in_data_dir (load, *system_dirs);
                 system_dirs++;
         }
 
 #ifdef GDK_WINDOWING_QUARTZ
         book_manager_add_from_xcode_docset (
-                book_manager,
+                load,
                 "/Library/Developer/Shared/Documentation/DocSets");
 #endif
 
+        /* The books do not point into the cache, close it before it is
+         * replaced */
+        stale = dh_book_cache_is_stale (load->cache);
+        dh_book_cache_free (load->cache);
+        load->cache = NULL;
+
+        if (stale) {
+                GList  *books;
+                GError *error = NULL;
+
+                books = g_list_concat (g_list_copy (load->books),
+                                       g_list_copy (load->duplicates));
+                if (!dh_book_cache_save (cache_file, books, &error)) {
+                        g_warning ("Failed to save the book cache: %s",
+                                   error->message);
+                        g_error_free (error);
+                }
+                g_list_free (books);
+        }
+
+        g_free (cache_file);
+
+        g_list_foreach (load->duplicates, (GFunc) g_object_unref, NULL);
+        g_list_free (load->duplicates);
+        load->duplicates = NULL;
+
+        /* Index the keywords while all books are still enabled, disabled
+         * books are then skipped when searching */
+        load->keyword_index = dh_keyword_index_new (load->books);
+}
+
+static void
+book_manager_install (DhBookManager *book_manager,
+                      DhBookLoad    *load)
+{
+        DhBookManagerPriv *priv;
+
+        priv = GET_PRIVATE (book_manager);
+
+        g_list_foreach (priv->books, (GFunc) g_object_unref, NULL);
+        g_list_free (priv->books);
+        dh_keyword_index_free (priv->keyword_index);
+
+        priv->books = load->books;
+        priv->keyword_index = load->keyword_index;
+
         /* Once all books are loaded, check enabled status from conf */
         book_manager_check_status_from_conf (book_manager);
+
+        g_signal_emit (book_manager, signals[BOOKS_LOADED], 0);
+}
+
+void
+dh_book_manager_populate (DhBookManager *book_manager)
+{
+        DhBookLoad load = { NULL, };
+
+        g_return_if_fail (book_manager);
+
+        book_manager_load (&load);
+        book_manager_install (book_manager, &load);
+}
+
+static gboolean
+book_manager_load_done (gpointer data)
+{
+        DhBookLoad *load = data;
+
+        GET_PRIVATE (load->book_manager)->loading = FALSE;
+        book_manager_install (load->book_manager, load);
+
+        g_object_unref (load->book_manager);
+        g_free (load);
+
+        return FALSE;
+}
+
+static gpointer
+book_manager_load_thread (gpointer data)
+{
+        DhBookLoad *load = data;
+
+        book_manager_load (load);
+        g_idle_add (book_manager_load_done, load);
+
+        return NULL;
+}
+
+/* Like dh_book_manager_populate(), but the books are read in a thread. The
+ * manager has no books until "books-loaded" is emitted.
+ */
+void
+dh_book_manager_populate_async (DhBookManager *book_manager)
+{
+        DhBookManagerPriv *priv;
+        DhBookLoad        *load;
+        GError            *error = NULL;
+
+        g_return_if_fail (book_manager);
+
+        priv = GET_PRIVATE (book_manager);
+        if (priv->loading) {
+                return;
+        }
+
+        if (!g_thread_supported ()) {
+                g_thread_init (NULL);
+        }
+
+        load = g_new0 (DhBookLoad, 1);
+        load->book_manager = g_object_ref (book_manager);
+
+        if (!g_thread_create (book_manager_load_thread, load, FALSE, &error)) {
+                g_warning ("Failed to start loading the books: %s",
+                           error->message);
+                g_error_free (error);
+
+                g_object_unref (load->book_manager);
+                g_free (load);
+                dh_book_manager_populate (book_manager);
+                return;
+        }
+
+        priv->loading = TRUE;
 }
 
 static gchar *
@@ -205,13 +366,13 @@ book_manager_get_book_path (const gchar *base_path,
 }
 
 static void
-book_manager_add_from_dir (DhBookManager *book_manager,
-                           const gchar   *dir_path)
+book_manager_add_from_dir (DhBookLoad  *load,
+                           const gchar *dir_path)
 {
         GDir        *dir;
         const gchar *name;
 
-        g_return_if_fail (book_manager);
+        g_return_if_fail (load);
         g_return_if_fail (dir_path);
 
         /* Open directory */
@@ -227,7 +388,7 @@ book_manager_add_from_dir (DhBookManager *book_manager,
                 book_path = book_manager_get_book_path (dir_path, name);
                 if (book_path) {
                         /* Add book from filepath */
-                        book_manager_add_from_filepath (book_manager,
+                        book_manager_add_from_filepath (load,
                                                         book_path);
                         g_free (book_path);
                 }
@@ -264,13 +425,13 @@ seems_docset_dir (const gchar *path)
 }
 
 static void
-book_manager_add_from_xcode_docset (DhBookManager *book_manager,
-                                    const gchar   *dir_path)
+book_manager_add_from_xcode_docset (DhBookLoad  *load,
+                                    const gchar *dir_path)
 {
         GDir        *dir;
         const gchar *name;
 
-        g_return_if_fail (book_manager);
+        g_return_if_fail (load);
         g_return_if_fail (dir_path);
 
         if (!seems_docset_dir (dir_path)) {
@@ -291,7 +452,7 @@ book_manager_add_from_xcode_docset (DhBookManager *book_manager,
 
                         book_path = g_build_filename (path, name, NULL);
                         /* Add book from filepath */
-                        book_manager_add_from_filepath (book_manager,
+                        book_manager_add_from_filepath (load,
                                                         book_path);
                         g_free (book_path);
                 }
@@ -302,39 +463,43 @@ book_manager_add_from_xcode_docset (DhBookManager *book_manager,
 #endif
 
 static void
-book_manager_add_from_filepath (DhBookManager *book_manager,
-                                const gchar   *book_path)
+book_manager_add_from_filepath (DhBookLoad  *load,
+                                const gchar *book_path)
 {
-        DhBookManagerPriv *priv;
-        DhBook            *book;
+        DhBook *book;
+        GList  *l;
 
-        g_return_if_fail (book_manager);
+        g_return_if_fail (load);
         g_return_if_fail (book_path);
 
-        priv = GET_PRIVATE (book_manager);
-
-        /* Allocate new book struct */
-        book = dh_book_new (book_path);
-
         /* Check if book with same path was already loaded in the manager */
-        if (g_list_find_custom (priv->books,
-                                book,
-                                (GCompareFunc)dh_book_cmp_by_path)) {
-                g_object_unref (book);
+        for (l = load->books; l; l = g_list_next (l)) {
+                if (g_strcmp0 (dh_book_get_path (l->data), book_path) == 0) {
+                        return;
+                }
+        }
+
+        /* Use the cached book if the file did not change, parse it
+         * otherwise */
+        book = dh_book_cache_lookup (load->cache, book_path);
+        if (!book) {
+                book = dh_book_new (book_path);
+        }
+        if (!book) {
                 return;
         }
 
         /* Check if book with same bookname was already loaded in the manager
          * (we need to force unique book names) */
-        if (g_list_find_custom (priv->books,
+        if (g_list_find_custom (load->books,
                                 book,
                                 (GCompareFunc)dh_book_cmp_by_name)) {
-                g_object_unref (book);
+                load->duplicates = g_list_prepend (load->duplicates, book);
                 return;
         }
 
         /* Add the book to the book list */
-        priv->books = g_list_insert_sorted (priv->books,
+        load->books = g_list_insert_sorted (load->books,
                                             book,
                                             (GCompareFunc)dh_book_cmp_by_title);
 }
@@ -347,6 +512,14 @@ dh_book_manager_get_books (DhBookManager *book_manager)
         return GET_PRIVATE (book_manager)->books;
 }
 
+DhKeywordIndex *
+dh_book_manager_get_keyword_index (DhBookManager *book_manager)
+{
+        g_return_val_if_fail (book_manager, NULL);
+
+        return GET_PRIVATE (book_manager)->keyword_index;
+}
+
 DhBook *
 dh_book_manager_get_book_by_name (DhBookManager *book_manager,
                                   const gchar *name)
@@ -24,6 +24,7 @@
 #include <gtk/gtk.h>
 
 #include "dh-book.h"
+#include "dh-keyword-index.h"
 
 G_BEGIN_DECLS
 
@@ -46,12 +47,15 @@ struct _DhBookManagerClass {
 
         /* Signals */
         void (* disabled_book_list_updated) (DhBookManager *book_manager);
+        void (* books_loaded)               (DhBookManager *book_manager);
 };
 
 GType          dh_book_manager_get_type         (void) G_GNUC_CONST;
 DhBookManager *dh_book_manager_new              (void);
 void           dh_book_manager_populate         (DhBookManager *book_manager);
+void           dh_book_manager_populate_async   (DhBookManager *book_manager);
 GList         *dh_book_manager_get_books        (DhBookManager *book_manager);
+DhKeywordIndex *dh_book_manager_get_keyword_index (DhBookManager *book_manager);
 DhBook        *dh_book_manager_get_book_by_name (DhBookManager *book_manager,
                                                  const gchar *name);
 void           dh_book_manager_update           (DhBookManager *book_manager);
@@ -31,9 +31,7 @@
 
 typedef struct {
         const gchar *uri;
-        gboolean     found;
-        GtkTreeIter  iter;
-        GtkTreePath *path;
+        GNode       *node;
 } FindURIData;
 
 typedef struct {
@@ -50,6 +48,10 @@ static void book_tree_populate_tree        (DhBookTree       *tree);
 static void book_tree_insert_node          (DhBookTree       *tree,
                                             GNode            *node,
                                             GtkTreeIter      *parent_iter);
+static gboolean book_tree_test_expand_row_cb (GtkTreeView    *view,
+                                            GtkTreeIter      *iter,
+                                            GtkTreePath      *path,
+                                            gpointer          user_data);
 static void book_tree_selection_changed_cb (GtkTreeSelection *selection,
                                             DhBookTree       *tree);
 
@@ -58,10 +60,15 @@ enum {
         LAST_SIGNAL
 };
 
+/* The rows of a node's children are only added when it is expanded, until
+ * then it has a single placeholder row, without link nor node, so that it
+ * shows an expander.
+ */
 enum {
 	COL_TITLE,
 	COL_LINK,
 	COL_WEIGHT,
+	COL_NODE,
 	N_COLUMNS
 };
 
@@ -113,7 +120,8 @@ dh_book_tree_init (DhBookTree *tree)
 	priv->store = gtk_tree_store_new (N_COLUMNS,
 					  G_TYPE_STRING,
 					  G_TYPE_POINTER,
-                                          PANGO_TYPE_WEIGHT);
+                                          PANGO_TYPE_WEIGHT,
+                                          G_TYPE_POINTER);
 	priv->selected_link = NULL;
 	gtk_tree_view_set_model (GTK_TREE_VIEW (tree),
 				 GTK_TREE_MODEL (priv->store));
@@ -123,6 +131,10 @@ dh_book_tree_init (DhBookTree *tree)
 	book_tree_add_columns (tree);
 
 	book_tree_setup_selection (tree);
+
+        g_signal_connect (tree, "test-expand-row",
+                          G_CALLBACK (book_tree_test_expand_row_cb),
+                          NULL);
 }
 
 static void
@@ -199,8 +211,8 @@ book_tree_insert_node (DhBookTree  *tree,
         DhBookTreePriv *priv = GET_PRIVATE (tree);
 	DhLink         *link;
 	GtkTreeIter     iter;
+	GtkTreeIter     child_iter;
         PangoWeight     weight;
-	GNode          *child;
 
 	link = node->data;
 
@@ -216,15 +228,60 @@ book_tree_insert_node (DhBookTree  *tree,
                             COL_TITLE, dh_link_get_name (link),
                             COL_LINK, link,
                             COL_WEIGHT, weight,
+                            COL_NODE, node,
                             -1);
 
+        if (g_node_first_child (node)) {
+                gtk_tree_store_append (priv->store, &child_iter, &iter);
+        }
+}
+
+/* Replaces the placeholder row of iter by the rows of its node's children,
+ * if not done yet.
+ */
+static void
+book_tree_insert_children (DhBookTree  *tree,
+                           GtkTreeIter *iter)
+{
+        DhBookTreePriv *priv = GET_PRIVATE (tree);
+        GtkTreeIter     child_iter;
+        GNode          *node;
+        GNode          *child;
+
+        if (!gtk_tree_model_iter_children (GTK_TREE_MODEL (priv->store),
+                                           &child_iter, iter)) {
+                return;
+        }
+        gtk_tree_model_get (GTK_TREE_MODEL (priv->store), &child_iter,
+                            COL_NODE, &child,
+                            -1);
+        if (child) {
+                return;
+        }
+        gtk_tree_store_remove (priv->store, &child_iter);
+
+        gtk_tree_model_get (GTK_TREE_MODEL (priv->store), iter,
+                            COL_NODE, &node,
+                            -1);
 	for (child = g_node_first_child (node);
 	     child;
 	     child = g_node_next_sibling (child)) {
-		book_tree_insert_node (tree, child, &iter);
+		book_tree_insert_node (tree, child, iter);
 	}
 }
 
+static gboolean
+book_tree_test_expand_row_cb (GtkTreeView *view,
+                              GtkTreeIter *iter,
+                              GtkTreePath *path,
+                              gpointer     user_data)
+{
+        book_tree_insert_children (DH_BOOK_TREE (view), iter);
+
+        /* Allow the expansion */
+        return FALSE;
+}
+
 static void
 book_tree_selection_changed_cb (GtkTreeSelection *selection,
 				DhBookTree       *tree)
@@ -263,6 +320,10 @@ dh_book_tree_new (DhBookManager *book_manager)
                           "disabled-book-list-updated",
                           G_CALLBACK (book_manager_disabled_book_list_changed_cb),
                           tree);
+        g_signal_connect (priv->book_manager,
+                          "books-loaded",
+                          G_CALLBACK (book_manager_disabled_book_list_changed_cb),
+                          tree);
 
         book_tree_populate_tree (tree);
 
@@ -290,27 +351,86 @@ dh_book_tree_new (DhBookManager *book_manager)
 }
 
 static gboolean
-book_tree_find_uri_foreach (GtkTreeModel *model,
-			    GtkTreePath  *path,
-			    GtkTreeIter  *iter,
-			    FindURIData  *data)
+book_tree_find_uri_traverse (GNode       *node,
+                             FindURIData *data)
 {
-	DhLink      *link;
         gchar       *link_uri;
 
-	gtk_tree_model_get (model, iter,
-			    COL_LINK, &link,
-			    -1);
-
-        link_uri = dh_link_get_uri (link);
+        link_uri = dh_link_get_uri (node->data);
 	if (g_str_has_prefix (data->uri, link_uri)) {
-		data->found = TRUE;
-		data->iter = *iter;
-		data->path = gtk_tree_path_copy (path);
+		data->node = node;
 	}
         g_free (link_uri);
 
-	return data->found;
+	return data->node != NULL;
+}
+
+/* Returns the first node, in the order of the tree, whose page contains
+ * uri.
+ */
+static GNode *
+book_tree_find_uri_node (DhBookTree  *tree,
+                         const gchar *uri)
+{
+        DhBookTreePriv *priv = GET_PRIVATE (tree);
+        FindURIData     data;
+        GList          *l;
+
+        data.uri = uri;
+        data.node = NULL;
+
+        for (l = dh_book_manager_get_books (priv->book_manager);
+             l && !data.node;
+             l = g_list_next (l)) {
+                GNode *node;
+
+                for (node = dh_book_get_tree (DH_BOOK (l->data));
+                     node && !data.node;
+                     node = g_node_next_sibling (node)) {
+                        g_node_traverse (node, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
+                                         (GNodeTraverseFunc) book_tree_find_uri_traverse,
+                                         &data);
+                }
+        }
+
+        return data.node;
+}
+
+/* Sets iter to the row of node, adding the rows down to it. */
+static gboolean
+book_tree_get_node_iter (DhBookTree  *tree,
+                         GNode       *node,
+                         GtkTreeIter *iter)
+{
+        DhBookTreePriv *priv = GET_PRIVATE (tree);
+        GtkTreeIter     parent_iter;
+        gboolean        valid;
+
+        if (!node->parent) {
+                valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->store),
+                                                       iter);
+        } else {
+                if (!book_tree_get_node_iter (tree, node->parent, &parent_iter)) {
+                        return FALSE;
+                }
+                book_tree_insert_children (tree, &parent_iter);
+                valid = gtk_tree_model_iter_children (GTK_TREE_MODEL (priv->store),
+                                                      iter, &parent_iter);
+        }
+
+        for (; valid; valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->store),
+                                                        iter)) {
+                GNode *row_node;
+
+                gtk_tree_model_get (GTK_TREE_MODEL (priv->store), iter,
+                                    COL_NODE, &row_node,
+                                    -1);
+                if (row_node == node) {
+                        return TRUE;
+                }
+        }
+
+        return FALSE;
 }
 
 void
@@ -319,18 +439,18 @@ dh_book_tree_select_uri (DhBookTree  *tree,
 {
         DhBookTreePriv   *priv = GET_PRIVATE (tree);
 	GtkTreeSelection *selection;
-	FindURIData       data;
-
-	data.found = FALSE;
-	data.uri = uri;
-
-	gtk_tree_model_foreach (GTK_TREE_MODEL (priv->store),
-				(GtkTreeModelForeachFunc) book_tree_find_uri_foreach,
-				&data);
-
-	if (!data.found) {
+        GtkTreeIter       iter;
+        GtkTreePath      *path;
+        GNode            *node;
+
+        /* Looked for in the books rather than in the rows, most of which
+         * are not there yet.
+         */
+        node = book_tree_find_uri_node (tree, uri);
+	if (!node || !book_tree_get_node_iter (tree, node, &iter)) {
 		return;
 	}
+        path = gtk_tree_model_get_path (GTK_TREE_MODEL (priv->store), &iter);
 
 	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (tree));
 
@@ -338,15 +458,15 @@ dh_book_tree_select_uri (DhBookTree  *tree,
 					 book_tree_selection_changed_cb,
 					 tree);
 
-	gtk_tree_view_expand_to_path (GTK_TREE_VIEW (tree), data.path);
-	gtk_tree_selection_select_iter (selection, &data.iter);
-	gtk_tree_view_set_cursor (GTK_TREE_VIEW (tree), data.path, NULL, 0);
+	gtk_tree_view_expand_to_path (GTK_TREE_VIEW (tree), path);
+	gtk_tree_selection_select_iter (selection, &iter);
+	gtk_tree_view_set_cursor (GTK_TREE_VIEW (tree), path, NULL, 0);
 
 	g_signal_handlers_unblock_by_func (selection,
 					   book_tree_selection_changed_cb,
 					   tree);
 
-	gtk_tree_path_free (data.path);
+	gtk_tree_path_free (path);
 }
 
 const gchar *
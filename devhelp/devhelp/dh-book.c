@@ -114,6 +114,22 @@ unref_node_link (GNode *node,
         dh_link_unref (node->data);
 }
 
+static void
+book_setup (DhBook      *book,
+            const gchar *book_path)
+{
+        DhBookPriv *priv = GET_PRIVATE (book);
+
+        /* Store path */
+        priv->path = g_strdup (book_path);
+
+        /* Setup title */
+        priv->title = g_strdup (dh_link_get_name ((DhLink *)priv->tree->data));
+
+        /* Setup name */
+        priv->name = g_strdup (dh_link_get_book_id ((DhLink *)priv->tree->data));
+}
+
 DhBook *
 dh_book_new (const gchar  *book_path)
 {
@@ -132,7 +148,7 @@ dh_book_new (const gchar  *book_path)
                                    &priv->keywords,
                                    &error)) {
                 g_warning ("Failed to read '%s': %s",
-                           priv->path, error->message);
+                           book_path, error->message);
                 g_error_free (error);
 
                 /* Deallocate the book, as we are not going to add it
@@ -141,18 +157,48 @@ dh_book_new (const gchar  *book_path)
                 return NULL;
         }
 
-        /* Store path */
-        priv->path = g_strdup (book_path);
+        book_setup (book, book_path);
 
-        /* Setup title */
-        priv->title = g_strdup (dh_link_get_name ((DhLink *)priv->tree->data));
+        return book;
+}
 
-        /* Setup name */
-        priv->name = g_strdup (dh_link_get_book_id ((DhLink *)priv->tree->data));
+/* Creates a book from an already parsed tree and keywords, as stored in the
+ * book cache. The book takes ownership of both.
+ */
+DhBook *
+dh_book_new_from_data (const gchar *book_path,
+                       GNode       *tree,
+                       GList       *keywords)
+{
+        DhBookPriv *priv;
+        DhBook     *book;
+
+        g_return_val_if_fail (book_path, NULL);
+        g_return_val_if_fail (tree, NULL);
+
+        book = g_object_new (DH_TYPE_BOOK, NULL);
+        priv = GET_PRIVATE (book);
+
+        priv->tree = tree;
+        priv->keywords = keywords;
+
+        book_setup (book, book_path);
 
         return book;
 }
 
+const gchar *
+dh_book_get_path (DhBook *book)
+{
+        DhBookPriv *priv;
+
+        g_return_val_if_fail (DH_IS_BOOK (book), NULL);
+
+        priv = GET_PRIVATE (book);
+
+        return priv->path;
+}
+
 GList *
 dh_book_get_keywords (DhBook *book)
 {
@@ -48,6 +48,10 @@ struct _DhBookClass {
 
 GType        dh_book_get_type     (void) G_GNUC_CONST;
 DhBook      *dh_book_new          (const gchar  *book_path);
+DhBook      *dh_book_new_from_data (const gchar *book_path,
+                                    GNode       *tree,
+                                    GList       *keywords);
+const gchar *dh_book_get_path     (DhBook *book);
 GList       *dh_book_get_keywords (DhBook *book);
 GNode       *dh_book_get_tree     (DhBook *book);
 const gchar *dh_book_get_name     (DhBook *book);
@@ -0,0 +1,365 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The keywords of all the books, sorted by their case-folded name, plus a
+ * trigram index over those names. A search looks at the keywords starting
+ * with the first term (a binary search in the sorted array), then at the
+ * keywords containing the rarest trigram of the terms. Nothing is allocated
+ * per candidate.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "dh-keyword-index.h"
+
+typedef struct {
+        const gchar *folded;    /* case-folded name, in the string chunk */
+        DhLink      *link;
+        DhBook      *book;
+} DhKeywordEntry;
+
+typedef struct {
+        guint offset;           /* in the postings array */
+        guint length;
+        guint last;             /* last entry added, while building */
+} DhTrigramSlot;
+
+struct _DhKeywordIndex {
+        DhKeywordEntry *entries;
+        guint           n_entries;
+        GStringChunk   *names;
+
+        /* trigram -> slot index + 1 */
+        GHashTable     *trigrams;
+        DhTrigramSlot  *slots;
+        guint          *postings;  /* entry indexes, ascending for each slot */
+};
+
+#define TRIGRAM(s) (((guint)(guchar)(s)[0] << 16) | \
+                    ((guint)(guchar)(s)[1] << 8) |  \
+                    (guint)(guchar)(s)[2])
+
+static gint
+keyword_entry_compare (gconstpointer a,
+                       gconstpointer b)
+{
+        const DhKeywordEntry *ea = a;
+        const DhKeywordEntry *eb = b;
+        gint                  diff;
+
+        diff = strcmp (ea->folded, eb->folded);
+        if (diff != 0) {
+                return diff;
+        }
+
+        return dh_link_compare (ea->link, eb->link);
+}
+
+static DhTrigramSlot *
+keyword_index_lookup (DhKeywordIndex *index,
+                      guint           trigram)
+{
+        guint slot;
+
+        slot = GPOINTER_TO_UINT (g_hash_table_lookup (index->trigrams,
+                                                      GUINT_TO_POINTER (trigram)));
+
+        return slot ? &index->slots[slot - 1] : NULL;
+}
+
+static void
+keyword_index_build_trigrams (DhKeywordIndex *index)
+{
+        GArray *slots;
+        guint   n_postings = 0;
+        guint   i;
+
+        index->trigrams = g_hash_table_new (g_direct_hash, g_direct_equal);
+        slots = g_array_new (FALSE, FALSE, sizeof (DhTrigramSlot));
+
+        /* First count the entries of each trigram, an entry is only counted
+         * once per trigram.
+         */
+        for (i = 0; i < index->n_entries; i++) {
+                const gchar *s;
+
+                for (s = index->entries[i].folded; s[0] && s[1] && s[2]; s++) {
+                        DhTrigramSlot *slot;
+                        guint          n;
+
+                        n = GPOINTER_TO_UINT (g_hash_table_lookup (index->trigrams,
+                                                                   GUINT_TO_POINTER (TRIGRAM (s))));
+                        if (n == 0) {
+                                DhTrigramSlot new_slot = { 0, 0, G_MAXUINT };
+
+                                g_array_append_val (slots, new_slot);
+                                n = slots->len;
+                                g_hash_table_insert (index->trigrams,
+                                                     GUINT_TO_POINTER (TRIGRAM (s)),
+                                                     GUINT_TO_POINTER (n));
+                        }
+
+                        slot = &g_array_index (slots, DhTrigramSlot, n - 1);
+                        if (slot->last != i) {
+                                slot->last = i;
+                                slot->length++;
+                                n_postings++;
+                        }
+                }
+        }
+
+        index->slots = (DhTrigramSlot *) g_array_free (slots, FALSE);
+        index->postings = g_new (guint, n_postings);
+
+        /* Then lay the lists out one after the other and fill them. */
+        n_postings = 0;
+        for (i = 0; i < g_hash_table_size (index->trigrams); i++) {
+                index->slots[i].offset = n_postings;
+                n_postings += index->slots[i].length;
+                index->slots[i].length = 0;
+                index->slots[i].last = G_MAXUINT;
+        }
+
+        for (i = 0; i < index->n_entries; i++) {
+                const gchar *s;
+
+                for (s = index->entries[i].folded; s[0] && s[1] && s[2]; s++) {
+                        DhTrigramSlot *slot;
+
+                        slot = keyword_index_lookup (index, TRIGRAM (s));
+                        if (slot->last != i) {
+                                slot->last = i;
+                                index->postings[slot->offset + slot->length++] = i;
+                        }
+                }
+        }
+}
+
+/* Builds the index of the keywords of the given books. Books disabled at
+ * this point are not indexed, books disabled later are skipped when
+ * searching.
+ */
+DhKeywordIndex *
+dh_keyword_index_new (GList *books)
+{
+        DhKeywordIndex *index;
+        GList          *b, *l;
+        guint           n = 0;
+
+        index = g_new0 (DhKeywordIndex, 1);
+        index->names = g_string_chunk_new (64 * 1024);
+
+        for (b = books; b; b = g_list_next (b)) {
+                n += g_list_length (dh_book_get_keywords (DH_BOOK (b->data)));
+        }
+
+        index->entries = g_new (DhKeywordEntry, n);
+
+        for (b = books; b; b = g_list_next (b)) {
+                DhBook *book = DH_BOOK (b->data);
+
+                for (l = dh_book_get_keywords (book); l; l = g_list_next (l)) {
+                        DhKeywordEntry *entry = &index->entries[index->n_entries++];
+                        const gchar    *name;
+                        gchar          *folded;
+                        gchar          *p;
+
+                        name = dh_link_get_name (l->data);
+                        folded = g_string_chunk_insert (index->names, name ? name : "");
+                        for (p = folded; *p; p++) {
+                                *p = g_ascii_tolower (*p);
+                        }
+
+                        entry->folded = folded;
+                        entry->link = l->data;
+                        entry->book = book;
+                }
+        }
+
+        qsort (index->entries, index->n_entries, sizeof (DhKeywordEntry),
+               keyword_entry_compare);
+
+        keyword_index_build_trigrams (index);
+
+        return index;
+}
+
+void
+dh_keyword_index_free (DhKeywordIndex *index)
+{
+        if (!index) {
+                return;
+        }
+
+        g_hash_table_destroy (index->trigrams);
+        g_free (index->slots);
+        g_free (index->postings);
+        g_string_chunk_free (index->names);
+        g_free (index->entries);
+        g_free (index);
+}
+
+/* Returns the first entry whose folded name is not lower than prefix */
+static guint
+keyword_index_lower_bound (DhKeywordIndex *index,
+                           const gchar    *prefix)
+{
+        guint lo = 0;
+        guint hi = index->n_entries;
+
+        while (lo < hi) {
+                guint mid = lo + (hi - lo) / 2;
+
+                if (strcmp (index->entries[mid].folded, prefix) < 0) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+
+        return lo;
+}
+
+static gboolean
+keyword_index_match (DhKeywordEntry  *entry,
+                     gchar          **terms,
+                     gboolean         case_sensitive)
+{
+        const gchar *name;
+        gint         i;
+
+        if (!dh_book_get_enabled (entry->book)) {
+                return FALSE;
+        }
+
+        name = case_sensitive ? dh_link_get_name (entry->link) : entry->folded;
+        if (!name) {
+                name = "";
+        }
+
+        for (i = 0; terms[i] != NULL; i++) {
+                if (!strstr (name, terms[i])) {
+                        return FALSE;
+                }
+        }
+
+        return TRUE;
+}
+
+/* Calls func for the keywords containing all the terms. The keywords whose
+ * name starts with the first term come first. Unless case_sensitive is set,
+ * the terms must be lower case.
+ */
+void
+dh_keyword_index_search (DhKeywordIndex      *index,
+                         gchar              **terms,
+                         gboolean             case_sensitive,
+                         DhKeywordIndexFunc   func,
+                         gpointer             user_data)
+{
+        gchar         **folded_terms;
+        DhTrigramSlot  *rarest = NULL;
+        guint           prefix_start = 0;
+        guint           prefix_end = 0;
+        guint           i;
+        gint            t;
+
+        g_return_if_fail (index != NULL);
+        g_return_if_fail (terms != NULL);
+
+        /* The index only knows about folded names. */
+        folded_terms = g_new (gchar *, g_strv_length (terms) + 1);
+        for (t = 0; terms[t] != NULL; t++) {
+                folded_terms[t] = case_sensitive ?
+                        g_ascii_strdown (terms[t], -1) : terms[t];
+        }
+        folded_terms[t] = NULL;
+
+        /* Keywords starting with the first term. */
+        if (folded_terms[0] && folded_terms[0][0] != '\0') {
+                prefix_start = keyword_index_lower_bound (index, folded_terms[0]);
+                for (prefix_end = prefix_start;
+                     prefix_end < index->n_entries &&
+                             g_str_has_prefix (index->entries[prefix_end].folded,
+                                               folded_terms[0]);
+                     prefix_end++) {
+                        DhKeywordEntry *entry = &index->entries[prefix_end];
+
+                        if (keyword_index_match (entry, terms, case_sensitive) &&
+                            !func (entry->link, user_data)) {
+                                goto out;
+                        }
+                }
+        }
+
+        /* The other candidates are the keywords containing the rarest
+         * trigram of the terms, if any term is long enough.
+         */
+        for (t = 0; folded_terms[t] != NULL; t++) {
+                const gchar *s;
+
+                for (s = folded_terms[t]; s[0] && s[1] && s[2]; s++) {
+                        DhTrigramSlot *slot;
+
+                        slot = keyword_index_lookup (index, TRIGRAM (s));
+                        if (!slot) {
+                                /* No keyword contains this term. */
+                                goto out;
+                        }
+                        if (!rarest || slot->length < rarest->length) {
+                                rarest = slot;
+                        }
+                }
+        }
+
+        if (rarest) {
+                for (i = 0; i < rarest->length; i++) {
+                        guint           n = index->postings[rarest->offset + i];
+                        DhKeywordEntry *entry = &index->entries[n];
+
+                        if (n >= prefix_start && n < prefix_end) {
+                                continue;
+                        }
+                        if (keyword_index_match (entry, terms, case_sensitive) &&
+                            !func (entry->link, user_data)) {
+                                goto out;
+                        }
+                }
+        } else {
+                for (i = 0; i < index->n_entries; i++) {
+                        DhKeywordEntry *entry = &index->entries[i];
+
+                        if (i >= prefix_start && i < prefix_end) {
+                                continue;
+                        }
+                        if (keyword_index_match (entry, terms, case_sensitive) &&
+                            !func (entry->link, user_data)) {
+                                goto out;
+                        }
+                }
+        }
+
+out:
+        if (case_sensitive) {
+                g_strfreev (folded_terms);
+        } else {
+                g_free (folded_terms);
+        }
+}
@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __DH_KEYWORD_INDEX_H__
+#define __DH_KEYWORD_INDEX_H__
+
+#include <glib.h>
+
+#include "dh-link.h"
+#include "dh-book.h"
+
+G_BEGIN_DECLS
+
+typedef struct _DhKeywordIndex DhKeywordIndex;
+
+/* Called for every keyword matching a search, in the index order.
+ * Returning FALSE stops the search.
+ */
+typedef gboolean (* DhKeywordIndexFunc) (DhLink   *link,
+                                         gpointer  user_data);
+
+DhKeywordIndex *dh_keyword_index_new    (GList               *books);
+void            dh_keyword_index_free   (DhKeywordIndex      *index);
+void            dh_keyword_index_search (DhKeywordIndex      *index,
+                                         gchar              **terms,
+                                         gboolean             case_sensitive,
+                                         DhKeywordIndexFunc   func,
+                                         gpointer             user_data);
+
+G_END_DECLS
+
+#endif /* __DH_KEYWORD_INDEX_H__ */
@@ -26,19 +26,21 @@
 
 #include "dh-link.h"
 #include "dh-book.h"
+#include "dh-keyword-index.h"
 #include "dh-keyword-model.h"
 
 struct _DhKeywordModelPriv {
         DhBookManager *book_manager;
 
-        GList *keyword_words;
-        gint   keyword_words_length;
+        /* The hits, iters hold their index */
+        GPtrArray *keyword_words;
 
-        gint   stamp;
+        gint       stamp;
 };
 
-#define G_LIST(x) ((GList *) x)
 #define MAX_HITS 100
+/* Above this many rows to update, the view is refilled instead */
+#define MAX_ROW_SIGNALS (MAX_HITS / 4)
 
 static void dh_keyword_model_init            (DhKeywordModel      *list_store);
 static void dh_keyword_model_class_init      (DhKeywordModelClass *class);
@@ -68,7 +70,7 @@ keyword_model_finalize (GObject *object)
         DhKeywordModel     *model = DH_KEYWORD_MODEL (object);
         DhKeywordModelPriv *priv = model->priv;
 
-        g_list_free (priv->keyword_words);
+        g_ptr_array_free (priv->keyword_words, TRUE);
 
         g_free (model->priv);
 
@@ -92,6 +94,8 @@ dh_keyword_model_init (DhKeywordModel *model)
         priv = g_new0 (DhKeywordModelPriv, 1);
         model->priv = priv;
 
+        priv->keyword_words = g_ptr_array_new ();
+
         do {
                 priv->stamp = g_random_int ();
         } while (priv->stamp == 0);
@@ -131,7 +135,6 @@ keyword_model_get_iter (GtkTreeModel *tree_model,
 {
         DhKeywordModel     *model;
         DhKeywordModelPriv *priv;
-        GList              *node;
         const gint         *indices;
 
         model = DH_KEYWORD_MODEL (tree_model);
@@ -143,14 +146,12 @@ keyword_model_get_iter (GtkTreeModel *tree_model,
                 return FALSE;
         }
 
-        if (indices[0] >= priv->keyword_words_length) {
+        if (indices[0] < 0 || indices[0] >= (gint) priv->keyword_words->len) {
                 return FALSE;
         }
 
-        node = g_list_nth (priv->keyword_words, indices[0]);
-
         iter->stamp     = priv->stamp;
-        iter->user_data = node;
+        iter->user_data = GINT_TO_POINTER (indices[0]);
 
         return TRUE;
 }
@@ -160,23 +161,16 @@ keyword_model_get_path (GtkTreeModel *tree_model,
                         GtkTreeIter  *iter)
 {
         DhKeywordModel     *model = DH_KEYWORD_MODEL (tree_model);
-        DhKeywordModelPriv *priv;
-        GtkTreePath        *path;
-        gint                i = 0;
+        gint                i;
 
         g_return_val_if_fail (iter->stamp == model->priv->stamp, NULL);
 
-        priv = model->priv;
-
-        i = g_list_position (priv->keyword_words, iter->user_data);
-        if (i < 0) {
+        i = GPOINTER_TO_INT (iter->user_data);
+        if (i >= (gint) model->priv->keyword_words->len) {
                 return NULL;
         }
 
-        path = gtk_tree_path_new ();
-        gtk_tree_path_append_index (path, i);
-
-        return path;
+        return gtk_tree_path_new_from_indices (i, -1);
 }
 
 static void
@@ -185,9 +179,11 @@ keyword_model_get_value (GtkTreeModel *tree_model,
                          gint          column,
                          GValue       *value)
 {
-        DhLink *link;
+        DhKeywordModel *model = DH_KEYWORD_MODEL (tree_model);
+        DhLink         *link;
 
-        link = G_LIST (iter->user_data)->data;
+        link = g_ptr_array_index (model->priv->keyword_words,
+                                  GPOINTER_TO_INT (iter->user_data));
 
         switch (column) {
         case DH_KEYWORD_MODEL_COL_NAME:
@@ -208,12 +204,14 @@ keyword_model_iter_next (GtkTreeModel *tree_model,
                          GtkTreeIter  *iter)
 {
         DhKeywordModel *model = DH_KEYWORD_MODEL (tree_model);
+        gint            i;
 
         g_return_val_if_fail (model->priv->stamp == iter->stamp, FALSE);
 
-        iter->user_data = G_LIST (iter->user_data)->next;
+        i = GPOINTER_TO_INT (iter->user_data) + 1;
+        iter->user_data = GINT_TO_POINTER (i);
 
-        return (iter->user_data != NULL);
+        return i < (gint) model->priv->keyword_words->len;
 }
 
 static gboolean
@@ -233,9 +231,9 @@ keyword_model_iter_children (GtkTreeModel *tree_model,
         /* But if parent == NULL we return the list itself as children of
          * the "root".
          */
-        if (priv->keyword_words) {
+        if (priv->keyword_words->len > 0) {
                 iter->stamp = priv->stamp;
-                iter->user_data = priv->keyword_words;
+                iter->user_data = GINT_TO_POINTER (0);
                 return TRUE;
         }
 
@@ -258,7 +256,7 @@ keyword_model_iter_n_children (GtkTreeModel *tree_model,
         priv = DH_KEYWORD_MODEL (tree_model)->priv;
 
         if (iter == NULL) {
-                return priv->keyword_words_length;
+                return priv->keyword_words->len;
         }
 
         g_return_val_if_fail (priv->stamp == iter->stamp, -1);
@@ -273,7 +271,6 @@ keyword_model_iter_nth_child (GtkTreeModel *tree_model,
                               gint          n)
 {
         DhKeywordModelPriv *priv;
-        GList              *child;
 
         priv = DH_KEYWORD_MODEL (tree_model)->priv;
 
@@ -281,11 +278,9 @@ keyword_model_iter_nth_child (GtkTreeModel *tree_model,
                 return FALSE;
         }
 
-        child = g_list_nth (priv->keyword_words, n);
-
-        if (child) {
+        if (n >= 0 && n < (gint) priv->keyword_words->len) {
                 iter->stamp = priv->stamp;
-                iter->user_data = child;
+                iter->user_data = GINT_TO_POINTER (n);
                 return TRUE;
         }
 
@@ -336,7 +331,55 @@ dh_keyword_model_set_words (DhKeywordModel *model,
         model->priv->book_manager = g_object_ref (book_manager);
 }
 
-static GList *
+typedef struct {
+        const gchar  *string;
+        const gchar  *book_id;
+        const gchar  *page_id;
+        gchar        *page_filename_prefix;
+        GPtrArray    *hits;
+        DhLink      **exact_link;
+} DhKeywordSearch;
+
+static gboolean
+keyword_model_search_hit (DhLink   *link,
+                          gpointer  user_data)
+{
+        DhKeywordSearch *search = user_data;
+
+        if (search->book_id &&
+            dh_link_get_book_id (link) &&
+            strcmp (dh_link_get_book_id (link), search->book_id) != 0) {
+                return TRUE;
+        }
+
+        if (search->page_id &&
+            (dh_link_get_link_type (link) != DH_LINK_TYPE_PAGE &&
+             !g_str_has_prefix (dh_link_get_file_name (link), search->page_filename_prefix))) {
+                return TRUE;
+        }
+
+        /* Include in the new list. */
+        g_ptr_array_add (search->hits, link);
+
+        if (!*search->exact_link &&
+            dh_link_get_name (link) && (
+                    (dh_link_get_link_type (link) == DH_LINK_TYPE_PAGE &&
+                     search->page_id && strcmp (dh_link_get_name (link), search->page_id) == 0) ||
+                    (strcmp (dh_link_get_name (link), search->string) == 0))) {
+                *search->exact_link = link;
+        }
+
+        return search->hits->len < MAX_HITS;
+}
+
+static gint
+keyword_model_hit_compare (gconstpointer a,
+                           gconstpointer b)
+{
+        return dh_link_compare (*(DhLink * const *) a, *(DhLink * const *) b);
+}
+
+static GPtrArray *
 keyword_model_search (DhKeywordModel  *model,
                       const gchar     *string,
                       gchar          **stringv,
@@ -345,126 +388,129 @@ keyword_model_search (DhKeywordModel  *model,
                       DhLink         **exact_link)
 {
         DhKeywordModelPriv *priv;
-        GList              *new_list = NULL, *b;
-        gint                hits = 0;
-        gchar              *page_id = NULL;
-        gchar              *page_filename_prefix = NULL;
+        DhKeywordIndex     *index;
+        DhKeywordSearch     search = { 0 };
 
         priv = model->priv;
 
+        index = dh_book_manager_get_keyword_index (priv->book_manager);
+        if (!index) {
+                return g_ptr_array_new ();
+        }
+
+        search.hits = g_ptr_array_sized_new (MAX_HITS);
+        search.string = string;
+        search.book_id = book_id;
+        search.exact_link = exact_link;
+
         /* The search string may be prefixed by a page:foobar qualifier, it
          * will be matched against the filenames of the hits to limit the
          * search to pages whose filename is prefixed by "foobar.
          */
         if (stringv && g_str_has_prefix(stringv[0], "page:")) {
-                page_id = stringv[0] + 5;
-                page_filename_prefix = g_strdup_printf("%s.", page_id);
+                search.page_id = stringv[0] + 5;
+                search.page_filename_prefix = g_strdup_printf("%s.", search.page_id);
                 stringv++;
         }
 
-        for (b = dh_book_manager_get_books (priv->book_manager);
-             b && hits < MAX_HITS;
-             b = g_list_next (b)) {
-                DhBook *book;
-                GList *l;
-
-                book = DH_BOOK (b->data);
-
-                for (l = dh_book_get_keywords (book);
-                     l && hits < MAX_HITS;
-                     l = g_list_next (l)) {
-                        DhLink   *link;
-                        gboolean  found;
-                        gchar    *name;
+        if (stringv[0] == NULL) {
+                /* means only a page was specified, no keyword */
+                gchar *page_terms[2];
+
+                page_terms[0] = (gchar *) search.page_id;
+                page_terms[1] = NULL;
+                dh_keyword_index_search (index, page_terms, TRUE,
+                                         keyword_model_search_hit, &search);
+        } else {
+                dh_keyword_index_search (index, stringv, case_sensitive,
+                                         keyword_model_search_hit, &search);
+        }
 
-                        link = l->data;
-                        found = FALSE;
+        g_free (search.page_filename_prefix);
 
-                        if (book_id &&
-                            dh_link_get_book_id (link) &&
-                            strcmp (dh_link_get_book_id (link), book_id) != 0) {
-                                continue;
-                        }
+        g_ptr_array_sort (search.hits, keyword_model_hit_compare);
 
-                        if (page_id &&
-                            (dh_link_get_link_type (link) != DH_LINK_TYPE_PAGE &&
-                             !g_str_has_prefix (dh_link_get_file_name (link), page_filename_prefix))) {
-                                continue;
-                        }
+        return search.hits;
+}
 
-                        if (!case_sensitive) {
-                                name = g_ascii_strdown (dh_link_get_name (link), -1);
-                        } else {
-                                name = g_strdup (dh_link_get_name (link));
-                        }
+/* Emits the row signals taking the rows from old to new, with a single path */
+static void
+keyword_model_update_rows (DhKeywordModel *model,
+                           GPtrArray      *old_words,
+                           GPtrArray      *new_words)
+{
+        GtkTreeModel *tree_model = GTK_TREE_MODEL (model);
+        GtkTreePath  *path;
+        GtkTreeIter   iter;
+        guint         i;
+
+        path = gtk_tree_path_new_first ();
+        iter.stamp = model->priv->stamp;
+
+        /* Rows 0 -> hits, skipping the rows that still show the same link. */
+        for (i = 0; i < MIN (old_words->len, new_words->len); i++) {
+                if (g_ptr_array_index (old_words, i) != g_ptr_array_index (new_words, i)) {
+                        iter.user_data = GINT_TO_POINTER (i);
+                        gtk_tree_model_row_changed (tree_model, path, &iter);
+                }
+                gtk_tree_path_next (path);
+        }
 
-                        if (!found) {
-                                gint i;
-
-                                if (stringv[0] == NULL) {
-                                        /* means only a page was specified, no keyword */
-                                        if (g_strrstr (dh_link_get_name(link), page_id))
-                                                found = TRUE;
-                                } else {
-                                        found = TRUE;
-                                        for (i = 0; stringv[i] != NULL; i++) {
-                                                if (!g_strrstr (name, stringv[i])) {
-                                                        found = FALSE;
-                                                        break;
-                                                }
-                                        }
-                                }
-                        }
+        /* Remove rows hits -> old length, each taking the place of the
+         * one before. */
+        for (i = new_words->len; i < old_words->len; i++) {
+                gtk_tree_model_row_deleted (tree_model, path);
+        }
 
-                        g_free (name);
+        /* Add rows old length -> hits. */
+        for (i = old_words->len; i < new_words->len; i++) {
+                iter.user_data = GINT_TO_POINTER (i);
+                gtk_tree_model_row_inserted (tree_model, path, &iter);
+                gtk_tree_path_next (path);
+        }
 
-                        if (found) {
-                                /* Include in the new list. */
-                                new_list = g_list_prepend (new_list, link);
-                                hits++;
+        gtk_tree_path_free (path);
+}
 
-                                if (!*exact_link &&
-                                    dh_link_get_name (link) && (
-                                            (dh_link_get_link_type (link) == DH_LINK_TYPE_PAGE &&
-                                             page_id && strcmp (dh_link_get_name (link), page_id) == 0) ||
-                                            (strcmp (dh_link_get_name (link), string) == 0))) {
-                                        *exact_link = link;
-                                }
-                        }
+static guint
+keyword_model_count_row_signals (GPtrArray *old_words,
+                                 GPtrArray *new_words)
+{
+        guint n_signals;
+        guint i;
+
+        n_signals = MAX (old_words->len, new_words->len) -
+                    MIN (old_words->len, new_words->len);
+        for (i = 0; i < MIN (old_words->len, new_words->len); i++) {
+                if (g_ptr_array_index (old_words, i) != g_ptr_array_index (new_words, i)) {
+                        n_signals++;
                 }
         }
 
-        g_free (page_filename_prefix);
-
-        return g_list_sort (new_list, dh_link_compare);
+        return n_signals;
 }
 
+/* When view is given and most of the rows change, the model is taken off the
+ * view while it is updated, the view reading all the rows once instead of
+ * handling a signal per row. */
 DhLink *
 dh_keyword_model_filter (DhKeywordModel *model,
                          const gchar    *string,
-                         const gchar    *book_id)
+                         const gchar    *book_id,
+                         GtkTreeView    *view)
 {
         DhKeywordModelPriv  *priv;
-        GList               *new_list = NULL;
-        gint                 old_length;
+        GPtrArray           *new_words;
+        GPtrArray           *old_words;
         DhLink              *exact_link = NULL;
-        gint                 hits;
+        gboolean             detach;
         gint                 i;
-        GtkTreePath         *path;
-        GtkTreeIter          iter;
 
         g_return_val_if_fail (DH_IS_KEYWORD_MODEL (model), NULL);
         g_return_val_if_fail (string != NULL, NULL);
 
         priv = model->priv;
 
-        /* Do the minimum amount of work: call update on all rows that are
-         * kept and remove the rest.
-         */
-        old_length = priv->keyword_words_length;
-        new_list = NULL;
-        hits = 0;
-
         if (string[0] != '\0') {
                 gchar    **stringv;
                 gboolean   case_sensitive;
@@ -492,53 +538,43 @@ dh_keyword_model_filter (DhKeywordModel *model,
                         g_free (lower);
                 }
 
-                new_list = keyword_model_search (model,
-                                                 string,
-                                                 stringv,
-                                                 book_id,
-                                                 case_sensitive,
-                                                 &exact_link);
-                hits = g_list_length (new_list);
+                new_words = keyword_model_search (model,
+                                                  string,
+                                                  stringv,
+                                                  book_id,
+                                                  case_sensitive,
+                                                  &exact_link);
 
                 g_strfreev (stringv);
+        } else {
+                new_words = g_ptr_array_new ();
         }
 
         /* Update the list of hits. */
-        g_list_free (priv->keyword_words);
-        priv->keyword_words = new_list;
-        priv->keyword_words_length = hits;
-
-        /* Update model: rows 0 -> hits. */
-        for (i = 0; i < hits; ++i) {
-                path = gtk_tree_path_new ();
-                gtk_tree_path_append_index (path, i);
-                keyword_model_get_iter (GTK_TREE_MODEL (model), &iter, path);
-                gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
-                gtk_tree_path_free (path);
+        old_words = priv->keyword_words;
+        priv->keyword_words = new_words;
+
+        detach = view != NULL &&
+                 gtk_tree_view_get_model (view) == GTK_TREE_MODEL (model) &&
+                 keyword_model_count_row_signals (old_words, new_words) > MAX_ROW_SIGNALS;
+        if (detach) {
+                g_object_ref (model);
+                gtk_tree_view_set_model (view, NULL);
         }
 
-        if (old_length > hits) {
-                /* Update model: remove rows hits -> old_length. */
-                for (i = old_length - 1; i >= hits; i--) {
-                        path = gtk_tree_path_new ();
-                        gtk_tree_path_append_index (path, i);
-                        gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
-                        gtk_tree_path_free (path);
-                }
-        }
-        else if (old_length < hits) {
-                /* Update model: add rows old_length -> hits. */
-                for (i = old_length; i < hits; i++) {
-                        path = gtk_tree_path_new ();
-                        gtk_tree_path_append_index (path, i);
-                        keyword_model_get_iter (GTK_TREE_MODEL (model), &iter, path);
-                        gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
-                        gtk_tree_path_free (path);
-                }
+        /* Do the minimum amount of work: call update on all rows that are
+         * kept and remove the rest.
+         */
+        keyword_model_update_rows (model, old_words, new_words);
+        g_ptr_array_free (old_words, TRUE);
+
+        if (detach) {
+                gtk_tree_view_set_model (view, GTK_TREE_MODEL (model));
+                g_object_unref (model);
         }
 
-        if (hits == 1) {
-                return priv->keyword_words->data;
+        if (new_words->len == 1) {
+                return g_ptr_array_index (new_words, 0);
         }
 
         return exact_link;
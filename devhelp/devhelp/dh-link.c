@@ -212,6 +212,35 @@ dh_link_get_book_id (DhLink *link)
         return "";
 }
 
+const gchar *
+dh_link_get_base (DhLink *link)
+{
+        if (link->type == DH_LINK_TYPE_BOOK) {
+                return link->base;
+        }
+
+        if (link->book) {
+                return link->book->base;
+        }
+
+        return "";
+}
+
+/* Unlike dh_link_get_file_name(), also returns the file of books and
+ * pages.
+ */
+const gchar *
+dh_link_get_filename (DhLink *link)
+{
+        return link->filename;
+}
+
+DhLink *
+dh_link_get_page (DhLink *link)
+{
+        return link->page;
+}
+
 gchar *
 dh_link_get_uri (DhLink *link)
 {
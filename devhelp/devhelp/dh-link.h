@@ -62,6 +62,9 @@ const gchar *dh_link_get_book_name      (DhLink        *link);
 const gchar *dh_link_get_page_name      (DhLink        *link);
 const gchar *dh_link_get_file_name      (DhLink        *link);
 const gchar *dh_link_get_book_id        (DhLink        *link);
+const gchar *dh_link_get_base           (DhLink        *link);
+const gchar *dh_link_get_filename       (DhLink        *link);
+DhLink      *dh_link_get_page           (DhLink        *link);
 gchar       *dh_link_get_uri            (DhLink        *link);
 DhLinkFlags  dh_link_get_flags          (DhLink        *link);
 void         dh_link_set_flags          (DhLink        *link,
@@ -361,7 +361,8 @@ search_entry_activated_cb (GtkEntry *entry,
 
         id = search_combo_get_active_id (search);
         str = gtk_entry_get_text (GTK_ENTRY (priv->entry));
-        dh_keyword_model_filter (priv->model, str, id);
+        dh_keyword_model_filter (priv->model, str, id,
+                                 GTK_TREE_VIEW (priv->hitlist));
         g_free (id);
 }
 
@@ -417,7 +418,8 @@ search_filter_idle (DhSearch *search)
 
         str = gtk_entry_get_text (GTK_ENTRY (priv->entry));
         id = search_combo_get_active_id (search);
-        link = dh_keyword_model_filter (priv->model, str, id);
+        link = dh_keyword_model_filter (priv->model, str, id,
+                                        GTK_TREE_VIEW (priv->hitlist));
         g_free (id);
 
         priv->idle_filter = 0;
@@ -589,6 +591,25 @@ book_manager_disabled_book_list_changed_cb (DhBookManager *book_manager,
         search_combo_populate (search);
 }
 
+static void
+book_manager_books_loaded_cb (DhBookManager *book_manager,
+                              gpointer       user_data)
+{
+        DhSearch     *search = user_data;
+        DhSearchPriv *priv = GET_PRIVATE (search);
+
+        g_completion_clear_items (priv->completion);
+        completion_add_items (search);
+        search_combo_populate (search);
+
+        /* The hits were links of the previous books, or the search was
+         * made before the books were there: search again now */
+        if (priv->idle_filter) {
+                g_source_remove (priv->idle_filter);
+        }
+        search_filter_idle (search);
+}
+
 GtkWidget *
 dh_search_new (DhBookManager *book_manager)
 {
@@ -609,6 +630,10 @@ dh_search_new (DhBookManager *book_manager)
                           "disabled-book-list-updated",
                           G_CALLBACK (book_manager_disabled_book_list_changed_cb),
                           search);
+        g_signal_connect (priv->book_manager,
+                          "books-loaded",
+                          G_CALLBACK (book_manager_books_loaded_cb),
+                          search);
 
         gtk_container_set_border_width (GTK_CONTAINER (search), 2);
 
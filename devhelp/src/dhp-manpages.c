@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 #include <glib.h>
 
 #ifdef HAVE_CONFIG_H
@@ -32,83 +33,245 @@
 	"</html>\n"
 
 
-/* Locates the path to the manpage found for the term and section. */
-static gchar *devhelp_plugin_find_manpage_path(DevhelpPlugin *self, const gchar *term, const gchar *section)
+#define DEVHELP_PLUGIN_MANPAGE_CACHE_SIZE 32
+
+
+/* A rendered manual page, kept in a temporary HTML file. */
+typedef struct
 {
-	gint retcode=0;
-	gchar *cmd, *path=NULL;
-	const gchar *man_path;
+	gchar *path;	/* the manual page file */
+	gchar *tmp_fn;	/* the HTML file */
+	gchar *uri;
+}
+ManPage;
 
-	g_return_val_if_fail(self != NULL, NULL);
-	g_return_val_if_fail(term != NULL, NULL);
 
-	if ((man_path = devhelp_plugin_get_man_prog_path(self)) == NULL)
-		man_path = "man";
+/* A man command running in the background. */
+typedef struct _ManLookup ManLookup;
+typedef void (*ManLookupFunc) (ManLookup *lookup, const gchar *output);
 
-	if (section == NULL)
+struct _ManLookup
+{
+	DevhelpPlugin *self;
+	gchar *term;
+	gchar *section;
+	GString *output;
+	guint source;
+	ManLookupFunc done;
+};
+
+
+/* "section\nterm" -> manual page path, or "" if there is none */
+static GHashTable *man_paths = NULL;
+/* of ManPage, the most recently used first */
+static GQueue *man_pages = NULL;
+/* only the latest lookup is shown, the previous one is cancelled */
+static ManLookup *man_lookup = NULL;
+
+
+static gchar *man_path_key(const gchar *term, const gchar *section)
+{
+	return g_strconcat(section ? section : "", "\n", term, NULL);
+}
+
+
+static void man_page_free(ManPage *page)
+{
+	if (remove(page->tmp_fn) == -1)
+		g_warning("Unable to delete temp file: %s", strerror(errno));
+	g_free(page->path);
+	g_free(page->tmp_fn);
+	g_free(page->uri);
+	g_free(page);
+}
+
+
+/* Returns the URI of the rendered page or NULL if it isn't cached. */
+static const gchar *man_page_lookup(const gchar *path)
+{
+	GList *link;
+
+	if (man_pages == NULL)
+		return NULL;
+
+	for (link = man_pages->head; link != NULL; link = link->next)
 	{
-		cmd = g_strdup_printf("%s -S %s --where '%s'", man_path,
-				DEVHELP_PLUGIN_MANPAGE_SECTIONS, term);
+		ManPage *page = link->data;
+
+		if (strcmp(page->path, path) == 0)
+		{
+			g_queue_unlink(man_pages, link);
+			g_queue_push_head_link(man_pages, link);
+			return page->uri;
+		}
 	}
-	else
-		cmd = g_strdup_printf("%s --where %s '%s'", man_path, section, term);
 
-	if (!g_spawn_command_line_sync(cmd, &path, NULL, &retcode, NULL))
+	return NULL;
+}
+
+
+/* Writes the text of a man page into a <pre> section in a temporary HTML
+ * file, which is cached, and returns its URI or NULL on error. */
+static const gchar *man_page_insert(const gchar *term, const gchar *path, const gchar *text)
+{
+	FILE *fp = NULL;
+	gint fd;
+	gsize len;
+	gchar *tmp_fn = NULL, *html_text;
+	const gchar *tmpl = "devhelp_manpage_XXXXXX.html";
+	ManPage *page;
+
+	if ((fd = g_file_open_tmp(tmpl, &tmp_fn, NULL)) == -1)
+		return NULL;
+
+	if ((fp = fdopen(fd, "w")) == NULL)
 	{
-		g_free(cmd);
+		close(fd);
+		remove(tmp_fn);
+		g_free(tmp_fn);
 		return NULL;
 	}
 
-	g_free(cmd);
+	html_text = g_strdup_printf(DEVHELP_PLUGIN_MANPAGE_HTML_TEMPLATE, term, text);
+	len = strlen(html_text);
 
-	if (retcode != 0)
+	if (fwrite(html_text, sizeof(gchar), len, fp) != len)
 	{
-		g_free(path);
+		fclose(fp);
+		remove(tmp_fn);
+		g_free(tmp_fn);
+		g_free(html_text);
 		return NULL;
 	}
 
-	return g_strstrip(path);
+	fclose(fp);
+	g_free(html_text);
+
+	if (man_pages == NULL)
+		man_pages = g_queue_new();
+
+	if (g_queue_get_length(man_pages) >= DEVHELP_PLUGIN_MANPAGE_CACHE_SIZE)
+		man_page_free(g_queue_pop_tail(man_pages));
+
+	page = g_new0(ManPage, 1);
+	page->path = g_strdup(path);
+	page->tmp_fn = tmp_fn;
+	page->uri = g_filename_to_uri(tmp_fn, NULL, NULL);
+	g_queue_push_head(man_pages, page);
+
+	return page->uri;
 }
 
 
-/* Read the text output from man or NULL. */
-static gchar *devhelp_plugin_read_man_text(DevhelpPlugin *self, const gchar *filename)
+/* Returns the command locating the manpage found for the term and section. */
+static gchar *devhelp_plugin_find_manpage_cmd(DevhelpPlugin *self, const gchar *term, const gchar *section)
 {
-	gint retcode=0;
-	gchar *cmd, *text=NULL;
 	const gchar *man_path;
 
-	g_return_val_if_fail(self != NULL, NULL);
-	g_return_val_if_fail(filename != NULL, NULL);
+	if ((man_path = devhelp_plugin_get_man_prog_path(self)) == NULL)
+		man_path = "man";
+
+	if (section == NULL)
+	{
+		return g_strdup_printf("%s -S %s --where '%s'", man_path,
+				DEVHELP_PLUGIN_MANPAGE_SECTIONS, term);
+	}
+	else
+		return g_strdup_printf("%s --where %s '%s'", man_path, section, term);
+}
+
+
+/* Returns the command printing the text of the manpage. */
+static gchar *devhelp_plugin_read_man_cmd(DevhelpPlugin *self, const gchar *filename)
+{
+	const gchar *man_path;
 
 	if ((man_path = devhelp_plugin_get_man_prog_path(self)) == NULL)
 		man_path = "man";
 
-	cmd = g_strdup_printf("%s -P\"%s\" \'%s\'", man_path,
+	return g_strdup_printf("%s -P\"%s\" \'%s\'", man_path,
 			DEVHELP_PLUGIN_MANPAGE_PAGER, filename);
+}
 
-	if (!g_spawn_command_line_sync(cmd, &text, NULL, &retcode, NULL))
-	{
-		g_free(cmd);
-		return NULL;
-	}
 
-	g_free(cmd);
+/* Runs the command and returns its output or NULL if it failed. */
+static gchar *devhelp_plugin_run_man_cmd(gchar *cmd)
+{
+	gint retcode=0;
+	gchar *text=NULL;
 
-	if (retcode != 0)
+	if (!g_spawn_command_line_sync(cmd, &text, NULL, &retcode, NULL))
+		text = NULL;
+	else if (retcode != 0)
 	{
 		g_free(text);
-		return NULL;
+		text = NULL;
 	}
 
+	g_free(cmd);
 	return text;
 }
 
 
+/* Locates the path to the manpage found for the term and section. */
+static gchar *devhelp_plugin_find_manpage_path(DevhelpPlugin *self, const gchar *term, const gchar *section)
+{
+	gchar *path;
+
+	g_return_val_if_fail(self != NULL, NULL);
+	g_return_val_if_fail(term != NULL, NULL);
+
+	path = devhelp_plugin_run_man_cmd(devhelp_plugin_find_manpage_cmd(self, term, section));
+
+	return path ? g_strstrip(path) : NULL;
+}
+
+
+/* Read the text output from man or NULL. */
+static gchar *devhelp_plugin_read_man_text(DevhelpPlugin *self, const gchar *filename)
+{
+	g_return_val_if_fail(self != NULL, NULL);
+	g_return_val_if_fail(filename != NULL, NULL);
+
+	return devhelp_plugin_run_man_cmd(devhelp_plugin_read_man_cmd(self, filename));
+}
+
+
+/* Looks up the path in the cache, returns TRUE if it is known, setting
+ * path to NULL if there is no manpage. */
+static gboolean man_path_lookup(const gchar *term, const gchar *section, const gchar **path)
+{
+	gchar *key;
+	gboolean found;
+
+	if (man_paths == NULL)
+		return FALSE;
+
+	key = man_path_key(term, section);
+	found = g_hash_table_lookup_extended(man_paths, key, NULL, (gpointer *) path);
+	g_free(key);
+
+	if (found && **path == '\0')
+		*path = NULL;
+
+	return found;
+}
+
+
+static void man_path_insert(const gchar *term, const gchar *section, const gchar *path)
+{
+	if (man_paths == NULL)
+		man_paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	g_hash_table_insert(man_paths, man_path_key(term, section), g_strdup(path ? path : ""));
+}
+
+
 /**
  * Searches for a manual page, and if it finds one, writes its text into a
  * <pre> section in an HTML file, and returns the URI of the HTML file which
- * can be loaded into the webview.
+ * can be loaded into the webview.  Both the location of the manual pages
+ * and the HTML files are cached.
  *
  * @param self Devhelp plugin.
  * @param term The search term to look for.
@@ -119,56 +282,185 @@ static gchar *devhelp_plugin_read_man_text(DevhelpPlugin *self, const gchar *fil
  */
 gchar *devhelp_plugin_manpages_search(DevhelpPlugin *self, const gchar *term, const gchar *section)
 {
-	FILE *fp = NULL;
-	gint fd = -1;
-	gsize len;
-	gchar *man_fn = NULL, *tmp_fn = NULL, *uri = NULL;
-	gchar *text = NULL, *html_text = NULL;
-	const gchar *tmpl = "devhelp_manpage_XXXXXX.html";
+	const gchar *man_fn, *uri;
+	gchar *path = NULL, *text;
 
 	g_return_val_if_fail(self != NULL, NULL);
 	g_return_val_if_fail(term != NULL, NULL);
 
-	if ((man_fn = devhelp_plugin_find_manpage_path(self, term, section)) == NULL)
-		goto error;
+	if (!man_path_lookup(term, section, &man_fn))
+	{
+		path = devhelp_plugin_find_manpage_path(self, term, section);
+		man_path_insert(term, section, path);
+		man_fn = path;
+	}
 
-	if ((fd = g_file_open_tmp(tmpl, &tmp_fn, NULL)) == -1)
-		goto error;
+	if (man_fn == NULL)
+		return NULL;
 
-	if ((fp = fdopen(fd, "w")) == NULL)
-		goto error;
+	if ((uri = man_page_lookup(man_fn)) == NULL &&
+		(text = devhelp_plugin_read_man_text(self, man_fn)) != NULL)
+	{
+		uri = man_page_insert(term, man_fn, text);
+		g_free(text);
+	}
 
-	if ((text = devhelp_plugin_read_man_text(self, man_fn)) == NULL)
-		goto error;
+	g_free(path);
+	return g_strdup(uri);
+}
 
-	html_text = g_strdup_printf(DEVHELP_PLUGIN_MANPAGE_HTML_TEMPLATE, term, text);
 
-	len = strlen(html_text);
-	if (fwrite(html_text, sizeof(gchar), len, fp) != len)
-		goto error;
+static void man_lookup_free(ManLookup *lookup)
+{
+	if (lookup->source != 0)
+		g_source_remove(lookup->source);
+	g_string_free(lookup->output, TRUE);
+	g_free(lookup->term);
+	g_free(lookup->section);
+	g_free(lookup);
+}
 
-	devhelp_plugin_add_temp_file(self, tmp_fn);
 
-	uri = g_filename_to_uri(tmp_fn, NULL, NULL);
+static gboolean on_man_lookup_output(GIOChannel *channel, GIOCondition cond, ManLookup *lookup)
+{
+	gchar buf[4096];
+	gsize n = 0;
+	GIOStatus status = G_IO_STATUS_EOF;
 
-	g_free(man_fn);
-	g_free(tmp_fn);
-	g_free(text);
-	g_free(html_text);
+	if (cond & G_IO_IN)
+	{
+		status = g_io_channel_read_chars(channel, buf, sizeof(buf), &n, NULL);
+		g_string_append_len(lookup->output, buf, n);
+	}
 
-	fclose(fp);
+	if (status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN)
+		return TRUE;
 
-	return uri;
+	/* end of the output, the channel is closed with the source */
+	lookup->source = 0;
+	lookup->done(lookup, lookup->output->str);
+	return FALSE;
+}
 
-error:
-	g_free(man_fn);
-	g_free(tmp_fn);
-	g_free(text);
-	g_free(html_text);
-	g_free(uri);
-	if (fp != NULL)
-		fclose(fp);
-	return NULL;
+
+/* Runs the command in the background, calling done with its output. */
+static gboolean man_lookup_run(ManLookup *lookup, gchar *cmd, ManLookupFunc done)
+{
+	gchar **argv;
+	gint fd_out;
+	GIOChannel *channel;
+	gboolean ok;
+
+	ok = g_shell_parse_argv(cmd, NULL, &argv, NULL);
+	g_free(cmd);
+	if (!ok)
+		return FALSE;
+
+	ok = g_spawn_async_with_pipes(NULL, argv, NULL, G_SPAWN_SEARCH_PATH |
+		G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL, NULL, NULL, &fd_out, NULL, NULL);
+	g_strfreev(argv);
+	if (!ok)
+		return FALSE;
+
+	g_string_truncate(lookup->output, 0);
+	lookup->done = done;
+
+	channel = g_io_channel_unix_new(fd_out);
+	g_io_channel_set_encoding(channel, NULL, NULL);
+	g_io_channel_set_buffered(channel, FALSE);
+	g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, NULL);
+	g_io_channel_set_close_on_unref(channel, TRUE);
+	lookup->source = g_io_add_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+		(GIOFunc) on_man_lookup_output, lookup);
+	g_io_channel_unref(channel);
+
+	return TRUE;
+}
+
+
+static void man_lookup_finish(void)
+{
+	man_lookup_free(man_lookup);
+	man_lookup = NULL;
+}
+
+
+static void man_lookup_show(DevhelpPlugin *self, const gchar *uri)
+{
+	devhelp_plugin_set_webview_uri(self, uri);
+	devhelp_plugin_activate_webview_tab(self);
+}
+
+
+/* man doesn't exit with an error when the page couldn't be formatted, the
+ * output is just empty then */
+static void on_man_text_read(ManLookup *lookup, const gchar *output)
+{
+	const gchar *man_fn, *uri = NULL;
+
+	if (*output != '\0' && man_path_lookup(lookup->term, lookup->section, &man_fn) && man_fn)
+		uri = man_page_insert(lookup->term, man_fn, output);
+
+	if (uri != NULL)
+		man_lookup_show(lookup->self, uri);
+
+	man_lookup_finish();
+}
+
+
+static void man_lookup_page(const gchar *man_fn)
+{
+	const gchar *uri;
+
+	if ((uri = man_page_lookup(man_fn)) != NULL)
+	{
+		man_lookup_show(man_lookup->self, uri);
+		man_lookup_finish();
+	}
+	else if (!man_lookup_run(man_lookup, devhelp_plugin_read_man_cmd(man_lookup->self,
+		man_fn), on_man_text_read))
+	{
+		man_lookup_finish();
+	}
+}
+
+
+static void on_man_path_found(ManLookup *lookup, const gchar *output)
+{
+	gchar *path = g_strstrip(g_strdup(output));
+
+	man_path_insert(lookup->term, lookup->section, *path ? path : NULL);
+
+	if (*path)
+		man_lookup_page(path);
+	else
+		man_lookup_finish();
+
+	g_free(path);
+}
+
+
+/**
+ * Cancels a manual page search running in the background, frees the cached
+ * pages and removes their temporary files.
+ */
+static void devhelp_plugin_manpages_clear_cache(void)
+{
+	if (man_lookup != NULL)
+		man_lookup_finish();
+
+	if (man_pages != NULL)
+	{
+		g_queue_foreach(man_pages, (GFunc) man_page_free, NULL);
+		g_queue_free(man_pages);
+		man_pages = NULL;
+	}
+
+	if (man_paths != NULL)
+	{
+		g_hash_table_destroy(man_paths);
+		man_paths = NULL;
+	}
 }
 
 
@@ -184,6 +476,8 @@ void devhelp_plugin_remove_manpages_temp_files(DevhelpPlugin *self)
 
 	g_return_if_fail(self != NULL);
 
+	devhelp_plugin_manpages_clear_cache();
+
 	temp_files = devhelp_plugin_get_temp_files(self);
 
 	if (temp_files == NULL)
@@ -218,23 +512,36 @@ void devhelp_plugin_add_temp_file(DevhelpPlugin *self, const gchar *filename)
 
 /**
  * Search for a term in Manual Pages and activate/show the plugin's UI stuff.
+ * The man commands run in the background, the page is shown once found.
  *
  * @param dhplug	Devhelp plugin
  * @param term		The string to search for
  */
 void devhelp_plugin_search_manpages(DevhelpPlugin *self, const gchar *term)
 {
-	gchar *man_fn;
+	const gchar *man_fn;
 
 	g_return_if_fail(self != NULL);
 	g_return_if_fail(term != NULL);
 
-	if ((man_fn = devhelp_plugin_manpages_search(self, term, NULL)) == NULL)
-		return;
-
-	devhelp_plugin_set_webview_uri(self, man_fn);
+	if (man_lookup != NULL)
+		man_lookup_finish();
 
-	g_free(man_fn);
+	man_lookup = g_new0(ManLookup, 1);
+	man_lookup->self = self;
+	man_lookup->term = g_strdup(term);
+	man_lookup->output = g_string_new(NULL);
 
-	devhelp_plugin_activate_webview_tab(self);
+	if (man_path_lookup(term, NULL, &man_fn))
+	{
+		if (man_fn != NULL)
+			man_lookup_page(man_fn);
+		else
+			man_lookup_finish();
+	}
+	else if (!man_lookup_run(man_lookup, devhelp_plugin_find_manpage_cmd(self, term, NULL),
+		on_man_path_found))
+	{
+		man_lookup_finish();
+	}
 }
@@ -114,6 +114,8 @@ enum
 
 /* Causes problems if it gets re-initialized so leave global for now */
 static DhBase *dhbase = NULL;
+/* Whether the books were asked for, they are only loaded once needed */
+static gboolean books_requested = FALSE;
 
 
 /* Internal callbacks */
@@ -338,6 +340,26 @@ static void devhelp_plugin_class_init(DevhelpPluginClass * klass)
 }
 
 
+/* Starts reading the books in a thread the first time they are needed, that is
+ * when the sidebar tab is first shown or something is looked up. Most of them
+ * come from the book cache. */
+static void devhelp_plugin_load_books(void)
+{
+#ifdef HAVE_BOOK_MANAGER
+	if (books_requested)
+		return;
+	books_requested = TRUE;
+	dh_book_manager_populate_async(dh_base_get_book_manager(dhbase));
+#endif
+}
+
+
+static void on_sidebar_map(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED gpointer user_data)
+{
+	devhelp_plugin_load_books();
+}
+
+
 /*
  * Initialize the Devhelp library/widgets.
  * The Devhelp API isn't exactly stable, so handle quirks in here.
@@ -352,7 +374,15 @@ static void devhelp_plugin_init_dh(DevhelpPlugin *self)
 #endif
 
 	if (dhbase == NULL)
+	{
+#ifdef HAVE_BOOK_MANAGER
+		/* the book tree and search fill in when the books are loaded,
+		 * see devhelp_plugin_load_books() */
+		dhbase = dh_base_new_deferred();
+#else
 		dhbase = dh_base_new();
+#endif
+	}
 	self->priv->dhbase = dhbase;
 
 #ifdef HAVE_BOOK_MANAGER /* for newer api */
@@ -499,6 +529,7 @@ static void devhelp_plugin_init_sidebar(DevhelpPlugin *self)
 
 	gtk_notebook_set_current_page(GTK_NOTEBOOK(p->sb_notebook), 0);
 	gtk_widget_show_all(p->sb_notebook);
+	g_signal_connect(p->sb_notebook, "map", G_CALLBACK(on_sidebar_map), NULL);
 
 	label = gtk_label_new(_("Devhelp"));
 	gtk_notebook_append_page(GTK_NOTEBOOK(geany->main_widgets->sidebar_notebook), p->sb_notebook, label);
@@ -636,6 +667,7 @@ void devhelp_plugin_search_books(DevhelpPlugin *self, const gchar *term)
 	g_return_if_fail(self != NULL);
 	g_return_if_fail(term != NULL);
 
+	devhelp_plugin_load_books();
 	dh_search_set_search_string(DH_SEARCH(self->priv->search), term, NULL);
 
 	devhelp_plugin_activate_all_tabs(self);
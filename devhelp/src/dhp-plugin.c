@@ -34,6 +34,7 @@
 
 #include "dhp-plugin.h"
 #include "dhp.h"
+#include "startprof.h"
 
 
 PLUGIN_VERSION_CHECK(200)
@@ -150,7 +151,7 @@ gboolean plugin_config_init(struct PluginData *pd)
 }
 
 
-void plugin_init(GeanyData *data)
+static void init(GeanyData *data)
 {
 	GeanyKeyGroup *key_group;
 
@@ -186,6 +187,9 @@ void plugin_init(GeanyData *data)
 }
 
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init)
+
+
 void plugin_cleanup(void)
 {
 	devhelp_plugin_store_settings(plugin.devhelp, plugin.user_config);
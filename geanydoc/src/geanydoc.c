@@ -171,13 +171,223 @@ show_output(const gchar * std_output, const gchar * name, const gchar * force_en
 	}
 }
 
+/* Outputs of the last lookups, the most recently used first: looking up
+ * the same symbols again doesn't run the commands again. */
+#define CACHE_SIZE 32
+
+typedef struct
+{
+	gchar *key;
+	gchar *output;
+} CacheEntry;
+
+static GQueue *cache_queue = NULL;	/* of CacheEntry */
+static GHashTable *cache_table = NULL;	/* key -> link in cache_queue */
+
+static gchar *
+cache_key(const gchar * ftype, const gchar * command, const gchar * word)
+{
+	return g_strconcat(ftype, "\n", command, "\n", word, NULL);
+}
+
+static void
+cache_entry_free(CacheEntry * entry)
+{
+	g_free(entry->key);
+	g_free(entry->output);
+	g_free(entry);
+}
+
+static const gchar *
+cache_lookup(const gchar * key)
+{
+	GList *link;
+
+	if (cache_table == NULL)
+		return NULL;
+	link = g_hash_table_lookup(cache_table, key);
+	if (link == NULL)
+		return NULL;
+
+	g_queue_unlink(cache_queue, link);
+	g_queue_push_head_link(cache_queue, link);
+	return ((CacheEntry *) link->data)->output;
+}
+
+static void
+cache_insert(const gchar * key, const gchar * output)
+{
+	CacheEntry *entry;
+	GList *link;
+
+	if (cache_table == NULL)
+	{
+		cache_queue = g_queue_new();
+		cache_table = g_hash_table_new(g_str_hash, g_str_equal);
+	}
+
+	link = g_hash_table_lookup(cache_table, key);
+	if (link != NULL)
+	{
+		entry = link->data;
+		setptr(entry->output, g_strdup(output));
+		g_queue_unlink(cache_queue, link);
+		g_queue_push_head_link(cache_queue, link);
+		return;
+	}
+
+	if (g_queue_get_length(cache_queue) >= CACHE_SIZE)
+	{
+		entry = g_queue_pop_tail(cache_queue);
+		g_hash_table_remove(cache_table, entry->key);
+		cache_entry_free(entry);
+	}
+
+	entry = g_new(CacheEntry, 1);
+	entry->key = g_strdup(key);
+	entry->output = g_strdup(output);
+	g_queue_push_head(cache_queue, entry);
+	g_hash_table_insert(cache_table, entry->key, cache_queue->head);
+}
+
+static void
+cache_clear(void)
+{
+	CacheEntry *entry;
+
+	if (cache_table == NULL)
+		return;
+	while ((entry = g_queue_pop_head(cache_queue)) != NULL)
+		cache_entry_free(entry);
+	g_queue_free(cache_queue);
+	g_hash_table_destroy(cache_table);
+	cache_queue = NULL;
+	cache_table = NULL;
+}
+
+/* A command running in the background, its output being read as it comes. */
+typedef struct
+{
+	gchar *word;
+	gint cmd_num;
+	gint filetype_id;
+	gchar *key;
+	GString *output;
+	guint source;
+	gboolean cancelled;
+} Lookup;
+
+/* Only the result of the last lookup is shown, the others still running
+ * are cancelled. */
+static Lookup *current_lookup = NULL;
+static GSList *lookups = NULL;
+
+static void
+lookup_free(Lookup * lookup)
+{
+	if (current_lookup == lookup)
+		current_lookup = NULL;
+	lookups = g_slist_remove(lookups, lookup);
+	g_free(lookup->word);
+	g_free(lookup->key);
+	g_string_free(lookup->output, TRUE);
+	g_free(lookup);
+}
+
+static void show_doc(const gchar * word, gint cmd_num);
+
+static void
+show_result(const gchar * output, const gchar * word, gint cmd_num, gint filetype_id)
+{
+	if (! EMPTY(output))
+	{
+		show_output(output, "*DOC*", NULL, filetype_id);
+	}
+	else
+	{
+		show_doc(word, cmd_num + 1);
+	}
+}
+
+static gboolean
+on_lookup_output(GIOChannel * channel, G_GNUC_UNUSED GIOCondition condition, gpointer data)
+{
+	Lookup *lookup = data;
+	gchar buf[4096];
+	gsize n = 0;
+	GIOStatus status;
+
+	status = g_io_channel_read_chars(channel, buf, sizeof(buf), &n, NULL);
+	g_string_append_len(lookup->output, buf, n);
+	if (status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN)
+		return TRUE;
+
+	/* the command is done: removing the watch closes the pipe */
+	if (!lookup->cancelled)
+	{
+		current_lookup = NULL;
+		cache_insert(lookup->key, lookup->output->str);
+		ui_set_statusbar(FALSE, "%s", "");
+		show_result(lookup->output->str, lookup->word, lookup->cmd_num,
+			    lookup->filetype_id);
+	}
+	lookup_free(lookup);
+	return FALSE;
+}
+
+static gboolean
+start_lookup(const gchar * command, const gchar * word, gint cmd_num, gint filetype_id,
+	     gchar * key)
+{
+	Lookup *lookup;
+	gchar **argv;
+	gint fd_out;
+	GIOChannel *channel;
+
+	if (!g_shell_parse_argv(command, NULL, &argv, NULL))
+		return FALSE;
+	if (!g_spawn_async_with_pipes(NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL,
+				      NULL, NULL, &fd_out, NULL, NULL))
+	{
+		g_strfreev(argv);
+		return FALSE;
+	}
+	g_strfreev(argv);
+
+	if (current_lookup != NULL)
+		current_lookup->cancelled = TRUE;
+
+	lookup = g_new0(Lookup, 1);
+	lookup->word = g_strdup(word);
+	lookup->cmd_num = cmd_num;
+	lookup->filetype_id = filetype_id;
+	lookup->key = key;
+	lookup->output = g_string_new("");
+
+	channel = g_io_channel_unix_new(fd_out);
+	g_io_channel_set_encoding(channel, NULL, NULL);
+	g_io_channel_set_buffered(channel, FALSE);
+	g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, NULL);
+	g_io_channel_set_close_on_unref(channel, TRUE);
+	lookup->source = g_io_add_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+					on_lookup_output, lookup);
+	g_io_channel_unref(channel);
+
+	lookups = g_slist_prepend(lookups, lookup);
+	current_lookup = lookup;
+	ui_set_statusbar(FALSE, _("Looking up the documentation of %s..."), word);
+	return TRUE;
+}
+
 static void
 show_doc(const gchar * word, gint cmd_num)
 {
 	GeanyDocument *doc;
 	const gchar *ftype;
+	const gchar *output;
 	gchar *command;
 	gchar *tmp;
+	gchar *key;
 	gboolean intern;
 
 	doc = document_get_current();
@@ -200,16 +410,20 @@ show_doc(const gchar * word, gint cmd_num)
 
 	if (intern)
 	{
-		g_spawn_command_line_sync(command, &tmp, NULL, NULL, NULL);
-		if (! EMPTY(tmp))
+		key = cache_key(ftype, command, word);
+		output = cache_lookup(key);
+		if (output != NULL)
 		{
-			show_output(tmp, "*DOC*", NULL, doc->file_type->id);
+			if (current_lookup != NULL)
+				current_lookup->cancelled = TRUE;
+			g_free(key);
+			show_result(output, word, cmd_num, doc->file_type->id);
 		}
-		else
+		else if (!start_lookup(command, word, cmd_num, doc->file_type->id, key))
 		{
+			g_free(key);
 			show_doc(word, cmd_num + 1);
 		}
-		g_free(tmp);
 	}
 	else
 	{
@@ -507,6 +721,13 @@ plugin_configure_single(G_GNUC_UNUSED GtkWidget * parent)
 void
 plugin_cleanup(void)
 {
+	while (lookups != NULL)
+	{
+		Lookup *lookup = lookups->data;
+		g_source_remove(lookup->source);
+		lookup_free(lookup);
+	}
+	cache_clear();
 	config_uninit();
 	keyb1 = NULL;
 	keyb2 = NULL;
@@ -82,6 +82,26 @@ static ScintillaObject *scintilla_get_current(void)
 #define sci_set_anchor_space(sci, space) sci_set_virtual_space(sci, ANCHOR, space)
 #define sci_get_cursor_space(sci) sci_virtual_space(sci, SCI_GET, CARET, 0)
 #define sci_set_cursor_space(sci, space) sci_set_virtual_space(sci, CARET, space)
+#define sci_get_rect_anchor(sci) SSM(sci, SCI_GETRECTANGULARSELECTIONANCHOR, 0, 0)
+#define sci_get_rect_anchor_space(sci) \
+	SSM(sci, SCI_GETRECTANGULARSELECTIONANCHORVIRTUALSPACE, 0, 0)
+#define sci_get_rect_cursor(sci) SSM(sci, SCI_GETRECTANGULARSELECTIONCARET, 0, 0)
+
+/* Each change of a rectangle selection makes Scintilla recompute the selected
+   range of all its lines, which is slow for tall rectangles, so these are
+   done only when needed. Scintilla usually takes the rectangle over from the
+   stream selection when switching to rectangle mode, but older versions don't */
+
+static void set_rect_anchor(ScintillaObject *sci, int anchor, int anchor_space)
+{
+	if (sci_get_rect_anchor(sci) != anchor)
+	{
+		sci_set_anchor(sci, anchor);
+		sci_set_anchor_space(sci, anchor_space);
+	}
+	else if (sci_get_rect_anchor_space(sci) != anchor_space)
+		SSM(sci, SCI_SETRECTANGULARSELECTIONANCHORVIRTUALSPACE, anchor_space, 0);
+}
 
 static void create_selection(ScintillaObject *sci, int anchor, int anchor_space,
 	gboolean rectangle)
@@ -92,18 +112,25 @@ static void create_selection(ScintillaObject *sci, int anchor, int anchor_space,
 	if (rectangle)
 	{
 		sci_set_selection_mode(sci, SC_SEL_RECTANGLE);
-		sci_set_anchor(sci, anchor);
-		/* sci_set_current_position() sets anchor = cursor, bypass */
-		scintilla_send_message(sci, SCI_SETCURRENTPOS, cursor, 0);
+		set_rect_anchor(sci, anchor, anchor_space);
+		/* the lines must be selected once anyway, setting the caret does it */
+		if (sci_get_rect_cursor(sci) == cursor)
+			SSM(sci, SCI_SETRECTANGULARSELECTIONCARETVIRTUALSPACE, cursor_space, 0);
+		else
+		{
+			/* sci_set_current_position() sets anchor = cursor, bypass */
+			scintilla_send_message(sci, SCI_SETCURRENTPOS, cursor, 0);
+			sci_set_cursor_space(sci, cursor_space);
+		}
 	}
 	else
 	{
 		sci_set_selection_mode(sci, SC_SEL_STREAM);
 		scintilla_send_message(sci, SCI_SETSEL, anchor, cursor);
+		sci_set_anchor_space(sci, anchor_space);
+		sci_set_cursor_space(sci, cursor_space);
 	}
 
-	sci_set_anchor_space(sci, anchor_space);
-	sci_set_cursor_space(sci, cursor_space);
 	sci_send_command(sci, SCI_CANCEL);
 }
 
@@ -149,10 +176,7 @@ static void column_mode_command(ScintillaObject *sci, int command)
 	sci_set_selection_mode(sci, SC_SEL_RECTANGLE);
 	sci_send_command(sci, command);
 	if (convert)
-	{
-		sci_set_anchor(sci, anchor);
-		sci_set_anchor_space(sci, anchor_space);
-	}
+		set_rect_anchor(sci, anchor, anchor_space);
 	sci_send_command(sci, SCI_CANCEL);
 }
 
@@ -25,8 +25,12 @@
 
 #include "ggd-file-type-manager.h"
 
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <glib.h>
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
 #include <geanyplugin.h>
 
 #include "ggd-plugin.h" /* to be able to use Geany data */
@@ -50,16 +54,103 @@
  * 
  * To get a file type from the file type manager, simply use
  * ggd_file_type_manager_get_file_type(). If the requested file type must be
- * loaded first, it will be done transparently.
+ * loaded first, it will be done transparently. A file type loaded from a
+ * configuration file is loaded again if that file changed since.
+ * 
+ * ggd_file_type_manager_preload() loads file types in the background, so that
+ * their first use doesn't have to wait for their configuration to be parsed.
  */
 
 
+/* Where a loaded #GgdFileType comes from */
+typedef struct _GgdFileTypeSource GgdFileTypeSource;
+
+struct _GgdFileTypeSource
+{
+  gchar  *filename;
+  time_t  mtime;
+};
+
 /* Hash table holding the loaded #GgdFileType<!-- -->s */
 static GHashTable *GGD_ft_table = NULL;
+/* Hash table holding the #GgdFileTypeSource of the file types loaded from a
+ * file, with the same keys as GGD_ft_table */
+static GHashTable *GGD_ft_sources = NULL;
+
+/* A file type being loaded in the background */
+typedef struct _GgdFileTypePreload GgdFileTypePreload;
+
+struct _GgdFileTypePreload
+{
+  filetype_id   id;
+  gchar        *filename;
+  time_t        mtime;
+  GgdFileType  *ft;     /* set by the loading thread, NULL on failure */
+};
+
+/* The running preload: its thread, the #GgdFileTypePreload<!-- -->s it loads,
+ * and the idle source it adds to hand them back once done */
+static GThread *GGD_preload_thread = NULL;
+static GSList  *GGD_preload_list = NULL;
+static guint    GGD_preload_idle = 0;
 
 /* checks whether the file type manager is initialized */
 #define ggd_file_type_manager_is_initialized() (GGD_ft_table != NULL)
 
+static void
+ggd_file_type_source_free (gpointer data)
+{
+  GgdFileTypeSource *source = data;
+  
+  g_free (source->filename);
+  g_slice_free1 (sizeof *source, source);
+}
+
+/* gets the modification time of @filename, or 0 if it cannot be read */
+static time_t
+get_file_mtime (const gchar *filename)
+{
+  struct stat st;
+  
+  if (g_stat (filename, &st) != 0) {
+    return 0;
+  }
+  
+  return st.st_mtime;
+}
+
+static void
+ggd_file_type_preload_free (gpointer data)
+{
+  GgdFileTypePreload *preload = data;
+  
+  g_free (preload->filename);
+  if (preload->ft) {
+    ggd_file_type_unref (preload->ft);
+  }
+  g_slice_free1 (sizeof *preload, preload);
+}
+
+/* waits for the running preload, if any, and drops what it loaded */
+static void
+ggd_file_type_manager_stop_preload (void)
+{
+  if (! GGD_preload_thread) {
+    return;
+  }
+  
+  g_thread_join (GGD_preload_thread);
+  GGD_preload_thread = NULL;
+  /* only set by the thread, which is done now */
+  if (GGD_preload_idle != 0) {
+    g_source_remove (GGD_preload_idle);
+    GGD_preload_idle = 0;
+  }
+  g_slist_foreach (GGD_preload_list, (GFunc) ggd_file_type_preload_free, NULL);
+  g_slist_free (GGD_preload_list);
+  GGD_preload_list = NULL;
+}
+
 /**
  * ggd_file_type_manager_init:
  * 
@@ -74,6 +165,8 @@ ggd_file_type_manager_init (void)
   GGD_ft_table = g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                         NULL,
                                         (GDestroyNotify)ggd_file_type_unref);
+  GGD_ft_sources = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                          NULL, ggd_file_type_source_free);
 }
 
 /**
@@ -88,6 +181,9 @@ ggd_file_type_manager_uninit (void)
 {
   g_return_if_fail (ggd_file_type_manager_is_initialized ());
   
+  ggd_file_type_manager_stop_preload ();
+  g_hash_table_destroy (GGD_ft_sources);
+  GGD_ft_sources = NULL;
   g_hash_table_destroy (GGD_ft_table);
   GGD_ft_table = NULL;
 }
@@ -104,6 +200,7 @@ ggd_file_type_manager_add_file_type (GgdFileType *filetype)
   g_return_if_fail (ggd_file_type_manager_is_initialized ());
   g_return_if_fail (filetype != NULL);
   
+  g_hash_table_remove (GGD_ft_sources, GINT_TO_POINTER (filetype->geany_ft));
   g_hash_table_insert (GGD_ft_table,
                        GINT_TO_POINTER (filetype->geany_ft),
                        ggd_file_type_ref (filetype));
@@ -183,6 +280,10 @@ ggd_file_type_manager_load_file_type (filetype_id id)
                        geany_ft->name, err->message);
     g_error_free (err);
   } else {
+    time_t mtime;
+    
+    /* get the time before loading not to miss a change made meanwhile */
+    mtime = get_file_mtime (filename);
     ft = ggd_file_type_new (id);
     if (! ggd_file_type_load (ft, filename, &err)) {
       gchar *display_filename;
@@ -195,8 +296,14 @@ ggd_file_type_manager_load_file_type (filetype_id id)
       g_error_free (err);
       ggd_file_type_unref (ft), ft = NULL;
     } else {
+      GgdFileTypeSource *source;
+      
       ggd_file_type_manager_add_file_type (ft);
       ggd_file_type_unref (ft);
+      source = g_slice_alloc (sizeof *source);
+      source->filename = filename, filename = NULL;
+      source->mtime = mtime;
+      g_hash_table_insert (GGD_ft_sources, GINT_TO_POINTER (id), source);
     }
     g_free (filename);
   }
@@ -204,12 +311,144 @@ ggd_file_type_manager_load_file_type (filetype_id id)
   return ft;
 }
 
+/* adds the file types loaded by the preload thread, unless loaded meanwhile */
+static gboolean
+ggd_file_type_manager_preload_done (gpointer data)
+{
+  GSList *node;
+  
+  /* the thread sets the source ID after adding it, wait for it to be done */
+  g_thread_join (GGD_preload_thread);
+  GGD_preload_thread = NULL;
+  GGD_preload_idle = 0;
+  
+  for (node = GGD_preload_list; node; node = node->next) {
+    GgdFileTypePreload *preload = node->data;
+    
+    if (preload->ft &&
+        ! g_hash_table_lookup (GGD_ft_table, GINT_TO_POINTER (preload->id))) {
+      GgdFileTypeSource *source;
+      
+      ggd_file_type_manager_add_file_type (preload->ft);
+      source = g_slice_alloc (sizeof *source);
+      source->filename = preload->filename, preload->filename = NULL;
+      source->mtime = preload->mtime;
+      g_hash_table_insert (GGD_ft_sources, GINT_TO_POINTER (preload->id),
+                           source);
+    }
+    ggd_file_type_preload_free (preload);
+  }
+  g_slist_free (GGD_preload_list);
+  GGD_preload_list = NULL;
+  
+  return FALSE;
+}
+
+/* parses the configuration files of the preloaded file types. Failures are
+ * ignored, they will be reported when the file type is loaded for use. */
+static gpointer
+ggd_file_type_manager_preload_thread (gpointer data)
+{
+  GSList *node;
+  
+  for (node = GGD_preload_list; node; node = node->next) {
+    GgdFileTypePreload *preload = node->data;
+    
+    preload->ft = ggd_file_type_new (preload->id);
+    if (! ggd_file_type_load (preload->ft, preload->filename, NULL)) {
+      ggd_file_type_unref (preload->ft), preload->ft = NULL;
+    }
+  }
+  GGD_preload_idle = g_idle_add (ggd_file_type_manager_preload_done, NULL);
+  
+  return NULL;
+}
+
+/**
+ * ggd_file_type_manager_preload:
+ * @ids: The IDs of the #GeanyFiletype<!-- -->s to load
+ * @n_ids: The number of IDs in @ids
+ * 
+ * Loads file types in a separate thread, for them to be ready when first used.
+ * The ones already loaded, or that are requested before their loading is done,
+ * are left alone. Nothing is done if a previous preload is still running.
+ */
+void
+ggd_file_type_manager_preload (const filetype_id *ids,
+                               guint              n_ids)
+{
+  guint i;
+  
+  g_return_if_fail (ggd_file_type_manager_is_initialized ());
+  
+  if (GGD_preload_thread) {
+    return;
+  }
+  
+  for (i = 0; i < n_ids; i++) {
+    GgdFileTypePreload *preload;
+    gchar              *filename;
+    
+    if (ids[i] < 0 || ids[i] >= (filetype_id) geany->filetypes_array->len ||
+        g_hash_table_lookup (GGD_ft_table, GINT_TO_POINTER (ids[i]))) {
+      continue;
+    }
+    filename = ggd_file_type_manager_get_conf_path_intern (filetypes[ids[i]],
+                                                           GGD_PERM_R, NULL);
+    if (! filename) {
+      continue;
+    }
+    preload = g_slice_alloc0 (sizeof *preload);
+    preload->id = ids[i];
+    preload->filename = filename;
+    /* get the time before loading not to miss a change made meanwhile */
+    preload->mtime = get_file_mtime (filename);
+    GGD_preload_list = g_slist_prepend (GGD_preload_list, preload);
+  }
+  
+  if (GGD_preload_list) {
+    GGD_preload_thread = g_thread_create (ggd_file_type_manager_preload_thread,
+                                          NULL, TRUE, NULL);
+    if (! GGD_preload_thread) {
+      g_slist_foreach (GGD_preload_list, (GFunc) ggd_file_type_preload_free,
+                       NULL);
+      g_slist_free (GGD_preload_list);
+      GGD_preload_list = NULL;
+    }
+  }
+}
+
+/* checks whether the configuration file of a loaded file type changed, or
+ * another file would be used now */
+static gboolean
+ggd_file_type_manager_is_outdated (filetype_id id)
+{
+  GgdFileTypeSource  *source;
+  gchar              *filename;
+  gboolean            outdated;
+  
+  source = g_hash_table_lookup (GGD_ft_sources, GINT_TO_POINTER (id));
+  if (! source) {
+    /* added by ggd_file_type_manager_add_file_type() */
+    return FALSE;
+  }
+  filename = ggd_file_type_manager_get_conf_path_intern (filetypes[id],
+                                                         GGD_PERM_R, NULL);
+  outdated = (! filename ||
+              strcmp (filename, source->filename) != 0 ||
+              get_file_mtime (filename) != source->mtime);
+  g_free (filename);
+  
+  return outdated;
+}
+
 /**
  * ggd_file_type_manager_get_file_type:
  * @id: A #GeanyFiletype ID
  * 
  * Gets a #GgdFileType from the file type manager by its Geany's file type ID.
- * If the file type isn't already known, it will be transparently loaded.
+ * If the file type isn't already known, or if its configuration file changed
+ * since it was loaded, it will be transparently loaded.
  * 
  * Returns: A #GgdFileType that shouldn't be unref'd, or %NULL if the requested
  *          file type neither can be found on the loaded file type nor can be
@@ -223,6 +462,11 @@ ggd_file_type_manager_get_file_type (filetype_id id)
   g_return_val_if_fail (ggd_file_type_manager_is_initialized (), NULL);
   
   ft = g_hash_table_lookup (GGD_ft_table, GINT_TO_POINTER (id));
+  if (ft && ggd_file_type_manager_is_outdated (id)) {
+    g_hash_table_remove (GGD_ft_sources, GINT_TO_POINTER (id));
+    g_hash_table_remove (GGD_ft_table, GINT_TO_POINTER (id));
+    ft = NULL;
+  }
   if (! ft) {
     /* if the filetype isn't loaded, try to load it
      * FIXME: it might be useful to have a way to know if a filetype loading
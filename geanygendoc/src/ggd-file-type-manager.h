@@ -39,6 +39,8 @@ gchar            *ggd_file_type_manager_get_conf_path   (filetype_id  id,
                                                          GgdPerms     perms_req,
                                                          GError     **error);
 GgdFileType      *ggd_file_type_manager_load_file_type  (filetype_id id);
+void              ggd_file_type_manager_preload         (const filetype_id *ids,
+                                                         guint              n_ids);
 GgdFileType      *ggd_file_type_manager_get_file_type   (filetype_id ft);
 GgdDocType       *ggd_file_type_manager_get_doc_type    (filetype_id  ft,
                                                          const gchar *docname);
@@ -543,6 +543,33 @@ destroy_menus (PluginData *pdata)
   remove_edit_menu_item (pdata);
 }
 
+/* loads the file types of the open documents in the background, so that their
+ * first documentation doesn't wait for the configuration to be parsed */
+static void
+preload_file_types (void)
+{
+  GArray *ids;
+  guint   i;
+  
+  ids = g_array_new (FALSE, FALSE, sizeof (filetype_id));
+  foreach_document (i) {
+    GeanyFiletype *ft = documents[i]->file_type;
+    
+    if (ft && ft->id != GEANY_FILETYPES_NONE) {
+      g_array_append_val (ids, ft->id);
+    }
+  }
+  ggd_file_type_manager_preload ((const filetype_id *) ids->data, ids->len);
+  g_array_free (ids, TRUE);
+}
+
+static void
+startup_complete_handler (GObject  *obj,
+                          gpointer  data)
+{
+  preload_file_types ();
+}
+
 void
 plugin_init (GeanyData *data G_GNUC_UNUSED)
 {
@@ -552,6 +579,13 @@ plugin_init (GeanyData *data G_GNUC_UNUSED)
   build_menus (plugin);
   plugin_signal_connect (geany_plugin, NULL, "update-editor-menu", FALSE,
                          G_CALLBACK (update_editor_menu_handler), plugin);
+  /* documents are still being opened if Geany is starting */
+  if (main_is_realized ()) {
+    preload_file_types ();
+  } else {
+    plugin_signal_connect (geany_plugin, NULL, "geany-startup-complete", FALSE,
+                           G_CALLBACK (startup_complete_handler), NULL);
+  }
 }
 
 void
@@ -128,12 +128,12 @@ ggd_tag_sort_by_line_to_list (const GPtrArray  *tags,
   g_return_val_if_fail (direction != 0, NULL);
   
   GGD_PTR_ARRAY_FOR (tags, i, el) {
-    children = g_list_insert_sorted_with_data (children, el,
-                                               tag_cmp_by_line,
-                                               GINT_TO_POINTER (direction));
+    children = g_list_prepend (children, el);
   }
+  children = g_list_reverse (children);
   
-  return children;
+  return g_list_sort_with_data (children, tag_cmp_by_line,
+                                GINT_TO_POINTER (direction));
 }
 
 /**
@@ -191,6 +191,49 @@ ggd_tag_find_at_current_pos (GeanyDocument *doc)
   return tag;
 }
 
+/*
+ * get_parent_name:
+ * @geany_ft: The Geany's file type identifier for which tags were generated
+ * @child: A #TMTag with a scope
+ * @parent_scope: Return location for the scope of the parent, to be freed with
+ *                g_free(). Set to %NULL if the parent has no scope.
+ * 
+ * Splits the scope of @child in the name of its parent and the parent's own
+ * scope.
+ * 
+ * Returns: The name of the parent, pointing inside @child's scope.
+ */
+static const gchar *
+get_parent_name (filetype_id   geany_ft,
+                 const TMTag  *child,
+                 gchar       **parent_scope)
+{
+  const gchar  *parent_name;
+  const gchar  *tmp;
+  const gchar  *separator;
+  gsize         separator_len;
+  
+  *parent_scope = NULL;
+  /* scope is of the form a<sep>b<sep>c */
+  parent_name = child->atts.entry.scope;
+  separator = symbols_get_context_separator (geany_ft);
+  separator_len = strlen (separator);
+  while ((tmp = strstr (parent_name, separator)) != NULL) {
+    parent_name = &tmp[separator_len];
+  }
+  /* if parent have scope */
+  if (parent_name != child->atts.entry.scope) {
+    /* the parent scope is the "dirname" of the child's scope */
+    *parent_scope = g_strndup (child->atts.entry.scope,
+                               parent_name - child->atts.entry.scope -
+                                 separator_len);
+  }
+  /*g_debug ("%s: parent_name = %s", G_STRFUNC, parent_name);
+  g_debug ("%s: parent_scope = %s", G_STRFUNC, *parent_scope);*/
+  
+  return parent_name;
+}
+
 /**
  * ggd_tag_find_parent:
  * @tags: A #GPtrArray of #TMTag<!-- -->s containing @tag
@@ -214,30 +257,12 @@ ggd_tag_find_parent (const GPtrArray *tags,
   if (! child->atts.entry.scope) {
     /* tag has no parent, we're done */
   } else {
-    gchar        *parent_scope = NULL;
+    gchar        *parent_scope;
     const gchar  *parent_name;
-    const gchar  *tmp;
     guint         i;
     TMTag        *el;
-    const gchar  *separator;
-    gsize         separator_len;
     
-    /* scope is of the form a<sep>b<sep>c */
-    parent_name = child->atts.entry.scope;
-    separator = symbols_get_context_separator (geany_ft);
-    separator_len = strlen (separator);
-    while ((tmp = strstr (parent_name, separator)) != NULL) {
-      parent_name = &tmp[separator_len];
-    }
-    /* if parent have scope */
-    if (parent_name != child->atts.entry.scope) {
-      /* the parent scope is the "dirname" of the child's scope */
-      parent_scope = g_strndup (child->atts.entry.scope,
-                                parent_name - child->atts.entry.scope -
-                                  separator_len);
-    }
-    /*g_debug ("%s: parent_name = %s", G_STRFUNC, parent_name);
-    g_debug ("%s: parent_scope = %s", G_STRFUNC, parent_scope);*/
+    parent_name = get_parent_name (geany_ft, child, &parent_scope);
     GGD_PTR_ARRAY_FOR (tags, i, el) {
       if (! (el->type & tm_tag_file_t) &&
           (utils_str_equal (el->name, parent_name) &&
@@ -481,3 +506,327 @@ ggd_tag_find_children (const GPtrArray *tags,
 {
   return ggd_tag_find_children_filtered (tags, parent, geany_ft, tm_tag_max_t);
 }
+
+
+/**
+ * SECTION: ggd-tag-index
+ * 
+ * A #GgdTagIndex answers the same queries as the ggd_tag_find_*() functions,
+ * but without going through the whole tag array each time. It is built in a
+ * single pass over the tags and is meant to be used for one operation, as
+ * long as the tag array doesn't change: it holds the tags sorted by line, the
+ * tags by name and the parent of each tag.
+ */
+
+struct _GgdTagIndex
+{
+  GPtrArray  *by_line;  /* tags sorted by line, without the file tags */
+  GHashTable *by_name;  /* name -> GPtrArray of tags, in the tag array order */
+  GHashTable *parents;  /* tag -> parent, for tags having a parent */
+  GHashTable *children; /* tag -> GPtrArray of children, sorted by line */
+};
+
+static void
+ptr_array_free (gpointer array)
+{
+  g_ptr_array_free (array, TRUE);
+}
+
+/* Same as ggd_tag_find_parent() but uses the name table of @index */
+static TMTag *
+tag_index_lookup_parent (GgdTagIndex  *index,
+                         filetype_id   geany_ft,
+                         const TMTag  *child)
+{
+  TMTag *tag = NULL;
+  
+  if (child->atts.entry.scope) {
+    gchar        *parent_scope;
+    const gchar  *parent_name;
+    GPtrArray    *candidates;
+    
+    parent_name = get_parent_name (geany_ft, child, &parent_scope);
+    candidates = g_hash_table_lookup (index->by_name, parent_name);
+    if (candidates) {
+      guint   i;
+      TMTag  *el;
+      
+      GGD_PTR_ARRAY_FOR (candidates, i, el) {
+        if (utils_str_equal (el->atts.entry.scope, parent_scope) &&
+            el->atts.entry.line <= child->atts.entry.line) {
+          tag = el;
+        }
+      }
+    }
+    g_free (parent_scope);
+  }
+  
+  return tag;
+}
+
+/**
+ * ggd_tag_index_new:
+ * @tags: A #GPtrArray of #TMTag<!-- -->s
+ * @geany_ft: The Geany's file type identifier for which tags were generated
+ * 
+ * Creates an index of @tags. The index refers to the tags, and must not be
+ * used after they are freed or modified.
+ * 
+ * Returns: A new #GgdTagIndex that should be freed with ggd_tag_index_free().
+ */
+GgdTagIndex *
+ggd_tag_index_new (const GPtrArray *tags,
+                   filetype_id      geany_ft)
+{
+  GgdTagIndex  *index;
+  guint         i;
+  TMTag        *el;
+  
+  g_return_val_if_fail (tags != NULL, NULL);
+  
+  index = g_slice_alloc (sizeof *index);
+  index->by_line = g_ptr_array_sized_new (tags->len);
+  index->by_name = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          NULL, ptr_array_free);
+  index->parents = g_hash_table_new (NULL, NULL);
+  index->children = g_hash_table_new_full (NULL, NULL, NULL, ptr_array_free);
+  
+  GGD_PTR_ARRAY_FOR (tags, i, el) {
+    GPtrArray *named;
+    
+    if (el->type & tm_tag_file_t) {
+      continue;
+    }
+    g_ptr_array_add (index->by_line, el);
+    named = g_hash_table_lookup (index->by_name, el->name);
+    if (! named) {
+      named = g_ptr_array_new ();
+      g_hash_table_insert (index->by_name, el->name, named);
+    }
+    g_ptr_array_add (named, el);
+  }
+  /* for the binary search of ggd_tag_index_find_from_line() */
+  ggd_tag_sort_by_line (index->by_line, GGD_SORT_ASC);
+  
+  GGD_PTR_ARRAY_FOR (index->by_line, i, el) {
+    TMTag *parent;
+    
+    parent = tag_index_lookup_parent (index, geany_ft, el);
+    if (parent) {
+      GPtrArray *children;
+      
+      g_hash_table_insert (index->parents, el, parent);
+      children = g_hash_table_lookup (index->children, parent);
+      if (! children) {
+        children = g_ptr_array_new ();
+        g_hash_table_insert (index->children, parent, children);
+      }
+      g_ptr_array_add (children, el);
+    }
+  }
+  
+  return index;
+}
+
+/**
+ * ggd_tag_index_free:
+ * @index: A #GgdTagIndex
+ * 
+ * Frees a #GgdTagIndex. The indexed tags are not freed.
+ */
+void
+ggd_tag_index_free (GgdTagIndex *index)
+{
+  g_return_if_fail (index != NULL);
+  
+  g_hash_table_destroy (index->children);
+  g_hash_table_destroy (index->parents);
+  g_hash_table_destroy (index->by_name);
+  g_ptr_array_free (index->by_line, TRUE);
+  g_slice_free1 (sizeof *index, index);
+}
+
+/**
+ * ggd_tag_index_find_from_line:
+ * @index: A #GgdTagIndex
+ * @line: Line for which find the tag
+ * 
+ * Finds the tag that applies for a given line, see ggd_tag_find_from_line().
+ * 
+ * Returns: A #TMTag, or %NULL if none found.
+ */
+TMTag *
+ggd_tag_index_find_from_line (GgdTagIndex *index,
+                              gulong       line)
+{
+  guint lo = 0;
+  guint hi;
+  
+  g_return_val_if_fail (index != NULL, NULL);
+  
+  /* find the first tag after the line */
+  hi = index->by_line->len;
+  while (lo < hi) {
+    guint   mid = lo + (hi - lo) / 2;
+    TMTag  *el = g_ptr_array_index (index->by_line, mid);
+    
+    if (el->atts.entry.line <= line) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0) {
+    return NULL;
+  }
+  /* and get the first of the tags on the line before it */
+  for (lo--; lo > 0; lo--) {
+    TMTag *prev = g_ptr_array_index (index->by_line, lo - 1);
+    TMTag *el   = g_ptr_array_index (index->by_line, lo);
+    
+    if (prev->atts.entry.line != el->atts.entry.line) {
+      break;
+    }
+  }
+  
+  return g_ptr_array_index (index->by_line, lo);
+}
+
+/**
+ * ggd_tag_index_find_parent:
+ * @index: A #GgdTagIndex
+ * @child: A #TMTag, child of the tag to find
+ * 
+ * Finds the parent tag of a #TMTag, see ggd_tag_find_parent().
+ * 
+ * Returns: A #TMTag, or %NULL if @child have no parent.
+ */
+TMTag *
+ggd_tag_index_find_parent (GgdTagIndex *index,
+                           const TMTag *child)
+{
+  g_return_val_if_fail (index != NULL, NULL);
+  g_return_val_if_fail (child != NULL, NULL);
+  
+  return g_hash_table_lookup (index->parents, child);
+}
+
+/**
+ * ggd_tag_index_find_children_filtered:
+ * @index: A #GgdTagIndex
+ * @parent: Tag for which get children
+ * @filter: A logical OR of the TMTagType<!-- -->s to match
+ * 
+ * Finds children tags of a #TMTag that matches @filter, see
+ * ggd_tag_find_children_filtered().
+ * 
+ * Returns: The list of children found for @parent, sorted by line
+ */
+GList *
+ggd_tag_index_find_children_filtered (GgdTagIndex *index,
+                                      const TMTag *parent,
+                                      TMTagType    filter)
+{
+  GList      *list = NULL;
+  GPtrArray  *children;
+  
+  g_return_val_if_fail (index != NULL, NULL);
+  g_return_val_if_fail (parent != NULL, NULL);
+  
+  children = g_hash_table_lookup (index->children, parent);
+  if (children) {
+    guint i;
+    
+    for (i = children->len; i > 0; i--) {
+      TMTag *el = g_ptr_array_index (children, i - 1);
+      
+      if (el->type & filter) {
+        list = g_list_prepend (list, el);
+      }
+    }
+  }
+  
+  return list;
+}
+
+/**
+ * ggd_tag_index_find_children:
+ * @index: A #GgdTagIndex
+ * @parent: Tag for which get children
+ * 
+ * Finds children tags of a #TMTag, see ggd_tag_find_children().
+ * 
+ * Returns: The list of children found for @parent, sorted by line
+ */
+GList *
+ggd_tag_index_find_children (GgdTagIndex *index,
+                             const TMTag *parent)
+{
+  return ggd_tag_index_find_children_filtered (index, parent, tm_tag_max_t);
+}
+
+/**
+ * ggd_tag_index_resolve_type_hierarchy:
+ * @index: A #GgdTagIndex
+ * @tag: A #TMTag to which get the type hierarchy
+ * 
+ * Gets the type hierarchy of a tag, see ggd_tag_resolve_type_hierarchy().
+ * 
+ * Returns: the tag's type hierarchy or %NULL if invalid.
+ */
+gchar *
+ggd_tag_index_resolve_type_hierarchy (GgdTagIndex *index,
+                                      const TMTag *tag)
+{
+  gchar *scope = NULL;
+  
+  g_return_val_if_fail (index != NULL, NULL);
+  g_return_val_if_fail (tag != NULL, NULL);
+  
+  if (tag->type & tm_tag_file_t) {
+    g_critical (_("Invalid tag"));
+  } else {
+    TMTag *parent_tag;
+    
+    parent_tag = ggd_tag_index_find_parent (index, tag);
+    scope = g_strdup (ggd_tag_get_type_name (tag));
+    if (parent_tag) {
+      gchar *parent_scope;
+      
+      parent_scope = ggd_tag_index_resolve_type_hierarchy (index, parent_tag);
+      if (parent_scope) {
+        gchar *tmp;
+        
+        tmp = g_strconcat (parent_scope, ".", scope, NULL);
+        g_free (scope);
+        scope = tmp;
+        g_free (parent_scope);
+      }
+    }
+  }
+  
+  return scope;
+}
+
+/**
+ * ggd_tag_index_find_from_name:
+ * @index: A #GgdTagIndex
+ * @name: the name of the tag to search for
+ * 
+ * Gets the tag named @name, see ggd_tag_find_from_name().
+ * 
+ * Returns: The #TMTag named @name, or %NULL if none matches
+ */
+TMTag *
+ggd_tag_index_find_from_name (GgdTagIndex *index,
+                              const gchar *name)
+{
+  GPtrArray *named;
+  
+  g_return_val_if_fail (index != NULL, NULL);
+  g_return_val_if_fail (name != NULL, NULL);
+  
+  named = g_hash_table_lookup (index->by_name, name);
+  
+  return named ? g_ptr_array_index (named, 0) : NULL;
+}
@@ -43,6 +43,8 @@ GGD_BEGIN_PLUGIN_API
  */
 #define GGD_SORT_DESC (-1)
 
+typedef struct _GgdTagIndex GgdTagIndex;
+
 void          ggd_tag_sort_by_line            (GPtrArray *tags,
                                                gint       direction);
 GList        *ggd_tag_sort_by_line_to_list    (const GPtrArray  *tags,
@@ -69,6 +71,23 @@ const gchar  *ggd_tag_get_type_name           (const TMTag *tag);
 const gchar  *ggd_tag_type_get_name           (TMTagType  type);
 TMTagType     ggd_tag_type_from_name          (const gchar *name);
 
+GgdTagIndex  *ggd_tag_index_new                     (const GPtrArray *tags,
+                                                     filetype_id      geany_ft);
+void          ggd_tag_index_free                    (GgdTagIndex *index);
+TMTag        *ggd_tag_index_find_from_line          (GgdTagIndex *index,
+                                                     gulong       line);
+TMTag        *ggd_tag_index_find_parent             (GgdTagIndex *index,
+                                                     const TMTag *child);
+GList        *ggd_tag_index_find_children_filtered  (GgdTagIndex *index,
+                                                     const TMTag *parent,
+                                                     TMTagType    filter);
+GList        *ggd_tag_index_find_children           (GgdTagIndex *index,
+                                                     const TMTag *parent);
+gchar        *ggd_tag_index_resolve_type_hierarchy  (GgdTagIndex *index,
+                                                     const TMTag *tag);
+TMTag        *ggd_tag_index_find_from_name          (GgdTagIndex *index,
+                                                     const gchar *name);
+
 
 GGD_END_PLUGIN_API
 G_END_DECLS
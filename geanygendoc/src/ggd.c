@@ -133,41 +133,139 @@ get_arg_list_from_string (GgdFileType  *ft,
   return arg_list;
 }
 
-/* pushes @value into @env as @{symbol}_list */
+/*
+ * The environment used to render comments. It is built once for all the tags
+ * documented at a time: the global environment is parsed and the file type's
+ * one merged once, then the symbols of each tag are pushed on top of them and
+ * popped again by env_pool_reset().
+ */
+typedef struct _EnvPool EnvPool;
+
+struct _EnvPool
+{
+  CtplEnviron  *env;
+  CtplEnviron  *global_env;   /* GGD_OPT_environ, overrides the tag symbols */
+  GSList       *pushed;       /* the symbols pushed for the current tag */
+};
+
+static EnvPool *
+env_pool_new (GgdFileType *ft)
+{
+  EnvPool  *pool;
+  GError   *err = NULL;
+  
+  pool = g_slice_alloc (sizeof *pool);
+  pool->env = ctpl_environ_new ();
+  ctpl_environ_merge (pool->env, ft->user_env, FALSE);
+  pool->global_env = ctpl_environ_new ();
+  if (! ctpl_environ_add_from_string (pool->global_env, GGD_OPT_environ,
+                                      &err)) {
+    msgwin_status_add (_("Failed to add global environment, skipping: %s"),
+                       err->message);
+    g_clear_error (&err);
+  }
+  pool->pushed = NULL;
+  
+  return pool;
+}
+
+/* pops all the symbols pushed since the last reset */
+static void
+env_pool_reset (EnvPool *pool)
+{
+  while (pool->pushed) {
+    GSList *tmp = pool->pushed;
+    
+    ctpl_environ_pop (pool->env, tmp->data, NULL);
+    g_free (tmp->data);
+    pool->pushed = g_slist_next (tmp);
+    g_slist_free_1 (tmp);
+  }
+}
+
+static void
+env_pool_free (EnvPool *pool)
+{
+  env_pool_reset (pool);
+  ctpl_environ_unref (pool->global_env);
+  ctpl_environ_unref (pool->env);
+  g_slice_free1 (sizeof *pool, pool);
+}
+
+static void
+env_pool_push (EnvPool         *pool,
+               const gchar     *symbol,
+               const CtplValue *value)
+{
+  ctpl_environ_push (pool->env, symbol, value);
+  pool->pushed = g_slist_prepend (pool->pushed, g_strdup (symbol));
+}
+
+static void
+env_pool_push_string (EnvPool     *pool,
+                      const gchar *symbol,
+                      const gchar *value)
+{
+  ctpl_environ_push_string (pool->env, symbol, value);
+  pool->pushed = g_slist_prepend (pool->pushed, g_strdup (symbol));
+}
+
+static void
+env_pool_push_int (EnvPool     *pool,
+                   const gchar *symbol,
+                   glong        value)
+{
+  ctpl_environ_push_int (pool->env, symbol, value);
+  pool->pushed = g_slist_prepend (pool->pushed, g_strdup (symbol));
+}
+
+/* pushes a symbol of the global environment into the pool */
+static gboolean
+env_pool_push_global_cb (CtplEnviron     *env,
+                         const gchar     *symbol,
+                         const CtplValue *value,
+                         gpointer         pool)
+{
+  (void)env;
+  
+  env_pool_push (pool, symbol, value);
+  
+  return TRUE;
+}
+
+/* pushes @value into @pool as @{symbol}_list */
 static void
 hash_table_env_push_list_cb (gpointer symbol,
                              gpointer value,
-                             gpointer env)
+                             gpointer pool)
 {
   gchar *symbol_name;
   
   symbol_name = g_strconcat (symbol, "_list", NULL);
-  ctpl_environ_push (env, symbol_name, value);
+  env_pool_push (pool, symbol_name, value);
   g_free (symbol_name);
 }
 
-/* gets the environment for a particular tag */
-static CtplEnviron *
-get_env_for_tag (GgdFileType   *ft,
-                 GgdDocSetting *setting,
-                 GeanyDocument *doc,
-                 const TMTag   *tag)
+/* pushes the environment of a particular tag into @pool */
+static void
+push_env_for_tag (EnvPool       *pool,
+                  GgdTagIndex   *index,
+                  GgdFileType   *ft,
+                  GgdDocSetting *setting,
+                  const TMTag   *tag)
 {
-  CtplEnviron  *env;
   GList        *children = NULL;
-  GPtrArray    *tag_array = doc->tm_file->tags_array;
   gboolean      returns;
   
-  env = ctpl_environ_new ();
-  ctpl_environ_push_string (env, "cursor", GGD_CURSOR_IDENTIFIER);
-  ctpl_environ_push_string (env, "symbol", tag->name);
+  env_pool_push_string (pool, "cursor", GGD_CURSOR_IDENTIFIER);
+  env_pool_push_string (pool, "symbol", tag->name);
   /* get argument list it it exists */
   if (tag->atts.entry.arglist) {
     CtplValue  *v;
     
     v = get_arg_list_from_string (ft, tag->atts.entry.arglist);
     if (v) {
-      ctpl_environ_push (env, "argument_list", v);
+      env_pool_push (pool, "argument_list", v);
       ctpl_value_free (v);
     }
   }
@@ -176,10 +274,9 @@ get_env_for_tag (GgdFileType   *ft,
   returns = ! (tag->atts.entry.var_type != NULL &&
                /* C-style none return type hack */
                strcmp ("void", tag->atts.entry.var_type) == 0);
-  ctpl_environ_push_int (env, "returns", returns);
+  env_pool_push_int (pool, "returns", returns);
   /* get direct children tags */
-  children = ggd_tag_find_children (tag_array, tag,
-                                    FILETYPE_ID (doc->file_type));
+  children = ggd_tag_index_find_children (index, tag);
   if (setting->merge_children) {
     CtplValue *v;
     
@@ -195,7 +292,7 @@ get_env_for_tag (GgdFileType   *ft,
       children = g_list_next (children);
       g_list_free_1 (tmp);
     }
-    ctpl_environ_push (env, "children", v);
+    env_pool_push (pool, "children", v);
     ctpl_value_free (v);
   } else {
     GHashTable  *vars;
@@ -221,35 +318,30 @@ get_env_for_tag (GgdFileType   *ft,
       g_list_free_1 (tmp);
     }
     /* insert children into the environment */
-    g_hash_table_foreach (vars, hash_table_env_push_list_cb, env);
+    g_hash_table_foreach (vars, hash_table_env_push_list_cb, pool);
     g_hash_table_destroy (vars);
   }
-  
-  return env;
+  /* the global environment has the last word */
+  ctpl_environ_foreach (pool->global_env, env_pool_push_global_cb, pool);
 }
 
 /* parses the template @tpl with the environment of @tag */
 static gchar *
-get_comment (GgdFileType   *ft,
+get_comment (EnvPool       *pool,
+             GgdTagIndex   *index,
+             GgdFileType   *ft,
              GgdDocSetting *setting,
-             GeanyDocument *doc,
              const TMTag   *tag,
              gint          *cursor_offset)
 {
   gchar *comment = NULL;
   
   if (setting->template) {
-    GError      *err = NULL;
-    CtplEnviron *env;
+    GError *err = NULL;
     
-    env = get_env_for_tag (ft, setting, doc, tag);
-    ctpl_environ_merge (env, ft->user_env, FALSE);
-    if (! ctpl_environ_add_from_string (env, GGD_OPT_environ, &err)) {
-      msgwin_status_add (_("Failed to add global environment, skipping: %s"),
-                         err->message);
-      g_clear_error (&err);
-    }
-    comment = parser_parse_to_string (setting->template, env, &err);
+    push_env_for_tag (pool, index, ft, setting, tag);
+    comment = parser_parse_to_string (setting->template, pool->env, &err);
+    env_pool_reset (pool);
     if (! comment) {
       msgwin_status_add (_("Failed to build comment: %s"), err->message);
       g_error_free (err);
@@ -327,7 +419,9 @@ adjust_start_line (ScintillaObject *sci,
 
 /* inserts the comment for @tag in @sci according to @setting */
 static gboolean
-do_insert_comment (GeanyDocument   *doc,
+do_insert_comment (EnvPool         *pool,
+                   GgdTagIndex     *index,
+                   GeanyDocument   *doc,
                    const TMTag     *tag,
                    GgdFileType     *ft,
                    GgdDocSetting   *setting)
@@ -338,7 +432,7 @@ do_insert_comment (GeanyDocument   *doc,
   ScintillaObject  *sci = doc->editor->sci;
   GPtrArray        *tag_array = doc->tm_file->tags_array;
   
-  comment = get_comment (ft, setting, doc, tag, &cursor_offset);
+  comment = get_comment (pool, index, ft, setting, tag, &cursor_offset);
   if (comment) {
     gint pos = 0;
     
@@ -379,23 +473,21 @@ do_insert_comment (GeanyDocument   *doc,
  * is returned in @real_tag. */
 static GgdDocSetting *
 get_setting_from_tag (GgdDocType     *doctype,
-                      GeanyDocument  *doc,
+                      GgdTagIndex    *index,
                       const TMTag    *tag,
                       const TMTag   **real_tag)
 {
   GgdDocSetting  *setting;
   gchar          *hierarchy;
   gint            nth_child;
-  GPtrArray      *tag_array = doc->tm_file->tags_array;
-  filetype_id     geany_ft = FILETYPE_ID (doc->file_type);
   
-  hierarchy = ggd_tag_resolve_type_hierarchy (tag_array, geany_ft, tag);
+  hierarchy = ggd_tag_index_resolve_type_hierarchy (index, tag);
   /*g_debug ("type hierarchy for tag %s is: %s", tag->name, hierarchy);*/
   setting = ggd_doc_type_resolve_setting (doctype, hierarchy, &nth_child);
   *real_tag = tag;
   if (setting) {
     for (; nth_child > 0; nth_child--) {
-      *real_tag = ggd_tag_find_parent (tag_array, geany_ft, *real_tag);
+      *real_tag = ggd_tag_index_find_parent (index, *real_tag);
     }
   }
   g_free (hierarchy);
@@ -445,6 +537,7 @@ get_config (GeanyDocument  *doc,
 /*
  * insert_multiple_comments:
  * @doc: A #GeanyDocument in which insert comments
+ * @index: A #GgdTagIndex of @doc's tags
  * @filetype: The #GgdFileType to use
  * @doctype: The #GgdDocType to use
  * @sorted_tag_list: A list of tag to document. This list must be sorted by
@@ -457,6 +550,7 @@ get_config (GeanyDocument  *doc,
  */
 static gboolean
 insert_multiple_comments (GeanyDocument *doc,
+                          GgdTagIndex   *index,
                           GgdFileType   *filetype,
                           GgdDocType    *doctype,
                           GList         *sorted_tag_list)
@@ -467,17 +561,19 @@ insert_multiple_comments (GeanyDocument *doc,
   GHashTable       *tag_done_table; /* keeps the list of documented tags.
                                      * Useful since documenting a tag might
                                      * actually document another one */
+  EnvPool          *pool;
   
   success = TRUE;
   tag_done_table = g_hash_table_new (NULL, NULL);
+  pool = env_pool_new (filetype);
   sci_start_undo_action (sci);
   for (node = sorted_tag_list; node; node = node->next) {
     GgdDocSetting  *setting;
     const TMTag    *tag = node->data;
     
-    setting = get_setting_from_tag (doctype, doc, tag, &tag);
+    setting = get_setting_from_tag (doctype, index, tag, &tag);
     if (setting && ! g_hash_table_lookup (tag_done_table, tag)) {
-      if (! do_insert_comment (doc, tag, filetype, setting)) {
+      if (! do_insert_comment (pool, index, doc, tag, filetype, setting)) {
         success = FALSE;
         break;
       } else {
@@ -491,6 +587,7 @@ insert_multiple_comments (GeanyDocument *doc,
     }
   }
   sci_end_undo_action (sci);
+  env_pool_free (pool);
   g_hash_table_destroy (tag_done_table);
   
   return success;
@@ -517,17 +614,21 @@ ggd_insert_comment (GeanyDocument  *doc,
 {
   gboolean          success = FALSE;
   const TMTag      *tag = NULL;
-  GPtrArray        *tag_array = NULL;
+  GgdTagIndex      *index = NULL;
   GgdFileType      *filetype = NULL;
   GgdDocType       *doctype = NULL;
   
   g_return_val_if_fail (DOC_VALID (doc), FALSE);
   
+  if (doc->tm_file) {
+    index = ggd_tag_index_new (doc->tm_file->tags_array,
+                               FILETYPE_ID (doc->file_type));
+  }
+  
  again:
   
-  if (doc->tm_file) {
-    tag_array = doc->tm_file->tags_array;
-    tag = ggd_tag_find_from_line (tag_array, line + 1 /* it is a SCI line */);
+  if (index) {
+    tag = ggd_tag_index_find_from_line (index, line + 1 /* it is a SCI line */);
   }
   if (! tag || (tag->type & tm_tag_file_t)) {
     msgwin_status_add (_("No valid tag at line %d."), line);
@@ -536,7 +637,7 @@ ggd_insert_comment (GeanyDocument  *doc,
       GgdDocSetting  *setting;
       GList          *tag_list = NULL;
       
-      setting = get_setting_from_tag (doctype, doc, tag, &tag);
+      setting = get_setting_from_tag (doctype, index, tag, &tag);
       if (setting && setting->policy == GGD_POLICY_PASS) {
         /* We want to completely skip this tag, so try previous line instead
          * FIXME: this implementation is kinda ugly... */
@@ -544,17 +645,20 @@ ggd_insert_comment (GeanyDocument  *doc,
         goto again;
       }
       if (setting && setting->autodoc_children) {
-        tag_list = ggd_tag_find_children_filtered (tag_array, tag,
-                                                   FILETYPE_ID (doc->file_type),
-                                                   setting->matches);
+        tag_list = ggd_tag_index_find_children_filtered (index, tag,
+                                                         setting->matches);
       }
       /* we assume that a parent always comes before any children, then simply add
        * it at the end */
       tag_list = g_list_append (tag_list, (gpointer)tag);
-      success = insert_multiple_comments (doc, filetype, doctype, tag_list);
+      success = insert_multiple_comments (doc, index, filetype, doctype,
+                                          tag_list);
       g_list_free (tag_list);
     }
   }
+  if (index) {
+    ggd_tag_index_free (index);
+  }
   
   return success;
 }
@@ -581,14 +685,19 @@ ggd_insert_all_comments (GeanyDocument *doc,
   if (! doc->tm_file) {
     msgwin_status_add (_("No tags in the document"));
   } else if (get_config (doc, doc_type, &filetype, &doctype)) {
-    GList    *tag_list;
+    GList        *tag_list;
+    GgdTagIndex  *index;
     
     /* get a sorted list of tags to be sure to insert by the end of the
      * document, then we don't modify the element's position of tags we'll work
      * on */
     tag_list = ggd_tag_sort_by_line_to_list (doc->tm_file->tags_array,
                                              GGD_SORT_DESC);
-    success = insert_multiple_comments (doc, filetype, doctype, tag_list);
+    index = ggd_tag_index_new (doc->tm_file->tags_array,
+                               FILETYPE_ID (doc->file_type));
+    success = insert_multiple_comments (doc, index, filetype, doctype,
+                                        tag_list);
+    ggd_tag_index_free (index);
     g_list_free (tag_list);
   }
   
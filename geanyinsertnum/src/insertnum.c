@@ -59,7 +59,7 @@ PLUGIN_KEY_GROUP(insert_numbers, COUNT_KB)
 #define RANGE_MAX 2147483647
 #define RANGE_LEN 11
 #define RANGE_TOOLTIP "-2147483648..2147483647"
-#define MAX_LINES 250000
+#define MAX_LINES 1000000
 
 typedef struct _InsertNumbersDialog
 {
@@ -122,14 +122,23 @@ static void update_display(void)
 #define sci_get_pos_at_line_sel_start(sci, line) \
 	scintilla_send_message(sci, SCI_GETLINESELSTARTPOSITION, line, 0)
 
+#define sci_get_pos_at_line_sel_end(sci, line) \
+	scintilla_send_message(sci, SCI_GETLINESELENDPOSITION, line, 0)
+
 static void insert_numbers(gboolean *cancel)
 {
 	/* editor */
 	ScintillaObject *sci = document_get_current()->editor->sci;
 	gint xinsert = sci_point_x_from_position(sci, start_pos);
 	gint xend = sci_point_x_from_position(sci, end_pos);
-	gint *line_pos = g_new(gint, end_line - start_line + 1);
+	/* selected range of each line, sel_start is -1 for the skipped lines */
+	gint *sel_start = g_new(gint, end_line - start_line + 1);
+	gint *sel_end = g_new(gint, end_line - start_line + 1);
 	gint line, i;
+	/* the whole lines are replaced at once, as a single modification */
+	gint region_start, region_end, pos;
+	gsize deleted = 0;
+	gchar *text, *result, *out;
 	/* generator */
 	gint64 start = start_value;
 	gint64 value;
@@ -150,12 +159,13 @@ static void insert_numbers(gboolean *cancel)
 		if (sci_point_x_from_position(sci,
 			scintilla_send_message(sci, SCI_GETLINEENDPOSITION, line, 0)) >= xinsert)
 		{
-			line_pos[i] = sci_get_pos_at_line_sel_start(sci, line) -
-				sci_get_position_from_line(sci, line);
+			sel_start[i] = sci_get_pos_at_line_sel_start(sci, line);
+			sel_end[i] = MAX(sel_start[i], sci_get_pos_at_line_sel_end(sci, line));
+			deleted += sel_end[i] - sel_start[i];
 			count++;
 		}
 		else
-			line_pos[i] = -1;
+			sel_start[i] = -1;
 
 		if (cancel && i % 2500 == 0)
 		{
@@ -163,7 +173,8 @@ static void insert_numbers(gboolean *cancel)
 			if (*cancel)
 			{
 				ui_progress_bar_stop();
-				g_free(line_pos);
+				g_free(sel_start);
+				g_free(sel_end);
 				return;
 			}
 		}
@@ -191,19 +202,22 @@ static void insert_numbers(gboolean *cancel)
 	aax = (lower_case ? 'a' : 'A') - 10;
 
 	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(geany->main_widgets->progressbar),
-		_("Preparing..."));
+		_("Inserting..."));
 	update_display();
-	sci_start_undo_action(sci);
-	sci_replace_sel(sci, "");
 
-	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(geany->main_widgets->progressbar),
-		_("Inserting..."));
+	/* build the new text of the lines, without the selection and with the
+	   numbers, instead of deleting and inserting on each line */
+	region_start = sci_get_position_from_line(sci, start_line);
+	region_end = sci_get_line_end_position(sci, end_line);
+	text = sci_get_contents_range(sci, region_start, region_end);
+	result = out = g_malloc(region_end - region_start - deleted + count * length + 1);
+	pos = region_start;
+
 	for (line = start_line, i = 0; line <= end_line; line++, i++)
 	{
 		gchar *beg, *end;
-		gint insert_pos;
 
-		if (line_pos[i] < 0)
+		if (sel_start[i] < 0)
 			continue;
 
 		beg = buffer;
@@ -233,24 +247,28 @@ static void insert_numbers(gboolean *cancel)
 		}
 
 		memset(beg, pad, end - beg);
-		insert_pos = sci_get_position_from_line(sci, line) + line_pos[i];
-		sci_insert_text(sci, insert_pos, buffer);
+		memcpy(out, text + (pos - region_start), sel_start[i] - pos);
+		out += sel_start[i] - pos;
+		memcpy(out, buffer, length);
+		out += length;
+		pos = sel_end[i];
 		start += step_value;
-
-		if (cancel && i % 1000 == 0)
-		{
-			update_display();
-			if (*cancel)
-			{
-				scintilla_send_message(sci, SCI_GOTOPOS, insert_pos + length, 0);
-				break;
-			}
-		}
 	}
 
-	sci_end_undo_action(sci);
+	memcpy(out, text + (pos - region_start), region_end - pos);
+	out += region_end - pos;
+	*out = '\0';
+
+	sci_set_target_start(sci, region_start);
+	sci_set_target_end(sci, region_end);
+	scintilla_send_message(sci, SCI_REPLACETARGET, out - result, (sptr_t) result);
+	scintilla_send_message(sci, SCI_GOTOPOS, start_pos, 0);
+
+	g_free(result);
+	g_free(text);
 	g_free(buffer);
-	g_free(line_pos);
+	g_free(sel_start);
+	g_free(sel_end);
 	ui_progress_bar_stop();
 }
 
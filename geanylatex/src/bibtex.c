@@ -190,68 +190,67 @@ void glatex_bibtex_insert_cite(gchar *reference_name, gchar *option)
 	g_free(tmp);
 }
 
-/* Parses a given bib file and inserting found references into a given comboboy */
-void glatex_parse_bib_file(const gchar* file, gpointer combobox)
+/* @comment, @preamble and @string entries have no key */
+static gboolean bib_entry_has_key(const gchar *type, const gchar *type_end)
 {
-	gchar **bib_entries = NULL;
-	int i = 0;
-	LaTeXLabel *tmp;
-	gchar *tmp_label_name = NULL;
-
-	if (file != NULL)
-	{
-		/* Return if its not an bib file
-		 * Also try to ignore biblatex autogenerated files */
-		if (!g_str_has_suffix(file, ".bib") ||
-			g_str_has_suffix(file, "-blx.bib"))
-		{
-			return;
-		}
+	static const gchar *keyless[] = { "comment", "preamble", "string", NULL };
+	gsize length;
+	gint i;
 
-		bib_entries = glatex_read_file_in_array(file);
+	while (type_end > type && g_ascii_isspace(type_end[-1]))
+		type_end--;
+	length = type_end - type;
 
-		if (bib_entries != NULL)
-		{
-			for (i = 0; bib_entries[i] != NULL ; i++)
-			{
-				if  (g_str_has_prefix(bib_entries[i], "@"))
-				{
-					tmp = glatex_parseLine_bib(bib_entries[i]);
-					tmp_label_name = g_strdup(tmp->label_name);
-					gtk_combo_box_append_text(GTK_COMBO_BOX(combobox), tmp_label_name);
-					g_free(tmp);
-					g_free(tmp_label_name);
-				}
-			}
-			g_free(bib_entries);
-		}
+	for (i = 0; keyless[i] != NULL; i++)
+	{
+		if (length == strlen(keyless[i]) &&
+			g_ascii_strncasecmp(type, keyless[i], length) == 0)
+			return FALSE;
 	}
+	return TRUE;
 }
 
 
-LaTeXLabel* glatex_parseLine_bib(const gchar *line)
+/* Calls func for the key of each entry starting a line of the .bib file
+ * contents data, the text between the opening brace and the first comma.
+ * Nothing is copied */
+void glatex_scan_bib_keys(const gchar *data, gsize length, LaTeXKeyFunc func,
+	gpointer user_data)
 {
-	LaTeXLabel *label;
-	const gchar *tmp_string = NULL;
-	const gchar *x = NULL;
-	gint l = 0;
+	const gchar *end = data + length;
+	const gchar *line;
+	const gchar *eol;
 
-	label = g_new0(LaTeXLabel, 1);
+	for (line = data; line < end; line = eol + 1)
+	{
+		const gchar *p;
+		const gchar *key;
+		const gchar *key_end;
 
-	x = line;
+		eol = glatex_find_line_end(line, end);
 
-	while (*x != '\0' &&
-		   *x != '{')
-	{
-		x++;
-	}
-	tmp_string = x + 1;
-	g_warning("%s", tmp_string);
-	while (*x != '\0' && *x != ',')
-	{
-		l++;
-		x++;
+		p = line;
+		while (p < eol && (*p == ' ' || *p == '\t'))
+			p++;
+		if (p == eol || *p != '@')
+			continue;
+
+		key = p + 1;
+		while (p < eol && *p != '{' && *p != '(')
+			p++;
+		if (p == eol || !bib_entry_has_key(key, p))
+			continue;
+
+		key = p + 1;
+		while (key < eol && g_ascii_isspace(*key))
+			key++;
+		key_end = key;
+		while (key_end < eol && *key_end != ',')
+			key_end++;
+		while (key_end > key && g_ascii_isspace(key_end[-1]))
+			key_end--;
+
+		if (key_end > key)
+			func(key, key_end - key, user_data);
 	}
-	label->label_name = g_strndup(tmp_string, l - 1);
-	return label;
 }
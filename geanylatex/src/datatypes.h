@@ -76,4 +76,7 @@ typedef struct
 	const gchar *chapter;
 } LaTeXLabel;
 
+/* Called with a key found in a file, which is not NUL-terminated */
+typedef void (*LaTeXKeyFunc) (const gchar *key, gsize length, gpointer user_data);
+
 #endif
@@ -31,6 +31,7 @@
 #endif
 
 #include "geanylatex.h"
+#include "notifyprof.h"
 #include "ctype.h"
 
 PLUGIN_VERSION_CHECK(217)
@@ -57,6 +58,7 @@ static GtkWidget *menu_latex_menu_special_char = NULL;
 static GtkWidget *menu_latex_menu_special_char_submenu = NULL;
 static GtkWidget *menu_latex_ref = NULL;
 static GtkWidget *menu_latex_label = NULL;
+static GtkWidget *menu_latex_goto_outline = NULL;
 static GtkWidget *menu_latex_bibtex = NULL;
 static GtkWidget *menu_latex_bibtex_submenu = NULL;
 static GtkWidget *menu_latex_insert_bibtex_cite = NULL;
@@ -98,6 +100,9 @@ gboolean glatex_lowercase_on_smallcaps = FALSE;
 
 /* Function will be deactivated, when only loaded */
 static gboolean toggle_active = FALSE;
+/* The open LaTeX documents, kept as their file type is set so that the
+ * keystrokes of the other documents are left at once */
+static GHashTable *glatex_latex_documents = NULL;
 
 static GtkUIManager *uim;
 static GtkActionGroup *group;
@@ -487,12 +492,23 @@ on_geany_startup_complete(G_GNUC_UNUSED GObject *obj,
 }
 
 
+static void update_latex_document(GeanyDocument *doc)
+{
+	if (doc->file_type != NULL && doc->file_type->id == GEANY_FILETYPES_LATEX)
+		g_hash_table_insert(glatex_latex_documents, doc, doc);
+	else
+		g_hash_table_remove(glatex_latex_documents, doc);
+}
+
+
 static void on_document_filetype_set(G_GNUC_UNUSED GObject *obj, GeanyDocument *doc,
 									 G_GNUC_UNUSED GeanyFiletype *filetype_old,
 									 G_GNUC_UNUSED gpointer user_data)
 {
 	g_return_if_fail(doc != NULL);
 
+	update_latex_document(doc);
+
 	if (main_is_realized() == TRUE)
 	{
 		toggle_toolbar_items_by_file_type(doc->file_type->id);
@@ -513,14 +529,152 @@ static gint get_char_relative(ScintillaObject *sci, gint pos, gint n)
 }
 
 
+/* Returns: the position of the first c in [pos, end), -1 if there is none */
+static gint find_char(ScintillaObject *sci, gint pos, gint end, gchar c)
+{
+	for (; pos < end; pos++)
+	{
+		if (sci_get_char_at(sci, pos) == c)
+			return pos;
+	}
+	return -1;
+}
+
+
+/* Introduces \end{} or \endgroup{} after a \begin{} on line, unless the
+ * environment is closed within the next lines already. Only the characters
+ * needed are read, the lines aren't copied. */
+static void glatex_close_environment(GeanyEditor *editor, gint pos, gint line)
+{
+	static const gchar begin[] = "\\begin";
+	ScintillaObject *sci = editor->sci;
+	gint start, line_end, open_brace, close_brace, last_line, i;
+	gchar *full_cmd, *env, *end_construct;
+	struct Sci_TextToFind ttf;
+
+	/* get to the first non-blank char */
+	start = (gint) scintilla_send_message(sci, SCI_GETLINEINDENTPOSITION, (uptr_t) line, 0);
+	line_end = sci_get_line_end_position(sci, line);
+
+	for (i = 0; begin[i] != '\0'; i++)
+	{
+		if (start + i >= line_end || sci_get_char_at(sci, start + i) != begin[i])
+			return;
+	}
+	start += i;
+
+	/* take also "\begingroup" (or whatever there can be) and
+	 * append "\endgroup" and so on. */
+	open_brace = find_char(sci, start, line_end, '{');
+	if (open_brace < 0)
+		return;
+	close_brace = find_char(sci, open_brace + 1, line_end, '}');
+	if (close_brace < 0)
+		return;
+
+	full_cmd = sci_get_contents_range(sci, start, open_brace);
+	env = sci_get_contents_range(sci, open_brace + 1, close_brace);
+	end_construct = g_strdup_printf("\\end%s{%s}", full_cmd, env);
+
+	/* Search whether the environment is closed within the next
+	 * lines. We assume, no \end is needed in such cases */
+	last_line = MIN(line + glatex_autocompletion_context_size - 1,
+					sci_get_line_count(sci) - 1);
+	if (last_line > line)
+	{
+		ttf.chrg.cpMin = sci_get_position_from_line(sci, line + 1);
+		ttf.chrg.cpMax = sci_get_line_end_position(sci, last_line);
+		ttf.lpstrText = end_construct;
+		if (sci_find_text(sci, SCFIND_MATCHCASE, &ttf) >= 0)
+		{
+			g_free(end_construct);
+			g_free(env);
+			g_free(full_cmd);
+			return;
+		}
+	}
+	g_free(end_construct);
+
+	{
+		/* After we have this, we need to ensure basic
+		 * indent is getting applied on closing command */
+		gint indent = sci_get_line_indentation(sci, line);
+		/* Now we build up closing string and insert
+		 * it into document */
+		gchar *construct = g_strdup_printf("\t\n\\end%s{%s}", full_cmd, env);
+
+		editor_insert_text_block(editor, construct, pos, 1, -1, TRUE);
+		/* ... and setting the indention */
+		sci_set_line_indentation(sci, sci_get_current_line(sci) + 1, indent);
+		g_free(construct);
+	}
+	g_free(env);
+	g_free(full_cmd);
+}
+
+
+/* Adds {} after a command ending the line that has been 'finished' */
+static void glatex_close_command_braces(GeanyEditor *editor, gint pos, gint line)
+{
+	ScintillaObject *sci = editor->sci;
+	gint line_start = sci_get_position_from_line(sci, line);
+	gint i;
+
+	/* Searching for either \ or " ", {, } from end of
+	 * line back to start */
+	for (i = sci_get_line_end_position(sci, line) - 1; i >= line_start; i--)
+	{
+		gchar c = sci_get_char_at(sci, i);
+
+		if (c == '\\')
+		{
+			if (i == line_start || sci_get_char_at(sci, i - 1) != '\\')
+			{
+				sci_insert_text(sci, pos - editor_get_eol_char_len(editor), "{}");
+			}
+			/* We will stop here in any case */
+			break;
+		}
+		/* Else we want to stop once we found a space,
+		 * some closing braces somewhere before as we
+		 * are assuming, manipulating something here
+		 * would cause a bigger mass. */
+		else if (c == ' ' || c == '}' || c == '{' || c == '"')
+		{
+			break;
+		}
+	}
+}
+
+
 static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *editor,
 									SCNotification *nt, G_GNUC_UNUSED gpointer data)
 {
 	ScintillaObject* sci;
 	gint pos;
+	gboolean is_latex;
 
 	g_return_val_if_fail(editor != NULL, FALSE);
 	sci = editor->sci;
+
+	/* Keep the outline of the document up to date */
+	if (nt->nmhdr.code == SCN_MODIFIED &&
+		(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+	{
+		glatex_outline_document_modified(editor->document, nt);
+		return FALSE;
+	}
+
+	if (nt->nmhdr.code != SCN_CHARADDED)
+		return FALSE;
+
+	/* Most keystrokes are typed into other documents, which have nothing to do
+	 * unless the autocompletion applies to all of them */
+	is_latex = g_hash_table_lookup(glatex_latex_documents, editor->document) != NULL;
+	if (!is_latex && (glatex_autocompletion_active == FALSE ||
+		glatex_autocompletion_only_for_latex == TRUE))
+		return FALSE;
+
 	/* Autocompletion for LaTeX specific stuff:
 	 * Introducing \end{} or \endgroup{} after a \begin{}
 
@@ -529,244 +683,108 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 	 * EXtended for GeanyLaTeX with some more autocompletion features
 	 * for e.g. _{} and ^{}.*/
 
-	if (glatex_autocompletion_active == TRUE &&
-		!(glatex_autocompletion_only_for_latex == TRUE &&
-		editor->document->file_type->id != GEANY_FILETYPES_LATEX))
+	if (glatex_autocompletion_active == TRUE)
 	{
 		pos = sci_get_current_position(sci);
 
-		if (nt->nmhdr.code == SCN_CHARADDED)
+		switch (nt->ch)
 		{
-			switch (nt->ch)
+			case '\n':
+			case '\r':
 			{
-				case '\n':
-				case '\r':
-				{
-					if (sci_get_char_at(sci, pos - (editor_get_eol_char_len (editor) + 1)) == '}'||
-						sci_get_char_at(sci, pos - (editor_get_eol_char_len (editor) + 1)) == ']')
-					{
-						gchar *buf, *construct;
-						/* TODO: Make possible to have longer than a 50 chars environment */
-						gchar env[50];
-						gint line = sci_get_line_from_position(sci, pos - (editor_get_eol_char_len (editor) + 1));
-						gint line_len = sci_get_line_length(sci, line);
-						gint i, start;
-						gint indent;
-
-						/* get the line */
-						buf = sci_get_line(sci, line);
-
-						/* get to the first non-blank char (some kind of ltrim()) */
-						start = 0;
-						while (isspace(buf[start]) && buf[start] != '\0')
-							start++;
-
-						/* check for begin for autocompletion of \end{} and \endgr*/
-						if (strncmp(buf + start, "\\begin", 6) == 0)
-						{
-							gchar full_cmd[15];
-							guint j = 0;
-
-							/* take also "\begingroup" (or whatever there can be) and
-							 * append "\endgroup" and so on. */
-							i = start + 6;
-							while (i < line_len && buf[i] != '{' && j < (sizeof(full_cmd) - 1))
-							{
-								/* copy all between "\begin" and "{" to full_cmd */
-								full_cmd[j] = buf[i];
-								i++;
-								j++;
-							}
-							full_cmd[j] = '\0';
-
-							/* go through the line and get the environment */
-							for (i = start + j; i < line_len; i++)
-							{
-								if (buf[i] == '{')
-								{
-									j = 0;
-									i++;
-									while (buf[i] != '}' && j < (sizeof(env) - 1))
-									{   /* this could be done in a shorter way,
-									 	 * but so it remains readable ;-) */
-										env[j] = buf[i];
-										j++;
-										i++;
-									}
-									env[j] = '\0';
-									break;
-								}
-							}
-							/* Search whether the environment is closed within the next
-							 * lines. We assume, no \end is needed in such cases */
-							/* TODO using sci_find_text() should be way faster than getting
-							 *	  the line buffer and performing string comparisons */
-							for (i = 1; i < glatex_autocompletion_context_size; i++)
-							{
-								gchar *tmp;
-								gchar *end_construct;
-								tmp = sci_get_line(sci, line + i);
-
-								end_construct = g_strdup_printf("\\end%s{%s}", full_cmd, env);
-								if (strstr(tmp, end_construct) != NULL)
-								{
-									/* Clean up everything and quit as nothing
-									 * needs to be done */
-									g_free(tmp);
-									g_free(buf);
-									g_free(end_construct);
-									return FALSE;
-								}
-								g_free(tmp);
-								g_free(end_construct);
-							}
-
-							/* After we have this, we need to ensure basic
-							 * indent is getting applied on closing command */
-							indent = sci_get_line_indentation(sci, line);
-
-							/* Now we build up closing string and insert
-							 * it into document */
-							construct = g_strdup_printf("\t\n\\end%s{%s}", full_cmd, env);
-							editor_insert_text_block(editor, construct, pos,
-								1, -1, TRUE);
-							/* ... and setting the indention */
-							sci_set_line_indentation(sci, sci_get_current_line(sci) + 1,
-								indent);
-							g_free(construct);
-						}
-						g_free(buf);
-					}
-
-					/* Now we are handling the case, a new line has been inserted
-					* but no closing braces */
-					else if (glatex_autobraces_active == TRUE)
-					{
-						gint line;
+				gint prev = pos - (editor_get_eol_char_len(editor) + 1);
+				gchar c = sci_get_char_at(sci, prev);
 
-						gint line_len;
-						gint i;
-						gchar *buf;
-
-						line = sci_get_line_from_position(sci, pos -
-									(editor_get_eol_char_len (editor) + 1));
-						line_len = sci_get_line_length(sci, line) -
-									editor_get_eol_char_len (editor);
-
-
-						/* Catching current line which has been 'finished'*/
-						buf = sci_get_line(sci, line);
-
-						/* Searching for either \ or " ", {, } from end of
-						 * line back to start */
-						for (i = line_len; i >= 0 ; i--)
-						{
-							if (buf[i] == '\\')
-							{
-								if ((i > 0 && buf[i-1] != '\\') ||
-									(i == 0))
-								{
-									sci_insert_text(sci,
-										pos - (editor_get_eol_char_len (editor)), "{}");
-								}
-								/* We will stop here in any case */
-								break;
-							}
-							/* Else we want to stop once we found a space,
-							 * some closing braces somewhere before as we
-							 * are assuming, manipulating something here
-							 * would cause a bigger mass. */
-							else if (buf[i] == ' ' ||
-									 buf[i] == '}' ||
-									 buf[i] == '{' ||
-									 buf[i] == '"')
-							{
-								break;
-							}
-						}
-						g_free(buf);
-					}
-					break;
-				} /* Closing case \r or \n */
-				case '_':
-				case '^':
+				if (c == '}' || c == ']')
 				{
-					if (glatex_autobraces_active == TRUE)
-					{
-						sci_insert_text(sci, -1, "{}");
-						sci_set_current_position(sci, pos + 1, TRUE);
-					}
-					break;
+					glatex_close_environment(editor, pos, sci_get_line_from_position(sci, prev));
 				}
-				default:
+				/* Now we are handling the case, a new line has been inserted
+				* but no closing braces */
+				else if (glatex_autobraces_active == TRUE)
 				{
-					if (glatex_capitalize_sentence_starts == TRUE &&
-						g_ascii_isspace(get_char_relative(sci, pos, -2)))
-					{
-						gint prevNonWhite = 0;
-						gint i;
+					glatex_close_command_braces(editor, pos, sci_get_line_from_position(sci, prev));
+				}
+				break;
+			} /* Closing case \r or \n */
+			case '{':
+			{
+				glatex_outline_complete_reference(editor, pos);
+				break;
+			}
+			case '_':
+			case '^':
+			{
+				if (glatex_autobraces_active == TRUE)
+				{
+					sci_insert_text(sci, -1, "{}");
+					sci_set_current_position(sci, pos + 1, TRUE);
+				}
+				break;
+			}
+			default:
+			{
+				if (glatex_capitalize_sentence_starts == TRUE &&
+					g_ascii_isspace(get_char_relative(sci, pos, -2)))
+				{
+					gint prevNonWhite = 0;
+					gint i;
 
-						/* find the previous non-white character */
-						i = get_position_relative(sci, pos, -3);
-						while (g_ascii_isspace((prevNonWhite = sci_get_char_at(sci, i))))
-						{
-							/* no need to bother about multi-byte characters here since
-							 * we only check for ASCII space characters anyway */
-							--i;
-						}
+					/* find the previous non-white character */
+					i = get_position_relative(sci, pos, -3);
+					while (g_ascii_isspace((prevNonWhite = sci_get_char_at(sci, i))))
+					{
+						/* no need to bother about multi-byte characters here since
+						 * we only check for ASCII space characters anyway */
+						--i;
+					}
 
-						if (prevNonWhite == '.' ||
-							prevNonWhite == '!' ||
-							prevNonWhite == '?')
-						{
-							gchar *upperLtr = NULL;
-							gchar *selection = NULL;
+					if (prevNonWhite == '.' ||
+						prevNonWhite == '!' ||
+						prevNonWhite == '?')
+					{
+						gchar *upperLtr = NULL;
+						gchar *selection = NULL;
 
-							sci_set_selection_start(sci, get_position_relative(sci, pos, -1));
-							sci_set_selection_end(sci, pos);
+						sci_set_selection_start(sci, get_position_relative(sci, pos, -1));
+						sci_set_selection_end(sci, pos);
 
-							selection = sci_get_selection_contents(sci);
-							upperLtr = g_utf8_strup(selection, -1);
-							sci_replace_sel(sci, upperLtr);
+						selection = sci_get_selection_contents(sci);
+						upperLtr = g_utf8_strup(selection, -1);
+						sci_replace_sel(sci, upperLtr);
 
-							g_free(upperLtr);
-							g_free(selection);
-						}
+						g_free(upperLtr);
+						g_free(selection);
 					}
-					break;
 				}
-			} /* Closing switch  */
-			/* later there could be some else ifs for other keywords */
-		}
+				break;
+			}
+		} /* Closing switch  */
+		/* later there could be some else ifs for other keywords */
 	} /* End of latex autocpletion */
 
 	/* Toggle special characters on input */
-	if (editor->document->file_type->id == GEANY_FILETYPES_LATEX &&
-		toggle_active == TRUE)
+	if (is_latex && toggle_active == TRUE)
 	{
-		if (nt->nmhdr.code == SCN_CHARADDED)
-		{
-			gchar buf[7];
-			gint len;
-			sci = editor->sci;
+		gchar buf[7];
+		gint len;
 
-			len = g_unichar_to_utf8(nt->ch, buf);
-			if (len > 0)
-			{
-				const gchar *entity;
+		len = g_unichar_to_utf8(nt->ch, buf);
+		if (len > 0)
+		{
+			const gchar *entity;
 
-				buf[len] = '\0';
-				entity = glatex_get_entity(buf);
+			buf[len] = '\0';
+			entity = glatex_get_entity(buf);
 
-				if (entity != NULL)
-				{
-					pos = sci_get_current_position(sci);
+			if (entity != NULL)
+			{
+				pos = sci_get_current_position(sci);
 
-					sci_set_selection_start(editor->sci, pos - len);
-					sci_set_selection_end(editor->sci, pos);
+				sci_set_selection_start(editor->sci, pos - len);
+				sci_set_selection_end(editor->sci, pos);
 
-					sci_replace_sel(editor->sci, entity);
-				}
+				sci_replace_sel(editor->sci, entity);
 			}
 		}
 	}
@@ -779,6 +797,9 @@ static void on_document_close(G_GNUC_UNUSED GObject *obj, GeanyDocument *doc,
 {
 	g_return_if_fail(doc != NULL);
 
+	glatex_outline_document_closed(doc);
+	g_hash_table_remove(glatex_latex_documents, doc);
+
 	if (doc->index < 2)
 		deactivate_toolbar_items();
 	if (doc->index < 1 &&
@@ -797,9 +818,12 @@ static void glatex_kblatex_toggle(G_GNUC_UNUSED guint key_id)
 }
 
 
+GP_NOTIFY_PROFILE_EDITOR_HANDLER(on_editor_notify_profiled, on_editor_notify)
+
+
 PluginCallback plugin_callbacks[] =
 {
-	{ "editor-notify", (GCallback) &on_editor_notify, FALSE, NULL },
+	{ "editor-notify", (GCallback) &on_editor_notify_profiled, FALSE, NULL },
 	{ "document-activate", (GCallback) &on_document_activate, FALSE, NULL },
 	{ "document-filetype-set", (GCallback) &on_document_filetype_set, FALSE, NULL },
 	{ "document-new", (GCallback) &on_document_new, FALSE, NULL},
@@ -892,10 +916,8 @@ glatex_insert_ref_activated(G_GNUC_UNUSED GtkMenuItem * menuitem,
 	GtkWidget *radio2 = NULL;
 	GtkWidget *radio3 = NULL;
 	GtkWidget *tmp_entry = NULL;
-	GtkTreeModel *model = NULL;
 	GeanyDocument *doc = NULL;
-	GSList *file_list = NULL;
-	gchar *dir;
+	gchar *dir = NULL;
 
 	doc = document_get_current();
 
@@ -913,21 +935,12 @@ glatex_insert_ref_activated(G_GNUC_UNUSED GtkMenuItem * menuitem,
 	gtk_table_set_row_spacings(GTK_TABLE(table), 6);
 
 	label_ref = gtk_label_new(_("Reference name:"));
-	textbox_ref = gtk_combo_box_entry_new_text();
 
+	/* Labels of the .aux files next to the document */
 	if (doc->real_path != NULL)
-	{
 		dir = g_path_get_dirname(doc->real_path);
-		file_list = utils_get_file_list_full(dir, TRUE, TRUE, NULL);
-		glatex_add_Labels(textbox_ref, file_list);
-		model = gtk_combo_box_get_model(GTK_COMBO_BOX(textbox_ref));
-		gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(model),
-			0, GTK_SORT_ASCENDING);
-		g_slist_foreach(file_list, (GFunc) g_free, NULL);
-		g_slist_free(file_list);
-		if (dir != NULL)
-			g_free(dir);
-	}
+	textbox_ref = glatex_label_index_combo_box_new(dir, GLATEX_LABEL_INDEX_LABELS);
+	g_free(dir);
 
 
 	gtk_misc_set_alignment(GTK_MISC(label_ref), 0, 0.5);
@@ -1259,8 +1272,8 @@ on_insert_bibtex_dialog_activate(G_GNUC_UNUSED GtkMenuItem *menuitem,
 	GtkWidget *textbox = NULL;
 	GtkWidget *table = NULL;
 	GtkWidget *tmp_entry = NULL;
-	GtkTreeModel *model = NULL;
 	GeanyDocument *doc = NULL;
+	gchar *dir = NULL;
 
 	doc = document_get_current();
 
@@ -1278,35 +1291,12 @@ on_insert_bibtex_dialog_activate(G_GNUC_UNUSED GtkMenuItem *menuitem,
 	gtk_table_set_row_spacings(GTK_TABLE(table), 6);
 
 	label = gtk_label_new(_("BibTeX reference name:"));
-	textbox = gtk_combo_box_entry_new_text();
 
+	/* Citation keys of the .bib files next to the document */
 	if (doc->real_path != NULL)
-	{
-		GDir *dir;
-		gchar *tmp_dir;
-		const gchar *filename;
-
-		tmp_dir = g_path_get_dirname(doc->real_path);
-		dir = g_dir_open(tmp_dir, 0, NULL);
-
-		if(dir == NULL)
-			g_free(tmp_dir);
-		g_return_if_fail(dir != NULL);
-
-		foreach_dir(filename, dir)
-		{
-			gchar *fullpath = NULL;
-			fullpath = g_build_path(G_DIR_SEPARATOR_S, tmp_dir, filename, NULL);
-
-			glatex_parse_bib_file(fullpath, textbox);
-			g_free(fullpath);
-		}
-		g_free(tmp_dir);
-		g_dir_close(dir);
-		model = gtk_combo_box_get_model(GTK_COMBO_BOX(textbox));
-		gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(model),
-			0, GTK_SORT_ASCENDING);
-	}
+		dir = g_path_get_dirname(doc->real_path);
+	textbox = glatex_label_index_combo_box_new(dir, GLATEX_LABEL_INDEX_CITATIONS);
+	g_free(dir);
 
 
 	gtk_misc_set_alignment(GTK_MISC(label), 0, 0.5);
@@ -2003,6 +1993,9 @@ static void init_keybindings(void)
 	keybindings_set_item(key_group, KB_LATEX_INSERT_CITE,
 		glatex_kb_insert_bibtex_cite, 0, 0, "insert_cite_dialog",
 		_("Insert BibTeX reference dialog"), menu_latex_insert_bibtex_cite);
+	keybindings_set_item(key_group, KB_LATEX_GOTO_OUTLINE,
+		glatex_kb_goto_outline, 0, 0, "goto_outline",
+		_("Go to structure element"), menu_latex_goto_outline);
 }
 
 
@@ -2171,6 +2164,15 @@ add_menu_to_menubar(void)
 		g_signal_connect(menu_latex_label, "activate",
 			G_CALLBACK(glatex_insert_label_activated), NULL);
 
+		menu_latex_goto_outline = gtk_menu_item_new_with_mnemonic(
+			_("_Go to Structure Element"));
+		ui_widget_set_tooltip_text(menu_latex_goto_outline,
+			_("Jumps to a section, label or environment of the document "
+			  "and of the files it includes"));
+		gtk_container_add(GTK_CONTAINER(menu_latex_menu), menu_latex_goto_outline);
+		g_signal_connect(menu_latex_goto_outline, "activate",
+			G_CALLBACK(glatex_outline_goto_dialog), NULL);
+
 		menu_latex_insert_environment = gtk_menu_item_new_with_mnemonic(
 			_("Insert _Environment"));
 		ui_widget_set_tooltip_text(menu_latex_insert_environment,
@@ -2263,6 +2265,7 @@ add_menu_to_menubar(void)
 		ui_add_document_sensitive(menu_latex_menu_special_char);
 		ui_add_document_sensitive(menu_latex_ref);
 		ui_add_document_sensitive(menu_latex_label);
+		ui_add_document_sensitive(menu_latex_goto_outline);
 		ui_add_document_sensitive(menu_latex_format_insert);
 		ui_add_document_sensitive(menu_latex_insert_environment);
 		ui_add_document_sensitive(menu_latex_insert_usepackage);
@@ -2364,11 +2367,18 @@ void
 plugin_init(G_GNUC_UNUSED GeanyData * data)
 {
 	GeanyDocument *doc = NULL;
+	guint i;
 
 	doc = document_get_current();
 
 	main_locale_init(LOCALEDIR, GETTEXT_PACKAGE);
 
+	glatex_latex_documents = g_hash_table_new(g_direct_hash, g_direct_equal);
+	foreach_document(i)
+	{
+		update_latex_document(documents[i]);
+	}
+
 	glatex_init_configuration();
 	glatex_init_encodings_latex();
 
@@ -2418,4 +2428,8 @@ plugin_cleanup(void)
 	g_free(glatex_ref_chapter_string);
 	g_free(glatex_ref_page_string);
 	g_free(glatex_ref_all_string);
+	glatex_label_index_cleanup();
+	glatex_outline_cleanup();
+	g_hash_table_destroy(glatex_latex_documents);
+	glatex_latex_documents = NULL;
 }
@@ -34,9 +34,11 @@
 #include "bibtex.h"
 #include "latexutils.h"
 #include "reftex.h"
+#include "labelindex.h"
 #include "latexenvironments.h"
 #include "formatutils.h"
 #include "latexstructure.h"
+#include "latexoutline.h"
 #include "latexkeybindings.h"
 
 #include <string.h>
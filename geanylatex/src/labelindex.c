@@ -0,0 +1,356 @@
+/*
+ *      labelindex.c
+ *
+ *      Index of the labels and citation keys found in the .aux and .bib
+ *      files of a directory, used to fill the reference dialogs.
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/* The files of a directory are only parsed again when their mtime or size
+ * changed, and the directory is only looked at again after its file monitor
+ * reported a change. Without a monitor it is looked at every time, which
+ * still only costs a stat() per file.
+ * Files are mapped and scanned in place, only the keys found are copied,
+ * into a string chunk per file, so memory does not grow with the size of
+ * the files. */
+
+#include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include "labelindex.h"
+#include "reftex.h"
+#include "bibtex.h"
+
+
+typedef struct
+{
+	const gchar *name;
+	const gchar *collate_key;
+} LabelIndexEntry;
+
+typedef struct
+{
+	GlatexLabelIndexKind kind;
+	time_t mtime;
+	gint64 size;
+	/* names and collate keys of the entries */
+	GStringChunk *strings;
+	GArray *entries;
+} LabelIndexFile;
+
+typedef struct
+{
+	gchar *dir;
+	GFileMonitor *monitor;
+	gboolean dirty;
+	/* full path -> LabelIndexFile */
+	GHashTable *files;
+	/* LabelIndexEntry of all files, sorted, pointing into files */
+	GArray *sorted[GLATEX_LABEL_INDEX_N_KINDS];
+} LabelIndexDir;
+
+
+/* directory -> LabelIndexDir */
+static GHashTable *label_index_dirs = NULL;
+
+
+static void label_index_file_free(gpointer data)
+{
+	LabelIndexFile *file = data;
+
+	g_string_chunk_free(file->strings);
+	g_array_free(file->entries, TRUE);
+	g_free(file);
+}
+
+
+static void label_index_dir_free(gpointer data)
+{
+	LabelIndexDir *index = data;
+	gint kind;
+
+	if (index->monitor != NULL)
+	{
+		g_file_monitor_cancel(index->monitor);
+		g_object_unref(index->monitor);
+	}
+	for (kind = 0; kind < GLATEX_LABEL_INDEX_N_KINDS; kind++)
+	{
+		if (index->sorted[kind] != NULL)
+			g_array_free(index->sorted[kind], TRUE);
+	}
+	g_hash_table_destroy(index->files);
+	g_free(index->dir);
+	g_free(index);
+}
+
+
+/* Returns the kind of names a file holds, or -1 if it is not indexed */
+static gint label_index_file_kind(const gchar *filename)
+{
+	if (g_str_has_suffix(filename, ".aux"))
+		return GLATEX_LABEL_INDEX_LABELS;
+	/* Also try to ignore biblatex autogenerated files */
+	if (g_str_has_suffix(filename, ".bib") &&
+		!g_str_has_suffix(filename, "-blx.bib"))
+		return GLATEX_LABEL_INDEX_CITATIONS;
+	return -1;
+}
+
+
+static void label_index_file_add_key(const gchar *key, gsize length,
+	gpointer user_data)
+{
+	LabelIndexFile *file = user_data;
+	LabelIndexEntry entry;
+	gchar *collate_key;
+
+	/* The combo box can only show valid UTF-8 */
+	if (!g_utf8_validate(key, length, NULL))
+		return;
+
+	entry.name = g_string_chunk_insert_len(file->strings, key, length);
+	collate_key = g_utf8_collate_key(entry.name, -1);
+	entry.collate_key = g_string_chunk_insert(file->strings, collate_key);
+	g_free(collate_key);
+
+	g_array_append_val(file->entries, entry);
+}
+
+
+static LabelIndexFile *label_index_file_parse(const gchar *path,
+	GlatexLabelIndexKind kind, struct stat *st)
+{
+	LabelIndexFile *file;
+	GMappedFile *map;
+
+	file = g_new0(LabelIndexFile, 1);
+	file->kind = kind;
+	file->mtime = st->st_mtime;
+	file->size = st->st_size;
+	file->strings = g_string_chunk_new(4096);
+	file->entries = g_array_new(FALSE, FALSE, sizeof(LabelIndexEntry));
+
+	map = g_mapped_file_new(path, FALSE, NULL);
+	if (map == NULL)
+		return file;
+
+	if (kind == GLATEX_LABEL_INDEX_LABELS)
+		glatex_scan_aux_labels(g_mapped_file_get_contents(map),
+			g_mapped_file_get_length(map), label_index_file_add_key, file);
+	else
+		glatex_scan_bib_keys(g_mapped_file_get_contents(map),
+			g_mapped_file_get_length(map), label_index_file_add_key, file);
+
+	g_mapped_file_free(map);
+
+	return file;
+}
+
+
+static gint label_index_entry_compare(gconstpointer a, gconstpointer b)
+{
+	const LabelIndexEntry *ea = a;
+	const LabelIndexEntry *eb = b;
+
+	return strcmp(ea->collate_key, eb->collate_key);
+}
+
+
+static void label_index_sort(LabelIndexDir *index)
+{
+	GHashTableIter iter;
+	gpointer value;
+	gint kind;
+
+	for (kind = 0; kind < GLATEX_LABEL_INDEX_N_KINDS; kind++)
+	{
+		if (index->sorted[kind] != NULL)
+			g_array_free(index->sorted[kind], TRUE);
+		index->sorted[kind] = g_array_new(FALSE, FALSE, sizeof(LabelIndexEntry));
+	}
+
+	g_hash_table_iter_init(&iter, index->files);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		LabelIndexFile *file = value;
+
+		g_array_append_vals(index->sorted[file->kind], file->entries->data,
+			file->entries->len);
+	}
+
+	for (kind = 0; kind < GLATEX_LABEL_INDEX_N_KINDS; kind++)
+		g_array_sort(index->sorted[kind], label_index_entry_compare);
+}
+
+
+/* Parses the new and changed files of the directory, and drops the files
+ * which are gone */
+static void label_index_scan(LabelIndexDir *index)
+{
+	GHashTable *files;
+	GDir *dir;
+	const gchar *filename;
+	gboolean changed = FALSE;
+
+	files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		label_index_file_free);
+
+	dir = g_dir_open(index->dir, 0, NULL);
+	if (dir != NULL)
+	{
+		foreach_dir(filename, dir)
+		{
+			gchar *path;
+			gpointer old_path;
+			gpointer old_file;
+			struct stat st;
+			gint kind;
+
+			kind = label_index_file_kind(filename);
+			if (kind < 0)
+				continue;
+
+			path = g_build_filename(index->dir, filename, NULL);
+			if (g_stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			{
+				g_free(path);
+				continue;
+			}
+
+			if (g_hash_table_lookup_extended(index->files, path, &old_path, &old_file) &&
+				((LabelIndexFile *) old_file)->mtime == st.st_mtime &&
+				((LabelIndexFile *) old_file)->size == st.st_size)
+			{
+				/* Unchanged, keep what was parsed before */
+				g_hash_table_steal(index->files, path);
+				g_hash_table_insert(files, old_path, old_file);
+				g_free(path);
+			}
+			else
+			{
+				g_hash_table_insert(files, path,
+					label_index_file_parse(path, kind, &st));
+				changed = TRUE;
+			}
+		}
+		g_dir_close(dir);
+	}
+
+	/* Whatever is left was removed or has changed */
+	if (g_hash_table_size(index->files) > 0)
+		changed = TRUE;
+	g_hash_table_destroy(index->files);
+	index->files = files;
+
+	if (changed || index->sorted[0] == NULL)
+		label_index_sort(index);
+}
+
+
+static void label_index_dir_changed_cb(G_GNUC_UNUSED GFileMonitor *monitor,
+	G_GNUC_UNUSED GFile *file, G_GNUC_UNUSED GFile *other_file,
+	G_GNUC_UNUSED GFileMonitorEvent event_type, gpointer user_data)
+{
+	LabelIndexDir *index = user_data;
+
+	index->dirty = TRUE;
+}
+
+
+static LabelIndexDir *label_index_get(const gchar *dirname)
+{
+	LabelIndexDir *index;
+
+	if (label_index_dirs == NULL)
+		label_index_dirs = g_hash_table_new_full(g_str_hash, g_str_equal,
+			NULL, label_index_dir_free);
+
+	index = g_hash_table_lookup(label_index_dirs, dirname);
+	if (index == NULL)
+	{
+		GFile *gfile;
+
+		index = g_new0(LabelIndexDir, 1);
+		index->dir = g_strdup(dirname);
+		index->dirty = TRUE;
+		index->files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			label_index_file_free);
+
+		gfile = g_file_new_for_path(dirname);
+		index->monitor = g_file_monitor_directory(gfile, G_FILE_MONITOR_NONE,
+			NULL, NULL);
+		g_object_unref(gfile);
+		if (index->monitor != NULL)
+			g_signal_connect(index->monitor, "changed",
+				G_CALLBACK(label_index_dir_changed_cb), index);
+
+		g_hash_table_insert(label_index_dirs, index->dir, index);
+	}
+
+	if (index->dirty || index->monitor == NULL)
+	{
+		/* Changes reported while scanning are caught by the next call */
+		index->dirty = FALSE;
+		label_index_scan(index);
+	}
+
+	return index;
+}
+
+
+/* Creates a combo box entry listing the labels or citation keys found in the
+ * files of dir, sorted. dir can be NULL for an empty list. */
+GtkWidget *glatex_label_index_combo_box_new(const gchar *dir,
+	GlatexLabelIndexKind kind)
+{
+	GtkListStore *store;
+	GtkWidget *combobox;
+
+	g_return_val_if_fail(kind < GLATEX_LABEL_INDEX_N_KINDS, NULL);
+
+	store = gtk_list_store_new(1, G_TYPE_STRING);
+
+	if (dir != NULL)
+	{
+		LabelIndexDir *index = label_index_get(dir);
+		GArray *sorted = index->sorted[kind];
+		guint i;
+
+		/* The store is filled before it is attached to the combo box, and
+		 * is not sorted by itself */
+		for (i = 0; i < sorted->len; i++)
+			gtk_list_store_insert_with_values(store, NULL, -1,
+				0, g_array_index(sorted, LabelIndexEntry, i).name, -1);
+	}
+
+	combobox = gtk_combo_box_entry_new_with_model(GTK_TREE_MODEL(store), 0);
+	g_object_unref(store);
+
+	return combobox;
+}
+
+
+void glatex_label_index_cleanup(void)
+{
+	if (label_index_dirs != NULL)
+	{
+		g_hash_table_destroy(label_index_dirs);
+		label_index_dirs = NULL;
+	}
+}
@@ -0,0 +1,36 @@
+/*
+ *      labelindex.h
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef LABELINDEX_H
+#define LABELINDEX_H
+
+#include "geanylatex.h"
+
+typedef enum
+{
+	GLATEX_LABEL_INDEX_LABELS = 0,	/* \newlabel entries of .aux files */
+	GLATEX_LABEL_INDEX_CITATIONS,	/* entries of .bib files */
+	GLATEX_LABEL_INDEX_N_KINDS
+} GlatexLabelIndexKind;
+
+GtkWidget *glatex_label_index_combo_box_new(const gchar *dir, GlatexLabelIndexKind kind);
+
+void glatex_label_index_cleanup(void);
+
+#endif
@@ -176,3 +176,10 @@ void glatex_kb_toggle_underscore_autobraces(G_GNUC_UNUSED guint key_id)
 		glatex_autobraces_active = TRUE;
 	}
 }
+
+
+void glatex_kb_goto_outline(G_GNUC_UNUSED guint key_id)
+{
+	g_return_if_fail(document_get_current() != NULL);
+	glatex_outline_goto_dialog(NULL, NULL);
+}
@@ -50,6 +50,7 @@ enum
 	KB_LATEX_INSERT_COMMAND,
 	KB_LATEX_INSERT_CITE,
 	KB_LATEX_TOGGLE_UNDERSCORE_AUTOBRACES,
+	KB_LATEX_GOTO_OUTLINE,
 	COUNT_KB
 };
 
@@ -76,5 +77,6 @@ void glatex_kb_usepackage_dialog(G_GNUC_UNUSED guint key_id);
 void glatex_kb_insert_command_dialog(G_GNUC_UNUSED guint key_id);
 void glatex_kb_insert_bibtex_cite(G_GNUC_UNUSED guint key_id);
 void glatex_kb_toggle_underscore_autobraces(G_GNUC_UNUSED guint key_id);
+void glatex_kb_goto_outline(G_GNUC_UNUSED guint key_id);
 
 #endif
@@ -0,0 +1,736 @@
+/*
+ *      latexoutline.c
+ *
+ *      Outline of the sectioning commands, labels and environments of a
+ *      document and of the files it includes.
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/* The outline of an open document is parsed completely the first time it is
+ * needed. After that, modifications only shift the line numbers of the
+ * entries and mark the lines they touched, which are parsed again the next
+ * time the outline is needed.
+ * Files pulled in by \input{} or \include{} use the outline of their
+ * document when they are open, otherwise their outline is cached until
+ * their mtime or size changes. */
+
+#include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include "latexoutline.h"
+
+
+#define OUTLINE_MAX_INPUT_DEPTH 16
+
+typedef struct
+{
+	gint line;
+	gint kind;
+	gchar *name;
+} OutlineEntry;
+
+/* Outline of an open document */
+typedef struct
+{
+	/* OutlineEntry, in line order */
+	GArray *entries;
+	/* Lines to parse again, dirty_start is -1 if there are none */
+	gint dirty_start;
+	gint dirty_end;
+} DocumentOutline;
+
+/* Outline of a file which is not open */
+typedef struct
+{
+	time_t mtime;
+	gint64 size;
+	GArray *entries;
+} FileOutline;
+
+typedef void (*OutlineFunc) (const OutlineEntry *entry, const gchar *path,
+	gpointer user_data);
+
+
+/* GeanyDocument -> DocumentOutline */
+static GHashTable *document_outlines = NULL;
+/* locale filename -> FileOutline */
+static GHashTable *file_outlines = NULL;
+
+static const gchar *reference_commands[] = {
+	"\\ref", "\\pageref", "\\eqref", "\\autoref", "\\vref", "\\cref",
+	"\\Cref", "\\nameref", NULL
+};
+
+enum {
+	OUTLINE_COLUMN_NAME = 0,
+	OUTLINE_COLUMN_FILE,
+	OUTLINE_COLUMN_LINE,
+	OUTLINE_N_COLUMNS
+};
+
+
+static void outline_entries_remove(GArray *entries, guint index, guint count)
+{
+	guint i;
+
+	for (i = index; i < index + count; i++)
+		g_free(g_array_index(entries, OutlineEntry, i).name);
+	g_array_remove_range(entries, index, count);
+}
+
+
+static void outline_entries_free(GArray *entries)
+{
+	outline_entries_remove(entries, 0, entries->len);
+	g_array_free(entries, TRUE);
+}
+
+
+static void document_outline_free(gpointer data)
+{
+	DocumentOutline *outline = data;
+
+	outline_entries_free(outline->entries);
+	g_free(outline);
+}
+
+
+static void file_outline_free(gpointer data)
+{
+	FileOutline *outline = data;
+
+	outline_entries_free(outline->entries);
+	g_free(outline);
+}
+
+
+/* Returns the index of the first entry on line or after it */
+static guint outline_entries_find(GArray *entries, gint line)
+{
+	guint lo = 0;
+	guint hi = entries->len;
+
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index(entries, OutlineEntry, mid).line < line)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+static gint outline_command_kind(const gchar *name, gsize length)
+{
+	gint i;
+
+	for (i = 0; i < GLATEX_STRUCTURE_N_LEVEL; i++)
+	{
+		/* Skip the backslash */
+		const gchar *value = glatex_structure_values[i] + 1;
+
+		if (strlen(value) == length && strncmp(value, name, length) == 0)
+			return i;
+	}
+
+	if (length == 5 && strncmp(name, "label", 5) == 0)
+		return GLATEX_OUTLINE_LABEL;
+	if (length == 5 && strncmp(name, "begin", 5) == 0)
+		return GLATEX_OUTLINE_ENVIRONMENT;
+	if ((length == 5 && strncmp(name, "input", 5) == 0) ||
+		(length == 7 && strncmp(name, "include", 7) == 0))
+		return GLATEX_OUTLINE_INPUT;
+
+	return -1;
+}
+
+
+static void outline_parse_line(const gchar *p, const gchar *end, gint line,
+	GArray *entries)
+{
+	while (p < end)
+	{
+		const gchar *name;
+		const gchar *arg;
+		gint kind;
+		gint depth;
+		OutlineEntry entry;
+
+		/* The rest of the line is a comment */
+		if (*p == '%')
+			return;
+		if (*p != '\\')
+		{
+			p++;
+			continue;
+		}
+
+		name = ++p;
+		while (p < end && g_ascii_isalpha(*p))
+			p++;
+		if (p == name)
+		{
+			/* Escaped character such as \% or \\ */
+			if (p < end)
+				p++;
+			continue;
+		}
+
+		kind = outline_command_kind(name, p - name);
+		if (kind < 0)
+			continue;
+
+		if (p < end && *p == '*')
+			p++;
+		while (p < end && g_ascii_isspace(*p))
+			p++;
+		/* Short title of sectioning commands */
+		if (p < end && *p == '[')
+		{
+			while (p < end && *p != ']')
+				p++;
+			if (p < end)
+				p++;
+			while (p < end && g_ascii_isspace(*p))
+				p++;
+		}
+		if (p == end || *p != '{')
+			continue;
+
+		arg = ++p;
+		depth = 0;
+		while (p < end && (*p != '}' || depth > 0))
+		{
+			if (*p == '{')
+				depth++;
+			else if (*p == '}')
+				depth--;
+			else if (*p == '\\' && p + 1 < end)
+				p++;
+			p++;
+		}
+
+		entry.line = line;
+		entry.kind = kind;
+		entry.name = g_strstrip(g_strndup(arg, p - arg));
+		if (*entry.name != '\0')
+			g_array_append_val(entries, entry);
+		else
+			g_free(entry.name);
+	}
+}
+
+
+/* Adds the entries of text to entries, line being the number of its first
+ * line */
+static void outline_parse_text(const gchar *text, gsize length, gint line,
+	GArray *entries)
+{
+	const gchar *end = text + length;
+	const gchar *p = text;
+
+	while (p < end)
+	{
+		const gchar *eol = glatex_find_line_end(p, end);
+
+		outline_parse_line(p, eol, line, entries);
+
+		/* "\r\n" ends a single line */
+		if (eol + 1 < end && eol[0] == '\r' && eol[1] == '\n')
+			eol++;
+		p = eol + 1;
+		line++;
+	}
+}
+
+
+static void document_outline_update(GeanyDocument *doc, DocumentOutline *outline)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	gint last_line = sci_get_line_count(sci) - 1;
+	gint start_line = outline->dirty_start;
+	gint end_line = MIN(outline->dirty_end, last_line);
+	guint first;
+	guint last;
+	gint start;
+	gint end;
+	gchar *text;
+	GArray *parsed;
+
+	outline->dirty_start = -1;
+	if (start_line > end_line)
+		return;
+
+	first = outline_entries_find(outline->entries, start_line);
+	last = outline_entries_find(outline->entries, end_line + 1);
+	outline_entries_remove(outline->entries, first, last - first);
+
+	start = sci_get_position_from_line(sci, start_line);
+	end = sci_get_line_end_position(sci, end_line);
+	text = sci_get_contents_range(sci, start, end);
+
+	parsed = g_array_new(FALSE, FALSE, sizeof(OutlineEntry));
+	outline_parse_text(text, end - start, start_line, parsed);
+	g_array_insert_vals(outline->entries, first, parsed->data, parsed->len);
+	g_array_free(parsed, TRUE);
+	g_free(text);
+}
+
+
+static GArray *document_outline_get(GeanyDocument *doc)
+{
+	DocumentOutline *outline;
+
+	if (document_outlines == NULL)
+		document_outlines = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, document_outline_free);
+
+	outline = g_hash_table_lookup(document_outlines, doc);
+	if (outline == NULL)
+	{
+		outline = g_new0(DocumentOutline, 1);
+		outline->entries = g_array_new(FALSE, FALSE, sizeof(OutlineEntry));
+		outline->dirty_start = 0;
+		outline->dirty_end = G_MAXINT;
+		g_hash_table_insert(document_outlines, doc, outline);
+	}
+
+	if (outline->dirty_start >= 0)
+		document_outline_update(doc, outline);
+
+	return outline->entries;
+}
+
+
+static GArray *file_outline_get(const gchar *path)
+{
+	FileOutline *outline;
+	GMappedFile *map;
+	struct stat st;
+
+	if (g_stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+		return NULL;
+
+	if (file_outlines == NULL)
+		file_outlines = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			file_outline_free);
+
+	outline = g_hash_table_lookup(file_outlines, path);
+	if (outline != NULL && outline->mtime == st.st_mtime &&
+		outline->size == st.st_size)
+		return outline->entries;
+
+	map = g_mapped_file_new(path, FALSE, NULL);
+	if (map == NULL)
+		return NULL;
+
+	if (outline == NULL)
+	{
+		outline = g_new0(FileOutline, 1);
+		outline->entries = g_array_new(FALSE, FALSE, sizeof(OutlineEntry));
+		g_hash_table_insert(file_outlines, g_strdup(path), outline);
+	}
+	else
+		outline_entries_remove(outline->entries, 0, outline->entries->len);
+
+	outline->mtime = st.st_mtime;
+	outline->size = st.st_size;
+	outline_parse_text(g_mapped_file_get_contents(map),
+		g_mapped_file_get_length(map), 0, outline->entries);
+	g_mapped_file_free(map);
+
+	return outline->entries;
+}
+
+
+/* Returns the real locale filename of an \input{} argument, relative to dir */
+static gchar *outline_input_path(const gchar *dir, const gchar *name)
+{
+	gchar *locale_name;
+	gchar *path;
+	gchar *real_path;
+
+	locale_name = utils_get_locale_from_utf8(name);
+	if (g_path_is_absolute(locale_name))
+		path = g_strdup(locale_name);
+	else
+		path = g_build_filename(dir, locale_name, NULL);
+	g_free(locale_name);
+
+	/* TeX adds the extension when there is none */
+	if (!g_file_test(path, G_FILE_TEST_IS_REGULAR))
+	{
+		gchar *tex_path = g_strconcat(path, ".tex", NULL);
+
+		g_free(path);
+		path = tex_path;
+	}
+
+	real_path = tm_get_real_path(path);
+	g_free(path);
+	return real_path;
+}
+
+
+/* Calls func for the entries, and for the entries of the files they include
+ * right after the \input{} entry. path is NULL for the current document */
+static void outline_foreach(GArray *entries, const gchar *path, const gchar *dir,
+	gint depth, GHashTable *visited, OutlineFunc func, gpointer user_data)
+{
+	guint i;
+
+	for (i = 0; i < entries->len; i++)
+	{
+		const OutlineEntry *entry = &g_array_index(entries, OutlineEntry, i);
+		GeanyDocument *input_doc;
+		GArray *input_entries;
+		gchar *input;
+
+		func(entry, path, user_data);
+
+		if (entry->kind != GLATEX_OUTLINE_INPUT || dir == NULL ||
+			depth >= OUTLINE_MAX_INPUT_DEPTH)
+			continue;
+
+		input = outline_input_path(dir, entry->name);
+		if (input == NULL || g_hash_table_lookup(visited, input) != NULL)
+		{
+			g_free(input);
+			continue;
+		}
+		g_hash_table_insert(visited, input, input);
+
+		input_doc = document_find_by_real_path(input);
+		if (input_doc != NULL)
+			input_entries = document_outline_get(input_doc);
+		else
+			input_entries = file_outline_get(input);
+
+		if (input_entries != NULL)
+			outline_foreach(input_entries, input, dir, depth + 1, visited,
+				func, user_data);
+	}
+}
+
+
+/* Calls func for the outline of doc and of the files it includes */
+static void outline_document_foreach(GeanyDocument *doc, OutlineFunc func,
+	gpointer user_data)
+{
+	GHashTable *visited;
+	GArray *entries;
+	gchar *dir = NULL;
+
+	visited = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	if (doc->real_path != NULL)
+	{
+		/* \input{} is relative to the directory of the main document */
+		dir = g_path_get_dirname(doc->real_path);
+		g_hash_table_insert(visited, g_strdup(doc->real_path), doc);
+	}
+
+	entries = document_outline_get(doc);
+	outline_foreach(entries, NULL, dir, 0, visited, func, user_data);
+
+	g_hash_table_destroy(visited);
+	g_free(dir);
+}
+
+
+void glatex_outline_document_modified(GeanyDocument *doc, SCNotification *nt)
+{
+	DocumentOutline *outline;
+	gint line;
+	gint added;
+
+	if (document_outlines == NULL)
+		return;
+
+	/* Documents are only followed once their outline was needed */
+	outline = g_hash_table_lookup(document_outlines, doc);
+	if (outline == NULL)
+		return;
+
+	line = sci_get_line_from_position(doc->editor->sci, nt->position);
+	added = nt->linesAdded;
+
+	if (added != 0)
+	{
+		guint i;
+
+		i = outline_entries_find(outline->entries, line + 1);
+		/* The entries of removed lines are gone */
+		if (added < 0)
+			outline_entries_remove(outline->entries, i,
+				outline_entries_find(outline->entries, line + 1 - added) - i);
+		for (; i < outline->entries->len; i++)
+			g_array_index(outline->entries, OutlineEntry, i).line += added;
+
+		if (outline->dirty_start > line)
+			outline->dirty_start = MAX(outline->dirty_start + added, line);
+		if (outline->dirty_end > line && outline->dirty_end != G_MAXINT)
+			outline->dirty_end = MAX(outline->dirty_end + added, line);
+	}
+
+	if (outline->dirty_start < 0)
+	{
+		outline->dirty_start = line;
+		outline->dirty_end = line + MAX(added, 0);
+	}
+	else
+	{
+		outline->dirty_start = MIN(outline->dirty_start, line);
+		if (outline->dirty_end != G_MAXINT)
+			outline->dirty_end = MAX(outline->dirty_end, line + MAX(added, 0));
+	}
+}
+
+
+void glatex_outline_document_closed(GeanyDocument *doc)
+{
+	if (document_outlines != NULL)
+		g_hash_table_remove(document_outlines, doc);
+}
+
+
+typedef struct
+{
+	GtkTreeStore *store;
+	/* Last entry of each sectioning level, while filling the store */
+	GtkTreeIter sections[GLATEX_STRUCTURE_N_LEVEL];
+	gboolean have_section[GLATEX_STRUCTURE_N_LEVEL];
+} OutlineStoreData;
+
+
+static void outline_store_add(const OutlineEntry *entry, const gchar *path,
+	gpointer user_data)
+{
+	OutlineStoreData *data = user_data;
+	GtkTreeIter iter;
+	GtkTreeIter *parent = NULL;
+	gint level;
+	gint i;
+	gchar *text;
+
+	/* Sections go below the last section of a higher level, everything else
+	 * below the last section */
+	level = entry->kind < GLATEX_STRUCTURE_N_LEVEL ?
+		entry->kind : GLATEX_STRUCTURE_N_LEVEL;
+	for (i = level - 1; i >= 0; i--)
+	{
+		if (data->have_section[i])
+		{
+			parent = &data->sections[i];
+			break;
+		}
+	}
+
+	switch (entry->kind)
+	{
+		case GLATEX_OUTLINE_LABEL:
+			text = g_strconcat("\\label{", entry->name, "}", NULL);
+			break;
+		case GLATEX_OUTLINE_ENVIRONMENT:
+			text = g_strconcat("\\begin{", entry->name, "}", NULL);
+			break;
+		case GLATEX_OUTLINE_INPUT:
+			text = g_strconcat("\\input{", entry->name, "}", NULL);
+			break;
+		default:
+			text = g_strdup(entry->name);
+			break;
+	}
+
+	gtk_tree_store_insert_with_values(data->store, &iter, parent, -1,
+		OUTLINE_COLUMN_NAME, text,
+		OUTLINE_COLUMN_FILE, path,
+		OUTLINE_COLUMN_LINE, entry->line, -1);
+	g_free(text);
+
+	if (entry->kind < GLATEX_STRUCTURE_N_LEVEL)
+	{
+		data->sections[entry->kind] = iter;
+		data->have_section[entry->kind] = TRUE;
+		for (i = entry->kind + 1; i < GLATEX_STRUCTURE_N_LEVEL; i++)
+			data->have_section[i] = FALSE;
+	}
+}
+
+
+static void outline_row_activated_cb(G_GNUC_UNUSED GtkTreeView *view,
+	G_GNUC_UNUSED GtkTreePath *path, G_GNUC_UNUSED GtkTreeViewColumn *column,
+	gpointer dialog)
+{
+	gtk_dialog_response(GTK_DIALOG(dialog), GTK_RESPONSE_ACCEPT);
+}
+
+
+void glatex_outline_goto_dialog(G_GNUC_UNUSED GtkMenuItem *menuitem,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	GeanyDocument *doc = NULL;
+	GtkWidget *dialog;
+	GtkWidget *vbox;
+	GtkWidget *swin;
+	GtkWidget *view;
+	GtkTreeSelection *selection;
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	OutlineStoreData data;
+
+	doc = document_get_current();
+	g_return_if_fail(doc != NULL);
+
+	memset(&data, 0, sizeof(data));
+	data.store = gtk_tree_store_new(OUTLINE_N_COLUMNS, G_TYPE_STRING,
+		G_TYPE_STRING, G_TYPE_INT);
+	outline_document_foreach(doc, outline_store_add, &data);
+
+	dialog = gtk_dialog_new_with_buttons(_("Go to Structure Element"),
+						 GTK_WINDOW(geany->main_widgets->window),
+						 GTK_DIALOG_DESTROY_WITH_PARENT, GTK_STOCK_CANCEL,
+						 GTK_RESPONSE_CANCEL, GTK_STOCK_JUMP_TO, GTK_RESPONSE_ACCEPT,
+						 NULL);
+	vbox = ui_dialog_vbox_new(GTK_DIALOG(dialog));
+	gtk_widget_set_name(dialog, "GeanyDialog");
+	gtk_window_set_default_size(GTK_WINDOW(dialog), 400, 500);
+
+	swin = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(swin),
+		GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(swin), GTK_SHADOW_IN);
+
+	view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(data.store));
+	g_object_unref(data.store);
+	gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(view), FALSE);
+	gtk_tree_view_insert_column_with_attributes(GTK_TREE_VIEW(view), -1, NULL,
+		gtk_cell_renderer_text_new(), "text", OUTLINE_COLUMN_NAME, NULL);
+	gtk_tree_view_set_search_column(GTK_TREE_VIEW(view), OUTLINE_COLUMN_NAME);
+	gtk_tree_view_expand_all(GTK_TREE_VIEW(view));
+	g_signal_connect(view, "row-activated",
+		G_CALLBACK(outline_row_activated_cb), dialog);
+
+	gtk_container_add(GTK_CONTAINER(swin), view);
+	gtk_box_pack_start(GTK_BOX(vbox), swin, TRUE, TRUE, 0);
+	gtk_widget_show_all(vbox);
+
+	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(view));
+	if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT &&
+		gtk_tree_selection_get_selected(selection, &model, &iter))
+	{
+		GeanyDocument *new_doc = doc;
+		gchar *path = NULL;
+		gint line;
+
+		gtk_tree_model_get(model, &iter, OUTLINE_COLUMN_FILE, &path,
+			OUTLINE_COLUMN_LINE, &line, -1);
+		if (path != NULL)
+			new_doc = document_open_file(path, FALSE, NULL, NULL);
+		if (new_doc != NULL)
+			navqueue_goto_line(doc, new_doc, line + 1);
+		g_free(path);
+	}
+
+	gtk_widget_destroy(dialog);
+}
+
+
+static void outline_collect_label(const OutlineEntry *entry,
+	G_GNUC_UNUSED const gchar *path, gpointer user_data)
+{
+	if (entry->kind == GLATEX_OUTLINE_LABEL)
+		g_hash_table_insert(user_data, entry->name, entry->name);
+}
+
+
+static gint outline_compare_labels(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const gchar **) a, *(const gchar **) b);
+}
+
+
+/* Shows the labels of the document and of the files it includes when the
+ * brace of a reference command was just typed before pos */
+void glatex_outline_complete_reference(GeanyEditor *editor, gint pos)
+{
+	ScintillaObject *sci = editor->sci;
+	GHashTable *labels;
+	GHashTableIter iter;
+	gpointer label;
+	GPtrArray *sorted;
+	GString *list;
+	gchar *before;
+	gint start;
+	gint i;
+
+	/* At most the longest command before the brace */
+	start = MAX(sci_get_position_from_line(sci, sci_get_line_from_position(sci, pos)),
+		pos - 1 - 10);
+	before = sci_get_contents_range(sci, start, pos - 1);
+	for (i = 0; reference_commands[i] != NULL; i++)
+	{
+		if (g_str_has_suffix(before, reference_commands[i]))
+			break;
+	}
+	g_free(before);
+	if (reference_commands[i] == NULL)
+		return;
+
+	/* Entries stay valid as long as the documents are not modified */
+	labels = g_hash_table_new(g_str_hash, g_str_equal);
+	outline_document_foreach(editor->document, outline_collect_label, labels);
+
+	sorted = g_ptr_array_new();
+	g_hash_table_iter_init(&iter, labels);
+	while (g_hash_table_iter_next(&iter, &label, NULL))
+		g_ptr_array_add(sorted, label);
+	g_ptr_array_sort(sorted, outline_compare_labels);
+
+	list = g_string_new(NULL);
+	for (i = 0; i < (gint) sorted->len; i++)
+	{
+		/* Geany separates autocompletion items with newlines */
+		if (i > 0)
+			g_string_append_c(list, '\n');
+		g_string_append(list, g_ptr_array_index(sorted, i));
+	}
+
+	if (list->len > 0)
+		scintilla_send_message(sci, SCI_AUTOCSHOW, 0, (sptr_t) list->str);
+
+	g_string_free(list, TRUE);
+	g_ptr_array_free(sorted, TRUE);
+	g_hash_table_destroy(labels);
+}
+
+
+void glatex_outline_cleanup(void)
+{
+	if (document_outlines != NULL)
+	{
+		g_hash_table_destroy(document_outlines);
+		document_outlines = NULL;
+	}
+	if (file_outlines != NULL)
+	{
+		g_hash_table_destroy(file_outlines);
+		file_outlines = NULL;
+	}
+}
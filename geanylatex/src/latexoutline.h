@@ -0,0 +1,40 @@
+/*
+ *      latexoutline.h
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef LATEXOUTLINE_H
+#define LATEXOUTLINE_H
+
+#include "geanylatex.h"
+#include "latexstructure.h"
+
+/* Kinds of outline entries, after the sectioning levels of latexstructure.h */
+enum {
+	GLATEX_OUTLINE_LABEL = GLATEX_STRUCTURE_N_LEVEL,
+	GLATEX_OUTLINE_ENVIRONMENT,
+	GLATEX_OUTLINE_INPUT
+};
+
+void glatex_outline_document_modified(GeanyDocument *doc, SCNotification *nt);
+void glatex_outline_document_closed(GeanyDocument *doc);
+void glatex_outline_goto_dialog(G_GNUC_UNUSED GtkMenuItem *menuitem,
+	G_GNUC_UNUSED gpointer gdata);
+void glatex_outline_complete_reference(GeanyEditor *editor, gint pos);
+void glatex_outline_cleanup(void);
+
+#endif
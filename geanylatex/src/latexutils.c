@@ -22,21 +22,12 @@
 #include "latexutils.h"
 #include "geanylatex.h"
 
-gchar **glatex_read_file_in_array(const gchar *filename)
+/* Returns the end of the line starting at p, a '\n' or '\r', or end */
+const gchar *glatex_find_line_end(const gchar *p, const gchar *end)
 {
-	gchar **result = NULL;
-	gchar *data;
-
-	g_return_val_if_fail((filename != NULL), NULL);
-	g_return_val_if_fail(g_file_get_contents(filename, &data, NULL, NULL), NULL);
-
-	if (data != NULL)
-	{
-		result = g_strsplit_set(data, "\r\n", -1);
-		g_free(data);
-		return result;
-	}
-	return NULL;
+	while (p < end && *p != '\n' && *p != '\r')
+		p++;
+	return p;
 }
 
 void glatex_usepackage(const gchar *pkg, const gchar *options)
@@ -23,7 +23,7 @@
 
 #include "geanylatex.h"
 
-gchar **glatex_read_file_in_array(const gchar *filename);
+const gchar *glatex_find_line_end(const gchar *p, const gchar *end);
 void glatex_usepackage(const gchar *pkg, const gchar *options);
 void glatex_enter_key_pressed_in_entry(G_GNUC_UNUSED GtkWidget *widget, gpointer dialog);
 void glatex_insert_string(const gchar *string, gboolean reset_position);
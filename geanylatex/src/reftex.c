@@ -23,72 +23,30 @@
 #include "reftex.h"
 #include "latexutils.h"
 
-void glatex_parse_aux_file(gchar *file, gpointer combobox)
+/* Calls func for the name of each \newlabel starting a line of the .aux
+ * file contents data. Nothing is copied */
+void glatex_scan_aux_labels(const gchar *data, gsize length, LaTeXKeyFunc func,
+	gpointer user_data)
 {
-	gchar **aux_entries = NULL;
-	int i = 0;
-	LaTeXLabel *tmp;
-	gchar *tmp_label_name = NULL;
+	static const gchar prefix[] = "\\newlabel{";
+	const gsize prefix_length = sizeof(prefix) - 1;
+	const gchar *end = data + length;
+	const gchar *line;
+	const gchar *eol;
 
-	if (file != NULL)
+	for (line = data; line < end; line = eol + 1)
 	{
-		/*  Return if its not an aux file */
-		if (!g_str_has_suffix(file, ".aux"))
-			return;
-
-		aux_entries = glatex_read_file_in_array(file);
-
-		if (aux_entries != NULL)
-		{
-			for (i = 0; aux_entries[i] != NULL ; i++)
-			{
-				if  (g_str_has_prefix(aux_entries[i], "\\newlabel"))
-				{
-					tmp = glatex_parseLine(aux_entries[i]);
-					tmp_label_name = g_strdup(tmp->label_name);
-					gtk_combo_box_append_text(GTK_COMBO_BOX(combobox), tmp_label_name);
-					g_free(tmp);
-					g_free(tmp_label_name);
-				}
-			}
-			g_free(aux_entries);
-		}
-	}
-}
-
-void glatex_add_Labels(GtkWidget *combobox, GSList *dir)
-{
-
-	if (dir == NULL)
-	{
-		return;
-	}
-
-	g_slist_foreach(dir, (GFunc) glatex_parse_aux_file, combobox);
-}
-
-
-LaTeXLabel* glatex_parseLine(const gchar *line)
-{
-	LaTeXLabel *label;
-	gchar *t = NULL;
-	const gchar *x = NULL;
-	gint l = 0;
-
-	label = g_new0(LaTeXLabel, 1);
-
-	line += 10;
-	x = line;
-	t = strchr(line, '}');
-	if (t != NULL)
-	{
-		while (*x != '\0' && x < t && *x != '}')
-		{
-			l++;
-			x++;
-		}
+		const gchar *name;
+		const gchar *name_end;
+
+		eol = glatex_find_line_end(line, end);
+		if ((gsize) (eol - line) < prefix_length ||
+			memcmp(line, prefix, prefix_length) != 0)
+			continue;
+
+		name = line + prefix_length;
+		name_end = memchr(name, '}', eol - name);
+		if (name_end != NULL && name_end > name)
+			func(name, name_end - name, user_data);
 	}
-	label->label_name = g_strndup(line, l);
-
-	return label;
 }
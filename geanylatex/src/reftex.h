@@ -25,10 +25,7 @@
 #include "geanylatex.h"
 
 
-void glatex_add_Labels(GtkWidget *combobox, GSList *dir);
-
-LaTeXLabel *glatex_parseLine(const gchar *line);
-
-void glatex_parse_aux_file(gchar* file, gpointer combobox);
+void glatex_scan_aux_labels(const gchar *data, gsize length, LaTeXKeyFunc func,
+	gpointer user_data);
 
 #endif
@@ -58,6 +58,7 @@ culpa qui officia deserunt mollit anim id est laborum.";
 enum
 {
 	LIPSUM_KB_INSERT,
+	LIPSUM_KB_INSERT_KB,
 	COUNT_KB
 };
 
@@ -76,6 +77,55 @@ insert_string(GeanyDocument *doc, const gchar *string)
 }
 
 
+/* Returns length bytes of lipsum repeated, filled in place by copying
+ * the part already filled, so that it stays cheap for megabytes of text. */
+static gchar *
+lipsum_generate(gsize length)
+{
+	gsize lipsum_len = strlen(lipsum);
+	gsize done;
+	gchar *text;
+	gchar *last;
+
+	if (lipsum_len == 0)
+		return g_strdup("");
+
+	text = g_malloc(length + 1);
+	done = MIN(lipsum_len, length);
+	memcpy(text, lipsum, done);
+	while (done < length)
+	{
+		gsize n = MIN(done, length - done);
+		memcpy(text + done, text, n);
+		done += n;
+	}
+	text[length] = '\0';
+
+	/* don't cut a multibyte character in the end */
+	if (length > 0)
+	{
+		last = g_utf8_find_prev_char(text, text + length);
+		if (last != NULL &&
+			g_utf8_get_char_validated(last, text + length - last) == (gunichar) -2)
+			text[last - text] = '\0';
+	}
+
+	return text;
+}
+
+
+static void
+insert_lipsum(GeanyDocument *doc, gsize length)
+{
+	gchar *text = lipsum_generate(length);
+
+	sci_start_undo_action(doc->editor->sci);
+	insert_string(doc, text);
+	sci_end_undo_action(doc->editor->sci);
+	g_free(text);
+}
+
+
 static void
 lipsum_activated(G_GNUC_UNUSED GtkMenuItem *menuitem, G_GNUC_UNUSED gpointer gdata)
 {
@@ -89,52 +139,33 @@ lipsum_activated(G_GNUC_UNUSED GtkMenuItem *menuitem, G_GNUC_UNUSED gpointer gda
 	if (doc != NULL && dialogs_show_input_numeric(_("Lipsum-Generator"),
 		_("Enter the length of Lipsum text here"), &value, 1, 5000, 1))
 	{
+		insert_lipsum(doc, (gsize) value);
+	}
+}
 
-		int tmp = 0;
-		int x = 0;
-		int i = 0;
-		int missing = 0;
-
-		/* Checking what we have */
-		tmp = strlen(lipsum);
-
-		if (tmp > value)
-		{
-			x = 0;
-			missing = value - (x * tmp);
-		}
-		else if (tmp == (int)value)
-		{
-			x = 1;
-		}
-		else if (tmp > 0)
-		{
-			x = value / tmp;
-			missing = value - (x * tmp);
-		}
-
-		sci_start_undo_action(doc->editor->sci);
-
-		/* Insert lipsum snippet as often as needed ... */
-		if (missing > 0)
-		{
-			gchar *missing_text = g_strndup(lipsum, missing);
-			insert_string(doc, missing_text);
-			g_free(missing_text);
-		}
-		for (i = 0; i < x; i++)
-		{
-			insert_string(doc, lipsum);
-		}
-		sci_end_undo_action(doc->editor->sci);
+
+/* Inserts kilobytes of text at once, e.g. to try things on large buffers */
+static void
+lipsum_kb_activated(void)
+{
+	GeanyDocument *doc = document_get_current();
+	static gdouble value = 1024;
+
+	if (doc != NULL && dialogs_show_input_numeric(_("Lipsum-Generator"),
+		_("Enter the size of Lipsum text in kilobytes here"), &value, 1, 1024 * 1024, 1))
+	{
+		insert_lipsum(doc, (gsize) value * 1024);
 	}
 }
 
 
 /* Called when keystroke were pressed */
-static void kblipsum_insert(G_GNUC_UNUSED guint key_id)
+static void kblipsum_insert(guint key_id)
 {
-	lipsum_activated(NULL, NULL);
+	if (key_id == LIPSUM_KB_INSERT_KB)
+		lipsum_kb_activated();
+	else
+		lipsum_activated(NULL, NULL);
 }
 
 
@@ -177,6 +208,8 @@ plugin_init(G_GNUC_UNUSED GeanyData *data)
 	key_group = plugin_set_key_group(geany_plugin, "geanylipsum", COUNT_KB, NULL);
 	keybindings_set_item(key_group, LIPSUM_KB_INSERT, kblipsum_insert,
 		0, 0, "insert_lipsum", _("Insert Lipsum text"), menu_lipsum);
+	keybindings_set_item(key_group, LIPSUM_KB_INSERT_KB, kblipsum_insert,
+		0, 0, "insert_lipsum_kb", _("Insert kilobytes of Lipsum text"), NULL);
 }
 
 
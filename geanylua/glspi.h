@@ -153,6 +153,11 @@ void glspi_init_sci_funcs(lua_State *L);
 /* custom dialogs module */
 void glspi_init_gsdlg_module(lua_State *L, GsDlgRunHook hook, GtkWindow *toplevel);
 void glspi_run_script(const gchar *script_file, gint caller, GKeyFile*proj, const gchar *script_dir);
+/* Run the script as a coroutine resumed from the main loop */
+void glspi_start_script(const gchar *script_file, const gchar *script_dir);
+void glspi_cancel_scripts(void);
+/* Free the compiled scripts and the idle states */
+void glspi_run_cleanup(void);
 
 /* Pass TRUE to create hashes, FALSE to destroy them */
 void glspi_set_sci_cmd_hash(gboolean create);
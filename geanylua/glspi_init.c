@@ -65,7 +65,7 @@ static struct {
 static void kb_activate(guint key_id)
 {
 	if ((key_id<MAX_HOT_KEYS) && KS[key_id]) {
-		glspi_run_script(KS[key_id],0,NULL,SD);
+		glspi_start_script(KS[key_id],SD);
 	}
 }
 
@@ -260,7 +260,14 @@ PluginCallback	glspi_geany_callbacks[] = {
 /* Callback when the menu item is clicked */
 static void menu_item_activate(GtkMenuItem * menuitem, gpointer gdata)
 {
-	glspi_run_script(gdata, 0,NULL, SD);
+	glspi_start_script(gdata, SD);
+}
+
+
+
+static void cancel_item_activate(GtkMenuItem * menuitem, gpointer gdata)
+{
+	glspi_cancel_scripts();
 }
 
 
@@ -379,6 +386,15 @@ static void build_menu(void)
 	local_data.acc_grp=NULL;
 	local_data.menu_item=new_menu(main_widgets->tools_menu,
 		local_data.script_dir, _("_Lua Scripts"));
+	if (local_data.menu_item) {
+		GtkWidget *menu = gtk_menu_item_get_submenu(GTK_MENU_ITEM(local_data.menu_item));
+		GtkWidget *item = gtk_separator_menu_item_new();
+		gtk_container_add(GTK_CONTAINER(menu), item);
+		item = gtk_menu_item_new_with_mnemonic(_("_Cancel Running Scripts"));
+		g_signal_connect(G_OBJECT(item), "activate", G_CALLBACK(cancel_item_activate), NULL);
+		gtk_container_add(GTK_CONTAINER(menu), item);
+		gtk_widget_show_all(menu);
+	}
 	if (local_data.acc_grp) {
 		gtk_window_add_accel_group(GTK_WINDOW(main_widgets->window), local_data.acc_grp);
 	}
@@ -504,7 +520,7 @@ void glspi_cleanup(void)
 	}
 	glspi_set_sci_cmd_hash(FALSE);
 	glspi_set_key_cmd_hash(FALSE);
-
+	glspi_run_cleanup();
 }
 
 
@@ -6,6 +6,9 @@
 
 #define NEED_FAIL_ARG_TYPE
 #include "glspi.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
 
 
 static KeyfileAssignFunc glspi_kfile_assign=NULL;
@@ -111,8 +114,25 @@ static void glspi_script_error(const gchar *script_file, const gchar *msg, gbool
 
 
 
+/*
+	The debug hook is called every HOOK_COUNT virtual machine instructions,
+	to check the timeout, and repaints the main window every REPAINT_HOOKS
+	calls. The line number information is only looked up when an error
+	occurs, by glspi_traceback().
+*/
+#define HOOK_COUNT 1000
+#define REPAINT_HOOKS 100
+
+/*
+	The scripts started from the menu or a keybinding run as a coroutine,
+	which yields back to the main loop after running for SLICE_TIME seconds,
+	and is resumed from an idle callback. They don't have a timeout, they
+	can be cancelled from the menu instead.
+*/
+#define SLICE_TIME 0.05
+
+
 typedef struct _StateInfo {
-	lua_State *state;
 	GString *source;
 	gint line;
 	GTimer*timer;
@@ -120,18 +140,25 @@ typedef struct _StateInfo {
 	gdouble remaining;
 	gdouble max;
 	gboolean optimized;
+	lua_State *co; /* the coroutine running the script, if it may yield */
+	GTimer*slice;
+	gboolean resuming;
+	gboolean cancelled;
 } StateInfo;
 
-static GSList *state_list=NULL;
+
+/* The address of this variable is the key of the StateInfo in the registry */
+static const gchar state_key = 0;
 
 
 static StateInfo*find_state(lua_State *L)
 {
-	GSList*p=state_list;
-	for (p=state_list; p; p=p->next) {
-		if ( p->data && ((StateInfo*)p->data)->state==L ) { return p->data; }
-	}
-	return NULL;
+	StateInfo*si;
+	lua_pushlightuserdata(L, (gpointer)&state_key);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	si=lua_touserdata(L, -1);
+	lua_pop(L, 1);
+	return si;
 }
 
 
@@ -149,6 +176,28 @@ static gchar *glspi_get_error_info(lua_State* L, gint *line)
 
 
 
+/*
+	Remember the innermost script location on the call stack,
+	skipping the C functions, for the error report.
+*/
+static void set_error_location(lua_State* L, gint level)
+{
+	StateInfo*si=find_state(L);
+	lua_Debug ar;
+	if (!si) { return; }
+	for (; lua_getstack(L, level, &ar); level++) {
+		if (lua_getinfo(L, "Sl", &ar) && (ar.currentline > 0)) {
+			if (ar.source && (ar.source[0]=='@')) {
+				g_string_assign(si->source, ar.source+1);
+			}
+			si->line=ar.currentline;
+			return;
+		}
+	}
+}
+
+
+
 static gint glspi_timeout(lua_State* L)
 {
 	if (( lua_gettop(L) > 0 ) && lua_isnumber(L,1)) {
@@ -166,8 +215,30 @@ static gint glspi_timeout(lua_State* L)
 
 
 
+/*
+	A coroutine can't yield from inside a C function, a metamethod or
+	an iterator called by the interpreter.
+*/
+static gboolean can_yield(lua_State* L, gint level)
+{
+	StateInfo*si=find_state(L);
+	lua_Debug ar;
+	if (!si || (si->co != L)) { return FALSE; }
+	for (; lua_getstack(L, level, &ar); level++) {
+		if (!lua_getinfo(L, "Sn", &ar) || (ar.what[0] == 'C')) { return FALSE; }
+		if (ar.namewhat && (g_str_equal(ar.namewhat, "metamethod") ||
+				g_str_equal(ar.namewhat, "for iterator"))) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+
 static gint glspi_yield(lua_State* L)
 {
+	if (can_yield(L, 1)) { return lua_yield(L, 0); }
 	while (gtk_events_pending()) { gtk_main_iteration(); }
 	return 0;
 }
@@ -177,6 +248,7 @@ static gint glspi_optimize(lua_State* L)
 {
 	StateInfo*si=find_state(L);
 	if (si) { si->optimized=TRUE; }
+	lua_sethook(L, NULL, 0, 0);
 	return 0;
 }
 
@@ -186,13 +258,17 @@ static void debug_hook(lua_State *L, lua_Debug *ar)
 {
 	StateInfo*si=find_state(L);
 	if (si && !si->optimized) {
-		if (lua_getinfo(L,"Sl",ar)) {
-			if (ar->source && (ar->source[0]=='@') && strcmp(si->source->str, ar->source+1)) {
-				g_string_assign(si->source, ar->source+1);
-			}
-			si->line=ar->currentline;
+		if (si->cancelled) {
+			lua_pushstring(L, _("Script cancelled."));
+			lua_error(L);
 		}
-		if (si->timer) {
+		if (si->co == L) {
+			/* Time to let the main loop run, unless the script can't yield here */
+			if ((g_timer_elapsed(si->slice,NULL) > SLICE_TIME) && can_yield(L, 0)) {
+				lua_yield(L, 0);
+				return;
+			}
+		} else if (si->timer) {
 			if (si->timer && si->max && (g_timer_elapsed(si->timer,NULL)>si->remaining)) {
 				if ( glspi_show_question(_("Script timeout"), _(
 					"A Lua script seems to be taking excessive time to complete.\n"
@@ -208,7 +284,7 @@ static void debug_hook(lua_State *L, lua_Debug *ar)
 				}
 			}
 		}
-		if (si->counter > 100000) {
+		if (si->counter > REPAINT_HOOKS) {
 			gdk_window_invalidate_rect(gtk_widget_get_window(main_widgets->window), NULL, TRUE);
 			gdk_window_process_updates(gtk_widget_get_window(main_widgets->window), TRUE);
 			si->counter=0;
@@ -242,20 +318,46 @@ static void glspi_pause_timer(gboolean pause, gpointer user_data)
 
 
 
+/*
+	Finished states can be kept and reused by the next scripts, to save
+	creating a new state and registering the modules each time. This is
+	off by default, since the global variables set by a script are seen
+	by the next ones, and can be turned on with geany.reuse().
+*/
+#define MAX_IDLE_STATES 4
+
+static gboolean reuse_states=FALSE;
+static GSList *idle_states=NULL;
+
+
+static gint glspi_reuse(lua_State* L)
+{
+	if (lua_gettop(L) > 0) {
+		if (!lua_isboolean(L,1)) { return FAIL_BOOL_ARG(1); }
+		reuse_states=lua_toboolean(L,1);
+	}
+	lua_pushboolean(L, reuse_states);
+	return 1;
+}
+
+
+
 static lua_State *glspi_state_new(void)
 {
 	lua_State *L = luaL_newstate();
 	StateInfo*si=g_new0(StateInfo,1);
 	luaL_openlibs(L);
-	si->state=L;
 	si->timer=g_timer_new();
 	si->max=DEFAULT_MAX_EXEC_TIME;
 	si->remaining=DEFAULT_MAX_EXEC_TIME;
 	si->source=g_string_new("");
 	si->line=-1;
 	si->counter=0;
-	state_list=g_slist_append(state_list,si);
-	lua_sethook(L,debug_hook,LUA_MASKLINE,1);
+	si->slice=g_timer_new();
+	lua_pushlightuserdata(L, (gpointer)&state_key);
+	lua_pushlightuserdata(L, si);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+	lua_sethook(L,debug_hook,LUA_MASKCOUNT,HOOK_COUNT);
 	return L;
 }
 
@@ -263,6 +365,7 @@ static lua_State *glspi_state_new(void)
 static void glspi_state_done(lua_State *L)
 {
 	StateInfo*si=find_state(L);
+	lua_close(L);
 	if (si) {
 		if (si->timer) {
 			g_timer_destroy(si->timer);
@@ -271,10 +374,46 @@ static void glspi_state_done(lua_State *L)
 		if (si->source) {
 			g_string_free(si->source, TRUE);
 		}
-		state_list=g_slist_remove(state_list,si);
+		g_timer_destroy(si->slice);
 		g_free(si);
 	}
-	lua_close(L);
+}
+
+
+
+/* Take an idle state for a new script, resetting its run information */
+static lua_State *glspi_state_take(void)
+{
+	lua_State *L;
+	StateInfo*si;
+	if (!idle_states) { return NULL; }
+	L=idle_states->data;
+	idle_states=g_slist_delete_link(idle_states, idle_states);
+	si=find_state(L);
+	g_timer_start(si->timer);
+	si->max=DEFAULT_MAX_EXEC_TIME;
+	si->remaining=DEFAULT_MAX_EXEC_TIME;
+	g_string_assign(si->source, "");
+	si->line=-1;
+	si->counter=0;
+	si->optimized=FALSE;
+	si->co=NULL;
+	si->cancelled=FALSE;
+	lua_sethook(L,debug_hook,LUA_MASKCOUNT,HOOK_COUNT);
+	return L;
+}
+
+
+/* Keep the state of a finished script for the next one, or close it */
+static void glspi_state_release(lua_State *L)
+{
+	if (reuse_states && (g_slist_length(idle_states) < MAX_IDLE_STATES)) {
+		lua_settop(L, 0);
+		lua_gc(L, LUA_GCCOLLECT, 0);
+		idle_states=g_slist_prepend(idle_states, L);
+	} else {
+		glspi_state_done(L);
+	}
 }
 
 
@@ -283,6 +422,7 @@ static const struct luaL_reg glspi_timer_funcs[] = {
 	{"timeout",  glspi_timeout},
 	{"yield",    glspi_yield},
 	{"optimize", glspi_optimize},
+	{"reuse",    glspi_reuse},
 	{NULL,NULL}
 };
 
@@ -293,6 +433,7 @@ static const struct luaL_reg glspi_timer_funcs[] = {
 /* Catch and report script errors */
 static gint glspi_traceback(lua_State *L)
 {
+	set_error_location(L, 1);
 	lua_getfield(L, LUA_GLOBALSINDEX, "debug");
 	if (!lua_istable(L, -1)) {
 		lua_pop(L, 1);
@@ -358,11 +499,14 @@ static void set_boolean_token(lua_State *L, const gchar*name, gboolean value)
 
 static void set_keyfile_token(lua_State *L, const gchar*name, GKeyFile* value)
 {
-	if (!value) {return;}
 	lua_getglobal(L, LUA_MODULE_NAME);
 	if (lua_istable(L, -1)) {
 		lua_pushstring(L,name);
-		glspi_kfile_assign(L, value);
+		if (value) {
+			glspi_kfile_assign(L, value);
+		} else {
+			lua_pushnil(L);
+		}
 		lua_settable(L, -3);
 	} else {
 		g_printerr("*** %s: Failed to set value for %s\n", PLUGIN_NAME, name);
@@ -391,6 +535,20 @@ static void show_error(lua_State *L, const gchar *script_file)
 
 
 
+/* Assign the module-level variables which depend on the script run */
+static void glspi_init_tokens(lua_State *L, const gchar *script_file, gint caller, GKeyFile*proj)
+{
+	set_string_token(L,tokenWordChars,GEANY_WORDCHARS);
+	set_string_token(L,tokenBanner,DEFAULT_BANNER);
+	set_string_token(L,tokenDirSep, G_DIR_SEPARATOR_S);
+	set_boolean_token(L,tokenRectSel,FALSE);
+	set_numeric_token(L,tokenCaller, caller);
+	set_keyfile_token(L,tokenProject, proj);
+	set_string_token(L,tokenScript,script_file);
+}
+
+
+
 static gint glspi_init_module(lua_State *L, const gchar *script_file, gint caller, GKeyFile*proj, const gchar*script_dir)
 {
 	luaL_openlib(L, LUA_MODULE_NAME, glspi_timer_funcs, 0);
@@ -399,15 +557,9 @@ static gint glspi_init_module(lua_State *L, const gchar *script_file, gint calle
 	glspi_init_mnu_funcs(L);
 	glspi_init_dlg_funcs(L, glspi_pause_timer);
 	glspi_init_app_funcs(L,script_dir);
-	set_string_token(L,tokenWordChars,GEANY_WORDCHARS);
-	set_string_token(L,tokenBanner,DEFAULT_BANNER);
-	set_string_token(L,tokenDirSep, G_DIR_SEPARATOR_S);
-	set_boolean_token(L,tokenRectSel,FALSE);
-	set_numeric_token(L,tokenCaller, caller);
 	glspi_init_gsdlg_module(L,glspi_pause_timer, geany_data?GTK_WINDOW(main_widgets->window):NULL);
 	glspi_init_kfile_module(L,&glspi_kfile_assign);
-	set_keyfile_token(L,tokenProject, proj);
-	set_string_token(L,tokenScript,script_file);
+	glspi_init_tokens(L, script_file, caller, proj);
 	return 0;
 }
 
@@ -427,31 +579,93 @@ gint luaopen_libgeanylua(lua_State *L)
 
 
 
-/* Load and run the script */
-void glspi_run_script(const gchar *script_file, gint caller, GKeyFile*proj, const gchar *script_dir)
+/*
+	The compiled scripts are kept, and loaded again without reading
+	their source as long as the file has the same time and size.
+*/
+typedef struct _CompiledScript {
+	time_t mtime;
+	off_t size;
+	GByteArray *code;
+} CompiledScript;
+
+static GHashTable *compiled_scripts=NULL;
+
+
+static void compiled_script_free(gpointer data)
 {
+	CompiledScript *cs=data;
+	g_byte_array_free(cs->code, TRUE);
+	g_free(cs);
+}
+
+
+static gint dump_writer(lua_State *L, const void *p, size_t size, void *code)
+{
+	g_byte_array_append(code, p, size);
+	return 0;
+}
+
+
+/* Same as luaL_loadfile(), using the compiled script when it is up to date */
+static gint load_script(lua_State *L, const gchar *script_file)
+{
+	CompiledScript *cs;
+	struct stat st;
 	gint status;
-	lua_State *L = glspi_state_new();
-	glspi_init_module(L, script_file, caller,proj,script_dir);
-#if 0
-	while (gtk_events_pending()) { gtk_main_iteration(); }
-#endif
-	status = luaL_loadfile(L, script_file);
-	switch (status) {
-	case 0: {
-		gint base = lua_gettop(L); /* function index */
-		lua_pushcfunction(L, glspi_traceback);	/* push traceback function */
-		lua_insert(L, base); /* put it under chunk and args */
-		status = lua_pcall(L, 0, 0, base);
-		lua_remove(L, base); /* remove traceback function */
-		if (0 == status) {
-			status = lua_pcall(L, 0, 0, 0);
+
+	if (g_stat(script_file, &st) != 0) {
+		return luaL_loadfile(L, script_file);
+	}
+	if (!compiled_scripts) {
+		compiled_scripts=g_hash_table_new_full(g_str_hash, g_str_equal, g_free, compiled_script_free);
+	}
+	cs=g_hash_table_lookup(compiled_scripts, script_file);
+	if (cs && (cs->mtime==st.st_mtime) && (cs->size==st.st_size)) {
+		gchar *chunkname=g_strconcat("@", script_file, NULL);
+		status=luaL_loadbuffer(L, (const gchar*)cs->code->data, cs->code->len, chunkname);
+		g_free(chunkname);
+		return status;
+	}
+
+	status=luaL_loadfile(L, script_file);
+	if (0 == status) {
+		cs=g_new0(CompiledScript, 1);
+		cs->mtime=st.st_mtime;
+		cs->size=st.st_size;
+		cs->code=g_byte_array_new();
+		if (0 == lua_dump(L, dump_writer, cs->code)) {
+			g_hash_table_insert(compiled_scripts, g_strdup(script_file), cs);
 		} else {
-			lua_gc(L, LUA_GCCOLLECT, 0); /* force garbage collection if error */
-			show_error(L, script_file);
+			compiled_script_free(cs);
 		}
-		break;
 	}
+	return status;
+}
+
+
+
+/* Create a state for the script, or take an idle one */
+static lua_State *glspi_state_prepare(const gchar *script_file, gint caller, GKeyFile*proj, const gchar *script_dir)
+{
+	lua_State *L = glspi_state_take();
+	if (L) {
+		glspi_init_tokens(L, script_file, caller, proj);
+	} else {
+		L = glspi_state_new();
+		glspi_init_module(L, script_file, caller,proj,script_dir);
+	}
+	return L;
+}
+
+
+
+/* Report an error loading the script, Returns TRUE if it was loaded */
+static gboolean check_load_status(lua_State *L, const gchar *script_file, gint status)
+{
+	switch (status) {
+	case 0:
+		return TRUE;
 	case LUA_ERRSYNTAX:
 		show_error(L, script_file);
 		break;
@@ -464,6 +678,228 @@ void glspi_run_script(const gchar *script_file, gint caller, GKeyFile*proj, cons
 	default:
 		glspi_script_error(script_file, _("Unknown error while loading script file."), TRUE, -1);
 	}
-	glspi_state_done(L);
+	return FALSE;
+}
+
+
+
+/*
+	The scripts running as coroutines, waiting for their next slice.
+	The coroutine is kept in the registry of the state while it runs.
+*/
+typedef struct _RunningScript {
+	lua_State *L;
+	lua_State *co;
+	gint co_ref;
+	gchar *script_file;
+	GTimer *timer;
+	gint shown_seconds;
+} RunningScript;
+
+static GSList *running_scripts=NULL;
+static guint resume_source=0;
+
+
+static void running_script_free(RunningScript *rs)
+{
+	luaL_unref(rs->L, LUA_REGISTRYINDEX, rs->co_ref);
+	glspi_state_release(rs->L);
+	g_timer_destroy(rs->timer);
+	g_free(rs->script_file);
+	g_free(rs);
+}
+
+
+
+/* Show the error of a coroutine, with the traceback of its stack */
+static void show_coroutine_error(RunningScript *rs)
+{
+	lua_State *L=rs->L;
+	set_error_location(rs->co, 0);
+	lua_xmove(rs->co, L, 1);
+	lua_getfield(L, LUA_GLOBALSINDEX, "debug");
+	if (lua_istable(L, -1)) {
+		lua_getfield(L, -1, "traceback");
+		lua_remove(L, -2);
+		if (lua_isfunction(L, -1)) {
+			lua_rawgeti(L, LUA_REGISTRYINDEX, rs->co_ref);
+			lua_pushvalue(L, -3);
+			lua_pushinteger(L, 0);
+			if (0 == lua_pcall(L, 3, 1, 0)) {
+				lua_replace(L, -2);
+			} else {
+				lua_pop(L, 1);
+			}
+		} else {
+			lua_pop(L, 1);
+		}
+	} else {
+		lua_pop(L, 1);
+	}
+	lua_gc(L, LUA_GCCOLLECT, 0); /* force garbage collection if error */
+	show_error(L, rs->script_file);
+}
+
+
+
+/* Run the script for a slice of time, Returns TRUE if it isn't done */
+static gboolean resume_script(RunningScript *rs)
+{
+	StateInfo*si=find_state(rs->L);
+	gint status;
+
+	g_timer_start(si->slice);
+	si->resuming=TRUE;
+	status=lua_resume(rs->co, 0);
+	si->resuming=FALSE;
+
+	if (LUA_YIELD == status) {
+		gint seconds=g_timer_elapsed(rs->timer, NULL);
+		if (seconds != rs->shown_seconds) {
+			gchar *name=g_path_get_basename(rs->script_file);
+			ui_set_statusbar(FALSE, _("Running Lua script %s (%d s)..."), name, seconds);
+			g_free(name);
+			rs->shown_seconds=seconds;
+		}
+		return TRUE;
+	}
+	if (si->cancelled) {
+		gchar *name=g_path_get_basename(rs->script_file);
+		lua_pop(rs->co, 1);
+		ui_set_statusbar(FALSE, _("Lua script %s cancelled."), name);
+		g_free(name);
+	} else if (0 != status) {
+		show_coroutine_error(rs);
+	} else if (rs->shown_seconds > 0) {
+		gchar *name=g_path_get_basename(rs->script_file);
+		ui_set_statusbar(FALSE, _("Lua script %s finished."), name);
+		g_free(name);
+	}
+	return FALSE;
+}
+
+
+
+static gboolean on_resume_idle(gpointer data)
+{
+	GSList *scripts=g_slist_copy(running_scripts);
+	GSList *p;
+	for (p=scripts; p; p=p->next) {
+		RunningScript *rs=p->data;
+		/* a script may have been cancelled by another one meanwhile */
+		if (g_slist_find(running_scripts, rs) && !resume_script(rs)) {
+			running_scripts=g_slist_remove(running_scripts, rs);
+			running_script_free(rs);
+		}
+	}
+	g_slist_free(scripts);
+	if (running_scripts) { return TRUE; }
+	resume_source=0;
+	return FALSE;
+}
+
+
+
+/*
+	Cancel the running scripts: those waiting for their next slice are
+	dropped, the others stop at their next instructions.
+*/
+void glspi_cancel_scripts(void)
+{
+	GSList *p=running_scripts;
+	while (p) {
+		RunningScript *rs=p->data;
+		StateInfo*si=find_state(rs->L);
+		GSList *next=p->next;
+		if (si->resuming) {
+			si->cancelled=TRUE;
+		} else {
+			gchar *name=g_path_get_basename(rs->script_file);
+			ui_set_statusbar(FALSE, _("Lua script %s cancelled."), name);
+			g_free(name);
+			running_scripts=g_slist_delete_link(running_scripts, p);
+			running_script_free(rs);
+		}
+		p=next;
+	}
+}
+
+
+
+/* Free the compiled scripts and the idle states */
+void glspi_run_cleanup(void)
+{
+	glspi_cancel_scripts();
+	if (resume_source) {
+		g_source_remove(resume_source);
+		resume_source=0;
+	}
+	if (compiled_scripts) {
+		g_hash_table_destroy(compiled_scripts);
+		compiled_scripts=NULL;
+	}
+	g_slist_foreach(idle_states, (GFunc)glspi_state_done, NULL);
+	g_slist_free(idle_states);
+	idle_states=NULL;
+	reuse_states=FALSE;
 }
 
+
+
+/* Load and run the script */
+void glspi_run_script(const gchar *script_file, gint caller, GKeyFile*proj, const gchar *script_dir)
+{
+	gint status;
+	lua_State *L = glspi_state_prepare(script_file, caller, proj, script_dir);
+	status = load_script(L, script_file);
+	if (check_load_status(L, script_file, status)) {
+		gint base = lua_gettop(L); /* function index */
+		lua_pushcfunction(L, glspi_traceback);	/* push traceback function */
+		lua_insert(L, base); /* put it under chunk and args */
+		status = lua_pcall(L, 0, 0, base);
+		lua_remove(L, base); /* remove traceback function */
+		if (0 == status) {
+			status = lua_pcall(L, 0, 0, 0);
+		} else {
+			lua_gc(L, LUA_GCCOLLECT, 0); /* force garbage collection if error */
+			show_error(L, script_file);
+		}
+	}
+	glspi_state_release(L);
+}
+
+
+
+/*
+	Load the script and run it as a coroutine: the first slice runs now,
+	so that short scripts are done at once, the others go on from the
+	main loop.
+*/
+void glspi_start_script(const gchar *script_file, const gchar *script_dir)
+{
+	RunningScript *rs;
+	StateInfo*si;
+	lua_State *L = glspi_state_prepare(script_file, 0, NULL, script_dir);
+	if (!check_load_status(L, script_file, load_script(L, script_file))) {
+		glspi_state_release(L);
+		return;
+	}
+	rs=g_new0(RunningScript, 1);
+	rs->L=L;
+	rs->co=lua_newthread(L);
+	rs->co_ref=luaL_ref(L, LUA_REGISTRYINDEX);
+	rs->script_file=g_strdup(script_file);
+	rs->timer=g_timer_new();
+	lua_xmove(L, rs->co, 1); /* the chunk is the body of the coroutine */
+	si=find_state(L);
+	si->co=rs->co;
+
+	if (!resume_script(rs)) {
+		running_script_free(rs);
+		return;
+	}
+	running_scripts=g_slist_append(running_scripts, rs);
+	if (!resume_source) {
+		resume_source=g_idle_add(on_resume_idle, NULL);
+	}
+}
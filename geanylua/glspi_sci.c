@@ -11,6 +11,16 @@
 #include "glspi_sci.h"
 
 
+/*
+	Direct pointer to the text of the document. It is only valid until the
+	document is modified, so don't keep it across calls to scintilla.
+*/
+static const gchar* get_text_pointer(GeanyDocument*doc)
+{
+	return (const gchar*) scintilla_send_message(doc->editor->sci, SCI_GETCHARACTERPOINTER, 0, 0);
+}
+
+
 /* Get or Set the entire text of the currently active Geany document */
 static gint glspi_text(lua_State* L)
 {
@@ -20,12 +30,8 @@ static gint glspi_text(lua_State* L)
 	if (!doc) { return 0; }
 	if (0 == lua_gettop(L)) { /* Called with no args, GET the current text */
 		gint len = sci_get_length(doc->editor->sci);
-		gchar *txt = NULL;
 		if (len>0) {
-			txt = g_malloc0((guint)len+2);
-			sci_get_text(doc->editor->sci, len+1, txt);
-			lua_pushstring(L, (const gchar *) txt);
-			g_free(txt);
+			lua_pushlstring(L, get_text_pointer(doc), len);
 		} else {
 			lua_pushstring(L, "");
 		}
@@ -272,12 +278,15 @@ static gint glspi_word(lua_State* L)
 	Pushes the line of text onto the Lua stack from the specified
 	line number. Return FALSE only if the index is out of bounds.
 */
-static gchar* get_line_text(GeanyDocument*doc,gint linenum)
+static gboolean push_line_text(lua_State *L, GeanyDocument*doc, gint linenum)
 {
 	gint count=sci_get_line_count(doc->editor->sci);
 	if ((linenum>0)&&(linenum<=count)) {
-		gchar *text=sci_get_line(doc->editor->sci, linenum-1);
-		return text?text:g_strdup("");
+		gint start=sci_get_position_from_line(doc->editor->sci, linenum-1);
+		gint stop=(linenum<count)?
+			sci_get_position_from_line(doc->editor->sci, linenum):sci_get_length(doc->editor->sci);
+		lua_pushlstring(L, get_text_pointer(doc)+start, stop-start);
+		return TRUE;
 	} else {
 		return FALSE;
 	}
@@ -292,13 +301,10 @@ static gint lines_closure(lua_State *L)
 {
 	gint idx=lua_tonumber(L, lua_upvalueindex(1))+1;
 	GeanyDocument *doc=lua_touserdata(L,lua_upvalueindex(2));
-	gchar *text=get_line_text(doc,idx);
-	if ( text ) {
-		push_number(L, idx);
-		lua_pushvalue(L, -1);
+	push_number(L, idx);
+	if ( push_line_text(L,doc,idx) ) {
+		lua_pushvalue(L, -2);
 		lua_replace(L, lua_upvalueindex(1));
-		lua_pushstring(L,text);
-		g_free(text);
 		return 2;
 	} else {
 		return 0;
@@ -318,18 +324,155 @@ static gint glspi_lines(lua_State* L)
 		return 1;
 	} else {
 		int idx;
-		gchar *text;
 		if (!lua_isnumber(L,1)) { return FAIL_NUMERIC_ARG(1); }
 		idx=lua_tonumber(L,1);
-		text=get_line_text(doc,idx);
-		if (text) {
-			lua_pushstring(L,text);
-			g_free(text);
-			return 1;
-		} else {
+		return push_line_text(L,doc,idx)?1:0;
+	}
+}
+
+
+
+/*
+	Lua "closure" function to iterate through the positions of the lines
+	in the current document, without copying their text.
+*/
+static gint spans_closure(lua_State *L)
+{
+	gint idx=lua_tonumber(L, lua_upvalueindex(1))+1;
+	gint last=lua_tonumber(L, lua_upvalueindex(2));
+	GeanyDocument *doc=lua_touserdata(L,lua_upvalueindex(3));
+	if ( (idx<=last) && (idx<=sci_get_line_count(doc->editor->sci)) ) {
+		push_number(L, idx);
+		lua_pushvalue(L, -1);
+		lua_replace(L, lua_upvalueindex(1));
+		push_number(L, sci_get_position_from_line(doc->editor->sci, idx-1));
+		push_number(L, sci_get_line_end_position(doc->editor->sci, idx-1));
+		return 3;
+	} else {
+		return 0;
+	}
+}
+
+
+
+/* Iterate through the start and end positions of a range of lines */
+static gint glspi_spans(lua_State* L)
+{
+	gint first=1;
+	gint last;
+	DOC_REQUIRED
+	last=sci_get_line_count(doc->editor->sci);
+	if (lua_gettop(L)>0) {
+		if (!lua_isnumber(L,1)) { return FAIL_NUMERIC_ARG(1); }
+		first=lua_tonumber(L,1);
+		if (first<1) { first=1; }
+	}
+	if (lua_gettop(L)>1) {
+		if (!lua_isnumber(L,2)) { return FAIL_NUMERIC_ARG(2); }
+		last=lua_tonumber(L,2);
+	}
+	push_number(L,first-1);
+	push_number(L,last);
+	lua_pushlightuserdata(L,doc); /* Pass the doc pointer to our iterator */
+	lua_pushcclosure(L, &spans_closure, 3);
+	return 1;
+}
+
+
+
+/* Get the text between two positions */
+static gint glspi_range(lua_State* L)
+{
+	gint start, stop, len;
+	DOC_REQUIRED
+	if (!lua_isnumber(L,1)) { return FAIL_NUMERIC_ARG(1); }
+	if (!lua_isnumber(L,2)) { return FAIL_NUMERIC_ARG(2); }
+	len=sci_get_length(doc->editor->sci);
+	start=CLAMP((gint)lua_tonumber(L,1), 0, len);
+	stop=CLAMP((gint)lua_tonumber(L,2), start, len);
+	lua_pushlstring(L, get_text_pointer(doc)+start, stop-start);
+	return 1;
+}
+
+
+
+typedef struct _TextRange {
+	gint start;
+	gint stop;
+	const gchar *text;
+	size_t len;
+} TextRange;
+
+
+static gint compare_ranges(gconstpointer a, gconstpointer b)
+{
+	return ((const TextRange*)b)->start - ((const TextRange*)a)->start;
+}
+
+
+/*
+	Replace several ranges of text in a single undoable step.
+	The ranges are applied from the end of the document, so
+	the positions of the others don't move.
+*/
+static gint glspi_replace(lua_State* L)
+{
+	GArray *ranges;
+	GdkWindow *window;
+	gint i, n, len;
+	DOC_REQUIRED
+	if (!lua_istable(L,1)) { return FAIL_TABLE_ARG(1); }
+
+	len=sci_get_length(doc->editor->sci);
+	n=lua_objlen(L,1);
+	ranges=g_array_sized_new(FALSE, FALSE, sizeof(TextRange), n);
+	for (i=1; i<=n; i++) {
+		TextRange r;
+		lua_rawgeti(L,1,i);
+		if (lua_istable(L,-1)) {
+			lua_rawgeti(L,-1,1);
+			lua_rawgeti(L,-2,2);
+			lua_rawgeti(L,-3,3);
+			if (lua_isnumber(L,-3) && lua_isnumber(L,-2) && lua_isstring(L,-1)) {
+				r.start=CLAMP((gint)lua_tonumber(L,-3), 0, len);
+				r.stop=CLAMP((gint)lua_tonumber(L,-2), r.start, len);
+				/* the string stays referenced by the table */
+				r.text=lua_tolstring(L,-1,&r.len);
+				g_array_append_val(ranges, r);
+				lua_pop(L, 4);
+				continue;
+			}
+		}
+		g_array_free(ranges, TRUE);
+		return glspi_fail_elem_type(L, __FUNCTION__, 1, i, "{start,stop,text}");
+	}
+
+	g_array_sort(ranges, compare_ranges);
+	for (i=1; i<(gint)ranges->len; i++) {
+		if (g_array_index(ranges, TextRange, i).stop > g_array_index(ranges, TextRange, i-1).start) {
+			g_array_free(ranges, TRUE);
+			lua_pushfstring(L, _("Error in module \"%s\" at function %s():\n"
+				" overlapping ranges in argument #%d\n"), LUA_MODULE_NAME, &__FUNCTION__[6], 1);
+			lua_error(L);
 			return 0;
 		}
 	}
+
+	window=gtk_widget_get_window(GTK_WIDGET(doc->editor->sci));
+	if (window) { gdk_window_freeze_updates(window); }
+	sci_start_undo_action(doc->editor->sci);
+	for (i=0; i<(gint)ranges->len; i++) {
+		TextRange *r=&g_array_index(ranges, TextRange, i);
+		scintilla_send_message(doc->editor->sci, SCI_SETTARGETSTART, r->start, 0);
+		scintilla_send_message(doc->editor->sci, SCI_SETTARGETEND, r->stop, 0);
+		scintilla_send_message(doc->editor->sci, SCI_REPLACETARGET, r->len, (sptr_t)r->text);
+	}
+	sci_end_undo_action(doc->editor->sci);
+	if (window) { gdk_window_thaw_updates(window); }
+
+	push_number(L, ranges->len);
+	g_array_free(ranges, TRUE);
+	return 1;
 }
 
 
@@ -853,6 +996,9 @@ static const struct luaL_reg glspi_sci_funcs[] = {
 	{"batch",     glspi_batch},
 	{"word",      glspi_word},
 	{"lines",     glspi_lines},
+	{"spans",     glspi_spans},
+	{"range",     glspi_range},
+	{"replace",   glspi_replace},
 	{"navigate",  glspi_navigate},
 	{"cut",       glspi_cut},
 	{"copy",      glspi_copy},
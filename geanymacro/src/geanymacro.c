@@ -19,6 +19,7 @@
 
 #include "utils.h"
 #include "Scintilla.h"
+#include "notifyprof.h"
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <string.h>
@@ -41,6 +42,14 @@ typedef struct
 	guint keyval;
 	guint state;
 	GSList *MacroEvents;
+	/* MacroEvents compiled into an array ready to replay: consecutive text inserts are merged and
+	 * search anchors added. Text is held in CompiledText */
+	MacroEvent *CompiledEvents;
+	gint NumCompiledEvents;
+	GStringChunk *CompiledText;
+	/* events as saved in macro file, not yet turned into MacroEvents (NULL once they have been) */
+	const gchar *SavedEvents;
+	gsize SavedEventsLength;
 } Macro;
 
 /* structure to hold details of Macro for macro editor */
@@ -159,6 +168,24 @@ const MacroDetailEntry MacroDetails[]={
 {0,NULL}
 };
 
+/* cursor movements: a run of the same one is recorded as one event, with the number of repeats in
+ * wparam (0 in macros from earlier versions meaning once) */
+static const gint RepeatableMessages[]={
+	SCI_LINESCROLLDOWN,SCI_LINESCROLLUP,
+	SCI_LINEDOWN,SCI_LINEUP,SCI_CHARLEFT,SCI_CHARRIGHT,SCI_WORDLEFT,SCI_WORDRIGHT,
+	SCI_WORDPARTLEFT,SCI_WORDPARTRIGHT,SCI_HOME,SCI_LINEEND,SCI_PAGEUP,SCI_PAGEDOWN,
+	SCI_HOMEDISPLAY,SCI_LINEENDDISPLAY,SCI_VCHOME,SCI_PARADOWN,SCI_PARAUP,SCI_WORDLEFTEND,
+	SCI_WORDRIGHTEND,
+	SCI_LINEDOWNEXTEND,SCI_LINEUPEXTEND,SCI_CHARLEFTEXTEND,SCI_CHARRIGHTEXTEND,SCI_WORDLEFTEXTEND,
+	SCI_WORDRIGHTEXTEND,SCI_WORDPARTLEFTEXTEND,SCI_WORDPARTRIGHTEXTEND,SCI_HOMEEXTEND,
+	SCI_LINEENDEXTEND,SCI_PAGEUPEXTEND,SCI_PAGEDOWNEXTEND,SCI_HOMEDISPLAYEXTEND,
+	SCI_LINEENDDISPLAYEXTEND,SCI_VCHOMEEXTEND,SCI_PARADOWNEXTEND,SCI_PARAUPEXTEND,
+	SCI_WORDLEFTENDEXTEND,SCI_WORDRIGHTENDEXTEND,
+	SCI_LINEDOWNRECTEXTEND,SCI_LINEUPRECTEXTEND,SCI_CHARLEFTRECTEXTEND,SCI_CHARRIGHTRECTEXTEND,
+	SCI_HOMERECTEXTEND,SCI_LINEENDRECTEXTEND,SCI_PAGEUPRECTEXTEND,SCI_PAGEDOWNRECTEXTEND,
+	SCI_VCHOMERECTEXTEND
+};
+
 /* define IDs for dialog buttons */
 enum GEANY_MACRO_BUTTON {
 	GEANY_MACRO_BUTTON_CANCEL,
@@ -169,7 +196,8 @@ enum GEANY_MACRO_BUTTON {
 	GEANY_MACRO_BUTTON_DOWN,
 	GEANY_MACRO_BUTTON_ABOVE,
 	GEANY_MACRO_BUTTON_BELOW,
-	GEANY_MACRO_BUTTON_APPLY
+	GEANY_MACRO_BUTTON_APPLY,
+	GEANY_MACRO_BUTTON_REPEAT
 };
 
 GeanyPlugin     *geany_plugin;
@@ -192,8 +220,23 @@ static GtkWidget *Record_Macro_menu_item=NULL;
 static GtkWidget *Stop_Record_Macro_menu_item=NULL;
 static GtkWidget *Edit_Macro_menu_item=NULL;
 static Macro *RecordingMacro=NULL;
+/* text typed since the last SCI_REPLACESEL event recorded began, NULL if the last event isn't one */
+static GString *RecordingText=NULL;
+/* message -> index in MacroDetails + 1, with repeatable messages marked by MACRO_DETAIL_REPEATABLE */
+static GHashTable *MacroDetailsIndex=NULL;
 static GSList *mList=NULL;
 static gboolean bMacrosHaveChanged=FALSE;
+/* contents of macro file, macros that have not been used yet point into it */
+static gchar *pcMacroFileData=NULL;
+
+/* macro file: header, then for each macro its key trigger, name and events. Numbers are 32 bit
+ * little endian, strings are a length followed by the text (no terminating NUL). Each event is
+ * message, wparam and text, where text length is 0 for no text or the length + 1
+*/
+#define MACRO_DETAIL_REPEATABLE 0x10000
+
+#define MACRO_FILE_MAGIC "GMAC"
+#define MACRO_FILE_VERSION 1
 
 /* default config file */
 const gchar default_config[] =
@@ -202,6 +245,47 @@ const gchar default_config[] =
 	"Question_Macro_Overwrite = true\n"
 	"[Macros]";
 
+/* look up message in the table of messages this plugin can handle, built when first needed.
+ * Returns NULL if it can't be handled, and sets bRepeatable if not NULL */
+static const MacroDetailEntry * GetMacroDetail(gint message,gboolean *bRepeatable)
+{
+	gint i,value;
+
+	if(MacroDetailsIndex==NULL)
+	{
+		MacroDetailsIndex=g_hash_table_new(g_direct_hash,g_direct_equal);
+		for(i=0;MacroDetails[i].description!=NULL;i++)
+			g_hash_table_insert(MacroDetailsIndex,GINT_TO_POINTER(MacroDetails[i].message),
+			                    GINT_TO_POINTER(i+1));
+		for(i=0;i<(gint)G_N_ELEMENTS(RepeatableMessages);i++)
+		{
+			value=GPOINTER_TO_INT(g_hash_table_lookup(MacroDetailsIndex,
+			                                          GINT_TO_POINTER(RepeatableMessages[i])));
+			g_hash_table_insert(MacroDetailsIndex,GINT_TO_POINTER(RepeatableMessages[i]),
+			                    GINT_TO_POINTER(value|MACRO_DETAIL_REPEATABLE));
+		}
+	}
+
+	value=GPOINTER_TO_INT(g_hash_table_lookup(MacroDetailsIndex,GINT_TO_POINTER(message)));
+	if(bRepeatable!=NULL)
+		*bRepeatable=(value&MACRO_DETAIL_REPEATABLE)!=0;
+	value&=~MACRO_DETAIL_REPEATABLE;
+
+	return (value==0)?NULL:&(MacroDetails[value-1]);
+}
+
+
+/* number of times event is to be repeated */
+static gulong GetMacroEventRepeats(const MacroEvent *me)
+{
+	gboolean bRepeatable;
+
+	GetMacroDetail(me->message,&bRepeatable);
+
+	return (bRepeatable && me->wparam>1)?me->wparam:1;
+}
+
+
 /* clear macro events list and free up any memory they are using */
 static GSList * ClearMacroList(GSList *gsl)
 {
@@ -241,26 +325,205 @@ static Macro * CreateMacro(void)
 	{
 		m->name=NULL;
 		m->MacroEvents=NULL;
+		m->CompiledEvents=NULL;
+		m->NumCompiledEvents=0;
+		m->CompiledText=NULL;
+		m->SavedEvents=NULL;
+		m->SavedEventsLength=0;
 		return m;
 	}
 	return NULL;
 }
 
 
+/* free compiled version of macro */
+static void FreeCompiledMacro(Macro *m)
+{
+	g_free(m->CompiledEvents);
+	m->CompiledEvents=NULL;
+	m->NumCompiledEvents=0;
+
+	if(m->CompiledText!=NULL)
+		g_string_chunk_free(m->CompiledText);
+	m->CompiledText=NULL;
+}
+
+
 /* delete macro */
 static Macro * FreeMacro(Macro *m)
 {
 	if(m==NULL)
 		return NULL;
 
+	/* the text being gathered belongs to the macro being recorded */
+	if(m==RecordingMacro && RecordingText!=NULL)
+	{
+		g_string_free(RecordingText,TRUE);
+		RecordingText=NULL;
+	}
+
 	g_free(m->name);
 	ClearMacroList(m->MacroEvents);
+	FreeCompiledMacro(m);
 	g_free(m);
 
 	return NULL;
 }
 
 
+/* add event to compiled macro array, with copy of any text it holds */
+static void AddCompiledEvent(Macro *m,GArray *ga,gint message,gulong wparam,const gchar *text)
+{
+	MacroEvent me;
+
+	me.message=message;
+	me.wparam=wparam;
+	me.lparam=(text==NULL)?0:(glong)g_string_chunk_insert(m->CompiledText,text);
+
+	g_array_append_val(ga,me);
+}
+
+
+/* turn list of macro events into array to replay. Consecutive SCI_REPLACESEL events are merged
+ * into one (replacing the selection and then inserting at the caret is the same as replacing the
+ * selection with the joined text), and a SCI_SEARCHANCHOR is added before the first search if
+ * the user edited macro doesn't have one, so that replay doesn't have to check for it. Other
+ * events get the number of times they are sent in wparam
+*/
+static void CompileMacro(Macro *m)
+{
+	GArray *ga;
+	GString *gsText;
+	GSList *gsl;
+	MacroEvent *me;
+	gboolean bFoundAnchor=FALSE;
+	gboolean bHaveText=FALSE;
+
+	FreeCompiledMacro(m);
+
+	ga=g_array_new(FALSE,FALSE,sizeof(MacroEvent));
+	m->CompiledText=g_string_chunk_new(256);
+	gsText=g_string_new(NULL);
+
+	for(gsl=m->MacroEvents;gsl!=NULL;gsl=g_slist_next(gsl))
+	{
+		me=gsl->data;
+
+		/* gather text inserts */
+		if(me->message==SCI_REPLACESEL)
+		{
+			g_string_append(gsText,(gchar*)(me->lparam));
+			bHaveText=TRUE;
+			continue;
+		}
+
+		/* end of run of text inserts: add them as one */
+		if(bHaveText)
+		{
+			AddCompiledEvent(m,ga,SCI_REPLACESEL,0,gsText->str);
+			g_string_truncate(gsText,0);
+			bHaveText=FALSE;
+		}
+
+		if(me->message==SCI_SEARCHANCHOR)
+			bFoundAnchor=TRUE;
+
+		if(me->message==SCI_SEARCHNEXT || me->message==SCI_SEARCHPREV)
+		{
+			/* possibility that user edited macros might not have anchor before search */
+			if(bFoundAnchor==FALSE)
+			{
+				AddCompiledEvent(m,ga,SCI_SEARCHANCHOR,1,NULL);
+				bFoundAnchor=TRUE;
+			}
+
+			/* NULL text means search for clipboard contents */
+			AddCompiledEvent(m,ga,me->message,me->wparam,(gchar*)(me->lparam));
+		}
+		else
+			/* wparam is unused by other messages: holds the number of repeats */
+			AddCompiledEvent(m,ga,me->message,GetMacroEventRepeats(me),NULL);
+	}
+
+	if(bHaveText)
+		AddCompiledEvent(m,ga,SCI_REPLACESEL,0,gsText->str);
+
+	g_string_free(gsText,TRUE);
+
+	m->NumCompiledEvents=ga->len;
+	m->CompiledEvents=(MacroEvent*)g_array_free(ga,FALSE);
+}
+
+
+/* read 32 bit number from macro file data, moving pointer past it. Returns FALSE if past end */
+static gboolean ReadMacroFileNumber(const gchar **p,const gchar *pEnd,guint32 *value)
+{
+	guint32 v;
+
+	if(pEnd-(*p)<4)
+		return FALSE;
+
+	memcpy(&v,*p,4);
+	*value=GUINT32_FROM_LE(v);
+	(*p)+=4;
+
+	return TRUE;
+}
+
+
+/* write 32 bit number to macro file data */
+static void WriteMacroFileNumber(GString *gs,guint32 value)
+{
+	guint32 v=GUINT32_TO_LE(value);
+
+	g_string_append_len(gs,(const gchar*)&v,4);
+}
+
+
+/* turn events saved in macro file into MacroEvents, if not already done */
+static void EnsureMacroEvents(Macro *m)
+{
+	const gchar *p=m->SavedEvents;
+	const gchar *pEnd;
+	MacroEvent *me;
+	guint32 message,wparam,length;
+
+	if(p==NULL)
+		return;
+
+	pEnd=p+m->SavedEventsLength;
+
+	m->SavedEvents=NULL;
+	m->SavedEventsLength=0;
+
+	while(p<pEnd)
+	{
+		if(!ReadMacroFileNumber(&p,pEnd,&message) ||
+		   !ReadMacroFileNumber(&p,pEnd,&wparam) ||
+		   !ReadMacroFileNumber(&p,pEnd,&length) ||
+		   (length>0 && (guint32)(pEnd-p)<length-1))
+			break;
+
+		me=g_new0(MacroEvent,1);
+		me->message=(gint)message;
+		me->wparam=wparam;
+		/* search text may be NULL (use clipboard) */
+		if(length>0)
+		{
+			me->lparam=(glong)g_strndup(p,length-1);
+			p+=length-1;
+		}
+		else if(me->message==SCI_REPLACESEL)
+			me->lparam=(glong)g_strdup("");
+
+		/* more efficient to create reverse list and reverse it at the end */
+		m->MacroEvents=g_slist_prepend(m->MacroEvents,me);
+	}
+
+	m->MacroEvents=g_slist_reverse(m->MacroEvents);
+}
+
+
 /* add a macro to the list of defined macros */
 static void AddMacroToList(Macro *m)
 {
@@ -330,84 +593,79 @@ static void ClearAllMacros(void)
 }
 
 
-/* Repeat a macro to the editor */
-static void ReplayMacro(Macro *m)
+/* Repeat a macro to the editor iRepeat times. The editor window is not redrawn until all the
+ * repeats are done, and everything can be undone in one go. When repeating more than once, the
+ * repeats stop at the first search that finds nothing
+*/
+static void ReplayMacro(Macro *m,gint iRepeat)
 {
-	MacroEvent *me;
-	GSList *gsl=m->MacroEvents;
+	MacroEvent *me,*meEnd;
 	ScintillaObject* sci=document_get_current()->editor->sci;
+	GdkWindow *window;
 	gchar *clipboardcontents;
-	gboolean bFoundAnchor=FALSE;
-
-	scintilla_send_message(sci,SCI_BEGINUNDOACTION,0,0);
+	glong lResult;
+	gulong j;
+	gint i;
 
-	while(gsl!=NULL)
+	if(m->CompiledEvents==NULL)
 	{
-		me=gsl->data;
+		EnsureMacroEvents(m);
+		CompileMacro(m);
+	}
 
-		/* make not if anchor has been found */
-		if(me->message==SCI_SEARCHANCHOR)
-			bFoundAnchor=TRUE;
+	window=gtk_widget_get_window(GTK_WIDGET(sci));
+	if(window!=NULL)
+		gdk_window_freeze_updates(window);
 
-		/* possibility that user edited macros might not have anchor before search */
-		if((me->message==SCI_SEARCHNEXT || me->message==SCI_SEARCHPREV) &&
-		   bFoundAnchor==FALSE)
-		{
-			scintilla_send_message(sci,SCI_SEARCHANCHOR,0,0);
-			bFoundAnchor=TRUE;
-		}
+	scintilla_send_message(sci,SCI_BEGINUNDOACTION,0,0);
 
-		/* search might use clipboard to look for: check & hanndle */
-		if((me->message==SCI_SEARCHNEXT || me->message==SCI_SEARCHPREV) &&
-		   ((gchar*)me->lparam)==NULL)
+	meEnd=m->CompiledEvents+m->NumCompiledEvents;
+	for(i=0;i<iRepeat;i++)
+	{
+		for(me=m->CompiledEvents;me<meEnd;me++)
 		{
-			clipboardcontents=gtk_clipboard_wait_for_text(gtk_clipboard_get(
-			                  GDK_SELECTION_CLIPBOARD));
-			/* ensure there is something in the clipboard */
-			if(clipboardcontents==NULL)
+			switch(me->message)
 			{
-				dialogs_show_msgbox(GTK_MESSAGE_INFO,_("No text in clipboard!"));
-				break;
+				case SCI_SEARCHNEXT:
+				case SCI_SEARCHPREV:
+					/* search might use clipboard to look for: check & hanndle */
+					if(((gchar*)me->lparam)==NULL)
+					{
+						clipboardcontents=gtk_clipboard_wait_for_text(gtk_clipboard_get(
+						                  GDK_SELECTION_CLIPBOARD));
+						/* ensure there is something in the clipboard */
+						if(clipboardcontents==NULL)
+						{
+							dialogs_show_msgbox(GTK_MESSAGE_INFO,_("No text in clipboard!"));
+							goto done;
+						}
+
+						lResult=scintilla_send_message(sci,me->message,me->wparam,
+						                               (glong)clipboardcontents);
+						g_free(clipboardcontents);
+					}
+					else
+						lResult=scintilla_send_message(sci,me->message,me->wparam,me->lparam);
+
+					if(lResult==-1 && iRepeat>1)
+						goto done;
+					break;
+				case SCI_REPLACESEL:
+					scintilla_send_message(sci,me->message,0,me->lparam);
+					break;
+				default:
+					for(j=me->wparam;j>0;j--)
+						scintilla_send_message(sci,me->message,0,0);
+					break;
 			}
-
-			scintilla_send_message(sci,me->message,me->wparam,(glong)clipboardcontents);
 		}
-		else
-			scintilla_send_message(sci,me->message,me->wparam,me->lparam);
-
-		/* move to next macro event */
-		gsl=g_slist_next(gsl);
 	}
 
+done:
 	scintilla_send_message(sci,SCI_ENDUNDOACTION,0,0);
-}
-
 
-/* convert string so that it can be saved as text in a comma separated text entry in an ini file
- * resultant string needs to be freed after use
-*/
-static gchar * MakeStringSaveable(gchar *s)
-{
-	gchar *cTemp;
-	gchar **pszBits;
-
-	/* use GLib routine to do most of the work
-	 * (sort out all special characters, and non-ASCII characters)
-	*/
-	cTemp=g_strescape(s,"");
-	/* now make sure that all instances of ',' are replaced by octal version so that can use ',' as
-	 * a separator
-	 * first break the string up at the commas
-	*/
-	pszBits=g_strsplit(cTemp,",",0);
-	/* can now free up cTemp */
-	g_free(cTemp);
-	/* now combine bits together with octal verion of comma in-between */
-	cTemp=g_strjoinv("\\054",pszBits);
-	/* free up memory used by bits */
-	g_strfreev(pszBits);
-
-	return cTemp;
+	if(window!=NULL)
+		gdk_window_thaw_updates(window);
 }
 
 
@@ -457,71 +715,34 @@ static MacroEvent * GetMacroEventFromString(gchar **s,gint *k)
 }
 
 
-/* convert a Macro event to a string that can be savable in a comma separated ini file entry
- * resultant string needs to be freed afterwards
-*/
-static gchar *MacroEventToString(MacroEvent *me)
+/* Is there a document open in the editor */
+static gboolean DocumentPresent(void)
 {
-	gchar *szMacroNumber;
-	gchar *szNumberAndData;
-	gchar *pTemp;
-
-	/* save off macro code */
-	szMacroNumber=g_strdup_printf("%i",me->message);
-
-	/* now handle lparam if required */
-	switch(me->message)
-	{
-		case SCI_SEARCHNEXT:
-		case SCI_SEARCHPREV:
-			/* check if string is NULL */
-			if(((gchar*)(me->lparam))==NULL)
-			{
-				/* now merge code and data */
-				szNumberAndData=g_strdup_printf("%s,,%lu",szMacroNumber,me->wparam);
-				/* free memory */
-				g_free(szMacroNumber);
-				return szNumberAndData;
-			}
-
-			/* first get string reprisentation of data */
-			pTemp=MakeStringSaveable((gchar*)(me->lparam));
-			/* now merge code and data */
-			szNumberAndData=g_strdup_printf("%s,%s,%lu",szMacroNumber,pTemp,me->wparam);
-			/* free memory */
-			g_free(szMacroNumber);
-			g_free(pTemp);
-			return szNumberAndData;
-
-		case SCI_REPLACESEL:
-			/* first get string reprisentation of data */
-			pTemp=MakeStringSaveable((gchar*)(me->lparam));
-			/* now merge code and data */
-			szNumberAndData=g_strdup_printf("%s,%s",szMacroNumber,pTemp);
-			/* free memory */
-			g_free(szMacroNumber);
-			g_free(pTemp);
-			return szNumberAndData;
-
-		/* default handler for messages without extra data */
-		default:
-			return szMacroNumber;
-	}
+  return (document_get_current()!=NULL);
 }
 
 
-/* Is there a document open in the editor */
-static gboolean DocumentPresent(void)
+/* end the SCI_REPLACESEL event being recorded: give it the text typed */
+static void FlushRecordingText(void)
 {
-  return (document_get_current()!=NULL);
+	MacroEvent *me;
+
+	if(RecordingText==NULL)
+		return;
+
+	me=RecordingMacro->MacroEvents->data;
+	me->lparam=(glong)g_string_free(RecordingText,FALSE);
+	RecordingText=NULL;
 }
 
 
-/* check editor notifications and remember editor events */
+/* check editor notifications and remember editor events. Consecutive typed characters are gathered
+ * into one SCI_REPLACESEL event and runs of the same cursor movement into one counted event
+*/
 static gboolean Notification_Handler(GObject *obj,GeanyEditor *ed,SCNotification *nt,gpointer ud)
 {
 	MacroEvent *me;
-	gint i;
+	gboolean bRepeatable;
 
 	/* ignore non macro recording messages */
 	if(nt->nmhdr.code!=SCN_MACRORECORD)
@@ -534,29 +755,39 @@ static gboolean Notification_Handler(GObject *obj,GeanyEditor *ed,SCNotification
 		return FALSE;
 
 	/* check to see if it's a code we're happy to deal with */
-	for(i=0;;i++)
+	if(GetMacroDetail(nt->message,&bRepeatable)==NULL)
 	{
-		/* break if code we can deal with */
-		if(nt->message==MacroDetails[i].message)
-			break;
+		dialogs_show_msgbox(GTK_MESSAGE_INFO,_("Unrecognised message\n%i %i %i"),nt->message,
+		                    (gint)(nt->wParam),(gint)(nt->lParam));
+		return FALSE;
+	}
 
-		/* got to end of codes without match: unrecognised */
-		if(MacroDetails[i].description==NULL)
-		{
-			dialogs_show_msgbox(GTK_MESSAGE_INFO,_("Unrecognised message\n%i %i %i"),nt->message,
-			                    (gint)(nt->wParam),(gint)(nt->lParam));
-			return FALSE;
-		}
+	/* more typed text */
+	if(nt->message==SCI_REPLACESEL && RecordingText!=NULL)
+	{
+		g_string_append(RecordingText,(gchar *)(nt->lParam));
+		return FALSE;
+	}
+	FlushRecordingText();
 
+	/* same cursor movement again */
+	me=(RecordingMacro->MacroEvents==NULL)?NULL:RecordingMacro->MacroEvents->data;
+	if(bRepeatable && me!=NULL && me->message==nt->message)
+	{
+		me->wparam++;
+		return FALSE;
 	}
+
 	me=g_new0(MacroEvent,1);
 	me->message=nt->message;
-	me->wparam=nt->wParam;
-	/* Special handling for text in lparam */
-	me->lparam=(me->message==SCI_SEARCHNEXT ||
-	            me->message==SCI_SEARCHPREV ||
-	            me->message==SCI_REPLACESEL)
-		?((glong) g_strdup((gchar *)(nt->lParam))) : nt->lParam;
+	me->wparam=bRepeatable?1:nt->wParam;
+	/* Special handling for text in lparam: typed text is gathered until the next other event */
+	if(me->message==SCI_REPLACESEL)
+		RecordingText=g_string_new((gchar *)(nt->lParam));
+	else if(me->message==SCI_SEARCHNEXT || me->message==SCI_SEARCHPREV)
+		me->lparam=(glong) g_strdup((gchar *)(nt->lParam));
+	else
+		me->lparam=nt->lParam;
 
 	/* more efficient to create reverse list and reverse it at the end */
 	RecordingMacro->MacroEvents=g_slist_prepend(RecordingMacro->MacroEvents,me);
@@ -606,19 +837,81 @@ static gchar *GetPretyKeyName(guint keyval,guint state)
 }
 
 
+/* add events of a macro to macro file data */
+static void WriteMacroEvents(GString *gs,Macro *m)
+{
+	GSList *gsl;
+	MacroEvent *me;
+	gsize length;
+
+	/* macro not used since loaded: events are still in macro file format */
+	if(m->SavedEvents!=NULL)
+	{
+		g_string_append_len(gs,m->SavedEvents,m->SavedEventsLength);
+		return;
+	}
+
+	for(gsl=m->MacroEvents;gsl!=NULL;gsl=g_slist_next(gsl))
+	{
+		me=gsl->data;
+		WriteMacroFileNumber(gs,me->message);
+		WriteMacroFileNumber(gs,me->wparam);
+
+		if((me->message==SCI_REPLACESEL || me->message==SCI_SEARCHNEXT ||
+		    me->message==SCI_SEARCHPREV) && ((gchar*)(me->lparam))!=NULL)
+		{
+			length=strlen((gchar*)(me->lparam));
+			WriteMacroFileNumber(gs,length+1);
+			g_string_append_len(gs,(gchar*)(me->lparam),length);
+		}
+		else
+			WriteMacroFileNumber(gs,0);
+	}
+}
+
+
+/* save macros to macro file */
+static void SaveMacroFile(const gchar *filename)
+{
+	GString *gs;
+	GSList *gsl;
+	Macro *m;
+	gsize start;
+	guint32 length;
+
+	gs=g_string_new(MACRO_FILE_MAGIC);
+	WriteMacroFileNumber(gs,MACRO_FILE_VERSION);
+	WriteMacroFileNumber(gs,(bSaveMacros==TRUE)?g_slist_length(mList):0);
+
+	for(gsl=(bSaveMacros==TRUE)?mList:NULL;gsl!=NULL;gsl=g_slist_next(gsl))
+	{
+		m=(Macro*)(gsl->data);
+
+		/* save trigger data and name */
+		WriteMacroFileNumber(gs,m->keyval);
+		WriteMacroFileNumber(gs,m->state);
+		WriteMacroFileNumber(gs,strlen(m->name));
+		g_string_append(gs,m->name);
+
+		/* save events, preceded by their length so they can be skipped when loading */
+		start=gs->len;
+		WriteMacroFileNumber(gs,0);
+		WriteMacroEvents(gs,m);
+		length=GUINT32_TO_LE(gs->len-start-4);
+		memcpy(gs->str+start,&length,4);
+	}
+
+	g_file_set_contents(filename,gs->str,gs->len,NULL);
+	g_string_free(gs,TRUE);
+}
+
+
 /* save settings (preferences, and macro data) */
 static void SaveSettings(void)
 {
 	GKeyFile *config = NULL;
 	gchar *config_file = NULL;
 	gchar *data;
-	gchar *cKey;
-	gchar *pcTemp;
-	gint i,k;
-	GSList *gsl=mList;
-	GSList *gslTemp;
-	gchar **pszMacroStrings;
-	Macro *m;
 
 	/* create new config from default settings */
 	config=g_key_file_new();
@@ -627,57 +920,6 @@ static void SaveSettings(void)
 	g_key_file_set_boolean(config,"Settings","Save_Macros",bSaveMacros);
 	g_key_file_set_boolean(config,"Settings","Question_Macro_Overwrite",bQueryOverwriteMacros);
 
-	/* now save macros */
-	if(bSaveMacros==TRUE)
-	{
-		i=0;
-
-		/* iterate through macros and save them */
-		while(gsl!=NULL)
-		{
-			m=(Macro*)(gsl->data);
-			cKey=g_strdup_printf("A%d",i);
-
-			/* save macro name */
-			pcTemp=MakeStringSaveable(m->name);
-			g_key_file_set_string(config,"Macros",cKey,pcTemp);
-			g_free(pcTemp);
-			/* save trigger data */
-			cKey[0]='B';
-			g_key_file_set_integer(config,"Macros",cKey,m->keyval);
-			cKey[0]='C';
-			g_key_file_set_integer(config,"Macros",cKey,m->state);
-			/* convert macros to saveable format
-			* first generate list of all macrodetails
-			*/
-			pszMacroStrings=(gchar **)
-				(g_malloc(sizeof(gchar *)*(g_slist_length(m->MacroEvents)+1)));
-			gslTemp=m->MacroEvents;
-			k=0;
-			while(gslTemp!=NULL)
-			{
-				pszMacroStrings[k++]=MacroEventToString((MacroEvent*)(gslTemp->data));
-				gslTemp=g_slist_next(gslTemp);
-			}
-
-			/* null terminate array for g_strfreev to work */
-			pszMacroStrings[k]=NULL;
-			/* now transfer to single string */
-			pcTemp=g_strjoinv(",",pszMacroStrings);
-			/* save data */
-			cKey[0]='D';
-			g_key_file_set_string(config,"Macros",cKey,pcTemp);
-			/* free up memory */
-			g_free(pcTemp);
-			g_strfreev(pszMacroStrings);
-			g_free(cKey);
-
-			/* move to next macro */
-			i++;
-			gsl=g_slist_next(gsl);
-		}
-	}
-
 	/* turn config into data */
 	data=g_key_file_to_data(config,NULL,NULL);
 
@@ -686,8 +928,14 @@ static void SaveSettings(void)
 	/* ensure directory exists */
 	g_mkdir_with_parents(config_file,0755);
 
+	/* now save macros (none if they are not to be saved) */
+	setptr(config_file,g_build_filename(geany->app->configdir,"plugins","Geany_Macros",
+	                                    "macros.dat",NULL));
+	SaveMacroFile(config_file);
+
 	/* make config_file hold name of settings file */
-	setptr(config_file,g_build_filename(config_file,"settings.conf",NULL));
+	setptr(config_file,g_build_filename(geany->app->configdir,"plugins","Geany_Macros",
+	                                    "settings.conf",NULL));
 
 	/* write data */
 	utils_write_file(config_file, data);
@@ -702,6 +950,70 @@ static void SaveSettings(void)
 }
 
 
+/* load macros from macro file. Only the names and key triggers are read, the events are turned
+ * into MacroEvents when the macro is first used. Returns FALSE if there is no valid macro file
+*/
+static gboolean LoadMacroFile(const gchar *filename)
+{
+	const gchar *p,*pEnd;
+	gsize length;
+	guint32 version,count,keyval,state,nameLength,eventsLength,i;
+	Macro *m;
+
+	if(!g_file_get_contents(filename,&pcMacroFileData,&length,NULL))
+		return FALSE;
+
+	p=pcMacroFileData;
+	pEnd=p+length;
+
+	/* check header */
+	if(length<4 || memcmp(p,MACRO_FILE_MAGIC,4)!=0)
+	{
+		g_free(pcMacroFileData);
+		pcMacroFileData=NULL;
+		return FALSE;
+	}
+	p+=4;
+
+	if(!ReadMacroFileNumber(&p,pEnd,&version) || version!=MACRO_FILE_VERSION ||
+	   !ReadMacroFileNumber(&p,pEnd,&count))
+	{
+		g_free(pcMacroFileData);
+		pcMacroFileData=NULL;
+		return FALSE;
+	}
+
+	/* read macros, keeping those before any damaged one */
+	for(i=0;i<count;i++)
+	{
+		if(!ReadMacroFileNumber(&p,pEnd,&keyval) || !ReadMacroFileNumber(&p,pEnd,&state) ||
+		   !ReadMacroFileNumber(&p,pEnd,&nameLength) || (guint32)(pEnd-p)<nameLength)
+			break;
+
+		m=CreateMacro();
+		m->name=g_strndup(p,nameLength);
+		p+=nameLength;
+		m->keyval=keyval;
+		m->state=state;
+
+		if(!ReadMacroFileNumber(&p,pEnd,&eventsLength) || (guint32)(pEnd-p)<eventsLength)
+		{
+			FreeMacro(m);
+			break;
+		}
+
+		/* events are read when needed */
+		m->SavedEvents=p;
+		m->SavedEventsLength=eventsLength;
+		p+=eventsLength;
+
+		AddMacroToList(m);
+	}
+
+	return TRUE;
+}
+
+
 /* load settings (preferences, file data, and macro data) */
 static void LoadSettings(void)
 {
@@ -712,6 +1024,7 @@ static void LoadSettings(void)
 	GKeyFile *config=NULL;
 	Macro *m;
 	gchar **pcMacroCommands;
+	gboolean bOldFormat;
 
 	/* Make config_file hold directory name of settings file */
 	config_file=g_build_filename(geany->app->configdir,"plugins","Geany_Macros",NULL);
@@ -732,9 +1045,15 @@ static void LoadSettings(void)
 	                                                "Question_Macro_Overwrite",FALSE);
 	bSaveMacros=utils_get_setting_boolean(config,"Settings","Save_Macros",FALSE);
 
+	/* load macros from macro file, or if there isn't one from settings file as saved by earlier
+	 * versions of this plugin */
+	setptr(config_file,g_build_filename(geany->app->configdir,"plugins","Geany_Macros",
+	                                    "macros.dat",NULL));
+	bOldFormat=!LoadMacroFile(config_file);
+
 	/* extract macros */
 	i=0;
-	while(TRUE)
+	while(bOldFormat)
 	{
 		pcKey=g_strdup_printf("A%d",i);
 		i++;
@@ -928,7 +1247,7 @@ static gboolean Key_Released_CallBack(GtkWidget *widget, GdkEventKey *ev, gpoint
 	/* if it's a macro trigger then run macro */
 	if(m!=NULL)
 	{
-		ReplayMacro(m);
+		ReplayMacro(m,1);
 /* ?is this needed */
 /*    g_signal_stop_emission_by_name((GObject *)widget,"key-release-event"); */
 		return TRUE;
@@ -1193,8 +1512,10 @@ static void StartRecordingMacro(void)
 static void StopRecordingMacro(void)
 {
 	scintilla_send_message(document_get_current()->editor->sci,SCI_STOPRECORD,0,0);
+	FlushRecordingText();
 	/* Recorded in reverse as more efficient */
 	RecordingMacro->MacroEvents=g_slist_reverse(RecordingMacro->MacroEvents);
+	CompileMacro(RecordingMacro);
 	/* add macro to list */
 	AddMacroToList(RecordingMacro);
 	/* set ready to record new macro (don't free as macro has been saved in macrolist) */
@@ -1215,9 +1536,12 @@ static void on_document_close(GObject *obj, GeanyDocument *doc, gpointer user_da
 }
 
 
+GP_NOTIFY_PROFILE_EDITOR_HANDLER(Notification_Handler_Profiled, Notification_Handler)
+
+
 PluginCallback plugin_callbacks[] =
 {
-	{ "editor-notify", (GCallback) &Notification_Handler, FALSE, NULL },
+	{ "editor-notify", (GCallback) &Notification_Handler_Profiled, FALSE, NULL },
 	{ "document-close", (GCallback) &on_document_close, FALSE, NULL },
 	{ NULL, NULL, FALSE, NULL }
 };
@@ -1724,12 +2048,13 @@ static void EditMacroElements(Macro *m)
 	GtkListStore *ls;
 	GtkTreePath *gtkPath;
 	gint i;
+	gulong ulRepeats;
 	GSList *gsl=m->MacroEvents;
 	gchar *cTitle,*cTemp,*cTemp2;
 	MacroEvent *me;
 	GtkListStore *lsCombo;
 	MacroDetailEntry *mde;
-	gboolean bHaveIter;
+	gboolean bHaveIter,bRepeatable;
 
 	/* create dialog box */
 	cTitle=g_strdup_printf(_("Edit: %s"),m->name);
@@ -1743,37 +2068,37 @@ static void EditMacroElements(Macro *m)
 	while(gsl!=NULL)
 	{
  		me=(MacroEvent*)(gsl->data);
-		i=0;
-		while(MacroDetails[i].description!=NULL)
-		{
-			if(MacroDetails[i].message==me->message) break;
-			i++;
-		}
+		mde=(MacroDetailEntry *)GetMacroDetail(me->message,NULL);
+		gsl=g_slist_next(gsl);
+		if(mde==NULL)
+			continue;
 
-		gtk_list_store_append(ls,&iter);  /*  Acquire an iterator */
-		/* set text, pointer to macro detail, and any ascociated string */
-		cTemp2=NULL;
-		if(me->message==SCI_REPLACESEL)
+		/* a run of cursor movements is shown as the lines it was recorded from */
+		for(ulRepeats=GetMacroEventRepeats(me);ulRepeats>0;ulRepeats--)
 		{
-			cTemp=g_strdup_printf(_("Insert/replace with \"%s\""),
-			                      (gchar*)(me->lparam));
-			cTemp2=g_strdup((gchar*)(me->lparam));
-		}
-		else if(MacroDetails[i].message==SCI_SEARCHNEXT ||
-		        MacroDetails[i].message==SCI_SEARCHPREV)
-		{
-			cTemp=GetSearchDescription(MacroDetails[i].message,(gchar*)(me->lparam),
-			                           me->wparam);
-			cTemp2=g_strdup_printf("%lu,%s",me->wparam,((gchar*)(me->lparam)==NULL)?
-			                       "":((gchar*)(me->lparam)));
-		}
-		else
-			cTemp=g_strdup(_(MacroDetails[i].description));
+			gtk_list_store_append(ls,&iter);  /*  Acquire an iterator */
+			/* set text, pointer to macro detail, and any ascociated string */
+			cTemp2=NULL;
+			if(me->message==SCI_REPLACESEL)
+			{
+				cTemp=g_strdup_printf(_("Insert/replace with \"%s\""),
+				                      (gchar*)(me->lparam));
+				cTemp2=g_strdup((gchar*)(me->lparam));
+			}
+			else if(mde->message==SCI_SEARCHNEXT || mde->message==SCI_SEARCHPREV)
+			{
+				cTemp=GetSearchDescription(mde->message,(gchar*)(me->lparam),me->wparam);
+				cTemp2=g_strdup_printf("%lu,%s",me->wparam,((gchar*)(me->lparam)==NULL)?
+				                       "":((gchar*)(me->lparam)));
+			}
+			else
+				cTemp=g_strdup(_(mde->description));
 
-		gtk_list_store_set(ls,&iter,0,cTemp,2,&(MacroDetails[i]),3,cTemp2,-1);
-		gsl=g_slist_next(gsl);
+			gtk_list_store_set(ls,&iter,0,cTemp,2,mde,3,cTemp2,-1);
+
+			g_free(cTemp);
+		}
 
-		g_free(cTemp);
 	}
 
 	/* create list store for combo renderer */
@@ -1962,12 +2287,22 @@ static void EditMacroElements(Macro *m)
 				/* get Macro event for this line */
 				gtk_tree_model_get(GTK_TREE_MODEL(ls),&iter,2,&mde,3,&cTemp,-1);
 
+				/* same cursor movement as the line before: count it */
+				me=(m->MacroEvents==NULL)?NULL:m->MacroEvents->data;
+				GetMacroDetail(mde->message,&bRepeatable);
+				if(bRepeatable && me!=NULL && me->message==mde->message)
+				{
+					me->wparam++;
+					bHaveIter=gtk_tree_model_iter_next(GTK_TREE_MODEL(ls),&iter);
+					continue;
+				}
+
 				/* create new macro event */
 				me=g_new0(MacroEvent,1);
 
 				me->message=mde->message;
 				me->lparam=0;
-				me->wparam=0;
+				me->wparam=bRepeatable?1:0;
 
 				/* Special handling for text inserting, duplicate inserted string */
 				if(me->message==SCI_REPLACESEL)
@@ -1992,6 +2327,7 @@ static void EditMacroElements(Macro *m)
 
 			/* was more efficient to record in reverse direction, so now reverse */
 			m->MacroEvents=g_slist_reverse(m->MacroEvents);
+			CompileMacro(m);
 
 			break;
 		}
@@ -2044,6 +2380,8 @@ static void DoEditMacroSelectionChanged(GtkTreeSelection *selection,gpointer dat
 	gtk_widget_set_sensitive(button,bHasItemSelected);
 	button=(GtkWidget*)(g_object_get_data(G_OBJECT(dialog),"GeanyMacros_bC"));
 	gtk_widget_set_sensitive(button,bHasItemSelected);
+	button=(GtkWidget*)(g_object_get_data(G_OBJECT(dialog),"GeanyMacros_bD"));
+	gtk_widget_set_sensitive(button,bHasItemSelected);
 }
 
 
@@ -2119,6 +2457,8 @@ static void DoEditMacro(GtkMenuItem *menuitem, gpointer gdata)
 	g_object_set_data(G_OBJECT(dialog),"GeanyMacros_bB",button);
 	button=gtk_dialog_add_button(GTK_DIALOG(dialog),_("_Delete"),GEANY_MACRO_BUTTON_DELETE);
 	g_object_set_data(G_OBJECT(dialog),"GeanyMacros_bC",button);
+	button=gtk_dialog_add_button(GTK_DIALOG(dialog),_("Re_peat..."),GEANY_MACRO_BUTTON_REPEAT);
+	g_object_set_data(G_OBJECT(dialog),"GeanyMacros_bD",button);
 	gtk_dialog_add_button(GTK_DIALOG(dialog),_("_Ok"),GEANY_MACRO_BUTTON_CANCEL);
 
 	/* listen for changes in selection */
@@ -2130,13 +2470,14 @@ static void DoEditMacro(GtkMenuItem *menuitem, gpointer gdata)
 
 	i=GTK_RESPONSE_REJECT;
 	while(i==GEANY_MACRO_BUTTON_RERECORD || i==GEANY_MACRO_BUTTON_EDIT ||
-	      i==GEANY_MACRO_BUTTON_DELETE || i==GTK_RESPONSE_REJECT)
+	      i==GEANY_MACRO_BUTTON_DELETE || i==GEANY_MACRO_BUTTON_REPEAT || i==GTK_RESPONSE_REJECT)
 	{
 		/* wait for button to be pressed */
 		i=gtk_dialog_run(GTK_DIALOG(dialog));
 
 		/* exit if not doing any action */
-		if(i!=GEANY_MACRO_BUTTON_RERECORD && i!=GEANY_MACRO_BUTTON_EDIT && i!=GEANY_MACRO_BUTTON_DELETE)
+		if(i!=GEANY_MACRO_BUTTON_RERECORD && i!=GEANY_MACRO_BUTTON_EDIT &&
+		   i!=GEANY_MACRO_BUTTON_DELETE && i!=GEANY_MACRO_BUTTON_REPEAT)
 			break;
 
 		/* check if line has been selected */
@@ -2183,10 +2524,24 @@ static void DoEditMacro(GtkMenuItem *menuitem, gpointer gdata)
 			/* handle edit macro */
 			if(i==GEANY_MACRO_BUTTON_EDIT && m)
 			{
+				EnsureMacroEvents(m);
 				EditMacroElements(m);
 				/* Signal that macros have changed (and need to be saved) */
 				bMacrosHaveChanged=TRUE;
 			}
+
+			/* handle repeat macro: run it several times on current document */
+			if(i==GEANY_MACRO_BUTTON_REPEAT && m && DocumentPresent())
+			{
+				gdouble dRepeat=2;
+
+				if(dialogs_show_input_numeric(_("Repeat Macro"),_("Number of times to run macro:"),
+				                              &dRepeat,1,100000,1))
+				{
+					ReplayMacro(m,(gint)dRepeat);
+					break;
+				}
+			}
 		}
 
 	}
@@ -2300,4 +2655,10 @@ void plugin_cleanup(void)
 
 	/* clean up memory used by macros */
 	ClearAllMacros();
+	g_free(pcMacroFileData);
+	pcMacroFileData=NULL;
+
+	if(MacroDetailsIndex!=NULL)
+		g_hash_table_destroy(MacroDetailsIndex);
+	MacroDetailsIndex=NULL;
 }
@@ -33,7 +33,13 @@
 #include    <geanyplugin.h>
 
 /* headers */
+#include    <stdio.h>
 #include    <stdlib.h>
+#include    <string.h>
+#include    <signal.h>
+#include    <unistd.h>
+#include    <sys/types.h>
+#include    <sys/wait.h>
 #include    <glib.h>
 #include    <glib/gstdio.h>
 
@@ -65,100 +71,579 @@ static gchar        *gms_command = NULL ;
 
 
 /**
- * \brief the function creates from the current selection to the input file
+ * \brief the function select entirely the document
  */
-static void create_selection_2_input_file( ScintillaObject *sci )
+static void select_entirely_doc( ScintillaObject *sci  )
 {
-    gchar  *contents = NULL;
-    gint    size_buf = sci_get_selected_text_length(sci);
+    gint            size_buf = sci_get_length(sci);
 
-    contents = GMS_G_MALLOC( gchar, size_buf + 1  ) ;
-    GMS_PNULL(contents) ;
+    sci_set_selection_start( sci , 0 ) ;
+    sci_set_selection_end( sci , size_buf ) ;
+}
 
-    sci_get_selected_text( sci ,contents  );
+/**
+ * \brief the function updates the current document
+ */
+static void update_doc( ScintillaObject *sci, gchar * contents )
+{
+    if (contents==NULL) return ;
+    sci_replace_sel( sci, contents );
+}
+/**
+ * \brief the function deletes the tempory files
+ */
+static void delete_tmp_files(void)
+{
+    if( g_file_test( gms_get_filter_filename(gms_hnd),G_FILE_TEST_EXISTS) == TRUE )
+        g_unlink( gms_get_filter_filename(gms_hnd) ) ;
+}
 
-    g_file_set_contents(gms_get_in_filename(gms_hnd), contents, -1 , NULL );
-    GMS_G_FREE(contents);
+/*! \brief size of the blocks written to and read from the filter */
+#define GMS_PIPE_CHUNK  65536
+
+/*! \brief definition of a running filter */
+typedef struct {
+    GPid        pid       ; /*!< process of the filter */
+    gchar      *input     ; /*!< text written to the filter input */
+    gsize       input_len ; /*!< length of the input */
+    gsize       input_pos ; /*!< length of the input already written */
+    GString    *output    ; /*!< filter output */
+    GString    *errors    ; /*!< filter error output */
+    gint        status    ; /*!< exit status of the filter */
+    guint       src_in    ; /*!< watch of the filter input pipe */
+    guint       src_out   ; /*!< watch of the filter output pipe */
+    guint       src_err   ; /*!< watch of the filter error pipe */
+    gint        n_pending ; /*!< number of watches not finished, child watch included */
+    GtkWidget  *dlg       ; /*!< dialog shown while running, NULL once closed */
+    gms_worker_type_t worker ; /*!< worker running the filter, or WORKER_NONE */
+} gms_filter_t ;
+
+/*! \brief definition of a persistent interpreter, running the filters
+ *         sent to it one after the other.
+ *
+ *  A request is a "<script length> <input length>\n" line followed by
+ *  the script and the input, the reply a "<exit status> <output length>
+ *  <errors length>\n" line followed by the output and the errors.
+ */
+typedef struct {
+    GPid        pid       ; /*!< process of the interpreter */
+    GIOChannel *ch_in     ; /*!< requests, written to the interpreter */
+    GIOChannel *ch_out    ; /*!< replies, read from the interpreter */
+    gchar      *cmd       ; /*!< command of the interpreter */
+    guint       src_child ; /*!< child watch of the interpreter */
+    gms_worker_type_t type ; /*!< type of the worker */
+} gms_worker_t ;
+
+static gms_worker_t *gms_workers[WORKER_COUNT] ;
+
+/*! \brief loop of the perl worker */
+static const gchar *worker_perl =
+    "use bytes ();\n"
+    "binmode STDIN; binmode STDOUT; $| = 1;\n"
+    "our $gms_exit;\n"
+    "BEGIN { *CORE::GLOBAL::exit = sub { $gms_exit = @_ ? $_[0] : 0; die \"gms_exit\\n\"; }; }\n"
+    "sub gms_read {\n"
+    "    my ($n, $d) = (shift, '');\n"
+    "    while (length($d) < $n) {\n"
+    "        read(STDIN, $d, $n - length($d), length($d)) or CORE::exit(0);\n"
+    "    }\n"
+    "    return $d;\n"
+    "}\n"
+    "while (defined(my $h = <STDIN>)) {\n"
+    "    my ($sl, $il) = split(' ', $h);\n"
+    "    my $script = gms_read($sl);\n"
+    "    my $input = gms_read($il);\n"
+    "    my ($out, $err) = ('', '');\n"
+    "    $gms_exit = undef;\n"
+    "    {\n"
+    "        local (*STDIN, *STDOUT, *STDERR, $_, $@);\n"
+    "        local ($/, $\\, $,) = (\"\\n\", undef, undef);\n"
+    "        open(STDIN, '<', \\$input); open(STDOUT, '>', \\$out); open(STDERR, '>', \\$err);\n"
+    "        unless (eval(\"package main;\\n#line 1 filter\\n$script\\n;1;\")) {\n"
+    "            unless (defined($gms_exit)) { print STDERR $@; $gms_exit = 255; }\n"
+    "        }\n"
+    "        close(STDOUT); close(STDERR);\n"
+    "    }\n"
+    "    print(defined($gms_exit) ? $gms_exit : 0, ' ', bytes::length($out), ' ',\n"
+    "          bytes::length($err), \"\\n\", $out, $err);\n"
+    "}\n" ;
+
+/*! \brief loop of the python worker, for python 2 and 3 */
+static const gchar *worker_python =
+    "import io, sys, traceback\n"
+    "stdin = getattr(sys.stdin, 'buffer', sys.stdin)\n"
+    "stdout = getattr(sys.stdout, 'buffer', sys.stdout)\n"
+    "def gms_read(n):\n"
+    "    d = b''\n"
+    "    while len(d) < n:\n"
+    "        c = stdin.read(n - len(d))\n"
+    "        if not c:\n"
+    "            sys.exit(0)\n"
+    "        d += c\n"
+    "    return d\n"
+    "def gms_stream(b):\n"
+    "    return io.TextIOWrapper(b) if sys.version_info[0] >= 3 else b\n"
+    "while True:\n"
+    "    h = stdin.readline()\n"
+    "    if not h:\n"
+    "        break\n"
+    "    sl, il = [int(x) for x in h.split()]\n"
+    "    script = gms_read(sl)\n"
+    "    out, err = io.BytesIO(), io.BytesIO()\n"
+    "    sys.stdin = gms_stream(io.BytesIO(gms_read(il)))\n"
+    "    sys.stdout, sys.stderr = gms_stream(out), gms_stream(err)\n"
+    "    status = 0\n"
+    "    try:\n"
+    "        exec(compile(script, 'filter', 'exec'), {'__name__': '__main__'})\n"
+    "    except SystemExit as e:\n"
+    "        if isinstance(e.code, int):\n"
+    "            status = e.code\n"
+    "        elif e.code is not None:\n"
+    "            sys.stderr.write('%s\\n' % e.code)\n"
+    "            status = 1\n"
+    "    except BaseException:\n"
+    "        traceback.print_exc()\n"
+    "        status = 1\n"
+    "    sys.stdout.flush(); sys.stderr.flush()\n"
+    "    o, e = out.getvalue(), err.getvalue()\n"
+    "    sys.stdin, sys.stdout, sys.stderr = sys.__stdin__, sys.__stdout__, sys.__stderr__\n"
+    "    stdout.write(('%d %d %d\\n' % (status, len(o), len(e))).encode('ascii'))\n"
+    "    stdout.write(o); stdout.write(e); stdout.flush()\n" ;
+
+/**
+ * \brief the function frees a filter
+ */
+static void filter_free( gms_filter_t *f )
+{
+    GMS_G_FREE( f->input ) ;
+    g_string_free( f->output, TRUE ) ;
+    g_string_free( f->errors, TRUE ) ;
+    GMS_G_FREE( f ) ;
 }
 
 /**
- * \brief the function reads the result file
+ * \brief the function is called when a watch of the filter is finished
  */
-static gchar *read_result_file( gchar *filename )
+static void filter_done( gms_filter_t *f )
 {
-    gchar *utf8     = NULL;
-    gchar *contents = NULL;
-    GError *error   = NULL ;
-    if (g_file_get_contents(filename, &contents, NULL, &error ))
+    if ( --f->n_pending > 0 )
+        return ;
+
+    if ( f->dlg != NULL )
+        gtk_dialog_response( GTK_DIALOG(f->dlg), GTK_RESPONSE_OK ) ;
+    else
+        filter_free( f ) ; /* cancelled, nobody waits for it anymore */
+}
+
+/**
+ * \brief the function writes the next block of the input into the filter
+ */
+static gboolean filter_write_cb( GIOChannel *ch, GIOCondition cond, gpointer data )
+{
+    gms_filter_t *f  = data ;
+    GIOStatus     st = G_IO_STATUS_NORMAL ;
+
+    if ( cond & G_IO_OUT )
     {
-        if ( contents )
-        {
-            utf8 = g_locale_to_utf8 (contents, -1, NULL, NULL, NULL);
-            GMS_G_FREE(contents);
-        }
+        gsize written = 0 ;
+
+        st = g_io_channel_write_chars( ch, f->input + f->input_pos,
+                    MIN( GMS_PIPE_CHUNK, f->input_len - f->input_pos ), &written, NULL ) ;
+        f->input_pos += written ;
+        if ( st == G_IO_STATUS_AGAIN )
+            st = G_IO_STATUS_NORMAL ;
     }
-    return utf8 ;
+
+    if ( f->input_pos < f->input_len && st == G_IO_STATUS_NORMAL &&
+         ( cond & ( G_IO_ERR | G_IO_HUP ) ) == 0 )
+        return TRUE ;
+
+    /* all is written, or the filter doesn't read anymore:
+     * removing the watch closes the pipe, which ends the filter input */
+    f->src_in = 0 ;
+    filter_done( f ) ;
+    return FALSE ;
+}
+
+/**
+ * \brief the function reads what the filter wrote into a pipe
+ */
+static gboolean filter_read( GIOChannel *ch, gms_filter_t *f, GString *str, guint *src )
+{
+    gchar     buf[GMS_PIPE_CHUNK] ;
+    gsize     n  = 0 ;
+    GIOStatus st = g_io_channel_read_chars( ch, buf, sizeof(buf), &n, NULL ) ;
+
+    g_string_append_len( str, buf, n ) ;
+    if ( st == G_IO_STATUS_NORMAL || st == G_IO_STATUS_AGAIN )
+        return TRUE ;
+
+    *src = 0 ;
+    filter_done( f ) ;
+    return FALSE ;
+}
+
+static gboolean filter_read_output_cb( GIOChannel *ch, GIOCondition cond, gpointer data )
+{
+    gms_filter_t *f = data ;
+    return filter_read( ch, f, f->output, &f->src_out ) ;
+}
+
+static gboolean filter_read_errors_cb( GIOChannel *ch, GIOCondition cond, gpointer data )
+{
+    gms_filter_t *f = data ;
+    return filter_read( ch, f, f->errors, &f->src_err ) ;
 }
+
 /**
- * \brief the function select entirely the document
+ * \brief the function is called when the filter process exits
  */
-static void select_entirely_doc( ScintillaObject *sci  )
+static void filter_exit_cb( GPid pid, gint status, gpointer data )
 {
-    gint            size_buf = sci_get_length(sci);
+    gms_filter_t *f = data ;
 
-    sci_set_selection_start( sci , 0 ) ;
-    sci_set_selection_end( sci , size_buf ) ;
+    f->status = status ;
+    g_spawn_close_pid( pid ) ;
+    filter_done( f ) ;
 }
 
 /**
- * \brief the function updates the current document
+ * \brief the function is called in the filter process before running it
  */
-static void update_doc( ScintillaObject *sci, gchar * contents )
+static void filter_setup_cb( gpointer data )
 {
-    if (contents==NULL) return ;
-    sci_replace_sel( sci, contents );
+    /* in its own process group, so that the whole pipeline can be killed */
+    setpgid( 0, 0 ) ;
 }
+
 /**
- * \brief the function deletes the tempory files
+ * \brief the function opens a channel on a pipe, closed with its last reference
  */
-static void delete_tmp_files(void)
+static GIOChannel *pipe_channel_new( gint fd )
 {
-    if( g_file_test( gms_get_in_filename(gms_hnd),G_FILE_TEST_EXISTS) == TRUE )
-        g_unlink( gms_get_in_filename(gms_hnd) ) ;
-    if( g_file_test( gms_get_out_filename(gms_hnd),G_FILE_TEST_EXISTS) == TRUE )
-        g_unlink( gms_get_out_filename(gms_hnd) ) ;
-    if( g_file_test( gms_get_filter_filename(gms_hnd),G_FILE_TEST_EXISTS) == TRUE )
-        g_unlink( gms_get_filter_filename(gms_hnd) ) ;
+    GIOChannel *ch = g_io_channel_unix_new( fd ) ;
+
+    g_io_channel_set_encoding( ch, NULL, NULL ) ;
+    g_io_channel_set_buffered( ch, FALSE ) ;
+    g_io_channel_set_flags( ch, G_IO_FLAG_NONBLOCK, NULL ) ;
+    g_io_channel_set_close_on_unref( ch, TRUE ) ;
+    return ch ;
+}
+
+/**
+ * \brief the function watches a channel of the filter
+ */
+static guint filter_add_channel_watch( GIOChannel *ch, GIOCondition cond, GIOFunc func, gms_filter_t *f )
+{
+    f->n_pending++ ;
+    return g_io_add_watch( ch, cond | G_IO_HUP | G_IO_ERR, func, f ) ;
+}
+
+/**
+ * \brief the function watches a pipe of the filter
+ */
+static guint filter_add_watch( gint fd, GIOCondition cond, GIOFunc func, gms_filter_t *f )
+{
+    GIOChannel *ch = pipe_channel_new( fd ) ;
+    guint       src = filter_add_channel_watch( ch, cond, func, f ) ;
+
+    /* the watch keeps the only reference: removing it closes the pipe */
+    g_io_channel_unref( ch ) ;
+    return src ;
+}
+
+/**
+ * \brief the function stops watching a pipe of the filter
+ */
+static void filter_remove_watch( gms_filter_t *f, guint *src )
+{
+    if ( *src != 0 )
+    {
+        g_source_remove( *src ) ;
+        *src = 0 ;
+        f->n_pending-- ;
+    }
+}
+
+/**
+ * \brief the function forgets a worker, once its process is gone
+ */
+static void worker_free( gms_worker_t *w )
+{
+    if ( gms_workers[w->type] == w )
+        gms_workers[w->type] = NULL ;
+    if ( w->src_child != 0 )
+        g_source_remove( w->src_child ) ;
+    g_io_channel_unref( w->ch_in ) ;
+    g_io_channel_unref( w->ch_out ) ;
+    GMS_G_FREE( w->cmd ) ;
+    GMS_G_FREE( w ) ;
+}
+
+/**
+ * \brief the function is called when a worker exits by itself
+ */
+static void worker_exit_cb( GPid pid, gint status, gpointer data )
+{
+    gms_worker_t *w = data ;
+
+    w->src_child = 0 ;
+    g_spawn_close_pid( pid ) ;
+    worker_free( w ) ;
+}
+
+/**
+ * \brief the function stops the worker of a type, if running
+ */
+static void worker_stop( gms_worker_type_t type )
+{
+    gms_worker_t *w = gms_workers[type] ;
+
+    if ( w == NULL )
+        return ;
+    if ( w->src_child != 0 )
+    {
+        kill( -w->pid, SIGKILL ) ;
+        waitpid( w->pid, NULL, 0 ) ;
+        g_spawn_close_pid( w->pid ) ;
+    }
+    worker_free( w ) ;
+}
+
+/**
+ * \brief the function stops all the workers
+ */
+static void worker_stop_all( void )
+{
+    gint ii ;
+
+    for ( ii = 0 ; ii < WORKER_COUNT ; ii++ )
+        worker_stop( ii ) ;
+}
+
+/**
+ * \brief the function gets the worker of a type, started if needed
+ * \return NULL if it can't be started.
+ */
+static gms_worker_t *worker_get( gms_worker_type_t type, const gchar *cmd, GError **error )
+{
+    gms_worker_t *w = gms_workers[type] ;
+    gchar        *quoted ;
+    gchar        *argv[4] ;
+    gint          fd_in, fd_out ;
+    gboolean      ok ;
+
+    if ( w != NULL && strcmp( w->cmd, cmd ) == 0 )
+        return w ;
+    worker_stop( type ) ; /* the command was changed */
+
+    w = GMS_G_MALLOC0( gms_worker_t, 1 ) ;
+    quoted = g_shell_quote( type == WORKER_PERL ? worker_perl : worker_python ) ;
+    argv[0] = "/bin/sh" ;
+    argv[1] = "-c" ;
+    argv[2] = g_strdup_printf( "exec %s %s %s", cmd, type == WORKER_PERL ? "-e" : "-c", quoted ) ;
+    argv[3] = NULL ;
+    ok = g_spawn_async_with_pipes( NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                    filter_setup_cb, NULL, &w->pid, &fd_in, &fd_out, NULL, error ) ;
+    GMS_G_FREE( argv[2] ) ;
+    GMS_G_FREE( quoted ) ;
+    if ( ! ok )
+    {
+        GMS_G_FREE( w ) ;
+        return NULL ;
+    }
+
+    w->type      = type ;
+    w->cmd       = g_strdup( cmd ) ;
+    w->ch_in     = pipe_channel_new( fd_in ) ;
+    w->ch_out    = pipe_channel_new( fd_out ) ;
+    w->src_child = g_child_watch_add( w->pid, worker_exit_cb, w ) ;
+    gms_workers[type] = w ;
+    return w ;
+}
+
+/**
+ * \brief the function parses the reply of a worker, once complete
+ * \return TRUE when the reply is complete, its output and errors
+ *         then being split into the filter output and errors.
+ */
+static gboolean filter_parse_reply( gms_filter_t *f )
+{
+    gchar  *nl = memchr( f->output->str, '\n', f->output->len ) ;
+    gsize   header_len ;
+    gint    status ;
+    gulong  out_len, err_len ;
+
+    if ( nl == NULL )
+        return FALSE ;
+    header_len = nl - f->output->str + 1 ;
+    if ( sscanf( f->output->str, "%d %lu %lu", &status, &out_len, &err_len ) != 3 ||
+         f->output->len < header_len + out_len + err_len )
+        return FALSE ;
+
+    g_string_append_len( f->errors, f->output->str + header_len + out_len, err_len ) ;
+    g_string_truncate( f->output, header_len + out_len ) ;
+    g_string_erase( f->output, 0, header_len ) ;
+    f->status = status ;
+    return TRUE ;
+}
+
+/**
+ * \brief the function reads the reply of the worker running the filter
+ */
+static gboolean filter_read_reply_cb( GIOChannel *ch, GIOCondition cond, gpointer data )
+{
+    gms_filter_t *f = data ;
+    gchar     buf[GMS_PIPE_CHUNK] ;
+    gsize     n  = 0 ;
+    GIOStatus st = g_io_channel_read_chars( ch, buf, sizeof(buf), &n, NULL ) ;
+
+    g_string_append_len( f->output, buf, n ) ;
+    if ( st == G_IO_STATUS_NORMAL || st == G_IO_STATUS_AGAIN )
+    {
+        if ( ! filter_parse_reply( f ) )
+            return TRUE ;
+    }
+    else
+    {
+        /* the interpreter died: it is started again by the next filter */
+        g_string_truncate( f->output, 0 ) ;
+        g_string_assign( f->errors, _("The interpreter stopped unexpectedly.") ) ;
+        f->status = -1 ;
+        worker_stop( f->worker ) ;
+    }
+
+    f->src_out = 0 ;
+    filter_done( f ) ;
+    return FALSE ;
+}
+
+/**
+ * \brief the function shows a message in a dialog box
+ */
+static void show_message( GtkMessageType type, const gchar *msg )
+{
+    GtkWidget *dlg = gtk_message_dialog_new( GTK_WINDOW(geany->main_widgets->window),
+                        GTK_DIALOG_DESTROY_WITH_PARENT,
+                        type,
+                        GTK_BUTTONS_CLOSE,
+                        "%s", msg);
+
+    gtk_dialog_run(GTK_DIALOG(dlg));
+    gtk_widget_destroy(GTK_WIDGET(dlg)) ;
 }
 
 /**
  * \brief the function updates the current document
+ * \note the selection is written into the filter input through a pipe, and
+ *       the filter output read through another one, as they come, while a
+ *       dialog allows to cancel the filter.
  */
 static gint run_filter( ScintillaObject *sci )
 {
-    int r , ret = 0 ;
+    int ret = 0 ;
+    gint response ;
     gchar *result = NULL ;
+    gchar *argv[4] ;
+    gint fd_in, fd_out, fd_err ;
+    GError *error = NULL ;
+    gms_filter_t *f ;
+    gms_worker_t *w = NULL ;
+    void (*old_sigpipe)(int) ;
+
+    f = GMS_G_MALLOC0( gms_filter_t, 1 ) ;
+    f->worker = gms_get_worker_type( gms_hnd ) ;
+    if ( f->worker != WORKER_NONE )
+    {
+        w = worker_get( f->worker, gms_get_script_cmd( gms_hnd ), &error ) ;
+    }
+    else
+    {
+        gms_command = gms_get_str_command(gms_hnd);
+        argv[0] = "/bin/sh" ;
+        argv[1] = "-c" ;
+        argv[2] = gms_command ;
+        argv[3] = NULL ;
+
+        g_spawn_async_with_pipes( NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                    filter_setup_cb, NULL, &f->pid, &fd_in, &fd_out, &fd_err, &error ) ;
+    }
+    if ( error != NULL )
+    {
+        show_message( GTK_MESSAGE_ERROR, error->message ) ;
+        g_error_free( error ) ;
+        GMS_G_FREE( f ) ;
+        return -1 ;
+    }
+
+    f->input     = sci_get_selection_contents( sci ) ;
+    f->input_len = strlen( f->input ) ;
+    f->output    = g_string_sized_new( f->input_len + 1 ) ;
+    f->errors    = g_string_new( "" ) ;
 
-    gms_command = gms_get_str_command(gms_hnd);
-    r = system( gms_command ) ;
-    if ( r != 0 )
+    /* the filter closing its input early must not kill geany */
+    old_sigpipe = signal( SIGPIPE, SIG_IGN ) ;
+
+    if ( w != NULL )
     {
-        GtkWidget *dlg ;
-        result = read_result_file( gms_get_error_filename(gms_hnd) ) ;
+        /* the request: header, script and input, in a single buffer */
+        gchar   *script  = gms_get_script_text( gms_hnd ) ;
+        GString *request = g_string_sized_new( f->input_len + strlen( script ) + 32 ) ;
+
+        g_string_printf( request, "%lu %lu\n", (gulong) strlen( script ), (gulong) f->input_len ) ;
+        g_string_append( request, script ) ;
+        g_string_append_len( request, f->input, f->input_len ) ;
+        GMS_G_FREE( script ) ;
+        GMS_G_FREE( f->input ) ;
+        f->input_len = request->len ;
+        f->input     = g_string_free( request, FALSE ) ;
+
+        /* the worker keeps its channels open, removing the watches doesn't close them */
+        f->src_in  = filter_add_channel_watch( w->ch_in, G_IO_OUT, filter_write_cb, f ) ;
+        f->src_out = filter_add_channel_watch( w->ch_out, G_IO_IN, filter_read_reply_cb, f ) ;
+    }
+    else
+    {
+        f->src_in  = filter_add_watch( fd_in, G_IO_OUT, filter_write_cb, f ) ;
+        f->src_out = filter_add_watch( fd_out, G_IO_IN, filter_read_output_cb, f ) ;
+        f->src_err = filter_add_watch( fd_err, G_IO_IN, filter_read_errors_cb, f ) ;
+        g_child_watch_add( f->pid, filter_exit_cb, f ) ;
+        f->n_pending++ ;
+    }
 
-        dlg = gtk_message_dialog_new( GTK_WINDOW(geany->main_widgets->window),
-                        GTK_DIALOG_DESTROY_WITH_PARENT,
-                        GTK_MESSAGE_ERROR,
-                        GTK_BUTTONS_CLOSE,
-                        "%s", result);
+    f->dlg = gtk_message_dialog_new( GTK_WINDOW(geany->main_widgets->window),
+                    GTK_DIALOG_DESTROY_WITH_PARENT|GTK_DIALOG_MODAL,
+                    GTK_MESSAGE_INFO,
+                    GTK_BUTTONS_CANCEL,
+                    "%s", _("Running the mini-script filter...") );
+    response = gtk_dialog_run( GTK_DIALOG(f->dlg) ) ;
+    GMS_FREE_WIDGET( f->dlg ) ;
 
-        gtk_dialog_run(GTK_DIALOG(dlg));
-        gtk_widget_destroy(GTK_WIDGET(dlg)) ;
+    if ( response != GTK_RESPONSE_OK )
+    {
+        /* cancelled: stop the whole pipeline, the child watch frees f */
+        filter_remove_watch( f, &f->src_in ) ;
+        filter_remove_watch( f, &f->src_out ) ;
+        filter_remove_watch( f, &f->src_err ) ;
+        if ( f->worker != WORKER_NONE )
+            worker_stop( f->worker ) ; /* it is in the middle of the request */
+        if ( f->n_pending > 0 )
+            kill( -f->pid, SIGTERM ) ;
+        else
+            filter_free( f ) ;
+        ret = -1 ;
+    }
+    else if ( f->status != 0 )
+    {
+        result = g_locale_to_utf8( f->errors->str, f->errors->len, NULL, NULL, NULL );
+        show_message( GTK_MESSAGE_ERROR, result != NULL ? result : "" ) ;
+        filter_free( f ) ;
 		ret = -1 ;
     }
     else
     {
-        result = read_result_file( gms_get_out_filename(gms_hnd) ) ;
+        result = g_locale_to_utf8( f->output->str, f->output->len, NULL, NULL, NULL );
+        filter_free( f ) ;
 
         if ( gms_get_output_mode( gms_hnd) == OUT_CURRENT_DOC )
         {
@@ -174,6 +659,7 @@ static gint run_filter( ScintillaObject *sci )
     }
     GMS_G_FREE( result ) ;
 
+    signal( SIGPIPE, old_sigpipe ) ;
 	return ret ;
 }
 
@@ -196,12 +682,10 @@ static void item_activate(GtkMenuItem *menuitem, gpointer gdata)
     {
         case IN_CURRENT_DOC :
             select_entirely_doc(  sci  ) ;
-            create_selection_2_input_file(sci) ;
             run_filter( sci ) ;
             delete_tmp_files() ;
             break;
         case IN_SELECTION :
-            create_selection_2_input_file(sci) ;
             run_filter( sci ) ;
             delete_tmp_files() ;
             break;
@@ -218,7 +702,6 @@ static void item_activate(GtkMenuItem *menuitem, gpointer gdata)
                     doc = document_get_from_page(i) ;
                     sci = doc->editor->sci ;
                     select_entirely_doc(  sci  ) ;
-                    create_selection_2_input_file(sci) ;
                     if ( run_filter( sci ) )
 						break ; /* if error then stop the loop */
                 }
@@ -263,9 +746,17 @@ void plugin_init(GeanyData *data)
  * Note: parent is the parent window which can be used as the transient window for the created
  *  dialog. */
 #if 1
+static void on_configure_response(GtkDialog *dialog, gint response, gpointer user_data)
+{
+    /* the response of gms_gui is handled before, the preferences are updated */
+    if ( ! gms_get_persistent( gms_hnd ) )
+        worker_stop_all() ;
+}
+
 GtkWidget *plugin_configure(GtkDialog *dialog)
 {
     g_signal_connect(dialog, "response", G_CALLBACK(on_gms_configure_response), gms_hnd );
+    g_signal_connect_after(dialog, "response", G_CALLBACK(on_configure_response), NULL );
     return gms_configure_gui( gms_hnd ) ;
 }
 #endif
@@ -275,6 +766,8 @@ GtkWidget *plugin_configure(GtkDialog *dialog)
  */
 void plugin_cleanup(void)
 {
+    worker_stop_all() ;
+
     if ( gms_hnd != NULL )
        gms_delete( &gms_hnd ) ;
 
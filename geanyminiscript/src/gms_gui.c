@@ -82,6 +82,7 @@ typedef struct {
     GtkWidget   *rb_ndoc      ; /*!< radio button : the filter output is in the current document */
 
     GtkWidget   *e_script[GMS_NB_TYPE_SCRIPT] ; /*!< entry for script configuration */
+    GtkWidget   *c_persistent ; /*!< check button for the persistent workers */
     PangoFontDescription *fontdesc;
 } gms_gui_t  ;
 
@@ -92,11 +93,9 @@ typedef struct {
     GString    *cmd         ;                    /*!< Command string of filtering */
     GtkWidget  *mw          ;                    /*!< MainWindow of Geany */
     gms_gui_t   w           ;                    /*!< Widgets of minis-script gui */
-    GString    *input_name  ;                    /*!< filename of the filter input */
     GString    *filter_name ;                    /*!< filter filename */
-    GString    *output_name ;                    /*!< filename of the filter output */
-    GString    *error_name  ;                    /*!< errors filename */
     GString    *script_cmd[GMS_NB_TYPE_SCRIPT];  /*!< array of script command names */
+    gboolean    persistent  ;                    /*!< keep the interpreters running */
 } gms_private_t  ;
 /*
  * *****************************************************************************
@@ -112,15 +111,16 @@ static gchar bufline[GMS_MAX_LINE+1]; /*!< buffer used to read the configuration
 
 static const gchar pref_filename[]   = "gms.rc"    ; /*!< preferences filename */
 static const gchar prefix_filename[] = "/tmp/gms"  ; /*!< prefix filename */
-static const gchar in_ext[]          = ".in"       ; /*!< filename extension for the input file */
-static const gchar out_ext[]         = ".out"      ; /*!< filename extension for the output file */
 static const gchar filter_ext[]      = ".filter"   ; /*!< filename extension for the filter file */
-static const gchar error_ext[]       = ".error"    ; /*!< filename extension for the error file */
 
 /**< \brief It's the default script command */
 static const gchar *default_script_cmd[GMS_NB_TYPE_SCRIPT] = {
     "${SHELL} ", "perl ", "python ", "sed -f ", "awk -f ", "cat - "  };
 
+/**< \brief It's the type of the worker able to run each script type */
+static const gms_worker_type_t worker_type[GMS_NB_TYPE_SCRIPT] = {
+    WORKER_NONE, WORKER_PERL, WORKER_PYTHON, WORKER_NONE, WORKER_NONE, WORKER_NONE };
+
 /**< \brief It's the label for the script command combobox */
 const gchar *label_script_cmd[GMS_NB_TYPE_SCRIPT] = {
     "Shell", "Perl", "Python", "Sed", "Awk", "User" };
@@ -180,6 +180,11 @@ static void load_prefs_file(
                 bufline[strlen(bufline)-1] = 0 ;
                 g_string_assign(this->script_cmd[ii] , bufline ) ;
             }
+            /* the persistent mode comes after, in newer files */
+            if ( ii == GMS_NB_TYPE_SCRIPT &&
+                 fgets(bufline,GMS_MAX_LINE,fd) != NULL &&
+                 fgets(bufline,GMS_MAX_LINE,fd) != NULL )
+                this->persistent = atoi( bufline ) != 0 ;
             fclose(fd) ;
         }
      }
@@ -215,6 +220,7 @@ static void save_prefs_file(
             int  ii ;
             for ( ii = 0 ; ii <GMS_NB_TYPE_SCRIPT ;ii++ )
                 fprintf(fd,"# %s\n%s\n",label_script_cmd[ii],this->script_cmd[ii]->str);
+            fprintf(fd,"# %s\n%d\n","Persistent",this->persistent);
 
             fclose(fd) ;
         }
@@ -532,24 +538,12 @@ gms_handle_t gms_new(
         gtk_widget_show_all(GTK_WIDGET(vb_dlg));
         this->id  = ++inst_cnt ;
 
-        this->input_name = g_string_new(prefix_filename) ;
         this->filter_name= g_string_new(prefix_filename) ;
-        this->output_name= g_string_new(prefix_filename) ;
-        this->error_name = g_string_new(prefix_filename) ;
 
         size_pid = (gint)(2*sizeof(pid_t)) ;
-        g_string_append_printf( this->input_name,"%02x_%0*x%s",
-                    this->id,size_pid, getpid(), in_ext ) ;
-
         g_string_append_printf(this->filter_name,"%02x_%0*x%s",
                     this->id,size_pid, getpid(), filter_ext ) ;
 
-        g_string_append_printf(this->output_name,"%02x_%0*x%s",
-                    this->id,size_pid, getpid(), out_ext ) ;
-
-        g_string_append_printf(this->error_name,"%02x_%0*x%s",
-                    this->id,size_pid, getpid(), error_ext ) ;
-
         for ( i=0;i<GMS_NB_TYPE_SCRIPT ; i++ )
         {
             this->script_cmd[i]=g_string_new(default_script_cmd[i] ) ;
@@ -578,8 +572,6 @@ void gms_delete(
         GMS_FREE_FONTDESC(this->w.fontdesc );
         GMS_FREE_WIDGET(this->w.dlg);
 
-        g_string_free( this->input_name  ,flag) ;
-        g_string_free( this->output_name ,flag) ;
         g_string_free( this->filter_name ,flag) ;
         g_string_free( this->cmd         ,flag) ;
 
@@ -648,69 +640,88 @@ gms_output_t  gms_get_output_mode(
 }
 
 /**
- * \brief the function get the input filename for filter input.
+ * \brief the function get the output filename for filter script.
+ */
+gchar *gms_get_filter_filename( gms_handle_t hnd )
+{
+    gms_private_t *this = GMS_PRIVATE( hnd ) ;
+    return this->filter_name->str ;
+}
+
+/**
+ * \brief the function creates the filter file.
  */
-gchar *gms_get_in_filename(
+void  gms_create_filter_file(
     gms_handle_t hnd /**< handle of mini-script data structure */
     )
 {
     gms_private_t *this = GMS_PRIVATE( hnd ) ;
-    return this->input_name->str ;
+    gchar           *contents = gms_get_script_text( hnd );
+
+    g_file_set_contents(this->filter_name->str, contents, -1 , NULL );
+    GMS_G_FREE(contents);
 }
 
 /**
- * \brief the function get the output filename for filter result.
+ * \brief the function gets the text of the script, to be freed.
  */
-gchar *gms_get_out_filename(
+gchar *gms_get_script_text(
     gms_handle_t hnd /**< handle of mini-script data structure */
     )
 {
     gms_private_t *this = GMS_PRIVATE( hnd ) ;
-    return this->output_name->str ;
+    GtkTextIter      start;
+    GtkTextIter      end;
+    GtkTextBuffer   *text_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW( this->w.t_script ) );
+
+    gtk_text_buffer_get_start_iter(text_buffer,&start);
+    gtk_text_buffer_get_end_iter(text_buffer,&end);
+    return gtk_text_buffer_get_text(text_buffer,&start,&end,FALSE);
 }
 
 /**
- * \brief the function get the output filename for filter script.
+ * \brief the function gets the command of the interpreter of the script.
  */
-gchar *gms_get_filter_filename( gms_handle_t hnd )
+gchar *gms_get_script_cmd(
+    gms_handle_t hnd /**< handle of mini-script data structure */
+    )
 {
     gms_private_t *this = GMS_PRIVATE( hnd ) ;
-    return this->filter_name->str ;
+    gint ii_script = gtk_combo_box_get_active(GTK_COMBO_BOX(this->w.cb_st) ) ;
+
+    return this->script_cmd[ii_script]->str ;
 }
 
 /**
- * \brief the function get the error filename for filter script.
+ * \brief the function gets the type of the worker to run the script with.
+ * \return WORKER_NONE when the script must run in its own process.
  */
-gchar *gms_get_error_filename(
+gms_worker_type_t gms_get_worker_type(
     gms_handle_t hnd /**< handle of mini-script data structure */
     )
 {
     gms_private_t *this = GMS_PRIVATE( hnd ) ;
-    return this->error_name->str ;
+    gint ii_script = gtk_combo_box_get_active(GTK_COMBO_BOX(this->w.cb_st) ) ;
+
+    if ( ! this->persistent )
+        return WORKER_NONE ;
+    return worker_type[ii_script] ;
 }
 
 /**
- * \brief the function creates the filter file.
+ * \brief the function tells whether the interpreters are kept running.
  */
-void  gms_create_filter_file(
+gboolean gms_get_persistent(
     gms_handle_t hnd /**< handle of mini-script data structure */
     )
 {
     gms_private_t *this = GMS_PRIVATE( hnd ) ;
-    gchar           *contents = NULL;
-    GtkTextIter      start;
-    GtkTextIter      end;
-    GtkTextBuffer   *text_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW( this->w.t_script ) );
-
-    gtk_text_buffer_get_start_iter(text_buffer,&start);
-    gtk_text_buffer_get_end_iter(text_buffer,&end);
-    contents=gtk_text_buffer_get_text(text_buffer,&start,&end,FALSE);
-    g_file_set_contents(this->filter_name->str, contents, -1 , NULL );
-    GMS_G_FREE(contents);
+    return this->persistent ;
 }
 
 /**
  * \brief the function creates the command string.
+ * \note the filter reads its standard input and writes its standard output.
  */
 gchar *gms_get_str_command(
     gms_handle_t hnd /**< handle of mini-script data structure */
@@ -719,12 +730,9 @@ gchar *gms_get_str_command(
     gms_private_t *this = GMS_PRIVATE( hnd ) ;
     gint ii_script = gtk_combo_box_get_active(GTK_COMBO_BOX(this->w.cb_st) ) ;
 
-    g_string_printf( this->cmd,"cat %s | %s %s > %s 2> %s",
-                                this->input_name->str,
-                                    this->script_cmd[ii_script]->str,
-                                        this->filter_name->str,
-                                            this->output_name->str,
-                                                this->error_name->str );
+    g_string_printf( this->cmd,"%s %s",
+                                this->script_cmd[ii_script]->str,
+                                    this->filter_name->str );
     return this->cmd->str  ;
 }
 
@@ -761,6 +769,13 @@ GtkWidget   *gms_configure_gui(
         gtk_table_attach_defaults(GTK_TABLE(t_script),this->w.e_script[ii], 1,2,ii,ii+1 );
     }
 
+    this->w.c_persistent = gtk_check_button_new_with_label(
+        _("Keep the Perl and Python interpreters running between filters"));
+    gtk_widget_set_tooltip_text(this->w.c_persistent,
+        _("Filters are faster to start, but they share the interpreter with the previous ones"));
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(this->w.c_persistent), this->persistent);
+    gtk_box_pack_start( GTK_BOX (vb_pref), this->w.c_persistent, FALSE, FALSE, 0);
+
     gtk_widget_show_all(vb_pref);
     return vb_pref ;
 }
@@ -778,6 +793,7 @@ void on_gms_configure_response(GtkDialog *dialog, gint response, gpointer user_d
         for ( ii = 0 ; ii <GMS_NB_TYPE_SCRIPT ;ii++ )
             if (this->w.e_script[ii]!=NULL )
                 g_string_assign( this->script_cmd[ii] , gtk_entry_get_text(GTK_ENTRY(this->w.e_script[ii])));
+        this->persistent = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(this->w.c_persistent));
         save_prefs_file(this);
     }
 }
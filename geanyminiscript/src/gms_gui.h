@@ -37,15 +37,23 @@ typedef enum {
     OUT_NEW_DOC        =1
 } gms_output_t ;
 
+typedef enum {
+    WORKER_NONE     =0,
+    WORKER_PERL     =1,
+    WORKER_PYTHON   =2,
+    WORKER_COUNT    =3
+} gms_worker_type_t ;
+
 gms_handle_t gms_new(  GtkWidget *mw, gchar *font, gint tabs, gchar *config_dir);
 void        gms_delete( gms_handle_t *hnd );
 int         gms_dlg( gms_handle_t hnd ) ;
-gchar       *gms_get_in_filename( gms_handle_t hnd ) ;
-gchar       *gms_get_out_filename( gms_handle_t hnd ) ;
 gchar       *gms_get_filter_filename( gms_handle_t hnd ) ;
-gchar       *gms_get_error_filename( gms_handle_t hnd ) ;
 void        gms_create_filter_file( gms_handle_t hnd ) ;
 gchar       *gms_get_str_command( gms_handle_t hnd ) ;
+gchar       *gms_get_script_text( gms_handle_t hnd ) ;
+gchar       *gms_get_script_cmd( gms_handle_t hnd ) ;
+gms_worker_type_t gms_get_worker_type( gms_handle_t hnd ) ;
+gboolean     gms_get_persistent( gms_handle_t hnd ) ;
 gms_input_t  gms_get_input_mode( gms_handle_t hnd );
 gms_output_t gms_get_output_mode( gms_handle_t hnd );
 
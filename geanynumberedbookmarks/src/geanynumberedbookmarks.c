@@ -21,6 +21,8 @@
 #include <gtk/gtk.h>
 #include <glib/gstdio.h>
 
+#include "startprof.h"
+
 static const gint base64_char_to_int[]=
 {
   255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
@@ -43,10 +45,15 @@ typedef struct FileData
 	gint iBookmark[10];   /* holds bookmark lines or -1 for not set */
 	gint iBookmarkMarkerUsed[10]; /*holds which marker (2-24) is used for this bookmark */
 	gint iBookmarkLinePos[10]; /* holds position of cursor in line */
-	gchar *pcFolding;     /* holds which folds are open and which not */
+	gchar *pcFolding;     /* holds which folds are closed: ranges of lines, or base64 bits */
+	gboolean bFoldingIsBits; /* TRUE if pcFolding is base64 bits (as saved by older versions) */
 	gint LastChangedTime; /* time file was last changed by this editor */
 	gchar *pcBookmarks;   /* holds non-numbered bookmarks */
-	struct FileData * NextNode;
+	gint iIndex;          /* number of entry in central settings file, or -1 for none */
+	gboolean bChanged;    /* TRUE if entry in central settings file needs rewriting */
+	gboolean bLocalKnown; /* TRUE once details file alongside file has been read or written */
+	gint LocalChangedTime; /* time details file alongside file was last changed, -1 for none */
+	gchar *pcLocalData;   /* contents of details file alongside file when last read or written */
 } FileData;
 
 
@@ -72,8 +79,24 @@ static gboolean bRememberBookmarks=TRUE;
 
 /* internal variables */
 static gint iShiftNumbers[]={41,33,34,163,36,37,94,38,42,40};
-static FileData *fdKnownFilesSettings=NULL;
+static GHashTable *htKnownFilesSettings=NULL; /* FileData for each filename */
+static FileData *fdUntitledFileSettings=NULL; /* FileData for documents without a filename */
 static gulong key_release_signal_id;
+static guint iLoadPendingIdleID=0;
+
+/* central settings file is kept in memory so only the entries of files that have changed need
+ * updating. It is written a little while after the last change by a separate thread
+*/
+#define SAVE_SETTINGS_DELAY 1000
+static GKeyFile *gkfSettings=NULL;
+static gchar *pcSettingsFile=NULL;
+static gint iNextFileDataIndex=0;
+static GPtrArray *gpaChangedFileData=NULL;
+static guint iSaveSettingsTimeoutID=0;
+static GMutex *gmSettingsWrite=NULL; /* protects pcSettingsToWrite & bSettingsWriterRunning */
+static gchar *pcSettingsToWrite=NULL;
+static gboolean bSettingsWriterRunning=FALSE;
+static GThread *gtSettingsWriter=NULL;
 
 /* default config file */
 const gchar default_config[] =
@@ -304,62 +327,77 @@ static const gchar ** aszMarkerImages[]=
 };
 
 
+/* free a FileData structure and the data it holds */
+static void FreeFileData(gpointer data)
+{
+	FileData *fd=(FileData*)data;
+
+	/* free filename */
+	g_free(fd->pcFileName);
+	/* free folding & bookmark information if present */
+	g_free(fd->pcFolding);
+	g_free(fd->pcBookmarks);
+	g_free(fd->pcLocalData);
+
+	/* free memory block  */
+	g_free(fd);
+}
+
+
 /* return a FileData structure for a file
  * if not come across this file before then create one, otherwise return existing structure with
  * data in it
- * returns NULL on error
+ * Geany's filenames are already absolute real paths so can be used as they are to find the file
 */
 static FileData * GetFileData(gchar *pcFileName)
 {
-	FileData *fdTemp=fdKnownFilesSettings;
+	FileData *fdTemp;
 	gint i;
 
-	/* First handle if main pointer doesn't point to anything */
-	if(fdTemp==NULL)
-	{
-		if((fdKnownFilesSettings=(FileData*)(g_malloc(sizeof *fdTemp)))!=NULL)
-		{
-			fdKnownFilesSettings->pcFileName=g_strdup(pcFileName);
-			for(i=0;i<10;i++)
-				fdKnownFilesSettings->iBookmark[i]=-1;
+	/* documents without a filename all share one structure, which is never saved */
+	if(pcFileName==NULL)
+		fdTemp=fdUntitledFileSettings;
+	else
+		fdTemp=(FileData*)(g_hash_table_lookup(htKnownFilesSettings,pcFileName));
 
-			/* don't need to initiate iBookmarkLinePos */
-			fdKnownFilesSettings->pcFolding=NULL;
-			fdKnownFilesSettings->LastChangedTime=-1;
-			fdKnownFilesSettings->pcBookmarks=NULL;
-			fdKnownFilesSettings->NextNode=NULL;
-		}
-		return fdKnownFilesSettings;
-	}
+	/* if have found relavent FileData, then exit */
+	if(fdTemp!=NULL)
+		return fdTemp;
 
-	/* move through chain to the correct entry or the end of a chain */
-	while(TRUE)
-	{
-		/* if have found relavent FileData, then exit */
-		if(utils_str_equal(pcFileName,fdTemp->pcFileName)==TRUE)
-			return fdTemp;
+	/* otherwise add new entry, and return it. */
+	fdTemp=g_new(FileData,1);
+	fdTemp->pcFileName=g_strdup(pcFileName);
+	for(i=0;i<10;i++)
+		fdTemp->iBookmark[i]=-1;
+
+	/* don't need to initiate iBookmarkLinePos */
+	fdTemp->pcFolding=NULL;
+	fdTemp->bFoldingIsBits=FALSE;
+	fdTemp->LastChangedTime=-1;
+	fdTemp->pcBookmarks=NULL;
+	fdTemp->iIndex=-1;
+	fdTemp->bChanged=FALSE;
+	fdTemp->bLocalKnown=FALSE;
+	fdTemp->LocalChangedTime=-1;
+	fdTemp->pcLocalData=NULL;
+
+	if(pcFileName==NULL)
+		fdUntitledFileSettings=fdTemp;
+	else
+		g_hash_table_insert(htKnownFilesSettings,fdTemp->pcFileName,fdTemp);
 
-		/* if end of chain, then add new entry, and return it. */
-		if(fdTemp->NextNode==NULL)
-		{
-			if((fdTemp->NextNode=(FileData*)(g_malloc(sizeof *fdTemp)))!=NULL)
-			{
-				fdTemp->NextNode->pcFileName=g_strdup(pcFileName);
-				for(i=0;i<10;i++)
-					fdTemp->NextNode->iBookmark[i]=-1;
-
-				/* don't need to initiate iBookmarkLinePos */
-				fdTemp->NextNode->pcFolding=NULL;
-				fdTemp->NextNode->LastChangedTime=-1;
-				fdTemp->NextNode->pcBookmarks=NULL;
-				fdTemp->NextNode->NextNode=NULL;
-			}
-			return fdTemp->NextNode;
+	return fdTemp;
+}
 
-		}
-		fdTemp=fdTemp->NextNode;
 
-	}
+/* note that entry for file in central settings file needs updating when next saved */
+static void FileDataChanged(FileData *fd)
+{
+	if(fd->pcFileName==NULL || fd->bChanged)
+		return;
+
+	fd->bChanged=TRUE;
+	g_ptr_array_add(gpaChangedFileData,fd);
 }
 
 
@@ -392,8 +430,8 @@ static gboolean SaveIndividualSetting(GKeyFile *gkf,FileData *fd,gint iNumber,gc
 	if(Filename!=NULL)
 		g_key_file_set_string(gkf,"FileData",cKey,Filename);
 
-	/* save folding data */
-	cKey[0]='B';
+	/* save folding data. Bits are only kept until the file is next saved */
+	cKey[0]=(fd->bFoldingIsBits)?'B':'G';
 	if(fd->pcFolding!=NULL && bRememberFolds==TRUE)
 		g_key_file_set_string(gkf,"FileData",cKey,fd->pcFolding);
 
@@ -463,56 +501,159 @@ static gboolean SaveIndividualSetting(GKeyFile *gkf,FileData *fd,gint iNumber,gc
 }
 
 
-/* save settings (preferences, file data such as fold states, marker positions) */
-static void SaveSettings(gchar *filename)
+/* remove individual file details from central settings */
+static void RemoveIndividualSetting(GKeyFile *gkf,gint iNumber)
 {
-	GKeyFile *config=NULL;
-	gchar *config_file=NULL,*config_dir=NULL;
-	gchar *data;
-	FileData* fdTemp=fdKnownFilesSettings;
-	gint i=0;
+	gchar *cKey;
+	gchar c;
+
+	cKey=g_strdup_printf("A%d",iNumber);
+	for(c='A';c<='G';c++)
+	{
+		cKey[0]=c;
+		g_key_file_remove_key(gkf,"FileData",cKey,NULL);
+	}
+
+	g_free(cKey);
+}
+
+
+/* write central settings data handed over by WriteSettingsData until there is no more */
+static gpointer SettingsWriterThread(gpointer data)
+{
+	gchar *pcData;
+
+	while(TRUE)
+	{
+		g_mutex_lock(gmSettingsWrite);
+		pcData=pcSettingsToWrite;
+		pcSettingsToWrite=NULL;
+		if(pcData==NULL)
+			bSettingsWriterRunning=FALSE;
+		g_mutex_unlock(gmSettingsWrite);
+
+		if(pcData==NULL)
+			return NULL;
+
+		g_file_set_contents(pcSettingsFile,pcData,-1,NULL);
+		g_free(pcData);
+	}
+}
 
-	/* create new config from default settings */
-	config=g_key_file_new();
+
+/* hand data to the writer thread to write to central settings file, replacing any older data it
+ * hasn't got round to writing yet. Takes ownership of pcData
+*/
+static void WriteSettingsData(gchar *pcData)
+{
+	gboolean bStartWriter;
+
+	g_mutex_lock(gmSettingsWrite);
+	g_free(pcSettingsToWrite);
+	pcSettingsToWrite=pcData;
+	bStartWriter=!bSettingsWriterRunning;
+	bSettingsWriterRunning=TRUE;
+	g_mutex_unlock(gmSettingsWrite);
+
+	if(!bStartWriter)
+		return;
+
+	/* any previous writer has finished so tidy it up before starting a new one */
+	if(gtSettingsWriter!=NULL)
+		g_thread_join(gtSettingsWriter);
+
+	gtSettingsWriter=g_thread_create(SettingsWriterThread,NULL,TRUE,NULL);
+	/* if unable to start thread then write data ourselves */
+	if(gtSettingsWriter==NULL)
+		SettingsWriterThread(NULL);
+}
+
+
+/* update central settings with preferences and changed file details then have them written */
+static void FlushSettings(void)
+{
+	FileData *fd;
+	guint i;
+	gint iNumber;
 
 	/* now set settings */
-	g_key_file_set_boolean(config,"Settings","Center_When_Goto_Bookmark",bCenterWhenGotoBookmark);
-	g_key_file_set_boolean(config,"Settings","Remember_Folds",bRememberFolds);
-	g_key_file_set_integer(config,"Settings","Position_In_Line",PositionInLine);
-	g_key_file_set_integer(config,"Settings","Where_To_Save_File_Details",WhereToSaveFileDetails);
-	g_key_file_set_boolean(config,"Settings","Remember_Bookmarks",bRememberBookmarks);
+	g_key_file_set_boolean(gkfSettings,"Settings","Center_When_Goto_Bookmark",
+	                       bCenterWhenGotoBookmark);
+	g_key_file_set_boolean(gkfSettings,"Settings","Remember_Folds",bRememberFolds);
+	g_key_file_set_integer(gkfSettings,"Settings","Position_In_Line",PositionInLine);
+	g_key_file_set_integer(gkfSettings,"Settings","Where_To_Save_File_Details",
+	                       WhereToSaveFileDetails);
+	g_key_file_set_boolean(gkfSettings,"Settings","Remember_Bookmarks",bRememberBookmarks);
 	if(FileDetailsSuffix!=NULL)
-		g_key_file_set_string(config,"Settings","File_Details_Suffix",FileDetailsSuffix);
+		g_key_file_set_string(gkfSettings,"Settings","File_Details_Suffix",FileDetailsSuffix);
 
-	/* now save file data */
-	while(fdTemp!=NULL)
+	/* now replace entries of files that have changed, keeping the number they already have */
+	for(i=0;i<gpaChangedFileData->len;i++)
 	{
-		/* if this entry has data needing saveing then save it and increment the counter */
-		if(SaveIndividualSetting(config,fdTemp,i,fdTemp->pcFileName))
-			i++;
+		fd=(FileData*)(g_ptr_array_index(gpaChangedFileData,i));
+		fd->bChanged=FALSE;
 
-		fdTemp=fdTemp->NextNode;
+		if(fd->iIndex!=-1)
+		{
+			RemoveIndividualSetting(gkfSettings,fd->iIndex);
+			iNumber=fd->iIndex;
+		}
+		else
+			iNumber=iNextFileDataIndex;
+
+		/* if this entry has data needing saveing then save it, otherwise it has no entry */
+		if(SaveIndividualSetting(gkfSettings,fd,iNumber,fd->pcFileName))
+		{
+			if(fd->iIndex==-1)
+				iNextFileDataIndex++;
+			fd->iIndex=iNumber;
+		}
+		else
+			fd->iIndex=-1;
 	}
+	g_ptr_array_set_size(gpaChangedFileData,0);
 
-	/* turn config into data */
-	data=g_key_file_to_data(config,NULL,NULL);
+	/* turn config into data, and write it */
+	WriteSettingsData(g_key_file_to_data(gkfSettings,NULL,NULL));
+}
 
-	/* calculate setting directory name */
-	config_dir=g_build_filename(geany->app->configdir,"plugins","Geany_Numbered_Bookmarks",NULL);
-	/* ensure directory exists */
-	g_mkdir_with_parents(config_dir,0755);
 
-	/* make config_file hold name of settings file */
-	config_file=g_build_filename(config_dir,"settings.conf",NULL);
+/* save central settings once there have been no changes for a little while */
+static gboolean SaveSettingsTimeout(gpointer data)
+{
+	iSaveSettingsTimeoutID=0;
+	FlushSettings();
 
-	/* write data */
-	utils_write_file(config_file,data);
+	return FALSE;
+}
 
-	/* free memory */
-	g_free(config_dir);
-	g_free(config_file);
-	g_key_file_free(config);
-	g_free(data);
+
+/* save settings (preferences, file data such as fold states, marker positions)
+ * filename is the file whose details have changed, or NULL if the preferences have changed
+*/
+static void SaveSettings(gchar *filename)
+{
+	GKeyFile *config=NULL;
+	gchar *config_file=NULL;
+	gchar *data;
+	FileData* fdTemp;
+	GHashTableIter iter;
+	struct stat sBuf;
+
+	/* preferences affect what is saved for every file, so then they all need rewriting */
+	if(filename==NULL)
+	{
+		g_hash_table_iter_init(&iter,htKnownFilesSettings);
+		while(g_hash_table_iter_next(&iter,NULL,(gpointer*)(&fdTemp)))
+			FileDataChanged(fdTemp);
+	}
+	else
+		FileDataChanged(GetFileData(filename));
+
+	/* (re)start the delay before the central settings file is written */
+	if(iSaveSettingsTimeoutID!=0)
+		g_source_remove(iSaveSettingsTimeoutID);
+	iSaveSettingsTimeoutID=g_timeout_add(SAVE_SETTINGS_DELAY,SaveSettingsTimeout,NULL);
 
 	/* now consider if not purely saving file settings to main settings file */
 	/* return if not saving data with file */
@@ -528,20 +669,32 @@ static void SaveSettings(gchar *filename)
 	/* calculate settings filename */
 	config_file=g_strdup_printf("%s%s",filename,FileDetailsSuffix);
 
-	/* if nothing to save then delete any old data */
+	/* if nothing to save then delete any old data, unless known there isn't any */
 	if(SaveIndividualSetting(config,fdTemp,-1,NULL)==FALSE)
-		g_remove(config_file);
-	/* otherwise save the data */
+	{
+		if(!fdTemp->bLocalKnown || fdTemp->LocalChangedTime!=-1)
+			g_remove(config_file);
+
+		data=NULL;
+	}
+	/* otherwise save the data, unless it is what the file already holds */
 	else
 	{
 		/* turn config into data */
 		data=g_key_file_to_data(config,NULL,NULL);
-		/* write data */
-		utils_write_file(config_file,data);
 
-		g_free(data);
+		if(!fdTemp->bLocalKnown || fdTemp->pcLocalData==NULL ||
+		   strcmp(fdTemp->pcLocalData,data)!=0 || stat(config_file,&sBuf)!=0 ||
+		   sBuf.st_mtime!=fdTemp->LocalChangedTime)
+			utils_write_file(config_file,data);
 	}
 
+	/* remember what the file now holds so it needn't be read or written again */
+	g_free(fdTemp->pcLocalData);
+	fdTemp->pcLocalData=data;
+	fdTemp->bLocalKnown=TRUE;
+	fdTemp->LocalChangedTime=(data!=NULL && stat(config_file,&sBuf)==0)?sBuf.st_mtime:-1;
+
 	/* free memory */
 	g_free(config_file);
 	g_key_file_free(config);
@@ -582,14 +735,28 @@ static gboolean LoadIndividualSetting(GKeyFile *gkf,gint iNumber,gchar *Filename
 
 		fd=GetFileData(pcTemp);
 		g_free(pcTemp);
+
+		/* if file is in central file more than once then only keep this entry */
+		if(fd->iIndex!=-1 && fd->iIndex!=iNumber)
+			RemoveIndividualSetting(gkf,fd->iIndex);
+		fd->iIndex=iNumber;
 	}
 
-	/* get folding data */
-	pcKey[0]='B';
+	/* get folding data, falling back to the bits saved by older versions */
+	g_free(fd->pcFolding);
+	fd->pcFolding=NULL;
+	fd->bFoldingIsBits=FALSE;
 	if(bRememberFolds==TRUE)
+	{
+		pcKey[0]='G';
 		fd->pcFolding=(gchar*)(utils_get_setting_string(gkf,"FileData",pcKey,NULL));
-	else
-		fd->pcFolding=NULL;
+		if(fd->pcFolding==NULL)
+		{
+			pcKey[0]='B';
+			fd->pcFolding=(gchar*)(utils_get_setting_string(gkf,"FileData",pcKey,NULL));
+			fd->bFoldingIsBits=(fd->pcFolding!=NULL);
+		}
+	}
 
 	/* load last saved time */
 	pcKey[0]='C';
@@ -649,65 +816,110 @@ static gboolean LoadIndividualSetting(GKeyFile *gkf,gint iNumber,gchar *Filename
 /* load settings (preferences, file data, and macro data) */
 static void LoadSettings(void)
 {
-	gint i;
-	gchar *config_file=NULL;
+	gint i,l;
 	gchar *config_dir=NULL;
-	GKeyFile *config=NULL;
+	gchar **pcKeys;
+	gchar *pcEnd;
 
 	/* Make config_dir hold directory name of settings file */
 	config_dir=g_build_filename(geany->app->configdir,"plugins","Geany_Numbered_Bookmarks",NULL);
 	/* ensure directory exists */
 	g_mkdir_with_parents(config_dir,0755);
 
-	/* make config_file hold name of settings file */
-	config_file=g_build_filename(config_dir,"settings.conf",NULL);
+	/* make pcSettingsFile hold name of settings file */
+	pcSettingsFile=g_build_filename(config_dir,"settings.conf",NULL);
 
 	/* either load settings file, or create one from default */
-	config=g_key_file_new();
-	if(!g_key_file_load_from_file(config,config_file, G_KEY_FILE_KEEP_COMMENTS,NULL))
-		g_key_file_load_from_data(config,default_config,sizeof(default_config),
+	gkfSettings=g_key_file_new();
+	if(!g_key_file_load_from_file(gkfSettings,pcSettingsFile,G_KEY_FILE_KEEP_COMMENTS,NULL))
+		g_key_file_load_from_data(gkfSettings,default_config,sizeof(default_config),
 								G_KEY_FILE_KEEP_COMMENTS,NULL);
 
 	/* extract settings */
-	bCenterWhenGotoBookmark=utils_get_setting_boolean(config,"Settings",
+	bCenterWhenGotoBookmark=utils_get_setting_boolean(gkfSettings,"Settings",
 	                        "Center_When_Goto_Bookmark",FALSE);
-	bRememberFolds=utils_get_setting_boolean(config,"Settings","Remember_Folds",FALSE);
-	PositionInLine=utils_get_setting_integer(config,"Settings","Position_In_Line",0);
-	WhereToSaveFileDetails=utils_get_setting_integer(config,"Settings",
+	bRememberFolds=utils_get_setting_boolean(gkfSettings,"Settings","Remember_Folds",FALSE);
+	PositionInLine=utils_get_setting_integer(gkfSettings,"Settings","Position_In_Line",0);
+	WhereToSaveFileDetails=utils_get_setting_integer(gkfSettings,"Settings",
 	                                                 "Where_To_Save_File_Details",0);
-	bRememberBookmarks=utils_get_setting_boolean(config,"Settings","Remember_Bookmarks",FALSE);
-	FileDetailsSuffix=utils_get_setting_string(config,"Settings","File_Details_Suffix",
+	bRememberBookmarks=utils_get_setting_boolean(gkfSettings,"Settings","Remember_Bookmarks",
+	                                             FALSE);
+	FileDetailsSuffix=utils_get_setting_string(gkfSettings,"Settings","File_Details_Suffix",
 	                                           ".gnbs.conf");
 
-	/* extract data about files */
-	i=0;
-	while(LoadIndividualSetting(config,i,NULL))
-		i++;
+	/* extract data about files. Entries are numbered, but there can be gaps where entries have
+	 * been removed, so look at each "A" key rather than counting up
+	*/
+	htKnownFilesSettings=g_hash_table_new_full(g_str_hash,g_str_equal,NULL,FreeFileData);
+	gpaChangedFileData=g_ptr_array_new();
+
+	pcKeys=g_key_file_get_keys(gkfSettings,"FileData",NULL,NULL);
+	for(i=0;pcKeys!=NULL && pcKeys[i]!=NULL;i++)
+	{
+		if(pcKeys[i][0]!='A' || !g_ascii_isdigit(pcKeys[i][1]))
+			continue;
+
+		l=strtol(pcKeys[i]+1,&pcEnd,10);
+		if(pcEnd[0]!=0)
+			continue;
+
+		if(LoadIndividualSetting(gkfSettings,l,NULL) && l>=iNextFileDataIndex)
+			iNextFileDataIndex=l+1;
+	}
 
 	/* free memory */
+	g_strfreev(pcKeys);
 	g_free(config_dir);
-	g_free(config_file);
-	g_key_file_free(config);
 }
 
 
-/* try to load localy saved file details */
+/* try to load localy saved file details. The parsed details are kept with the file's other
+ * details, so the file is only read again if it has changed since it was last read or written
+*/
 static void LoadLocalFileDetails(gchar *filename)
 {
 	gchar *config_file=NULL;
 	GKeyFile *config=NULL;
+	FileData *fd;
+	struct stat sBuf;
+	gchar *data;
+	gsize length;
+	gint i;
 
 	/* calculate settings filename */
 	config_file=g_strdup_printf("%s%s",filename,FileDetailsSuffix);
 
+	/* nothing to do if file is as it was when last read or written */
+	fd=GetFileData(filename);
+	if(stat(config_file,&sBuf)!=0)
+		sBuf.st_mtime=-1;
+	if(fd->bLocalKnown && fd->LocalChangedTime==sBuf.st_mtime)
+	{
+		g_free(config_file);
+		return;
+	}
+
+	g_free(fd->pcLocalData);
+	fd->pcLocalData=NULL;
+	fd->bLocalKnown=TRUE;
+	fd->LocalChangedTime=sBuf.st_mtime;
+
 	/* create keyfile to hold data */
 	config=g_key_file_new();
 
 	/* if can load settings file then extract the info */
-	if(g_key_file_load_from_file(config,config_file,G_KEY_FILE_KEEP_COMMENTS,NULL))
+	if(sBuf.st_mtime!=-1 && g_file_get_contents(config_file,&data,&length,NULL))
 	{
-		/* load file details */
-		LoadIndividualSetting(config,-1,filename);
+		if(g_key_file_load_from_data(config,data,length,G_KEY_FILE_KEEP_COMMENTS,NULL))
+		{
+			/* load file details, replacing any bookmarks read before */
+			for(i=0;i<10;i++)
+				fd->iBookmark[i]=-1;
+			LoadIndividualSetting(config,-1,filename);
+			fd->pcLocalData=data;
+		}
+		else
+			g_free(data);
 	}
 
 	/* free memory */
@@ -938,26 +1150,144 @@ _("Unable to apply all markers to '%s' as all being used."),
 }
 
 
-/* handler for when a document has been opened
+/* close the folds given as bits by older versions of this plugin, one bit per fold header (set if
+ * open), 6 to a base64 character
+*/
+static void ApplyFoldBits(ScintillaObject *sci,const gchar *pcFoldData)
+{
+	/* keep compiler happy & initialise iBits: will logically be initiated anyway */
+	gint i,iLineCount,iFlags,iBits=0,iBitCounter;
+
+	iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
+
+	/* go through lines setting fold status */
+	for(i=0,iBitCounter=6;i<iLineCount;i++)
+	{
+		iFlags=scintilla_send_message(sci,SCI_GETFOLDLEVEL,i,0);
+		/* ignore non-folding lines */
+		if((iFlags & SC_FOLDLEVELHEADERFLAG)==0)
+			continue;
+
+		/* get next 6 fold states if needed */
+		if(iBitCounter==6)
+		{
+			/* less headers now than when saved: the rest stay open */
+			if(*pcFoldData==0)
+				break;
+
+			iBitCounter=0;
+			iBits=base64_char_to_int[(gint)(*pcFoldData)];
+			pcFoldData++;
+		}
+
+		/* set fold if needed */
+		if(((iBits>>iBitCounter)&1)==0)
+			scintilla_send_message(sci,SCI_TOGGLEFOLD,i,0);
+
+		/* increment counter */
+		iBitCounter++;
+	}
+}
+
+
+/* close the folds whose header lines are in pcFoldData: comma separated hex line numbers, or
+ * ranges of them as "first-last"
+*/
+static void ApplyFoldRanges(ScintillaObject *sci,const gchar *pcFoldData)
+{
+	gint i,iFirst,iLast,iLineCount;
+	gchar *pcEnd;
+
+	iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
+
+	while(*pcFoldData!=0)
+	{
+		iFirst=strtol(pcFoldData,&pcEnd,16);
+		iLast=(*pcEnd=='-')?strtol(pcEnd+1,&pcEnd,16):iFirst;
+		/* stop at anything not understood */
+		if(pcEnd==pcFoldData || (*pcEnd!=',' && *pcEnd!=0))
+			break;
+
+		for(i=iFirst;i<=iLast && i<iLineCount;i++)
+			if((scintilla_send_message(sci,SCI_GETFOLDLEVEL,i,0) & SC_FOLDLEVELHEADERFLAG)!=0 &&
+			   scintilla_send_message(sci,SCI_GETFOLDEXPANDED,i,0)!=0)
+				scintilla_send_message(sci,SCI_TOGGLEFOLD,i,0);
+
+		pcFoldData=(*pcEnd==',')?pcEnd+1:pcEnd;
+	}
+}
+
+
+/* returns the next closed fold header from iLine onwards, or -1 if there are no more */
+static gint GetNextClosedFold(ScintillaObject *sci,gint iLine,gint iLineCount)
+{
+#ifdef SCI_CONTRACTEDFOLDNEXT
+	/* Scintilla keeps the closed folds apart, so can go straight to them */
+	return scintilla_send_message(sci,SCI_CONTRACTEDFOLDNEXT,iLine,0);
+#else
+	gint iFlags;
+
+	for(;iLine<iLineCount;iLine++)
+	{
+		iFlags=scintilla_send_message(sci,SCI_GETFOLDLEVEL,iLine,0);
+		/* only fold headers can be closed */
+		if((iFlags & SC_FOLDLEVELHEADERFLAG)==0)
+			continue;
+
+		if(scintilla_send_message(sci,SCI_GETFOLDEXPANDED,iLine,0)==0)
+			return iLine;
+	}
+
+	return -1;
+#endif
+}
+
+
+/* returns the lines of the closed folds as ranges, as read by ApplyFoldRanges, or NULL if all
+ * folds are open
+*/
+static gchar * GetFoldRanges(ScintillaObject *sci)
+{
+	GString *gsRanges=NULL;
+	gint iLine,iFirst,iLast,iLineCount;
+
+	iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
+
+	iLine=GetNextClosedFold(sci,0,iLineCount);
+	while(iLine!=-1)
+	{
+		/* gather closed folds on consecutive lines into one range */
+		iFirst=iLast=iLine;
+		while((iLine=GetNextClosedFold(sci,iLast+1,iLineCount))==iLast+1)
+			iLast=iLine;
+
+		if(gsRanges==NULL)
+			gsRanges=g_string_new(NULL);
+		else
+			g_string_append_c(gsRanges,',');
+
+		if(iFirst==iLast)
+			g_string_append_printf(gsRanges,"%X",iFirst);
+		else
+			g_string_append_printf(gsRanges,"%X-%X",iFirst,iLast);
+	}
+
+	return (gsRanges==NULL)?NULL:g_string_free(gsRanges,FALSE);
+}
+
+
+/* apply file settings to a document
  * this checks to see if a document has been altered since it was last saved in geany (as plugin
  * data may then be out of date for file)
- * It then applies file settings
 */
-static void on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data)
+static void ApplyFileDetails(GeanyDocument *doc)
 {
 	FileData *fd;
-	gint i,l=GTK_RESPONSE_ACCEPT,iLineCount;
+	gint i,l=GTK_RESPONSE_ACCEPT;
 	ScintillaObject* sci=doc->editor->sci;
 	struct stat sBuf;
 	GtkWidget *dialog;
-	gchar *cFoldData=NULL;
 	gchar *pcTemp;
-	/* keep compiler happy & initialise iBits: will logically be initiated anyway */
-	gint iBits=0,iFlags,iBitCounter;
-
-	/* if saving details in file alongside file we're editing then load it up */
-	if(WhereToSaveFileDetails==1)
-		LoadLocalFileDetails(doc->file_name);
 
 	/* check to see if file has changed since geany last saved it */
 	fd=GetFileData(doc->file_name);
@@ -986,36 +1316,13 @@ ill not be loaded.\nPress Ignore to try an load markers anyway."),doc->file_name
 			/* get fold settings if present and want to use them */
 			if(fd->pcFolding!=NULL && bRememberFolds==TRUE)
 			{
-				cFoldData=fd->pcFolding;
-
 				/* first ensure fold positions exist */
 				scintilla_send_message(sci,SCI_COLOURISE,0,-1);
 
-				iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
-
-				/* go through lines setting fold status */
-				for(i=0,iBitCounter=6;i<iLineCount;i++)
-				{
-					iFlags=scintilla_send_message(sci,SCI_GETFOLDLEVEL,i,0);
-					/* ignore non-folding lines */
-					if((iFlags & SC_FOLDLEVELHEADERFLAG)==0)
-						continue;
-
-					/* get next 6 fold states if needed */
-					if(iBitCounter==6)
-					{
-						iBitCounter=0;
-						iBits=base64_char_to_int[(gint)(*cFoldData)];
-						cFoldData++;
-					}
-
-					/* set fold if needed */
-					if(((iBits>>iBitCounter)&1)==0)
-						scintilla_send_message(sci,SCI_TOGGLEFOLD,i,0);
-
-					/* increment counter */
-					iBitCounter++;
-				}
+				if(fd->bFoldingIsBits)
+					ApplyFoldBits(sci,fd->pcFolding);
+				else
+					ApplyFoldRanges(sci,fd->pcFolding);
 			}
 
 			/* get non-numbered bookmark settings if present and want to use them */
@@ -1050,18 +1357,74 @@ ill not be loaded.\nPress Ignore to try an load markers anyway."),doc->file_name
 }
 
 
+/* apply file settings to a document opened while they were to be loaded from the file alongside
+ * it, reading that file now if it hasn't been already
+*/
+static void LoadPendingFileDetails(GeanyDocument *doc)
+{
+	GObject *sci=G_OBJECT(doc->editor->sci);
+
+	if(g_object_get_data(sci,"Geany_Numbered_Bookmarks_Pending")==NULL)
+		return;
+
+	g_object_set_data(sci,"Geany_Numbered_Bookmarks_Pending",NULL);
+	LoadLocalFileDetails(doc->file_name);
+	ApplyFileDetails(doc);
+}
+
+
+/* the document shown once the documents being opened are all open may not get activated again */
+static gboolean LoadPendingIdle(gpointer data)
+{
+	GeanyDocument *doc=document_get_current();
+
+	iLoadPendingIdleID=0;
+	if(doc!=NULL)
+		LoadPendingFileDetails(doc);
+
+	return FALSE;
+}
+
+
+/* handler for when a document has been opened
+ * if file settings are saved in a file alongside the document, reading that is left until the
+ * document is first shown, so restoring a session doesn't read one for every document
+*/
+static void on_document_open(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	if(WhereToSaveFileDetails!=1 || doc->file_name==NULL)
+	{
+		ApplyFileDetails(doc);
+		return;
+	}
+
+	g_object_set_data(G_OBJECT(doc->editor->sci),"Geany_Numbered_Bookmarks_Pending",
+	                  GINT_TO_POINTER(TRUE));
+	if(iLoadPendingIdleID==0)
+		iLoadPendingIdleID=g_idle_add(LoadPendingIdle,NULL);
+}
+
+
+/* handler for when a document is shown, or about to be saved (which would otherwise replace
+ * settings not yet loaded)
+*/
+static void on_document_activate(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	LoadPendingFileDetails(doc);
+}
+
+
 /* handler for when a document has been saved
  * This saves off fold state, and marker positions for the file
 */
 static void on_document_save(GObject *obj, GeanyDocument *doc, gpointer user_data)
 {
 	FileData *fd;
-	gint i,iLineCount,iFlags,iBitCounter=0;
+	gint i;
 	ScintillaObject* sci=doc->editor->sci;
 	struct stat sBuf;
 	GByteArray *gbaFoldData=NULL;
-	guint8 guiFold=0;
-	gboolean bHasClosedFold=FALSE,bHasBookmark=FALSE;
+	gboolean bHasBookmark=FALSE;
 	gchar szLine[20];
 
 	/* update markerpos */
@@ -1071,53 +1434,12 @@ static void on_document_save(GObject *obj, GeanyDocument *doc, gpointer user_dat
 		                                        1<<(fd->iBookmarkMarkerUsed[i]));
 
 	/* save fold state */
-	if(bRememberFolds==TRUE)
-	{
-		gbaFoldData=g_byte_array_sized_new(1000);
-
-		iLineCount=scintilla_send_message(sci,SCI_GETLINECOUNT,0,0);
-		/* go through each line */
-		for(i=0;i<iLineCount;i++)
-		{
-			iFlags=scintilla_send_message(sci,SCI_GETFOLDLEVEL,i,0);
-			/* ignore line if not a folding point */
-			if((iFlags & SC_FOLDLEVELHEADERFLAG)==0)
-				continue;
-
-			iFlags=scintilla_send_message(sci,SCI_GETFOLDEXPANDED,i,0);
-			/* make note of if any folds closed or not */
-			bHasClosedFold|=((iFlags&1)==0);
-			/* remember if folded or not */
-			guiFold|=(iFlags&1)<<iBitCounter;
-			iBitCounter++;
-			if(iBitCounter<6)
-				continue;
-
-			/* if have 6 bits then store these */
-			iBitCounter=0;
-			guiFold=(guint8)base64_int_to_char[guiFold];
-			g_byte_array_append(gbaFoldData,&guiFold,1);
-			guiFold=0;
-		}
-
-		/* flush buffer */
-		if(iBitCounter!=0)
-		{
-			guiFold=(guint8)base64_int_to_char[guiFold];
-			g_byte_array_append(gbaFoldData,&guiFold,1);
-		}
-
-		/* transfer data to text string if have closed fold. Default will leave them open*/
-		fd->pcFolding=(!bHasClosedFold)?NULL:g_strndup((gchar*)(gbaFoldData->data),
-	                                               gbaFoldData->len);
-
-		/* free byte array space */
-		g_byte_array_free(gbaFoldData,TRUE);
-	}
-	else
-		fd->pcFolding=NULL;
+	g_free(fd->pcFolding);
+	fd->pcFolding=(bRememberFolds==TRUE)?GetFoldRanges(sci):NULL;
+	fd->bFoldingIsBits=FALSE;
 
 	/* now save off bookmarks */
+	g_free(fd->pcBookmarks);
 	if(bRememberBookmarks==TRUE)
 	{
 		gbaFoldData=g_byte_array_sized_new(1000);
@@ -1153,9 +1475,14 @@ static void on_document_save(GObject *obj, GeanyDocument *doc, gpointer user_dat
 }
 
 
+GP_STARTUP_PROFILE_DOCUMENT_OPEN_HANDLER(on_document_open_profiled, on_document_open)
+
+
 PluginCallback plugin_callbacks[] =
 {
-	{ "document-open", (GCallback) &on_document_open, FALSE, NULL },
+	{ "document-open", (GCallback) &on_document_open_profiled, FALSE, NULL },
+	{ "document-activate", (GCallback) &on_document_activate, FALSE, NULL },
+	{ "document-before-save", (GCallback) &on_document_activate, FALSE, NULL },
 	{ "document-save", (GCallback) &on_document_save, FALSE, NULL },
 	{ NULL, NULL, FALSE, NULL }
 };
@@ -1401,6 +1728,7 @@ static void SetBookMark(gint iBookMark)
 		/* otherwise ok to set marker */
 		SetMarker(sci,iBookMark,m,iNewLine);
 		fd->iBookmarkLinePos[iBookMark]=iPosInLine;
+		FileDataChanged(fd);
 	}
 	/* else if have to remove marker from current line */
 	else if(iOldLine==iNewLine)
@@ -1421,6 +1749,7 @@ static void SetBookMark(gint iBookMark)
 		/* there should be one free */
 		SetMarker(sci,iBookMark,m,iNewLine);
 		fd->iBookmarkLinePos[iBookMark]=iPosInLine;
+		FileDataChanged(fd);
 	}
 }
 
@@ -1468,11 +1797,17 @@ static gboolean Key_Released_CallBack(GtkWidget *widget, GdkEventKey *ev, gpoint
 
 
 /* set up this plugin */
-void plugin_init(GeanyData *data)
+static void init_plugin(GeanyData *data)
 {
 	gint i,k,iResults=0;
 	GdkKeymapKey *gdkkmkResults;
 
+	/* central settings file is written in a separate thread */
+	plugin_module_make_resident(geany_plugin);
+	if(!g_thread_supported())
+		g_thread_init(NULL);
+	gmSettingsWrite=g_mutex_new();
+
 	/* Load settings */
 	LoadSettings();
 
@@ -1532,6 +1867,8 @@ void plugin_init(GeanyData *data)
 	                                       G_CALLBACK(Key_Released_CallBack),NULL);
 }
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init_plugin)
+
 
 /* clean up on exiting this plugin */
 void plugin_cleanup(void)
@@ -1539,12 +1876,12 @@ void plugin_cleanup(void)
 	gint k;
 	guint i;
 	ScintillaObject* sci;
-	FileData *fdTemp=fdKnownFilesSettings;
-	FileData *fdTemp2;
 	guint32 *markers;
 
 	/* uncouple keypress monitor */
 	g_signal_handler_disconnect(geany->main_widgets->window,key_release_signal_id);
+	if(iLoadPendingIdleID!=0)
+		g_source_remove(iLoadPendingIdleID);
 
 	/* go through all documents removing markers (?needed) */
 	for(i=0;i<GEANY(documents_array)->len;i++)
@@ -1558,21 +1895,25 @@ void plugin_cleanup(void)
 			g_free(markers);
 		}
 
-	/* Clear memory used to hold file details */
-	while(fdTemp!=NULL)
+	/* write any settings still waiting to be saved, and wait for them to be written */
+	if(iSaveSettingsTimeoutID!=0)
 	{
-		/* free filename */
-		g_free(fdTemp->pcFileName);
-		/* free folding & bookmark information if present */
-		g_free(fdTemp->pcFolding);
-		g_free(fdTemp->pcBookmarks);
-
-		fdTemp2=fdTemp->NextNode;
-		/* free memory block  */
-		g_free(fdTemp);
-		fdTemp=fdTemp2;
+		g_source_remove(iSaveSettingsTimeoutID);
+		iSaveSettingsTimeoutID=0;
+		FlushSettings();
 	}
+	if(gtSettingsWriter!=NULL)
+		g_thread_join(gtSettingsWriter);
+	g_mutex_free(gmSettingsWrite);
+
+	/* Clear memory used to hold file details */
+	g_ptr_array_free(gpaChangedFileData,TRUE);
+	g_hash_table_destroy(htKnownFilesSettings);
+	if(fdUntitledFileSettings!=NULL)
+		FreeFileData(fdUntitledFileSettings);
 
 	/* free memory used for settings */
+	g_key_file_free(gkfSettings);
+	g_free(pcSettingsFile);
 	g_free(FileDetailsSuffix);
 }
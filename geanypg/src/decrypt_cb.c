@@ -21,58 +21,64 @@
 
 #include "geanypg.h"
 
-static void geanypg_decrypt_verify(encrypt_data * ed)
+static int geanypg_decrypt_verify_done(encrypt_data * ed, gpgme_error_t err)
 {
-    gpgme_data_t plain, cipher;
-    gpgme_error_t err;
-    FILE * tempfile;
-
-    tempfile = tmpfile();
-    if (!(tempfile))
-    {
-        fprintf(stderr, "GeanyPG: %s: %s.\n", _("couldn't create tempfile"), strerror(errno));
-        return ;
-    }
-    gpgme_data_new_from_stream(&plain, tempfile);
-
-    geanypg_load_buffer(&cipher);
-
-    err = gpgme_op_decrypt_verify(ed->ctx, cipher, plain);
-    if (gpgme_err_code(err) == GPG_ERR_NO_DATA) /* no encription, but maybe signatures */
+    if (gpgme_err_code(err) == GPG_ERR_NO_DATA && !ed->sig) /* no encription, but maybe signatures */
     {
-        /* maybe reaload cipher */
-        gpgme_data_release(cipher);
-        geanypg_load_buffer(&cipher);
-        rewind(tempfile);
-        err = gpgme_op_verify(ed->ctx, cipher, NULL, plain);
+        /* reload cipher, the text being read again as the signed message */
+        gpgme_data_release(ed->input);
+        geanypg_load_buffer(ed, &ed->sig);
+        ed->input = NULL;
+        rewind(ed->tempfile);
+        err = gpgme_op_verify_start(ed->ctx, ed->sig, NULL, ed->output);
+        if (err == GPG_ERR_NO_ERROR)
+            return 1;
     }
     if (err != GPG_ERR_NO_ERROR)
         geanypg_show_err_msg(err);
     else
     {
-        rewind(tempfile);
-        geanypg_write_file(tempfile);
+        geanypg_write_file(ed);
         geanypg_handle_signatures(ed, 0);
     }
+    return 0;
+}
+
+/* starts decrypting, ed is released once it is done */
+static void geanypg_decrypt_verify(encrypt_data * ed)
+{
+    gpgme_error_t err;
+
+    if (!geanypg_open_output(ed, &ed->output))
+    {
+        geanypg_free_ed(ed);
+        return ;
+    }
+
+    geanypg_load_buffer(ed, &ed->input);
 
-    fclose(tempfile);
-    /* release buffers */
-    gpgme_data_release(cipher);
-    gpgme_data_release(plain);
+    geanypg_run(ed, geanypg_decrypt_verify_done);
+    err = gpgme_op_decrypt_verify_start(ed->ctx, ed->input, ed->output);
+    if (err != GPG_ERR_NO_ERROR)
+        geanypg_start_failed(ed, err);
 }
 
 void geanypg_decrypt_cb(GtkMenuItem * menuitem, gpointer user_data)
 {
-    encrypt_data ed;
+    encrypt_data * ed = geanypg_new_ed();
     gpgme_error_t err;
-    geanypg_init_ed(&ed);
-    err = gpgme_new(&ed.ctx);
+    err = gpgme_new(&ed->ctx);
     if (err && geanypg_show_err_msg(err))
+    {
+        geanypg_free_ed(ed);
+        return;
+    }
+    gpgme_set_protocol(ed->ctx, GPGME_PROTOCOL_OpenPGP);
+    gpgme_set_passphrase_cb(ed->ctx, geanypg_passphrase_cb, NULL);
+    if (geanypg_get_keys(ed) && geanypg_get_secret_keys(ed))
+    {
+        geanypg_decrypt_verify(ed);
         return;
-    gpgme_set_protocol(ed.ctx, GPGME_PROTOCOL_OpenPGP);
-    gpgme_set_passphrase_cb(ed.ctx, geanypg_passphrase_cb, NULL);
-    if (geanypg_get_keys(&ed) && geanypg_get_secret_keys(&ed))
-        geanypg_decrypt_verify(&ed);
-    geanypg_release_keys(&ed);
-    gpgme_release(ed.ctx);
+    }
+    geanypg_free_ed(ed);
 }
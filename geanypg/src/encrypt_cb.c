@@ -21,60 +21,61 @@
 
 #include "geanypg.h"
 
+static int geanypg_encrypt_done(encrypt_data * ed, gpgme_error_t err)
+{
+    if (err != GPG_ERR_NO_ERROR && gpgme_err_code(err) != GPG_ERR_CANCELED)
+        geanypg_show_err_msg(err);
+    else if(gpgme_err_code(err) != GPG_ERR_CANCELED)
+        geanypg_write_file(ed);
+    return 0;
+}
+
+/* starts the encryption, ed is released once it is done */
 static void geanypg_encrypt(encrypt_data * ed, gpgme_key_t * recp, int sign, int flags)
 {   /* FACTORIZE */
-    gpgme_data_t plain, cipher;
     gpgme_error_t err;
-    FILE * tempfile;
-    tempfile = tmpfile();
-    if (!(tempfile))
+    if (!geanypg_open_output(ed, &ed->output))
     {
-        fprintf(stderr, "GeanyPG: %s: %s.\n", _("couldn't create tempfile"), strerror(errno));
+        geanypg_free_ed(ed);
         return ;
     }
-    gpgme_data_new_from_stream(&cipher, tempfile);
-    gpgme_data_set_encoding(cipher, GPGME_DATA_ENCODING_ARMOR);
+    gpgme_data_set_encoding(ed->output, GPGME_DATA_ENCODING_ARMOR);
 
-    geanypg_load_buffer(&plain);
+    geanypg_load_buffer(ed, &ed->input);
 
     /* do the actual encryption */
+    geanypg_run(ed, geanypg_encrypt_done);
     if (sign)
-        err = gpgme_op_encrypt_sign(ed->ctx, recp, flags, plain, cipher);
+        err = gpgme_op_encrypt_sign_start(ed->ctx, recp, flags, ed->input, ed->output);
     else
-        err = gpgme_op_encrypt(ed->ctx, recp, flags, plain, cipher);
-    if (err != GPG_ERR_NO_ERROR && gpgme_err_code(err) != GPG_ERR_CANCELED)
-        geanypg_show_err_msg(err);
-    else if(gpgme_err_code(err) != GPG_ERR_CANCELED)
-    {
-        rewind(tempfile);
-        geanypg_write_file(tempfile);
-    }
-
-    fclose(tempfile);
-    /* release buffers */
-    gpgme_data_release(plain);
-    gpgme_data_release(cipher);
+        err = gpgme_op_encrypt_start(ed->ctx, recp, flags, ed->input, ed->output);
+    if (err != GPG_ERR_NO_ERROR)
+        geanypg_start_failed(ed, err);
 }
 
 void geanypg_encrypt_cb(GtkMenuItem * menuitem, gpointer user_data)
 {
     int sign;
-    encrypt_data ed;
+    encrypt_data * ed = geanypg_new_ed();
     gpgme_error_t err;
-    geanypg_init_ed(&ed);
-    err = gpgme_new(&ed.ctx);
+    err = gpgme_new(&ed->ctx);
     if (err && geanypg_show_err_msg(err))
+    {
+        geanypg_free_ed(ed);
         return;
-    gpgme_set_armor(ed.ctx, 1);
-    gpgme_set_passphrase_cb(ed.ctx, geanypg_passphrase_cb, NULL);
-    if (geanypg_get_keys(&ed) && geanypg_get_secret_keys(&ed))
+    }
+    gpgme_set_armor(ed->ctx, 1);
+    gpgme_set_passphrase_cb(ed->ctx, geanypg_passphrase_cb, NULL);
+    if (geanypg_get_keys(ed) && geanypg_get_secret_keys(ed))
     {
         gpgme_key_t * recp = NULL;
-        if (geanypg_encrypt_selection_dialog(&ed, &recp, &sign))
+        if (geanypg_encrypt_selection_dialog(ed, &recp, &sign))
         {
             int flags = 0;
             int stop = 0;
             gpgme_key_t * key = recp;
+            /* freed with ed, the keys are used until the encryption is done */
+            ed->recp = recp;
             while (*key)
             {
                 if ((*key)->owner_trust != GPGME_VALIDITY_ULTIMATE &&
@@ -92,13 +93,18 @@ void geanypg_encrypt_cb(GtkMenuItem * menuitem, gpointer user_data)
                 ++key;
             }
             if (*recp && !stop)
-                geanypg_encrypt(&ed, recp, sign, flags);
+            {
+                geanypg_encrypt(ed, recp, sign, flags);
+                return;
+            }
             else if (!stop && dialogs_show_question(_("No recipients were selected,\nuse symetric cipher?")))
-                geanypg_encrypt(&ed, NULL, sign, flags);
+            {
+                geanypg_encrypt(ed, NULL, sign, flags);
+                return;
+            }
         }
-        if (recp)
+        else if (recp)
             free(recp);
     }
-    geanypg_release_keys(&ed);
-    gpgme_release(ed.ctx);
+    geanypg_free_ed(ed);
 }
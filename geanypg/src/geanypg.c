@@ -115,6 +115,7 @@ void plugin_init(GeanyData *data)
 
 void plugin_cleanup(void)
 {
+    geanypg_cancel_all();
     if (main_menu_item)
         gtk_widget_destroy(main_menu_item);
 }
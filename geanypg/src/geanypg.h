@@ -43,14 +43,36 @@ enum
     WRITE = 1
 };
 
-typedef struct
+typedef struct encrypt_data encrypt_data;
+
+/* called when an operation is done, returns nonzero if it started another one */
+typedef int (*geanypg_done_cb)(encrypt_data * ed, gpgme_error_t err);
+
+struct encrypt_data
 {
     gpgme_ctx_t ctx;
     gpgme_key_t * key_array;
     unsigned long nkeys;
     gpgme_key_t * skey_array;
     unsigned long nskeys;
-} encrypt_data;
+
+    /* the operation, running in the main loop (helper_functions.c) */
+    ScintillaObject * sci;  /* document read, and replaced with the output */
+    const char * text;      /* text of the document, read-only meanwhile */
+    unsigned long start;    /* range of the text read */
+    unsigned long end;
+    unsigned long pos;      /* position of the next byte read */
+    int readonly;           /* read-only state of the document before */
+    gpgme_data_t input;
+    gpgme_data_t output;
+    gpgme_data_t sig;
+    FILE * tempfile;        /* output */
+    FILE * sigfile;         /* detached signature */
+    gpgme_key_t * recp;     /* recipients */
+    geanypg_done_cb done;
+    gpgme_error_t err;
+    guint idle_id;
+};
 
 extern GeanyPlugin     *geany_plugin;
 extern GeanyData       *geany_data;
@@ -61,8 +83,14 @@ void geanypg_init_ed(encrypt_data * ed);
 int geanypg_get_keys(encrypt_data * ed);
 int geanypg_get_secret_keys(encrypt_data * ed);
 void geanypg_release_keys(encrypt_data * ed);
-void geanypg_load_buffer(gpgme_data_t * buffer);
-void geanypg_write_file(FILE * file);
+encrypt_data * geanypg_new_ed(void);
+void geanypg_free_ed(encrypt_data * ed);
+void geanypg_load_buffer(encrypt_data * ed, gpgme_data_t * buffer);
+int geanypg_open_output(encrypt_data * ed, gpgme_data_t * buffer);
+void geanypg_write_file(encrypt_data * ed);
+void geanypg_run(encrypt_data * ed, geanypg_done_cb done);
+void geanypg_start_failed(encrypt_data * ed, gpgme_error_t err);
+void geanypg_cancel_all(void);
 
 /* some more auxiliary functions (verify_aux.c) */
 void geanypg_handle_signatures(encrypt_data * ed, int need_error);
@@ -129,52 +129,254 @@ void geanypg_release_keys(encrypt_data * ed)
 }
 
 
-void geanypg_load_buffer(gpgme_data_t * buffer)
+/* the operations running, until they are done */
+static GSList * running = NULL;
+
+encrypt_data * geanypg_new_ed(void)
 {
-    /* gpgme_data_new_from_mem(buffer, text, size, 0); */
-    GeanyDocument * doc = document_get_current();
-    char * data = NULL;
-    unsigned long size = 0;
-    if (sci_has_selection(doc->editor->sci))
+    encrypt_data * ed = (encrypt_data *) calloc(1, sizeof(encrypt_data));
+    geanypg_init_ed(ed);
+    return ed;
+}
+
+static void geanypg_release_doc(encrypt_data * ed)
+{
+    if (ed->sci)
     {
-        size = scintilla_send_message(doc->editor->sci, SCI_GETSELTEXT, 0, 0) - 1;
-        data = (char *) malloc(size + 1);
-        scintilla_send_message(doc->editor->sci, SCI_GETSELTEXT, 0, (sptr_t)data);
-        gpgme_data_new_from_mem(buffer, data, size, 1);
+        scintilla_send_message(ed->sci, SCI_SETREADONLY, (uptr_t) ed->readonly, 0);
+        g_object_unref(ed->sci);
+        ed->sci = NULL;
+        ed->text = NULL;
     }
-    else
+}
+
+void geanypg_free_ed(encrypt_data * ed)
+{
+    running = g_slist_remove(running, ed);
+    /* releasing a context still running cancels it, which may schedule
+     * geanypg_done_idle() */
+    if (ed->ctx)
+        gpgme_release(ed->ctx);
+    if (ed->idle_id)
+        g_source_remove(ed->idle_id);
+    if (ed->input)
+        gpgme_data_release(ed->input);
+    if (ed->output)
+        gpgme_data_release(ed->output);
+    if (ed->sig)
+        gpgme_data_release(ed->sig);
+    if (ed->tempfile)
+        fclose(ed->tempfile);
+    if (ed->sigfile)
+        fclose(ed->sigfile);
+    if (ed->recp)
+        free(ed->recp);
+    geanypg_release_doc(ed);
+    geanypg_release_keys(ed);
+    free(ed);
+}
+
+/* gpgme reads the text straight from Scintilla's buffer */
+static ssize_t geanypg_read_cb(void * handle, void * buffer, size_t size)
+{
+    encrypt_data * ed = (encrypt_data *) handle;
+    size_t left = ed->end - ed->pos;
+    if (size > left)
+        size = left;
+    memcpy(buffer, ed->text + ed->pos, size);
+    ed->pos += size;
+    return size;
+}
+
+static off_t geanypg_seek_cb(void * handle, off_t offset, int whence)
+{
+    encrypt_data * ed = (encrypt_data *) handle;
+    off_t pos = offset;
+    if (whence == SEEK_CUR)
+        pos += ed->pos - ed->start;
+    else if (whence == SEEK_END)
+        pos += ed->end - ed->start;
+    if (pos < 0 || pos > (off_t) (ed->end - ed->start))
     {
-        size = scintilla_send_message(doc->editor->sci, SCI_GETLENGTH, 0, 0);
-        data = (char *) malloc(size + 1);
-        scintilla_send_message(doc->editor->sci, SCI_GETTEXT, (uptr_t)(size + 1), (sptr_t)data);
-        gpgme_data_new_from_mem(buffer, data, size, 1);
+        errno = EINVAL;
+        return -1;
     }
-    if (data) /* if there is no text data may still be NULL */
-        free(data);
+    ed->pos = ed->start + pos;
+    return pos;
+}
+
+static struct gpgme_data_cbs geanypg_read_cbs =
+{
+    geanypg_read_cb,
+    NULL,
+    geanypg_seek_cb,
+    NULL
+};
+
+void geanypg_load_buffer(encrypt_data * ed, gpgme_data_t * buffer)
+{
+    if (!ed->sci)
+    {   /* the selection, or the whole document */
+        GeanyDocument * doc = document_get_current();
+        ed->sci = doc->editor->sci;
+        if (sci_has_selection(ed->sci))
+        {
+            ed->start = sci_get_selection_start(ed->sci);
+            ed->end = sci_get_selection_end(ed->sci);
+        }
+        else
+        {
+            ed->start = 0;
+            ed->end = sci_get_length(ed->sci);
+        }
+        /* the text is used in place, so it must not change (nor the widget
+         * be finalized) until the operation is done */
+        g_object_ref(ed->sci);
+        ed->readonly = scintilla_send_message(ed->sci, SCI_GETREADONLY, 0, 0);
+        scintilla_send_message(ed->sci, SCI_SETREADONLY, 1, 0);
+        ed->text = (const char *) scintilla_send_message(ed->sci, SCI_GETCHARACTERPOINTER, 0, 0);
+    }
+    ed->pos = ed->start;
+    gpgme_data_new_from_cbs(buffer, &geanypg_read_cbs, ed);
     gpgme_data_set_encoding(*buffer, GPGME_DATA_ENCODING_BINARY);
 }
 
-void geanypg_write_file(FILE * file)
+int geanypg_open_output(encrypt_data * ed, gpgme_data_t * buffer)
 {
-#define BUFSIZE 2048
-    unsigned long size;
-    char buffer[BUFSIZE] = {0};
-    GeanyDocument * doc = document_get_current();
-    sci_start_undo_action(doc->editor->sci);
-    if (sci_has_selection(doc->editor->sci))
-    {   /* replace selected text
-         * clear selection, cursor should be at the end or beginneng of the selection */
-        scintilla_send_message(doc->editor->sci, SCI_REPLACESEL, 0, (sptr_t)"");
-        while ((size = fread(buffer, 1, BUFSIZE, file)))
-            /* add at the cursor */
-            scintilla_send_message(doc->editor->sci, SCI_ADDTEXT, (uptr_t) size, (sptr_t) buffer);
+    ed->tempfile = tmpfile();
+    if (!(ed->tempfile))
+    {
+        fprintf(stderr, "GeanyPG: %s: %s.\n", _("couldn't create tempfile"), strerror(errno));
+        return 0;
     }
-    else
-    {   /* replace complete document */
-        scintilla_send_message(doc->editor->sci, SCI_CLEARALL, 0, 0);
-        while ((size = fread(buffer, 1, BUFSIZE, file)))
-            scintilla_send_message(doc->editor->sci, SCI_APPENDTEXT, (uptr_t) size, (sptr_t) buffer);
+    gpgme_data_new_from_stream(buffer, ed->tempfile);
+    return 1;
+}
+
+static int geanypg_doc_is_open(ScintillaObject * sci)
+{
+    guint i;
+    foreach_document(i)
+    {
+        if (documents[i]->editor->sci == sci)
+            return 1;
     }
-    sci_end_undo_action(doc->editor->sci);
+    return 0;
+}
+
+void geanypg_write_file(encrypt_data * ed)
+{
+#define BUFSIZE (1024 * 1024)
+    unsigned long size;
+    char * buffer;
+    ScintillaObject * sci = ed->sci;
+    if (!geanypg_doc_is_open(sci))
+        return; /* closed meanwhile */
+    scintilla_send_message(sci, SCI_SETREADONLY, (uptr_t) ed->readonly, 0);
+    if (ed->readonly)
+        return;
+
+    buffer = (char *) malloc(BUFSIZE);
+    rewind(ed->tempfile);
+    sci_start_undo_action(sci);
+    /* replace the text read, then add the output at the cursor */
+    sci_set_target_start(sci, ed->start);
+    sci_set_target_end(sci, ed->end);
+    scintilla_send_message(sci, SCI_REPLACETARGET, 0, (sptr_t)"");
+    scintilla_send_message(sci, SCI_GOTOPOS, (uptr_t) ed->start, 0);
+    while ((size = fread(buffer, 1, BUFSIZE, ed->tempfile)))
+        scintilla_send_message(sci, SCI_ADDTEXT, (uptr_t) size, (sptr_t) buffer);
+    sci_end_undo_action(sci);
+    free(buffer);
 #undef BUFSIZE
 }
+
+/* gpgme's external event loop, the GLib main loop, so that the editor
+ * stays usable while gpg runs */
+typedef struct
+{
+    int fd;
+    gpgme_io_cb_t fnc;
+    void * fnc_data;
+    guint source;
+} geanypg_io;
+
+static gboolean geanypg_io_ready(GIOChannel * channel, GIOCondition cond, gpointer data)
+{
+    geanypg_io * io = (geanypg_io *) data;
+    /* may remove the watch, freeing io */
+    io->fnc(io->fnc_data, io->fd);
+    return TRUE;
+}
+
+static gpgme_error_t geanypg_add_io_cb(void * data, int fd, int dir,
+                                       gpgme_io_cb_t fnc, void * fnc_data, void ** tag)
+{
+    geanypg_io * io = (geanypg_io *) malloc(sizeof(geanypg_io));
+    GIOChannel * channel = g_io_channel_unix_new(fd);
+    io->fd = fd;
+    io->fnc = fnc;
+    io->fnc_data = fnc_data;
+    /* dir is 1 when gpgme reads from fd */
+    io->source = g_io_add_watch(channel, (dir ? G_IO_IN : G_IO_OUT) | G_IO_HUP | G_IO_ERR,
+                                geanypg_io_ready, io);
+    g_io_channel_unref(channel);
+    *tag = io;
+    return GPG_ERR_NO_ERROR;
+}
+
+static void geanypg_remove_io_cb(void * tag)
+{
+    geanypg_io * io = (geanypg_io *) tag;
+    g_source_remove(io->source);
+    free(io);
+}
+
+static gboolean geanypg_done_idle(gpointer data)
+{
+    encrypt_data * ed = (encrypt_data *) data;
+    ed->idle_id = 0;
+    if (!ed->done(ed, ed->err))
+        geanypg_free_ed(ed);
+    return FALSE;
+}
+
+static void geanypg_event_cb(void * data, gpgme_event_io_t type, void * type_data)
+{
+    encrypt_data * ed = (encrypt_data *) data;
+    if (type == GPGME_EVENT_DONE)
+    {   /* the error is the first member of the event data in any version;
+         * the operation is finished out of gpgme's callback */
+        ed->err = *(gpgme_error_t *) type_data;
+        ed->idle_id = g_idle_add(geanypg_done_idle, ed);
+    }
+}
+
+void geanypg_run(encrypt_data * ed, geanypg_done_cb done)
+{
+    struct gpgme_io_cbs io_cbs;
+    io_cbs.add = geanypg_add_io_cb;
+    io_cbs.add_priv = ed;
+    io_cbs.remove = geanypg_remove_io_cb;
+    io_cbs.event = geanypg_event_cb;
+    io_cbs.event_priv = ed;
+    gpgme_set_io_cbs(ed->ctx, &io_cbs);
+    ed->done = done;
+    if (!g_slist_find(running, ed))
+        running = g_slist_prepend(running, ed);
+}
+
+void geanypg_start_failed(encrypt_data * ed, gpgme_error_t err)
+{
+    if (!ed->done(ed, err))
+        geanypg_free_ed(ed);
+}
+
+void geanypg_cancel_all(void)
+{
+    while (running)
+    {
+        /* nothing may be called back once the plugin is unloaded */
+        geanypg_free_ed((encrypt_data *) running->data);
+    }
+}
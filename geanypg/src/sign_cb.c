@@ -21,55 +21,54 @@
 
 #include "geanypg.h"
 
+static int geanypg_sign_done(encrypt_data * ed, gpgme_error_t err)
+{
+    if (err != GPG_ERR_NO_ERROR && gpgme_err_code(err) != GPG_ERR_CANCELED)
+        geanypg_show_err_msg(err);
+    else
+        geanypg_write_file(ed);
+    return 0;
+}
+
+/* starts signing, ed is released once it is done */
 static void geanypg_sign(encrypt_data * ed)
 {
-    gpgme_data_t plain, cipher;
     gpgme_error_t err;
-    FILE * tempfile;
 
-    tempfile = tmpfile();
-    if (!(tempfile))
+    if (!geanypg_open_output(ed, &ed->output))
     {
-        fprintf(stderr, "GeanyPG: %s: %s\n", _("couldn't create tempfile"), strerror(errno));
+        geanypg_free_ed(ed);
         return ;
     }
-    gpgme_data_new_from_stream(&cipher, tempfile);
-    gpgme_data_set_encoding(cipher, GPGME_DATA_ENCODING_ARMOR);
-
-    geanypg_load_buffer(&plain);
+    gpgme_data_set_encoding(ed->output, GPGME_DATA_ENCODING_ARMOR);
 
-    err = gpgme_op_sign(ed->ctx, plain , cipher, GPGME_SIG_MODE_CLEAR);
-    if (err != GPG_ERR_NO_ERROR && gpgme_err_code(err) != GPG_ERR_CANCELED)
-        geanypg_show_err_msg(err);
-    else
-    {
-        rewind(tempfile);
-        geanypg_write_file(tempfile);
-    }
+    geanypg_load_buffer(ed, &ed->input);
 
-    fclose(tempfile);
-    /* release buffers */
-    gpgme_data_release(plain);
-    gpgme_data_release(cipher);
+    geanypg_run(ed, geanypg_sign_done);
+    err = gpgme_op_sign_start(ed->ctx, ed->input, ed->output, GPGME_SIG_MODE_CLEAR);
+    if (err != GPG_ERR_NO_ERROR)
+        geanypg_start_failed(ed, err);
 }
 
 void geanypg_sign_cb(GtkMenuItem * menuitem, gpointer user_data)
 {
-    encrypt_data ed;
+    encrypt_data * ed = geanypg_new_ed();
     gpgme_error_t err;
-    geanypg_init_ed(&ed);
-    err = gpgme_new(&ed.ctx);
+    err = gpgme_new(&ed->ctx);
     if (err && geanypg_show_err_msg(err))
+    {
+        geanypg_free_ed(ed);
         return;
-    ed.key_array = NULL;
-    ed.nkeys = 0;
-    /*gpgme_set_armor(ed.ctx, 1);*/
-    gpgme_set_passphrase_cb(ed.ctx, geanypg_passphrase_cb, NULL);
-    if (geanypg_get_secret_keys(&ed))
+    }
+    /*gpgme_set_armor(ed->ctx, 1);*/
+    gpgme_set_passphrase_cb(ed->ctx, geanypg_passphrase_cb, NULL);
+    if (geanypg_get_secret_keys(ed))
     {
-        if (geanypg_sign_selection_dialog(&ed))
-            geanypg_sign(&ed);
+        if (geanypg_sign_selection_dialog(ed))
+        {
+            geanypg_sign(ed);
+            return;
+        }
     }
-    geanypg_release_keys(&ed);
-    gpgme_release(ed.ctx);
+    geanypg_free_ed(ed);
 }
@@ -38,46 +38,57 @@ static char * geanypg_choose_sig(void)
     return file;
 }
 
-static void geanypg_verify(encrypt_data * ed, char * signame)
+static int geanypg_verify_done(encrypt_data * ed, gpgme_error_t err)
 {
-    gpgme_data_t sig, text;
-    gpgme_error_t err;
-    FILE * sigfile = fopen(signame, "r");
-    gpgme_data_new_from_stream(&sig, sigfile);
-    geanypg_load_buffer(&text);
-
-    err = gpgme_op_verify(ed->ctx, sig, text, NULL);
-
     if (err != GPG_ERR_NO_ERROR)
         geanypg_show_err_msg(err);
     else
         geanypg_handle_signatures(ed, 1);
+    return 0;
+}
 
-    gpgme_data_release(sig);
-    gpgme_data_release(text);
-    fclose(sigfile);
+/* starts verifying, ed is released once it is done */
+static void geanypg_verify(encrypt_data * ed, char * signame)
+{
+    gpgme_error_t err;
+    ed->sigfile = fopen(signame, "r");
+    if (!ed->sigfile)
+    {
+        fprintf(stderr, "GeanyPG: %s: %s.\n", signame, strerror(errno));
+        geanypg_free_ed(ed);
+        return;
+    }
+    gpgme_data_new_from_stream(&ed->sig, ed->sigfile);
+    geanypg_load_buffer(ed, &ed->input);
+
+    geanypg_run(ed, geanypg_verify_done);
+    err = gpgme_op_verify_start(ed->ctx, ed->sig, ed->input, NULL);
+    if (err != GPG_ERR_NO_ERROR)
+        geanypg_start_failed(ed, err);
 }
 
 void geanypg_verify_cb(GtkMenuItem * menuitem, gpointer user_data)
 {
     char * sigfile = NULL;
-    encrypt_data ed;
+    encrypt_data * ed = geanypg_new_ed();
     gpgme_error_t err;
-    geanypg_init_ed(&ed);
-    err = gpgme_new(&ed.ctx);
+    err = gpgme_new(&ed->ctx);
     if (err && geanypg_show_err_msg(err))
+    {
+        geanypg_free_ed(ed);
         return;
-    gpgme_set_protocol(ed.ctx, GPGME_PROTOCOL_OpenPGP);
-    gpgme_set_passphrase_cb(ed.ctx, geanypg_passphrase_cb, NULL);
-    if (geanypg_get_keys(&ed) && geanypg_get_secret_keys(&ed))
+    }
+    gpgme_set_protocol(ed->ctx, GPGME_PROTOCOL_OpenPGP);
+    gpgme_set_passphrase_cb(ed->ctx, geanypg_passphrase_cb, NULL);
+    if (geanypg_get_keys(ed) && geanypg_get_secret_keys(ed))
     {
         sigfile = geanypg_choose_sig();
         if (sigfile)
         {
-            geanypg_verify(&ed, sigfile);
+            geanypg_verify(ed, sigfile);
             g_free(sigfile);
+            return;
         }
     }
-    geanypg_release_keys(&ed);
-    gpgme_release(ed.ctx);
+    geanypg_free_ed(ed);
 }
@@ -38,6 +38,7 @@ PLUGIN_VERSION_CHECK(147)
 PLUGIN_SET_INFO(_("Project"), _("Alternative project support."), VERSION,
 		"Yura Siamashka <yurand2@gmail.com>")
 
+GeanyPlugin    *geany_plugin;
 GeanyData      *geany_data;
 GeanyFunctions *geany_functions;
 
@@ -62,8 +62,15 @@ struct GeanyPrj
 	gint type;
 
 	GHashTable *tags;	/**< project tags */
+	GQueue *pending_tags;	/**< files of tags still to be parsed */
+	guint pending_tags_id;	/**< idle source parsing pending_tags */
+
+	struct GpFileIndex *file_index;	/**< files under base_path, shared with other plugins */
+	gulong file_index_subscription;
+	gboolean file_list_partial;	/**< read while the index was still being checked */
 };
 
+extern GeanyPlugin *geany_plugin;
 extern GeanyData *geany_data;
 extern GeanyFunctions *geany_functions;
 
@@ -88,12 +95,15 @@ void geany_project_set_description(struct GeanyPrj *prj, const gchar *descriptio
 void geany_project_set_base_path(struct GeanyPrj *prj, const gchar *base_path);
 void geany_project_set_run_cmd(struct GeanyPrj *prj, const gchar *run_cmd);
 void geany_project_set_tags_from_list(struct GeanyPrj *prj, GSList *files);
+gboolean geany_project_update_tag(const gchar *filename);
 
 
 /* sidebar.c */
 void create_sidebar(void);
 void destroy_sidebar(void);
 void sidebar_refresh(void);
+void sidebar_add_file(const gchar *path);
+void sidebar_remove_file(const gchar *path);
 
 
 /* xproject.c */
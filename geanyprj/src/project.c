@@ -23,7 +23,14 @@
 #include <string.h>
 #include <sys/time.h>
 
+#ifdef HAVE_CONFIG_H
+	#include "config.h" /* for the gettext domain */
+#endif
 #include "geanyprj.h"
+#include "fileindex.h"
+
+/* seconds spent parsing queued files in one idle call */
+#define TAGS_UPDATE_SLICE 0.02
 
 const gchar *project_type_string[NEW_PROJECT_TYPE_SIZE] = {
 	"All",
@@ -81,9 +88,194 @@ gboolean (*project_type_filter[NEW_PROJECT_TYPE_SIZE]) (const gchar *) = {
 };
 
 
+/* A tag object shared by all loaded projects containing its file. */
+typedef struct
+{
+	gchar *filename;	/* utf8 */
+	TMWorkObject *obj;
+	guint refs;
+	gboolean parsed;
+} TagObjectRef;
+
+/* filename -> TagObjectRef and TMWorkObject -> TagObjectRef */
+static GHashTable *tag_objects = NULL;
+static GHashTable *tag_object_refs = NULL;
+
+
+static TagObjectRef *tag_object_ref(const gchar *filename)
+{
+	TagObjectRef *ref;
+	TMWorkObject *tm_obj;
+	gchar *locale_filename;
+
+	if (!tag_objects)
+	{
+		tag_objects = g_hash_table_new(g_str_hash, g_str_equal);
+		tag_object_refs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	}
+
+	ref = g_hash_table_lookup(tag_objects, filename);
+	if (ref)
+	{
+		ref->refs++;
+		return ref;
+	}
+
+	locale_filename = utils_get_locale_from_utf8(filename);
+	tm_obj = tm_source_file_new(locale_filename, FALSE,
+				    filetypes_detect_from_file(filename)->name);
+	g_free(locale_filename);
+	if (!tm_obj)
+		return NULL;
+
+	ref = g_new0(TagObjectRef, 1);
+	ref->filename = g_strdup(filename);
+	ref->obj = tm_obj;
+	ref->refs = 1;
+	g_hash_table_insert(tag_objects, ref->filename, ref);
+	g_hash_table_insert(tag_object_refs, tm_obj, ref);
+	return ref;
+}
+
+
+/* value destroy function of the project tags, drops one reference */
 static void free_tag_object(gpointer obj)
 {
-	tm_workspace_remove_object((TMWorkObject *) obj, TRUE, FALSE);
+	TagObjectRef *ref = g_hash_table_lookup(tag_object_refs, obj);
+
+	g_return_if_fail(ref);
+
+	if (--ref->refs > 0)
+		return;
+
+	g_hash_table_remove(tag_objects, ref->filename);
+	g_hash_table_remove(tag_object_refs, obj);
+	/* objects of cached projects are not in the workspace */
+	if (!tm_workspace_remove_object((TMWorkObject *) obj, TRUE, FALSE))
+		tm_work_object_free(obj);
+	g_free(ref->filename);
+	g_free(ref);
+
+	if (g_hash_table_size(tag_objects) == 0)
+	{
+		g_hash_table_destroy(tag_objects);
+		g_hash_table_destroy(tag_object_refs);
+		tag_objects = NULL;
+		tag_object_refs = NULL;
+	}
+}
+
+
+static void update_tag_object(TagObjectRef *ref)
+{
+	tm_source_file_update(ref->obj, TRUE, FALSE, TRUE);
+	ref->parsed = TRUE;
+}
+
+
+/* Reparses filename once, whichever loaded projects contain it.
+ * Returns: FALSE if no project contains filename. */
+gboolean geany_project_update_tag(const gchar *filename)
+{
+	TagObjectRef *ref;
+
+	if (!tag_objects || !(ref = g_hash_table_lookup(tag_objects, filename)))
+		return FALSE;
+
+	update_tag_object(ref);
+	return TRUE;
+}
+
+
+static gboolean update_pending_tags(gpointer data)
+{
+	struct GeanyPrj *prj = (struct GeanyPrj *) data;
+	TMWorkObject *tm_obj;
+	TagObjectRef *ref;
+	GTimer *timer;
+	gchar *filename;
+
+	timer = g_timer_new();
+	while ((filename = g_queue_pop_head(prj->pending_tags)))
+	{
+		/* the file may have been removed from the project meanwhile, or
+		 * parsed for another project */
+		tm_obj = g_hash_table_lookup(prj->tags, filename);
+		g_free(filename);
+		if (!tm_obj)
+			continue;
+		ref = g_hash_table_lookup(tag_object_refs, tm_obj);
+		if (ref->parsed)
+			continue;
+		update_tag_object(ref);
+
+		if (g_timer_elapsed(timer, NULL) > TAGS_UPDATE_SLICE)
+			break;
+	}
+	g_timer_destroy(timer);
+
+	if (!g_queue_is_empty(prj->pending_tags))
+	{
+		ui_set_statusbar(FALSE, _("Parsing project files (%u left)..."),
+				 g_queue_get_length(prj->pending_tags));
+		return TRUE;
+	}
+
+	ui_set_statusbar(FALSE, _("Project \"%s\" parsed."), prj->name);
+	prj->pending_tags_id = 0;
+	return FALSE;
+}
+
+
+static const gchar *get_current_file_name(void)
+{
+	GeanyDocument *doc = document_get_current();
+
+	return doc ? doc->file_name : NULL;
+}
+
+
+/* Parses filename later from an idle callback, current is the file of the
+ * current document which gets parsed first. */
+static void queue_tag_update(struct GeanyPrj *prj, const gchar *filename, const gchar *current)
+{
+	if (current && strcmp(current, filename) == 0)
+		g_queue_push_head(prj->pending_tags, g_strdup(filename));
+	else
+		g_queue_push_tail(prj->pending_tags, g_strdup(filename));
+
+	if (!prj->pending_tags_id)
+		prj->pending_tags_id = g_idle_add(update_pending_tags, prj);
+}
+
+
+static void clear_pending_tags(struct GeanyPrj *prj)
+{
+	gchar *filename;
+
+	if (prj->pending_tags_id)
+	{
+		g_source_remove(prj->pending_tags_id);
+		prj->pending_tags_id = 0;
+	}
+	while ((filename = g_queue_pop_head(prj->pending_tags)))
+		g_free(filename);
+}
+
+
+/* Adds filename to the tags of prj. Files not parsed yet are queued, files
+ * already in another loaded project share its tag object. */
+static gboolean add_tag_object(struct GeanyPrj *prj, const gchar *filename, const gchar *current)
+{
+	TagObjectRef *ref = tag_object_ref(filename);
+
+	if (!ref)
+		return FALSE;
+
+	g_hash_table_insert(prj->tags, g_strdup(filename), ref->obj);
+	if (!ref->parsed)
+		queue_tag_update(prj, filename, current);
+	return TRUE;
 }
 
 
@@ -93,6 +285,7 @@ struct GeanyPrj *geany_project_new(void)
 
 	ret = (struct GeanyPrj *) g_new0(struct GeanyPrj, 1);
 	ret->tags = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_tag_object);
+	ret->pending_tags = g_queue_new();
 
 	return ret;
 }
@@ -101,13 +294,13 @@ struct GeanyPrj *geany_project_new(void)
 struct GeanyPrj *geany_project_load(const gchar *path)
 {
 	struct GeanyPrj *ret;
-	TMWorkObject *tm_obj = NULL;
 	GKeyFile *config;
 	gint i = 0;
 	gchar *file;
-	gchar *filename, *locale_filename;
+	gchar *filename;
 	gchar *key;
 	gchar *tmp;
+	const gchar *current;
 
 	debug("%s path=%s\n", __FUNCTION__, path);
 
@@ -153,23 +346,14 @@ struct GeanyPrj *geany_project_load(const gchar *path)
 	}
 	else
 	{
-		/* Create tag files */
+		/* Create tag files, they are parsed in the background */
+		current = get_current_file_name();
 		key = g_strdup_printf("file%d", i);
 		while ((file = g_key_file_get_string(config, "files", key, NULL)))
 		{
 			filename = get_full_path(path, file);
-
-			locale_filename = utils_get_locale_from_utf8(filename);
-			tm_obj = tm_source_file_new(locale_filename, FALSE,
-						    filetypes_detect_from_file(filename)->name);
-			g_free(locale_filename);
-			if (tm_obj)
-			{
-				g_hash_table_insert(ret->tags, filename, tm_obj);
-				tm_source_file_update(tm_obj, TRUE, FALSE, TRUE);
-			}
-			else
-				g_free(filename);
+			add_tag_object(ret, filename, current);
+			g_free(filename);
 			i++;
 			g_free(key);
 			g_free(file);
@@ -196,14 +380,102 @@ static void g_hash_table_remove_all(GHashTable *hash_table)
 #endif
 
 
+static void release_file_index(struct GeanyPrj *prj)
+{
+	if (prj->file_index)
+	{
+		gp_file_index_unsubscribe(prj->file_index, prj->file_index_subscription);
+		gp_file_index_unref(prj->file_index);
+		prj->file_index = NULL;
+		prj->file_index_subscription = 0;
+	}
+}
+
+
+/* the list was read while the index was still checked, read it again once complete */
+static void on_file_index_changed(GpFileIndex *index, gpointer user_data)
+{
+	struct GeanyPrj *prj = user_data;
+
+	if (prj->file_list_partial && !gp_file_index_is_building(index))
+	{
+		geany_project_regenerate_file_list(prj);
+		if (prj == g_current_project)
+			sidebar_refresh();
+	}
+}
+
+
+static GpFileIndex *get_file_index(struct GeanyPrj *prj)
+{
+	GpFileIndex *index;
+	gchar *utf8_base_path;
+
+	if (!prj->base_path)
+		return NULL;
+
+	utf8_base_path = utils_get_utf8_from_locale(prj->base_path);
+	if (!prj->file_index || !utils_str_equal(gp_file_index_get_root(prj->file_index),
+		utf8_base_path))
+	{
+		/* referenced before the old one is released, in case it is the same */
+		index = gp_file_index_ref(geany_plugin, utf8_base_path);
+		release_file_index(prj);
+		prj->file_index = index;
+		prj->file_index_subscription = gp_file_index_subscribe(index,
+			on_file_index_changed, prj);
+	}
+	g_free(utf8_base_path);
+
+	return prj->file_index;
+}
+
+
+typedef struct
+{
+	struct GeanyPrj *prj;
+	GSList *list;
+} IndexFileList;
+
+
+static void add_index_file(const gchar *rel_path, gpointer user_data)
+{
+	IndexFileList *ifl = user_data;
+	gchar *locale_path = utils_get_locale_from_utf8(rel_path);
+	gchar *filename = g_build_filename(ifl->prj->base_path, locale_path, NULL);
+
+	if (!project_type_filter[ifl->prj->type] || project_type_filter[ifl->prj->type](filename))
+		ifl->list = g_slist_prepend(ifl->list, filename);
+	else
+		g_free(filename);
+	g_free(locale_path);
+}
+
+
+/* The file index shared with the other plugins is used once it has files, of
+ * this session or the previous one: the tree is only walked here otherwise. */
 void geany_project_regenerate_file_list(struct GeanyPrj *prj)
 {
+	GpFileIndex *index;
 	GSList *lst;
 
 	debug("%s path=%s\n", __FUNCTION__, prj->base_path);
 	g_hash_table_remove_all(prj->tags);
 
-	lst = get_file_list(prj->base_path, NULL, project_type_filter[prj->type], NULL);
+	index = get_file_index(prj);
+	if (index && (gp_file_index_get_size(index) > 0 || !gp_file_index_is_building(index)))
+	{
+		IndexFileList ifl = { prj, NULL };
+
+		gp_file_index_foreach(index, add_index_file, &ifl);
+		lst = ifl.list;
+		prj->file_list_partial = gp_file_index_is_building(index);
+	}
+	else
+	{
+		lst = get_file_list(prj->base_path, NULL, project_type_filter[prj->type], NULL);
+		prj->file_list_partial = FALSE;
+	}
 	geany_project_set_tags_from_list(prj, lst);
 
 	g_slist_foreach(lst, (GFunc) g_free, NULL);
@@ -297,25 +569,16 @@ void geany_project_set_run_cmd(struct GeanyPrj *prj, const gchar *run_cmd)
 void geany_project_set_tags_from_list(struct GeanyPrj *prj, GSList *files)
 {
 	GSList *tmp;
-	gchar *locale_filename;
-	TMWorkObject *tm_obj = NULL;
+	const gchar *current;
 
+	clear_pending_tags(prj);
 	if (prj->tags)
 		g_hash_table_destroy(prj->tags);
 	prj->tags = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_tag_object);
 
+	current = get_current_file_name();
 	for (tmp = files; tmp != NULL; tmp = g_slist_next(tmp))
-	{
-		locale_filename = utils_get_locale_from_utf8(tmp->data);
-		tm_obj = tm_source_file_new(locale_filename, FALSE,
-					    filetypes_detect_from_file(tmp->data)->name);
-		g_free(locale_filename);
-		if (tm_obj)
-		{
-			g_hash_table_insert(prj->tags, g_strdup(tmp->data), tm_obj);
-			tm_source_file_update(tm_obj, TRUE, FALSE, TRUE);
-		}
-	}
+		add_tag_object(prj, tmp->data, current);
 }
 
 
@@ -324,6 +587,9 @@ void geany_project_free(struct GeanyPrj *prj)
 	debug("%s prj=%p\n", __FUNCTION__, prj);
 	g_return_if_fail(prj);
 
+	clear_pending_tags(prj);
+	g_queue_free(prj->pending_tags);
+	release_file_index(prj);
 	if (prj->path)
 		g_free(prj->path);
 	if (prj->name)
@@ -343,8 +609,7 @@ void geany_project_free(struct GeanyPrj *prj)
 
 gboolean geany_project_add_file(struct GeanyPrj *prj, const gchar *path)
 {
-	gchar *filename;
-	TMWorkObject *tm_obj = NULL;
+	TagObjectRef *ref;
 
 	GKeyFile *config;
 
@@ -361,13 +626,12 @@ gboolean geany_project_add_file(struct GeanyPrj *prj, const gchar *path)
 		return TRUE;
 	}
 
-	filename = utils_get_locale_from_utf8(path);
-	tm_obj = tm_source_file_new(filename, FALSE, filetypes_detect_from_file(path)->name);
-	g_free(filename);
-	if (tm_obj)
+	ref = tag_object_ref(path);
+	if (ref)
 	{
-		g_hash_table_insert(prj->tags, g_strdup(path), tm_obj);
-		tm_source_file_update(tm_obj, TRUE, FALSE, TRUE);
+		g_hash_table_insert(prj->tags, g_strdup(path), ref->obj);
+		if (!ref->parsed)
+			update_tag_object(ref);
 	}
 	geany_project_save(prj);
 	return TRUE;
@@ -20,6 +20,7 @@
 
 #include <sys/time.h>
 #include <gdk/gdkkeysyms.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef HAVE_CONFIG_H
@@ -400,10 +401,50 @@ static gint mycmp(const gchar *a, const gchar *b)
 static void add_item(gpointer name, G_GNUC_UNUSED gpointer value, gpointer user_data)
 {
 	gchar *item;
-	GSList **lst = (GSList **) user_data;
+	GPtrArray *items = (GPtrArray *) user_data;
 
 	item = get_relative_path(g_current_project->path, name);
-	*lst = g_slist_prepend(*lst, item);
+	if (item)
+		g_ptr_array_add(items, item);
+}
+
+
+static gint compare_items(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const gchar **) a, *(const gchar **) b);
+}
+
+
+/* Returns: the row of name in the sorted file_store, or the row it should be
+ * inserted at if found is FALSE. */
+static gint find_row(const gchar *name, GtkTreeIter *iter, gboolean *found)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(file_store);
+	gint lo = 0;
+	gint hi = gtk_tree_model_iter_n_children(model, NULL);
+	gint mid, cmp;
+	gchar *row_name;
+
+	*found = FALSE;
+	while (lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		gtk_tree_model_iter_nth_child(model, iter, NULL, mid);
+		gtk_tree_model_get(model, iter, FILEVIEW_COLUMN_NAME, &row_name, -1);
+		cmp = strcmp(row_name, name);
+		g_free(row_name);
+
+		if (cmp == 0)
+		{
+			*found = TRUE;
+			return mid;
+		}
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
 }
 
 
@@ -411,26 +452,76 @@ static void add_item(gpointer name, G_GNUC_UNUSED gpointer value, gpointer user_
 void sidebar_refresh(void)
 {
 	GtkTreeIter iter;
-	GSList *lst = NULL;
-	GSList *tmp;
+	GPtrArray *items;
+	guint i;
 
 	if (! file_view_vbox)
 		return;
 
+	/* fill the store while it is detached from the view */
+	g_object_ref(file_store);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(file_view), NULL);
 	sidebar_clear();
 
-	if (!g_current_project)
-		return;
-
-	g_hash_table_foreach(g_current_project->tags, add_item, &lst);
-	lst = g_slist_sort(lst, (GCompareFunc) strcmp);
-	for (tmp = lst; tmp != NULL; tmp = g_slist_next(tmp))
+	if (g_current_project)
 	{
-		gtk_list_store_append(file_store, &iter);
-		gtk_list_store_set(file_store, &iter, FILEVIEW_COLUMN_NAME, tmp->data, -1);
+		items = g_ptr_array_sized_new(g_hash_table_size(g_current_project->tags));
+		g_hash_table_foreach(g_current_project->tags, add_item, items);
+		qsort(items->pdata, items->len, sizeof(gpointer), compare_items);
+		for (i = 0; i < items->len; i++)
+		{
+			gtk_list_store_insert_with_values(file_store, &iter, i,
+							  FILEVIEW_COLUMN_NAME, items->pdata[i], -1);
+			g_free(items->pdata[i]);
+		}
+		g_ptr_array_free(items, TRUE);
 	}
-	g_slist_foreach(lst, (GFunc) g_free, NULL);
-	g_slist_free(lst);
+
+	gtk_tree_view_set_model(GTK_TREE_VIEW(file_view), GTK_TREE_MODEL(file_store));
+	g_object_unref(file_store);
+}
+
+
+/* path is the full filename of a file just added to the current project */
+void sidebar_add_file(const gchar *path)
+{
+	GtkTreeIter iter;
+	gboolean found;
+	gchar *item;
+	gint row;
+
+	if (! file_view_vbox || !g_current_project)
+		return;
+
+	item = get_relative_path(g_current_project->path, path);
+	if (!item)
+		return;
+
+	row = find_row(item, &iter, &found);
+	if (!found)
+		gtk_list_store_insert_with_values(file_store, &iter, row, FILEVIEW_COLUMN_NAME, item, -1);
+	g_free(item);
+}
+
+
+/* path is the full filename of a file just removed from the current project */
+void sidebar_remove_file(const gchar *path)
+{
+	GtkTreeIter iter;
+	gboolean found;
+	gchar *item;
+
+	if (! file_view_vbox || !g_current_project)
+		return;
+
+	item = get_relative_path(g_current_project->path, path);
+	if (!item)
+		return;
+
+	find_row(item, &iter, &found);
+	if (found)
+		gtk_list_store_remove(file_store, &iter);
+	g_free(item);
 }
 
 
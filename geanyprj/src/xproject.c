@@ -32,7 +32,8 @@
 
 
 struct GeanyPrj *g_current_project = NULL;
-static GPtrArray *g_projects = NULL;
+/* cached projects by path */
+static GHashTable *g_projects = NULL;
 
 
 static void add_tag(G_GNUC_UNUSED gpointer key, gpointer value, G_GNUC_UNUSED gpointer user_data)
@@ -57,10 +58,11 @@ void xproject_close(gboolean cache)
 	if (!g_current_project)
 		return;
 
+	/* tag objects shared with cached projects outlive this one */
+	g_hash_table_foreach(g_current_project->tags, remove_tag, NULL);
 	if (cache)
 	{
-		g_hash_table_foreach(g_current_project->tags, remove_tag, NULL);
-		g_ptr_array_add(g_projects, g_current_project);
+		g_hash_table_insert(g_projects, g_current_project->path, g_current_project);
 	}
 	else
 	{
@@ -74,20 +76,13 @@ void xproject_close(gboolean cache)
 
 void xproject_open(const gchar *path)
 {
-	guint i;
-	struct GeanyPrj *p = NULL;
+	struct GeanyPrj *p;
 	debug("%s\n", __FUNCTION__);
 
-	for (i = 0; i < g_projects->len; i++)
-	{
-		if (strcmp(path, ((struct GeanyPrj *) g_projects->pdata[i])->path) == 0)
-		{
-			p = (struct GeanyPrj *)g_projects->pdata[i];
-			g_ptr_array_remove_index(g_projects, i);
-			break;
-		}
-	}
-	if (!p)
+	p = (struct GeanyPrj *) g_hash_table_lookup(g_projects, path);
+	if (p)
+		g_hash_table_steal(g_projects, path);
+	else
 		p = geany_project_load(path);
 
 	if (!p)
@@ -101,28 +96,10 @@ void xproject_open(const gchar *path)
 }
 
 
+/* the tag objects are shared between projects, so this parses filename once */
 void xproject_update_tag(const gchar *filename)
 {
-	guint i;
-	TMWorkObject *tm_obj;
-
-	if (g_current_project)
-	{
-		tm_obj = g_hash_table_lookup(g_current_project->tags, filename);
-		if (tm_obj)
-		{
-			tm_source_file_update(tm_obj, TRUE, FALSE, TRUE);
-		}
-	}
-
-	for (i = 0; i < g_projects->len; i++)
-	{
-		tm_obj = (TMWorkObject *)g_hash_table_lookup(((struct GeanyPrj *)(g_projects->pdata[i]))->tags, filename);
-		if (tm_obj)
-		{
-			tm_source_file_update(tm_obj, TRUE, FALSE, TRUE);
-		}
-	}
+	geany_project_update_tag(filename);
 }
 
 
@@ -142,7 +119,7 @@ gboolean xproject_add_file(const gchar *path)
 		{
 			tm_workspace_add_object((TMWorkObject *) tm_obj);
 		}
-		sidebar_refresh();
+		sidebar_add_file(path);
 		return TRUE;
 	}
 	return FALSE;
@@ -166,7 +143,7 @@ gboolean xproject_remove_file(const gchar *path)
 
 	if (geany_project_remove_file(g_current_project, path))
 	{
-		sidebar_refresh();
+		sidebar_remove_file(path);
 		return TRUE;
 	}
 	return FALSE;
@@ -175,18 +152,14 @@ gboolean xproject_remove_file(const gchar *path)
 
 void xproject_init(void)
 {
-	g_projects = g_ptr_array_sized_new(10);
+	g_projects = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+					   (GDestroyNotify) geany_project_free);
 	g_current_project = NULL;
 }
 
 
 void xproject_cleanup(void)
 {
-	guint i;
-	for (i = 0; i < g_projects->len; i++)
-	{
-		geany_project_free(((struct GeanyPrj *)(g_projects->pdata[i])));
-	}
-	g_ptr_array_free(g_projects, TRUE);
+	g_hash_table_destroy(g_projects);
 	g_projects = NULL;
 }
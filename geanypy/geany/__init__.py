@@ -26,6 +26,7 @@ import scintilla
 import search
 import templates
 import ui_utils
+import worker
 
 from app import App
 from prefs import Prefs, ToolPrefs
@@ -47,7 +48,8 @@ __all__ = [ "Plugin",
             "search_prefs",
             "template_prefs",
             "tool_prefs",
-            "signals" ]
+            "signals",
+            "worker" ]
 
 # Geany's application data fields
 app = App()
@@ -1,9 +1,13 @@
 import os
 import imp
+import json
 from collections import namedtuple
+import gobject
 import geany
 
-PluginInfo = namedtuple('PluginInfo', 'filename, name, version, description, author, cls')
+# The class itself is only known once its module is imported, see plugin_class()
+PluginInfo = namedtuple('PluginInfo',
+	'filename, name, version, description, author, has_help, cls_name')
 
 
 class PluginLoader(object):
@@ -13,12 +17,61 @@ class PluginLoader(object):
 	def __init__(self, plugin_dirs):
 
 		self.plugin_dirs = plugin_dirs
+		self.modules = {}
+
+		# The metadata of the plugin files by filename, with their mtime, so
+		# that listing the plugins doesn't import the unchanged files again
+		self.info_cache_file = os.path.join(geany.app.configdir,
+			'plugins', 'geanypy', 'plugin_info_cache')
+		self.info_cache = self.read_info_cache()
+		self.info_cache_changed = False
 
 		self.available_plugins = []
 		for plugin in self.iter_plugin_info():
 			self.available_plugins.append(plugin)
+		# forget the files gone meanwhile
+		for filename in list(self.info_cache):
+			if not os.path.exists(filename):
+				del self.info_cache[filename]
+				self.info_cache_changed = True
+		self.write_info_cache()
+
+		# The enabled plugins are loaded once Geany is up, so that they don't
+		# hold its startup
+		if geany.is_realized():
+			gobject.idle_add(self.on_restore_idle)
+		else:
+			self.startup_handler = geany.signals.connect(
+				'geany-startup-complete', self.on_startup_complete)
+
+
+	def on_startup_complete(self, signals):
+		geany.signals.disconnect(self.startup_handler)
+		gobject.idle_add(self.on_restore_idle)
 
+
+	def on_restore_idle(self):
 		self.restore_loaded_plugins()
+		return False
+
+
+	def read_info_cache(self):
+		try:
+			with open(self.info_cache_file) as f:
+				return json.load(f)
+		except (IOError, ValueError):
+			return {}
+
+
+	def write_info_cache(self):
+		if not self.info_cache_changed:
+			return
+		try:
+			with open(self.info_cache_file, 'w') as f:
+				json.dump(self.info_cache, f)
+			self.info_cache_changed = False
+		except IOError as err:
+			print("Unable to write the plugins information cache: %s" % err)
 
 
 	def update_loaded_plugins_file(self):
@@ -96,39 +149,64 @@ class PluginLoader(object):
 								
 	def load_plugin_info(self,d,f):
 		filename = os.path.abspath(os.path.join(d, f))
-		if filename.endswith("test.py"):
-			pass
-		text = open(filename).read()
-		module_name = os.path.basename(filename)[:-3]
 		try:
-			module = imp.load_source(module_name, filename)
-		except ImportError as exc:
-			print "Error: failed to import settings module ({})".format(exc)
-			module=None
+			mtime = os.path.getmtime(filename)
+		except OSError:
+			return
+		cached = self.info_cache.get(filename)
+		if cached is None or cached['mtime'] != mtime:
+			# a file without plugin is cached too, it isn't imported again
+			cached = { 'mtime': mtime,
+				'plugins': list(self.import_plugin_info(filename)) }
+			self.info_cache[filename] = cached
+			self.info_cache_changed = True
+		for fields in cached['plugins']:
+			yield PluginInfo(filename, *fields)
+
+
+	def import_module(self, filename):
+		if filename not in self.modules:
+			module_name = os.path.basename(filename)[:-3]
+			try:
+				self.modules[filename] = imp.load_source(module_name, filename)
+			except ImportError as exc:
+				print "Error: failed to import settings module ({})".format(exc)
+				return None
+		return self.modules[filename]
+
+
+	def import_plugin_info(self, filename):
+		module = self.import_module(filename)
 		if module:	
 			for k, v in module.__dict__.iteritems():
 				if k == geany.Plugin.__name__:
 					continue
 				try:
 					if issubclass(v, geany.Plugin):
-						inf = PluginInfo(
-								filename,
-								getattr(v, '__plugin_name__'),
+						yield [ getattr(v, '__plugin_name__'),
 								getattr(v, '__plugin_version__', ''),
 								getattr(v, '__plugin_description__', ''),
 								getattr(v, '__plugin_author__', ''),
-								v)
-						yield inf
+								hasattr(v, 'show_help'),
+								k ]
 						
 				except TypeError:
 					continue
 
 
+	def plugin_class(self, plugin_info):
+		module = self.import_module(plugin_info.filename)
+		return getattr(module, plugin_info.cls_name, None) if module else None
+
+
 	def load_plugin(self, filename):
 
 		for avail in self.available_plugins:
 			if avail.filename == filename:
-				inst = avail.cls()
+				cls = self.plugin_class(avail)
+				if cls is None:
+					return None
+				inst = cls()
 				self.plugins[filename] = inst
 				self.update_loaded_plugins_file()
 				geany.ui_utils.set_statusbar('GeanyPy: plugin activated: %s' %
@@ -159,9 +237,9 @@ class PluginLoader(object):
 
 	def plugin_has_help(self, filename):
 
-		for plugin_info in self.iter_plugin_info():
+		for plugin_info in self.available_plugins:
 			if plugin_info.filename == filename:
-				return hasattr(plugin_info.cls, 'show_help')
+				return plugin_info.has_help
 
 
 	def plugin_has_configure(self, filename):
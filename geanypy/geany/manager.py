@@ -17,6 +17,8 @@ class PluginManager(gtk.Dialog):
 		self.set_icon(icon)
 
 		self.connect("response", lambda w,d: self.hide())
+		# the enabled plugins are loaded after the list is filled
+		self.connect("show", self.on_show)
 
 		vbox = gtk.VBox(False, 12)
 		vbox.set_border_width(12)
@@ -70,7 +72,7 @@ class PluginManager(gtk.Dialog):
 		filename = model.get_value(iter, 2)
 		for plugin in self.loader.available_plugins:
 			if plugin.filename == filename:
-				plugin.cls.show_help()
+				self.loader.plugin_class(plugin).show_help()
 				break
 		else:
 			print("Plugin does not support help function")
@@ -128,7 +130,7 @@ class PluginManager(gtk.Dialog):
 
 	def load_sorted_plugins_info(self, list_store):
 
-		plugin_info_list = list(self.loader.iter_plugin_info())
+		plugin_info_list = list(self.loader.available_plugins)
 		#plugin_info_list.sort(key=lambda pi: pi[1])
 
 		for plugin_info in plugin_info_list:
@@ -147,6 +149,11 @@ class PluginManager(gtk.Dialog):
 			list_store.append([loaded, lbl, plugin_info.filename])
 
 
+	def on_show(self, dialog):
+		for row in self.treeview.get_model():
+			row[0] = row[2] in self.loader.plugins
+
+
 	def on_selected_plugin_changed(self, treeview, model):
 
 		path = treeview.get_cursor()[0]
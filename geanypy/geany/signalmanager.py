@@ -5,6 +5,7 @@ where the Geany types get wrapped in PyObject types.
 """
 
 import gobject
+import scintilla
 
 
 class SignalManager(gobject.GObject):
@@ -30,6 +31,12 @@ class SignalManager(gobject.GObject):
 										(gobject.TYPE_PYOBJECT,)),
 		'document-save':			(gobject.SIGNAL_RUN_LAST, gobject.TYPE_NONE,
 										(gobject.TYPE_PYOBJECT,)),
+		# The documents opened or saved in a row, such as a session or "save
+		# all", as one list of Document objects, emitted once they are done
+		'documents-opened':			(gobject.SIGNAL_RUN_LAST, gobject.TYPE_NONE,
+										(gobject.TYPE_PYOBJECT,)),
+		'documents-saved':			(gobject.SIGNAL_RUN_LAST, gobject.TYPE_NONE,
+										(gobject.TYPE_PYOBJECT,)),
 		'editor-notify':			(gobject.SIGNAL_RUN_LAST, gobject.TYPE_BOOLEAN,
 										(gobject.TYPE_PYOBJECT, gobject.TYPE_PYOBJECT)),
 		'geany-startup-complete':	(gobject.SIGNAL_RUN_LAST, gobject.TYPE_NONE,
@@ -53,6 +60,46 @@ class SignalManager(gobject.GObject):
 
 	def __init__(self):
 		self.__gobject_init__()
+		self._notification_codes = {}
+
+	def connect(self, name, callback, *user_data):
+		"""
+		Connects callback to the signal name.  Handlers connected to
+		'editor-notify' this way receive all the Scintilla notifications,
+		see connect_notification() to only receive some of them.
+		"""
+		if name == 'editor-notify':
+			return self.connect_notification(None, callback, *user_data)
+		return gobject.GObject.connect(self, name, callback, *user_data)
+
+	def connect_notification(self, codes, callback, *user_data):
+		"""
+		Connects callback to 'editor-notify', asking only for the
+		notifications whose code is in codes (a list of
+		constants such as scintilla.CHAR_ADDED), or for all of them if codes is None.
+		Notifications nobody asked for, such as the very frequent
+		'painted' ones, are not passed to Python, which keeps typing
+		fast.  The callback may still receive the codes asked for by
+		other handlers, so it should check the code it gets.
+		"""
+		if codes is None:
+			codes = [-1]
+		handler_id = gobject.GObject.connect(self, 'editor-notify',
+			callback, *user_data)
+		for code in codes:
+			scintilla.subscribe_notification(code)
+		self._notification_codes[handler_id] = codes
+		return handler_id
+
+	def disconnect(self, handler_id):
+		"""
+		Disconnects the handler handler_id.
+		"""
+		gobject.GObject.disconnect(self, handler_id)
+		for code in self._notification_codes.pop(handler_id, ()):
+			scintilla.unsubscribe_notification(code)
+
+	handler_disconnect = disconnect
 
 gobject.type_register(SignalManager)
 
@@ -0,0 +1,158 @@
+"""
+Helpers to run slow work, like a linter or reading files, on background
+threads, so that Geany's user interface doesn't freeze while it runs.
+Signal handlers and other plugin code run on the main thread, holding
+Python's global lock, so anything slow done there blocks the whole editor.
+
+The work given to a WorkerPool runs on its threads.  The lock is released
+while a thread waits for I/O, such as reading a file or the output of a
+process, so the editor keeps running meanwhile.  The result of the work is
+then passed to a callback on the main thread, which is the only one allowed
+to touch Geany and GTK+ objects:
+
+	import geany
+	from geany import worker
+
+	def lint(filename):
+		return subprocess.Popen(["pyflakes", filename],
+			stdout=subprocess.PIPE).communicate()[0]
+
+	def show_result(output, doc):
+		if doc.is_valid:
+			geany.msgwindow.compiler_add(output)
+
+	def on_document_save(signals, doc):
+		worker.submit(lint, doc.real_path,
+			callback=lambda output: show_result(output, doc))
+
+Work must not call any function of the `geany` package itself, nor use GTK+
+widgets: do that from the callback, or use call_in_main().
+"""
+
+import sys
+import threading
+import traceback
+import Queue
+
+import gobject
+
+
+# Let the other threads run while the main loop waits for events.
+gobject.threads_init()
+
+
+def call_in_main(func, *args, **kwargs):
+	"""
+	Calls func(*args, **kwargs) from Geany's main loop, on the main thread.
+	Can be called from any thread.
+	"""
+	def idle():
+		try:
+			func(*args, **kwargs)
+		except Exception:
+			traceback.print_exc()
+		return False
+	gobject.idle_add(idle)
+
+
+class WorkerPool(object):
+	"""
+	A set of threads running the work submitted to them, in order.
+	"""
+
+	def __init__(self, num_threads=2):
+		self._queue = Queue.Queue()
+		self._threads = []
+		for i in range(num_threads):
+			thread = threading.Thread(target=self._run,
+				name="geanypy-worker-%d" % i)
+			thread.daemon = True
+			thread.start()
+			self._threads.append(thread)
+
+
+	def submit(self, func, *args, **kwargs):
+		"""
+		Runs func(*args, **kwargs) on one of the threads.  The keyword
+		arguments `callback` and `error_callback`, if given, are not passed
+		to func: callback(result) is called on the main thread when func
+		returns, and error_callback(exc_info) when it raises an exception.
+		Without error_callback, the exception is printed.
+		"""
+		callback = kwargs.pop("callback", None)
+		error_callback = kwargs.pop("error_callback", None)
+		self._queue.put((func, args, kwargs, callback, error_callback))
+
+
+	def shutdown(self, wait=True):
+		"""
+		Stops the threads once the work already submitted is done.  With
+		wait, returns once they have stopped.
+		"""
+		for thread in self._threads:
+			self._queue.put(None)
+		if wait:
+			for thread in self._threads:
+				thread.join()
+		self._threads = []
+
+
+	def _run(self):
+		while True:
+			work = self._queue.get()
+			if work is None:
+				return
+			func, args, kwargs, callback, error_callback = work
+			try:
+				result = func(*args, **kwargs)
+			except Exception:
+				if error_callback is not None:
+					call_in_main(error_callback, sys.exc_info())
+				else:
+					traceback.print_exc()
+			else:
+				if callback is not None:
+					call_in_main(callback, result)
+
+
+_default_pool = None
+
+def submit(func, *args, **kwargs):
+	"""
+	Same as WorkerPool.submit(), on a pool shared by all the plugins.
+	"""
+	global _default_pool
+	if _default_pool is None:
+		_default_pool = WorkerPool()
+	_default_pool.submit(func, *args, **kwargs)
+
+
+def apply_edits(doc, edits, expected_length=None):
+	"""
+	Replaces ranges of the text of doc, as a single undo action.  edits is
+	a list of (start, end, text) tuples, with positions in the text as it
+	was when the work computing them started; they must not overlap.  To be
+	called on the main thread, typically from a callback.
+
+	Nothing is changed, and False is returned, when the document was closed
+	meanwhile, or when expected_length is given and the length of the text
+	changed, which means the positions may be wrong.
+	"""
+	if not doc.is_valid:
+		return False
+	sci = doc.editor.scintilla
+	if expected_length is not None and sci.get_length() != expected_length:
+		return False
+
+	position = sci.get_current_position()
+	sci.start_undo_action()
+	try:
+		# from the end, so the positions of the other edits don't move
+		for start, end, text in sorted(edits, reverse=True):
+			sci.set_selection_start(start)
+			sci.set_selection_end(end)
+			sci.replace_sel(text)
+	finally:
+		sci.end_undo_action()
+	sci.set_current_position(min(position, sci.get_length()))
+	return True
@@ -22,6 +22,7 @@
 #define INCLUDE_PYGOBJECT_ONCE_FULL
 
 #include "geanypy.h"
+#include "startprof.h"
 
 G_MODULE_EXPORT GeanyPlugin		*geany_plugin;
 G_MODULE_EXPORT GeanyData		*geany_data;
@@ -41,6 +42,8 @@ static GtkWidget *loader_item = NULL;
 static PyObject *manager = NULL;
 static gchar *plugin_dir = NULL;
 static SignalManager *signal_manager = NULL;
+/* The main thread, while it doesn't hold the interpreter lock */
+static PyThreadState *main_thread_state = NULL;
 
 
 /* Forward declarations to prevent compiler warnings. */
@@ -82,6 +85,7 @@ GeanyPy_start_interpreter(void)
 #endif
 
     Py_Initialize();
+    PyEval_InitThreads();
 
     /* Import the C modules */
     initapp();
@@ -139,7 +143,14 @@ static void
 GeanyPy_stop_interpreter(void)
 {
     if (Py_IsInitialized())
+    {
+        if (main_thread_state != NULL)
+        {
+            PyEval_RestoreThread(main_thread_state);
+            main_thread_state = NULL;
+        }
         Py_Finalize();
+    }
 }
 
 
@@ -235,13 +246,19 @@ GeanyPy_show_manager(void)
 static void
 on_python_plugin_loader_activate(GtkMenuItem *item, gpointer user_data)
 {
+    PyGILState_STATE state = PyGILState_Ensure();
     GeanyPy_show_manager();
+    PyGILState_Release(state);
 }
 
 
 G_MODULE_EXPORT void
 plugin_init(GeanyData *data)
 {
+    GpStartupTimer timer;
+
+    /* most of it is importing the Python plugins */
+    gp_startup_profile_start(&timer, geany_plugin, GP_STARTUP_PHASE_INIT);
     GeanyPy_start_interpreter();
     signal_manager = signal_manager_new(geany_plugin);
 
@@ -263,17 +280,27 @@ plugin_init(GeanyData *data)
     if (plugin_dir != NULL)
         GeanyPy_init_manager(plugin_dir);
 
+    /* Let the threads of the plugins run while Geany doesn't call Python */
+    if (Py_IsInitialized())
+        main_thread_state = PyEval_SaveThread();
+
     loader_item = gtk_menu_item_new_with_label(_("Python Plugin Manager"));
 	gtk_widget_set_sensitive(loader_item, plugin_dir != NULL);
 	gtk_menu_append(GTK_MENU(geany->main_widgets->tools_menu), loader_item);
 	gtk_widget_show(loader_item);
 	g_signal_connect(loader_item, "activate",
 		G_CALLBACK(on_python_plugin_loader_activate), NULL);
+    gp_startup_profile_stop(&timer);
 }
 
 
 G_MODULE_EXPORT void plugin_cleanup(void)
 {
+    if (main_thread_state != NULL)
+    {
+        PyEval_RestoreThread(main_thread_state);
+        main_thread_state = NULL;
+    }
     signal_manager_free(signal_manager);
     Py_XDECREF(manager);
 	GeanyPy_stop_interpreter();
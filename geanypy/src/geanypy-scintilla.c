@@ -221,6 +221,37 @@ Scintilla_get_contents_range(Scintilla *self, PyObject *args, PyObject *kwargs)
 }
 
 
+/* The buffer points straight into Scintilla's memory, so it is only valid
+ * until the document is modified. */
+static PyObject *
+Scintilla_get_contents_buffer(Scintilla *self, PyObject *args, PyObject *kwargs)
+{
+	gint start = -1, end = -1, len;
+	const gchar *text;
+	static gchar *kwlist[] = { "start", "end", NULL };
+
+	SCI_RET_IF_FAIL(self);
+
+	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|ii", kwlist, &start, &end))
+	{
+		len = sci_get_length(self->sci);
+		if (start < 0)
+			start = 0;
+		if (end < 0 || end > len)
+			end = len;
+		if (start > end)
+			start = end;
+		text = (const gchar *) scintilla_send_message(self->sci,
+			SCI_GETCHARACTERPOINTER, 0, 0);
+		if (text == NULL)
+			Py_RETURN_NONE;
+		return PyBuffer_FromMemory((void *) (text + start), end - start);
+	}
+
+	Py_RETURN_NONE;
+}
+
+
 static PyObject *
 Scintilla_get_current_line(Scintilla *self)
 {
@@ -486,6 +517,42 @@ Scintilla_get_style_at(Scintilla *self, PyObject *args, PyObject *kwargs)
 }
 
 
+static PyObject *
+Scintilla_get_styled_text_range(Scintilla *self, PyObject *args, PyObject *kwargs)
+{
+	gint start = -1, end = -1, len;
+	struct Sci_TextRange tr;
+	PyObject *py_text;
+	static gchar *kwlist[] = { "start", "end", NULL };
+
+	SCI_RET_IF_FAIL(self);
+
+	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|ii", kwlist, &start, &end))
+	{
+		len = sci_get_length(self->sci);
+		if (start < 0)
+			start = 0;
+		if (end < 0 || end > len)
+			end = len;
+		if (start > end)
+			start = end;
+		/* Scintilla writes a character and a style byte per position,
+		 * plus two NUL bytes, straight into the Python string */
+		py_text = PyString_FromStringAndSize(NULL, 2 * (end - start) + 2);
+		if (py_text == NULL)
+			return NULL;
+		tr.chrg.cpMin = start;
+		tr.chrg.cpMax = end;
+		tr.lpstrText = PyString_AS_STRING(py_text);
+		scintilla_send_message(self->sci, SCI_GETSTYLEDTEXT, 0, (sptr_t) &tr);
+		_PyString_Resize(&py_text, 2 * (end - start));
+		return py_text;
+	}
+
+	Py_RETURN_NONE;
+}
+
+
 static PyObject *
 Scintilla_get_tab_width(Scintilla *self)
 {
@@ -799,6 +866,10 @@ static PyMethodDef Scintilla_methods[] = {
 		"Gets all text inside a given text length." },
 	{ "get_contents_range", (PyCFunction) Scintilla_get_contents_range, METH_KEYWORDS,
 		"Gets text between start and end." },
+	{ "get_contents_buffer", (PyCFunction) Scintilla_get_contents_buffer, METH_KEYWORDS,
+		"Gets a read-only buffer over the text between start and end, "
+		"without copying it. The buffer is only valid until the document "
+		"is modified." },
 	{ "get_current_line", (PyCFunction) Scintilla_get_current_line, METH_NOARGS,
 		"Gets current line number." },
 	{ "get_current_position", (PyCFunction) Scintilla_get_current_position, METH_NOARGS,
@@ -833,6 +904,9 @@ static PyMethodDef Scintilla_methods[] = {
 		"Gets the selection start position." },
 	{ "get_style_at", (PyCFunction) Scintilla_get_style_at, METH_KEYWORDS,
 		"Gets the style ID at pos." },
+	{ "get_styled_text_range", (PyCFunction) Scintilla_get_styled_text_range, METH_KEYWORDS,
+		"Gets the text between start and end with its styles, as a string "
+		"holding a character byte then a style byte for each position." },
 	{ "get_tab_width", (PyCFunction) Scintilla_get_tab_width, METH_NOARGS,
 		"Gets display tab width (this is not indent width, see IndentPrefs)." },
 	{ "goto_line", (PyCFunction) Scintilla_goto_line, METH_KEYWORDS,
@@ -903,7 +977,40 @@ static PyTypeObject ScintillaType = {
 	0, 0,											/* tp_alloc - tp_new */
 };
 
-static PyMethodDef ScintillaModule_methods[] = { { NULL } };
+static PyObject *
+Scintilla_subscribe_notification(PyObject *module, PyObject *args, PyObject *kwargs)
+{
+	gint code = -1;
+	static gchar *kwlist[] = { "code", NULL };
+
+	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|i", kwlist, &code))
+		signal_manager_subscribe_notification(code);
+
+	Py_RETURN_NONE;
+}
+
+
+static PyObject *
+Scintilla_unsubscribe_notification(PyObject *module, PyObject *args, PyObject *kwargs)
+{
+	gint code = -1;
+	static gchar *kwlist[] = { "code", NULL };
+
+	if (PyArg_ParseTupleAndKeywords(args, kwargs, "|i", kwlist, &code))
+		signal_manager_unsubscribe_notification(code);
+
+	Py_RETURN_NONE;
+}
+
+
+static PyMethodDef ScintillaModule_methods[] = {
+	{ "subscribe_notification", (PyCFunction) Scintilla_subscribe_notification,
+		METH_KEYWORDS, "Passes the notifications with the given code (all of "
+		"them if omitted) to the 'editor-notify' signal handlers." },
+	{ "unsubscribe_notification", (PyCFunction) Scintilla_unsubscribe_notification,
+		METH_KEYWORDS, "Cancels a call to subscribe_notification() with the same code." },
+	{ NULL }
+};
 
 
 PyMODINIT_FUNC initscintilla(void)
@@ -1,14 +1,39 @@
 #include "geanypy.h"
+#include "notifyprof.h"
+#include "startprof.h"
+
+/* The documents of the batched signals, passed to Python as one list from an
+ * idle callback so that opening a session or saving all the documents is
+ * handled in one pass. Only gathered while the signal has handlers. */
+enum
+{
+	BATCH_OPENED,
+	BATCH_SAVED,
+	BATCH_COUNT
+};
+
+static const gchar *batch_signals[BATCH_COUNT] = { "documents-opened", "documents-saved" };
 
 struct _SignalManager
 {
 	GeanyPlugin *geany_plugin;
 	PyObject *py_obj;
 	GObject *obj;
+	GHashTable *editors; /* GeanyEditor -> its Python wrapper */
+	Notification *notif; /* wrapper reused while nobody else keeps it */
+	GPtrArray *batches[BATCH_COUNT]; /* GeanyDocument */
+	guint batch_source;
 };
 
 
+/* Number of subscriptions to each Scintilla notification code, and to all
+ * of them. Other notifications aren't passed to Python at all. */
+static GHashTable *notify_codes = NULL;
+static guint notify_all = 0;
+
+
 static void signal_manager_connect_signals(SignalManager *man);
+static void signal_manager_free_batches(SignalManager *man);
 
 static void on_build_start(GObject *geany_object, SignalManager *man);
 static void on_document_activate(GObject *geany_object, GeanyDocument *doc, SignalManager *man);
@@ -20,6 +45,7 @@ static void on_document_open(GObject *geany_object, GeanyDocument *doc, SignalMa
 static void on_document_reload(GObject *geany_object, GeanyDocument *doc, SignalManager *man);
 static void on_document_save(GObject *geany_object, GeanyDocument *doc, SignalManager *man);
 static gboolean on_editor_notify(GObject *geany_object, GeanyEditor *editor, SCNotification *nt, SignalManager *man);
+static gboolean on_editor_notify_profiled(GObject *geany_object, GeanyEditor *editor, SCNotification *nt, SignalManager *man);
 static void on_geany_startup_complete(GObject *geany_object, SignalManager *man);
 static void on_project_close(GObject *geany_object, SignalManager *man);
 static void on_project_dialog_confirmed(GObject *geany_object, GtkWidget *notebook, SignalManager *man);
@@ -34,12 +60,19 @@ SignalManager *signal_manager_new(GeanyPlugin *geany_plugin)
 {
 	SignalManager *man;
 	PyObject *module;
+	guint i;
 
 	man = g_new0(SignalManager, 1);
 
 	man->geany_plugin = geany_plugin;
 	man->py_obj = NULL;
 	man->obj = NULL;
+	man->editors = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+		(GDestroyNotify) Py_DecRef);
+	man->notif = NULL;
+	for (i = 0; i < BATCH_COUNT; i++)
+		man->batches[i] = g_ptr_array_new();
+	man->batch_source = 0;
 
 	module = PyImport_ImportModule("geany");
 	if (!module)
@@ -47,6 +80,8 @@ SignalManager *signal_manager_new(GeanyPlugin *geany_plugin)
 		if (PyErr_Occurred())
 			PyErr_Print();
 		g_warning("Unable to import 'geany' module");
+		signal_manager_free_batches(man);
+		g_hash_table_destroy(man->editors);
 		g_free(man);
 		return NULL;
 	}
@@ -58,6 +93,8 @@ SignalManager *signal_manager_new(GeanyPlugin *geany_plugin)
 		if (PyErr_Occurred())
 			PyErr_Print();
 		g_warning("Unable to get 'SignalManager' instance from 'geany' module.");
+		signal_manager_free_batches(man);
+		g_hash_table_destroy(man->editors);
 		g_free(man);
 		return NULL;
 	}
@@ -72,10 +109,52 @@ SignalManager *signal_manager_new(GeanyPlugin *geany_plugin)
 void signal_manager_free(SignalManager *man)
 {
 	g_return_if_fail(man != NULL);
+	if (man->batch_source != 0)
+		g_source_remove(man->batch_source);
+	signal_manager_free_batches(man);
+	g_hash_table_destroy(man->editors);
+	Py_XDECREF(man->notif);
 	Py_XDECREF(man->py_obj);
 	g_free(man);
 }
 
+
+/* A negative code subscribes to all the notifications */
+void signal_manager_subscribe_notification(gint code)
+{
+	guint count;
+
+	if (code < 0)
+	{
+		notify_all++;
+		return;
+	}
+	if (!notify_codes)
+		notify_codes = g_hash_table_new(g_direct_hash, g_direct_equal);
+	count = GPOINTER_TO_UINT(g_hash_table_lookup(notify_codes, GINT_TO_POINTER(code)));
+	g_hash_table_insert(notify_codes, GINT_TO_POINTER(code), GUINT_TO_POINTER(count + 1));
+}
+
+
+void signal_manager_unsubscribe_notification(gint code)
+{
+	guint count;
+
+	if (code < 0)
+	{
+		if (notify_all > 0)
+			notify_all--;
+		return;
+	}
+	if (!notify_codes)
+		return;
+	count = GPOINTER_TO_UINT(g_hash_table_lookup(notify_codes, GINT_TO_POINTER(code)));
+	if (count > 1)
+		g_hash_table_insert(notify_codes, GINT_TO_POINTER(code), GUINT_TO_POINTER(count - 1));
+	else
+		g_hash_table_remove(notify_codes, GINT_TO_POINTER(code));
+}
+
 GObject *signal_manager_get_gobject(SignalManager *signal_manager)
 {
 	return G_OBJECT(signal_manager->obj);
@@ -93,7 +172,7 @@ static void signal_manager_connect_signals(SignalManager *man)
 	plugin_signal_connect(geany_plugin, NULL, "document-open", TRUE, G_CALLBACK(on_document_open), man);
 	plugin_signal_connect(geany_plugin, NULL, "document-reload", TRUE, G_CALLBACK(on_document_reload), man);
 	plugin_signal_connect(geany_plugin, NULL, "document-save", TRUE, G_CALLBACK(on_document_save), man);
-	plugin_signal_connect(geany_plugin, NULL, "editor-notify", TRUE, G_CALLBACK(on_editor_notify), man);
+	plugin_signal_connect(geany_plugin, NULL, "editor-notify", TRUE, G_CALLBACK(on_editor_notify_profiled), man);
 	plugin_signal_connect(geany_plugin, NULL, "geany-startup-complete", TRUE, G_CALLBACK(on_geany_startup_complete), man);
 	plugin_signal_connect(geany_plugin, NULL, "project-close", TRUE, G_CALLBACK(on_project_close), man);
 	plugin_signal_connect(geany_plugin, NULL, "project-dialog-confirmed", TRUE, G_CALLBACK(on_project_dialog_confirmed), man);
@@ -106,15 +185,103 @@ static void signal_manager_connect_signals(SignalManager *man)
 
 static void on_build_start(GObject *geany_object, SignalManager *man)
 {
+	PyGILState_STATE state = PyGILState_Ensure();
 	g_signal_emit_by_name(man->obj, "build-start");
+	PyGILState_Release(state);
+}
+
+
+static void signal_manager_free_batches(SignalManager *man)
+{
+	guint i;
+
+	for (i = 0; i < BATCH_COUNT; i++)
+		g_ptr_array_free(man->batches[i], TRUE);
+}
+
+
+/* Whether any Python handler is connected to the signal, so that nothing
+ * is wrapped for Python otherwise */
+static gboolean signal_manager_has_handlers(SignalManager *man, const gchar *signal_name)
+{
+	guint signal_id = g_signal_lookup(signal_name, G_OBJECT_TYPE(man->obj));
+
+	return signal_id != 0 && g_signal_has_handler_pending(man->obj, signal_id, 0, FALSE);
+}
+
+
+static gboolean on_batches_idle(SignalManager *man)
+{
+	PyGILState_STATE state;
+	guint i, j;
+
+	man->batch_source = 0;
+
+	state = PyGILState_Ensure();
+	for (i = 0; i < BATCH_COUNT; i++)
+	{
+		GPtrArray *docs = man->batches[i];
+		PyObject *py_docs;
+
+		if (docs->len == 0)
+			continue;
+
+		py_docs = PyList_New(0);
+		for (j = 0; j < docs->len; j++)
+		{
+			PyObject *py_doc = (PyObject *) Document_create_new_from_geany_document(
+				g_ptr_array_index(docs, j));
+
+			if (py_doc)
+			{
+				PyList_Append(py_docs, py_doc);
+				Py_DECREF(py_doc);
+			}
+		}
+		/* the handlers may open or save more documents, for the next batch */
+		g_ptr_array_set_size(docs, 0);
+		g_signal_emit_by_name(man->obj, batch_signals[i], py_docs);
+		Py_DECREF(py_docs);
+	}
+	PyGILState_Release(state);
+
+	return FALSE;
+}
+
+
+static void signal_manager_batch_document(SignalManager *man, guint batch, GeanyDocument *doc)
+{
+	GPtrArray *docs = man->batches[batch];
+	guint i;
+
+	if (!signal_manager_has_handlers(man, batch_signals[batch]))
+		return;
+
+	for (i = 0; i < docs->len; i++)
+	{
+		if (g_ptr_array_index(docs, i) == doc)
+			break;
+	}
+	if (i == docs->len)
+		g_ptr_array_add(docs, doc);
+	if (man->batch_source == 0)
+		man->batch_source = g_idle_add((GSourceFunc) on_batches_idle, man);
 }
 
 
 static void on_document_event(GObject *geany_object, GeanyDocument *doc, SignalManager *man, const gchar *signal_name)
 {
-	PyObject *py_doc = (PyObject *) Document_create_new_from_geany_document(doc);
+	PyObject *py_doc;
+	PyGILState_STATE state;
+
+	if (!signal_manager_has_handlers(man, signal_name))
+		return;
+
+	state = PyGILState_Ensure();
+	py_doc = (PyObject *) Document_create_new_from_geany_document(doc);
 	g_signal_emit_by_name(man->obj, signal_name, py_doc);
 	Py_XDECREF(py_doc);
+	PyGILState_Release(state);
 }
 
 
@@ -132,18 +299,30 @@ static void on_document_before_save(GObject *geany_object, GeanyDocument *doc, S
 
 static void on_document_close(GObject *geany_object, GeanyDocument *doc, SignalManager *man)
 {
+	PyGILState_STATE state;
+	guint i;
+
 	on_document_event(geany_object, doc, man, "document-close");
+	for (i = 0; i < BATCH_COUNT; i++)
+		g_ptr_array_remove(man->batches[i], doc);
+	state = PyGILState_Ensure();
+	g_hash_table_remove(man->editors, doc->editor);
+	PyGILState_Release(state);
 }
 
 
 static void on_document_filetype_set(GObject *geany_object, GeanyDocument *doc, GeanyFiletype *filetype_old, SignalManager *man)
 {
 	PyObject *py_doc, *py_ft;
+	PyGILState_STATE state;
+
+	state = PyGILState_Ensure();
 	py_doc = (PyObject *) Document_create_new_from_geany_document(doc);
 	py_ft = (PyObject *) Filetype_create_new_from_geany_filetype(filetype_old);
 	g_signal_emit_by_name(man->obj, "document-filetype-set", py_doc, py_ft);
 	Py_XDECREF(py_doc);
 	Py_XDECREF(py_ft);
+	PyGILState_Release(state);
 }
 
 
@@ -155,7 +334,12 @@ static void on_document_new(GObject *geany_object, GeanyDocument *doc, SignalMan
 
 static void on_document_open(GObject *geany_object, GeanyDocument *doc, SignalManager *man)
 {
+	GpStartupTimer timer;
+
+	gp_startup_profile_start(&timer, man->geany_plugin, GP_STARTUP_PHASE_DOCUMENT_OPEN);
 	on_document_event(geany_object, doc, man, "document-open");
+	signal_manager_batch_document(man, BATCH_OPENED, doc);
+	gp_startup_profile_stop(&timer);
 }
 
 
@@ -168,76 +352,157 @@ static void on_document_reload(GObject *geany_object, GeanyDocument *doc, Signal
 static void on_document_save(GObject *geany_object, GeanyDocument *doc, SignalManager *man)
 {
 	on_document_event(geany_object, doc, man, "document-save");
+	signal_manager_batch_document(man, BATCH_SAVED, doc);
 }
 
 
 static gboolean on_editor_notify(GObject *geany_object, GeanyEditor *editor, SCNotification *nt, SignalManager *man)
 {
 	gboolean res = FALSE;
-	PyObject *py_ed, *py_notif;
-	py_ed = (PyObject *) Editor_create_new_from_geany_editor(editor);
-	py_notif = (PyObject *) Notification_create_new_from_scintilla_notification(nt);
-	g_signal_emit_by_name(man->obj, "editor-notify", py_ed, py_notif, &res);
-	Py_XDECREF(py_ed);
-	Py_XDECREF(py_notif);
+	PyObject *py_ed;
+	PyGILState_STATE state;
+
+	if (notify_all == 0 && (!notify_codes ||
+		!g_hash_table_lookup(notify_codes, GINT_TO_POINTER(nt->nmhdr.code))))
+	{
+		return FALSE;
+	}
+
+	state = PyGILState_Ensure();
+
+	py_ed = g_hash_table_lookup(man->editors, editor);
+	if (!py_ed)
+	{
+		py_ed = (PyObject *) Editor_create_new_from_geany_editor(editor);
+		g_hash_table_insert(man->editors, editor, py_ed);
+	}
+
+	/* reuse the wrapper unless a handler kept a reference to it */
+	if (man->notif && (man->notif->ob_refcnt > 1 || man->notif->hdr->ob_refcnt > 1))
+	{
+		Py_DECREF(man->notif);
+		man->notif = NULL;
+	}
+	if (!man->notif)
+		man->notif = Notification_create_new_from_scintilla_notification(nt);
+	else
+	{
+		man->notif->notif = nt;
+		man->notif->hdr->notif = nt;
+	}
+
+	g_signal_emit_by_name(man->obj, "editor-notify", py_ed, man->notif, &res);
+	PyGILState_Release(state);
+	return res;
+}
+
+
+/* the handlers of all the Python plugins are measured as one */
+static gboolean on_editor_notify_profiled(GObject *geany_object, GeanyEditor *editor, SCNotification *nt, SignalManager *man)
+{
+	GpNotifyTimer timer;
+	gboolean res;
+
+	gp_notify_profile_start(&timer, man->geany_plugin, nt);
+	res = on_editor_notify(geany_object, editor, nt, man);
+	gp_notify_profile_stop(&timer);
 	return res;
 }
 
 
 static void on_geany_startup_complete(GObject *geany_object, SignalManager *man)
 {
+	GpStartupTimer timer;
+	PyGILState_STATE state;
+
+	gp_startup_profile_start(&timer, man->geany_plugin, GP_STARTUP_PHASE_STARTUP_COMPLETE);
+	state = PyGILState_Ensure();
 	g_signal_emit_by_name(man->obj, "geany-startup-complete");
+	PyGILState_Release(state);
+	gp_startup_profile_stop(&timer);
 }
 
 
 static void on_project_close(GObject *geany_object, SignalManager *man)
 {
+	PyGILState_STATE state = PyGILState_Ensure();
 	g_signal_emit_by_name(man->obj, "project-close");
+	PyGILState_Release(state);
 }
 
 
 static void on_project_dialog_confirmed(GObject *geany_object, GtkWidget *notebook, SignalManager *man)
 {
-	PyObject *gob = (PyObject *) pygobject_new(G_OBJECT(notebook));
+	PyObject *gob;
+	PyGILState_STATE state;
+
+	state = PyGILState_Ensure();
+	gob = (PyObject *) pygobject_new(G_OBJECT(notebook));
 	g_signal_emit_by_name(man->obj, "project-dialog-confirmed", gob);
 	Py_XDECREF(gob);
+	PyGILState_Release(state);
 }
 
 
 static void on_project_dialog_open(GObject *geany_object, GtkWidget *notebook, SignalManager *man)
 {
-	PyObject *gob = (PyObject *) pygobject_new(G_OBJECT(notebook));
+	PyObject *gob;
+	PyGILState_STATE state;
+
+	state = PyGILState_Ensure();
+	gob = (PyObject *) pygobject_new(G_OBJECT(notebook));
 	g_signal_emit_by_name(man->obj, "project-dialog-open", gob);
 	Py_XDECREF(gob);
+	PyGILState_Release(state);
 }
 
 static void on_project_dialog_close(GObject *geany_object, GtkWidget *notebook, SignalManager *man)
 {
-	PyObject *gob = (PyObject *) pygobject_new(G_OBJECT(notebook));
+	PyObject *gob;
+	PyGILState_STATE state;
+
+	state = PyGILState_Ensure();
+	gob = (PyObject *) pygobject_new(G_OBJECT(notebook));
 	g_signal_emit_by_name(man->obj, "project-dialog-close", gob);
 	Py_XDECREF(gob);
+	PyGILState_Release(state);
 }
 
 
 static void on_project_open(GObject *geany_object, GKeyFile *config, SignalManager *man)
 {
-	PyObject *py_proj = (PyObject *) GEANYPY_NEW(Project);
+	PyObject *py_proj;
+	PyGILState_STATE state;
+
+	state = PyGILState_Ensure();
+	py_proj = (PyObject *) GEANYPY_NEW(Project);
 	g_signal_emit_by_name(man->obj, "project-open", py_proj);
 	Py_XDECREF(py_proj);
+	PyGILState_Release(state);
 }
 
 
 static void on_project_save(GObject *geany_object, GKeyFile *config, SignalManager *man)
 {
-	PyObject *py_proj = (PyObject *) GEANYPY_NEW(Project);
+	PyObject *py_proj;
+	PyGILState_STATE state;
+
+	state = PyGILState_Ensure();
+	py_proj = (PyObject *) GEANYPY_NEW(Project);
 	g_signal_emit_by_name(man->obj, "project-save", py_proj);
 	Py_XDECREF(py_proj);
+	PyGILState_Release(state);
 }
 
 
 static void on_update_editor_menu(GObject *geany_object, const gchar *word, gint pos, GeanyDocument *doc, SignalManager *man)
 {
-	PyObject *py_doc = (PyObject *) Document_create_new_from_geany_document(doc);
+	PyObject *py_doc;
+	PyGILState_STATE state;
+
+	state = PyGILState_Ensure();
+	py_doc = (PyObject *) Document_create_new_from_geany_document(doc);
 	g_signal_emit_by_name(man->obj, "update-editor-menu", word, pos, py_doc);
 	Py_XDECREF(py_doc);
+	PyGILState_Release(state);
 }
@@ -6,5 +6,7 @@ typedef struct _SignalManager SignalManager;
 SignalManager *signal_manager_new(GeanyPlugin *geany_plugin);
 void signal_manager_free(SignalManager *signal_manager);
 GObject *signal_manager_get_gobject(SignalManager *signal_manager);
+void signal_manager_subscribe_notification(gint code);
+void signal_manager_unsubscribe_notification(gint code);
 
 #endif /* SIGNALMANAGER_H */
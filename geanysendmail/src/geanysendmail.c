@@ -28,7 +28,11 @@
 	#include "config.h" /* for the gettext domain */
 #endif
 
+#include <string.h>
 #include <geanyplugin.h>
+#ifdef G_OS_UNIX
+# include <sys/wait.h>
+#endif
 #include "icon.h"
 
 GeanyPlugin		*geany_plugin;
@@ -63,117 +67,236 @@ GtkWidget *mailbutton = NULL;
 static GtkWidget *main_menu_item = NULL;
 
 
+/* A mailer being run, watched to report how it ended */
+typedef struct
+{
+	GPid pid;
+	guint source;
+	gchar *filename; /* UTF-8, for the messages */
+} MailerChild;
+
+static GSList *mailer_children = NULL;
+
+
+static void mailer_child_free(MailerChild *child)
+{
+	g_spawn_close_pid(child->pid);
+	g_free(child->filename);
+	g_free(child);
+}
+
+
+static void on_mailer_exited(GPid pid, gint status, gpointer data)
+{
+	MailerChild *child = data;
+	gint code = status;
+
+#ifdef G_OS_UNIX
+	code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+	if (code == 0)
+		msgwin_status_add(_("The mailer finished with %s."), child->filename);
+	else
+		msgwin_status_add(_("The mailer failed with %s (exit status %d)."), child->filename, code);
+
+	mailer_children = g_slist_remove(mailer_children, child);
+	mailer_child_free(child);
+}
+
+
+static gboolean run_mailer(const gchar *command, const gchar *filename)
+{
+	gchar **argv;
+	GPid pid;
+	GError *error = NULL;
+
+	if (! g_shell_parse_argv(command, NULL, &argv, &error))
+	{
+		msgwin_status_add(_("Could not execute mailer: %s"), error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	if (! g_spawn_async(NULL, argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+			NULL, NULL, &pid, &error))
+	{
+		msgwin_status_add(_("Could not execute mailer: %s"), error->message);
+		g_error_free(error);
+		g_strfreev(argv);
+		return FALSE;
+	}
+	g_strfreev(argv);
+
+	{
+		MailerChild *child = g_new0(MailerChild, 1);
+
+		child->pid = pid;
+		child->filename = g_strdup(filename);
+		child->source = g_child_watch_add(pid, on_mailer_exited, child);
+		mailer_children = g_slist_prepend(mailer_children, child);
+	}
+	return TRUE;
+}
+
+
+static gchar *get_temp_dir(void)
+{
+	gchar *config_dir = g_path_get_dirname(config_file);
+	gchar *temp_dir = g_build_filename(config_dir, "tmp", NULL);
+
+	g_free(config_dir);
+	return temp_dir;
+}
+
+
+/* Writes the buffer of an unsaved document to a file of the same name in the
+ * plugin's temporary directory, reused by the next sends.  The files are kept,
+ * as a mailer may read them only when the mail is sent.
+ * Returns: the locale file name, or NULL */
+static gchar *write_temp_file(GeanyDocument *doc)
+{
+	gchar *temp_dir = get_temp_dir();
+	gchar *basename = g_path_get_basename(DOC_FILENAME(doc));
+	gchar *locale_basename = utils_get_locale_from_utf8(basename);
+	gchar *locale_filename = g_build_filename(temp_dir, locale_basename, NULL);
+	gchar *text = sci_get_contents(doc->editor->sci, -1);
+	gchar *data = NULL;
+	gsize len = 0;
+	gint error;
+	GError *gerror = NULL;
+
+	/* written in the document's encoding if possible */
+	if (doc->encoding != NULL && ! utils_str_equal(doc->encoding, "UTF-8"))
+		data = g_convert(text, -1, doc->encoding, "UTF-8", NULL, &len, NULL);
+	if (data == NULL)
+	{
+		data = text;
+		len = strlen(text);
+		text = NULL;
+	}
+
+	error = utils_mkdir(temp_dir, TRUE);
+	if (error != 0)
+	{
+		msgwin_status_add(_("Could not create the directory %s: %s"), temp_dir,
+			g_strerror(error));
+		g_free(locale_filename);
+		locale_filename = NULL;
+	}
+	else if (! g_file_set_contents(locale_filename, data, len, &gerror))
+	{
+		msgwin_status_add(_("Could not write the temporary file %s: %s"), basename,
+			gerror->message);
+		g_error_free(gerror);
+		g_free(locale_filename);
+		locale_filename = NULL;
+	}
+
+	g_free(text);
+	g_free(data);
+	g_free(locale_basename);
+	g_free(basename);
+	g_free(temp_dir);
+	return locale_filename;
+}
+
+
 /* Callback for sending file as attachment */
 static void
 send_as_attachment(G_GNUC_UNUSED GtkMenuItem *menuitem, G_GNUC_UNUSED gpointer gdata)
 {
 	GeanyDocument *doc;
 	gchar	*locale_filename = NULL;
+	gchar	*locale_basename;
 	gchar	*command = NULL;
-	GError	*error = NULL;
 	GString	*cmd_str = NULL;
-	GKeyFile 	*config = g_key_file_new();
-	gchar 		*config_dir = g_path_get_dirname(config_file);
+	GKeyFile 	*config;
+	gchar 		*config_dir;
 	gchar 		*data;
 
 	doc = document_get_current();
 
-	if (doc->file_name == NULL)
+	if (! mailer)
 	{
-		dialogs_show_save_as();
+		ui_set_statusbar(FALSE, _("Please define a mail client first."));
+		return;
 	}
+
+	/* an unsaved document is sent as it is, without saving it */
+	if (doc->file_name == NULL || doc->changed)
+		locale_filename = write_temp_file(doc);
 	else
-	{
-		document_save_file(doc, FALSE);
-	}
+		locale_filename = utils_get_locale_from_utf8(doc->file_name);
 
-    if (doc->file_name != NULL)
+	if (locale_filename == NULL)
+		return;
+
+	cmd_str = g_string_new(mailer);
+	if ((use_address_dialog == TRUE) && (g_strrstr(mailer, "%r") != NULL))
 	{
-		if (mailer)
+		gchar *input = dialogs_show_input(_("Recipient's Address"),
+								GTK_WINDOW(geany->main_widgets->window),
+								_("Enter the recipient's e-mail address:"),
+								address);
+
+		if (! input)
 		{
-			locale_filename = utils_get_locale_from_utf8(doc->file_name);
-			cmd_str = g_string_new(mailer);
-			if ((use_address_dialog == TRUE) && (g_strrstr(mailer, "%r") != NULL))
-			{
- 				gchar *input = dialogs_show_input(_("Recipient's Address"),
-										GTK_WINDOW(geany->main_widgets->window),
-										_("Enter the recipient's e-mail address:"),
-										address);
-
-				if (input)
-				{
-					g_key_file_load_from_file(config, config_file, G_KEY_FILE_NONE, NULL);
-
-					g_free(address);
- 					address = input;
-
- 					g_key_file_set_string(config, "tools", "address", address);
- 				}
- 				else
- 				{
-					g_string_free(cmd_str, TRUE);
-					g_free(locale_filename);
-					return;
-				}
-
-				if (! g_file_test(config_dir, G_FILE_TEST_IS_DIR) &&
-				      utils_mkdir(config_dir, TRUE) != 0)
- 				{
- 					dialogs_show_msgbox(GTK_MESSAGE_ERROR,
- 						_("Plugin configuration directory could not be created."));
- 				}
- 				else
- 				{
- 					/* write config to file */
- 					data = g_key_file_to_data(config, NULL, NULL);
- 					utils_write_file(config_file, data);
-					g_free(data);
-					g_key_file_free(config);
- 					g_free(config_dir);
- 				}
- 			}
-
-			if (! utils_string_replace_all(cmd_str, "%f", locale_filename))
-				ui_set_statusbar(FALSE,
-				_("Filename placeholder not found. The executed command might have failed."));
-
-			if (use_address_dialog == TRUE && address != NULL)
-			{
-				if (! utils_string_replace_all(cmd_str, "%r", address))
- 					ui_set_statusbar(FALSE,
-					_("Recipient address placeholder not found. The executed command might have failed."));
-					g_free(address);
-			}
-			else
-			{
-				/* Removes %r if option was not activ but was included into command */
-				utils_string_replace_all(cmd_str, "%r", "");
-			}
+			g_string_free(cmd_str, TRUE);
+			g_free(locale_filename);
+			return;
+		}
 
-			utils_string_replace_all(cmd_str, "%b", g_path_get_basename(locale_filename));
+		g_free(address);
+		address = input;
 
-			command = g_string_free(cmd_str, FALSE);
-			g_spawn_command_line_async(command, &error);
-			if (error != NULL)
-			{
-				ui_set_statusbar(FALSE, _("Could not execute mailer. Please check your configuration."));
-				g_error_free(error);
-			}
+		config = g_key_file_new();
+		config_dir = g_path_get_dirname(config_file);
+		g_key_file_load_from_file(config, config_file, G_KEY_FILE_NONE, NULL);
+		g_key_file_set_string(config, "tools", "address", address);
 
-			g_free(locale_filename);
-			g_free(command);
+		if (! g_file_test(config_dir, G_FILE_TEST_IS_DIR) &&
+		      utils_mkdir(config_dir, TRUE) != 0)
+		{
+			dialogs_show_msgbox(GTK_MESSAGE_ERROR,
+				_("Plugin configuration directory could not be created."));
 		}
 		else
 		{
-			ui_set_statusbar(FALSE, _("Please define a mail client first."));
+			/* write config to file */
+			data = g_key_file_to_data(config, NULL, NULL);
+			utils_write_file(config_file, data);
+			g_free(data);
 		}
+		g_key_file_free(config);
+		g_free(config_dir);
+	}
+
+	if (! utils_string_replace_all(cmd_str, "%f", locale_filename))
+		ui_set_statusbar(FALSE,
+		_("Filename placeholder not found. The executed command might have failed."));
+
+	if (use_address_dialog == TRUE && address != NULL)
+	{
+		if (! utils_string_replace_all(cmd_str, "%r", address))
+			ui_set_statusbar(FALSE,
+			_("Recipient address placeholder not found. The executed command might have failed."));
 	}
 	else
 	{
-		ui_set_statusbar(FALSE, _("File has to be saved before sending."));
+		/* Removes %r if option was not activ but was included into command */
+		utils_string_replace_all(cmd_str, "%r", "");
 	}
 
-	g_key_file_free(config);
+	locale_basename = g_path_get_basename(locale_filename);
+	utils_string_replace_all(cmd_str, "%b", locale_basename);
+	g_free(locale_basename);
+
+	command = g_string_free(cmd_str, FALSE);
+	if (! run_mailer(command, DOC_FILENAME(doc)))
+		ui_set_statusbar(FALSE, _("Could not execute mailer. Please check your configuration."));
+
+	g_free(locale_filename);
+	g_free(command);
 }
 
 static void key_send_as_attachment(G_GNUC_UNUSED guint key_id)
@@ -399,6 +522,15 @@ void plugin_init(GeanyData G_GNUC_UNUSED *data)
 
 void plugin_cleanup(void)
 {
+	/* the mailers still running are no longer watched */
+	while (mailer_children != NULL)
+	{
+		MailerChild *child = mailer_children->data;
+
+		g_source_remove(child->source);
+		mailer_children = g_slist_delete_link(mailer_children, mailer_children);
+		mailer_child_free(child);
+	}
 	gtk_widget_destroy(main_menu_item);
 	cleanup_icon();
 	g_free(mailer);
@@ -0,0 +1,517 @@
+/*
+ *      blame.c - Plugin to geany light IDE to work with vc
+ *
+ *      Annotation of the current line with its last change, from a cached blame.
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifndef G_OS_WIN32
+#include <sys/types.h>
+#include <signal.h>
+#endif
+
+#include <geanyplugin.h>
+#include <glib/gstdio.h>
+#include "geanyvc.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+extern GeanyPlugin *geany_plugin;
+
+
+/* number of files whose blame is kept */
+#define BLAME_CACHE_SIZE  16
+#define BLAME_READ_SIZE   65536
+
+
+/* A revision some lines were last changed in, as given by the porcelain headers */
+typedef struct
+{
+	gchar *author;
+	gchar *date;
+	gchar *summary;
+} BlameCommit;
+
+/* The blame of a file, for the revision of its working copy */
+typedef struct
+{
+	gchar *key;		/* file name and revision */
+	time_t mtime;		/* of the file when blamed, a saved change invalidates the blame */
+	GPtrArray *lines;	/* BlameCommit of each line, NULL while not parsed yet */
+	GHashTable *commits;	/* hash -> BlameCommit, owns them */
+	gboolean complete;
+} BlameData;
+
+/* The blame being parsed as the output of the command arrives */
+typedef struct
+{
+	BlameData *data;
+	GPid pid;
+	guint child_source;
+	GIOChannel *channel;
+	guint channel_source;
+	GString *buffer;	/* incomplete line of output */
+	BlameCommit *commit;	/* of the header being parsed */
+	gboolean new_commit;	/* whether its details follow */
+	gint line;		/* line of the header being parsed */
+
+	GeanyDocument *doc;	/* to show the annotation for, NULL once shown */
+	gint doc_line;
+} BlameJob;
+
+
+static GHashTable *blame_cache = NULL;	/* key -> BlameData */
+static GQueue *blame_lru = NULL;	/* of BlameData, the most recently used first */
+static BlameJob *blame_job = NULL;
+
+
+static void
+blame_commit_free(BlameCommit * commit)
+{
+	g_free(commit->author);
+	g_free(commit->date);
+	g_free(commit->summary);
+	g_free(commit);
+}
+
+
+static void
+blame_data_free(BlameData * data)
+{
+	g_free(data->key);
+	g_ptr_array_free(data->lines, TRUE);
+	g_hash_table_destroy(data->commits);
+	g_free(data);
+}
+
+
+static time_t
+blame_get_mtime(const gchar * filename)
+{
+	gchar *locale_filename = utils_get_locale_from_utf8(filename);
+	struct stat st;
+	time_t mtime = 0;
+
+	if (g_stat(locale_filename, &st) == 0)
+		mtime = st.st_mtime;
+	g_free(locale_filename);
+	return mtime;
+}
+
+
+static void
+blame_cache_remove(BlameData * data)
+{
+	g_queue_remove(blame_lru, data);
+	g_hash_table_remove(blame_cache, data->key);
+}
+
+
+static BlameData *
+blame_cache_lookup(const gchar * key, time_t mtime)
+{
+	BlameData *data = g_hash_table_lookup(blame_cache, key);
+
+	if (data == NULL)
+		return NULL;
+	if (data->mtime != mtime)
+	{
+		if (blame_job == NULL || blame_job->data != data)
+			blame_cache_remove(data);
+		return NULL;
+	}
+
+	g_queue_remove(blame_lru, data);
+	g_queue_push_head(blame_lru, data);
+	return data;
+}
+
+
+static BlameData *
+blame_cache_add(const gchar * key, time_t mtime)
+{
+	BlameData *data = g_new0(BlameData, 1);
+
+	data->key = g_strdup(key);
+	data->mtime = mtime;
+	data->lines = g_ptr_array_new();
+	data->commits = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					      (GDestroyNotify) blame_commit_free);
+
+	g_hash_table_insert(blame_cache, data->key, data);
+	g_queue_push_head(blame_lru, data);
+
+	while (g_queue_get_length(blame_lru) > BLAME_CACHE_SIZE)
+		blame_cache_remove(g_queue_peek_tail(blame_lru));
+	return data;
+}
+
+
+/* Shows the annotation of line in a calltip, returns FALSE if it isn't known (yet) */
+static gboolean
+blame_show(GeanyDocument * doc, gint line, BlameData * data)
+{
+	BlameCommit *commit = NULL;
+	gchar *text;
+
+	if ((guint) line < data->lines->len)
+		commit = g_ptr_array_index(data->lines, line);
+	if (commit == NULL)
+	{
+		if (data->complete)
+			ui_set_statusbar(FALSE, _("No history available"));
+		return data->complete;
+	}
+
+	text = g_strdup_printf("%s  %s\n%s", commit->author ? commit->author : "",
+			       commit->date ? commit->date : "",
+			       commit->summary ? commit->summary : "");
+	scintilla_send_message(doc->editor->sci, SCI_CALLTIPSHOW,
+			       sci_get_position_from_line(doc->editor->sci, line), (sptr_t) text);
+	g_free(text);
+	return TRUE;
+}
+
+
+/* Shows the annotation requested when its line has been parsed */
+static void
+blame_job_show(BlameJob * job)
+{
+	if (job->doc == NULL)
+		return;
+
+	if (!job->doc->is_valid || job->doc != document_get_current() ||
+	    sci_get_current_line(job->doc->editor->sci) != job->doc_line)
+		job->doc = NULL;
+	else if (blame_show(job->doc, job->doc_line, job->data))
+		job->doc = NULL;
+}
+
+
+/* Parses a line of "git blame --porcelain" output */
+static void
+blame_job_parse_line(BlameJob * job, gchar * line)
+{
+	BlameData *data = job->data;
+
+	if (line[0] == '\t')
+	{
+		/* the content of the line ends its header */
+		if (job->commit != NULL && job->line >= 0)
+		{
+			if ((guint) job->line >= data->lines->len)
+				g_ptr_array_set_size(data->lines, job->line + 1);
+			g_ptr_array_index(data->lines, job->line) = job->commit;
+		}
+		job->commit = NULL;
+	}
+	else if (job->commit == NULL)
+	{
+		/* <hash> <original line> <final line> [<lines in group>] */
+		gchar **fields = g_strsplit(line, " ", 4);
+
+		if (g_strv_length(fields) >= 3)
+		{
+			job->commit = g_hash_table_lookup(data->commits, fields[0]);
+			job->new_commit = (job->commit == NULL);
+			if (job->new_commit)
+			{
+				job->commit = g_new0(BlameCommit, 1);
+				g_hash_table_insert(data->commits, g_strdup(fields[0]), job->commit);
+			}
+			job->line = atoi(fields[2]) - 1;
+		}
+		g_strfreev(fields);
+	}
+	else if (job->new_commit)
+	{
+		if (g_str_has_prefix(line, "author "))
+			setptr(job->commit->author, g_strdup(line + strlen("author ")));
+		else if (g_str_has_prefix(line, "author-time "))
+		{
+			time_t t = (time_t) strtol(line + strlen("author-time "), NULL, 10);
+			gchar date[64];
+
+			if (strftime(date, sizeof(date), "%Y-%m-%d %H:%M", localtime(&t)) > 0)
+				setptr(job->commit->date, g_strdup(date));
+		}
+		else if (g_str_has_prefix(line, "summary "))
+			setptr(job->commit->summary, g_strdup(line + strlen("summary ")));
+	}
+}
+
+
+static void
+blame_job_parse(BlameJob * job)
+{
+	gchar *start = job->buffer->str;
+	gchar *end;
+
+	while ((end = strchr(start, '\n')) != NULL)
+	{
+		*end = '\0';
+		if (end > start && end[-1] == '\r')
+			end[-1] = '\0';
+		if (!g_utf8_validate(start, -1, NULL))
+		{
+			gchar *utf8 = encodings_convert_to_utf8(start, -1, NULL);
+
+			if (utf8)
+			{
+				blame_job_parse_line(job, utf8);
+				g_free(utf8);
+			}
+		}
+		else
+			blame_job_parse_line(job, start);
+		start = end + 1;
+	}
+	g_string_erase(job->buffer, 0, start - job->buffer->str);
+}
+
+
+static void
+blame_job_free(BlameJob * job)
+{
+	if (job->channel)
+		g_io_channel_unref(job->channel);
+	g_string_free(job->buffer, TRUE);
+	g_free(job);
+}
+
+
+static void
+blame_job_reap_cb(GPid pid, G_GNUC_UNUSED gint status, G_GNUC_UNUSED gpointer data)
+{
+	g_spawn_close_pid(pid);
+}
+
+
+/* Stops the running blame, the incomplete blame is dropped from the cache */
+static void
+blame_job_cancel(void)
+{
+	BlameJob *job = blame_job;
+
+	if (job == NULL)
+		return;
+
+	if (job->channel_source)
+		g_source_remove(job->channel_source);
+	if (job->child_source)
+	{
+		g_source_remove(job->child_source);
+#ifndef G_OS_WIN32
+		kill(job->pid, SIGTERM);
+#endif
+		/* the process still needs to be reaped */
+		g_child_watch_add(job->pid, blame_job_reap_cb, NULL);
+	}
+
+	blame_job = NULL;
+	blame_cache_remove(job->data);
+	blame_job_free(job);
+}
+
+
+static void
+blame_job_finish(BlameJob * job)
+{
+	job->data->complete = TRUE;
+	blame_job_show(job);
+
+	blame_job = NULL;
+	blame_job_free(job);
+}
+
+
+static gboolean
+blame_job_read_cb(GIOChannel * channel, GIOCondition cond, gpointer user_data)
+{
+	BlameJob *job = user_data;
+	gchar buf[BLAME_READ_SIZE];
+	gsize n = 0;
+	GIOStatus status = G_IO_STATUS_EOF;
+
+	if (cond & (G_IO_IN | G_IO_PRI))
+		status = g_io_channel_read_chars(channel, buf, sizeof(buf), &n, NULL);
+
+	if (n > 0)
+	{
+		g_string_append_len(job->buffer, buf, n);
+		blame_job_parse(job);
+		/* the first lines can be annotated before the whole file is blamed */
+		blame_job_show(job);
+	}
+	if (status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN)
+		return TRUE;
+
+	job->channel_source = 0;
+	g_io_channel_unref(job->channel);
+	job->channel = NULL;
+	if (job->child_source == 0)
+		blame_job_finish(job);
+	return FALSE;
+}
+
+
+static void
+blame_job_exited_cb(GPid pid, G_GNUC_UNUSED gint status, gpointer user_data)
+{
+	BlameJob *job = user_data;
+
+	g_spawn_close_pid(pid);
+	job->pid = 0;
+	job->child_source = 0;
+	if (job->channel == NULL)
+		blame_job_finish(job);
+}
+
+
+static gboolean
+blame_job_start(BlameData * data, const gchar * dir, gchar ** argv, gchar ** env)
+{
+	BlameJob *job;
+	GPid pid;
+	gint out_fd;
+	GError *error = NULL;
+
+	if (!g_spawn_async_with_pipes(dir, argv, env,
+				      G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+				      G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL,
+				      &pid, NULL, &out_fd, NULL, &error))
+	{
+		g_warning("geanyvc: s_spawn_async error: %s", error->message);
+		ui_set_statusbar(FALSE, _("geanyvc: s_spawn_async error: %s"), error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	job = g_new0(BlameJob, 1);
+	job->data = data;
+	job->pid = pid;
+	job->buffer = g_string_new(NULL);
+	job->child_source = g_child_watch_add(pid, blame_job_exited_cb, job);
+#ifdef G_OS_WIN32
+	job->channel = g_io_channel_win32_new_fd(out_fd);
+#else
+	job->channel = g_io_channel_unix_new(out_fd);
+#endif
+	g_io_channel_set_encoding(job->channel, NULL, NULL);
+	g_io_channel_set_buffered(job->channel, FALSE);
+	g_io_channel_set_close_on_unref(job->channel, TRUE);
+	job->channel_source = g_io_add_watch(job->channel, G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR,
+					     blame_job_read_cb, job);
+
+	blame_job = job;
+	return TRUE;
+}
+
+
+/* Shows the last change of the current line of doc in a calltip. The blame of the file is
+ * cached for the revision of the working copy; if it isn't, it is started in the
+ * background and the annotation is shown as soon as the line has been parsed. */
+void
+vc_blame_show_line(GeanyDocument * doc)
+{
+	gchar *dir = NULL;
+	gchar *revision = NULL;
+	gchar **argv;
+	gchar **env = NULL;
+	gchar *key;
+	time_t mtime;
+	BlameData *data;
+	gint line;
+
+	g_return_if_fail(doc != NULL && doc->file_name != NULL);
+
+	argv = get_blame_lines_command(doc->file_name, &dir, &env, &revision);
+	if (argv == NULL)
+	{
+		ui_set_statusbar(FALSE, _("The version control system of %s can't annotate lines."),
+				 doc->file_name);
+		return;
+	}
+
+	if (blame_cache == NULL)
+	{
+		blame_cache = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+						    (GDestroyNotify) blame_data_free);
+		blame_lru = g_queue_new();
+	}
+
+	line = sci_get_current_line(doc->editor->sci);
+	key = g_strconcat(doc->file_name, "\n", revision ? revision : "", NULL);
+	mtime = blame_get_mtime(doc->file_name);
+	data = blame_cache_lookup(key, mtime);
+
+	if (data == NULL || (!data->complete && (blame_job == NULL || blame_job->data != data)))
+	{
+		blame_job_cancel();
+		data = blame_cache_add(key, mtime);
+		if (!blame_job_start(data, dir, argv, env))
+		{
+			blame_cache_remove(data);
+			data = NULL;
+		}
+		else
+			ui_set_statusbar(FALSE, _("Annotating %s..."), doc->file_name);
+	}
+
+	if (blame_job != NULL && blame_job->data == data)
+	{
+		blame_job->doc = doc;
+		blame_job->doc_line = line;
+		blame_job_show(blame_job);
+	}
+	else if (data != NULL)
+		blame_show(doc, line, data);
+
+	g_free(key);
+	g_strfreev(argv);
+	g_strfreev(env);
+	g_free(revision);
+	g_free(dir);
+}
+
+
+/* The annotation requested for doc is not shown once it's closed */
+void
+vc_blame_document_close(GeanyDocument * doc)
+{
+	if (blame_job != NULL && blame_job->doc == doc)
+		blame_job->doc = NULL;
+}
+
+
+void
+vc_blame_cleanup(void)
+{
+	blame_job_cancel();
+
+	if (blame_cache != NULL)
+	{
+		g_queue_free(blame_lru);
+		blame_lru = NULL;
+		g_hash_table_destroy(blame_cache);
+		blame_cache = NULL;
+	}
+}
@@ -20,12 +20,21 @@
 
 #include <string.h>
 
+#ifndef G_OS_WIN32
+#include <sys/types.h>
+#include <signal.h>
+#endif
+
 #include <geanyplugin.h>
+#include <glib/gstdio.h>
 #include "geanyvc.h"
 
 extern GeanyFunctions *geany_functions;
 
 
+#define EXTERNAL_DIFF_READ_SIZE  65536
+
+
 enum
 {
 	EXTERNAL_DIFF_MELD,
@@ -37,8 +46,28 @@ enum
 };
 
 
+/* The base revision of a file being copied from the output of its VC into a cache file */
+typedef struct
+{
+	gchar *key;
+	gchar *path;		/* of the cache file, in locale encoding */
+	gchar *filename;	/* the working copy to compare it with, in locale encoding */
+	GIOChannel *file;
+	GPid pid;
+	guint child_source;
+	GIOChannel *channel;
+	guint channel_source;
+	gboolean failed;
+} DiffFetch;
+
+
 static const gchar *viewers[EXTERNAL_DIFF_COUNT] = { "meld", "kompare", "kdiff3", "diffuse", "tkdiff" };
 
+/* directory, revision and file name -> cache file holding the file in that revision.
+ * Without a revision the file is fetched again each time, into the same cache file. */
+static GHashTable *base_cache = NULL;
+static DiffFetch *diff_fetch = NULL;
+
 static gchar *extern_diff_viewer = NULL;
 const gchar *
 get_external_diff_viewer(void)
@@ -75,7 +104,319 @@ vc_external_diff(const gchar * src, const gchar * dest)
 	argv[1] = (gchar *) src;
 	argv[2] = (gchar *) dest;
 
-	utils_spawn_sync(NULL, argv, NULL,
-			 G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL |
-			 G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+	/* the viewer runs on its own, the files it shows are kept until the plugin is unloaded */
+	g_spawn_async(NULL, argv, NULL,
+		      G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL |
+		      G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL, NULL, NULL);
+}
+
+
+static void
+cache_file_free(gchar * path)
+{
+	g_unlink(path);
+	g_free(path);
+}
+
+
+/* Opens the cache file of key for writing, truncated, and sets path to its name */
+static GIOChannel *
+cache_file_open(const gchar * key, gchar ** path)
+{
+	GIOChannel *channel;
+	GError *error = NULL;
+	gint fd;
+
+	*path = g_strdup(g_hash_table_lookup(base_cache, key));
+	if (*path != NULL)
+		channel = g_io_channel_new_file(*path, "w", &error);
+	else
+	{
+		fd = g_file_open_tmp("geanyvc-XXXXXX", path, &error);
+		channel = (fd < 0) ? NULL : g_io_channel_unix_new(fd);
+	}
+	if (channel == NULL)
+	{
+		g_warning("geanyvc: unable to create a temporary file: %s", error->message);
+		g_error_free(error);
+		g_free(*path);
+		*path = NULL;
+		return NULL;
+	}
+
+	g_io_channel_set_encoding(channel, NULL, NULL);
+	g_io_channel_set_close_on_unref(channel, TRUE);
+	return channel;
+}
+
+
+/* Keeps the cache file written for key, or drops it if it couldn't be written completely */
+static void
+cache_file_close(const gchar * key, gchar * path, GIOChannel * channel, gboolean failed)
+{
+	if (g_io_channel_shutdown(channel, TRUE, NULL) != G_IO_STATUS_NORMAL)
+		failed = TRUE;
+	g_io_channel_unref(channel);
+
+	if (!failed)
+	{
+		if (g_hash_table_lookup(base_cache, key) == NULL)
+			g_hash_table_insert(base_cache, g_strdup(key), g_strdup(path));
+	}
+	else if (g_hash_table_lookup(base_cache, key) != NULL)
+		g_hash_table_remove(base_cache, key);
+	else
+		cache_file_free(g_strdup(path));
+}
+
+
+static void
+diff_fetch_free(DiffFetch * fetch)
+{
+	if (fetch->channel)
+		g_io_channel_unref(fetch->channel);
+	g_free(fetch->key);
+	g_free(fetch->path);
+	g_free(fetch->filename);
+	g_free(fetch);
+}
+
+
+static void
+diff_fetch_reap_cb(GPid pid, G_GNUC_UNUSED gint status, G_GNUC_UNUSED gpointer data)
+{
+	g_spawn_close_pid(pid);
+}
+
+
+/* Stops the running fetch, its incomplete cache file is dropped */
+static void
+diff_fetch_cancel(void)
+{
+	DiffFetch *fetch = diff_fetch;
+
+	if (fetch == NULL)
+		return;
+
+	if (fetch->channel_source)
+		g_source_remove(fetch->channel_source);
+	if (fetch->child_source)
+	{
+		g_source_remove(fetch->child_source);
+#ifndef G_OS_WIN32
+		kill(fetch->pid, SIGTERM);
+#endif
+		/* the process still needs to be reaped */
+		g_child_watch_add(fetch->pid, diff_fetch_reap_cb, NULL);
+	}
+
+	diff_fetch = NULL;
+	cache_file_close(fetch->key, fetch->path, fetch->file, TRUE);
+	diff_fetch_free(fetch);
+}
+
+
+static void
+diff_fetch_finish(DiffFetch * fetch)
+{
+	diff_fetch = NULL;
+	cache_file_close(fetch->key, fetch->path, fetch->file, fetch->failed);
+	if (!fetch->failed)
+		vc_external_diff(fetch->path, fetch->filename);
+	else
+		ui_set_statusbar(FALSE, _("Unable to get the base revision of the file."));
+	diff_fetch_free(fetch);
+}
+
+
+static gboolean
+diff_fetch_read_cb(GIOChannel * channel, GIOCondition cond, gpointer user_data)
+{
+	DiffFetch *fetch = user_data;
+	gchar buf[EXTERNAL_DIFF_READ_SIZE];
+	gsize n = 0;
+	GIOStatus status = G_IO_STATUS_EOF;
+
+	if (cond & (G_IO_IN | G_IO_PRI))
+		status = g_io_channel_read_chars(channel, buf, sizeof(buf), &n, NULL);
+
+	/* straight into the cache file, the output is never held as a whole */
+	if (n > 0 && !fetch->failed &&
+	    g_io_channel_write_chars(fetch->file, buf, n, NULL, NULL) != G_IO_STATUS_NORMAL)
+		fetch->failed = TRUE;
+	if (status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN)
+		return TRUE;
+
+	if (status == G_IO_STATUS_ERROR)
+		fetch->failed = TRUE;
+	fetch->channel_source = 0;
+	g_io_channel_unref(fetch->channel);
+	fetch->channel = NULL;
+	if (fetch->child_source == 0)
+		diff_fetch_finish(fetch);
+	return FALSE;
+}
+
+
+static void
+diff_fetch_exited_cb(GPid pid, gint status, gpointer user_data)
+{
+	DiffFetch *fetch = user_data;
+
+	g_spawn_close_pid(pid);
+	if (status != 0)
+		fetch->failed = TRUE;
+	fetch->pid = 0;
+	fetch->child_source = 0;
+	if (fetch->channel == NULL)
+		diff_fetch_finish(fetch);
+}
+
+
+static void
+diff_fetch_start(const gchar * key, const gchar * filename, const gchar * dir, gchar ** argv,
+		 gchar ** env)
+{
+	DiffFetch *fetch;
+	GIOChannel *file;
+	gchar *path;
+	GPid pid;
+	gint out_fd;
+	GError *error = NULL;
+
+	file = cache_file_open(key, &path);
+	if (file == NULL)
+		return;
+
+	if (!g_spawn_async_with_pipes(dir, argv, env,
+				      G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+				      G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL,
+				      &pid, NULL, &out_fd, NULL, &error))
+	{
+		g_warning("geanyvc: s_spawn_async error: %s", error->message);
+		ui_set_statusbar(FALSE, _("geanyvc: s_spawn_async error: %s"), error->message);
+		g_error_free(error);
+		cache_file_close(key, path, file, TRUE);
+		g_free(path);
+		return;
+	}
+
+	fetch = g_new0(DiffFetch, 1);
+	fetch->key = g_strdup(key);
+	fetch->path = path;
+	fetch->filename = utils_get_locale_from_utf8(filename);
+	fetch->file = file;
+	fetch->pid = pid;
+	fetch->child_source = g_child_watch_add(pid, diff_fetch_exited_cb, fetch);
+#ifdef G_OS_WIN32
+	fetch->channel = g_io_channel_win32_new_fd(out_fd);
+#else
+	fetch->channel = g_io_channel_unix_new(out_fd);
+#endif
+	g_io_channel_set_encoding(fetch->channel, NULL, NULL);
+	g_io_channel_set_buffered(fetch->channel, FALSE);
+	g_io_channel_set_close_on_unref(fetch->channel, TRUE);
+	fetch->channel_source = g_io_add_watch(fetch->channel,
+					       G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR,
+					       diff_fetch_read_cb, fetch);
+	diff_fetch = fetch;
+}
+
+
+/* Writes text, the base revision given by a VC command that can't be streamed, to the cache
+ * file of key and shows the diff */
+static void
+diff_show_text(const gchar * key, const gchar * filename, const gchar * text)
+{
+	GIOChannel *file;
+	gchar *path;
+	gchar *locale_filename;
+	gboolean failed;
+
+	file = cache_file_open(key, &path);
+	if (file == NULL)
+		return;
+
+	failed = g_io_channel_write_chars(file, text, -1, NULL, NULL) != G_IO_STATUS_NORMAL;
+	cache_file_close(key, path, file, failed);
+	if (!failed)
+	{
+		locale_filename = utils_get_locale_from_utf8(filename);
+		vc_external_diff(path, locale_filename);
+		g_free(locale_filename);
+	}
+	g_free(path);
+}
+
+
+/* Shows the changes to filename since its base revision in the external diff viewer. The base
+ * revision is kept in a temporary file for as long as the plugin is loaded, and reused as long as
+ * the revision of the working copy doesn't change. */
+void
+vc_external_diff_file(const gchar * filename)
+{
+	gchar *dir = NULL;
+	gchar *revision = NULL;
+	gchar **argv;
+	gchar **env = NULL;
+	gchar *key;
+	const gchar *path;
+	gchar *locale_filename;
+	gchar *text;
+
+	if (!get_external_diff_viewer())
+		return;
+
+	if (base_cache == NULL)
+		base_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+						   (GDestroyNotify) cache_file_free);
+
+	argv = get_base_revision_command(filename, &dir, &env, &revision);
+	key = g_strjoin("\n", dir ? dir : "", revision ? revision : "", filename, NULL);
+
+	/* a fetch of the same file would write the cache file again */
+	if (diff_fetch != NULL && strcmp(diff_fetch->key, key) == 0)
+		diff_fetch_cancel();
+
+	path = g_hash_table_lookup(base_cache, key);
+	if (revision != NULL && path != NULL)
+	{
+		locale_filename = utils_get_locale_from_utf8(filename);
+		vc_external_diff(path, locale_filename);
+		g_free(locale_filename);
+	}
+	else if (argv != NULL)
+	{
+		/* only one at a time, the viewer of an older request would pop up late */
+		diff_fetch_cancel();
+		diff_fetch_start(key, filename, dir, argv, env);
+	}
+	else
+	{
+		text = get_base_revision_text(filename);
+		if (text != NULL)
+			diff_show_text(key, filename, text);
+		else
+			ui_set_statusbar(FALSE, _("Unable to get the base revision of the file."));
+		g_free(text);
+	}
+
+	g_free(key);
+	g_free(revision);
+	g_free(dir);
+	g_strfreev(argv);
+	g_strfreev(env);
+}
+
+
+/* Stops a running fetch and removes the cached files */
+void
+vc_external_diff_cleanup(void)
+{
+	diff_fetch_cancel();
+	if (base_cache != NULL)
+	{
+		g_hash_table_destroy(base_cache);
+		base_cache = NULL;
+	}
 }
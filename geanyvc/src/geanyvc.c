@@ -27,7 +27,12 @@
 #include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <time.h>
+#ifndef G_OS_WIN32
+# include <signal.h>
+#endif
 
 #ifdef HAVE_CONFIG_H
 	#include "config.h"
@@ -36,6 +41,7 @@
 
 #include "geanyvc.h"
 #include "SciLexer.h"
+#include "startprof.h"
 
 #ifdef USE_GTKSPELL
 #include <gtkspell/gtkspell.h>
@@ -62,6 +68,7 @@ static gboolean set_maximize_commit_dialog;
 static gboolean set_external_diff;
 static gboolean set_editor_menu_entries;
 static gboolean set_menubar_entry;
+static gboolean set_gutter_diff;
 
 static gchar *config_file;
 
@@ -78,6 +85,36 @@ static gchar *lang;
 
 static GSList *VC = NULL;
 
+/* Cached VC lookup of a directory */
+typedef struct
+{
+	const VC_RECORD *vc;	/* first VC managing the directory or NULL */
+	gchar *base_dir;		/* base directory of vc */
+	gchar *meta_dir;		/* watched metadata directory of vc or NULL */
+	GHashTable *files;		/* basename -> VC_RECORD managing the file or NULL */
+	time_t checked;
+} VC_DIR_ENTRY;
+
+/* directory -> VC_DIR_ENTRY */
+static GHashTable *vc_dirs = NULL;
+/* metadata directory -> GFileMonitor */
+static GHashTable *vc_monitors = NULL;
+
+/* lifetime in seconds of cached lookups without a watched metadata directory */
+#define VC_CACHE_UNWATCHED_TIMEOUT 10
+
+/* Cached diff of a file shown in the commit dialog */
+typedef struct
+{
+	gchar *diff;
+	gchar *meta_dir;	/* watched metadata directory of the file's VC or NULL */
+	time_t mtime;
+	goffset size;
+} VC_DIFF_ENTRY;
+
+/* filename -> VC_DIFF_ENTRY */
+static GHashTable *vc_diffs = NULL;
+
 /* The addresses of these strings act as enums, their contents are not used. */
 /* absolute path dirname of file */
 const gchar ABS_DIRNAME[] = "*ABS_DIRNAME*";
@@ -130,6 +167,7 @@ enum
 	VC_REVERT_FILE,
 	VC_REVERT_DIR,
 	VC_REVERT_BASEDIR,
+	VC_BLAME_LINE,
 	COUNT_KB
 };
 
@@ -152,7 +190,7 @@ free_text_list(GSList * lst)
 	g_slist_free(lst);
 }
 
-static void
+void
 free_commit_list(GSList * lst)
 {
 	GSList *tmp;
@@ -242,19 +280,213 @@ find_dir(const gchar * filename, const char *find, gboolean recursive)
 }
 
 
-static const VC_RECORD *
-find_vc(const char *filename)
+static void
+vc_dir_entry_free(VC_DIR_ENTRY * entry)
+{
+	g_free(entry->base_dir);
+	g_free(entry->meta_dir);
+	g_hash_table_destroy(entry->files);
+	g_free(entry);
+}
+
+static void
+vc_monitor_free(GFileMonitor * monitor)
+{
+	g_file_monitor_cancel(monitor);
+	g_object_unref(monitor);
+}
+
+/* Something changed in a metadata directory, forget all lookups below its base directory */
+static void
+vc_meta_dir_changed_cb(G_GNUC_UNUSED GFileMonitor * monitor, G_GNUC_UNUSED GFile * file,
+		       G_GNUC_UNUSED GFile * other_file, G_GNUC_UNUSED GFileMonitorEvent event,
+		       gpointer user_data)
+{
+	const gchar *meta_dir = user_data;
+	GHashTableIter iter;
+	gpointer value;
+
+	vc_gutter_invalidate();
+
+	g_hash_table_iter_init(&iter, vc_dirs);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		VC_DIR_ENTRY *entry = value;
+
+		if (utils_str_equal(entry->meta_dir, meta_dir))
+			g_hash_table_iter_remove(&iter);
+	}
+
+	/* the diffs are against a base which might have changed */
+	if (vc_diffs)
+	{
+		g_hash_table_iter_init(&iter, vc_diffs);
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			VC_DIFF_ENTRY *entry = value;
+
+			if (utils_str_equal(entry->meta_dir, meta_dir))
+				g_hash_table_iter_remove(&iter);
+		}
+	}
+}
+
+static void
+vc_watch_meta_dir(VC_DIR_ENTRY * entry)
+{
+	GFileMonitor *monitor;
+	GFile *file;
+	gchar *meta_dir;
+
+	if (!entry->vc->meta_dir || !entry->base_dir)
+		return;
+
+	meta_dir = g_build_filename(entry->base_dir, entry->vc->meta_dir, NULL);
+	if (g_hash_table_lookup(vc_monitors, meta_dir))
+	{
+		entry->meta_dir = meta_dir;
+		return;
+	}
+
+	file = g_file_new_for_path(meta_dir);
+	monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, NULL);
+	g_object_unref(file);
+	if (!monitor)
+	{
+		g_free(meta_dir);
+		return;
+	}
+
+	/* the key lives as long as the monitor */
+	entry->meta_dir = meta_dir;
+	meta_dir = g_strdup(meta_dir);
+	g_hash_table_insert(vc_monitors, meta_dir, monitor);
+	g_signal_connect(monitor, "changed", G_CALLBACK(vc_meta_dir_changed_cb), meta_dir);
+}
+
+/* Drops all cached lookups, needed when the registered VCs change */
+static void
+vc_cache_clear(void)
+{
+	if (vc_diffs)
+	{
+		g_hash_table_destroy(vc_diffs);
+		vc_diffs = NULL;
+	}
+	if (vc_dirs)
+	{
+		g_hash_table_destroy(vc_dirs);
+		vc_dirs = NULL;
+	}
+	if (vc_monitors)
+	{
+		g_hash_table_destroy(vc_monitors);
+		vc_monitors = NULL;
+	}
+}
+
+/* Returns the cached lookup of directory dir, walking the tree only on the first call.
+ * Lookups are dropped when the metadata directory of their VC changes; those which
+ * can't be watched, including directories not under VC, expire after a few seconds. */
+static VC_DIR_ENTRY *
+vc_cache_get_dir(const gchar * dir)
 {
+	VC_DIR_ENTRY *entry;
 	GSList *tmp;
 
+	if (!vc_dirs)
+	{
+		vc_dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+						(GDestroyNotify) vc_dir_entry_free);
+		vc_monitors = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+						    (GDestroyNotify) vc_monitor_free);
+	}
+
+	entry = g_hash_table_lookup(vc_dirs, dir);
+	if (entry)
+	{
+		if (entry->meta_dir || time(NULL) - entry->checked < VC_CACHE_UNWATCHED_TIMEOUT)
+			return entry;
+		g_hash_table_remove(vc_dirs, dir);
+	}
+
+	entry = g_new0(VC_DIR_ENTRY, 1);
+	entry->files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	entry->checked = time(NULL);
+
 	for (tmp = VC; tmp != NULL; tmp = g_slist_next(tmp))
+	{
+		if (((VC_RECORD *) tmp->data)->in_vc(dir))
+		{
+			entry->vc = (VC_RECORD *) tmp->data;
+			break;
+		}
+	}
+	if (entry->vc)
+	{
+		entry->base_dir = entry->vc->get_base_dir(dir);
+		vc_watch_meta_dir(entry);
+	}
+
+	g_hash_table_insert(vc_dirs, g_strdup(dir), entry);
+	return entry;
+}
+
+const VC_RECORD *
+find_vc(const char *filename)
+{
+	VC_DIR_ENTRY *entry;
+	GSList *tmp;
+	gchar *dir;
+	gchar *base_name;
+	gpointer vc = NULL;
+
+	if (g_file_test(filename, G_FILE_TEST_IS_DIR))
+		return vc_cache_get_dir(filename)->vc;
+
+	dir = g_path_get_dirname(filename);
+	entry = vc_cache_get_dir(dir);
+	g_free(dir);
+	/* a file can only be under a VC which also manages its directory */
+	if (!entry->vc)
+		return NULL;
+
+	base_name = g_path_get_basename(filename);
+	if (g_hash_table_lookup_extended(entry->files, base_name, NULL, &vc))
+	{
+		g_free(base_name);
+		return vc;
+	}
+
+	for (tmp = g_slist_find(VC, entry->vc); tmp != NULL; tmp = g_slist_next(tmp))
 	{
 		if (((VC_RECORD *) tmp->data)->in_vc(filename))
 		{
-			return (VC_RECORD *) tmp->data;
+			vc = tmp->data;
+			break;
 		}
 	}
-	return NULL;
+	g_hash_table_insert(entry->files, base_name, vc);
+	return vc;
+}
+
+/* Same as vc->get_base_dir() but uses the cached lookup if possible */
+gchar *
+find_base_dir(const VC_RECORD * vc, const gchar * filename)
+{
+	VC_DIR_ENTRY *entry;
+	gchar *dir;
+
+	if (g_file_test(filename, G_FILE_TEST_IS_DIR))
+		dir = g_strdup(filename);
+	else
+		dir = g_path_get_dirname(filename);
+	entry = vc_cache_get_dir(dir);
+	g_free(dir);
+
+	if (entry->vc == vc && entry->base_dir)
+		return g_strdup(entry->base_dir);
+	return vc->get_base_dir(filename);
 }
 
 static void *
@@ -272,19 +504,77 @@ find_cmd_env(gint cmd_type, gboolean cmd, const gchar * filename)
 	return NULL;
 }
 
-/* Get list of commands for given command spec*/
+/* Returns the number of bytes the file names of a FILE_LIST may take on one command line */
+static gsize
+get_file_list_max_size(void)
+{
+#ifdef G_OS_WIN32
+	/* the whole command line is limited to 32767 characters */
+	return 24 * 1024;
+#else
+	static gsize max_size = 0;
+
+	if (max_size == 0)
+	{
+		glong arg_max = -1;
+
+#ifdef _SC_ARG_MAX
+		arg_max = sysconf(_SC_ARG_MAX);
+#endif
+		if (arg_max <= 0)
+			arg_max = 128 * 1024;
+		/* leave room for the environment and the other arguments */
+		max_size = MIN(arg_max / 2, 1024 * 1024);
+	}
+	return max_size;
+#endif
+}
+
+/* Splits the locale encoded file names of filelist into chunks that fit on a command line.
+ * A NULL filelist gives a single empty chunk. */
+static GSList *
+split_file_list(GSList * filelist, gboolean split)
+{
+	GSList *chunks = NULL;
+	GSList *chunk = NULL;
+	GSList *tmp;
+	gsize max_size = get_file_list_max_size();
+	gsize size = 0;
+
+	for (tmp = filelist; tmp != NULL; tmp = g_slist_next(tmp))
+	{
+		gchar *name = utils_get_locale_from_utf8((gchar *) tmp->data);
+		gsize len = strlen(name) + 1 + sizeof(gchar *);
+
+		if (split && chunk != NULL && size + len > max_size)
+		{
+			chunks = g_slist_prepend(chunks, g_slist_reverse(chunk));
+			chunk = NULL;
+			size = 0;
+		}
+		chunk = g_slist_prepend(chunk, name);
+		size += len;
+	}
+	return g_slist_reverse(g_slist_prepend(chunks, g_slist_reverse(chunk)));
+}
+
+/* Get list of commands for given command spec.
+ * A command whose FILE_LIST is too long for one command line is run once per chunk of
+ * files, unless it has a MESSAGE: a commit has to stay a single invocation. */
 static GSList *
 get_cmd(const gchar ** argv, const gchar * dir, const gchar * filename, GSList * filelist,
 	const gchar * message)
 {
 	gint i, j;
-	gint len = 0;
+	gint start, end;
 	gchar **ret;
 	gchar *abs_dir;
 	gchar *base_filename;
 	gchar *base_dirname;
 	gchar *basename;
 	GSList *head = NULL;
+	GSList *chunks;
+	GSList *chunk;
 	GSList *tmp;
 	GString *repl;
 
@@ -296,74 +586,81 @@ get_cmd(const gchar ** argv, const gchar * dir, const gchar * filename, GSList *
 	base_filename = get_relative_path(dir, filename);
 	base_dirname = get_relative_path(dir, abs_dir);
 
-	while (1)
+	for (start = 0;; start = end + 1)
 	{
-		if (argv[len] == NULL)
-			break;
-		len++;
-	}
-	if (filelist)
-		ret = g_malloc0(sizeof(gchar *) * (len * g_slist_length(filelist) + 1));
-	else
-		ret = g_malloc0(sizeof(gchar *) * (len + 1));
-
-	head = g_slist_alloc();
-	head->data = ret;
+		gboolean has_list = FALSE;
+		gboolean has_message = FALSE;
 
-	for (i = 0, j = 0; i < len; i++, j++)
-	{
-		if (argv[i] == CMD_SEPARATOR)
-		{
-			if (filelist)
-				ret = g_malloc0(sizeof(gchar *) *
-						(len * g_slist_length(filelist) + 1));
-			else
-				ret = g_malloc0(sizeof(gchar *) * (len + 1));
-			j = -1;
-			head = g_slist_append(head, ret);
-		}
-		else if (argv[i] == ABS_DIRNAME)
-		{
-			ret[j] = utils_get_locale_from_utf8(abs_dir);
-		}
-		else if (argv[i] == ABS_FILENAME)
-		{
-			ret[j] = utils_get_locale_from_utf8(filename);
-		}
-		else if (argv[i] == BASE_DIRNAME)
-		{
-			ret[j] = utils_get_locale_from_utf8(base_dirname);
-		}
-		else if (argv[i] == BASE_FILENAME)
+		for (end = start; argv[end] != NULL && argv[end] != CMD_SEPARATOR; end++)
 		{
-			ret[j] = utils_get_locale_from_utf8(base_filename);
+			if (argv[end] == FILE_LIST)
+				has_list = TRUE;
+			else if (argv[end] == MESSAGE)
+				has_message = TRUE;
 		}
-		else if (argv[i] == BASENAME)
-		{
-			ret[j] = utils_get_locale_from_utf8(basename);
-		}
-		else if (argv[i] == FILE_LIST)
+
+		chunks = split_file_list(has_list ? filelist : NULL, !has_message);
+		for (chunk = chunks; chunk != NULL; chunk = g_slist_next(chunk))
 		{
-			for (tmp = filelist; tmp != NULL; tmp = g_slist_next(tmp))
+			ret = g_malloc0(sizeof(gchar *) *
+					(end - start + g_slist_length(chunk->data) + 1));
+			head = g_slist_append(head, ret);
+
+			for (i = start, j = 0; i < end; i++, j++)
 			{
-				ret[j] = utils_get_locale_from_utf8((gchar *) tmp->data);
-				j++;
+				if (argv[i] == ABS_DIRNAME)
+				{
+					ret[j] = utils_get_locale_from_utf8(abs_dir);
+				}
+				else if (argv[i] == ABS_FILENAME)
+				{
+					ret[j] = utils_get_locale_from_utf8(filename);
+				}
+				else if (argv[i] == BASE_DIRNAME)
+				{
+					ret[j] = utils_get_locale_from_utf8(base_dirname);
+				}
+				else if (argv[i] == BASE_FILENAME)
+				{
+					ret[j] = utils_get_locale_from_utf8(base_filename);
+				}
+				else if (argv[i] == BASENAME)
+				{
+					ret[j] = utils_get_locale_from_utf8(basename);
+				}
+				else if (argv[i] == FILE_LIST)
+				{
+					for (tmp = chunk->data; tmp != NULL; tmp = g_slist_next(tmp))
+					{
+						ret[j] = g_strdup(tmp->data);
+						j++;
+					}
+					j--;
+				}
+				else if (argv[i] == MESSAGE)
+				{
+					ret[j] = utils_get_locale_from_utf8(message);
+				}
+				else
+				{
+					repl = g_string_new(argv[i]);
+					utils_string_replace_all(repl, P_ABS_DIRNAME, abs_dir);
+					utils_string_replace_all(repl, P_ABS_FILENAME, filename);
+					utils_string_replace_all(repl, P_BASENAME, basename);
+					ret[j] = g_string_free(repl, FALSE);
+					setptr(ret[j], utils_get_locale_from_utf8(ret[j]));
+				}
 			}
-			j--;
 		}
-		else if (argv[i] == MESSAGE)
+		for (chunk = chunks; chunk != NULL; chunk = g_slist_next(chunk))
 		{
-			ret[j] = utils_get_locale_from_utf8(message);
-		}
-		else
-		{
-			repl = g_string_new(argv[i]);
-			utils_string_replace_all(repl, P_ABS_DIRNAME, abs_dir);
-			utils_string_replace_all(repl, P_ABS_FILENAME, filename);
-			utils_string_replace_all(repl, P_BASENAME, basename);
-			ret[j] = g_string_free(repl, FALSE);
-			setptr(ret[j], utils_get_locale_from_utf8(ret[j]));
+			g_slist_foreach(chunk->data, (GFunc) g_free, NULL);
+			g_slist_free(chunk->data);
 		}
+		g_slist_free(chunks);
+
+		if (argv[end] == NULL)
+			break;
 	}
 	g_free(abs_dir);
 	g_free(base_dirname);
@@ -417,6 +714,33 @@ show_output(const gchar * std_output, const gchar * name,
 	}
 }
 
+/* Converts the output of a command, or text read by a backend, from the encoding of the
+ * original file into UTF-8 because internally Geany always needs UTF-8, with Unix line ends.
+ * Sets *text to NULL if it is empty. */
+void
+normalize_command_output(gchar ** text)
+{
+	GString *tmp;
+
+	if (*text == NULL)
+		return;
+
+	tmp = g_string_new(*text);
+	utils_string_replace_all(tmp, "\r\n", "\n");
+	utils_string_replace_all(tmp, "\r", "\n");
+	setptr(*text, g_string_free(tmp, FALSE));
+
+	if (!g_utf8_validate(*text, -1, NULL))
+	{
+		setptr(*text, encodings_convert_to_utf8(*text, strlen(*text), NULL));
+	}
+	if (EMPTY(*text))
+	{
+		g_free(*text);
+		*text = NULL;
+	}
+}
+
 /*
  * Execute command by command spec, return std_out std_err
  *
@@ -437,7 +761,6 @@ execute_custom_command(const gchar * dir, const gchar ** argv, const gchar ** en
 		       const gchar * message)
 {
 	gint exit_code;
-	GString *tmp;
 	GSList *cur;
 	GSList *largv = get_cmd(argv, dir, filename, list, message);
 	GError *error = NULL;
@@ -477,102 +800,554 @@ execute_custom_command(const gchar * dir, const gchar ** argv, const gchar ** en
 			g_error_free(error);
 		}
 
-		/* need to convert output text from the encoding of the original file into
-		   UTF-8 because internally Geany always needs UTF-8 */
-		if (std_out && *std_out)
-		{
-			tmp = g_string_new(*std_out);
-			utils_string_replace_all(tmp, "\r\n", "\n");
-			utils_string_replace_all(tmp, "\r", "\n");
-			setptr(*std_out, g_string_free(tmp, FALSE));
+		if (std_out)
+			normalize_command_output(std_out);
+		if (std_err)
+			normalize_command_output(std_err);
+		g_strfreev(cur->data);
+	}
+	g_slist_free(largv);
+	return exit_code;
+}
+
+/* Returns the directory to run command cmd of vc on filename in */
+static gchar *
+get_command_dir(const VC_RECORD * vc, const gchar * filename, gint cmd)
+{
+	gchar *dir = NULL;
+
+	if (vc->commands[cmd].startdir == VC_COMMAND_STARTDIR_FILE)
+	{
+		if (g_file_test(filename, G_FILE_TEST_IS_DIR))
+			dir = g_strdup(filename);
+		else
+			dir = g_path_get_dirname(filename);
+	}
+	else if (vc->commands[cmd].startdir == VC_COMMAND_STARTDIR_BASE)
+	{
+		dir = find_base_dir(vc, filename);
+	}
+	else
+	{
+		g_warning("geanyvc: unknown startdir type: %d", vc->commands[cmd].startdir);
+	}
+	return dir;
+}
+
+/* Returns the revision of the working copy, NULL if the VC can't tell it */
+static gchar *
+get_head_revision(const VC_RECORD * vc, const gchar * dir, const gchar * filename)
+{
+	gchar *revision = NULL;
+
+	if (vc->get_head_revision != NULL)
+	{
+		revision = vc->get_head_revision(filename);
+		if (revision != NULL)
+			return revision;
+	}
+	if (vc->head_revision == NULL)
+		return NULL;
+
+	execute_custom_command(dir, vc->head_revision, NULL, &revision, NULL, filename, NULL, NULL);
+	if (revision)
+		g_strstrip(revision);
+	return revision;
+}
+
+/* Returns the last of the commands argv expands to, for running it in the background */
+static gchar **
+get_last_cmd(const gchar ** argv, const gchar * dir, const gchar * filename)
+{
+	GSList *cmds, *tmp;
+	gchar **ret;
+
+	cmds = get_cmd(argv, dir, filename, NULL, NULL);
+	for (tmp = cmds; tmp != NULL && tmp->next != NULL; tmp = g_slist_next(tmp))
+		g_strfreev(tmp->data);
+	ret = tmp ? tmp->data : NULL;
+	g_slist_free(cmds);
+	return ret;
+}
+
+/* Returns command, one of the commands of vc, expanded for filename, along with the directory
+ * and environment of vc's command cmd to run it in */
+gchar **
+get_vc_command(const VC_RECORD * vc, const gchar ** command, gint cmd, const gchar * filename,
+	       gchar ** dir, gchar *** env)
+{
+	*dir = get_command_dir(vc, filename, cmd);
+	*env = g_strdupv((gchar **) vc->commands[cmd].env);
+	return get_last_cmd(command, *dir, filename);
+}
+
+/* Returns the command blaming filename line by line, along with the directory and environment
+ * to run it in and the revision of the working copy, or NULL if its VC can't do that */
+gchar **
+get_blame_lines_command(const gchar * filename, gchar ** dir, gchar *** env, gchar ** revision)
+{
+	const VC_RECORD *vc;
+
+	*dir = NULL;
+	*env = NULL;
+	*revision = NULL;
+
+	vc = find_vc(filename);
+	if (vc == NULL || vc->blame_lines == NULL)
+		return NULL;
+
+	*dir = get_command_dir(vc, filename, VC_COMMAND_BLAME);
+	*env = g_strdupv((gchar **) vc->commands[VC_COMMAND_BLAME].env);
+	*revision = get_head_revision(vc, *dir, filename);
+	return get_last_cmd(vc->blame_lines, *dir, filename);
+}
+
+/* Returns the command printing the base revision of filename, along with the directory and
+ * environment to run it in and the revision of the working copy if the VC can tell it, or NULL
+ * if its VC has no such command */
+gchar **
+get_base_revision_command(const gchar * filename, gchar ** dir, gchar *** env,
+			  gchar ** revision)
+{
+	const VC_RECORD *vc;
+
+	*dir = NULL;
+	*env = NULL;
+	*revision = NULL;
+
+	vc = find_vc(filename);
+	if (vc == NULL || vc->commands[VC_COMMAND_SHOW].function != NULL ||
+	    vc->commands[VC_COMMAND_SHOW].command == NULL)
+		return NULL;
+
+	*dir = get_command_dir(vc, filename, VC_COMMAND_SHOW);
+	*env = g_strdupv((gchar **) vc->commands[VC_COMMAND_SHOW].env);
+	*revision = get_head_revision(vc, *dir, filename);
+	return get_last_cmd(vc->commands[VC_COMMAND_SHOW].command, *dir, filename);
+}
+
+static gint
+execute_command(const VC_RECORD * vc, gchar ** std_out, gchar ** std_err, const gchar * filename,
+		gint cmd, GSList * list, const gchar * message)
+{
+	gchar *dir = NULL;
+	gint ret;
+	const gint action_command_cell = 1;
+
+	if (std_out)
+		*std_out = NULL;
+	if (std_err)
+		*std_err = NULL;
+
+	if (vc->commands[cmd].function)
+	{
+		return vc->commands[cmd].function(std_out, std_err, filename, list, message);
+	}
+
+	dir = get_command_dir(vc, filename, cmd);
+	ret = execute_custom_command(dir, vc->commands[cmd].command, vc->commands[cmd].env, std_out,
+				     std_err, filename, list, message);
+
+	ui_set_statusbar(TRUE, _("File %s: action %s executed via %s."),
+			 filename, vc->commands[cmd].command[action_command_cell], vc->program);
+
+	g_free(dir);
+	return ret;
+}
+
+/* Returns the content of filename in the base revision, NULL if it is not under VC */
+gchar *
+get_base_revision_text(const gchar * filename)
+{
+	const VC_RECORD *vc;
+	gchar *dir;
+	gchar *text = NULL;
+	gint ret;
+
+	vc = find_vc(filename);
+	if (vc == NULL)
+		return NULL;
+
+	if (vc->commands[VC_COMMAND_SHOW].function)
+		ret = vc->commands[VC_COMMAND_SHOW].function(&text, NULL, filename, NULL, NULL);
+	else
+	{
+		dir = get_command_dir(vc, filename, VC_COMMAND_SHOW);
+		ret = execute_custom_command(dir, vc->commands[VC_COMMAND_SHOW].command,
+					     vc->commands[VC_COMMAND_SHOW].env, &text, NULL, filename,
+					     NULL, NULL);
+		g_free(dir);
+	}
+	if (ret != 0 && text != NULL)
+	{
+		g_free(text);
+		text = NULL;
+	}
+	return text;
+}
+
+/* A command running in the background, its output is streamed into a document */
+typedef struct
+{
+	GSList *cmds;		/* argument vectors still to run, the output of the last is shown */
+	gchar *dir;
+	gchar **env;
+	GPid pid;
+	guint child_source;
+	GIOChannel *channel;
+	guint channel_source;
+	gboolean exited;
+
+	GString *buffer;	/* output not yet added to the document */
+	GeanyDocument *doc;	/* output document, opened with the first output */
+	gchar *name;
+	gchar *encoding;
+	GeanyFiletype *ftype;
+	gint line;
+
+	gchar *filename;
+	const gchar *action;
+	const gchar *program;
+	gchar *empty_message;
+} VC_JOB;
+
+/* only one command runs at a time, starting another one cancels it */
+static VC_JOB *running_job = NULL;
+
+#define VC_JOB_READ_SIZE 65536
+
+static gboolean vc_job_spawn_next(VC_JOB * job);
+
+static void
+vc_job_free(VC_JOB * job)
+{
+	GSList *tmp;
+
+	for (tmp = job->cmds; tmp != NULL; tmp = g_slist_next(tmp))
+		g_strfreev(tmp->data);
+	g_slist_free(job->cmds);
+	g_free(job->dir);
+	g_strfreev(job->env);
+	if (job->channel)
+		g_io_channel_unref(job->channel);
+	g_string_free(job->buffer, TRUE);
+	g_free(job->name);
+	g_free(job->encoding);
+	g_free(job->filename);
+	g_free(job->empty_message);
+	g_free(job);
+}
+
+/* Adds the buffered output to the document, up to the last complete line unless all is set */
+static void
+vc_job_flush(VC_JOB * job, gboolean all)
+{
+	GString *text;
+	gchar *utf8;
+	gsize len = job->buffer->len;
+
+	if (!all)
+	{
+		while (len > 0 && job->buffer->str[len - 1] != '\n')
+			len--;
+	}
+	if (len == 0)
+		return;
+
+	text = g_string_new_len(job->buffer->str, len);
+	g_string_erase(job->buffer, 0, len);
+
+	/* the same conversion as done for synchronous commands */
+	utils_string_replace_all(text, "\r\n", "\n");
+	utils_string_replace_all(text, "\r", "\n");
+	if (!g_utf8_validate(text->str, text->len, NULL))
+	{
+		utf8 = encodings_convert_to_utf8(text->str, text->len, NULL);
+		if (utf8)
+		{
+			g_string_assign(text, utf8);
+			g_free(utf8);
+		}
+	}
+
+	if (job->doc == NULL)
+	{
+		show_output(text->str, job->name, job->encoding, job->ftype, 0);
+		job->doc = document_find_by_filename(job->name);
+	}
+	else if (job->doc->is_valid)
+	{
+		scintilla_send_message(job->doc->editor->sci, SCI_APPENDTEXT, text->len,
+				       (sptr_t) text->str);
+		document_set_text_changed(job->doc, set_changed_flag);
+	}
+	g_string_free(text, TRUE);
+}
+
+static void
+vc_job_finish(VC_JOB * job)
+{
+	vc_job_flush(job, TRUE);
+	ui_progress_bar_stop();
+
+	if (job->doc == NULL)
+	{
+		if (job->empty_message)
+			ui_set_statusbar(FALSE, "%s", job->empty_message);
+	}
+	else
+	{
+		if (job->line > 0 && job->doc->is_valid)
+			sci_goto_line(job->doc->editor->sci, job->line, TRUE);
+		ui_set_statusbar(TRUE, _("File %s: action %s executed via %s."),
+				 job->filename, job->action, job->program);
+	}
+
+	running_job = NULL;
+	vc_job_free(job);
+}
+
+static gboolean
+vc_job_read_cb(GIOChannel * channel, GIOCondition cond, gpointer data)
+{
+	VC_JOB *job = data;
+	gchar buf[VC_JOB_READ_SIZE];
+	gsize n = 0;
+	GIOStatus status = G_IO_STATUS_EOF;
+
+	if (cond & (G_IO_IN | G_IO_PRI))
+		status = g_io_channel_read_chars(channel, buf, sizeof(buf), &n, NULL);
+
+	if (n > 0)
+	{
+		g_string_append_len(job->buffer, buf, n);
+		vc_job_flush(job, FALSE);
+	}
+	if (status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN)
+		return TRUE;
+
+	/* end of output */
+	job->channel_source = 0;
+	g_io_channel_unref(job->channel);
+	job->channel = NULL;
+	if (job->exited)
+		vc_job_finish(job);
+	return FALSE;
+}
+
+static void
+vc_job_reap_cb(GPid pid, G_GNUC_UNUSED gint status, G_GNUC_UNUSED gpointer data)
+{
+	g_spawn_close_pid(pid);
+}
 
-			if (!g_utf8_validate(*std_out, -1, NULL))
-			{
-				setptr(*std_out, encodings_convert_to_utf8(*std_out,
-									   strlen(*std_out), NULL));
-			}
-			if (EMPTY(*std_out))
-			{
-				g_free(*std_out);
-				*std_out = NULL;
-			}
-		}
-		if (std_err && *std_err)
-		{
-			tmp = g_string_new(*std_err);
-			utils_string_replace_all(tmp, "\r\n", "\n");
-			utils_string_replace_all(tmp, "\r", "\n");
-			setptr(*std_err, g_string_free(tmp, FALSE));
+static void
+vc_job_exited_cb(GPid pid, G_GNUC_UNUSED gint status, gpointer data)
+{
+	VC_JOB *job = data;
 
-			if (!g_utf8_validate(*std_err, -1, NULL))
-			{
-				setptr(*std_err, encodings_convert_to_utf8(*std_err,
-									   strlen(*std_err), NULL));
-			}
-			if (EMPTY(*std_err))
-			{
-				g_free(*std_err);
-				*std_err = NULL;
-			}
-		}
-		g_strfreev(cur->data);
+	g_spawn_close_pid(pid);
+	job->pid = 0;
+	job->child_source = 0;
+
+	/* like synchronous commands, run the next one regardless of the exit status */
+	if (job->cmds != NULL)
+	{
+		if (!vc_job_spawn_next(job))
+			vc_job_finish(job);
+		return;
 	}
-	g_slist_free(largv);
-	return exit_code;
+
+	job->exited = TRUE;
+	if (job->channel == NULL)
+		vc_job_finish(job);
 }
 
-static gint
-execute_command(const VC_RECORD * vc, gchar ** std_out, gchar ** std_err, const gchar * filename,
-		gint cmd, GSList * list, const gchar * message)
+/* Starts the next command of job, returns FALSE if there is none or it can't be run */
+static gboolean
+vc_job_spawn_next(VC_JOB * job)
 {
-	gchar *dir = NULL;
-	gint ret;
-	const gint action_command_cell = 1;
+	gchar **argv;
+	gboolean last;
+	gint out_fd = -1;
+	GError *error = NULL;
 
-	if (std_out)
-		*std_out = NULL;
-	if (std_err)
-		*std_err = NULL;
+	if (job->cmds == NULL)
+		return FALSE;
 
-	if (vc->commands[cmd].function)
+	argv = job->cmds->data;
+	job->cmds = g_slist_delete_link(job->cmds, job->cmds);
+	last = (job->cmds == NULL);
+
+	if (!g_spawn_async_with_pipes(job->dir, argv, job->env,
+				      G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+				      G_SPAWN_STDERR_TO_DEV_NULL |
+				      (last ? 0 : G_SPAWN_STDOUT_TO_DEV_NULL), NULL, NULL,
+				      &job->pid, NULL, last ? &out_fd : NULL, NULL, &error))
 	{
-		return vc->commands[cmd].function(std_out, std_err, filename, list, message);
+		g_warning("geanyvc: s_spawn_async error: %s", error->message);
+		ui_set_statusbar(FALSE, _("geanyvc: s_spawn_async error: %s"), error->message);
+		g_error_free(error);
+		g_strfreev(argv);
+		return FALSE;
 	}
+	g_strfreev(argv);
 
-	if (vc->commands[cmd].startdir == VC_COMMAND_STARTDIR_FILE)
+	job->child_source = g_child_watch_add(job->pid, vc_job_exited_cb, job);
+	if (last)
 	{
-		if (g_file_test(filename, G_FILE_TEST_IS_DIR))
-			dir = g_strdup(filename);
-		else
-			dir = g_path_get_dirname(filename);
+#ifdef G_OS_WIN32
+		job->channel = g_io_channel_win32_new_fd(out_fd);
+#else
+		job->channel = g_io_channel_unix_new(out_fd);
+#endif
+		g_io_channel_set_encoding(job->channel, NULL, NULL);
+		g_io_channel_set_buffered(job->channel, FALSE);
+		g_io_channel_set_close_on_unref(job->channel, TRUE);
+		job->channel_source = g_io_add_watch(job->channel, G_IO_IN | G_IO_PRI | G_IO_HUP |
+						     G_IO_ERR, vc_job_read_cb, job);
 	}
-	else if (vc->commands[cmd].startdir == VC_COMMAND_STARTDIR_BASE)
+	return TRUE;
+}
+
+/* Stops the running command, the output received so far stays in the document */
+static void
+vc_job_cancel(void)
+{
+	VC_JOB *job = running_job;
+
+	if (job == NULL)
+		return;
+
+	if (job->channel_source)
+		g_source_remove(job->channel_source);
+	if (job->child_source)
 	{
-		dir = vc->get_base_dir(filename);
+		g_source_remove(job->child_source);
+#ifndef G_OS_WIN32
+		kill(job->pid, SIGTERM);
+#endif
+		/* the process still needs to be reaped */
+		g_child_watch_add(job->pid, vc_job_reap_cb, NULL);
 	}
-	else
+	ui_progress_bar_stop();
+	ui_set_statusbar(FALSE, _("Command cancelled."));
+
+	running_job = NULL;
+	vc_job_free(job);
+}
+
+/* Runs command cmd of vc on filename in the background and streams its output into the
+ * document name, which is opened with the first output. empty_message is shown in the
+ * statusbar if there was no output. Commands implemented by a function run synchronously. */
+static void
+execute_command_async(const VC_RECORD * vc, const gchar * filename, gint cmd,
+		      const gchar * name, const gchar * force_encoding, GeanyFiletype * ftype,
+		      gint line, const gchar * empty_message)
+{
+	VC_JOB *job;
+	const gint action_command_cell = 1;
+
+	vc_job_cancel();
+
+	if (vc->commands[cmd].function)
 	{
-		g_warning("geanyvc: unknown startdir type: %d", vc->commands[cmd].startdir);
+		gchar *text = NULL;
+
+		execute_command(vc, &text, NULL, filename, cmd, NULL, NULL);
+		if (text)
+		{
+			show_output(text, name, force_encoding, ftype, line);
+			g_free(text);
+		}
+		else if (empty_message)
+			ui_set_statusbar(FALSE, "%s", empty_message);
+		return;
 	}
 
-	ret = execute_custom_command(dir, vc->commands[cmd].command, vc->commands[cmd].env, std_out,
-				     std_err, filename, list, message);
+	job = g_new0(VC_JOB, 1);
+	job->dir = get_command_dir(vc, filename, cmd);
+	job->env = g_strdupv((gchar **) vc->commands[cmd].env);
+	job->cmds = get_cmd(vc->commands[cmd].command, job->dir, filename, NULL, NULL);
+	job->buffer = g_string_new(NULL);
+	job->name = g_strdup(name);
+	job->encoding = g_strdup(force_encoding);
+	job->ftype = ftype;
+	job->line = line;
+	job->filename = g_strdup(filename);
+	job->action = vc->commands[cmd].command[action_command_cell];
+	job->program = vc->program;
+	job->empty_message = g_strdup(empty_message);
 
-	ui_set_statusbar(TRUE, _("File %s: action %s executed via %s."),
-			 filename, vc->commands[cmd].command[action_command_cell], vc->program);
+	if (!vc_job_spawn_next(job))
+	{
+		vc_job_free(job);
+		return;
+	}
+	running_job = job;
+	ui_progress_bar_start(_("Running VC command..."));
+}
 
-	g_free(dir);
-	return ret;
+static void
+vccancel_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
+{
+	vc_job_cancel();
+}
+
+/* Closing the output document of the running command cancels it */
+static void
+vc_document_close_cb(G_GNUC_UNUSED GObject * obj, GeanyDocument * doc,
+		     G_GNUC_UNUSED gpointer user_data)
+{
+	if (running_job && running_job->doc == doc)
+		vc_job_cancel();
+	vc_gutter_document_close(doc);
+	vc_blame_document_close(doc);
+}
+
+static void
+vc_document_update_cb(G_GNUC_UNUSED GObject * obj, GeanyDocument * doc,
+		      G_GNUC_UNUSED gpointer user_data)
+{
+	vc_gutter_document_update(doc);
+}
+
+static void
+vc_document_saved_cb(G_GNUC_UNUSED GObject * obj, GeanyDocument * doc,
+		     G_GNUC_UNUSED gpointer user_data)
+{
+	vc_gutter_document_update(doc);
+	vc_status_document_saved(doc);
+}
+
+static gboolean
+vc_editor_notify_cb(G_GNUC_UNUSED GObject * obj, GeanyEditor * editor, SCNotification * nt,
+		    G_GNUC_UNUSED gpointer user_data)
+{
+	if (nt->nmhdr.code == SCN_MODIFIED &&
+	    (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+		vc_gutter_document_changed(editor->document);
+	return FALSE;
 }
 
+GP_STARTUP_PROFILE_DOCUMENT_OPEN_HANDLER(vc_document_open_profiled_cb, vc_document_update_cb)
+
+PluginCallback plugin_callbacks[] = {
+	{"document-close", (GCallback) & vc_document_close_cb, FALSE, NULL},
+	{"document-activate", (GCallback) & vc_document_update_cb, FALSE, NULL},
+	{"document-open", (GCallback) & vc_document_open_profiled_cb, FALSE, NULL},
+	{"document-reload", (GCallback) & vc_document_update_cb, FALSE, NULL},
+	{"document-save", (GCallback) & vc_document_saved_cb, FALSE, NULL},
+	{"editor-notify", (GCallback) & vc_editor_notify_cb, FALSE, NULL},
+	{NULL, NULL, FALSE, NULL}
+};
+
 /* Callback if menu item for a single file was activated */
 static void
 vcdiff_file_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
 {
 	gchar *text = NULL;
-	gchar *new, *old;
 	gchar *name;
-	gchar *localename;
 	const VC_RECORD *vc;
 	GeanyDocument *doc;
 
@@ -587,64 +1362,20 @@ vcdiff_file_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpoint
 	vc = find_vc(doc->file_name);
 	g_return_if_fail(vc);
 
+	if (!set_external_diff || !get_external_diff_viewer())
+	{
+		name = g_strconcat(doc->file_name, ".vc.diff", NULL);
+		execute_command_async(vc, doc->file_name, VC_COMMAND_DIFF_FILE, name, doc->encoding,
+				      NULL, 0, _("No changes were made."));
+		g_free(name);
+		return;
+	}
+
 	execute_command(vc, &text, NULL, doc->file_name, VC_COMMAND_DIFF_FILE, NULL, NULL);
 	if (text)
 	{
-		if (set_external_diff && get_external_diff_viewer())
-		{
-			g_free(text);
-
-			/*  1) rename file to file.geany.~NEW~
-			   2) revert file
-			   3) rename file to file.geanyvc.~BASE~
-			   4) rename file.geany.~NEW~ to origin file
-			   5) show diff
-			 */
-			localename = utils_get_locale_from_utf8(doc->file_name);
-
-			new = g_strconcat(doc->file_name, ".geanyvc.~NEW~", NULL);
-			setptr(new, utils_get_locale_from_utf8(new));
-
-			old = g_strconcat(doc->file_name, ".geanyvc.~BASE~", NULL);
-			setptr(old, utils_get_locale_from_utf8(old));
-
-			if (g_rename(localename, new) != 0)
-			{
-				g_warning(_
-					  ("geanyvc: vcdiff_file_activated: Unable to rename '%s' to '%s'"),
-					  localename, new);
-				goto end;
-			}
-
-			execute_command(vc, NULL, NULL, doc->file_name,
-					VC_COMMAND_REVERT_FILE, NULL, NULL);
-
-			if (g_rename(localename, old) != 0)
-			{
-				g_warning(_
-					  ("geanyvc: vcdiff_file_activated: Unable to rename '%s' to '%s'"),
-					  localename, old);
-				g_rename(new, localename);
-				goto end;
-			}
-			g_rename(new, localename);
-
-			vc_external_diff(old, localename);
-			g_unlink(old);
-		      end:
-			g_free(old);
-			g_free(new);
-			g_free(localename);
-			return;
-		}
-		else
-		{
-			name = g_strconcat(doc->file_name, ".vc.diff", NULL);
-			show_output(text, name, doc->encoding, NULL, 0);
-			g_free(text);
-			g_free(name);
-		}
-
+		g_free(text);
+		vc_external_diff_file(doc->file_name);
 	}
 	else
 	{
@@ -658,7 +1389,7 @@ vcdiff_file_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpoint
 static void
 vcdiff_dir_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, gpointer data)
 {
-	gchar *text = NULL;
+	gchar *name;
 	gchar *dir;
 	gint flags = GPOINTER_TO_INT(data);
 	const VC_RECORD *vc;
@@ -677,7 +1408,7 @@ vcdiff_dir_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, gpointer data)
 
 	if (flags & FLAG_BASEDIR)
 	{
-		dir = vc->get_base_dir(doc->file_name);
+		dir = find_base_dir(vc, doc->file_name);
 	}
 	else if (flags & FLAG_DIR)
 	{
@@ -687,26 +1418,16 @@ vcdiff_dir_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, gpointer data)
 		return;
 	g_return_if_fail(dir);
 
-	execute_command(vc, &text, NULL, dir, VC_COMMAND_DIFF_DIR, NULL, NULL);
-	if (text)
-	{
-		gchar *name;
-		name = g_strconcat(dir, ".vc.diff", NULL);
-		show_output(text, name, doc->encoding, NULL, 0);
-		g_free(text);
-		g_free(name);
-	}
-	else
-	{
-		ui_set_statusbar(FALSE, _("No changes were made."));
-	}
+	name = g_strconcat(dir, ".vc.diff", NULL);
+	execute_command_async(vc, dir, VC_COMMAND_DIFF_DIR, name, doc->encoding, NULL, 0,
+			      _("No changes were made."));
+	g_free(name);
 	g_free(dir);
 }
 
 static void
 vcblame_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
 {
-	gchar *text = NULL;
 	const VC_RECORD *vc;
 	GeanyDocument *doc;
 
@@ -716,24 +1437,26 @@ vcblame_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer g
 	vc = find_vc(doc->file_name);
 	g_return_if_fail(vc);
 
-	execute_command(vc, &text, NULL, doc->file_name, VC_COMMAND_BLAME, NULL, NULL);
-	if (text)
-	{
-		show_output(text, "*VC-BLAME*", NULL,
-			doc->file_type, sci_get_current_line(doc->editor->sci));
-		g_free(text);
-	}
-	else
-	{
-		ui_set_statusbar(FALSE, _("No history available"));
-	}
+	execute_command_async(vc, doc->file_name, VC_COMMAND_BLAME, "*VC-BLAME*", NULL,
+			      doc->file_type, sci_get_current_line(doc->editor->sci),
+			      _("No history available"));
+}
+
+static void
+vcblame_line_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
+{
+	GeanyDocument *doc;
+
+	doc = document_get_current();
+	g_return_if_fail(doc != NULL && doc->file_name != NULL);
+
+	vc_blame_show_line(doc);
 }
 
 
 static void
 vclog_file_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
 {
-	gchar *output = NULL;
 	const VC_RECORD *vc;
 	GeanyDocument *doc;
 
@@ -743,19 +1466,15 @@ vclog_file_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointe
 	vc = find_vc(doc->file_name);
 	g_return_if_fail(vc);
 
-	execute_command(vc, &output, NULL, doc->file_name, VC_COMMAND_LOG_FILE, NULL, NULL);
-	if (output)
-	{
-		show_output(output, "*VC-LOG*", NULL, NULL, 0);
-		g_free(output);
-	}
+	if (!vc_log_show(vc, doc->file_name, VC_COMMAND_LOG_FILE))
+		execute_command_async(vc, doc->file_name, VC_COMMAND_LOG_FILE, "*VC-LOG*", NULL,
+				      NULL, 0, NULL);
 }
 
 static void
 vclog_dir_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
 {
 	gchar *base_name = NULL;
-	gchar *text = NULL;
 	const VC_RECORD *vc;
 	GeanyDocument *doc;
 
@@ -767,12 +1486,9 @@ vclog_dir_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 	vc = find_vc(base_name);
 	g_return_if_fail(vc);
 
-	execute_command(vc, &text, NULL, base_name, VC_COMMAND_LOG_DIR, NULL, NULL);
-	if (text)
-	{
-		show_output(text, "*VC-LOG*", NULL, NULL, 0);
-		g_free(text);
-	}
+	if (!vc_log_show(vc, base_name, VC_COMMAND_LOG_DIR))
+		execute_command_async(vc, base_name, VC_COMMAND_LOG_DIR, "*VC-LOG*", NULL, NULL, 0,
+				      NULL);
 
 	g_free(base_name);
 }
@@ -780,7 +1496,6 @@ vclog_dir_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 static void
 vclog_basedir_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
 {
-	gchar *text = NULL;
 	const VC_RECORD *vc;
 	GeanyDocument *doc;
 	gchar *basedir;
@@ -791,15 +1506,12 @@ vclog_basedir_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpoi
 	vc = find_vc(doc->file_name);
 	g_return_if_fail(vc);
 
-	basedir = vc->get_base_dir(doc->file_name);
+	basedir = find_base_dir(vc, doc->file_name);
 	g_return_if_fail(basedir);
 
-	execute_command(vc, &text, NULL, basedir, VC_COMMAND_LOG_DIR, NULL, NULL);
-	if (text)
-	{
-		show_output(text, "*VC-LOG*", NULL, NULL, 0);
-		g_free(text);
-	}
+	if (!vc_log_show(vc, basedir, VC_COMMAND_LOG_DIR))
+		execute_command_async(vc, basedir, VC_COMMAND_LOG_DIR, "*VC-LOG*", NULL, NULL, 0,
+				      NULL);
 	g_free(basedir);
 }
 
@@ -808,7 +1520,6 @@ static void
 vcstatus_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
 {
 	gchar *base_name = NULL;
-	gchar *text = NULL;
 	const VC_RECORD *vc;
 	GeanyDocument *doc;
 
@@ -825,12 +1536,7 @@ vcstatus_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 	vc = find_vc(base_name);
 	g_return_if_fail(vc);
 
-	execute_command(vc, &text, NULL, base_name, VC_COMMAND_STATUS, NULL, NULL);
-	if (text)
-	{
-		show_output(text, "*VC-STATUS*", NULL, NULL, 0);
-		g_free(text);
-	}
+	execute_command_async(vc, base_name, VC_COMMAND_STATUS, "*VC-STATUS*", NULL, NULL, 0, NULL);
 
 	g_free(base_name);
 }
@@ -838,7 +1544,7 @@ vcstatus_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 static void
 vcshow_file_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer gdata)
 {
-	gchar *output = NULL;
+	gchar *name;
 	const VC_RECORD *vc;
 	GeanyDocument *doc;
 
@@ -848,15 +1554,10 @@ vcshow_file_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpoint
 	vc = find_vc(doc->file_name);
 	g_return_if_fail(vc);
 
-	execute_command(vc, &output, NULL, doc->file_name, VC_COMMAND_SHOW, NULL, NULL);
-	if (output)
-	{
-		gchar *name;
-		name = g_strconcat(doc->file_name, ".vc.orig", NULL);
-		show_output(output, name, doc->encoding, doc->file_type, 0);
-		g_free(name);
-		g_free(output);
-	}
+	name = g_strconcat(doc->file_name, ".vc.orig", NULL);
+	execute_command_async(vc, doc->file_name, VC_COMMAND_SHOW, name, doc->encoding,
+			      doc->file_type, 0, NULL);
+	g_free(name);
 }
 
 static gboolean
@@ -877,7 +1578,7 @@ command_with_question_activated(gchar ** text, gint cmd, const gchar * question,
 
 	if (flags & FLAG_BASEDIR)
 	{
-		dir = vc->get_base_dir(dir);
+		setptr(dir, find_base_dir(vc, dir));
 	}
 
 	if (doc->changed)
@@ -1023,70 +1724,88 @@ get_commit_files_foreach(GtkTreeModel * model, G_GNUC_UNUSED GtkTreePath * path,
 	return FALSE;
 }
 
-static gboolean
-get_commit_diff_foreach(GtkTreeModel * model, G_GNUC_UNUSED GtkTreePath * path, GtkTreeIter * iter,
-			gpointer data)
+static void
+vc_diff_entry_free(VC_DIFF_ENTRY * entry)
 {
-	GString *diff = data;
-	gboolean commit;
-	gchar *filename;
-	gchar *tmp = NULL;
-	gchar *status;
-	const VC_RECORD *vc;
+	g_free(entry->diff);
+	g_free(entry->meta_dir);
+	g_free(entry);
+}
 
-	gtk_tree_model_get(model, iter, COLUMN_COMMIT, &commit, -1);
-	if (!commit)
-		return FALSE;
+/* Drops the cached diffs which can't be kept up to date */
+static void
+vc_diff_cache_drop_unwatched(void)
+{
+	GHashTableIter iter;
+	gpointer value;
 
-	gtk_tree_model_get(model, iter, COLUMN_STATUS, &status, -1);
+	if (!vc_diffs)
+		return;
 
-	if (! utils_str_equal(status, FILE_STATUS_MODIFIED))
+	g_hash_table_iter_init(&iter, vc_diffs);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
 	{
-		g_free(status);
-		return FALSE;
+		if (((VC_DIFF_ENTRY *) value)->meta_dir == NULL)
+			g_hash_table_iter_remove(&iter);
 	}
+}
 
-	gtk_tree_model_get(model, iter, COLUMN_PATH, &filename, -1);
-
-	vc = find_vc(filename);
-	g_return_val_if_fail(vc, FALSE);
+/* Returns the diff of filename, which must not be freed. The diff is cached until the
+ * file or the metadata directory of its VC changes. */
+static const gchar *
+get_commit_file_diff(const gchar * filename)
+{
+	VC_DIFF_ENTRY *entry;
+	VC_DIR_ENTRY *dir_entry;
+	const VC_RECORD *vc;
+	struct stat st;
+	gchar *locale_filename;
+	gchar *dir;
+	gchar *text = NULL;
 
-	execute_command(vc, &tmp, NULL, filename, VC_COMMAND_DIFF_FILE, NULL, NULL);
-	if (tmp)
-	{
-		/* We temporarily add the filename to the diff output for parsing the diff output later,
-		 * after we have finished parsing, we apply the tag "invisible" which hides the text. */
-		g_string_append_printf(diff, "VC_DIFF%s\n", filename);
-		g_string_append(diff, tmp);
-		g_free(tmp);
-	}
-	else
+	locale_filename = utils_get_locale_from_utf8(filename);
+	if (g_stat(locale_filename, &st) != 0)
 	{
-		g_warning("error: geanyvc: get_commit_diff_foreach: empty diff output");
+		st.st_mtime = 0;
+		st.st_size = 0;
 	}
-	g_free(filename);
-	return FALSE;
-}
+	g_free(locale_filename);
 
-static gchar *
-get_commit_diff(GtkTreeView * treeview)
-{
-	GtkTreeModel *model = gtk_tree_view_get_model(treeview);
-	GString *ret = g_string_new(NULL);
+	if (!vc_diffs)
+		vc_diffs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+						 (GDestroyNotify) vc_diff_entry_free);
+
+	entry = g_hash_table_lookup(vc_diffs, filename);
+	if (entry && entry->mtime == st.st_mtime && entry->size == st.st_size)
+		return entry->diff;
+
+	vc = find_vc(filename);
+	g_return_val_if_fail(vc, NULL);
+
+	execute_command(vc, &text, NULL, filename, VC_COMMAND_DIFF_FILE, NULL, NULL);
+	if (!text)
+		g_warning("error: geanyvc: get_commit_file_diff: empty diff output");
+
+	dir = g_path_get_dirname(filename);
+	dir_entry = vc_cache_get_dir(dir);
+	g_free(dir);
 
-	gtk_tree_model_foreach(model, get_commit_diff_foreach, ret);
+	entry = g_new0(VC_DIFF_ENTRY, 1);
+	entry->diff = text;
+	entry->meta_dir = g_strdup(dir_entry->meta_dir);
+	entry->mtime = st.st_mtime;
+	entry->size = st.st_size;
+	g_hash_table_insert(vc_diffs, g_strdup(filename), entry);
 
-	return g_string_free(ret, FALSE);
+	return text;
 }
 
 static void
 set_diff_buff(GtkWidget * textview, GtkTextBuffer * buffer, const gchar * txt)
 {
 	GtkTextIter start, end;
-	GtkTextMark *mark;
-	gchar *filename;
 	const gchar *tagname = "";
-	const gchar *c, *p = txt;
+	const gchar *p = txt;
 
 	if (strlen(txt) > COMMIT_DIFF_MAXLENGTH)
 	{
@@ -1110,7 +1829,6 @@ set_diff_buff(GtkWidget * textview, GtkTextBuffer * buffer, const gchar * txt)
 
 	while (p)
 	{
-		c = NULL;
 		if (*p == '-')
 		{
 			tagname = "deleted";
@@ -1123,14 +1841,6 @@ set_diff_buff(GtkWidget * textview, GtkTextBuffer * buffer, const gchar * txt)
 		{
 			tagname = "";
 		}
-		else if (strncmp(p, "VC_DIFF", 7) == 0)
-		{	/* Lines starting with VC_DIFF are special and were added by our code to tell about
-			 * filename to which the following diff lines belong. We use this file to create
-			 * text marks which we then later use to scroll to if the corresponding file has been
-			 * selected in the commit dialog's files list. */
-			tagname = "invisible";
-			c = strchr(p + 7, '\n');
-		}
 		else
 		{
 			tagname = "default";
@@ -1138,18 +1848,6 @@ set_diff_buff(GtkWidget * textview, GtkTextBuffer * buffer, const gchar * txt)
 		gtk_text_buffer_get_iter_at_offset(buffer, &start,
 						   g_utf8_pointer_to_offset(txt, p));
 
-		if (c)
-		{	/* create the mark *after* the start iter has been updated */
-			filename = g_strndup(p + 7, c - p - 7);
-			/* delete old text marks */
-			mark = gtk_text_buffer_get_mark(buffer, filename);
-			if (mark)
-				gtk_text_buffer_delete_mark(buffer, mark);
-			/* create a new one */
-			gtk_text_buffer_create_mark(buffer, filename, &start, TRUE);
-			g_free(filename);
-		}
-
 		p = strchr(p, '\n');
 		if (p)
 		{
@@ -1164,16 +1862,6 @@ set_diff_buff(GtkWidget * textview, GtkTextBuffer * buffer, const gchar * txt)
 	}
 }
 
-static void
-refresh_diff_view(GtkTreeView *treeview)
-{
-	gchar *diff;
-	GtkWidget *diffView = ui_lookup_widget(GTK_WIDGET(treeview), "textDiff");
-	diff = get_commit_diff(GTK_TREE_VIEW(treeview));
-	set_diff_buff(diffView, gtk_text_view_get_buffer(GTK_TEXT_VIEW(diffView)), diff);
-	g_free(diff);
-}
-
 static void
 commit_toggled(G_GNUC_UNUSED GtkCellRendererToggle * cell, gchar * path_str, gpointer data)
 {
@@ -1182,13 +1870,10 @@ commit_toggled(G_GNUC_UNUSED GtkCellRendererToggle * cell, gchar * path_str, gpo
 	GtkTreeIter iter;
 	GtkTreePath *path = gtk_tree_path_new_from_string(path_str);
 	gboolean fixed;
-	gchar *filename;
-	GtkTextView *diffView = GTK_TEXT_VIEW(ui_lookup_widget(GTK_WIDGET(treeview), "textDiff"));
-	GtkTextMark *mark;
 
 	/* get toggled iter */
 	gtk_tree_model_get_iter(model, &iter, path);
-	gtk_tree_model_get(model, &iter, COLUMN_COMMIT, &fixed, COLUMN_PATH, &filename, -1);
+	gtk_tree_model_get(model, &iter, COLUMN_COMMIT, &fixed, -1);
 
 	/* do something with the value */
 	fixed ^= 1;
@@ -1196,18 +1881,8 @@ commit_toggled(G_GNUC_UNUSED GtkCellRendererToggle * cell, gchar * path_str, gpo
 	/* set new value */
 	gtk_list_store_set(GTK_LIST_STORE(model), &iter, COLUMN_COMMIT, fixed, -1);
 
-	if (! fixed)
-	{
-		mark = gtk_text_buffer_get_mark(gtk_text_view_get_buffer(diffView), filename);
-		if (mark)
-			gtk_text_buffer_delete_mark(gtk_text_view_get_buffer(diffView), mark);
-	}
-
-	refresh_diff_view(treeview);
-
 	/* clean up */
 	gtk_tree_path_free(path);
-	g_free(filename);
 }
 
 static gboolean
@@ -1226,8 +1901,6 @@ commit_all_toggled_cb(GtkToggleButton *check_box, gpointer treeview)
 	gint toggled = gtk_toggle_button_get_active(check_box);
 
 	gtk_tree_model_foreach(model, toggle_all_commit_files, &toggled);
-
-	refresh_diff_view(treeview);
 }
 
 static void
@@ -1284,25 +1957,25 @@ get_diff_color(G_GNUC_UNUSED GeanyDocument * doc, gint style)
 #define GLADE_HOOKUP_OBJECT_NO_REF(component,widget,name) \
   g_object_set_data (G_OBJECT (component), name, widget)
 
+/* Shows the diff of the selected file, only computed when a file is selected first */
 static void commit_tree_selection_changed_cb(GtkTreeSelection *sel, GtkTextView *textview)
 {
 	GtkTreeModel *model;
 	GtkTreeIter iter;
-	GtkTextMark *mark;
+	const gchar *diff = NULL;
 	gchar *path;
-	gboolean set;
+	gchar *status;
 
 	if (! gtk_tree_selection_get_selected(sel, &model, &iter))
 		return;
 
-	gtk_tree_model_get(model, &iter, COLUMN_COMMIT, &set, COLUMN_PATH, &path, -1);
+	gtk_tree_model_get(model, &iter, COLUMN_STATUS, &status, COLUMN_PATH, &path, -1);
 
-	if (set)
-	{
-		mark = gtk_text_buffer_get_mark(gtk_text_view_get_buffer(textview), path);
-		if (mark)
-			gtk_text_view_scroll_to_mark(textview, mark, 0.0, TRUE, 0.0, 0.0);
-	}
+	if (utils_str_equal(status, FILE_STATUS_MODIFIED))
+		diff = get_commit_file_diff(path);
+	set_diff_buff(GTK_WIDGET(textview), gtk_text_view_get_buffer(textview), diff ? diff : "");
+
+	g_free(status);
 	g_free(path);
 }
 
@@ -1529,11 +2202,11 @@ vccommit_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 
 	GtkTextIter begin;
 	GtkTextIter end;
+	GtkTreeIter first;
 	GSList *selected_files = NULL;
 
 	gchar *dir;
 	gchar *message;
-	gchar *diff;
 
 	gint height;
 
@@ -1547,7 +2220,7 @@ vccommit_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 	g_return_if_fail(doc->file_name);
 	vc = find_vc(doc->file_name);
 	g_return_if_fail(vc);
-	dir = vc->get_base_dir(doc->file_name);
+	dir = find_base_dir(vc, doc->file_name);
 
 	lst = vc->get_commit_files(dir);
 	if (!lst)
@@ -1564,7 +2237,6 @@ vccommit_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 	/* add columns to the tree view */
 	add_commit_columns(GTK_TREE_VIEW(treeview));
 
-	diff = get_commit_diff(GTK_TREE_VIEW(treeview));
 	diffbuf = gtk_text_view_get_buffer(GTK_TEXT_VIEW(diffView));
 
 	gtk_text_buffer_create_tag(diffbuf, "deleted", "foreground-gdk",
@@ -1576,10 +2248,10 @@ vccommit_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 	gtk_text_buffer_create_tag(diffbuf, "default", "foreground-gdk",
 				   get_diff_color(doc, SCE_DIFF_POSITION), NULL);
 
-	gtk_text_buffer_create_tag(diffbuf, "invisible", "invisible",
-				   TRUE, NULL);
-
-	set_diff_buff(diffView, diffbuf, diff);
+	/* show the diff of the first file */
+	if (gtk_tree_model_get_iter_first(model, &first))
+		gtk_tree_selection_select_iter(gtk_tree_view_get_selection(GTK_TREE_VIEW(treeview)),
+					       &first);
 
 	if (set_maximize_commit_dialog)
 	{
@@ -1642,13 +2314,14 @@ vccommit_activated(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer
 	gtk_widget_destroy(commit);
 	free_commit_list(lst);
 	g_free(dir);
-	g_free(diff);
+	vc_diff_cache_drop_unwatched();
 }
 
 static GtkWidget *menu_vc_diff_file = NULL;
 static GtkWidget *menu_vc_diff_dir = NULL;
 static GtkWidget *menu_vc_diff_basedir = NULL;
 static GtkWidget *menu_vc_blame = NULL;
+static GtkWidget *menu_vc_blame_line = NULL;
 static GtkWidget *menu_vc_log_file = NULL;
 static GtkWidget *menu_vc_log_dir = NULL;
 static GtkWidget *menu_vc_log_basedir = NULL;
@@ -1661,6 +2334,7 @@ static GtkWidget *menu_vc_remove_file = NULL;
 static GtkWidget *menu_vc_update = NULL;
 static GtkWidget *menu_vc_commit = NULL;
 static GtkWidget *menu_vc_show_file = NULL;
+static GtkWidget *menu_vc_cancel = NULL;
 
 static void
 update_menu_items(void)
@@ -1692,6 +2366,7 @@ update_menu_items(void)
 	gtk_widget_set_sensitive(menu_vc_diff_basedir, d_have_vc);
 
 	gtk_widget_set_sensitive(menu_vc_blame, f_have_vc);
+	gtk_widget_set_sensitive(menu_vc_blame_line, f_have_vc);
 
 	gtk_widget_set_sensitive(menu_vc_log_file, f_have_vc);
 	gtk_widget_set_sensitive(menu_vc_log_dir, d_have_vc);
@@ -1710,9 +2385,17 @@ update_menu_items(void)
 	gtk_widget_set_sensitive(menu_vc_commit, d_have_vc);
 
 	gtk_widget_set_sensitive(menu_vc_show_file, f_have_vc);
+
+	gtk_widget_set_sensitive(menu_vc_cancel, running_job != NULL);
 }
 
 
+static void
+kbblame_line(G_GNUC_UNUSED guint key_id)
+{
+	vcblame_line_activated(NULL, NULL);
+}
+
 static void
 kbdiff_file(G_GNUC_UNUSED guint key_id)
 {
@@ -1776,6 +2459,7 @@ static struct
 	GtkWidget *cb_external_diff;
 	GtkWidget *cb_editor_menu_entries;
 	GtkWidget *cb_attach_to_menubar;
+	GtkWidget *cb_gutter_diff;
 	GtkWidget *cb_cvs;
 	GtkWidget *cb_git;
 	GtkWidget *cb_svn;
@@ -1812,6 +2496,8 @@ on_configure_response(G_GNUC_UNUSED GtkDialog * dialog, gint response,
 			gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widgets.cb_editor_menu_entries));
 		set_menubar_entry =
 			gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widgets.cb_attach_to_menubar));
+		set_gutter_diff =
+			gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widgets.cb_gutter_diff));
 
 		enable_cvs = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widgets.cb_cvs));
 		enable_git = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widgets.cb_git));
@@ -1834,6 +2520,7 @@ on_configure_response(G_GNUC_UNUSED GtkDialog * dialog, gint response,
 				       set_maximize_commit_dialog);
 		g_key_file_set_boolean(config, "VC", "set_editor_menu_entries", set_editor_menu_entries);
 		g_key_file_set_boolean(config, "VC", "attach_to_menubar", set_menubar_entry);
+		g_key_file_set_boolean(config, "VC", "show_gutter_diff", set_gutter_diff);
 
 		g_key_file_set_boolean(config, "VC", "enable_cvs", enable_cvs);
 		g_key_file_set_boolean(config, "VC", "enable_git", enable_git);
@@ -1871,6 +2558,7 @@ on_configure_response(G_GNUC_UNUSED GtkDialog * dialog, gint response,
 		g_key_file_free(config);
 
 		registrate();
+		vc_gutter_set_enabled(set_gutter_diff);
 	}
 }
 
@@ -1939,6 +2627,14 @@ plugin_configure(GtkDialog * dialog)
 		set_menubar_entry);
 	gtk_box_pack_start(GTK_BOX(vbox), widgets.cb_attach_to_menubar, TRUE, FALSE, 2);
 
+	widgets.cb_gutter_diff = gtk_check_button_new_with_label(_("Show changed lines in the margin"));
+	ui_widget_set_tooltip_text(widgets.cb_gutter_diff,
+			     _("Mark the lines added, changed or deleted since the last commit "
+			       "in the margin of the editor while typing."));
+	gtk_button_set_focus_on_click(GTK_BUTTON(widgets.cb_gutter_diff), FALSE);
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(widgets.cb_gutter_diff), set_gutter_diff);
+	gtk_box_pack_start(GTK_BOX(vbox), widgets.cb_gutter_diff, TRUE, FALSE, 2);
+
 	widgets.cb_cvs = gtk_check_button_new_with_label(_("Enable CVS"));
 	gtk_button_set_focus_on_click(GTK_BUTTON(widgets.cb_cvs), FALSE);
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(widgets.cb_cvs), enable_cvs);
@@ -2021,6 +2717,8 @@ load_config(void)
 		TRUE);
 	set_menubar_entry = utils_get_setting_boolean(config, "VC", "attach_to_menubar",
 		FALSE);
+	set_gutter_diff = utils_get_setting_boolean(config, "VC", "show_gutter_diff",
+		FALSE);
 
 #ifdef USE_GTKSPELL
 	lang = g_key_file_get_string(config, "VC", "spellchecking_language", &error);
@@ -2045,6 +2743,7 @@ registrate(void)
 		g_slist_free(VC);
 		VC = NULL;
 	}
+	vc_cache_clear();
 	REGISTER_VC(GIT, enable_git);
 	REGISTER_VC(SVN, enable_svn);
 	REGISTER_VC(CVS, enable_cvs);
@@ -2094,6 +2793,14 @@ do_current_file_menu(GtkWidget ** parent_menu, gboolean editor_menu)
 
 	g_signal_connect(menu_vc_blame, "activate", G_CALLBACK(vcblame_activated), NULL);
 
+	/* Last change of the current line */
+	menu_vc_blame_line = gtk_menu_item_new_with_mnemonic(_("Blame Current _Line"));
+	gtk_container_add(GTK_CONTAINER(cur_file_menu), menu_vc_blame_line);
+	ui_widget_set_tooltip_text(menu_vc_blame_line,
+			     _("Shows the author, date and summary of the last change of the current line."));
+
+	g_signal_connect(menu_vc_blame_line, "activate", G_CALLBACK(vcblame_line_activated), NULL);
+
 	gtk_container_add(GTK_CONTAINER(cur_file_menu), gtk_separator_menu_item_new());
 
 	/* History/log of current file */
@@ -2286,11 +2993,13 @@ init_keybindings(void)
 			     "vc_revert_basedir", _("Revert base directory"), menu_vc_revert_basedir);
 	keybindings_set_item(plugin_key_group, VC_UPDATE, kbupdate, 0, 0, "vc_update",
 			     _("Update file"), menu_vc_update);
+	keybindings_set_item(plugin_key_group, VC_BLAME_LINE, kbblame_line, 0, 0,
+			     "vc_blame_line", _("Blame current line"), menu_vc_blame_line);
 }
 
-/* Called by Geany to initialize the plugin */
-void
-plugin_init(G_GNUC_UNUSED GeanyData * data)
+/* Called by Geany to initialize the plugin, through plugin_init() below */
+static void
+init_plugin(G_GNUC_UNUSED GeanyData * data)
 {
 	GtkWidget *menu_vc = NULL;
 	GtkWidget *menu_vc_menu = NULL;
@@ -2298,6 +3007,11 @@ plugin_init(G_GNUC_UNUSED GeanyData * data)
 	GtkWidget *menu_vc_dir = NULL;
 	GtkWidget *menu_vc_basedir = NULL;
 
+	/* the gutter markers are computed in a worker thread */
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+	plugin_module_make_resident(geany_plugin);
+
 	config_file =
 		g_strconcat(geany->app->configdir, G_DIR_SEPARATOR_S, "plugins", G_DIR_SEPARATOR_S,
 			    "VC", G_DIR_SEPARATOR_S, "VC.conf", NULL);
@@ -2361,6 +3075,16 @@ plugin_init(G_GNUC_UNUSED GeanyData * data)
 
 	g_signal_connect(menu_vc_commit, "activate", G_CALLBACK(vccommit_activated), NULL);
 
+	gtk_container_add(GTK_CONTAINER(menu_vc_menu), gtk_separator_menu_item_new());
+
+	/* Stop a command running in the background */
+	menu_vc_cancel = gtk_menu_item_new_with_mnemonic(_("C_ancel Running Command"));
+	gtk_container_add(GTK_CONTAINER(menu_vc_menu), menu_vc_cancel);
+	ui_widget_set_tooltip_text(menu_vc_cancel,
+				   _("Stop the diff, log or status command still writing its output."));
+
+	g_signal_connect(menu_vc_cancel, "activate", G_CALLBACK(vccancel_activated), NULL);
+
 	gtk_widget_show_all(menu_vc);
 
 	/* initialize keybindings */
@@ -2371,16 +3095,28 @@ plugin_init(G_GNUC_UNUSED GeanyData * data)
 
 	ui_add_document_sensitive(menu_vc);
 	menu_entry = menu_vc;
+
+	vc_gutter_set_enabled(set_gutter_diff);
+	vc_status_init();
 }
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init_plugin)
+
 
 /* Called by Geany before unloading the plugin. */
 void
 plugin_cleanup(void)
 {
+	vc_job_cancel();
+	vc_gutter_cleanup();
+	vc_blame_cleanup();
+	vc_log_cleanup();
+	vc_status_cleanup();
+	vc_external_diff_cleanup();
 	remove_menuitems_from_editor_menu();
 	gtk_widget_destroy(menu_entry);
 	g_slist_free(VC);
 	VC = NULL;
+	vc_cache_clear();
 	g_free(config_file);
 }
@@ -64,6 +64,12 @@ enum
 #define P_ABS_FILENAME      "*<?geanyvcFILENAME>*"
 #define P_BASENAME          "*<?geanyvcBASE_FILENAME>*"
 
+/* replaced by the log browser, see log.c */
+#define P_LOG_LIMIT         "*<?geanyvcLOG_LIMIT>*"
+#define P_LOG_SKIP          "*<?geanyvcLOG_SKIP>*"
+#define P_LOG_FROM          "*<?geanyvcLOG_FROM>*"
+#define P_LOG_REVISION      "*<?geanyvcLOG_REVISION>*"
+
 /* The addresses of these strings act as enums, their contents are not used. */
 
 
@@ -100,8 +106,14 @@ execute_custom_command(const gchar * dir, const gchar ** argv, const gchar ** en
 		       gchar ** std_err, const gchar * filename, GSList * list,
 		       const gchar * message);
 
+void normalize_command_output(gchar ** text);
 gboolean find_dir(const gchar * filename, const char *find, gboolean recursive);
+gchar *get_base_revision_text(const gchar * filename);
 gchar *find_subdir_path(const gchar * filename, const gchar * subdir);
+gchar **get_blame_lines_command(const gchar * filename, gchar ** dir, gchar *** env,
+				gchar ** revision);
+gchar **get_base_revision_command(const gchar * filename, gchar ** dir, gchar *** env,
+				  gchar ** revision);
 
 typedef struct _VC_COMMAND
 {
@@ -119,6 +131,24 @@ typedef struct _VC_RECORD
 	/* check if file in VC */
 	gboolean(*in_vc) (const gchar * path);
 	GSList *(*get_commit_files) (const gchar * dir);
+	/* metadata directory below the base directory, watched to invalidate cached lookups */
+	const gchar *meta_dir;
+	/* blame in the "git blame --porcelain" format, NULL if lines can't be annotated */
+	const gchar **blame_lines;
+	/* prints the revision of the working copy, the blame is cached per revision */
+	const gchar **head_revision;
+	/* one page of the log, NULL if it can't be paged, see log.c */
+	const gchar **log_page;
+	/* P_LOG_FROM of the first page, NULL if the pages skip P_LOG_SKIP commits instead */
+	const gchar *log_first;
+	/* turns the output of log_page into records, NULL if it prints them already */
+	gchar *(*log_records) (const gchar * output);
+	/* the details of revision P_LOG_REVISION */
+	const gchar **log_show;
+	/* like get_commit_files, with the untracked files; NULL to use get_commit_files */
+	GSList *(*get_status_files) (const gchar * dir);
+	/* the revision of the working copy without running head_revision, NULL if it can't tell */
+	gchar *(*get_head_revision) (const gchar * path);
 } VC_RECORD;
 
 typedef struct _CommitItem
@@ -137,6 +167,36 @@ extern const gchar *NO_ENV[];
 /* External diff viewer */
 const gchar *get_external_diff_viewer(void);
 void vc_external_diff(const gchar * src, const gchar * dest);
+void vc_external_diff_file(const gchar * filename);
+void vc_external_diff_cleanup(void);
+
+/* Gutter markers */
+void vc_gutter_set_enabled(gboolean enabled);
+void vc_gutter_document_changed(GeanyDocument * doc);
+void vc_gutter_document_update(GeanyDocument * doc);
+void vc_gutter_document_close(GeanyDocument * doc);
+void vc_gutter_invalidate(void);
+void vc_gutter_cleanup(void);
+
+const VC_RECORD *find_vc(const char *filename);
+gchar *find_base_dir(const VC_RECORD * vc, const gchar * filename);
+void free_commit_list(GSList * lst);
+gchar **get_vc_command(const VC_RECORD * vc, const gchar ** command, gint cmd,
+		       const gchar * filename, gchar ** dir, gchar *** env);
+
+/* Line annotations */
+void vc_blame_show_line(GeanyDocument * doc);
+void vc_blame_document_close(GeanyDocument * doc);
+void vc_blame_cleanup(void);
+
+/* Log browser */
+gboolean vc_log_show(const VC_RECORD * vc, const gchar * filename, gint cmd);
+void vc_log_cleanup(void);
+
+/* Status shared with the other plugins */
+void vc_status_init(void);
+void vc_status_document_saved(GeanyDocument * doc);
+void vc_status_cleanup(void);
 
 /* utils.c */
 gchar *normpath(const gchar * filename);
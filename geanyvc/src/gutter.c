@@ -0,0 +1,608 @@
+/*
+ *      gutter.c - Plugin to geany light IDE to work with vc
+ *
+ *      Live markers of the lines changed against the VC base revision.
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <geanyplugin.h>
+#include "geanyvc.h"
+#include "SciLexer.h"
+#include "largefile.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+extern GeanyPlugin *geany_plugin;
+
+
+/* markers 12 to 17 are used by the debugger plugin */
+#define GUTTER_MARKER_ADDED    20
+#define GUTTER_MARKER_CHANGED  21
+#define GUTTER_MARKER_DELETED  22
+
+/* delay in ms after the last modification before the markers are updated */
+#define GUTTER_UPDATE_DELAY    300
+#define GUTTER_POLL_INTERVAL   50
+/* bigger differences are marked as a single changed block */
+#define GUTTER_MAX_EDITS       1000
+
+#define GUTTER_DATA_KEY "geanyvc-gutter"
+
+
+/* State of a document, attached to its ScintillaObject */
+typedef struct
+{
+	gchar *base;		/* content in the base revision, NULL if unknown or not under VC */
+	gboolean have_base;	/* whether base was fetched */
+	guint version;		/* incremented on every modification */
+} GutterData;
+
+typedef struct
+{
+	const gchar *start;
+	gsize len;
+	guint hash;
+} GutterLine;
+
+typedef struct
+{
+	gint line;
+	gint marker;
+} GutterMark;
+
+/* A diff running in the worker thread */
+typedef struct
+{
+	GeanyDocument *doc;	/* NULL if the document was closed meanwhile */
+	guint version;
+	gchar *base;
+	gchar *text;
+	GArray *marks;		/* GutterMark */
+	GThread *thread;
+	volatile gint finished;
+} GutterJob;
+
+
+static gboolean gutter_enabled = FALSE;
+static GutterJob *gutter_job = NULL;
+static gboolean gutter_pending = FALSE;
+static guint gutter_update_source = 0;
+static guint gutter_poll_source = 0;
+
+
+static void
+gutter_data_free(GutterData * data)
+{
+	g_free(data->base);
+	g_free(data);
+}
+
+
+static void
+gutter_define_markers(ScintillaObject * sci)
+{
+	const gint markers[] = { GUTTER_MARKER_ADDED, GUTTER_MARKER_CHANGED, GUTTER_MARKER_DELETED };
+	const gint styles[] = { SCE_DIFF_ADDED, SCE_DIFF_POSITION, SCE_DIFF_DELETED };
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(markers); i++)
+	{
+		const GeanyLexerStyle *s = highlighting_get_style(GEANY_FILETYPES_DIFF, styles[i]);
+
+		scintilla_send_message(sci, SCI_MARKERDEFINE, markers[i], SC_MARK_LEFTRECT);
+		scintilla_send_message(sci, SCI_MARKERSETBACK, markers[i], s->foreground);
+	}
+}
+
+
+static GutterData *
+gutter_get_data(GeanyDocument * doc, gboolean create)
+{
+	GutterData *data = g_object_get_data(G_OBJECT(doc->editor->sci), GUTTER_DATA_KEY);
+
+	if (data == NULL && create)
+	{
+		data = g_new0(GutterData, 1);
+		g_object_set_data_full(G_OBJECT(doc->editor->sci), GUTTER_DATA_KEY, data,
+				       (GDestroyNotify) gutter_data_free);
+		gutter_define_markers(doc->editor->sci);
+	}
+	return data;
+}
+
+
+static void
+gutter_clear_markers(GeanyDocument * doc)
+{
+	ScintillaObject *sci = doc->editor->sci;
+
+	scintilla_send_message(sci, SCI_MARKERDELETEALL, GUTTER_MARKER_ADDED, 0);
+	scintilla_send_message(sci, SCI_MARKERDELETEALL, GUTTER_MARKER_CHANGED, 0);
+	scintilla_send_message(sci, SCI_MARKERDELETEALL, GUTTER_MARKER_DELETED, 0);
+}
+
+
+/* Splits text into lines without their line endings. A text ending with a line break has
+ * an empty last line, like in Scintilla. */
+static GArray *
+gutter_split_lines(const gchar * text)
+{
+	GArray *lines = g_array_new(FALSE, FALSE, sizeof(GutterLine));
+	const gchar *p = text;
+
+	while (TRUE)
+	{
+		GutterLine line;
+		const gchar *end = strchr(p, '\n');
+		const gchar *c;
+
+		if (end == NULL)
+			end = p + strlen(p);
+
+		line.start = p;
+		line.len = end - p;
+		if (line.len > 0 && p[line.len - 1] == '\r')
+			line.len--;
+		line.hash = 5381;
+		for (c = p; c < p + line.len; c++)
+			line.hash = (line.hash << 5) + line.hash + (guchar) *c;
+		g_array_append_val(lines, line);
+
+		if (*end == '\0')
+			break;
+		p = end + 1;
+	}
+	return lines;
+}
+
+
+static gboolean
+gutter_lines_equal(const GutterLine * a, const GutterLine * b)
+{
+	return a->hash == b->hash && a->len == b->len && memcmp(a->start, b->start, a->len) == 0;
+}
+
+
+static void
+gutter_add_mark(GArray * marks, gint line, gint marker)
+{
+	GutterMark mark;
+
+	mark.line = line;
+	mark.marker = marker;
+	g_array_append_val(marks, mark);
+}
+
+
+/* Adds the markers for a block where n base lines were replaced by the current lines from
+ * line to line + m - 1. last is the last line of the current text. */
+static void
+gutter_mark_block(GArray * marks, gint n, gint line, gint m, gint last)
+{
+	gint i;
+
+	if (m > 0)
+	{
+		for (i = line; i < line + m; i++)
+			gutter_add_mark(marks, i, n > 0 ? GUTTER_MARKER_CHANGED : GUTTER_MARKER_ADDED);
+	}
+	else if (n > 0)
+		gutter_add_mark(marks, MIN(line, last), GUTTER_MARKER_DELETED);
+}
+
+
+/* Finds the shortest edit script from a (n lines) to b (m lines) with Myers' algorithm
+ * and fills deleted and inserted. Returns FALSE if it needs more than GUTTER_MAX_EDITS edits. */
+static gboolean
+gutter_myers(const GutterLine * a, gint n, const GutterLine * b, gint m,
+	     gboolean * deleted, gboolean * inserted)
+{
+	gint max_d = MIN(n + m, GUTTER_MAX_EDITS);
+	gint *v = g_new(gint, 2 * max_d + 3) + max_d + 1;
+	GPtrArray *trace = g_ptr_array_new();
+	gboolean found = FALSE;
+	gint d, k, x, y;
+	guint i;
+
+	v[1] = 0;
+	for (d = 0; d <= max_d && !found; d++)
+	{
+		gint *step;
+
+		for (k = -d; k <= d; k += 2)
+		{
+			if (k == -d || (k != d && v[k - 1] < v[k + 1]))
+				x = v[k + 1];
+			else
+				x = v[k - 1] + 1;
+			y = x - k;
+			while (x < n && y < m && gutter_lines_equal(&a[x], &b[y]))
+			{
+				x++;
+				y++;
+			}
+			v[k] = x;
+			if (x >= n && y >= m)
+			{
+				found = TRUE;
+				break;
+			}
+		}
+		/* remember v[-d..d] to walk back */
+		step = g_new(gint, 2 * d + 1);
+		memcpy(step, &v[-d], (2 * d + 1) * sizeof(gint));
+		g_ptr_array_add(trace, step);
+	}
+
+	if (found)
+	{
+		x = n;
+		y = m;
+		for (d = trace->len - 1; d > 0; d--)
+		{
+			gint *prev = (gint *) g_ptr_array_index(trace, d - 1) + d - 1;
+			gint prev_k, prev_x, prev_y;
+
+			k = x - y;
+			if (k == -d || (k != d && prev[k - 1] < prev[k + 1]))
+				prev_k = k + 1;
+			else
+				prev_k = k - 1;
+			prev_x = prev[prev_k];
+			prev_y = prev_x - prev_k;
+
+			/* skip the equal lines after the edit */
+			while (x > prev_x && y > prev_y)
+			{
+				x--;
+				y--;
+			}
+			if (x == prev_x)
+				inserted[prev_y] = TRUE;
+			else
+				deleted[prev_x] = TRUE;
+			x = prev_x;
+			y = prev_y;
+		}
+	}
+
+	for (i = 0; i < trace->len; i++)
+		g_free(g_ptr_array_index(trace, i));
+	g_ptr_array_free(trace, TRUE);
+	g_free(v - max_d - 1);
+	return found;
+}
+
+
+/* Computes the markers of the changes from base to text */
+static void
+gutter_diff(const gchar * base, const gchar * text, GArray * marks)
+{
+	GArray *a_lines = gutter_split_lines(base);
+	GArray *b_lines = gutter_split_lines(text);
+	const GutterLine *a = (const GutterLine *) a_lines->data;
+	const GutterLine *b = (const GutterLine *) b_lines->data;
+	gint n = a_lines->len;
+	gint m = b_lines->len;
+	gint last = m - 1;
+	gint start = 0;
+	gboolean *deleted, *inserted;
+
+	/* most edits are local, only the different middle part needs to be diffed */
+	while (start < n && start < m && gutter_lines_equal(&a[start], &b[start]))
+		start++;
+	while (n > start && m > start && gutter_lines_equal(&a[n - 1], &b[m - 1]))
+	{
+		n--;
+		m--;
+	}
+	a += start;
+	b += start;
+	n -= start;
+	m -= start;
+
+	deleted = g_new0(gboolean, n + 1);
+	inserted = g_new0(gboolean, m + 1);
+	if (n == 0 || m == 0 || ! gutter_myers(a, n, b, m, deleted, inserted))
+		gutter_mark_block(marks, n, start, m, last);
+	else
+	{
+		gint i = 0, j = 0;
+
+		while (i < n || j < m)
+		{
+			gint dels = 0, ins_start;
+
+			if (i < n && j < m && !deleted[i] && !inserted[j])
+			{
+				i++;
+				j++;
+				continue;
+			}
+			while (i < n && deleted[i])
+			{
+				dels++;
+				i++;
+			}
+			ins_start = j;
+			while (j < m && inserted[j])
+				j++;
+			if (dels == 0 && j == ins_start)
+				break;
+			gutter_mark_block(marks, dels, start + ins_start, j - ins_start, last);
+		}
+	}
+
+	g_free(deleted);
+	g_free(inserted);
+	g_array_free(a_lines, TRUE);
+	g_array_free(b_lines, TRUE);
+}
+
+
+static gpointer
+gutter_job_thread(gpointer data)
+{
+	GutterJob *job = data;
+
+	gutter_diff(job->base, job->text, job->marks);
+	g_atomic_int_set(&job->finished, TRUE);
+	return NULL;
+}
+
+
+static void
+gutter_job_free(GutterJob * job)
+{
+	g_free(job->base);
+	g_free(job->text);
+	g_array_free(job->marks, TRUE);
+	g_free(job);
+}
+
+
+static void
+gutter_apply(GutterJob * job)
+{
+	GutterData *data;
+	ScintillaObject *sci;
+	guint i;
+
+	if (job->doc == NULL || !job->doc->is_valid || !gutter_enabled)
+		return;
+	data = gutter_get_data(job->doc, FALSE);
+	/* the document changed meanwhile, another update is coming */
+	if (data == NULL || data->version != job->version)
+		return;
+
+	sci = job->doc->editor->sci;
+	gutter_clear_markers(job->doc);
+	for (i = 0; i < job->marks->len; i++)
+	{
+		GutterMark *mark = &g_array_index(job->marks, GutterMark, i);
+
+		scintilla_send_message(sci, SCI_MARKERADD, mark->line, mark->marker);
+	}
+}
+
+
+static void gutter_schedule_update(void);
+
+
+static gboolean
+gutter_poll_cb(G_GNUC_UNUSED gpointer user_data)
+{
+	if (!g_atomic_int_get(&gutter_job->finished))
+		return TRUE;
+
+	g_thread_join(gutter_job->thread);
+	gutter_apply(gutter_job);
+	gutter_job_free(gutter_job);
+	gutter_job = NULL;
+	gutter_poll_source = 0;
+
+	if (gutter_pending)
+	{
+		gutter_pending = FALSE;
+		gutter_schedule_update();
+	}
+	return FALSE;
+}
+
+
+/* Starts the diff of the current document */
+static gboolean
+gutter_update_cb(G_GNUC_UNUSED gpointer user_data)
+{
+	GeanyDocument *doc = document_get_current();
+	GutterData *data;
+	GutterJob *job;
+
+	gutter_update_source = 0;
+
+	if (!gutter_enabled || doc == NULL || doc->file_name == NULL ||
+	    !g_path_is_absolute(doc->file_name))
+		return FALSE;
+
+	if (gutter_job != NULL)
+	{	/* try again when the running diff finished */
+		gutter_pending = TRUE;
+		return FALSE;
+	}
+
+	data = gutter_get_data(doc, TRUE);
+	if (!data->have_base)
+	{
+		g_free(data->base);
+		data->base = get_base_revision_text(doc->file_name);
+		data->have_base = TRUE;
+	}
+	if (data->base == NULL)
+	{
+		gutter_clear_markers(doc);
+		return FALSE;
+	}
+
+	job = g_new0(GutterJob, 1);
+	job->doc = doc;
+	job->version = data->version;
+	job->base = g_strdup(data->base);
+	job->text = sci_get_contents(doc->editor->sci, -1);
+	job->marks = g_array_new(FALSE, FALSE, sizeof(GutterMark));
+	job->thread = g_thread_create(gutter_job_thread, job, TRUE, NULL);
+	if (job->thread == NULL)
+	{
+		gutter_job_free(job);
+		return FALSE;
+	}
+
+	gutter_job = job;
+	gutter_poll_source = plugin_timeout_add(geany_plugin, GUTTER_POLL_INTERVAL, gutter_poll_cb,
+						NULL);
+	return FALSE;
+}
+
+
+static void
+gutter_schedule_update(void)
+{
+	if (!gutter_enabled)
+		return;
+
+	if (gutter_update_source)
+		g_source_remove(gutter_update_source);
+	gutter_update_source = plugin_timeout_add(geany_plugin, GUTTER_UPDATE_DELAY,
+						  gutter_update_cb, NULL);
+}
+
+
+/* Called on every modification of doc */
+void
+vc_gutter_document_changed(GeanyDocument * doc)
+{
+	GutterData *data;
+
+	if (!gutter_enabled)
+		return;
+
+	data = gutter_get_data(doc, FALSE);
+	if (data != NULL)
+		data->version++;
+	/* large documents are diffed again once saved or activated */
+	if (doc == document_get_current() && !gp_large_file_check(doc))
+		gutter_schedule_update();
+}
+
+
+/* Called when doc is activated, opened, reloaded or saved */
+void
+vc_gutter_document_update(GeanyDocument * doc)
+{
+	GutterData *data;
+
+	if (!gutter_enabled)
+		return;
+
+	/* a file without base might have been added meanwhile */
+	data = gutter_get_data(doc, FALSE);
+	if (data != NULL && data->base == NULL)
+		data->have_base = FALSE;
+	if (doc == document_get_current())
+		gutter_schedule_update();
+}
+
+
+void
+vc_gutter_document_close(GeanyDocument * doc)
+{
+	if (gutter_job != NULL && gutter_job->doc == doc)
+		gutter_job->doc = NULL;
+	g_object_set_data(G_OBJECT(doc->editor->sci), GUTTER_DATA_KEY, NULL);
+}
+
+
+/* Called when the VC base of some files might have changed, e.g. after a commit */
+void
+vc_gutter_invalidate(void)
+{
+	guint i;
+
+	if (!gutter_enabled)
+		return;
+
+	foreach_document(i)
+	{
+		GutterData *data = gutter_get_data(documents[i], FALSE);
+
+		if (data != NULL)
+			data->have_base = FALSE;
+	}
+	gutter_schedule_update();
+}
+
+
+void
+vc_gutter_set_enabled(gboolean enabled)
+{
+	guint i;
+
+	if (enabled == gutter_enabled)
+		return;
+
+	gutter_enabled = enabled;
+	if (enabled)
+	{
+		gp_large_file_register(geany_plugin, _("Version control changes in the margin"),
+			GP_LARGE_FILE_IDLE_ONLY);
+		gutter_schedule_update();
+		return;
+	}
+
+	gp_large_file_unregister(geany_plugin);
+
+	if (gutter_update_source)
+	{
+		g_source_remove(gutter_update_source);
+		gutter_update_source = 0;
+	}
+	foreach_document(i)
+	{
+		if (gutter_get_data(documents[i], FALSE) != NULL)
+		{
+			gutter_clear_markers(documents[i]);
+			g_object_set_data(G_OBJECT(documents[i]->editor->sci), GUTTER_DATA_KEY, NULL);
+		}
+	}
+}
+
+
+void
+vc_gutter_cleanup(void)
+{
+	vc_gutter_set_enabled(FALSE);
+
+	if (gutter_job != NULL)
+	{
+		g_source_remove(gutter_poll_source);
+		gutter_poll_source = 0;
+		g_thread_join(gutter_job->thread);
+		gutter_job_free(gutter_job);
+		gutter_job = NULL;
+	}
+	gutter_pending = FALSE;
+}
@@ -0,0 +1,564 @@
+/*
+ *      log.c - Plugin to geany light IDE to work with vc
+ *
+ *      Browser of the log of a file or directory, listed a page at a time.
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* The log_page command of a VC prints one page of the log, newest first, as records
+ * "revision\x1fauthor\x1fdate\x1fsubject\x1e" (or log_records turns its output into those).
+ * P_LOG_LIMIT is replaced with the size of the page. The next page either skips the commits
+ * already listed, P_LOG_SKIP, or starts from the revision number before the last one listed,
+ * P_LOG_FROM, which is log_first for the first page. The details of a commit are only asked
+ * for when it gets selected, with the log_show command and P_LOG_REVISION. */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#ifndef G_OS_WIN32
+#include <sys/types.h>
+#include <signal.h>
+#endif
+
+#include <geanyplugin.h>
+#include "geanyvc.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+extern GeanyPlugin *geany_plugin;
+
+
+#define LOG_PAGE_SIZE  200
+#define LOG_READ_SIZE  65536
+
+
+enum
+{
+	LOG_COLUMN_REVISION,
+	LOG_COLUMN_AUTHOR,
+	LOG_COLUMN_DATE,
+	LOG_COLUMN_SUBJECT,
+	LOG_N_COLUMNS
+};
+
+typedef void (*LogCommandFunc) (const gchar * output, gpointer data);
+
+/* A command run in the background, its output is passed to func once it exited */
+typedef struct
+{
+	GPid pid;
+	guint child_source;
+	GIOChannel *channel;
+	guint channel_source;
+	GString *output;
+	LogCommandFunc func;
+	gpointer data;
+} LogCommand;
+
+/* The log of a file or directory shown in a window */
+typedef struct
+{
+	const VC_RECORD *vc;
+	gchar *filename;
+	gint cmd;		/* VC_COMMAND_LOG_FILE or VC_COMMAND_LOG_DIR, for its directory */
+
+	GtkWidget *window;
+	GtkListStore *store;
+	GtkWidget *tree;
+	GtkTextBuffer *details;
+	GtkWidget *status;
+
+	gint listed;		/* number of commits listed */
+	gchar *from;		/* P_LOG_FROM of the next page */
+	gboolean complete;	/* whether the whole log is listed */
+	LogCommand *page;
+	LogCommand *show;
+} LogBrowser;
+
+
+static GSList *log_browsers = NULL;
+
+
+static void
+log_command_free(LogCommand * command)
+{
+	if (command->channel)
+		g_io_channel_unref(command->channel);
+	g_string_free(command->output, TRUE);
+	g_free(command);
+}
+
+
+static void
+log_command_reap_cb(GPid pid, G_GNUC_UNUSED gint status, G_GNUC_UNUSED gpointer data)
+{
+	g_spawn_close_pid(pid);
+}
+
+
+/* Stops command, its function is not called */
+static void
+log_command_cancel(LogCommand * command)
+{
+	if (command == NULL)
+		return;
+
+	if (command->channel_source)
+		g_source_remove(command->channel_source);
+	if (command->child_source)
+	{
+		g_source_remove(command->child_source);
+#ifndef G_OS_WIN32
+		kill(command->pid, SIGTERM);
+#endif
+		/* the process still needs to be reaped */
+		g_child_watch_add(command->pid, log_command_reap_cb, NULL);
+	}
+	log_command_free(command);
+}
+
+
+static void
+log_command_finish(LogCommand * command)
+{
+	gchar *utf8;
+
+	/* the same conversion as done for the output of the other commands */
+	if (!g_utf8_validate(command->output->str, command->output->len, NULL))
+	{
+		utf8 = encodings_convert_to_utf8(command->output->str, command->output->len, NULL);
+		if (utf8)
+		{
+			g_string_assign(command->output, utf8);
+			g_free(utf8);
+		}
+	}
+
+	command->func(command->output->str, command->data);
+	log_command_free(command);
+}
+
+
+static gboolean
+log_command_read_cb(GIOChannel * channel, GIOCondition cond, gpointer user_data)
+{
+	LogCommand *command = user_data;
+	gchar buf[LOG_READ_SIZE];
+	gsize n = 0;
+	GIOStatus status = G_IO_STATUS_EOF;
+
+	if (cond & (G_IO_IN | G_IO_PRI))
+		status = g_io_channel_read_chars(channel, buf, sizeof(buf), &n, NULL);
+
+	if (n > 0)
+		g_string_append_len(command->output, buf, n);
+	if (status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN)
+		return TRUE;
+
+	command->channel_source = 0;
+	g_io_channel_unref(command->channel);
+	command->channel = NULL;
+	if (command->child_source == 0)
+		log_command_finish(command);
+	return FALSE;
+}
+
+
+static void
+log_command_exited_cb(GPid pid, G_GNUC_UNUSED gint status, gpointer user_data)
+{
+	LogCommand *command = user_data;
+
+	g_spawn_close_pid(pid);
+	command->pid = 0;
+	command->child_source = 0;
+	if (command->channel == NULL)
+		log_command_finish(command);
+}
+
+
+/* Runs argv in dir in the background, replacing the placeholders of the log with the values
+ * given in pairs after data, then NULL */
+static LogCommand *
+log_command_start(const gchar * dir, gchar ** argv, gchar ** env, LogCommandFunc func,
+		  gpointer data, ...)
+{
+	LogCommand *command;
+	GPid pid;
+	gint out_fd;
+	gchar **arg;
+	GError *error = NULL;
+
+	for (arg = argv; *arg != NULL; arg++)
+	{
+		const gchar *pattern;
+		va_list args;
+		GString *repl;
+
+		if (strstr(*arg, "*<?geanyvc") == NULL)
+			continue;
+
+		repl = g_string_new(*arg);
+		va_start(args, data);
+		while ((pattern = va_arg(args, const gchar *)) != NULL)
+			utils_string_replace_all(repl, pattern, va_arg(args, const gchar *));
+		va_end(args);
+		setptr(*arg, g_string_free(repl, FALSE));
+	}
+
+	if (!g_spawn_async_with_pipes(dir, argv, env,
+				      G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+				      G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL,
+				      &pid, NULL, &out_fd, NULL, &error))
+	{
+		g_warning("geanyvc: s_spawn_async error: %s", error->message);
+		ui_set_statusbar(FALSE, _("geanyvc: s_spawn_async error: %s"), error->message);
+		g_error_free(error);
+		return NULL;
+	}
+
+	command = g_new0(LogCommand, 1);
+	command->pid = pid;
+	command->output = g_string_new(NULL);
+	command->func = func;
+	command->data = data;
+	command->child_source = g_child_watch_add(pid, log_command_exited_cb, command);
+#ifdef G_OS_WIN32
+	command->channel = g_io_channel_win32_new_fd(out_fd);
+#else
+	command->channel = g_io_channel_unix_new(out_fd);
+#endif
+	g_io_channel_set_encoding(command->channel, NULL, NULL);
+	g_io_channel_set_buffered(command->channel, FALSE);
+	g_io_channel_set_close_on_unref(command->channel, TRUE);
+	command->channel_source = g_io_add_watch(command->channel,
+						 G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR,
+						 log_command_read_cb, command);
+	return command;
+}
+
+
+static void
+log_browser_update_status(LogBrowser * browser)
+{
+	gchar *text;
+
+	if (browser->page)
+		text = g_strdup_printf(_("%d commits, loading more..."), browser->listed);
+	else if (browser->complete)
+		text = g_strdup_printf(_("%d commits"), browser->listed);
+	else
+		text = g_strdup_printf(_("%d commits, more are listed when scrolling down"),
+				       browser->listed);
+	gtk_label_set_text(GTK_LABEL(browser->status), text);
+	g_free(text);
+}
+
+
+/* Adds the records of output to the list, returns their number */
+static gint
+log_browser_add_records(LogBrowser * browser, const gchar * output)
+{
+	gchar **records = g_strsplit(output, "\x1e", -1);
+	gchar **record;
+	gchar *last = NULL;
+	gint count = 0;
+
+	for (record = records; *record != NULL; record++)
+	{
+		gchar **fields;
+		GtkTreeIter iter;
+
+		g_strstrip(*record);
+		if (**record == '\0')
+			continue;
+
+		fields = g_strsplit(*record, "\x1f", 4);
+		if (g_strv_length(fields) == 4)
+		{
+			gtk_list_store_insert_with_values(browser->store, &iter, -1,
+							  LOG_COLUMN_REVISION, fields[0],
+							  LOG_COLUMN_AUTHOR, fields[1],
+							  LOG_COLUMN_DATE, fields[2],
+							  LOG_COLUMN_SUBJECT, fields[3], -1);
+			setptr(last, g_strdup(fields[0]));
+			count++;
+		}
+		g_strfreev(fields);
+	}
+	g_strfreev(records);
+
+	/* the next page starts before the oldest revision listed */
+	if (last != NULL && browser->from != NULL)
+	{
+		gint from = atoi(last) - 1;
+
+		setptr(browser->from, g_strdup_printf("%d", from));
+		if (from < 0)
+			browser->complete = TRUE;
+	}
+	g_free(last);
+
+	return count;
+}
+
+
+static void log_browser_load_page(LogBrowser * browser);
+
+
+static void
+log_browser_page_cb(const gchar * output, gpointer data)
+{
+	LogBrowser *browser = data;
+	gchar *records = NULL;
+	gint count;
+
+	browser->page = NULL;
+
+	if (browser->vc->log_records)
+		records = browser->vc->log_records(output);
+	count = log_browser_add_records(browser, records ? records : output);
+	g_free(records);
+
+	browser->listed += count;
+	if (count < LOG_PAGE_SIZE)
+		browser->complete = TRUE;
+	log_browser_update_status(browser);
+}
+
+
+static void
+log_browser_load_page(LogBrowser * browser)
+{
+	gchar *dir = NULL;
+	gchar **env = NULL;
+	gchar **argv;
+	gchar *limit, *skip;
+
+	if (browser->complete || browser->page != NULL)
+		return;
+
+	argv = get_vc_command(browser->vc, browser->vc->log_page, browser->cmd, browser->filename,
+			      &dir, &env);
+	if (argv == NULL)
+	{
+		g_free(dir);
+		g_strfreev(env);
+		return;
+	}
+
+	limit = g_strdup_printf("%d", LOG_PAGE_SIZE);
+	skip = g_strdup_printf("%d", browser->listed);
+	browser->page = log_command_start(dir, argv, env, log_browser_page_cb, browser,
+					  P_LOG_LIMIT, limit, P_LOG_SKIP, skip,
+					  P_LOG_FROM, browser->from ? browser->from : "", NULL);
+	/* don't try again on each scroll */
+	if (browser->page == NULL)
+		browser->complete = TRUE;
+	log_browser_update_status(browser);
+
+	g_free(limit);
+	g_free(skip);
+	g_strfreev(argv);
+	g_strfreev(env);
+	g_free(dir);
+}
+
+
+/* Lists the next page once the end of the list is less than a screen away */
+static void
+on_log_scrolled(GtkAdjustment * adjustment, gpointer data)
+{
+	LogBrowser *browser = data;
+	gdouble value = gtk_adjustment_get_value(adjustment);
+	gdouble page_size = gtk_adjustment_get_page_size(adjustment);
+
+	if (value + 2 * page_size >= gtk_adjustment_get_upper(adjustment))
+		log_browser_load_page(browser);
+}
+
+
+static void
+log_browser_show_cb(const gchar * output, gpointer data)
+{
+	LogBrowser *browser = data;
+
+	browser->show = NULL;
+	gtk_text_buffer_set_text(browser->details, output, -1);
+}
+
+
+static void
+on_log_selection_changed(GtkTreeSelection * selection, gpointer data)
+{
+	LogBrowser *browser = data;
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	gchar *revision;
+	gchar *dir = NULL;
+	gchar **env = NULL;
+	gchar **argv;
+
+	log_command_cancel(browser->show);
+	browser->show = NULL;
+
+	if (!gtk_tree_selection_get_selected(selection, &model, &iter))
+	{
+		gtk_text_buffer_set_text(browser->details, "", -1);
+		return;
+	}
+
+	gtk_tree_model_get(model, &iter, LOG_COLUMN_REVISION, &revision, -1);
+	argv = get_vc_command(browser->vc, browser->vc->log_show, browser->cmd, browser->filename,
+			      &dir, &env);
+	if (argv != NULL)
+	{
+		gtk_text_buffer_set_text(browser->details, _("Loading..."), -1);
+		browser->show = log_command_start(dir, argv, env, log_browser_show_cb, browser,
+						  P_LOG_REVISION, revision, NULL);
+		g_strfreev(argv);
+	}
+	g_strfreev(env);
+	g_free(dir);
+	g_free(revision);
+}
+
+
+static void
+on_log_window_destroy(G_GNUC_UNUSED GtkWidget * widget, gpointer data)
+{
+	LogBrowser *browser = data;
+
+	log_command_cancel(browser->page);
+	log_command_cancel(browser->show);
+	log_browsers = g_slist_remove(log_browsers, browser);
+	g_object_unref(browser->store);
+	g_free(browser->filename);
+	g_free(browser->from);
+	g_free(browser);
+}
+
+
+static void
+log_add_column(GtkWidget * tree, const gchar * title, gint column)
+{
+	GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+	GtkTreeViewColumn *col;
+
+	g_object_set(renderer, "ellipsize", PANGO_ELLIPSIZE_END, NULL);
+	col = gtk_tree_view_column_new_with_attributes(title, renderer, "text", column, NULL);
+	gtk_tree_view_column_set_resizable(col, TRUE);
+	gtk_tree_view_append_column(GTK_TREE_VIEW(tree), col);
+}
+
+
+/* Opens a window listing the log of filename, a file or directory according to cmd, and
+ * returns TRUE, or returns FALSE if vc can't list its log a page at a time */
+gboolean
+vc_log_show(const VC_RECORD * vc, const gchar * filename, gint cmd)
+{
+	LogBrowser *browser;
+	GtkWidget *vbox, *paned, *scrolled, *text_view;
+	GtkTreeSelection *selection;
+	PangoFontDescription *font;
+	gchar *title;
+
+	if (vc->log_page == NULL)
+		return FALSE;
+
+	browser = g_new0(LogBrowser, 1);
+	browser->vc = vc;
+	browser->filename = g_strdup(filename);
+	browser->cmd = cmd;
+	browser->from = g_strdup(vc->log_first);
+
+	title = g_strdup_printf(_("VC log of %s"), filename);
+	browser->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_window_set_title(GTK_WINDOW(browser->window), title);
+	gtk_window_set_transient_for(GTK_WINDOW(browser->window),
+				     GTK_WINDOW(geany->main_widgets->window));
+	gtk_window_set_destroy_with_parent(GTK_WINDOW(browser->window), TRUE);
+	gtk_window_set_default_size(GTK_WINDOW(browser->window), 800, 600);
+	g_free(title);
+
+	vbox = gtk_vbox_new(FALSE, 6);
+	gtk_container_set_border_width(GTK_CONTAINER(vbox), 6);
+	gtk_container_add(GTK_CONTAINER(browser->window), vbox);
+
+	paned = gtk_vpaned_new();
+	gtk_box_pack_start(GTK_BOX(vbox), paned, TRUE, TRUE, 0);
+
+	browser->store = gtk_list_store_new(LOG_N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING,
+					    G_TYPE_STRING, G_TYPE_STRING);
+	browser->tree = gtk_tree_view_new_with_model(GTK_TREE_MODEL(browser->store));
+	log_add_column(browser->tree, _("Revision"), LOG_COLUMN_REVISION);
+	log_add_column(browser->tree, _("Author"), LOG_COLUMN_AUTHOR);
+	log_add_column(browser->tree, _("Date"), LOG_COLUMN_DATE);
+	log_add_column(browser->tree, _("Subject"), LOG_COLUMN_SUBJECT);
+
+	scrolled = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled), GTK_POLICY_AUTOMATIC,
+				       GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(scrolled), GTK_SHADOW_IN);
+	gtk_container_add(GTK_CONTAINER(scrolled), browser->tree);
+	gtk_widget_set_size_request(scrolled, -1, 250);
+	gtk_paned_pack1(GTK_PANED(paned), scrolled, TRUE, FALSE);
+	g_signal_connect(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(scrolled)),
+			 "value-changed", G_CALLBACK(on_log_scrolled), browser);
+	g_signal_connect(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(scrolled)),
+			 "changed", G_CALLBACK(on_log_scrolled), browser);
+
+	text_view = gtk_text_view_new();
+	gtk_text_view_set_editable(GTK_TEXT_VIEW(text_view), FALSE);
+	font = pango_font_description_from_string(geany->interface_prefs->editor_font);
+	gtk_widget_modify_font(text_view, font);
+	pango_font_description_free(font);
+	browser->details = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view));
+
+	scrolled = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled), GTK_POLICY_AUTOMATIC,
+				       GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(scrolled), GTK_SHADOW_IN);
+	gtk_container_add(GTK_CONTAINER(scrolled), text_view);
+	gtk_paned_pack2(GTK_PANED(paned), scrolled, TRUE, FALSE);
+
+	browser->status = gtk_label_new(NULL);
+	gtk_misc_set_alignment(GTK_MISC(browser->status), 0, 0.5);
+	gtk_box_pack_start(GTK_BOX(vbox), browser->status, FALSE, FALSE, 0);
+
+	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(browser->tree));
+	g_signal_connect(selection, "changed", G_CALLBACK(on_log_selection_changed), browser);
+	g_signal_connect(browser->window, "destroy", G_CALLBACK(on_log_window_destroy), browser);
+
+	log_browsers = g_slist_prepend(log_browsers, browser);
+	log_browser_load_page(browser);
+	gtk_widget_show_all(browser->window);
+	return TRUE;
+}
+
+
+void
+vc_log_cleanup(void)
+{
+	while (log_browsers != NULL)
+	{
+		LogBrowser *browser = log_browsers->data;
+
+		/* the destroy handler removes it from the list */
+		gtk_widget_destroy(browser->window);
+	}
+}
@@ -0,0 +1,202 @@
+/*
+ *      status.c - Plugin to geany light IDE to work with vc
+ *
+ *      Status of the working copies, published for the other plugins' sidebars.
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <geanyplugin.h>
+#include "geanyvc.h"
+#include "vcstatus.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+extern GeanyPlugin *geany_plugin;
+
+
+/* delay gathering the saves and focus changes into one status run per working copy */
+#define STATUS_REFRESH_DELAY  1000
+
+/* The working copies whose status was asked for: base directory -> VC_RECORD */
+static GHashTable *status_roots = NULL;
+/* Those whose status is to run again, base directory -> VC_RECORD */
+static GHashTable *status_pending = NULL;
+static guint status_timeout = 0;
+static gulong status_focus_handler = 0;
+
+
+static GpVcStatus
+status_from_item(const CommitItem * item)
+{
+	if (item->status == FILE_STATUS_ADDED)
+		return GP_VC_STATUS_ADDED;
+	if (item->status == FILE_STATUS_DELETED)
+		return GP_VC_STATUS_DELETED;
+	if (item->status == FILE_STATUS_UNKNOWN)
+		return GP_VC_STATUS_UNTRACKED;
+	return GP_VC_STATUS_MODIFIED;
+}
+
+static void
+status_publish(const gchar * root, const VC_RECORD * vc)
+{
+	GHashTable *statuses = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	GSList *files, *node;
+	gchar *locale_root;
+
+	if (vc->get_status_files)
+		files = vc->get_status_files(root);
+	else
+		files = vc->get_commit_files(root);
+
+	for (node = files; node != NULL; node = node->next)
+	{
+		CommitItem *item = node->data;
+
+		g_hash_table_insert(statuses, utils_get_locale_from_utf8(item->path),
+				    GINT_TO_POINTER(status_from_item(item)));
+	}
+	free_commit_list(files);
+
+	locale_root = utils_get_locale_from_utf8(root);
+	gp_vc_status_publish(locale_root, statuses);
+	g_free(locale_root);
+	g_hash_table_destroy(statuses);
+}
+
+static gboolean
+on_status_timeout(G_GNUC_UNUSED gpointer data)
+{
+	GHashTable *pending = status_pending;
+	GHashTableIter iter;
+	gpointer root, vc;
+
+	status_timeout = 0;
+	/* a subscriber asking for a status again is scheduled for the next run */
+	status_pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	g_hash_table_iter_init(&iter, pending);
+	while (g_hash_table_iter_next(&iter, &root, &vc))
+		status_publish(root, vc);
+	g_hash_table_destroy(pending);
+
+	return FALSE;
+}
+
+static void
+status_schedule(void)
+{
+	if (status_timeout != 0)
+		g_source_remove(status_timeout);
+	status_timeout = plugin_timeout_add(geany_plugin, STATUS_REFRESH_DELAY, on_status_timeout,
+					    NULL);
+}
+
+/* Schedules the status of the working copy containing filename, in UTF-8, if it is
+ * known already or known is FALSE */
+static void
+status_request(const gchar * filename, gboolean known)
+{
+	const VC_RECORD *vc = find_vc(filename);
+	gchar *root;
+
+	if (vc == NULL)
+		return;
+
+	root = find_base_dir(vc, filename);
+	if (root == NULL)
+		return;
+
+	if (!g_hash_table_lookup(status_roots, root))
+	{
+		if (known)
+		{
+			g_free(root);
+			return;
+		}
+		g_hash_table_insert(status_roots, g_strdup(root), (gpointer) vc);
+	}
+	g_hash_table_replace(status_pending, root, (gpointer) vc);
+	status_schedule();
+}
+
+static void
+on_status_refresh(const gchar * path, G_GNUC_UNUSED gpointer user_data)
+{
+	gchar *utf8_path = utils_get_utf8_from_locale(path);
+
+	status_request(utf8_path, FALSE);
+	g_free(utf8_path);
+}
+
+/* Files may have changed outside while the window was not focused */
+static gboolean
+on_window_focus_in(G_GNUC_UNUSED GtkWidget * widget, G_GNUC_UNUSED GdkEventFocus * event,
+		   G_GNUC_UNUSED gpointer user_data)
+{
+	GHashTableIter iter;
+	gpointer root, vc;
+
+	if (g_hash_table_size(status_roots) == 0)
+		return FALSE;
+
+	g_hash_table_iter_init(&iter, status_roots);
+	while (g_hash_table_iter_next(&iter, &root, &vc))
+		g_hash_table_replace(status_pending, g_strdup(root), vc);
+	status_schedule();
+
+	return FALSE;
+}
+
+/* Only the working copies shown by a sidebar run their status again */
+void
+vc_status_document_saved(GeanyDocument * doc)
+{
+	if (status_roots == NULL || doc == NULL || doc->file_name == NULL)
+		return;
+
+	status_request(doc->file_name, TRUE);
+}
+
+void
+vc_status_init(void)
+{
+	status_roots = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	status_pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	status_focus_handler = g_signal_connect(geany->main_widgets->window, "focus-in-event",
+						G_CALLBACK(on_window_focus_in), NULL);
+	gp_vc_status_set_provider(on_status_refresh, NULL);
+}
+
+void
+vc_status_cleanup(void)
+{
+	if (status_roots == NULL)
+		return;
+
+	gp_vc_status_set_provider(NULL, NULL);
+	if (status_timeout != 0)
+		g_source_remove(status_timeout);
+	status_timeout = 0;
+	g_signal_handler_disconnect(geany->main_widgets->window, status_focus_handler);
+	status_focus_handler = 0;
+	g_hash_table_destroy(status_pending);
+	status_pending = NULL;
+	g_hash_table_destroy(status_roots);
+	status_roots = NULL;
+}
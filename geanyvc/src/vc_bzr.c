@@ -257,4 +257,5 @@ VC_RECORD VC_BZR = {
 	get_base_dir,
 	in_vc_bzr,
 	get_commit_files_bzr,
+	".bzr"
 };
@@ -36,7 +36,7 @@ static const gchar *CVS_CMD_LOG_FILE[] = { "cvs", "log", BASE_FILENAME, NULL };
 static const gchar *CVS_CMD_LOG_DIR[] = { "cvs", "log", NULL };
 static const gchar *CVS_CMD_COMMIT[] = { "cvs", "commit", "-m", MESSAGE, FILE_LIST, NULL };
 static const gchar *CVS_CMD_BLAME[] = { "cvs", "annotate", BASE_FILENAME, NULL };
-static const gchar *CVS_CMD_SHOW[] = { "cvs", NULL };
+static const gchar *CVS_CMD_SHOW[] = { "cvs", "-Q", "update", "-p", "-r", "BASE", BASENAME, NULL };
 static const gchar *CVS_CMD_UPDATE[] = { "cvs", "up", "-d", NULL };
 
 static const VC_COMMAND commands[] = {
@@ -246,4 +246,5 @@ VC_RECORD VC_CVS = {
 	get_base_dir,
 	in_vc_cvs,
 	get_commit_files_cvs,
+	"CVS"
 };
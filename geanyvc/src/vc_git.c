@@ -20,63 +20,103 @@
  */
 
 #include <string.h>
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
 #include <geanyplugin.h>
+
+#ifdef HAVE_LIBGIT2
+#include <git2.h>
+#endif
+
 #include "geanyvc.h"
 
 extern GeanyData *geany_data;
 
+/* how many status commands run at once across the submodules and nested checkouts */
+#define GIT_STATUS_JOBS 4
+
 static gchar *
 get_base_dir(const gchar * path)
 {
 	return find_subdir_path(path, ".git");
 }
 
+/* Returns the repository path is in, base_dir or a submodule or checkout nested in it */
+static gchar *
+git_find_repository(const gchar * base_dir, const gchar * path)
+{
+	gchar *dir = g_path_get_dirname(path);
+	gchar *dotgit;
+	gboolean found;
+
+	while (strlen(dir) > strlen(base_dir))
+	{
+		dotgit = g_build_filename(dir, ".git", NULL);
+		found = g_file_test(dotgit, G_FILE_TEST_EXISTS);
+		g_free(dotgit);
+		if (found)
+			return dir;
+		setptr(dir, g_path_get_dirname(dir));
+	}
+	g_free(dir);
+	return g_strdup(base_dir);
+}
+
+static gint
+compare_length_desc(gconstpointer a, gconstpointer b)
+{
+	return (gint) strlen(b) - (gint) strlen(a);
+}
+
+/* The files of the commit dialog may be in submodules and nested checkouts, each of their
+ * repositories commits its files, the innermost first */
 static gint
 git_commit(G_GNUC_UNUSED gchar ** std_out, G_GNUC_UNUSED gchar ** std_err, const gchar * filename,
 	   GSList * list, const gchar * message)
 {
 	gchar *base_dir = get_base_dir(filename);
-	gint len = strlen(base_dir);
-	GSList *commit = NULL;
+	GHashTable *repos;
+	GList *dirs, *node;
 	GSList *tmp = NULL;
 	const gchar *argv[] = { "git", "commit", "-m", MESSAGE, "--", FILE_LIST, NULL };
-	gint ret;
+	gint ret = 0;
 
 	g_return_val_if_fail(base_dir, -1);
 
+	/* repository -> its files, relative to it */
+	repos = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 	for (tmp = list; tmp != NULL; tmp = g_slist_next(tmp))
 	{
-		commit = g_slist_prepend(commit, (gchar *) tmp->data + len + 1);
+		gchar *repo = git_find_repository(base_dir, tmp->data);
+		GSList *commit = g_hash_table_lookup(repos, repo);
+
+		commit = g_slist_prepend(commit, (gchar *) tmp->data + strlen(repo) + 1);
+		g_hash_table_insert(repos, repo, commit);
+	}
+
+	dirs = g_list_sort(g_hash_table_get_keys(repos), compare_length_desc);
+	for (node = dirs; node != NULL; node = node->next)
+	{
+		GSList *commit = g_hash_table_lookup(repos, node->data);
+		gint status;
+
+		status = execute_custom_command(node->data, argv, NULL, NULL, NULL, node->data,
+						commit, message);
+		if (status != 0)
+			ret = status;
+		g_slist_free(commit);
 	}
 
-	ret = execute_custom_command(base_dir, argv, NULL, NULL, NULL, base_dir, commit, message);
-	g_slist_free(commit);
+	g_list_free(dirs);
+	g_hash_table_destroy(repos);
 	g_free(base_dir);
 	return ret;
 }
 
 static const gchar *GIT_ENV_SHOW[] = { "PAGER=cat", NULL };
 
-static gint
-git_show(gchar ** std_out, gchar ** std_err, const gchar * filename,
-	 GSList * list, const gchar * message)
-{
-	gchar *base_dir = get_base_dir(filename);
-	gint len = strlen(base_dir);
-	const gchar *argv[] = { "git", "show", NULL, NULL };
-	gint ret;
-
-	g_return_val_if_fail(base_dir, -1);
-
-	argv[2] = g_strdup_printf("HEAD:%s", filename + len + 1);
-
-	ret = execute_custom_command(base_dir, argv, GIT_ENV_SHOW, std_out, std_err, base_dir, list,
-				     message);
-	g_free(base_dir);
-	g_free((gchar *) argv[2]);
-	return ret;
-}
-
 
 
 static const gchar *GIT_CMD_DIFF_FILE[] = { "git", "diff", "HEAD", "--", BASENAME, NULL };
@@ -95,8 +135,16 @@ static const gchar *GIT_CMD_REMOVE[] =
 };
 static const gchar *GIT_CMD_LOG_FILE[] = { "git", "log", "--", BASENAME, NULL };
 static const gchar *GIT_CMD_LOG_DIR[] = { "git", "log", NULL };
+static const gchar *GIT_CMD_SHOW[] = { "git", "show", "HEAD:./" P_BASENAME, NULL };
 static const gchar *GIT_CMD_BLAME[] = { "git", "blame", "--", BASENAME, NULL };
+static const gchar *GIT_CMD_BLAME_LINES[] = { "git", "blame", "--porcelain", "--", BASENAME, NULL };
+static const gchar *GIT_CMD_HEAD_REVISION[] = { "git", "rev-parse", "HEAD", NULL };
 static const gchar *GIT_CMD_UPDATE[] = { "git", "pull", NULL };
+static const gchar *GIT_CMD_LOG_PAGE[] = { "git", "log", "--format=%h%x1f%an%x1f%ad%x1f%s%x1e",
+	"--date=short", "--skip=" P_LOG_SKIP, "-n", P_LOG_LIMIT, "--", ABS_FILENAME, NULL
+};
+static const gchar *GIT_CMD_LOG_SHOW[] =
+	{ "git", "show", "--stat", "--format=fuller", P_LOG_REVISION, NULL };
 
 static const gchar *GIT_ENV_DIFF_FILE[] = { "PAGER=cat", NULL };
 static const gchar *GIT_ENV_DIFF_DIR[] = { "PAGER=cat", NULL };
@@ -110,12 +158,305 @@ static const gchar *GIT_ENV_LOG_DIR[] = { "PAGER=cat", NULL };
 static const gchar *GIT_ENV_BLAME[] = { "PAGER=cat", NULL };
 static const gchar *GIT_ENV_UPDATE[] = { "PAGER=cat", NULL };
 
+#ifdef HAVE_LIBGIT2
+/* The read-only operations which run often (the menu, the commit dialog, the gutter) read
+ * the repository in-process; git is only run when libgit2 fails, e.g. on a repository
+ * format it doesn't support. Blame, the log and the directory diff still run git, in the
+ * background. */
+
+static void
+git2_init(void)
+{
+	static volatile gsize initialized = 0;
+
+	if (g_once_init_enter(&initialized))
+	{
+		git_libgit2_init();
+		g_once_init_leave(&initialized, 1);
+	}
+}
+
+/* Whether libgit2 can be used from the worker threads, it may be built without locking */
+static gboolean
+git2_threads_supported(void)
+{
+	git2_init();
+	return (git_libgit2_features() & GIT_FEATURE_THREADS) != 0;
+}
+
+static git_repository *
+git2_open(const gchar * path)
+{
+	git_repository *repo = NULL;
+	gchar *dir;
+
+	git2_init();
+
+	if (g_file_test(path, G_FILE_TEST_IS_DIR))
+		dir = g_strdup(path);
+	else
+		dir = g_path_get_dirname(path);
+	if (git_repository_open_ext(&repo, dir, 0, NULL) == 0 && git_repository_is_bare(repo))
+	{
+		git_repository_free(repo);
+		repo = NULL;
+	}
+	g_free(dir);
+	return repo;
+}
+
+/* Returns the path of filename in the work tree of repo, NULL if it is outside of it */
+static gchar *
+git2_relative_path(git_repository * repo, const gchar * filename)
+{
+	const gchar *workdir = git_repository_workdir(repo);
+	gchar *path = g_strdup(filename);
+	gchar *ret = NULL;
+	gsize len = strlen(workdir);
+
+#ifdef G_OS_WIN32
+	g_strdelimit(path, "\\", '/');
+	if (g_ascii_strncasecmp(path, workdir, len) == 0)
+#else
+	if (strncmp(path, workdir, len) == 0)
+#endif
+		ret = g_strdup(path + len);
+	g_free(path);
+	return ret;
+}
+
+/* Like "git ls-files": TRUE if filename is in the index, -1 if it can't tell */
+static gint
+git2_in_vc(const gchar * filename)
+{
+	git_repository *repo = git2_open(filename);
+	git_index *index;
+	gchar *path;
+	gsize pos;
+	gint ret = -1;
+
+	if (repo == NULL)
+		return -1;
+
+	path = git2_relative_path(repo, filename);
+	if (path != NULL && git_repository_index(&index, repo) == 0)
+	{
+		ret = git_index_find(&pos, index, path) == 0;
+		git_index_free(index);
+	}
+	g_free(path);
+	git_repository_free(repo);
+	return ret;
+}
+
+/* Like parse_git_status() on the output of "git status", FALSE if it can't tell */
+static gboolean
+git2_status_files(const gchar * base_dir, gboolean untracked, GSList ** files)
+{
+	git_repository *repo = git2_open(base_dir);
+	git_status_options opts = GIT_STATUS_OPTIONS_INIT;
+	git_status_list *list;
+	GSList *ret = NULL;
+	gsize i, count;
+
+	if (repo == NULL)
+		return FALSE;
+
+	opts.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+	opts.flags = GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX;
+	if (untracked)
+		opts.flags |= GIT_STATUS_OPT_INCLUDE_UNTRACKED;
+	if (git_status_list_new(&list, repo, &opts) != 0)
+	{
+		git_repository_free(repo);
+		return FALSE;
+	}
+
+	count = git_status_list_entrycount(list);
+	for (i = 0; i < count; i++)
+	{
+		const git_status_entry *entry = git_status_byindex(list, i);
+		const git_diff_delta *delta;
+		const gchar *status = NULL;
+		CommitItem *item;
+
+		if (entry->status & (GIT_STATUS_INDEX_DELETED | GIT_STATUS_WT_DELETED))
+			status = FILE_STATUS_DELETED;
+		else if (entry->status & (GIT_STATUS_INDEX_NEW | GIT_STATUS_INDEX_RENAMED))
+			status = FILE_STATUS_ADDED;
+		else if (entry->status & (GIT_STATUS_INDEX_MODIFIED | GIT_STATUS_WT_MODIFIED))
+			status = FILE_STATUS_MODIFIED;
+		else if (entry->status & GIT_STATUS_WT_NEW)
+			status = FILE_STATUS_UNKNOWN;
+		if (status == NULL)
+			continue;
+
+		/* the new path of renamed entries */
+		delta = entry->head_to_index ? entry->head_to_index : entry->index_to_workdir;
+		item = g_new(CommitItem, 1);
+		item->status = status;
+		item->path = g_build_filename(base_dir, delta->new_file.path, NULL);
+		ret = g_slist_prepend(ret, item);
+	}
+
+	git_status_list_free(list);
+	git_repository_free(repo);
+	*files = g_slist_reverse(ret);
+	return TRUE;
+}
+
+static gchar *
+git2_head_revision(const gchar * path)
+{
+	git_repository *repo = git2_open(path);
+	gchar buf[GIT_OID_HEXSZ + 1];
+	git_oid oid;
+	gchar *ret = NULL;
+
+	if (repo == NULL)
+		return NULL;
+
+	if (git_reference_name_to_id(&oid, repo, "HEAD") == 0)
+		ret = g_strdup(git_oid_tostr(buf, sizeof buf, &oid));
+	git_repository_free(repo);
+	return ret;
+}
+
+/* Like "git show HEAD:./file": 0 and the content of filename in HEAD, 1 if it is not in
+ * HEAD, -1 if it can't tell */
+static gint
+git2_show(const gchar * filename, gchar ** std_out)
+{
+	git_repository *repo = git2_open(filename);
+	git_object *tree = NULL;
+	git_tree_entry *entry = NULL;
+	git_blob *blob = NULL;
+	gchar *path;
+	gint err;
+	gint ret = -1;
+
+	if (repo == NULL)
+		return -1;
+
+	path = git2_relative_path(repo, filename);
+	err = path ? git_revparse_single(&tree, repo, "HEAD^{tree}") : -1;
+	if (err == 0)
+		err = git_tree_entry_bypath(&entry, (git_tree *) tree, path);
+	if (err == GIT_ENOTFOUND || err == GIT_EUNBORNBRANCH ||
+	    (err == 0 && git_tree_entry_type(entry) != GIT_OBJ_BLOB))
+	{
+		ret = 1;
+	}
+	else if (err == 0 && git_blob_lookup(&blob, repo, git_tree_entry_id(entry)) == 0)
+	{
+		*std_out = g_strndup(git_blob_rawcontent(blob), git_blob_rawsize(blob));
+		normalize_command_output(std_out);
+		ret = 0;
+	}
+
+	git_blob_free(blob);
+	git_tree_entry_free(entry);
+	git_object_free(tree);
+	g_free(path);
+	git_repository_free(repo);
+	return ret;
+}
+
+static gint
+git2_diff_line(G_GNUC_UNUSED const git_diff_delta * delta, G_GNUC_UNUSED const git_diff_hunk * hunk,
+	       const git_diff_line * line, gpointer data)
+{
+	GString *out = data;
+
+	if (line->origin == GIT_DIFF_LINE_CONTEXT || line->origin == GIT_DIFF_LINE_ADDITION ||
+	    line->origin == GIT_DIFF_LINE_DELETION)
+		g_string_append_c(out, line->origin);
+	g_string_append_len(out, line->content, line->content_len);
+	return 0;
+}
+
+/* Like "git diff HEAD -- file", FALSE if it can't tell */
+static gboolean
+git2_diff_file(const gchar * filename, gchar ** std_out)
+{
+	git_repository *repo = git2_open(filename);
+	git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+	git_object *tree = NULL;
+	git_diff *diff = NULL;
+	GString *out;
+	gchar *path;
+	gboolean ret = FALSE;
+
+	if (repo == NULL)
+		return FALSE;
+
+	path = git2_relative_path(repo, filename);
+	if (path != NULL && git_revparse_single(&tree, repo, "HEAD^{tree}") == 0)
+	{
+		opts.flags = GIT_DIFF_DISABLE_PATHSPEC_MATCH;
+		opts.pathspec.strings = &path;
+		opts.pathspec.count = 1;
+		if (git_diff_tree_to_workdir_with_index(&diff, repo, (git_tree *) tree, &opts) == 0)
+		{
+			out = g_string_new(NULL);
+			ret = git_diff_print(diff, GIT_DIFF_FORMAT_PATCH, git2_diff_line, out) == 0;
+			*std_out = g_string_free(out, !ret);
+			normalize_command_output(std_out);
+			git_diff_free(diff);
+		}
+	}
+
+	git_object_free(tree);
+	g_free(path);
+	git_repository_free(repo);
+	return ret;
+}
+
+static gint
+git_diff_file(gchar ** std_out, gchar ** std_err, const gchar * filename,
+	      G_GNUC_UNUSED GSList * list, G_GNUC_UNUSED const gchar * message)
+{
+	gchar *dir;
+	gint ret;
+
+	if (std_out != NULL && git2_diff_file(filename, std_out))
+		return 0;
+
+	dir = g_path_get_dirname(filename);
+	ret = execute_custom_command(dir, GIT_CMD_DIFF_FILE, GIT_ENV_DIFF_FILE, std_out, std_err,
+				     filename, NULL, NULL);
+	g_free(dir);
+	return ret;
+}
+
+static gint
+git_show(gchar ** std_out, gchar ** std_err, const gchar * filename,
+	 G_GNUC_UNUSED GSList * list, G_GNUC_UNUSED const gchar * message)
+{
+	gchar *dir;
+	gint ret;
+
+	if (std_out != NULL && (ret = git2_show(filename, std_out)) >= 0)
+		return ret;
+
+	dir = g_path_get_dirname(filename);
+	ret = execute_custom_command(dir, GIT_CMD_SHOW, GIT_ENV_SHOW, std_out, std_err,
+				     filename, NULL, NULL);
+	g_free(dir);
+	return ret;
+}
+#endif
+
 static const VC_COMMAND commands[VC_COMMAND_COUNT] = {
 	{
 		VC_COMMAND_STARTDIR_FILE,
 		GIT_CMD_DIFF_FILE,
 		GIT_ENV_DIFF_FILE,
+#ifdef HAVE_LIBGIT2
+		git_diff_file},
+#else
 		NULL},
+#endif
 	{
 		VC_COMMAND_STARTDIR_FILE,
 		GIT_CMD_DIFF_DIR,
@@ -168,9 +509,13 @@ static const VC_COMMAND commands[VC_COMMAND_COUNT] = {
 		NULL},
 	{
 		VC_COMMAND_STARTDIR_FILE,
-		NULL,
+		GIT_CMD_SHOW,
 		GIT_ENV_SHOW,
+#ifdef HAVE_LIBGIT2
 		git_show},
+#else
+		NULL},
+#endif
 	{
 		VC_COMMAND_STARTDIR_BASE,
 		GIT_CMD_UPDATE,
@@ -193,6 +538,15 @@ in_vc_git(const gchar * filename)
 	if (g_file_test(filename, G_FILE_TEST_IS_DIR))
 		return TRUE;
 
+#ifdef HAVE_LIBGIT2
+	{
+		gint found = git2_in_vc(filename);
+
+		if (found >= 0)
+			return found;
+	}
+#endif
+
 	dir = g_path_get_dirname(filename);
 	base_name = g_path_get_basename(filename);
 	argv[3] = base_name;
@@ -211,66 +565,275 @@ in_vc_git(const gchar * filename)
 	return ret;
 }
 
+/* Parses the output of "git status --porcelain -z": entries of two status letters, the
+ * index and the work tree one, a space and the path. Renamed and copied entries are
+ * followed by the original path. Untracked entries, "??", are only listed if untracked. */
 static GSList *
-parse_git_status(GSList * lst, const gchar * base_dir, const gchar * txt, const gchar * s_out,
-		 const gchar * status)
+parse_git_status(const gchar * base_dir, const gchar * txt, gsize len, gboolean untracked)
 {
-	gchar *start, *end;
-	gchar *base_name;
-	gchar *filename;
+	const gchar *p = txt;
+	const gchar *end = txt + len;
+	GSList *ret = NULL;
 	CommitItem *item;
 
-	start = strstr(txt, s_out);
-	while (start)
+	while (p + 3 < end)
 	{
-		start += strlen(s_out);
-		while (*start == ' ' || *start == '\t')
+		const gchar *path = p + 3;
+		const gchar *status = NULL;
+		gchar x = p[0];
+		gchar y = p[1];
+
+		if (x == 'D' || y == 'D')
+			status = FILE_STATUS_DELETED;
+		else if (x == 'A' || x == 'R' || x == 'C')
+			status = FILE_STATUS_ADDED;
+		else if (x == 'M' || y == 'M')
+			status = FILE_STATUS_MODIFIED;
+		else if (x == '?' && untracked)
+			status = FILE_STATUS_UNKNOWN;
+
+		if (status)
 		{
-			start++;
+			item = g_new(CommitItem, 1);
+			item->status = status;
+			item->path = g_build_filename(base_dir, path, NULL);
+			ret = g_slist_prepend(ret, item);
 		}
-		g_return_val_if_fail(*start, NULL);
 
-		end = strchr(start, '\n');
-		g_return_val_if_fail(start, NULL);
+		p = path + strlen(path) + 1;
+		/* skip the original path */
+		if ((x == 'R' || x == 'C') && p < end)
+			p += strlen(p) + 1;
+	}
+	return g_slist_reverse(ret);
+}
 
-		base_name = g_malloc0(end - start + 1);
-		memcpy(base_name, start, end - start);
-		filename = g_build_filename(base_dir, base_name, NULL);
-		g_free(base_name);
+/* The status of one repository, with the untracked files; runs in a worker thread, where
+ * libgit2 is only used if use_libgit2 is set */
+static GSList *
+git_status_repository(const gchar * base_dir, G_GNUC_UNUSED gboolean use_libgit2)
+{
+	const gchar *argv[] = { "git", "status", "--porcelain", "-z", NULL };
+	const gchar *env[] = { "PAGER=cat", NULL };
+	gchar *std_out = NULL;
+	GSList *ret = NULL;
+	gint exit_code;
 
-		item = g_new(CommitItem, 1);
-		item->status = status;
-		item->path = filename;
+#ifdef HAVE_LIBGIT2
+	if (use_libgit2 && git2_status_files(base_dir, TRUE, &ret))
+		return ret;
+#endif
+
+	/* not through execute_custom_command(), its text conversion stops at the NUL separators */
+	if (g_spawn_sync(base_dir, (gchar **) argv, (gchar **) env,
+			 G_SPAWN_SEARCH_PATH | G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL,
+			 &std_out, NULL, &exit_code, NULL) && !EMPTY(std_out))
+	{
+		/* the output length is not returned, but all entries end with a NUL separator
+		 * and the output with a terminating NUL */
+		const gchar *end = std_out;
+
+		while (*end)
+			end += strlen(end) + 1;
+		ret = parse_git_status(base_dir, std_out, end - std_out, TRUE);
+	}
+
+	g_free(std_out);
+	return ret;
+}
+
+typedef struct
+{
+	const gchar *base_dir;
+	gboolean use_libgit2;
+	GSList *files;
+} GitStatusJob;
+
+static void
+git_status_job_run(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+	GitStatusJob *job = data;
+
+	job->files = git_status_repository(job->base_dir, job->use_libgit2);
+}
+
+/* Runs the status of the count repositories of dirs, at most GIT_STATUS_JOBS at once, and
+ * returns their files in the same order */
+static GitStatusJob *
+git_status_collect(gchar ** dirs, guint count)
+{
+	GitStatusJob *jobs = g_new0(GitStatusJob, count);
+	GThreadPool *pool = NULL;
+	gboolean use_libgit2 = TRUE;
+	guint i;
+
+	if (count > 1)
+	{
+#ifdef HAVE_LIBGIT2
+		/* otherwise the workers run git */
+		use_libgit2 = git2_threads_supported();
+#endif
+		pool = g_thread_pool_new(git_status_job_run, NULL, MIN(count, GIT_STATUS_JOBS),
+					 FALSE, NULL);
+	}
+	for (i = 0; i < count; i++)
+	{
+		jobs[i].base_dir = dirs[i];
+		jobs[i].use_libgit2 = use_libgit2;
+		if (pool != NULL)
+			g_thread_pool_push(pool, &jobs[i], NULL);
+		else
+			git_status_job_run(&jobs[i], NULL);
+	}
+	/* waits for all of them */
+	if (pool != NULL)
+		g_thread_pool_free(pool, FALSE, TRUE);
+	return jobs;
+}
+
+static gboolean
+git_is_repository(const gchar * dir)
+{
+	gchar *dotgit = g_build_filename(dir, ".git", NULL);
+	/* a file in submodules and linked work trees */
+	gboolean ret = g_file_test(dotgit, G_FILE_TEST_EXISTS);
+
+	g_free(dotgit);
+	return ret;
+}
+
+/* Appends the initialized submodules of the repository base_dir to roots, recursively */
+static void
+git_find_submodules(const gchar * base_dir, GPtrArray * roots)
+{
+	gchar *filename = g_build_filename(base_dir, ".gitmodules", NULL);
+	gchar *contents = NULL;
+	gchar **lines;
+	guint i;
 
-		lst = g_slist_append(lst, item);
-		start = strstr(start, s_out);
+	if (g_file_get_contents(filename, &contents, NULL, NULL))
+	{
+		lines = g_strsplit(contents, "\n", -1);
+		for (i = 0; lines[i] != NULL; i++)
+		{
+			gchar *line = g_strstrip(lines[i]);
+			gchar *path;
+
+			if (!g_str_has_prefix(line, "path"))
+				continue;
+			line = g_strchug(line + strlen("path"));
+			if (*line != '=')
+				continue;
+
+			path = g_build_filename(base_dir, g_strchug(line + 1), NULL);
+			if (git_is_repository(path))
+			{
+				g_ptr_array_add(roots, path);
+				git_find_submodules(path, roots);
+			}
+			else
+				g_free(path);
+		}
+		g_strfreev(lines);
 	}
-	return lst;
+	g_free(contents);
+	g_free(filename);
 }
 
+static gboolean
+git_has_root(GPtrArray * roots, const gchar * dir)
+{
+	guint i;
+
+	for (i = 0; i < roots->len; i++)
+	{
+		if (strcmp(g_ptr_array_index(roots, i), dir) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* The files of the working copy of file, with those of its submodules and of the checkouts
+ * nested in it, whose status runs in parallel */
 static GSList *
-get_commit_files_git(const gchar * file)
+git_status_files(const gchar * file, gboolean untracked)
 {
-	const gchar *argv[] = { "git", "status", NULL };
-	const gchar *env[] = { "PAGES=cat", NULL };
-	gchar *std_out = NULL;
 	gchar *base_dir = find_subdir_path(file, ".git");
+	GPtrArray *roots;
 	GSList *ret = NULL;
+	guint done = 0;
+	guint i;
 
 	g_return_val_if_fail(base_dir, NULL);
 
-	execute_custom_command(base_dir, (const gchar **) argv, (const gchar **) env,
-			       &std_out, NULL, base_dir, NULL, NULL);
-	g_return_val_if_fail(std_out, NULL);
+#ifdef HAVE_LIBGIT2
+	/* before the worker threads use it */
+	git2_init();
+#endif
 
-	ret = parse_git_status(ret, base_dir, std_out, "modified:", FILE_STATUS_MODIFIED);
-	ret = parse_git_status(ret, base_dir, std_out, "deleted:", FILE_STATUS_DELETED);
-	ret = parse_git_status(ret, base_dir, std_out, "new file:", FILE_STATUS_ADDED);
+	roots = g_ptr_array_new();
+	g_ptr_array_add(roots, base_dir);
+	git_find_submodules(base_dir, roots);
 
-	g_free(std_out);
-	g_free(base_dir);
+	/* the nested checkouts show up as untracked directories, their status runs next */
+	while (done < roots->len)
+	{
+		guint count = roots->len - done;
+		GitStatusJob *jobs = git_status_collect((gchar **) roots->pdata + done, count);
 
-	return ret;
+		for (i = 0; i < count; i++)
+		{
+			GSList *node;
+
+			for (node = jobs[i].files; node != NULL; node = node->next)
+			{
+				CommitItem *item = node->data;
+
+				if (item->status == FILE_STATUS_UNKNOWN &&
+				    (g_str_has_suffix(item->path, "/") ||
+				     g_str_has_suffix(item->path, G_DIR_SEPARATOR_S)))
+				{
+					gchar *dir = g_path_get_dirname(item->path);
+
+					if (git_is_repository(dir) && !git_has_root(roots, dir))
+					{
+						g_ptr_array_add(roots, dir);
+						dir = NULL;
+						item->status = NULL;
+					}
+					g_free(dir);
+				}
+				if (item->status == NULL ||
+				    (item->status == FILE_STATUS_UNKNOWN && !untracked))
+				{
+					g_free(item->path);
+					g_free(item);
+				}
+				else
+					ret = g_slist_prepend(ret, item);
+			}
+			g_slist_free(jobs[i].files);
+		}
+		g_free(jobs);
+		done += count;
+	}
+
+	g_ptr_array_foreach(roots, (GFunc) g_free, NULL);
+	g_ptr_array_free(roots, TRUE);
+
+	return g_slist_reverse(ret);
+}
+
+static GSList *
+get_commit_files_git(const gchar * file)
+{
+	return git_status_files(file, FALSE);
+}
+
+static GSList *
+get_status_files_git(const gchar * file)
+{
+	return git_status_files(file, TRUE);
 }
 
 VC_RECORD VC_GIT = {
@@ -279,4 +842,17 @@ VC_RECORD VC_GIT = {
 	get_base_dir,
 	in_vc_git,
 	get_commit_files_git,
+	".git",
+	GIT_CMD_BLAME_LINES,
+	GIT_CMD_HEAD_REVISION,
+	GIT_CMD_LOG_PAGE,
+	NULL,
+	NULL,
+	GIT_CMD_LOG_SHOW,
+	get_status_files_git,
+#ifdef HAVE_LIBGIT2
+	git2_head_revision
+#else
+	NULL
+#endif
 };
@@ -39,6 +39,11 @@ static const gchar *HG_CMD_COMMIT[] = { "hg", "commit", "-m", MESSAGE, FILE_LIST
 static const gchar *HG_CMD_BLAME[] = { "hg", "annotate", BASENAME, NULL };
 static const gchar *HG_CMD_SHOW[] = { "hg", "cat", BASENAME, NULL };
 static const gchar *HG_CMD_UPDATE[] = { "hg", "pull", CMD_SEPARATOR, "hg", "update", NULL };
+static const gchar *HG_CMD_LOG_PAGE[] = { "hg", "log", "--template",
+	"{rev}\x1f{author|person}\x1f{date|shortdate}\x1f{desc|firstline}\x1e",
+	"-l", P_LOG_LIMIT, "-r", P_LOG_FROM ":0", ABS_FILENAME, NULL
+};
+static const gchar *HG_CMD_LOG_SHOW[] = { "hg", "log", "-v", "--stat", "-r", P_LOG_REVISION, NULL };
 
 static const VC_COMMAND commands[] = {
 	{
@@ -240,4 +245,11 @@ VC_RECORD VC_HG = {
 	get_base_dir,
 	in_vc_hg,
 	get_commit_files_hg,
+	".hg",
+	NULL,
+	NULL,
+	HG_CMD_LOG_PAGE,
+	".",
+	NULL,
+	HG_CMD_LOG_SHOW
 };
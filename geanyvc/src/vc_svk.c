@@ -257,4 +257,5 @@ VC_RECORD VC_SVK = {
 	get_base_dir,
 	in_vc_svk,
 	get_commit_files_svk,
+	NULL
 };
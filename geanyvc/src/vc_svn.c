@@ -41,6 +41,10 @@ static const gchar *SVN_CMD_COMMIT[] =
 static const gchar *SVN_CMD_BLAME[] = { "svn", "blame", BASENAME, NULL };
 static const gchar *SVN_CMD_SHOW[] = { "svn", "cat", "-rBASE", BASENAME, NULL };
 static const gchar *SVN_CMD_UPDATE[] = { "svn", "up", NULL };
+static const gchar *SVN_CMD_LOG_PAGE[] =
+	{ "svn", "log", "--limit", P_LOG_LIMIT, "-r", P_LOG_FROM ":0", ABS_FILENAME, NULL };
+static const gchar *SVN_CMD_LOG_SHOW[] =
+	{ "svn", "log", "-v", "-r", P_LOG_REVISION, ABS_FILENAME, NULL };
 
 static const VC_COMMAND commands[] = {
 	{
@@ -296,10 +300,75 @@ get_commit_files_svn(const gchar * dir)
 	return ret;
 }
 
+/* Turns the entries of "svn log", a header "r12 | author | date (day) | 3 lines", an empty line
+ * and the message, between lines of dashes, into the records of the log browser */
+static gchar *
+log_records_svn(const gchar * output)
+{
+	enum
+	{ HEADER, BLANK, SUBJECT, MESSAGE } state = HEADER;
+	GString *records = g_string_new(NULL);
+	gchar **lines = g_strsplit(output, "\n", -1);
+	gchar **line;
+
+	for (line = lines; *line != NULL; line++)
+	{
+		gchar **header;
+
+		g_strchomp(*line);
+		if (g_str_has_prefix(*line, "------------------------------------"))
+		{
+			/* a record without a message gets an empty subject */
+			if (state == BLANK || state == SUBJECT)
+				g_string_append_c(records, '\x1e');
+			state = HEADER;
+			continue;
+		}
+		switch (state)
+		{
+			case HEADER:
+				header = g_strsplit(*line, " | ", 4);
+				if (**line == 'r' && g_strv_length(header) >= 3)
+				{
+					/* the date without its time and the day in words */
+					if (strlen(header[2]) > 10)
+						header[2][10] = '\0';
+					g_string_append_printf(records, "%s\x1f%s\x1f%s\x1f",
+							       header[0] + 1, header[1], header[2]);
+					state = BLANK;
+				}
+				g_strfreev(header);
+				break;
+			case BLANK:
+				state = SUBJECT;
+				break;
+			case SUBJECT:
+				g_string_append(records, *line);
+				g_string_append_c(records, '\x1e');
+				state = MESSAGE;
+				break;
+			case MESSAGE:
+				break;
+		}
+	}
+	if (state == BLANK || state == SUBJECT)
+		g_string_append_c(records, '\x1e');
+	g_strfreev(lines);
+
+	return g_string_free(records, FALSE);
+}
+
 VC_RECORD VC_SVN = {
 	commands,
 	"svn",
 	get_base_dir,
 	in_vc_svn,
 	get_commit_files_svn,
+	".svn",
+	NULL,
+	NULL,
+	SVN_CMD_LOG_PAGE,
+	"BASE",
+	log_records_svn,
+	SVN_CMD_LOG_SHOW
 };
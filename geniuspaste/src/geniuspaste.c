@@ -96,6 +96,26 @@ static gchar *author_name = NULL;
 static gint website_selected;
 static gboolean check_button_is_checked = FALSE;
 
+/* the encoded text is sent by chunks of at most this size */
+#define PASTE_CHUNK_SIZE 65536
+
+typedef struct
+{
+    SoupMessage *msg;
+    gint website;
+    gchar *f_type;
+    gchar *text;        /* snapshot of the pasted text, until all of it is encoded */
+    gsize text_len;
+    gsize text_pos;     /* how much of the text is already encoded */
+    goffset body_len;
+    goffset body_sent;
+    GQueue chunk_lengths;   /* lengths of the chunks not written yet */
+    gint percent;
+} PasteJob;
+
+static SoupSession *session = NULL;
+static PasteJob *current_job = NULL;
+
 PLUGIN_VERSION_CHECK(147)
 PLUGIN_SET_TRANSLATABLE_INFO(LOCALEDIR, GETTEXT_PACKAGE, PLUGIN_NAME,
                              _("Paste your code on your favorite pastebin"),
@@ -150,40 +170,230 @@ static void save_settings(void)
     g_key_file_free(config);
 }
 
-static gchar *get_paste_text(GeanyDocument *doc, gsize *text_len)
+static gchar *get_paste_text(GeanyDocument *doc)
 {
-    gsize len;
-    gchar *paste_text;
-
     if (sci_has_selection(doc->editor->sci))
+        return sci_get_selection_contents(doc->editor->sci);
+    else
+        return sci_get_contents(doc->editor->sci, sci_get_length(doc->editor->sci) + 1);
+}
+
+/* same escaping as soup_form_encode() */
+static gboolean is_form_safe_char(guchar c)
+{
+    return g_ascii_isalnum(c) || c == '-' || c == '_' || c == '.';
+}
+
+static gsize get_form_encoded_length(const gchar *text, gsize len)
+{
+    gsize i, encoded_len = 0;
+
+    for (i = 0; i < len; i++)
+        encoded_len += (is_form_safe_char(text[i]) || text[i] == ' ') ? 1 : 3;
+
+    return encoded_len;
+}
+
+/* appends the next chunk of the encoded text to the request body, so that
+ * the text is encoded as it is sent rather than all at once beforehand */
+static void append_paste_chunk(PasteJob *job)
+{
+    static const gchar hex[] = "0123456789ABCDEF";
+    gchar *chunk = g_malloc(PASTE_CHUNK_SIZE);
+    gsize chunk_len = 0;
+
+    while (job->text_pos < job->text_len && chunk_len + 3 <= PASTE_CHUNK_SIZE)
+    {
+        guchar c = job->text[job->text_pos++];
+
+        if (c == ' ')
+            chunk[chunk_len++] = '+';
+        else if (is_form_safe_char(c))
+            chunk[chunk_len++] = c;
+        else
+        {
+            chunk[chunk_len++] = '%';
+            chunk[chunk_len++] = hex[c >> 4];
+            chunk[chunk_len++] = hex[c & 0xf];
+        }
+    }
+
+    soup_message_body_append(job->msg->request_body, SOUP_MEMORY_TAKE, chunk, chunk_len);
+    g_queue_push_tail(&job->chunk_lengths, GSIZE_TO_POINTER(chunk_len));
+
+    if (job->text_pos == job->text_len)
+    {
+        /* all of the snapshot is in the request now */
+        g_free(job->text);
+        job->text = NULL;
+    }
+}
+
+static void on_paste_wrote_chunk(SoupMessage *msg, PasteJob *job)
+{
+    gint percent;
+
+    job->body_sent += GPOINTER_TO_SIZE(g_queue_pop_head(&job->chunk_lengths));
+    percent = MIN(100, job->body_sent * 100 / MAX(job->body_len, 1));
+    if (percent != job->percent)
     {
-        len = sci_get_selected_text_length(doc->editor->sci) + 1;
-        paste_text = sci_get_selection_contents(doc->editor->sci);
+        job->percent = percent;
+        ui_set_statusbar(FALSE, _("Pasting on %s... %d%%"), websites[job->website], percent);
+    }
+
+    if (job->text != NULL)
+        append_paste_chunk(job);
+}
+
+static void free_paste_job(PasteJob *job)
+{
+    g_free(job->text);
+    g_free(job->f_type);
+    g_queue_clear(&job->chunk_lengths);
+    g_free(job);
+}
+
+static void show_paste_result(PasteJob *job, guint status, const gchar *response)
+{
+    gchar *p_url = g_strdup(response);
+    gchar **tokens_array;
+    gint occ_position;
+
+    if(status == SOUP_STATUS_OK)
+    {
+
+        /*
+         * codepad.org doesn't return only the url of the new snippet pasted
+         * but an html page. This minimal parser will get the bare url.
+         */
+
+        if (job->website == CODEPAD_ORG)
+        {
+            tokens_array = g_strsplit(p_url, "<a href=\"", 0);
+
+            /* cuts the string when it finds the first occurrence of '/'
+             * It shoud work even if codepad would change its url.
+             */
+
+            SETPTR(p_url, g_strdup(tokens_array[5]));
+            occ_position = indexof(tokens_array[5], '\"');
+
+            g_strfreev(tokens_array);
+
+            if(occ_position != -1)
+            {
+                p_url[occ_position] = '\0';
+            }
+            else
+            {
+                dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Unable to paste the code on codepad.org\n"
+                                    "Retry or select another pastebin."));
+                g_free(p_url);
+                return;
+            }
+
+        }
+        else if(job->website == TINYPASTE_COM)
+        {
+            /* tinypaste.com returns a XML response which looks
+             * like this:
+             * 
+             * <?xml version="1.0" encoding="utf-8"?>
+             * <result>
+             *      <response>xxxxx</response>
+             * </result>
+             */
+            tokens_array = g_strsplit_set(p_url, "<>", 0);
+            
+            SETPTR(p_url, g_strdup_printf("http://%s/%s", websites[TINYPASTE_COM], tokens_array[6]));
+            
+            g_strfreev(tokens_array);
+        }
+            
+        else if(job->website == DPASTE_DE)
+        {
+            SETPTR(p_url, g_strndup(p_url + 1, strlen(p_url) - 2));
+
+        }
+        else if(job->website == SPRUNGE_US)
+        {
+
+            /* in order to enable the syntax highlightning on sprunge.us
+             * it is necessary to append at the returned url a question
+             * mark '?' followed by the file type.
+             *
+             * e.g. sprunge.us/xxxx?c
+             */
+            gchar *ft_tmp = g_ascii_strdown(job->f_type, -1);
+            g_strstrip(p_url);
+            SETPTR(p_url, g_strdup_printf("%s?%s", p_url, ft_tmp));
+            g_free(ft_tmp);
+        }
+
+        if (check_button_is_checked)
+        {
+            utils_open_browser(p_url);
+        }
+        else
+        {
+            GtkWidget *dlg = gtk_message_dialog_new(GTK_WINDOW(geany->main_widgets->window),
+                GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+                _("Paste Successful"));
+            gtk_message_dialog_format_secondary_markup(GTK_MESSAGE_DIALOG(dlg),
+                _("Your paste can be found here:\n<a href=\"%s\" "
+                "title=\"Click to open the paste in your browser\">%s</a>"), p_url, p_url);
+            gtk_dialog_run(GTK_DIALOG(dlg));
+            gtk_widget_destroy(dlg);
+        }
     }
     else
     {
-        len = sci_get_length(doc->editor->sci) + 1;
-        paste_text = sci_get_contents(doc->editor->sci, len);
+        dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Unable to paste the code. Check your connection and retry.\n"
+                            "Error code: %d\n"), status);
     }
 
-    if (text_len)
-        *text_len = len;
+    g_free(p_url);
+}
+
+/* gtk_menu_item_set_label() needs GTK 2.16 */
+static void set_menu_item_label(const gchar *label)
+{
+    gtk_label_set_text_with_mnemonic(GTK_LABEL(gtk_bin_get_child(GTK_BIN(main_menu_item))), label);
+}
+
+static void on_paste_finished(SoupSession *soup, SoupMessage *msg, gpointer user_data)
+{
+    PasteJob *job = user_data;
+
+    current_job = NULL;
+    ui_progress_bar_stop();
+    if (main_menu_item != NULL)
+        set_menu_item_label(_("_Paste it!"));
+
+    if (msg->status_code == SOUP_STATUS_CANCELLED)
+        ui_set_statusbar(FALSE, _("Paste cancelled."));
+    else
+    {
+        ui_set_statusbar(FALSE, "%s", "");
+        show_paste_result(job, msg->status_code, msg->response_body->data);
+    }
 
-    return paste_text;
+    free_paste_job(job);
 }
 
 static void paste(GeanyDocument * doc, const gchar * website)
 {
-    SoupSession *session;
-    SoupMessage *msg = NULL;
+    SoupMessage *msg;
+    PasteJob *job;
 
     gchar *f_content;
     gchar const *f_type;
     gchar *f_title;
-    gchar *p_url;
+    const gchar *content_field = NULL;
     gchar *formdata = NULL;
     gchar *user_agent = NULL;
-    gchar **tokens_array;
+    gchar *head;
+    gsize head_len;
 
     const gchar *langs_supported_codepad[] =
     {
@@ -200,12 +410,10 @@ static void paste(GeanyDocument * doc, const gchar * website)
         "Python3", "Restructured Text", "SQL", "Text only"
     };
 
-    gint occ_position;
     gint i;
-    guint status;
-    gsize f_length;
 
     g_return_if_fail(doc && doc->is_valid);
+    g_return_if_fail(current_job == NULL);
 
     f_type = doc->file_type->name;
 
@@ -216,13 +424,18 @@ static void paste(GeanyDocument * doc, const gchar * website)
 
     load_settings();
     
-    f_content = get_paste_text(doc, &f_length);
+    /* the text is copied so that the document can be edited while it's sent */
+    f_content = get_paste_text(doc);
     if (f_content == NULL || f_content[0] == '\0')
     {
         dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Refusing to create blank paste"));
+        g_free(f_content);
+        g_free(f_title);
         return;
     }
 
+    /* the text itself isn't encoded here but while sending, as the last
+     * field after the others */
     switch (website_selected)
     {
 
@@ -236,9 +449,8 @@ static void paste(GeanyDocument * doc, const gchar * website)
                 f_type = DEFAULT_TYPE_CODEPAD;
         }
 
-        msg = soup_message_new("POST", website);
+        content_field = "code";
         formdata = soup_form_encode("lang", f_type,
-                                    "code", f_content,
                                     "submit", "Submit",
                                     NULL);
 
@@ -246,9 +458,8 @@ static void paste(GeanyDocument * doc, const gchar * website)
 
     case TINYPASTE_COM:
 
-        msg = soup_message_new("POST", website);
-        formdata = soup_form_encode("paste", f_content, 
-                                    "title", f_title,
+        content_field = "paste";
+        formdata = soup_form_encode("title", f_title,
                                     "is_code", g_strcmp0(f_type, "None") == 0 ? "0" : "1",
                                     NULL);
 
@@ -265,12 +476,11 @@ static void paste(GeanyDocument * doc, const gchar * website)
                 f_type = DEFAULT_TYPE_DPASTE;
         }
 
-        msg = soup_message_new("POST", website);
         /* apparently dpaste.de detects automatically the syntax of the
          * pasted code so 'lexer' should be unneeded
          */
-        formdata = soup_form_encode("content", f_content,
-                                    "title", f_title,
+        content_field = "content";
+        formdata = soup_form_encode("title", f_title,
                                     "lexer", f_type,
                                     NULL);
 
@@ -278,16 +488,15 @@ static void paste(GeanyDocument * doc, const gchar * website)
 
     case SPRUNGE_US:
 
-        msg = soup_message_new("POST", website);
-        formdata = soup_form_encode("sprunge", f_content, NULL);
+        content_field = "sprunge";
+        formdata = g_strdup("");
 
         break;
 
     case PASTEBIN_GEANY_ORG:
 
-        msg = soup_message_new("POST", website);
-        formdata = soup_form_encode("content", f_content,
-                                    "author", author_name,
+        content_field = "content";
+        formdata = soup_form_encode("author", author_name,
                                     "title", f_title,
                                     "lexer", f_type,
                                     NULL);
@@ -296,121 +505,63 @@ static void paste(GeanyDocument * doc, const gchar * website)
 
     }
 
-    g_free(f_content);
-
-    user_agent = g_strconcat(PLUGIN_NAME, " ", PLUGIN_VERSION, " / Geany ", GEANY_VERSION, NULL);
-    session = soup_session_async_new_with_options(SOUP_SESSION_USER_AGENT, user_agent, NULL);
-    g_free(user_agent);
-
-    soup_message_set_request(msg, "application/x-www-form-urlencoded",
-                             SOUP_MEMORY_TAKE, formdata, strlen(formdata));
-
-    status = soup_session_send_message(session, msg);
-    p_url = g_strdup(msg->response_body->data);
-
-    g_object_unref(session);
-    g_object_unref(msg);
-
-    if(status == SOUP_STATUS_OK)
-    {
-
-        /*
-         * codepad.org doesn't return only the url of the new snippet pasted
-         * but an html page. This minimal parser will get the bare url.
-         */
-
-        if (website_selected == CODEPAD_ORG)
-        {
-            tokens_array = g_strsplit(p_url, "<a href=\"", 0);
-
-            /* cuts the string when it finds the first occurrence of '/'
-             * It shoud work even if codepad would change its url.
-             */
-
-            SETPTR(p_url, g_strdup(tokens_array[5]));
-            occ_position = indexof(tokens_array[5], '\"');
-
-            g_strfreev(tokens_array);
-
-            if(occ_position != -1)
-            {
-                p_url[occ_position] = '\0';
-            }
-            else
-            {
-                dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Unable to paste the code on codepad.org\n"
-                                    "Retry or select another pastebin."));
-                g_free(p_url);
-                return;
-            }
-
-        }
-        else if(website_selected == TINYPASTE_COM)
-        {
-            /* tinypaste.com returns a XML response which looks
-             * like this:
-             * 
-             * <?xml version="1.0" encoding="utf-8"?>
-             * <result>
-             *      <response>xxxxx</response>
-             * </result>
-             */
-            tokens_array = g_strsplit_set(p_url, "<>", 0);
-            
-            SETPTR(p_url, g_strdup_printf("http://%s/%s", websites[TINYPASTE_COM], tokens_array[6]));
-            
-            g_strfreev(tokens_array);
-        }
-            
-        else if(website_selected == DPASTE_DE)
-        {
-            SETPTR(p_url, g_strndup(p_url + 1, strlen(p_url) - 2));
-
-        }
-        else if(website_selected == SPRUNGE_US)
-        {
-
-            /* in order to enable the syntax highlightning on sprunge.us
-             * it is necessary to append at the returned url a question
-             * mark '?' followed by the file type.
-             *
-             * e.g. sprunge.us/xxxx?c
-             */
-            gchar *ft_tmp = g_ascii_strdown(f_type, -1);
-            g_strstrip(p_url);
-            SETPTR(p_url, g_strdup_printf("%s?%s", p_url, ft_tmp));
-            g_free(ft_tmp);
-        }
+    g_free(f_title);
+    g_return_if_fail(content_field != NULL);
 
-        if (check_button_is_checked)
-        {
-            utils_open_browser(p_url);
-        }
-        else
-        {
-            GtkWidget *dlg = gtk_message_dialog_new(GTK_WINDOW(geany->main_widgets->window),
-                GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
-                _("Paste Successful"));
-            gtk_message_dialog_format_secondary_markup(GTK_MESSAGE_DIALOG(dlg),
-                _("Your paste can be found here:\n<a href=\"%s\" "
-                "title=\"Click to open the paste in your browser\">%s</a>"), p_url, p_url);
-            gtk_dialog_run(GTK_DIALOG(dlg));
-            gtk_widget_destroy(dlg);
-        }
-    }
-    else
+    if (session == NULL)
     {
-        dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Unable to paste the code. Check your connection and retry.\n"
-                            "Error code: %d\n"), status);
+        user_agent = g_strconcat(PLUGIN_NAME, " ", PLUGIN_VERSION, " / Geany ", GEANY_VERSION, NULL);
+        session = soup_session_async_new_with_options(SOUP_SESSION_USER_AGENT, user_agent, NULL);
+        g_free(user_agent);
     }
 
-    g_free(p_url);
+    msg = soup_message_new("POST", website);
+
+    job = g_new0(PasteJob, 1);
+    job->msg = msg;
+    job->website = website_selected;
+    job->f_type = g_strdup(f_type);
+    job->text = f_content;
+    job->text_len = strlen(f_content);
+    job->percent = -1;
+
+    head = g_strconcat(formdata, formdata[0] ? "&" : "", content_field, "=", NULL);
+    g_free(formdata);
+    job->body_len = strlen(head) + get_form_encoded_length(job->text, job->text_len);
+
+    /* the body is given in chunks, so its length has to be set beforehand */
+    soup_message_headers_replace(msg->request_headers, "Content-Type",
+                                 "application/x-www-form-urlencoded");
+    soup_message_headers_set_content_length(msg->request_headers, job->body_len);
+    head_len = strlen(head);
+    soup_message_body_append(msg->request_body, SOUP_MEMORY_TAKE, head, head_len);
+    g_queue_push_tail(&job->chunk_lengths, GSIZE_TO_POINTER(head_len));
+    append_paste_chunk(job);
+    g_signal_connect(msg, "wrote-chunk", G_CALLBACK(on_paste_wrote_chunk), job);
+
+    current_job = job;
+    set_menu_item_label(_("_Cancel paste"));
+    ui_progress_bar_start(_("Pasting..."));
+
+    soup_session_queue_message(session, msg, on_paste_finished, job);
+}
+
+static void cancel_paste(void)
+{
+    if (current_job != NULL)
+        soup_session_cancel_message(session, current_job->msg, SOUP_STATUS_CANCELLED);
 }
 
 static void item_activate(GtkMenuItem * menuitem, gpointer gdata)
 {
     GeanyDocument *doc = document_get_current();
 
+    if (current_job != NULL)
+    {
+        cancel_paste();
+        return;
+    }
+
     if(!DOC_VALID(doc))
     {
         dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("There are no opened documents. Open one and retry.\n"));
@@ -505,6 +656,14 @@ void plugin_init(GeanyData * data)
 
 void plugin_cleanup(void)
 {
+    if (session != NULL)
+    {
+        /* runs the callback of the pending paste, if any */
+        soup_session_abort(session);
+        g_object_unref(session);
+        session = NULL;
+    }
     g_free(author_name);
     gtk_widget_destroy(main_menu_item);
+    main_menu_item = NULL;
 }
@@ -0,0 +1,528 @@
+/*
+ * Copyright 2010 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Matching of the names skipped by the scanner: the configured patterns and
+ * the rules of the .gitignore files.  Both are compiled once so that names
+ * are mostly looked up in hash tables instead of being matched against every
+ * pattern.
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "gproject-ignore.h"
+
+
+struct GPrjPatternSet
+{
+	GHashTable *names;		/* patterns without wildcards */
+	GHashTable *extensions;	/* "*.ext" patterns, by their ".ext" */
+	GSList *specs;			/* GPatternSpec of the other patterns */
+};
+
+
+/* a .gitignore rule which isn't a plain name or extension, or any rule of a
+ * file with negations, whose rules must be applied in order */
+typedef struct
+{
+	gchar *pattern;
+	gboolean negated;
+	gboolean dir_only;
+	gboolean anchored;	/* matched against the path relative to the .gitignore */
+} Rule;
+
+enum
+{
+	RULE_ANY = 1,
+	RULE_DIR_ONLY
+};
+
+struct GPrjIgnore
+{
+	volatile gint refcount;
+	GPrjIgnore *parent;
+	gchar *dir;
+	GHashTable *names;		/* name -> RULE_ANY or RULE_DIR_ONLY */
+	GHashTable *extensions;	/* ".ext" -> RULE_ANY or RULE_DIR_ONLY */
+	GPtrArray *rules;		/* Rule */
+};
+
+typedef enum
+{
+	MATCH_NONE,
+	MATCH_IGNORED,
+	MATCH_INCLUDED
+} MatchResult;
+
+
+static gboolean has_wildcards(const gchar *pattern)
+{
+	return strpbrk(pattern, "*?[\\") != NULL;
+}
+
+
+/* "*.ext" (or "*ext") without other wildcards, NULL otherwise */
+static const gchar *get_extension(const gchar *pattern)
+{
+	if (pattern[0] != '*' || pattern[1] == '\0' || has_wildcards(pattern + 1))
+		return NULL;
+	return pattern + 1;
+}
+
+
+/* whether a suffix of name is in extensions, returns its value */
+static gpointer lookup_extension(GHashTable *extensions, const gchar *name)
+{
+	const gchar *p;
+
+	if (extensions == NULL)
+		return NULL;
+
+	for (p = name; *p; p++)
+	{
+		gpointer value = g_hash_table_lookup(extensions, p);
+
+		if (value)
+			return value;
+	}
+	return NULL;
+}
+
+
+GPrjPatternSet *gprj_pattern_set_new(gchar **patterns)
+{
+	GPrjPatternSet *set = g_new0(GPrjPatternSet, 1);
+	guint i;
+
+	set->names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	set->extensions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	for (i = 0; patterns && patterns[i]; i++)
+	{
+		const gchar *pattern = patterns[i];
+
+		/* only '*' and '?' are wildcards for GPatternSpec */
+		if (pattern[0] == '\0')
+			continue;
+		else if (strpbrk(pattern, "*?") == NULL)
+			g_hash_table_replace(set->names, g_strdup(pattern), GINT_TO_POINTER(TRUE));
+		else if (pattern[0] == '*' && pattern[1] != '\0' && strpbrk(pattern + 1, "*?") == NULL)
+			g_hash_table_replace(set->extensions, g_strdup(pattern + 1), GINT_TO_POINTER(TRUE));
+		else
+			set->specs = g_slist_prepend(set->specs, g_pattern_spec_new(pattern));
+	}
+	return set;
+}
+
+
+gboolean gprj_pattern_set_match(const GPrjPatternSet *set, const gchar *name)
+{
+	GSList *elem;
+
+	if (set == NULL)
+		return FALSE;
+
+	if (g_hash_table_lookup(set->names, name) || lookup_extension(set->extensions, name))
+		return TRUE;
+
+	for (elem = set->specs; elem != NULL; elem = g_slist_next(elem))
+	{
+		if (g_pattern_match_string(elem->data, name))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+void gprj_pattern_set_free(GPrjPatternSet *set)
+{
+	if (set == NULL)
+		return;
+
+	g_hash_table_destroy(set->names);
+	g_hash_table_destroy(set->extensions);
+	g_slist_foreach(set->specs, (GFunc) g_pattern_spec_free, NULL);
+	g_slist_free(set->specs);
+	g_free(set);
+}
+
+
+/* Matches str against the glob pattern like Git does: '*' and '?' don't match
+ * '/', "**" matches any number of directories.  start is the beginning of the
+ * pattern. */
+static gboolean glob_match(const gchar *start, const gchar *p, const gchar *s)
+{
+	while (*p)
+	{
+		gboolean at_segment = p == start || p[-1] == '/';
+
+		if (p[0] == '*' && p[1] == '*' && at_segment && (p[2] == '/' || p[2] == '\0'))
+		{
+			if (p[2] == '\0')
+				return *s != '\0';
+			/* zero or more directories */
+			p += 3;
+			while (TRUE)
+			{
+				if (glob_match(start, p, s))
+					return TRUE;
+				s = strchr(s, '/');
+				if (s == NULL)
+					return FALSE;
+				s++;
+			}
+		}
+
+		switch (*p)
+		{
+			case '*':
+				while (*p == '*')
+					p++;
+				while (TRUE)
+				{
+					if (glob_match(start, p, s))
+						return TRUE;
+					if (*s == '\0' || *s == '/')
+						return FALSE;
+					s++;
+				}
+			case '?':
+				if (*s == '\0' || *s == '/')
+					return FALSE;
+				break;
+			case '[':
+			{
+				const gchar *q = p + 1;
+				const gchar *first;
+				gboolean negated = *q == '!' || *q == '^';
+				gboolean matched = FALSE;
+
+				if (negated)
+					q++;
+				first = q;
+				/* a ']' right after the '[' is part of the class */
+				while (*q != '\0' && (*q != ']' || q == first))
+				{
+					if (q[1] == '-' && q[2] != '\0' && q[2] != ']')
+					{
+						if ((guchar) *s >= (guchar) q[0] && (guchar) *s <= (guchar) q[2])
+							matched = TRUE;
+						q += 3;
+					}
+					else
+					{
+						if (*q == *s)
+							matched = TRUE;
+						q++;
+					}
+				}
+
+				if (*q == '\0')
+				{
+					/* no closing bracket, a plain '[' */
+					if (*s != '[')
+						return FALSE;
+					break;
+				}
+				if (*s == '\0' || *s == '/' || matched == negated)
+					return FALSE;
+				p = q;
+				break;
+			}
+			case '\\':
+				if (p[1] != '\0')
+					p++;
+				/* fall through */
+			default:
+				if (*p != *s)
+					return FALSE;
+				break;
+		}
+		p++;
+		s++;
+	}
+	return *s == '\0';
+}
+
+
+static void rule_free(Rule *rule)
+{
+	g_free(rule->pattern);
+	g_free(rule);
+}
+
+
+static void ignore_add_rule(GPrjIgnore *ignore, gchar *line, gboolean in_order)
+{
+	Rule *rule;
+	gsize len;
+	const gchar *ext;
+
+	rule = g_new0(Rule, 1);
+	if (line[0] == '!')
+	{
+		rule->negated = TRUE;
+		line++;
+	}
+	len = strlen(line);
+	if (len > 0 && line[len - 1] == '/')
+	{
+		rule->dir_only = TRUE;
+		line[--len] = '\0';
+	}
+	if (strchr(line, '/') != NULL)
+	{
+		rule->anchored = TRUE;
+		if (line[0] == '/')
+			line++;
+	}
+	if (line[0] == '\0')
+	{
+		g_free(rule);
+		return;
+	}
+
+	if (!in_order && !rule->anchored)
+	{
+		gpointer kind = GINT_TO_POINTER(rule->dir_only ? RULE_DIR_ONLY : RULE_ANY);
+		GHashTable *table = NULL;
+
+		if (!has_wildcards(line))
+			table = ignore->names;
+		else if ((ext = get_extension(line)) != NULL)
+		{
+			table = ignore->extensions;
+			line = (gchar *) ext;
+		}
+		if (table != NULL)
+		{
+			/* a rule for any entry wins over one for directories only */
+			if (GPOINTER_TO_INT(g_hash_table_lookup(table, line)) != RULE_ANY)
+				g_hash_table_replace(table, g_strdup(line), kind);
+			g_free(rule);
+			return;
+		}
+	}
+
+	rule->pattern = g_strdup(line);
+	g_ptr_array_add(ignore->rules, rule);
+}
+
+
+/* returns NULL if dir has no .gitignore or it has no rules */
+static GPrjIgnore *ignore_new(const gchar *dir)
+{
+	GPrjIgnore *ignore;
+	gchar *filename, *contents;
+	gchar **lines;
+	gboolean in_order = FALSE;
+	guint i;
+
+	filename = g_build_filename(dir, ".gitignore", NULL);
+	if (!g_file_get_contents(filename, &contents, NULL, NULL))
+	{
+		g_free(filename);
+		return NULL;
+	}
+	g_free(filename);
+
+	lines = g_strsplit(contents, "\n", -1);
+	g_free(contents);
+
+	for (i = 0; lines[i] != NULL; i++)
+	{
+		g_strchomp(lines[i]);
+		if (lines[i][0] == '!')
+			in_order = TRUE;
+	}
+
+	ignore = g_new0(GPrjIgnore, 1);
+	ignore->refcount = 1;
+	ignore->dir = g_strdup(dir);
+	ignore->names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	ignore->extensions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	ignore->rules = g_ptr_array_new();
+
+	for (i = 0; lines[i] != NULL; i++)
+	{
+		if (lines[i][0] != '\0' && lines[i][0] != '#')
+			ignore_add_rule(ignore, lines[i], in_order);
+	}
+	g_strfreev(lines);
+
+	if (ignore->rules->len == 0 && g_hash_table_size(ignore->names) == 0 &&
+		g_hash_table_size(ignore->extensions) == 0)
+	{
+		gprj_ignore_unref(ignore);
+		return NULL;
+	}
+	return ignore;
+}
+
+
+/* Returns the rules of parent with those of the .gitignore in dir, or a new
+ * reference to parent when dir has none */
+GPrjIgnore *gprj_ignore_push(GPrjIgnore *parent, const gchar *dir)
+{
+	GPrjIgnore *ignore = ignore_new(dir);
+
+	if (ignore == NULL)
+		return gprj_ignore_ref(parent);
+
+	ignore->parent = gprj_ignore_ref(parent);
+	return ignore;
+}
+
+
+/* Returns the rules of the .gitignore files of the repository containing dir
+ * which apply to the entries of dir, the one of dir excepted */
+GPrjIgnore *gprj_ignore_new_for_dir(const gchar *dir)
+{
+	GSList *dirs = NULL, *elem;
+	GPrjIgnore *ignore = NULL;
+	gchar *path = g_strdup(dir);
+	gboolean found = FALSE;
+
+	while (!found)
+	{
+		gchar *git_dir = g_build_filename(path, ".git", NULL);
+		gchar *parent;
+
+		/* a file in submodules */
+		found = g_file_test(git_dir, G_FILE_TEST_EXISTS);
+		g_free(git_dir);
+
+		parent = g_path_get_dirname(path);
+		if (found || strcmp(parent, path) == 0)
+		{
+			g_free(parent);
+			break;
+		}
+		g_free(path);
+		path = parent;
+		dirs = g_slist_prepend(dirs, g_strdup(path));
+	}
+	g_free(path);
+
+	/* outside of repositories, .gitignore files have no meaning */
+	if (found)
+	{
+		for (elem = dirs; elem != NULL; elem = g_slist_next(elem))
+		{
+			GPrjIgnore *child = gprj_ignore_push(ignore, elem->data);
+
+			gprj_ignore_unref(ignore);
+			ignore = child;
+		}
+	}
+	g_slist_foreach(dirs, (GFunc) g_free, NULL);
+	g_slist_free(dirs);
+
+	return ignore;
+}
+
+
+static MatchResult ignore_match_one(const GPrjIgnore *ignore, const gchar *rel_path,
+	const gchar *name, gboolean is_dir)
+{
+	MatchResult result = MATCH_NONE;
+	gint kind;
+	guint i;
+
+	kind = GPOINTER_TO_INT(g_hash_table_lookup(ignore->names, name));
+	if (kind == 0)
+		kind = GPOINTER_TO_INT(lookup_extension(ignore->extensions, name));
+	if (kind == RULE_ANY || (kind == RULE_DIR_ONLY && is_dir))
+		return MATCH_IGNORED;
+
+	/* the last matching rule decides */
+	for (i = ignore->rules->len; i > 0 && result == MATCH_NONE; i--)
+	{
+		const Rule *rule = ignore->rules->pdata[i - 1];
+
+		if (rule->dir_only && !is_dir)
+			continue;
+		if (glob_match(rule->pattern, rule->pattern, rule->anchored ? rel_path : name))
+			result = rule->negated ? MATCH_INCLUDED : MATCH_IGNORED;
+	}
+	return result;
+}
+
+
+/* path - absolute path in locale of an entry below the directories of the
+ * rules, the deepest .gitignore matching it decides */
+gboolean gprj_ignore_match(const GPrjIgnore *ignore, const gchar *path, gboolean is_dir)
+{
+	const gchar *name = strrchr(path, G_DIR_SEPARATOR);
+	gchar *copy = NULL;
+	gboolean ret = FALSE;
+
+	name = name ? name + 1 : path;
+
+	for (; ignore != NULL; ignore = ignore->parent)
+	{
+		gsize len = strlen(ignore->dir);
+		const gchar *rel_path;
+		MatchResult result;
+
+		if (strncmp(path, ignore->dir, len) != 0 || path[len] != G_DIR_SEPARATOR)
+			continue;
+		rel_path = path + len + 1;
+#ifdef G_OS_WIN32
+		/* the rules use slashes */
+		g_free(copy);
+		copy = g_strdup(rel_path);
+		g_strdelimit(copy, "\\", '/');
+		rel_path = copy;
+#endif
+		result = ignore_match_one(ignore, rel_path, name, is_dir);
+		if (result != MATCH_NONE)
+		{
+			ret = result == MATCH_IGNORED;
+			break;
+		}
+	}
+	g_free(copy);
+	return ret;
+}
+
+
+GPrjIgnore *gprj_ignore_ref(GPrjIgnore *ignore)
+{
+	if (ignore)
+		g_atomic_int_inc(&ignore->refcount);
+	return ignore;
+}
+
+
+void gprj_ignore_unref(GPrjIgnore *ignore)
+{
+	while (ignore && g_atomic_int_dec_and_test(&ignore->refcount))
+	{
+		GPrjIgnore *parent = ignore->parent;
+
+		g_free(ignore->dir);
+		g_hash_table_destroy(ignore->names);
+		g_hash_table_destroy(ignore->extensions);
+		g_ptr_array_foreach(ignore->rules, (GFunc) rule_free, NULL);
+		g_ptr_array_free(ignore->rules, TRUE);
+		g_free(ignore);
+		ignore = parent;
+	}
+}
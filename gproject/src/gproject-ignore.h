@@ -0,0 +1,43 @@
+/*
+ * Copyright 2010 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GPROJECT_IGNORE_H__
+#define __GPROJECT_IGNORE_H__
+
+/* Configured patterns compiled for matching names: literal names and "*.ext"
+ * patterns are hash lookups, only the other patterns are matched one by one. */
+typedef struct GPrjPatternSet GPrjPatternSet;
+
+GPrjPatternSet *gprj_pattern_set_new(gchar **patterns);
+gboolean gprj_pattern_set_match(const GPrjPatternSet *set, const gchar *name);
+void gprj_pattern_set_free(GPrjPatternSet *set);
+
+
+/* The rules of the .gitignore files applying to a directory, each directory's
+ * rules chained to those of its parents.  NULL stands for no rules.  Paths are
+ * in locale; the rules can be shared between threads. */
+typedef struct GPrjIgnore GPrjIgnore;
+
+GPrjIgnore *gprj_ignore_new_for_dir(const gchar *dir);
+GPrjIgnore *gprj_ignore_push(GPrjIgnore *parent, const gchar *dir);
+gboolean gprj_ignore_match(const GPrjIgnore *ignore, const gchar *path, gboolean is_dir);
+
+GPrjIgnore *gprj_ignore_ref(GPrjIgnore *ignore);
+void gprj_ignore_unref(GPrjIgnore *ignore);
+
+#endif
@@ -31,6 +31,7 @@
 #include "gproject-project.h"
 #include "gproject-sidebar.h"
 #include "gproject-menu.h"
+#include "startprof.h"
 
 PLUGIN_VERSION_CHECK(214)
 PLUGIN_SET_INFO(_("GProject"),
@@ -46,7 +47,6 @@ GeanyFunctions *geany_functions;
 static gint page_index = -1;
 
 
-void plugin_init(G_GNUC_UNUSED GeanyData * data);
 void plugin_cleanup(void);
 
 
@@ -57,15 +57,19 @@ static void on_doc_open(G_GNUC_UNUSED GObject * obj, G_GNUC_UNUSED GeanyDocument
 
 	/* tags of open files managed by geany*/
 	if (gprj_project_is_in_project(doc->file_name))
+	{
+		gprj_project_file_used(doc->file_name);
 		gprj_project_remove_file_tag(doc->file_name);
+	}
 
 	gprj_sidebar_update(FALSE);
 }
 
 
-static void on_doc_activate(G_GNUC_UNUSED GObject * obj, G_GNUC_UNUSED GeanyDocument * doc,
+static void on_doc_activate(G_GNUC_UNUSED GObject * obj, GeanyDocument * doc,
 		G_GNUC_UNUSED gpointer user_data)
 {
+	gprj_project_file_used(doc->file_name);
 	gprj_sidebar_update(FALSE);
 }
 
@@ -132,10 +136,15 @@ static void on_project_dialog_close(G_GNUC_UNUSED GObject * obj, GtkWidget * not
 static void on_project_open(G_GNUC_UNUSED GObject * obj, GKeyFile * config,
 		G_GNUC_UNUSED gpointer user_data)
 {
+	GpStartupTimer timer;
+
+	/* the session's project is opened while Geany starts */
+	gp_startup_profile_start(&timer, geany_plugin, "project-open");
 	gprj_project_open(config);
 	gprj_sidebar_update(TRUE);
 	gprj_sidebar_activate(TRUE);
 	gprj_menu_activate_menu_items(TRUE);
+	gp_startup_profile_stop(&timer);
 }
 
 
@@ -165,8 +174,11 @@ static void on_project_save(G_GNUC_UNUSED GObject * obj, GKeyFile * config,
 }
 
 
+GP_STARTUP_PROFILE_DOCUMENT_OPEN_HANDLER(on_doc_open_profiled, on_doc_open)
+
+
 PluginCallback plugin_callbacks[] = {
-	{"document-open", (GCallback) & on_doc_open, TRUE, NULL},
+	{"document-open", (GCallback) & on_doc_open_profiled, TRUE, NULL},
 	{"document-activate", (GCallback) & on_doc_activate, TRUE, NULL},
 	{"document-close", (GCallback) & on_doc_close, TRUE, NULL},
 	{"build-start", (GCallback) & on_build_start, TRUE, NULL},
@@ -180,13 +192,21 @@ PluginCallback plugin_callbacks[] = {
 };
 
 
-void plugin_init(G_GNUC_UNUSED GeanyData * data)
+static void init(G_GNUC_UNUSED GeanyData * data)
 {
+	/* the project scanner uses a thread pool */
+	plugin_module_make_resident(geany_plugin);
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+
 	gprj_menu_init();
 	gprj_sidebar_init();
 }
 
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init)
+
+
 void plugin_cleanup(void)
 {
 	if (geany_data->app->project)
@@ -17,6 +17,8 @@
  */
 
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <string.h>
 #include <gdk/gdkkeysyms.h>
 #include <glib/gstdio.h>
 
@@ -26,7 +28,11 @@
 #include <geanyplugin.h>
 
 #include "gproject-utils.h"
+#include "gproject-ignore.h"
 #include "gproject-project.h"
+#include "gproject-scanner.h"
+#include "gproject-sidebar.h"
+#include "idlesched.h"
 
 extern GeanyPlugin *geany_plugin;
 extern GeanyData *geany_data;
@@ -37,7 +43,11 @@ typedef struct
 	GtkWidget *source_patterns;
 	GtkWidget *header_patterns;
 	GtkWidget *ignored_dirs_patterns;
+	GtkWidget *use_gitignore;
 	GtkWidget *generate_tags;
+	GtkWidget *watch_files;
+	GtkWidget *lazy_tags_size;
+	GtkWidget *lazy_tags_filetypes;
 } PropertyDialogElements;
 
 GPrj *g_prj = NULL;
@@ -52,8 +62,33 @@ typedef struct
 	DeferredTagOpType type;
 } DeferredTagOp;
 
-static GSList *file_tag_deferred_op_queue = NULL;
-static gboolean flush_queued = FALSE;
+/* maximum time the workspace tags are left outdated while flushing */
+#define WORKSPACE_UPDATE_INTERVAL 1.0
+/* recently used files remembered, parsed first when the project opens */
+#define RECENT_FILES_MAX 100
+
+/* ops in the order of arrival, only the last op for a file is kept */
+static GQueue *file_tag_deferred_op_queue = NULL;
+static GHashTable *file_tag_deferred_op_table = NULL;	/* filename -> GList link of the queue */
+/* tags of files removed from the project waiting for removal from the workspace */
+static GPtrArray *file_tag_deferred_orphans = NULL;
+static GTimer *workspace_update_timer = NULL;
+static guint flush_task_id = 0;
+
+static GPrjScanner *s_scanner = NULL;
+
+/* delay used to collect file monitor events into a single update */
+#define WATCH_UPDATE_DELAY 500
+
+static struct
+{
+	GHashTable *monitors;	/* locale dir path -> GFileMonitor */
+	GHashTable *created;	/* locale paths of pending events */
+	GHashTable *deleted;
+	GSList *scanners;	/* scanners of newly created directories */
+	guint update_source_id;
+	gboolean error_reported;
+} s_watch = {NULL, NULL, NULL, NULL, 0, FALSE};
 
 
 static void deferred_op_free(DeferredTagOp* op, G_GNUC_UNUSED gpointer user_data)
@@ -63,210 +98,703 @@ static void deferred_op_free(DeferredTagOp* op, G_GNUC_UNUSED gpointer user_data
 }
 
 
+/* only the last tag removal updates the workspace */
+static void workspace_remove_tags(GPtrArray *tags, gboolean update)
+{
+	guint i;
+
+	for (i = 0; i < tags->len; i++)
+		tm_workspace_remove_object(tags->pdata[i], TRUE, update && i == tags->len - 1);
+	g_ptr_array_set_size(tags, 0);
+}
+
+
 static void deferred_op_queue_clean(void)
 {
-	g_slist_foreach(file_tag_deferred_op_queue, (GFunc)deferred_op_free, NULL);
-	g_slist_free(file_tag_deferred_op_queue);
-	file_tag_deferred_op_queue = NULL;
-        flush_queued = FALSE;
+	if (!file_tag_deferred_op_queue)
+	{
+		file_tag_deferred_op_queue = g_queue_new();
+		file_tag_deferred_op_table = g_hash_table_new(g_str_hash, g_str_equal);
+		file_tag_deferred_orphans = g_ptr_array_new();
+		workspace_update_timer = g_timer_new();
+	}
+
+	g_queue_foreach(file_tag_deferred_op_queue, (GFunc)deferred_op_free, NULL);
+	g_queue_clear(file_tag_deferred_op_queue);
+	g_hash_table_remove_all(file_tag_deferred_op_table);
+	workspace_remove_tags(file_tag_deferred_orphans, TRUE);
+	if (flush_task_id)
+		gp_sched_remove(flush_task_id);
+	flush_task_id = 0;
+}
+
+
+/* whether the policy leaves the file unparsed until it is opened or requested */
+static gboolean is_parsed_lazily(const gchar *locale_filename, GeanyFiletype *ft)
+{
+	if (g_prj->lazy_tags_size > 0)
+	{
+		struct stat st;
+
+		if (g_stat(locale_filename, &st) == 0 && st.st_size > (gint64) g_prj->lazy_tags_size * 1024)
+			return TRUE;
+	}
+
+	if (g_prj->lazy_tags_filetypes)
+	{
+		gchar **name;
+
+		for (name = g_prj->lazy_tags_filetypes; *name; name++)
+		{
+			if (**name && g_ascii_strcasecmp(*name, ft->name) == 0)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
 }
 
 
-static void workspace_add_tag(gchar *filename, TagObject *obj, gpointer foo)
+/* creates and parses a tag object for the file unless it is open in Geany
+ * (tags of open files are managed by Geany itself) or left for later by the
+ * policy, unless forced; the workspace is not updated */
+static TMWorkObject *workspace_create_tag(gchar *filename, gboolean force)
 {
 	TMWorkObject *tm_obj = NULL;
 
 	if (!document_find_by_filename(filename))
 	{
+		GeanyFiletype *ft = filetypes_detect_from_file(filename);
 		gchar *locale_filename;
 
 		locale_filename = utils_get_locale_from_utf8(filename);
-		tm_obj = tm_source_file_new(locale_filename, FALSE, filetypes_detect_from_file(filename)->name);
+		if (force || !is_parsed_lazily(locale_filename, ft))
+			tm_obj = tm_source_file_new(locale_filename, FALSE, ft->name);
 		g_free(locale_filename);
 
 		if (tm_obj)
-		{
 			tm_workspace_add_object(tm_obj);
-			tm_source_file_update(tm_obj, TRUE, FALSE, TRUE);
-		}
 	}
 
+	return tm_obj;
+}
+
+
+static void workspace_collect_tag(G_GNUC_UNUSED gchar *filename, TagObject *obj, GPtrArray *tags)
+{
 	if (obj->tag)
-		tm_workspace_remove_object(obj->tag, TRUE, TRUE);
+	{
+		g_ptr_array_add(tags, obj->tag);
+		obj->tag = NULL;
+	}
+}
+
 
-	obj->tag = tm_obj;
+static void workspace_remove_all_tags(void)
+{
+	GPtrArray *tags = g_ptr_array_new();
+
+	g_hash_table_foreach(g_prj->file_tag_table, (GHFunc)workspace_collect_tag, tags);
+	workspace_remove_tags(tags, TRUE);
+	g_ptr_array_free(tags, TRUE);
 }
 
 
-static void workspace_add_file_tag(gchar *filename)
+/* Processes the queued ops for the time the scheduler gives. Tag objects
+ * are created and parsed one by one but the (expensive) workspace update is
+ * done only once for the whole batch, when the queue gets empty or after
+ * WORKSPACE_UPDATE_INTERVAL. */
+static gboolean deferred_op_queue_flush(G_GNUC_UNUSED gpointer data)
 {
-	TagObject *obj;
+	GPtrArray *removed_tags;
+	TMWorkObject *last_added = NULL;
+	gboolean update_workspace;
 
-	obj = g_hash_table_lookup(g_prj->file_tag_table, filename);
-	if (obj)
-		workspace_add_tag(filename, obj, NULL);
+	if (!g_prj)
+	{
+		flush_task_id = 0;
+		return FALSE;
+	}
+
+	removed_tags = file_tag_deferred_orphans;
+	file_tag_deferred_orphans = g_ptr_array_new();
+
+	while (!g_queue_is_empty(file_tag_deferred_op_queue) && !gp_sched_should_yield())
+	{
+		DeferredTagOp *op = g_queue_pop_head(file_tag_deferred_op_queue);
+		TagObject *obj;
+
+		g_hash_table_remove(file_tag_deferred_op_table, op->filename);
+
+		obj = g_hash_table_lookup(g_prj->file_tag_table, op->filename);
+		if (obj)
+		{
+			workspace_collect_tag(op->filename, obj, removed_tags);
+
+			if (op->type == DeferredTagOpAdd)
+			{
+				obj->tag = workspace_create_tag(op->filename, obj->requested);
+				if (obj->tag)
+				{
+					/* the last object is parsed after the loop together with
+					 * the workspace update */
+					if (last_added)
+						tm_source_file_update(last_added, TRUE, FALSE, FALSE);
+					last_added = obj->tag;
+				}
+			}
+		}
+
+		deferred_op_free(op, NULL);
+	}
+
+	update_workspace = g_queue_is_empty(file_tag_deferred_op_queue) ||
+		g_timer_elapsed(workspace_update_timer, NULL) > WORKSPACE_UPDATE_INTERVAL;
+
+	workspace_remove_tags(removed_tags, update_workspace && !last_added);
+	if (last_added)
+		tm_source_file_update(last_added, TRUE, FALSE, update_workspace);
+	if (update_workspace)
+		g_timer_start(workspace_update_timer);
+
+	g_ptr_array_free(removed_tags, TRUE);
+
+	if (g_queue_is_empty(file_tag_deferred_op_queue))
+	{
+		flush_task_id = 0;
+		return FALSE;
+	}
+	return TRUE;
 }
 
 
-static void workspace_remove_tag(gchar *filename, TagObject *obj, gpointer foo)
+static void deferred_op_queue_schedule_flush(void)
 {
-	if (obj->tag)
+	if (!flush_task_id)
 	{
-		tm_workspace_remove_object(obj->tag, TRUE, TRUE);
+		flush_task_id = gp_sched_add(geany_plugin, GP_SCHED_PRIORITY_DEFAULT, NULL,
+			deferred_op_queue_flush, NULL, NULL);
+	}
+}
+
+
+static void deferred_op_queue_enqueue(gchar* filename, DeferredTagOpType type)
+{
+	DeferredTagOp * op;
+	GList *link;
+
+	link = g_hash_table_lookup(file_tag_deferred_op_table, filename);
+	if (link)
+	{
+		/* the last op wins */
+		op = link->data;
+		op->type = type;
+		g_queue_unlink(file_tag_deferred_op_queue, link);
+		g_queue_push_tail_link(file_tag_deferred_op_queue, link);
+	}
+	else
+	{
+		op = (DeferredTagOp *) g_new0(DeferredTagOp, 1);
+		op->type = type;
+		op->filename = g_strdup(filename);
+
+		g_queue_push_tail(file_tag_deferred_op_queue, op);
+		g_hash_table_insert(file_tag_deferred_op_table, op->filename,
+			g_queue_peek_tail_link(file_tag_deferred_op_queue));
+	}
+
+	deferred_op_queue_schedule_flush();
+}
+
+
+/* tag - tag object of a file that was removed from the project */
+static void deferred_op_queue_enqueue_orphan(TMWorkObject *tag)
+{
+	g_ptr_array_add(file_tag_deferred_orphans, tag);
+	deferred_op_queue_schedule_flush();
+}
+
+
+/* paths - UTF-8 paths owned by the file table; the recently used files are
+ * queued first */
+static void enqueue_add_tags(GPtrArray *paths)
+{
+	GHashTable *pending;
+	GList *node;
+	guint i;
+
+	pending = g_hash_table_new(g_str_hash, g_str_equal);
+	for (i = 0; i < paths->len; i++)
+		g_hash_table_insert(pending, paths->pdata[i], paths->pdata[i]);
+
+	for (node = g_prj->recent_files->head; node; node = node->next)
+	{
+		gchar *path = g_hash_table_lookup(pending, node->data);
+
+		if (path)
+		{
+			g_hash_table_remove(pending, path);
+			deferred_op_queue_enqueue(path, DeferredTagOpAdd);
+		}
+	}
+
+	for (i = 0; i < paths->len; i++)
+	{
+		if (g_hash_table_remove(pending, paths->pdata[i]))
+			deferred_op_queue_enqueue(paths->pdata[i], DeferredTagOpAdd);
+	}
+
+	g_hash_table_destroy(pending);
+}
+
+
+/* queues the files of the project which have no tags, e.g. after a change of
+ * the policy */
+static void enqueue_untagged(void)
+{
+	GPtrArray *paths = g_ptr_array_new();
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init(&iter, g_prj->file_tag_table);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		TagObject *obj = value;
+
+		if (!obj->tag)
+			g_ptr_array_add(paths, key);
+	}
+	enqueue_add_tags(paths);
+	g_ptr_array_free(paths, TRUE);
+}
+
+
+static gchar *get_index_file(void)
+{
+	gchar *checksum, *name, *ret;
+
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_MD5,
+		geany_data->app->project->file_name, -1);
+	name = g_strconcat(checksum, ".index", NULL);
+	ret = g_build_filename(geany_data->app->configdir, "plugins", "gproject", name, NULL);
+
+	g_free(checksum);
+	g_free(name);
+	return ret;
+}
+
+
+/* files - UTF-8 paths, returns the files which were not part of the project
+ * yet; the strings are owned by the file table */
+static GPtrArray *add_files(GPtrArray *files)
+{
+	GPtrArray *added;
+	guint i;
+
+	added = g_ptr_array_new();
+
+	for (i = 0; i < files->len; i++)
+	{
+		gchar *path = files->pdata[i];
+
+		if (!g_hash_table_lookup(g_prj->file_tag_table, path))
+		{
+			TagObject *obj;
+
+			obj = g_new0(TagObject, 1);
+			obj->tag = NULL;
+			path = g_strdup(path);
+			g_hash_table_insert(g_prj->file_tag_table, path, obj);
+			g_ptr_array_add(added, path);
+		}
+	}
+
+	if (g_prj->generate_tags)
+		enqueue_add_tags(added);
+
+	return added;
+}
+
+
+/* files - UTF-8 paths of files in the project */
+static void remove_files(GPtrArray *files)
+{
+	guint i;
+
+	for (i = 0; i < files->len; i++)
+	{
+		TagObject *obj;
+
+		obj = g_hash_table_lookup(g_prj->file_tag_table, files->pdata[i]);
+		if (!obj)
+			continue;
+
+		/* the tag is removed together with the other queued tag operations */
+		if (obj->tag)
+			deferred_op_queue_enqueue_orphan(obj->tag);
 		obj->tag = NULL;
+		g_hash_table_remove(g_prj->file_tag_table, files->pdata[i]);
 	}
 }
 
 
-static void workspace_remove_file_tag(gchar *filename)
+static void report_watch_error(const gchar *path, GError *error)
 {
-	TagObject *obj;
+	gchar *utf8_path;
 
-	obj = g_hash_table_lookup(g_prj->file_tag_table, filename);
-	if (obj)
-		workspace_remove_tag(filename, obj, NULL);
+	if (s_watch.error_reported)
+		return;
+	s_watch.error_reported = TRUE;
+
+	utf8_path = utils_get_utf8_from_locale(path);
+	msgwin_status_add(_("GProject: cannot watch %s for changes (%s), the project tree "
+		"may have to be reloaded manually."), utf8_path, error->message);
+	g_free(utf8_path);
 }
 
 
-static void deferred_op_queue_dispatch(DeferredTagOp* op, G_GNUC_UNUSED gpointer user_data)
+static void monitor_free(GFileMonitor *monitor)
 {
-	if (op->type == DeferredTagOpAdd)
-		workspace_add_file_tag(op->filename);
-	else if (op->type == DeferredTagOpRemove)
-		workspace_remove_file_tag(op->filename);
+	g_file_monitor_cancel(monitor);
+	g_object_unref(monitor);
 }
 
 
-static gboolean deferred_op_queue_flush(G_GNUC_UNUSED gpointer data)
+static void unwatch_all(void)
 {
-	g_slist_foreach(file_tag_deferred_op_queue,
-					(GFunc)deferred_op_queue_dispatch, NULL);
-	deferred_op_queue_clean();
-	flush_queued = FALSE;
+	if (s_watch.update_source_id)
+		g_source_remove(s_watch.update_source_id);
+	s_watch.update_source_id = 0;
+
+	g_slist_foreach(s_watch.scanners, (GFunc)gprj_scanner_cancel, NULL);
+	g_slist_free(s_watch.scanners);
+	s_watch.scanners = NULL;
 
-	return FALSE; /* returning false removes this callback; it is a one-shot */
+	if (s_watch.monitors)
+	{
+		g_hash_table_destroy(s_watch.monitors);
+		g_hash_table_destroy(s_watch.created);
+		g_hash_table_destroy(s_watch.deleted);
+	}
+	s_watch.monitors = NULL;
+	s_watch.created = NULL;
+	s_watch.deleted = NULL;
 }
 
 
-static void deferred_op_queue_enqueue(gchar* filename, DeferredTagOpType type)
+static gboolean is_in_dir(const gchar *path, const gchar *dir)
 {
-	DeferredTagOp * op;
+	gsize len = strlen(dir);
+
+	return strncmp(path, dir, len) == 0 && (path[len] == '\0' || G_IS_DIR_SEPARATOR(path[len]));
+}
 
-	op = (DeferredTagOp *) g_new0(DeferredTagOp, 1);
-	op->type = type;
-	op->filename = g_strdup(filename);
 
-	file_tag_deferred_op_queue = g_slist_prepend(file_tag_deferred_op_queue,op);
+static void unwatch_dir(const gchar *path)
+{
+	GHashTableIter iter;
+	gpointer key;
 
-	if (!flush_queued)
+	g_hash_table_iter_init(&iter, s_watch.monitors);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
 	{
-		flush_queued = TRUE;
-		plugin_idle_add(geany_plugin, (GSourceFunc)deferred_op_queue_flush, NULL);
+		if (is_in_dir(key, path))
+			g_hash_table_iter_remove(&iter);
 	}
 }
 
 
-/* path - absolute path in locale, returned list in locale */
-static GSList *get_file_list(const gchar * path, GSList *patterns, GSList *ignored_dirs_patterns)
+static gboolean on_watch_update(gpointer foo);
+
+
+static void on_dir_changed(G_GNUC_UNUSED GFileMonitor *monitor, GFile *file,
+	G_GNUC_UNUSED GFile *other_file, GFileMonitorEvent event_type, G_GNUC_UNUSED gpointer user_data)
 {
-	GSList *list = NULL;
-	GDir *dir;
+	gchar *path;
 
-	dir = g_dir_open(path, 0, NULL);
-	if (!dir)
-		return NULL;
+	if (event_type != G_FILE_MONITOR_EVENT_CREATED && event_type != G_FILE_MONITOR_EVENT_DELETED)
+		return;
+
+	path = g_file_get_path(file);
+	if (!path)
+		return;
 
-	while (TRUE)
+	/* only the last event for each path matters */
+	if (event_type == G_FILE_MONITOR_EVENT_CREATED)
+	{
+		g_hash_table_remove(s_watch.deleted, path);
+		g_hash_table_insert(s_watch.created, path, NULL);
+	}
+	else
 	{
-		const gchar *name;
-		gchar *filename;
+		g_hash_table_remove(s_watch.created, path);
+		g_hash_table_insert(s_watch.deleted, path, NULL);
+	}
 
-		name = g_dir_read_name(dir);
-		if (!name)
-			break;
+	if (!s_watch.update_source_id)
+		s_watch.update_source_id = plugin_timeout_add(geany_plugin, WATCH_UPDATE_DELAY,
+			on_watch_update, NULL);
+}
 
-		filename = g_build_filename(path, name, NULL);
 
-		if (g_file_test(filename, G_FILE_TEST_IS_DIR))
-		{
-			GSList *lst;
+static void watch_dir(gchar *path)
+{
+	GFileMonitor *monitor;
+	GFile *file;
+	GError *error = NULL;
 
-			if (patterns_match(ignored_dirs_patterns, name))
-			{
-				g_free(filename);
-				continue;
-			}
+	if (g_hash_table_lookup(s_watch.monitors, path))
+		return;
 
-			lst = get_file_list(filename, patterns, ignored_dirs_patterns);
-			if (lst)
-				list = g_slist_concat(list, lst);
-			g_free(filename);
-		}
-		else if (g_file_test(filename, G_FILE_TEST_IS_REGULAR))
+	file = g_file_new_for_path(path);
+	monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, &error);
+	g_object_unref(file);
+
+	if (!monitor)
+	{
+		report_watch_error(path, error);
+		g_error_free(error);
+		return;
+	}
+
+	g_signal_connect(monitor, "changed", G_CALLBACK(on_dir_changed), NULL);
+	g_hash_table_insert(s_watch.monitors, g_strdup(path), monitor);
+}
+
+
+/* dirs - locale paths of all directories belonging to the project */
+static void watch_dirs(GPtrArray *dirs, gboolean unwatch_others)
+{
+	guint i;
+
+	if (!s_watch.monitors)
+	{
+		s_watch.monitors = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)monitor_free);
+		s_watch.created = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		s_watch.deleted = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	if (unwatch_others)
+	{
+		GHashTable *dir_set;
+		GHashTableIter iter;
+		gpointer key;
+
+		dir_set = g_hash_table_new(g_str_hash, g_str_equal);
+		for (i = 0; i < dirs->len; i++)
+			g_hash_table_insert(dir_set, dirs->pdata[i], dirs->pdata[i]);
+
+		g_hash_table_iter_init(&iter, s_watch.monitors);
+		while (g_hash_table_iter_next(&iter, &key, NULL))
 		{
-			if (patterns_match(patterns, name))
-				list = g_slist_prepend(list, filename);
-			else
-				g_free(filename);
+			if (!g_hash_table_lookup(dir_set, key))
+				g_hash_table_iter_remove(&iter);
 		}
+		g_hash_table_destroy(dir_set);
 	}
 
-	g_dir_close(dir);
+	for (i = 0; i < dirs->len; i++)
+		watch_dir(dirs->pdata[i]);
+}
+
 
-	return list;
+static void on_dir_scan_finished(GPrjScanner *scanner, GPtrArray *files, GPtrArray *dirs,
+	G_GNUC_UNUSED gpointer user_data)
+{
+	GPtrArray *added, *removed;
+
+	s_watch.scanners = g_slist_remove(s_watch.scanners, scanner);
+
+	watch_dirs(dirs, FALSE);
+
+	added = add_files(files);
+	removed = g_ptr_array_new();
+	if (added->len > 0)
+		gprj_sidebar_update_files(added, removed);
+	g_ptr_array_free(added, TRUE);
+	g_ptr_array_free(removed, TRUE);
 }
 
 
-void gprj_project_rescan(void)
+/* Whether the .gitignore files of the repository ignore path */
+static gboolean is_git_ignored(const gchar *path, gboolean is_dir)
 {
-	GSList *pattern_list = NULL;
-	GSList *ignored_dirs_list = NULL;
-	GSList *lst;
-	GSList *elem;
+	gchar *dir = g_path_get_dirname(path);
+	GPrjIgnore *parent = gprj_ignore_new_for_dir(dir);
+	GPrjIgnore *ignore = gprj_ignore_push(parent, dir);
+	gboolean ret = gprj_ignore_match(ignore, path, is_dir);
+
+	gprj_ignore_unref(ignore);
+	gprj_ignore_unref(parent);
+	g_free(dir);
+	return ret;
+}
 
-	if (!g_prj)
-		return;
 
-	if (g_prj->generate_tags)
-		g_hash_table_foreach(g_prj->file_tag_table, (GHFunc)workspace_remove_tag, NULL);
-	g_hash_table_destroy(g_prj->file_tag_table);
-	g_prj->file_tag_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+/* Applies all file monitor events received since the last update at once. */
+static gboolean on_watch_update(G_GNUC_UNUSED gpointer foo)
+{
+	GPtrArray *created, *removed, *added;
+	GSList *removed_dirs = NULL, *elem;
+	GPrjPatternSet *file_patterns, *ignored_dirs_patterns;
+	GHashTableIter iter;
+	gpointer key;
 
-	deferred_op_queue_clean();
+	s_watch.update_source_id = 0;
 
-	pattern_list = get_precompiled_patterns(geany_data->app->project->file_patterns);
+	file_patterns = gprj_pattern_set_new(geany_data->app->project->file_patterns);
+	ignored_dirs_patterns = gprj_pattern_set_new(g_prj->ignored_dirs_patterns);
+	created = g_ptr_array_new();
+	removed = g_ptr_array_new();
 
-	ignored_dirs_list = get_precompiled_patterns(g_prj->ignored_dirs_patterns);
+	g_hash_table_iter_init(&iter, s_watch.deleted);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		gchar *utf8_path = utils_get_utf8_from_locale(key);
 
-	lst = get_file_list(geany_data->app->project->base_path, pattern_list, ignored_dirs_list);
+		if (g_hash_table_lookup(g_prj->file_tag_table, utf8_path))
+			g_ptr_array_add(removed, utf8_path);
+		else if (g_hash_table_lookup(s_watch.monitors, key))
+		{
+			/* a watched directory - everything under it is gone */
+			removed_dirs = g_slist_prepend(removed_dirs, utf8_path);
+			unwatch_dir(key);
+		}
+		else
+			g_free(utf8_path);
+	}
 
-	for (elem = lst; elem != NULL; elem = g_slist_next(elem))
+	if (removed_dirs)
 	{
-		char *path;
-		TagObject *obj;
+		g_hash_table_iter_init(&iter, g_prj->file_tag_table);
+		while (g_hash_table_iter_next(&iter, &key, NULL))
+		{
+			for (elem = removed_dirs; elem != NULL; elem = g_slist_next(elem))
+			{
+				if (is_in_dir(key, elem->data))
+				{
+					g_ptr_array_add(removed, g_strdup(key));
+					break;
+				}
+			}
+		}
+	}
 
-		obj = g_new0(TagObject, 1);
-		obj->tag = NULL;
+	g_hash_table_iter_init(&iter, s_watch.created);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		gchar *name = g_path_get_basename(key);
 
-		path = tm_get_real_path(elem->data);
-		if (path)
+		if (g_file_test(key, G_FILE_TEST_IS_DIR))
 		{
-			setptr(path, utils_get_utf8_from_locale(path));
-			g_hash_table_insert(g_prj->file_tag_table, path, obj);
+			if (!gprj_pattern_set_match(ignored_dirs_patterns, name) &&
+				!g_hash_table_lookup(s_watch.monitors, key) &&
+				!(g_prj->use_gitignore && is_git_ignored(key, TRUE)))
+			{
+				GPrjScanner *scanner;
+
+				scanner = gprj_scanner_start(key, geany_data->app->project->file_patterns,
+					g_prj->ignored_dirs_patterns, g_prj->use_gitignore, NULL,
+					on_dir_scan_finished, NULL);
+				if (scanner)
+					s_watch.scanners = g_slist_prepend(s_watch.scanners, scanner);
+			}
 		}
+		else if (gprj_pattern_set_match(file_patterns, name) &&
+			g_file_test(key, G_FILE_TEST_IS_REGULAR) &&
+			!(g_prj->use_gitignore && is_git_ignored(key, FALSE)))
+		{
+			gchar *path = tm_get_real_path(key);
+
+			if (path)
+			{
+				g_ptr_array_add(created, utils_get_utf8_from_locale(path));
+				g_free(path);
+			}
+		}
+
+		g_free(name);
 	}
 
-	if (g_prj->generate_tags)
-		g_hash_table_foreach(g_prj->file_tag_table, (GHFunc)workspace_add_tag, NULL);
+	g_hash_table_remove_all(s_watch.created);
+	g_hash_table_remove_all(s_watch.deleted);
+
+	remove_files(removed);
+	added = add_files(created);
+	if (added->len > 0 || removed->len > 0)
+		gprj_sidebar_update_files(added, removed);
+
+	g_ptr_array_free(added, TRUE);
+	g_ptr_array_foreach(created, (GFunc)g_free, NULL);
+	g_ptr_array_free(created, TRUE);
+	g_ptr_array_foreach(removed, (GFunc)g_free, NULL);
+	g_ptr_array_free(removed, TRUE);
+	g_slist_foreach(removed_dirs, (GFunc)g_free, NULL);
+	g_slist_free(removed_dirs);
+	gprj_pattern_set_free(file_patterns);
+	gprj_pattern_set_free(ignored_dirs_patterns);
+
+	return FALSE;
+}
+
+
+static void on_scan_finished(G_GNUC_UNUSED GPrjScanner *scanner, GPtrArray *files,
+	GPtrArray *dirs, G_GNUC_UNUSED gpointer user_data)
+{
+	GHashTable *file_set;
+	GHashTableIter iter;
+	gpointer key;
+	GPtrArray *added, *removed;
+	guint i;
+
+	s_scanner = NULL;
+
+	file_set = g_hash_table_new(g_str_hash, g_str_equal);
+	for (i = 0; i < files->len; i++)
+		g_hash_table_insert(file_set, files->pdata[i], files->pdata[i]);
+
+	removed = g_ptr_array_new();
+	g_hash_table_iter_init(&iter, g_prj->file_tag_table);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		if (!g_hash_table_lookup(file_set, key))
+			g_ptr_array_add(removed, g_strdup(key));
+	}
+
+	remove_files(removed);
+	added = add_files(files);
 
-	g_slist_foreach(lst, (GFunc) g_free, NULL);
-	g_slist_free(lst);
+	if (added->len > 0 || removed->len > 0)
+		gprj_sidebar_update_files(added, removed);
+
+	if (g_prj->watch_files)
+		watch_dirs(dirs, TRUE);
+
+	g_ptr_array_free(added, TRUE);
+	g_ptr_array_foreach(removed, (GFunc)g_free, NULL);
+	g_ptr_array_free(removed, TRUE);
+	g_hash_table_destroy(file_set);
+}
+
+
+/* Scanning runs in the background, the file table and the sidebar are updated
+ * with the differences once it finishes. */
+void gprj_project_rescan(void)
+{
+	gchar *index_file;
+
+	if (!g_prj)
+		return;
 
-	g_slist_foreach(pattern_list, (GFunc) g_pattern_spec_free, NULL);
-	g_slist_free(pattern_list);
+	gprj_scanner_cancel(s_scanner);
+	s_watch.error_reported = FALSE;
 
-	g_slist_foreach(ignored_dirs_list, (GFunc) g_pattern_spec_free, NULL);
-	g_slist_free(ignored_dirs_list);
+	index_file = get_index_file();
+	s_scanner = gprj_scanner_start(geany_data->app->project->base_path,
+		geany_data->app->project->file_patterns, g_prj->ignored_dirs_patterns,
+		g_prj->use_gitignore, index_file, on_scan_finished, NULL);
+	g_free(index_file);
 }
 
 
@@ -274,8 +802,15 @@ static void update_project(
 	gchar **source_patterns,
 	gchar **header_patterns,
 	gchar **ignored_dirs_patterns,
-	gboolean generate_tags)
+	gboolean use_gitignore,
+	gboolean generate_tags,
+	gboolean watch_files,
+	gint lazy_tags_size,
+	gchar **lazy_tags_filetypes)
 {
+	gboolean policy_changed;
+	gchar *old_filetypes, *new_filetypes;
+
 	if (g_prj->source_patterns)
 		g_strfreev(g_prj->source_patterns);
 	g_prj->source_patterns = g_strdupv(source_patterns);
@@ -287,9 +822,30 @@ static void update_project(
 	if (g_prj->ignored_dirs_patterns)
 		g_strfreev(g_prj->ignored_dirs_patterns);
 	g_prj->ignored_dirs_patterns = g_strdupv(ignored_dirs_patterns);
-
+	g_prj->use_gitignore = use_gitignore;
+
+	old_filetypes = g_prj->lazy_tags_filetypes ? g_strjoinv(" ", g_prj->lazy_tags_filetypes) : g_strdup("");
+	new_filetypes = g_strjoinv(" ", lazy_tags_filetypes);
+	policy_changed = g_prj->lazy_tags_size != lazy_tags_size ||
+		!utils_str_equal(old_filetypes, new_filetypes);
+	g_free(old_filetypes);
+	g_free(new_filetypes);
+
+	if (g_prj->lazy_tags_filetypes)
+		g_strfreev(g_prj->lazy_tags_filetypes);
+	g_prj->lazy_tags_filetypes = g_strdupv(lazy_tags_filetypes);
+	g_prj->lazy_tags_size = lazy_tags_size;
+
+	if (g_prj->generate_tags && !generate_tags)
+		workspace_remove_all_tags();
+	else if (generate_tags && (!g_prj->generate_tags || policy_changed))
+		enqueue_untagged();
 	g_prj->generate_tags = generate_tags;
 
+	if (!watch_files)
+		unwatch_all();
+	g_prj->watch_files = watch_files;
+
 	gprj_project_rescan();
 }
 
@@ -305,14 +861,39 @@ void gprj_project_save(GKeyFile * key_file)
 		(const gchar**) g_prj->header_patterns, g_strv_length(g_prj->header_patterns));
 	g_key_file_set_string_list(key_file, "gproject", "ignored_dirs_patterns",
 		(const gchar**) g_prj->ignored_dirs_patterns, g_strv_length(g_prj->ignored_dirs_patterns));
+	g_key_file_set_boolean(key_file, "gproject", "use_gitignore", g_prj->use_gitignore);
 	g_key_file_set_boolean(key_file, "gproject", "generate_tags", g_prj->generate_tags);
+	g_key_file_set_boolean(key_file, "gproject", "watch_files", g_prj->watch_files);
+	g_key_file_set_integer(key_file, "gproject", "lazy_tags_size", g_prj->lazy_tags_size);
+	g_key_file_set_string_list(key_file, "gproject", "lazy_tags_filetypes",
+		(const gchar**) g_prj->lazy_tags_filetypes, g_strv_length(g_prj->lazy_tags_filetypes));
+
+	if (!g_queue_is_empty(g_prj->recent_files))
+	{
+		guint len = g_queue_get_length(g_prj->recent_files);
+		gchar **recent = g_new0(gchar *, len + 1);
+		GList *node;
+		guint i = 0;
+
+		for (node = g_prj->recent_files->head; node; node = node->next)
+		{
+			gchar *rel_path = get_file_relative_path(geany_data->app->project->base_path, node->data);
+
+			if (rel_path)
+				recent[i++] = rel_path;
+		}
+		g_key_file_set_string_list(key_file, "gproject", "recent_files", (const gchar**) recent, i);
+		g_strfreev(recent);
+	}
 }
 
 
 void gprj_project_open(GKeyFile * key_file)
 {
-	gchar **source_patterns, **header_patterns, **ignored_dirs_patterns;
-	gboolean generate_tags;
+	gchar **source_patterns, **header_patterns, **ignored_dirs_patterns, **lazy_tags_filetypes;
+	gchar **recent;
+	gboolean use_gitignore, generate_tags, watch_files;
+	gint lazy_tags_size;
 
 	if (g_prj != NULL)
 		gprj_project_close();
@@ -323,8 +904,23 @@ void gprj_project_open(GKeyFile * key_file)
 	g_prj->header_patterns = NULL;
 	g_prj->ignored_dirs_patterns = NULL;
 	g_prj->generate_tags = FALSE;
+	g_prj->watch_files = FALSE;
 
 	g_prj->file_tag_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	g_prj->recent_files = g_queue_new();
+
+	recent = g_key_file_get_string_list(key_file, "gproject", "recent_files", NULL, NULL);
+	if (recent)
+	{
+		gchar **name;
+
+		for (name = recent; *name && g_queue_get_length(g_prj->recent_files) < RECENT_FILES_MAX; name++)
+		{
+			g_queue_push_tail(g_prj->recent_files,
+				g_build_filename(geany_data->app->project->base_path, *name, NULL));
+		}
+		g_strfreev(recent);
+	}
 
 	deferred_op_queue_clean();
 
@@ -337,17 +933,28 @@ void gprj_project_open(GKeyFile * key_file)
 	ignored_dirs_patterns = g_key_file_get_string_list(key_file, "gproject", "ignored_dirs_patterns", NULL, NULL);
 	if (!ignored_dirs_patterns)
 		ignored_dirs_patterns = g_strsplit(".* CVS", " ", -1);
+	use_gitignore = utils_get_setting_boolean(key_file, "gproject", "use_gitignore", TRUE);
 	generate_tags = utils_get_setting_boolean(key_file, "gproject", "generate_tags", FALSE);
+	watch_files = utils_get_setting_boolean(key_file, "gproject", "watch_files", FALSE);
+	lazy_tags_size = utils_get_setting_integer(key_file, "gproject", "lazy_tags_size", 1024);
+	lazy_tags_filetypes = g_key_file_get_string_list(key_file, "gproject", "lazy_tags_filetypes", NULL, NULL);
+	if (!lazy_tags_filetypes)
+		lazy_tags_filetypes = g_new0(gchar *, 1);
 
 	update_project(
 		source_patterns,
 		header_patterns,
 		ignored_dirs_patterns,
-		generate_tags);
+		use_gitignore,
+		generate_tags,
+		watch_files,
+		lazy_tags_size,
+		lazy_tags_filetypes);
 
 	g_strfreev(source_patterns);
 	g_strfreev(header_patterns);
 	g_strfreev(ignored_dirs_patterns);
+	g_strfreev(lazy_tags_filetypes);
 }
 
 
@@ -371,19 +978,25 @@ static gchar **split_patterns(const gchar *str)
 
 void gprj_project_read_properties_tab(void)
 {
-	gchar **source_patterns, **header_patterns, **ignored_dirs_patterns;
+	gchar **source_patterns, **header_patterns, **ignored_dirs_patterns, **lazy_tags_filetypes;
 
 	source_patterns = split_patterns(gtk_entry_get_text(GTK_ENTRY(e->source_patterns)));
 	header_patterns = split_patterns(gtk_entry_get_text(GTK_ENTRY(e->header_patterns)));
 	ignored_dirs_patterns = split_patterns(gtk_entry_get_text(GTK_ENTRY(e->ignored_dirs_patterns)));
+	lazy_tags_filetypes = split_patterns(gtk_entry_get_text(GTK_ENTRY(e->lazy_tags_filetypes)));
 
 	update_project(
 		source_patterns, header_patterns, ignored_dirs_patterns,
-		gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(e->generate_tags)));
+		gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(e->use_gitignore)),
+		gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(e->generate_tags)),
+		gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(e->watch_files)),
+		gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(e->lazy_tags_size)),
+		lazy_tags_filetypes);
 
 	g_strfreev(source_patterns);
 	g_strfreev(header_patterns);
 	g_strfreev(ignored_dirs_patterns);
+	g_strfreev(lazy_tags_filetypes);
 }
 
 
@@ -399,7 +1012,7 @@ gint gprj_project_add_properties_tab(GtkWidget *notebook)
 
 	vbox = gtk_vbox_new(FALSE, 0);
 
-	table = gtk_table_new(3, 2, FALSE);
+	table = gtk_table_new(5, 2, FALSE);
 	gtk_table_set_row_spacings(GTK_TABLE(table), 5);
 	gtk_table_set_col_spacings(GTK_TABLE(table), 10);
 
@@ -438,8 +1051,36 @@ gint gprj_project_add_properties_tab(GtkWidget *notebook)
 	gtk_entry_set_text(GTK_ENTRY(e->ignored_dirs_patterns), str);
 	g_free(str);
 
+	label = gtk_label_new(_("Parse lazily above (KiB):"));
+	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+	e->lazy_tags_size = gtk_spin_button_new_with_range(0, G_MAXINT / 1024, 64);
+	ui_table_add_row(GTK_TABLE(table), 3, label, e->lazy_tags_size, NULL);
+	ui_widget_set_tooltip_text(e->lazy_tags_size,
+		_("Files bigger than this size are only parsed when opened or when their tags are "
+		  "requested from the sidebar. 0 parses all files."));
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(e->lazy_tags_size), g_prj->lazy_tags_size);
+
+	label = gtk_label_new(_("Parse lazily filetypes:"));
+	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+	e->lazy_tags_filetypes = gtk_entry_new();
+	ui_entry_add_clear_icon(GTK_ENTRY(e->lazy_tags_filetypes));
+	ui_table_add_row(GTK_TABLE(table), 4, label, e->lazy_tags_filetypes, NULL);
+	ui_widget_set_tooltip_text(e->lazy_tags_filetypes,
+		_("Space separated list of filetype names, e.g. \"Javascript\", whose files are only "
+		  "parsed when opened or when their tags are requested from the sidebar."));
+	str = g_strjoinv(" ", g_prj->lazy_tags_filetypes);
+	gtk_entry_set_text(GTK_ENTRY(e->lazy_tags_filetypes), str);
+	g_free(str);
+
 	gtk_box_pack_start(GTK_BOX(vbox), table, FALSE, FALSE, 6);
 
+	e->use_gitignore = gtk_check_button_new_with_label(_("Skip the files ignored by Git"));
+	ui_widget_set_tooltip_text(e->use_gitignore,
+		_("Apply the .gitignore files of the repository the project is in, so that "
+		  "e.g. build directories are not scanned."));
+	gtk_box_pack_start(GTK_BOX(vbox), e->use_gitignore, FALSE, FALSE, 6);
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(e->use_gitignore), g_prj->use_gitignore);
+
 	e->generate_tags = gtk_check_button_new_with_label(_("Generate tags for all project files"));
 	ui_widget_set_tooltip_text(e->generate_tags,
 		_("Generate tag list for all project files instead of only for the currently opened files. "
@@ -447,6 +1088,14 @@ gint gprj_project_add_properties_tab(GtkWidget *notebook)
 	gtk_box_pack_start(GTK_BOX(vbox), e->generate_tags, FALSE, FALSE, 6);
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(e->generate_tags), g_prj->generate_tags);
 
+	e->watch_files = gtk_check_button_new_with_label(_("Watch project directories for changes"));
+	ui_widget_set_tooltip_text(e->watch_files,
+		_("Update the project tree automatically when files are added or removed. "
+		  "Every project directory is watched separately so the system limit "
+		  "of watched directories may be reached with very big projects."));
+	gtk_box_pack_start(GTK_BOX(vbox), e->watch_files, FALSE, FALSE, 6);
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(e->watch_files), g_prj->watch_files);
+
 	hbox1 = gtk_hbox_new(FALSE, 0);
 	label = gtk_label_new(_("Note: set the patterns of files belonging to the project under the Project tab."));
 	gtk_box_pack_start(GTK_BOX(hbox1), label, FALSE, FALSE, 0);
@@ -468,16 +1117,23 @@ void gprj_project_close(void)
 {
 	g_return_if_fail(g_prj);
 
+	gprj_scanner_cancel(s_scanner);
+	s_scanner = NULL;
+	unwatch_all();
+
 	if (g_prj->generate_tags)
-		g_hash_table_foreach(g_prj->file_tag_table, (GHFunc)workspace_remove_tag, NULL);
+		workspace_remove_all_tags();
 
 	deferred_op_queue_clean();
 
 	g_strfreev(g_prj->source_patterns);
 	g_strfreev(g_prj->header_patterns);
 	g_strfreev(g_prj->ignored_dirs_patterns);
+	g_strfreev(g_prj->lazy_tags_filetypes);
 
 	g_hash_table_destroy(g_prj->file_tag_table);
+	g_queue_foreach(g_prj->recent_files, (GFunc)g_free, NULL);
+	g_queue_free(g_prj->recent_files);
 
 	g_free(g_prj);
 	g_prj = NULL;
@@ -496,6 +1152,72 @@ void gprj_project_remove_file_tag(gchar *filename)
 }
 
 
+/* parses the file, or the files below the directory, whatever the policy */
+void gprj_project_request_file_tags(const gchar *path)
+{
+	GPtrArray *paths;
+	GHashTableIter iter;
+	gpointer key, value;
+	gchar *dir;
+
+	if (!g_prj)
+		return;
+
+	paths = g_ptr_array_new();
+	dir = g_strconcat(path, G_DIR_SEPARATOR_S, NULL);
+	g_hash_table_iter_init(&iter, g_prj->file_tag_table);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		TagObject *obj = value;
+
+		if (utils_str_equal(key, path) || g_str_has_prefix(key, dir))
+		{
+			obj->requested = TRUE;
+			if (!obj->tag)
+				g_ptr_array_add(paths, key);
+		}
+	}
+	enqueue_add_tags(paths);
+
+	g_ptr_array_free(paths, TRUE);
+	g_free(dir);
+}
+
+
+/* moves the file first in the recently used files; an opened file is parsed
+ * whatever the policy once closed */
+void gprj_project_file_used(const gchar *filename)
+{
+	TagObject *obj;
+	GList *node;
+
+	if (!g_prj || !filename)
+		return;
+
+	obj = g_hash_table_lookup(g_prj->file_tag_table, filename);
+	if (!obj)
+		return;
+	obj->requested = TRUE;
+
+	for (node = g_prj->recent_files->head; node; node = node->next)
+	{
+		if (utils_str_equal(node->data, filename))
+			break;
+	}
+	if (node)
+	{
+		g_queue_unlink(g_prj->recent_files, node);
+		g_queue_push_head_link(g_prj->recent_files, node);
+	}
+	else
+	{
+		g_queue_push_head(g_prj->recent_files, g_strdup(filename));
+		if (g_queue_get_length(g_prj->recent_files) > RECENT_FILES_MAX)
+			g_free(g_queue_pop_tail(g_prj->recent_files));
+	}
+}
+
+
 gboolean gprj_project_is_in_project(const gchar * filename)
 {
 	return filename && g_prj && geany_data->app->project &&
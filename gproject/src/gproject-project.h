@@ -23,6 +23,7 @@
 typedef struct
 {
 	TMWorkObject *tag;
+	gboolean requested;	/* parsed even if the policy leaves it for later */
 } TagObject;
 
 
@@ -31,9 +32,16 @@ typedef struct
 	gchar **source_patterns;
 	gchar **header_patterns;
 	gchar **ignored_dirs_patterns;
+	gboolean use_gitignore;
 	gboolean generate_tags;
+	gboolean watch_files;
+	/* files above this size, in KiB (0 for no limit), or of these filetypes are
+	 * only parsed once opened or requested */
+	gint lazy_tags_size;
+	gchar **lazy_tags_filetypes;
 
 	GHashTable *file_tag_table;
+	GQueue *recent_files;	/* UTF-8 paths, the most recently used first */
 } GPrj;
 
 extern GPrj *g_prj;
@@ -51,6 +59,8 @@ void gprj_project_rescan(void);
 
 void gprj_project_add_file_tag(gchar *filename);
 void gprj_project_remove_file_tag(gchar *filename);
+void gprj_project_request_file_tags(const gchar *path);
+void gprj_project_file_used(const gchar *filename);
 
 gboolean gprj_project_is_in_project(const gchar * filename);
 
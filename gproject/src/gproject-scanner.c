@@ -0,0 +1,645 @@
+/*
+ * Copyright 2010 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Background project scanner. Every directory is read by a separate task of
+ * a thread pool; the result of each read is stored into an on-disk index
+ * together with the directory's mtime so the next scan only re-reads
+ * directories that changed in the meantime.  The index keeps the entries
+ * matching the configured patterns, the .gitignore rules are applied to them
+ * on every scan since they may have changed without the directory changing.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+#include <geanyplugin.h>
+
+#ifndef G_OS_WIN32
+	#include <dirent.h>
+#endif
+
+#include "gproject-utils.h"
+#include "gproject-ignore.h"
+#include "gproject-scanner.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+
+
+#define SCANNER_MAX_THREADS 4
+#define INDEX_HEADER "# GProject file index 2"
+
+/* the first character of every directory entry stored in the index */
+enum
+{
+	ENTRY_FILE = 'f',
+	ENTRY_FILE_LINK = 'l',
+	ENTRY_DIR = 'd',
+	ENTRY_DIR_LINK = 'L',
+	ENTRY_GITIGNORE = 'g'	/* in addition to its file entry, if any */
+};
+
+typedef struct
+{
+	gint64 mtime;
+	GPtrArray *entries;	/* kind-prefixed names of matching files and non-ignored dirs */
+} DirIndex;
+
+typedef struct
+{
+	gchar *rel_path;	/* relative to the base path, "" for the base path */
+	gchar *real_path;	/* absolute, symlinks resolved */
+	GPrjIgnore *ignore;	/* the .gitignore rules of the parent directories */
+} ScanTask;
+
+struct GPrjScanner
+{
+	gchar *base_path;
+	gchar *index_file;
+	gchar *signature;
+	GPrjPatternSet *file_patterns;
+	GPrjPatternSet *ignored_dirs_patterns;
+	gboolean use_gitignore;
+	gint64 start_time;
+
+	GMutex *lock;
+	GHashTable *old_index;	/* read from disk by the first task, entries are stolen when reused */
+	gint64 old_index_time;
+	GHashTable *new_index;
+	GHashTable *visited_links;
+	GPtrArray *files;
+	GPtrArray *dirs;
+
+	GThreadPool *pool;
+	volatile gint pending;
+	volatile gint cancelled;
+	guint done_source_id;
+
+	GPrjScanCallback callback;
+	gpointer user_data;
+};
+
+
+static void free_string_array(GPtrArray *arr)
+{
+	if (!arr)
+		return;
+	g_ptr_array_foreach(arr, (GFunc)g_free, NULL);
+	g_ptr_array_free(arr, TRUE);
+}
+
+
+static void dir_index_free(DirIndex *idx)
+{
+	free_string_array(idx->entries);
+	g_free(idx);
+}
+
+
+static void scan_task_free(ScanTask *task)
+{
+	g_free(task->rel_path);
+	g_free(task->real_path);
+	gprj_ignore_unref(task->ignore);
+	g_free(task);
+}
+
+
+static ScanTask *scan_task_new(const gchar *rel_path, gchar *real_path, GPrjIgnore *ignore)
+{
+	ScanTask *task = g_new0(ScanTask, 1);
+
+	task->rel_path = g_strdup(rel_path);
+	task->real_path = real_path;
+	task->ignore = gprj_ignore_ref(ignore);
+	return task;
+}
+
+
+static gchar *create_signature(gchar **file_patterns, gchar **ignored_dirs_patterns,
+	gboolean use_gitignore)
+{
+	GString *str = g_string_new(NULL);
+	gchar *ret;
+	guint i;
+
+	for (i = 0; file_patterns && file_patterns[i]; i++)
+		g_string_append_printf(str, "%s\n", file_patterns[i]);
+	g_string_append_c(str, '\n');
+	for (i = 0; ignored_dirs_patterns && ignored_dirs_patterns[i]; i++)
+		g_string_append_printf(str, "%s\n", ignored_dirs_patterns[i]);
+	g_string_append_printf(str, "\n%d\n", use_gitignore);
+
+	ret = g_compute_checksum_for_string(G_CHECKSUM_MD5, str->str, str->len);
+	g_string_free(str, TRUE);
+	return ret;
+}
+
+
+/* only backslashes and line ends have to be escaped to keep one entry per line */
+static void append_escaped(GString *str, const gchar *name)
+{
+	for (; *name; name++)
+	{
+		if (*name == '\\')
+			g_string_append(str, "\\\\");
+		else if (*name == '\n')
+			g_string_append(str, "\\n");
+		else if (*name == '\r')
+			g_string_append(str, "\\r");
+		else
+			g_string_append_c(str, *name);
+	}
+}
+
+
+static void load_index(GPrjScanner *scanner)
+{
+	gchar *contents;
+	gchar **lines;
+	DirIndex *idx = NULL;
+	guint i;
+
+	if (!scanner->index_file || !g_file_get_contents(scanner->index_file, &contents, NULL, NULL))
+		return;
+
+	lines = g_strsplit(contents, "\n", -1);
+	g_free(contents);
+
+	/* header, pattern signature and index time */
+	if (g_strv_length(lines) < 3 || strcmp(lines[0], INDEX_HEADER) != 0 ||
+		strcmp(lines[1], scanner->signature) != 0)
+	{
+		g_strfreev(lines);
+		return;
+	}
+
+	scanner->old_index_time = g_ascii_strtoll(lines[2], NULL, 10);
+	scanner->old_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)dir_index_free);
+
+	for (i = 3; lines[i] != NULL; i++)
+	{
+		gchar *line = lines[i];
+
+		if (line[0] == 'D' && line[1] == '\t')
+		{
+			gchar *end;
+			gint64 mtime = g_ascii_strtoll(line + 2, &end, 10);
+
+			if (*end != '\t')
+			{
+				idx = NULL;
+				continue;
+			}
+
+			idx = g_new0(DirIndex, 1);
+			idx->mtime = mtime;
+			idx->entries = g_ptr_array_new();
+			g_hash_table_insert(scanner->old_index, g_strcompress(end + 1), idx);
+		}
+		else if (idx && line[0] != '\0')
+			g_ptr_array_add(idx->entries, g_strcompress(line));
+	}
+
+	g_strfreev(lines);
+}
+
+
+static void save_index(GPrjScanner *scanner)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	GString *str;
+	gchar *dir;
+
+	if (!scanner->index_file)
+		return;
+
+	str = g_string_sized_new(1024 * 1024);
+	g_string_append_printf(str, "%s\n%s\n%" G_GINT64_FORMAT "\n",
+		INDEX_HEADER, scanner->signature, scanner->start_time);
+
+	g_hash_table_iter_init(&iter, scanner->new_index);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		DirIndex *idx = value;
+		guint i;
+
+		g_string_append_printf(str, "D\t%" G_GINT64_FORMAT "\t", idx->mtime);
+		append_escaped(str, key);
+		g_string_append_c(str, '\n');
+
+		for (i = 0; i < idx->entries->len; i++)
+		{
+			append_escaped(str, idx->entries->pdata[i]);
+			g_string_append_c(str, '\n');
+		}
+	}
+
+	dir = g_path_get_dirname(scanner->index_file);
+	g_mkdir_with_parents(dir, 0700);
+	g_free(dir);
+
+	g_file_set_contents(scanner->index_file, str->str, str->len, NULL);
+	g_string_free(str, TRUE);
+}
+
+
+/* returns the kind of the entry or 0 if it is neither a regular file nor
+ * a directory */
+static gchar stat_entry_kind(const gchar *filename, gboolean is_link)
+{
+	struct stat st;
+
+	if (g_stat(filename, &st) != 0)
+		return 0;
+
+	if (S_ISDIR(st.st_mode))
+		return is_link ? ENTRY_DIR_LINK : ENTRY_DIR;
+	if (S_ISREG(st.st_mode))
+		return is_link ? ENTRY_FILE_LINK : ENTRY_FILE;
+	return 0;
+}
+
+
+static void add_entry(GPrjScanner *scanner, GPtrArray *entries, const gchar *name, gchar kind)
+{
+	if (kind == ENTRY_DIR || kind == ENTRY_DIR_LINK)
+	{
+		if (gprj_pattern_set_match(scanner->ignored_dirs_patterns, name))
+			return;
+	}
+	else if (kind == ENTRY_FILE || kind == ENTRY_FILE_LINK)
+	{
+		/* saves trying to read a .gitignore in every directory */
+		if (scanner->use_gitignore && strcmp(name, ".gitignore") == 0)
+			g_ptr_array_add(entries, g_strdup_printf("%c%s", ENTRY_GITIGNORE, name));
+		if (!gprj_pattern_set_match(scanner->file_patterns, name))
+			return;
+	}
+	else
+		return;
+
+	g_ptr_array_add(entries, g_strdup_printf("%c%s", kind, name));
+}
+
+
+/* path - absolute path in locale, entries are kind-prefixed names in locale */
+static GPtrArray *read_dir(GPrjScanner *scanner, const gchar *path)
+{
+	GPtrArray *entries;
+#ifdef G_OS_WIN32
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open(path, 0, NULL);
+	if (!dir)
+		return NULL;
+
+	entries = g_ptr_array_new();
+	while ((name = g_dir_read_name(dir)) != NULL)
+	{
+		gchar *filename = g_build_filename(path, name, NULL);
+
+		add_entry(scanner, entries, name, stat_entry_kind(filename, FALSE));
+		g_free(filename);
+	}
+	g_dir_close(dir);
+#else
+	DIR *dir;
+	struct dirent *de;
+
+	dir = opendir(path);
+	if (!dir)
+		return NULL;
+
+	entries = g_ptr_array_new();
+	while ((de = readdir(dir)) != NULL)
+	{
+		const gchar *name = de->d_name;
+		gchar kind = 0;
+
+		if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+			continue;
+
+#ifdef DT_DIR
+		/* d_type saves a stat() call for all but symlinks and file systems
+		 * not filling it in */
+		if (de->d_type == DT_DIR)
+			kind = ENTRY_DIR;
+		else if (de->d_type == DT_REG)
+			kind = ENTRY_FILE;
+		else if (de->d_type == DT_LNK || de->d_type == DT_UNKNOWN)
+#endif
+		{
+			gchar *filename = g_build_filename(path, name, NULL);
+			struct stat st;
+			gboolean is_link = g_lstat(filename, &st) == 0 && S_ISLNK(st.st_mode);
+
+			kind = stat_entry_kind(filename, is_link);
+			g_free(filename);
+		}
+
+		add_entry(scanner, entries, name, kind);
+	}
+	closedir(dir);
+#endif
+
+	return entries;
+}
+
+
+static gboolean on_scan_done(GPrjScanner *scanner)
+{
+	g_mutex_lock(scanner->lock);
+	scanner->done_source_id = 0;
+	g_mutex_unlock(scanner->lock);
+
+	/* all tasks are finished at this point, just release the pool */
+	g_thread_pool_free(scanner->pool, FALSE, TRUE);
+	scanner->pool = NULL;
+
+	scanner->callback(scanner, scanner->files, scanner->dirs, scanner->user_data);
+	gprj_scanner_cancel(scanner);
+
+	return FALSE;
+}
+
+
+static void scan_finish(GPrjScanner *scanner)
+{
+	if (g_atomic_int_get(&scanner->cancelled))
+		return;
+
+	save_index(scanner);
+
+	g_mutex_lock(scanner->lock);
+	if (!g_atomic_int_get(&scanner->cancelled))
+		scanner->done_source_id = g_idle_add((GSourceFunc)on_scan_done, scanner);
+	g_mutex_unlock(scanner->lock);
+}
+
+
+/* Whether path is dir or inside it, "/p/src" not being an ancestor of "/p/src-old" */
+static gboolean path_is_ancestor(const gchar *dir, const gchar *path)
+{
+	gsize len = strlen(dir);
+
+	if (strncmp(path, dir, len) != 0)
+		return FALSE;
+	return path[len] == '\0' || G_IS_DIR_SEPARATOR(path[len]) ||
+		(len > 0 && G_IS_DIR_SEPARATOR(dir[len - 1]));
+}
+
+
+static void scan_dir(ScanTask *task, GPrjScanner *scanner)
+{
+	gchar *path;
+	struct stat st;
+	GPtrArray *files = NULL;
+	GPtrArray *entries = NULL;
+	GSList *subtasks = NULL, *elem;
+	GPrjIgnore *ignore = NULL;
+	DirIndex *idx;
+	guint i;
+
+	if (g_atomic_int_get(&scanner->cancelled))
+		goto done;
+
+	/* the first task runs alone so the index can be loaded without locking */
+	if (task->rel_path[0] == '\0')
+	{
+		load_index(scanner);
+		if (scanner->use_gitignore)
+			task->ignore = gprj_ignore_new_for_dir(scanner->base_path);
+	}
+
+	path = g_build_filename(scanner->base_path, task->rel_path, NULL);
+	if (g_stat(path, &st) != 0)
+	{
+		g_free(path);
+		goto done;
+	}
+
+	g_mutex_lock(scanner->lock);
+	idx = scanner->old_index ? g_hash_table_lookup(scanner->old_index, task->rel_path) : NULL;
+	/* an entry read in the same second the directory was modified might not
+	 * contain the latest changes */
+	if (idx && idx->mtime == (gint64) st.st_mtime && idx->mtime < scanner->old_index_time)
+	{
+		entries = idx->entries;
+		idx->entries = NULL;
+	}
+	g_mutex_unlock(scanner->lock);
+
+	if (!entries)
+		entries = read_dir(scanner, path);
+
+	if (!entries)
+	{
+		g_free(path);
+		goto done;
+	}
+
+	for (i = 0; i < entries->len; i++)
+	{
+		if (((gchar *) entries->pdata[i])[0] == ENTRY_GITIGNORE)
+			break;
+	}
+	if (i < entries->len)
+		ignore = gprj_ignore_push(task->ignore, path);
+	else
+		ignore = gprj_ignore_ref(task->ignore);
+
+	files = g_ptr_array_new();
+	for (i = 0; i < entries->len; i++)
+	{
+		const gchar *entry = entries->pdata[i];
+		const gchar *name = entry + 1;
+		gchar *filename;
+
+		/* ignored subtrees are not even opened */
+		if (ignore && entry[0] != ENTRY_GITIGNORE)
+		{
+			gchar *entry_path = g_build_filename(path, name, NULL);
+			gboolean ignored = gprj_ignore_match(ignore, entry_path,
+				entry[0] == ENTRY_DIR || entry[0] == ENTRY_DIR_LINK);
+
+			g_free(entry_path);
+			if (ignored)
+				continue;
+		}
+
+		filename = g_build_filename(task->real_path, name, NULL);
+
+		switch (entry[0])
+		{
+			case ENTRY_FILE_LINK:
+				setptr(filename, tm_get_real_path(filename));
+				/* fall through */
+			case ENTRY_FILE:
+				if (filename)
+					g_ptr_array_add(files, utils_get_utf8_from_locale(filename));
+				break;
+			case ENTRY_DIR_LINK:
+			{
+				gboolean visited = TRUE;
+
+				setptr(filename, tm_get_real_path(filename));
+
+				/* avoid endless loops caused by links pointing to their parents */
+				g_mutex_lock(scanner->lock);
+				if (filename && !path_is_ancestor(filename, task->real_path) &&
+					!g_hash_table_lookup(scanner->visited_links, filename))
+				{
+					g_hash_table_insert(scanner->visited_links, g_strdup(filename), GINT_TO_POINTER(TRUE));
+					visited = FALSE;
+				}
+				g_mutex_unlock(scanner->lock);
+
+				if (visited)
+					break;
+			}
+				/* fall through */
+			case ENTRY_DIR:
+			{
+				gchar *rel_path = g_build_filename(task->rel_path, name, NULL);
+
+				subtasks = g_slist_prepend(subtasks, scan_task_new(rel_path, filename, ignore));
+				filename = NULL;
+				g_free(rel_path);
+				break;
+			}
+		}
+
+		g_free(filename);
+	}
+	gprj_ignore_unref(ignore);
+	g_free(path);
+
+	idx = g_new0(DirIndex, 1);
+	idx->mtime = st.st_mtime;
+	idx->entries = entries;
+
+	g_mutex_lock(scanner->lock);
+	g_hash_table_insert(scanner->new_index, g_strdup(task->rel_path), idx);
+	g_ptr_array_add(scanner->dirs, g_strdup(task->real_path));
+	for (i = 0; i < files->len; i++)
+		g_ptr_array_add(scanner->files, files->pdata[i]);
+	g_mutex_unlock(scanner->lock);
+	g_ptr_array_free(files, TRUE);
+
+	/* under the lock, gprj_scanner_cancel() may be freeing the pool otherwise */
+	g_mutex_lock(scanner->lock);
+	for (elem = subtasks; elem != NULL; elem = g_slist_next(elem))
+	{
+		if (g_atomic_int_get(&scanner->cancelled))
+		{
+			scan_task_free(elem->data);
+			continue;
+		}
+		g_atomic_int_inc(&scanner->pending);
+		g_thread_pool_push(scanner->pool, elem->data, NULL);
+	}
+	g_mutex_unlock(scanner->lock);
+	g_slist_free(subtasks);
+
+done:
+	scan_task_free(task);
+	if (g_atomic_int_dec_and_test(&scanner->pending))
+		scan_finish(scanner);
+}
+
+
+/* base_path - absolute path in locale
+ * index_file - path in locale of the index used to speed up rescans, may be NULL */
+GPrjScanner *gprj_scanner_start(const gchar *base_path, gchar **file_patterns,
+	gchar **ignored_dirs_patterns, gboolean use_gitignore, const gchar *index_file,
+	GPrjScanCallback callback, gpointer user_data)
+{
+	GPrjScanner *scanner;
+	gchar *real_path;
+
+	real_path = tm_get_real_path(base_path);
+	if (!real_path)
+		return NULL;
+
+	scanner = g_new0(GPrjScanner, 1);
+	scanner->base_path = g_strdup(base_path);
+	scanner->index_file = g_strdup(index_file);
+	scanner->signature = create_signature(file_patterns, ignored_dirs_patterns, use_gitignore);
+	scanner->file_patterns = gprj_pattern_set_new(file_patterns);
+	scanner->ignored_dirs_patterns = gprj_pattern_set_new(ignored_dirs_patterns);
+	scanner->use_gitignore = use_gitignore;
+	scanner->start_time = time(NULL);
+	scanner->lock = g_mutex_new();
+	scanner->new_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)dir_index_free);
+	scanner->visited_links = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	scanner->files = g_ptr_array_new();
+	scanner->dirs = g_ptr_array_new();
+	scanner->callback = callback;
+	scanner->user_data = user_data;
+
+	scanner->pool = g_thread_pool_new((GFunc)scan_dir, scanner, SCANNER_MAX_THREADS, FALSE, NULL);
+	scanner->pending = 1;
+	g_thread_pool_push(scanner->pool, scan_task_new("", real_path, NULL), NULL);
+
+	return scanner;
+}
+
+
+/* stops the scan (waiting for the running tasks) and frees the scanner */
+void gprj_scanner_cancel(GPrjScanner *scanner)
+{
+	if (!scanner)
+		return;
+
+	g_mutex_lock(scanner->lock);
+	g_atomic_int_set(&scanner->cancelled, TRUE);
+	g_mutex_unlock(scanner->lock);
+
+	/* queued tasks return immediately once cancelled is set */
+	if (scanner->pool)
+		g_thread_pool_free(scanner->pool, FALSE, TRUE);
+
+	if (scanner->done_source_id)
+		g_source_remove(scanner->done_source_id);
+
+	g_free(scanner->base_path);
+	g_free(scanner->index_file);
+	g_free(scanner->signature);
+	gprj_pattern_set_free(scanner->file_patterns);
+	gprj_pattern_set_free(scanner->ignored_dirs_patterns);
+	g_mutex_free(scanner->lock);
+	if (scanner->old_index)
+		g_hash_table_destroy(scanner->old_index);
+	g_hash_table_destroy(scanner->new_index);
+	g_hash_table_destroy(scanner->visited_links);
+	free_string_array(scanner->files);
+	free_string_array(scanner->dirs);
+	g_free(scanner);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2010 Jiri Techet <techet@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GPROJECT_SCANNER_H__
+#define __GPROJECT_SCANNER_H__
+
+typedef struct GPrjScanner GPrjScanner;
+
+/* files - array of absolute UTF-8 paths with symlinks resolved
+ * dirs - array of absolute paths in locale of all scanned directories
+ * Both are owned by the scanner and freed after the callback returns. */
+typedef void (*GPrjScanCallback) (GPrjScanner *scanner, GPtrArray *files, GPtrArray *dirs,
+	gpointer user_data);
+
+
+/* use_gitignore - skip the files and directories ignored by the .gitignore
+ * files of the repository base_path is in */
+GPrjScanner *gprj_scanner_start(const gchar *base_path, gchar **file_patterns,
+	gchar **ignored_dirs_patterns, gboolean use_gitignore, const gchar *index_file,
+	GPrjScanCallback callback, gpointer user_data);
+
+void gprj_scanner_cancel(GPrjScanner *scanner);
+
+#endif
@@ -26,6 +26,8 @@
 #include <geanyplugin.h>
 #include <gtkcompat.h>
 
+#include "vcstatus.h"
+
 #include "gproject-utils.h"
 #include "gproject-project.h"
 #include "gproject-sidebar.h"
@@ -33,6 +35,9 @@
 extern GeanyData *geany_data;
 extern GeanyFunctions *geany_functions;
 
+/* above this number of changes the tree is rebuilt from scratch */
+#define MAX_INCREMENTAL_UPDATES 1000
+
 enum
 {
 	FILEVIEW_COLUMN_ICON,
@@ -41,11 +46,33 @@ enum
 };
 
 
+/* The files of a directory, by their names.  Rows of the tree are only created
+ * when their directory gets expanded; until then a directory has a single
+ * placeholder child with no name. */
+typedef struct
+{
+	GPtrArray *dirs;
+	GPtrArray *files;
+	gboolean sorted;
+} DirIndex;
+
+
 static GtkWidget *s_file_view_vbox = NULL;
 static GtkWidget *s_file_view = NULL;
 static GtkTreeStore *s_file_store = NULL;
 static gboolean s_follow_editor = FALSE;
 
+/* relative path of a directory ("" for the project base path) -> DirIndex */
+static GHashTable *s_dir_index = NULL;
+/* relative path -> GtkTreeIter of the rows created so far, the iters of
+ * a GtkTreeStore stay valid as long as their row exists */
+static GHashTable *s_row_index = NULL;
+/* sorted relative paths of all files, built for find-file when needed */
+static GPtrArray *s_file_paths = NULL;
+static GSList *s_header_patterns = NULL;
+static GSList *s_source_patterns = NULL;
+static gulong s_vc_status_subscription = 0;
+
 static struct
 {
 	GtkWidget *expand;
@@ -164,44 +191,404 @@ static gint show_dialog_find_file(gchar *path, gchar **pattern, gboolean *case_s
 }
 
 
-static gchar *build_path(GtkTreeIter *iter)
+static void free_string_array(GPtrArray *arr)
 {
-	GtkTreeIter node;
-	GtkTreeIter parent;
-	gchar *path = NULL;
-	GtkTreeModel *model;
-	gchar *name;
+	g_ptr_array_foreach(arr, (GFunc) g_free, NULL);
+	g_ptr_array_free(arr, TRUE);
+}
+
+
+static void dir_index_free(DirIndex *dir)
+{
+	free_string_array(dir->dirs);
+	free_string_array(dir->files);
+	g_free(dir);
+}
+
+
+static gint compare_names(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const gchar **) a, *(const gchar **) b);
+}
+
+
+static void dir_index_sort(DirIndex *dir)
+{
+	if (dir->sorted)
+		return;
+
+	g_ptr_array_sort(dir->dirs, compare_names);
+	g_ptr_array_sort(dir->files, compare_names);
+	dir->sorted = TRUE;
+}
+
+
+static void remove_name(GPtrArray *arr, const gchar *name)
+{
+	guint i;
+
+	for (i = 0; i < arr->len; i++)
+	{
+		if (strcmp(arr->pdata[i], name) == 0)
+		{
+			g_free(g_ptr_array_remove_index(arr, i));
+			return;
+		}
+	}
+}
+
+
+static void file_paths_invalidate(void)
+{
+	if (s_file_paths)
+		free_string_array(s_file_paths);
+	s_file_paths = NULL;
+}
+
+
+/* the relative path made of the first len elements of path_split */
+static gchar *index_key(gchar **path_split, gint len)
+{
+	GString *key = g_string_new("");
+	gint i;
+
+	for (i = 0; i < len; i++)
+	{
+		if (i > 0)
+			g_string_append(key, G_DIR_SEPARATOR_S);
+		g_string_append(key, path_split[i]);
+	}
+
+	return g_string_free(key, FALSE);
+}
+
+
+static DirIndex *index_get_dir(gchar **path_split, gint len, gboolean create)
+{
+	gchar *key = index_key(path_split, len);
+	DirIndex *dir = g_hash_table_lookup(s_dir_index, key);
+
+	if (!dir && create)
+	{
+		dir = g_new0(DirIndex, 1);
+		dir->dirs = g_ptr_array_new();
+		dir->files = g_ptr_array_new();
+		g_hash_table_insert(s_dir_index, key, dir);
+		key = NULL;
+
+		if (len > 0)
+		{
+			DirIndex *parent = index_get_dir(path_split, len - 1, TRUE);
+
+			g_ptr_array_add(parent->dirs, g_strdup(path_split[len - 1]));
+			parent->sorted = FALSE;
+		}
+	}
+
+	g_free(key);
+	return dir;
+}
+
+
+static void index_add_file(gchar **path_split)
+{
+	gint len = g_strv_length(path_split);
+	DirIndex *dir = index_get_dir(path_split, len - 1, TRUE);
+
+	g_ptr_array_add(dir->files, g_strdup(path_split[len - 1]));
+	dir->sorted = FALSE;
+	file_paths_invalidate();
+}
+
+
+/* removes the file together with all directories it leaves empty */
+static void index_remove_file(gchar **path_split)
+{
+	gint len = g_strv_length(path_split) - 1;
+	DirIndex *dir = index_get_dir(path_split, len, FALSE);
+
+	if (!dir)
+		return;
+
+	remove_name(dir->files, path_split[len]);
+	file_paths_invalidate();
+
+	while (len > 0 && dir->dirs->len == 0 && dir->files->len == 0)
+	{
+		gchar *key = index_key(path_split, len);
+
+		g_hash_table_remove(s_dir_index, key);
+		g_free(key);
+
+		len--;
+		dir = index_get_dir(path_split, len, FALSE);
+		remove_name(dir->dirs, path_split[len]);
+	}
+}
+
+
+static gchar *split_relative_path(const gchar *utf8_path, gchar ***path_split)
+{
+	gchar *rel_path = get_file_relative_path(geany_data->app->project->base_path, utf8_path);
+
+	if (rel_path)
+		*path_split = g_strsplit_set(rel_path, "/\\", 0);
+	return rel_path;
+}
+
+
+static void index_rebuild(void)
+{
+	GHashTableIter iter;
+	gpointer name;
+
+	if (s_dir_index)
+		g_hash_table_destroy(s_dir_index);
+	s_dir_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, (GDestroyNotify) dir_index_free);
+	file_paths_invalidate();
+
+	g_hash_table_iter_init(&iter, g_prj->file_tag_table);
+	while (g_hash_table_iter_next(&iter, &name, NULL))
+	{
+		gchar **path_split;
+		gchar *rel_path = split_relative_path(name, &path_split);
+
+		if (rel_path)
+		{
+			index_add_file(path_split);
+			g_strfreev(path_split);
+		}
+		g_free(rel_path);
+	}
+}
+
+
+static gchar *child_key(const gchar *key, const gchar *name)
+{
+	if (*key)
+		return g_build_filename(key, name, NULL);
+	return g_strdup(name);
+}
+
+
+static void row_index_add(gchar *key, GtkTreeIter *iter)
+{
+	g_hash_table_insert(s_row_index, key, g_memdup(iter, sizeof(GtkTreeIter)));
+}
+
+
+static gboolean is_in_dir(gpointer key, G_GNUC_UNUSED gpointer value, gpointer dir_key)
+{
+	gsize len = strlen(dir_key);
+
+	return strncmp(key, dir_key, len) == 0 &&
+		(((gchar *) key)[len] == '\0' || ((gchar *) key)[len] == G_DIR_SEPARATOR);
+}
+
+
+/* to be called before the row of key and its children are removed */
+static void row_index_remove(const gchar *key)
+{
+	g_hash_table_foreach_remove(s_row_index, is_in_dir, (gpointer) key);
+}
+
+
+static void row_index_clear(void)
+{
+	if (s_row_index)
+		g_hash_table_destroy(s_row_index);
+	s_row_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+}
+
+
+/* the relative path of the row, as used by the index */
+static gchar *build_index_key(GtkTreeIter *iter)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(s_file_store);
+	GtkTreeIter node, parent;
+	gchar *key = NULL;
+	gboolean has_parent;
 
 	if (!iter)
-		return g_strdup(geany_data->app->project->base_path);
+		return g_strdup("");
 
 	node = *iter;
-	model = GTK_TREE_MODEL(s_file_store);
-
-	while (gtk_tree_model_iter_parent(model, &parent, &node))
+	do
 	{
+		gchar *name;
+
 		gtk_tree_model_get(model, &node, FILEVIEW_COLUMN_NAME, &name, -1);
-		if (path == NULL)
-			path = g_strdup(name);
+		if (key == NULL)
+			key = name;
 		else
-			setptr(path, g_build_filename(name, path, NULL));
-		g_free(name);
+		{
+			setptr(key, g_strconcat(name, G_DIR_SEPARATOR_S, key, NULL));
+			g_free(name);
+		}
 
+		has_parent = gtk_tree_model_iter_parent(model, &parent, &node);
 		node = parent;
 	}
+	while (has_parent);
 
-	gtk_tree_model_get(model, &node, FILEVIEW_COLUMN_NAME, &name, -1);
-	setptr(path, g_build_filename(name, path, NULL));
-	g_free(name);
+	return key;
+}
 
-	setptr(path, g_build_filename(geany_data->app->project->base_path, path, NULL));
+
+static gchar *build_path(GtkTreeIter *iter)
+{
+	gchar *key, *path;
+
+	if (!iter)
+		return g_strdup(geany_data->app->project->base_path);
+
+	key = build_index_key(iter);
+	path = g_build_filename(geany_data->app->project->base_path, key, NULL);
+	g_free(key);
 
 	return path;
 }
 
 
+static gboolean has_placeholder(GtkTreeIter *iter)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(s_file_store);
+	GtkTreeIter child;
+	gchar *name;
+	gboolean ret;
+
+	if (!gtk_tree_model_iter_children(model, &child, iter))
+		return FALSE;
+
+	gtk_tree_model_get(model, &child, FILEVIEW_COLUMN_NAME, &name, -1);
+	ret = name == NULL;
+	g_free(name);
+
+	return ret;
+}
+
+
+static GIcon *get_file_icon(const gchar *name)
+{
+	GIcon *icon = NULL;
+	gchar *content_type = g_content_type_guess(name, NULL, 0, NULL);
+
+	if (content_type)
+	{
+		icon = g_content_type_get_icon(content_type);
+		g_free(content_type);
+	}
+
+	if (!icon)
+	{
+		if (patterns_match(s_header_patterns, name))
+			icon = g_icon_new_for_string("gproject-header", NULL);
+		else if (patterns_match(s_source_patterns, name))
+			icon = g_icon_new_for_string("gproject-source", NULL);
+		else
+			icon = g_icon_new_for_string("gproject-file", NULL);
+	}
+
+	return icon;
+}
+
+
+static void set_dir_row(GtkTreeIter *iter, const gchar *name, GIcon *icon_dir)
+{
+	GtkTreeIter placeholder;
+
+	gtk_tree_store_set(s_file_store, iter,
+		FILEVIEW_COLUMN_ICON, icon_dir,
+		FILEVIEW_COLUMN_NAME, name, -1);
+	gtk_tree_store_append(s_file_store, &placeholder, iter);
+}
+
+
+static void create_branch(GtkTreeIter *parent, const gchar *key, DirIndex *dir)
+{
+	GIcon *icon_dir = g_icon_new_for_string("gtk-directory", NULL);
+	GtkTreeIter iter;
+	guint i;
+
+	dir_index_sort(dir);
+
+	for (i = 0; i < dir->dirs->len; i++)
+	{
+		gtk_tree_store_append(s_file_store, &iter, parent);
+		set_dir_row(&iter, dir->dirs->pdata[i], icon_dir);
+		row_index_add(child_key(key, dir->dirs->pdata[i]), &iter);
+	}
+
+	for (i = 0; i < dir->files->len; i++)
+	{
+		GIcon *icon = get_file_icon(dir->files->pdata[i]);
+
+		gtk_tree_store_append(s_file_store, &iter, parent);
+		gtk_tree_store_set(s_file_store, &iter,
+			FILEVIEW_COLUMN_ICON, icon,
+			FILEVIEW_COLUMN_NAME, dir->files->pdata[i], -1);
+		g_object_unref(icon);
+		row_index_add(child_key(key, dir->files->pdata[i]), &iter);
+	}
+
+	g_object_unref(icon_dir);
+}
+
+
+/* replaces the placeholder of a directory by its files */
+static void load_branch(GtkTreeIter *iter)
+{
+	GtkTreeIter placeholder;
+	DirIndex *dir;
+	gchar *key;
+
+	if (!has_placeholder(iter))
+		return;
+
+	key = build_index_key(iter);
+	dir = g_hash_table_lookup(s_dir_index, key);
+
+	/* removed last so that the row never becomes childless, which would
+	 * collapse it */
+	gtk_tree_model_iter_children(GTK_TREE_MODEL(s_file_store), &placeholder, iter);
+	if (dir)
+		create_branch(iter, key, dir);
+	gtk_tree_store_remove(s_file_store, &placeholder);
+	g_free(key);
+}
+
+
+static void load_branch_recursive(GtkTreeIter *iter)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(s_file_store);
+	GtkTreeIter child;
+	gboolean iterate;
+
+	if (iter)
+		load_branch(iter);
+
+	iterate = gtk_tree_model_iter_children(model, &child, iter);
+	while (iterate)
+	{
+		if (gtk_tree_model_iter_has_child(model, &child))
+			load_branch_recursive(&child);
+		iterate = gtk_tree_model_iter_next(model, &child);
+	}
+}
+
+
+static gboolean on_test_expand_row(G_GNUC_UNUSED GtkTreeView *tree_view, GtkTreeIter *iter,
+	G_GNUC_UNUSED GtkTreePath *path, G_GNUC_UNUSED gpointer user_data)
+{
+	load_branch(iter);
+	return FALSE;
+}
+
+
 static void on_expand_all(G_GNUC_UNUSED GtkMenuItem * menuitem, G_GNUC_UNUSED gpointer user_data)
 {
+	load_branch_recursive(NULL);
 	gtk_tree_view_expand_all(GTK_TREE_VIEW(s_file_view));
 }
 
@@ -219,57 +606,73 @@ static void on_follow_active(GtkToggleToolButton *button, G_GNUC_UNUSED gpointer
 }
 
 
-static void find_file_recursive(GtkTreeIter *iter, gboolean case_sensitive, gboolean full_path, GPatternSpec *pattern)
+static void file_paths_build(void)
 {
-	GtkTreeModel *model = GTK_TREE_MODEL(s_file_store);
-	GtkTreeIter child;
-	gboolean iterate;
+	GHashTableIter iter;
+	gpointer key, value;
 
-	iterate = gtk_tree_model_iter_children(model, &child, iter);
-	if (iterate)
+	s_file_paths = g_ptr_array_new();
+
+	g_hash_table_iter_init(&iter, s_dir_index);
+	while (g_hash_table_iter_next(&iter, &key, &value))
 	{
-		while (iterate)
-		{
-			find_file_recursive(&child, case_sensitive, full_path, pattern);
-			iterate = gtk_tree_model_iter_next(model, &child);
-		}
+		DirIndex *dir = value;
+		guint i;
+
+		for (i = 0; i < dir->files->len; i++)
+			g_ptr_array_add(s_file_paths, child_key(key, dir->files->pdata[i]));
 	}
-	else
-	{
-		gchar *name;
 
-		if (iter == NULL)
-			return;
+	g_ptr_array_sort(s_file_paths, compare_names);
+}
 
-		gtk_tree_model_get(GTK_TREE_MODEL(model), iter, FILEVIEW_COLUMN_NAME, &name, -1);
 
-		if (full_path)
-		{
-			gchar *path;
+/* matches the sorted paths of the files under the directory key rather than
+ * the tree, which only has the rows of the directories expanded so far */
+static void find_file_in_index(const gchar *key, gboolean case_sensitive, gboolean full_path, GPatternSpec *pattern)
+{
+	gchar *prefix = *key ? g_strconcat(key, G_DIR_SEPARATOR_S, NULL) : g_strdup("");
+	gsize prefix_len = strlen(prefix);
+	guint low = 0, high, i;
 
-			path = build_path(iter);
-			name = get_file_relative_path(geany_data->app->project->base_path, path);
-			g_free(path);
-		}
+	if (!s_file_paths)
+		file_paths_build();
+
+	/* the first path not sorting before the prefix */
+	high = s_file_paths->len;
+	while (low < high)
+	{
+		guint mid = (low + high) / 2;
+
+		if (strcmp(s_file_paths->pdata[mid], prefix) < 0)
+			low = mid + 1;
 		else
-			name = g_strdup(name);
+			high = mid;
+	}
+
+	for (i = low; i < s_file_paths->len; i++)
+	{
+		const gchar *rel_path = s_file_paths->pdata[i];
+		const gchar *base_name;
+		gchar *name;
+
+		if (strncmp(rel_path, prefix, prefix_len) != 0)
+			break;
+
+		base_name = strrchr(rel_path, G_DIR_SEPARATOR);
+		base_name = base_name ? base_name + 1 : rel_path;
 
+		name = g_strdup(full_path ? rel_path : base_name);
 		if (!case_sensitive)
 			setptr(name, g_utf8_strdown(name, -1));
 
 		if (g_pattern_match_string(pattern, name))
-		{
-			gchar *path, *rel_path;
-
-			path = build_path(iter);
-			rel_path = get_file_relative_path(geany_data->app->project->base_path, path);
-			msgwin_msg_add(COLOR_BLACK, -1, NULL, "./%s", rel_path ? rel_path : path);
-			g_free(path);
-			g_free(rel_path);
-		}
+			msgwin_msg_add(COLOR_BLACK, -1, NULL, "./%s", rel_path);
 
 		g_free(name);
 	}
+
+	g_free(prefix);
 }
 
 
@@ -284,6 +687,7 @@ static void find_file(GtkTreeIter *iter)
 	if (show_dialog_find_file(path, &pattern_str, &case_sensitive, &full_path) == GTK_RESPONSE_ACCEPT)
 	{
 		GPatternSpec *pattern;
+		gchar *key;
 
 		if (!case_sensitive)
 			setptr(pattern_str, g_utf8_strdown(pattern_str, -1));
@@ -292,7 +696,10 @@ static void find_file(GtkTreeIter *iter)
 
 		msgwin_clear_tab(MSG_MESSAGE);
 		msgwin_set_messages_dir(geany_data->app->project->base_path);
-		find_file_recursive(iter, case_sensitive, full_path, pattern);
+		key = build_index_key(iter);
+		find_file_in_index(key, case_sensitive, full_path, pattern);
+		g_free(key);
+		g_pattern_spec_free(pattern);
 		msgwin_switch_tab(MSG_MESSAGE, TRUE);
 	}
 
@@ -323,6 +730,23 @@ static void on_find_file(G_GNUC_UNUSED GtkMenuItem *menuitem, G_GNUC_UNUSED gpoi
 }
 
 
+static void on_parse_tags(G_GNUC_UNUSED GtkMenuItem *menuitem, G_GNUC_UNUSED gpointer user_data)
+{
+	GtkTreeSelection *treesel;
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	gchar *path;
+
+	treesel = gtk_tree_view_get_selection(GTK_TREE_VIEW(s_file_view));
+	if (!gtk_tree_selection_get_selected(treesel, &model, &iter))
+		return;
+
+	path = build_path(&iter);
+	gprj_project_request_file_tags(path);
+	g_free(path);
+}
+
+
 static void on_reload_project(G_GNUC_UNUSED GtkMenuItem *menuitem, G_GNUC_UNUSED gpointer user_data)
 {
 	gprj_project_rescan();
@@ -405,7 +829,10 @@ static void expand_all(G_GNUC_UNUSED GtkMenuItem *menuitem, G_GNUC_UNUSED gpoint
 	treesel = gtk_tree_view_get_selection(GTK_TREE_VIEW(s_file_view));
 
 	if (gtk_tree_selection_get_selected(treesel, &model, &iter))
+	{
+		load_branch_recursive(&iter);
 		gtk_tree_view_expand_row(GTK_TREE_VIEW(s_file_view), gtk_tree_model_get_path (model, &iter), TRUE);
+	}
 }
 
 
@@ -436,157 +863,86 @@ static void on_find_in_files(G_GNUC_UNUSED GtkMenuItem *menuitem, G_GNUC_UNUSED
 }
 
 
-static void build_file_list(gpointer name, G_GNUC_UNUSED gpointer value, GSList **lst)
+static void free_patterns(void)
 {
-	gchar *item;
-
-	item = get_file_relative_path(geany_data->app->project->base_path, name);
-	*lst = g_slist_prepend(*lst, item);
+	g_slist_foreach(s_header_patterns, (GFunc) g_pattern_spec_free, NULL);
+	g_slist_free(s_header_patterns);
+	s_header_patterns = NULL;
+	g_slist_foreach(s_source_patterns, (GFunc) g_pattern_spec_free, NULL);
+	g_slist_free(s_source_patterns);
+	s_source_patterns = NULL;
 }
 
 
-static void create_branch(gint level, GSList *leaf_list, GtkTreeIter *parent,
-	GSList *header_patterns, GSList *source_patterns)
+/* asks GeanyVC for the status of the project's working copy */
+static void refresh_vc_status(void)
 {
-	GSList *dir_list = NULL;
-	GSList *file_list = NULL;
-	GSList *elem;
+	gchar *locale_path;
 
-	for (elem = leaf_list; elem != NULL; elem = g_slist_next(elem))
-	{
-		gchar **path_arr = elem->data;
-
-		if (path_arr[level+1] != NULL)
-			dir_list = g_slist_prepend(dir_list, path_arr);
-		else
-			file_list = g_slist_prepend(file_list, path_arr);
-	}
-
-	if (dir_list)
-	{
-		GSList *tmp_list = NULL;
-		GtkTreeIter iter;
-		gchar **path_arr = dir_list->data;
-		gchar *last_dir_name;
-		GIcon *icon_dir = g_icon_new_for_string("gtk-directory", NULL);
-
-		last_dir_name = path_arr[level];
-
-		for (elem = dir_list; elem != NULL; elem = g_slist_next(elem))
-		{
-			gboolean dir_changed;
-
-			path_arr = (gchar **) elem->data;
-			dir_changed = g_strcmp0(last_dir_name, path_arr[level]) != 0;
-
-			if (dir_changed)
-			{
-				gtk_tree_store_append(s_file_store, &iter, parent);
-				gtk_tree_store_set(s_file_store, &iter,
-					FILEVIEW_COLUMN_ICON, icon_dir,
-					FILEVIEW_COLUMN_NAME, last_dir_name, -1);
-
-				create_branch(level+1, tmp_list, &iter, header_patterns, source_patterns);
+	if (!geany_data->app->project)
+		return;
 
-				g_slist_free(tmp_list);
-				tmp_list = NULL;
-				last_dir_name = path_arr[level];
-			}
+	locale_path = utils_get_locale_from_utf8(geany_data->app->project->base_path);
+	gp_vc_status_refresh(locale_path);
+	g_free(locale_path);
+}
 
-			tmp_list = g_slist_prepend(tmp_list, path_arr);
-		}
 
-		gtk_tree_store_append(s_file_store, &iter, parent);
-		gtk_tree_store_set(s_file_store, &iter,
-			FILEVIEW_COLUMN_ICON, icon_dir,
-			FILEVIEW_COLUMN_NAME, last_dir_name, -1);
+static void on_vc_status_changed(const gchar *root, G_GNUC_UNUSED gpointer user_data)
+{
+	if (root == NULL)
+		refresh_vc_status();
+	else
+		gtk_widget_queue_draw(s_file_view);
+}
 
-		create_branch(level+1, tmp_list, &iter, header_patterns, source_patterns);
 
-		g_slist_free(tmp_list);
-		g_slist_free(dir_list);
-		g_object_unref(icon_dir);
-	}
+static void badge_data_func(G_GNUC_UNUSED GtkTreeViewColumn *column, GtkCellRenderer *cell,
+	G_GNUC_UNUSED GtkTreeModel *model, GtkTreeIter *iter, G_GNUC_UNUSED gpointer data)
+{
+	const gchar *badge = NULL;
 
-	for (elem = file_list; elem != NULL; elem = g_slist_next(elem))
+	if (g_prj && geany_data->app->project && s_dir_index)
 	{
-		GtkTreeIter iter;
-		gchar **path_arr = elem->data;
-		GIcon *icon = NULL;
-		gchar *content_type = g_content_type_guess(path_arr[level], NULL, 0, NULL);
-
-		if (content_type)
-		{
-			icon = g_content_type_get_icon(content_type);
-			g_free(content_type);
-		}
-
-		gtk_tree_store_append(s_file_store, &iter, parent);
-		if (patterns_match(header_patterns, path_arr[level]))
-		{
-			if (! icon)
-				icon = g_icon_new_for_string("gproject-header", NULL);
+		gchar *path = build_path(iter);
+		gchar *locale_path = utils_get_locale_from_utf8(path);
 
-			gtk_tree_store_set(s_file_store, &iter,
-				FILEVIEW_COLUMN_ICON, icon,
-				FILEVIEW_COLUMN_NAME, path_arr[level], -1);
-		}
-		else if (patterns_match(source_patterns, path_arr[level]))
-		{
-			if (! icon)
-				icon = g_icon_new_for_string("gproject-source", NULL);
-
-			gtk_tree_store_set(s_file_store, &iter,
-				FILEVIEW_COLUMN_ICON, icon,
-				FILEVIEW_COLUMN_NAME, path_arr[level], -1);
-		}
-		else
-		{
-			if (! icon)
-				icon = g_icon_new_for_string("gproject-file", NULL);
-
-			gtk_tree_store_set(s_file_store, &iter,
-				FILEVIEW_COLUMN_ICON, icon,
-				FILEVIEW_COLUMN_NAME, path_arr[level], -1);
-		}
-
-		if (icon)
-			g_object_unref(icon);
+		badge = gp_vc_status_get_badge(gp_vc_status_get(locale_path));
+		g_free(locale_path);
+		g_free(path);
 	}
-
-	g_slist_free(file_list);
+	g_object_set(cell, "text", badge, "visible", badge != NULL, NULL);
 }
 
 
 static void load_project(void)
 {
-	GSList *lst = NULL;
-	GSList *path_list = NULL;
-	GSList *elem, *header_patterns, *source_patterns;
+	DirIndex *root;
 
 	gtk_tree_store_clear(s_file_store);
+	row_index_clear();
+	free_patterns();
 
 	if (!g_prj || !geany_data->app->project)
+	{
+		if (s_dir_index)
+			g_hash_table_destroy(s_dir_index);
+		s_dir_index = NULL;
+		file_paths_invalidate();
 		return;
+	}
 
-	header_patterns = get_precompiled_patterns(g_prj->header_patterns);
-	source_patterns = get_precompiled_patterns(g_prj->source_patterns);
+	s_header_patterns = get_precompiled_patterns(g_prj->header_patterns);
+	s_source_patterns = get_precompiled_patterns(g_prj->source_patterns);
 
-	g_hash_table_foreach(g_prj->file_tag_table, (GHFunc)build_file_list, &lst);
-	lst = g_slist_sort(lst, (GCompareFunc) strcmp);
+	index_rebuild();
+	root = g_hash_table_lookup(s_dir_index, "");
 
-	for (elem = lst; elem != NULL; elem = g_slist_next(elem))
+	if (root != NULL)
 	{
-		gchar **path_split;
-
-		path_split = g_strsplit_set(elem->data, "/\\", 0);
-		path_list = g_slist_prepend(path_list, path_split);
-	}
+		create_branch(NULL, "", root);
+		refresh_vc_status();
 
-	if (path_list != NULL)
-	{
-		create_branch(0, path_list, NULL, header_patterns, source_patterns);
-		
 		gtk_widget_set_sensitive(s_project_toolbar.expand, TRUE);
 		gtk_widget_set_sensitive(s_project_toolbar.collapse, TRUE);
 		gtk_widget_set_sensitive(s_project_toolbar.follow, TRUE);
@@ -603,53 +959,87 @@ static void load_project(void)
 		gtk_widget_set_sensitive(s_project_toolbar.collapse, FALSE);
 		gtk_widget_set_sensitive(s_project_toolbar.follow, FALSE);
 	}
-
-	g_slist_foreach(header_patterns, (GFunc) g_pattern_spec_free, NULL);
-	g_slist_free(header_patterns);
-	g_slist_foreach(source_patterns, (GFunc) g_pattern_spec_free, NULL);
-	g_slist_free(source_patterns);
-
-	g_slist_foreach(lst, (GFunc) g_free, NULL);
-	g_slist_free(lst);
-	g_slist_foreach(path_list, (GFunc) g_strfreev, NULL);
-	g_slist_free(path_list);
 }
 
 
-static gboolean find_in_tree(GtkTreeIter *parent, gchar **path_split, gint level, GtkTreeIter *ret)
+static gboolean find_child(GtkTreeIter *parent, const gchar *name, GtkTreeIter *ret)
 {
-	GtkTreeModel *model;
-	GtkTreeIter iter;
+	GtkTreeModel *model = GTK_TREE_MODEL(s_file_store);
 	gboolean iterate;
 
-	model = GTK_TREE_MODEL(s_file_store);
-
-	iterate = gtk_tree_model_iter_children(model, &iter, parent);
+	iterate = gtk_tree_model_iter_children(model, ret, parent);
 	while (iterate)
 	{
-		gchar *name;
+		gchar *iter_name;
+		gint cmp;
 
-		gtk_tree_model_get(model, &iter, FILEVIEW_COLUMN_NAME, &name, -1);
+		gtk_tree_model_get(model, ret, FILEVIEW_COLUMN_NAME, &iter_name, -1);
+		cmp = g_strcmp0(name, iter_name);
+		g_free(iter_name);
 
-		if (g_strcmp0(name, path_split[level]) == 0)
-		{
-			GtkTreeIter foo;
-			if (path_split[level+1] == NULL && !gtk_tree_model_iter_children (model, &foo, &iter))
-			{
-				*ret = iter;
-				return TRUE;
-			}
-			else
-				return find_in_tree(&iter, path_split, level + 1, ret);
-		}
+		if (cmp == 0)
+			return TRUE;
 
-		iterate = gtk_tree_model_iter_next(model, &iter);
+		iterate = gtk_tree_model_iter_next(model, ret);
 	}
 
 	return FALSE;
 }
 
 
+/* walks the tree, creating the rows of the directories on the way */
+static gboolean find_in_tree_walk(gchar **path_split, GtkTreeIter *ret)
+{
+	GtkTreeIter iter, parent;
+	gint level;
+
+	for (level = 0; path_split[level] != NULL; level++)
+	{
+		if (level > 0)
+			load_branch(&parent);
+		if (!find_child(level == 0 ? NULL : &parent, path_split[level], &iter))
+			return FALSE;
+		parent = iter;
+	}
+
+	*ret = iter;
+	return level > 0;
+}
+
+
+/* looks the rows up by their path, creating the rows of the directories on
+ * the way; the tree is only walked if a row is missing from the row index */
+static gboolean find_in_tree(gchar **path_split, GtkTreeIter *ret)
+{
+	GtkTreeIter *iter = NULL;
+	gint level;
+
+	if (!s_row_index)
+		return find_in_tree_walk(path_split, ret);
+
+	for (level = 0; path_split[level] != NULL; level++)
+	{
+		gchar *key;
+
+		if (level > 0)
+			load_branch(iter);
+
+		key = index_key(path_split, level + 1);
+		iter = g_hash_table_lookup(s_row_index, key);
+		g_free(key);
+
+		if (!iter)
+			return find_in_tree_walk(path_split, ret);
+	}
+
+	if (!iter)
+		return FALSE;
+
+	*ret = *iter;
+	return TRUE;
+}
+
+
 static void follow_editor(void)
 {
 	GtkTreeIter found_iter;
@@ -662,14 +1052,12 @@ static void follow_editor(void)
 	if (!doc || !doc->file_name || !geany_data->app->project)
 		return;
 
-	path = get_file_relative_path(geany_data->app->project->base_path, doc->file_name);
+	path = split_relative_path(doc->file_name, &path_split);
 
 	if (!path)
 		return;
 
-	path_split = g_strsplit_set(path, "/\\", 0);
-
-	if (find_in_tree(NULL, path_split, 0, &found_iter))
+	if (find_in_tree(path_split, &found_iter))
 	{
 		GtkTreePath *tree_path;
 		GtkTreeModel *model;
@@ -681,7 +1069,173 @@ static void follow_editor(void)
 		gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(s_file_view), tree_path,
 			NULL, FALSE, 0.0, 0.0);
 		gtk_tree_view_set_cursor(GTK_TREE_VIEW(s_file_view), tree_path, NULL, FALSE);
+		gtk_tree_path_free(tree_path);
+	}
+
+	g_strfreev(path_split);
+	g_free(path);
+}
+
+
+/* directories are sorted before files, both alphabetically; returns whether
+ * the row was inserted */
+static gboolean find_or_insert_child(GtkTreeIter *parent, const gchar *name, gboolean is_dir,
+	GtkTreeIter *ret)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(s_file_store);
+	GtkTreeIter iter;
+	gboolean iterate;
+
+	iterate = gtk_tree_model_iter_children(model, &iter, parent);
+	while (iterate)
+	{
+		gboolean iter_is_dir = gtk_tree_model_iter_has_child(model, &iter);
+		gchar *iter_name;
+		gint cmp;
+
+		gtk_tree_model_get(model, &iter, FILEVIEW_COLUMN_NAME, &iter_name, -1);
+		cmp = g_strcmp0(name, iter_name);
+		g_free(iter_name);
+
+		if (is_dir == iter_is_dir && cmp == 0)
+		{
+			*ret = iter;
+			return FALSE;
+		}
+
+		if ((is_dir && !iter_is_dir) || (is_dir == iter_is_dir && cmp < 0))
+			break;
+
+		iterate = gtk_tree_model_iter_next(model, &iter);
+	}
+
+	if (iterate)
+		gtk_tree_store_insert_before(s_file_store, ret, parent, &iter);
+	else
+		gtk_tree_store_append(s_file_store, ret, parent);
+
+	if (is_dir)
+	{
+		GIcon *icon_dir = g_icon_new_for_string("gtk-directory", NULL);
+
+		set_dir_row(ret, name, icon_dir);
+		g_object_unref(icon_dir);
+	}
+	else
+	{
+		GIcon *icon = get_file_icon(name);
+
+		gtk_tree_store_set(s_file_store, ret,
+			FILEVIEW_COLUMN_ICON, icon,
+			FILEVIEW_COLUMN_NAME, name, -1);
+		g_object_unref(icon);
+	}
+
+	return TRUE;
+}
+
+
+/* rows are only added to the directories already expanded, the others get
+ * the file from the index once expanded */
+static void add_file(const gchar *utf8_path)
+{
+	GtkTreeIter iter, parent;
+	gchar *rel_path;
+	gchar **path_split;
+	gint level;
+
+	rel_path = split_relative_path(utf8_path, &path_split);
+	if (!rel_path)
+		return;
+
+	index_add_file(path_split);
+
+	for (level = 0; path_split[level] != NULL; level++)
+	{
+		gboolean is_dir = path_split[level+1] != NULL;
+
+		if (level > 0 && has_placeholder(&parent))
+			break;
+		if (find_or_insert_child(level == 0 ? NULL : &parent, path_split[level],
+			is_dir, &iter))
+		{
+			row_index_add(index_key(path_split, level + 1), &iter);
+			if (is_dir)
+				break;
+		}
+		parent = iter;
+	}
+
+	g_strfreev(path_split);
+	g_free(rel_path);
+}
+
+
+static void remove_file(const gchar *utf8_path)
+{
+	GtkTreeIter iter, parent;
+	gchar *rel_path;
+	gchar **path_split;
+	gint level;
+
+	rel_path = split_relative_path(utf8_path, &path_split);
+	if (!rel_path)
+		return;
+
+	index_remove_file(path_split);
+
+	/* remove the row of the file, or of the topmost directory it left empty */
+	for (level = 0; path_split[level] != NULL; level++)
+	{
+		DirIndex *dir = NULL;
+
+		if (level > 0 && has_placeholder(&parent))
+			break;
+		if (!find_child(level == 0 ? NULL : &parent, path_split[level], &iter))
+			break;
+
+		if (path_split[level+1] != NULL)
+			dir = index_get_dir(path_split, level + 1, FALSE);
+		if (!dir)
+		{
+			gchar *key = index_key(path_split, level + 1);
+
+			row_index_remove(key);
+			g_free(key);
+			gtk_tree_store_remove(s_file_store, &iter);
+			break;
+		}
+		parent = iter;
 	}
+
+	g_strfreev(path_split);
+	g_free(rel_path);
+}
+
+
+/* Applies the changes of the project file list without rebuilding the whole
+ * tree unless there are too many of them. */
+void gprj_sidebar_update_files(GPtrArray *added, GPtrArray *removed)
+{
+	guint i;
+
+	if (!g_prj || !geany_data->app->project)
+		return;
+
+	if (!gtk_widget_get_sensitive(s_project_toolbar.expand) || !s_dir_index ||
+		added->len + removed->len > MAX_INCREMENTAL_UPDATES ||
+		g_hash_table_size(g_prj->file_tag_table) == 0)
+	{
+		gprj_sidebar_update(TRUE);
+		return;
+	}
+
+	for (i = 0; i < removed->len; i++)
+		remove_file(removed->pdata[i]);
+	for (i = 0; i < added->len; i++)
+		add_file(added->pdata[i]);
+
+	gprj_sidebar_update(FALSE);
 }
 
 
@@ -793,6 +1347,12 @@ void gprj_sidebar_init(void)
 	gtk_tree_view_column_pack_start(column, renderer, TRUE);
 	gtk_tree_view_column_set_attributes(column, renderer, "text", FILEVIEW_COLUMN_NAME, NULL);
 
+	/* the version control status of the row, as GeanyVC publishes it */
+	renderer = gtk_cell_renderer_text_new();
+	g_object_set(renderer, "weight", PANGO_WEIGHT_BOLD, NULL);
+	gtk_tree_view_column_pack_start(column, renderer, FALSE);
+	gtk_tree_view_column_set_cell_data_func(column, renderer, badge_data_func, NULL, NULL);
+
 	gtk_tree_view_append_column(GTK_TREE_VIEW(s_file_view), column);
 
 	gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(s_file_view), FALSE);
@@ -812,6 +1372,8 @@ void gprj_sidebar_init(void)
 			G_CALLBACK(on_button_press), NULL);
 	g_signal_connect(G_OBJECT(s_file_view), "key-press-event",
 			G_CALLBACK(on_key_press), NULL);
+	g_signal_connect(G_OBJECT(s_file_view), "test-expand-row",
+			G_CALLBACK(on_test_expand_row), NULL);
 
 	/**** popup menu ****/
 
@@ -844,6 +1406,11 @@ void gprj_sidebar_init(void)
 	g_signal_connect((gpointer) item, "activate", G_CALLBACK(on_find_file), NULL);
 	s_popup_menu.find_file = item;
 
+	item = gtk_menu_item_new_with_mnemonic(_("_Parse Tags"));
+	gtk_widget_show(item);
+	gtk_container_add(GTK_CONTAINER(s_popup_menu.widget), item);
+	g_signal_connect((gpointer) item, "activate", G_CALLBACK(on_parse_tags), NULL);
+
 	item = gtk_separator_menu_item_new();
 	gtk_widget_show(item);
 	gtk_container_add(GTK_CONTAINER(s_popup_menu.widget), item);
@@ -870,6 +1437,8 @@ void gprj_sidebar_init(void)
 	gtk_widget_show_all(s_file_view_vbox);
 	gtk_notebook_append_page(GTK_NOTEBOOK(geany->main_widgets->sidebar_notebook),
 				 s_file_view_vbox, gtk_label_new(_("Project")));
+
+	s_vc_status_subscription = gp_vc_status_subscribe(on_vc_status_changed, NULL);
 }
 
 
@@ -881,5 +1450,16 @@ void gprj_sidebar_activate(gboolean activate)
 
 void gprj_sidebar_cleanup(void)
 {
+	gp_vc_status_unsubscribe(s_vc_status_subscription);
+	s_vc_status_subscription = 0;
 	gtk_widget_destroy(s_file_view_vbox);
+
+	if (s_dir_index)
+		g_hash_table_destroy(s_dir_index);
+	s_dir_index = NULL;
+	if (s_row_index)
+		g_hash_table_destroy(s_row_index);
+	s_row_index = NULL;
+	file_paths_invalidate();
+	free_patterns();
 }
@@ -27,6 +27,7 @@ void gprj_sidebar_activate(gboolean activate);
 void gprj_sidebar_find_file_in_active(void);
 
 void gprj_sidebar_update(gboolean reload);
+void gprj_sidebar_update_files(GPtrArray *added, GPtrArray *removed);
 
 
 
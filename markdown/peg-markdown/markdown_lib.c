@@ -130,7 +130,6 @@ static element * process_raw_blocks(element *input, int extensions, element *ref
                     last_child = last_child->next;
                 last_child->next = parse_markdown(contents, extensions, references, notes);
             }
-            free(current->contents.str);
             current->contents.str = NULL;
         }
         if (current->children != NULL)
@@ -162,8 +161,7 @@ GString * markdown_to_g_string(char *text, int extensions, int output_format) {
 
     print_element_list(out, result, output_format, extensions);
 
-    free_element_list(result);
-    free_element_list(references);
+    arena_reset();  /* elements, references and notes all live in the arena */
     return out;
 }
 
@@ -65,8 +65,7 @@ typedef struct Element element;
 element * parse_references(char *string, int extensions);
 element * parse_notes(char *string, int extensions, element *reference_list);
 element * parse_markdown(char *string, int extensions, element *reference_list, element *note_list);
-void free_element_list(element * elt);
-void free_element(element *elt);
+void arena_reset(void);
 void print_element_list(GString *out, element *elt, int format, int exts);
 
 #endif
@@ -1,5 +1,5 @@
-/* parsing_functions.c - Functions for parsing markdown and
- * freeing element lists. */
+/* parsing_functions.c - Functions for parsing markdown.
+ * Elements are allocated from the arena and released by arena_reset. */
 
 /* These yy_* functions come from markdown_parser.c which is
  * generated from markdown_parser.leg
@@ -16,59 +16,6 @@ extern int yy_Doc();
 #include "parsing_functions.h"
 #include "markdown_peg.h"
 
-static void free_element_contents(element elt);
-
-/* free_element_list - free list of elements recursively */
-void free_element_list(element * elt) {
-    element * next = NULL;
-    while (elt != NULL) {
-        next = elt->next;
-        free_element_contents(*elt);
-        if (elt->children != NULL) {
-            free_element_list(elt->children);
-            elt->children = NULL;
-        }
-        free(elt);
-        elt = next;
-    }
-}
-
-/* free_element_contents - free element contents depending on type */
-static void free_element_contents(element elt) {
-    switch (elt.key) {
-      case STR:
-      case SPACE:
-      case RAW:
-      case HTMLBLOCK:
-      case HTML:
-      case VERBATIM:
-      case CODE:
-      case NOTE:
-        free(elt.contents.str);
-        elt.contents.str = NULL;
-        break;
-      case LINK:
-      case IMAGE:
-      case REFERENCE:
-        free(elt.contents.link->url);
-        elt.contents.link->url = NULL;
-        free(elt.contents.link->title);
-        elt.contents.link->title = NULL;
-        free_element_list(elt.contents.link->label);
-        free(elt.contents.link);
-        elt.contents.link = NULL;
-        break;
-      default:
-        ;
-    }
-}
-
-/* free_element - free element and contents */
-void free_element(element *elt) {
-    free_element_contents(*elt);
-    free(elt);
-}
-
 element * parse_references(char *string, int extensions) {
 
     char *oldcharbuf;
@@ -325,7 +325,12 @@ static void Rule_compile_c2(Node *node)
 
       safe= ((Query == node->rule.expression->type) || (Star == node->rule.expression->type));
 
-      fprintf(output, "\nYY_RULE(int) yy_%s(yycontext *ctx)\n{", node->rule.name);
+      /* a memoized rule is compiled under another name and called from a wrapper
+	 which replays the result of an earlier call at the same position */
+      if (RuleMemo & node->rule.flags)
+	fprintf(output, "\nYY_LOCAL(int) yym_%s(yycontext *ctx)\n{", node->rule.name);
+      else
+	fprintf(output, "\nYY_RULE(int) yy_%s(yycontext *ctx)\n{", node->rule.name);
       if (!safe) save(0);
       if (node->rule.variables)
 	fprintf(output, "  yyDo(ctx, yyPush, %d, 0);", countVariables(node->rule.variables));
@@ -343,6 +348,22 @@ static void Rule_compile_c2(Node *node)
 	  fprintf(output, "\n  return 0;");
 	}
       fprintf(output, "\n}");
+      if (RuleMemo & node->rule.flags)
+	{
+	  fprintf(output, "\n\nYY_RULE(int) yy_%s(yycontext *ctx)\n{", node->rule.name);
+	  fprintf(output, "\n  int yypos0= ctx->pos, yythunkpos0= ctx->thunkpos, yybegin0= ctx->begin, yyend0= ctx->end, yymarked0= ctx->memomarked, yyok;");
+	  fprintf(output, "\n  if (yyMemoReplay(ctx, %d, &yyok))", node->rule.id);
+	  fprintf(output, "\n    yyprintf((stderr, \"  memo %%s %%s @ %%s\\n\", yyok ? \"ok\" : \"fail\", \"%s\", ctx->buf+yypos0));", node->rule.name);
+	  fprintf(output, "\n  else");
+	  fprintf(output, "\n    {");
+	  fprintf(output, "\n      ctx->begin= ctx->end= YY_MEMO_MARK;");
+	  fprintf(output, "\n      yyok= yym_%s(ctx);", node->rule.name);
+	  fprintf(output, "\n      yyMemoStore(ctx, %d, yypos0, yythunkpos0, yymarked0, yyok);", node->rule.id);
+	  fprintf(output, "\n    }");
+	  fprintf(output, "\n  yyMemoMarks(ctx, yymarked0, yybegin0, yyend0);");
+	  fprintf(output, "\n  return yyok;");
+	  fprintf(output, "\n}");
+	}
     }
 
   if (node->rule.next)
@@ -403,6 +424,20 @@ typedef struct _yycontext yycontext;\n\
 typedef void (*yyaction)(yycontext *ctx, char *yytext, int yyleng);\n\
 typedef struct _yythunk { int begin, end;  yyaction  action;  struct _yythunk *next; } yythunk;\n\
 \n\
+#ifdef YYMEMOCOUNT\n\
+#define YY_MEMO_MARK		(-0x40000000)\n\
+#define YY_MEMO_MAXTHUNKS	256\n\
+typedef struct _yymemo {\n\
+  int       generation;	/* in use if the one of the context */\n\
+  int       rule;\n\
+  int       pos;\n\
+  int       ok;			/* -1 for a match which is not stored */\n\
+  int       endpos, begin, end;\n\
+  int       thunkpos, thunkcount;	/* the thunks of a match, in memothunks */\n\
+  int       marked;		/* whether they hold YY_MEMO_MARK */\n\
+} yymemo;\n\
+#endif\n\
+\n\
 struct _yycontext {\n\
   char     *buf;\n\
   int       buflen;\n\
@@ -420,6 +455,18 @@ struct _yycontext {\n\
   YYSTYPE  *val;\n\
   YYSTYPE  *vals;\n\
   int       valslen;\n\
+#ifdef YYMEMOCOUNT\n\
+  yymemo   *memos;\n\
+  int       memoslen;\n\
+  int       memoscount;\n\
+  int       memogeneration;\n\
+  yythunk  *memothunks;\n\
+  int       memothunkslen;\n\
+  int       memothunkpos;\n\
+  int      *memomarks;		/* the thunks which may hold YY_MEMO_MARK */\n\
+  int       memomarkslen;\n\
+  int       memomarked;\n\
+#endif\n\
 #ifdef YY_CTX_MEMBERS\n\
   YY_CTX_MEMBERS\n\
 #endif\n\
@@ -505,6 +552,18 @@ YY_LOCAL(int) yymatchClass(yycontext *ctx, unsigned char *bits)\n\
   return 0;\n\
 }\n\
 \n\
+#ifdef YYMEMOCOUNT\n\
+YY_LOCAL(void) yyMemoPushMark(yycontext *ctx, int thunkpos)\n\
+{\n\
+  while (ctx->memomarked >= ctx->memomarkslen)\n\
+    {\n\
+      ctx->memomarkslen *= 2;\n\
+      ctx->memomarks= (int *)realloc(ctx->memomarks, sizeof(int) * ctx->memomarkslen);\n\
+    }\n\
+  ctx->memomarks[ctx->memomarked++]= thunkpos;\n\
+}\n\
+#endif\n\
+\n\
 YY_LOCAL(void) yyDo(yycontext *ctx, yyaction action, int begin, int end)\n\
 {\n\
   while (ctx->thunkpos >= ctx->thunkslen)\n\
@@ -516,6 +575,10 @@ YY_LOCAL(void) yyDo(yycontext *ctx, yyaction action, int begin, int end)\n\
   ctx->thunks[ctx->thunkpos].end=    end;\n\
   ctx->thunks[ctx->thunkpos].action= action;\n\
   ++ctx->thunkpos;\n\
+#ifdef YYMEMOCOUNT\n\
+  if (YY_MEMO_MARK == begin || YY_MEMO_MARK == end)\n\
+    yyMemoPushMark(ctx, ctx->thunkpos - 1);\n\
+#endif\n\
 }\n\
 \n\
 YY_LOCAL(int) yyText(yycontext *ctx, int begin, int end)\n\
@@ -549,12 +612,151 @@ YY_LOCAL(void) yyDone(yycontext *ctx)\n\
   ctx->thunkpos= 0;\n\
 }\n\
 \n\
+#ifdef YYMEMOCOUNT\n\
+\n\
+/* Results of the memoized rules, by rule and position.  They are valid until\n\
+   the buffer is committed, which moves the positions.  A memoized rule runs\n\
+   with the text markers set to YY_MEMO_MARK: the thunks and markers which\n\
+   still hold it refer to the caller's markers, whatever they are when the\n\
+   result is used.  Predicates of a memoized rule only see the text marked\n\
+   by the rule itself.  A match is only stored once the rule is called at its\n\
+   position again, most matches are never backtracked over and copying their\n\
+   thunks would be wasted, and not at all when it holds more than\n\
+   YY_MEMO_MAXTHUNKS thunks: nested rules would copy them again at each level. */\n\
+\n\
+YY_LOCAL(void) yyMemoClear(yycontext *ctx)\n\
+{\n\
+  if (ctx->memoscount && ++ctx->memogeneration == 0)\n\
+    {\n\
+      memset(ctx->memos, 0, sizeof(yymemo) * ctx->memoslen);\n\
+      ctx->memogeneration= 1;\n\
+    }\n\
+  ctx->memoscount= ctx->memothunkpos= ctx->memomarked= 0;\n\
+}\n\
+\n\
+YY_LOCAL(yymemo *) yyMemoSlot(yycontext *ctx, int rule, int pos)\n\
+{\n\
+  unsigned int mask= ctx->memoslen - 1;\n\
+  unsigned int i= ((unsigned int)pos * 2654435761u + (unsigned int)rule) & mask;\n\
+  while (ctx->memos[i].generation == ctx->memogeneration && (ctx->memos[i].rule != rule || ctx->memos[i].pos != pos))\n\
+    i= (i + 1) & mask;\n\
+  return &ctx->memos[i];\n\
+}\n\
+\n\
+YY_LOCAL(void) yyMemoGrow(yycontext *ctx)\n\
+{\n\
+  yymemo *old= ctx->memos;\n\
+  int oldlen= ctx->memoslen, i;\n\
+  ctx->memoslen *= 2;\n\
+  ctx->memos= (yymemo *)calloc(ctx->memoslen, sizeof(yymemo));\n\
+  for (i= 0;  i < oldlen;  ++i)\n\
+    if (old[i].generation == ctx->memogeneration)\n\
+      *yyMemoSlot(ctx, old[i].rule, old[i].pos)= old[i];\n\
+  free(old);\n\
+}\n\
+\n\
+YY_LOCAL(int) yyMemoReplay(yycontext *ctx, int rule, int *ok)\n\
+{\n\
+  yymemo *memo= yyMemoSlot(ctx, rule, ctx->pos);\n\
+  if (memo->generation != ctx->memogeneration || memo->ok < 0)\n\
+    return 0;\n\
+  if ((*ok= memo->ok))\n\
+    {\n\
+      while (ctx->thunkpos + memo->thunkcount >= ctx->thunkslen)\n\
+	{\n\
+	  ctx->thunkslen *= 2;\n\
+	  ctx->thunks= (yythunk *)realloc(ctx->thunks, sizeof(yythunk) * ctx->thunkslen);\n\
+	}\n\
+      memcpy(ctx->thunks + ctx->thunkpos, ctx->memothunks + memo->thunkpos, sizeof(yythunk) * memo->thunkcount);\n\
+      if (memo->marked)\n\
+	{\n\
+	  int i;\n\
+	  for (i= ctx->thunkpos;  i < ctx->thunkpos + memo->thunkcount;  ++i)\n\
+	    if (YY_MEMO_MARK == ctx->thunks[i].begin || YY_MEMO_MARK == ctx->thunks[i].end)\n\
+	      yyMemoPushMark(ctx, i);\n\
+	}\n\
+      ctx->thunkpos += memo->thunkcount;\n\
+      ctx->pos= memo->endpos;\n\
+    }\n\
+  ctx->begin= memo->begin;\n\
+  ctx->end= memo->end;\n\
+  return 1;\n\
+}\n\
+\n\
+YY_LOCAL(void) yyMemoStore(yycontext *ctx, int rule, int pos, int thunkpos, int marked, int ok)\n\
+{\n\
+  yymemo *memo;\n\
+  int count= ok ? ctx->thunkpos - thunkpos : 0;\n\
+  if (2 * (ctx->memoscount + 1) > ctx->memoslen)\n\
+    yyMemoGrow(ctx);\n\
+  memo= yyMemoSlot(ctx, rule, pos);\n\
+  if (memo->generation != ctx->memogeneration)\n\
+    {\n\
+      ++ctx->memoscount;\n\
+      if (count)\n\
+	{\n\
+	  memo->generation= ctx->memogeneration;\n\
+	  memo->rule= rule;\n\
+	  memo->pos= pos;\n\
+	  memo->ok= -1;\n\
+	  return;\n\
+	}\n\
+    }\n\
+  if (count > YY_MEMO_MAXTHUNKS)\n\
+    return;\n\
+  while (ctx->memothunkpos + count >= ctx->memothunkslen)\n\
+    {\n\
+      ctx->memothunkslen *= 2;\n\
+      ctx->memothunks= (yythunk *)realloc(ctx->memothunks, sizeof(yythunk) * ctx->memothunkslen);\n\
+    }\n\
+  memcpy(ctx->memothunks + ctx->memothunkpos, ctx->thunks + thunkpos, sizeof(yythunk) * count);\n\
+  memo->generation= ctx->memogeneration;\n\
+  memo->rule= rule;\n\
+  memo->pos= pos;\n\
+  memo->ok= ok;\n\
+  memo->endpos= ctx->pos;\n\
+  memo->begin= ctx->begin;\n\
+  memo->end= ctx->end;\n\
+  memo->thunkpos= ctx->memothunkpos;\n\
+  memo->thunkcount= count;\n\
+  memo->marked= ctx->memomarked != marked;\n\
+  ctx->memothunkpos += count;\n\
+}\n\
+\n\
+/* Gives the caller's markers to the thunks and markers of a memoized rule which refer to them */\n\
+YY_LOCAL(void) yyMemoMarks(yycontext *ctx, int marked, int begin, int end)\n\
+{\n\
+  int i, j;\n\
+  if (YY_MEMO_MARK != begin || YY_MEMO_MARK != end)\n\
+    {\n\
+      for (i= j= marked;  i < ctx->memomarked;  ++i)\n\
+	{\n\
+	  yythunk *thunk;\n\
+	  if (ctx->memomarks[i] >= ctx->thunkpos)\n\
+	    continue;	/* backtracked over */\n\
+	  thunk= &ctx->thunks[ctx->memomarks[i]];\n\
+	  if (YY_MEMO_MARK == thunk->begin) thunk->begin= begin;\n\
+	  if (YY_MEMO_MARK == thunk->end)   thunk->end= end;\n\
+	  if (YY_MEMO_MARK == thunk->begin || YY_MEMO_MARK == thunk->end)\n\
+	    ctx->memomarks[j++]= ctx->memomarks[i];\n\
+	}\n\
+      ctx->memomarked= j;\n\
+    }\n\
+  if (YY_MEMO_MARK == ctx->begin) ctx->begin= begin;\n\
+  if (YY_MEMO_MARK == ctx->end)   ctx->end= end;\n\
+}\n\
+\n\
+#endif\n\
+\n\
 YY_LOCAL(void) yyCommit(yycontext *ctx)\n\
 {\n\
   if ((ctx->limit -= ctx->pos))\n\
     {\n\
       memmove(ctx->buf, ctx->buf + ctx->pos, ctx->limit);\n\
     }\n\
+#ifdef YYMEMOCOUNT\n\
+  yyMemoClear(ctx);\n\
+#endif\n\
   ctx->begin -= ctx->pos;\n\
   ctx->end -= ctx->pos;\n\
   ctx->pos= ctx->thunkpos= 0;\n\
@@ -575,7 +777,17 @@ YY_LOCAL(int) yyAccept(yycontext *ctx, int tp0)\n\
   return 1;\n\
 }\n\
 \n\
-YY_LOCAL(void) yyPush(yycontext *ctx, char *text, int count)  { ctx->val += count; }\n\
+YY_LOCAL(void) yyPush(yycontext *ctx, char *text, int count)\n\
+{\n\
+  ctx->val += count;\n\
+  while (ctx->valslen <= ctx->val - ctx->vals)\n\
+    {\n\
+      long offset= ctx->val - ctx->vals;\n\
+      ctx->valslen *= 2;\n\
+      ctx->vals= (YYSTYPE *)realloc(ctx->vals, sizeof(YYSTYPE) * ctx->valslen);\n\
+      ctx->val= ctx->vals + offset;\n\
+    }\n\
+}\n\
 YY_LOCAL(void) yyPop(yycontext *ctx, char *text, int count)   { ctx->val -= count; }\n\
 YY_LOCAL(void) yySet(yycontext *ctx, char *text, int count)   { ctx->val[count]= ctx->yy; }\n\
 \n\
@@ -605,7 +817,21 @@ YY_PARSE(int) YYPARSEFROM(YY_CTX_PARAM_ yyrule yystart)\n\
       yyctx->valslen= 32;\n\
       yyctx->vals= (YYSTYPE *)malloc(sizeof(YYSTYPE) * yyctx->valslen);\n\
       yyctx->begin= yyctx->end= yyctx->pos= yyctx->limit= yyctx->thunkpos= 0;\n\
+#ifdef YYMEMOCOUNT\n\
+      yyctx->memoslen= 1024;\n\
+      yyctx->memos= (yymemo *)calloc(yyctx->memoslen, sizeof(yymemo));\n\
+      yyctx->memoscount= 0;\n\
+      yyctx->memogeneration= 1;\n\
+      yyctx->memothunkslen= 1024;\n\
+      yyctx->memothunks= (yythunk *)malloc(sizeof(yythunk) * yyctx->memothunkslen);\n\
+      yyctx->memothunkpos= 0;\n\
+      yyctx->memomarkslen= 1024;\n\
+      yyctx->memomarks= (int *)malloc(sizeof(int) * yyctx->memomarkslen);\n\
+#endif\n\
     }\n\
+#ifdef YYMEMOCOUNT\n\
+  yyMemoClear(yyctx);\n\
+#endif\n\
   yyctx->begin= yyctx->end= yyctx->pos;\n\
   yyctx->thunkpos= 0;\n\
   yyctx->val= yyctx->vals;\n\
@@ -623,12 +849,24 @@ YY_PARSE(int) YYPARSE(YY_CTX_PARAM)\n\
 #endif\n\
 ";
 
+static int memoCount(void)
+{
+  Node *n;
+  int count= 0;
+  for (n= rules;  n;  n= n->rule.next)
+    if (RuleMemo & n->rule.flags)
+      ++count;
+  return count;
+}
+
 void Rule_compile_c_header(void)
 {
   fprintf(output, "/* A recursive-descent parser generated by peg %d.%d.%d */\n", PEG_MAJOR, PEG_MINOR, PEG_LEVEL);
   fprintf(output, "\n");
   fprintf(output, "%s", header);
   fprintf(output, "#define YYRULECOUNT %d\n", ruleCount);
+  if (memoCount())
+    fprintf(output, "#define YYMEMOCOUNT %d\n", memoCount());
 }
 
 int consumesInput(Node *node)
@@ -3,7 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#define YYRULECOUNT 36
+#define YYRULECOUNT 37
 
 # include "tree.h"
 # include "version.h"
@@ -93,6 +93,20 @@ typedef struct _yycontext yycontext;
 typedef void (*yyaction)(yycontext *ctx, char *yytext, int yyleng);
 typedef struct _yythunk { int begin, end;  yyaction  action;  struct _yythunk *next; } yythunk;
 
+#ifdef YYMEMOCOUNT
+#define YY_MEMO_MARK		(-0x40000000)
+#define YY_MEMO_MAXTHUNKS	256
+typedef struct _yymemo {
+  int       generation;	/* in use if the one of the context */
+  int       rule;
+  int       pos;
+  int       ok;			/* -1 for a match which is not stored */
+  int       endpos, begin, end;
+  int       thunkpos, thunkcount;	/* the thunks of a match, in memothunks */
+  int       marked;		/* whether they hold YY_MEMO_MARK */
+} yymemo;
+#endif
+
 struct _yycontext {
   char     *buf;
   int       buflen;
@@ -110,6 +124,18 @@ struct _yycontext {
   YYSTYPE  *val;
   YYSTYPE  *vals;
   int       valslen;
+#ifdef YYMEMOCOUNT
+  yymemo   *memos;
+  int       memoslen;
+  int       memoscount;
+  int       memogeneration;
+  yythunk  *memothunks;
+  int       memothunkslen;
+  int       memothunkpos;
+  int      *memomarks;		/* the thunks which may hold YY_MEMO_MARK */
+  int       memomarkslen;
+  int       memomarked;
+#endif
 #ifdef YY_CTX_MEMBERS
   YY_CTX_MEMBERS
 #endif
@@ -195,6 +221,18 @@ YY_LOCAL(int) yymatchClass(yycontext *ctx, unsigned char *bits)
   return 0;
 }
 
+#ifdef YYMEMOCOUNT
+YY_LOCAL(void) yyMemoPushMark(yycontext *ctx, int thunkpos)
+{
+  while (ctx->memomarked >= ctx->memomarkslen)
+    {
+      ctx->memomarkslen *= 2;
+      ctx->memomarks= (int *)realloc(ctx->memomarks, sizeof(int) * ctx->memomarkslen);
+    }
+  ctx->memomarks[ctx->memomarked++]= thunkpos;
+}
+#endif
+
 YY_LOCAL(void) yyDo(yycontext *ctx, yyaction action, int begin, int end)
 {
   while (ctx->thunkpos >= ctx->thunkslen)
@@ -206,6 +244,10 @@ YY_LOCAL(void) yyDo(yycontext *ctx, yyaction action, int begin, int end)
   ctx->thunks[ctx->thunkpos].end=    end;
   ctx->thunks[ctx->thunkpos].action= action;
   ++ctx->thunkpos;
+#ifdef YYMEMOCOUNT
+  if (YY_MEMO_MARK == begin || YY_MEMO_MARK == end)
+    yyMemoPushMark(ctx, ctx->thunkpos - 1);
+#endif
 }
 
 YY_LOCAL(int) yyText(yycontext *ctx, int begin, int end)
@@ -239,12 +281,151 @@ YY_LOCAL(void) yyDone(yycontext *ctx)
   ctx->thunkpos= 0;
 }
 
+#ifdef YYMEMOCOUNT
+
+/* Results of the memoized rules, by rule and position.  They are valid until
+   the buffer is committed, which moves the positions.  A memoized rule runs
+   with the text markers set to YY_MEMO_MARK: the thunks and markers which
+   still hold it refer to the caller's markers, whatever they are when the
+   result is used.  Predicates of a memoized rule only see the text marked
+   by the rule itself.  A match is only stored once the rule is called at its
+   position again, most matches are never backtracked over and copying their
+   thunks would be wasted, and not at all when it holds more than
+   YY_MEMO_MAXTHUNKS thunks: nested rules would copy them again at each level. */
+
+YY_LOCAL(void) yyMemoClear(yycontext *ctx)
+{
+  if (ctx->memoscount && ++ctx->memogeneration == 0)
+    {
+      memset(ctx->memos, 0, sizeof(yymemo) * ctx->memoslen);
+      ctx->memogeneration= 1;
+    }
+  ctx->memoscount= ctx->memothunkpos= ctx->memomarked= 0;
+}
+
+YY_LOCAL(yymemo *) yyMemoSlot(yycontext *ctx, int rule, int pos)
+{
+  unsigned int mask= ctx->memoslen - 1;
+  unsigned int i= ((unsigned int)pos * 2654435761u + (unsigned int)rule) & mask;
+  while (ctx->memos[i].generation == ctx->memogeneration && (ctx->memos[i].rule != rule || ctx->memos[i].pos != pos))
+    i= (i + 1) & mask;
+  return &ctx->memos[i];
+}
+
+YY_LOCAL(void) yyMemoGrow(yycontext *ctx)
+{
+  yymemo *old= ctx->memos;
+  int oldlen= ctx->memoslen, i;
+  ctx->memoslen *= 2;
+  ctx->memos= (yymemo *)calloc(ctx->memoslen, sizeof(yymemo));
+  for (i= 0;  i < oldlen;  ++i)
+    if (old[i].generation == ctx->memogeneration)
+      *yyMemoSlot(ctx, old[i].rule, old[i].pos)= old[i];
+  free(old);
+}
+
+YY_LOCAL(int) yyMemoReplay(yycontext *ctx, int rule, int *ok)
+{
+  yymemo *memo= yyMemoSlot(ctx, rule, ctx->pos);
+  if (memo->generation != ctx->memogeneration || memo->ok < 0)
+    return 0;
+  if ((*ok= memo->ok))
+    {
+      while (ctx->thunkpos + memo->thunkcount >= ctx->thunkslen)
+	{
+	  ctx->thunkslen *= 2;
+	  ctx->thunks= (yythunk *)realloc(ctx->thunks, sizeof(yythunk) * ctx->thunkslen);
+	}
+      memcpy(ctx->thunks + ctx->thunkpos, ctx->memothunks + memo->thunkpos, sizeof(yythunk) * memo->thunkcount);
+      if (memo->marked)
+	{
+	  int i;
+	  for (i= ctx->thunkpos;  i < ctx->thunkpos + memo->thunkcount;  ++i)
+	    if (YY_MEMO_MARK == ctx->thunks[i].begin || YY_MEMO_MARK == ctx->thunks[i].end)
+	      yyMemoPushMark(ctx, i);
+	}
+      ctx->thunkpos += memo->thunkcount;
+      ctx->pos= memo->endpos;
+    }
+  ctx->begin= memo->begin;
+  ctx->end= memo->end;
+  return 1;
+}
+
+YY_LOCAL(void) yyMemoStore(yycontext *ctx, int rule, int pos, int thunkpos, int marked, int ok)
+{
+  yymemo *memo;
+  int count= ok ? ctx->thunkpos - thunkpos : 0;
+  if (2 * (ctx->memoscount + 1) > ctx->memoslen)
+    yyMemoGrow(ctx);
+  memo= yyMemoSlot(ctx, rule, pos);
+  if (memo->generation != ctx->memogeneration)
+    {
+      ++ctx->memoscount;
+      if (count)
+	{
+	  memo->generation= ctx->memogeneration;
+	  memo->rule= rule;
+	  memo->pos= pos;
+	  memo->ok= -1;
+	  return;
+	}
+    }
+  if (count > YY_MEMO_MAXTHUNKS)
+    return;
+  while (ctx->memothunkpos + count >= ctx->memothunkslen)
+    {
+      ctx->memothunkslen *= 2;
+      ctx->memothunks= (yythunk *)realloc(ctx->memothunks, sizeof(yythunk) * ctx->memothunkslen);
+    }
+  memcpy(ctx->memothunks + ctx->memothunkpos, ctx->thunks + thunkpos, sizeof(yythunk) * count);
+  memo->generation= ctx->memogeneration;
+  memo->rule= rule;
+  memo->pos= pos;
+  memo->ok= ok;
+  memo->endpos= ctx->pos;
+  memo->begin= ctx->begin;
+  memo->end= ctx->end;
+  memo->thunkpos= ctx->memothunkpos;
+  memo->thunkcount= count;
+  memo->marked= ctx->memomarked != marked;
+  ctx->memothunkpos += count;
+}
+
+/* Gives the caller's markers to the thunks and markers of a memoized rule which refer to them */
+YY_LOCAL(void) yyMemoMarks(yycontext *ctx, int marked, int begin, int end)
+{
+  int i, j;
+  if (YY_MEMO_MARK != begin || YY_MEMO_MARK != end)
+    {
+      for (i= j= marked;  i < ctx->memomarked;  ++i)
+	{
+	  yythunk *thunk;
+	  if (ctx->memomarks[i] >= ctx->thunkpos)
+	    continue;	/* backtracked over */
+	  thunk= &ctx->thunks[ctx->memomarks[i]];
+	  if (YY_MEMO_MARK == thunk->begin) thunk->begin= begin;
+	  if (YY_MEMO_MARK == thunk->end)   thunk->end= end;
+	  if (YY_MEMO_MARK == thunk->begin || YY_MEMO_MARK == thunk->end)
+	    ctx->memomarks[j++]= ctx->memomarks[i];
+	}
+      ctx->memomarked= j;
+    }
+  if (YY_MEMO_MARK == ctx->begin) ctx->begin= begin;
+  if (YY_MEMO_MARK == ctx->end)   ctx->end= end;
+}
+
+#endif
+
 YY_LOCAL(void) yyCommit(yycontext *ctx)
 {
   if ((ctx->limit -= ctx->pos))
     {
       memmove(ctx->buf, ctx->buf + ctx->pos, ctx->limit);
     }
+#ifdef YYMEMOCOUNT
+  yyMemoClear(ctx);
+#endif
   ctx->begin -= ctx->pos;
   ctx->end -= ctx->pos;
   ctx->pos= ctx->thunkpos= 0;
@@ -265,7 +446,17 @@ YY_LOCAL(int) yyAccept(yycontext *ctx, int tp0)
   return 1;
 }
 
-YY_LOCAL(void) yyPush(yycontext *ctx, char *text, int count)  { ctx->val += count; }
+YY_LOCAL(void) yyPush(yycontext *ctx, char *text, int count)
+{
+  ctx->val += count;
+  while (ctx->valslen <= ctx->val - ctx->vals)
+    {
+      long offset= ctx->val - ctx->vals;
+      ctx->valslen *= 2;
+      ctx->vals= (YYSTYPE *)realloc(ctx->vals, sizeof(YYSTYPE) * ctx->valslen);
+      ctx->val= ctx->vals + offset;
+    }
+}
 YY_LOCAL(void) yyPop(yycontext *ctx, char *text, int count)   { ctx->val -= count; }
 YY_LOCAL(void) yySet(yycontext *ctx, char *text, int count)   { ctx->val[count]= ctx->yy; }
 
@@ -273,35 +464,36 @@ YY_LOCAL(void) yySet(yycontext *ctx, char *text, int count)   { ctx->val[count]=
 
 #define	YYACCEPT	yyAccept(ctx, yythunkpos0)
 
-YY_RULE(int) yy_end_of_line(yycontext *ctx); /* 36 */
-YY_RULE(int) yy_comment(yycontext *ctx); /* 35 */
-YY_RULE(int) yy_space(yycontext *ctx); /* 34 */
-YY_RULE(int) yy_braces(yycontext *ctx); /* 33 */
-YY_RULE(int) yy_range(yycontext *ctx); /* 32 */
-YY_RULE(int) yy_char(yycontext *ctx); /* 31 */
-YY_RULE(int) yy_END(yycontext *ctx); /* 30 */
-YY_RULE(int) yy_BEGIN(yycontext *ctx); /* 29 */
-YY_RULE(int) yy_DOT(yycontext *ctx); /* 28 */
-YY_RULE(int) yy_class(yycontext *ctx); /* 27 */
-YY_RULE(int) yy_literal(yycontext *ctx); /* 26 */
-YY_RULE(int) yy_CLOSE(yycontext *ctx); /* 25 */
-YY_RULE(int) yy_OPEN(yycontext *ctx); /* 24 */
-YY_RULE(int) yy_COLON(yycontext *ctx); /* 23 */
-YY_RULE(int) yy_PLUS(yycontext *ctx); /* 22 */
-YY_RULE(int) yy_STAR(yycontext *ctx); /* 21 */
-YY_RULE(int) yy_QUESTION(yycontext *ctx); /* 20 */
-YY_RULE(int) yy_primary(yycontext *ctx); /* 19 */
-YY_RULE(int) yy_NOT(yycontext *ctx); /* 18 */
-YY_RULE(int) yy_suffix(yycontext *ctx); /* 17 */
-YY_RULE(int) yy_action(yycontext *ctx); /* 16 */
-YY_RULE(int) yy_AND(yycontext *ctx); /* 15 */
-YY_RULE(int) yy_prefix(yycontext *ctx); /* 14 */
-YY_RULE(int) yy_BAR(yycontext *ctx); /* 13 */
-YY_RULE(int) yy_sequence(yycontext *ctx); /* 12 */
-YY_RULE(int) yy_SEMICOLON(yycontext *ctx); /* 11 */
-YY_RULE(int) yy_expression(yycontext *ctx); /* 10 */
-YY_RULE(int) yy_EQUAL(yycontext *ctx); /* 9 */
-YY_RULE(int) yy_identifier(yycontext *ctx); /* 8 */
+YY_RULE(int) yy_end_of_line(yycontext *ctx); /* 37 */
+YY_RULE(int) yy_comment(yycontext *ctx); /* 36 */
+YY_RULE(int) yy_space(yycontext *ctx); /* 35 */
+YY_RULE(int) yy_braces(yycontext *ctx); /* 34 */
+YY_RULE(int) yy_range(yycontext *ctx); /* 33 */
+YY_RULE(int) yy_char(yycontext *ctx); /* 32 */
+YY_RULE(int) yy_END(yycontext *ctx); /* 31 */
+YY_RULE(int) yy_BEGIN(yycontext *ctx); /* 30 */
+YY_RULE(int) yy_DOT(yycontext *ctx); /* 29 */
+YY_RULE(int) yy_class(yycontext *ctx); /* 28 */
+YY_RULE(int) yy_literal(yycontext *ctx); /* 27 */
+YY_RULE(int) yy_CLOSE(yycontext *ctx); /* 26 */
+YY_RULE(int) yy_OPEN(yycontext *ctx); /* 25 */
+YY_RULE(int) yy_COLON(yycontext *ctx); /* 24 */
+YY_RULE(int) yy_PLUS(yycontext *ctx); /* 23 */
+YY_RULE(int) yy_STAR(yycontext *ctx); /* 22 */
+YY_RULE(int) yy_QUESTION(yycontext *ctx); /* 21 */
+YY_RULE(int) yy_primary(yycontext *ctx); /* 20 */
+YY_RULE(int) yy_NOT(yycontext *ctx); /* 19 */
+YY_RULE(int) yy_suffix(yycontext *ctx); /* 18 */
+YY_RULE(int) yy_action(yycontext *ctx); /* 17 */
+YY_RULE(int) yy_AND(yycontext *ctx); /* 16 */
+YY_RULE(int) yy_prefix(yycontext *ctx); /* 15 */
+YY_RULE(int) yy_BAR(yycontext *ctx); /* 14 */
+YY_RULE(int) yy_sequence(yycontext *ctx); /* 13 */
+YY_RULE(int) yy_SEMICOLON(yycontext *ctx); /* 12 */
+YY_RULE(int) yy_expression(yycontext *ctx); /* 11 */
+YY_RULE(int) yy_EQUAL(yycontext *ctx); /* 10 */
+YY_RULE(int) yy_identifier(yycontext *ctx); /* 9 */
+YY_RULE(int) yy_MEMO(yycontext *ctx); /* 8 */
 YY_RULE(int) yy_RPERCENT(yycontext *ctx); /* 7 */
 YY_RULE(int) yy_end_of_file(yycontext *ctx); /* 6 */
 YY_RULE(int) yy_trailer(yycontext *ctx); /* 5 */
@@ -531,6 +723,17 @@ YY_ACTION(void) yy_1_trailer(yycontext *ctx, char *yytext, int yyleng)
 #undef yypos
 #undef yy
 }
+YY_ACTION(void) yy_2_declaration(yycontext *ctx, char *yytext, int yyleng)
+{
+#define yy ctx->yy
+#define yypos ctx->pos
+#define yythunkpos ctx->thunkpos
+  yyprintf((stderr, "do yy_2_declaration\n"));
+   Rule_beMemo(findRule(yytext)); ;
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
 YY_ACTION(void) yy_1_declaration(yycontext *ctx, char *yytext, int yyleng)
 {
 #define yy ctx->yy
@@ -922,105 +1125,128 @@ YY_RULE(int) yy_identifier(yycontext *ctx)
   yyprintf((stderr, "  fail %s @ %s\n", "identifier", ctx->buf+ctx->pos));
   return 0;
 }
+YY_RULE(int) yy_MEMO(yycontext *ctx)
+{  int yypos0= ctx->pos, yythunkpos0= ctx->thunkpos;
+  yyprintf((stderr, "%s\n", "MEMO"));  if (!yymatchString(ctx, "%memo")) goto l92;  if (!yy__(ctx)) goto l92;
+  yyprintf((stderr, "  ok   %s @ %s\n", "MEMO", ctx->buf+ctx->pos));
+  return 1;
+  l92:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "MEMO", ctx->buf+ctx->pos));
+  return 0;
+}
 YY_RULE(int) yy_RPERCENT(yycontext *ctx)
 {  int yypos0= ctx->pos, yythunkpos0= ctx->thunkpos;
-  yyprintf((stderr, "%s\n", "RPERCENT"));  if (!yymatchString(ctx, "%}")) goto l92;  if (!yy__(ctx)) goto l92;
+  yyprintf((stderr, "%s\n", "RPERCENT"));  if (!yymatchString(ctx, "%}")) goto l93;  if (!yy__(ctx)) goto l93;
   yyprintf((stderr, "  ok   %s @ %s\n", "RPERCENT", ctx->buf+ctx->pos));
   return 1;
-  l92:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
+  l93:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "RPERCENT", ctx->buf+ctx->pos));
   return 0;
 }
 YY_RULE(int) yy_end_of_file(yycontext *ctx)
 {  int yypos0= ctx->pos, yythunkpos0= ctx->thunkpos;
   yyprintf((stderr, "%s\n", "end_of_file"));
-  {  int yypos94= ctx->pos, yythunkpos94= ctx->thunkpos;  if (!yymatchDot(ctx)) goto l94;  goto l93;
-  l94:;	  ctx->pos= yypos94; ctx->thunkpos= yythunkpos94;
+  {  int yypos95= ctx->pos, yythunkpos95= ctx->thunkpos;  if (!yymatchDot(ctx)) goto l95;  goto l94;
+  l95:;	  ctx->pos= yypos95; ctx->thunkpos= yythunkpos95;
   }
   yyprintf((stderr, "  ok   %s @ %s\n", "end_of_file", ctx->buf+ctx->pos));
   return 1;
-  l93:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
+  l94:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "end_of_file", ctx->buf+ctx->pos));
   return 0;
 }
 YY_RULE(int) yy_trailer(yycontext *ctx)
 {  int yypos0= ctx->pos, yythunkpos0= ctx->thunkpos;
-  yyprintf((stderr, "%s\n", "trailer"));  if (!yymatchString(ctx, "%%")) goto l95;  yyText(ctx, ctx->begin, ctx->end);  if (!(YY_BEGIN)) goto l95;
-  l96:;	
-  {  int yypos97= ctx->pos, yythunkpos97= ctx->thunkpos;  if (!yymatchDot(ctx)) goto l97;  goto l96;
-  l97:;	  ctx->pos= yypos97; ctx->thunkpos= yythunkpos97;
-  }  yyText(ctx, ctx->begin, ctx->end);  if (!(YY_END)) goto l95;  yyDo(ctx, yy_1_trailer, ctx->begin, ctx->end);
+  yyprintf((stderr, "%s\n", "trailer"));  if (!yymatchString(ctx, "%%")) goto l96;  yyText(ctx, ctx->begin, ctx->end);  if (!(YY_BEGIN)) goto l96;
+  l97:;	
+  {  int yypos98= ctx->pos, yythunkpos98= ctx->thunkpos;  if (!yymatchDot(ctx)) goto l98;  goto l97;
+  l98:;	  ctx->pos= yypos98; ctx->thunkpos= yythunkpos98;
+  }  yyText(ctx, ctx->begin, ctx->end);  if (!(YY_END)) goto l96;  yyDo(ctx, yy_1_trailer, ctx->begin, ctx->end);
   yyprintf((stderr, "  ok   %s @ %s\n", "trailer", ctx->buf+ctx->pos));
   return 1;
-  l95:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
+  l96:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "trailer", ctx->buf+ctx->pos));
   return 0;
 }
 YY_RULE(int) yy_definition(yycontext *ctx)
 {  int yypos0= ctx->pos, yythunkpos0= ctx->thunkpos;
-  yyprintf((stderr, "%s\n", "definition"));  if (!yy_identifier(ctx)) goto l98;  yyDo(ctx, yy_1_definition, ctx->begin, ctx->end);  if (!yy_EQUAL(ctx)) goto l98;  if (!yy_expression(ctx)) goto l98;  yyDo(ctx, yy_2_definition, ctx->begin, ctx->end);
-  {  int yypos99= ctx->pos, yythunkpos99= ctx->thunkpos;  if (!yy_SEMICOLON(ctx)) goto l99;  goto l100;
-  l99:;	  ctx->pos= yypos99; ctx->thunkpos= yythunkpos99;
+  yyprintf((stderr, "%s\n", "definition"));  if (!yy_identifier(ctx)) goto l99;  yyDo(ctx, yy_1_definition, ctx->begin, ctx->end);  if (!yy_EQUAL(ctx)) goto l99;  if (!yy_expression(ctx)) goto l99;  yyDo(ctx, yy_2_definition, ctx->begin, ctx->end);
+  {  int yypos100= ctx->pos, yythunkpos100= ctx->thunkpos;  if (!yy_SEMICOLON(ctx)) goto l100;  goto l101;
+  l100:;	  ctx->pos= yypos100; ctx->thunkpos= yythunkpos100;
   }
-  l100:;	
+  l101:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "definition", ctx->buf+ctx->pos));
   return 1;
-  l98:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
+  l99:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "definition", ctx->buf+ctx->pos));
   return 0;
 }
 YY_RULE(int) yy_declaration(yycontext *ctx)
 {  int yypos0= ctx->pos, yythunkpos0= ctx->thunkpos;
-  yyprintf((stderr, "%s\n", "declaration"));  if (!yymatchString(ctx, "%{")) goto l101;  yyText(ctx, ctx->begin, ctx->end);  if (!(YY_BEGIN)) goto l101;
-  l102:;	
-  {  int yypos103= ctx->pos, yythunkpos103= ctx->thunkpos;
-  {  int yypos104= ctx->pos, yythunkpos104= ctx->thunkpos;  if (!yymatchString(ctx, "%}")) goto l104;  goto l103;
-  l104:;	  ctx->pos= yypos104; ctx->thunkpos= yythunkpos104;
-  }  if (!yymatchDot(ctx)) goto l103;  goto l102;
-  l103:;	  ctx->pos= yypos103; ctx->thunkpos= yythunkpos103;
-  }  yyText(ctx, ctx->begin, ctx->end);  if (!(YY_END)) goto l101;  if (!yy_RPERCENT(ctx)) goto l101;  yyDo(ctx, yy_1_declaration, ctx->begin, ctx->end);
+  yyprintf((stderr, "%s\n", "declaration"));
+  {  int yypos103= ctx->pos, yythunkpos103= ctx->thunkpos;  if (!yymatchString(ctx, "%{")) goto l104;  yyText(ctx, ctx->begin, ctx->end);  if (!(YY_BEGIN)) goto l104;
+  l105:;	
+  {  int yypos106= ctx->pos, yythunkpos106= ctx->thunkpos;
+  {  int yypos107= ctx->pos, yythunkpos107= ctx->thunkpos;  if (!yymatchString(ctx, "%}")) goto l107;  goto l106;
+  l107:;	  ctx->pos= yypos107; ctx->thunkpos= yythunkpos107;
+  }  if (!yymatchDot(ctx)) goto l106;  goto l105;
+  l106:;	  ctx->pos= yypos106; ctx->thunkpos= yythunkpos106;
+  }  yyText(ctx, ctx->begin, ctx->end);  if (!(YY_END)) goto l104;  if (!yy_RPERCENT(ctx)) goto l104;  yyDo(ctx, yy_1_declaration, ctx->begin, ctx->end);  goto l103;
+  l104:;	  ctx->pos= yypos103; ctx->thunkpos= yythunkpos103;  if (!yy_MEMO(ctx)) goto l102;  if (!yy_identifier(ctx)) goto l102;
+  {  int yypos110= ctx->pos, yythunkpos110= ctx->thunkpos;  if (!yy_EQUAL(ctx)) goto l110;  goto l102;
+  l110:;	  ctx->pos= yypos110; ctx->thunkpos= yythunkpos110;
+  }  yyDo(ctx, yy_2_declaration, ctx->begin, ctx->end);
+  l108:;	
+  {  int yypos109= ctx->pos, yythunkpos109= ctx->thunkpos;  if (!yy_identifier(ctx)) goto l109;
+  {  int yypos111= ctx->pos, yythunkpos111= ctx->thunkpos;  if (!yy_EQUAL(ctx)) goto l111;  goto l109;
+  l111:;	  ctx->pos= yypos111; ctx->thunkpos= yythunkpos111;
+  }  yyDo(ctx, yy_2_declaration, ctx->begin, ctx->end);  goto l108;
+  l109:;	  ctx->pos= yypos109; ctx->thunkpos= yythunkpos109;
+  }
+  }
+  l103:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "declaration", ctx->buf+ctx->pos));
   return 1;
-  l101:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
+  l102:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "declaration", ctx->buf+ctx->pos));
   return 0;
 }
 YY_RULE(int) yy__(yycontext *ctx)
 {
   yyprintf((stderr, "%s\n", "_"));
-  l106:;	
-  {  int yypos107= ctx->pos, yythunkpos107= ctx->thunkpos;
-  {  int yypos108= ctx->pos, yythunkpos108= ctx->thunkpos;  if (!yy_space(ctx)) goto l109;  goto l108;
-  l109:;	  ctx->pos= yypos108; ctx->thunkpos= yythunkpos108;  if (!yy_comment(ctx)) goto l107;
+  l113:;	
+  {  int yypos114= ctx->pos, yythunkpos114= ctx->thunkpos;
+  {  int yypos115= ctx->pos, yythunkpos115= ctx->thunkpos;  if (!yy_space(ctx)) goto l116;  goto l115;
+  l116:;	  ctx->pos= yypos115; ctx->thunkpos= yythunkpos115;  if (!yy_comment(ctx)) goto l114;
   }
-  l108:;	  goto l106;
-  l107:;	  ctx->pos= yypos107; ctx->thunkpos= yythunkpos107;
+  l115:;	  goto l113;
+  l114:;	  ctx->pos= yypos114; ctx->thunkpos= yythunkpos114;
   }
   yyprintf((stderr, "  ok   %s @ %s\n", "_", ctx->buf+ctx->pos));
   return 1;
 }
 YY_RULE(int) yy_grammar(yycontext *ctx)
 {  int yypos0= ctx->pos, yythunkpos0= ctx->thunkpos;
-  yyprintf((stderr, "%s\n", "grammar"));  if (!yy__(ctx)) goto l110;
-  {  int yypos113= ctx->pos, yythunkpos113= ctx->thunkpos;  if (!yy_declaration(ctx)) goto l114;  goto l113;
-  l114:;	  ctx->pos= yypos113; ctx->thunkpos= yythunkpos113;  if (!yy_definition(ctx)) goto l110;
+  yyprintf((stderr, "%s\n", "grammar"));  if (!yy__(ctx)) goto l117;
+  {  int yypos120= ctx->pos, yythunkpos120= ctx->thunkpos;  if (!yy_declaration(ctx)) goto l121;  goto l120;
+  l121:;	  ctx->pos= yypos120; ctx->thunkpos= yythunkpos120;  if (!yy_definition(ctx)) goto l117;
   }
-  l113:;	
-  l111:;	
-  {  int yypos112= ctx->pos, yythunkpos112= ctx->thunkpos;
-  {  int yypos115= ctx->pos, yythunkpos115= ctx->thunkpos;  if (!yy_declaration(ctx)) goto l116;  goto l115;
-  l116:;	  ctx->pos= yypos115; ctx->thunkpos= yythunkpos115;  if (!yy_definition(ctx)) goto l112;
+  l120:;	
+  l118:;	
+  {  int yypos119= ctx->pos, yythunkpos119= ctx->thunkpos;
+  {  int yypos122= ctx->pos, yythunkpos122= ctx->thunkpos;  if (!yy_declaration(ctx)) goto l123;  goto l122;
+  l123:;	  ctx->pos= yypos122; ctx->thunkpos= yythunkpos122;  if (!yy_definition(ctx)) goto l119;
   }
-  l115:;	  goto l111;
-  l112:;	  ctx->pos= yypos112; ctx->thunkpos= yythunkpos112;
+  l122:;	  goto l118;
+  l119:;	  ctx->pos= yypos119; ctx->thunkpos= yythunkpos119;
   }
-  {  int yypos117= ctx->pos, yythunkpos117= ctx->thunkpos;  if (!yy_trailer(ctx)) goto l117;  goto l118;
-  l117:;	  ctx->pos= yypos117; ctx->thunkpos= yythunkpos117;
+  {  int yypos124= ctx->pos, yythunkpos124= ctx->thunkpos;  if (!yy_trailer(ctx)) goto l124;  goto l125;
+  l124:;	  ctx->pos= yypos124; ctx->thunkpos= yythunkpos124;
   }
-  l118:;	  if (!yy_end_of_file(ctx)) goto l110;
+  l125:;	  if (!yy_end_of_file(ctx)) goto l117;
   yyprintf((stderr, "  ok   %s @ %s\n", "grammar", ctx->buf+ctx->pos));
   return 1;
-  l110:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
+  l117:;	  ctx->pos= yypos0; ctx->thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "grammar", ctx->buf+ctx->pos));
   return 0;
 }
@@ -1043,7 +1269,21 @@ YY_PARSE(int) YYPARSEFROM(YY_CTX_PARAM_ yyrule yystart)
       yyctx->valslen= 32;
       yyctx->vals= (YYSTYPE *)malloc(sizeof(YYSTYPE) * yyctx->valslen);
       yyctx->begin= yyctx->end= yyctx->pos= yyctx->limit= yyctx->thunkpos= 0;
+#ifdef YYMEMOCOUNT
+      yyctx->memoslen= 1024;
+      yyctx->memos= (yymemo *)calloc(yyctx->memoslen, sizeof(yymemo));
+      yyctx->memoscount= 0;
+      yyctx->memogeneration= 1;
+      yyctx->memothunkslen= 1024;
+      yyctx->memothunks= (yythunk *)malloc(sizeof(yythunk) * yyctx->memothunkslen);
+      yyctx->memothunkpos= 0;
+      yyctx->memomarkslen= 1024;
+      yyctx->memomarks= (int *)malloc(sizeof(int) * yyctx->memomarkslen);
+#endif
     }
+#ifdef YYMEMOCOUNT
+  yyMemoClear(yyctx);
+#endif
   yyctx->begin= yyctx->end= yyctx->pos;
   yyctx->thunkpos= 0;
   yyctx->val= yyctx->vals;
@@ -86,6 +86,14 @@ void Rule_setExpression(Node *node, Node *expression)
     start= node;
 }
 
+Node *Rule_beMemo(Node *node)
+{
+  assert(node);
+  assert(Rule == node->type);
+  node->rule.flags |= RuleMemo;
+  return node;
+}
+
 Node *makeVariable(char *name)
 {
   Node *node;
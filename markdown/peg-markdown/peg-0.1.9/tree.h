@@ -23,6 +23,7 @@ enum { Unknown= 0, Rule, Variable, Name, Dot, Character, String, Class, Action,
 enum {
   RuleUsed	= 1<<0,
   RuleReached	= 1<<1,
+  RuleMemo	= 1<<2,
 };
 
 typedef union Node Node;
@@ -80,6 +81,7 @@ extern Node *findRule(char *name);
 extern Node *beginRule(Node *rule);
 extern void  Rule_setExpression(Node *rule, Node *expression);
 extern Node *Rule_beToken(Node *rule);
+extern Node *Rule_beMemo(Node *rule);
 extern Node *makeVariable(char *name);
 extern Node *makeName(Node *rule);
 extern Node *makeDot(void);
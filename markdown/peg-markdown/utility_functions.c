@@ -8,6 +8,82 @@
 #include <assert.h>
 
 
+/**********************************************************************
+
+  Element arena
+
+  Elements, their strings and links are only ever released together,
+  once the output has been printed, so they are bump allocated from a
+  chain of large blocks instead of one malloc per node.  arena_reset
+  releases everything at once and keeps a few blocks for the next parse.
+
+ ***********************************************************************/
+
+#define ARENA_BLOCK_SIZE 65536
+#define ARENA_ALIGN (2 * sizeof(void *))
+#define ARENA_SPARE_BLOCKS 16
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t            size;
+    size_t            used;
+} ArenaBlock;
+
+#define ARENA_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static ArenaBlock *arena_blocks = NULL;  /* blocks in use, newest first */
+static ArenaBlock *arena_spare = NULL;   /* standard blocks kept for reuse */
+static int arena_spare_count = 0;
+
+/* arena_alloc - allocate size bytes, valid until the next arena_reset */
+void *arena_alloc(size_t size) {
+    ArenaBlock *block = arena_blocks;
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (block == NULL || block->size - block->used < size) {
+        if (size <= ARENA_BLOCK_SIZE - ARENA_HEADER && arena_spare != NULL) {
+            block = arena_spare;
+            arena_spare = block->next;
+            arena_spare_count--;
+        } else {
+            size_t block_size = ARENA_BLOCK_SIZE;
+            if (size > block_size - ARENA_HEADER)
+                block_size = size + ARENA_HEADER;
+            block = malloc(block_size);
+            if (block == NULL) {
+                fprintf(stderr, "arena_alloc: out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            block->size = block_size;
+        }
+        block->used = ARENA_HEADER;
+        block->next = arena_blocks;
+        arena_blocks = block;
+    }
+    block->used += size;
+    return (char *) block + block->used - size;
+}
+
+/* arena_strdup - copy a string into the arena */
+char *arena_strdup(const char *string) {
+    size_t len = strlen(string) + 1;
+    return memcpy(arena_alloc(len), string, len);
+}
+
+/* arena_reset - release everything allocated since the last reset */
+void arena_reset(void) {
+    ArenaBlock *next;
+    while (arena_blocks != NULL) {
+        next = arena_blocks->next;
+        if (arena_blocks->size == ARENA_BLOCK_SIZE && arena_spare_count < ARENA_SPARE_BLOCKS) {
+            arena_blocks->next = arena_spare;
+            arena_spare = arena_blocks;
+            arena_spare_count++;
+        } else
+            free(arena_blocks);
+        arena_blocks = next;
+    }
+}
+
 /**********************************************************************
 
   List manipulation functions
@@ -33,19 +109,15 @@ element *reverse(element *list) {
     return new;
 }
 
-/* concat_string_list - concatenates string contents of list of STR elements.
- * Frees STR elements as they are added to the concatenation. */
+/* concat_string_list - concatenates string contents of list of STR elements. */
 GString *concat_string_list(element *list) {
     GString *result;
-    element *next;
     result = g_string_new("");
     while (list != NULL) {
         assert(list->key == STR);
         assert(list->contents.str != NULL);
         g_string_append(result, list->contents.str);
-        next = list->next;
-        free_element(list);
-        list = next;
+        list = list->next;
     }
     return result;
 }
@@ -72,7 +144,7 @@ int syntax_extensions;  /* Syntax extensions selected. */
 
 /* mk_element - generic constructor for element */
 element * mk_element(int key) {
-    element *result = malloc(sizeof(element));
+    element *result = arena_alloc(sizeof(element));
     result->key = key;
     result->children = NULL;
     result->next = NULL;
@@ -85,7 +157,7 @@ element * mk_str(char *string) {
     element *result;
     assert(string != NULL);
     result = mk_element(STR);
-    result->contents.str = strdup(string);
+    result->contents.str = arena_strdup(string);
     return result;
 }
 
@@ -97,8 +169,8 @@ element * mk_str_from_list(element *list, bool extra_newline) {
     if (extra_newline)
         g_string_append(c, "\n");
     result = mk_element(STR);
-    result->contents.str = c->str;
-    g_string_free(c, false);
+    result->contents.str = memcpy(arena_alloc(c->len + 1), c->str, c->len + 1);
+    g_string_free(c, true);
     return result;
 }
 
@@ -116,10 +188,10 @@ element * mk_list(int key, element *lst) {
 element * mk_link(element *label, char *url, char *title) {
     element *result;
     result = mk_element(LINK);
-    result->contents.link = malloc(sizeof(link));
+    result->contents.link = arena_alloc(sizeof(link));
     result->contents.link->label = label;
-    result->contents.link->url = strdup(url);
-    result->contents.link->title = strdup(title);
+    result->contents.link->url = arena_strdup(url);
+    result->contents.link->title = arena_strdup(title);
     return result;
 }
 
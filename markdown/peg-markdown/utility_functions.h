@@ -10,13 +10,18 @@
  * constructors, and macro definitions for leg markdown parser. */
 
 
+/* arena_alloc - allocate size bytes, valid until the next arena_reset */
+void *arena_alloc(size_t size);
+
+/* arena_strdup - copy a string into the arena */
+char *arena_strdup(const char *string);
+
 /* cons - cons an element onto a list, returning pointer to new head */
 element * cons(element *new, element *list);
 
 /* reverse - reverse a list, returning pointer to new list */
 element *reverse(element *list);
-/* concat_string_list - concatenates string contents of list of STR elements.
- * Frees STR elements as they are added to the concatenation. */
+/* concat_string_list - concatenates string contents of list of STR elements. */
 GString *concat_string_list(element *list);
 /**********************************************************************
 
@@ -89,6 +89,7 @@ struct _MarkdownConfigPrivate
   gboolean initialized;
   gchar *tmpl_text;
   gsize tmpl_text_len;
+  GFileMonitor *tmpl_monitor;
   struct {
     GtkWidget *table;
     GtkWidget *pos_sb_radio;
@@ -143,17 +144,48 @@ init_conf_file(MarkdownConfig *conf)
   g_free(def_tmpl);
 }
 
+/* Forgets the template text, and stops watching its file */
+static void
+markdown_config_clear_template_text(MarkdownConfig *conf)
+{
+  g_free(conf->priv->tmpl_text);
+  conf->priv->tmpl_text = NULL;
+  conf->priv->tmpl_text_len = 0;
+
+  if (conf->priv->tmpl_monitor) {
+    g_file_monitor_cancel(conf->priv->tmpl_monitor);
+    g_object_unref(conf->priv->tmpl_monitor);
+    conf->priv->tmpl_monitor = NULL;
+  }
+}
+
+/* The template was edited on disk: it is read again when next used, the
+ * viewers being told through the template-file property. */
+static void
+on_template_file_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+  GFileMonitorEvent event_type, MarkdownConfig *conf)
+{
+  if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+      event_type != G_FILE_MONITOR_EVENT_CREATED &&
+      event_type != G_FILE_MONITOR_EVENT_DELETED)
+  {
+    return;
+  }
+
+  markdown_config_clear_template_text(conf);
+  g_object_notify_by_pspec(G_OBJECT(conf), md_props[PROP_TEMPLATE_FILE]);
+}
+
 static void
 markdown_config_load_template_text(MarkdownConfig *conf)
 {
   GError *error = NULL;
   gchar *tmpl_file = NULL;
+  GFile *file;
 
   g_object_get(conf, "template-file", &tmpl_file, NULL);
 
-  g_free(conf->priv->tmpl_text);
-  conf->priv->tmpl_text = NULL;
-  conf->priv->tmpl_text_len = 0;
+  markdown_config_clear_template_text(conf);
 
   if (!g_file_get_contents(tmpl_file, &(conf->priv->tmpl_text),
       &(conf->priv->tmpl_text_len), &error))
@@ -161,6 +193,19 @@ markdown_config_load_template_text(MarkdownConfig *conf)
     g_warning("Error reading template file: %s", error->message);
     g_error_free(error); error = NULL;
   }
+
+  /* Watched even if missing, so that it is read once created */
+  file = g_file_new_for_path(tmpl_file);
+  conf->priv->tmpl_monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, &error);
+  if (conf->priv->tmpl_monitor) {
+    g_signal_connect(conf->priv->tmpl_monitor, "changed",
+      G_CALLBACK(on_template_file_changed), conf);
+  } else {
+    g_debug("Unable to watch template file: %s", error->message);
+    g_error_free(error); error = NULL;
+  }
+  g_object_unref(file);
+  g_free(tmpl_file);
 }
 
 static void
@@ -177,7 +222,8 @@ markdown_config_set_property(GObject *obj, guint prop_id, const GValue *value, G
     case PROP_TEMPLATE_FILE:
       g_key_file_set_string(conf->priv->kf, "general", "template",
         g_value_get_string(value));
-      /*markdown_config_load_template_text(conf);*/
+      /* Read again when next used */
+      markdown_config_clear_template_text(conf);
       save_later = TRUE;
       break;
     case PROP_FONT_NAME:
@@ -402,6 +448,7 @@ markdown_config_finalize(GObject *object)
     markdown_config_save(self);
   }
 
+  markdown_config_clear_template_text(self);
   g_free(self->priv->filename);
   g_key_file_free(self->priv->kf);
 
@@ -0,0 +1,256 @@
+/*
+ * export.c - Part of the Geany Markdown plugin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <geanyplugin.h>
+#ifndef FULL_PRICE
+# include <mkdio.h>
+#else
+# include "markdown_lib.h"
+#endif
+#include "export.h"
+
+extern GeanyData      *geany_data;
+extern GeanyFunctions *geany_functions;
+
+#define MD_EXPORT_HTML_HEADER \
+  "<!DOCTYPE html>\n" \
+  "<html>\n" \
+  "<head>\n" \
+  "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=UTF-8\">\n" \
+  "<title>%s</title>\n" \
+  "</head>\n" \
+  "<body>\n"
+#define MD_EXPORT_HTML_FOOTER \
+  "</body>\n" \
+  "</html>\n"
+
+typedef enum
+{
+  MD_EXPORT_HTML,
+  MD_EXPORT_ODF
+} MarkdownExportFormat;
+
+/* An export, written from the render thread and reported from an idle */
+typedef struct
+{
+  MarkdownExportFormat format;
+  gchar *text;
+  gsize len;
+  gchar *filename; /* in the file name encoding */
+  gchar *title;
+  gchar *error;
+} MarkdownExportJob;
+
+/* Writes the HTML straight into the file as it is generated */
+static gboolean
+export_write_html(MarkdownExportJob *job, FILE *fp)
+{
+  gchar *title = g_markup_escape_text(job->title, -1);
+  gboolean success;
+#ifndef FULL_PRICE
+  MMIOT *doc;
+#else
+  GString *out;
+#endif
+
+  success = fprintf(fp, MD_EXPORT_HTML_HEADER, title) >= 0;
+  g_free(title);
+
+#ifndef FULL_PRICE
+  doc = mkd_string(job->text, job->len, 0);
+  /* Discount keeps its own copy of the lines */
+  g_free(job->text);
+  job->text = NULL;
+  mkd_compile(doc, 0);
+  success = success && mkd_generatehtml(doc, fp) != EOF;
+  mkd_cleanup(doc);
+#else
+  out = markdown_to_g_string(job->text, 0, HTML_FORMAT);
+  g_free(job->text);
+  job->text = NULL;
+  success = success && fwrite(out->str, 1, out->len, fp) == out->len;
+  g_string_free(out, TRUE);
+#endif
+
+  return success && fputs(MD_EXPORT_HTML_FOOTER, fp) != EOF;
+}
+
+#ifdef FULL_PRICE
+/* peg-markdown writes a whole flat ODF document */
+static gboolean
+export_write_odf(MarkdownExportJob *job, FILE *fp)
+{
+  GString *out = markdown_to_g_string(job->text, 0, ODF_FORMAT);
+  gboolean success;
+
+  g_free(job->text);
+  job->text = NULL;
+  success = fwrite(out->str, 1, out->len, fp) == out->len;
+  g_string_free(out, TRUE);
+
+  return success;
+}
+#endif
+
+static gboolean
+on_export_done(MarkdownExportJob *job)
+{
+  gchar *utf8_filename = utils_get_utf8_from_locale(job->filename);
+
+  if (job->error) {
+    dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Unable to export \"%s\": %s"),
+      utf8_filename, job->error);
+  } else {
+    ui_set_statusbar(TRUE, _("Exported Markdown to \"%s\""), utf8_filename);
+  }
+
+  g_free(utf8_filename);
+  g_free(job->text);
+  g_free(job->filename);
+  g_free(job->title);
+  g_free(job->error);
+  g_free(job);
+
+  return FALSE;
+}
+
+/* Runs in the render thread */
+static void
+export_job_run(MarkdownExportJob *job, gpointer unused)
+{
+  FILE *fp = g_fopen(job->filename, "wb");
+  gboolean success;
+
+  if (!fp) {
+    job->error = g_strdup(g_strerror(errno));
+  } else {
+#ifdef FULL_PRICE
+    if (job->format == MD_EXPORT_ODF) {
+      success = export_write_odf(job, fp);
+    } else
+#endif
+    success = export_write_html(job, fp);
+
+    if (fclose(fp) != 0 || !success) {
+      job->error = g_strdup(g_strerror(errno));
+    }
+  }
+
+  g_idle_add((GSourceFunc) on_export_done, job);
+}
+
+static gchar *
+ask_export_filename(GeanyDocument *doc, MarkdownExportFormat *format)
+{
+  GtkWidget *dialog;
+  GtkFileFilter *filter;
+#ifdef FULL_PRICE
+  GtkFileFilter *odf_filter;
+#endif
+  gchar *filename = NULL, *basename, *dot, *name;
+
+  dialog = gtk_file_chooser_dialog_new(_("Export Markdown"),
+    GTK_WINDOW(geany->main_widgets->window), GTK_FILE_CHOOSER_ACTION_SAVE,
+    GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+    GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT, NULL);
+  gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+
+  filter = gtk_file_filter_new();
+  gtk_file_filter_set_name(filter, _("HTML"));
+  gtk_file_filter_add_pattern(filter, "*.html");
+  gtk_file_filter_add_pattern(filter, "*.htm");
+  gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(dialog), filter);
+#ifdef FULL_PRICE
+  odf_filter = gtk_file_filter_new();
+  gtk_file_filter_set_name(odf_filter, _("Flat OpenDocument Text"));
+  gtk_file_filter_add_pattern(odf_filter, "*.fodt");
+  gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(dialog), odf_filter);
+#endif
+
+  /* Offer the document's name with the extension of the format */
+  if (doc->file_name) {
+    gchar *dirname = g_path_get_dirname(doc->file_name);
+    gchar *locale_dirname = utils_get_locale_from_utf8(dirname);
+
+    gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER(dialog), locale_dirname);
+    g_free(locale_dirname);
+    g_free(dirname);
+  }
+  basename = g_path_get_basename(DOC_FILENAME(doc));
+  dot = strrchr(basename, '.');
+  if (dot) {
+    *dot = '\0';
+  }
+  name = g_strconcat(basename, ".html", NULL);
+  gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(dialog), name);
+  g_free(name);
+  g_free(basename);
+
+  if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+    filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+    *format = MD_EXPORT_HTML;
+#ifdef FULL_PRICE
+    /* The extension given wins over the filter chosen */
+    if (g_str_has_suffix(filename, ".fodt") ||
+        (gtk_file_chooser_get_filter(GTK_FILE_CHOOSER(dialog)) == odf_filter &&
+         !g_str_has_suffix(filename, ".html") && !g_str_has_suffix(filename, ".htm"))) {
+      *format = MD_EXPORT_ODF;
+    }
+#endif
+  }
+  gtk_widget_destroy(dialog);
+
+  return filename;
+}
+
+/* Asks where to export the document, and writes it there from the render
+ * thread: the preview isn't involved, and the output goes to the file as
+ * it is generated rather than being kept. */
+void
+markdown_export_document(MarkdownViewer *viewer, GeanyDocument *doc)
+{
+  MarkdownExportJob *job;
+  MarkdownExportFormat format = MD_EXPORT_HTML;
+  gchar *filename;
+  const gchar *text;
+
+  g_return_if_fail(DOC_VALID(doc));
+
+  filename = ask_export_filename(doc, &format);
+  if (!filename) {
+    return;
+  }
+
+  /* A snapshot, as the document may be edited meanwhile */
+  text = (const gchar *) scintilla_send_message(doc->editor->sci, SCI_GETCHARACTERPOINTER, 0, 0);
+  job = g_new0(MarkdownExportJob, 1);
+  job->format = format;
+  job->len = (gsize) sci_get_length(doc->editor->sci);
+  job->text = g_strndup(text, job->len);
+  job->filename = filename;
+  job->title = g_path_get_basename(DOC_FILENAME(doc));
+
+  ui_set_statusbar(FALSE, _("Exporting Markdown..."));
+  markdown_viewer_run_in_render_thread(viewer, (GFunc) export_job_run, job);
+}
@@ -0,0 +1,32 @@
+/*
+ * export.h - Part of the Geany Markdown plugin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MARKDOWN_EXPORT_H
+#define MARKDOWN_EXPORT_H 1
+
+#include <geanyplugin.h>
+#include "viewer.h"
+
+G_BEGIN_DECLS
+
+void markdown_export_document(MarkdownViewer *viewer, GeanyDocument *doc);
+
+G_END_DECLS
+
+#endif /* MARKDOWN_EXPORT_H */
@@ -23,6 +23,7 @@
 #include <geanyplugin.h>
 #include "viewer.h"
 #include "conf.h"
+#include "export.h"
 
 GeanyData      *geany_data;
 GeanyPlugin    *geany_plugin;
@@ -53,6 +54,7 @@ PLUGIN_SET_TRANSLATABLE_INFO(LOCALEDIR, GETTEXT_PACKAGE,
 /* Global data */
 static MarkdownViewer *g_viewer = NULL;
 static GtkWidget *g_scrolled_win = NULL;
+static GtkWidget *g_export_item = NULL;
 
 /* Forward declarations */
 static void update_markdown_viewer(MarkdownViewer *viewer);
@@ -60,6 +62,7 @@ static gboolean on_editor_notify(GObject *obj, GeanyEditor *editor, SCNotificati
 static void on_document_signal(GObject *obj, GeanyDocument *doc, MarkdownViewer *viewer);
 static void on_document_filetype_set(GObject *obj, GeanyDocument *doc, GeanyFiletype *ft_old, MarkdownViewer *viewer);
 static void on_view_pos_notify(GObject *obj, GParamSpec *pspec, MarkdownViewer *viewer);
+static void on_export_activate(GtkMenuItem *item, MarkdownViewer *viewer);
 
 /* Main plugin entry point on plugin load. */
 void plugin_init(GeanyData *data)
@@ -102,6 +105,11 @@ void plugin_init(GeanyData *data)
 
   g_signal_connect(conf, "notify::view-pos", G_CALLBACK(on_view_pos_notify), viewer);
 
+  g_export_item = gtk_menu_item_new_with_mnemonic(_("_Export Markdown..."));
+  gtk_menu_shell_append(GTK_MENU_SHELL(geany->main_widgets->tools_menu), g_export_item);
+  g_signal_connect(g_export_item, "activate", G_CALLBACK(on_export_activate), viewer);
+  gtk_widget_show(g_export_item);
+
 #define MD_PSC(sig, cb) \
   plugin_signal_connect(geany_plugin, NULL, (sig), TRUE, G_CALLBACK(cb), viewer)
   /* Geany takes care of disconnecting these for us when the plugin is unloaded,
@@ -124,6 +132,7 @@ void plugin_init(GeanyData *data)
 /* Cleanup resources on plugin unload. */
 void plugin_cleanup(void)
 {
+  gtk_widget_destroy(g_export_item);
   gtk_widget_destroy(g_scrolled_win);
 }
 
@@ -152,8 +161,12 @@ static void
 update_markdown_viewer(MarkdownViewer *viewer)
 {
   GeanyDocument *doc = document_get_current();
+  gboolean is_markdown = DOC_VALID(doc) &&
+    g_strcmp0(doc->file_type->name, "Markdown") == 0;
+
+  gtk_widget_set_sensitive(g_export_item, is_markdown);
 
-  if (DOC_VALID(doc) && g_strcmp0(doc->file_type->name, "Markdown") == 0) {
+  if (is_markdown) {
     gchar *text;
     text = (gchar*) scintilla_send_message(doc->editor->sci, SCI_GETCHARACTERPOINTER, 0, 0);
     markdown_viewer_set_markdown(viewer, text, doc->encoding);
@@ -235,3 +248,14 @@ on_view_pos_notify(GObject *obj, GParamSpec *pspec, MarkdownViewer *viewer)
 
   update_markdown_viewer(viewer);
 }
+
+/* Export the current document to a file, without the preview */
+static void
+on_export_activate(GtkMenuItem *item, MarkdownViewer *viewer)
+{
+  GeanyDocument *doc = document_get_current();
+
+  if (DOC_VALID(doc)) {
+    markdown_export_document(viewer, doc);
+  }
+}
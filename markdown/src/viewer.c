@@ -32,6 +32,11 @@
 #include "conf.h"
 
 #define MD_ENC_MAX 256
+/* minimum time between two renderings, in milliseconds */
+#define MD_UPDATE_INTERVAL 250
+/* comments around the rendered markdown in the page, see update_page() */
+#define MD_BODY_START "<!--geany-markdown-start-->"
+#define MD_BODY_END "<!--geany-markdown-end-->"
 
 enum
 {
@@ -42,19 +47,78 @@ enum
   N_PROPERTIES
 };
 
+/* Placeholders substituted in the HTML template */
+enum
+{
+  TMPL_FONT_NAME,
+  TMPL_CODE_FONT_NAME,
+  TMPL_FONT_POINT_SIZE,
+  TMPL_CODE_FONT_POINT_SIZE,
+  TMPL_BG_COLOR,
+  TMPL_FG_COLOR,
+  TMPL_MARKDOWN,
+  TMPL_N_SLOTS
+};
+
+static const gchar *tmpl_slot_names[TMPL_N_SLOTS] = {
+  "@@font_name@@",
+  "@@code_font_name@@",
+  "@@font_point_size@@",
+  "@@code_font_point_size@@",
+  "@@bg_color@@",
+  "@@fg_color@@",
+  "@@markdown@@"
+};
+
+/* A literal run of the template text followed by a placeholder slot,
+ * or by nothing (-1) for the last part. */
+typedef struct
+{
+  gsize offset;
+  gsize len;
+  gint slot;
+} MarkdownTemplatePart;
+
 struct _MarkdownViewerPrivate
 {
   MarkdownConfig *conf;
   gulong load_handle;
   guint update_handle;
   gulong prop_handle;
+  gulong tmpl_handle;
   GString *text;
   gchar enc[MD_ENC_MAX];
   gdouble vscroll_pos;
   gdouble hscroll_pos;
+  gchar *tmpl_text; /* copy of the template the parts refer to */
+  GArray *tmpl_parts;
+  gboolean tmpl_can_patch; /* one @@markdown@@ inside the body */
+  GThreadPool *render_pool;
+  gint generation; /* of the latest rendering, older results are dropped */
+  GTimer *update_timer;
+  gchar *page_values; /* template values of the loaded page */
+  gboolean page_loaded;
+  /* used by the render thread only */
+  GHashTable *block_html; /* block text -> rendered HTML */
+  gchar *block_refs; /* reference definitions appended to every block */
 };
 
+/* A markdown to HTML conversion, done on the render thread */
+typedef struct
+{
+  MarkdownViewer *self;
+  gint generation;
+  gchar *text;
+  gsize len;
+  gchar *html;
+  GFunc func; /* for other work, see markdown_viewer_run_in_render_thread() */
+  gpointer data;
+} MarkdownRenderJob;
+
+static void markdown_viewer_dispose (GObject *object);
 static void markdown_viewer_finalize (GObject *object);
+static void render_job_run(MarkdownRenderJob *job, MarkdownViewer *self);
+static void markdown_viewer_clear_template(MarkdownViewer *self);
 
 static GParamSpec *viewer_props[N_PROPERTIES] = { NULL };
 
@@ -127,6 +191,7 @@ markdown_viewer_class_init(MarkdownViewerClass *klass)
   g_object_class = G_OBJECT_CLASS(klass);
   g_object_class->set_property = markdown_viewer_set_property;
   g_object_class->get_property = markdown_viewer_get_property;
+  g_object_class->dispose = markdown_viewer_dispose;
   g_object_class->finalize = markdown_viewer_finalize;
   g_type_class_add_private((gpointer)klass, sizeof(MarkdownViewerPrivate));
 
@@ -141,6 +206,24 @@ markdown_viewer_class_init(MarkdownViewerClass *klass)
   g_object_class_install_properties(g_object_class, N_PROPERTIES, viewer_props);
 }
 
+static void
+markdown_viewer_dispose(GObject *object)
+{
+  MarkdownViewer *self = MARKDOWN_VIEWER(object);
+  /* Results of renderings still running are not shown anymore */
+  g_atomic_int_inc(&self->priv->generation);
+  if (self->priv->conf && self->priv->prop_handle != 0) {
+    g_signal_handler_disconnect(self->priv->conf, self->priv->prop_handle);
+    g_signal_handler_disconnect(self->priv->conf, self->priv->tmpl_handle);
+    self->priv->prop_handle = self->priv->tmpl_handle = 0;
+  }
+  if (self->priv->update_handle != 0) {
+    g_source_remove(self->priv->update_handle);
+    self->priv->update_handle = 0;
+  }
+  G_OBJECT_CLASS(markdown_viewer_parent_class)->dispose(object);
+}
+
 static void
 markdown_viewer_finalize(GObject *object)
 {
@@ -148,12 +231,19 @@ markdown_viewer_finalize(GObject *object)
   g_return_if_fail(MARKDOWN_IS_VIEWER(object));
   self = MARKDOWN_VIEWER(object);
   if (self->priv->conf) {
-    g_signal_handler_disconnect(self->priv->conf, self->priv->prop_handle);
     g_object_unref(self->priv->conf);
   }
   if (self->priv->text) {
     g_string_free(self->priv->text, TRUE);
   }
+  markdown_viewer_clear_template(self);
+  /* Every job holds a reference, so none is left at this point */
+  g_thread_pool_free(self->priv->render_pool, FALSE, TRUE);
+  g_timer_destroy(self->priv->update_timer);
+  if (self->priv->block_html) {
+    g_hash_table_destroy(self->priv->block_html);
+  }
+  g_free(self->priv->block_refs);
   G_OBJECT_CLASS(markdown_viewer_parent_class)->finalize(object);
 }
 
@@ -161,6 +251,10 @@ static void
 markdown_viewer_init(MarkdownViewer *self)
 {
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self, MARKDOWN_TYPE_VIEWER, MarkdownViewerPrivate);
+  /* A single thread, the markdown libraries are not reentrant */
+  self->priv->render_pool = g_thread_pool_new((GFunc) render_job_run, self, 1,
+    FALSE, NULL);
+  self->priv->update_timer = g_timer_new();
 }
 
 
@@ -174,69 +268,160 @@ markdown_viewer_new(MarkdownConfig *conf)
   /* Cause the view to be updated whenever the config changes. */
   self->priv->prop_handle = g_signal_connect_swapped(self->priv->conf, "notify",
       G_CALLBACK(markdown_viewer_queue_update), self);
+  self->priv->tmpl_handle = g_signal_connect_swapped(self->priv->conf,
+      "notify::template-file", G_CALLBACK(markdown_viewer_clear_template), self);
 
   return GTK_WIDGET(self);
 }
 
 static void
-replace_all(MarkdownViewer *self,
-            GString *haystack,
-            const gchar *needle,
-            const gchar *replacement)
+markdown_viewer_clear_template(MarkdownViewer *self)
+{
+  g_free(self->priv->tmpl_text);
+  self->priv->tmpl_text = NULL;
+  /* A different template needs a page reload */
+  g_free(self->priv->page_values);
+  self->priv->page_values = NULL;
+  if (self->priv->tmpl_parts) {
+    g_array_free(self->priv->tmpl_parts, TRUE);
+    self->priv->tmpl_parts = NULL;
+  }
+}
+
+/* Splits the template into literal runs and placeholder slots, so that
+ * it is only searched once, and not for every preview refresh. */
+static void
+compile_template(MarkdownViewer *self)
 {
-  gchar *ptr;
-  gsize needle_len = strlen(needle);
+  const gchar *tmpl_text = markdown_config_get_template_text(self->priv->conf);
+  const gchar *ptr, *start;
+  MarkdownTemplatePart part;
+
+  markdown_viewer_clear_template(self);
+  self->priv->tmpl_text = g_strdup(tmpl_text ? tmpl_text : "");
+  self->priv->tmpl_parts = g_array_new(FALSE, FALSE, sizeof(MarkdownTemplatePart));
+
+  start = self->priv->tmpl_text;
+  for (ptr = strstr(start, "@@"); ptr != NULL; ptr = strstr(ptr, "@@")) {
+    gint slot;
+    gsize slot_len = 0;
+
+    for (slot = 0; slot < TMPL_N_SLOTS; slot++) {
+      slot_len = strlen(tmpl_slot_names[slot]);
+      if (strncmp(ptr, tmpl_slot_names[slot], slot_len) == 0)
+        break;
+    }
+
+    if (slot == TMPL_N_SLOTS) {
+      ptr++;
+      continue;
+    }
+
+    part.offset = start - self->priv->tmpl_text;
+    part.len = ptr - start;
+    part.slot = slot;
+    g_array_append_val(self->priv->tmpl_parts, part);
+    ptr += slot_len;
+    start = ptr;
+  }
+
+  part.offset = start - self->priv->tmpl_text;
+  part.len = strlen(start);
+  part.slot = -1;
+  g_array_append_val(self->priv->tmpl_parts, part);
 
-  /* For each occurrence of needle in haystack */
-  while ((ptr = strstr(haystack->str, needle)) != NULL) {
-    goffset offset = ptr - haystack->str;
-    g_string_erase(haystack, offset, needle_len);
-    g_string_insert(haystack, offset, replacement);
+  /* The page can only be patched if the markdown is in the body once */
+  {
+    gchar *lower = g_ascii_strdown(self->priv->tmpl_text, -1);
+    gchar *body = strstr(lower, "<body");
+    guint i, n_markdown = 0;
+
+    self->priv->tmpl_can_patch = FALSE;
+    for (i = 0; i < self->priv->tmpl_parts->len; i++) {
+      MarkdownTemplatePart *p;
+      p = &g_array_index(self->priv->tmpl_parts, MarkdownTemplatePart, i);
+      if (p->slot == TMPL_MARKDOWN) {
+        n_markdown++;
+        self->priv->tmpl_can_patch = body &&
+          (gsize) (body - lower) < p->offset + p->len;
+      }
+    }
+    if (n_markdown != 1)
+      self->priv->tmpl_can_patch = FALSE;
+    g_free(lower);
   }
 }
 
-static gchar *
-template_replace(MarkdownViewer *self, const gchar *html_text)
+/* Reads the configuration settings substituted in the template */
+static void
+read_template_values(MarkdownViewer *self, gchar *values[TMPL_N_SLOTS])
 {
-  MarkdownConfigViewPos view_pos;
   guint font_point_size = 0, code_font_point_size = 0;
-  gchar *font_name = NULL, *code_font_name = NULL;
-  gchar *bg_color = NULL, *fg_color = NULL;
-  gchar font_pt_size[10] = { 0 };
-  gchar code_font_pt_size[10] = { 0 };
-  GString *tmpl;
-
-  { /* Read all the configuration settings into strings */
-    g_object_get(self->priv->conf,
-                 "view-pos", &view_pos,
-                 "font-name", &font_name,
-                 "code-font-name", &code_font_name,
-                 "font-point-size", &font_point_size,
-                 "code-font-point-size", &code_font_point_size,
-                 "bg-color", &bg_color,
-                 "fg-color", &fg_color,
-                 NULL);
-    g_snprintf(font_pt_size, 10, "%d", font_point_size);
-    g_snprintf(code_font_pt_size, 10, "%d", code_font_point_size);
-  }
-
-  /* Load the template into a GString to be modified in place */
-  tmpl = g_string_new(markdown_config_get_template_text(self->priv->conf));
-
-  replace_all(self, tmpl, "@@font_name@@", font_name);
-  replace_all(self, tmpl, "@@code_font_name@@", code_font_name);
-  replace_all(self, tmpl, "@@font_point_size@@", font_pt_size);
-  replace_all(self, tmpl, "@@code_font_point_size@@", code_font_pt_size);
-  replace_all(self, tmpl, "@@bg_color@@", bg_color);
-  replace_all(self, tmpl, "@@fg_color@@", fg_color);
-  replace_all(self, tmpl, "@@markdown@@", html_text);
-
-  g_free(font_name);
-  g_free(code_font_name);
-  g_free(bg_color);
-  g_free(fg_color);
-
-  return g_string_free(tmpl, FALSE);
+
+  g_object_get(self->priv->conf,
+               "font-name", &values[TMPL_FONT_NAME],
+               "code-font-name", &values[TMPL_CODE_FONT_NAME],
+               "font-point-size", &font_point_size,
+               "code-font-point-size", &code_font_point_size,
+               "bg-color", &values[TMPL_BG_COLOR],
+               "fg-color", &values[TMPL_FG_COLOR],
+               NULL);
+  values[TMPL_FONT_POINT_SIZE] = g_strdup_printf("%d", font_point_size);
+  values[TMPL_CODE_FONT_POINT_SIZE] = g_strdup_printf("%d", code_font_point_size);
+  values[TMPL_MARKDOWN] = NULL;
+}
+
+static void
+free_template_values(gchar *values[TMPL_N_SLOTS])
+{
+  gint i;
+  for (i = 0; i < TMPL_N_SLOTS; i++) {
+    g_free(values[i]);
+  }
+}
+
+static gchar *
+template_replace(MarkdownViewer *self, gchar *values[TMPL_N_SLOTS],
+                 const gchar *html_text)
+{
+  const gchar *strs[TMPL_N_SLOTS];
+  gsize lens[TMPL_N_SLOTS];
+  gsize html_len = 0;
+  guint i;
+  GString *html;
+
+  for (i = 0; i < TMPL_N_SLOTS; i++) {
+    strs[i] = values[i] ? values[i] : "";
+  }
+  strs[TMPL_MARKDOWN] = html_text;
+
+  /* Size the output first, then fill it in a single pass */
+  for (i = 0; i < TMPL_N_SLOTS; i++) {
+    lens[i] = strlen(strs[i]);
+  }
+  /* The markers let update_page() find the markdown in the loaded page */
+  lens[TMPL_MARKDOWN] += strlen(MD_BODY_START) + strlen(MD_BODY_END);
+  for (i = 0; i < self->priv->tmpl_parts->len; i++) {
+    MarkdownTemplatePart *part;
+    part = &g_array_index(self->priv->tmpl_parts, MarkdownTemplatePart, i);
+    html_len += part->len + (part->slot >= 0 ? lens[part->slot] : 0);
+  }
+
+  html = g_string_sized_new(html_len + 1);
+  for (i = 0; i < self->priv->tmpl_parts->len; i++) {
+    MarkdownTemplatePart *part;
+    part = &g_array_index(self->priv->tmpl_parts, MarkdownTemplatePart, i);
+    g_string_append_len(html, self->priv->tmpl_text + part->offset, part->len);
+    if (part->slot == TMPL_MARKDOWN) {
+      g_string_append(html, MD_BODY_START);
+      g_string_append(html, strs[part->slot]);
+      g_string_append(html, MD_BODY_END);
+    }
+    else if (part->slot >= 0)
+      g_string_append_len(html, strs[part->slot], lens[part->slot]);
+  }
+
+  return g_string_free(html, FALSE);
 }
 
 static gboolean
@@ -302,58 +487,289 @@ on_webview_load_status_notify(WebKitWebView *view, GParamSpec *pspec,
 
   /* When the webkit is done loading, reset the scroll position. */
   if (load_status == WEBKIT_LOAD_FINISHED) {
+    self->priv->page_loaded = TRUE;
     pop_scroll_pos(self);
   }
 }
 
+/* Converts markdown to HTML, called from the render thread only */
 static gchar *
-markdown_viewer_get_html(MarkdownViewer *self)
+markdown_to_html(const gchar *text, gsize len)
 {
   gchar *md_as_html, *html = NULL;
 
-  /* Ensure the internal buffer is created */
-  if (!self->priv->text) {
-    update_internal_text(self, "");
-  }
-
-  {
 #ifndef FULL_PRICE  /* this version using Discount markdown library
                      * is faster but may invoke endless discussions
                      * about the GPL and licenses similar to (but the
                      * same as) the old BSD 4-clause license being
                      * incompatible */
-    MMIOT *doc;
-    doc = mkd_string(self->priv->text->str, self->priv->text->len, 0);
-    mkd_compile(doc, 0);
-    if (mkd_document(doc, &md_as_html) != EOF) {
-      html = template_replace(self, md_as_html);
-    }
-    mkd_cleanup(doc);
+  MMIOT *doc;
+  doc = mkd_string((gchar *) text, len, 0);
+  mkd_compile(doc, 0);
+  if (mkd_document(doc, &md_as_html) != EOF) {
+    html = g_strdup(md_as_html);
+  }
+  mkd_cleanup(doc);
 #else /* this version is slower but is unquestionably GPL-friendly
        * and the lib also has much more readable/maintainable code */
 
-    md_as_html = markdown_to_string(self->priv->text->str, 0, HTML_FORMAT);
-    if (md_as_html) {
-      html = template_replace(self, md_as_html);
-      g_free(md_as_html); /* TODO: become 100% convinced this wasn't
-                           * malloc()'d outside of GLIB functions with
-                           * libc allocator (probably same anyway). */
-    }
-#endif
+  md_as_html = markdown_to_string((gchar *) text, 0, HTML_FORMAT);
+  if (md_as_html) {
+    html = md_as_html; /* TODO: become 100% convinced this wasn't
+                        * malloc()'d outside of GLIB functions with
+                        * libc allocator (probably same anyway). */
   }
+#endif
 
   return html;
 }
 
 static gboolean
-markdown_viewer_update_view(MarkdownViewer *self)
+line_is_blank(const gchar *line, const gchar *end)
+{
+  for (; line < end; line++) {
+    if (*line != ' ' && *line != '\t')
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* A line that can not start a new block, as it may continue the previous
+ * one: indented lines, list items and block quotes. */
+static gboolean
+line_continues_block(const gchar *line, const gchar *end)
+{
+  const gchar *p = line;
+
+  if (*line == ' ' || *line == '\t' || *line == '>')
+    return TRUE;
+  if ((*line == '*' || *line == '+' || *line == '-') &&
+      line + 1 < end && (line[1] == ' ' || line[1] == '\t'))
+    return TRUE;
+  while (p < end && g_ascii_isdigit(*p))
+    p++;
+  return p > line && p + 1 < end && *p == '.' && (p[1] == ' ' || p[1] == '\t');
+}
+
+/* Reference definitions, like [id]: http://example.com/ */
+static gboolean
+line_is_reference(const gchar *line, const gchar *end)
+{
+  gint indent;
+
+  for (indent = 0; indent < 3 && line < end && *line == ' '; indent++)
+    line++;
+  if (line >= end || *line != '[')
+    return FALSE;
+  while (line < end && *line != ']')
+    line++;
+  return line + 1 < end && line[1] == ':';
+}
+
+static gboolean
+line_has(const gchar *line, const gchar *end, const gchar *str)
+{
+  gsize len = strlen(str);
+  for (; line + len <= end; line++) {
+    if (strncmp(line, str, len) == 0)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* Renders one block, reusing the HTML of the previous rendering if the
+ * block did not change */
+static void
+render_block(MarkdownViewer *self, GHashTable *block_html, GString *html,
+             const gchar *start, const gchar *end)
+{
+  gchar *block = g_strndup(start, end - start);
+  gpointer old_block, block_as_html;
+
+  if (self->priv->block_html && g_hash_table_lookup_extended(self->priv->block_html,
+      block, &old_block, &block_as_html)) {
+    g_hash_table_steal(self->priv->block_html, block);
+    g_free(old_block);
+  }
+  else if ((block_as_html = g_hash_table_lookup(block_html, block)) != NULL) {
+    /* the same block twice in the document */
+    block_as_html = g_strdup(block_as_html);
+  }
+  else {
+    gchar *src = g_strconcat(block, "\n", self->priv->block_refs, NULL);
+    block_as_html = markdown_to_html(src, strlen(src));
+    if (!block_as_html)
+      block_as_html = g_strdup("");
+    g_free(src);
+  }
+
+  g_string_append(html, block_as_html);
+  g_string_append_c(html, '\n');
+  g_hash_table_replace(block_html, block, block_as_html);
+}
+
+/* Splits the text in blocks at blank lines, where a block can not
+ * continue the previous one, and renders only the blocks that changed
+ * since the last time. Reference definitions are added to every block,
+ * so that links between blocks still work. */
+static gchar *
+render_blocks(MarkdownViewer *self, const gchar *text, gsize len)
+{
+  const gchar *text_end = text + len;
+  const gchar *line, *next;
+  const gchar *block_start = text;
+  GString *refs = g_string_new(NULL);
+  GString *html = g_string_sized_new(len * 2 + 1);
+  GHashTable *block_html;
+  gboolean prev_blank = FALSE, in_fence = FALSE, in_html = FALSE;
+
+  for (line = text; line < text_end; line = next) {
+    const gchar *end = memchr(line, '\n', text_end - line);
+    next = end ? end + 1 : text_end;
+    if (line_is_reference(line, end ? end : text_end)) {
+      g_string_append_len(refs, line, next - line);
+      if (!end)
+        g_string_append_c(refs, '\n');
+    }
+  }
+
+  /* Changed references may change the rendering of every block */
+  if (g_strcmp0(refs->str, self->priv->block_refs) != 0) {
+    if (self->priv->block_html) {
+      g_hash_table_destroy(self->priv->block_html);
+      self->priv->block_html = NULL;
+    }
+    g_free(self->priv->block_refs);
+    self->priv->block_refs = g_string_free(refs, FALSE);
+  }
+  else
+    g_string_free(refs, TRUE);
+
+  block_html = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+  for (line = text; line < text_end; line = next) {
+    const gchar *end = memchr(line, '\n', text_end - line);
+    gboolean blank;
+
+    if (!end)
+      end = text_end;
+    next = end < text_end ? end + 1 : text_end;
+    blank = line_is_blank(line, end);
+
+    if (!blank) {
+      if (prev_blank && !in_fence && !in_html && line > block_start &&
+          !line_continues_block(line, end)) {
+        render_block(self, block_html, html, block_start, line);
+        block_start = line;
+      }
+
+      if (end - line >= 3 && (strncmp(line, "```", 3) == 0 ||
+          strncmp(line, "~~~", 3) == 0))
+        in_fence = !in_fence;
+      /* HTML blocks may contain blank lines up to their end tag */
+      else if (!in_fence && line == block_start && *line == '<')
+        in_html = TRUE;
+      if (in_html && (line_has(line, end, "</") || line_has(line, end, "/>")))
+        in_html = FALSE;
+    }
+    prev_blank = blank;
+  }
+  if (text_end > block_start)
+    render_block(self, block_html, html, block_start, text_end);
+
+  /* Keep the HTML of the current blocks only */
+  if (self->priv->block_html)
+    g_hash_table_destroy(self->priv->block_html);
+  self->priv->block_html = block_html;
+
+  return g_string_free(html, FALSE);
+}
+
+/* Appends text as a JavaScript single quoted string literal */
+static void
+append_js_string(GString *script, const gchar *text)
 {
-  gchar *html = markdown_viewer_get_html(self);
+  const gchar *p;
+
+  g_string_append_c(script, '\'');
+  for (p = text; *p; p++) {
+    switch (*p) {
+      case '\\':
+        g_string_append(script, "\\\\");
+        break;
+      case '\'':
+        g_string_append(script, "\\'");
+        break;
+      case '\n':
+        g_string_append(script, "\\n");
+        break;
+      case '\r':
+        g_string_append(script, "\\r");
+        break;
+      default:
+        /* U+2028 and U+2029 end lines in JavaScript */
+        if ((guchar) p[0] == 0xE2 && (guchar) p[1] == 0x80 &&
+            ((guchar) p[2] == 0xA8 || (guchar) p[2] == 0xA9)) {
+          g_string_append(script, (guchar) p[2] == 0xA8 ? "\\u2028" : "\\u2029");
+          p += 2;
+        }
+        else
+          g_string_append_c(script, *p);
+        break;
+    }
+  }
+  g_string_append_c(script, '\'');
+}
 
-  push_scroll_pos(self);
+/* Shows new markdown HTML. If only the markdown changed since the page
+ * was loaded, the nodes between the markers are replaced in place, which
+ * keeps the scroll position. Otherwise the page is loaded again. */
+static void
+update_page(MarkdownViewer *self, const gchar *md_as_html)
+{
+  gchar *values[TMPL_N_SLOTS];
+  gchar *page_values;
 
-  if (html) {
+  if (!self->priv->tmpl_parts) {
+    compile_template(self);
+  }
+
+  read_template_values(self, values);
+  page_values = g_strjoin("\n", values[TMPL_FONT_NAME], values[TMPL_CODE_FONT_NAME],
+    values[TMPL_FONT_POINT_SIZE], values[TMPL_CODE_FONT_POINT_SIZE],
+    values[TMPL_BG_COLOR], values[TMPL_FG_COLOR], NULL);
+
+  if (self->priv->page_loaded && self->priv->tmpl_can_patch &&
+      g_strcmp0(page_values, self->priv->page_values) == 0) {
+    GString *script = g_string_sized_new(strlen(md_as_html) + 512);
+
+    g_string_append(script,
+      "(function(html) {"
+      "  var walker = document.createTreeWalker(document.body,"
+      "    NodeFilter.SHOW_COMMENT, null, false);"
+      "  var start = null, end = null, node, range;"
+      "  while ((node = walker.nextNode())) {"
+      "    if (node.nodeValue == 'geany-markdown-start') start = node;"
+      "    else if (node.nodeValue == 'geany-markdown-end') end = node;"
+      "  }"
+      "  if (!start || !end) return;"
+      "  range = document.createRange();"
+      "  range.setStartAfter(start);"
+      "  range.setEndBefore(end);"
+      "  range.deleteContents();"
+      "  range.insertNode(range.createContextualFragment(html));"
+      "})(");
+    append_js_string(script, md_as_html);
+    g_string_append(script, ");");
+    webkit_web_view_execute_script(WEBKIT_WEB_VIEW(self), script->str);
+    g_string_free(script, TRUE);
+    g_free(page_values);
+  }
+  else {
     static const gchar *base_uri = "file://.";
+    gchar *html = template_replace(self, values, md_as_html);
+
+    push_scroll_pos(self);
 
     /* Connect a signal handler (only needed once) to restore the scroll
      * position once the webview is reloaded. */
@@ -363,12 +779,69 @@ markdown_viewer_update_view(MarkdownViewer *self)
           G_CALLBACK(on_webview_load_status_notify), self);
     }
 
+    self->priv->page_loaded = FALSE;
+    g_free(self->priv->page_values);
+    self->priv->page_values = page_values;
     webkit_web_view_load_string(WEBKIT_WEB_VIEW(self), html, "text/html",
       self->priv->enc, base_uri);
 
     g_free(html);
   }
 
+  free_template_values(values);
+}
+
+static gboolean
+on_render_done(MarkdownRenderJob *job)
+{
+  MarkdownViewer *self = job->self;
+
+  if (job->html && job->generation == g_atomic_int_get(&self->priv->generation)) {
+    update_page(self, job->html);
+  }
+
+  g_free(job->text);
+  g_free(job->html);
+  g_object_unref(self);
+  g_free(job);
+
+  return FALSE;
+}
+
+static void
+render_job_run(MarkdownRenderJob *job, MarkdownViewer *self)
+{
+  if (job->func) {
+    job->func(job->data, NULL);
+    g_free(job);
+    return;
+  }
+  /* Skip texts already replaced by a newer one */
+  if (job->generation == g_atomic_int_get(&self->priv->generation)) {
+    job->html = render_blocks(self, job->text, job->len);
+  }
+  g_idle_add((GSourceFunc) on_render_done, job);
+}
+
+static gboolean
+markdown_viewer_update_view(MarkdownViewer *self)
+{
+  MarkdownRenderJob *job = g_new0(MarkdownRenderJob, 1);
+
+  /* Ensure the internal buffer is created */
+  if (!self->priv->text) {
+    update_internal_text(self, "");
+  }
+
+  /* Render a snapshot of the text, the result is shown from an idle */
+  job->self = g_object_ref(self);
+  g_atomic_int_inc(&self->priv->generation);
+  job->generation = self->priv->generation;
+  job->text = g_strndup(self->priv->text->str, self->priv->text->len);
+  job->len = self->priv->text->len;
+  g_thread_pool_push(self->priv->render_pool, job, NULL);
+
+  g_timer_start(self->priv->update_timer);
   if (self->priv->update_handle != 0) {
     g_source_remove(self->priv->update_handle);
   }
@@ -377,13 +850,40 @@ markdown_viewer_update_view(MarkdownViewer *self)
   return FALSE; /* When used as an idle handler, says to remove the source */
 }
 
+/* Runs func on the thread rendering the preview, after the renderings
+ * already queued, as the markdown libraries are not reentrant. The
+ * result is to be handed back to the main thread with an idle. */
+void
+markdown_viewer_run_in_render_thread(MarkdownViewer *self, GFunc func, gpointer data)
+{
+  MarkdownRenderJob *job;
+
+  g_return_if_fail(MARKDOWN_IS_VIEWER(self));
+  g_return_if_fail(func != NULL);
+
+  job = g_new0(MarkdownRenderJob, 1);
+  job->func = func;
+  job->data = data;
+  g_thread_pool_push(self->priv->render_pool, job, NULL);
+}
+
 void
 markdown_viewer_queue_update(MarkdownViewer *self)
 {
   g_return_if_fail(MARKDOWN_IS_VIEWER(self));
   if (self->priv->update_handle == 0) {
-    self->priv->update_handle = g_idle_add(
-      (GSourceFunc) markdown_viewer_update_view, self);
+    gdouble elapsed = g_timer_elapsed(self->priv->update_timer, NULL) * 1000;
+
+    /* Coalesce the updates of fast typing into one per interval */
+    if (elapsed >= MD_UPDATE_INTERVAL) {
+      self->priv->update_handle = g_idle_add(
+        (GSourceFunc) markdown_viewer_update_view, self);
+    }
+    else {
+      self->priv->update_handle = g_timeout_add(
+        MD_UPDATE_INTERVAL - (guint) elapsed,
+        (GSourceFunc) markdown_viewer_update_view, self);
+    }
   }
 }
 
@@ -56,6 +56,8 @@ GtkWidget *markdown_viewer_new(MarkdownConfig *conf);
 void markdown_viewer_set_markdown(MarkdownViewer *self, const gchar *text,
   const gchar *encoding);
 void markdown_viewer_queue_update(MarkdownViewer *self);
+void markdown_viewer_run_in_render_thread(MarkdownViewer *self, GFunc func,
+  gpointer data);
 
 G_END_DECLS
 
@@ -137,9 +137,16 @@ font=Monospace 9
 # output
 #scroll_on_output=false
 
-# The number of lines to keep in the scrollback buffer
+# The number of lines to keep in the scrollback buffer, or -1 to keep
+# them all (which makes the memory used grow with the output)
 #scrollback_lines=512
 
+# Seconds after which a terminal whose tab isn't shown drops all but
+# the last hibernate_scrollback_lines lines of its scrollback buffer to
+# save memory, its process keeps running.  Zero to never hibernate.
+#hibernate_delay=0
+#hibernate_scrollback_lines=100
+
 # Whether the terminal will present a visible bell when the child
 # sends a bell sequence.  The terminal will clear itself to the
 # default foreground color and then repaint itself.
@@ -320,6 +320,34 @@ namespace MultiTerm
 			}
 		}
 
+		public int hibernate_delay
+		{
+			get
+			{
+				try { return kf.get_integer(_section, "hibernate_delay"); }
+				catch (KeyFileError err) { return 0; }
+			}
+			set
+			{
+				kf.set_integer(_section, "hibernate_delay", value);
+				cfg.store_eventually();
+			}
+		}
+
+		public int hibernate_scrollback_lines
+		{
+			get
+			{
+				try { return kf.get_integer(_section, "hibernate_scrollback_lines"); }
+				catch (KeyFileError err) { return 100; }
+			}
+			set
+			{
+				kf.set_integer(_section, "hibernate_scrollback_lines", value);
+				cfg.store_eventually();
+			}
+		}
+
 		public bool visible_bell
 		{
 			get
@@ -29,6 +29,8 @@ namespace MultiTerm
 	{
 		public Vte.Terminal terminal;
 		private ShellConfig sh;
+		private bool started = false;
+		private uint hibernate_source = 0;
 
 		public signal bool right_click_event(EventButton event);
 
@@ -121,9 +123,64 @@ namespace MultiTerm
 
 		public void send_command(string command)
 		{
+			start();
 			terminal.feed_child("%s\n".printf(command), -1);
 		}
 
+		/* The shell is only spawned the first time the terminal is shown
+		 * (or used), so that the terminals never looked at cost nothing. */
+		public void start()
+		{
+			if (!started)
+			{
+				started = true;
+				run_command(this.sh.command);
+			}
+		}
+
+		private int scrollback_lines
+		{
+			get { return (sh.cfg != null) ? sh.scrollback_lines : 512; }
+		}
+
+		private void on_map()
+		{
+			if (hibernate_source != 0)
+			{
+				Source.remove(hibernate_source);
+				hibernate_source = 0;
+			}
+			/* the lines dropped while hibernating are lost */
+			terminal.set_scrollback_lines(scrollback_lines);
+			start();
+		}
+
+		private bool on_hibernate_timeout()
+		{
+			hibernate_source = 0;
+			if (sh.hibernate_scrollback_lines >= 0 &&
+				(scrollback_lines < 0 || sh.hibernate_scrollback_lines < scrollback_lines))
+			{
+				terminal.set_scrollback_lines(sh.hibernate_scrollback_lines);
+			}
+			return false;
+		}
+
+		private void on_destroy()
+		{
+			if (hibernate_source != 0)
+			{
+				Source.remove(hibernate_source);
+				hibernate_source = 0;
+			}
+		}
+
+		private void on_unmap()
+		{
+			if (started && sh.cfg != null && sh.hibernate_delay > 0 && hibernate_source == 0)
+				hibernate_source = Timeout.add_seconds(sh.hibernate_delay, on_hibernate_timeout);
+		}
+
 		public Terminal(ShellConfig sh)
 		{
 			VScrollbar vsb;
@@ -161,7 +218,7 @@ namespace MultiTerm
 				terminal.set_mouse_autohide(this.sh.pointer_autohide);
 				terminal.set_scroll_on_keystroke(this.sh.scroll_on_keystroke);
 				terminal.set_scroll_on_output(this.sh.scroll_on_output);
-				terminal.set_scrollback_lines(this.sh.scrollback_lines);
+				terminal.set_scrollback_lines(scrollback_lines);
 				terminal.set_visible_bell(this.sh.visible_bell);
 				terminal.set_word_chars(this.sh.word_chars);
 			}
@@ -176,13 +233,15 @@ namespace MultiTerm
 				terminal.set_mouse_autohide(false);
 				terminal.set_scroll_on_keystroke(true);
 				terminal.set_scroll_on_output(false);
-				terminal.set_scrollback_lines(512);
+				terminal.set_scrollback_lines(scrollback_lines);
 				terminal.set_visible_bell(false);
 				terminal.set_word_chars("");
 			}
 
 			terminal.realize.connect(on_vte_realize); /* colors can only be set on realize (lame) */
-			run_command(this.sh.command);
+			this.map.connect(on_map);
+			this.unmap.connect(on_unmap);
+			this.destroy.connect(on_destroy);
 		}
 
 	}
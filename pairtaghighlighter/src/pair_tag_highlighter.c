@@ -13,6 +13,8 @@
 #include <string.h>
 #include "Scintilla.h"  /* for the SCNotification struct */
 #include "SciLexer.h"
+#include "notifyprof.h"
+#include "largefile.h"
 
 #define INDICATOR_TAGMATCH 9
 #define MAX_TAG_NAME 64
@@ -30,6 +32,27 @@ GeanyFunctions  *geany_functions;
  * from the tag */
 static gint highlightedBrackets[] = {0, 0, 0, 0};
 
+/* Tags of a document, kept on its ScintillaObject and updated on every
+ * text change, so matching a tag is a lookup instead of a document scan.
+ * A tag is a valid '<' followed by the first valid '>' on the same line. */
+#define TAG_INDEX_KEY "pair-tag-highlighter-index"
+
+typedef struct
+{
+    gint openingBracket;
+    gint closingBracket;
+    GQuark name;
+    gboolean isOpening;
+    gint match;         /* index of the matching tag, -1 if none */
+} TagEntry;
+
+typedef struct
+{
+    GArray *tags;       /* TagEntry, in document order */
+    gint length;        /* document length the tags are valid for */
+    gboolean isPaired;  /* TagEntry.match is up to date */
+} TagIndex;
+
 PLUGIN_VERSION_CHECK(211)
 
 PLUGIN_SET_TRANSLATABLE_INFO(LOCALEDIR, GETTEXT_PACKAGE, _("Pair Tag Highlighter"),
@@ -37,13 +60,43 @@ PLUGIN_SET_TRANSLATABLE_INFO(LOCALEDIR, GETTEXT_PACKAGE, _("Pair Tag Highlighter
                             "1.1", "Volodymyr Kononenko <vm@kononenko.ws>")
 
 
+/* The document text is read directly through SCI_GETCHARACTERPOINTER,
+ * positions outside of it read as '\0', like sci_get_char_at() does. */
+static gchar char_at(const gchar *text, gint length, gint pos)
+{
+    return (pos >= 0 && pos < length) ? text[pos] : '\0';
+}
+
+
+static gboolean is_line_end(gchar c)
+{
+    return '\n' == c || '\r' == c;
+}
+
+
+/* '<' not starting a "<?" processing instruction */
+static gboolean is_opening_bracket(const gchar *text, gint length, gint pos)
+{
+    return '<' == text[pos] && '?' != char_at(text, length, pos+1);
+}
+
+
+/* '>' not ending a "->" comment or "?>" processing instruction */
+static gboolean is_closing_bracket(const gchar *text, gint length, gint pos)
+{
+    gchar charAtPrevPosition = char_at(text, length, pos-1);
+
+    return '>' == text[pos] && '-' != charAtPrevPosition && '?' != charAtPrevPosition;
+}
+
+
 /* Searches tag brackets.
  * direction variable shows sets search direction:
  * TRUE  - to the right
  * FALSE - to the left
  * from the current cursor position to the start of the line.
  */
-static gint findBracket(ScintillaObject *sci, gint position, gint endOfSearchPos,
+static gint findBracket(const gchar *text, gint length, gint position, gint endOfSearchPos,
                         gchar searchedBracket, gchar breakBracket, gboolean direction)
 {
     gint foundBracket = -1;
@@ -52,11 +105,11 @@ static gint findBracket(ScintillaObject *sci, gint position, gint endOfSearchPos
     if(TRUE == direction)
     {
         /* search to the right */
-        for(pos=position; pos<=endOfSearchPos; pos++)
+        for(pos=position; pos<=endOfSearchPos && pos<length; pos++)
         {
-            gchar charAtCurPosition = sci_get_char_at(sci, pos);
-            gchar charAtPrevPosition = sci_get_char_at(sci, pos-1);
-            gchar charAtNextPosition = sci_get_char_at(sci, pos+1);
+            gchar charAtCurPosition = text[pos];
+            gchar charAtPrevPosition = char_at(text, length, pos-1);
+            gchar charAtNextPosition = char_at(text, length, pos+1);
 
             if(charAtCurPosition == searchedBracket) {
                 if ('>' == searchedBracket) {
@@ -80,11 +133,11 @@ static gint findBracket(ScintillaObject *sci, gint position, gint endOfSearchPos
     else
     {
         /* search to the left */
-        for(pos=position-1; pos>=endOfSearchPos; pos--)
+        for(pos=MIN(position, length)-1; pos>=endOfSearchPos; pos--)
         {
-            gchar charAtCurPosition = sci_get_char_at(sci, pos);
-            gchar charAtPrevPosition = sci_get_char_at(sci, pos+1);
-            gchar charAtNextPosition = sci_get_char_at(sci, pos-1);
+            gchar charAtCurPosition = text[pos];
+            gchar charAtPrevPosition = char_at(text, length, pos+1);
+            gchar charAtNextPosition = char_at(text, length, pos-1);
 
             if(charAtCurPosition == searchedBracket)
             {
@@ -154,14 +207,9 @@ static void clear_previous_highlighting(ScintillaObject *sci, gint rangeStart, g
 }
 
 
-static gboolean is_tag_self_closing(ScintillaObject *sci, gint closingBracket)
+static gboolean is_tag_self_closing(const gchar *text, gint length, gint closingBracket)
 {
-    gboolean isTagSelfClosing = FALSE;
-    gchar charBeforeBracket = sci_get_char_at(sci, closingBracket-1);
-
-    if('/' == charBeforeBracket)
-        isTagSelfClosing = TRUE;
-    return isTagSelfClosing;
+    return '/' == char_at(text, length, closingBracket-1);
 }
 
 
@@ -182,124 +230,151 @@ static gboolean is_tag_empty(gchar *tagName)
 }
 
 
-static gboolean is_tag_opening(ScintillaObject *sci, gint openingBracket)
+static gboolean is_tag_opening(const gchar *text, gint length, gint openingBracket)
 {
-    gboolean isTagOpening = TRUE;
-    gchar charAfterBracket = sci_get_char_at(sci, openingBracket+1);
-
-    if('/' == charAfterBracket)
-        isTagOpening = FALSE;
-    return isTagOpening;
+    return '/' != char_at(text, length, openingBracket+1);
 }
 
 
-static void get_tag_name(ScintillaObject *sci, gint openingBracket, gint closingBracket,
+static void get_tag_name(const gchar *text, gint length, gint openingBracket,
                     gchar tagName[], gboolean isTagOpening)
 {
     gint nameStart = openingBracket + (TRUE == isTagOpening ? 1 : 2);
     gint nameEnd = nameStart;
-    gchar charAtCurPosition = sci_get_char_at(sci, nameStart);
 
-    while(' ' != charAtCurPosition && '>' != charAtCurPosition &&
-        '\t' != charAtCurPosition && '\r' != charAtCurPosition && '\n' != charAtCurPosition)
+    while(nameEnd < length && nameEnd-nameStart < MAX_TAG_NAME-1)
     {
-        charAtCurPosition = sci_get_char_at(sci, nameEnd);
-        nameEnd++;
-        if(nameEnd-nameStart > MAX_TAG_NAME)
+        gchar charAtCurPosition = text[nameEnd];
+
+        if(' ' == charAtCurPosition || '>' == charAtCurPosition ||
+            '\t' == charAtCurPosition || is_line_end(charAtCurPosition))
             break;
+        nameEnd++;
     }
-    sci_get_text_range(sci, nameStart, nameEnd-1, tagName);
+
+    memcpy(tagName, text + nameStart, nameEnd - nameStart);
+    tagName[nameEnd - nameStart] = '\0';
 }
 
 
-static void findMatchingOpeningTag(ScintillaObject *sci, gchar *tagName, gint openingBracket)
+/* Counts a tag against the searched one, returns TRUE when they are balanced */
+static gboolean count_tag(const gchar *text, gint length, gchar *tagName,
+                          gint openingBracket, gint *openingTagsCount, gint *closingTagsCount)
 {
-    gint pos;
+    gchar matchingTagName[MAX_TAG_NAME];
+    gboolean isMatchingTagOpening = is_tag_opening(text, length, openingBracket);
+
+    get_tag_name(text, length, openingBracket, matchingTagName, isMatchingTagOpening);
+    if(strcmp(tagName, matchingTagName) == 0)
+    {
+        if(TRUE == isMatchingTagOpening)
+            (*openingTagsCount)++;
+        else
+            (*closingTagsCount)++;
+    }
+
+    return *openingTagsCount == *closingTagsCount;
+}
+
+
+static void findMatchingOpeningTag(ScintillaObject *sci, const gchar *text, gint length,
+                                   gchar *tagName, gint openingBracket)
+{
+    gint pos = openingBracket;
     gint openingTagsCount = 0;
     gint closingTagsCount = 1;
 
-    for(pos=openingBracket; pos>0; pos--)
+    /* tags are searched from the right to the left, both brackets on the same line */
+    while(pos > 0)
     {
-        /* are we inside tag? */
-        gint lineNumber = sci_get_line_from_position(sci, pos);
-        gint lineStart = sci_get_position_from_line(sci, lineNumber);
-        gint matchingOpeningBracket = findBracket(sci, pos, lineStart, '<', '\0', FALSE);
-        gint matchingClosingBracket = findBracket(sci, pos, lineStart, '>', '\0', FALSE);
-
-        if(-1 != matchingOpeningBracket && -1 != matchingClosingBracket
-            && (matchingClosingBracket > matchingOpeningBracket))
+        gint matchingOpeningBracket = -1;
+        gint matchingClosingBracket = -1;
+        gint p;
+
+        for(p=pos-1; p>=0 && !is_line_end(text[p]); p--)
         {
-            /* we are inside of some tag. Let us check what tag*/
-            gchar matchingTagName[MAX_TAG_NAME];
-            gboolean isMatchingTagOpening = is_tag_opening(sci, matchingOpeningBracket);
-            get_tag_name(sci, matchingOpeningBracket, matchingClosingBracket,
-                            matchingTagName, isMatchingTagOpening);
-            if(strcmp(tagName, matchingTagName) == 0)
+            if(-1 == matchingClosingBracket && is_closing_bracket(text, length, p))
+                matchingClosingBracket = p;
+            else if(is_opening_bracket(text, length, p))
             {
-                if(TRUE == isMatchingTagOpening)
-                    openingTagsCount++;
-                else
-                    closingTagsCount++;
+                matchingOpeningBracket = p;
+                break;
             }
-            pos = matchingOpeningBracket+1;
         }
-        /* Speed up search: if findBracket returns -1, that means start of line
-         * is reached. There is no need to go through the same positions again.
-         * Jump to the start of line */
-        else if(-1 == matchingOpeningBracket || -1 == matchingClosingBracket)
+
+        if(-1 != matchingOpeningBracket && -1 != matchingClosingBracket)
         {
-            pos = lineStart;
+            if(count_tag(text, length, tagName, matchingOpeningBracket,
+                &openingTagsCount, &closingTagsCount))
+            {
+                /* matching tag is found */
+                highlightedBrackets[2] = matchingOpeningBracket;
+                highlightedBrackets[3] = matchingClosingBracket;
+                highlight_matching_pair(sci);
+                return;
+            }
+            pos = matchingOpeningBracket;
             continue;
         }
-        if(openingTagsCount == closingTagsCount)
+
+        if(-1 != matchingOpeningBracket)
         {
-            /* matching tag is found */
-            highlightedBrackets[2] = matchingOpeningBracket;
-            highlightedBrackets[3] = matchingClosingBracket;
-            highlight_matching_pair(sci);
-            return;
+            /* inside of a tag; continue left of it if there is some tag end */
+            for(p=matchingOpeningBracket-1; p>=0 && !is_line_end(text[p]); p--)
+                if(is_closing_bracket(text, length, p))
+                    break;
+            if(p >= 0 && !is_line_end(text[p]))
+            {
+                pos = matchingOpeningBracket;
+                continue;
+            }
         }
+
+        /* no tag on the rest of the line: jump to the end of the previous line */
+        while(p >= 0 && !is_line_end(text[p]))
+            p--;
+        pos = p;
     }
     highlight_tag(sci, highlightedBrackets[0], highlightedBrackets[1],
                   NONMATCHING_PAIR_COLOR);
 }
 
 
-static void findMatchingClosingTag(ScintillaObject *sci, gchar *tagName, gint closingBracket)
+static void findMatchingClosingTag(ScintillaObject *sci, const gchar *text, gint length,
+                                   gchar *tagName, gint closingBracket)
 {
-    gint pos;
-    gint linesInDocument = sci_get_line_count(sci);
-    gint endOfDocument = sci_get_position_from_line(sci, linesInDocument);
+    gint pos = closingBracket;
     gint openingTagsCount = 1;
     gint closingTagsCount = 0;
 
-    for(pos=closingBracket; pos<endOfDocument; pos++)
+    /* tags are searched from the left to the right, both brackets on the same line */
+    while(pos < length)
     {
-        /* are we inside tag? */
-        gint lineNumber = sci_get_line_from_position(sci, pos);
-        gint lineEnd = sci_get_line_end_position(sci, lineNumber);
-        gint matchingOpeningBracket = findBracket(sci, pos, lineEnd, '<', '\0', TRUE);
-        gint matchingClosingBracket = findBracket(sci, pos, lineEnd, '>', '\0', TRUE);
-
-        if(-1 != matchingOpeningBracket && -1 != matchingClosingBracket
-            && (matchingClosingBracket > matchingOpeningBracket))
+        const gchar *found = memchr(text + pos, '<', length - pos);
+        gint matchingOpeningBracket;
+        gint matchingClosingBracket;
+
+        if(NULL == found)
+            break;
+
+        matchingOpeningBracket = found - text;
+        pos = matchingOpeningBracket + 1;
+        if(!is_opening_bracket(text, length, matchingOpeningBracket))
+            continue;
+
+        for(matchingClosingBracket=pos; matchingClosingBracket<length;
+            matchingClosingBracket++)
         {
-            /* we are inside of some tag. Let us check what tag*/
-            gchar matchingTagName[64];
-            gboolean isMatchingTagOpening = is_tag_opening(sci, matchingOpeningBracket);
-            get_tag_name(sci, matchingOpeningBracket, matchingClosingBracket,
-                            matchingTagName, isMatchingTagOpening);
-            if(strcmp(tagName, matchingTagName) == 0)
-            {
-                if(TRUE == isMatchingTagOpening)
-                    openingTagsCount++;
-                else
-                    closingTagsCount++;
-            }
-            pos = matchingClosingBracket;
+            if(is_line_end(text[matchingClosingBracket]) ||
+                is_closing_bracket(text, length, matchingClosingBracket))
+                break;
         }
 
-        if(openingTagsCount == closingTagsCount)
+        if(matchingClosingBracket == length || is_line_end(text[matchingClosingBracket]))
+            continue;
+
+        if(count_tag(text, length, tagName, matchingOpeningBracket,
+            &openingTagsCount, &closingTagsCount))
         {
             /* matching tag is found */
             highlightedBrackets[2] = matchingOpeningBracket;
@@ -307,38 +382,260 @@ static void findMatchingClosingTag(ScintillaObject *sci, gchar *tagName, gint cl
             highlight_matching_pair(sci);
             return;
         }
+        pos = matchingClosingBracket + 1;
     }
     highlight_tag(sci, highlightedBrackets[0], highlightedBrackets[1],
                   NONMATCHING_PAIR_COLOR);
 }
 
 
-static void findMatchingTag(ScintillaObject *sci, gint openingBracket, gint closingBracket)
+static void tag_index_free(TagIndex *index)
+{
+    g_array_free(index->tags, TRUE);
+    g_free(index);
+}
+
+
+/* Appends the tags starting in [start, end) to the array */
+static void scan_tags(const gchar *text, gint length, gint start, gint end, GArray *tags)
+{
+    gint pos = start;
+
+    while(pos < end)
+    {
+        const gchar *found = memchr(text + pos, '<', end - pos);
+        gint openingBracket;
+        gint closingBracket;
+
+        if(NULL == found)
+            break;
+
+        openingBracket = found - text;
+        pos = openingBracket + 1;
+        if(!is_opening_bracket(text, length, openingBracket))
+            continue;
+
+        for(closingBracket=pos; closingBracket<length; closingBracket++)
+        {
+            if(is_line_end(text[closingBracket]) ||
+                is_closing_bracket(text, length, closingBracket))
+                break;
+        }
+
+        if(closingBracket < length && !is_line_end(text[closingBracket]))
+        {
+            gchar tagName[MAX_TAG_NAME];
+            TagEntry tag;
+
+            tag.openingBracket = openingBracket;
+            tag.closingBracket = closingBracket;
+            tag.isOpening = is_tag_opening(text, length, openingBracket);
+            get_tag_name(text, length, openingBracket, tagName, tag.isOpening);
+            tag.name = g_quark_from_string(tagName);
+            tag.match = -1;
+            g_array_append_val(tags, tag);
+            pos = closingBracket + 1;
+        }
+    }
+}
+
+
+/* Returns the index of the first tag starting at or after position */
+static guint find_tag(GArray *tags, gint position)
+{
+    guint low = 0;
+    guint high = tags->len;
+
+    while(low < high)
+    {
+        guint mid = (low + high) / 2;
+
+        if(g_array_index(tags, TagEntry, mid).openingBracket < position)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+
+static void free_tag_stack(GArray *stack)
+{
+    g_array_free(stack, TRUE);
+}
+
+
+/* Pairs the tags by name, the same way as counting opening and closing
+ * tags from either of them does */
+static void pair_tags(TagIndex *index)
+{
+    GHashTable *stacks = g_hash_table_new_full(NULL, NULL, NULL,
+                                               (GDestroyNotify) free_tag_stack);
+    gint i;
+
+    for(i=0; i<(gint) index->tags->len; i++)
+    {
+        TagEntry *tag = &g_array_index(index->tags, TagEntry, i);
+        GArray *stack = g_hash_table_lookup(stacks, GUINT_TO_POINTER(tag->name));
+
+        tag->match = -1;
+        if(TRUE == tag->isOpening)
+        {
+            if(NULL == stack)
+            {
+                stack = g_array_new(FALSE, FALSE, sizeof(gint));
+                g_hash_table_insert(stacks, GUINT_TO_POINTER(tag->name), stack);
+            }
+            g_array_append_val(stack, i);
+        }
+        else if(NULL != stack && stack->len > 0)
+        {
+            gint opening = g_array_index(stack, gint, stack->len-1);
+
+            g_array_set_size(stack, stack->len-1);
+            tag->match = opening;
+            g_array_index(index->tags, TagEntry, opening).match = i;
+        }
+    }
+
+    g_hash_table_destroy(stacks);
+    index->isPaired = TRUE;
+}
+
+
+/* Returns the document tags, building them on first use */
+static TagIndex *get_tag_index(ScintillaObject *sci, const gchar *text, gint length)
+{
+    TagIndex *index = g_object_get_data(G_OBJECT(sci), TAG_INDEX_KEY);
+
+    /* changes we were not notified about */
+    if(NULL != index && index->length != length)
+        index = NULL;
+
+    if(NULL == index)
+    {
+        index = g_new0(TagIndex, 1);
+        index->tags = g_array_new(FALSE, FALSE, sizeof(TagEntry));
+        index->length = length;
+        scan_tags(text, length, 0, length, index->tags);
+        g_object_set_data_full(G_OBJECT(sci), TAG_INDEX_KEY, index,
+                               (GDestroyNotify) tag_index_free);
+    }
+
+    if(FALSE == index->isPaired)
+        pair_tags(index);
+
+    return index;
+}
+
+
+/* Rescans the lines touched by an insertion (delta > 0) or deletion
+ * (delta < 0) at position, and moves the tags after them */
+static void update_tag_index(ScintillaObject *sci, gint position, gint delta)
+{
+    TagIndex *index = g_object_get_data(G_OBJECT(sci), TAG_INDEX_KEY);
+    const gchar *text;
+    gint length;
+    gint regionStart;
+    gint regionEnd;
+    guint first;
+    guint last;
+    guint i;
+    GArray *tags;
+
+    if(NULL == index)
+        return;
+
+    length = sci_get_length(sci);
+    if(index->length + delta != length)
+    {
+        g_object_set_data(G_OBJECT(sci), TAG_INDEX_KEY, NULL);
+        return;
+    }
+
+    text = (const gchar *) scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+    regionStart = sci_get_position_from_line(sci, sci_get_line_from_position(sci, position));
+    regionEnd = sci_get_line_end_position(sci,
+        sci_get_line_from_position(sci, position + MAX(delta, 0)));
+
+    /* the old tags of the region, in positions before the change */
+    first = find_tag(index->tags, regionStart);
+    last = find_tag(index->tags, regionEnd - delta + 1);
+    g_array_remove_range(index->tags, first, last - first);
+
+    for(i=first; i<index->tags->len; i++)
+    {
+        TagEntry *tag = &g_array_index(index->tags, TagEntry, i);
+
+        tag->openingBracket += delta;
+        tag->closingBracket += delta;
+    }
+
+    tags = g_array_new(FALSE, FALSE, sizeof(TagEntry));
+    scan_tags(text, length, regionStart, regionEnd, tags);
+    g_array_insert_vals(index->tags, first, tags->data, tags->len);
+    g_array_free(tags, TRUE);
+
+    index->length = length;
+    index->isPaired = FALSE;
+}
+
+
+static void findMatchingTag(ScintillaObject *sci, const gchar *text, gint length,
+                            gint openingBracket, gint closingBracket)
 {
     gchar tagName[MAX_TAG_NAME];
-    gboolean isTagOpening = is_tag_opening(sci, openingBracket);
+    gboolean isTagOpening = is_tag_opening(text, length, openingBracket);
+    TagIndex *index;
+    TagEntry *tag;
+    guint i;
 
-    get_tag_name(sci, openingBracket, closingBracket, tagName, isTagOpening);
+    get_tag_name(text, length, openingBracket, tagName, isTagOpening);
 
-    if(is_tag_self_closing(sci, closingBracket) || is_tag_empty(tagName)) {
+    if(is_tag_self_closing(text, length, closingBracket) || is_tag_empty(tagName)) {
         highlight_tag(sci, openingBracket, closingBracket, EMPTY_TAG_COLOR);
+        return;
+    }
+
+    index = get_tag_index(sci, text, length);
+    i = find_tag(index->tags, openingBracket);
+    tag = i < index->tags->len ? &g_array_index(index->tags, TagEntry, i) : NULL;
+
+    if(NULL != tag && tag->openingBracket == openingBracket &&
+        tag->closingBracket == closingBracket)
+    {
+        if(-1 != tag->match)
+        {
+            TagEntry *matchingTag = &g_array_index(index->tags, TagEntry, tag->match);
+
+            highlightedBrackets[2] = matchingTag->openingBracket;
+            highlightedBrackets[3] = matchingTag->closingBracket;
+            highlight_matching_pair(sci);
+        }
+        else
+            highlight_tag(sci, openingBracket, closingBracket, NONMATCHING_PAIR_COLOR);
     } else {
+        /* the cursor tag is not split the same way as when reading from
+         * the line start, e.g. "<a <b>", so search for the match */
         if(isTagOpening)
-            findMatchingClosingTag(sci, tagName, closingBracket);
+            findMatchingClosingTag(sci, text, length, tagName, closingBracket);
         else
-            findMatchingOpeningTag(sci, tagName, openingBracket);
+            findMatchingOpeningTag(sci, text, length, tagName, openingBracket);
     }
 }
 
 
 static void run_tag_highlighter(ScintillaObject *sci)
 {
+    const gchar *text = (const gchar *) scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+    gint length = sci_get_length(sci);
     gint position = sci_get_current_position(sci);
     gint lineNumber = sci_get_current_line(sci);
     gint lineStart = sci_get_position_from_line(sci, lineNumber);
     gint lineEnd = sci_get_line_end_position(sci, lineNumber);
-    gint openingBracket = findBracket(sci, position, lineStart, '<', '>', FALSE);
-    gint closingBracket = findBracket(sci, position, lineEnd, '>', '<', TRUE);
+    gint openingBracket = findBracket(text, length, position, lineStart, '<', '>', FALSE);
+    gint closingBracket = findBracket(text, length, position, lineEnd, '>', '<', TRUE);
     int i;
 
     if(-1 == openingBracket || -1 == closingBracket)
@@ -364,7 +661,7 @@ static void run_tag_highlighter(ScintillaObject *sci)
         highlightedBrackets[0] = openingBracket;
         highlightedBrackets[1] = closingBracket;
 
-        findMatchingTag(sci, openingBracket, closingBracket);
+        findMatchingTag(sci, text, length, openingBracket, closingBracket);
     }
 }
 
@@ -375,6 +672,23 @@ static gboolean on_editor_notify(GObject *obj, GeanyEditor *editor,
 {
     gint lexer;
 
+    /* the tag index covers the whole document */
+    if(gp_large_file_check(editor->document))
+    {
+        g_object_set_data(G_OBJECT(editor->sci), TAG_INDEX_KEY, NULL);
+        return FALSE;
+    }
+
+    /* keep the tags up to date, also in other modes, to reuse them later */
+    if(SCN_MODIFIED == nt->nmhdr.code)
+    {
+        if(nt->modificationType & SC_MOD_INSERTTEXT)
+            update_tag_index(editor->sci, nt->position, nt->length);
+        else if(nt->modificationType & SC_MOD_DELETETEXT)
+            update_tag_index(editor->sci, nt->position, -nt->length);
+        return FALSE;
+    }
+
     lexer = sci_get_lexer(editor->sci);
     if((lexer != SCLEX_HTML) && (lexer != SCLEX_XML))
     {
@@ -394,21 +708,30 @@ static gboolean on_editor_notify(GObject *obj, GeanyEditor *editor,
 }
 
 
+GP_NOTIFY_PROFILE_EDITOR_HANDLER(on_editor_notify_profiled, on_editor_notify)
+
+
 PluginCallback plugin_callbacks[] =
 {
-    { "editor-notify", (GCallback) &on_editor_notify, FALSE, NULL },
+    { "editor-notify", (GCallback) &on_editor_notify_profiled, FALSE, NULL },
     { NULL, NULL, FALSE, NULL }
 };
 
 
 void plugin_init(GeanyData *data)
 {
+    gp_large_file_register(geany_plugin, _("Tag pair highlighting"), GP_LARGE_FILE_DISABLED);
 }
 
 
 void plugin_cleanup(void)
 {
     GeanyDocument *doc = document_get_current();
+    guint i;
+
+    gp_large_file_unregister(geany_plugin);
+    foreach_document(i)
+        g_object_set_data(G_OBJECT(documents[i]->editor->sci), TAG_INDEX_KEY, NULL);
 
     if (doc)
     {
@@ -45,6 +45,14 @@ PLUGIN_SET_TRANSLATABLE_INFO (
 )
 
 
+/* GTK compatibility functions/macros */
+
+#if ! GTK_CHECK_VERSION (2, 18, 0)
+# define gtk_widget_get_visible(w) \
+  (GTK_WIDGET_VISIBLE (w))
+#endif
+
+
 enum {
   GPH_KB_GOTO_PREV,
   GPH_KB_GOTO_NEXT,
@@ -56,7 +64,9 @@ enum {
   GPH_KB_GOTO_NEXT_UNTRANSLATED_OR_FUZZY,
   GPH_KB_PASTE_UNTRANSLATED,
   GPH_KB_REFLOW,
+  GPH_KB_REFLOW_ALL,
   GPH_KB_TOGGLE_FUZZY,
+  GPH_KB_SHOW_STATISTICS,
   GPH_KB_COUNT
 };
 
@@ -65,9 +75,19 @@ static struct Plugin {
   gboolean update_headers;
   
   GtkWidget *menu_item;
+  
+  struct {
+    GtkWidget  *window;
+    GtkWidget  *translated;
+    GtkWidget  *fuzzy;
+    GtkWidget  *untranslated;
+    GtkWidget  *progress;
+    guint       update_source;
+  } stats;
 } plugin = {
   TRUE,
-  NULL
+  NULL,
+  { NULL, NULL, NULL, NULL, NULL, 0 }
 };
 
 
@@ -76,12 +96,6 @@ static struct Plugin {
                         (doc)->file_type->id == GEANY_FILETYPES_PO)
 
 
-/* gets the smallest valid position between @a and @b */
-#define MIN_POS(a, b) ((a) < 0 ? (b) : (b) < 0 ? (a) : MIN ((a), (b)))
-/* gets the highest valid position between @a and @b */
-#define MAX_POS(a, b) (MAX ((a), (b)))
-
-
 /*
  * find_style:
  * @sci: a #ScintillaObject
@@ -126,196 +140,438 @@ find_style (ScintillaObject  *sci,
   return pos;
 }
 
-/*
- * find_message:
- * @doc: A #GeanyDocument
- * @start: start of the search range
- * @end: end of the search range
- * 
- * Finds the start position of the next msgstr in the given range.  If start is
- * > end, searches backwards.
- * 
- * Returns: The start position of the next msgstr in the given range, or -1 if
- *          not found.
- */
-static gint
-find_message (GeanyDocument  *doc,
-              gint            start,
-              gint            end)
+/* message index */
+
+/* number of characters read at once when indexing */
+#define INDEX_CHUNK_SIZE 65536
+
+/* what to search for in the index */
+enum {
+  GPH_MATCH_ANY           = 0,
+  GPH_MATCH_UNTRANSLATED  = 1 << 0,
+  GPH_MATCH_FUZZY         = 1 << 1
+};
+
+typedef struct {
+  gint      start;        /* start of the entry, including its comments */
+  gint      msgid;        /* position of the msgid keyword, or -1 */
+  gint      msgstr;       /* start of the translation text, or -1 */
+  guint     fuzzy : 1;
+  guint     translated : 1;
+  guint     header : 1;   /* whether the msgid is empty */
+} GphEntry;
+
+/* Entries of a document, sorted by position.  They cover the whole document,
+ * each one going from its first comment to the start of the next one.
+ * Modifications shift the following entries and mark the modified range as
+ * dirty, it gets parsed again the next time the index is used. */
+typedef struct {
+  GArray   *entries;
+  gint      dirty_start;  /* start of the range to parse again, or -1 */
+  gint      dirty_end;
+  /* statistics of the entries, like msgfmt's */
+  gint      n_translated;
+  gint      n_fuzzy;
+  gint      n_untranslated;
+} GphIndex;
+
+/* parser state, kept between chunks */
+typedef struct {
+  GphEntry  entry;
+  gboolean  in_msgstr;    /* whether the msgstr keyword has been seen */
+  gboolean  in_text;      /* whether we're in the first msgstr text */
+  gboolean  text_done;    /* whether the first msgstr text is over */
+  gchar     word[8];      /* current word in a flags comment */
+  guint     word_len;
+} GphParser;
+
+static GHashTable *G_indexes = NULL;
+
+
+static void
+index_free (gpointer data)
 {
-  if (doc_is_po (doc)) {
-    ScintillaObject *sci = doc->editor->sci;
-    gint pos = find_style (sci, SCE_PO_MSGSTR, start, end);
-    
-    if (pos >= 0) {
-      pos = find_style (sci, SCE_PO_MSGSTR_TEXT, pos, sci_get_length (sci));
-      if (pos >= 0) {
-        return pos + 1;
-      } 
-    }
-  }
+  GphIndex *index = data;
   
-  return -1;
+  g_array_free (index->entries, TRUE);
+  g_slice_free (GphIndex, index);
 }
 
-/*
- * find_untranslated:
- * @doc: A #GeanyDocument
- * @start: start of the search range
- * @end: end of the search range
- * 
- * Searches for the next untranslated message in the given range.  If start is
- * > end, searches backwards.
- * 
- * Returns: The start position of the next untranslated message in the given
- *          range, or -1 if not found.
- */
-static gint
-find_untranslated (GeanyDocument *doc,
-                   gint           start,
-                   gint           end)
+static void
+parser_start_entry (GphParser  *parser,
+                    gint        start)
 {
-  if (doc_is_po (doc)) {
-    ScintillaObject *sci = doc->editor->sci;
-    gboolean backwards = start > end;
+  memset (parser, 0, sizeof *parser);
+  parser->entry.start = start;
+  parser->entry.msgid = -1;
+  parser->entry.msgstr = -1;
+}
+
+static void
+parser_end_word (GphParser *parser)
+{
+  if (parser->word_len == 5 && strncmp (parser->word, "fuzzy", 5) == 0) {
+    parser->entry.fuzzy = TRUE;
+  }
+  parser->word_len = 0;
+}
+
+static void
+parser_feed (GphParser *parser,
+             GArray    *entries,
+             gint       pos,
+             gchar      ch,
+             gint       style)
+{
+  if (parser->in_msgstr &&
+      style != SCE_PO_MSGSTR &&
+      style != SCE_PO_MSGSTR_TEXT &&
+      style != SCE_PO_DEFAULT) {
+    /* anything else than the translation starts the next entry */
+    parser_end_word (parser);
+    g_array_append_val (entries, parser->entry);
+    parser_start_entry (parser, pos);
+  }
+  
+  if (style == SCE_PO_FUZZY || style == SCE_PO_FLAGS) {
+    if (g_ascii_isalnum (ch) || ch == '-' || ch == '_') {
+      if (parser->word_len < sizeof parser->word) {
+        parser->word[parser->word_len] = ch;
+      }
+      parser->word_len++;
+    } else {
+      parser_end_word (parser);
+    }
+  } else if (parser->word_len > 0) {
+    parser_end_word (parser);
+  }
+  
+  switch (style) {
+    case SCE_PO_MSGID:
+      if (parser->entry.msgid < 0) {
+        parser->entry.msgid = pos;
+        parser->entry.header = TRUE;
+      }
+      break;
     
-    while (start >= 0) {
-      gint pos;
-      
-      if (backwards) {
-        start = find_style (sci, SCE_PO_MSGID, start, end);
+    case SCE_PO_MSGID_TEXT:
+      if (ch != '"') {
+        parser->entry.header = FALSE;
       }
-      
-      pos = find_message (doc, start, end);
-      if (pos < 0) {
-        return -1;
-      } else {
-        gint i = pos;
-        
-        for (i = pos; i < sci_get_length (sci); i++) {
-          gint style = sci_get_style_at (sci, i);
-          
-          if (style == SCE_PO_MSGSTR_TEXT) {
-            if (sci_get_char_at (sci, i) != '"') {
-              /* if any character in the text is not a delimiter, there's a
-               * translation */
-              i = -1;
-              break;
-            }
-          } else if (style != SCE_PO_DEFAULT) {
-            /* if we reached something else than the text and the background,
-             * we're done searching */
-            break;
-          }
+      break;
+    
+    case SCE_PO_MSGSTR:
+      parser->in_msgstr = TRUE;
+      if (parser->in_text) {
+        /* a plural form, only the first one is checked */
+        parser->in_text = FALSE;
+        parser->text_done = TRUE;
+      }
+      break;
+    
+    case SCE_PO_MSGSTR_TEXT:
+      if (parser->in_msgstr && ! parser->text_done) {
+        if (! parser->in_text) {
+          parser->in_text = TRUE;
+          parser->entry.msgstr = pos + 1;
+        } else if (ch != '"') {
+          /* if any character in the text is not a delimiter, there's a
+           * translation */
+          parser->entry.translated = TRUE;
         }
-        if (i >= 0)
-          return pos;
       }
-      
-      start = pos;
+      break;
+  }
+}
+
+/* parses the entries in [@start, @end), @start being the start of an entry.
+ * The last entry ends at @end. */
+static GArray *
+index_parse (ScintillaObject *sci,
+             gint             start,
+             gint             end)
+{
+  GArray *entries = g_array_new (FALSE, FALSE, sizeof (GphEntry));
+  gchar *buf = g_malloc (INDEX_CHUNK_SIZE * 2 + 2);
+  GphParser parser;
+  gint chunk;
+  
+  /* the lexer only styles what's needed for display, style the rest */
+  scintilla_send_message (sci, SCI_COLOURISE, (uptr_t) start, end);
+  
+  parser_start_entry (&parser, start);
+  for (chunk = start; chunk < end; chunk += INDEX_CHUNK_SIZE) {
+    struct Sci_TextRange tr;
+    gint len = MIN (INDEX_CHUNK_SIZE, end - chunk);
+    gint i;
+    
+    tr.chrg.cpMin = chunk;
+    tr.chrg.cpMax = chunk + len;
+    tr.lpstrText = buf;
+    /* fills @buf with character and style pairs */
+    scintilla_send_message (sci, SCI_GETSTYLEDTEXT, 0, (sptr_t) &tr);
+    for (i = 0; i < len; i++) {
+      parser_feed (&parser, entries, chunk + i,
+                   buf[i * 2], (guchar) buf[i * 2 + 1]);
     }
   }
+  parser_end_word (&parser);
+  if (start < end) {
+    g_array_append_val (entries, parser.entry);
+  }
   
-  return -1;
+  g_free (buf);
+  
+  return entries;
 }
 
-static gint
-find_prev_untranslated (GeanyDocument  *doc)
+/* adds (@sign > 0) or removes (@sign < 0) @n_entries entries to the
+ * statistics of @index */
+static void
+index_count (GphIndex        *index,
+             const GphEntry  *entries,
+             guint            n_entries,
+             gint             sign)
 {
-  return find_untranslated (doc, sci_get_current_position (doc->editor->sci),
-                            0);
+  guint i;
+  
+  for (i = 0; i < n_entries; i++) {
+    if (entries[i].msgstr < 0 || entries[i].header) {
+      /* not a message */
+    } else if (entries[i].fuzzy && entries[i].translated) {
+      index->n_fuzzy += sign;
+    } else if (entries[i].translated) {
+      index->n_translated += sign;
+    } else {
+      index->n_untranslated += sign;
+    }
+  }
 }
 
+/* gets the index of the last entry starting at or before @pos, or -1 */
 static gint
-find_next_untranslated (GeanyDocument  *doc)
+index_find_entry (GphIndex *index,
+                  gint      pos)
 {
-  return find_untranslated (doc, sci_get_current_position (doc->editor->sci),
-                            sci_get_length (doc->editor->sci));
+  gint lo = 0;
+  gint hi = (gint) index->entries->len;
+  
+  /* the first entry at or after @pos */
+  while (lo < hi) {
+    gint mid = lo + (hi - lo) / 2;
+    
+    if (g_array_index (index->entries, GphEntry, mid).start <= pos) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  
+  return lo - 1;
 }
 
-static gint
-find_fuzzy (GeanyDocument  *doc,
-            gint            start,
-            gint            end)
+/* parses again the dirty range of @index */
+static void
+index_refresh (GphIndex        *index,
+               ScintillaObject *sci)
 {
-  if (doc_is_po (doc)) {
-    ScintillaObject *sci = doc->editor->sci;
+  gint length = sci_get_length (sci);
+  gint first;
+  gint last;
+  gint end;
+  GArray *entries;
+  
+  if (index->dirty_start < 0) {
+    return;
+  }
+  
+  first = MAX (0, index_find_entry (index, index->dirty_start));
+  /* the first entry after the dirty range is untouched */
+  last = index_find_entry (index, index->dirty_end) + 1;
+  
+  while (TRUE) {
+    GphEntry *last_entry;
     
-    if (start > end) {
-      /* if searching backwards, first go to the previous msgstr not to find
-       * the current one */
-      gint style = sci_get_style_at (sci, start);
-      
-      if (style == SCE_PO_MSGSTR || style == SCE_PO_MSGSTR_TEXT) {
-        start = find_style (sci, SCE_PO_MSGID, start, end);
-        if (start >= 0) {
-          start = find_style (sci, SCE_PO_MSGSTR, start, end);
-        }
-      }
+    end = (last < (gint) index->entries->len)
+          ? g_array_index (index->entries, GphEntry, last).start
+          : length;
+    entries = index_parse (sci, first < (gint) index->entries->len
+                                ? g_array_index (index->entries, GphEntry, first).start
+                                : 0,
+                           end);
+    if (end >= length || entries->len == 0) {
+      break;
     }
-    
-    if (start >= 0) {
-      struct Sci_TextToFind ttf;
-      
-      ttf.chrg.cpMin = start;
-      ttf.chrg.cpMax = end;
-      ttf.lpstrText = (gchar *)"fuzzy";
-      
-      while (sci_find_text (sci, SCFIND_WHOLEWORD | SCFIND_MATCHCASE,
-                            &ttf) >= 0) {
-        gint style = sci_get_style_at (sci, (gint) ttf.chrgText.cpMin);
-        
-        if (style == SCE_PO_FUZZY || style == SCE_PO_FLAGS) {
-          /* OK, now find the start of the translation */
-          return find_message (doc, (gint) ttf.chrgText.cpMax,
-                               start > end ? sci_get_length (sci) : end);
-        }
-        
-        ttf.chrg.cpMin = start > end ? ttf.chrgText.cpMin : ttf.chrgText.cpMax;
-      }
+    last_entry = &g_array_index (entries, GphEntry, entries->len - 1);
+    if (last_entry->msgstr >= 0) {
+      break;
     }
+    /* the last entry got cut, e.g. because its msgstr was removed: it
+     * continues in the next one */
+    g_array_free (entries, TRUE);
+    last++;
   }
   
-  return -1;
+  if (last > first) {
+    index_count (index, &g_array_index (index->entries, GphEntry, first),
+                 (guint) (last - first), -1);
+    g_array_remove_range (index->entries, (guint) first, (guint) (last - first));
+  }
+  index_count (index, (const GphEntry *) (gpointer) entries->data,
+               entries->len, +1);
+  g_array_insert_vals (index->entries, (guint) first,
+                       entries->data, entries->len);
+  g_array_free (entries, TRUE);
+  
+  index->dirty_start = -1;
+  index->dirty_end = -1;
 }
 
-static gint
-find_prev_fuzzy (GeanyDocument *doc)
+/* gets the up-to-date index of @doc, building it if needed */
+static GphIndex *
+get_index (GeanyDocument *doc)
 {
-  return find_fuzzy (doc, sci_get_current_position (doc->editor->sci), 0);
+  ScintillaObject *sci = doc->editor->sci;
+  GphIndex *index;
+  
+  if (! G_indexes) {
+    G_indexes = g_hash_table_new_full (NULL, NULL, NULL, index_free);
+  }
+  
+  index = g_hash_table_lookup (G_indexes, doc);
+  if (! index) {
+    index = g_slice_new0 (GphIndex);
+    index->entries = index_parse (sci, 0, sci_get_length (sci));
+    index->dirty_start = -1;
+    index->dirty_end = -1;
+    index_count (index, (const GphEntry *) (gpointer) index->entries->data,
+                 index->entries->len, +1);
+    g_hash_table_insert (G_indexes, doc, index);
+  } else {
+    index_refresh (index, sci);
+  }
+  
+  return index;
 }
 
-static gint
-find_next_fuzzy (GeanyDocument *doc)
+/* updates the index of @doc for a modification of @length characters at
+ * @pos, @length being negative for a deletion */
+static void
+index_update (GeanyDocument  *doc,
+              gint            pos,
+              gint            length)
 {
-  return find_fuzzy (doc, sci_get_current_position (doc->editor->sci),
-                     sci_get_length (doc->editor->sci));
+  GphIndex *index = G_indexes ? g_hash_table_lookup (G_indexes, doc) : NULL;
+  gint removed_end = length < 0 ? pos - length : pos;
+  gint first;
+  guint i;
+  
+  if (! index) {
+    return;
+  }
+  
+  /* drop the entries starting in the removed range, and shift the next ones */
+  first = index_find_entry (index, pos) + 1;
+  for (i = (guint) first; i < index->entries->len; i++) {
+    if (g_array_index (index->entries, GphEntry, i).start >= removed_end) {
+      break;
+    }
+  }
+  if (i > (guint) first) {
+    index_count (index, &g_array_index (index->entries, GphEntry, first),
+                 i - (guint) first, -1);
+    g_array_remove_range (index->entries, (guint) first, i - (guint) first);
+  }
+  for (i = (guint) first; i < index->entries->len; i++) {
+    GphEntry *entry = &g_array_index (index->entries, GphEntry, i);
+    
+    entry->start += length;
+    if (entry->msgid >= 0) {
+      entry->msgid += length;
+    }
+    if (entry->msgstr >= 0) {
+      entry->msgstr += length;
+    }
+  }
+  
+  if (index->dirty_start < 0) {
+    index->dirty_start = pos;
+    index->dirty_end = MAX (pos, pos + length);
+  } else {
+    if (index->dirty_end >= removed_end) {
+      index->dirty_end += length;
+    } else if (index->dirty_end > pos) {
+      index->dirty_end = pos;
+    }
+    index->dirty_start = MIN (index->dirty_start, pos);
+    index->dirty_end = MAX (index->dirty_end, MAX (pos, pos + length));
+  }
 }
 
-/* goto */
+static gboolean
+entry_matches (const GphEntry  *entry,
+               guint            match)
+{
+  return (entry->msgstr >= 0 &&
+          (match == GPH_MATCH_ANY ||
+           ((match & GPH_MATCH_UNTRANSLATED) && ! entry->translated) ||
+           ((match & GPH_MATCH_FUZZY) && entry->fuzzy)));
+}
 
-static void
-goto_prev (GeanyDocument *doc)
+/*
+ * find_message:
+ * @doc: A #GeanyDocument
+ * @pos: position from which to search
+ * @backwards: whether to search backwards
+ * @match: a combination of GPH_MATCH_* values, the message has to match one
+ * 
+ * Finds the next message matching @match after @pos, or the previous one
+ * before the message at @pos when searching backwards.
+ * 
+ * Returns: The start position of the message translation, or -1 if not found.
+ */
+static gint
+find_message (GeanyDocument  *doc,
+              gint            pos,
+              gboolean        backwards,
+              guint           match)
 {
   if (doc_is_po (doc)) {
-    gint pos = sci_get_current_position (doc->editor->sci);
+    GphIndex *index = get_index (doc);
+    gint i = index_find_entry (index, pos);
     
-    pos = find_style (doc->editor->sci, SCE_PO_MSGID, pos, 0);
-    if (pos >= 0) {
-      pos = find_message (doc, pos, 0);
-      if (pos >= 0) {
-        editor_goto_pos (doc->editor, pos, FALSE);
+    if (backwards) {
+      for (i--; i >= 0; i--) {
+        const GphEntry *entry = &g_array_index (index->entries, GphEntry, i);
+        
+        if (entry_matches (entry, match)) {
+          return entry->msgstr;
+        }
+      }
+    } else {
+      for (i = MAX (i, 0); i < (gint) index->entries->len; i++) {
+        const GphEntry *entry = &g_array_index (index->entries, GphEntry, i);
+        
+        if (entry->msgstr > pos && entry_matches (entry, match)) {
+          return entry->msgstr;
+        }
       }
     }
   }
+  
+  return -1;
 }
 
+/* goto */
+
 static void
-goto_next (GeanyDocument *doc)
+goto_message (GeanyDocument  *doc,
+              gboolean        backwards,
+              guint           match)
 {
   if (doc_is_po (doc)) {
     gint pos = find_message (doc, sci_get_current_position (doc->editor->sci),
-                             sci_get_length (doc->editor->sci));
+                             backwards, match);
     
     if (pos >= 0) {
       editor_goto_pos (doc->editor, pos, FALSE);
@@ -323,80 +579,52 @@ goto_next (GeanyDocument *doc)
   }
 }
 
+static void
+goto_prev (GeanyDocument *doc)
+{
+  goto_message (doc, TRUE, GPH_MATCH_ANY);
+}
+
+static void
+goto_next (GeanyDocument *doc)
+{
+  goto_message (doc, FALSE, GPH_MATCH_ANY);
+}
+
 static void
 goto_prev_untranslated (GeanyDocument *doc)
 {
-  if (doc_is_po (doc)) {
-    gint pos = find_prev_untranslated (doc);
-    
-    if (pos >= 0) {
-      editor_goto_pos (doc->editor, pos, FALSE);
-    }
-  }
+  goto_message (doc, TRUE, GPH_MATCH_UNTRANSLATED);
 }
 
 static void
 goto_next_untranslated (GeanyDocument *doc)
 {
-  if (doc_is_po (doc)) {
-    gint pos = find_next_untranslated (doc);
-    
-    if (pos >= 0) {
-      editor_goto_pos (doc->editor, pos, FALSE);
-    }
-  }
+  goto_message (doc, FALSE, GPH_MATCH_UNTRANSLATED);
 }
 
 static void
 goto_prev_fuzzy (GeanyDocument *doc)
 {
-  if (doc_is_po (doc)) {
-    gint pos = find_prev_fuzzy (doc);
-    
-    if (pos >= 0) {
-      editor_goto_pos (doc->editor, pos, FALSE);
-    }
-  }
+  goto_message (doc, TRUE, GPH_MATCH_FUZZY);
 }
 
 static void
 goto_next_fuzzy (GeanyDocument *doc)
 {
-  if (doc_is_po (doc)) {
-    gint pos = find_next_fuzzy (doc);
-    
-    if (pos >= 0) {
-      editor_goto_pos (doc->editor, pos, FALSE);
-    }
-  }
+  goto_message (doc, FALSE, GPH_MATCH_FUZZY);
 }
 
 static void
 goto_prev_untranslated_or_fuzzy (GeanyDocument *doc)
 {
-  if (doc_is_po (doc)) {
-    gint pos1 = find_prev_untranslated (doc);
-    gint pos2 = find_prev_fuzzy (doc);
-    gint pos = MAX_POS (pos1, pos2);
-    
-    if (pos >= 0) {
-      editor_goto_pos (doc->editor, pos, FALSE);
-    }
-  }
+  goto_message (doc, TRUE, GPH_MATCH_UNTRANSLATED | GPH_MATCH_FUZZY);
 }
 
 static void
 goto_next_untranslated_or_fuzzy (GeanyDocument *doc)
 {
-  if (doc_is_po (doc)) {
-    gint pos1 = find_next_untranslated (doc);
-    gint pos2 = find_next_fuzzy (doc);
-    gint pos = MIN_POS (pos1, pos2);
-    
-    if (pos >= 0) {
-      editor_goto_pos (doc->editor, pos, FALSE);
-    }
-  }
+  goto_message (doc, FALSE, GPH_MATCH_UNTRANSLATED | GPH_MATCH_FUZZY);
 }
 
 /* basic regex search/replace without captures or back references */
@@ -493,6 +721,7 @@ on_document_activate (GObject        *obj,
                       gpointer        user_data)
 {
   update_menus (doc);
+  update_statistics (doc);
 }
 
 static void
@@ -501,7 +730,11 @@ on_document_filetype_set (GObject        *obj,
                           GeanyFiletype  *old_ft,
                           gpointer        user_data)
 {
+  if (G_indexes) {
+    g_hash_table_remove (G_indexes, doc);
+  }
   update_menus (doc);
+  queue_update_statistics ();
 }
 
 static void
@@ -509,7 +742,32 @@ on_document_close (GObject       *obj,
                    GeanyDocument *doc,
                    gpointer       user_data)
 {
+  if (G_indexes) {
+    g_hash_table_remove (G_indexes, doc);
+  }
   update_menus (NULL);
+  queue_update_statistics ();
+}
+
+static gboolean
+on_editor_notify (GObject        *obj,
+                  GeanyEditor    *editor,
+                  SCNotification *nt,
+                  gpointer        user_data)
+{
+  if (nt->nmhdr.code == SCN_MODIFIED && G_indexes) {
+    if (nt->modificationType & SC_MOD_INSERTTEXT) {
+      index_update (editor->document, (gint) nt->position, (gint) nt->length);
+    } else if (nt->modificationType & SC_MOD_DELETETEXT) {
+      index_update (editor->document, (gint) nt->position, - (gint) nt->length);
+    }
+    if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT) &&
+        editor->document == document_get_current ()) {
+      queue_update_statistics ();
+    }
+  }
+  
+  return FALSE;
 }
 
 static void
@@ -769,6 +1027,51 @@ split_msg (const gchar *str,
   return (gchar **) g_ptr_array_free (chunks, FALSE);
 }
 
+/* gets the width to reflow the translations to */
+static gint
+get_reflow_line_len (void)
+{
+  /* FIXME: line_break_column isn't supposedly public */
+  gint line_len = geany_data->editor_prefs->line_break_column;
+  
+  /* if line break column doesn't have a reasonable value, don't use it */
+  if (line_len < 8) {
+    line_len = 72;
+  }
+  
+  return line_len;
+}
+
+/* builds the strings of the reflowed @msgstr, the first one starting at
+ * @column */
+static gchar *
+reflow_msg (const gchar  *msgstr,
+            gint          column,
+            gint          line_len)
+{
+  glong len = g_utf8_strlen (msgstr, -1);
+  
+  if (column + len + 2 <= line_len) {
+    /* if all can go in the msgstr line, put it here */
+    return g_strconcat ("\"", msgstr, "\"", NULL);
+  } else {
+    /* otherwise, put nothing on the msgstr line and split it up through
+     * next ones */
+    gchar **chunks = split_msg (msgstr, (gsize)(line_len - 2));
+    GString *text = g_string_new ("\"\""); /* nothing on the msgstr line */
+    guint i;
+    
+    for (i = 0; chunks[i]; i++) {
+      g_string_append (text, "\n\"");
+      g_string_append (text, chunks[i]);
+      g_string_append_c (text, '"');
+    }
+    g_strfreev (chunks);
+    
+    return g_string_free (text, FALSE);
+  }
+}
+
 static void
 on_kb_reflow (guint key_id)
 {
@@ -782,51 +1085,175 @@ on_kb_reflow (guint key_id)
     if (msgstr) {
       gint start = find_msgstr_start_at (doc, pos);
       gint end = find_msgstr_end_at (doc, pos);
-      glong len = g_utf8_strlen (msgstr->str, (gssize) msgstr->len);
-      /* FIXME: line_break_column isn't supposedly public */
-      gint line_len = geany_data->editor_prefs->line_break_column;
       gint msgstr_kw_len;
+      gchar *text;
       
-      /* if line break column doesn't have a reasonable value, don't use it */
-      if (line_len < 8) {
-        line_len = 72;
-      }
+      msgstr_kw_len = start - sci_get_position_from_line (sci, sci_get_line_from_position (sci, start));
+      text = reflow_msg (msgstr->str, msgstr_kw_len, get_reflow_line_len ());
       
       sci_start_undo_action (sci);
-      scintilla_send_message (sci, SCI_DELETERANGE,
-                              (uptr_t) start, end + 1 - start);
-      
-      msgstr_kw_len = start - sci_get_position_from_line (sci, sci_get_line_from_position (sci, start));
-      if (msgstr_kw_len + len + 2 <= line_len) {
-        /* if all can go in the msgstr line, put it here */
-        gchar *text = g_strconcat ("\"", msgstr->str, "\"", NULL);
-        sci_insert_text (sci, start, text);
-        g_free (text);
-      } else {
-        /* otherwise, put nothing on the msgstr line and split it up through
-         * next ones */
-        gchar **chunks = split_msg (msgstr->str, (gsize)(line_len - 2));
-        guint i;
-        
-        sci_insert_text (sci, start, "\"\""); /* nothing on the msgstr line */
-        start += 2;
-        for (i = 0; chunks[i]; i++) {
-          SETPTR (chunks[i], g_strconcat ("\n\"", chunks[i], "\"", NULL));
-          sci_insert_text (sci, start, chunks[i]);
-          start += (gint) strlen (chunks[i]);
-        }
-        
-        g_strfreev (chunks);
+      sci_set_target_start (sci, start);
+      sci_set_target_end (sci, end + 1);
+      sci_replace_target (sci, text, FALSE);
+      /* inside the string if on the msgstr line, after the last one
+       * otherwise */
+      if (strchr (text, '\n')) {
+        start += (gint) strlen (text);
       }
-      
       scintilla_send_message (sci, SCI_GOTOPOS, (uptr_t) (start + 1), 0);
       sci_end_undo_action (sci);
       
+      g_free (text);
       g_string_free (msgstr, TRUE);
     }
   }
 }
 
+/* reads the text of the strings in [@p, @end), @p being the opening quote of
+ * the first one, into @msgstr.  Returns the end of the last string */
+static const gchar *
+read_msg_strings (const gchar  *p,
+                  const gchar  *end,
+                  GString      *msgstr)
+{
+  const gchar *last = p;
+  
+  while (p < end && *p == '"') {
+    for (p++; p < end && *p != '"'; p++) {
+      if (*p == '\\' && p + 1 < end) {
+        g_string_append_c (msgstr, *p++);
+      }
+      g_string_append_c (msgstr, *p);
+    }
+    if (p < end) {
+      p++; /* skip closing quote */
+    }
+    last = p;
+    
+    while (p < end && g_ascii_isspace (*p)) {
+      p++;
+    }
+  }
+  
+  return last;
+}
+
+/* a replacement of the range [start, end) of the document */
+typedef struct {
+  gint    start;
+  gint    end;
+  gchar  *text;
+} GphEdit;
+
+/* adds to @edits the reflow of the translations in [@p, @end) of @contents,
+ * @p being the opening quote of the first one */
+static void
+reflow_entry (const gchar  *contents,
+              const gchar  *p,
+              const gchar  *end,
+              gint          line_len,
+              GArray       *edits)
+{
+  GString *msgstr = g_string_new (NULL);
+  
+  /* each plural form in turn */
+  while (p < end && *p == '"') {
+    const gchar *line = p;
+    const gchar *text_end;
+    gchar *text;
+    
+    while (line > contents && line[-1] != '\n') {
+      line--;
+    }
+    
+    g_string_truncate (msgstr, 0);
+    text_end = read_msg_strings (p, end, msgstr);
+    text = reflow_msg (msgstr->str, (gint) (p - line), line_len);
+    if (strncmp (text, p, (gsize) (text_end - p)) != 0 ||
+        text[text_end - p] != 0) {
+      GphEdit edit;
+      
+      edit.start = (gint) (p - contents);
+      edit.end = (gint) (text_end - contents);
+      edit.text = text;
+      g_array_append_val (edits, edit);
+    } else {
+      g_free (text);
+    }
+    
+    /* next msgstr[N] keyword, if any */
+    p = text_end;
+    while (p < end && g_ascii_isspace (*p)) {
+      p++;
+    }
+    if (end - p < 7 || strncmp (p, "msgstr[", 7) != 0) {
+      break;
+    }
+    while (p < end && *p != '"' && *p != '\n') {
+      p++;
+    }
+  }
+  
+  g_string_free (msgstr, TRUE);
+}
+
+/*
+ * on_kb_reflow_all:
+ * @key_id: unused
+ * 
+ * Reflows the translations of all the messages, but the header.  The new
+ * texts are computed in one pass over the message index, then applied from
+ * the end of the document as a single undo action.
+ */
+static void
+on_kb_reflow_all (guint key_id)
+{
+  GeanyDocument *doc = document_get_current ();
+  
+  if (doc_is_po (doc)) {
+    ScintillaObject *sci = doc->editor->sci;
+    GphIndex *index = get_index (doc);
+    gint length = sci_get_length (sci);
+    gchar *contents = sci_get_contents (sci, -1);
+    gint line_len = get_reflow_line_len ();
+    GArray *edits = g_array_new (FALSE, FALSE, sizeof (GphEdit));
+    guint i;
+    
+    for (i = 0; i < index->entries->len; i++) {
+      const GphEntry *entry = &g_array_index (index->entries, GphEntry, i);
+      gint end = (i + 1 < index->entries->len)
+                 ? g_array_index (index->entries, GphEntry, i + 1).start
+                 : length;
+      
+      /* the position is after the opening quote */
+      if (entry->msgstr > 0 && ! entry->header) {
+        reflow_entry (contents, contents + entry->msgstr - 1, contents + end,
+                      line_len, edits);
+      }
+    }
+    
+    if (edits->len > 0) {
+      /* parsing the whole document again is cheaper than updating the index
+       * for each edit */
+      g_hash_table_remove (G_indexes, doc);
+      
+      sci_start_undo_action (sci);
+      for (i = edits->len; i > 0; i--) {
+        GphEdit *edit = &g_array_index (edits, GphEdit, i - 1);
+        
+        sci_set_target_start (sci, edit->start);
+        sci_set_target_end (sci, edit->end);
+        sci_replace_target (sci, edit->text, FALSE);
+        g_free (edit->text);
+      }
+      sci_end_undo_action (sci);
+    }
+    
+    g_array_free (edits, TRUE);
+    g_free (contents);
+  }
+}
+
 /* returns the first non-default style on the line, or the default style if
  * there is no other on that line */
 static gint
@@ -1022,6 +1449,84 @@ on_kb_toggle_fuzziness (guint key_id)
   }
 }
 
+/* statistics */
+
+static void
+set_count_label (GtkWidget *label,
+                 gint       count,
+                 gint       total)
+{
+  gchar *text;
+  
+  text = g_strdup_printf ("%d (%.1f%%)", count,
+                          total > 0 ? count * 100.0 / total : 0.0);
+  gtk_label_set_text (GTK_LABEL (label), text);
+  g_free (text);
+}
+
+static void
+update_statistics (GeanyDocument *doc)
+{
+  if (! plugin.stats.window ||
+      ! gtk_widget_get_visible (plugin.stats.window)) {
+    return;
+  }
+  
+  if (doc_is_po (doc)) {
+    GphIndex *index = get_index (doc);
+    gint total = index->n_translated + index->n_fuzzy + index->n_untranslated;
+    gdouble fraction = total > 0 ? (gdouble) index->n_translated / total : 0.0;
+    gchar *text;
+    
+    set_count_label (plugin.stats.translated, index->n_translated, total);
+    set_count_label (plugin.stats.fuzzy, index->n_fuzzy, total);
+    set_count_label (plugin.stats.untranslated, index->n_untranslated, total);
+    
+    text = g_strdup_printf (_("%.0f%% translated"), fraction * 100.0);
+    gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (plugin.stats.progress),
+                                   fraction);
+    gtk_progress_bar_set_text (GTK_PROGRESS_BAR (plugin.stats.progress), text);
+    g_free (text);
+  } else {
+    gtk_label_set_text (GTK_LABEL (plugin.stats.translated), "-");
+    gtk_label_set_text (GTK_LABEL (plugin.stats.fuzzy), "-");
+    gtk_label_set_text (GTK_LABEL (plugin.stats.untranslated), "-");
+    gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (plugin.stats.progress),
+                                   0.0);
+    gtk_progress_bar_set_text (GTK_PROGRESS_BAR (plugin.stats.progress),
+                               _("Not a translation file"));
+  }
+}
+
+static gboolean
+update_statistics_idle (gpointer data)
+{
+  plugin.stats.update_source = 0;
+  update_statistics (document_get_current ());
+  
+  return FALSE;
+}
+
+/* updates the statistics once the current modifications are done */
+static void
+queue_update_statistics (void)
+{
+  if (plugin.stats.window &&
+      gtk_widget_get_visible (plugin.stats.window) &&
+      plugin.stats.update_source == 0) {
+    plugin.stats.update_source = g_idle_add (update_statistics_idle, NULL);
+  }
+}
+
+static void
+on_kb_show_statistics (guint key_id)
+{
+  if (plugin.stats.window) {
+    gtk_window_present (GTK_WINDOW (plugin.stats.window));
+    update_statistics (document_get_current ());
+  }
+}
+
 static const struct Action {
   guint             id;
   const gchar      *name;
@@ -1062,9 +1567,15 @@ static const struct Action {
   { GPH_KB_REFLOW, "reflow",
     on_kb_reflow,
     N_("Reflow the current translation string"), "reflow_translation" },
+  { GPH_KB_REFLOW_ALL, "reflow-all",
+    on_kb_reflow_all,
+    N_("Reflow all the translation strings"), "reflow_all_translations" },
   { GPH_KB_TOGGLE_FUZZY, "toggle-fuzziness",
     on_kb_toggle_fuzziness,
-    N_("Toggle current translation fuzziness"), "toggle_fuzziness" }
+    N_("Toggle current translation fuzziness"), "toggle_fuzziness" },
+  { GPH_KB_SHOW_STATISTICS, "show-statistics",
+    on_kb_show_statistics,
+    N_("Show translation statistics"), "show_statistics" }
 };
 
 static void
@@ -1200,6 +1711,24 @@ plugin_init (GeanyData *data)
                                     plugin.update_headers);
     g_signal_connect (obj, "toggled",
                       G_CALLBACK (on_update_headers_upon_save_toggled), NULL);
+    
+    plugin.stats.window = GTK_WIDGET (gtk_builder_get_object (builder,
+                                                              "stats_window"));
+    plugin.stats.translated = GTK_WIDGET (gtk_builder_get_object (builder,
+                                                                  "stats_translated"));
+    plugin.stats.fuzzy = GTK_WIDGET (gtk_builder_get_object (builder,
+                                                             "stats_fuzzy"));
+    plugin.stats.untranslated = GTK_WIDGET (gtk_builder_get_object (builder,
+                                                                    "stats_untranslated"));
+    plugin.stats.progress = GTK_WIDGET (gtk_builder_get_object (builder,
+                                                                "stats_progress"));
+    gtk_window_set_transient_for (GTK_WINDOW (plugin.stats.window),
+                                  GTK_WINDOW (geany->main_widgets->window));
+    g_signal_connect (plugin.stats.window, "delete-event",
+                      G_CALLBACK (gtk_widget_hide_on_delete), NULL);
+    obj = gtk_builder_get_object (builder, "stats_close");
+    g_signal_connect_swapped (obj, "clicked",
+                              G_CALLBACK (gtk_widget_hide), plugin.stats.window);
   }
   
   /* signal handlers */
@@ -1211,6 +1740,8 @@ plugin_init (GeanyData *data)
                          G_CALLBACK (on_document_close), NULL);
   plugin_signal_connect (geany_plugin, NULL, "document-before-save", TRUE,
                          G_CALLBACK (on_document_save), NULL);
+  plugin_signal_connect (geany_plugin, NULL, "editor-notify", FALSE,
+                         G_CALLBACK (on_editor_notify), NULL);
   
   /* add keybindings */
   group = plugin_set_key_group (geany_plugin, "pohelper", GPH_KB_COUNT, NULL);
@@ -1247,6 +1778,18 @@ plugin_cleanup (void)
   if (plugin.menu_item) {
     gtk_widget_destroy (plugin.menu_item);
   }
+  if (plugin.stats.update_source) {
+    g_source_remove (plugin.stats.update_source);
+    plugin.stats.update_source = 0;
+  }
+  if (plugin.stats.window) {
+    gtk_widget_destroy (plugin.stats.window);
+    plugin.stats.window = NULL;
+  }
+  if (G_indexes) {
+    g_hash_table_destroy (G_indexes);
+    G_indexes = NULL;
+  }
   
   save_config ();
 }
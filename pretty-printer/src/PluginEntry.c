@@ -43,10 +43,44 @@ PLUGIN_KEY_GROUP(prettyprinter, 1)
 
 static GtkWidget* main_menu_item = NULL; /*the main menu of the plugin*/
 
+/* documents (or selections) bigger than this are formatted in a separate thread */
+#define PRETTY_PRINTER_THREAD_THRESHOLD (1024*1024)
+
+/* returned by format_xml when the content is not a valid XML */
+#define PRETTY_PRINTER_PARSE_ERROR -1
+
+/* a formatting running in a separate thread */
+typedef struct
+{
+    GeanyDocument* doc;
+    gboolean wholeDocument;
+    int start;
+    int length;
+    char* input;                        /* copy of the formatted range */
+    PrettyPrintingOptions options;      /* copy of the options, they may change while formatting */
+    gboolean wasReadOnly;
+
+    GThread* thread;
+    volatile gint cancelled;
+    volatile gint finished;
+    volatile gint processed;            /* number of input chars already formatted */
+
+    int result;                         /* set by the thread, read once finished */
+    char* output;
+    int outputLength;
+
+    guint sourceId;
+}
+FormatJob;
+
+static FormatJob* formatJob = NULL; /* the running formatting, if any */
+
 /* declaration of the functions */
 static void xml_format(GtkMenuItem *menuitem, gpointer gdata);
 static void kb_run_xml_pretty_print(G_GNUC_UNUSED guint key_id);
 static void config_closed(GtkWidget* configWidget, gint response, gpointer data);
+static void on_document_close(GObject* obj, GeanyDocument* doc, gpointer gdata);
+static void cancel_format_job(GeanyDocument* doc);
 
 void plugin_init(GeanyData *data);
 void plugin_cleanup(void);
@@ -58,6 +92,11 @@ void plugin_init(GeanyData *data)
 {
     /* initializes the libxml2 */
     LIBXML_TEST_VERSION
+    xmlInitParser();
+
+    /* big documents are formatted in a separate thread */
+    plugin_module_make_resident(geany_plugin);
+    if (!g_thread_supported()) { g_thread_init(NULL); }
 
     /* mutilanguage support */
     main_locale_init(LOCALEDIR, GETTEXT_PACKAGE);
@@ -76,10 +115,15 @@ void plugin_init(GeanyData *data)
 
     /* add activation callback */
     g_signal_connect(main_menu_item, "activate", G_CALLBACK(xml_format), NULL);
+
+    /* a formatting cannot outlive its document */
+    plugin_signal_connect(geany_plugin, NULL, "document-close", FALSE, G_CALLBACK(on_document_close), NULL);
 }
 
 void plugin_cleanup(void)
 {
+    cancel_format_job(NULL);
+
     /* destroys the plugin */
     gtk_widget_destroy(main_menu_item);
 }
@@ -104,70 +148,230 @@ void config_closed(GtkWidget* configWidget, gint response, gpointer gdata)
     }
 }
 
+void on_document_close(GObject* obj, GeanyDocument* doc, gpointer gdata)
+{
+    cancel_format_job(doc);
+}
+
 void kb_run_xml_pretty_print(G_GNUC_UNUSED guint key_id)
 {
     xml_format(NULL, NULL);
 }
 
-void xml_format(GtkMenuItem* menuitem, gpointer gdata)
+/*========================================== FORMATTING ==================================================================*/
+
+/* checks that the '\0'-terminated input is an XML, then pretty-prints it.
+ * Does not use any Geany or GTK function, so it can run in any thread */
+static int format_xml(const char* input, int length, char** output, int* outputLength,
+                      PrettyPrintingOptions* options, PrettyPrintingProgress progress, void* progressData)
 {
-    /* retrieves the current document */
-    GeanyDocument* doc = document_get_current();
-    GeanyEditor* editor;
-    ScintillaObject* sco;
-    int length;
-    char* buffer;
     xmlDoc* parsedDocument;
-    int result;
-    int xOffset;
-    GeanyFiletype* fileType;
-    
-    g_return_if_fail(doc != NULL);
 
-    editor = doc->editor;
-    sco = editor->sci;
-
-    /* default printing options */
-    if (prettyPrintingOptions == NULL) { prettyPrintingOptions = createDefaultPrettyPrintingOptions(); }
-
-    /* prepare the buffer that will contain the text
-     * from the scintilla object */
-    length = sci_get_length(sco)+1;
-    buffer = (char*)malloc(length*sizeof(char));
-    if (buffer == NULL) { exit(-1); } /* malloc error */
+    /* checks if the data is an XML format */
+    parsedDocument = xmlParseMemory(input, length);
+    if (parsedDocument == NULL) { return PRETTY_PRINTER_PARSE_ERROR; }
+    xmlFreeDoc(parsedDocument);
 
-    /* retrieves the text */
-    sci_get_text(sco, length, buffer);
+    /* process pretty-printing */
+    return processXMLPrettyPrintingWithProgress(input, length, output, outputLength, options, progress, progressData);
+}
 
-    /* checks if the data is an XML format */
-    parsedDocument = xmlParseDoc((unsigned char*)buffer);
+/* replaces the formatted range of the document, or tells why it could not be formatted */
+static void apply_format_result(GeanyDocument* doc, int result, gboolean wholeDocument,
+                                int start, int length, const char* output, int outputLength)
+{
+    ScintillaObject* sco = doc->editor->sci;
+    int xOffset;
+    GeanyFiletype* fileType;
 
     /* this is not a valid xml => exit with an error message */
-    if(parsedDocument == NULL)
+    if (result == PRETTY_PRINTER_PARSE_ERROR)
     {
         dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Unable to parse the content as XML."));
         return;
     }
 
-    /* free all */
-    xmlFreeDoc(parsedDocument);
-
-    /* process pretty-printing */
-    result = processXMLPrettyPrinting(&buffer, &length, prettyPrintingOptions);
     if (result != PRETTY_PRINTING_SUCCESS)
     {
         dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("Unable to process PrettyPrinting on the specified XML because some features are not supported.\n\nSee Help > Debug messages for more details..."));
         return;
     }
 
-    /* updates the document */
-    sci_set_text(sco, buffer);
+    /* updates the document with a single replacement of the formatted range */
+    sci_start_undo_action(sco);
+    sci_set_target_start(sco, start);
+    sci_set_target_end(sco, start + length);
+    scintilla_send_message(sco, SCI_REPLACETARGET, outputLength, (sptr_t)output);
+    sci_end_undo_action(sco);
 
     /* set the line */
     xOffset = scintilla_send_message(sco, SCI_GETXOFFSET, 0, 0);
     scintilla_send_message(sco, SCI_LINESCROLL, -xOffset, 0); /* TODO update with the right function-call for geany-0.19 */
 
-    /* sets the type */
-    fileType = filetypes_index(GEANY_FILETYPES_XML);
-    document_set_filetype(doc, fileType);
+    /* sets the type (only when the whole document is XML) */
+    if (wholeDocument)
+    {
+        fileType = filetypes_index(GEANY_FILETYPES_XML);
+        document_set_filetype(doc, fileType);
+    }
+}
+
+static bool format_job_progress(int processed, int total, void* data)
+{
+    FormatJob* job = data;
+
+    g_atomic_int_set(&job->processed, processed);
+    return !g_atomic_int_get(&job->cancelled);
+}
+
+static gpointer format_job_thread(gpointer data)
+{
+    FormatJob* job = data;
+
+    job->result = format_xml(job->input, job->length, &job->output, &job->outputLength,
+                             &job->options, format_job_progress, job);
+    g_atomic_int_set(&job->finished, TRUE);
+
+    return NULL;
+}
+
+/* waits for the thread and makes the document editable again */
+static void format_job_stop(FormatJob* job)
+{
+    g_thread_join(job->thread);
+
+    scintilla_send_message(job->doc->editor->sci, SCI_SETREADONLY, job->wasReadOnly, 0);
+    ui_progress_bar_stop();
+}
+
+static void format_job_free(FormatJob* job)
+{
+    if (job->result == PRETTY_PRINTING_SUCCESS) { free(job->output); }
+    g_free(job->input);
+    g_free(job);
+}
+
+static gboolean format_job_update(gpointer data)
+{
+    FormatJob* job = data;
+    gchar* text;
+
+    if (!g_atomic_int_get(&job->finished))
+    {
+        text = g_strdup_printf(_("Formatting XML (%d%%)..."),
+                               (int)(100.0 * g_atomic_int_get(&job->processed) / job->length));
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(geany->main_widgets->progressbar), text);
+        g_free(text);
+        return TRUE;
+    }
+
+    /* the scintilla must be writable again before replacing the text */
+    format_job_stop(job);
+    apply_format_result(job->doc, job->result, job->wholeDocument,
+                        job->start, job->length, job->output, job->outputLength);
+
+    format_job_free(job);
+    formatJob = NULL;
+
+    return FALSE;
+}
+
+/* stops a running formatting, the document is left untouched. If doc is
+ * not NULL, the formatting is only cancelled if it is running on doc. */
+static void cancel_format_job(GeanyDocument* doc)
+{
+    FormatJob* job = formatJob;
+
+    if (job == NULL || (doc != NULL && job->doc != doc)) { return; }
+
+    g_atomic_int_set(&job->cancelled, TRUE);
+    g_source_remove(job->sourceId);
+    format_job_stop(job);
+    ui_set_statusbar(FALSE, _("XML formatting of \"%s\" was cancelled."), DOC_FILENAME(job->doc));
+    format_job_free(job);
+    formatJob = NULL;
+}
+
+static void start_format_job(GeanyDocument* doc, gboolean wholeDocument, int start, int length, char* input)
+{
+    ScintillaObject* sco = doc->editor->sci;
+    FormatJob* job = g_new0(FormatJob, 1);
+
+    job->doc = doc;
+    job->wholeDocument = wholeDocument;
+    job->start = start;
+    job->length = length;
+    job->input = input;
+    job->options = *prettyPrintingOptions;
+
+    /* the range must not change until the result is put back */
+    job->wasReadOnly = scintilla_send_message(sco, SCI_GETREADONLY, 0, 0);
+    scintilla_send_message(sco, SCI_SETREADONLY, TRUE, 0);
+    ui_progress_bar_start(_("Formatting XML..."));
+
+    job->thread = g_thread_create(format_job_thread, job, TRUE, NULL);
+    job->sourceId = plugin_timeout_add(geany_plugin, 100, format_job_update, job);
+    formatJob = job;
+}
+
+void xml_format(GtkMenuItem* menuitem, gpointer gdata)
+{
+    /* retrieves the current document */
+    GeanyDocument* doc = document_get_current();
+    ScintillaObject* sco;
+    int start;
+    int length;
+    const char* input;
+    char* selection;
+    gboolean wholeDocument;
+    char* output = NULL;
+    int outputLength = 0;
+    int result;
+    
+    g_return_if_fail(doc != NULL);
+
+    /* running the formatting again while it is in progress cancels it */
+    if (formatJob != NULL)
+    {
+        cancel_format_job(NULL);
+        return;
+    }
+
+    sco = doc->editor->sci;
+
+    /* default printing options */
+    if (prettyPrintingOptions == NULL) { prettyPrintingOptions = createDefaultPrettyPrintingOptions(); }
+
+    /* if there is a selection, only the selected text is formatted (and
+     * copied), otherwise the document is read in place from scintilla */
+    selection = NULL;
+    wholeDocument = !sci_has_selection(sco);
+    if (!wholeDocument)
+    {
+        start = sci_get_selection_start(sco);
+        length = sci_get_selection_end(sco) - start;
+        selection = sci_get_selection_contents(sco);
+        input = selection;
+    }
+    else
+    {
+        start = 0;
+        length = sci_get_length(sco);
+        input = (const char*)scintilla_send_message(sco, SCI_GETCHARACTERPOINTER, 0, 0);
+    }
+
+    /* big contents are formatted in the background, on their own copy
+     * since scintilla may move its buffer in the meantime */
+    if (length >= PRETTY_PRINTER_THREAD_THRESHOLD)
+    {
+        if (selection == NULL) { selection = g_strndup(input, length); }
+        start_format_job(doc, wholeDocument, start, length, selection);
+        return;
+    }
+
+    result = format_xml(input, length, &output, &outputLength, prettyPrintingOptions, NULL, NULL);
+    g_free(selection);
+
+    apply_format_result(doc, result, wholeDocument, start, length, output, outputLength);
+    if (result == PRETTY_PRINTING_SUCCESS) { free(output); }
 }
@@ -43,6 +43,9 @@
 #define PRETTY_PRINTING_EMPTY_XML 2
 #define PRETTY_PRINTING_NOT_SUPPORTED_YET 3
 #define PRETTY_PRINTING_SYSTEM_ERROR 4
+#define PRETTY_PRINTING_CANCELLED 5
+
+#define PRETTY_PRINTING_PROGRESS_STEP (256*1024)                                               /* number of input chars between two calls of the progress callback */
 
 #ifndef FALSE
 #define FALSE (0)
@@ -82,9 +85,18 @@ typedef struct
 }
 PrettyPrintingOptions;
 
+/**
+ * Called from time to time while pretty-printing, with the number of chars
+ * of the input already processed. Returning FALSE cancels the processing.
+ * It is called from the thread running the pretty-printing.
+ */
+typedef bool (*PrettyPrintingProgress)(int processed, int total, void* data);
+
 /*========================================== FUNCTIONS =========================================================*/
 
 int processXMLPrettyPrinting(char** xml, int* length, PrettyPrintingOptions* ppOptions);    /* process the pretty-printing on a valid xml string (no check done !!!). The ppOptions ARE NOT FREE-ED after processing. The method returns 0 if the pretty-printing has been done. */
+int processXMLPrettyPrintingBuffer(const char* xml, int length, char** output, int* outputLength, PrettyPrintingOptions* ppOptions); /* same as processXMLPrettyPrinting, but the '\0'-terminated input is left untouched and the result is returned into a new buffer (to be free-ed by the caller) */
+int processXMLPrettyPrintingWithProgress(const char* xml, int length, char** output, int* outputLength, PrettyPrintingOptions* ppOptions, PrettyPrintingProgress progress, void* progressData); /* same as processXMLPrettyPrintingBuffer, reporting the progress through the callback (may be NULL). The processing is reentrant and can run in any thread. */
 PrettyPrintingOptions* createDefaultPrettyPrintingOptions(void);                            /* creates a default PrettyPrintingOptions object */
 
 #endif
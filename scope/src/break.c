@@ -189,7 +189,175 @@ static void break_ignore_set_data_func(G_GNUC_UNUSED GtkTreeViewColumn *column,
 
 static ScpTreeStore *store;
 static GtkTreeSelection *selection;
+static GtkTreeView *tree;
 static gint scid_gen = 0;
+/* the view is detached while the breakpoints applied at once are inserted */
+static gboolean break_batch = FALSE;
+
+static void breaks_batch_done(void)
+{
+	if (break_batch)
+	{
+		gtk_tree_view_set_model(tree, GTK_TREE_MODEL(store));
+		g_object_unref(store);
+		break_batch = FALSE;
+	}
+}
+
+/* file -> array of (line, store position), sorted by line, so that editing touches only
+   the breakpoints of the edited file; rebuilt on first use after a change of the store */
+typedef struct _BreakIndex
+{
+	gint line;
+	gint pos;
+} BreakIndex;
+
+static GHashTable *break_index = NULL;
+static gboolean break_index_dirty = TRUE;
+static gboolean break_index_locked = FALSE;
+
+static gchar *break_index_key(const char *file)
+{
+#ifdef G_OS_WIN32
+	return g_utf8_casefold(file, -1);
+#else
+	return g_strdup(file);
+#endif
+}
+
+static void break_index_free(GArray *array)
+{
+	g_array_free(array, TRUE);
+}
+
+static gint break_index_compare(const BreakIndex *a, const BreakIndex *b)
+{
+	return a->line - b->line;
+}
+
+static void break_index_sort(G_GNUC_UNUSED gpointer key, GArray *array,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	g_array_sort(array, (GCompareFunc) break_index_compare);
+}
+
+static GArray *break_index_find(const char *real_path)
+{
+	gchar *key;
+	GArray *array;
+
+	if (break_index_dirty)
+	{
+		GtkTreeIter iter;
+		gboolean valid = scp_tree_store_get_iter_first(store, &iter);
+		BreakIndex bi;
+
+		if (break_index)
+			g_hash_table_remove_all(break_index);
+		else
+		{
+			break_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+				(GDestroyNotify) break_index_free);
+		}
+
+		for (bi.pos = 0; valid; bi.pos++)
+		{
+			const char *file;
+
+			scp_tree_store_get(store, &iter, BREAK_FILE, &file, BREAK_LINE, &bi.line, -1);
+
+			if (file && bi.line > 0)
+			{
+				key = break_index_key(file);
+
+				if ((array = g_hash_table_lookup(break_index, key)) == NULL)
+				{
+					array = g_array_new(FALSE, FALSE, sizeof(BreakIndex));
+					g_hash_table_insert(break_index, key, array);
+				}
+				else
+					g_free(key);
+
+				g_array_append_val(array, bi);
+			}
+
+			valid = scp_tree_store_iter_next(store, &iter);
+		}
+
+		g_hash_table_foreach(break_index, (GHFunc) break_index_sort, NULL);
+		break_index_dirty = FALSE;
+	}
+
+	key = break_index_key(real_path);
+	array = g_hash_table_lookup(break_index, key);
+	g_free(key);
+	return array;
+}
+
+static void on_break_row_inserted(void)
+{
+	break_index_dirty = TRUE;
+}
+
+static void on_break_row_changed(void)
+{
+	if (!break_index_locked)
+		break_index_dirty = TRUE;
+}
+
+static void break_index_delete(G_GNUC_UNUSED gpointer key, GArray *array, gint *pos)
+{
+	guint i;
+
+	for (i = 0; i < array->len; i++)
+	{
+		BreakIndex *bi = &g_array_index(array, BreakIndex, i);
+
+		if (bi->pos == *pos)
+			g_array_remove_index(array, i--);
+		else if (bi->pos > *pos)
+			bi->pos--;
+	}
+}
+
+static void on_break_row_deleted(G_GNUC_UNUSED GtkTreeModel *model, GtkTreePath *path,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	if (!break_index_dirty)
+	{
+		gint pos = *gtk_tree_path_get_indices(path);
+		g_hash_table_foreach(break_index, (GHFunc) break_index_delete, &pos);
+	}
+}
+
+static void break_index_reorder(G_GNUC_UNUSED gpointer key, GArray *array,
+	const gint *new_pos)
+{
+	guint i;
+
+	for (i = 0; i < array->len; i++)
+	{
+		BreakIndex *bi = &g_array_index(array, BreakIndex, i);
+		bi->pos = new_pos[bi->pos];
+	}
+}
+
+static void on_break_rows_reordered(G_GNUC_UNUSED GtkTreeModel *model,
+	G_GNUC_UNUSED GtkTreePath *path, G_GNUC_UNUSED GtkTreeIter *iter, gint *new_order,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	if (!break_index_dirty)
+	{
+		gint count = scp_tree_store_iter_n_children(store, NULL), i;
+		gint *new_pos = g_new(gint, count);
+
+		for (i = 0; i < count; i++)
+			new_pos[new_order[i]] = i;
+
+		g_hash_table_foreach(break_index, (GHFunc) break_index_reorder, new_pos);
+		g_free(new_pos);
+	}
+}
 
 static void break_mark(GtkTreeIter *iter, gboolean mark)
 {
@@ -483,7 +651,7 @@ static void break_node_parse(const ParseNode *node, BreakData *bd)
 					BREAK_LOCATION, location, BREAK_RUN_APPLY, leading && borts,
 					BREAK_DISCARD, leading ? bd->stage : BG_PARTLOC, -1);
 
-				if (leading && bd->stage == BG_PERSIST)
+				if (leading && bd->stage == BG_PERSIST && !break_batch)
 					utils_tree_set_cursor(selection, iter, 0.5);
 
 				g_free(original);
@@ -716,6 +884,11 @@ void on_break_done(GArray *nodes)
 				dc_error("%s: bid not found", token);
 			break;
 		}
+		case '5' :
+		{
+			breaks_batch_done();
+			break;
+		}
 		default : dc_error("%c%s: invalid b_oper", oper, token);
 	}
 }
@@ -831,29 +1004,35 @@ static void break_delete(GtkTreeIter *iter)
 		debug_send_format(N, "024%s-break-delete %s", id, id);
 }
 
-static void break_iter_mark(GtkTreeIter *iter, GeanyDocument *doc)
+void breaks_mark(GeanyDocument *doc)
 {
-	const char *file;
-	gint line;
-	gboolean enabled;
+	GArray *array;
 
-	scp_tree_store_get(store, iter, BREAK_FILE, &file, BREAK_LINE, &line,
-		BREAK_ENABLED, &enabled, -1);
+	if (doc->real_path && (array = break_index_find(doc->real_path)) != NULL)
+	{
+		guint i;
 
-	if (line && !utils_filenamecmp(file, doc->real_path))
-		sci_set_marker_at_line(doc->editor->sci, line - 1, MARKER_BREAKPT + enabled);
-}
+		for (i = 0; i < array->len; i++)
+		{
+			BreakIndex *bi = &g_array_index(array, BreakIndex, i);
+			GtkTreeIter iter;
+			gboolean enabled;
 
-void breaks_mark(GeanyDocument *doc)
-{
-	if (doc->real_path)
-		store_foreach(store, (GFunc) break_iter_mark, doc);
+			scp_tree_store_iter_nth_child(store, &iter, NULL, bi->pos);
+			scp_tree_store_get(store, &iter, BREAK_ENABLED, &enabled, -1);
+			sci_set_marker_at_line(doc->editor->sci, bi->line - 1,
+				MARKER_BREAKPT + enabled);
+		}
+	}
 }
 
 void breaks_clear(void)
 {
 	GtkTreeIter iter;
-	gboolean valid = scp_tree_store_get_iter_first(store, &iter);
+	gboolean valid;
+
+	breaks_batch_done();
+	valid = scp_tree_store_get_iter_first(store, &iter);
 
 	while (valid)
 	{
@@ -881,7 +1060,7 @@ void breaks_reset(void)
 	store_foreach(store, (GFunc) break_iter_reset, NULL);
 }
 
-static void break_iter_apply(GtkTreeIter *iter, G_GNUC_UNUSED gpointer gdata)
+static void break_iter_apply(GtkTreeIter *iter, gint *count)
 {
 	const char *id, *ignore, *ignnow;
 	char type;
@@ -899,12 +1078,30 @@ static void break_iter_apply(GtkTreeIter *iter, G_GNUC_UNUSED gpointer gdata)
 		}
 	}
 	else if (run_apply)
+	{
 		break_apply(iter, FALSE);
+		(*count)++;
+	}
 }
 
+/* the inserts are written to gdb at once, and their replies update the store without the
+   view, which is attached again after the last one ("025") */
 void breaks_apply(void)
 {
-	store_foreach(store, (GFunc) break_iter_apply, NULL);
+	gint count = 0;
+
+	debug_hold_commands(TRUE);
+	store_foreach(store, (GFunc) break_iter_apply, &count);
+
+	if (count > 1 && !break_batch)
+	{
+		g_object_ref(store);
+		gtk_tree_view_set_model(tree, NULL);
+		break_batch = TRUE;
+		debug_send_command(N, "025");
+	}
+
+	debug_hold_commands(FALSE);
 }
 
 void breaks_query_async(GString *commands)
@@ -931,46 +1128,54 @@ static void break_relocate(GtkTreeIter *iter, const char *real_path, gint line)
 void breaks_delta(ScintillaObject *sci, const char *real_path, gint start, gint delta,
 	gboolean active)
 {
-	GtkTreeIter iter;
-	gboolean valid = scp_tree_store_get_iter_first(store, &iter);
+	GArray *array = break_index_find(real_path);
+	gint i;
 
-	while (valid)
+	if (!array)
+		return;
+
+	break_index_locked = TRUE;
+
+	/* backwards, removing a row removes its index entry */
+	for (i = array->len - 1; i >= 0; i--)
 	{
-		const char *file;
-		gint line;
+		BreakIndex *bi = &g_array_index(array, BreakIndex, i);
+		gint line = bi->line - 1;
+		GtkTreeIter iter;
 		gboolean enabled;
 		const char *location;
 
-		scp_tree_store_get(store, &iter, BREAK_FILE, &file, BREAK_LINE, &line,
-			BREAK_ENABLED, &enabled, BREAK_LOCATION, &location, -1);
+		if (start > line)
+			break;
+
+		scp_tree_store_iter_nth_child(store, &iter, NULL, bi->pos);
+		scp_tree_store_get(store, &iter, BREAK_ENABLED, &enabled, BREAK_LOCATION,
+			&location, -1);
 
-		if (--line >= 0 && start <= line && !utils_filenamecmp(file, real_path))
+		if (active)
 		{
-			if (active)
-			{
-				utils_move_mark(sci, line, start, delta, MARKER_BREAKPT + enabled);
-			}
-			else if (delta > 0 || start - delta <= line)
-			{
-				char *split = strchr(location, ':');
+			utils_move_mark(sci, line, start, delta, MARKER_BREAKPT + enabled);
+		}
+		else if (delta > 0 || start - delta <= line)
+		{
+			char *split = strchr(location, ':');
 
-				line += delta + 1;
+			line += delta + 1;
+			bi->line = line;
 
-				if (split && isdigit(split[1]))
-					break_relocate(&iter, real_path, line);
-				else
-					scp_tree_store_set(store, &iter, BREAK_LINE, line, -1);
-			}
+			if (split && isdigit(split[1]))
+				break_relocate(&iter, real_path, line);
 			else
-			{
-				sci_delete_marker_at_line(sci, start, MARKER_BREAKPT + enabled);
-				valid = scp_tree_store_remove(store, &iter);
-				continue;
-			}
+				scp_tree_store_set(store, &iter, BREAK_LINE, line, -1);
+		}
+		else
+		{
+			sci_delete_marker_at_line(sci, start, MARKER_BREAKPT + enabled);
+			scp_tree_store_remove(store, &iter);
 		}
-
-		valid = scp_tree_store_iter_next(store, &iter);
 	}
+
+	break_index_locked = FALSE;
 }
 
 static void break_iter_check(GtkTreeIter *iter, guint *active)
@@ -1197,7 +1402,6 @@ static void on_break_selection_changed(GtkTreeSelection *selection,
 	}
 }
 
-static GtkTreeView *tree;
 static GtkTreeViewColumn *break_type_column;
 static GtkTreeViewColumn *break_display_column;
 
@@ -1459,6 +1663,10 @@ void break_init(void)
 	view_set_sort_func(store, BREAK_ID, break_id_compare);
 	view_set_sort_func(store, BREAK_IGNORE, store_gint_compare);
 	view_set_sort_func(store, BREAK_LOCATION, break_location_compare);
+	g_signal_connect(store, "row-inserted", G_CALLBACK(on_break_row_inserted), NULL);
+	g_signal_connect(store, "row-changed", G_CALLBACK(on_break_row_changed), NULL);
+	g_signal_connect(store, "row-deleted", G_CALLBACK(on_break_row_deleted), NULL);
+	g_signal_connect(store, "rows-reordered", G_CALLBACK(on_break_rows_reordered), NULL);
 
 	for (i = 0; i < EDITCOLS; i++)
 		block_cells[i] = get_object(break_cells[i + 1].name);
@@ -1479,4 +1687,7 @@ void break_init(void)
 void break_finalize(void)
 {
 	store_foreach(store, (GFunc) break_iter_unmark, NULL);
+
+	if (break_index)
+		g_hash_table_destroy(break_index);
 }
@@ -41,6 +41,7 @@ typedef struct _MenuItem MenuItem;
 #include "register.h"
 #include "stack.h"
 #include "scope.h"
+#include "stats.h"
 #include "store.h"
 #include "thread.h"
 #include "tooltip.h"
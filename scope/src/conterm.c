@@ -157,7 +157,31 @@ void on_vte_realize(VteTerminal *vte, G_GNUC_UNUSED gpointer gdata)
 	vte_terminal_set_cursor_blinks(vte, pref_vte_blinken);
 #endif
 }
+#endif  /* G_OS_UNIX */
+
+/* Output is appended to dc_pending and shown at most once per frame, so that a debuggee
+   printing fast costs one insert and one scroll per frame instead of per chunk. */
+#define DC_FLUSH_DELAY 16  /* ms */
+
+typedef struct _ContextRun
+{
+	gint fd;
+	gsize start;  /* in dc_pending */
+} ContextRun;
+
+static GString *dc_pending = NULL;
+static GArray *dc_runs = NULL;  /* context only */
+static guint dc_flush_id = 0;
+
+static gboolean dc_flush(gpointer gdata);
+
+static void dc_schedule_flush(void)
+{
+	if (!dc_flush_id)
+		dc_flush_id = plugin_timeout_add(geany_plugin, DC_FLUSH_DELAY, dc_flush, NULL);
+}
 
+#ifdef G_OS_UNIX
 static VteTerminal *debug_console = NULL;  /* NULL -> GtkTextView "context" */
 
 static void console_output(int fd, const char *text, gint length)
@@ -165,40 +189,48 @@ static void console_output(int fd, const char *text, gint length)
 	static const char fd_colors[NFD] = { '6', '7', '1', '7', '5' };
 	static char setaf[5] = { '\033', '[', '3', '?', 'm' };
 	static int last_fd = -1;
-	gint i;
+	const char *end;
 
 	if (last_fd == 3 && fd != 0)
-		vte_terminal_feed(debug_console, "\r\n", 2);
+		g_string_append_len(dc_pending, "\r\n", 2);
 
 	if (fd != last_fd)
 	{
 		setaf[3] = fd_colors[fd];
-		vte_terminal_feed(debug_console, setaf, sizeof setaf);
+		g_string_append_len(dc_pending, setaf, sizeof setaf);
 		last_fd = fd;
 	}
 
 	if (length == -1)
 		length = strlen(text);
 
-	for (i = 0; i < length; i++)
+	for (end = text + length; text < end; )
 	{
-		if (text[i] == '\n')
+		const char *nl = memchr(text, '\n', end - text);
+
+		if (!nl)
 		{
-			vte_terminal_feed(debug_console, text, i);
-			vte_terminal_feed(debug_console, "\r", 2);
-			length -= i;
-			text += i;
-			i = 0;
+			g_string_append_len(dc_pending, text, end - text);
+			break;
 		}
+
+		g_string_append_len(dc_pending, text, nl - text);
+		g_string_append_len(dc_pending, "\r\n", 2);
+		text = nl + 1;
 	}
 
-	vte_terminal_feed(debug_console, text, length);
+	dc_schedule_flush();
 }
 
 static void console_output_nl(int fd, const char *text, gint length)
 {
 	dc_output(fd, text, length);
-	vte_terminal_feed(debug_console, "\r\n", 2);
+	g_string_append_len(dc_pending, "\r\n", 2);
+}
+
+static void console_flush(void)
+{
+	vte_terminal_feed(debug_console, dc_pending->str, dc_pending->len);
 }
 #endif  /* G_OS_UNIX */
 
@@ -209,16 +241,26 @@ static GtkTextTag *fd_tags[NFD];
 #define DC_DELTA 6144
 static guint dc_chars = 0;
 
+static void context_append(int fd, const char *text, gint length)
+{
+	ContextRun *run = dc_runs->len ? &g_array_index(dc_runs, ContextRun, dc_runs->len - 1)
+		: NULL;
+
+	if (!run || run->fd != fd)
+	{
+		ContextRun new_run = { fd, dc_pending->len };
+		g_array_append_val(dc_runs, new_run);
+	}
+
+	g_string_append_len(dc_pending, text, length);
+}
+
 void context_output(int fd, const char *text, gint length)
 {
 	static int last_fd = -1;
-	GtkTextIter end;
-	gchar *utf8;
-
-	gtk_text_buffer_get_end_iter(context, &end);
 
 	if (last_fd == 3 && fd != 0)
-		gtk_text_buffer_insert(context, &end, "\n", 1);
+		context_append(last_fd, "\n", 1);
 
 	if (fd != last_fd)
 		last_fd = fd;
@@ -226,36 +268,95 @@ void context_output(int fd, const char *text, gint length)
 	if (length == -1)
 		length = strlen(text);
 
-	dc_chars += length;
-	utf8 = g_locale_to_utf8(text, length, NULL, NULL, NULL);
+	context_append(fd, text, length);
+	dc_schedule_flush();
+}
+
+void context_output_nl(int fd, const char *text, gint length)
+{
+	dc_output(fd, text, length);
+	dc_output(fd, "\n", 1);
+}
 
-	if (utf8)
+static void context_flush(void)
+{
+	GtkTextIter end;
+	gsize skip = 0;
+	guint i;
+
+	/* only the last DC_LIMIT or so would survive the trim, start at a line there */
+	if (dc_pending->len > DC_LIMIT)
 	{
-		gtk_text_buffer_insert_with_tags(context, &end, utf8, -1, fd_tags[fd], NULL);
-		g_free(utf8);
+		const char *nl = memchr(dc_pending->str + dc_pending->len - DC_LIMIT, '\n',
+			DC_LIMIT);
+
+		if (nl)
+		{
+			skip = nl + 1 - dc_pending->str;
+			gtk_text_buffer_set_text(context, "", -1);
+			dc_chars = 0;
+		}
+	}
+
+	gtk_text_buffer_get_end_iter(context, &end);
+
+	for (i = 0; i < dc_runs->len; i++)
+	{
+		const ContextRun *run = &g_array_index(dc_runs, ContextRun, i);
+		gsize start = MAX(run->start, skip);
+		gsize stop = i + 1 < dc_runs->len ?
+			g_array_index(dc_runs, ContextRun, i + 1).start : dc_pending->len;
+		gchar *utf8;
+
+		if (start >= stop)
+			continue;
+
+		dc_chars += stop - start;
+		utf8 = g_locale_to_utf8(dc_pending->str + start, stop - start, NULL, NULL, NULL);
+
+		if (utf8)
+		{
+			gtk_text_buffer_insert_with_tags(context, &end, utf8, -1, fd_tags[run->fd], NULL);
+			g_free(utf8);
+		}
+		else
+		{
+			gtk_text_buffer_insert_with_tags(context, &end, dc_pending->str + start,
+				stop - start, fd_tags[run->fd], NULL);
+		}
 	}
-	else
-		gtk_text_buffer_insert_with_tags(context, &end, text, length, fd_tags[fd], NULL);
 
 	if (dc_chars > DC_LIMIT + (DC_DELTA / 2))
 	{
 		GtkTextIter start, delta;
 
 		gtk_text_buffer_get_start_iter(context, &start);
-		gtk_text_buffer_get_iter_at_offset(context, &delta, DC_DELTA);
+		gtk_text_buffer_get_iter_at_offset(context, &delta,
+			gtk_text_buffer_get_char_count(context) - DC_LIMIT + DC_DELTA / 2);
 		gtk_text_buffer_delete(context, &start, &delta);
 		gtk_text_buffer_get_end_iter(context, &end);
 		dc_chars = gtk_text_buffer_get_char_count(context);
 	}
 
+	g_array_set_size(dc_runs, 0);
 	gtk_text_buffer_place_cursor(context, &end);
-      gtk_text_view_scroll_mark_onscreen(debug_context, gtk_text_buffer_get_insert(context));
+	gtk_text_view_scroll_mark_onscreen(debug_context, gtk_text_buffer_get_insert(context));
 }
 
-void context_output_nl(int fd, const char *text, gint length)
+static gboolean dc_flush(G_GNUC_UNUSED gpointer gdata)
 {
-	dc_output(fd, text, length);
-	dc_output(fd, "\n", 1);
+#ifdef G_OS_UNIX
+	if (debug_console)
+		console_flush();
+	else
+#endif
+	{
+		context_flush();
+	}
+
+	g_string_truncate(dc_pending, 0);
+	dc_flush_id = 0;
+	return FALSE;
 }
 
 static gboolean on_console_button_3_press(G_GNUC_UNUSED GtkWidget *widget,
@@ -296,8 +397,11 @@ void dc_clear(void)
 #endif
 	{
 		gtk_text_buffer_set_text(context, "", -1);
+		g_array_set_size(dc_runs, 0);
 		dc_chars = 0;
 	}
+
+	g_string_truncate(dc_pending, 0);
 }
 
 gboolean dc_update(void)
@@ -429,6 +533,7 @@ void conterm_init(void)
 #endif
 
 	conterm_load_config();
+	dc_pending = g_string_sized_new(DC_LIMIT);
 #ifdef G_OS_UNIX
 	program_window = get_widget("program_window");
 	console = vte_terminal_new();
@@ -532,6 +637,7 @@ void conterm_init(void)
 		dc_output = context_output;
 		dc_output_nl = context_output_nl;
 		context = gtk_text_view_get_buffer(debug_context);
+		dc_runs = g_array_new(FALSE, FALSE, sizeof(ContextRun));
 
 		for (i = 0; i < NFD; i++)
 		{
@@ -549,6 +655,12 @@ void conterm_init(void)
 
 void conterm_finalize(void)
 {
+	if (dc_flush_id)
+		g_source_remove(dc_flush_id);
+	g_string_free(dc_pending, TRUE);
+	if (dc_runs)
+		g_array_free(dc_runs, TRUE);
+
 #ifdef G_OS_UNIX
 	g_object_unref(program_terminal);
 	g_free(slave_pty_name);
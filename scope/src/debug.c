@@ -126,6 +126,7 @@ static void gdb_io_check(ssize_t count, const char *operation, int eagain)
 static guint wait_result;
 static gboolean wait_prompt;
 static GString *commands;
+static gsize hold_commands = 0;  /* commands length + 1 when held */
 
 static void send_commands(void)
 {
@@ -133,19 +134,20 @@ static void send_commands(void)
 
 	if (count > 0)
 	{
-		const char *s = commands->str;
+		const char *line = commands->str, *s;
 
 		dc_output(0, commands->str, count);
 		wait_prompt = TRUE;
 
 		do
 		{
-			s = strchr(s, '\n');
+			s = strchr(line, '\n');
 			if (s - commands->str >= count)
 				break;
 
+			stats_send(line, s + 1 - line);
 			wait_result++;
-		} while (*++s);
+		} while (*(line = s + 1));
 
 		g_string_erase(commands, 0, count);
 		update_state(DS_BUSY);
@@ -171,13 +173,15 @@ static void debug_send_commands(void)
 	}
 }
 
-static void pre_parse(char *string, gboolean overflow)
+static void pre_parse(char *string, gsize length)
 {
 	if (*string && strchr("~@&", *string))
 	{
 		char *text = string + 1;
 		const char *end;
 
+		stats_receive(string, length);
+
 		if (*text == '"')
 		{
 			end = parse_string(text, '\n');
@@ -189,9 +193,7 @@ static void pre_parse(char *string, gboolean overflow)
 			end = NULL;
 		}
 
-		if (overflow)
-			dc_error("overflow");
-		else if (!end)
+		if (!end)
 			dc_error("\" expected");
 		else if (g_str_has_prefix(string, "~^(Scope)#07"))
 			on_inspect_signal(string + 12);
@@ -204,17 +206,15 @@ static void pre_parse(char *string, gboolean overflow)
 	else
 	{
 		char *message;
+		gdouble start = stats_clock();
+		StatsEntry *entry;
 
 		for (message = string; isdigit(*message); message++);
+		entry = stats_receive(message, length);
 
 		if (option_library_messages || !g_str_has_prefix(message, "=library-"))
-		{
 			dc_output_nl(1, string, -1);
 
-			if (overflow)
-				dc_error("overflow");
-		}
-
 		if (*message == '^')
 		{
 			iff (wait_result, "extra result")
@@ -230,24 +230,56 @@ static void pre_parse(char *string, gboolean overflow)
 			string = NULL;  /* no token */
 
 		parse_message(message, string);
+		stats_handled(entry, start);
 	}
 }
 
+/* parsed in place; the unparsed tail is moved only if full, and grows for long messages */
 static guint MAXLEN;
 static GString *received;
-static gboolean leading_receive;
-static char *reading_pos;
+static gsize received_start;  /* start of the first unparsed line */
+static gsize received_scanned;  /* "\n" searched up to */
+
+#define received_pending() (received_scanned < received->len)
+
+static void received_reset(void)
+{
+	g_string_truncate(received, 0);
+	received_start = received_scanned = 0;
+}
+
+static void received_reserve(void)
+{
+	if (received->len + MAXLEN / 4 > MAXLEN)
+	{
+		if (received_start)
+		{
+			g_string_erase(received, 0, received_start);
+			received_scanned -= received_start;
+			received_start = 0;
+		}
+
+		if (received->len + MAXLEN / 4 > MAXLEN)
+		{
+			gsize len = received->len;
+
+			g_string_set_size(received, MAXLEN * 2);
+			g_string_truncate(received, len);
+			MAXLEN = received->allocated_len - 1;
+		}
+	}
+}
 
 static gboolean source_prepare(G_GNUC_UNUSED GSource *source, gint *timeout)
 {
 	*timeout = -1;
-	return gdb_state != INACTIVE && reading_pos > received->str;
+	return gdb_state != INACTIVE && received_pending();
 }
 
 #ifdef G_OS_UNIX
 static gboolean source_check(G_GNUC_UNUSED GSource *source)
 {
-	return gdb_state != INACTIVE && (gdb_err.revents || reading_pos > received->str ||
+	return gdb_state != INACTIVE && (gdb_err.revents || received_pending() ||
 		gdb_out.revents || (commands->len && gdb_in.revents));
 }
 #else  /* G_OS_UNIX */
@@ -260,7 +292,7 @@ static gboolean peek_pipe(GPollFD *fd)
 
 static gboolean source_check(G_GNUC_UNUSED GSource *source)
 {
-	return gdb_state != INACTIVE && (reading_pos > received->str || peek_pipe(&gdb_err) ||
+	return gdb_state != INACTIVE && (received_pending() || peek_pipe(&gdb_err) ||
 		peek_pipe(&gdb_out) || (commands->len &&
 		GetTickCount() - last_send_ticks >= (guint) pref_gdb_send_interval * 10));
 }
@@ -275,7 +307,7 @@ static gboolean source_dispatch(G_GNUC_UNUSED GSource *source,
 	pid_t result;
 	ssize_t count;
 	char buffer[0x200];
-	char *pos;
+	char *pos, *end;
 
 	/* show errors */
 	while ((count = read(gdb_err.fd, buffer, sizeof buffer - 1)) > 0)
@@ -284,6 +316,7 @@ static gboolean source_dispatch(G_GNUC_UNUSED GSource *source,
 	gdb_io_check(count, "read(gdb_err)", EINVAL);
 
 	/* receive */
+	received_reserve();
 	count = read(gdb_out.fd, received->str + received->len, MAXLEN - received->len);
 
 	if (count > 0)
@@ -291,40 +324,24 @@ static gboolean source_dispatch(G_GNUC_UNUSED GSource *source,
 	else
 		gdb_io_check(count, "read(gdb_out)", EINVAL);
 
-	while (pos = reading_pos, (reading_pos = strchr(pos, '\n')) != NULL)
+	/* the offsets are updated before parsing, a nested dispatch continues from them */
+	while ((end = strchr(received->str + received_scanned, '\n')) != NULL)
 	{
-		if (leading_receive)
-		{
-		#ifdef G_OS_UNIX
-			*reading_pos++ = '\0';
-		#else
-			gboolean cr = reading_pos > received->str && reading_pos[-1] == '\r';
-			reading_pos[-cr]= '\0';
-			reading_pos++;
-		#endif
-			pre_parse(pos, FALSE);
-		}
-		else
-		{
-			reading_pos++;
-			leading_receive = TRUE;
-		}
+		pos = received->str + received_start;
+	#ifdef G_OS_UNIX
+		*end = '\0';
+	#else
+		end[-(end > pos && end[-1] == '\r')] = '\0';
+	#endif
+		received_start = received_scanned = end + 1 - received->str;
+		pre_parse(pos, strlen(pos));
 	}
 
-	g_string_erase(received, 0, pos - received->str);
+	received_scanned = received->len;
 
-	if (G_UNLIKELY(received->len == MAXLEN))
-	{
-		if (leading_receive)
-		{
-			reading_pos = received->str + MAXLEN;
-			pre_parse(received->str, TRUE);
-		}
-		g_string_truncate(received, 0);
-		leading_receive = FALSE;
-	}
+	if (received_start == received->len)
+		received_reset();
 
-	reading_pos = received->str;
 	result = waitpid(gdb_pid, &status, WNOHANG);
 
 	if (result == 0)
@@ -510,6 +527,7 @@ static void load_program(void)
 		(char *) "--interpreter=mi2", NULL };
 	GError *gerror = NULL;
 
+	program_load_views();
 	statusbar_update_state(DS_EXTRA_2);
 	plugin_blink();
 	while (gtk_events_pending())
@@ -536,11 +554,10 @@ static void load_program(void)
 			utils_lock_all(TRUE);
 			signal(SIGINT, SIG_IGN);
 			wait_result = 0;
+			stats_reset();
 			wait_prompt = TRUE;
 			g_string_truncate(commands, 0);
-			g_string_truncate(received, 0);
-			reading_pos = received->str;
-			leading_receive = TRUE;
+			received_reset();
 
 			gdb_source = g_source_new(&gdb_source_funcs, sizeof(GSource));
 			g_source_set_can_recurse(gdb_source, TRUE);
@@ -652,18 +669,21 @@ void on_debug_goto_source(G_GNUC_UNUSED const MenuItem *menu_item)
 
 void on_debug_step_into(G_GNUC_UNUSED const MenuItem *menu_item)
 {
+	views_step();
 	debug_send_thread(thread_state == THREAD_AT_SOURCE ? "-exec-step"
 		: "-exec-step-instruction");
 }
 
 void on_debug_step_over(G_GNUC_UNUSED const MenuItem *menu_item)
 {
+	views_step();
 	debug_send_thread(thread_state == THREAD_AT_SOURCE ? "-exec-next"
 		: "-exec-next-instruction");
 }
 
 void on_debug_step_out(G_GNUC_UNUSED const MenuItem *menu_item)
 {
+	views_step();
 	debug_send_thread("-exec-finish");
 }
 
@@ -715,7 +735,22 @@ void debug_send_command(gint tf, const char *command)
 		g_string_append(commands, s);
 		g_string_append_c(commands, '\n');
 
-		if (!previous_len)
+		if (!previous_len && !hold_commands)
+			debug_send_commands();
+	}
+}
+
+/* gather the commands sent until released into one write */
+void debug_hold_commands(gboolean hold)
+{
+	if (hold)
+		hold_commands = commands->len + 1;
+	else if (hold_commands)
+	{
+		gsize previous_len = hold_commands - 1;
+
+		hold_commands = 0;
+		if (!previous_len && commands->len && gdb_state == ACTIVE)
 			debug_send_commands();
 	}
 }
@@ -1,32 +1,36 @@
-/*
- *  gtk216.h
- *
- *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
- *
- *  This program is free software; you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation; either version 2 of the License, or
- *  (at your option) any later version.
- *
- *  This program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
- *  GNU General Public License for more details.
- *
- *  You should have received a copy of the GNU General Public License
- *  along with this program. If not, see <http://www.gnu.org/licenses/>.
- */
-
-#ifndef GTK216_H
-
-#if !GTK_CHECK_VERSION(2, 18, 0)
-#define gtk_widget_get_visible(widget) GTK_WIDGET_VISIBLE(widget)
-#define gtk_widget_get_sensitive(widget) GTK_WIDGET_SENSITIVE(widget)
-void gtk_widget_set_visible(GtkWidget *widget, gboolean visible);
-#endif
-
-void gtk216_init(void);
-void gtk216_finalize(void);
-
-#define GTK216_H 1
-#endif
+/*
+ *  gtk216.h
+ *
+ *  Copyright 2012 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GTK216_H
+
+#if !GTK_CHECK_VERSION(2, 18, 0)
+#define gtk_widget_get_visible(widget) GTK_WIDGET_VISIBLE(widget)
+#define gtk_widget_get_sensitive(widget) GTK_WIDGET_SENSITIVE(widget)
+void gtk_widget_set_visible(GtkWidget *widget, gboolean visible);
+#endif
+
+#if !GTK_CHECK_VERSION(2, 20, 0)
+#define gtk_widget_get_mapped(widget) GTK_WIDGET_MAPPED(widget)
+#endif
+
+void gtk216_init(void);
+void gtk216_finalize(void);
+
+#define GTK216_H 1
+#endif
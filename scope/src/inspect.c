@@ -65,59 +65,66 @@ static void append_stub(GtkTreeIter *parent, const gchar *text, gboolean expand)
 
 #define append_ellipsis(parent, expand) append_stub((parent), _("..."), (expand))
 
-static gboolean inspect_find_recursive(GtkTreeIter *iter, gint i, const char *key)
-{
-	do
-	{
-		gboolean flag = !key;
-
-		if (flag)
-		{
-			gint scid;
+/* scid -> iter and var1 -> iter. The iters remain valid until a row is inserted before
+   others or removed, which marks the index dirty; rebuilt on the next lookup. */
+static GHashTable *inspect_scids = NULL;
+static GHashTable *inspect_var1s = NULL;
+static gboolean inspect_index_dirty = TRUE;
 
-			scp_tree_store_get(store, iter, INSPECT_SCID, &scid, -1);
-			if (scid == i)
-				return TRUE;
-		}
-		else
-		{
-			const char *var1;
-			size_t len;
+static void inspect_index_add(GtkTreeIter *iter)
+{
+	gint scid;
+	const char *var1;
 
-			scp_tree_store_get(store, iter, INSPECT_VAR1, &var1, -1);
-			len = var1 ? strlen(var1) : 0;
+	scp_tree_store_get(store, iter, INSPECT_SCID, &scid, INSPECT_VAR1, &var1, -1);
 
-			if (var1 && !strncmp(key, var1, len))
-			{
-				if (key[len] == '\0')
-					return TRUE;
-
-				flag = key[len] == '.' && key[len + 1];
-			}
-		}
-
-		if (flag)
-		{
-			GtkTreeIter child;
+	if (scid)
+	{
+		g_hash_table_insert(inspect_scids, GINT_TO_POINTER(scid),
+			g_memdup(iter, sizeof(GtkTreeIter)));
+	}
 
-			if (scp_tree_store_iter_children(store, &child, iter) &&
-				inspect_find_recursive(&child, i, key))
-			{
-				*iter = child;
-				return TRUE;
-			}
-		}
-	} while (scp_tree_store_iter_next(store, iter));
+	if (var1)
+		g_hash_table_insert(inspect_var1s, g_strdup(var1), g_memdup(iter, sizeof(GtkTreeIter)));
+}
 
+static gint inspect_index_add_iter(G_GNUC_UNUSED ScpTreeStore *store, GtkTreeIter *iter,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	inspect_index_add(iter);
 	return FALSE;
 }
 
 static gboolean inspect_find(GtkTreeIter *iter, gboolean string, const char *key)
 {
-	if (scp_tree_store_get_iter_first(store, iter) &&
-		inspect_find_recursive(iter, atoi(key), string ? key : NULL))
+	GtkTreeIter *found;
+
+	if (inspect_index_dirty)
 	{
-		return TRUE;
+		g_hash_table_remove_all(inspect_scids);
+		g_hash_table_remove_all(inspect_var1s);
+		scp_tree_store_traverse(store, TRUE, NULL, NULL, inspect_index_add_iter, NULL);
+		inspect_index_dirty = FALSE;
+	}
+
+	if (string)
+		found = g_hash_table_lookup(inspect_var1s, key);
+	else
+		found = g_hash_table_lookup(inspect_scids, GINT_TO_POINTER(atoi(key)));
+
+	/* the row may have lost its scid or var1 since */
+	if (found)
+	{
+		gint scid;
+		const char *var1;
+
+		scp_tree_store_get(store, found, INSPECT_SCID, &scid, INSPECT_VAR1, &var1, -1);
+
+		if (string ? !g_strcmp0(var1, key) : scid == atoi(key))
+		{
+			*iter = *found;
+			return TRUE;
+		}
 	}
 
 	if (!string)
@@ -168,6 +175,17 @@ static gchar *jump_to_expr = NULL;
 static void on_inspect_row_inserted(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter,
 	G_GNUC_UNUSED gpointer gdata)
 {
+	if (!inspect_index_dirty)
+	{
+		GtkTreeIter next = *iter;
+
+		/* appending keeps the iters of the other rows valid */
+		if (scp_tree_store_iter_next(store, &next))
+			inspect_index_dirty = TRUE;
+		else
+			inspect_index_add(iter);
+	}
+
 	if (gtk_tree_path_get_depth(path) == 1)
 	{
 		GtkWidget *item;
@@ -185,6 +203,9 @@ static void on_inspect_row_inserted(GtkTreeModel *model, GtkTreePath *path, GtkT
 static void on_inspect_row_changed(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter,
 	G_GNUC_UNUSED gpointer gdata)
 {
+	if (!inspect_index_dirty)
+		inspect_index_add(iter);
+
 	if (!jump_to_expr && gtk_tree_path_get_depth(path) == 1)
 	{
 		const gint *index = gtk_tree_path_get_indices(path);
@@ -201,6 +222,8 @@ static void on_inspect_row_changed(GtkTreeModel *model, GtkTreePath *path, GtkTr
 static void on_inspect_row_deleted(GtkTreeModel *model, GtkTreePath *path,
 	G_GNUC_UNUSED gpointer gdata)
 {
+	inspect_index_dirty = TRUE;
+
 	if (gtk_tree_path_get_depth(path) == 1)
 	{
 		const gint *index = gtk_tree_path_get_indices(path);
@@ -215,6 +238,11 @@ static void on_inspect_row_deleted(GtkTreeModel *model, GtkTreePath *path,
 	}
 }
 
+static void on_inspect_rows_reordered(void)
+{
+	inspect_index_dirty = TRUE;
+}
+
 static const MenuItem *apply_item;
 
 static gchar *inspect_redisplay(GtkTreeIter *iter, const char *value, gchar *display)
@@ -248,6 +276,22 @@ static gint inspect_variable_store(GtkTreeIter *iter, const ParseVariable *var)
 static const char *const inspect_formats[FORMAT_COUNT] = { "natural", "decimal",
 	"hexadecimal", "octal", "binary" };
 
+static void inspect_cache_value(GtkTreeIter *iter, const char *value)
+{
+	if (!scp_tree_store_iter_depth(store, iter))
+	{
+		const char *expr, *frame;
+		gint format;
+
+		scp_tree_store_get(store, iter, INSPECT_EXPR, &expr, INSPECT_FRAME, &frame,
+			INSPECT_FORMAT, &format, -1);
+
+		/* floating variables are evaluated in the current frame, like the tooltips */
+		if (!g_strcmp0(frame, "@") && format == FORMAT_NATURAL)
+			tooltip_cache_set(expr, value);
+	}
+}
+
 void on_inspect_variable(GArray *nodes)
 {
 	GtkTreeIter iter;
@@ -267,6 +311,8 @@ void on_inspect_variable(GArray *nodes)
 			debug_send_format(N, "07%s-var-set-format %s %s", token, var.name,
 				inspect_formats[format]);
 		}
+		else
+			inspect_cache_value(&iter, var.value);
 
 		if (gtk_tree_selection_iter_is_selected(selection, &iter))
 			menu_item_set_active(apply_item, TRUE);
@@ -473,6 +519,8 @@ static void inspect_node_change(const ParseNode *node, G_GNUC_UNUSED gpointer gd
 					scp_tree_store_set(store, &iter, INSPECT_DISPLAY, var.display,
 						INSPECT_VALUE, var.value, -1);
 				}
+
+				inspect_cache_value(&iter, var.value);
 			}
 		}
 
@@ -642,6 +690,7 @@ static void inspect_dialog_store(GtkTreeIter *iter)
 
 void inspect_add(const gchar *text)
 {
+	program_load_views();
 	gtk_entry_set_text(inspect_expr, text ? text : "");
 	gtk_entry_set_text(inspect_name, "-");
 	gtk_toggle_button_set_active(inspect_run_apply, FALSE);
@@ -1147,6 +1196,9 @@ void inspect_init(void)
 	g_signal_connect(store, "row-inserted", G_CALLBACK(on_inspect_row_inserted), NULL);
 	g_signal_connect(store, "row-changed", G_CALLBACK(on_inspect_row_changed), NULL);
 	g_signal_connect(store, "row-deleted", G_CALLBACK(on_inspect_row_deleted), NULL);
+	g_signal_connect(store, "rows-reordered", G_CALLBACK(on_inspect_rows_reordered), NULL);
+	inspect_scids = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+	inspect_var1s = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
 
 	g_signal_connect(selection, "changed", G_CALLBACK(on_inspect_selection_changed), NULL);
 	menu = menu_select("inspect_menu", &inspect_menu_info, selection);
@@ -1180,4 +1232,6 @@ void inspect_finalize(void)
 	gtk_widget_destroy(inspect_dialog);
 	gtk_widget_destroy(expand_dialog);
 	g_free(jump_to_expr);
+	g_hash_table_destroy(inspect_scids);
+	g_hash_table_destroy(inspect_var1s);
 }
@@ -47,10 +47,18 @@ static const TreeCell local_cells[] =
 	{ NULL, NULL }
 };
 
+typedef struct _LocalVariable
+{
+	ParseVariable var;
+	const char *arg1;
+	gint row;  /* matching row before the update, -1 if new */
+} LocalVariable;
+
 typedef struct _LocalData
 {
 	char *name;
 	gboolean entry;
+	GArray *vars;
 } LocalData;
 
 static void local_node_variable(const ParseNode *node, const LocalData *ld)
@@ -58,26 +66,167 @@ static void local_node_variable(const ParseNode *node, const LocalData *ld)
 	iff (node->type == PT_ARRAY, "variables: contains value")
 	{
 		GArray *nodes = (GArray *) node->value;
-		ParseVariable var;
+		LocalVariable lv;
 
-		if (parse_variable(nodes, &var, NULL))
+		if (parse_variable(nodes, &lv.var, NULL))
 		{
-			GtkTreeIter iter;
-			const char *arg1 = parse_find_value(nodes, "arg");
+			lv.arg1 = parse_find_value(nodes, "arg");
+			lv.row = -1;
 
-			if (!arg1 || ld->entry || !g_str_has_suffix(var.name, "@entry"))
-			{
-				scp_tree_store_append_with_values(store, &iter, NULL, LOCAL_NAME,
-					var.name, LOCAL_DISPLAY, var.display, LOCAL_VALUE, var.value,
-					LOCAL_HB_MODE, var.hb_mode, LOCAL_MR_MODE, var.mr_mode,
-					LOCAL_ARG1, arg1, -1);
+			if (!lv.arg1 || ld->entry || !g_str_has_suffix(lv.var.name, "@entry"))
+				g_array_append_val(ld->vars, lv);
+			else
+				parse_variable_free(&lv.var);
+		}
+	}
+}
+
+static void local_insert(const LocalVariable *lv, gint position)
+{
+	scp_tree_store_insert_with_values(store, NULL, NULL, position, LOCAL_NAME,
+		lv->var.name, LOCAL_DISPLAY, lv->var.display, LOCAL_VALUE, lv->var.value,
+		LOCAL_HB_MODE, lv->var.hb_mode, LOCAL_MR_MODE, lv->var.mr_mode, LOCAL_ARG1,
+		lv->arg1, -1);
+}
+
+static void local_patch(gint row, const LocalVariable *lv)
+{
+	GtkTreeIter iter;
+	const char *display, *value;
+	gint hb_mode, mr_mode;
+
+	scp_tree_store_iter_nth_child(store, &iter, NULL, row);
+	scp_tree_store_get(store, &iter, LOCAL_DISPLAY, &display, LOCAL_VALUE, &value,
+		LOCAL_HB_MODE, &hb_mode, LOCAL_MR_MODE, &mr_mode, -1);
+
+	if (g_strcmp0(display, lv->var.display) || g_strcmp0(value, lv->var.value) ||
+		hb_mode != lv->var.hb_mode || mr_mode != lv->var.mr_mode)
+	{
+		scp_tree_store_set(store, &iter, LOCAL_DISPLAY, lv->var.display, LOCAL_VALUE,
+			lv->var.value, LOCAL_HB_MODE, lv->var.hb_mode, LOCAL_MR_MODE,
+			lv->var.mr_mode, -1);
+	}
+}
 
-				if (!g_strcmp0(var.name, ld->name))
-					gtk_tree_selection_select_iter(selection, &iter);
+/* match the variables to the current rows by name and arg, in order for duplicate names */
+static gboolean local_match_rows(GArray *vars, gboolean *used, gint count, gboolean sorted)
+{
+	GHashTable *rows = g_hash_table_new(g_str_hash, g_str_equal);
+	gint *next = g_new(gint, count);
+	GtkTreeIter iter;
+	gint i, last = -1;
+	gboolean ordered = TRUE;
+
+	for (i = count - 1; i >= 0; i--)
+	{
+		const char *name;
+
+		scp_tree_store_iter_nth_child(store, &iter, NULL, i);
+		scp_tree_store_get(store, &iter, LOCAL_NAME, &name, -1);
+		next[i] = GPOINTER_TO_INT(g_hash_table_lookup(rows, name)) - 1;
+		g_hash_table_insert(rows, (gpointer) name, GINT_TO_POINTER(i + 1));
+	}
+
+	for (i = 0; i < (gint) vars->len; i++)
+	{
+		LocalVariable *lv = &g_array_index(vars, LocalVariable, i);
+		gint row = GPOINTER_TO_INT(g_hash_table_lookup(rows, lv->var.name)) - 1;
+
+		for (; row != -1; row = next[row])
+		{
+			const char *arg1;
+
+			scp_tree_store_iter_nth_child(store, &iter, NULL, row);
+			scp_tree_store_get(store, &iter, LOCAL_ARG1, &arg1, -1);
+
+			if (!used[row] && !g_strcmp0(arg1, lv->arg1))
+			{
+				used[row] = TRUE;
+				lv->row = row;
+				ordered &= row > last;
+				last = row;
+				break;
 			}
-			parse_variable_free(&var);
 		}
 	}
+
+	g_hash_table_destroy(rows);
+	g_free(next);
+	/* unsorted rows are in gdb order, which should not change for the kept ones */
+	return sorted || ordered;
+}
+
+static void locals_patch(GArray *vars)
+{
+	gint count = scp_tree_store_iter_n_children(store, NULL);
+	gboolean *used = g_new0(gboolean, count);
+	gint *map = g_new(gint, count);
+	gint sort_column_id, i, kept = 0;
+	gboolean sorted;
+
+	sorted = scp_tree_store_get_sort_column_id(store, &sort_column_id, NULL);
+
+	/* a sort by value may move the patched rows */
+	if ((sorted && sort_column_id != LOCAL_NAME && sort_column_id != LOCAL_ARG1) ||
+		!local_match_rows(vars, used, count, sorted))
+	{
+		memset(used, 0, count * sizeof(gboolean));
+	}
+
+	for (i = 0; i < count; i++)
+		map[i] = used[i] ? kept++ : -1;
+
+	for (i = count - 1; i >= 0; i--)
+	{
+		if (!used[i])
+		{
+			GtkTreeIter iter;
+
+			scp_tree_store_iter_nth_child(store, &iter, NULL, i);
+			scp_tree_store_remove(store, &iter);
+		}
+	}
+
+	if (!kept)
+	{
+		scp_tree_store_load_start(store, NULL);
+		for (i = 0; i < (gint) vars->len; i++)
+			local_insert(&g_array_index(vars, LocalVariable, i), -1);
+		scp_tree_store_load_finish(store);
+	}
+	else if (sorted)
+	{
+		for (i = 0; i < (gint) vars->len; i++)
+		{
+			const LocalVariable *lv = &g_array_index(vars, LocalVariable, i);
+
+			if (lv->row != -1)
+				local_patch(map[lv->row], lv);
+		}
+
+		for (i = 0; i < (gint) vars->len; i++)
+		{
+			const LocalVariable *lv = &g_array_index(vars, LocalVariable, i);
+
+			if (lv->row == -1)
+				local_insert(lv, -1);
+		}
+	}
+	else
+	{
+		for (i = 0; i < (gint) vars->len; i++)
+		{
+			const LocalVariable *lv = &g_array_index(vars, LocalVariable, i);
+
+			if (lv->row != -1)
+				local_patch(i, lv);
+			else
+				local_insert(lv, i);
+		}
+	}
+
+	g_free(map);
+	g_free(used);
 }
 
 void on_local_variables(GArray *nodes)
@@ -85,13 +234,25 @@ void on_local_variables(GArray *nodes)
 	if (utils_matches_frame(parse_grab_token(nodes)))
 	{
 		GtkTreeIter iter;
-		LocalData ld = { NULL, stack_entry() };
+		LocalData ld = { NULL, stack_entry(), g_array_new(FALSE, FALSE,
+			sizeof(LocalVariable)) };
+		guint i;
 
 		if (gtk_tree_selection_get_selected(selection, NULL, &iter))
 			gtk_tree_model_get((GtkTreeModel *) store, &iter, LOCAL_NAME, &ld.name, -1);
 
-		locals_clear();
 		parse_foreach(parse_lead_array(nodes), (GFunc) local_node_variable, &ld);
+		locals_patch(ld.vars);
+
+		if (ld.name && !gtk_tree_selection_get_selected(selection, NULL, NULL) &&
+			store_find(store, &iter, LOCAL_NAME, ld.name))
+		{
+			gtk_tree_selection_select_iter(selection, &iter);
+		}
+
+		for (i = 0; i < ld.vars->len; i++)
+			parse_variable_free(&g_array_index(ld.vars, LocalVariable, i).var);
+		g_array_free(ld.vars, TRUE);
 		g_free(ld.name);
 	}
 }
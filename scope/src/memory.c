@@ -133,48 +133,45 @@ static void memory_configure(void)
 }
 
 static guint64 memory_start;
-static guint memory_count = 0;
-#define MAX_BYTES (124 * MAX_BYTES_PER_LINE)
-
-static void write_block(guint64 start, const char *contents, guint count, const char *maddr)
+static guint memory_count = 0;  /* bytes in the view */
+static GByteArray *memory_cache;  /* bytes read from memory_start */
+static guint memory_shown = 0;  /* bytes in the store */
+static gboolean memory_fetching = FALSE;
+static gchar *memory_ascii[0x100];
+#define PAGE_BYTES (124 * MAX_BYTES_PER_LINE)
+
+static void memory_show(guint count, const char *maddr)
 {
-	if (!memory_count)
-		memory_start = start;
-	else if (memory_count < MAX_BYTES)
-		memory_count = start - memory_start;
+	static const char hex[] = "0123456789abcdef";
+	guint end = memory_cache->len;
+
+	if (end <= memory_shown)
+		return;
+
+	/* lines are split only at the end of view */
+	if (end - memory_shown > count)
+		end = memory_shown + count;
+	if (end < memory_count)
+		end -= (end - memory_shown) % bytes_per_line;
 
-	while (memory_count < MAX_BYTES)
+	while (memory_shown < end)
 	{
 		GtkTreeIter iter;
-		char *addr = g_strdup_printf(addr_format, start);
+		char *addr = g_strdup_printf(addr_format, memory_start + memory_shown);
 		GString *bytes = g_string_sized_new(bytes_per_line * 3);
 		GString *ascii = g_string_new(" ");
 		gint n = 0;
 
-		while (n < bytes_per_line)
+		while (n < bytes_per_line && memory_shown < end)
 		{
-			char locale;
-			gchar *utf8;
-
-			g_string_append_len(bytes, contents, 2);
-			contents += 2;
-			memory_count++;
-			locale = strtol(bytes->str + bytes->len - 2, NULL, 16);
-			utf8 = locale >= 0x20 ? g_locale_to_utf8(&locale, 1, NULL, NULL, NULL) : NULL;
+			guint8 byte = memory_cache->data[memory_shown++];
 
-			if (utf8)
-			{
-				g_string_append(ascii, utf8);
-				g_free(utf8);
-			}
-			else
-				g_string_append_c(ascii, '.');  /* 0xfffd? */
+			g_string_append_c(bytes, hex[byte >> 4]);
+			g_string_append_c(bytes, hex[byte & 0x0F]);
+			g_string_append(ascii, memory_ascii[byte]);
 
 			if (++n % bytes_per_group == 0)
 				g_string_append_c(bytes, ' ');
-
-			if (!--count)
-				break;
 		}
 
 		while (n < bytes_per_line)
@@ -193,18 +190,31 @@ static void write_block(guint64 start, const char *contents, guint count, const
 		g_free(addr);
 		g_string_free(bytes, TRUE);
 		g_string_free(ascii, TRUE);
+	}
+}
 
-		if (!count)
-			break;
+static void write_block(guint64 start, const char *contents, guint count)
+{
+	guint len = memory_cache->len;
+	guint i;
 
-		start += bytes_per_line;
+	if (!len && !memory_shown)
+		memory_start = start;
+	else if (start != memory_start + len)
+	{
+		dc_error("memory: non-contiguous data");
+		return;
 	}
 
-	if (count)
-		dc_error("memory: too much data");
+	g_byte_array_set_size(memory_cache, len + count);
+	for (i = 0; i < count; i++, contents += 2)
+	{
+		memory_cache->data[len + i] = (g_ascii_xdigit_value(contents[0]) << 4) |
+			g_ascii_xdigit_value(contents[1]);
+	}
 }
 
-static void memory_node_read(const ParseNode *node, const char *maddr)
+static void memory_node_read(const ParseNode *node, G_GNUC_UNUSED gpointer gdata)
 {
 	iff (node->type == PT_ARRAY, "memory: contains value")
 	{
@@ -222,55 +232,102 @@ static void memory_node_read(const ParseNode *node, const char *maddr)
 				start += g_ascii_strtoull(offset, NULL, 0);
 
 			iff (count, "memory: contents too short")
-				write_block(start, contents, count, maddr);
+				write_block(start, contents, count);
 		}
 	}
 }
 
+/* token 0 - refresh the shown bytes, 1 - next page, none - new view */
 void on_memory_read_bytes(GArray *nodes)
 {
 	if (pointer_size <= MAX_POINTER_SIZE)
 	{
-		GtkTreeIter iter;
-		char *maddr = NULL;
+		const char *token = parse_grab_token(nodes);
 
-		if (gtk_tree_selection_get_selected(selection, NULL, &iter))
-			gtk_tree_model_get((GtkTreeModel *) store, &iter, MEMORY_ADDR, &maddr, -1);
+		if (token && *token == '1')
+		{
+			memory_fetching = FALSE;
+			parse_foreach(parse_lead_array(nodes), (GFunc) memory_node_read, NULL);
+			memory_show(PAGE_BYTES, NULL);
+		}
+		else
+		{
+			GtkTreeIter iter;
+			char *maddr = NULL;
+			guint count = token ? memory_shown : PAGE_BYTES;
 
-		store_clear(store);
-		memory_count = 0;
+			if (gtk_tree_selection_get_selected(selection, NULL, &iter))
+				gtk_tree_model_get((GtkTreeModel *) store, &iter, MEMORY_ADDR, &maddr, -1);
 
-		if (pref_memory_bytes_per_line != back_bytes_per_line)
-		{
-			memory_configure();
-			gtk_tree_view_column_queue_resize(get_column("memory_bytes_column"));
-			gtk_tree_view_column_queue_resize(get_column("memory_ascii_column"));
+			store_clear(store);
+			g_byte_array_set_size(memory_cache, 0);
+			memory_shown = 0;
+			memory_fetching = FALSE;
+
+			if (pref_memory_bytes_per_line != back_bytes_per_line)
+			{
+				memory_configure();
+				gtk_tree_view_column_queue_resize(get_column("memory_bytes_column"));
+				gtk_tree_view_column_queue_resize(get_column("memory_ascii_column"));
+			}
+
+			parse_foreach(parse_lead_array(nodes), (GFunc) memory_node_read, NULL);
+
+			if (!token || memory_count < memory_cache->len)
+				memory_count = memory_cache->len;
+
+			memory_show(count, maddr);
+			g_free(maddr);
 		}
+	}
+}
+
+static void memory_more(void)
+{
+	if (memory_shown < memory_cache->len)
+		memory_show(PAGE_BYTES, NULL);
+	else if (memory_shown < memory_count && memory_shown && !memory_fetching &&
+		(debug_state() & DS_VARIABLE))
+	{
+		guint count = memory_count - memory_shown;
+
+		if (count > PAGE_BYTES)
+			count = PAGE_BYTES - PAGE_BYTES % bytes_per_line;
 
-		parse_foreach(parse_lead_array(nodes), (GFunc) memory_node_read, maddr);
-		g_free(maddr);
+		debug_send_format(T, "041-data-read-memory-bytes 0x%" G_GINT64_MODIFIER "x %u",
+			memory_start + memory_shown, count);
+		memory_fetching = TRUE;
+	}
+}
+
+static void on_memory_scrolled(GtkAdjustment *adjustment, G_GNUC_UNUSED gpointer gdata)
+{
+	if (gtk_adjustment_get_value(adjustment) + gtk_adjustment_get_page_size(adjustment) * 2 >=
+		gtk_adjustment_get_upper(adjustment))
+	{
+		memory_more();
 	}
 }
 
 void memory_clear(void)
 {
 	store_clear(store);
+	g_byte_array_set_size(memory_cache, 0);
 }
 
 gboolean memory_update(void)
 {
-	if (memory_count)
+	if (memory_shown)
 	{
-		debug_send_format(T, "04-data-read-memory-bytes 0x%" G_GINT64_MODIFIER "x %u",
-			memory_start, memory_count);
+		debug_send_format(T, "040-data-read-memory-bytes 0x%" G_GINT64_MODIFIER "x %u",
+			memory_start, memory_shown);
 	}
 	return TRUE;
 }
 
 static void on_memory_refresh(G_GNUC_UNUSED const MenuItem *menu_item)
 {
-	debug_send_format(T, "-data-read-memory-bytes 0x%" G_GINT64_MODIFIER "x %u",
-		memory_start, memory_count);
+	memory_update();
 }
 
 static void on_memory_read(G_GNUC_UNUSED const MenuItem *menu_item)
@@ -311,8 +368,8 @@ static void on_memory_copy(G_GNUC_UNUSED const MenuItem *menu_item)
 
 static void on_memory_clear(G_GNUC_UNUSED const MenuItem *menu_item)
 {
-	store_clear(store);
-	memory_count = 0;
+	memory_clear();
+	memory_count = memory_shown = 0;
 }
 
 static void on_memory_group_display(const MenuItem *menu_item)
@@ -327,9 +384,7 @@ static void on_memory_group_update(const MenuItem *menu_item)
 {
 	bytes_per_group = 1 << GPOINTER_TO_INT(menu_item->gdata);
 	back_bytes_per_line = 0;
-
-	if (memory_count)
-		on_memory_refresh(menu_item);
+	memory_update();
 }
 
 #define DS_FRESHABLE (DS_VRIABLE | DS_EXTRA_2)
@@ -378,6 +433,7 @@ void memory_init(void)
 {
 	GtkWidget *tree = GTK_WIDGET(view_connect("memory_view", &store, &selection,
 		memory_cells, "memory_window", NULL));
+	guint i;
 
 	memory_font = *pref_memory_font ? pref_memory_font : pref_vte_font;
 	ui_widget_modify_font_from_string(tree, memory_font);
@@ -391,6 +447,21 @@ void memory_init(void)
 	addr_format = g_strdup_printf("%%0%u" G_GINT64_MODIFIER "x  ", pointer_size * 2);
 	memory_configure();
 
+	memory_cache = g_byte_array_new();
+	g_signal_connect(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(
+		get_widget("memory_window"))), "value-changed", G_CALLBACK(on_memory_scrolled), NULL);
+
+	for (i = 0; i < 0x100; i++)
+	{
+		char locale = i;
+
+		if (locale < 0x20 || (memory_ascii[i] = g_locale_to_utf8(&locale, 1, NULL, NULL,
+			NULL)) == NULL)
+		{
+			memory_ascii[i] = g_strdup(".");  /* 0xfffd? */
+		}
+	}
+
 	if (pointer_size > MAX_POINTER_SIZE)
 	{
 		msgwin_status_add(_("Scope: pointer size > %d, Data disabled."), MAX_POINTER_SIZE);
@@ -402,5 +473,11 @@ void memory_init(void)
 
 void memory_finalize(void)
 {
+	guint i;
+
+	for (i = 0; i < 0x100; i++)
+		g_free(memory_ascii[i]);
+
+	g_byte_array_free(memory_cache, TRUE);
 	g_free(addr_format);
 }
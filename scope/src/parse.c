@@ -23,13 +23,30 @@
 
 #include "common.h"
 
-static void parse_node_free(ParseNode *node, G_GNUC_UNUSED gpointer gdata)
+/* node arrays are kept between messages: [0, parse_used) are in use, the rest are free */
+static GPtrArray *parse_arrays;
+static guint parse_used = 0;
+
+static GArray *parse_array_new(void)
 {
-	if (node->type == PT_ARRAY)
+	GArray *array;
+
+	if (parse_used < parse_arrays->len)
+		array = (GArray *) g_ptr_array_index(parse_arrays, parse_used);
+	else
 	{
-		parse_foreach((GArray *) node->value, (GFunc) parse_node_free, NULL);
-		g_array_free((GArray *) node->value, TRUE);
+		array = g_array_new(FALSE, FALSE, sizeof(ParseNode));
+		g_ptr_array_add(parse_arrays, array);
 	}
+
+	parse_used++;
+	return array;
+}
+
+static void parse_arrays_release(guint used)
+{
+	while (parse_used > used)
+		g_array_set_size((GArray *) g_ptr_array_index(parse_arrays, --parse_used), 0);
 }
 
 void parse_foreach(GArray *nodes, GFunc func, gpointer gdata)
@@ -198,7 +215,6 @@ static char *parse_text(GArray *nodes, char *text, char end, char newline)
 
 			if (!text && !newline)
 			{
-				parse_foreach(nodes, (GFunc) parse_node_free, NULL);
 				g_array_set_size(nodes, 0);
 				return NULL;
 			}
@@ -213,7 +229,7 @@ static char *parse_text(GArray *nodes, char *text, char end, char newline)
 			if (!brace && *text != '[')
 				return parse_error("\" { or [ expected");
 
-			array = g_array_new(FALSE, FALSE, sizeof(ParseNode));
+			array = parse_array_new();
 			node.type = PT_ARRAY;
 			node.value = array;
 
@@ -245,7 +261,8 @@ void parse_message(char *message, const char *token)
 
 	if (route->callback)
 	{
-		GArray *nodes = g_array_new(FALSE, FALSE, sizeof(ParseNode));
+		guint used = parse_used;  /* callbacks may parse nested messages */
+		GArray *nodes = parse_array_new();
 		const char *comma = strchr(route->prefix, ',');
 
 		if (comma)
@@ -262,8 +279,7 @@ void parse_message(char *message, const char *token)
 			route->callback(nodes);
 		}
 
-		parse_foreach(nodes, (GFunc) parse_node_free, NULL);
-		g_array_free(nodes, TRUE);
+		parse_arrays_release(used);
 	}
 }
 
@@ -571,6 +587,7 @@ void parse_mode_update(const char *name, gint mode, gint value)
 	char *pm_name = parse_mode_pm_name(name);
 	GtkTreeIter iter;
 
+	program_load_views();
 	if (!store_find(parse_modes, &iter, MODE_NAME, name))
 	{
 		scp_tree_store_append_with_values(parse_modes, &iter, NULL, MODE_NAME, pm_name,
@@ -621,11 +638,14 @@ void parse_save(GKeyFile *config)
 void parse_init(void)
 {
 	errors = g_string_sized_new(MAXLEN);
+	parse_arrays = g_ptr_array_new();
 	parse_modes = SCP_TREE_STORE(get_object("parse_mode_store"));
 	scp_tree_store_set_sort_column_id(parse_modes, MODE_NAME, GTK_SORT_ASCENDING);
 }
 
 void parse_finalize(void)
 {
+	g_ptr_array_foreach(parse_arrays, (GFunc) g_array_free, GINT_TO_POINTER(TRUE));
+	g_ptr_array_free(parse_arrays, TRUE);
 	g_string_free(errors, TRUE);
 }
@@ -150,6 +150,26 @@ static gint program_compare(ScpTreeStore *store, GtkTreeIter *iter, const char *
 #define program_find(iter, name) scp_tree_store_traverse(recent_programs, FALSE, (iter), \
 	NULL, (ScpTreeStoreTraverseFunc) program_compare, (gpointer) (name))
 
+/* The watches, inspects, registers and parse modes of the program, not loaded
+ * into their stores until shown or debugging starts */
+static GKeyFile *views_config = NULL;
+static const char *const views_prefixes[] = { "watch", "inspect", "register", "parse", NULL };
+
+void program_load_views(void)
+{
+	if (views_config)
+	{
+		GKeyFile *config = views_config;
+
+		views_config = NULL;
+		watches_load(config);
+		inspects_load(config);
+		registers_load(config);
+		parse_load(config);
+		g_key_file_free(config);
+	}
+}
+
 static void save_program_settings(void)
 {
 	const gchar *program_name = *program_executable ? program_executable :
@@ -191,10 +211,22 @@ static void save_program_settings(void)
 		configfile = recent_file_name(id);
 		stash_foreach((GFunc) stash_group_save_to_key_file, config);
 		breaks_save(config);
-		watches_save(config);
-		inspects_save(config);
-		registers_save(config);
-		parse_save(config);
+
+		if (views_config)
+		{
+			const char *const *prefix;
+
+			for (prefix = views_prefixes; *prefix; prefix++)
+				utils_copy_sections(views_config, config, *prefix);
+		}
+		else
+		{
+			watches_save(config);
+			inspects_save(config);
+			registers_save(config);
+			parse_save(config);
+		}
+
 		utils_key_file_write_to_file(config, configfile);
 		g_free(configfile);
 		g_key_file_free(config);
@@ -248,10 +280,13 @@ static void on_recent_menu_item_activate(G_GNUC_UNUSED GtkMenuItem *menuitem, co
 			if ((unsigned) option_inspect_expand > EXPAND_MAX)
 				option_inspect_expand = 100;
 			breaks_load(config);
-			watches_load(config);
-			inspects_load(config);
-			registers_load(config);
-			parse_load(config);
+			/* the markers need the breakpoints, the rest waits for the views */
+			if (views_config)
+				g_key_file_free(views_config);
+			views_config = config;
+			config = NULL;
+			if (views_shown())
+				program_load_views();
 			message = g_strdup_printf(_("Loaded debug settings for %s."), name);
 			program_find(&iter, name);
 			scp_tree_store_move(recent_programs, &iter, 0);
@@ -271,7 +306,8 @@ static void on_recent_menu_item_activate(G_GNUC_UNUSED GtkMenuItem *menuitem, co
 			msgwin_status_add("%s", message);
 
 		g_free(message);
-		g_key_file_free(config);
+		if (config)
+			g_key_file_free(config);
 		g_free(configfile);
 	}
 }
@@ -418,6 +454,7 @@ static void on_program_ok_button_clicked(G_GNUC_UNUSED GtkButton *button,
 		if (gtk_toggle_button_get_active(delete_all_items) &&
 			dialogs_show_question(_("Delete all breakpoints, watches et cetera?")))
 		{
+			program_load_views();
 			breaks_delete_all();
 			watches_delete_all();
 			inspects_delete_all();
@@ -568,6 +605,11 @@ void program_finalize(void)
 	GKeyFile *config = g_key_file_new();
 
 	save_program_settings();
+	if (views_config)
+	{
+		g_key_file_free(views_config);
+		views_config = NULL;
+	}
 	g_key_file_load_from_file(config, configfile, G_KEY_FILE_NONE, NULL);
 	store_save(recent_programs, config, "recent", recent_program_save);
 	utils_key_file_write_to_file(config, configfile);
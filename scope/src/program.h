@@ -50,6 +50,7 @@ void program_context_changed(void);
 void program_update_state(DebugState state);
 void on_program_setup(const MenuItem *menu_item);
 void program_load_config(GKeyFile *config);
+void program_load_views(void);
 
 void program_init(void);
 void program_finalize(void);
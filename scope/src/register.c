@@ -171,6 +171,16 @@ void on_register_changes(GArray *nodes)
 		query_all_registers = TRUE;  /* external changes */
 }
 
+static gboolean register_matches(GtkTreeIter *iter, const char *name, const char *value)
+{
+	const char *old_name, *display, *old_value;
+
+	scp_tree_store_get(store, iter, REGISTER_NAME, &old_name, REGISTER_DISPLAY, &display,
+		REGISTER_VALUE, &old_value, -1);
+	return !g_strcmp0(name, old_name) && !g_strcmp0(value, display) &&
+		!g_strcmp0(value, old_value);
+}
+
 static void register_set_value(GtkTreeIter *iter, char *value)
 {
 	if (*value == '{')
@@ -180,8 +190,9 @@ static void register_set_value(GtkTreeIter *iter, char *value)
 		gboolean valid = scp_tree_store_iter_children(store, &child, iter);
 		gboolean next;
 
-		scp_tree_store_set(store, iter, REGISTER_DISPLAY, NULL, REGISTER_VALUE, NULL, -1);
 		scp_tree_store_get(store, iter, REGISTER_NAME, &parent, -1);
+		if (!register_matches(iter, parent, NULL))
+			scp_tree_store_set(store, iter, REGISTER_DISPLAY, NULL, REGISTER_VALUE, NULL, -1);
 
 		do
 		{
@@ -225,8 +236,11 @@ static void register_set_value(GtkTreeIter *iter, char *value)
 
 			if (!valid)
 				scp_tree_store_append(store, &child, iter);
-			scp_tree_store_set(store, &child, REGISTER_PATH, path, REGISTER_NAME, name,
-				REGISTER_DISPLAY, value, REGISTER_VALUE, value, -1);
+			if (!register_matches(&child, name, value))
+			{
+				scp_tree_store_set(store, &child, REGISTER_PATH, path, REGISTER_NAME,
+					name, REGISTER_DISPLAY, value, REGISTER_VALUE, value, -1);
+			}
 			valid &= scp_tree_store_iter_next(store, &child);
 
 			g_free(path);
@@ -241,8 +255,13 @@ static void register_set_value(GtkTreeIter *iter, char *value)
 	}
 	else
 	{
+		const char *name;
+
 		scp_tree_store_clear_children(store, iter, FALSE);
-		scp_tree_store_set(store, iter, REGISTER_DISPLAY, value, REGISTER_VALUE, value, -1);
+		scp_tree_store_get(store, iter, REGISTER_NAME, &name, -1);
+
+		if (!register_matches(iter, name, value))
+			scp_tree_store_set(store, iter, REGISTER_DISPLAY, value, REGISTER_VALUE, value, -1);
 	}
 }
 
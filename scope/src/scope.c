@@ -24,6 +24,7 @@
 #include <stdlib.h>
 
 #include "common.h"
+#include "startprof.h"
 
 GeanyPlugin *geany_plugin;
 GeanyData *geany_data;
@@ -431,10 +432,14 @@ typedef struct _ScopeCallback  /* we don't want callbacks on builder init failur
 	GCallback callback;
 } ScopeCallback;
 
+GP_STARTUP_PROFILE_DOCUMENT_OPEN_HANDLER(on_document_open_profiled, on_document_open)
+GP_STARTUP_PROFILE_STARTUP_COMPLETE_HANDLER(on_geany_startup_complete_profiled,
+	on_geany_startup_complete)
+
 static const ScopeCallback scope_callbacks[] =
 {
 	{ "document-new",             G_CALLBACK(on_document_new) },
-	{ "document-open",            G_CALLBACK(on_document_open) },
+	{ "document-open",            G_CALLBACK(on_document_open_profiled) },
 	{ "document-reload",          G_CALLBACK(on_document_open) },
 	{ "save-settings",            G_CALLBACK(on_settings_save) },
 	{ "editor-notify",            G_CALLBACK(on_editor_notify) },
@@ -444,7 +449,7 @@ static const ScopeCallback scope_callbacks[] =
 	{ "project-before-save",      G_CALLBACK(on_project_before_save) },
 	{ "project-open",             G_CALLBACK(on_project_open) },
 	{ "project-close",            G_CALLBACK(on_project_close) },
-	{ "geany-startup-complete",   G_CALLBACK(on_geany_startup_complete) },
+	{ "geany-startup-complete",   G_CALLBACK(on_geany_startup_complete_profiled) },
 	{ "build-start",              G_CALLBACK(on_build_start) },
 	{ NULL, NULL }
 };
@@ -528,7 +533,7 @@ void configure_panel(void)
 	gtk_notebook_set_tab_pos(GTK_NOTEBOOK(debug_panel), pref_panel_tab_pos);
 }
 
-void plugin_init(G_GNUC_UNUSED GeanyData *gdata)
+static void init_plugin(G_GNUC_UNUSED GeanyData *gdata)
 {
 	GeanyKeyGroup *scope_key_group;
 	char *gladefile = g_build_filename(PLUGINDATADIR, "scope.glade", NULL);
@@ -603,6 +608,7 @@ void plugin_init(G_GNUC_UNUSED GeanyData *gdata)
 	stack_init();
 	local_init();
 	memory_init();
+	stats_init();
 	menu_init();
 	menu_set_popup_keybindings(scope_key_group, item);
 
@@ -630,6 +636,8 @@ void plugin_init(G_GNUC_UNUSED GeanyData *gdata)
 		plugin_signal_connect(geany_plugin, NULL, scb->name, FALSE, scb->callback, NULL);
 }
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init_plugin)
+
 void plugin_cleanup(void)
 {
 	ToolItem *item;
@@ -652,6 +660,7 @@ void plugin_cleanup(void)
 	thread_finalize();
 	break_finalize();
 	memory_finalize();
+	stats_finalize();
 	menu_finalize();
 	views_finalize();
 	utils_finalize();
@@ -36,7 +36,7 @@ enum
 static ScpTreeStore *store;
 static GtkTreeSelection *selection;
 
-static void stack_node_location(const ParseNode *node, const char *fid)
+static void stack_node_location(const ParseNode *node, G_GNUC_UNUSED gpointer gdata)
 {
 	iff (node->type == PT_ARRAY, "stack: contains value")
 	{
@@ -55,9 +55,6 @@ static void stack_node_location(const ParseNode *node, const char *fid)
 				loc.addr, STACK_ENTRY, !loc.func ||
 				parse_mode_get(loc.func, MODE_ENTRY), -1);
 			parse_location_free(&loc);
-
-			if (!g_strcmp0(id, fid))
-				gtk_tree_selection_select_iter(selection, &iter);
 		}
 	}
 }
@@ -69,18 +66,19 @@ void on_stack_frames(GArray *nodes)
 	if (!g_strcmp0(parse_grab_token(nodes), thread_id))
 	{
 		char *fid = g_strdup(frame_id);
+		GtkTreeIter iter;
 
 		stack_clear();
-		parse_foreach(parse_lead_array(nodes), (GFunc) stack_node_location, fid);
-		g_free(fid);
+		scp_tree_store_load_start(store, NULL);
+		parse_foreach(parse_lead_array(nodes), (GFunc) stack_node_location, NULL);
+		scp_tree_store_load_finish(store);
 
-		if (!frame_id)
-		{
-			GtkTreeIter iter;
+		if (fid && store_find(store, &iter, STACK_ID, fid))
+			gtk_tree_selection_select_iter(selection, &iter);
+		g_free(fid);
 
-			if (store_find(store, &iter, STACK_ID, "0"))
-				utils_tree_set_cursor(selection, &iter, -1);
-		}
+		if (!frame_id && store_find(store, &iter, STACK_ID, "0"))
+			utils_tree_set_cursor(selection, &iter, -1);
 	}
 }
 
@@ -0,0 +1,289 @@
+/*
+ *  stats.c
+ *
+ *  Copyright 2013 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "common.h"
+
+enum
+{
+	STATS_NAME,
+	STATS_COUNT,
+	STATS_SENT,
+	STATS_RECEIVED,
+	STATS_LATENCY,
+	STATS_LATENCY_MAX,
+	STATS_HANDLING
+};
+
+/* times are in seconds, shown in milliseconds */
+struct _StatsEntry
+{
+	char *name;
+	gint count;
+	gint64 sent;
+	gint64 received;
+	gdouble latency;
+	gdouble latency_max;
+	gdouble handling;
+	gboolean changed;
+};
+
+typedef struct _StatsPending
+{
+	char *name;
+	gdouble sent;
+} StatsPending;
+
+static ScpTreeStore *store;
+static GTimer *timer;
+static GHashTable *entries;
+static GQueue *pending;  /* sent commands, in result order */
+
+static void stats_entry_free(StatsEntry *entry)
+{
+	g_free(entry->name);
+	g_free(entry);
+}
+
+static StatsEntry *stats_entry(const char *name, gsize length)
+{
+	char *key = g_strndup(name, length);
+	StatsEntry *entry = (StatsEntry *) g_hash_table_lookup(entries, key);
+
+	if (entry)
+		g_free(key);
+	else
+	{
+		entry = g_new0(StatsEntry, 1);
+		entry->name = key;
+		g_hash_table_insert(entries, key, entry);
+	}
+
+	entry->changed = TRUE;
+	view_dirty(VIEW_STATS);
+	return entry;
+}
+
+static void stats_pending_free(StatsPending *sp)
+{
+	g_free(sp->name);
+	g_free(sp);
+}
+
+gdouble stats_clock(void)
+{
+	return g_timer_elapsed(timer, NULL);
+}
+
+void stats_send(const char *line, gsize length)
+{
+	const char *name;
+	StatsPending *sp = g_new(StatsPending, 1);
+	StatsEntry *entry;
+
+	for (name = line; isdigit(*name); name++);
+	entry = stats_entry(name, strcspn(name, " \n"));
+	entry->sent += length;
+	sp->name = g_strdup(entry->name);
+	sp->sent = stats_clock();
+	g_queue_push_tail(pending, sp);
+}
+
+StatsEntry *stats_receive(const char *message, gsize length)
+{
+	StatsPending *sp = (StatsPending *) g_queue_peek_head(pending);
+	StatsEntry *entry;
+
+	if (sp && (*message == '^' || (*message && strchr("~@&", *message))))
+	{
+		/* results and stream output belong to the oldest command */
+		entry = stats_entry(sp->name, strlen(sp->name));
+
+		if (*message == '^')
+		{
+			gdouble latency = stats_clock() - sp->sent;
+
+			entry->count++;
+			entry->latency += latency;
+			if (entry->latency_max < latency)
+				entry->latency_max = latency;
+
+			stats_pending_free((StatsPending *) g_queue_pop_head(pending));
+		}
+	}
+	else
+	{
+		entry = stats_entry(message, strcspn(message, ","));
+		entry->count++;
+	}
+
+	entry->received += length;
+	return entry;
+}
+
+void stats_handled(StatsEntry *entry, gdouble start)
+{
+	entry->handling += stats_clock() - start;
+}
+
+void stats_reset(void)
+{
+	g_queue_foreach(pending, (GFunc) stats_pending_free, NULL);
+	g_queue_clear(pending);
+}
+
+static void stats_entry_show(G_GNUC_UNUSED gpointer key, StatsEntry *entry,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	if (entry->changed)
+	{
+		GtkTreeIter iter;
+
+		if (!store_find(store, &iter, STATS_NAME, entry->name))
+		{
+			scp_tree_store_append_with_values(store, &iter, NULL, STATS_NAME, entry->name,
+				-1);
+		}
+
+		scp_tree_store_set(store, &iter, STATS_COUNT, entry->count, STATS_SENT,
+			entry->sent, STATS_RECEIVED, entry->received, STATS_LATENCY,
+			entry->latency * 1000, STATS_LATENCY_MAX, entry->latency_max * 1000,
+			STATS_HANDLING, entry->handling * 1000, -1);
+		entry->changed = FALSE;
+	}
+}
+
+gboolean stats_update(void)
+{
+	g_hash_table_foreach(entries, (GHFunc) stats_entry_show, NULL);
+	return TRUE;
+}
+
+static void on_stats_clear(G_GNUC_UNUSED const MenuItem *menu_item)
+{
+	g_hash_table_remove_all(entries);
+	store_clear(store);
+}
+
+static void stats_iter_export(GtkTreeIter *iter, GString *text)
+{
+	const char *name;
+	gint count;
+	gint64 sent, received;
+	gdouble latency, latency_max, handling;
+
+	scp_tree_store_get(store, iter, STATS_NAME, &name, STATS_COUNT, &count, STATS_SENT,
+		&sent, STATS_RECEIVED, &received, STATS_LATENCY, &latency, STATS_LATENCY_MAX,
+		&latency_max, STATS_HANDLING, &handling, -1);
+	g_string_append_printf(text, "%s,%d,%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT
+		",%.3f,%.3f,%.3f\n", name, count, sent, received, latency, latency_max, handling);
+}
+
+static void on_stats_export(G_GNUC_UNUSED const MenuItem *menu_item)
+{
+	GtkWidget *dialog = gtk_file_chooser_dialog_new(_("Export Statistics"),
+		GTK_WINDOW(geany->main_widgets->window), GTK_FILE_CHOOSER_ACTION_SAVE,
+		GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL, GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT, NULL);
+
+	gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+	gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(dialog), "scope-stats.csv");
+
+	if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT)
+	{
+		char *filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+		GString *text = g_string_new("name,count,sent,received,latency_ms,latency_max_ms,"
+			"handling_ms\n");
+		GError *gerror = NULL;
+
+		stats_update();
+		store_foreach(store, (GFunc) stats_iter_export, text);
+
+		if (!g_file_set_contents(filename, text->str, text->len, &gerror))
+		{
+			show_error(_("%s: %s."), filename, gerror->message);
+			g_error_free(gerror);
+		}
+
+		g_string_free(text, TRUE);
+		g_free(filename);
+	}
+
+	gtk_widget_destroy(dialog);
+}
+
+#define DS_EXPORTABLE (DS_BASICS | DS_EXTRA_1)
+
+static MenuItem stats_menu_items[] =
+{
+	{ "stats_export", on_stats_export, DS_EXPORTABLE, NULL, NULL },
+	{ "stats_clear",  on_stats_clear,  0,             NULL, NULL },
+	{ NULL, NULL, 0, NULL, NULL }
+};
+
+static guint stats_menu_extra_state(void)
+{
+	return (g_hash_table_size(entries) != 0) << DS_INDEX_1;
+}
+
+static MenuInfo stats_menu_info = { stats_menu_items, stats_menu_extra_state, 0 };
+
+static void stats_ms_data_func(G_GNUC_UNUSED GtkTreeViewColumn *column,
+	GtkCellRenderer *cell, GtkTreeModel *model, GtkTreeIter *iter, gpointer gdata)
+{
+	gdouble value;
+	char text[G_ASCII_DTOSTR_BUF_SIZE];
+
+	gtk_tree_model_get(model, iter, GPOINTER_TO_INT(gdata), &value, -1);
+	g_snprintf(text, sizeof text, "%.3f", value);
+	g_object_set(cell, "text", text, NULL);
+}
+
+static void stats_set_ms_data_func(const char *column, const char *cell, gint column_id)
+{
+	gtk_tree_view_column_set_cell_data_func(get_column(column),
+		GTK_CELL_RENDERER(get_object(cell)), stats_ms_data_func,
+		GINT_TO_POINTER(column_id), NULL);
+}
+
+void stats_init(void)
+{
+	GtkTreeSelection *selection;
+	GtkWidget *tree = GTK_WIDGET(view_create("stats_view", &store, &selection));
+
+	timer = g_timer_new();
+	entries = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify) stats_entry_free);
+	pending = g_queue_new();
+
+	stats_set_ms_data_func("stats_latency_column", "stats_latency", STATS_LATENCY);
+	stats_set_ms_data_func("stats_latency_max_column", "stats_latency_max",
+		STATS_LATENCY_MAX);
+	stats_set_ms_data_func("stats_handling_column", "stats_handling", STATS_HANDLING);
+	menu_connect("stats_menu", &stats_menu_info, tree);
+}
+
+void stats_finalize(void)
+{
+	stats_reset();
+	g_queue_free(pending);
+	g_hash_table_destroy(entries);
+	g_timer_destroy(timer);
+}
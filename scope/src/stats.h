@@ -0,0 +1,36 @@
+/*
+ *  stats.h
+ *
+ *  Copyright 2013 Dimitar Toshkov Zhekov <dimitar.zhekov@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATS_H
+
+typedef struct _StatsEntry StatsEntry;
+
+void stats_send(const char *line, gsize length);
+StatsEntry *stats_receive(const char *message, gsize length);
+gdouble stats_clock(void);
+void stats_handled(StatsEntry *entry, gdouble start);
+void stats_reset(void);  /* forget the commands waiting for results */
+
+gboolean stats_update(void);
+
+void stats_init(void);
+void stats_finalize(void);
+
+#define STATS_H 1
+#endif
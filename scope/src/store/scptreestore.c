@@ -72,6 +72,7 @@ struct _ScpTreeStorePrivate
 	guint sublevel_reserved;
 	gboolean sublevel_discard;
 	gboolean columns_dirty;
+	AElem *load_parent;  /* children being loaded */
 };
 
 #define VALID_ITER(iter, store) \
@@ -406,6 +407,9 @@ static void scp_set_valist(ScpTreeStore *store, AElem *elem, gboolean *changed,
 static void scp_set_values_signals(ScpTreeStore *store, GtkTreeIter *iter, gboolean changed,
 	gboolean sort_changed)
 {
+	if (ITER_ELEM(iter)->parent == store->priv->load_parent)
+		return;  /* sorted and signalled when loaded */
+
 	if (sort_changed)
 		scp_sort_element(store, iter, TRUE);
 
@@ -474,6 +478,7 @@ gboolean scp_tree_store_remove(ScpTreeStore *store, GtkTreeIter *iter)
 	index = ITER_INDEX(iter);
 	elem = (AElem *) array->pdata[index];
 	parent = elem->parent;
+	g_return_val_if_fail(parent != priv->load_parent, FALSE);
 
 	path = scp_tree_store_get_path(store, iter);
 	scp_free_element(store, elem);
@@ -536,6 +541,7 @@ static gboolean scp_insert_element(ScpTreeStore *store, GtkTreeIter *iter, AElem
 	g_return_val_if_fail(iter != NULL, FALSE);
 	g_return_val_if_fail(priv->sublevels == TRUE || parent_iter == NULL, FALSE);
 	g_return_val_if_fail(VALID_ITER_OR_NULL(parent_iter, store), FALSE);
+	g_return_val_if_fail(!priv->load_parent || parent->parent != priv->load_parent, FALSE);
 
 	if (array)
 	{
@@ -557,11 +563,14 @@ static gboolean scp_insert_element(ScpTreeStore *store, GtkTreeIter *iter, AElem
 	iter->stamp = priv->stamp;
 	iter->user_data = array;
 	iter->user_data2 = GINT_TO_POINTER(position);
+	priv->columns_dirty = TRUE;
+
+	if (parent == priv->load_parent)
+		return TRUE;
 
 	if (priv->sort_func)
 		scp_sort_element(store, iter, FALSE);
 
-	priv->columns_dirty = TRUE;
 	path = scp_tree_store_get_path(store, iter);
 	gtk_tree_model_row_inserted(SCP_TREE_MODEL(store), path, iter);
 
@@ -737,11 +746,9 @@ gboolean scp_tree_store_iter_is_valid(ScpTreeStore *store, GtkTreeIter *iter)
 	return scp_tree_contains(store->priv->root->children, ITER_ELEM(iter));
 }
 
-static void scp_reorder_array(ScpTreeStore *store, GtkTreeIter *parent, GPtrArray *array,
-	gint *new_order)
+static void scp_permute_array(GPtrArray *array, gint *new_order)
 {
 	gpointer *pdata = g_new(gpointer, array->len);
-	GtkTreePath *path;
 	guint i;
 
 	for (i = 0; i < array->len; i++)
@@ -749,6 +756,14 @@ static void scp_reorder_array(ScpTreeStore *store, GtkTreeIter *parent, GPtrArra
 
 	memcpy(array->pdata, pdata, array->len * sizeof(gpointer));
 	g_free(pdata);
+}
+
+static void scp_reorder_array(ScpTreeStore *store, GtkTreeIter *parent, GPtrArray *array,
+	gint *new_order)
+{
+	GtkTreePath *path;
+
+	scp_permute_array(array, new_order);
 	/* emit signal */
 	path = parent ? scp_tree_store_get_path(store, parent) : gtk_tree_path_new();
 	gtk_tree_model_rows_reordered(SCP_TREE_MODEL(store), path, parent, new_order);
@@ -1543,6 +1558,86 @@ gboolean scp_tree_store_get_utf8_collate(ScpTreeStore *store, gint column)
 	return priv->headers[column].utf8_collate;
 }
 
+void scp_tree_store_load_start(ScpTreeStore *store, GtkTreeIter *parent)
+{
+	ScpTreeStorePrivate *priv = store->priv;
+	AElem *elem;
+
+	g_return_if_fail(SCP_IS_TREE_STORE(store));
+	g_return_if_fail(VALID_ITER_OR_NULL(parent, store));
+	g_return_if_fail(priv->load_parent == NULL);
+
+	elem = parent ? ITER_ELEM(parent) : priv->root;
+	g_return_if_fail(elem->children == NULL || elem->children->len == 0);
+	priv->load_parent = elem;
+}
+
+void scp_tree_store_load_finish(ScpTreeStore *store)
+{
+	ScpTreeStorePrivate *priv = store->priv;
+	AElem *parent = priv->load_parent;
+	GPtrArray *array;
+
+	g_return_if_fail(SCP_IS_TREE_STORE(store));
+	g_return_if_fail(parent != NULL);
+
+	priv->load_parent = NULL;
+	array = parent->children;
+
+	if (array && array->len)
+	{
+		GtkTreeIter iter, parent_iter;
+		GtkTreePath *path;
+		guint i;
+
+		if (priv->sort_func)
+		{
+			gint *new_order = g_new(gint, array->len);
+			ScpSortData sort_data = { store, array };
+
+			for (i = 0; i < array->len; i++)
+				new_order[i] = i;
+
+			g_qsort_with_data(new_order, array->len, sizeof(gint),
+				(GCompareDataFunc) scp_index_compare, &sort_data);
+			scp_permute_array(array, new_order);
+			g_free(new_order);
+		}
+
+		if (parent->parent)
+		{
+			parent_iter.stamp = priv->stamp;
+			parent_iter.user_data = parent->parent->children;
+			parent_iter.user_data2 = GINT_TO_POINTER(scp_ptr_array_find(
+				parent->parent->children, parent));
+			path = scp_tree_store_get_path(store, &parent_iter);
+			gtk_tree_path_down(path);
+		}
+		else
+			path = gtk_tree_path_new_first();
+
+		iter.stamp = priv->stamp;
+		iter.user_data = array;
+
+		for (i = 0; i < array->len; i++)
+		{
+			iter.user_data2 = GINT_TO_POINTER(i);
+			gtk_tree_model_row_inserted(SCP_TREE_MODEL(store), path, &iter);
+			gtk_tree_path_next(path);
+		}
+
+		if (parent->parent)
+		{
+			gtk_tree_path_up(path);
+			gtk_tree_model_row_has_child_toggled(SCP_TREE_MODEL(store), path,
+				&parent_iter);
+		}
+
+		gtk_tree_path_free(path);
+		validate_store(store);
+	}
+}
+
 #define scp_data_string(data) ((data)->v_string ? (data)->v_string : "")
 
 gint scp_tree_store_compare_func(ScpTreeStore *store, GtkTreeIter *a, GtkTreeIter *b,
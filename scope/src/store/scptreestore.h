@@ -148,6 +148,8 @@ void scp_tree_store_set_allocation(ScpTreeStore *store, guint toplevel_reserved,
 	guint sublevel_reserved, gboolean sublevel_discard);
 void scp_tree_store_set_utf8_collate(ScpTreeStore *store, gint column, gboolean collate);
 gboolean scp_tree_store_get_utf8_collate(ScpTreeStore *store, gint column);
+void scp_tree_store_load_start(ScpTreeStore *store, GtkTreeIter *parent);
+void scp_tree_store_load_finish(ScpTreeStore *store);
 gint scp_tree_store_compare_func(ScpTreeStore *store, GtkTreeIter *a, GtkTreeIter *b,
 	gpointer data);
 gboolean scp_tree_store_iter_seek(ScpTreeStore *store, GtkTreeIter *iter, gint position);
@@ -148,6 +148,28 @@ static gint thread_ident_compare(ScpTreeStore *store, GtkTreeIter *a, GtkTreeIte
 
 static ScpTreeStore *store;
 static GtkTreeSelection *selection;
+static GtkTreeView *tree;
+
+/* thread creations and exits are applied to the store in batches */
+#define THREAD_BATCH_TIME 50
+
+typedef struct _ThreadCreated
+{
+	char *tid;
+	char *gid;
+	char *pid;
+} ThreadCreated;
+
+static GArray *created_threads;
+static GHashTable *exited_threads;
+static gboolean created_select = FALSE;
+static guint batch_id = 0;
+
+/* threads with -thread-info queried for, the rows are only queried when visible */
+static GHashTable *queried_threads;
+static guint query_id = 0;
+
+static void threads_flush(void);
 
 static gboolean find_thread(const char *tid, GtkTreeIter *iter)
 {
@@ -231,10 +253,14 @@ void on_thread_running(GArray *nodes)
 {
 	const char *tid = parse_find_value(nodes, "thread-id");
 
+	threads_flush();
+
 	iff (tid, "no tid")
 	{
 		gboolean was_stopped = thread_state >= THREAD_STOPPED;
 
+		tooltip_cache_clear();
+
 		if (!strcmp(tid, "all"))
 			store_foreach(store, (GFunc) thread_iter_running, NULL);
 		else
@@ -255,7 +281,13 @@ static void thread_parse_extra(GArray *nodes, GtkTreeIter *iter, const char *nam
 	const char *value = parse_find_value(nodes, name);
 
 	if (value)
-		scp_tree_store_set(store, iter, column, value, -1);
+	{
+		const char *old_value;
+
+		scp_tree_store_get(store, iter, column, &old_value, -1);
+		if (strcmp(value, old_value ? old_value : ""))
+			scp_tree_store_set(store, iter, column, value, -1);
+	}
 }
 
 static void thread_parse_frame(GArray *frame, const char *tid, GtkTreeIter *iter)
@@ -306,8 +338,10 @@ static void thread_iter_stopped(GtkTreeIter *iter, StopData *sd)
 		tid ? -1 : THREAD_ID, &tid, -1);
 
 	if (strcmp(state, STOPPED))
+	{
 		thread_prompt++;
-	scp_tree_store_set(store, iter, THREAD_STATE, STOPPED, -1);
+		scp_tree_store_set(store, iter, THREAD_STATE, STOPPED, -1);
+	}
 
 	if (!g_strcmp0(tid, thread_id))
 	{
@@ -346,6 +380,8 @@ void on_thread_stopped(GArray *nodes)
 	const ParseNode *stopped = parse_find_node(nodes, "stopped-threads");
 	StopData sd;
 
+	threads_flush();
+
 	if (tid)
 	{
 		sd.found = find_thread(tid, &sd.iter);
@@ -413,6 +449,7 @@ static void set_gdb_thread(const char *tid, gboolean select)
 
 	if (select)
 	{
+		threads_flush();
 		GtkTreeIter iter;
 
 		if (find_thread(gdb_thread, &iter))
@@ -420,6 +457,189 @@ static void set_gdb_thread(const char *tid, gboolean select)
 	}
 }
 
+static gboolean thread_query_visible(G_GNUC_UNUSED gpointer gdata)
+{
+	GtkTreePath *start, *end;
+
+	query_id = 0;
+
+	if (gtk_tree_view_get_visible_range(tree, &start, &end))
+	{
+		gint index = gtk_tree_path_get_indices(start)[0];
+		gint last = gtk_tree_path_get_indices(end)[0];
+		GtkTreeIter iter;
+		gboolean valid = scp_tree_store_iter_nth_child(store, &iter, NULL, index);
+
+		for (; valid && index <= last; index++)
+		{
+			const char *tid;
+			const gchar *state;
+
+			scp_tree_store_get(store, &iter, THREAD_ID, &tid, THREAD_STATE, &state, -1);
+
+			if (!*state && !g_hash_table_lookup(queried_threads, tid))
+			{
+				g_hash_table_insert(queried_threads, g_strdup(tid), GINT_TO_POINTER(TRUE));
+				debug_send_format(N, "04-thread-info %s", tid);
+			}
+
+			valid = scp_tree_store_iter_next(store, &iter);
+		}
+
+		gtk_tree_path_free(start);
+		gtk_tree_path_free(end);
+	}
+
+	return FALSE;
+}
+
+static void thread_queue_query(void)
+{
+	if (!query_id)
+		query_id = plugin_idle_add(geany_plugin, thread_query_visible, NULL);
+}
+
+static void on_thread_scrolled(G_GNUC_UNUSED GtkAdjustment *adjustment,
+	G_GNUC_UNUSED gpointer gdata)
+{
+	thread_queue_query();
+}
+
+static void thread_created_free(ThreadCreated *created)
+{
+	g_free(created->tid);
+	g_free(created->gid);
+	g_free(created->pid);
+}
+
+static void threads_remove_exited(void)
+{
+	gboolean select = FALSE;
+	GtkTreeIter iter;
+	gint index = scp_tree_store_iter_n_children(store, NULL);
+
+	/* backwards, so that the removals don't shift the rows still to check */
+	while (index > 0 && g_hash_table_size(exited_threads))
+	{
+		const char *tid;
+
+		scp_tree_store_iter_nth_child(store, &iter, NULL, --index);
+		scp_tree_store_get(store, &iter, THREAD_ID, &tid, -1);
+
+		if (g_hash_table_remove(exited_threads, tid))
+		{
+			select |= !g_strcmp0(tid, thread_id);
+			g_hash_table_remove(queried_threads, tid);
+			thread_iter_unmark(&iter, GINT_TO_POINTER(TRUE));
+			scp_tree_store_remove(store, &iter);
+		}
+	}
+
+	if (g_hash_table_size(exited_threads))
+	{
+		GHashTableIter exited;
+		gpointer tid;
+
+		g_hash_table_iter_init(&exited, exited_threads);
+		while (g_hash_table_iter_next(&exited, &tid, NULL))
+			dc_error("%s: tid not found", (const char *) tid);
+
+		g_hash_table_remove_all(exited_threads);
+	}
+
+	if (select && thread_select_on_exited)
+		auto_select_thread();
+}
+
+static void threads_insert_created(void)
+{
+	gboolean load = !scp_tree_store_iter_n_children(store, NULL);
+	guint i;
+
+	/* a thread list freshly filled in, typically on startup, is sorted once */
+	if (load)
+		scp_tree_store_load_start(store, NULL);
+
+	for (i = 0; i < created_threads->len; i++)
+	{
+		ThreadCreated *created = &g_array_index(created_threads, ThreadCreated, i);
+
+		scp_tree_store_append_with_values(store, NULL, NULL, THREAD_ID, created->tid,
+			THREAD_STATE, "", THREAD_GROUP_ID, created->gid, THREAD_PID, created->pid, -1);
+		thread_created_free(created);
+	}
+
+	if (load)
+		scp_tree_store_load_finish(store);
+
+	g_array_set_size(created_threads, 0);
+
+	if (created_select)
+	{
+		GtkTreeIter iter;
+
+		created_select = FALSE;
+		if (gdb_thread && find_thread(gdb_thread, &iter))
+			utils_tree_set_cursor(selection, &iter, -1);
+	}
+
+	thread_queue_query();
+}
+
+/* applies the pending thread creations and exits, before the store is used */
+static void threads_flush(void)
+{
+	if (batch_id)
+	{
+		g_source_remove(batch_id);
+		batch_id = 0;
+	}
+
+	if (g_hash_table_size(exited_threads))
+		threads_remove_exited();
+
+	if (created_threads->len)
+		threads_insert_created();
+}
+
+static gboolean threads_batch_flush(G_GNUC_UNUSED gpointer gdata)
+{
+	batch_id = 0;
+	threads_flush();
+	return FALSE;
+}
+
+static void threads_batch(void)
+{
+	if (!batch_id)
+		batch_id = plugin_timeout_add(geany_plugin, THREAD_BATCH_TIME, threads_batch_flush, NULL);
+}
+
+/* the pending creations and exits are dropped, along with the store contents */
+static void threads_discard(void)
+{
+	guint i;
+
+	if (batch_id)
+	{
+		g_source_remove(batch_id);
+		batch_id = 0;
+	}
+
+	if (query_id)
+	{
+		g_source_remove(query_id);
+		query_id = 0;
+	}
+
+	for (i = 0; i < created_threads->len; i++)
+		thread_created_free(&g_array_index(created_threads, ThreadCreated, i));
+	g_array_set_size(created_threads, 0);
+	g_hash_table_remove_all(exited_threads);
+	g_hash_table_remove_all(queried_threads);
+	created_select = FALSE;
+}
+
 void on_thread_created(GArray *nodes)
 {
 	const char *tid = parse_find_value(nodes, "id");
@@ -443,39 +663,63 @@ void on_thread_created(GArray *nodes)
 	{
 		GtkTreeIter iter;
 		const char *pid = NULL;
+		ThreadCreated created;
 
 		iff (gid, "no gid")
 			iff (store_find(groups, &iter, GROUP_ID, gid), "%s: gid not found", gid)
 				scp_tree_store_get(groups, &iter, GROUP_PID, &pid, -1);
 
-		scp_tree_store_append_with_values(store, &iter, NULL, THREAD_ID, tid, THREAD_STATE,
-			"", THREAD_GROUP_ID, gid, THREAD_PID, pid, -1);
-		debug_send_format(N, "04-thread-info %s", tid);
+		/* a thread id may be reused after the exit is processed */
+		if (g_hash_table_size(exited_threads))
+			threads_flush();
+
+		created.tid = g_strdup(tid);
+		created.gid = g_strdup(gid);
+		created.pid = g_strdup(pid);
+		g_array_append_val(created_threads, created);
+		threads_batch();
 
 		if (thread_count == 1)
-			set_gdb_thread(tid, TRUE);
+		{
+			set_gdb_thread(tid, FALSE);
+			created_select = TRUE;
+		}
 	}
 }
 
+/* a thread created and exited in the same batch is never inserted */
+static gboolean thread_drop_created(const char *tid)
+{
+	guint i;
+
+	for (i = created_threads->len; i > 0; i--)
+	{
+		ThreadCreated *created = &g_array_index(created_threads, ThreadCreated, i - 1);
+
+		if (!strcmp(created->tid, tid))
+		{
+			thread_created_free(created);
+			g_array_remove_index(created_threads, i - 1);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 void on_thread_exited(GArray *nodes)
 {
 	const char *tid = parse_find_value(nodes, "id");
 
 	iff (tid, "no tid")
 	{
-		GtkTreeIter iter;
-
 		if (!g_strcmp0(tid, gdb_thread))
 			set_gdb_thread(NULL, FALSE);
 
-		if (find_thread(tid, &iter))
+		if (!thread_drop_created(tid))
 		{
-			gboolean was_selected = !g_strcmp0(tid, thread_id);
-
-			thread_iter_unmark(&iter, GINT_TO_POINTER(TRUE));
-			scp_tree_store_remove(store, &iter);
-			if (was_selected && thread_select_on_exited)
-				auto_select_thread();
+			g_hash_table_insert(exited_threads, g_strdup(tid), GINT_TO_POINTER(TRUE));
+			threads_batch();
 		}
 	}
 
@@ -484,6 +728,7 @@ void on_thread_exited(GArray *nodes)
 		if (!--thread_count)
 		{
 			/* shutdown */
+			threads_flush();
 			registers_show(FALSE);
 		#ifdef G_OS_UNIX
 			if (terminal_auto_hide)
@@ -503,6 +748,9 @@ static void thread_parse(GArray *nodes, const char *tid, gboolean stopped)
 {
 	GtkTreeIter iter;
 
+	threads_flush();
+	g_hash_table_remove(queried_threads, tid);
+
 	if (find_thread(tid, &iter))
 	{
 		if (stopped)
@@ -586,6 +834,7 @@ void threads_mark(GeanyDocument *doc)
 
 void threads_clear(void)
 {
+	threads_discard();
 	store_foreach(store, (GFunc) thread_iter_unmark, GINT_TO_POINTER(TRUE));
 	store_clear(groups);
 	store_clear(store);
@@ -614,6 +863,7 @@ void threads_delta(ScintillaObject *sci, const char *real_path, gint start, gint
 
 gboolean threads_update(void)
 {
+	threads_flush();
 	debug_send_command(N, "04-thread-info");
 	return TRUE;
 }
@@ -873,8 +1123,9 @@ static void on_thread_synchronize_button_release(GtkWidget *widget, GdkEventButt
 
 void thread_init(void)
 {
-	GtkTreeView *tree = view_create("thread_view", &store, &selection);
+	tree = view_create("thread_view", &store, &selection);
 	GtkWidget *menu = menu_select("thread_menu", &thread_menu_info, selection);
+	GtkAdjustment *adjustment;
 
 	view_set_sort_func(store, THREAD_ID, store_gint_compare);
 	view_set_sort_func(store, THREAD_FILE, store_seek_compare);
@@ -896,6 +1147,14 @@ void thread_init(void)
 		thread_seek_selected);
 
 	g_signal_connect(selection, "changed", G_CALLBACK(on_thread_selection_changed), NULL);
+	adjustment = gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(
+		get_widget("thread_window")));
+	g_signal_connect(adjustment, "value-changed", G_CALLBACK(on_thread_scrolled), NULL);
+	g_signal_connect(adjustment, "changed", G_CALLBACK(on_thread_scrolled), NULL);
+
+	created_threads = g_array_new(FALSE, FALSE, sizeof(ThreadCreated));
+	exited_threads = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	queried_threads = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 	g_signal_connect(get_widget("thread_synchronize"), "button-release-event",
 		G_CALLBACK(on_thread_synchronize_button_release), menu);
 #ifndef G_OS_UNIX
@@ -905,6 +1164,10 @@ void thread_init(void)
 
 void thread_finalize(void)
 {
+	threads_discard();
+	g_array_free(created_threads, TRUE);
+	g_hash_table_destroy(exited_threads);
+	g_hash_table_destroy(queried_threads);
 	store_foreach(store, (GFunc) thread_iter_unmark, NULL);
 	set_gdb_thread(NULL, FALSE);
 }
@@ -69,6 +69,47 @@ static void tooltip_set(gchar *text)
 	}
 }
 
+/* expression -> value for the current thread and frame, filled by the tooltips, watches
+   and inspects, cleared whenever the debuggee data or the current frame may change */
+static GHashTable *value_cache = NULL;
+
+static gchar *tooltip_cache_key(const gchar *expr)
+{
+	return g_strdup_printf("%s %s %s", thread_id ? thread_id : "", frame_id ? frame_id : "",
+		expr);
+}
+
+void tooltip_cache_set(const gchar *expr, const char *value)
+{
+	if (option_editor_tooltips && expr && value && *value && thread_id)
+	{
+		if (!value_cache)
+			value_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+		g_hash_table_insert(value_cache, tooltip_cache_key(expr), g_strdup(value));
+	}
+}
+
+static const char *tooltip_cache_get(const gchar *expr)
+{
+	const char *value = NULL;
+
+	if (value_cache)
+	{
+		gchar *key = tooltip_cache_key(expr);
+		value = g_hash_table_lookup(value_cache, key);
+		g_free(key);
+	}
+
+	return value;
+}
+
+void tooltip_cache_clear(void)
+{
+	if (value_cache)
+		g_hash_table_remove_all(value_cache);
+}
+
 static gint scid_gen = 0;
 
 void on_tooltip_error(GArray *nodes)
@@ -87,13 +128,22 @@ void on_tooltip_error(GArray *nodes)
 }
 
 static char *input = NULL;
+static gchar *input_expr = NULL;
+
+static void tooltip_set_value(const char *value)
+{
+	tooltip_set(parse_get_display_from_7bit(value, parse_mode_get(input, MODE_HBIT),
+		parse_mode_get(input, MODE_MEMBER)));
+}
 
 void on_tooltip_value(GArray *nodes)
 {
 	if (atoi(parse_grab_token(nodes)) == scid_gen)
 	{
-		tooltip_set(parse_get_display_from_7bit(parse_lead_value(nodes),
-			parse_mode_get(input, MODE_HBIT), parse_mode_get(input, MODE_MEMBER)));
+		const char *value = parse_lead_value(nodes);
+
+		tooltip_cache_set(input_expr, value);
+		tooltip_set_value(value);
 	}
 }
 
@@ -115,9 +165,19 @@ static gboolean tooltip_launch(gpointer gdata)
 
 		if ((expr = utils_verify_selection(expr)) != NULL)
 		{
+			const char *value = tooltip_cache_get(expr);
+
 			g_free(input);
-			input = debug_send_evaluate('3', scid_gen, expr);
-			g_free(expr);
+			g_free(input_expr);
+			input_expr = expr;
+
+			if (value)
+			{
+				input = utils_get_locale_from_utf8(expr);
+				tooltip_set_value(value);
+			}
+			else
+				input = debug_send_evaluate('3', scid_gen, expr);
 		}
 		else
 			tooltip_set(NULL);
@@ -184,6 +244,7 @@ void tooltip_remove(GeanyEditor *editor)
 
 void tooltip_clear(void)
 {
+	tooltip_cache_clear();
 	scid_gen = 0;
 	last_pos = -1;
 	peek_pos = -1;
@@ -204,4 +265,8 @@ void tooltip_finalize(void)
 {
 	g_free(output);
 	g_free(input);
+	g_free(input_expr);
+
+	if (value_cache)
+		g_hash_table_destroy(value_cache);
 }
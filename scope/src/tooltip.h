@@ -25,6 +25,9 @@ void on_tooltip_value(GArray *nodes);
 void tooltip_attach(GeanyEditor *editor);
 void tooltip_remove(GeanyEditor *editor);
 
+void tooltip_cache_set(const gchar *expr, const char *value);
+void tooltip_cache_clear(void);
+
 void tooltip_clear(void);
 gboolean tooltip_update(void);
 
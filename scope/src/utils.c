@@ -230,6 +230,41 @@ void utils_load(GKeyFile *config, const gchar *prefix,
 	} while (valid);
 }
 
+void utils_copy_sections(GKeyFile *from, GKeyFile *to, const gchar *prefix)
+{
+	guint i = 0;
+	gboolean valid;
+
+	do
+	{
+		char *section = g_strdup_printf("%s_%d", prefix, i++);
+		gchar **keys = g_key_file_get_keys(from, section, NULL, NULL);
+
+		valid = keys != NULL;
+
+		if (valid)
+		{
+			gchar **key;
+
+			for (key = keys; *key; key++)
+			{
+				gchar *value = g_key_file_get_value(from, section, *key, NULL);
+
+				if (value)
+				{
+					g_key_file_set_value(to, section, *key, value);
+					g_free(value);
+				}
+			}
+
+			g_strfreev(keys);
+		}
+
+		g_free(section);
+
+	} while (valid);
+}
+
 void utils_stash_group_free(StashGroup *group)
 {
 	stash_group_free_settings(group);
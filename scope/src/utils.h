@@ -43,6 +43,7 @@ gint store_seek_compare(ScpTreeStore *store, GtkTreeIter *a, GtkTreeIter *b, gpo
 
 void utils_load(GKeyFile *config, const char *prefix,
 	gboolean (*load_func)(GKeyFile *config, const char *section));
+void utils_copy_sections(GKeyFile *from, GKeyFile *to, const gchar *prefix);
 void utils_stash_group_free(StashGroup *group);
 
 typedef enum _SeekerType
@@ -50,6 +50,7 @@ static ViewInfo views[VIEW_COUNT] =
 	{ FALSE, VC_FRAME, watches_clear,   watches_update,   FALSE, DS_VARIABLE },
 	{ FALSE, VC_DATA,  memory_clear,    memory_update,    FALSE, DS_VARIABLE },
 	{ FALSE, VC_NONE,  NULL,            dc_update,        FALSE, DS_DEBUG },
+	{ FALSE, VC_NONE,  NULL,            stats_update,     FALSE, DS_BASICS },
 	{ FALSE, VC_FRAME, inspects_clear,  inspects_update,  FALSE, DS_VARIABLE },
 	{ FALSE, VC_FRAME, registers_clear, registers_update, TRUE,  DS_DEBUG },
 	{ FALSE, VC_DATA,  tooltip_clear,   tooltip_update,   FALSE, DS_SENDABLE },
@@ -97,15 +98,78 @@ void view_dirty(ViewIndex index)
 	views[index].dirty = TRUE;
 }
 
+/* Holding a step key sends the next step as soon as the previous one stopped.  A step sent
+   within VIEWS_STEP_DELAY of the last stop continues a burst: the views are only refreshed
+   once no step followed a stop for that long, instead of querying GDB about every stop. */
+#define VIEWS_STEP_DELAY 150  /* ms */
+
+static gboolean step_sent = FALSE;
+static gboolean step_burst = FALSE;
+static guint step_id = 0;
+
+static gboolean views_step_settled(G_GNUC_UNUSED gpointer gdata)
+{
+	step_id = 0;
+
+	if (step_burst)
+	{
+		DebugState state = debug_state();
+
+		step_burst = FALSE;
+		if (state & DS_SENDABLE)
+			views_update(state);
+	}
+
+	return FALSE;
+}
+
+static void views_step_reset(void)
+{
+	if (step_id)
+	{
+		g_source_remove(step_id);
+		step_id = 0;
+	}
+
+	step_sent = step_burst = FALSE;
+}
+
+void views_step(void)
+{
+	if (step_id)
+	{
+		g_source_remove(step_id);
+		step_id = 0;
+		step_burst = TRUE;
+	}
+
+	step_sent = TRUE;
+}
+
+/* Returns TRUE if refreshing the views waits for the end of a step burst */
+static gboolean views_step_postpone(DebugState state)
+{
+	/* stopped, or the program exited */
+	if ((state & (DS_DEBUG | DS_HANGING)) && step_sent)
+	{
+		step_sent = FALSE;
+		step_id = plugin_timeout_add(geany_plugin, VIEWS_STEP_DELAY, views_step_settled, NULL);
+	}
+
+	return step_burst;
+}
+
 void views_context_dirty(DebugState state, gboolean frame_only)
 {
 	ViewIndex i;
 
+	tooltip_cache_clear();
+
 	for (i = 0; i < VIEW_COUNT; i++)
 		if (views[i].context >= (frame_only ? VC_FRAME : VC_DATA))
 			view_dirty(i);
 
-	if (state != DS_BUSY)
+	if (state != DS_BUSY && !views_step_postpone(state))
 	{
 		if (option_update_all_views)
 			views_update(state);
@@ -125,6 +189,8 @@ void views_clear(void)
 	ViewIndex i;
 	ViewInfo *view = views;
 
+	views_step_reset();
+
 	for (i = 0; i < VIEW_COUNT; i++, view++)
 	{
 		view->dirty = FALSE;
@@ -136,6 +202,9 @@ void views_clear(void)
 
 void views_update(DebugState state)
 {
+	if (views_step_postpone(state))
+		return;
+
 	if (option_update_all_views)
 	{
 		ViewIndex i;
@@ -607,6 +676,20 @@ static void on_geany_sidebar_switch_page(G_GNUC_UNUSED GtkNotebook *notebook,
 	views_sidebar_update(page_num, debug_state());
 }
 
+static GtkWidget *views_panel;
+
+/* the watches, inspects et cetera of the program are loaded when first shown */
+static void on_view_map(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED gpointer gdata)
+{
+	program_load_views();
+}
+
+gboolean views_shown(void)
+{
+	return gtk_widget_get_mapped(views_panel) || gtk_widget_get_mapped(inspect_page) ||
+		gtk_widget_get_mapped(register_page);
+}
+
 static gulong switch_sidebar_page_id;
 
 void views_init(void)
@@ -648,10 +731,15 @@ void views_init(void)
 	gtk_notebook_append_page(geany_sidebar, inspect_page, get_widget("inspect_label"));
 	register_page = get_widget("register_page");
 	gtk_notebook_append_page(geany_sidebar, register_page, get_widget("register_label"));
+	views_panel = get_widget("debug_panel");
+	g_signal_connect(views_panel, "map", G_CALLBACK(on_view_map), NULL);
+	g_signal_connect(inspect_page, "map", G_CALLBACK(on_view_map), NULL);
+	g_signal_connect(register_page, "map", G_CALLBACK(on_view_map), NULL);
 }
 
 void views_finalize(void)
 {
+	views_step_reset();
 	g_signal_handler_disconnect(geany_sidebar, switch_sidebar_page_id);
 	gtk_widget_destroy(GTK_WIDGET(command_dialog));
 	gtk_widget_destroy(inspect_page);
@@ -29,6 +29,7 @@ typedef enum _ViewIndex
 	VIEW_WATCHES,
 	VIEW_MEMORY,
 	VIEW_CONSOLE,
+	VIEW_STATS,
 	VIEW_INSPECT,
 	VIEW_REGISTERS,
 	VIEW_TOOLTIP,
@@ -41,6 +42,7 @@ void views_context_dirty(DebugState state, gboolean frame_only);
 #define views_data_dirty(state) views_context_dirty((state), FALSE)
 void views_clear(void);
 void views_update(DebugState state);
+void views_step(void);
 gboolean view_stack_update(void);
 #define view_frame_update() (g_strcmp0(frame_id, "0") && view_stack_update())
 void view_local_update(void);
@@ -82,6 +84,7 @@ void view_seek_selected(GtkTreeSelection *selection, gboolean focus, SeekerType
 void view_command_line(const gchar *text, const gchar *title, const gchar *seek,
 	gboolean seek_after);
 void views_update_state(DebugState state);
+gboolean views_shown(void);
 
 void views_init(void);
 void views_finalize(void);
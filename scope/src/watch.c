@@ -107,6 +107,8 @@ static void watch_set(GArray *nodes, gchar *display, const char *value)
 
 	iff (store_find(store, &iter, WATCH_SCID, token), "%s: w_scid not found", token)
 	{
+		const char *old_display, *old_value;
+
 		if (!display)
 		{
 			gint hb_mode, mr_mode;
@@ -116,7 +118,19 @@ static void watch_set(GArray *nodes, gchar *display, const char *value)
 			display = parse_get_display_from_7bit(value, hb_mode, mr_mode);
 		}
 
-		scp_tree_store_set(store, &iter, WATCH_DISPLAY, display, WATCH_VALUE, value, -1);
+		scp_tree_store_get(store, &iter, WATCH_DISPLAY, &old_display, WATCH_VALUE,
+			&old_value, -1);
+
+		if (g_strcmp0(display, old_display) || g_strcmp0(value, old_value))
+			scp_tree_store_set(store, &iter, WATCH_DISPLAY, display, WATCH_VALUE, value, -1);
+
+		if (value)
+		{
+			const gchar *expr;
+
+			scp_tree_store_get(store, &iter, WATCH_EXPR, &expr, -1);
+			tooltip_cache_set(expr, value);
+		}
 	}
 
 	g_free(display);
@@ -153,7 +167,10 @@ gboolean watches_update(void)
 
 void watch_add(const gchar *text)
 {
-	gchar *expr = dialogs_show_input("Add Watch", GTK_WINDOW(geany->main_widgets->window),
+	gchar *expr;
+
+	program_load_views();
+	expr = dialogs_show_input("Add Watch", GTK_WINDOW(geany->main_widgets->window),
 		"Watch expression:", text);
 
 	if (validate_column(expr, TRUE))
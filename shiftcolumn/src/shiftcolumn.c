@@ -37,6 +37,7 @@
 #include "plugindata.h"
 #include "geanyfunctions.h"
 
+#include <string.h>
 #include <glib.h>
 #include <glib/gprintf.h>
 #include <gdk/gdkkeysyms.h>
@@ -63,6 +64,102 @@ enum{
 PLUGIN_KEY_GROUP(shiftcolumn, KB_COUNT)
 
 
+/* shift the block between startcol and endcol of the lines one character
+ * left or right: the new text of all the lines is made here, then replaces
+ * them at once, so the document is modified only once.
+ * returns the new position of the start of endline */
+static gint shift_block(ScintillaObject *sci, gint startline, gint endline,
+                        gint startcol, gint endcol, gboolean left){
+   gint region_start;
+   gint region_end;
+   gint line_iter;
+   gint linepos;
+   gint lineend;
+   gint linelen;
+   gint last_linepos = 0;
+   gint pad;
+   gsize start;
+   gchar *txt;
+   gchar *line;
+   gchar *block;
+   gchar moved;
+   GString *out;
+
+   region_start = sci_get_position_from_line(sci, startline);
+   region_end = sci_get_line_end_position(sci, endline);
+   txt = sci_get_contents_range(sci, region_start, region_end);
+   out = g_string_sized_new(region_end - region_start + 2 * (endline - startline + 1));
+
+   for(line_iter = startline; line_iter <= endline; line_iter++){
+      linepos = sci_get_position_from_line(sci, line_iter);
+      lineend = sci_get_line_end_position(sci, line_iter);
+      /* the length without the line end, but counting it in the tests */
+      linelen = lineend - linepos;
+      line = txt + (linepos - region_start);
+
+      if(line_iter == endline){
+         last_linepos = region_start + out->len;
+         }
+
+      /* do we need to do something */
+      if(linelen + 1 < startcol - 1){
+         g_string_append_len(out, line, linelen);
+         }
+
+      else if(left){
+         /* the block and the character before it are swapped in place */
+         start = out->len;
+         g_string_append_len(out, line, linelen);
+
+         /* if between the two columns */
+         /* pad to the end first -- sorry, I dont like tabs */
+         for(pad = linelen; pad < endcol; pad++){
+            g_string_append_c(out, ' ');
+            }
+
+         /* now move the text itself */
+         block = out->str + start;
+         moved = block[startcol - 1];
+         memmove(block + startcol - 1, block + startcol, endcol - startcol);
+         block[endcol - 1] = moved;
+         }
+
+      /* if between the two columns or at the end */
+      /* add in a space */
+      else if(linelen <= endcol){
+         pad = MIN(startcol, linelen);
+         g_string_append_len(out, line, pad);
+         g_string_append_c(out, ' ');
+         g_string_append_len(out, line + pad, linelen - pad);
+         }
+
+      else{
+         /* move the text itself */
+         start = out->len;
+         g_string_append_len(out, line, linelen);
+
+         block = out->str + start;
+         moved = block[endcol];
+         memmove(block + startcol + 1, block + startcol, endcol - startcol);
+         block[startcol] = moved;
+         }
+
+      /* and the line end as it was */
+      if(line_iter < endline){
+         g_string_append_len(out, txt + (lineend - region_start),
+            sci_get_position_from_line(sci, line_iter + 1) - lineend);
+         }
+      }
+
+   sci_set_target_start(sci, region_start);
+   sci_set_target_end(sci, region_end);
+   scintilla_send_message(sci, SCI_REPLACETARGET, out->len, (sptr_t) out->str);
+
+   g_string_free(out, TRUE);
+   g_free(txt);
+   return last_linepos;
+   }
+
 static void shift_left_cb(G_GNUC_UNUSED GtkMenuItem *menuitem,
                           G_GNUC_UNUSED gpointer gdata){
    gchar *txt;
@@ -75,18 +172,13 @@ static void shift_left_cb(G_GNUC_UNUSED GtkMenuItem *menuitem,
 
    gint startline;
    gint endline;
-   gint line_iter;
    gint linepos;
-   gint linelen;
 
    gint startcol;
    gint endcol;
 
    gint i;
 
-   gint n_spaces;
-   gchar *spaces;
-
    ScintillaObject *sci;
 
    /* get a pointer to the scintilla object */
@@ -154,55 +246,10 @@ static void shift_left_cb(G_GNUC_UNUSED GtkMenuItem *menuitem,
          /* start undo */
          sci_start_undo_action(sci);
 
-         for(line_iter = startline; line_iter <= endline; line_iter++){
-            linepos = sci_get_position_from_line(sci, line_iter);
-            linelen = sci_get_line_length(sci, line_iter);
-
-            /* do we need to do something */
-            if(linelen >= startcol - 1 ){
-
-               /* if between the two columns */
-               /* pad to the end first */
-               if(linelen <= endcol){
-
-                  /* bung in some spaces -- sorry, I dont like tabs */
-                  n_spaces = endcol - linelen + 1;
-                  spaces = g_malloc(sizeof(gchar) * (n_spaces + 1));
-                  for(i = 0; i < n_spaces; i++){
-                     spaces[i] = ' ';
-                     }
-                  spaces[i] = '\0';
-
-                  sci_insert_text(sci, linepos + linelen - 1, spaces);
-                  g_free(spaces);
-                  }
-
-               /* now move the text itself */
-               sci_set_selection_mode(sci, 0);
-               sci_set_selection_start(sci, linepos + startcol);
-               sci_set_selection_end(sci, linepos + endcol);
-
-               txt_len = sci_get_selected_text_length(sci);
-               txt_i = g_malloc(txt_len + 1);
-               txt = g_malloc(txt_len + 2);
-
-               sci_get_selected_text(sci, txt_i);
-               char_before = sci_get_char_at(sci, linepos + startcol - 1);
-
-               /* set up new text buf */
-               (void) g_sprintf(txt, "%s%c", txt_i, char_before);
-
-               /* put the new text in */
-               sci_set_selection_start(sci, linepos + startcol - 1);
-               sci_replace_sel(sci, txt);
-
-               g_free(txt);
-               g_free(txt_i);
-               }
-            }
+         linepos = shift_block(sci, startline, endline, startcol, endcol, TRUE);
 
          /* put the selection box back */
-         /* here we rely upon the last result of linepos */
+         /* linepos is the new start of the last line */
          sci_set_selection_mode(sci, 1);
          sci_set_selection_start(sci, startpos - 1);
          sci_set_selection_end(sci, linepos + endcol - 1);
@@ -226,9 +273,7 @@ static void shift_right_cb(G_GNUC_UNUSED GtkMenuItem *menuitem,
 
    gint startline;
    gint endline;
-   gint line_iter;
    gint linepos;
-   gint linelen;
 
    gint startcol;
    gint endcol;
@@ -296,51 +341,10 @@ static void shift_right_cb(G_GNUC_UNUSED GtkMenuItem *menuitem,
          /* start undo */
          sci_start_undo_action(sci);
 
-         for(line_iter = startline; line_iter <= endline; line_iter++){
-            linepos = sci_get_position_from_line(sci, line_iter);
-            linelen = sci_get_line_length(sci, line_iter);
-
-            /* do we need to do something */
-            if(linelen >= startcol - 1 ){
-
-               /* if between the two columns or at the end */
-               /* add in a space */
-               if(linelen <= endcol || linelen - 1 == endcol){
-                  txt = g_malloc(sizeof(gchar) * 2);
-                  sprintf(txt, " ");
-
-                  sci_insert_text(sci, linepos + startcol, txt);
-                  g_free(txt);
-                  }
-
-               else{
-                  /* move the text itself */
-                  sci_set_selection_mode(sci, 0);
-                  sci_set_selection_start(sci, linepos + startcol);
-                  sci_set_selection_end(sci, linepos + endcol);
-
-                  txt_len = sci_get_selected_text_length(sci);
-                  txt_i = g_malloc(txt_len + 1);
-                  txt = g_malloc(txt_len + 2);
-
-                  sci_get_selected_text(sci, txt_i);
-                  char_after = sci_get_char_at(sci, linepos + endcol);
-
-                  /* set up new text buf */
-                  (void) g_sprintf(txt, "%c%s", char_after, txt_i);
-
-                  /* put the new text in */
-                  sci_set_selection_end(sci, linepos + endcol + 1);
-                  sci_replace_sel(sci, txt);
-
-                  g_free(txt);
-                  g_free(txt_i);
-                  }
-               }
-            }
+         linepos = shift_block(sci, startline, endline, startcol, endcol, FALSE);
 
          /* put the selection box back */
-         /* here we rely upon the last result of linepos */
+         /* linepos is the new start of the last line */
          sci_set_selection_mode(sci, 1);
          sci_set_selection_start(sci, startpos + 1);
          sci_set_selection_end(sci, linepos + endcol + 1);
@@ -35,6 +35,8 @@
 #include "gui.h"
 #include "scplugin.h"
 #include "speller.h"
+#include "idlesched.h"
+#include "largefile.h"
 
 
 
@@ -47,14 +49,30 @@ typedef struct
 } SpellClickInfo;
 static SpellClickInfo clickinfo;
 
+/* "Looking up suggestions..." item of the editor submenu, NULL once it is destroyed */
+static GtkWidget *suggestions_placeholder = NULL;
+
+/* A range of text which was changed while checking while typing was enabled and has not
+ * been checked yet. The dirty ranges of a document are kept sorted and non-overlapping in an
+ * array attached to its ScintillaObject. */
 typedef struct
 {
-	GeanyDocument *doc;
-	gint line_number;
-	gint line_count;
-	guint check_while_typing_idle_source_id;
-} CheckLineData;
-static CheckLineData check_line_data;
+	gint start;
+	gint end;
+} DirtyRange;
+
+#define DIRTY_RANGES_KEY "spellcheck-dirty-ranges"
+
+/* off-screen ranges are checked in pieces of about this size in bytes */
+#define CHECK_IDLE_CHUNK_SIZE 4096
+
+/* timeout checking the visible dirty ranges of the current document */
+static guint check_while_typing_source_id = 0;
+/* scheduler tasks checking the remaining dirty ranges, GeanyDocument -> id */
+static GHashTable *check_tasks = NULL;
+
+/* the language of a menu item, owned by sc_info->dicts */
+#define LANGUAGE_KEY "spellcheck-menu-language"
 
 /* Flag to indicate that a callback function will be triggered by generating the appropriate event
  * but the callback should be ignored. */
@@ -166,7 +184,7 @@ static void menu_suggestion_item_activate_cb(GtkMenuItem *menuitem, gpointer gda
 		sci_replace_sel(sci, sugg);
 
 		/* store the replacement for future checks */
-		sc_speller_store_replacement(word, sugg);
+		sc_speller_store_replacement(clickinfo.doc, word, sugg);
 
 		/* remove indicator */
 		sci_indicator_clear(sci, startword, endword - startword);
@@ -189,10 +207,10 @@ static void menu_addword_item_activate_cb(GtkMenuItem *menuitem, gpointer gdata)
 	/* if we ignore the word, we add it to the current session, to ignore it
 	 * also for further checks*/
 	if (ignore)
-		sc_speller_add_word_to_session(clickinfo.word);
+		sc_speller_add_word_to_session(clickinfo.doc, clickinfo.word);
 	/* if we do not ignore the word, we add the word to the personal dictionary */
 	else
-		sc_speller_add_word(clickinfo.word);
+		sc_speller_add_word(clickinfo.doc, clickinfo.word);
 
 	/* Remove all indicators on the added/ignored word */
 	sci = clickinfo.doc->editor->sci;
@@ -252,6 +270,64 @@ static GtkWidget *init_editor_submenu(void)
 }
 
 
+/* Inserts suggs into the editor submenu at position, ten per menu */
+static void add_suggestions(gchar **suggs, gint position)
+{
+	GtkWidget *menu = sc_info->edit_menu_sub;
+	GtkWidget *menu_item;
+	guint i;
+
+	for (i = 0; suggs[i] != NULL; i++)
+	{
+		if (i > 0 && i % 10 == 0)
+		{
+			menu_item = gtk_menu_item_new();
+			gtk_widget_show(menu_item);
+			gtk_menu_shell_insert(GTK_MENU_SHELL(menu), menu_item, position++);
+
+			menu_item = gtk_menu_item_new_with_label(_("More..."));
+			gtk_widget_show(menu_item);
+			gtk_menu_shell_insert(GTK_MENU_SHELL(menu), menu_item, position++);
+
+			menu = gtk_menu_new();
+			gtk_menu_item_set_submenu(GTK_MENU_ITEM(menu_item), menu);
+			position = 0;
+		}
+		menu_item = gtk_menu_item_new_with_label(suggs[i]);
+		gtk_widget_show(menu_item);
+		gtk_menu_shell_insert(GTK_MENU_SHELL(menu), menu_item, position++);
+		g_signal_connect(menu_item, "activate",
+			G_CALLBACK(menu_suggestion_item_activate_cb), NULL);
+	}
+	if (i == 0)
+	{
+		menu_item = gtk_menu_item_new_with_label(_("(No Suggestions)"));
+		gtk_widget_set_sensitive(menu_item, FALSE);
+		gtk_widget_show(menu_item);
+		gtk_menu_shell_insert(GTK_MENU_SHELL(menu), menu_item, position);
+	}
+}
+
+
+/* Replaces the placeholder of the editor submenu with the suggestions, unless the submenu
+ * was rebuilt for another word meanwhile */
+static void suggestions_ready_cb(const gchar *word, gchar **suggs, gpointer data)
+{
+	GList *children;
+	gint position;
+
+	if (suggestions_placeholder == NULL || ! utils_str_equal(word, clickinfo.word))
+		return;
+
+	children = gtk_container_get_children(GTK_CONTAINER(sc_info->edit_menu_sub));
+	position = g_list_index(children, suggestions_placeholder);
+	g_list_free(children);
+
+	gtk_widget_destroy(suggestions_placeholder);
+	add_suggestions(suggs, position);
+}
+
+
 static void perform_check(GeanyDocument *doc)
 {
 	clear_spellcheck_error_markers(doc);
@@ -324,48 +400,35 @@ void sc_gui_update_editor_menu_cb(GObject *obj, const gchar *word, gint pos,
 		return;
 	}
 
-	if (sc_speller_dict_check(search_word) != 0)
+	if (sc_speller_dict_check(doc, search_word) != 0)
 	{
-		GtkWidget *menu_item, *menu;
+		GtkWidget *menu_item;
 		gchar *label;
-		gsize n_suggs, i;
 		gchar **suggs;
 
-		suggs = sc_speller_dict_suggest(search_word, &n_suggs);
-
 		clickinfo.pos = pos;
 		clickinfo.doc = doc;
 		setptr(clickinfo.word, search_word);
 
-		menu = init_editor_submenu();
+		init_editor_submenu();
 
-		for (i = 0; i < n_suggs; i++)
+		/* looking suggestions up may take a while, the menu shows up without them */
+		suggs = sc_speller_get_cached_suggestions(doc, search_word);
+		if (suggs != NULL)
 		{
-			if (i > 0 && i % 10 == 0)
-			{
-				menu_item = gtk_menu_item_new();
-				gtk_widget_show(menu_item);
-				gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_item);
-
-				menu_item = gtk_menu_item_new_with_label(_("More..."));
-				gtk_widget_show(menu_item);
-				gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_item);
-
-				menu = gtk_menu_new();
-				gtk_menu_item_set_submenu(GTK_MENU_ITEM(menu_item), menu);
-			}
-			menu_item = gtk_menu_item_new_with_label(suggs[i]);
-			gtk_widget_show(menu_item);
-			gtk_container_add(GTK_CONTAINER(menu), menu_item);
-			g_signal_connect(menu_item, "activate",
-				G_CALLBACK(menu_suggestion_item_activate_cb), NULL);
+			add_suggestions(suggs, 0);
+			g_strfreev(suggs);
 		}
-		if (suggs == NULL)
+		else
 		{
-			menu_item = gtk_menu_item_new_with_label(_("(No Suggestions)"));
+			menu_item = gtk_menu_item_new_with_label(_("Looking up suggestions..."));
 			gtk_widget_set_sensitive(menu_item, FALSE);
 			gtk_widget_show(menu_item);
 			gtk_container_add(GTK_CONTAINER(sc_info->edit_menu_sub), menu_item);
+			suggestions_placeholder = menu_item;
+			g_object_add_weak_pointer(G_OBJECT(menu_item), (gpointer *) &suggestions_placeholder);
+
+			sc_speller_suggest_async(doc, search_word, suggestions_ready_cb, NULL);
 		}
 		menu_item = gtk_separator_menu_item_new();
 		gtk_widget_show(menu_item);
@@ -384,9 +447,6 @@ void sc_gui_update_editor_menu_cb(GObject *obj, const gchar *word, gint pos,
 		g_signal_connect(menu_item, "activate",
 			G_CALLBACK(menu_addword_item_activate_cb), GINT_TO_POINTER(TRUE));
 
-		if (suggs != NULL)
-			sc_speller_dict_free_string_list(suggs);
-
 		g_free(label);
 	}
 	else
@@ -396,48 +456,285 @@ void sc_gui_update_editor_menu_cb(GObject *obj, const gchar *word, gint pos,
 }
 
 
-static void indicator_clear_on_line(GeanyDocument *doc, gint line_number)
+static void dirty_ranges_free(GArray *ranges)
+{
+	g_array_free(ranges, TRUE);
+}
+
+
+/* Returns the dirty ranges of doc, creating them if create is TRUE */
+static GArray *get_dirty_ranges(GeanyDocument *doc, gboolean create)
+{
+	GArray *ranges = g_object_get_data(G_OBJECT(doc->editor->sci), DIRTY_RANGES_KEY);
+
+	if (ranges == NULL && create)
+	{
+		ranges = g_array_new(FALSE, FALSE, sizeof(DirtyRange));
+		g_object_set_data_full(G_OBJECT(doc->editor->sci), DIRTY_RANGES_KEY, ranges,
+			(GDestroyNotify) dirty_ranges_free);
+	}
+	return ranges;
+}
+
+
+/* Returns the index of the first range which ends at or after pos */
+static guint dirty_ranges_find(GArray *ranges, gint pos)
+{
+	guint lo = 0, hi = ranges->len;
+
+	while (lo < hi)
+	{
+		guint mid = (lo + hi) / 2;
+
+		if (g_array_index(ranges, DirtyRange, mid).end < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+/* Adds start to end to ranges, merging it with overlapping and adjacent ranges */
+static void dirty_ranges_add(GArray *ranges, gint start, gint end)
+{
+	guint i = dirty_ranges_find(ranges, start);
+	guint j = i;
+	DirtyRange range = { start, end };
+
+	while (j < ranges->len && g_array_index(ranges, DirtyRange, j).start <= end)
+	{
+		DirtyRange *r = &g_array_index(ranges, DirtyRange, j);
+
+		range.start = MIN(range.start, r->start);
+		range.end = MAX(range.end, r->end);
+		j++;
+	}
+	if (j > i)
+		g_array_remove_range(ranges, i, j - i);
+	g_array_insert_val(ranges, i, range);
+}
+
+
+/* Whether r starts after end. Empty ranges left by deletions belong to the text ending
+ * at their position. */
+static gboolean dirty_range_is_after(const DirtyRange *r, gint end)
 {
-	gint start_pos, length;
+	return r->start > end || (r->start == end && r->end > r->start);
+}
+
+
+/* Removes start to end from ranges, splitting ranges which contain it */
+static void dirty_ranges_remove(GArray *ranges, gint start, gint end)
+{
+	guint i = dirty_ranges_find(ranges, start);
+
+	while (i < ranges->len)
+	{
+		DirtyRange *r = &g_array_index(ranges, DirtyRange, i);
 
-	g_return_if_fail(doc != NULL);
+		if (dirty_range_is_after(r, end))
+			break;
 
-	start_pos = sci_get_position_from_line(doc->editor->sci, line_number);
-	length = sci_get_line_length(doc->editor->sci, line_number);
+		if (r->start < start && r->end > end)
+		{	/* split */
+			DirtyRange tail = { end, r->end };
 
-	sci_indicator_clear(doc->editor->sci, start_pos, length);
+			r->end = start;
+			g_array_insert_val(ranges, i + 1, tail);
+			break;
+		}
+		else if (r->start < start)
+		{
+			r->end = start;
+			i++;
+		}
+		else if (r->end > end)
+		{
+			r->start = end;
+			break;
+		}
+		else
+			g_array_remove_index(ranges, i);
+	}
 }
 
 
-static gboolean check_lines(gpointer data)
+/* Moves the ranges after a text modification at pos and marks the modified text dirty */
+static void dirty_ranges_update(GArray *ranges, gint pos, gint inserted, gint deleted)
 {
-	GeanyDocument *doc = check_line_data.doc;
+	guint i;
 
-	/* since we're in an timeout callback, the document may have been closed */
-	if (DOC_VALID (doc))
+	for (i = dirty_ranges_find(ranges, pos); i < ranges->len; i++)
 	{
-		gchar *line;
-		gint line_number = check_line_data.line_number;
-		gint line_count = check_line_data.line_count;
-		gint i;
+		DirtyRange *r = &g_array_index(ranges, DirtyRange, i);
 
-		for (i = 0; i < line_count; i++)
+		if (inserted > 0)
+		{
+			if (r->start > pos)
+				r->start += inserted;
+			if (r->end > pos)
+				r->end += inserted;
+		}
+		else
 		{
-			line = sci_get_line(doc->editor->sci, line_number);
-			indicator_clear_on_line(doc, line_number);
-			if (sc_speller_process_line(doc, line_number, line) != 0)
-			{
-				if (sc_info->use_msgwin)
-					msgwin_switch_tab(MSG_MESSAGE, FALSE);
-			}
-			g_free(line);
+			if (r->start > pos + deleted)
+				r->start -= deleted;
+			else if (r->start > pos)
+				r->start = pos;
+			if (r->end > pos + deleted)
+				r->end -= deleted;
+			else if (r->end > pos)
+				r->end = pos;
 		}
 	}
-	check_line_data.check_while_typing_idle_source_id = 0;
+	dirty_ranges_add(ranges, pos, pos + inserted);
+}
+
+
+static gboolean is_space_at(ScintillaObject *sci, gint pos)
+{
+	return g_ascii_isspace(sci_get_char_at(sci, pos));
+}
+
+
+/* Checks start to end after extending it to the surrounding white space so that partly
+ * changed words are checked completely. Returns the end of the checked text. */
+static gint check_range(GeanyDocument *doc, gint start, gint end)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	gint length = sci_get_length(sci);
+
+	end = MIN(end, length);
+	while (start > 0 && ! is_space_at(sci, start - 1))
+		start--;
+	while (end < length && ! is_space_at(sci, end))
+		end++;
+
+	if (end > start)
+	{
+		sci_indicator_set(sci, GEANY_INDICATOR_ERROR);
+		sci_indicator_clear(sci, start, end - start);
+		if (sc_speller_process_range(doc, start, end) != 0)
+		{
+			if (sc_info->use_msgwin)
+				msgwin_switch_tab(MSG_MESSAGE, FALSE);
+		}
+	}
+	return end;
+}
+
+
+/* Checks the dirty ranges of doc in the given range and removes them from the dirty set */
+static void check_dirty_ranges(GeanyDocument *doc, GArray *ranges, gint start, gint end)
+{
+	guint i = dirty_ranges_find(ranges, start);
+
+	while (i < ranges->len)
+	{
+		DirtyRange r = g_array_index(ranges, DirtyRange, i);
+		gint checked_end;
+
+		if (dirty_range_is_after(&r, end))
+			break;
+
+		r.start = MAX(r.start, start);
+		r.end = MIN(r.end, end);
+
+		checked_end = check_range(doc, r.start, r.end);
+		dirty_ranges_remove(ranges, r.start, MAX(r.end, checked_end));
+		/* a range was removed or cut off, continue with the next one */
+		i = dirty_ranges_find(ranges, checked_end);
+	}
+}
+
+
+/* Checks the dirty ranges of a document in small pieces while Geany is idle, the
+ * current document first */
+static gboolean check_offscreen_ranges(gpointer data)
+{
+	GeanyDocument *doc = data;
+	GArray *ranges;
+
+	if (! sc_info->check_while_typing || (ranges = get_dirty_ranges(doc, FALSE)) == NULL)
+		return FALSE;
+
+	while (ranges->len > 0 && ! gp_sched_should_yield())
+	{
+		DirtyRange r = g_array_index(ranges, DirtyRange, 0);
+
+		check_dirty_ranges(doc, ranges, r.start, MIN(r.end, r.start + CHECK_IDLE_CHUNK_SIZE));
+	}
+	return ranges->len > 0;
+}
+
+
+static void on_check_task_removed(gpointer data)
+{
+	g_hash_table_remove(check_tasks, data);
+}
+
+
+static void schedule_offscreen_checks(void)
+{
+	guint i;
+
+	if (check_tasks == NULL)
+		check_tasks = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	foreach_document(i)
+	{
+		GeanyDocument *doc = documents[i];
+		GArray *ranges = get_dirty_ranges(doc, FALSE);
+
+		/* only the visible part of large documents is checked */
+		if (ranges != NULL && ranges->len > 0 && g_hash_table_lookup(check_tasks, doc) == NULL &&
+			! gp_large_file_check(doc))
+		{
+			guint id = gp_sched_add(geany_plugin, GP_SCHED_PRIORITY_DEFAULT, doc,
+				check_offscreen_ranges, doc, on_check_task_removed);
+
+			g_hash_table_insert(check_tasks, doc, GUINT_TO_POINTER(id));
+		}
+	}
+}
+
+
+/* Checks the dirty ranges in the visible part of the current document, the rest is
+ * checked later when Geany is idle */
+static gboolean check_visible_ranges(gpointer data)
+{
+	GeanyDocument *doc = document_get_current();
+	GArray *ranges;
+
+	if (DOC_VALID(doc) && (ranges = get_dirty_ranges(doc, FALSE)) != NULL)
+	{
+		ScintillaObject *sci = doc->editor->sci;
+		gint first_visible = scintilla_send_message(sci, SCI_GETFIRSTVISIBLELINE, 0, 0);
+		gint lines_on_screen = scintilla_send_message(sci, SCI_LINESONSCREEN, 0, 0);
+		gint first_line, last_line;
+
+		first_line = scintilla_send_message(sci, SCI_DOCLINEFROMVISIBLE, first_visible, 0);
+		last_line = scintilla_send_message(sci, SCI_DOCLINEFROMVISIBLE,
+			first_visible + lines_on_screen, 0);
+
+		check_dirty_ranges(doc, ranges, sci_get_position_from_line(sci, first_line),
+			sci_get_line_end_position(sci, last_line));
+	}
+
+	schedule_offscreen_checks();
+
 	return FALSE;
 }
 
 
+static gboolean check_visible_ranges_timeout(gpointer data)
+{
+	check_while_typing_source_id = 0;
+	return check_visible_ranges(data);
+}
+
+
 static gboolean need_delay(void)
 {
 	static gint64 time_prev = 0; /* time in microseconds */
@@ -452,10 +749,10 @@ static gboolean need_delay(void)
 	if (time_now < (time_prev + (timeout * 1000)))
 		return TRUE;
 
-	if (check_line_data.check_while_typing_idle_source_id == 0)
+	if (check_while_typing_source_id == 0)
 	{
-		check_line_data.check_while_typing_idle_source_id =
-			plugin_timeout_add(geany_plugin, timeout, check_lines, NULL);
+		check_while_typing_source_id =
+			plugin_timeout_add(geany_plugin, timeout, check_visible_ranges_timeout, NULL);
 	}
 
 	/* set current time for the next key press */
@@ -465,46 +762,44 @@ static gboolean need_delay(void)
 }
 
 
-static void check_on_text_changed(GeanyDocument *doc, gint position, gint lines_added)
+static void check_on_text_changed(GeanyDocument *doc, SCNotification *nt)
 {
-	gint line_number;
-	gint line_count;
-
-	/* Iterating over all lines which changed as indicated by lines_added. lines_added is 0
-	 * if only a lines has changed, in this case set it to 1. Otherwise, iterating over all
-	 * new lines makes spell checking work for pasted text. */
-	line_count = MAX(1, lines_added);
+	GArray *ranges = get_dirty_ranges(doc, TRUE);
 
-	line_number = sci_get_line_from_position(doc->editor->sci, position);
-	/* TODO: storing these information in the global check_line_data struct isn't that good.
-	 * The data gets overwritten when a new line is inserted and so there is a chance that thep
-	 * previous line is not checked to the end. One solution could be to simple maintain a list
-	 * of line numbers which needs to be checked and do this is the timeout handler. */
-	check_line_data.doc = doc;
-	check_line_data.line_number = line_number;
-	check_line_data.line_count = line_count;
+	if (nt->modificationType & SC_MOD_INSERTTEXT)
+		dirty_ranges_update(ranges, nt->position, nt->length, 0);
+	else
+		dirty_ranges_update(ranges, nt->position, 0, nt->length);
 
 	/* check only once in a while */
 	if (! need_delay())
-		check_lines(NULL);
+		check_visible_ranges(NULL);
 }
 
 
 gboolean sc_gui_editor_notify(GObject *object, GeanyEditor *editor,
 							  SCNotification *nt, gpointer data)
 {
-	if (! sc_info->check_while_typing)
+	if (nt->nmhdr.code != SCN_MODIFIED ||
+		! (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
 		return FALSE;
 
-	if (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
-	{
-		check_on_text_changed(editor->document, nt->position, nt->linesAdded);
-	}
+	/* positions of a running document check are not valid anymore */
+	sc_speller_cancel_check(editor->document);
+
+	if (sc_info->check_while_typing)
+		check_on_text_changed(editor->document, nt);
 
 	return FALSE;
 }
 
 
+void sc_gui_document_close_cb(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	sc_speller_cancel_check(doc);
+}
+
+
 #if ! GTK_CHECK_VERSION(2, 16, 0)
 static void gtk_menu_item_set_label(GtkMenuItem *menu_item, const gchar *label)
 {
@@ -521,6 +816,7 @@ static void gtk_menu_item_set_label(GtkMenuItem *menu_item, const gchar *label)
 
 static void update_labels(void)
 {
+	GeanyDocument *doc = document_get_current();
 	gchar *label;
 
 	label = g_strdup_printf(_("Default (%s)"),
@@ -533,9 +829,10 @@ static void update_labels(void)
 #if GTK_CHECK_VERSION(2, 12, 0)
 	if (sc_info->toolbar_button != NULL)
 	{
+		const gchar *lang = sc_speller_get_doc_lang(doc);
 		gchar *text = g_strdup_printf(
 			_("Toggle spell check while typing (current language: %s)"),
-			(sc_info->default_language != NULL) ? sc_info->default_language : _("unknown"));
+			(lang != NULL) ? lang : _("unknown"));
 		gtk_tool_item_set_tooltip_text(GTK_TOOL_ITEM(sc_info->toolbar_button), text);
 		g_free(text);
 	}
@@ -543,6 +840,37 @@ static void update_labels(void)
 }
 
 
+/* Activates the menu item of the language of doc */
+static void update_language_items(GeanyDocument *doc)
+{
+	const gchar *lang = sc_speller_get_doc_lang(doc);
+	GList *children, *node;
+
+	if (sc_info->main_menu == NULL)
+		return;
+
+	sc_ignore_callback = TRUE;
+	children = gtk_container_get_children(GTK_CONTAINER(sc_info->main_menu));
+	for (node = children; node != NULL; node = node->next)
+	{
+		if (GTK_IS_RADIO_MENU_ITEM(node->data) &&
+			utils_str_equal(lang, g_object_get_data(G_OBJECT(node->data), LANGUAGE_KEY)))
+		{
+			gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(node->data), TRUE);
+		}
+	}
+	g_list_free(children);
+	sc_ignore_callback = FALSE;
+}
+
+
+void sc_gui_document_activate_cb(GObject *obj, GeanyDocument *doc, gpointer user_data)
+{
+	update_language_items(doc);
+	update_labels();
+}
+
+
 static void menu_item_toggled_cb(GtkCheckMenuItem *menuitem, gpointer gdata)
 {
 	GeanyDocument *doc;
@@ -558,14 +886,20 @@ static void menu_item_toggled_cb(GtkCheckMenuItem *menuitem, gpointer gdata)
 	}
 	doc = document_get_current();
 
-	/* Another language was chosen from the menu item, so make it default for this session. */
-    if (gdata != NULL)
+	if (! DOC_VALID(doc))
+		return;
+
+	/* Another language was chosen from the menu item, so use it for the current document,
+	 * the default item switches it back to the default language. The dictionaries of the
+	 * languages in use stay loaded. */
+	if (! sc_speller_set_doc_lang(doc, gdata))
 	{
-		setptr(sc_info->default_language, g_strdup(gdata));
-		sc_speller_reinit_enchant_dict();
-		sc_gui_update_menu();
-		update_labels();
+		ui_set_statusbar(TRUE, _("The dictionary for \"%s\" could not be loaded."),
+			(const gchar *) gdata);
+		return;
 	}
+	update_language_items(doc);
+	update_labels();
 
 	perform_check(doc);
 }
@@ -637,7 +971,8 @@ void sc_gui_update_menu(void)
 		label = g_ptr_array_index(sc_info->dicts, i);
 		menu_item = gtk_radio_menu_item_new_with_label(group, label);
 		group = gtk_radio_menu_item_get_group(GTK_RADIO_MENU_ITEM(menu_item));
-		if (utils_str_equal(sc_info->default_language, label))
+		g_object_set_data(G_OBJECT(menu_item), LANGUAGE_KEY, label);
+		if (utils_str_equal(sc_speller_get_doc_lang(document_get_current()), label))
 			gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(menu_item), TRUE);
 		gtk_container_add(GTK_CONTAINER(sc_info->main_menu), menu_item);
 		g_signal_connect(menu_item, "toggled", G_CALLBACK(menu_item_toggled_cb), label);
@@ -655,9 +990,19 @@ void sc_gui_init(void)
 
 void sc_gui_free(void)
 {
+	guint i;
+
 	g_free(clickinfo.word);
-	if (check_line_data.check_while_typing_idle_source_id != 0)
+	foreach_document(i)
+		g_object_set_data(G_OBJECT(documents[i]->editor->sci), DIRTY_RANGES_KEY, NULL);
+	if (check_while_typing_source_id != 0)
+	{
+		g_source_remove(check_while_typing_source_id);
+	}
+	gp_sched_cancel_plugin(geany_plugin);
+	if (check_tasks != NULL)
 	{
-		g_source_remove(check_line_data.check_while_typing_idle_source_id);
+		g_hash_table_destroy(check_tasks);
+		check_tasks = NULL;
 	}
 }
@@ -33,6 +33,9 @@
 #include "scplugin.h"
 #include "gui.h"
 #include "speller.h"
+#include "notifyprof.h"
+#include "largefile.h"
+#include "startprof.h"
 
 
 GeanyPlugin		*geany_plugin;
@@ -65,11 +68,15 @@ PLUGIN_KEY_GROUP(spellcheck, KB_COUNT)
 
 
 
+GP_NOTIFY_PROFILE_EDITOR_HANDLER(sc_gui_editor_notify_profiled, sc_gui_editor_notify)
+
 
 PluginCallback plugin_callbacks[] =
 {
 	{ "update-editor-menu", (GCallback) &sc_gui_update_editor_menu_cb, FALSE, NULL },
-	{ "editor-notify", (GCallback) &sc_gui_editor_notify, FALSE, NULL },
+	{ "editor-notify", (GCallback) &sc_gui_editor_notify_profiled, FALSE, NULL },
+	{ "document-activate", (GCallback) &sc_gui_document_activate_cb, FALSE, NULL },
+	{ "document-close", (GCallback) &sc_gui_document_close_cb, FALSE, NULL },
 	{ NULL, NULL, FALSE, NULL }
 };
 
@@ -158,11 +165,16 @@ static void configure_response_cb(GtkDialog *dialog, gint response, gpointer use
 }
 
 
-void plugin_init(GeanyData *data)
+static void init_plugin(GeanyData *data)
 {
 	GKeyFile *config = g_key_file_new();
 	gchar *default_lang;
 
+	/* the document check runs in a separate thread */
+	plugin_module_make_resident(geany_plugin);
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+
 	default_lang = sc_speller_get_default_lang();
 	sc_info = g_new0(SpellCheck, 1);
 
@@ -203,8 +215,13 @@ void plugin_init(GeanyData *data)
 	keybindings_set_item(plugin_key_group, KB_SPELL_TOOGLE_TYPING,
 		sc_gui_kb_toggle_typing_activate_cb, 0, 0, "spell_toggle_typing",
 		_("Toggle Check While Typing"), NULL);
+
+	gp_large_file_register(geany_plugin, _("Spell check while typing"),
+		GP_LARGE_FILE_VIEWPORT_ONLY);
 }
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init_plugin)
+
 
 #ifdef HAVE_ENCHANT_1_5
 static void dictionary_dir_button_clicked_cb(GtkButton *button, gpointer item)
@@ -351,6 +368,7 @@ void plugin_cleanup(void)
 	if (sc_info->toolbar_button != NULL)
 		gtk_widget_destroy(GTK_WIDGET(sc_info->toolbar_button));
 
+	gp_large_file_unregister(geany_plugin);
 	sc_gui_free();
 	sc_speller_free();
 
@@ -36,11 +36,59 @@
 
 #include "speller.h"
 #include "scplugin.h"
+#include "sciutils.h"
 
 
 
 static EnchantBroker *sc_speller_broker = NULL;
-static EnchantDict *sc_speller_dict = NULL;
+
+/* maximum number of words whose check result is remembered, per dictionary */
+#define SC_CACHE_MAX_WORDS 20000
+
+/* Cache of enchant_dict_check() results for a dictionary. Recently used words are kept at
+ * the head of the queue, the least recently used ones are dropped from its tail. */
+typedef struct
+{
+	GHashTable *words;	/* word -> CacheEntry */
+	GQueue *lru;		/* of words, owned by the hash table */
+} SpellCache;
+
+typedef struct
+{
+	gboolean misspelled;
+	GList *link;
+} CacheEntry;
+
+/* maximum number of dictionaries kept loaded, documents may use different languages */
+#define SC_POOL_MAX_DICTS 4
+
+/* A dictionary loaded from the broker together with the results looked up in it */
+typedef struct
+{
+	gchar *lang;
+	EnchantDict *dict;
+	SpellCache cache;
+	GHashTable *suggest_cache;	/* word -> suggestions, only used by the main thread */
+	gint users;					/* running checks and lookups, which prevent eviction */
+} SpellDict;
+
+/* The loaded dictionaries, lang -> SpellDict, and the same with the most recently used
+ * first. Both are only used by the main thread. */
+static GHashTable *sc_speller_pool = NULL;
+static GQueue *sc_speller_pool_lru = NULL;
+
+/* protects the dictionaries and their check caches which are also used by the threads */
+static GMutex *sc_speller_lock = NULL;
+
+/* the language used for documents without a language of their own, which is the default
+ * language unless there is no dictionary for it */
+static gchar *sc_speller_lang = NULL;
+
+/* the language of a document chosen from the menu, attached to its ScintillaObject */
+#define DOC_LANG_KEY "spellcheck-language"
+
+
+static gboolean is_text_style(gint lexer, gint style);
 
 
 
@@ -121,14 +169,250 @@ static gchar *strip_word(const gchar *word_to_check, gint *result_offset)
 }
 
 
-static gint sc_speller_check_word(GeanyDocument *doc, gint line_number, const gchar *word,
-						   gint start_pos, gint end_pos)
+static void cache_entry_free(gpointer data)
+{
+	g_slice_free(CacheEntry, data);
+}
+
+
+static void cache_clear(SpellCache *cache)
+{
+	if (cache->words == NULL)
+	{
+		cache->words = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, cache_entry_free);
+		cache->lru = g_queue_new();
+	}
+	else
+	{
+		g_queue_clear(cache->lru);
+		g_hash_table_remove_all(cache->words);
+	}
+}
+
+
+static void cache_free(SpellCache *cache)
+{
+	if (cache->words == NULL)
+		return;
+
+	g_queue_free(cache->lru);
+	g_hash_table_destroy(cache->words);
+	cache->words = NULL;
+	cache->lru = NULL;
+}
+
+
+/* Returns enchant_dict_check()'s result for word but asks the dictionary only if the word
+ * has not been seen recently. Must be called with sc_speller_lock held. */
+static gint cache_dict_check(SpellDict *sd, const gchar *word)
+{
+	SpellCache *cache = &sd->cache;
+	CacheEntry *entry;
+	gchar *key;
+	gint result;
+
+	entry = g_hash_table_lookup(cache->words, word);
+	if (entry != NULL)
+	{
+		g_queue_unlink(cache->lru, entry->link);
+		g_queue_push_head_link(cache->lru, entry->link);
+		return entry->misspelled ? 1 : 0;
+	}
+
+	result = enchant_dict_check(sd->dict, word, -1);
+	/* don't remember errors */
+	if (result < 0)
+		return result;
+
+	if (g_hash_table_size(cache->words) >= SC_CACHE_MAX_WORDS)
+	{	/* drop the least recently used word */
+		gchar *old_key = g_queue_pop_tail(cache->lru);
+		g_hash_table_remove(cache->words, old_key);
+	}
+
+	key = g_strdup(word);
+	entry = g_slice_new(CacheEntry);
+	entry->misspelled = (result != 0);
+	g_queue_push_head(cache->lru, key);
+	entry->link = cache->lru->head;
+	g_hash_table_insert(cache->words, key, entry);
+
+	return result;
+}
+
+
+static void spell_dict_free(SpellDict *sd)
+{
+	cache_free(&sd->cache);
+	if (sd->suggest_cache != NULL)
+		g_hash_table_destroy(sd->suggest_cache);
+	enchant_broker_free_dict(sc_speller_broker, sd->dict);
+	g_free(sd->lang);
+	g_free(sd);
+}
+
+
+/* Drops the least recently used dictionaries beyond SC_POOL_MAX_DICTS which are not in use */
+static void pool_evict(void)
+{
+	GList *node = sc_speller_pool_lru->tail;
+
+	while (node != NULL && g_queue_get_length(sc_speller_pool_lru) > SC_POOL_MAX_DICTS)
+	{
+		SpellDict *sd = node->data;
+		GList *prev = node->prev;
+
+		if (sd->users == 0)
+		{
+			g_queue_delete_link(sc_speller_pool_lru, node);
+			g_hash_table_remove(sc_speller_pool, sd->lang);
+			spell_dict_free(sd);
+		}
+		node = prev;
+	}
+}
+
+
+/* Returns the dictionary for lang, loading it only if it is not in the pool yet.
+ * Returns NULL if the broker has no dictionary for lang. */
+static SpellDict *pool_get(const gchar *lang)
+{
+	SpellDict *sd;
+	EnchantDict *dict;
+
+	if (EMPTY(lang))
+		return NULL;
+
+	sd = g_hash_table_lookup(sc_speller_pool, lang);
+	if (sd != NULL)
+	{
+		g_queue_remove(sc_speller_pool_lru, sd);
+		g_queue_push_head(sc_speller_pool_lru, sd);
+		return sd;
+	}
+
+	dict = enchant_broker_request_dict(sc_speller_broker, lang);
+	if (dict == NULL)
+		return NULL;
+
+	sd = g_new0(SpellDict, 1);
+	sd->lang = g_strdup(lang);
+	sd->dict = dict;
+	cache_clear(&sd->cache);
+	g_hash_table_insert(sc_speller_pool, sd->lang, sd);
+	g_queue_push_head(sc_speller_pool_lru, sd);
+	pool_evict();
+
+	return sd;
+}
+
+
+/* Frees all dictionaries, none of them may be in use */
+static void pool_clear(void)
+{
+	g_hash_table_remove_all(sc_speller_pool);
+	while (! g_queue_is_empty(sc_speller_pool_lru))
+		spell_dict_free(g_queue_pop_head(sc_speller_pool_lru));
+}
+
+
+static void dict_ref(SpellDict *sd)
+{
+	sd->users++;
+}
+
+
+static void dict_unref(SpellDict *sd)
+{
+	sd->users--;
+	if (sd->users == 0)
+		pool_evict();
+}
+
+
+/* Returns the language chosen for doc or the default language */
+const gchar *sc_speller_get_doc_lang(GeanyDocument *doc)
+{
+	const gchar *lang = NULL;
+
+	if (DOC_VALID(doc))
+		lang = g_object_get_data(G_OBJECT(doc->editor->sci), DOC_LANG_KEY);
+	return (lang != NULL) ? lang : sc_info->default_language;
+}
+
+
+/* Sets the language of doc, NULL to use the default language again. Returns FALSE if there
+ * is no dictionary for lang. */
+gboolean sc_speller_set_doc_lang(GeanyDocument *doc, const gchar *lang)
+{
+	g_return_val_if_fail(DOC_VALID(doc), FALSE);
+
+	if (lang != NULL && pool_get(lang) == NULL)
+		return FALSE;
+
+	/* a running check of doc uses its former dictionary */
+	sc_speller_cancel_check(doc);
+	g_object_set_data_full(G_OBJECT(doc->editor->sci), DOC_LANG_KEY, g_strdup(lang), g_free);
+	return TRUE;
+}
+
+
+/* Returns the dictionary of doc, falling back to the default one if the dictionary of its
+ * language cannot be loaded anymore, or NULL if there is no dictionary at all */
+static SpellDict *get_doc_dict(GeanyDocument *doc)
+{
+	SpellDict *sd = NULL;
+
+	if (DOC_VALID(doc))
+		sd = pool_get(g_object_get_data(G_OBJECT(doc->editor->sci), DOC_LANG_KEY));
+	return (sd != NULL) ? sd : pool_get(sc_speller_lang);
+}
+
+
+/* Builds the messages window line for a misspelled word or returns NULL if there are no
+ * suggestions. The number of suggestions is stored in n_suggs.
+ * Must be called with sc_speller_lock held. */
+static gchar *get_suggestions_message(SpellDict *sd, gint line_number, const gchar *word,
+									  gsize *n_suggs)
+{
+	gsize j;
+	gchar **suggs;
+	GString *str;
+
+	*n_suggs = 0;
+	suggs = enchant_dict_suggest(sd->dict, word, -1, n_suggs);
+	if (suggs == NULL)
+		return NULL;
+
+	str = g_string_sized_new(256);
+	g_string_append_printf(str, "line %d: %s | ",  line_number + 1, word);
+
+	g_string_append(str, _("Try: "));
+
+	/* Now find the misspellings in the line, limit suggestions to a maximum of 15 (for now) */
+	for (j = 0; j < MIN(*n_suggs, 15); j++)
+	{
+		g_string_append(str, suggs[j]);
+		g_string_append_c(str, ' ');
+	}
+
+	if (*n_suggs > 0)
+		enchant_dict_free_string_list(sd->dict, suggs);
+
+	return g_string_free(str, FALSE);
+}
+
+
+static gint sc_speller_check_word(GeanyDocument *doc, SpellDict *sd, gint line_number,
+								  const gchar *word, gint start_pos, gint end_pos)
 {
 	gsize n_suggs = 0;
 	gchar *word_to_check;
 	gint offset;
+	gint result;
 
-	g_return_val_if_fail(sc_speller_dict != NULL, 0);
+	g_return_val_if_fail(sd != NULL, 0);
 	g_return_val_if_fail(doc != NULL, 0);
 	g_return_val_if_fail(word != NULL, 0);
 	g_return_val_if_fail(start_pos >= 0 && end_pos >= 0, 0);
@@ -136,14 +420,10 @@ static gint sc_speller_check_word(GeanyDocument *doc, gint line_number, const gc
 	if (EMPTY(word))
 		return 0;
 
-	/* ignore numbers or words starting with digits */
+	/* ignore numbers or words starting with digits, non-text was skipped by the caller */
 	if (isdigit(*word))
 		return 0;
 
-	/* ignore non-text */
-	if (! sc_speller_is_text(doc, start_pos))
-		return 0;
-
 	/* strip punctuation and white space */
 	word_to_check = strip_word(word, &offset);
 	if (! NZV(word_to_check))
@@ -156,8 +436,12 @@ static gint sc_speller_check_word(GeanyDocument *doc, gint line_number, const gc
 	start_pos += offset;
 	end_pos = start_pos + strlen(word_to_check);
 
+	g_mutex_lock(sc_speller_lock);
+	result = cache_dict_check(sd, word_to_check);
+	g_mutex_unlock(sc_speller_lock);
+
 	/* early out if the word is spelled correctly */
-	if (enchant_dict_check(sc_speller_dict, word_to_check, -1) == 0)
+	if (result == 0)
 	{
 		g_free(word_to_check);
 		return 0;
@@ -167,98 +451,423 @@ static gint sc_speller_check_word(GeanyDocument *doc, gint line_number, const gc
 
 	if (sc_info->use_msgwin && line_number != -1)
 	{
-		gsize j;
-		gchar **suggs;
-		GString *str;
+		gchar *msg;
 
-		str = g_string_sized_new(256);
-		suggs = enchant_dict_suggest(sc_speller_dict, word_to_check, -1, &n_suggs);
-		if (suggs != NULL)
+		g_mutex_lock(sc_speller_lock);
+		msg = get_suggestions_message(sd, line_number, word_to_check, &n_suggs);
+		g_mutex_unlock(sc_speller_lock);
+
+		if (msg != NULL)
 		{
-			g_string_append_printf(str, "line %d: %s | ",  line_number + 1, word_to_check);
+			msgwin_msg_add(COLOR_RED, line_number + 1, doc, "%s", msg);
+			g_free(msg);
+		}
+	}
+
+	g_free(word_to_check);
+	return n_suggs;
+}
+
 
-			g_string_append(str, _("Try: "));
+typedef gboolean (*SplitWordsFunc)(const gchar *word, gsize offset, gpointer data);
+
+
+/* Calls func for each word in text from start to stop. Words are split in-process using
+ * is_word_sep() instead of asking Scintilla for each word's boundaries. The word passed to
+ * func is only valid during the call, offset is its byte offset in text. Returns FALSE if
+ * func returned FALSE to stop splitting. */
+static gboolean split_words(const gchar *text, gsize start, gsize stop, GString *str,
+							SplitWordsFunc func, gpointer data)
+{
+	const gchar *p = text + start;
+	const gchar *end = text + stop;
+	const gchar *word_start = NULL;
+
+	while (p <= end)
+	{
+		gunichar c;
+		const gchar *next;
 
-			/* Now find the misspellings in the line, limit suggestions to a maximum of 15 (for now) */
-			for (j = 0; j < MIN(n_suggs, 15); j++)
+		if (p == end)
+		{	/* flush the last word */
+			c = ' ';
+			next = p + 1;
+		}
+		else
+		{
+			c = g_utf8_get_char_validated(p, end - p);
+			if (c == (gunichar) -1 || c == (gunichar) -2 || c == 0)
+			{	/* treat invalid UTF-8 and NUL bytes as separators */
+				c = ' ';
+				next = p + 1;
+			}
+			else
+				next = g_utf8_next_char(p);
+		}
+
+		if (is_word_sep(c))
+		{
+			if (word_start != NULL)
 			{
-				g_string_append(str, suggs[j]);
-				g_string_append_c(str, ' ');
+				g_string_truncate(str, 0);
+				g_string_append_len(str, word_start, p - word_start);
+
+				if (! func(str->str, word_start - text, data))
+					return FALSE;
+				word_start = NULL;
 			}
+		}
+		else if (word_start == NULL)
+			word_start = p;
 
-			msgwin_msg_add(COLOR_RED, line_number + 1, doc, "%s", str->str);
+		p = next;
+	}
+	return TRUE;
+}
+
+
+/* Calls split_words() on each run of text whose styles are checked for lexer. Code is
+ * skipped a style run at a time, so that only the words of the comments, strings and the
+ * like are split and looked up. */
+static void split_text_words(const gchar *text, const guchar *styles, gsize len, gint lexer,
+							 GString *str, SplitWordsFunc func, gpointer data)
+{
+	gsize start = 0;
 
-			if (suggs != NULL && n_suggs > 0)
-				enchant_dict_free_string_list(sc_speller_dict, suggs);
+	while (start < len)
+	{
+		guchar style = styles[start];
+		gsize end = start + 1;
+
+		if (! is_text_style(lexer, style))
+		{
+			while (end < len && styles[end] == style)
+				end++;
 		}
-		g_string_free(str, TRUE);
+		else
+		{
+			/* adjacent text runs of different styles are split as one */
+			while (end < len && (styles[end] == styles[end - 1] ||
+				is_text_style(lexer, styles[end])))
+				end++;
+
+			if (! split_words(text, start, end, str, func, data))
+				return;
+		}
+		start = end;
 	}
+}
 
-	g_free(word_to_check);
-	return n_suggs;
+
+typedef struct
+{
+	GeanyDocument *doc;
+	SpellDict *sd;
+	gint line_number;	/* -1 to look up the line of each word */
+	gint start_pos;
+	gint suggestions_found;
+} CheckTextData;
+
+
+static gboolean check_text_word(const gchar *word, gsize offset, gpointer data)
+{
+	CheckTextData *ctd = data;
+	gint pos = ctd->start_pos + offset;
+	gint line_number = ctd->line_number;
+
+	/* the line is only needed for the messages window */
+	if (line_number == -1 && sc_info->use_msgwin)
+		line_number = sci_get_line_from_position(ctd->doc->editor->sci, pos);
+
+	ctd->suggestions_found += sc_speller_check_word(ctd->doc, ctd->sd, line_number, word,
+		pos, pos + strlen(word));
+	return TRUE;
 }
 
 
-gint sc_speller_process_line(GeanyDocument *doc, gint line_number, const gchar *line)
+/* Checks the words of the text from start_pos to end_pos, fetching its styles at once */
+static gint check_text(GeanyDocument *doc, gint line_number, gint start_pos, gint end_pos)
 {
-	gint pos_start, pos_end;
-	gint wstart, wend;
+	ScintillaObject *sci = doc->editor->sci;
 	GString *str;
-	gint suggestions_found = 0;
+	gchar *text;
+	guchar *styles;
+	CheckTextData ctd;
+
+	ctd.sd = get_doc_dict(doc);
+	if (ctd.sd == NULL)
+		return 0;
+
+	ctd.doc = doc;
+	ctd.line_number = line_number;
+	ctd.start_pos = start_pos;
+	ctd.suggestions_found = 0;
+
+	gp_sci_get_styled_text(sci, start_pos, end_pos, &text, &styles);
+	str = g_string_sized_new(256);
+	split_text_words(text, styles, end_pos - start_pos,
+		scintilla_send_message(sci, SCI_GETLEXER, 0, 0), str, check_text_word, &ctd);
+	g_string_free(str, TRUE);
+	g_free(text);
+	g_free(styles);
+
+	return ctd.suggestions_found;
+}
+
+
+gint sc_speller_process_line(GeanyDocument *doc, gint line_number, const gchar *line)
+{
+	gint start_pos;
 
-	g_return_val_if_fail(sc_speller_dict != NULL, 0);
 	g_return_val_if_fail(doc != NULL, 0);
 	g_return_val_if_fail(line != NULL, 0);
 
-	str = g_string_sized_new(256);
+	start_pos = sci_get_position_from_line(doc->editor->sci, line_number);
+	return check_text(doc, line_number, start_pos, start_pos + strlen(line));
+}
+
+
+gint sc_speller_process_range(GeanyDocument *doc, gint start_pos, gint end_pos)
+{
+	g_return_val_if_fail(doc != NULL, 0);
+	g_return_val_if_fail(start_pos >= 0 && end_pos >= start_pos, 0);
+
+	return check_text(doc, -1, start_pos, end_pos);
+}
+
+
+/* A misspelled word found by the check thread */
+typedef struct
+{
+	gint start;
+	gint end;
+	gchar *message;		/* line for the messages window, may be NULL */
+} CheckResult;
+
+/* A full document check running in a separate thread. The thread works on a copy of the
+ * document text and its styles, misspellings are collected in results and applied to the
+ * document from a timeout handler in the main thread. */
+typedef struct
+{
+	GeanyDocument *doc;
+	SpellDict *sd;		/* in use until the job is freed */
+	gchar *text;
+	guchar *styles;
+	gsize len;
+	gint start_pos;
+	gint lexer;
+	gboolean use_msgwin;
+
+	/* used only by the check thread to track the line of the current word */
+	gint line_number;
+	gsize line_offset;
+
+	GThread *thread;
+	volatile gint cancelled;
+	volatile gint finished;
+
+	GMutex *lock;
+	GPtrArray *results;	/* of CheckResult, protected by lock */
+
+	guint source_id;
+	gint misspellings_found;
+} CheckJob;
+
+static CheckJob *sc_check_job = NULL;
 
-	pos_start = sci_get_position_from_line(doc->editor->sci, line_number);
-	pos_end = sci_get_position_from_line(doc->editor->sci, line_number + 1);
 
-	while (pos_start < pos_end)
+static void check_result_free(CheckResult *result)
+{
+	g_free(result->message);
+	g_slice_free(CheckResult, result);
+}
+
+
+static gboolean check_job_word(const gchar *word, gsize offset, gpointer data)
+{
+	CheckJob *job = data;
+	CheckResult *result;
+	gchar *word_to_check;
+	gchar *message = NULL;
+	gint word_offset;
+	gint misspelled;
+
+	if (g_atomic_int_get(&job->cancelled))
+		return FALSE;
+
+	/* ignore numbers or words starting with digits, non-text was skipped by split_text_words() */
+	if (isdigit(*word))
+		return TRUE;
+
+	word_to_check = strip_word(word, &word_offset);
+	if (! NZV(word_to_check))
 	{
-		wstart = scintilla_send_message(doc->editor->sci, SCI_WORDSTARTPOSITION, pos_start, TRUE);
-		wend = scintilla_send_message(doc->editor->sci, SCI_WORDENDPOSITION, wstart, FALSE);
-		if (wstart == wend)
-			break;
+		g_free(word_to_check);
+		return TRUE;
+	}
 
-		/* ensure the string has enough allocated memory */
-		if (str->len < (guint)(wend - wstart))
-			g_string_set_size(str, wend - wstart);
+	/* advance the line counter up to the current word */
+	for (; job->line_offset < offset; job->line_offset++)
+	{
+		gchar c = job->text[job->line_offset];
 
-		sci_get_text_range(doc->editor->sci, wstart, wend, str->str);
+		if (c == '\n' || (c == '\r' && job->text[job->line_offset + 1] != '\n'))
+			job->line_number++;
+	}
 
-		suggestions_found += sc_speller_check_word(doc, line_number, str->str, wstart, wend);
+	g_mutex_lock(sc_speller_lock);
+	misspelled = cache_dict_check(job->sd, word_to_check);
+	if (misspelled > 0 && job->use_msgwin)
+	{
+		gsize n_suggs;
+		message = get_suggestions_message(job->sd, job->line_number, word_to_check, &n_suggs);
+	}
+	g_mutex_unlock(sc_speller_lock);
 
-		pos_start = wend + 1;
+	if (misspelled > 0)
+	{
+		result = g_slice_new(CheckResult);
+		result->start = job->start_pos + offset + word_offset;
+		result->end = result->start + strlen(word_to_check);
+		result->message = message;
+
+		g_mutex_lock(job->lock);
+		g_ptr_array_add(job->results, result);
+		g_mutex_unlock(job->lock);
 	}
 
+	g_free(word_to_check);
+	return TRUE;
+}
+
+
+static gpointer check_job_thread(gpointer data)
+{
+	CheckJob *job = data;
+	GString *str = g_string_sized_new(256);
+
+	split_text_words(job->text, job->styles, job->len, job->lexer, str, check_job_word, job);
+
 	g_string_free(str, TRUE);
-	return suggestions_found;
+	g_atomic_int_set(&job->finished, TRUE);
+	return NULL;
+}
+
+
+/* Applies the results collected so far to the document, returns the number of results */
+static guint check_job_apply_results(CheckJob *job)
+{
+	GPtrArray *results;
+	guint i;
+
+	g_mutex_lock(job->lock);
+	results = job->results;
+	job->results = g_ptr_array_new();
+	g_mutex_unlock(job->lock);
+
+	for (i = 0; i < results->len; i++)
+	{
+		CheckResult *result = g_ptr_array_index(results, i);
+
+		editor_indicator_set_on_range(job->doc->editor, GEANY_INDICATOR_ERROR,
+			result->start, result->end);
+		if (result->message != NULL)
+		{
+			msgwin_msg_add(COLOR_RED,
+				sci_get_line_from_position(job->doc->editor->sci, result->start) + 1,
+				job->doc, "%s", result->message);
+		}
+		check_result_free(result);
+	}
+	i = results->len;
+	g_ptr_array_free(results, TRUE);
+
+	return i;
+}
+
+
+static void check_job_free(CheckJob *job)
+{
+	g_thread_join(job->thread);
+
+	g_ptr_array_foreach(job->results, (GFunc) check_result_free, NULL);
+	g_ptr_array_free(job->results, TRUE);
+	g_mutex_free(job->lock);
+	g_free(job->text);
+	g_free(job->styles);
+	dict_unref(job->sd);
+	g_free(job);
+}
+
+
+static gboolean check_job_update(gpointer data)
+{
+	CheckJob *job = data;
+	gboolean finished = g_atomic_int_get(&job->finished);
+
+	job->misspellings_found += check_job_apply_results(job);
+
+	if (! finished)
+		return TRUE;
+
+	if (job->misspellings_found == 0 && sc_info->use_msgwin)
+		msgwin_msg_add(COLOR_BLUE, -1, NULL, _("The checked text is spelled correctly."));
+
+	ui_progress_bar_stop();
+	check_job_free(job);
+	sc_check_job = NULL;
+
+	return FALSE;
+}
+
+
+/* Stops a running document check, the misspellings found so far stay marked.
+ * If doc is not NULL, the check is only cancelled if it is running on doc. */
+void sc_speller_cancel_check(GeanyDocument *doc)
+{
+	CheckJob *job = sc_check_job;
+
+	if (job == NULL || (doc != NULL && job->doc != doc))
+		return;
+
+	g_atomic_int_set(&job->cancelled, TRUE);
+	g_source_remove(job->source_id);
+	ui_set_statusbar(FALSE, _("Spell checking of \"%s\" was cancelled."),
+		DOC_FILENAME(job->doc));
+	check_job_free(job);
+	sc_check_job = NULL;
+
+	ui_progress_bar_stop();
 }
 
 
 void sc_speller_check_document(GeanyDocument *doc)
 {
-	gchar *line;
-	gint i;
+	ScintillaObject *sci;
+	CheckJob *job;
 	gint first_line, last_line;
+	gint start_pos, end_pos;
 	gchar *dict_string = NULL;
-	gint suggestions_found = 0;
+	SpellDict *sd;
 
-	g_return_if_fail(sc_speller_dict != NULL);
 	g_return_if_fail(doc != NULL);
 
+	sci = doc->editor->sci;
+
+	sc_speller_cancel_check(NULL);
+
+	sd = get_doc_dict(doc);
+	if (sd == NULL)
+		return;
+
 	ui_progress_bar_start(_("Checking"));
 
-	enchant_dict_describe(sc_speller_dict, dict_describe, &dict_string);
+	enchant_dict_describe(sd->dict, dict_describe, &dict_string);
 
-	if (sci_has_selection(doc->editor->sci))
+	if (sci_has_selection(sci))
 	{
-		first_line = sci_get_line_from_position(
-			doc->editor->sci, sci_get_selection_start(doc->editor->sci));
-		last_line = sci_get_line_from_position(
-			doc->editor->sci, sci_get_selection_end(doc->editor->sci));
+		first_line = sci_get_line_from_position(sci, sci_get_selection_start(sci));
+		last_line = sci_get_line_from_position(sci, sci_get_selection_end(sci));
 
 		if (sc_info->use_msgwin)
 			msgwin_msg_add(COLOR_BLUE, -1, NULL,
@@ -270,7 +879,7 @@ void sc_speller_check_document(GeanyDocument *doc)
 	else
 	{
 		first_line = 0;
-		last_line = sci_get_line_count(doc->editor->sci);
+		last_line = sci_get_line_count(sci);
 		if (sc_info->use_msgwin)
 			msgwin_msg_add(COLOR_BLUE, -1, NULL, _("Checking file \"%s\" (using %s):"),
 				DOC_FILENAME(doc), dict_string);
@@ -280,28 +889,31 @@ void sc_speller_check_document(GeanyDocument *doc)
 
 	if (first_line == last_line)
 	{
-		line = sci_get_selection_contents(doc->editor->sci);
-		suggestions_found += sc_speller_process_line(doc, first_line, line);
-		g_free(line);
+		start_pos = sci_get_selection_start(sci);
+		end_pos = sci_get_selection_end(sci);
 	}
 	else
 	{
-		for (i = first_line; i < last_line; i++)
-		{
-			line = sci_get_line(doc->editor->sci, i);
-
-			suggestions_found += sc_speller_process_line(doc, i, line);
-
-			/* process other GTK events to keep the GUI being responsive */
-			while (g_main_context_iteration(NULL, FALSE));
-
-			g_free(line);
-		}
+		start_pos = sci_get_position_from_line(sci, first_line);
+		end_pos = sci_get_position_from_line(sci, last_line);
 	}
-	if (suggestions_found == 0 && sc_info->use_msgwin)
-		msgwin_msg_add(COLOR_BLUE, -1, NULL, _("The checked text is spelled correctly."));
 
-	ui_progress_bar_stop();
+	job = g_new0(CheckJob, 1);
+	job->doc = doc;
+	job->sd = sd;
+	dict_ref(sd);
+	job->start_pos = start_pos;
+	job->len = end_pos - start_pos;
+	job->lexer = scintilla_send_message(sci, SCI_GETLEXER, 0, 0);
+	job->use_msgwin = sc_info->use_msgwin;
+	job->line_number = first_line;
+	job->lock = g_mutex_new();
+	job->results = g_ptr_array_new();
+	gp_sci_get_styled_text(sci, start_pos, end_pos, &job->text, &job->styles);
+
+	job->thread = g_thread_create(check_job_thread, job, TRUE, NULL);
+	job->source_id = plugin_timeout_add(geany_plugin, 100, check_job_update, job);
+	sc_check_job = job;
 }
 
 
@@ -414,66 +1026,264 @@ static void create_dicts_array(void)
 }
 
 
-void sc_speller_dict_free_string_list(gchar **tmp_suggs)
+void sc_speller_add_word(GeanyDocument *doc, const gchar *word)
 {
-	g_return_if_fail(sc_speller_dict != NULL);
+	SpellDict *sd = get_doc_dict(doc);
 
-	enchant_dict_free_string_list(sc_speller_dict, tmp_suggs);
+	g_return_if_fail(sd != NULL);
+	g_return_if_fail(word != NULL);
+
+	g_mutex_lock(sc_speller_lock);
+	enchant_dict_add_to_pwl(sd->dict, word, -1);
+	cache_clear(&sd->cache);
+	g_mutex_unlock(sc_speller_lock);
 }
 
+gboolean sc_speller_dict_check(GeanyDocument *doc, const gchar *word)
+{
+	SpellDict *sd = get_doc_dict(doc);
+	gint result;
+
+	g_return_val_if_fail(sd != NULL, FALSE);
+	g_return_val_if_fail(word != NULL, FALSE);
+
+	g_mutex_lock(sc_speller_lock);
+	result = cache_dict_check(sd, word);
+	g_mutex_unlock(sc_speller_lock);
 
-void sc_speller_add_word(const gchar *word)
+	return result;
+}
+
+
+/* Suggestions are looked up for the editor menu in a separate thread, one word at a time.
+ * The word requested while a lookup runs waits in pending, replacing any older request. */
+typedef struct
 {
-	g_return_if_fail(sc_speller_dict != NULL);
-	g_return_if_fail(word != NULL);
+	gchar *word;
+	gchar **suggs;		/* NULL-terminated, set by the thread */
+	SpellDict *sd;		/* in use until the job is freed */
+	SpellSuggestFunc func;
+	gpointer data;
+
+	GThread *thread;
+	guint source_id;
+} SuggestJob;
 
-	enchant_dict_add_to_pwl(sc_speller_dict, word, -1);
+static SuggestJob *sc_suggest_job = NULL;
+static SuggestJob *sc_suggest_pending = NULL;
+
+/* a dictionary's suggestions cache is dropped when it grows beyond this number of words */
+#define SC_SUGGEST_CACHE_MAX_WORDS 1000
+
+
+static void suggest_job_start(SuggestJob *job);
+
+
+static void suggest_job_free(SuggestJob *job)
+{
+	if (job->thread != NULL)
+		g_thread_join(job->thread);
+	if (job->source_id != 0)
+		g_source_remove(job->source_id);
+	g_strfreev(job->suggs);
+	g_free(job->word);
+	dict_unref(job->sd);
+	g_free(job);
 }
 
-gboolean sc_speller_dict_check(const gchar *word)
+
+static void suggest_cache_insert(SpellDict *sd, const gchar *word, gchar **suggs)
 {
-	g_return_val_if_fail(sc_speller_dict != NULL, FALSE);
-	g_return_val_if_fail(word != NULL, FALSE);
+	if (sd->suggest_cache == NULL)
+		sd->suggest_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify) g_strfreev);
+	else if (g_hash_table_size(sd->suggest_cache) >= SC_SUGGEST_CACHE_MAX_WORDS)
+		g_hash_table_remove_all(sd->suggest_cache);
+
+	g_hash_table_insert(sd->suggest_cache, g_strdup(word), suggs);
+}
+
 
-	return enchant_dict_check(sc_speller_dict, word, -1);
+static gboolean suggest_job_done(gpointer data)
+{
+	SuggestJob *job = data;
+
+	/* the thread sets source_id after adding this callback */
+	if (job->thread != NULL)
+		g_thread_join(job->thread);
+	job->thread = NULL;
+	job->source_id = 0;
+	suggest_cache_insert(job->sd, job->word, g_strdupv(job->suggs));
+	sc_suggest_job = NULL;
+
+	/* a newer request is about to be answered, this one is stale */
+	if (sc_suggest_pending == NULL)
+		job->func(job->word, job->suggs, job->data);
+	suggest_job_free(job);
+
+	if (sc_suggest_pending != NULL)
+	{
+		job = sc_suggest_pending;
+		sc_suggest_pending = NULL;
+		suggest_job_start(job);
+	}
+	return FALSE;
 }
 
 
-gchar **sc_speller_dict_suggest(const gchar *word, gsize *n_suggs)
+static gpointer suggest_job_thread(gpointer data)
 {
-	g_return_val_if_fail(sc_speller_dict != NULL, NULL);
+	SuggestJob *job = data;
+	gchar **suggs;
+	gsize n_suggs = 0, i;
+
+	g_mutex_lock(sc_speller_lock);
+	suggs = enchant_dict_suggest(job->sd->dict, job->word, -1, &n_suggs);
+	job->suggs = g_new(gchar *, n_suggs + 1);
+	for (i = 0; i < n_suggs; i++)
+		job->suggs[i] = g_strdup(suggs[i]);
+	job->suggs[n_suggs] = NULL;
+	if (suggs != NULL)
+		enchant_dict_free_string_list(job->sd->dict, suggs);
+	g_mutex_unlock(sc_speller_lock);
+
+	job->source_id = g_idle_add(suggest_job_done, job);
+	return NULL;
+}
+
+
+static void suggest_job_start(SuggestJob *job)
+{
+	sc_suggest_job = job;
+	job->thread = g_thread_create(suggest_job_thread, job, TRUE, NULL);
+	if (job->thread == NULL)
+	{
+		/* look the word up right here rather than not at all */
+		suggest_job_thread(job);
+	}
+}
+
+
+/* Waits for a running lookup and drops the pending one, without calling their functions */
+static void suggest_job_cancel(void)
+{
+	if (sc_suggest_pending != NULL)
+	{
+		suggest_job_free(sc_suggest_pending);
+		sc_suggest_pending = NULL;
+	}
+	if (sc_suggest_job != NULL)
+	{
+		suggest_job_free(sc_suggest_job);
+		sc_suggest_job = NULL;
+	}
+}
+
+
+/* Returns a copy of the suggestions for word in the language of doc if they were already
+ * looked up, or NULL */
+gchar **sc_speller_get_cached_suggestions(GeanyDocument *doc, const gchar *word)
+{
+	SpellDict *sd = get_doc_dict(doc);
+	gchar **suggs;
+
 	g_return_val_if_fail(word != NULL, NULL);
 
-	return enchant_dict_suggest(sc_speller_dict, word, -1, n_suggs);
+	if (sd == NULL || sd->suggest_cache == NULL)
+		return NULL;
+
+	suggs = g_hash_table_lookup(sd->suggest_cache, word);
+	return suggs != NULL ? g_strdupv(suggs) : NULL;
 }
 
 
-void sc_speller_add_word_to_session(const gchar *word)
+/* Looks the suggestions for word in the language of doc up in a separate thread and calls
+ * func with them from the main loop.  func is not called if another word is requested
+ * meanwhile, nor if the dictionaries are reloaded. */
+void sc_speller_suggest_async(GeanyDocument *doc, const gchar *word, SpellSuggestFunc func,
+							  gpointer data)
 {
-	g_return_if_fail(sc_speller_dict != NULL);
+	SpellDict *sd = get_doc_dict(doc);
+	SuggestJob *job;
+
+	g_return_if_fail(sd != NULL);
+	g_return_if_fail(word != NULL && func != NULL);
+
+	job = g_new0(SuggestJob, 1);
+	job->word = g_strdup(word);
+	job->sd = sd;
+	dict_ref(sd);
+	job->func = func;
+	job->data = data;
+
+	if (sc_suggest_job != NULL)
+	{
+		if (sc_suggest_pending != NULL)
+			suggest_job_free(sc_suggest_pending);
+		sc_suggest_pending = job;
+	}
+	else
+		suggest_job_start(job);
+}
+
+
+void sc_speller_add_word_to_session(GeanyDocument *doc, const gchar *word)
+{
+	SpellDict *sd = get_doc_dict(doc);
+
+	g_return_if_fail(sd != NULL);
 	g_return_if_fail(word != NULL);
 
-	enchant_dict_add_to_session(sc_speller_dict, word, -1);
+	g_mutex_lock(sc_speller_lock);
+	enchant_dict_add_to_session(sd->dict, word, -1);
+	cache_clear(&sd->cache);
+	g_mutex_unlock(sc_speller_lock);
 }
 
 
-void sc_speller_store_replacement(const gchar *old_word, const gchar *new_word)
+void sc_speller_store_replacement(GeanyDocument *doc, const gchar *old_word,
+								  const gchar *new_word)
 {
-	g_return_if_fail(sc_speller_dict != NULL);
+	SpellDict *sd = get_doc_dict(doc);
+
+	g_return_if_fail(sd != NULL);
 	g_return_if_fail(old_word != NULL);
 	g_return_if_fail(new_word != NULL);
 
-	enchant_dict_store_replacement(sc_speller_dict, old_word, -1, new_word, -1);
+	g_mutex_lock(sc_speller_lock);
+	enchant_dict_store_replacement(sd->dict, old_word, -1, new_word, -1);
+	g_mutex_unlock(sc_speller_lock);
+
+	/* enchant suggests the stored replacement first from now on */
+	if (sd->suggest_cache != NULL && g_hash_table_lookup(sd->suggest_cache, old_word) != NULL)
+	{
+		gchar **suggs = g_hash_table_lookup(sd->suggest_cache, old_word);
+		guint len = g_strv_length(suggs);
+		gchar **new_suggs = g_new(gchar *, len + 2);
+		guint i, n = 0;
+
+		new_suggs[n++] = g_strdup(new_word);
+		for (i = 0; i < len; i++)
+		{
+			if (! utils_str_equal(suggs[i], new_word))
+				new_suggs[n++] = g_strdup(suggs[i]);
+		}
+		new_suggs[n] = NULL;
+		g_hash_table_insert(sd->suggest_cache, g_strdup(old_word), new_suggs);
+	}
 }
 
 
+/* Reloads the list of dictionaries and drops the loaded ones, e.g. after the dictionary
+ * directory changed. Documents keep their language if it is still available. */
 void sc_speller_reinit_enchant_dict(void)
 {
 	const gchar *lang = sc_info->default_language;
 
-	/* Release a previous dict object */
-	if (sc_speller_dict != NULL)
-		enchant_broker_free_dict(sc_speller_broker, sc_speller_dict);
+	/* a running check or lookup uses a dictionary */
+	sc_speller_cancel_check(NULL);
+	suggest_job_cancel();
+	pool_clear();
 
 #if HAVE_ENCHANT_1_5
 	{
@@ -508,13 +1318,10 @@ void sc_speller_reinit_enchant_dict(void)
 		else
 			g_warning("Stored language ('%s') could not be loaded.", sc_info->default_language);
 	}
+	setptr(sc_speller_lang, g_strdup(lang));
 
-	/* Request new dict object */
-	if (! EMPTY(lang))
-		sc_speller_dict = enchant_broker_request_dict(sc_speller_broker, lang);
-	else
-		sc_speller_dict = NULL;
-	if (sc_speller_dict == NULL)
+	/* Load the default dictionary right away */
+	if (pool_get(sc_speller_lang) == NULL)
 	{
 		broker_init_failed();
 		gtk_widget_set_sensitive(sc_info->menu_item, FALSE);
@@ -528,7 +1335,10 @@ void sc_speller_reinit_enchant_dict(void)
 
 void sc_speller_init(void)
 {
+	sc_speller_lock = g_mutex_new();
 	sc_speller_broker = enchant_broker_init();
+	sc_speller_pool = g_hash_table_new(g_str_hash, g_str_equal);
+	sc_speller_pool_lru = g_queue_new();
 
 	sc_speller_reinit_enchant_dict();
 }
@@ -536,10 +1346,21 @@ void sc_speller_init(void)
 
 void sc_speller_free(void)
 {
+	guint i;
+
+	sc_speller_cancel_check(NULL);
+	suggest_job_cancel();
 	sc_speller_dicts_free();
-	if (sc_speller_dict != NULL)
-		enchant_broker_free_dict(sc_speller_broker, sc_speller_dict);
+	pool_clear();
+	g_hash_table_destroy(sc_speller_pool);
+	sc_speller_pool = NULL;
+	g_queue_free(sc_speller_pool_lru);
+	sc_speller_pool_lru = NULL;
+	setptr(sc_speller_lang, NULL);
+	foreach_document(i)
+		g_object_set_data(G_OBJECT(documents[i]->editor->sci), DOC_LANG_KEY, NULL);
 	enchant_broker_free(sc_speller_broker);
+	g_mutex_free(sc_speller_lock);
 }
 
 
@@ -556,6 +1377,18 @@ gboolean sc_speller_is_text(GeanyDocument *doc, gint pos)
 		return TRUE;
 
 	lexer = scintilla_send_message(doc->editor->sci, SCI_GETLEXER, 0, 0);
+	return is_text_style(lexer, style);
+}
+
+
+/* Returns whether style contains text which should be checked for lexer. This doesn't
+ * access the document and so can be used from the check thread. */
+static gboolean is_text_style(gint lexer, gint style)
+{
+	/* early out for the default style */
+	if (style == STYLE_DEFAULT)
+		return TRUE;
+
 	switch (lexer)
 	{
 		case SCLEX_ABAQUS:
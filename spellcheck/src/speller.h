@@ -29,25 +29,37 @@
 
 gint sc_speller_process_line(GeanyDocument *doc, gint line_number, const gchar *line);
 
+gint sc_speller_process_range(GeanyDocument *doc, gint start_pos, gint end_pos);
+
 void sc_speller_check_document(GeanyDocument *doc);
 
+void sc_speller_cancel_check(GeanyDocument *doc);
+
 void sc_speller_reinit_enchant_dict(void);
 
 gchar *sc_speller_get_default_lang(void);
 
-void sc_speller_dict_free_string_list(gchar **tmp_suggs);
+const gchar *sc_speller_get_doc_lang(GeanyDocument *doc);
+
+gboolean sc_speller_set_doc_lang(GeanyDocument *doc, const gchar *lang);
+
+void sc_speller_add_word(GeanyDocument *doc, const gchar *word);
+
+gboolean sc_speller_dict_check(GeanyDocument *doc, const gchar *word);
 
-void sc_speller_add_word(const gchar *word);
+typedef void (*SpellSuggestFunc)(const gchar *word, gchar **suggs, gpointer data);
 
-gboolean sc_speller_dict_check(const gchar *word);
+gchar **sc_speller_get_cached_suggestions(GeanyDocument *doc, const gchar *word);
 
-gchar **sc_speller_dict_suggest(const gchar *word, gsize *n_suggs);
+void sc_speller_suggest_async(GeanyDocument *doc, const gchar *word, SpellSuggestFunc func,
+							  gpointer data);
 
 gboolean sc_speller_is_text(GeanyDocument *doc, gint pos);
 
-void sc_speller_add_word_to_session(const gchar *word);
+void sc_speller_add_word_to_session(GeanyDocument *doc, const gchar *word);
 
-void sc_speller_store_replacement(const gchar *old_word, const gchar *new_word);
+void sc_speller_store_replacement(GeanyDocument *doc, const gchar *old_word,
+								  const gchar *new_word);
 
 void sc_speller_init(void);
 
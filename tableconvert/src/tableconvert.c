@@ -23,6 +23,7 @@
 #endif
 
 #include "geanyplugin.h"
+#include <string.h>
 
 GeanyPlugin     *geany_plugin;
 GeanyData       *geany_data;
@@ -105,71 +106,145 @@ TableConvertRule tablerules[] = {
 
 static GtkWidget *main_menu_item = NULL;
 
-static gchar* convert_to_table_worker(gchar **rows, gboolean header, 
-	const TableConvertRule *rule)
+/* Appends @str to @out, returns the new end of @out */
+static gchar* append_str(gchar *out, const gchar *str, gsize len)
 {
-	guint i;
-	guint j;
-	GString *replacement_str = NULL;
+	memcpy(out, str, len);
+	return out + len;
+}
 
-	g_return_val_if_fail(rows != NULL, NULL);
+/* Converts the @len bytes of @text, rows separated by line breaks and
+ * columns by tabs, into a table.  The output is sized from the number
+ * of rows and columns before being written, in a single allocation. */
+static gchar* convert_to_table_worker(const gchar *text, gsize len,
+	gboolean header, const TableConvertRule *rule)
+{
+	gsize n_rows = 1;
+	gsize n_columnsplits = 0;
+	gsize n_separators = 0;
+	gsize size;
+	gsize i;
+	gsize row;
+	gchar *replacement;
+	gchar *out;
+
+	gsize start_len = strlen(rule->start);
+	gsize header_start_len = strlen(rule->header_start);
+	gsize header_stop_len = strlen(rule->header_stop);
+	gsize body_start_len = strlen(rule->body_start);
+	gsize body_end_len = strlen(rule->body_end);
+	gsize columnsplit_len = strlen(rule->columnsplit);
+	gsize linestart_len = strlen(rule->linestart);
+	gsize lineend_len = strlen(rule->lineend);
+	gsize linesplit_len = strlen(rule->linesplit);
+	gsize end_len = strlen(rule->end);
+
+	g_return_val_if_fail(text != NULL, NULL);
+
+	/* Counting rows and columns to know the size of the table */
+	for (i = 0; i < len; i++)
+	{
+		switch (text[i])
+		{
+			case '\r':
+				if (i + 1 < len && text[i + 1] == '\n')
+				{
+					i++;
+					n_separators++;
+				}
+				/* fall through */
+			case '\n':
+				n_rows++;
+				n_separators++;
+				break;
+			case '\t':
+				n_columnsplits++;
+				n_separators++;
+				break;
+		}
+	}
+
+	size = start_len + end_len +
+		(len - n_separators) +
+		n_columnsplits * columnsplit_len +
+		n_rows * (linestart_len + lineend_len) +
+		(n_rows - 1) * linesplit_len;
+	if (header == TRUE)
+	{
+		size += header_start_len + body_end_len;
+		if (n_rows > 1)
+		{
+			size += header_stop_len + body_start_len;
+		}
+	}
+
+	replacement = g_malloc(size + 1);
 
 	/* Adding start of table to replacement */
-	replacement_str = g_string_new(rule->start);
+	out = append_str(replacement, rule->start, start_len);
 
 	/* Adding special header if requested
 	 * e.g. <thead> */
 	if (header == TRUE)
 	{
-		g_string_append(replacement_str, rule->header_start);
+		out = append_str(out, rule->header_start, header_start_len);
 	}
 
 	/* Iteration onto rows and building up lines of table for
 	 * replacement */
-	for (i = 0; rows[i] != NULL; i++)
+	i = 0;
+	for (row = 0; row < n_rows; row++)
 	{
-		gchar **columns = NULL;
-		columns = g_strsplit_set(rows[i], "\t", -1);
-
-		if (i == 1 &&
+		if (row == 1 &&
 			header == TRUE)
 		{
-			g_string_append(replacement_str, rule->header_stop);
-			/* We are assuming, that if someone inserts a head, 
-			 * only in this case we will insert some special body. 
+			out = append_str(out, rule->header_stop, header_stop_len);
+			/* We are assuming, that if someone inserts a head,
+			 * only in this case we will insert some special body.
 			 * Might needs to be discussed further */
-			g_string_append(replacement_str, rule->body_start);
+			out = append_str(out, rule->body_start, body_start_len);
 		}
 
-		g_string_append(replacement_str, rule->linestart);
+		out = append_str(out, rule->linestart, linestart_len);
 
-		for (j = 0; columns[j] != NULL; j++)
+		for (; i < len && text[i] != '\r' && text[i] != '\n'; i++)
 		{
-			if (j > 0)
+			if (text[i] == '\t')
+			{
+				out = append_str(out, rule->columnsplit, columnsplit_len);
+			}
+			else
 			{
-				g_string_append(replacement_str, rule->columnsplit);
+				*out++ = text[i];
 			}
-			g_string_append(replacement_str, columns[j]);
 		}
 
-		g_string_append(replacement_str, rule->lineend);
+		out = append_str(out, rule->lineend, lineend_len);
 
-		if (rows[i+1] != NULL)
+		if (i < len)
 		{
-			g_string_append(replacement_str, rule->linesplit);
+			/* Skipping the line break */
+			if (text[i] == '\r' && i + 1 < len && text[i + 1] == '\n')
+			{
+				i++;
+			}
+			i++;
+			out = append_str(out, rule->linesplit, linesplit_len);
 		}
-		g_strfreev(columns);
 	}
 
 	if (header == TRUE)
 	{
-		g_string_append(replacement_str, rule->body_end);
+		out = append_str(out, rule->body_end, body_end_len);
 	}
-	
+
 	/* Adding the footer of table */
-	g_string_append(replacement_str, rule->end);
+	out = append_str(out, rule->end, end_len);
+	*out = '\0';
 
-	return g_string_free(replacement_str, FALSE);
+	g_warn_if_fail((gsize) (out - replacement) == size);
+
+	return replacement;
 }
 
 static void convert_to_table(gboolean header)
@@ -181,70 +256,66 @@ static void convert_to_table(gboolean header)
 
 	if (sci_has_selection(doc->editor->sci))
 	{
-		gchar *selection = NULL;
-		gchar **rows = NULL;
+		ScintillaObject *sci = doc->editor->sci;
+		const TableConvertRule *rule = NULL;
 		gchar *replacement = NULL;
 
-		/* Actually grabbing selection and splitting it into single
-		 * lines we will work on later */
-		selection = sci_get_selection_contents(doc->editor->sci);
-		rows = g_strsplit_set(selection, "\r\n", -1);
-		g_free(selection);
+		switch (doc->file_type->id)
+		{
+			case GEANY_FILETYPES_HTML:
+			case GEANY_FILETYPES_MARKDOWN:
+			{
+				rule = &tablerules[TC_HTML];
+				break;
+			}
+			case GEANY_FILETYPES_LATEX:
+			{
+				rule = &tablerules[TC_LATEX];
+				break;
+			}
+			case GEANY_FILETYPES_SQL:
+			{
+				rule = &tablerules[TC_SQL];
+				break;
+			}
+			default:
+			{
+				/* We just don't do anything */
+				return;
+			}
+		} /* filetype switch */
 
-		/* Checking whether we do have something we can work on - Returning if not */
-		if (rows != NULL)
+		if (sci_get_selection_mode(sci) == SC_SEL_STREAM)
 		{
-			switch (doc->file_type->id)
+			/* Working directly on the document buffer, and replacing
+			 * the selection in one go */
+			gint start = sci_get_selection_start(sci);
+			gint end = sci_get_selection_end(sci);
+			const gchar *text = (const gchar *) scintilla_send_message(sci,
+				SCI_GETCHARACTERPOINTER, 0, 0);
+
+			replacement = convert_to_table_worker(text + start,
+				(gsize) (end - start), header, rule);
+			if (replacement != NULL)
 			{
-				case GEANY_FILETYPES_NONE:
-				{
-					g_strfreev(rows);
-					return;
-				}
-				case GEANY_FILETYPES_HTML:
-				case GEANY_FILETYPES_MARKDOWN:
-				{
-					replacement = convert_to_table_worker(rows,
-						header,
-						&tablerules[TC_HTML]);
-					break;
-				}
-				case GEANY_FILETYPES_LATEX:
-				{
-					replacement = convert_to_table_worker(rows,
-						header,
-						&tablerules[TC_LATEX]);
-					break;
-				}
-				case GEANY_FILETYPES_SQL:
-				{
-					replacement = convert_to_table_worker(rows,
-						header,
-						&tablerules[TC_SQL]);
-					break;
-				}
-				default:
-				{
-					/* We just don't do anything */
-				}
-			} /* filetype switch */
+				sci_set_target_start(sci, start);
+				sci_set_target_end(sci, end);
+				sci_replace_target(sci, replacement, FALSE);
+			}
 		}
 		else
 		{
-			/* OK. Something went not as expected.
-			 * We did have a selection but cannot parse it into rows.
-			 * Aborting */
-			g_warning(_("Something went wrong on parsing selection. Aborting"));
-			return;
-		}
+			/* Rectangular selections can't be a target, copying them */
+			gchar *selection = sci_get_selection_contents(sci);
 
-		/* The replacement should have been prepared at this point. Let's go
-		 * on and put it into document and replace selection with it. */
-		if (replacement != NULL)
-		{
-			sci_replace_sel(doc->editor->sci, replacement);
+			replacement = convert_to_table_worker(selection,
+				strlen(selection), header, rule);
+			g_free(selection);
+			if (replacement != NULL)
+			{
+				sci_replace_sel(sci, replacement);
+			}
 		}
-		g_strfreev(rows);
 		g_free(replacement);
 	}
 	   /* in case of there was no selection we are just doing nothing */
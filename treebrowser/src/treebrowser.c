@@ -18,6 +18,8 @@
 
 #include "geany.h"
 #include "geanyplugin.h"
+#include "vcstatus.h"
+#include "startprof.h"
 
 #ifdef HAVE_GIO
 # include <gio/gio.h>
@@ -43,9 +45,50 @@ static gchar 				*addressbar_last_address 	= NULL;
 
 static GtkTreeIter 			bookmarks_iter;
 static gboolean 			bookmarks_expanded = FALSE;
+/* the paths of the bookmarks, read again only when their file changes */
+static GSList 				*bookmarks_paths 			= NULL;
+static gboolean 			bookmarks_found 			= FALSE;
+static gboolean 			bookmarks_changed 			= TRUE;
+#ifdef HAVE_GIO
+static GFileMonitor 		*bookmarks_monitor 			= NULL;
+#endif
 
 static GtkTreeViewColumn 	*treeview_column_text;
-static GtkCellRenderer 		*render_icon, *render_text;
+static GtkCellRenderer 		*render_icon, *render_text, *render_badge;
+static gulong 				vc_status_subscription 		= 0;
+#if GTK_CHECK_VERSION(2, 20, 0)
+static GtkCellRenderer 		*render_spinner;
+#endif
+
+#ifdef HAVE_GIO
+static GSList 				*browse_jobs 				= NULL;
+static GSList 				*dir_watches 				= NULL;
+# if GTK_CHECK_VERSION(2, 20, 0)
+static guint 				browse_pulse_id 			= 0;
+static guint 				browse_pulse 				= 0;
+# endif
+#endif
+
+/* Icons rendered so far, by stock id and by content type. They are shared by all the
+ * rows and dropped when the icon theme changes. */
+static GHashTable 			*icon_cache_stock 			= NULL;
+static GHashTable 			*icon_cache_ctype 			= NULL;
+
+/* The filter entry compiled, again when its text changes: the "*.ext" patterns by their
+ * suffix, the others as pattern specs. */
+static GHashTable 			*filter_suffixes 			= NULL;
+static GSList 				*filter_patterns 			= NULL;
+static gboolean 			filter_reverse 				= FALSE;
+static gboolean 			filter_empty 				= TRUE;
+static gboolean 			filter_compiled 			= FALSE;
+
+/* The rows of the directories listed below the root, by path, so that tracking the
+ * current document needs no walk down from the root. */
+static GHashTable 			*dir_rows 					= NULL;
+
+/* row to select once its directory got listed, and whether to rename it then */
+static gchar 				*reveal_uri 				= NULL;
+static gboolean 			reveal_rename 				= FALSE;
 
 /* ------------------
  * FLAGS
@@ -95,7 +138,9 @@ enum
 	TREEBROWSER_RENDER_ICON 							= 0,
 	TREEBROWSER_RENDER_TEXT 							= 1,
 
-	TREEBROWSER_FLAGS_SEPARATOR 						= -1
+	TREEBROWSER_FLAGS_SEPARATOR 						= -1,
+	TREEBROWSER_FLAGS_LOADING 							= -2,
+	TREEBROWSER_FLAGS_EMPTY 							= -3
 };
 
 
@@ -152,6 +197,7 @@ static void 	project_change_cb(G_GNUC_UNUSED GObject *obj, G_GNUC_UNUSED GKeyFil
 static void 	treebrowser_browse(gchar *directory, gpointer parent);
 static void 	treebrowser_bookmarks_set_state(void);
 static void 	treebrowser_load_bookmarks(void);
+static void 	treebrowser_reveal_check(void);
 static void 	gtk_tree_store_iter_clear_nodes(gpointer iter, gboolean delete_root);
 static void 	treebrowser_rename_current(void);
 static void 	on_menu_create_new_object(GtkMenuItem *menuitem, const gchar *type);
@@ -188,51 +234,99 @@ tree_view_row_expanded_iter(GtkTreeView *tree_view, GtkTreeIter *iter)
 	return expanded;
 }
 
+static void
+icon_cache_value_free(gpointer data)
+{
+	if (data)
+		g_object_unref(data);
+}
+
+/* Returns: whether key is cached, icon is set to a new reference of the cached icon. */
+static gboolean
+icon_cache_lookup(GHashTable *cache, const gchar *key, GdkPixbuf **icon)
+{
+	gpointer value;
+
+	if (cache == NULL || ! g_hash_table_lookup_extended(cache, key, NULL, &value))
+		return FALSE;
+
+	*icon = value ? g_object_ref(value) : NULL;
+	return TRUE;
+}
+
+/* icon may be NULL, remembering that there is none */
+static void
+icon_cache_insert(GHashTable **cache, const gchar *key, GdkPixbuf *icon)
+{
+	if (*cache == NULL)
+		*cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, icon_cache_value_free);
+
+	g_hash_table_insert(*cache, g_strdup(key), icon ? g_object_ref(icon) : NULL);
+}
+
+static void
+icon_cache_clear(void)
+{
+	if (icon_cache_stock)
+		g_hash_table_remove_all(icon_cache_stock);
+	if (icon_cache_ctype)
+		g_hash_table_remove_all(icon_cache_ctype);
+}
+
 static GdkPixbuf *
 utils_pixbuf_from_stock(const gchar *stock_id)
 {
-	GtkIconSet *icon_set;
+	GtkIconSet 	*icon_set;
+	GdkPixbuf 	*ret = NULL;
+
+	if (icon_cache_lookup(icon_cache_stock, stock_id, &ret))
+		return ret;
 
 	icon_set = gtk_icon_factory_lookup_default(stock_id);
 
 	if (icon_set)
-		return gtk_icon_set_render_icon(icon_set, gtk_widget_get_default_style(),
+		ret = gtk_icon_set_render_icon(icon_set, gtk_widget_get_default_style(),
 										gtk_widget_get_default_direction(),
 										GTK_STATE_NORMAL, GTK_ICON_SIZE_MENU, NULL, NULL);
-	return NULL;
+
+	icon_cache_insert(&icon_cache_stock, stock_id, ret);
+	return ret;
 }
 
+#ifdef HAVE_GIO
 static GdkPixbuf *
-utils_pixbuf_from_path(gchar *path)
+utils_pixbuf_from_content_type(const gchar *ctype)
 {
-#if defined(HAVE_GIO) && GTK_CHECK_VERSION(2, 14, 0)
+#if GTK_CHECK_VERSION(2, 14, 0)
 	GIcon 		*icon;
 	GdkPixbuf 	*ret = NULL;
 	GtkIconInfo *info;
-	gchar 		*ctype;
 	gint 		width;
 
-	ctype = g_content_type_guess(path, NULL, 0, NULL);
+	if (icon_cache_lookup(icon_cache_ctype, ctype, &ret))
+		return ret;
+
 	icon = g_content_type_get_icon(ctype);
-	g_free(ctype);
 
 	if (icon != NULL)
 	{
 		gtk_icon_size_lookup(GTK_ICON_SIZE_MENU, &width, NULL);
 		info = gtk_icon_theme_lookup_by_gicon(gtk_icon_theme_get_default(), icon, width, GTK_ICON_LOOKUP_USE_BUILTIN);
 		g_object_unref(icon);
-		if (!info)
-			return NULL;
-		ret = gtk_icon_info_load_icon (info, NULL);
-		gtk_icon_info_free(info);
+		if (info)
+		{
+			ret = gtk_icon_info_load_icon (info, NULL);
+			gtk_icon_info_free(info);
+		}
 	}
+
+	icon_cache_insert(&icon_cache_ctype, ctype, ret);
 	return ret;
 #else
-	return utils_pixbuf_from_stock(g_file_test(path, G_FILE_TEST_IS_DIR)
-									? GTK_STOCK_DIRECTORY
-									: GTK_STOCK_FILE);
+	return utils_pixbuf_from_stock(GTK_STOCK_FILE);
 #endif
 }
+#endif
 
 
 /* result must be freed */
@@ -272,17 +366,77 @@ path_is_in_dir(gchar* src, gchar* find)
 	return diffed_path;
 }
 
+static void
+filter_clear(void)
+{
+	if (filter_suffixes)
+		g_hash_table_destroy(filter_suffixes);
+	filter_suffixes = NULL;
+	g_slist_foreach(filter_patterns, (GFunc) g_pattern_spec_free, NULL);
+	g_slist_free(filter_patterns);
+	filter_patterns = NULL;
+	filter_compiled = FALSE;
+}
+
+static void
+filter_compile(void)
+{
+	gchar		**filters;
+	guint 		i;
+
+	filter_clear();
+	filter_suffixes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	filter_compiled = TRUE;
+
+	filter_empty = EMPTY(gtk_entry_get_text(GTK_ENTRY(filter)));
+	if (filter_empty)
+		return;
+
+	filters = g_strsplit(gtk_entry_get_text(GTK_ENTRY(filter)), ";", 0);
+
+	if (utils_str_equal(filters[0], "!") == TRUE)
+	{
+		filter_reverse = TRUE;
+		i = 1;
+	}
+	else
+	{
+		filter_reverse = FALSE;
+		i = 0;
+	}
+
+	for (; filters[i]; i++)
+	{
+		const gchar *pattern = filters[i];
+
+		/* an empty pattern only matches an empty name */
+		if (*pattern == '\0')
+			continue;
+		if (pattern[0] == '*' && pattern[1] == '.' && strpbrk(pattern + 1, "*?") == NULL)
+			g_hash_table_insert(filter_suffixes, g_strdup(pattern + 1), GINT_TO_POINTER(1));
+		else
+			filter_patterns = g_slist_prepend(filter_patterns, g_pattern_spec_new(pattern));
+	}
+	filter_patterns = g_slist_reverse(filter_patterns);
+	g_strfreev(filters);
+}
+
+static void
+on_filter_changed(GtkEditable *editable, gpointer user_data)
+{
+	filter_compiled = FALSE;
+}
+
 /* Return: FALSE - if file is filtered and not shown, and TRUE - if file isn`t filtered, and have to be shown */
 static gboolean
 check_filtered(const gchar *base_name)
 {
-	gchar		**filters;
 	guint 		i;
-	gboolean 	temporary_reverse 	= FALSE;
 	const gchar *exts[] 			= {".o", ".obj", ".so", ".dll", ".a", ".lib", ".la", ".lo", ".pyc"};
 	guint exts_len;
 	const gchar *ext;
-	gboolean	filtered;
+	gboolean	matched = FALSE;
+	guint 		length;
 
 	if (CONFIG_HIDE_OBJECT_FILES)
 	{
@@ -295,33 +449,33 @@ check_filtered(const gchar *base_name)
 		}
 	}
 
-	if (EMPTY(gtk_entry_get_text(GTK_ENTRY(filter))))
+	if (! filter_compiled)
+		filter_compile();
+	if (filter_empty)
 		return TRUE;
 
-	filters = g_strsplit(gtk_entry_get_text(GTK_ENTRY(filter)), ";", 0);
+	if (utils_str_equal(base_name, "*"))
+		matched = TRUE;
 
-	if (utils_str_equal(filters[0], "!") == TRUE)
-	{
-		temporary_reverse = TRUE;
-		i = 1;
-	}
-	else
-		i = 0;
+	/* "*.ext" matches the suffix from any dot */
+	for (ext = strchr(base_name, '.'); ext && ! matched; ext = strchr(ext + 1, '.'))
+		matched = g_hash_table_lookup(filter_suffixes, ext) != NULL;
 
-	filtered = CONFIG_REVERSE_FILTER || temporary_reverse ? TRUE : FALSE;
-	for (; filters[i]; i++)
+	if (! matched && filter_patterns)
 	{
-		if (utils_str_equal(base_name, "*") || g_pattern_match_simple(filters[i], base_name))
-		{
-			filtered = CONFIG_REVERSE_FILTER || temporary_reverse ? FALSE : TRUE;
-			break;
-		}
+		GSList *node;
+
+		length = strlen(base_name);
+		for (node = filter_patterns; node && ! matched; node = node->next)
+			matched = g_pattern_match(node->data, length, base_name, NULL);
 	}
-	g_strfreev(filters);
 
-	return filtered;
+	if (CONFIG_REVERSE_FILTER || filter_reverse)
+		return ! matched;
+	return matched;
 }
 
+#ifndef HAVE_GIO
 #ifdef G_OS_WIN32
 static gboolean
 win32_check_hidden(const gchar *filename)
@@ -341,8 +495,15 @@ static gboolean
 check_hidden(const gchar *filename)
 {
 	gsize len;
-	const gchar *base_name = NULL;
-	base_name = g_path_get_basename(filename);
+	const gchar *base_name = filename;
+	const gchar *p;
+
+	/* the base name is the end of filename, without a separator */
+	for (p = filename; *p; p++)
+	{
+		if (G_IS_DIR_SEPARATOR(*p))
+			base_name = p + 1;
+	}
 
 	if (EMPTY(base_name))
 		return FALSE;
@@ -364,6 +525,7 @@ check_hidden(const gchar *filename)
 
 	return FALSE;
 }
+#endif
 
 static gchar*
 get_default_dir(void)
@@ -411,64 +573,817 @@ get_terminal(void)
 	return terminal;
 }
 
-static gboolean
-treebrowser_checkdir(gchar *directory)
+static gboolean
+treebrowser_checkdir(gchar *directory)
+{
+	gboolean is_dir;
+	static const GdkColor red 	= {0, 0xffff, 0x6666, 0x6666};
+	static const GdkColor white = {0, 0xffff, 0xffff, 0xffff};
+	static gboolean old_value = TRUE;
+
+	is_dir = g_file_test(directory, G_FILE_TEST_IS_DIR);
+
+	if (old_value != is_dir)
+	{
+		gtk_widget_modify_base(GTK_WIDGET(addressbar), GTK_STATE_NORMAL, is_dir ? NULL : &red);
+		gtk_widget_modify_text(GTK_WIDGET(addressbar), GTK_STATE_NORMAL, is_dir ? NULL : &white);
+		old_value = is_dir;
+	}
+
+	if (!is_dir)
+	{
+		if (CONFIG_SHOW_BARS == 0)
+			dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("%s: no such directory."), directory);
+
+		return FALSE;
+	}
+
+	return is_dir;
+}
+
+static void
+treebrowser_chroot(const gchar *dir)
+{
+	gchar *directory;
+
+	if (g_str_has_suffix(dir, G_DIR_SEPARATOR_S))
+		directory = g_strndup(dir, strlen(dir)-1);
+	else
+		directory = g_strdup(dir);
+
+	gtk_entry_set_text(GTK_ENTRY(addressbar), directory);
+
+	if (!directory || strlen(directory) == 0)
+		setptr(directory, g_strdup(G_DIR_SEPARATOR_S));
+
+	if (! treebrowser_checkdir(directory))
+	{
+		g_free(directory);
+		return;
+	}
+
+	treebrowser_bookmarks_set_state();
+
+	gtk_tree_store_clear(treestore);
+	treebrowser_dir_rows_clear();
+	setptr(addressbar_last_address, directory);
+
+	treebrowser_browse(addressbar_last_address, NULL);
+	gp_vc_status_refresh(addressbar_last_address);
+	treebrowser_load_bookmarks();
+}
+
+/* The rows are sorted like utils_get_file_list() does, directories first. */
+static gint
+treebrowser_browse_compare_row(GtkTreeIter *iter, gboolean is_dir, const gchar *name)
+{
+	gchar 		*row_name, *row_uri;
+	gint 		flag, ret;
+	gboolean 	row_is_dir;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(treestore), iter,
+						TREEBROWSER_COLUMN_NAME, 	&row_name,
+						TREEBROWSER_COLUMN_URI, 	&row_uri,
+						TREEBROWSER_COLUMN_FLAG, 	&flag,
+						-1);
+
+	/* the placeholder stays last, the bookmarks first */
+	if (flag == TREEBROWSER_FLAGS_LOADING)
+		ret = 1;
+	else if (row_uri == NULL)
+		ret = -1;
+	else
+	{
+		/* only directories have children */
+		row_is_dir = gtk_tree_model_iter_has_child(GTK_TREE_MODEL(treestore), iter);
+		if (row_is_dir != is_dir)
+			ret = row_is_dir ? -1 : 1;
+		else
+			ret = utils_str_casecmp(row_name, name);
+	}
+
+	g_free(row_name);
+	g_free(row_uri);
+	return ret;
+}
+
+static gboolean
+treebrowser_row_has_name(GtkTreeIter *iter, const gchar *name)
+{
+	gchar 		*row_name;
+	gboolean 	ret;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(treestore), iter, TREEBROWSER_COLUMN_NAME, &row_name, -1);
+	ret = utils_str_equal(row_name, name);
+	g_free(row_name);
+
+	return ret;
+}
+
+/* Binary search for the position of a row for name below parent. Returns: whether there
+ * is a row at that position, then set in iter. */
+static gboolean
+treebrowser_row_lookup(GtkTreeIter *parent, gboolean is_dir, const gchar *name, GtkTreeIter *iter)
+{
+	gint low = 0, high, mid;
+
+	high = gtk_tree_model_iter_n_children(GTK_TREE_MODEL(treestore), parent);
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(treestore), iter, parent, mid);
+		if (treebrowser_browse_compare_row(iter, is_dir, name) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(treestore), iter, parent, low);
+}
+
+/* Returns: whether a row named name is below parent, then set in iter. */
+static gboolean
+treebrowser_row_find(GtkTreeIter *parent, gboolean is_dir, const gchar *name, GtkTreeIter *iter)
+{
+	gboolean valid;
+
+	/* names only differing by case sort the same */
+	valid = treebrowser_row_lookup(parent, is_dir, name, iter);
+	while (valid && treebrowser_browse_compare_row(iter, is_dir, name) == 0)
+	{
+		if (treebrowser_row_has_name(iter, name))
+			return TRUE;
+		valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(treestore), iter);
+	}
+	return FALSE;
+}
+
+static void
+treebrowser_dir_rows_clear(void)
+{
+	if (dir_rows)
+		g_hash_table_remove_all(dir_rows);
+}
+
+/* Remembers the row of directory, which gets listed below it. The bookmarks are left
+ * out, tracking only goes below the root. */
+static void
+treebrowser_dir_rows_add(const gchar *directory, GtkTreeIter *parent)
+{
+	GtkTreePath *path;
+
+	if (gtk_tree_store_iter_is_valid(treestore, &bookmarks_iter) &&
+		(parent == &bookmarks_iter || gtk_tree_store_is_ancestor(treestore, &bookmarks_iter, parent)))
+		return;
+
+	if (dir_rows == NULL)
+		dir_rows = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+										(GDestroyNotify) gtk_tree_row_reference_free);
+
+	path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), parent);
+	g_hash_table_insert(dir_rows, g_strdup(directory),
+						gtk_tree_row_reference_new(GTK_TREE_MODEL(treestore), path));
+	gtk_tree_path_free(path);
+}
+
+/* Returns: whether the row of directory is known and still shows it, then set in iter. */
+static gboolean
+treebrowser_dir_rows_lookup(const gchar *directory, GtkTreeIter *iter)
+{
+	GtkTreeRowReference *row;
+	GtkTreePath 		*path;
+	gchar 				*uri = NULL;
+
+	row = dir_rows ? g_hash_table_lookup(dir_rows, directory) : NULL;
+	if (row == NULL)
+		return FALSE;
+
+	path = gtk_tree_row_reference_get_path(row);
+	if (path != NULL && gtk_tree_model_get_iter(GTK_TREE_MODEL(treestore), iter, path))
+		gtk_tree_model_get(GTK_TREE_MODEL(treestore), iter, TREEBROWSER_COLUMN_URI, &uri, -1);
+	if (path != NULL)
+		gtk_tree_path_free(path);
+
+	/* the row went away, or is another one since a rename */
+	if (! utils_str_equal(uri, directory))
+	{
+		g_hash_table_remove(dir_rows, directory);
+		g_free(uri);
+		return FALSE;
+	}
+	g_free(uri);
+	return TRUE;
+}
+
+#ifdef HAVE_GIO
+
+/* Entries read from the enumerator at once, each batch gets its rows in a single pass. */
+#define BROWSE_BATCH_SIZE 			200
+
+#define BROWSE_ATTRIBUTES 			G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+									G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+									G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+									G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP
+#ifdef G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE
+# define BROWSE_ICON_ATTRIBUTES 	BROWSE_ATTRIBUTES "," G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE
+#else
+# define BROWSE_ICON_ATTRIBUTES 	BROWSE_ATTRIBUTES
+#endif
+
+typedef struct
+{
+	GCancellable 			*cancellable;
+	GFileEnumerator 		*enumerator;
+	/* the "Loading..." placeholder, the last child of the browsed row */
+	GtkTreeRowReference 	*loading;
+	gchar 					*directory;
+} BrowseJob;
+
+typedef struct
+{
+	GFileMonitor 			*monitor;
+	/* the directory row, NULL for the root */
+	GtkTreeRowReference 	*row;
+	gchar 					*directory;
+} DirWatch;
+
+static void
+treebrowser_browse_job_free(BrowseJob *job)
+{
+	if (job->enumerator)
+		g_object_unref(job->enumerator);
+	g_object_unref(job->cancellable);
+	gtk_tree_row_reference_free(job->loading);
+	g_free(job->directory);
+	g_free(job);
+}
+
+#if GTK_CHECK_VERSION(2, 20, 0)
+static gboolean
+treebrowser_browse_pulse_cb(gpointer data)
+{
+	GSList 		*node;
+	GtkTreePath *path;
+	GtkTreeIter iter;
+
+	if (browse_jobs == NULL)
+	{
+		browse_pulse_id = 0;
+		return FALSE;
+	}
+
+	browse_pulse++;
+	for (node = browse_jobs; node != NULL; node = node->next)
+	{
+		BrowseJob *job = node->data;
+
+		path = gtk_tree_row_reference_get_path(job->loading);
+		if (path == NULL)
+			continue;
+		if (gtk_tree_model_get_iter(GTK_TREE_MODEL(treestore), &iter, path))
+			gtk_tree_model_row_changed(GTK_TREE_MODEL(treestore), path, &iter);
+		gtk_tree_path_free(path);
+	}
+	return TRUE;
+}
+#endif
+
+/* Cancels the listings below parent, or all of them if parent is NULL. The jobs are
+ * freed by their pending callback. */
+static void
+treebrowser_browse_cancel(GtkTreeIter *parent)
+{
+	GSList 		*node, *next;
+	GtkTreePath *parent_path = NULL, *path;
+
+	if (parent)
+		parent_path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), parent);
+
+	for (node = browse_jobs; node != NULL; node = next)
+	{
+		BrowseJob *job = node->data;
+		gboolean below;
+
+		next = node->next;
+		path = gtk_tree_row_reference_get_path(job->loading);
+		below = path == NULL || parent_path == NULL || gtk_tree_path_is_descendant(path, parent_path);
+		if (path)
+			gtk_tree_path_free(path);
+
+		if (below)
+		{
+			g_cancellable_cancel(job->cancellable);
+			browse_jobs = g_slist_delete_link(browse_jobs, node);
+		}
+	}
+
+	if (parent_path)
+		gtk_tree_path_free(parent_path);
+}
+
+/* Returns TRUE and frees job when it was cancelled or its rows went away meanwhile. */
+static gboolean
+treebrowser_browse_job_stopped(BrowseJob *job)
+{
+	if (g_cancellable_is_cancelled(job->cancellable))
+	{
+		treebrowser_browse_job_free(job);
+		return TRUE;
+	}
+	if (! gtk_tree_row_reference_valid(job->loading))
+	{
+		browse_jobs = g_slist_remove(browse_jobs, job);
+		treebrowser_browse_job_free(job);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+treebrowser_browse_finish(BrowseJob *job)
+{
+	GtkTreePath *path;
+	GtkTreeIter iter, iter_prev;
+	gboolean 	has_rows = FALSE;
+
+	path = gtk_tree_row_reference_get_path(job->loading);
+	gtk_tree_model_get_iter(GTK_TREE_MODEL(treestore), &iter, path);
+
+	/* the listed rows, if any, come right before the placeholder */
+	if (gtk_tree_path_prev(path) && gtk_tree_model_get_iter(GTK_TREE_MODEL(treestore), &iter_prev, path))
+	{
+		gchar *uri;
+
+		gtk_tree_model_get(GTK_TREE_MODEL(treestore), &iter_prev, TREEBROWSER_COLUMN_URI, &uri, -1);
+		has_rows = uri != NULL;
+		g_free(uri);
+	}
+	gtk_tree_path_free(path);
+
+	if (has_rows)
+		gtk_tree_store_remove(treestore, &iter);
+	else
+		gtk_tree_store_set(treestore, &iter,
+						TREEBROWSER_COLUMN_NAME, 	_("(Empty)"),
+						TREEBROWSER_COLUMN_FLAG, 	TREEBROWSER_FLAGS_EMPTY,
+						-1);
+
+	browse_jobs = g_slist_remove(browse_jobs, job);
+	treebrowser_browse_job_free(job);
+
+	treebrowser_reveal_check();
+}
+
+static gint
+treebrowser_browse_compare_infos(gconstpointer a, gconstpointer b)
+{
+	GFileInfo *info_a = *((GFileInfo **) a);
+	GFileInfo *info_b = *((GFileInfo **) b);
+	gboolean dir_a = g_file_info_get_file_type(info_a) == G_FILE_TYPE_DIRECTORY;
+	gboolean dir_b = g_file_info_get_file_type(info_b) == G_FILE_TYPE_DIRECTORY;
+
+	if (dir_a != dir_b)
+		return dir_a ? -1 : 1;
+	return utils_str_casecmp(g_file_info_get_name(info_a), g_file_info_get_name(info_b));
+}
+
+/* Returns: whether the entry gets a row, as check_hidden() and check_filtered() decide. */
+static gboolean
+treebrowser_info_is_shown(GFileInfo *info)
+{
+	gchar 		*utf8_name;
+	gboolean 	shown;
+
+	if (! CONFIG_SHOW_HIDDEN_FILES &&
+		(g_file_info_get_is_hidden(info) || g_file_info_get_is_backup(info)))
+		return FALSE;
+
+	if (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY)
+		return TRUE;
+
+	/* in a UTF-8 locale the conversion would only copy the name */
+	if (g_get_charset(NULL))
+		return check_filtered(g_file_info_get_name(info));
+
+	utf8_name = utils_get_utf8_from_locale(g_file_info_get_name(info));
+	shown = check_filtered(utf8_name);
+	g_free(utf8_name);
+
+	return shown;
+}
+
+/* Adds the row for info below parent, before sibling or last if sibling is NULL. */
+static void
+treebrowser_insert_info(GtkTreeIter *parent, GtkTreeIter *sibling, const gchar *directory, GFileInfo *info)
+{
+	GtkTreeIter 	iter, iter_empty;
+	const gchar 	*fname 	= g_file_info_get_name(info);
+	gboolean 		is_dir 	= g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY;
+	GdkPixbuf 		*icon 	= NULL;
+	gchar 			*uri;
+
+	uri = g_strconcat(directory, fname, NULL);
+	if (is_dir)
+		icon = CONFIG_SHOW_ICONS ? utils_pixbuf_from_stock(GTK_STOCK_DIRECTORY) : NULL;
+	else if (CONFIG_SHOW_ICONS == 2)
+	{
+		const gchar *ctype = NULL;
+		gchar *guessed = NULL;
+
+#ifdef G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE
+		ctype = g_file_info_get_attribute_string(info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE);
+#endif
+		if (ctype == NULL)
+			ctype = guessed = g_content_type_guess(fname, NULL, 0, NULL);
+		icon = utils_pixbuf_from_content_type(ctype);
+		g_free(guessed);
+	}
+	else if (CONFIG_SHOW_ICONS)
+		icon = utils_pixbuf_from_stock(GTK_STOCK_FILE);
+
+	gtk_tree_store_insert_before(treestore, &iter, parent, sibling);
+	gtk_tree_store_set(treestore, &iter,
+						TREEBROWSER_COLUMN_ICON, 	icon,
+						TREEBROWSER_COLUMN_NAME, 	fname,
+						TREEBROWSER_COLUMN_URI, 	uri,
+						-1);
+	if (is_dir)
+	{
+		gtk_tree_store_prepend(treestore, &iter_empty, &iter);
+		gtk_tree_store_set(treestore, &iter_empty,
+						TREEBROWSER_COLUMN_ICON, 	NULL,
+						TREEBROWSER_COLUMN_NAME, 	_("(Empty)"),
+						TREEBROWSER_COLUMN_URI, 	NULL,
+						TREEBROWSER_COLUMN_FLAG, 	TREEBROWSER_FLAGS_EMPTY,
+						-1);
+	}
+
+	if (icon)
+		g_object_unref(icon);
+	g_free(uri);
+}
+
+static void
+treebrowser_browse_add_files(BrowseJob *job, GList *files)
+{
+	GtkTreeIter 	iter_next, iter_loading, iter_parent;
+	GtkTreeIter 	*parent;
+	GtkTreePath 	*path;
+	GPtrArray 		*infos;
+	GList 			*node;
+	guint 			i;
+
+	infos = g_ptr_array_new();
+	for (node = files; node != NULL; node = node->next)
+	{
+		if (treebrowser_info_is_shown(node->data))
+			g_ptr_array_add(infos, node->data);
+	}
+	g_ptr_array_sort(infos, treebrowser_browse_compare_infos);
+
+	path = gtk_tree_row_reference_get_path(job->loading);
+	gtk_tree_model_get_iter(GTK_TREE_MODEL(treestore), &iter_loading, path);
+	gtk_tree_path_free(path);
+	parent = gtk_tree_model_iter_parent(GTK_TREE_MODEL(treestore), &iter_parent, &iter_loading)
+				? &iter_parent : NULL;
+
+	/* merge the batch into the rows listed so far, walking them once */
+	gtk_tree_model_iter_children(GTK_TREE_MODEL(treestore), &iter_next, parent);
+	for (i = 0; i < infos->len; i++)
+	{
+		GFileInfo 	*info 	= g_ptr_array_index(infos, i);
+		const gchar *fname 	= g_file_info_get_name(info);
+		gboolean 	is_dir 	= g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY;
+		gint 		cmp;
+
+		while ((cmp = treebrowser_browse_compare_row(&iter_next, is_dir, fname)) < 0)
+			gtk_tree_model_iter_next(GTK_TREE_MODEL(treestore), &iter_next);
+
+		/* the directory watch may have added it already */
+		if (cmp == 0 && treebrowser_row_has_name(&iter_next, fname))
+			continue;
+
+		treebrowser_insert_info(parent, &iter_next, job->directory, info);
+	}
+
+	g_ptr_array_free(infos, TRUE);
+}
+
+static void
+treebrowser_browse_next_files_cb(GObject *source, GAsyncResult *result, gpointer data)
+{
+	BrowseJob 	*job = data;
+	GList 		*files;
+
+	files = g_file_enumerator_next_files_finish(G_FILE_ENUMERATOR(source), result, NULL);
+
+	if (! treebrowser_browse_job_stopped(job))
+	{
+		if (files == NULL)
+			treebrowser_browse_finish(job);
+		else
+		{
+			treebrowser_browse_add_files(job, files);
+			g_file_enumerator_next_files_async(job->enumerator, BROWSE_BATCH_SIZE, G_PRIORITY_LOW,
+				job->cancellable, treebrowser_browse_next_files_cb, job);
+		}
+	}
+
+	g_list_foreach(files, (GFunc) g_object_unref, NULL);
+	g_list_free(files);
+}
+
+static void
+treebrowser_browse_enumerate_cb(GObject *source, GAsyncResult *result, gpointer data)
+{
+	BrowseJob 	*job = data;
+
+	job->enumerator = g_file_enumerate_children_finish(G_FILE(source), result, NULL);
+
+	if (treebrowser_browse_job_stopped(job))
+		return;
+
+	/* an unreadable directory shows up as empty */
+	if (job->enumerator == NULL)
+		treebrowser_browse_finish(job);
+	else
+		g_file_enumerator_next_files_async(job->enumerator, BROWSE_BATCH_SIZE, G_PRIORITY_LOW,
+			job->cancellable, treebrowser_browse_next_files_cb, job);
+}
+
+static void
+on_dir_watch_changed(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event,
+					gpointer data);
+
+static void
+treebrowser_watch_free(DirWatch *watch)
+{
+	g_signal_handlers_disconnect_by_func(watch->monitor, on_dir_watch_changed, watch);
+	g_file_monitor_cancel(watch->monitor);
+	g_object_unref(watch->monitor);
+	if (watch->row)
+		gtk_tree_row_reference_free(watch->row);
+	g_free(watch->directory);
+	g_free(watch);
+}
+
+/* Stops watching parent and the directories below it, or all of them if parent is NULL. */
+static void
+treebrowser_watch_stop(GtkTreeIter *parent)
+{
+	GSList 		*node, *next;
+	GtkTreePath *parent_path = NULL, *path;
+
+	if (parent)
+		parent_path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), parent);
+
+	for (node = dir_watches; node != NULL; node = next)
+	{
+		DirWatch *watch = node->data;
+		gboolean below;
+
+		next = node->next;
+		if (watch->row == NULL)
+			below = parent_path == NULL;
+		else
+		{
+			/* the rows of the others went away */
+			path = gtk_tree_row_reference_get_path(watch->row);
+			below = path == NULL || parent_path == NULL ||
+				gtk_tree_path_compare(path, parent_path) == 0 ||
+				gtk_tree_path_is_descendant(path, parent_path);
+			if (path)
+				gtk_tree_path_free(path);
+		}
+
+		if (below)
+		{
+			treebrowser_watch_free(watch);
+			dir_watches = g_slist_delete_link(dir_watches, node);
+		}
+	}
+
+	if (parent_path)
+		gtk_tree_path_free(parent_path);
+}
+
+static void
+treebrowser_watch_start(const gchar *directory, GtkTreeIter *parent)
+{
+	GFile 			*file;
+	GFileMonitor 	*monitor;
+	GtkTreePath 	*path;
+	DirWatch 		*watch;
+
+	file = g_file_new_for_path(directory);
+	monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, NULL);
+	g_object_unref(file);
+	if (monitor == NULL)
+		return;
+
+	watch 				= g_new0(DirWatch, 1);
+	watch->monitor 		= monitor;
+	watch->directory 	= g_strconcat(directory, G_DIR_SEPARATOR_S, NULL);
+	if (parent)
+	{
+		path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), parent);
+		watch->row = gtk_tree_row_reference_new(GTK_TREE_MODEL(treestore), path);
+		gtk_tree_path_free(path);
+	}
+	g_signal_connect(monitor, "changed", G_CALLBACK(on_dir_watch_changed), watch);
+	dir_watches = g_slist_prepend(dir_watches, watch);
+}
+
+static void
+treebrowser_watch_remove_empty(GtkTreeIter *parent)
+{
+	GtkTreeIter iter;
+	gboolean 	valid, is_entry;
+	gchar 		*uri;
+	gint 		flag;
+
+	/* the placeholder sorts before the entries */
+	valid = gtk_tree_model_iter_children(GTK_TREE_MODEL(treestore), &iter, parent);
+	while (valid)
+	{
+		gtk_tree_model_get(GTK_TREE_MODEL(treestore), &iter,
+							TREEBROWSER_COLUMN_URI, 	&uri,
+							TREEBROWSER_COLUMN_FLAG, 	&flag,
+							-1);
+		is_entry = uri != NULL;
+		g_free(uri);
+
+		if (is_entry || flag == TREEBROWSER_FLAGS_LOADING)
+			break;
+		if (flag == TREEBROWSER_FLAGS_EMPTY)
+		{
+			gtk_tree_store_remove(treestore, &iter);
+			break;
+		}
+		valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(treestore), &iter);
+	}
+}
+
+static void
+treebrowser_watch_add_row(DirWatch *watch, GtkTreeIter *parent, GFile *file)
+{
+	GFileInfo 	*info;
+	GtkTreeIter iter;
+	const gchar *fname;
+	gboolean 	is_dir;
+
+	info = g_file_query_info(file, CONFIG_SHOW_ICONS == 2 ? BROWSE_ICON_ATTRIBUTES : BROWSE_ATTRIBUTES,
+							G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	/* already gone again */
+	if (info == NULL)
+		return;
+
+	fname 	= g_file_info_get_name(info);
+	is_dir 	= g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY;
+	if (treebrowser_info_is_shown(info) && ! treebrowser_row_find(parent, is_dir, fname, &iter))
+	{
+		treebrowser_insert_info(parent,
+			treebrowser_row_lookup(parent, is_dir, fname, &iter) ? &iter : NULL,
+			watch->directory, info);
+		treebrowser_watch_remove_empty(parent);
+	}
+	g_object_unref(info);
+}
+
+static void
+treebrowser_watch_remove_row(GtkTreeIter *parent, GFile *file)
 {
-	gboolean is_dir;
-	static const GdkColor red 	= {0, 0xffff, 0x6666, 0x6666};
-	static const GdkColor white = {0, 0xffff, 0xffff, 0xffff};
-	static gboolean old_value = TRUE;
-
-	is_dir = g_file_test(directory, G_FILE_TEST_IS_DIR);
+	GtkTreeIter iter, iter_empty;
+	gchar 		*fname;
 
-	if (old_value != is_dir)
+	fname = g_file_get_basename(file);
+	/* the entry is gone, it may have been either kind */
+	if (treebrowser_row_find(parent, FALSE, fname, &iter) ||
+		treebrowser_row_find(parent, TRUE, fname, &iter))
 	{
-		gtk_widget_modify_base(GTK_WIDGET(addressbar), GTK_STATE_NORMAL, is_dir ? NULL : &red);
-		gtk_widget_modify_text(GTK_WIDGET(addressbar), GTK_STATE_NORMAL, is_dir ? NULL : &white);
-		old_value = is_dir;
+		gtk_tree_store_remove(treestore, &iter);
+		if (gtk_tree_model_iter_n_children(GTK_TREE_MODEL(treestore), parent) == 0)
+		{
+			gtk_tree_store_append(treestore, &iter_empty, parent);
+			gtk_tree_store_set(treestore, &iter_empty,
+							TREEBROWSER_COLUMN_ICON, 	NULL,
+							TREEBROWSER_COLUMN_NAME, 	_("(Empty)"),
+							TREEBROWSER_COLUMN_URI, 	NULL,
+							TREEBROWSER_COLUMN_FLAG, 	TREEBROWSER_FLAGS_EMPTY,
+							-1);
+		}
 	}
+	g_free(fname);
+}
 
-	if (!is_dir)
-	{
-		if (CONFIG_SHOW_BARS == 0)
-			dialogs_show_msgbox(GTK_MESSAGE_ERROR, _("%s: no such directory."), directory);
+/* Renames come as a deletion followed by a creation. */
+static void
+on_dir_watch_changed(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event,
+					gpointer data)
+{
+	DirWatch 	*watch = data;
+	GtkTreeIter iter_parent, *parent = NULL;
+	GtkTreePath *path;
 
-		return FALSE;
+	if (event != G_FILE_MONITOR_EVENT_CREATED && event != G_FILE_MONITOR_EVENT_DELETED)
+		return;
+
+	if (watch->row)
+	{
+		/* the row went away, the watch goes with the next treebrowser_watch_stop() */
+		path = gtk_tree_row_reference_get_path(watch->row);
+		if (path == NULL)
+			return;
+		gtk_tree_model_get_iter(GTK_TREE_MODEL(treestore), &iter_parent, path);
+		gtk_tree_path_free(path);
+		parent = &iter_parent;
 	}
 
-	return is_dir;
+	if (event == G_FILE_MONITOR_EVENT_CREATED)
+		treebrowser_watch_add_row(watch, parent, file);
+	else
+		treebrowser_watch_remove_row(parent, file);
 }
 
+/* Lists directory below parent in the background. The old rows are replaced by a
+ * placeholder right away and the entries come in by batches. */
 static void
-treebrowser_chroot(const gchar *dir)
+treebrowser_browse(gchar *directory, gpointer parent)
 {
-	gchar *directory;
+	GtkTreeIter 	iter, iter_loading;
+	GtkTreePath 	*path;
+	gboolean 		has_parent, expanded;
+	gint 			flag;
+	BrowseJob 		*job;
+	GFile 			*file;
 
-	if (g_str_has_suffix(dir, G_DIR_SEPARATOR_S))
-		directory = g_strndup(dir, strlen(dir)-1);
+	has_parent = parent ? gtk_tree_store_iter_is_valid(treestore, parent) : FALSE;
+	if (has_parent)
+	{
+		if (parent == &bookmarks_iter)
+			treebrowser_load_bookmarks();
+		treebrowser_dir_rows_add(directory, parent);
+	}
 	else
-		directory = g_strdup(dir);
+		parent = NULL;
 
-	gtk_entry_set_text(GTK_ENTRY(addressbar), directory);
+	/* at the root the bookmarks are rebuilt along with the other rows */
+	expanded = ! has_parent || tree_view_row_expanded_iter(GTK_TREE_VIEW(treeview), parent);
+	if (expanded)
+		treebrowser_bookmarks_set_state();
 
-	if (!directory || strlen(directory) == 0)
-		setptr(directory, g_strdup(G_DIR_SEPARATOR_S));
+	treebrowser_browse_cancel(parent);
+	treebrowser_watch_stop(parent);
+	/* collapsed rows are listed again when expanded */
+	if (expanded)
+		treebrowser_watch_start(directory, parent);
 
-	if (! treebrowser_checkdir(directory))
-	{
-		g_free(directory);
-		return;
-	}
+	/* the placeholder goes in before the old rows are removed, so that the parent
+	 * keeps a child and stays expanded */
+	gtk_tree_store_append(treestore, &iter_loading, parent);
+	gtk_tree_store_set(treestore, &iter_loading,
+						TREEBROWSER_COLUMN_ICON, 	NULL,
+						TREEBROWSER_COLUMN_NAME, 	_("Loading..."),
+						TREEBROWSER_COLUMN_URI, 	NULL,
+						TREEBROWSER_COLUMN_FLAG, 	TREEBROWSER_FLAGS_LOADING,
+						-1);
 
-	treebrowser_bookmarks_set_state();
+	/* the bookmarks and their separator stay first, they are only rebuilt when their
+	 * file changes */
+	if (! has_parent && CONFIG_SHOW_BOOKMARKS && gtk_tree_store_iter_is_valid(treestore, &bookmarks_iter))
+		gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(treestore), &iter, NULL, 2);
+	else
+		gtk_tree_model_iter_children(GTK_TREE_MODEL(treestore), &iter, parent);
+	do
+		gtk_tree_model_get(GTK_TREE_MODEL(treestore), &iter, TREEBROWSER_COLUMN_FLAG, &flag, -1);
+	while (flag != TREEBROWSER_FLAGS_LOADING && gtk_tree_store_remove(treestore, &iter));
 
-	gtk_tree_store_clear(treestore);
-	setptr(addressbar_last_address, directory);
+	if (! has_parent)
+		treebrowser_load_bookmarks();
 
-	treebrowser_browse(addressbar_last_address, NULL);
-	treebrowser_load_bookmarks();
+	job 				= g_new0(BrowseJob, 1);
+	job->cancellable 	= g_cancellable_new();
+	job->directory 		= g_strconcat(directory, G_DIR_SEPARATOR_S, NULL);
+	path 				= gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), &iter_loading);
+	job->loading 		= gtk_tree_row_reference_new(GTK_TREE_MODEL(treestore), path);
+	gtk_tree_path_free(path);
+	browse_jobs 		= g_slist_prepend(browse_jobs, job);
+
+#if GTK_CHECK_VERSION(2, 20, 0)
+	if (browse_pulse_id == 0)
+		browse_pulse_id = plugin_timeout_add(geany_plugin, 100, treebrowser_browse_pulse_cb, NULL);
+#endif
+
+	file = g_file_new_for_path(directory);
+	g_file_enumerate_children_async(file,
+		CONFIG_SHOW_ICONS == 2 ? BROWSE_ICON_ATTRIBUTES : BROWSE_ATTRIBUTES,
+		G_FILE_QUERY_INFO_NONE, G_PRIORITY_LOW, job->cancellable,
+		treebrowser_browse_enumerate_cb, job);
+	g_object_unref(file);
 }
 
+#else
+
 static void
 treebrowser_browse(gchar *directory, gpointer parent)
 {
@@ -481,17 +1396,18 @@ treebrowser_browse(gchar *directory, gpointer parent)
 	gchar 			*fname;
 	gchar 			*uri;
 
-	directory 		= g_strconcat(directory, G_DIR_SEPARATOR_S, NULL);
-
 	has_parent = parent ? gtk_tree_store_iter_is_valid(treestore, parent) : FALSE;
 	if (has_parent)
 	{
 		if (parent == &bookmarks_iter)
 			treebrowser_load_bookmarks();
+		treebrowser_dir_rows_add(directory, parent);
 	}
 	else
 		parent = NULL;
 
+	directory 		= g_strconcat(directory, G_DIR_SEPARATOR_S, NULL);
+
 	if (has_parent && tree_view_row_expanded_iter(GTK_TREE_VIEW(treeview), parent))
 	{
 		expanded = TRUE;
@@ -542,11 +1458,7 @@ treebrowser_browse(gchar *directory, gpointer parent)
 				{
 					if (check_filtered(utf8_name))
 					{
-						icon = CONFIG_SHOW_ICONS == 2
-									? utils_pixbuf_from_path(uri)
-									: CONFIG_SHOW_ICONS
-										? utils_pixbuf_from_stock(GTK_STOCK_FILE)
-										: NULL;
+						icon = CONFIG_SHOW_ICONS ? utils_pixbuf_from_stock(GTK_STOCK_FILE) : NULL;
 						gtk_tree_store_append(treestore, &iter, parent);
 						gtk_tree_store_set(treestore, &iter,
 										TREEBROWSER_COLUMN_ICON, 	icon,
@@ -585,6 +1497,7 @@ treebrowser_browse(gchar *directory, gpointer parent)
 	g_free(directory);
 
 }
+#endif
 
 static void
 treebrowser_bookmarks_set_state(void)
@@ -595,47 +1508,47 @@ treebrowser_bookmarks_set_state(void)
 		bookmarks_expanded = FALSE;
 }
 
+#ifdef HAVE_GIO
 static void
-treebrowser_load_bookmarks(void)
+on_bookmarks_file_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+					GFileMonitorEvent event, gpointer data)
+{
+	if (event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED || event == G_FILE_MONITOR_EVENT_PRE_UNMOUNT)
+		return;
+
+	bookmarks_changed = TRUE;
+	if (CONFIG_SHOW_BOOKMARKS && gtk_tree_store_iter_is_valid(treestore, &bookmarks_iter))
+		treebrowser_load_bookmarks();
+}
+#endif
+
+static void
+treebrowser_read_bookmarks(void)
 {
 	gchar 		*bookmarks;
 	gchar 		*contents, *path_full;
 	gchar 		**lines, **line;
-	GtkTreeIter iter;
 	gchar 		*pos;
-	GdkPixbuf 	*icon = NULL;
 
-	if (! CONFIG_SHOW_BOOKMARKS)
-		return;
+	g_slist_foreach(bookmarks_paths, (GFunc) g_free, NULL);
+	g_slist_free(bookmarks_paths);
+	bookmarks_paths = NULL;
 
 	bookmarks = g_build_filename(g_get_home_dir(), ".gtk-bookmarks", NULL);
-	if (g_file_get_contents(bookmarks, &contents, NULL, NULL))
+#ifdef HAVE_GIO
+	if (bookmarks_monitor == NULL)
 	{
-		if (gtk_tree_store_iter_is_valid(treestore, &bookmarks_iter))
-		{
-			bookmarks_expanded = tree_view_row_expanded_iter(GTK_TREE_VIEW(treeview), &bookmarks_iter);
-			gtk_tree_store_iter_clear_nodes(&bookmarks_iter, FALSE);
-		}
-		else
-		{
-			gtk_tree_store_prepend(treestore, &bookmarks_iter, NULL);
-			icon = CONFIG_SHOW_ICONS ? utils_pixbuf_from_stock(GTK_STOCK_HOME) : NULL;
-			gtk_tree_store_set(treestore, &bookmarks_iter,
-											TREEBROWSER_COLUMN_ICON, 	icon,
-											TREEBROWSER_COLUMN_NAME, 	_("Bookmarks"),
-											TREEBROWSER_COLUMN_URI, 	NULL,
-											-1);
-			if (icon)
-				g_object_unref(icon);
+		GFile *file = g_file_new_for_path(bookmarks);
 
-			gtk_tree_store_insert_after(treestore, &iter, NULL, &bookmarks_iter);
-			gtk_tree_store_set(treestore, &iter,
-											TREEBROWSER_COLUMN_ICON, 	NULL,
-											TREEBROWSER_COLUMN_NAME, 	NULL,
-											TREEBROWSER_COLUMN_URI, 	NULL,
-											TREEBROWSER_COLUMN_FLAG, 	TREEBROWSER_FLAGS_SEPARATOR,
-											-1);
-		}
+		bookmarks_monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL);
+		if (bookmarks_monitor)
+			g_signal_connect(bookmarks_monitor, "changed", G_CALLBACK(on_bookmarks_file_changed), NULL);
+		g_object_unref(file);
+	}
+#endif
+	bookmarks_found = g_file_get_contents(bookmarks, &contents, NULL, NULL);
+	if (bookmarks_found)
+	{
 		lines = g_strsplit (contents, "\n", 0);
 		for (line = lines; *line; ++line)
 		{
@@ -649,79 +1562,207 @@ treebrowser_load_bookmarks(void)
 			}
 			path_full = g_filename_from_uri(*line, NULL, NULL);
 			if (path_full != NULL)
-			{
-				if (g_file_test(path_full, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_DIR))
-				{
-					gchar *file_name = g_path_get_basename(path_full);
-
-					gtk_tree_store_append(treestore, &iter, &bookmarks_iter);
-					icon = CONFIG_SHOW_ICONS ? utils_pixbuf_from_stock(GTK_STOCK_DIRECTORY) : NULL;
-					gtk_tree_store_set(treestore, &iter,
-												TREEBROWSER_COLUMN_ICON, 	icon,
-												TREEBROWSER_COLUMN_NAME, 	file_name,
-												TREEBROWSER_COLUMN_URI, 	path_full,
-												-1);
-					g_free(file_name);
-					if (icon)
-						g_object_unref(icon);
-					gtk_tree_store_append(treestore, &iter, &iter);
-					gtk_tree_store_set(treestore, &iter,
-											TREEBROWSER_COLUMN_ICON, 	NULL,
-											TREEBROWSER_COLUMN_NAME, 	_("(Empty)"),
-											TREEBROWSER_COLUMN_URI, 	NULL,
-												-1);
-				}
-				g_free(path_full);
-			}
+				bookmarks_paths = g_slist_prepend(bookmarks_paths, path_full);
 		}
+		bookmarks_paths = g_slist_reverse(bookmarks_paths);
 		g_strfreev(lines);
 		g_free(contents);
-		if (bookmarks_expanded)
+	}
+	g_free(bookmarks);
+}
+
+static void
+treebrowser_load_bookmarks(void)
+{
+	GtkTreeIter iter;
+	GSList 		*node;
+	GdkPixbuf 	*icon = NULL;
+	gboolean 	has_node;
+
+	if (! CONFIG_SHOW_BOOKMARKS)
+		return;
+
+	has_node = gtk_tree_store_iter_is_valid(treestore, &bookmarks_iter);
+	if (has_node && ! bookmarks_changed)
+		return;
+
+	if (bookmarks_changed)
+		treebrowser_read_bookmarks();
+#ifdef HAVE_GIO
+	/* without a monitor, the file is read each time */
+	bookmarks_changed = bookmarks_monitor == NULL;
+#endif
+
+	if (! bookmarks_found)
+	{
+		if (has_node)
+		{
+			iter = bookmarks_iter;
+			if (gtk_tree_model_iter_next(GTK_TREE_MODEL(treestore), &iter))
+				gtk_tree_store_remove(treestore, &iter);
+			gtk_tree_store_remove(treestore, &bookmarks_iter);
+		}
+		return;
+	}
+
+	if (has_node)
+	{
+		bookmarks_expanded = tree_view_row_expanded_iter(GTK_TREE_VIEW(treeview), &bookmarks_iter);
+		gtk_tree_store_iter_clear_nodes(&bookmarks_iter, FALSE);
+	}
+	else
+	{
+		gtk_tree_store_prepend(treestore, &bookmarks_iter, NULL);
+		icon = CONFIG_SHOW_ICONS ? utils_pixbuf_from_stock(GTK_STOCK_HOME) : NULL;
+		gtk_tree_store_set(treestore, &bookmarks_iter,
+										TREEBROWSER_COLUMN_ICON, 	icon,
+										TREEBROWSER_COLUMN_NAME, 	_("Bookmarks"),
+										TREEBROWSER_COLUMN_URI, 	NULL,
+										-1);
+		if (icon)
+			g_object_unref(icon);
+
+		gtk_tree_store_insert_after(treestore, &iter, NULL, &bookmarks_iter);
+		gtk_tree_store_set(treestore, &iter,
+										TREEBROWSER_COLUMN_ICON, 	NULL,
+										TREEBROWSER_COLUMN_NAME, 	NULL,
+										TREEBROWSER_COLUMN_URI, 	NULL,
+										TREEBROWSER_COLUMN_FLAG, 	TREEBROWSER_FLAGS_SEPARATOR,
+										-1);
+	}
+	for (node = bookmarks_paths; node; node = node->next)
+	{
+		const gchar *path_full = node->data;
+
+		if (g_file_test(path_full, G_FILE_TEST_EXISTS | G_FILE_TEST_IS_DIR))
 		{
-			GtkTreePath *tree_path;
+			gchar *file_name = g_path_get_basename(path_full);
 
-			tree_path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), &bookmarks_iter);
-			gtk_tree_view_expand_row(GTK_TREE_VIEW(treeview), tree_path, FALSE);
-			gtk_tree_path_free(tree_path);
+			gtk_tree_store_append(treestore, &iter, &bookmarks_iter);
+			icon = CONFIG_SHOW_ICONS ? utils_pixbuf_from_stock(GTK_STOCK_DIRECTORY) : NULL;
+			gtk_tree_store_set(treestore, &iter,
+										TREEBROWSER_COLUMN_ICON, 	icon,
+										TREEBROWSER_COLUMN_NAME, 	file_name,
+										TREEBROWSER_COLUMN_URI, 	path_full,
+										-1);
+			g_free(file_name);
+			if (icon)
+				g_object_unref(icon);
+			gtk_tree_store_append(treestore, &iter, &iter);
+			gtk_tree_store_set(treestore, &iter,
+									TREEBROWSER_COLUMN_ICON, 	NULL,
+									TREEBROWSER_COLUMN_NAME, 	_("(Empty)"),
+									TREEBROWSER_COLUMN_URI, 	NULL,
+										-1);
 		}
 	}
-	g_free(bookmarks);
+	if (bookmarks_expanded)
+	{
+		GtkTreePath *tree_path;
+
+		tree_path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), &bookmarks_iter);
+		gtk_tree_view_expand_row(GTK_TREE_VIEW(treeview), tree_path, FALSE);
+		gtk_tree_path_free(tree_path);
+	}
 }
 
+/* Follows uri down the rows below the root directory, by a lookup at each level. Returns:
+ * whether its row was found, then set in iter. Otherwise in_tree tells whether iter is set
+ * to the deepest directory row on the way. */
 static gboolean
-treebrowser_search(gchar *uri, gpointer parent)
+treebrowser_locate(const gchar *uri, GtkTreeIter *iter, gboolean *in_tree)
 {
-	GtkTreeIter 	iter;
-	GtkTreePath 	*path;
-	gchar 			*uri_current;
+	GtkTreeIter parent_iter, *parent = NULL;
+	gchar 		*prefix, *dirname, *basename;
+	gchar 		**segments;
+	gboolean 	found = FALSE;
+	guint 		i, n;
+
+	*in_tree = FALSE;
+	if (addressbar_last_address == NULL)
+		return FALSE;
 
-	if (gtk_tree_model_iter_children(GTK_TREE_MODEL(treestore), &iter, parent))
+	/* most of the time the directory of uri is listed already */
+	dirname = g_path_get_dirname(uri);
+	if (treebrowser_dir_rows_lookup(dirname, &parent_iter))
 	{
-		do
-		{
-			if (gtk_tree_model_iter_has_child(GTK_TREE_MODEL(treestore), &iter))
-				if (treebrowser_search(uri, &iter))
-					return TRUE;
+		basename = g_path_get_basename(uri);
+		found = treebrowser_row_find(&parent_iter, FALSE, basename, iter) ||
+				treebrowser_row_find(&parent_iter, TRUE, basename, iter);
+		g_free(basename);
+	}
+	g_free(dirname);
+	if (found)
+		return TRUE;
 
-			gtk_tree_model_get(GTK_TREE_MODEL(treestore), &iter, TREEBROWSER_COLUMN_URI, &uri_current, -1);
+	if (g_str_has_suffix(addressbar_last_address, G_DIR_SEPARATOR_S))
+		prefix = g_strdup(addressbar_last_address);
+	else
+		prefix = g_strconcat(addressbar_last_address, G_DIR_SEPARATOR_S, NULL);
 
-			if (utils_str_equal(uri, uri_current) == TRUE)
-			{
-				path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), &iter);
-				gtk_tree_view_expand_to_path(GTK_TREE_VIEW(treeview), path);
-				gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(treeview), path, TREEBROWSER_COLUMN_ICON, FALSE, 0, 0);
-				gtk_tree_view_set_cursor(GTK_TREE_VIEW(treeview), path, treeview_column_text, FALSE);
-				gtk_tree_path_free(path);
-				g_free(uri_current);
-				return TRUE;
-			}
-			else
-				g_free(uri_current);
+	if (! g_str_has_prefix(uri, prefix))
+	{
+		g_free(prefix);
+		return FALSE;
+	}
+
+	segments = g_strsplit(uri + strlen(prefix), G_DIR_SEPARATOR_S, 0);
+	n = g_strv_length(segments);
+	for (i = 0; i < n; i++)
+	{
+		gboolean last = (i == n - 1);
+
+		if (EMPTY(segments[i]))
+			continue;
+
+		if (last ? (treebrowser_row_find(parent, FALSE, segments[i], iter) ||
+					treebrowser_row_find(parent, TRUE, segments[i], iter))
+				 : treebrowser_row_find(parent, TRUE, segments[i], iter))
+		{
+			parent_iter = *iter;
+			parent 		= &parent_iter;
+			found 		= last;
+		}
+		else
+			break;
+	}
 
-		} while (gtk_tree_model_iter_next(GTK_TREE_MODEL(treestore), &iter));
+	if (! found && parent != NULL)
+	{
+		*iter 		= parent_iter;
+		*in_tree 	= TRUE;
 	}
 
-	return FALSE;
+	g_strfreev(segments);
+	g_free(prefix);
+
+	return found;
+}
+
+static void
+treebrowser_select_iter(GtkTreeIter *iter)
+{
+	GtkTreePath *path;
+
+	path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), iter);
+	gtk_tree_view_expand_to_path(GTK_TREE_VIEW(treeview), path);
+	gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(treeview), path, TREEBROWSER_COLUMN_ICON, FALSE, 0, 0);
+	gtk_tree_view_set_cursor(GTK_TREE_VIEW(treeview), path, treeview_column_text, FALSE);
+	gtk_tree_path_free(path);
+}
+
+/* Returns: whether uri is listed, then its row is selected. */
+static gboolean
+treebrowser_search(const gchar *uri)
+{
+	GtkTreeIter iter;
+	gboolean 	in_tree;
+
+	if (! treebrowser_locate(uri, &iter, &in_tree))
+		return FALSE;
+
+	treebrowser_select_iter(&iter);
+	return TRUE;
 }
 
 static void
@@ -800,40 +1841,55 @@ gtk_tree_store_iter_clear_nodes(gpointer iter, gboolean delete_root)
 		gtk_tree_store_remove(GTK_TREE_STORE(treestore), iter);
 }
 
-static gboolean
-treebrowser_expand_to_path(gchar* root, gchar* find)
+/* Selects uri, after expanding the directories down to it. Directories are listed in
+ * the background, so this goes on as their rows come in. */
+static void
+treebrowser_reveal(const gchar *uri, gboolean rename)
 {
-	guint i = 0;
-	gboolean founded = FALSE, global_founded = FALSE;
-	gchar *new = NULL;
-	gchar **root_segments = NULL, **find_segments = NULL;
-	guint find_segments_n = 0;
-
-	root_segments = g_strsplit(root, G_DIR_SEPARATOR_S, 0);
-	find_segments = g_strsplit(find, G_DIR_SEPARATOR_S, 0);
+	setptr(reveal_uri, g_strdup(uri));
+	reveal_rename = rename;
+	treebrowser_reveal_check();
+}
 
-	find_segments_n = g_strv_length(find_segments)-1;
+static void
+treebrowser_reveal_check(void)
+{
+	GtkTreeIter 	iter;
+	GtkTreePath 	*path;
+	gboolean 		in_tree, expanded;
 
+	if (reveal_uri == NULL)
+		return;
 
-	for (i = 1; i<=find_segments_n; i++)
+	while (! treebrowser_locate(reveal_uri, &iter, &in_tree))
 	{
-		new = g_strconcat(new ? new : "", G_DIR_SEPARATOR_S, find_segments[i], NULL);
+		/* expanding the deepest directory listed on the way lists the next level */
+		expanded = FALSE;
+		if (in_tree && ! tree_view_row_expanded_iter(GTK_TREE_VIEW(treeview), &iter))
+		{
+			path = gtk_tree_model_get_path(GTK_TREE_MODEL(treestore), &iter);
+			gtk_tree_view_expand_to_path(GTK_TREE_VIEW(treeview), path);
+			expanded = gtk_tree_view_row_expanded(GTK_TREE_VIEW(treeview), path);
+			gtk_tree_path_free(path);
+		}
 
-		if (founded)
+#ifdef HAVE_GIO
+		/* wait for the listings to come in */
+		if (browse_jobs != NULL)
+			return;
+#endif
+		if (! expanded)
 		{
-			if (treebrowser_search(new, NULL))
-				global_founded = TRUE;
+			setptr(reveal_uri, NULL);
+			return;
 		}
-		else
-			if (utils_str_equal(root, new) == TRUE)
-				founded = TRUE;
 	}
 
-	g_free(new);
-	g_strfreev(root_segments);
-	g_strfreev(find_segments);
+	treebrowser_select_iter(&iter);
+	if (reveal_rename)
+		treebrowser_rename_current();
 
-	return global_founded;
+	setptr(reveal_uri, NULL);
 }
 
 static gboolean
@@ -852,7 +1908,7 @@ treebrowser_track_current(void)
 		/*
 		 * Checking if the document is in the expanded or collapsed files
 		 */
-		if (! treebrowser_search(path_current, NULL))
+		if (! treebrowser_search(path_current))
 		{
 			/*
 			 * Else we have to chroting to the document`s nearles path
@@ -866,7 +1922,7 @@ treebrowser_track_current(void)
 			if (utils_str_equal(froot, addressbar_last_address) != TRUE)
 				treebrowser_chroot(froot);
 
-			treebrowser_expand_to_path(froot, path_current);
+			treebrowser_reveal(path_current, FALSE);
 		}
 
 		g_strfreev(path_segments);
@@ -1063,8 +2119,7 @@ on_menu_create_new_object(GtkMenuItem *menuitem, const gchar *type)
 			if (creation_success)
 			{
 				treebrowser_browse(uri, refresh_root ? NULL : &iter);
-				if (treebrowser_search(uri_new, NULL))
-					treebrowser_rename_current();
+				treebrowser_reveal(uri_new, TRUE);
 				if (utils_str_equal(type, "file") && CONFIG_OPEN_NEW_FILES == TRUE)
 					document_open_file(uri_new,FALSE, NULL,NULL);
 			}
@@ -1585,6 +2640,10 @@ on_treeview_row_collapsed(GtkWidget *widget, GtkTreeIter *iter, GtkTreePath *pat
 	gtk_tree_model_get(GTK_TREE_MODEL(treestore), iter, TREEBROWSER_COLUMN_URI, &uri, -1);
 	if (uri == NULL)
 		return;
+#ifdef HAVE_GIO
+	/* it gets listed again when expanded */
+	treebrowser_watch_stop(iter);
+#endif
 	if (CONFIG_SHOW_ICONS)
 	{
 		GdkPixbuf *icon = utils_pixbuf_from_stock(GTK_STOCK_DIRECTORY);
@@ -1656,6 +2715,12 @@ treebrowser_track_current_cb(void)
 		treebrowser_track_current();
 }
 
+static void
+on_icon_theme_changed(GtkIconTheme *icon_theme, gpointer data)
+{
+	icon_cache_clear();
+}
+
 
 /* ------------------
  * TREEBROWSER INITIAL FUNCTIONS
@@ -1669,6 +2734,43 @@ treeview_separator_func(GtkTreeModel *model, GtkTreeIter *iter, gpointer data)
 	return (flag == TREEBROWSER_FLAGS_SEPARATOR);
 }
 
+#if GTK_CHECK_VERSION(2, 20, 0)
+static void
+treeview_spinner_data_func(GtkTreeViewColumn *column, GtkCellRenderer *cell, GtkTreeModel *model,
+						GtkTreeIter *iter, gpointer data)
+{
+	gint flag;
+	gtk_tree_model_get(model, iter, TREEBROWSER_COLUMN_FLAG, &flag, -1);
+	g_object_set(cell,
+				"visible", 	flag == TREEBROWSER_FLAGS_LOADING,
+				"active", 	flag == TREEBROWSER_FLAGS_LOADING,
+				"pulse", 	browse_pulse,
+				NULL);
+}
+#endif
+
+static void
+treeview_badge_data_func(GtkTreeViewColumn *column, GtkCellRenderer *cell, GtkTreeModel *model,
+						GtkTreeIter *iter, gpointer data)
+{
+	gchar 			*uri;
+	const gchar 	*badge;
+
+	gtk_tree_model_get(model, iter, TREEBROWSER_COLUMN_URI, &uri, -1);
+	badge = gp_vc_status_get_badge(gp_vc_status_get(uri));
+	g_object_set(cell, "text", badge, "visible", badge != NULL, NULL);
+	g_free(uri);
+}
+
+static void
+on_vc_status_changed(const gchar *root, gpointer user_data)
+{
+	if (root == NULL && addressbar_last_address != NULL)
+		gp_vc_status_refresh(addressbar_last_address);
+	else
+		gtk_widget_queue_draw(treeview);
+}
+
 static GtkWidget*
 create_view_and_model(void)
 {
@@ -1689,6 +2791,18 @@ create_view_and_model(void)
 	gtk_tree_view_column_pack_start(treeview_column_text, render_text, TRUE);
 	gtk_tree_view_column_add_attribute(treeview_column_text, render_text, "text", TREEBROWSER_RENDER_TEXT);
 
+	/* the version control status of the row, as GeanyVC publishes it */
+	render_badge 			= gtk_cell_renderer_text_new();
+	g_object_set(render_badge, "weight", PANGO_WEIGHT_BOLD, NULL);
+	gtk_tree_view_column_pack_start(treeview_column_text, render_badge, FALSE);
+	gtk_tree_view_column_set_cell_data_func(treeview_column_text, render_badge, treeview_badge_data_func, NULL, NULL);
+
+#if GTK_CHECK_VERSION(2, 20, 0)
+	render_spinner 			= gtk_cell_renderer_spinner_new();
+	gtk_tree_view_column_pack_start(treeview_column_text, render_spinner, FALSE);
+	gtk_tree_view_column_set_cell_data_func(treeview_column_text, render_spinner, treeview_spinner_data_func, NULL, NULL);
+#endif
+
 	gtk_tree_view_set_enable_search(GTK_TREE_VIEW(view), TRUE);
 	gtk_tree_view_set_search_column(GTK_TREE_VIEW(view), TREEBROWSER_COLUMN_NAME);
 
@@ -1801,6 +2915,7 @@ create_sidebar(void)
 	g_signal_connect(treeview, 			"key-press-event", 		G_CALLBACK(on_treeview_keypress), 			NULL);
 	g_signal_connect(addressbar, 		"activate", 			G_CALLBACK(on_addressbar_activate), 			NULL);
 	g_signal_connect(filter, 			"activate", 			G_CALLBACK(on_filter_activate), 				NULL);
+	g_signal_connect(filter, 			"changed", 				G_CALLBACK(on_filter_changed), 					NULL);
 
 	gtk_widget_show_all(sidebar_vbox);
 
@@ -2094,8 +3209,8 @@ static void kb_activate(guint key_id)
 	}
 }
 
-void
-plugin_init(GeanyData *data)
+static void
+init_plugin(GeanyData *data)
 {
 	GeanyKeyGroup *key_group;
 
@@ -2104,8 +3219,14 @@ plugin_init(GeanyData *data)
 
 	flag_on_expand_refresh = FALSE;
 
+#ifdef HAVE_GIO
+	/* the callbacks of cancelled listings still run after plugin_cleanup() */
+	plugin_module_make_resident(geany_plugin);
+#endif
+
 	load_settings();
 	create_sidebar();
+	vc_status_subscription = gp_vc_status_subscribe(on_vc_status_changed, NULL);
 	treebrowser_chroot(get_default_dir());
 
 	/* setup keybindings */
@@ -2126,11 +3247,43 @@ plugin_init(GeanyData *data)
 
 	plugin_signal_connect(geany_plugin, NULL, "document-activate", TRUE,
 		(GCallback)&treebrowser_track_current_cb, NULL);
+	plugin_signal_connect(geany_plugin, G_OBJECT(gtk_icon_theme_get_default()), "changed", FALSE,
+		(GCallback)&on_icon_theme_changed, NULL);
 }
 
+GP_STARTUP_PROFILE_PLUGIN_INIT(init_plugin)
+
 void
 plugin_cleanup(void)
 {
+#ifdef HAVE_GIO
+	treebrowser_browse_cancel(NULL);
+	treebrowser_watch_stop(NULL);
+#endif
+	g_free(reveal_uri);
+	filter_clear();
+	gp_vc_status_unsubscribe(vc_status_subscription);
+	vc_status_subscription = 0;
+#ifdef HAVE_GIO
+	if (bookmarks_monitor)
+	{
+		g_signal_handlers_disconnect_by_func(bookmarks_monitor, on_bookmarks_file_changed, NULL);
+		g_file_monitor_cancel(bookmarks_monitor);
+		g_object_unref(bookmarks_monitor);
+		bookmarks_monitor = NULL;
+	}
+#endif
+	g_slist_foreach(bookmarks_paths, (GFunc) g_free, NULL);
+	g_slist_free(bookmarks_paths);
+	bookmarks_paths = NULL;
+	bookmarks_changed = TRUE;
+	if (icon_cache_stock)
+		g_hash_table_destroy(icon_cache_stock);
+	if (icon_cache_ctype)
+		g_hash_table_destroy(icon_cache_ctype);
+	if (dir_rows)
+		g_hash_table_destroy(dir_rows);
+	dir_rows = NULL;
 	g_free(addressbar_last_address);
 	g_free(CONFIG_FILE);
 	g_free(CONFIG_OPEN_EXTERNAL_CMD);
@@ -22,6 +22,7 @@
 
 #include "libsoup/soup.h"
 #include "stdlib.h"
+#include <time.h>
 
 #ifdef HAVE_CONFIG_H
 	#include "config.h" /* for the gettext domain */
@@ -54,6 +55,22 @@ static void update_check_result_cb(SoupSession *session,
 
 static gboolean check_on_startup = FALSE;
 
+/* The result of the last successful check is kept in the configuration and
+ * reused for this long, in seconds, instead of asking the server again */
+#define UPDATECHECK_CACHE_TTL (24 * 60 * 60)
+/* A failed check isn't retried on startup before this long */
+#define UPDATECHECK_RETRY_INTERVAL (60 * 60)
+/* The check on startup waits until the editor has been idle for this long */
+#define UPDATECHECK_STARTUP_DELAY 30
+
+static gchar *cached_version = NULL;
+static gint64 cached_version_time = 0;
+static gint64 last_failure_time = 0;
+
+static SoupSession *soup = NULL;
+static guint startup_check_id = 0;
+static time_t last_activity_time = 0;
+
 /* Configuration file */
 static gchar *config_file = NULL;
 
@@ -74,18 +91,90 @@ typedef struct
 version_struct;
 
 
+/* times are saved as strings, g_key_file_set_int64() needs GLib 2.26 */
+static gint64 get_time_setting(GKeyFile *config, const gchar *key)
+{
+    gchar *value = g_key_file_get_string(config, "cache", key, NULL);
+    gint64 result = value ? g_ascii_strtoll(value, NULL, 10) : 0;
+
+    g_free(value);
+    return result;
+}
+
+
+static void set_time_setting(GKeyFile *config, const gchar *key, gint64 value)
+{
+    gchar *str = g_strdup_printf("%" G_GINT64_FORMAT, value);
+
+    g_key_file_set_string(config, "cache", key, str);
+    g_free(str);
+}
+
+
+static void save_configuration(void)
+{
+    GKeyFile *config = g_key_file_new();
+    gchar *data;
+    gchar *config_dir = g_path_get_dirname(config_file);
+
+    g_key_file_load_from_file(config, config_file, G_KEY_FILE_NONE, NULL);
+
+    g_key_file_set_boolean(config, "general", "check_for_updates_on_startup",
+        check_on_startup);
+    if (cached_version != NULL)
+    {
+        g_key_file_set_string(config, "cache", "version", cached_version);
+        set_time_setting(config, "time", cached_version_time);
+    }
+    set_time_setting(config, "last_failure", last_failure_time);
+
+    if (!g_file_test(config_dir, G_FILE_TEST_IS_DIR)
+        && utils_mkdir(config_dir, TRUE) != 0)
+    {
+        dialogs_show_msgbox(GTK_MESSAGE_ERROR,
+            _("Plugin configuration directory could not be created."));
+    }
+    else
+    {
+        /* write config to file */
+        data = g_key_file_to_data(config, NULL, NULL);
+        utils_write_file(config_file, data);
+        g_free(data);
+    }
+
+    g_free(config_dir);
+    g_key_file_free(config);
+}
+
+
+static void cancel_startup_check(void)
+{
+    if (startup_check_id != 0)
+    {
+        g_source_remove(startup_check_id);
+        startup_check_id = 0;
+    }
+}
+
+
 static void update_check(gint type)
 {
-    SoupSession *soup;
     SoupMessage *msg;
-    gchar *user_agent = g_strconcat("Updatechecker ", VERSION, " at Geany ",
-                                     GEANY_VERSION, NULL);
 
-    g_message("Checking for updates");
-    soup = soup_session_async_new_with_options(SOUP_SESSION_USER_AGENT,
-            user_agent, NULL);
+    cancel_startup_check();
 
-    g_free(user_agent);
+    /* the session is kept for the next checks */
+    if (soup == NULL)
+    {
+        gchar *user_agent = g_strconcat("Updatechecker ", VERSION, " at Geany ",
+                                         GEANY_VERSION, NULL);
+
+        soup = soup_session_async_new_with_options(SOUP_SESSION_USER_AGENT,
+                user_agent, NULL);
+        g_free(user_agent);
+    }
+
+    g_message("Checking for updates");
 
     msg = soup_message_new ("GET", "http://geany.org/service/version.php");
 
@@ -94,14 +183,63 @@ static void update_check(gint type)
 
 
 
+static gboolean startup_check_cb(G_GNUC_UNUSED gpointer user_data)
+{
+    time_t idle_time = time(NULL) - last_activity_time;
+
+    if (idle_time >= 0 && idle_time < UPDATECHECK_STARTUP_DELAY)
+    {
+        /* the user is busy, wait until the editor has been idle long enough */
+        startup_check_id = g_timeout_add_seconds(UPDATECHECK_STARTUP_DELAY - idle_time,
+            startup_check_cb, NULL);
+        return FALSE;
+    }
+
+    startup_check_id = 0;
+    update_check(UPDATECHECK_STARTUP);
+    return FALSE;
+}
+
+
+static gboolean
+on_editor_notify(G_GNUC_UNUSED GObject *obj, G_GNUC_UNUSED GeanyEditor *editor,
+                 SCNotification *nt, G_GNUC_UNUSED gpointer user_data)
+{
+    /* only typing and moving around count as activity, not repaints */
+    if (startup_check_id != 0 &&
+        (nt->nmhdr.code == SCN_MODIFIED || nt->nmhdr.code == SCN_UPDATEUI))
+    {
+        last_activity_time = time(NULL);
+    }
+    return FALSE;
+}
+
+
 static void
 on_geany_startup_complete(G_GNUC_UNUSED GObject *obj,
                           G_GNUC_UNUSED gpointer user_data)
 {
-    if (check_on_startup == TRUE)
+    gint64 now = time(NULL);
+
+    if (check_on_startup == FALSE)
+        return;
+
+    if (cached_version != NULL &&
+        now >= cached_version_time && now - cached_version_time < UPDATECHECK_CACHE_TTL)
     {
-        update_check(UPDATECHECK_STARTUP);
+        /* the user was already told about it when it was fetched */
+        g_message("Using the result of the update check from %" G_GINT64_FORMAT
+            " seconds ago", now - cached_version_time);
+        return;
     }
+    if (now >= last_failure_time && now - last_failure_time < UPDATECHECK_RETRY_INTERVAL)
+        return;
+
+    /* don't compete with the rest of the startup, nor with the user */
+    last_activity_time = time(NULL);
+    cancel_startup_check();
+    startup_check_id = g_timeout_add_seconds(UPDATECHECK_STARTUP_DELAY,
+        startup_check_cb, NULL);
 }
 
 
@@ -181,9 +319,16 @@ static void update_check_result_cb(SoupSession *session,
 {
     gint type = GPOINTER_TO_INT(user_data);
 
+    if (msg->status_code == SOUP_STATUS_CANCELLED)
+        return;
+
     /* Checking whether we did get a valid (200) result */
     if (msg->status_code == 200)
     {
+        SETPTR(cached_version, g_strstrip(g_strdup(msg->response_body->data)));
+        cached_version_time = time(NULL);
+        save_configuration();
+
         if (version_compare(msg->response_body->data) == TRUE)
         {
             dialogs_show_msgbox(GTK_MESSAGE_INFO,
@@ -213,6 +358,9 @@ static void update_check_result_cb(SoupSession *session,
         }
         g_warning("Connection error. Code: %d; Message: %s",
             msg->status_code, msg->reason_phrase);
+
+        last_failure_time = time(NULL);
+        save_configuration();
     }
 }
 
@@ -228,40 +376,11 @@ on_configure_response(G_GNUC_UNUSED GtkDialog *dialog, gint response,
 {
     if (response == GTK_RESPONSE_OK || response == GTK_RESPONSE_APPLY)
     {
-        GKeyFile *config = g_key_file_new();
-        gchar *data;
-        gchar *config_dir = g_path_get_dirname(config_file);
-
-        config_file = g_strconcat(geany->app->configdir,
-            G_DIR_SEPARATOR_S, "plugins", G_DIR_SEPARATOR_S,
-            "updatechecker", G_DIR_SEPARATOR_S, "general.conf", NULL);
-
         /* Crabbing options that has been set */
         check_on_startup =
             gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(config_widgets.run_on_startup));
 
-        /* write stuff to file */
-        g_key_file_load_from_file(config, config_file, G_KEY_FILE_NONE, NULL);
-
-        g_key_file_set_boolean(config, "general", "check_for_updates_on_startup",
-            check_on_startup);
-
-        if (!g_file_test(config_dir, G_FILE_TEST_IS_DIR)
-            && utils_mkdir(config_dir, TRUE) != 0)
-        {
-            dialogs_show_msgbox(GTK_MESSAGE_ERROR,
-                _("Plugin configuration directory could not be created."));
-        }
-        else
-        {
-            /* write config to file */
-            data = g_key_file_to_data(config, NULL, NULL);
-            utils_write_file(config_file, data);
-            g_free(data);
-        }
-
-        g_free(config_dir);
-        g_key_file_free(config);
+        save_configuration();
     }
 }
 
@@ -289,6 +408,7 @@ plugin_configure(GtkDialog * dialog)
 PluginCallback plugin_callbacks[] =
 {
     { "geany-startup-complete", (GCallback) &on_geany_startup_complete, FALSE, NULL },
+    { "editor-notify", (GCallback) &on_editor_notify, FALSE, NULL },
     { NULL, NULL, FALSE, NULL }
 };
 
@@ -308,6 +428,10 @@ static void init_configuration(void)
     check_on_startup = utils_get_setting_boolean(config, "general",
         "check_for_updates_on_startup", FALSE);
 
+    cached_version = g_key_file_get_string(config, "cache", "version", NULL);
+    cached_version_time = get_time_setting(config, "time");
+    last_failure_time = get_time_setting(config, "last_failure");
+
     g_key_file_free(config);
 }
 
@@ -326,6 +450,15 @@ void plugin_init(GeanyData *data)
 
 void plugin_cleanup(void)
 {
+    cancel_startup_check();
+    if (soup != NULL)
+    {
+        soup_session_abort(soup);
+        g_object_unref(soup);
+        soup = NULL;
+    }
     gtk_widget_destroy(main_menu_item);
     g_free(config_file);
+    g_free(cached_version);
+    cached_version = NULL;
 }
@@ -0,0 +1,1129 @@
+/*
+ * fileindex.c - index of the files under a directory, shared by the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/* The directories are walked from an idle callback, a little at a time, and
+ * monitored afterwards.  The entries of each directory are saved with its
+ * mtime, so the next session adds the files of a directory which didn't
+ * change without reading it.
+ *
+ * Each file keeps a mask of the characters of its path, so most files are
+ * rejected by a query without looking at their path, and a query which
+ * extends the previous one only looks at the previous matches.  The files are
+ * also indexed by their basename without extension.
+ *
+ * The indexes are registered on the main window, which all the plugins
+ * share.  Each plugin links its own copy of this code, and an index runs the
+ * code of the plugin which created it: the plugins referencing an index are
+ * made resident, so that code stays loaded. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#include <geanyplugin.h>
+
+#include "fileindex.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+
+
+#define BUILD_SLICE 0.01		/* seconds of walking per idle call */
+#define NOTIFY_INTERVAL 0.5		/* seconds between notifications while walking */
+
+/* changed with the layout of GpFileIndex, so that plugins built from
+ * different sources don't share indexes */
+#define REGISTRY_KEY "geany-plugins-file-index-1"
+#define CACHE_HEADER "# geany-plugins file index 1"
+
+/* the first character of the entries of a DirRecord */
+enum
+{
+	NAME_FILE = 'f',
+	NAME_DIR = 'd'
+};
+
+typedef struct
+{
+	guint64 mask;			/* characters of lower, see char_bit() */
+	const gchar *path;		/* relative to the root, UTF-8 */
+	const gchar *lower;		/* path in ASCII lower case */
+	guint base;				/* offset of the basename in path */
+	guint length;
+	gboolean removed;
+} FileEntry;
+
+/* what the cache keeps of a directory */
+typedef struct
+{
+	gint64 mtime;			/* 0 when the directory changed since it was read */
+	GPtrArray *names;		/* kind-prefixed names of the files and directories */
+} DirRecord;
+
+typedef struct
+{
+	gulong id;
+	GpFileIndexChangedFunc func;
+	gpointer user_data;
+} Subscriber;
+
+struct GpFileIndex
+{
+	gint ref_count;
+	gchar *root;				/* UTF-8 */
+	gchar *locale_root;
+	GFile *root_file;
+	gchar *cache_file;
+
+	GArray *entries;			/* FileEntry */
+	GStringChunk *strings;
+	GHashTable *entry_table;	/* path -> index in entries + 1 */
+	GHashTable *stem_table;		/* stem -> GSList of indexes in entries */
+	guint n_files;				/* entries not removed */
+	guint generation;			/* changed with the entries */
+
+	GHashTable *cached_dirs;	/* locale relative path -> DirRecord, not read again yet */
+	GHashTable *dirs;			/* locale relative path -> DirRecord, read by this session */
+	gboolean dirty;				/* dirs changed since the cache was saved */
+
+	GQueue *pending_dirs;		/* relative paths still to walk */
+	GDir *current_dir;
+	gchar *current_dir_path;
+	DirRecord *current_record;	/* being read */
+	DirRecord *current_cached;	/* of the previous session, for what was removed */
+	guint build_id;
+	GTimer *notify_timer;
+	GHashTable *monitors;		/* locale relative path -> GFileMonitor */
+
+	/* the previous query and the entries matching it */
+	gchar *last_query;
+	GArray *last_candidates;
+	guint last_generation;
+
+	GSList *subscribers;		/* Subscriber */
+	gulong last_subscriber_id;
+};
+
+
+static void walk_entry(GpFileIndex *index, const gchar *dir_path, const gchar *name,
+	DirRecord *record);
+static void on_dir_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+	GFileMonitorEvent event_type, gpointer user_data);
+
+
+/* Bit of a character in the masks: letters and digits have their own bit,
+ * other characters share the remaining ones. */
+static guint char_bit(guchar c)
+{
+	if (c >= 'a' && c <= 'z')
+		return c - 'a';
+	if (c >= '0' && c <= '9')
+		return 26 + c - '0';
+	return 36 + c % 28;
+}
+
+
+static guint64 string_mask(const gchar *s)
+{
+	guint64 mask = 0;
+
+	for (; *s != '\0'; s++)
+		mask |= G_GUINT64_CONSTANT(1) << char_bit((guchar) *s);
+	return mask;
+}
+
+
+static gchar *child_path(const gchar *dir_path, const gchar *name)
+{
+	return dir_path[0] != '\0' ? g_build_filename(dir_path, name, NULL) : g_strdup(name);
+}
+
+
+static DirRecord *dir_record_new(gint64 mtime)
+{
+	DirRecord *record = g_new(DirRecord, 1);
+
+	record->mtime = mtime;
+	record->names = g_ptr_array_new();
+	return record;
+}
+
+
+static void dir_record_free(DirRecord *record)
+{
+	g_ptr_array_foreach(record->names, (GFunc) g_free, NULL);
+	g_ptr_array_free(record->names, TRUE);
+	g_free(record);
+}
+
+
+static void monitor_free(GFileMonitor *monitor)
+{
+	g_signal_handlers_disconnect_matched(monitor, G_SIGNAL_MATCH_FUNC, 0, 0, NULL,
+		on_dir_changed, NULL);
+	g_file_monitor_cancel(monitor);
+	g_object_unref(monitor);
+}
+
+
+static GHashTable *get_registry(gboolean create)
+{
+	GObject *window = G_OBJECT(geany_data->main_widgets->window);
+	GHashTable *registry = g_object_get_data(window, REGISTRY_KEY);
+
+	if (registry == NULL && create)
+	{
+		registry = g_hash_table_new(g_str_hash, g_str_equal);
+		g_object_set_data_full(window, REGISTRY_KEY, registry,
+			(GDestroyNotify) g_hash_table_destroy);
+	}
+	return registry;
+}
+
+
+static void notify_changed(GpFileIndex *index)
+{
+	GSList *subscribers, *node;
+
+	g_timer_start(index->notify_timer);
+
+	/* a subscriber may unsubscribe others, or release the index */
+	index->ref_count++;
+	subscribers = g_slist_copy(index->subscribers);
+	for (node = subscribers; node != NULL; node = node->next)
+	{
+		Subscriber *sub = node->data;
+
+		if (g_slist_find(index->subscribers, sub) != NULL)
+			sub->func(index, sub->user_data);
+	}
+	g_slist_free(subscribers);
+	gp_file_index_unref(index);
+}
+
+
+/* Adds a file, rel_path being relative to the root in the file name encoding */
+static void add_file(GpFileIndex *index, const gchar *rel_path)
+{
+	FileEntry entry;
+	gchar *utf8_path;
+	gchar *lower;
+	gchar *pc;
+	gchar *stem;
+	GSList *stem_indexes;
+	gpointer pos;
+
+	utf8_path = g_filename_to_utf8(rel_path, -1, NULL, NULL, NULL);
+	if (utf8_path == NULL)
+		return;
+
+	pos = g_hash_table_lookup(index->entry_table, utf8_path);
+	if (pos != NULL)
+	{
+		FileEntry *old = &g_array_index(index->entries, FileEntry, GPOINTER_TO_UINT(pos) - 1);
+
+		if (old->removed)
+		{
+			old->removed = FALSE;
+			index->n_files++;
+			index->generation++;
+		}
+		g_free(utf8_path);
+		return;
+	}
+
+	entry.path = g_string_chunk_insert(index->strings, utf8_path);
+	lower = g_string_chunk_insert(index->strings, utf8_path);
+	entry.base = 0;
+	for (pc = lower; *pc != '\0'; pc++)
+	{
+		*pc = g_ascii_tolower(*pc);
+		if (*pc == G_DIR_SEPARATOR)
+			entry.base = pc - lower + 1;
+	}
+	entry.lower = lower;
+	entry.length = pc - lower;
+	entry.mask = string_mask(lower);
+	entry.removed = FALSE;
+
+	/* the stem is the basename up to its first dot */
+	for (pc = (gchar *) entry.path + entry.base; *pc != '\0' && *pc != '.'; pc++);
+	stem = g_string_chunk_insert_len(index->strings, entry.path + entry.base,
+		pc - entry.path - entry.base);
+	stem_indexes = g_hash_table_lookup(index->stem_table, stem);
+	if (stem_indexes != NULL)
+		g_hash_table_steal(index->stem_table, stem);
+	stem_indexes = g_slist_prepend(stem_indexes, GUINT_TO_POINTER(index->entries->len));
+	g_hash_table_insert(index->stem_table, stem, stem_indexes);
+
+	g_array_append_val(index->entries, entry);
+	g_hash_table_insert(index->entry_table, (gpointer) entry.path,
+		GUINT_TO_POINTER(index->entries->len));
+	index->n_files++;
+	index->generation++;
+	g_free(utf8_path);
+}
+
+
+/* Removes a file, or all the files of a directory (UTF-8 relative path) */
+static void remove_path(GpFileIndex *index, const gchar *utf8_path)
+{
+	gpointer pos;
+	gchar *prefix;
+	guint i;
+
+	pos = g_hash_table_lookup(index->entry_table, utf8_path);
+	if (pos != NULL)
+	{
+		FileEntry *entry = &g_array_index(index->entries, FileEntry, GPOINTER_TO_UINT(pos) - 1);
+
+		if (! entry->removed)
+		{
+			entry->removed = TRUE;
+			index->n_files--;
+			index->generation++;
+		}
+		return;
+	}
+
+	prefix = g_strconcat(utf8_path, G_DIR_SEPARATOR_S, NULL);
+	for (i = 0; i < index->entries->len; i++)
+	{
+		FileEntry *entry = &g_array_index(index->entries, FileEntry, i);
+
+		if (! entry->removed && g_str_has_prefix(entry->path, prefix))
+		{
+			entry->removed = TRUE;
+			index->n_files--;
+			index->generation++;
+		}
+	}
+	g_free(prefix);
+}
+
+
+/* Removes what a directory (locale relative path) had in the cache but not anymore */
+static void remove_vanished(GpFileIndex *index, const gchar *dir_path, DirRecord *cached,
+	DirRecord *current)
+{
+	GHashTable *names = g_hash_table_new(g_str_hash, g_str_equal);
+	guint i;
+
+	for (i = 0; current != NULL && i < current->names->len; i++)
+		g_hash_table_insert(names, g_ptr_array_index(current->names, i), names);
+
+	for (i = 0; i < cached->names->len; i++)
+	{
+		const gchar *name = g_ptr_array_index(cached->names, i);
+
+		if (g_hash_table_lookup(names, name) == NULL)
+		{
+			gchar *rel_path = child_path(dir_path, name + 1);
+			gchar *utf8_path = g_filename_to_utf8(rel_path, -1, NULL, NULL, NULL);
+
+			if (utf8_path != NULL)
+				remove_path(index, utf8_path);
+			g_free(utf8_path);
+			g_free(rel_path);
+		}
+	}
+	g_hash_table_destroy(names);
+}
+
+
+/* The directory (locale relative path) changed after it was read, it has to be
+ * read again by the next session */
+static void mark_dir_changed(GpFileIndex *index, const gchar *dir_path)
+{
+	DirRecord *record = g_hash_table_lookup(index->dirs, dir_path);
+
+	if (record != NULL)
+	{
+		record->mtime = 0;
+		index->dirty = TRUE;
+	}
+}
+
+
+static void on_dir_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+	GFileMonitorEvent event_type, gpointer user_data)
+{
+	GpFileIndex *index = user_data;
+	gchar *rel_path;
+	gchar *dir_path;
+
+	if (event_type != G_FILE_MONITOR_EVENT_CREATED && event_type != G_FILE_MONITOR_EVENT_DELETED)
+		return;
+
+	rel_path = g_file_get_relative_path(index->root_file, file);
+	if (rel_path == NULL)
+		return;
+
+	dir_path = g_path_get_dirname(rel_path);
+	if (strcmp(dir_path, ".") == 0)
+		dir_path[0] = '\0';
+	mark_dir_changed(index, dir_path);
+
+	if (event_type == G_FILE_MONITOR_EVENT_CREATED)
+	{
+		gchar *name = g_path_get_basename(rel_path);
+
+		walk_entry(index, dir_path, name, NULL);
+		g_free(name);
+	}
+	else
+	{
+		gchar *utf8_path = g_filename_to_utf8(rel_path, -1, NULL, NULL, NULL);
+
+		if (utf8_path != NULL)
+			remove_path(index, utf8_path);
+		g_free(utf8_path);
+	}
+	notify_changed(index);
+
+	g_free(dir_path);
+	g_free(rel_path);
+}
+
+
+static void watch_dir(GpFileIndex *index, const gchar *dir_path, const gchar *full_path)
+{
+	GFile *file = g_file_new_for_path(full_path);
+	GFileMonitor *monitor;
+
+	monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, NULL);
+	if (monitor != NULL)
+	{
+		g_signal_connect(monitor, "changed", G_CALLBACK(on_dir_changed), index);
+		g_hash_table_insert(index->monitors, g_strdup(dir_path), monitor);
+	}
+	g_object_unref(file);
+}
+
+
+static void save_cache(GpFileIndex *index)
+{
+	GHashTable *tables[] = { index->cached_dirs, index->dirs };
+	GString *str = g_string_new(CACHE_HEADER "\n");
+	gchar *escaped;
+	gchar *dir;
+	guint i, j;
+
+	escaped = g_strescape(index->locale_root, NULL);
+	g_string_append_printf(str, "%s\n", escaped);
+	g_free(escaped);
+
+	/* "D\t<mtime>\t<relative path>" lines, each followed by the entries */
+	for (i = 0; i < G_N_ELEMENTS(tables); i++)
+	{
+		GHashTableIter iter;
+		gpointer key, value;
+
+		g_hash_table_iter_init(&iter, tables[i]);
+		while (g_hash_table_iter_next(&iter, &key, &value))
+		{
+			DirRecord *record = value;
+
+			escaped = g_strescape(key, NULL);
+			g_string_append_printf(str, "D\t%" G_GINT64_FORMAT "\t%s\n", record->mtime, escaped);
+			g_free(escaped);
+			for (j = 0; j < record->names->len; j++)
+			{
+				escaped = g_strescape(g_ptr_array_index(record->names, j), NULL);
+				g_string_append_printf(str, "%s\n", escaped);
+				g_free(escaped);
+			}
+		}
+	}
+
+	dir = g_path_get_dirname(index->cache_file);
+	g_mkdir_with_parents(dir, 0700);
+	g_file_set_contents(index->cache_file, str->str, str->len, NULL);
+	g_free(dir);
+	g_string_free(str, TRUE);
+	index->dirty = FALSE;
+}
+
+
+/* Adds the files of the previous session.  Their directories are kept to be
+ * checked by the walk. */
+static void load_cache(GpFileIndex *index)
+{
+	DirRecord *record = NULL;
+	const gchar *dir_path = NULL;
+	gchar *contents;
+	gchar *root;
+	gchar **lines;
+	guint i;
+
+	if (! g_file_get_contents(index->cache_file, &contents, NULL, NULL))
+		return;
+	lines = g_strsplit(contents, "\n", -1);
+	g_free(contents);
+
+	root = lines[0] && lines[1] ? g_strcompress(lines[1]) : NULL;
+	if (root == NULL || strcmp(lines[0], CACHE_HEADER) != 0 ||
+		strcmp(root, index->locale_root) != 0)
+	{
+		g_free(root);
+		g_strfreev(lines);
+		return;
+	}
+
+	for (i = 2; lines[i] != NULL; i++)
+	{
+		const gchar *line = lines[i];
+
+		if (line[0] == 'D' && line[1] == '\t')
+		{
+			const gchar *rel_path = strchr(line + 2, '\t');
+
+			record = NULL;
+			if (rel_path != NULL)
+			{
+				gchar *path = g_strcompress(rel_path + 1);
+
+				record = dir_record_new(g_ascii_strtoll(line + 2, NULL, 10));
+				g_hash_table_insert(index->cached_dirs, path, record);
+				dir_path = path;
+			}
+		}
+		else if (record != NULL && (line[0] == NAME_FILE || line[0] == NAME_DIR))
+		{
+			gchar *name = g_strcompress(line);
+
+			g_ptr_array_add(record->names, name);
+			if (name[0] == NAME_FILE)
+			{
+				gchar *path = child_path(dir_path, name + 1);
+
+				add_file(index, path);
+				g_free(path);
+			}
+		}
+	}
+	g_free(root);
+	g_strfreev(lines);
+}
+
+
+/* Starts reading a directory, or reuses what the cache has of it when it
+ * didn't change.  dir_path is consumed. */
+static void open_dir(GpFileIndex *index, gchar *dir_path)
+{
+	gchar *full_path = g_build_filename(index->locale_root, dir_path, NULL);
+	DirRecord *cached = NULL;
+	gpointer key = NULL;
+	struct stat st;
+
+	if (g_hash_table_lookup_extended(index->cached_dirs, dir_path, &key, (gpointer *) &cached))
+	{
+		g_hash_table_steal(index->cached_dirs, dir_path);
+		g_free(key);
+	}
+
+	if (g_stat(full_path, &st) == 0 && S_ISDIR(st.st_mode))
+	{
+		watch_dir(index, dir_path, full_path);
+
+		if (cached != NULL && cached->mtime == (gint64) st.st_mtime)
+		{
+			guint i;
+
+			/* its files were added with the cache */
+			for (i = 0; i < cached->names->len; i++)
+			{
+				const gchar *name = g_ptr_array_index(cached->names, i);
+
+				if (name[0] == NAME_DIR)
+					g_queue_push_tail(index->pending_dirs, child_path(dir_path, name + 1));
+			}
+			g_hash_table_insert(index->dirs, dir_path, cached);
+			g_free(full_path);
+			return;
+		}
+
+		index->current_dir = g_dir_open(full_path, 0, NULL);
+	}
+
+	if (index->current_dir != NULL)
+	{
+		index->current_dir_path = dir_path;
+		index->current_record = dir_record_new((gint64) st.st_mtime);
+		index->current_cached = cached;
+	}
+	else
+	{
+		if (cached != NULL)
+		{
+			remove_vanished(index, dir_path, cached, NULL);
+			dir_record_free(cached);
+		}
+		g_free(dir_path);
+	}
+	g_free(full_path);
+}
+
+
+static void close_dir(GpFileIndex *index)
+{
+	g_dir_close(index->current_dir);
+	index->current_dir = NULL;
+
+	if (index->current_cached != NULL)
+	{
+		remove_vanished(index, index->current_dir_path, index->current_cached,
+			index->current_record);
+		dir_record_free(index->current_cached);
+		index->current_cached = NULL;
+	}
+
+	g_hash_table_insert(index->dirs, index->current_dir_path, index->current_record);
+	index->current_dir_path = NULL;
+	index->current_record = NULL;
+	index->dirty = TRUE;
+}
+
+
+/* Walks the directories in pending_dirs for a time slice */
+static gboolean build_step(gpointer data)
+{
+	GpFileIndex *index = data;
+	GTimer *timer = g_timer_new();
+
+	while (g_timer_elapsed(timer, NULL) < BUILD_SLICE)
+	{
+		const gchar *name;
+
+		if (index->current_dir == NULL)
+		{
+			if (g_queue_is_empty(index->pending_dirs))
+				break;
+			open_dir(index, g_queue_pop_head(index->pending_dirs));
+			continue;
+		}
+
+		name = g_dir_read_name(index->current_dir);
+		if (name == NULL)
+			close_dir(index);
+		else
+			walk_entry(index, index->current_dir_path, name, index->current_record);
+	}
+	g_timer_destroy(timer);
+
+	if (index->current_dir == NULL && g_queue_is_empty(index->pending_dirs))
+	{
+		index->build_id = 0;
+		if (index->dirty)
+			save_cache(index);
+		notify_changed(index);
+		return FALSE;
+	}
+
+	if (g_timer_elapsed(index->notify_timer, NULL) > NOTIFY_INTERVAL)
+		notify_changed(index);
+	return TRUE;
+}
+
+
+static void start_build(GpFileIndex *index)
+{
+	if (index->build_id == 0)
+		index->build_id = g_idle_add(build_step, index);
+}
+
+
+/* Adds a file of the directory dir_path (relative to the root, "" for the
+ * root itself), or queues it if it is a directory.  The entry is added to
+ * record, unless it is NULL. */
+static void walk_entry(GpFileIndex *index, const gchar *dir_path, const gchar *name,
+	DirRecord *record)
+{
+	gchar *rel_path;
+	gchar *full_path;
+	gchar kind = 0;
+	struct stat st;
+
+	/* skip hidden files and directories, such as .git or .svn */
+	if (name[0] == '.')
+		return;
+
+	rel_path = child_path(dir_path, name);
+	full_path = g_build_filename(index->locale_root, rel_path, NULL);
+
+	/* don't follow links to directories, they could make loops */
+	if (g_lstat(full_path, &st) == 0)
+	{
+		if (S_ISDIR(st.st_mode))
+		{
+			kind = NAME_DIR;
+			g_queue_push_tail(index->pending_dirs, rel_path);
+			rel_path = NULL;
+			start_build(index);
+		}
+		else if (S_ISREG(st.st_mode))
+			kind = NAME_FILE;
+#ifdef S_ISLNK
+		else if (S_ISLNK(st.st_mode) && g_file_test(full_path, G_FILE_TEST_IS_REGULAR))
+			kind = NAME_FILE;
+#endif
+		if (kind == NAME_FILE)
+			add_file(index, rel_path);
+	}
+
+	if (kind != 0 && record != NULL)
+		g_ptr_array_add(record->names, g_strdup_printf("%c%s", kind, name));
+
+	g_free(full_path);
+	g_free(rel_path);
+}
+
+
+static GpFileIndex *index_new(const gchar *root)
+{
+	GpFileIndex *index = g_new0(GpFileIndex, 1);
+	gchar *checksum;
+	gchar *name;
+	gsize len;
+
+	index->ref_count = 1;
+	index->root = g_strdup(root);
+	len = strlen(index->root);
+	while (len > 1 && index->root[len - 1] == G_DIR_SEPARATOR)
+		index->root[--len] = '\0';
+	index->locale_root = utils_get_locale_from_utf8(index->root);
+	index->root_file = g_file_new_for_path(index->locale_root);
+
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_MD5, index->root, -1);
+	name = g_strconcat(checksum, ".index", NULL);
+	index->cache_file = g_build_filename(geany_data->app->configdir, "plugins", "fileindex",
+		name, NULL);
+	g_free(name);
+	g_free(checksum);
+
+	index->entries = g_array_new(FALSE, FALSE, sizeof(FileEntry));
+	index->strings = g_string_chunk_new(64 * 1024);
+	index->entry_table = g_hash_table_new(g_str_hash, g_str_equal);
+	index->stem_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify) g_slist_free);
+	index->cached_dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify) dir_record_free);
+	index->dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify) dir_record_free);
+	index->pending_dirs = g_queue_new();
+	index->monitors = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify) monitor_free);
+	index->notify_timer = g_timer_new();
+
+	load_cache(index);
+	g_queue_push_tail(index->pending_dirs, g_strdup(""));
+	start_build(index);
+
+	return index;
+}
+
+
+static void index_free(GpFileIndex *index)
+{
+	GHashTable *registry = get_registry(FALSE);
+
+	if (registry != NULL && g_hash_table_lookup(registry, index->root) == index)
+		g_hash_table_remove(registry, index->root);
+
+	if (index->build_id != 0)
+		g_source_remove(index->build_id);
+	if (index->current_dir != NULL)
+	{
+		/* what was read is incomplete, the previous session's record is kept */
+		g_dir_close(index->current_dir);
+		dir_record_free(index->current_record);
+		if (index->current_cached != NULL)
+			g_hash_table_insert(index->cached_dirs, index->current_dir_path,
+				index->current_cached);
+		else
+			g_free(index->current_dir_path);
+	}
+	if (index->dirty)
+		save_cache(index);
+
+	g_queue_foreach(index->pending_dirs, (GFunc) g_free, NULL);
+	g_queue_free(index->pending_dirs);
+	g_hash_table_destroy(index->monitors);
+	g_timer_destroy(index->notify_timer);
+	g_hash_table_destroy(index->cached_dirs);
+	g_hash_table_destroy(index->dirs);
+
+	if (index->last_candidates != NULL)
+		g_array_free(index->last_candidates, TRUE);
+	g_free(index->last_query);
+
+	g_hash_table_destroy(index->stem_table);
+	g_hash_table_destroy(index->entry_table);
+	g_string_chunk_free(index->strings);
+	g_array_free(index->entries, TRUE);
+
+	g_slist_foreach(index->subscribers, (GFunc) g_free, NULL);
+	g_slist_free(index->subscribers);
+
+	g_object_unref(index->root_file);
+	g_free(index->cache_file);
+	g_free(index->locale_root);
+	g_free(index->root);
+	g_free(index);
+}
+
+
+/* Returns the index of the files under root (UTF-8), shared with the other
+ * plugins, and starts indexing them if no plugin did.  plugin is made
+ * resident.  Release the index with gp_file_index_unref(). */
+GpFileIndex *gp_file_index_ref(GeanyPlugin *plugin, const gchar *root)
+{
+	GHashTable *registry;
+	GpFileIndex *index;
+
+	g_return_val_if_fail(plugin != NULL && root != NULL, NULL);
+
+	/* the index runs the code of the plugin which created it */
+	plugin_module_make_resident(plugin);
+
+	registry = get_registry(TRUE);
+	index = g_hash_table_lookup(registry, root);
+	if (index == NULL)
+	{
+		gchar *norm_root = g_strdup(root);
+		gsize len = strlen(norm_root);
+
+		while (len > 1 && norm_root[len - 1] == G_DIR_SEPARATOR)
+			norm_root[--len] = '\0';
+		index = g_hash_table_lookup(registry, norm_root);
+		g_free(norm_root);
+	}
+
+	if (index != NULL)
+		index->ref_count++;
+	else
+	{
+		index = index_new(root);
+		g_hash_table_insert(registry, index->root, index);
+	}
+	return index;
+}
+
+
+void gp_file_index_unref(GpFileIndex *index)
+{
+	g_return_if_fail(index != NULL);
+
+	if (--index->ref_count == 0)
+		index_free(index);
+}
+
+
+/* Calls func each time files are added to or removed from the index.
+ * Returns an id for gp_file_index_unsubscribe(). */
+gulong gp_file_index_subscribe(GpFileIndex *index, GpFileIndexChangedFunc func,
+	gpointer user_data)
+{
+	Subscriber *sub = g_new(Subscriber, 1);
+
+	sub->id = ++index->last_subscriber_id;
+	sub->func = func;
+	sub->user_data = user_data;
+	index->subscribers = g_slist_append(index->subscribers, sub);
+	return sub->id;
+}
+
+
+void gp_file_index_unsubscribe(GpFileIndex *index, gulong id)
+{
+	GSList *node;
+
+	for (node = index->subscribers; node != NULL; node = node->next)
+	{
+		Subscriber *sub = node->data;
+
+		if (sub->id == id)
+		{
+			index->subscribers = g_slist_delete_link(index->subscribers, node);
+			g_free(sub);
+			return;
+		}
+	}
+}
+
+
+const gchar *gp_file_index_get_root(GpFileIndex *index)
+{
+	return index->root;
+}
+
+
+/* Whether the directories are still being walked.  The files of the previous
+ * session are in the index meanwhile. */
+gboolean gp_file_index_is_building(GpFileIndex *index)
+{
+	return index->build_id != 0;
+}
+
+
+guint gp_file_index_get_size(GpFileIndex *index)
+{
+	return index->n_files;
+}
+
+
+/* Changes each time files are added or removed, for users keeping what they
+ * got from the index */
+guint gp_file_index_get_generation(GpFileIndex *index)
+{
+	return index->generation;
+}
+
+
+/* Greedy match of the characters of query, in order, from start in lower.
+ * Consecutive characters and characters starting a word score more.
+ * Returns the score, or 0 if query doesn't match. */
+static gint match_from(const gchar *lower, guint start, const gchar *query)
+{
+	const gchar *pc = lower + start;
+	const gchar *prev = NULL;
+	gint score = 0;
+
+	for (; *query != '\0'; query++)
+	{
+		pc = strchr(pc, *query);
+		if (pc == NULL)
+			return 0;
+
+		score++;
+		if (prev != NULL && pc == prev + 1)
+			score += 4;
+		if (pc == lower + start || strchr(G_DIR_SEPARATOR_S "_-. ", pc[-1]) != NULL)
+			score += 3;
+		prev = pc;
+		pc++;
+	}
+	return score;
+}
+
+
+static gint entry_score(const FileEntry *entry, const gchar *query)
+{
+	gint score;
+
+	/* matches in the basename are the best ones */
+	score = match_from(entry->lower, entry->base, query);
+	if (score > 0)
+		score += 10;
+	else
+		score = match_from(entry->lower, 0, query);
+
+	/* then the shortest paths */
+	return score > 0 ? score * 256 - (gint) MIN(entry->length, 255) : 0;
+}
+
+
+/* Fills matches with the best max_matches files matching query, best first.
+ * The characters of query must appear in the path in order, spaces only
+ * separate them.  Returns the number of matches. */
+guint gp_file_index_query(GpFileIndex *index, const gchar *query,
+	GpFileIndexMatch *matches, guint max_matches)
+{
+	GArray *candidates;
+	gchar *lower_query;
+	gchar *pc;
+	gchar *pq;
+	guint64 mask;
+	gboolean narrow;
+	guint n_matches = 0;
+	guint n;
+	guint i;
+
+	g_return_val_if_fail(query != NULL, 0);
+
+	if (max_matches == 0)
+		return 0;
+
+	lower_query = g_ascii_strdown(query, -1);
+	for (pc = pq = lower_query; *pc != '\0'; pc++)
+	{
+		if (*pc != ' ')
+			*pq++ = *pc;
+	}
+	*pq = '\0';
+
+	if (lower_query[0] == '\0')
+	{
+		g_free(lower_query);
+		return 0;
+	}
+
+	/* the files matching a query also match its prefixes */
+	narrow = (index->last_query != NULL && index->last_generation == index->generation &&
+		g_str_has_prefix(lower_query, index->last_query));
+	n = narrow ? index->last_candidates->len : index->entries->len;
+
+	mask = string_mask(lower_query);
+	candidates = g_array_new(FALSE, FALSE, sizeof(guint));
+	for (i = 0; i < n; i++)
+	{
+		guint pos = narrow ? g_array_index(index->last_candidates, guint, i) : i;
+		const FileEntry *entry = &g_array_index(index->entries, FileEntry, pos);
+		gint score;
+		guint j;
+
+		if (entry->removed || (entry->mask & mask) != mask)
+			continue;
+
+		score = entry_score(entry, lower_query);
+		if (score == 0)
+			continue;
+		g_array_append_val(candidates, pos);
+
+		/* keep the best matches sorted */
+		if (n_matches == max_matches && score <= matches[n_matches - 1].score)
+			continue;
+		if (n_matches < max_matches)
+			n_matches++;
+		for (j = n_matches - 1; j > 0 && matches[j - 1].score < score; j--)
+			matches[j] = matches[j - 1];
+		matches[j].path = entry->path;
+		matches[j].score = score;
+	}
+
+	if (index->last_candidates != NULL)
+		g_array_free(index->last_candidates, TRUE);
+	g_free(index->last_query);
+	index->last_candidates = candidates;
+	index->last_query = lower_query;
+	index->last_generation = index->generation;
+
+	return n_matches;
+}
+
+
+/* Returns a list of the files whose basename up to its first dot is stem */
+GSList *gp_file_index_find_by_stem(GpFileIndex *index, const gchar *stem)
+{
+	GSList *paths = NULL;
+	GSList *node;
+
+	g_return_val_if_fail(stem != NULL, NULL);
+
+	for (node = g_hash_table_lookup(index->stem_table, stem); node != NULL; node = node->next)
+	{
+		const FileEntry *entry = &g_array_index(index->entries, FileEntry,
+			GPOINTER_TO_UINT(node->data));
+
+		if (! entry->removed)
+			paths = g_slist_prepend(paths, (gpointer) entry->path);
+	}
+	return paths;
+}
+
+
+/* Returns a list of the files named basename */
+GSList *gp_file_index_find_by_basename(GpFileIndex *index, const gchar *basename)
+{
+	GSList *paths, *node;
+	gchar *stem;
+
+	g_return_val_if_fail(basename != NULL, NULL);
+
+	stem = g_strndup(basename, strcspn(basename, "."));
+	paths = gp_file_index_find_by_stem(index, stem);
+	g_free(stem);
+
+	for (node = paths; node != NULL; )
+	{
+		GSList *next = node->next;
+		const gchar *base = strrchr(node->data, G_DIR_SEPARATOR);
+
+		if (strcmp(base != NULL ? base + 1 : node->data, basename) != 0)
+			paths = g_slist_delete_link(paths, node);
+		node = next;
+	}
+	return paths;
+}
+
+
+/* Returns a list of the files whose path starts with prefix */
+GSList *gp_file_index_find_by_prefix(GpFileIndex *index, const gchar *prefix)
+{
+	GSList *paths = NULL;
+	guint i;
+
+	g_return_val_if_fail(prefix != NULL, NULL);
+
+	for (i = index->entries->len; i-- > 0; )
+	{
+		const FileEntry *entry = &g_array_index(index->entries, FileEntry, i);
+
+		if (! entry->removed && g_str_has_prefix(entry->path, prefix))
+			paths = g_slist_prepend(paths, (gpointer) entry->path);
+	}
+	return paths;
+}
+
+
+/* Returns a list of the files matching the glob pattern, which is matched
+ * against the basename unless it contains a directory separator */
+GSList *gp_file_index_find_by_glob(GpFileIndex *index, const gchar *pattern)
+{
+	GPatternSpec *spec;
+	gboolean whole_path;
+	GSList *paths = NULL;
+	guint i;
+
+	g_return_val_if_fail(pattern != NULL, NULL);
+
+	spec = g_pattern_spec_new(pattern);
+	whole_path = strchr(pattern, G_DIR_SEPARATOR) != NULL;
+	for (i = index->entries->len; i-- > 0; )
+	{
+		const FileEntry *entry = &g_array_index(index->entries, FileEntry, i);
+
+		if (! entry->removed && g_pattern_match_string(spec,
+				whole_path ? entry->path : entry->path + entry->base))
+			paths = g_slist_prepend(paths, (gpointer) entry->path);
+	}
+	g_pattern_spec_free(spec);
+	return paths;
+}
+
+
+/* Calls func on the path of each file, in the order they were found */
+void gp_file_index_foreach(GpFileIndex *index, GpFileIndexForeachFunc func,
+	gpointer user_data)
+{
+	guint i;
+
+	for (i = 0; i < index->entries->len; i++)
+	{
+		const FileEntry *entry = &g_array_index(index->entries, FileEntry, i);
+
+		if (! entry->removed)
+			func(entry->path, user_data);
+	}
+}
@@ -0,0 +1,74 @@
+/*
+ * fileindex.h - index of the files under a directory, shared by the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_FILEINDEX_H
+#define GP_FILEINDEX_H
+
+#include <geanyplugin.h>
+
+G_BEGIN_DECLS
+
+
+/* The files under a directory, walked in the background and monitored
+ * afterwards.  There is one index per directory for all the plugins: the
+ * plugins referencing the same directory share it.  Hidden files and
+ * directories are skipped, and links to directories are not followed.
+ *
+ * The index starts with the files saved in its cache by the previous
+ * session, then the walk only reads the directories which changed since.
+ *
+ * The paths given by an index are relative to its root, in UTF-8, and only
+ * valid until the index changes. */
+typedef struct GpFileIndex GpFileIndex;
+
+typedef struct GpFileIndexMatch
+{
+	const gchar *path;
+	gint score;
+} GpFileIndexMatch;
+
+/* Called when files were added to or removed from the index */
+typedef void (*GpFileIndexChangedFunc)(GpFileIndex *index, gpointer user_data);
+typedef void (*GpFileIndexForeachFunc)(const gchar *path, gpointer user_data);
+
+GpFileIndex *gp_file_index_ref(GeanyPlugin *plugin, const gchar *root);
+void gp_file_index_unref(GpFileIndex *index);
+
+gulong gp_file_index_subscribe(GpFileIndex *index, GpFileIndexChangedFunc func,
+	gpointer user_data);
+void gp_file_index_unsubscribe(GpFileIndex *index, gulong id);
+
+const gchar *gp_file_index_get_root(GpFileIndex *index);
+gboolean gp_file_index_is_building(GpFileIndex *index);
+guint gp_file_index_get_size(GpFileIndex *index);
+guint gp_file_index_get_generation(GpFileIndex *index);
+
+guint gp_file_index_query(GpFileIndex *index, const gchar *query,
+	GpFileIndexMatch *matches, guint max_matches);
+GSList *gp_file_index_find_by_stem(GpFileIndex *index, const gchar *stem);
+GSList *gp_file_index_find_by_basename(GpFileIndex *index, const gchar *basename);
+GSList *gp_file_index_find_by_prefix(GpFileIndex *index, const gchar *prefix);
+GSList *gp_file_index_find_by_glob(GpFileIndex *index, const gchar *pattern);
+void gp_file_index_foreach(GpFileIndex *index, GpFileIndexForeachFunc func,
+	gpointer user_data);
+
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,377 @@
+/*
+ * idlesched.c - idle work and worker threads shared by the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <geanyplugin.h>
+
+#include "idlesched.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+
+
+/* The scheduler is kept on the main window, every plugin linking this file
+ * reaches it there.  Its idle callback and worker threads run the code of
+ * the plugin which created it, which stays loaded. */
+#define REGISTRY_KEY "geany-plugins-idle-scheduler-1"
+
+#define WORKER_THREADS 2
+
+typedef struct
+{
+	guint id;
+	GeanyPlugin *plugin;
+	GpSchedPriority priority;
+	GeanyDocument *doc;
+	GpSchedFunc func;
+	gpointer user_data;
+	GDestroyNotify notify;
+	gboolean running;
+	gboolean removed;	/* while running, freed once it returns */
+} Task;
+
+typedef struct
+{
+	GeanyPlugin *plugin;
+	GeanyDocument *doc;
+	GpSchedWorkFunc work;
+	GpSchedDoneFunc done;
+	gpointer user_data;
+	volatile gint cancelled;
+} Job;
+
+typedef struct
+{
+	GList *tasks;		/* Task, in the order they take turns */
+	GList *jobs;		/* Job, queued or running */
+	guint next_id;
+	guint source;
+	gint64 deadline;	/* in microseconds, 0 outside of the idle callback */
+	GThreadPool *pool;
+	gulong close_handler;
+} Scheduler;
+
+
+static gint64 now(void)
+{
+#if GLIB_CHECK_VERSION(2, 28, 0)
+	return g_get_monotonic_time();
+#else
+	GTimeVal tv;
+
+	g_get_current_time(&tv);
+	return (gint64) tv.tv_sec * G_USEC_PER_SEC + tv.tv_usec;
+#endif
+}
+
+
+static Scheduler *lookup_scheduler(void)
+{
+	return g_object_get_data(G_OBJECT(geany_data->main_widgets->window), REGISTRY_KEY);
+}
+
+
+static void task_free(Scheduler *sched, Task *task)
+{
+	sched->tasks = g_list_remove(sched->tasks, task);
+	if (task->notify != NULL)
+		task->notify(task->user_data);
+	g_free(task);
+}
+
+
+static void task_remove(Scheduler *sched, Task *task)
+{
+	if (task->running)
+		task->removed = TRUE;
+	else
+		task_free(sched, task);
+}
+
+
+/* The tasks of the current document first, then by priority.  Among equals,
+ * the first in the list, as a task goes to the end once it ran. */
+static Task *pick_task(Scheduler *sched)
+{
+	GeanyDocument *current = document_get_current();
+	Task *best = NULL;
+	gint best_rank = G_MAXINT;
+	GList *node, *next;
+
+	for (node = sched->tasks; node != NULL; node = next)
+	{
+		Task *task = node->data;
+		gint rank;
+
+		next = node->next;
+		/* in case the document was closed without us knowing */
+		if (task->doc != NULL && ! task->doc->is_valid)
+		{
+			task_free(sched, task);
+			continue;
+		}
+
+		rank = task->priority;
+		if (task->doc == NULL || task->doc != current)
+			rank += GP_SCHED_PRIORITY_LOW + 1;
+		if (rank < best_rank)
+		{
+			best = task;
+			best_rank = rank;
+		}
+	}
+	return best;
+}
+
+
+static gboolean on_idle(gpointer data)
+{
+	Scheduler *sched = data;
+
+	sched->deadline = now() + GP_SCHED_FRAME_BUDGET * 1000;
+	do
+	{
+		Task *task = pick_task(sched);
+		gboolean more;
+
+		if (task == NULL)
+			break;
+
+		sched->tasks = g_list_remove(sched->tasks, task);
+		sched->tasks = g_list_append(sched->tasks, task);
+		task->running = TRUE;
+		more = task->func(task->user_data);
+		task->running = FALSE;
+		if (! more || task->removed)
+			task_free(sched, task);
+	}
+	while (! gp_sched_should_yield());
+	sched->deadline = 0;
+
+	if (sched->tasks == NULL)
+	{
+		sched->source = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+static void on_document_close(GObject *object, GeanyDocument *doc, gpointer data)
+{
+	gp_sched_cancel_document(doc);
+}
+
+
+/* Runs in a worker thread */
+static void run_job(gpointer data, gpointer user_data);
+
+
+static void free_scheduler(gpointer data)
+{
+	Scheduler *sched = data;
+
+	if (sched->source != 0)
+		g_source_remove(sched->source);
+	g_signal_handler_disconnect(geany_data->object, sched->close_handler);
+	while (sched->tasks != NULL)
+	{
+		g_free(sched->tasks->data);
+		sched->tasks = g_list_delete_link(sched->tasks, sched->tasks);
+	}
+	/* the running jobs finish on their own, and are not reported */
+	g_thread_pool_free(sched->pool, TRUE, FALSE);
+	g_list_free(sched->jobs);
+	g_free(sched);
+}
+
+
+static Scheduler *get_scheduler(GeanyPlugin *plugin)
+{
+	Scheduler *sched = lookup_scheduler();
+
+	if (sched == NULL)
+	{
+		if (! g_thread_supported())
+			g_thread_init(NULL);
+
+		sched = g_new0(Scheduler, 1);
+		sched->next_id = 1;
+		sched->pool = g_thread_pool_new(run_job, NULL, WORKER_THREADS, FALSE, NULL);
+		g_object_set_data_full(G_OBJECT(geany_data->main_widgets->window), REGISTRY_KEY,
+			sched, free_scheduler);
+
+		/* not plugin_signal_connect(), the handler would leave with the plugin
+		 * creating the scheduler while the others still use it */
+		plugin_module_make_resident(plugin);
+		sched->close_handler = g_signal_connect(geany_data->object, "document-close",
+			G_CALLBACK(on_document_close), NULL);
+	}
+	return sched;
+}
+
+
+guint gp_sched_add(GeanyPlugin *plugin, GpSchedPriority priority, GeanyDocument *doc,
+	GpSchedFunc func, gpointer user_data, GDestroyNotify notify)
+{
+	Scheduler *sched;
+	Task *task;
+
+	g_return_val_if_fail(plugin != NULL, 0);
+	g_return_val_if_fail(func != NULL, 0);
+	g_return_val_if_fail(doc == NULL || DOC_VALID(doc), 0);
+
+	sched = get_scheduler(plugin);
+	task = g_new0(Task, 1);
+	task->id = sched->next_id++;
+	task->plugin = plugin;
+	task->priority = priority;
+	task->doc = doc;
+	task->func = func;
+	task->user_data = user_data;
+	task->notify = notify;
+	sched->tasks = g_list_append(sched->tasks, task);
+
+	if (sched->source == 0)
+		sched->source = g_idle_add(on_idle, sched);
+	return task->id;
+}
+
+
+void gp_sched_remove(guint id)
+{
+	Scheduler *sched = lookup_scheduler();
+	GList *node;
+
+	for (node = sched ? sched->tasks : NULL; node != NULL; node = node->next)
+	{
+		Task *task = node->data;
+
+		if (task->id == id)
+		{
+			task_remove(sched, task);
+			return;
+		}
+	}
+}
+
+
+/* Whether the task should return and let the UI run, TRUE outside of the
+ * scheduler's idle callback */
+gboolean gp_sched_should_yield(void)
+{
+	Scheduler *sched = lookup_scheduler();
+
+	return sched == NULL || sched->deadline == 0 || now() >= sched->deadline;
+}
+
+
+static gboolean on_job_done(gpointer data)
+{
+	Job *job = data;
+	Scheduler *sched = lookup_scheduler();
+
+	if (sched != NULL)
+	{
+		sched->jobs = g_list_remove(sched->jobs, job);
+		job->done(job->user_data, g_atomic_int_get(&job->cancelled));
+	}
+	g_free(job);
+
+	return FALSE;
+}
+
+
+static void run_job(gpointer data, gpointer user_data)
+{
+	Job *job = data;
+
+	if (! g_atomic_int_get(&job->cancelled))
+		job->work(job->user_data, &job->cancelled);
+	g_idle_add(on_job_done, job);
+}
+
+
+void gp_sched_run_in_thread(GeanyPlugin *plugin, GeanyDocument *doc,
+	GpSchedWorkFunc work, GpSchedDoneFunc done, gpointer user_data)
+{
+	Scheduler *sched;
+	Job *job;
+
+	g_return_if_fail(plugin != NULL);
+	g_return_if_fail(work != NULL && done != NULL);
+
+	sched = get_scheduler(plugin);
+	job = g_new0(Job, 1);
+	job->plugin = plugin;
+	job->doc = doc;
+	job->work = work;
+	job->done = done;
+	job->user_data = user_data;
+	sched->jobs = g_list_prepend(sched->jobs, job);
+	g_thread_pool_push(sched->pool, job, NULL);
+}
+
+
+static void cancel_matching(GeanyPlugin *plugin, GeanyDocument *doc)
+{
+	Scheduler *sched = lookup_scheduler();
+	GList *node, *next;
+
+	if (sched == NULL)
+		return;
+
+	for (node = sched->tasks; node != NULL; node = next)
+	{
+		Task *task = node->data;
+
+		next = node->next;
+		if ((plugin != NULL && task->plugin == plugin) || (doc != NULL && task->doc == doc))
+			task_remove(sched, task);
+	}
+	for (node = sched->jobs; node != NULL; node = node->next)
+	{
+		Job *job = node->data;
+
+		if ((plugin != NULL && job->plugin == plugin) || (doc != NULL && job->doc == doc))
+			g_atomic_int_set(&job->cancelled, TRUE);
+	}
+}
+
+
+/* Removes the tasks of doc, and cancels its jobs */
+void gp_sched_cancel_document(GeanyDocument *doc)
+{
+	g_return_if_fail(doc != NULL);
+
+	cancel_matching(NULL, doc);
+}
+
+
+/* Removes the tasks of plugin, and cancels its jobs: their done function is
+ * still called, with cancelled set */
+void gp_sched_cancel_plugin(GeanyPlugin *plugin)
+{
+	g_return_if_fail(plugin != NULL);
+
+	cancel_matching(plugin, NULL);
+}
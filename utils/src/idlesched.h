@@ -0,0 +1,74 @@
+/*
+ * idlesched.h - idle work and worker threads shared by the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_IDLESCHED_H
+#define GP_IDLESCHED_H
+
+#include <geanyplugin.h>
+
+G_BEGIN_DECLS
+
+
+/* One idle callback runs the background tasks of all the plugins, in turn,
+ * for at most GP_SCHED_FRAME_BUDGET per main loop iteration, so that several
+ * plugins having work at once (e.g. after a session is restored) don't run
+ * long callbacks back to back.  The tasks of the current document come
+ * first, then the others by priority, the ones of a same priority in turn.
+ *
+ * A task does a piece of its work each time it is called, checking
+ * gp_sched_should_yield() between small steps, and returns whether it has
+ * more to do.  The tasks given a document are cancelled when it is closed.
+ *
+ * A plugin must remove its tasks and jobs when unloaded, see
+ * gp_sched_cancel_plugin(); the plugin using the worker threads must stay
+ * loaded, see plugin_module_make_resident(). */
+#define GP_SCHED_FRAME_BUDGET 8		/* milliseconds */
+
+typedef enum
+{
+	GP_SCHED_PRIORITY_HIGH,
+	GP_SCHED_PRIORITY_DEFAULT,
+	GP_SCHED_PRIORITY_LOW
+} GpSchedPriority;
+
+/* Returns TRUE to be called again */
+typedef gboolean (*GpSchedFunc)(gpointer user_data);
+/* Called in a worker thread, it should return early once *cancelled is set
+ * (read it with g_atomic_int_get()) */
+typedef void (*GpSchedWorkFunc)(gpointer user_data, volatile gint *cancelled);
+/* Called in the main thread once the work is done or was cancelled, to use
+ * its result and free user_data */
+typedef void (*GpSchedDoneFunc)(gpointer user_data, gboolean cancelled);
+
+guint gp_sched_add(GeanyPlugin *plugin, GpSchedPriority priority, GeanyDocument *doc,
+	GpSchedFunc func, gpointer user_data, GDestroyNotify notify);
+void gp_sched_remove(guint id);
+gboolean gp_sched_should_yield(void);
+
+/* The computation must not use GTK, Geany or Scintilla */
+void gp_sched_run_in_thread(GeanyPlugin *plugin, GeanyDocument *doc,
+	GpSchedWorkFunc work, GpSchedDoneFunc done, gpointer user_data);
+
+void gp_sched_cancel_document(GeanyDocument *doc);
+void gp_sched_cancel_plugin(GeanyPlugin *plugin);
+
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * largefile.c - throttling of the plugins' work on large documents
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <geanyplugin.h>
+
+#include "largefile.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+
+
+/* The features of all the plugins are kept on the main window, every plugin
+ * linking this file reaches them there.  The indicator is updated by the
+ * code of the plugin which registered first, which stays loaded. */
+#define REGISTRY_KEY "geany-plugins-large-file-1"
+
+typedef struct
+{
+	GeanyPlugin *plugin;
+	gchar *name;
+	GpLargeFilePolicy policy;
+} Feature;
+
+typedef struct
+{
+	GList *features;
+	GtkWidget *indicator;	/* NULL without a status bar */
+} Registry;
+
+
+static Registry *lookup_registry(void)
+{
+	return g_object_get_data(G_OBJECT(geany_data->main_widgets->window), REGISTRY_KEY);
+}
+
+
+/* Only asks Scintilla for its length and line count, which are known */
+gboolean gp_large_file_check(GeanyDocument *doc)
+{
+	ScintillaObject *sci;
+	gint length;
+
+	g_return_val_if_fail(DOC_VALID(doc), FALSE);
+
+	sci = doc->editor->sci;
+	length = sci_get_length(sci);
+	if (length >= GP_LARGE_FILE_SIZE)
+		return TRUE;
+	return length >= GP_LARGE_FILE_LONG_LINES_SIZE &&
+		length / sci_get_line_count(sci) >= GP_LARGE_FILE_LINE_LENGTH;
+}
+
+
+static const gchar *get_policy_name(GpLargeFilePolicy policy)
+{
+	switch (policy)
+	{
+		case GP_LARGE_FILE_VIEWPORT_ONLY: return _("visible part only");
+		case GP_LARGE_FILE_IDLE_ONLY: return _("not while typing");
+		case GP_LARGE_FILE_DISABLED: return _("disabled");
+	}
+	return "";
+}
+
+
+static void update_indicator(GeanyDocument *doc)
+{
+	Registry *registry = lookup_registry();
+	GString *tooltip;
+	GList *node;
+	gchar *text;
+
+	if (registry == NULL || registry->indicator == NULL)
+		return;
+
+	if (registry->features == NULL || ! DOC_VALID(doc) || ! gp_large_file_check(doc))
+	{
+		gtk_widget_hide(registry->indicator);
+		return;
+	}
+
+	tooltip = g_string_new(_("Large file, throttled:"));
+	for (node = registry->features; node != NULL; node = node->next)
+	{
+		Feature *feature = node->data;
+
+		g_string_append_printf(tooltip, "\n%s: %s", feature->name,
+			get_policy_name(feature->policy));
+	}
+	text = g_strdup_printf(ngettext("Large file: %u feature throttled",
+		"Large file: %u features throttled", g_list_length(registry->features)),
+		g_list_length(registry->features));
+	gtk_label_set_text(GTK_LABEL(registry->indicator), text);
+	ui_widget_set_tooltip_text(registry->indicator, tooltip->str);
+	gtk_widget_show(registry->indicator);
+	g_free(text);
+	g_string_free(tooltip, TRUE);
+}
+
+
+static void on_document_changed(GObject *object, GeanyDocument *doc, gpointer data)
+{
+	if (doc == document_get_current())
+		update_indicator(doc);
+}
+
+
+static void feature_free(Feature *feature)
+{
+	g_free(feature->name);
+	g_free(feature);
+}
+
+
+static void free_registry(gpointer data)
+{
+	Registry *registry = data;
+
+	g_signal_handlers_disconnect_by_func(geany_data->object, on_document_changed, NULL);
+	g_list_foreach(registry->features, (GFunc) feature_free, NULL);
+	g_list_free(registry->features);
+	g_free(registry);
+}
+
+
+static Registry *get_registry(GeanyPlugin *plugin)
+{
+	Registry *registry = lookup_registry();
+
+	if (registry == NULL)
+	{
+		GtkWidget *statusbar = ui_lookup_widget(geany_data->main_widgets->window, "statusbar");
+
+		registry = g_new0(Registry, 1);
+		g_object_set_data_full(G_OBJECT(geany_data->main_widgets->window), REGISTRY_KEY,
+			registry, free_registry);
+
+		if (statusbar != NULL)
+		{
+			registry->indicator = gtk_label_new(NULL);
+			gtk_box_pack_end(GTK_BOX(statusbar), registry->indicator, FALSE, FALSE, 4);
+		}
+
+		/* the handlers stay when the plugin creating the registry unloads */
+		plugin_module_make_resident(plugin);
+		g_signal_connect_after(geany_data->object, "document-activate",
+			G_CALLBACK(on_document_changed), NULL);
+		g_signal_connect_after(geany_data->object, "document-open",
+			G_CALLBACK(on_document_changed), NULL);
+		g_signal_connect_after(geany_data->object, "document-reload",
+			G_CALLBACK(on_document_changed), NULL);
+		g_signal_connect_after(geany_data->object, "document-save",
+			G_CALLBACK(on_document_changed), NULL);
+	}
+	return registry;
+}
+
+
+void gp_large_file_register(GeanyPlugin *plugin, const gchar *feature,
+	GpLargeFilePolicy policy)
+{
+	Registry *registry;
+	Feature *f;
+
+	g_return_if_fail(plugin != NULL);
+	g_return_if_fail(feature != NULL);
+
+	registry = get_registry(plugin);
+	f = g_new0(Feature, 1);
+	f->plugin = plugin;
+	f->name = g_strdup(feature);
+	f->policy = policy;
+	registry->features = g_list_append(registry->features, f);
+
+	update_indicator(document_get_current());
+}
+
+
+/* Removes the features of plugin, to be called when it is unloaded */
+void gp_large_file_unregister(GeanyPlugin *plugin)
+{
+	Registry *registry = lookup_registry();
+	GList *node, *next;
+
+	if (registry == NULL)
+		return;
+
+	for (node = registry->features; node != NULL; node = next)
+	{
+		Feature *feature = node->data;
+
+		next = node->next;
+		if (feature->plugin == plugin)
+		{
+			feature_free(feature);
+			registry->features = g_list_delete_link(registry->features, node);
+		}
+	}
+	update_indicator(document_get_current());
+}
@@ -0,0 +1,56 @@
+/*
+ * largefile.h - throttling of the plugins' work on large documents
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_LARGEFILE_H
+#define GP_LARGEFILE_H
+
+#include <geanyplugin.h>
+
+G_BEGIN_DECLS
+
+
+/* A document is large when it holds at least GP_LARGE_FILE_SIZE bytes, or
+ * at least GP_LARGE_FILE_LONG_LINES_SIZE bytes in lines of
+ * GP_LARGE_FILE_LINE_LENGTH bytes on average (e.g. minified code).  The
+ * features whose work per keystroke or caret move grows with the size of
+ * the document register how they degrade on large documents, and apply it
+ * when gp_large_file_check() says so.  An indicator in the status bar lists
+ * what is throttled while the current document is large. */
+#define GP_LARGE_FILE_SIZE				(4 * 1024 * 1024)
+#define GP_LARGE_FILE_LONG_LINES_SIZE	(256 * 1024)
+#define GP_LARGE_FILE_LINE_LENGTH		4096
+
+typedef enum
+{
+	GP_LARGE_FILE_VIEWPORT_ONLY,	/* only the visible part is handled */
+	GP_LARGE_FILE_IDLE_ONLY,		/* not while typing, but later on */
+	GP_LARGE_FILE_DISABLED
+} GpLargeFilePolicy;
+
+gboolean gp_large_file_check(GeanyDocument *doc);
+
+/* feature is shown in the indicator, e.g. _("Spell check while typing") */
+void gp_large_file_register(GeanyPlugin *plugin, const gchar *feature,
+	GpLargeFilePolicy policy);
+void gp_large_file_unregister(GeanyPlugin *plugin);
+
+
+G_END_DECLS
+
+#endif
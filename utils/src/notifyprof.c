@@ -0,0 +1,339 @@
+/*
+ * notifyprof.c - latency of the plugins' editor notification handlers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <geanyplugin.h>
+
+#include "notifyprof.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+
+
+/* The measures of all the plugins are kept in one table on the main window,
+ * every plugin linking this file reaches it there.  The entries only hold
+ * plain memory, so that the table can be freed whichever plugin is left. */
+#define REGISTRY_KEY "geany-plugins-notify-profile-1"
+
+/* latencies kept for the percentiles, the last ones of each entry */
+#define PROFILE_SAMPLES 512
+
+typedef struct
+{
+	guint calls;
+	gint64 total;		/* microseconds */
+	gint64 max;
+	gint32 samples[PROFILE_SAMPLES];	/* ring, calls % PROFILE_SAMPLES is next */
+} NotifyStats;
+
+enum
+{
+	COL_PLUGIN,
+	COL_CODE,
+	COL_CALLS,
+	COL_TOTAL,
+	COL_P50,
+	COL_P99,
+	COL_MAX,
+	N_COLUMNS
+};
+
+static const struct
+{
+	gint code;
+	const gchar *name;
+} code_names[] = {
+	{ SCN_STYLENEEDED, "SCN_STYLENEEDED" },
+	{ SCN_CHARADDED, "SCN_CHARADDED" },
+	{ SCN_SAVEPOINTREACHED, "SCN_SAVEPOINTREACHED" },
+	{ SCN_SAVEPOINTLEFT, "SCN_SAVEPOINTLEFT" },
+	{ SCN_MODIFYATTEMPTRO, "SCN_MODIFYATTEMPTRO" },
+	{ SCN_KEY, "SCN_KEY" },
+	{ SCN_DOUBLECLICK, "SCN_DOUBLECLICK" },
+	{ SCN_UPDATEUI, "SCN_UPDATEUI" },
+	{ SCN_MODIFIED, "SCN_MODIFIED" },
+	{ SCN_MACRORECORD, "SCN_MACRORECORD" },
+	{ SCN_MARGINCLICK, "SCN_MARGINCLICK" },
+	{ SCN_NEEDSHOWN, "SCN_NEEDSHOWN" },
+	{ SCN_PAINTED, "SCN_PAINTED" },
+	{ SCN_USERLISTSELECTION, "SCN_USERLISTSELECTION" },
+	{ SCN_URIDROPPED, "SCN_URIDROPPED" },
+	{ SCN_DWELLSTART, "SCN_DWELLSTART" },
+	{ SCN_DWELLEND, "SCN_DWELLEND" },
+	{ SCN_ZOOM, "SCN_ZOOM" },
+	{ SCN_HOTSPOTCLICK, "SCN_HOTSPOTCLICK" },
+	{ SCN_HOTSPOTDOUBLECLICK, "SCN_HOTSPOTDOUBLECLICK" },
+	{ SCN_CALLTIPCLICK, "SCN_CALLTIPCLICK" },
+	{ SCN_AUTOCSELECTION, "SCN_AUTOCSELECTION" },
+	{ SCN_INDICATORCLICK, "SCN_INDICATORCLICK" },
+	{ SCN_INDICATORRELEASE, "SCN_INDICATORRELEASE" },
+	{ SCN_AUTOCCANCELLED, "SCN_AUTOCCANCELLED" },
+	{ SCN_AUTOCCHARDELETED, "SCN_AUTOCCHARDELETED" }
+};
+
+static gint enabled = -1;
+
+
+static gint64 now(void)
+{
+#if GLIB_CHECK_VERSION(2, 28, 0)
+	return g_get_monotonic_time();
+#else
+	GTimeVal tv;
+
+	g_get_current_time(&tv);
+	return (gint64) tv.tv_sec * G_USEC_PER_SEC + tv.tv_usec;
+#endif
+}
+
+
+gboolean gp_notify_profile_enabled(void)
+{
+	if (enabled < 0)
+	{
+		const gchar *value = g_getenv(GP_NOTIFY_PROFILE_ENV);
+
+		enabled = value != NULL && *value != '\0' && strcmp(value, "0") != 0;
+	}
+	return enabled;
+}
+
+
+static const gchar *get_code_name(gint code, gchar *buf, gsize size)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(code_names); i++)
+	{
+		if (code_names[i].code == code)
+			return code_names[i].name;
+	}
+	g_snprintf(buf, size, "%d", code);
+	return buf;
+}
+
+
+static gint compare_samples(const void *a, const void *b)
+{
+	gint32 sa = *(const gint32 *) a;
+	gint32 sb = *(const gint32 *) b;
+
+	return sa < sb ? -1 : sa > sb;
+}
+
+
+static gdouble to_ms(gint64 usec)
+{
+	return usec / 1000.0;
+}
+
+
+static void add_row(gpointer key, gpointer value, gpointer user_data)
+{
+	GtkListStore *store = user_data;
+	NotifyStats *stats = value;
+	gchar **parts = g_strsplit(key, "\t", 2);
+	guint n = MIN(stats->calls, PROFILE_SAMPLES);
+	gint32 sorted[PROFILE_SAMPLES];
+	gchar buf[16];
+	GtkTreeIter iter;
+
+	memcpy(sorted, stats->samples, n * sizeof(gint32));
+	qsort(sorted, n, sizeof(gint32), compare_samples);
+
+	gtk_list_store_append(store, &iter);
+	gtk_list_store_set(store, &iter,
+		COL_PLUGIN, parts[0],
+		COL_CODE, get_code_name(atoi(parts[1]), buf, sizeof(buf)),
+		COL_CALLS, stats->calls,
+		COL_TOTAL, to_ms(stats->total),
+		COL_P50, to_ms(sorted[(n - 1) * 50 / 100]),
+		COL_P99, to_ms(sorted[(n - 1) * 99 / 100]),
+		COL_MAX, to_ms(stats->max),
+		-1);
+	g_strfreev(parts);
+}
+
+
+static void fill_store(GtkListStore *store)
+{
+	GHashTable *registry = g_object_get_data(G_OBJECT(geany_data->main_widgets->window),
+		REGISTRY_KEY);
+
+	gtk_list_store_clear(store);
+	if (registry != NULL)
+		g_hash_table_foreach(registry, add_row, store);
+}
+
+
+static void render_ms(GtkTreeViewColumn *column, GtkCellRenderer *cell,
+	GtkTreeModel *model, GtkTreeIter *iter, gpointer data)
+{
+	gdouble ms;
+	gchar *text;
+
+	gtk_tree_model_get(model, iter, GPOINTER_TO_INT(data), &ms, -1);
+	text = g_strdup_printf("%.3f", ms);
+	g_object_set(cell, "text", text, NULL);
+	g_free(text);
+}
+
+
+static void add_column(GtkTreeView *view, const gchar *title, gint col)
+{
+	GtkCellRenderer *cell = gtk_cell_renderer_text_new();
+	GtkTreeViewColumn *column;
+
+	if (col <= COL_CODE)
+		column = gtk_tree_view_column_new_with_attributes(title, cell, "text", col, NULL);
+	else
+	{
+		g_object_set(cell, "xalign", 1.0, NULL);
+		column = gtk_tree_view_column_new_with_attributes(title, cell, NULL);
+		if (col == COL_CALLS)
+			gtk_tree_view_column_add_attribute(column, cell, "text", col);
+		else
+			gtk_tree_view_column_set_cell_data_func(column, cell, render_ms,
+				GINT_TO_POINTER(col), NULL);
+	}
+	gtk_tree_view_column_set_sort_column_id(column, col);
+	gtk_tree_view_column_set_resizable(column, TRUE);
+	gtk_tree_view_append_column(view, column);
+}
+
+
+static void on_show_timings(GtkMenuItem *item, gpointer user_data)
+{
+	GtkWidget *dialog, *swin, *view;
+	GtkListStore *store;
+
+	dialog = gtk_dialog_new_with_buttons(_("Editor Notification Timings"),
+		GTK_WINDOW(geany_data->main_widgets->window), GTK_DIALOG_DESTROY_WITH_PARENT,
+		GTK_STOCK_CLEAR, GTK_RESPONSE_REJECT, GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE, NULL);
+	gtk_window_set_default_size(GTK_WINDOW(dialog), 640, 400);
+
+	store = gtk_list_store_new(N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_UINT,
+		G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE);
+	gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(store), COL_TOTAL,
+		GTK_SORT_DESCENDING);
+	view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+	g_object_unref(store);
+
+	add_column(GTK_TREE_VIEW(view), _("Plugin"), COL_PLUGIN);
+	add_column(GTK_TREE_VIEW(view), _("Notification"), COL_CODE);
+	add_column(GTK_TREE_VIEW(view), _("Calls"), COL_CALLS);
+	add_column(GTK_TREE_VIEW(view), _("Total (ms)"), COL_TOTAL);
+	add_column(GTK_TREE_VIEW(view), _("p50 (ms)"), COL_P50);
+	add_column(GTK_TREE_VIEW(view), _("p99 (ms)"), COL_P99);
+	add_column(GTK_TREE_VIEW(view), _("Max (ms)"), COL_MAX);
+
+	swin = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(swin), GTK_POLICY_AUTOMATIC,
+		GTK_POLICY_AUTOMATIC);
+	gtk_container_add(GTK_CONTAINER(swin), view);
+	gtk_box_pack_start(GTK_BOX(GTK_DIALOG(dialog)->vbox), swin, TRUE, TRUE, 0);
+	gtk_widget_show_all(dialog);
+
+	fill_store(store);
+	while (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_REJECT)
+	{
+		GHashTable *registry = g_object_get_data(
+			G_OBJECT(geany_data->main_widgets->window), REGISTRY_KEY);
+
+		if (registry != NULL)
+			g_hash_table_remove_all(registry);
+		fill_store(store);
+	}
+	gtk_widget_destroy(dialog);
+}
+
+
+/* The first plugin measuring creates the table and the menu item, and stays
+ * loaded since the menu item runs its code. */
+static GHashTable *get_registry(GeanyPlugin *plugin)
+{
+	GObject *window = G_OBJECT(geany_data->main_widgets->window);
+	GHashTable *registry = g_object_get_data(window, REGISTRY_KEY);
+
+	if (registry == NULL)
+	{
+		GtkWidget *item;
+
+		registry = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+		g_object_set_data_full(window, REGISTRY_KEY, registry,
+			(GDestroyNotify) g_hash_table_destroy);
+
+		plugin_module_make_resident(plugin);
+		item = gtk_menu_item_new_with_mnemonic(_("Editor _Notification Timings"));
+		gtk_container_add(GTK_CONTAINER(geany_data->main_widgets->tools_menu), item);
+		g_signal_connect(item, "activate", G_CALLBACK(on_show_timings), NULL);
+		gtk_widget_show(item);
+	}
+	return registry;
+}
+
+
+void gp_notify_profile_start(GpNotifyTimer *timer, GeanyPlugin *plugin,
+	const SCNotification *nt)
+{
+	if (! gp_notify_profile_enabled())
+	{
+		timer->plugin = NULL;
+		return;
+	}
+
+	timer->plugin = plugin;
+	timer->code = nt->nmhdr.code;
+	timer->start = now();
+}
+
+
+void gp_notify_profile_stop(GpNotifyTimer *timer)
+{
+	GHashTable *registry;
+	NotifyStats *stats;
+	gint64 elapsed;
+	gchar *key;
+
+	if (timer->plugin == NULL)
+		return;
+
+	elapsed = now() - timer->start;
+	registry = get_registry(timer->plugin);
+	key = g_strdup_printf("%s\t%d", timer->plugin->info->name, timer->code);
+	stats = g_hash_table_lookup(registry, key);
+	if (stats == NULL)
+	{
+		stats = g_new0(NotifyStats, 1);
+		g_hash_table_insert(registry, key, stats);
+	}
+	else
+		g_free(key);
+
+	stats->samples[stats->calls % PROFILE_SAMPLES] = (gint32) MIN(elapsed, G_MAXINT32);
+	stats->calls++;
+	stats->total += elapsed;
+	stats->max = MAX(stats->max, elapsed);
+}
@@ -0,0 +1,65 @@
+/*
+ * notifyprof.h - latency of the plugins' editor notification handlers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_NOTIFYPROF_H
+#define GP_NOTIFYPROF_H
+
+#include <geanyplugin.h>
+
+G_BEGIN_DECLS
+
+
+/* Environment variable enabling the measures when set to a non-empty value
+ * other than "0".  When enabled, Tools->Editor Notification Timings shows the
+ * number of calls and the latencies of each plugin's handler, per
+ * notification code.  When disabled, a measure only costs a test. */
+#define GP_NOTIFY_PROFILE_ENV "GEANY_PLUGINS_PROFILE_NOTIFY"
+
+typedef struct GpNotifyTimer
+{
+	GeanyPlugin *plugin;
+	gint code;
+	gint64 start;		/* in microseconds, 0 when not measuring */
+} GpNotifyTimer;
+
+gboolean gp_notify_profile_enabled(void);
+void gp_notify_profile_start(GpNotifyTimer *timer, GeanyPlugin *plugin,
+	const SCNotification *nt);
+void gp_notify_profile_stop(GpNotifyTimer *timer);
+
+/* Defines wrapper, measuring handler, for plugin_callbacks[] or
+ * plugin_signal_connect().  handler is an "editor-notify" handler, declared
+ * before; the plugin must define geany_plugin. */
+#define GP_NOTIFY_PROFILE_EDITOR_HANDLER(wrapper, handler) \
+	static gboolean wrapper(GObject *object, GeanyEditor *editor, \
+		SCNotification *nt, gpointer data) \
+	{ \
+		GpNotifyTimer timer; \
+		gboolean ret; \
+		\
+		gp_notify_profile_start(&timer, geany_plugin, nt); \
+		ret = handler(object, editor, nt, data); \
+		gp_notify_profile_stop(&timer); \
+		return ret; \
+	}
+
+
+G_END_DECLS
+
+#endif
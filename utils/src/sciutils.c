@@ -0,0 +1,312 @@
+/*
+ * sciutils.c - bulk access to the Scintilla buffer, shared by the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <geanyplugin.h>
+
+#include "sciutils.h"
+
+extern GeanyFunctions *geany_functions;
+
+
+/* size of the windows of a reader, the ones next to the gap may be smaller */
+#define READER_WINDOW_SIZE 4096
+
+#define SSM(s, m, w, l) scintilla_send_message(s, m, w, l)
+
+
+void gp_sci_reader_init(GpSciReader *reader, ScintillaObject *sci)
+{
+	reader->sci = sci;
+	gp_sci_reader_reset(reader);
+}
+
+
+/* forgets the window, to be called after the buffer was modified */
+void gp_sci_reader_reset(GpSciReader *reader)
+{
+	reader->length = (gint) SSM(reader->sci, SCI_GETLENGTH, 0, 0);
+	reader->start = 0;
+	reader->end = 0;
+	reader->text = NULL;
+}
+
+
+/* Makes the window cover pos, aligned on the window size and cut at the gap.
+ * Returns FALSE if pos is outside of the buffer. */
+static gboolean reader_fill(GpSciReader *reader, gint pos)
+{
+	gint gap;
+
+	if (pos < 0 || pos >= reader->length)
+		return FALSE;
+
+	reader->start = pos - pos % READER_WINDOW_SIZE;
+	reader->end = MIN(reader->start + READER_WINDOW_SIZE, reader->length);
+
+	/* the part before the gap and the part after it are both contiguous */
+	gap = (gint) SSM(reader->sci, SCI_GETGAPPOSITION, 0, 0);
+	if (gap > reader->start && gap < reader->end)
+	{
+		if (pos < gap)
+			reader->end = gap;
+		else
+			reader->start = gap;
+	}
+
+	reader->text = (const gchar *) SSM(reader->sci, SCI_GETRANGEPOINTER,
+		reader->start, reader->end - reader->start);
+	return reader->text != NULL;
+}
+
+
+/* Returns the character at pos, or '\0' outside of the buffer, like SCI_GETCHARAT */
+gchar gp_sci_reader_char_at(GpSciReader *reader, gint pos)
+{
+	if (pos >= reader->start && pos < reader->end)
+		return reader->text[pos - reader->start];
+
+	return reader_fill(reader, pos) ? reader->text[pos - reader->start] : '\0';
+}
+
+
+/* Returns the window covering pos and sets its range in start and end, or
+ * returns NULL if pos is outside of the buffer.  Scanning a range a window
+ * at a time avoids the test of gp_sci_reader_char_at() on each character. */
+const gchar *gp_sci_reader_window(GpSciReader *reader, gint pos, gint *start, gint *end)
+{
+	if (pos < reader->start || pos >= reader->end)
+	{
+		if (! reader_fill(reader, pos))
+			return NULL;
+	}
+
+	*start = reader->start;
+	*end = reader->end;
+	return reader->text;
+}
+
+
+/* Returns a pointer to the text from start to end in Scintilla's buffer,
+ * valid until the buffer is modified.  Unlike SCI_GETCHARACTERPOINTER, only
+ * moves the gap of the buffer if it is inside the range. */
+const gchar *gp_sci_get_range_pointer(ScintillaObject *sci, gint start, gint end)
+{
+	return (const gchar *) SSM(sci, SCI_GETRANGEPOINTER, start, end - start);
+}
+
+
+/* Fetches the characters and the styles from start to end into range */
+void gp_sci_styled_range_fetch(GpSciStyledRange *range, ScintillaObject *sci,
+	gint start, gint end)
+{
+	struct Sci_TextRange tr;
+	/* two terminating NULs */
+	gsize size = 2 * (gsize) (end - start) + 2;
+
+	if (range->size < size)
+	{
+		g_free(range->cells);
+		range->cells = g_malloc(size);
+		range->size = size;
+	}
+
+	range->start = start;
+	range->end = end;
+	tr.chrg.cpMin = start;
+	tr.chrg.cpMax = end;
+	tr.lpstrText = range->cells;
+	SSM(sci, SCI_GETSTYLEDTEXT, 0, (sptr_t) &tr);
+}
+
+
+void gp_sci_styled_range_clear(GpSciStyledRange *range)
+{
+	g_free(range->cells);
+	range->cells = NULL;
+	range->size = 0;
+	range->start = range->end = 0;
+}
+
+
+/* Gets the text and the styles from start to end in one message.  Both are
+ * newly allocated and NUL-terminated, styles[i] is the style of text[i]. */
+void gp_sci_get_styled_text(ScintillaObject *sci, gint start, gint end,
+	gchar **text, guchar **styles)
+{
+	GpSciStyledRange range = GP_SCI_STYLED_RANGE_INIT;
+	gint length = end - start;
+	gint i;
+
+	gp_sci_styled_range_fetch(&range, sci, start, end);
+
+	*text = g_malloc(length + 1);
+	*styles = g_malloc(length + 1);
+	for (i = 0; i < length; i++)
+	{
+		(*text)[i] = range.cells[2 * i];
+		(*styles)[i] = (guchar) range.cells[2 * i + 1];
+	}
+	(*text)[length] = '\0';
+	(*styles)[length] = 0;
+
+	gp_sci_styled_range_clear(&range);
+}
+
+
+typedef struct
+{
+	gint start;
+	gint end;
+	guint order;	/* keeps the insertions at the same position in order */
+	gchar *text;
+	gint length;
+} SciEdit;
+
+struct GpSciEdits
+{
+	GArray *edits;
+};
+
+
+GpSciEdits *gp_sci_edits_new(void)
+{
+	GpSciEdits *edits = g_new(GpSciEdits, 1);
+
+	edits->edits = g_array_new(FALSE, FALSE, sizeof(SciEdit));
+	return edits;
+}
+
+
+static void edits_clear(GpSciEdits *edits)
+{
+	guint i;
+
+	for (i = 0; i < edits->edits->len; i++)
+		g_free(g_array_index(edits->edits, SciEdit, i).text);
+	g_array_set_size(edits->edits, 0);
+}
+
+
+void gp_sci_edits_free(GpSciEdits *edits)
+{
+	edits_clear(edits);
+	g_array_free(edits->edits, TRUE);
+	g_free(edits);
+}
+
+
+/* Replaces the text from start to end with text, which may be NULL to delete.
+ * Positions are in the buffer before any of the edits is applied, and the
+ * replaced ranges must not overlap. */
+void gp_sci_edits_replace(GpSciEdits *edits, gint start, gint end, const gchar *text)
+{
+	SciEdit edit;
+
+	g_return_if_fail(start >= 0 && start <= end);
+
+	edit.start = start;
+	edit.end = end;
+	edit.order = edits->edits->len;
+	edit.text = g_strdup(text ? text : "");
+	edit.length = strlen(edit.text);
+	g_array_append_val(edits->edits, edit);
+}
+
+
+void gp_sci_edits_insert(GpSciEdits *edits, gint pos, const gchar *text)
+{
+	gp_sci_edits_replace(edits, pos, pos, text);
+}
+
+
+void gp_sci_edits_delete(GpSciEdits *edits, gint start, gint end)
+{
+	gp_sci_edits_replace(edits, start, end, NULL);
+}
+
+
+guint gp_sci_edits_count(GpSciEdits *edits)
+{
+	return edits->edits->len;
+}
+
+
+static gint edit_compare(gconstpointer a, gconstpointer b)
+{
+	const SciEdit *ea = a;
+	const SciEdit *eb = b;
+
+	if (ea->start != eb->start)
+		return ea->start < eb->start ? -1 : 1;
+	if (ea->order != eb->order)
+		return ea->order < eb->order ? -1 : 1;
+	return 0;
+}
+
+
+/* Applies the edits as one undo action and forgets them.  They are applied
+ * from the end of the buffer, so that the positions before an edit are
+ * still the original ones.  An edit overlapping the next one is dropped with
+ * a warning.  Returns the change of the length of the buffer. */
+gint gp_sci_edits_apply(GpSciEdits *edits, ScintillaObject *sci)
+{
+	gint delta = 0;
+	gint limit = G_MAXINT;
+	guint i;
+
+	if (edits->edits->len == 0)
+		return 0;
+
+	g_array_sort(edits->edits, edit_compare);
+
+	if (edits->edits->len > 1)
+		SSM(sci, SCI_SETREDRAW, FALSE, 0);
+	SSM(sci, SCI_BEGINUNDOACTION, 0, 0);
+
+	for (i = edits->edits->len; i-- > 0; )
+	{
+		const SciEdit *edit = &g_array_index(edits->edits, SciEdit, i);
+
+		/* of insertions at the same position the later goes first, so they end up in order */
+		if (edit->end > limit)
+		{
+			g_warning("Overlapping edit of %d-%d ignored", edit->start, edit->end);
+			continue;
+		}
+		limit = edit->start;
+
+		SSM(sci, SCI_SETTARGETSTART, edit->start, 0);
+		SSM(sci, SCI_SETTARGETEND, edit->end, 0);
+		SSM(sci, SCI_REPLACETARGET, edit->length, (sptr_t) edit->text);
+		delta += edit->length - (edit->end - edit->start);
+	}
+
+	SSM(sci, SCI_ENDUNDOACTION, 0, 0);
+	if (edits->edits->len > 1)
+		SSM(sci, SCI_SETREDRAW, TRUE, 0);
+
+	edits_clear(edits);
+	return delta;
+}
@@ -0,0 +1,91 @@
+/*
+ * sciutils.h - bulk access to the Scintilla buffer, shared by the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_SCIUTILS_H
+#define GP_SCIUTILS_H
+
+#include <geanyplugin.h>
+
+G_BEGIN_DECLS
+
+
+/* Reads the buffer through windows pointing into Scintilla's own storage
+ * (SCI_GETRANGEPOINTER) instead of one message per character.  A window never
+ * spans the gap of the buffer, so that Scintilla never has to move the gap to
+ * give a contiguous range.  The pointers are only valid until the buffer is
+ * modified: a reader is meant to be used inside one callback, or reset after
+ * each modification. */
+typedef struct GpSciReader
+{
+	ScintillaObject *sci;
+	gint length;		/* of the buffer */
+	gint start;			/* range of the current window */
+	gint end;
+	const gchar *text;	/* text of the current window, text[0] is at start */
+} GpSciReader;
+
+void gp_sci_reader_init(GpSciReader *reader, ScintillaObject *sci);
+void gp_sci_reader_reset(GpSciReader *reader);
+gchar gp_sci_reader_char_at(GpSciReader *reader, gint pos);
+const gchar *gp_sci_reader_window(GpSciReader *reader, gint pos, gint *start, gint *end);
+
+const gchar *gp_sci_get_range_pointer(ScintillaObject *sci, gint start, gint end);
+
+
+/* The characters and the styles of a range, fetched with one SCI_GETSTYLEDTEXT.
+ * The cells are reused by the next fetches into the same range. */
+typedef struct GpSciStyledRange
+{
+	gint start;
+	gint end;
+	gchar *cells;		/* character and style of each position, interleaved */
+	gsize size;			/* allocated size of cells */
+} GpSciStyledRange;
+
+#define GP_SCI_STYLED_RANGE_INIT { 0, 0, NULL, 0 }
+
+#define gp_sci_styled_range_char_at(range, pos) \
+	((range)->cells[2 * ((pos) - (range)->start)])
+#define gp_sci_styled_range_style_at(range, pos) \
+	((guchar) (range)->cells[2 * ((pos) - (range)->start) + 1])
+
+void gp_sci_styled_range_fetch(GpSciStyledRange *range, ScintillaObject *sci,
+	gint start, gint end);
+void gp_sci_styled_range_clear(GpSciStyledRange *range);
+
+void gp_sci_get_styled_text(ScintillaObject *sci, gint start, gint end,
+	gchar **text, guchar **styles);
+
+
+/* Collects replacements given in positions of the unmodified buffer, and
+ * applies them at once as one undo action, without redrawing in between. */
+typedef struct GpSciEdits GpSciEdits;
+
+GpSciEdits *gp_sci_edits_new(void);
+void gp_sci_edits_replace(GpSciEdits *edits, gint start, gint end, const gchar *text);
+void gp_sci_edits_insert(GpSciEdits *edits, gint pos, const gchar *text);
+void gp_sci_edits_delete(GpSciEdits *edits, gint start, gint end);
+guint gp_sci_edits_count(GpSciEdits *edits);
+gint gp_sci_edits_apply(GpSciEdits *edits, ScintillaObject *sci);
+void gp_sci_edits_free(GpSciEdits *edits);
+
+
+G_END_DECLS
+
+#endif
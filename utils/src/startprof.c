@@ -0,0 +1,291 @@
+/*
+ * startprof.c - startup cost of the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
+#include <geanyplugin.h>
+
+#include "startprof.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+
+
+/* The measures of all the plugins are kept in one array on the main window,
+ * every plugin linking this file reaches it there.  The entries only hold
+ * plain memory, so that the array can be freed whichever plugin is left. */
+#define REGISTRY_KEY "geany-plugins-startup-profile-1"
+
+typedef struct
+{
+	gchar plugin[64];
+	gchar phase[32];
+	gint64 elapsed;		/* microseconds */
+	gint64 heap;		/* bytes, G_MININT64 if unknown */
+} StartupEntry;
+
+static gint enabled = -1;
+
+
+static gint64 now(void)
+{
+#if GLIB_CHECK_VERSION(2, 28, 0)
+	return g_get_monotonic_time();
+#else
+	GTimeVal tv;
+
+	g_get_current_time(&tv);
+	return (gint64) tv.tv_sec * G_USEC_PER_SEC + tv.tv_usec;
+#endif
+}
+
+
+/* Only the main arena is counted, the allocations of other threads aren't */
+static gint64 heap_in_use(void)
+{
+#ifdef __GLIBC__
+	struct mallinfo info = mallinfo();
+
+	return (gint64) (guint) info.uordblks + (guint) info.hblkhd;
+#else
+	return -1;
+#endif
+}
+
+
+gboolean gp_startup_profile_enabled(void)
+{
+	if (enabled < 0)
+	{
+		const gchar *value = g_getenv(GP_STARTUP_PROFILE_ENV);
+
+		enabled = value != NULL && *value != '\0' && strcmp(value, "0") != 0;
+	}
+	return enabled;
+}
+
+
+static GArray *lookup_registry(void)
+{
+	return g_object_get_data(G_OBJECT(geany_data->main_widgets->window), REGISTRY_KEY);
+}
+
+
+static StartupEntry *find_entry(GArray *registry, const gchar *plugin, const gchar *phase)
+{
+	guint i;
+
+	for (i = 0; registry != NULL && i < registry->len; i++)
+	{
+		StartupEntry *entry = &g_array_index(registry, StartupEntry, i);
+
+		if (strncmp(entry->plugin, plugin, sizeof(entry->plugin) - 1) == 0 &&
+			strcmp(entry->phase, phase) == 0)
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+
+static void append_json_string(GString *json, const gchar *str)
+{
+	g_string_append_c(json, '"');
+	for (; *str; str++)
+	{
+		if (*str == '"' || *str == '\\')
+			g_string_append_printf(json, "\\%c", *str);
+		else if ((guchar) *str < 0x20)
+			g_string_append_printf(json, "\\u%04x", (guchar) *str);
+		else
+			g_string_append_c(json, *str);
+	}
+	g_string_append_c(json, '"');
+}
+
+
+static void write_json(GArray *registry, const gchar *filename)
+{
+	GString *json = g_string_new("[\n");
+	GError *error = NULL;
+	guint i;
+
+	for (i = 0; i < registry->len; i++)
+	{
+		StartupEntry *entry = &g_array_index(registry, StartupEntry, i);
+
+		g_string_append(json, "  { \"plugin\": ");
+		append_json_string(json, entry->plugin);
+		g_string_append(json, ", \"phase\": ");
+		append_json_string(json, entry->phase);
+		g_string_append_printf(json, ", \"wall_us\": %" G_GINT64_FORMAT, entry->elapsed);
+		if (entry->heap != G_MININT64)
+			g_string_append_printf(json, ", \"heap_bytes\": %" G_GINT64_FORMAT, entry->heap);
+		g_string_append_printf(json, " }%s\n", i + 1 < registry->len ? "," : "");
+	}
+	g_string_append(json, "]\n");
+
+	if (! g_file_set_contents(filename, json->str, json->len, &error))
+	{
+		msgwin_status_add(_("Unable to write the plugin startup timings to \"%s\": %s"),
+			filename, error->message);
+		g_error_free(error);
+	}
+	g_string_free(json, TRUE);
+}
+
+
+/* Writes the measures to the Messages tab, in the order they were taken,
+ * and to the JSON file if one was asked for */
+static void report(void)
+{
+	GArray *registry = lookup_registry();
+	const gchar *value = g_getenv(GP_STARTUP_PROFILE_ENV);
+	gint64 total = 0;
+	guint i;
+
+	if (registry == NULL)
+		return;
+
+	msgwin_clear_tab(MSG_MESSAGE);
+	msgwin_msg_add(COLOR_BLUE, -1, NULL, _("Plugin startup timings:"));
+	for (i = 0; i < registry->len; i++)
+	{
+		StartupEntry *entry = &g_array_index(registry, StartupEntry, i);
+
+		if (entry->heap != G_MININT64)
+		{
+			msgwin_msg_add(COLOR_BLACK, -1, NULL, "%s, %s: %.3f ms, %+" G_GINT64_FORMAT " KiB",
+				entry->plugin, entry->phase, entry->elapsed / 1000.0, entry->heap / 1024);
+		}
+		else
+		{
+			msgwin_msg_add(COLOR_BLACK, -1, NULL, "%s, %s: %.3f ms",
+				entry->plugin, entry->phase, entry->elapsed / 1000.0);
+		}
+		total += entry->elapsed;
+	}
+	msgwin_msg_add(COLOR_BLUE, -1, NULL, _("Total: %.3f ms"), total / 1000.0);
+	msgwin_switch_tab(MSG_MESSAGE, FALSE);
+
+	if (value != NULL && strcmp(value, "1") != 0)
+		write_json(registry, value);
+}
+
+
+/* After the other plugins' geany-startup-complete handlers */
+static gboolean on_report_idle(gpointer data)
+{
+	report();
+	return FALSE;
+}
+
+
+static void on_startup_complete(GObject *object, gpointer data)
+{
+	g_idle_add(on_report_idle, NULL);
+}
+
+
+static void on_show_timings(GtkMenuItem *item, gpointer user_data)
+{
+	report();
+}
+
+
+static void free_registry(gpointer data)
+{
+	g_array_free(data, TRUE);
+}
+
+
+/* The first plugin measuring creates the array and the menu item, and stays
+ * loaded since the menu item runs its code.  The report is written once
+ * Geany started; it isn't when the plugins are loaded later on. */
+static GArray *get_registry(GeanyPlugin *plugin)
+{
+	GArray *registry = lookup_registry();
+
+	if (registry == NULL)
+	{
+		GtkWidget *item;
+
+		registry = g_array_new(FALSE, TRUE, sizeof(StartupEntry));
+		g_object_set_data_full(G_OBJECT(geany_data->main_widgets->window), REGISTRY_KEY,
+			registry, free_registry);
+
+		plugin_module_make_resident(plugin);
+		plugin_signal_connect(plugin, NULL, "geany-startup-complete", TRUE,
+			G_CALLBACK(on_startup_complete), NULL);
+		item = gtk_menu_item_new_with_mnemonic(_("Plugin _Startup Timings"));
+		gtk_container_add(GTK_CONTAINER(geany_data->main_widgets->tools_menu), item);
+		g_signal_connect(item, "activate", G_CALLBACK(on_show_timings), NULL);
+		gtk_widget_show(item);
+	}
+	return registry;
+}
+
+
+void gp_startup_profile_start(GpStartupTimer *timer, GeanyPlugin *plugin,
+	const gchar *phase)
+{
+	timer->plugin = NULL;
+	if (! gp_startup_profile_enabled() ||
+		find_entry(lookup_registry(), plugin->info->name, phase) != NULL)
+	{
+		return;
+	}
+
+	timer->plugin = plugin;
+	timer->phase = phase;
+	timer->heap = heap_in_use();
+	timer->start = now();
+}
+
+
+void gp_startup_profile_stop(GpStartupTimer *timer)
+{
+	GArray *registry;
+	StartupEntry entry;
+	gint64 elapsed;
+	gint64 heap;
+
+	if (timer->plugin == NULL)
+		return;
+
+	elapsed = now() - timer->start;
+	heap = heap_in_use();
+
+	memset(&entry, 0, sizeof entry);
+	g_strlcpy(entry.plugin, timer->plugin->info->name, sizeof(entry.plugin));
+	g_strlcpy(entry.phase, timer->phase, sizeof(entry.phase));
+	entry.elapsed = elapsed;
+	entry.heap = timer->heap < 0 ? G_MININT64 : heap - timer->heap;
+
+	registry = get_registry(timer->plugin);
+	g_array_append_val(registry, entry);
+}
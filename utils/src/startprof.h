@@ -0,0 +1,95 @@
+/*
+ * startprof.h - startup cost of the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_STARTPROF_H
+#define GP_STARTPROF_H
+
+#include <geanyplugin.h>
+
+G_BEGIN_DECLS
+
+
+/* Environment variable enabling the measures when set to a non-empty value
+ * other than "0".  When enabled, the wall time and heap growth of each
+ * plugin's plugin_init(), first document-open handler and
+ * geany-startup-complete handler are written to the Messages tab once Geany
+ * started, and again from Tools->Plugin Startup Timings.  A value other than
+ * "1" is a file name the report is also written to, as JSON.  When disabled,
+ * a measure only costs a test. */
+#define GP_STARTUP_PROFILE_ENV "GEANY_PLUGINS_PROFILE_STARTUP"
+
+#define GP_STARTUP_PHASE_INIT "plugin_init"
+#define GP_STARTUP_PHASE_DOCUMENT_OPEN "document-open"
+#define GP_STARTUP_PHASE_STARTUP_COMPLETE "geany-startup-complete"
+
+typedef struct GpStartupTimer
+{
+	GeanyPlugin *plugin;
+	const gchar *phase;
+	gint64 start;		/* in microseconds */
+	gint64 heap;		/* bytes in use, -1 if unknown */
+} GpStartupTimer;
+
+gboolean gp_startup_profile_enabled(void);
+/* Only the first measure of each plugin and phase is kept, the later ones
+ * cost a lookup. */
+void gp_startup_profile_start(GpStartupTimer *timer, GeanyPlugin *plugin,
+	const gchar *phase);
+void gp_startup_profile_stop(GpStartupTimer *timer);
+
+/* Defines plugin_init() measuring init, the plugin's own initialization
+ * renamed and declared before; the plugin must define geany_plugin. */
+#define GP_STARTUP_PROFILE_PLUGIN_INIT(init) \
+	void plugin_init(GeanyData *data) \
+	{ \
+		GpStartupTimer timer; \
+		\
+		gp_startup_profile_start(&timer, geany_plugin, GP_STARTUP_PHASE_INIT); \
+		init(data); \
+		gp_startup_profile_stop(&timer); \
+	}
+
+/* Defines wrapper, measuring handler, for plugin_callbacks[] or
+ * plugin_signal_connect().  handler is a "document-open" handler, declared
+ * before. */
+#define GP_STARTUP_PROFILE_DOCUMENT_OPEN_HANDLER(wrapper, handler) \
+	static void wrapper(GObject *object, GeanyDocument *doc, gpointer data) \
+	{ \
+		GpStartupTimer timer; \
+		\
+		gp_startup_profile_start(&timer, geany_plugin, GP_STARTUP_PHASE_DOCUMENT_OPEN); \
+		handler(object, doc, data); \
+		gp_startup_profile_stop(&timer); \
+	}
+
+/* Same for a "geany-startup-complete" handler */
+#define GP_STARTUP_PROFILE_STARTUP_COMPLETE_HANDLER(wrapper, handler) \
+	static void wrapper(GObject *object, gpointer data) \
+	{ \
+		GpStartupTimer timer; \
+		\
+		gp_startup_profile_start(&timer, geany_plugin, GP_STARTUP_PHASE_STARTUP_COMPLETE); \
+		handler(object, data); \
+		gp_startup_profile_stop(&timer); \
+	}
+
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,318 @@
+/*
+ * vcstatus.c - version control status of the files, shared by the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <geanyplugin.h>
+
+#include "vcstatus.h"
+
+extern GeanyData *geany_data;
+extern GeanyFunctions *geany_functions;
+
+
+/* The statuses are kept in one registry on the main window, every plugin
+ * linking this file reaches it there.  It only holds plain memory and the
+ * functions of the plugins currently using it, and the last plugin leaving
+ * it frees it. */
+#define REGISTRY_KEY "geany-plugins-vc-status-1"
+
+typedef struct
+{
+	gulong id;
+	GpVcStatusChangedFunc func;
+	gpointer user_data;
+} Subscriber;
+
+typedef struct
+{
+	/* path -> status for all the working copies, the keys belonging to the
+	 * table of their root */
+	GHashTable *paths;
+	GHashTable *roots;		/* root -> table of its paths and statuses */
+	GSList *subscribers;		/* Subscriber */
+	gulong last_subscriber_id;
+	GpVcStatusRefreshFunc refresh;
+	gpointer refresh_data;
+} Registry;
+
+
+static Registry *get_registry(gboolean create)
+{
+	GObject *window = G_OBJECT(geany_data->main_widgets->window);
+	Registry *registry = g_object_get_data(window, REGISTRY_KEY);
+
+	if (registry == NULL && create)
+	{
+		registry = g_new0(Registry, 1);
+		registry->paths = g_hash_table_new(g_str_hash, g_str_equal);
+		registry->roots = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify) g_hash_table_destroy);
+		g_object_set_data(window, REGISTRY_KEY, registry);
+	}
+	return registry;
+}
+
+
+static void release_registry(Registry *registry)
+{
+	if (registry->refresh != NULL || registry->subscribers != NULL ||
+		g_hash_table_size(registry->roots) > 0)
+		return;
+
+	g_object_set_data(G_OBJECT(geany_data->main_widgets->window), REGISTRY_KEY, NULL);
+	g_hash_table_destroy(registry->paths);
+	g_hash_table_destroy(registry->roots);
+	g_free(registry);
+}
+
+
+static void notify_changed(Registry *registry, const gchar *root)
+{
+	GSList *subscribers, *node;
+
+	/* a subscriber may unsubscribe others */
+	subscribers = g_slist_copy(registry->subscribers);
+	for (node = subscribers; node != NULL; node = node->next)
+	{
+		Subscriber *sub = node->data;
+
+		if (g_slist_find(registry->subscribers, sub) != NULL)
+			sub->func(root, sub->user_data);
+	}
+	g_slist_free(subscribers);
+}
+
+
+/* Returns: a copy of path without its trailing separators */
+static gchar *strip_separators(const gchar *path)
+{
+	gchar *copy = g_strdup(path);
+	gsize len = strlen(copy);
+
+	while (len > 1 && G_IS_DIR_SEPARATOR(copy[len - 1]))
+		copy[--len] = '\0';
+	return copy;
+}
+
+
+static void remove_root(Registry *registry, const gchar *root)
+{
+	GHashTable *table = g_hash_table_lookup(registry->roots, root);
+	GHashTableIter iter;
+	gpointer key;
+
+	if (table == NULL)
+		return;
+
+	g_hash_table_iter_init(&iter, table);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		gpointer current;
+
+		/* a nested working copy published later owns the path now */
+		if (g_hash_table_lookup_extended(registry->paths, key, &current, NULL) &&
+			current == key)
+			g_hash_table_remove(registry->paths, key);
+	}
+	g_hash_table_remove(registry->roots, root);
+}
+
+
+/* Gives the directories from path's parent up to root the status of the
+ * files below them */
+static void add_parents(GHashTable *table, const gchar *root, const gchar *path, GpVcStatus status)
+{
+	GpVcStatus dir_status = status == GP_VC_STATUS_UNTRACKED ?
+		GP_VC_STATUS_UNTRACKED : GP_VC_STATUS_MODIFIED;
+	gsize root_len = strlen(root);
+	gchar *dir = g_strdup(path);
+	gchar *sep;
+
+	while ((sep = strrchr(dir, G_DIR_SEPARATOR)) != NULL && (gsize) (sep - dir) >= root_len)
+	{
+		*sep = '\0';
+		if (GPOINTER_TO_INT(g_hash_table_lookup(table, dir)) >= (gint) dir_status)
+			break;	/* and its parents as well */
+		g_hash_table_replace(table, g_strdup(dir), GINT_TO_POINTER(dir_status));
+	}
+	g_free(dir);
+}
+
+
+gboolean gp_vc_status_is_available(void)
+{
+	Registry *registry = get_registry(FALSE);
+
+	return registry != NULL && registry->refresh != NULL;
+}
+
+
+GpVcStatus gp_vc_status_get(const gchar *path)
+{
+	Registry *registry = get_registry(FALSE);
+
+	if (registry == NULL || path == NULL)
+		return GP_VC_STATUS_NONE;
+	return GPOINTER_TO_INT(g_hash_table_lookup(registry->paths, path));
+}
+
+
+/* Returns: the letter shown next to the name of a file, NULL if it is unchanged */
+const gchar *gp_vc_status_get_badge(GpVcStatus status)
+{
+	switch (status)
+	{
+		case GP_VC_STATUS_UNTRACKED:
+			return "?";
+		case GP_VC_STATUS_MODIFIED:
+			return "M";
+		case GP_VC_STATUS_ADDED:
+			return "A";
+		case GP_VC_STATUS_DELETED:
+			return "D";
+		default:
+			return NULL;
+	}
+}
+
+
+/* Asks for the status of the working copy containing path, the subscribers
+ * being told when it is published */
+void gp_vc_status_refresh(const gchar *path)
+{
+	Registry *registry = get_registry(FALSE);
+
+	g_return_if_fail(path != NULL);
+
+	if (registry != NULL && registry->refresh != NULL)
+		registry->refresh(path, registry->refresh_data);
+}
+
+
+gulong gp_vc_status_subscribe(GpVcStatusChangedFunc func, gpointer user_data)
+{
+	Registry *registry = get_registry(TRUE);
+	Subscriber *sub = g_new0(Subscriber, 1);
+
+	sub->id = ++registry->last_subscriber_id;
+	sub->func = func;
+	sub->user_data = user_data;
+	registry->subscribers = g_slist_append(registry->subscribers, sub);
+
+	return sub->id;
+}
+
+
+void gp_vc_status_unsubscribe(gulong id)
+{
+	Registry *registry = get_registry(FALSE);
+	GSList *node;
+
+	if (registry == NULL)
+		return;
+
+	for (node = registry->subscribers; node != NULL; node = node->next)
+	{
+		Subscriber *sub = node->data;
+
+		if (sub->id == id)
+		{
+			registry->subscribers = g_slist_delete_link(registry->subscribers, node);
+			g_free(sub);
+			break;
+		}
+	}
+	release_registry(registry);
+}
+
+
+/* Sets the plugin running the statuses, func being NULL when it leaves: the
+ * statuses it published are dropped then. */
+void gp_vc_status_set_provider(GpVcStatusRefreshFunc func, gpointer user_data)
+{
+	Registry *registry = get_registry(func != NULL);
+
+	if (registry == NULL)
+		return;
+
+	registry->refresh = func;
+	registry->refresh_data = user_data;
+
+	if (func != NULL)
+		notify_changed(registry, NULL);
+	else
+	{
+		GList *roots = g_hash_table_get_keys(registry->roots);
+		GList *node;
+
+		for (node = roots; node != NULL; node = node->next)
+		{
+			gchar *root = g_strdup(node->data);
+
+			remove_root(registry, root);
+			notify_changed(registry, root);
+			g_free(root);
+		}
+		g_list_free(roots);
+		release_registry(registry);
+	}
+}
+
+
+void gp_vc_status_publish(const gchar *root, GHashTable *statuses)
+{
+	Registry *registry = get_registry(TRUE);
+	gchar *norm_root = strip_separators(root);
+	GHashTable *table;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	remove_root(registry, norm_root);
+
+	table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	if (statuses != NULL)
+	{
+		g_hash_table_iter_init(&iter, statuses);
+		while (g_hash_table_iter_next(&iter, &key, &value))
+		{
+			GpVcStatus status = GPOINTER_TO_INT(value);
+
+			if (status != GP_VC_STATUS_NONE)
+			{
+				gchar *path = strip_separators(key);
+
+				add_parents(table, norm_root, path, status);
+				g_hash_table_replace(table, path, value);
+			}
+		}
+	}
+	g_hash_table_insert(registry->roots, g_strdup(norm_root), table);
+
+	g_hash_table_iter_init(&iter, table);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		g_hash_table_replace(registry->paths, key, value);
+
+	notify_changed(registry, norm_root);
+	g_free(norm_root);
+}
@@ -0,0 +1,68 @@
+/*
+ * vcstatus.h - version control status of the files, shared by the plugins
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GP_VCSTATUS_H
+#define GP_VCSTATUS_H
+
+#include <geanyplugin.h>
+
+G_BEGIN_DECLS
+
+
+/* The status of the files of the working copies, kept by a provider (GeanyVC)
+ * for all the plugins.  The provider runs the status of a working copy when
+ * asked to, and publishes it whole; the other plugins look the files up and
+ * subscribe to the changes.
+ *
+ * Paths are absolute, in the file name encoding, without trailing separator.
+ * A directory has the status of the files below it: GP_VC_STATUS_MODIFIED
+ * when some are changed, GP_VC_STATUS_UNTRACKED when they are only new.  The
+ * files inside an untracked directory are not listed themselves. */
+typedef enum
+{
+	GP_VC_STATUS_NONE,		/* unchanged, or not in a working copy known yet */
+	GP_VC_STATUS_UNTRACKED,
+	GP_VC_STATUS_MODIFIED,
+	GP_VC_STATUS_ADDED,
+	GP_VC_STATUS_DELETED
+} GpVcStatus;
+
+/* Called when the status of the working copy at root was published, root being
+ * NULL when a provider arrived: the statuses are to be asked for again then. */
+typedef void (*GpVcStatusChangedFunc)(const gchar *root, gpointer user_data);
+/* Asks the provider to run the status of the working copy containing path */
+typedef void (*GpVcStatusRefreshFunc)(const gchar *path, gpointer user_data);
+
+gboolean gp_vc_status_is_available(void);
+GpVcStatus gp_vc_status_get(const gchar *path);
+const gchar *gp_vc_status_get_badge(GpVcStatus status);
+void gp_vc_status_refresh(const gchar *path);
+
+gulong gp_vc_status_subscribe(GpVcStatusChangedFunc func, gpointer user_data);
+void gp_vc_status_unsubscribe(gulong id);
+
+/* The provider: statuses maps the changed paths under root to their
+ * GpVcStatus, with GINT_TO_POINTER(); the table is copied. */
+void gp_vc_status_set_provider(GpVcStatusRefreshFunc func, gpointer user_data);
+void gp_vc_status_publish(const gchar *root, GHashTable *statuses);
+
+
+G_END_DECLS
+
+#endif
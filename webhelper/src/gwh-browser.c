@@ -84,6 +84,11 @@ struct _GwhBrowserPrivate
   
   GtkWidget    *statusbar;
   gchar        *hovered_link;
+  
+  /* scroll position to restore once reloaded */
+  gboolean      restore_scroll;
+  gint          scroll_x;
+  gint          scroll_y;
 };
 
 enum {
@@ -422,6 +427,16 @@ update_load_status (GwhBrowser *self)
       break;
   }
   
+  if (! loading && self->priv->restore_scroll) {
+    gchar *script;
+    
+    self->priv->restore_scroll = FALSE;
+    script = g_strdup_printf ("window.scrollTo (%d, %d);",
+                              self->priv->scroll_x, self->priv->scroll_y);
+    webkit_web_view_execute_script (web_view, script);
+    g_free (script);
+  }
+  
   gtk_widget_set_sensitive (GTK_WIDGET (self->priv->item_reload), ! loading);
   gtk_widget_set_visible   (GTK_WIDGET (self->priv->item_reload), ! loading);
   gtk_widget_set_sensitive (GTK_WIDGET (self->priv->item_cancel), loading);
@@ -1011,6 +1026,7 @@ gwh_browser_init (GwhBrowser *self)
     self->priv->statusbar = gtk_statusbar_new ();
   }
   self->priv->hovered_link = NULL;
+  self->priv->restore_scroll = FALSE;
   
   g_signal_connect (self, "notify::orientation",
                     G_CALLBACK (on_orientation_notify), self);
@@ -1135,6 +1151,72 @@ gwh_browser_reload (GwhBrowser *self)
   webkit_web_view_reload (WEBKIT_WEB_VIEW (self->priv->web_view));
 }
 
+/* remembers the scroll position for it to be restored once loaded */
+static void
+save_scroll_position (GwhBrowser *self)
+{
+  GtkScrolledWindow *scrolled;
+  
+  scrolled = GTK_SCROLLED_WINDOW (gtk_widget_get_parent (self->priv->web_view));
+  self->priv->scroll_x = (gint) gtk_adjustment_get_value (gtk_scrolled_window_get_hadjustment (scrolled));
+  self->priv->scroll_y = (gint) gtk_adjustment_get_value (gtk_scrolled_window_get_vadjustment (scrolled));
+  self->priv->restore_scroll = TRUE;
+}
+
+/* like gwh_browser_reload() but scrolls back where the page was */
+void
+gwh_browser_reload_keeping_scroll (GwhBrowser *self)
+{
+  g_return_if_fail (GWH_IS_BROWSER (self));
+  
+  save_scroll_position (self);
+  gwh_browser_reload (self);
+}
+
+/* loads @html as if it was the content of @base_uri, keeping the scroll
+ * position.  the resources the page uses are resolved against @base_uri, and
+ * taken from WebKit's cache if they were already loaded */
+void
+gwh_browser_load_html_keeping_scroll (GwhBrowser  *self,
+                                      const gchar *html,
+                                      const gchar *base_uri)
+{
+  g_return_if_fail (GWH_IS_BROWSER (self));
+  g_return_if_fail (html != NULL);
+  
+  /* don't lose the position of the first load if another one comes before
+   * it finished */
+  if (! self->priv->restore_scroll) {
+    save_scroll_position (self);
+  }
+  webkit_web_view_load_string (WEBKIT_WEB_VIEW (self->priv->web_view), html,
+                               "text/html", "UTF-8", base_uri);
+}
+
+/* reloads only the style sheets linked by the page, changing their URI so
+ * that they are not taken from the cache, without reloading the page */
+void
+gwh_browser_reload_stylesheets (GwhBrowser *self)
+{
+  static const gchar script[] =
+    "(function () {"
+    "  var links = document.getElementsByTagName ('link');"
+    "  for (var i = 0; i < links.length; i++) {"
+    "    var link = links[i];"
+    "    if (/\\bstylesheet\\b/i.test (link.rel) && link.href) {"
+    "      var href = link.href.replace (/[?&]gwh-reload=\\d+$/, '');"
+    "      link.href = href + (href.indexOf ('?') < 0 ? '?' : '&') +"
+    "                  'gwh-reload=' + new Date ().getTime ();"
+    "    }"
+    "  }"
+    "}) ();";
+  
+  g_return_if_fail (GWH_IS_BROWSER (self));
+  
+  webkit_web_view_execute_script (WEBKIT_WEB_VIEW (self->priv->web_view),
+                                  script);
+}
+
 void
 gwh_browser_set_inspector_transient_for (GwhBrowser *self,
                                             GtkWindow  *window)
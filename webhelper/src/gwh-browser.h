@@ -77,6 +77,14 @@ WebKitWebView  *gwh_browser_get_web_view                  (GwhBrowser *self);
 G_GNUC_INTERNAL
 void            gwh_browser_reload                        (GwhBrowser *self);
 G_GNUC_INTERNAL
+void            gwh_browser_reload_keeping_scroll         (GwhBrowser *self);
+G_GNUC_INTERNAL
+void            gwh_browser_reload_stylesheets            (GwhBrowser *self);
+G_GNUC_INTERNAL
+void            gwh_browser_load_html_keeping_scroll      (GwhBrowser  *self,
+                                                           const gchar *html,
+                                                           const gchar *base_uri);
+G_GNUC_INTERNAL
 void            gwh_browser_set_inspector_transient_for   (GwhBrowser *self,
                                                            GtkWindow  *window);
 G_GNUC_INTERNAL
@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 #include <gtk/gtk.h>
@@ -36,6 +37,7 @@
 #include "gwh-plugin.h"
 #include "gwh-keybindings.h"
 #include "gwh-enum-types.h"
+#include "startprof.h"
 
 
 GeanyPlugin      *geany_plugin;
@@ -61,7 +63,12 @@ enum {
   CONTAINER_WINDOW
 };
 
+/* the browser is created the first time its holder is shown, and possibly
+ * destroyed after it has been hidden for some time, to not pay for WebKit
+ * when the preview isn't used */
+static GtkWidget   *G_holder    = NULL;
 static GtkWidget   *G_browser   = NULL;
+static guint        G_unload_source = 0;
 static struct {
   guint       type;
   GtkWidget  *widget;
@@ -70,6 +77,14 @@ static struct {
   gboolean    visible;
 } G_container;
 static GwhSettings *G_settings  = NULL;
+/* pending auto-reload */
+static struct {
+  guint       source;
+  /* whether the page has to be reloaded, or only its style sheets */
+  gboolean    full;
+} G_reload = { 0, FALSE };
+/* pending push of the current document's buffer to the browser */
+static guint        G_live_source = 0;
 
 
 static void
@@ -106,8 +121,24 @@ static void
 on_separate_window_destroy (GtkWidget  *widget,
                             gpointer    data)
 {
-  gwh_browser_set_inspector_transient_for (GWH_BROWSER (G_browser), NULL);
-  gtk_container_remove (GTK_CONTAINER (G_container.widget), G_browser);
+  if (G_browser) {
+    gwh_browser_set_inspector_transient_for (GWH_BROWSER (G_browser), NULL);
+  }
+  gtk_container_remove (GTK_CONTAINER (G_container.widget), G_holder);
+}
+
+static void
+update_inspector_transient_for (void)
+{
+  if (G_browser) {
+    GtkWidget *window = geany_data->main_widgets->window;
+    
+    if (G_container.type == CONTAINER_WINDOW) {
+      window = G_container.widget;
+    }
+    gwh_browser_set_inspector_transient_for (GWH_BROWSER (G_browser),
+                                             GTK_WINDOW (window));
+  }
 }
 
 static gboolean
@@ -146,7 +177,7 @@ create_separate_window (void)
                     G_CALLBACK (on_separate_window_delete_event), NULL);
   g_signal_connect (window, "destroy",
                     G_CALLBACK (on_separate_window_destroy), NULL);
-  gtk_container_add (GTK_CONTAINER (window), G_browser);
+  gtk_container_add (GTK_CONTAINER (window), G_holder);
   if (is_transient) {
     gtk_window_set_transient_for (GTK_WINDOW (window),
                                   GTK_WINDOW (geany_data->main_widgets->window));
@@ -157,8 +188,6 @@ create_separate_window (void)
     gtk_window_set_icon_list (GTK_WINDOW (window), icons);
     g_list_free (icons);
   }
-  gwh_browser_set_inspector_transient_for (GWH_BROWSER (G_browser),
-                                           GTK_WINDOW (window));
   
   return window;
 }
@@ -183,10 +212,9 @@ attach_browser (void)
       G_container.widget = geany_data->main_widgets->message_window_notebook;
     }
     gtk_notebook_append_page (GTK_NOTEBOOK (G_container.widget),
-                              G_browser, gtk_label_new (_("Web preview")));
-    gwh_browser_set_inspector_transient_for (GWH_BROWSER (G_browser),
-                                             GTK_WINDOW (geany_data->main_widgets->window));
+                              G_holder, gtk_label_new (_("Web preview")));
   }
+  update_inspector_transient_for ();
 }
 
 static void
@@ -196,8 +224,8 @@ detach_browser (void)
     separate_window_set_visible (FALSE); /* saves the geometry */
     gtk_widget_destroy (G_container.widget);
   } else {
-    gtk_container_remove (GTK_CONTAINER (gtk_widget_get_parent (G_browser)),
-                          G_browser);
+    gtk_container_remove (GTK_CONTAINER (gtk_widget_get_parent (G_holder)),
+                          G_holder);
   }
 }
 
@@ -206,10 +234,8 @@ on_settings_browser_position_notify (GObject     *object,
                                      GParamSpec  *pspec,
                                      gpointer     data)
 {
-  g_object_ref (G_browser);
   detach_browser ();
   attach_browser ();
-  g_object_unref (G_browser);
 }
 
 static void
@@ -219,25 +245,124 @@ on_settings_windows_attrs_notify (GObject    *object,
 {
   /* recreate the window to apply the new attributes */
   if (G_container.type == CONTAINER_WINDOW) {
-    g_object_ref (G_browser);
     detach_browser ();
     attach_browser ();
-    g_object_unref (G_browser);
   }
 }
 
+static gboolean
+on_reload_timeout (gpointer data)
+{
+  gboolean keep_scroll = FALSE;
+  
+  g_object_get (G_OBJECT (G_settings),
+                "browser-auto-reload-keep-scroll", &keep_scroll,
+                NULL);
+  if (! G_reload.full) {
+    gwh_browser_reload_stylesheets (GWH_BROWSER (G_browser));
+  } else if (keep_scroll) {
+    gwh_browser_reload_keeping_scroll (GWH_BROWSER (G_browser));
+  } else {
+    gwh_browser_reload (GWH_BROWSER (G_browser));
+  }
+  G_reload.source = 0;
+  G_reload.full = FALSE;
+  
+  return FALSE;
+}
+
+/* whether the browser shows @doc itself, rather than a page using it */
+static gboolean
+browser_shows_document (GeanyDocument *doc)
+{
+  const gchar  *uri = gwh_browser_get_uri (GWH_BROWSER (G_browser));
+  gchar        *doc_uri;
+  gboolean      shows = FALSE;
+  
+  if (uri && doc->real_path) {
+    doc_uri = g_filename_to_uri (doc->real_path, NULL, NULL);
+    shows = doc_uri && strcmp (uri, doc_uri) == 0;
+    g_free (doc_uri);
+  }
+  
+  return shows;
+}
+
 static void
 on_document_save (GObject        *obj,
                   GeanyDocument  *doc,
                   gpointer        user_data)
 {
-  gboolean auto_reload = FALSE;
+  gboolean  auto_reload = FALSE;
+  gint      delay = 0;
   
-  g_object_get (G_OBJECT (G_settings), "browser-auto-reload", &auto_reload,
+  g_object_get (G_OBJECT (G_settings),
+                "browser-auto-reload", &auto_reload,
+                "browser-auto-reload-delay", &delay,
                 NULL);
-  if (auto_reload) {
-    gwh_browser_reload (GWH_BROWSER (G_browser));
+  /* without a browser there's nothing to reload, it loads the page when
+   * created */
+  if (auto_reload && G_browser) {
+    /* a style sheet can be swapped without reloading the page using it */
+    if (doc->file_type == NULL || doc->file_type->id != GEANY_FILETYPES_CSS ||
+        browser_shows_document (doc)) {
+      G_reload.full = TRUE;
+    }
+    /* wait for the saves done at the same time (e.g. save all) to reload
+     * only once */
+    if (G_reload.source) {
+      g_source_remove (G_reload.source);
+    }
+    G_reload.source = g_timeout_add (delay, on_reload_timeout, NULL);
+  }
+}
+
+static gboolean
+on_live_preview_timeout (gpointer data)
+{
+  GeanyDocument *doc = document_get_current ();
+  
+  G_live_source = 0;
+  /* the document may have been switched or saved under another name since
+   * the change */
+  if (G_browser && DOC_VALID (doc) && browser_shows_document (doc)) {
+    gchar *text = sci_get_contents (doc->editor->sci, -1);
+    gchar *uri  = g_filename_to_uri (doc->real_path, NULL, NULL);
+    
+    /* the buffer is always in UTF-8, whatever the file encoding is */
+    gwh_browser_load_html_keeping_scroll (GWH_BROWSER (G_browser), text, uri);
+    g_free (uri);
+    g_free (text);
   }
+  
+  return FALSE;
+}
+
+static gboolean
+on_editor_notify (GObject        *obj,
+                  GeanyEditor    *editor,
+                  SCNotification *nt,
+                  gpointer        user_data)
+{
+  if (nt->nmhdr.code == SCN_MODIFIED &&
+      nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT) &&
+      G_browser && ! G_live_source) {
+    gboolean  live_preview = FALSE;
+    gint      delay = 0;
+    
+    g_object_get (G_OBJECT (G_settings),
+                  "browser-live-preview", &live_preview,
+                  "browser-live-preview-delay", &delay,
+                  NULL);
+    /* don't reset a pending push so that typing continuously still updates
+     * the preview every @delay */
+    if (live_preview && editor->document == document_get_current () &&
+        browser_shows_document (editor->document)) {
+      G_live_source = g_timeout_add (delay, on_live_preview_timeout, NULL);
+    }
+  }
+  
+  return FALSE;
 }
 
 static void
@@ -248,6 +373,14 @@ on_item_auto_reload_toggled (GtkCheckMenuItem *item,
                 gtk_check_menu_item_get_active (item), NULL);
 }
 
+static void
+on_item_live_preview_toggled (GtkCheckMenuItem *item,
+                              gpointer          dummy)
+{
+  g_object_set (G_OBJECT (G_settings), "browser-live-preview",
+                gtk_check_menu_item_get_active (item), NULL);
+}
+
 static void
 on_browser_populate_popup (GwhBrowser *browser,
                            GtkMenu    *menu,
@@ -255,6 +388,7 @@ on_browser_populate_popup (GwhBrowser *browser,
 {
   GtkWidget  *item;
   gboolean    auto_reload = FALSE;
+  gboolean    live_preview = FALSE;
   
   item = gtk_separator_menu_item_new ();
   gtk_widget_show (item);
@@ -268,11 +402,85 @@ on_browser_populate_popup (GwhBrowser *browser,
   gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
   g_signal_connect (item, "toggled", G_CALLBACK (on_item_auto_reload_toggled),
                     NULL);
+  
+  g_object_get (G_OBJECT (G_settings), "browser-live-preview", &live_preview,
+                NULL);
+  item = gtk_check_menu_item_new_with_mnemonic (_("Update upon document editing"));
+  gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (item), live_preview);
+  gtk_widget_show (item);
+  gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+  g_signal_connect (item, "toggled", G_CALLBACK (on_item_live_preview_toggled),
+                    NULL);
+}
+
+static void
+ensure_browser (void)
+{
+  if (! G_browser) {
+    G_browser = gwh_browser_new ();
+    g_signal_connect (G_browser, "populate-popup",
+                      G_CALLBACK (on_browser_populate_popup), NULL);
+    gtk_container_add (GTK_CONTAINER (G_holder), G_browser);
+    gtk_widget_show_all (G_browser);
+    update_inspector_transient_for ();
+  }
+}
+
+static void
+destroy_browser (void)
+{
+  if (G_reload.source) {
+    g_source_remove (G_reload.source);
+    G_reload.source = 0;
+    G_reload.full = FALSE;
+  }
+  if (G_live_source) {
+    g_source_remove (G_live_source);
+    G_live_source = 0;
+  }
+  if (G_browser) {
+    gwh_browser_set_inspector_transient_for (GWH_BROWSER (G_browser), NULL);
+    gtk_widget_destroy (G_browser);
+    G_browser = NULL;
+  }
+}
+
+static gboolean
+on_unload_timeout (gpointer data)
+{
+  G_unload_source = 0;
+  destroy_browser ();
+  
+  return FALSE;
+}
+
+static void
+on_holder_map (GtkWidget *widget,
+               gpointer   data)
+{
+  if (G_unload_source) {
+    g_source_remove (G_unload_source);
+    G_unload_source = 0;
+  }
+  ensure_browser ();
+}
+
+static void
+on_holder_unmap (GtkWidget *widget,
+                 gpointer   data)
+{
+  gint delay = 0;
+  
+  g_object_get (G_settings, "browser-unload-delay", &delay, NULL);
+  if (G_browser && delay > 0 && ! G_unload_source) {
+    G_unload_source = g_timeout_add_seconds (delay, on_unload_timeout, NULL);
+  }
 }
 
 static void
 on_kb_toggle_inspector (guint key_id)
 {
+  ensure_browser ();
   gwh_browser_toggle_inspector (GWH_BROWSER (G_browser));
 }
 
@@ -306,6 +514,38 @@ load_config (void)
     _("Whether the browser reloads itself upon document saving"),
     TRUE,
     G_PARAM_READWRITE));
+  gwh_settings_install_property (G_settings, g_param_spec_int (
+    "browser-auto-reload-delay",
+    _("Browser auto reload delay"),
+    _("Time to wait for other documents to be saved before reloading, in milliseconds"),
+    0, 10000, 300,
+    G_PARAM_READWRITE));
+  gwh_settings_install_property (G_settings, g_param_spec_boolean (
+    "browser-auto-reload-keep-scroll",
+    _("Keep scroll position upon auto reload"),
+    _("Whether the browser scrolls back where it was after reloading itself upon document saving"),
+    TRUE,
+    G_PARAM_READWRITE));
+  gwh_settings_install_property (G_settings, g_param_spec_boolean (
+    "browser-live-preview",
+    _("Browser live preview"),
+    _("Whether the browser shows the edits of the current document without "
+      "it being saved"),
+    FALSE,
+    G_PARAM_READWRITE));
+  gwh_settings_install_property (G_settings, g_param_spec_int (
+    "browser-live-preview-delay",
+    _("Browser live preview delay"),
+    _("Minimum time between two updates of the live preview, in milliseconds"),
+    0, 10000, 500,
+    G_PARAM_READWRITE));
+  gwh_settings_install_property (G_settings, g_param_spec_int (
+    "browser-unload-delay",
+    _("Browser unload delay"),
+    _("Time after which the browser is destroyed to free memory once hidden, "
+      "in seconds, or 0 to keep it"),
+    0, G_MAXINT, 0,
+    G_PARAM_READWRITE));
   gwh_settings_install_property (G_settings, g_param_spec_string (
     "browser-last-uri",
     _("Browser last URI"),
@@ -392,8 +632,8 @@ save_config (void)
   G_settings = NULL;
 }
 
-void
-plugin_init (GeanyData *data)
+static void
+init (GeanyData *data)
 {
   /* even though it's not really a good idea to keep all the library we load
    * into memory, this is needed for webkit. first, without this we creash after
@@ -406,15 +646,20 @@ plugin_init (GeanyData *data)
     g_thread_init (NULL);
   }
   
+  /* keep the resources in memory so the live preview doesn't fetch the
+   * images, scripts and style sheets of the page again on each update */
+  webkit_set_cache_model (WEBKIT_CACHE_MODEL_DOCUMENT_BROWSER);
+  
   load_config ();
   gwh_keybindings_init ();
   
-  G_browser = gwh_browser_new ();
-  g_signal_connect (G_browser, "populate-popup",
-                    G_CALLBACK (on_browser_populate_popup), NULL);
+  G_holder = gtk_vbox_new (FALSE, 0);
+  g_object_ref_sink (G_holder);
+  g_signal_connect (G_holder, "map", G_CALLBACK (on_holder_map), NULL);
+  g_signal_connect (G_holder, "unmap", G_CALLBACK (on_holder_unmap), NULL);
+  gtk_widget_show (G_holder);
   
   attach_browser ();
-  gtk_widget_show_all (G_browser);
   
   plugin_signal_connect (geany_plugin, G_OBJECT (G_settings),
                          "notify::browser-position", FALSE,
@@ -431,6 +676,8 @@ plugin_init (GeanyData *data)
   
   plugin_signal_connect (geany_plugin, NULL, "document-save", TRUE,
                          G_CALLBACK (on_document_save), NULL);
+  plugin_signal_connect (geany_plugin, NULL, "editor-notify", FALSE,
+                         G_CALLBACK (on_editor_notify), NULL);
   
   /* add keybindings */
   keybindings_set_item (gwh_keybindings_get_group (), GWH_KB_TOGGLE_INSPECTOR,
@@ -443,10 +690,19 @@ plugin_init (GeanyData *data)
                         _("Show/Hide Web View's Window"), NULL);
 }
 
+GP_STARTUP_PROFILE_PLUGIN_INIT (init)
+
 void
 plugin_cleanup (void)
 {
+  if (G_unload_source) {
+    g_source_remove (G_unload_source);
+    G_unload_source = 0;
+  }
+  destroy_browser ();
   detach_browser ();
+  g_object_unref (G_holder);
+  G_holder = NULL;
   
   gwh_keybindings_cleanup ();
   save_config ();
@@ -458,6 +714,11 @@ struct _GwhConfigDialog
 {
   GtkWidget *browser_position;
   GtkWidget *browser_auto_reload;
+  GtkWidget *browser_auto_reload_delay;
+  GtkWidget *browser_auto_reload_keep_scroll;
+  GtkWidget *browser_live_preview;
+  GtkWidget *browser_live_preview_delay;
+  GtkWidget *browser_unload_delay;
   
   GtkWidget *secondary_windows_skip_taskbar;
   GtkWidget *secondary_windows_are_transient;
@@ -477,6 +738,11 @@ on_configure_dialog_response (GtkDialog        *dialog,
       gwh_settings_widget_sync_v (G_settings,
                                   cdialog->browser_position,
                                   cdialog->browser_auto_reload,
+                                  cdialog->browser_auto_reload_delay,
+                                  cdialog->browser_auto_reload_keep_scroll,
+                                  cdialog->browser_live_preview,
+                                  cdialog->browser_live_preview_delay,
+                                  cdialog->browser_unload_delay,
                                   cdialog->secondary_windows_skip_taskbar,
                                   cdialog->secondary_windows_are_transient,
                                   cdialog->secondary_windows_type,
@@ -516,6 +782,23 @@ plugin_configure (GtkDialog *dialog)
   cdialog->browser_auto_reload = gwh_settings_widget_new (G_settings,
                                                           "browser-auto-reload");
   gtk_box_pack_start (GTK_BOX (box), cdialog->browser_auto_reload, FALSE, TRUE, 0);
+  cdialog->browser_auto_reload_delay = gwh_settings_widget_new (G_settings,
+                                                                "browser-auto-reload-delay");
+  gtk_box_pack_start (GTK_BOX (box), cdialog->browser_auto_reload_delay, FALSE, TRUE, 0);
+  cdialog->browser_auto_reload_keep_scroll = gwh_settings_widget_new (G_settings,
+                                                                      "browser-auto-reload-keep-scroll");
+  gtk_box_pack_start (GTK_BOX (box), cdialog->browser_auto_reload_keep_scroll, FALSE, TRUE, 0);
+  /* live preview */
+  cdialog->browser_live_preview = gwh_settings_widget_new (G_settings,
+                                                           "browser-live-preview");
+  gtk_box_pack_start (GTK_BOX (box), cdialog->browser_live_preview, FALSE, TRUE, 0);
+  cdialog->browser_live_preview_delay = gwh_settings_widget_new (G_settings,
+                                                                 "browser-live-preview-delay");
+  gtk_box_pack_start (GTK_BOX (box), cdialog->browser_live_preview_delay, FALSE, TRUE, 0);
+  /* unload delay */
+  cdialog->browser_unload_delay = gwh_settings_widget_new (G_settings,
+                                                           "browser-unload-delay");
+  gtk_box_pack_start (GTK_BOX (box), cdialog->browser_unload_delay, FALSE, TRUE, 0);
   
   /* Windows */
   gtk_box_pack_start (GTK_BOX (box1), ui_frame_new_with_alignment (_("Windows"), &alignment), FALSE, FALSE, 0);
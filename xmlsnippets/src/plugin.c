@@ -59,6 +59,7 @@ void plugin_init(GeanyData *data)
 
 void plugin_cleanup(void)
 {
+	clear_snippets();
 }
 
 
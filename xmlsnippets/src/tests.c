@@ -35,6 +35,7 @@ static void finalize(void);
 static gboolean test(gint ordinal, const gchar *input, const gchar *completion_needed);
 static void fill_completions(void);
 static gboolean run_tests(void);
+static void run_benchmarks(void);
 
 
 static void init(void)
@@ -45,6 +46,7 @@ static void init(void)
 
 static void finalize(void)
 {
+  clear_snippets();
   test_stubs_finalize();
 }
 
@@ -172,14 +174,64 @@ static gboolean run_tests(void)
 		/* %cursor% in tag name is treated normally */
 	success = test(70, "<cursor", "<cursor%cursor%>") && success;
 
+	/* Snippets changed in the configuration are compiled again */
+	g_hash_table_insert(completions, "ai", "<a><b/></a>");
+	success = test(80, "<ai", "<a><b/></a>") && success;
+	success = test(81, "<ai alt='...'", "<a alt='...'><b/></a>") && success;
+	g_hash_table_insert(completions, "ai", "<a><img/></a>");
+	success = test(82, "<ai", "<a><img/></a>") && success;
+
 	return success;
 }
 
 
+static void benchmark(const gchar *name, const gchar *input, gint iterations)
+{
+	CompletionInfo c;
+	InputInfo i;
+	GTimer *timer;
+	gint size, n;
+	gdouble elapsed;
+
+	input = g_strconcat(input, ">", NULL);
+	size = strlen(input);
+
+	timer = g_timer_new();
+	for (n = 0; n < iterations; n++)
+	{
+		if (get_completion(NULL, input, size, &c, &i))
+			g_free(c.completion);
+	}
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+	g_free((gchar *)input);
+
+	g_message("%-24s %10.0f completions/s", name,
+		elapsed > 0 ? iterations / elapsed : 0.0);
+}
+
+
+/* Measures the throughput of get_completion() on the keystroke path */
+static void run_benchmarks(void)
+{
+	const gint iterations = 1000000;
+
+	benchmark("no snippet", "<p", iterations);
+	benchmark("not a tag", "<tagname", iterations);
+	benchmark("plain", "<ai", iterations);
+	benchmark("attributes", "<ai alt='...' href='#'", iterations);
+	benchmark("long text", "<p>Lorem ipsum dolor sit amet, consectetur adipiscing "
+		"elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua.</p>"
+		"<ai class='x'", iterations);
+}
+
+
 int main(int argc, char ** argv)
 {
   init();
 	gboolean success = run_tests();
+	if (success && argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+		run_benchmarks();
   finalize();
   return success ? 0 : 1;
 }
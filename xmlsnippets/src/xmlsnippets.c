@@ -28,18 +28,18 @@
 #include <string.h>
 
 
-typedef struct Info
+/* A snippet, compiled the first time it is used */
+typedef struct Snippet
 {
-	struct
-	{
-		const gchar *completion;
-		const gchar *tag_name_start; /* start of the first tag within `completion' */
-	} snippet;
-	struct
-	{
-		const gchar *tag_name_end;
-	} input;
-} Info;
+	gchar *body;              /* the snippet as found in the configuration */
+	gboolean is_tag;          /* whether the body starts with a tag */
+	gsize head_len;           /* length of the body up to the end of the first tag name */
+	gboolean has_attributes;  /* whether the first tag of the body has attributes */
+} Snippet;
+
+
+/* Maps tag names to their compiled Snippet */
+static GHashTable *snippets = NULL;
 
 
 static const gchar * skip_xml_tag_name(const gchar * start)
@@ -51,17 +51,95 @@ static const gchar * skip_xml_tag_name(const gchar * start)
 }
 
 
+static void snippet_free(gpointer data)
+{
+	Snippet *snippet = data;
+
+	g_free(snippet->body);
+	g_slice_free(Snippet, snippet);
+}
+
+
+static Snippet * snippet_compile(const gchar *body)
+{
+	Snippet *snippet = g_slice_new0(Snippet);
+	const gchar *iter;
+
+	snippet->body = g_strdup(body);
+
+	/* To prevent insertion of a snippet, which user intended to use,
+	 * e.g., in JavaScript, ensure the snippet body starts with a tag.
+	 * We don't prevent name clashes by using special snippet names
+	 * as it won't allow the plugin to automatically catch up the
+	 * snippets supplied with Geany, e.g. "table". */
+	iter = snippet->body;
+	while (TRUE)
+	{
+		if (isspace(*iter))
+			iter++;
+		else if (*iter == '\\' && (*(iter+1) == 'n' || *(iter+1) == 't'))
+			iter += 2;
+		else
+			break;
+	}
+	if (*iter != '<')
+		return snippet;
+
+	snippet->is_tag = TRUE;
+	iter = skip_xml_tag_name(iter + 1); /* +1: skip the left bracket */
+	snippet->head_len = iter - snippet->body;
+	snippet->has_attributes = (*iter != '>');
+	return snippet;
+}
+
+
+/* Gets the compiled snippet for @a tagname, compiling it again if the configuration
+ * changed since it was last used
+ * @return   The snippet, or @c NULL if there is no snippet named @a tagname */
+static const Snippet * find_snippet(GeanyEditor *editor, const gchar *tagname)
+{
+	const gchar *body;
+	Snippet *snippet;
+
+	body = editor_find_snippet(editor, tagname);
+	if (body == NULL)
+		return NULL;
+
+	if (snippets == NULL)
+		snippets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, snippet_free);
+
+	snippet = g_hash_table_lookup(snippets, tagname);
+	if (snippet == NULL || strcmp(snippet->body, body) != 0)
+	{
+		snippet = snippet_compile(body);
+		g_hash_table_insert(snippets, g_strdup(tagname), snippet);
+	}
+	return snippet;
+}
+
+
+void clear_snippets(void)
+{
+	if (snippets != NULL)
+	{
+		g_hash_table_destroy(snippets);
+		snippets = NULL;
+	}
+}
+
+
 /* If user entered some attributes, copy them to the first tag within snippet body
  * @return   Newly allocated completion string or @c NULL to indicate
  *           that completion should be aborted
  */
-static gchar * merge_attributes(const gchar *sel, gint size, const Info * info)
+static gchar * merge_attributes(const gchar *sel, gint size, const Snippet *snippet,
+	const gchar *tag_name_end)
 {
 	const gchar *input_iter, *input_iter_end, *iter;
 
 	/* Separately ensure there is at least one space
 	 * Needed for the code below which copy attributes */
-	input_iter = info->input.tag_name_end;
+	input_iter = tag_name_end;
 	if (!isspace(*input_iter))
 		goto normal; /* nothing to do */
 
@@ -79,9 +157,7 @@ static gchar * merge_attributes(const gchar *sel, gint size, const Info * info)
 	input_iter_end++;
 
 	/* Ensure the tag within snippet body does not contain attributes */
-	iter = info->snippet.tag_name_start;
-	iter = skip_xml_tag_name(iter);
-	if (*iter != '>')
+	if (snippet->has_attributes)
 	{
 		g_message("%s",
 			"Autocompletion aborted: both of the input string and "
@@ -92,7 +168,8 @@ static gchar * merge_attributes(const gchar *sel, gint size, const Info * info)
 	/* Merge */
 	{
 		GString *completion = g_string_sized_new(20);
-		g_string_append_len(completion, info->snippet.completion, iter - info->snippet.completion);
+		iter = snippet->body + snippet->head_len;
+		g_string_append_len(completion, snippet->body, snippet->head_len);
 
 		input_iter -= 1; /* leave one space */
 		for (; input_iter != input_iter_end; ++input_iter)
@@ -120,15 +197,15 @@ static gchar * merge_attributes(const gchar *sel, gint size, const Info * info)
 	abort:
 		return NULL;
 	normal:
-		return g_strdup(info->snippet.completion);
+		return g_strdup(snippet->body);
 }
 
 
 gboolean get_completion(GeanyEditor *editor, const gchar *sel, const gint size,
 	CompletionInfo * c, InputInfo * i)
 {
-	Info info;
-	const gchar *str_found, *tagname, *input_iter, *completion, *iter;
+	const Snippet *snippet;
+	const gchar *str_found, *tagname, *input_iter;
 	gchar *completion_result;
 
 	g_return_val_if_fail(sel[size-1] == '>', FALSE);
@@ -147,34 +224,12 @@ gboolean get_completion(GeanyEditor *editor, const gchar *sel, const gint size,
 		return FALSE;
 
 	tagname = g_strndup(tagname, input_iter - tagname);
-	completion = editor_find_snippet(editor, tagname);
+	snippet = find_snippet(editor, tagname);
 	g_free((gchar *)tagname);
-	if (completion == NULL)
+	if (snippet == NULL || !snippet->is_tag)
 		return FALSE;
 
-	/* To prevent insertion of a snippet, which user intended to use,
-	 * e.g., in JavaScript, ensure the snippet body starts with a tag.
-	 * We don't prevent name clashes by using special snippet names
-	 * as it won't allow the plugin to automatically catch up the
-	 * snippets supplied with Geany, e.g. "table". */
-	iter = completion;
-	while (TRUE)
-	{
-		if (isspace(*iter))
-			iter++;
-		else if (*iter == '\\' && (*(iter+1) == 'n' || *(iter+1) == 't'))
-			iter += 2;
-		else
-			break;
-	}
-	if (*iter != '<')
-		return FALSE;
-
-	info.snippet.completion = completion;
-	info.snippet.tag_name_start = iter+1; /* +1: skip the left bracket */
-	info.input.tag_name_end = input_iter;
-
-	completion_result = merge_attributes(sel, size, &info);
+	completion_result = merge_attributes(sel, size, snippet, input_iter);
 	if (completion_result == NULL)
 		return FALSE;
 
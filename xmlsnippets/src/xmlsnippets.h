@@ -42,4 +42,6 @@ typedef struct CompletionInfo
 gboolean get_completion(GeanyEditor *editor, const gchar *sel, const gint size,
   CompletionInfo * c, InputInfo * i);
 
+void clear_snippets(void);
+
 #endif